@@ -0,0 +1,86 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <Eigen/Geometry>
+#include <cstddef>
+#include <vector>
+
+namespace collision_detection
+{
+/** \brief A bounding volume hierarchy over a set of axis-aligned bounding boxes.
+ *
+ * The tree is built once for all boxes and answers which of them overlap a query region. Boxes which are unbounded
+ * (e.g. of planes) are kept outside of the hierarchy and tested for every query. */
+class AABBTree
+{
+public:
+  /** \brief Build the tree over \e boxes, replacing its previous contents. Queries report indices into \e boxes. */
+  void build(const std::vector<Eigen::AlignedBox3d>& boxes);
+
+  /** \brief Remove all boxes */
+  void clear();
+
+  /** \brief Append the indices of the boxes intersecting \e box to \e result */
+  void queryAABB(const Eigen::AlignedBox3d& box, std::vector<std::size_t>& result) const;
+
+  /** \brief Append the indices of the boxes within distance \e radius of \e center to \e result */
+  void queryRadius(const Eigen::Vector3d& center, double radius, std::vector<std::size_t>& result) const;
+
+  /** \brief Get the number of bytes allocated for the nodes and boxes */
+  std::size_t getMemoryUsage() const;
+
+private:
+  struct Node
+  {
+    Eigen::AlignedBox3d box;
+    /** \brief For leaves the first entry of items_, otherwise the index of the second child (the first one follows
+     * the node directly) */
+    std::size_t index;
+    /** \brief Number of items of a leaf, 0 for inner nodes */
+    std::size_t count;
+  };
+
+  template <typename Predicate>
+  void query(const Predicate& overlaps, std::vector<std::size_t>& result) const;
+
+  std::size_t buildNode(std::size_t begin, std::size_t end);
+
+  std::vector<Node> nodes_;
+  std::vector<std::size_t> items_;
+  std::vector<Eigen::AlignedBox3d> boxes_;
+  std::vector<std::size_t> unbounded_items_;
+};
+}  // namespace collision_detection
@@ -41,6 +41,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 #include <set>
 #include <Eigen/Core>
 #include <moveit/robot_model/robot_model.h>
@@ -154,6 +155,28 @@ enum DistanceRequestType
 using DistanceRequestType = DistanceRequestTypes::DistanceRequestType;
 
 /** \brief Representation of a distance-reporting request */
+/** \brief Backend-specific state kept by a DistanceQueryCache between queries */
+struct DistanceQueryCacheData
+{
+  virtual ~DistanceQueryCacheData() = default;
+};
+
+/** \brief Carries information between distance queries on consecutive, similar robot states.
+
+    Backends that support it store per-pair bounds here and use them to skip pairs that provably cannot be closer
+    than the current threshold, e.g. when sampling along a trajectory or in a control loop. Backends without support
+    ignore it. A cache is not thread-safe: use one per stream of queries. */
+struct DistanceQueryCache
+{
+  /// Drop all information gathered so far
+  void clear()
+  {
+    data.reset();
+  }
+
+  std::shared_ptr<DistanceQueryCacheData> data;
+};
+
 struct DistanceRequest
 {
   DistanceRequest()
@@ -166,6 +189,7 @@ struct DistanceRequest
     , distance_threshold(std::numeric_limits<double>::max())
     , verbose(false)
     , compute_gradient(false)
+    , cache(nullptr)
   {
   }
 
@@ -211,6 +235,10 @@ struct DistanceRequest
   /// Indicate if gradient should be calculated between each object.
   /// This is the normalized vector connecting the closest points on the two objects.
   bool compute_gradient;
+
+  /// Optional cache reused across consecutive queries (see DistanceQueryCache). Results are identical with or without
+  /// it; only the amount of work changes.
+  DistanceQueryCache* cache;
 };
 
 /** \brief Generic representation of the distance information for a pair of objects */
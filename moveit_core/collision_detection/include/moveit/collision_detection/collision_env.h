@@ -156,6 +156,28 @@ public:
                                    const moveit::core::RobotState& state1,
                                    const moveit::core::RobotState& state2) const = 0;
 
+  /** \brief Check many states of the robot model for collision with the world. Self collisions are not checked.
+   *  This is equivalent to calling checkRobotCollision(req, results[i], *states[i]) for each state, but lets the
+   *  collision checking libraries amortize the setup of the check and distribute the states over multiple threads.
+   *  @param req A CollisionRequest object that is used for all states
+   *  @param states The kinematic states for which checks are being made; their collision body transforms need to be up
+   *  to date
+   *  @param results Resized to the number of states and filled with one CollisionResult per state */
+  virtual void checkRobotCollisionBatch(const CollisionRequest& req,
+                                        const std::vector<const moveit::core::RobotState*>& states,
+                                        std::vector<CollisionResult>& results) const;
+
+  /** \brief Check many states of the robot model for collision with the world, taking into account the allowed
+   *  collisions specified by \e acm. Self collisions are not checked.
+   *  @param req A CollisionRequest object that is used for all states
+   *  @param states The kinematic states for which checks are being made; their collision body transforms need to be up
+   *  to date
+   *  @param results Resized to the number of states and filled with one CollisionResult per state
+   *  @param acm The allowed collision matrix. */
+  virtual void checkRobotCollisionBatch(const CollisionRequest& req,
+                                        const std::vector<const moveit::core::RobotState*>& states,
+                                        std::vector<CollisionResult>& results, const AllowedCollisionMatrix& acm) const;
+
   /** \brief The distance to self-collision given the robot is at state \e state.
       @param req A DistanceRequest object that encapsulates the distance request
       @param res A DistanceResult object that encapsulates the distance result
@@ -302,6 +324,10 @@ public:
   /** @brief Get the link scaling as a vector of messages*/
   void getScale(std::vector<moveit_msgs::msg::LinkScale>& scale) const;
 
+  /** @brief Estimate the memory held by the collision geometry and caches of this environment, not counting the
+   * world, see World::getMemoryUsage(). The default implementation reports nothing. */
+  virtual moveit::MemoryUsage getMemoryUsage() const;
+
 protected:
   /** @brief When the scale or padding is changed for a set of links by any of the functions in this class,
      updatedPaddingOrScaling() function is called.
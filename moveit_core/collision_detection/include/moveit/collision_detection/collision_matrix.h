@@ -39,10 +39,13 @@
 #include <moveit/collision_detection/collision_common.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/msg/allowed_collision_matrix.hpp>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -71,6 +74,99 @@ enum Type
 using DecideContactFn = std::function<bool(collision_detection::Contact&)>;
 
 MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix);  // Defines AllowedCollisionMatrixPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CompiledAllowedCollisionMatrix);  // Defines CompiledAllowedCollisionMatrixPtr, ConstPtr, WeakPtr...
+
+/** @class CompiledAllowedCollisionMatrix
+ *  @brief Immutable snapshot of an AllowedCollisionMatrix optimized for lookups in collision callbacks.
+ *
+ *  Every name known to the matrix is assigned a dense index. The explicitly set entries are stored as rows of bits,
+ *  the default entries as one value per index, and the DecideContactFn predicates in a side table that is only
+ *  consulted for conditional entries. Queries give the same answers as the corresponding functions of
+ *  AllowedCollisionMatrix. Use AllowedCollisionMatrix::getCompiled() to obtain an instance. */
+class CompiledAllowedCollisionMatrix
+{
+public:
+  /** @brief Index returned by getIndex() for names that are not known to the matrix */
+  static constexpr int UNKNOWN_INDEX = -1;
+
+  /** @brief Build the compiled form of \e acm */
+  CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  /** @brief Get the dense index of \e name, or UNKNOWN_INDEX if the name has no entries and no default */
+  int getIndex(const std::string& name) const
+  {
+    const auto it = indices_.find(name);
+    return it == indices_.end() ? UNKNOWN_INDEX : it->second;
+  }
+
+  /** @brief Get the number of names known to the matrix */
+  std::size_t getSize() const
+  {
+    return names_.size();
+  }
+
+  /** @brief Same as AllowedCollisionMatrix::getAllowedCollision(), for elements given by their index.
+   *  Either index may be UNKNOWN_INDEX. */
+  bool getAllowedCollision(int index1, int index2, AllowedCollision::Type& allowed_collision) const;
+
+  /** @brief Same as AllowedCollisionMatrix::getAllowedCollision(), for elements given by their index.
+   *  Either index may be UNKNOWN_INDEX. */
+  bool getAllowedCollision(int index1, int index2, DecideContactFn& fn) const;
+
+  bool getAllowedCollision(const std::string& name1, const std::string& name2,
+                           AllowedCollision::Type& allowed_collision) const
+  {
+    return getAllowedCollision(getIndex(name1), getIndex(name2), allowed_collision);
+  }
+
+  bool getAllowedCollision(const std::string& name1, const std::string& name2, DecideContactFn& fn) const
+  {
+    return getAllowedCollision(getIndex(name1), getIndex(name2), fn);
+  }
+
+private:
+  /** @brief Value of default_types_ for names without a default entry */
+  static constexpr std::int8_t NO_DEFAULT = -1;
+
+  bool testBit(const std::vector<std::uint64_t>& bits, int index1, int index2) const
+  {
+    const std::size_t bit = static_cast<std::size_t>(index2);
+    return (bits[static_cast<std::size_t>(index1) * words_per_row_ + (bit >> 6)] >> (bit & 63)) & 1;
+  }
+
+  void setBit(std::vector<std::uint64_t>& bits, int index1, int index2)
+  {
+    const std::size_t bit = static_cast<std::size_t>(index2);
+    bits[static_cast<std::size_t>(index1) * words_per_row_ + (bit >> 6)] |= std::uint64_t(1) << (bit & 63);
+  }
+
+  std::size_t pairKey(int index1, int index2) const
+  {
+    return static_cast<std::size_t>(index1) * names_.size() + static_cast<std::size_t>(index2);
+  }
+
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, int> indices_;
+  std::size_t words_per_row_;
+
+  /** @brief Bit (i, j) is set if the pair has an explicit entry */
+  std::vector<std::uint64_t> entry_bits_;
+
+  /** @brief Bit (i, j) is set if the explicit entry of the pair is AllowedCollision::ALWAYS */
+  std::vector<std::uint64_t> always_bits_;
+
+  /** @brief Bit (i, j) is set if the explicit entry of the pair is AllowedCollision::CONDITIONAL */
+  std::vector<std::uint64_t> conditional_bits_;
+
+  /** @brief Explicitly set predicates, keyed by pairKey() */
+  std::unordered_map<std::size_t, DecideContactFn> contact_fns_;
+
+  /** @brief Default AllowedCollision::Type of each index, or NO_DEFAULT */
+  std::vector<std::int8_t> default_types_;
+
+  /** @brief Default predicate of each index (empty if there is none) */
+  std::vector<DecideContactFn> default_contact_fns_;
+};
 
 /** @class AllowedCollisionMatrix
  *  @brief Definition of a structure for the allowed collision matrix. All elements in the collision world are referred
@@ -94,10 +190,10 @@ public:
   AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg);
 
   /** @brief Copy constructor */
-  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm) = default;
+  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
 
   /** @brief Copy assignment */
-  AllowedCollisionMatrix& operator=(const AllowedCollisionMatrix&) = default;
+  AllowedCollisionMatrix& operator=(const AllowedCollisionMatrix& acm);
 
   /** @brief Get the type of the allowed collision between two elements.
    *  Return true if the entry is included in the collision matrix. Return false if the entry is not found.
@@ -246,14 +342,28 @@ public:
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
+  /** @brief Get the compiled form of this matrix for fast repeated lookups.
+   *
+   *  The compiled form is built on first use and kept until the matrix is modified. This function may be called
+   *  concurrently from multiple threads, as long as the matrix itself is not modified at the same time. */
+  CompiledAllowedCollisionMatrixConstPtr getCompiled() const;
+
 private:
+  friend class CompiledAllowedCollisionMatrix;
+
   bool getDefaultEntry(const std::string& name1, const std::string& name2,
                        AllowedCollision::Type& allowed_collision) const;
 
+  /** @brief Drop the compiled form, called by all functions modifying the matrix */
+  void invalidateCompiled();
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
+
+  /** @brief Lazily built compiled form, accessed through std::atomic_load() / std::atomic_store() */
+  mutable CompiledAllowedCollisionMatrixConstPtr compiled_;
 };
 }  // namespace collision_detection
@@ -55,6 +55,18 @@ public:
    */
   bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene);
 
+  /**
+   * @brief Activate a collision plugin, keeping the previously active collision environments alive in the scene.
+   *
+   * Inactive environments stay synchronized with the scene's world, so switching between detectors repeatedly
+   * (e.g. FCL for octomaps and Bullet for continuous checks) reuses them instead of rebuilding from the world.
+   * @param name The plugin name, which matches the name of the collision detector allocator it installs.
+   * @param scene The planning scene instance.
+   * @param keep_inactive If true, the scene retains inactive collision detectors.
+   * @return success / failure
+   */
+  bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene, bool keep_inactive);
+
 private:
   MOVEIT_CLASS_FORWARD(CollisionPluginCacheImpl);
   CollisionPluginCacheImplPtr cache_;
@@ -59,6 +59,11 @@ public:
   {
   }
 
+  /** @brief Copy the nodes of a tree. The caller needs to hold a read lock of the copied tree, if it is shared */
+  explicit OccMapTree(const octomap::OcTree& tree) : octomap::OcTree(tree)
+  {
+  }
+
   /** @brief lock the underlying octree. it will not be read or written by the
    *  monitor until unlockTree() is called */
   void lockRead()
@@ -43,6 +43,7 @@
 
 #include <urdf_parser/urdf_parser.h>
 #include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
 
 #include <gtest/gtest.h>
 #include <sstream>
@@ -164,6 +165,27 @@ TYPED_TEST_P(CollisionDetectorPandaTest, RobotWorldCollision_1)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief An octree that is updated in place is checked with its new voxels once its shape is set again. */
+TYPED_TEST_P(CollisionDetectorPandaTest, OctomapUpdatedInPlace)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+
+  auto octree = std::make_shared<octomap::OcTree>(0.05);
+  octree->updateNode(octomap::point3d(2.0, 2.0, 2.0), true);
+  shapes::ShapeConstPtr shape_ptr = std::make_shared<const shapes::OcTree>(octree);
+  this->cenv_->getWorld()->addToObject("octomap", shape_ptr, Eigen::Isometry3d::Identity());
+
+  this->cenv_->checkRobotCollision(req, res, *this->robot_state_, *this->acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+
+  octree->updateNode(octomap::point3d(0.0, 0.0, 0.3), true);
+  this->cenv_->getWorld()->moveShapeInObject("octomap", shape_ptr, Eigen::Isometry3d::Identity());
+  this->cenv_->checkRobotCollision(req, res, *this->robot_state_, *this->acm_);
+  ASSERT_TRUE(res.collision);
+}
+
 /** \brief Adding obstacles to the world which are tested against the robot. */
 TYPED_TEST_P(CollisionDetectorPandaTest, RobotWorldCollision_2)
 {
@@ -355,7 +377,8 @@ TYPED_TEST_P(DistanceFullPandaTest, DistancePoints)
 }
 
 REGISTER_TYPED_TEST_SUITE_P(CollisionDetectorPandaTest, InitOK, DefaultNotInCollision, LinksInCollision,
-                            RobotWorldCollision_1, RobotWorldCollision_2, PaddingTest, DistanceSelf, DistanceWorld);
+                            RobotWorldCollision_1, OctomapUpdatedInPlace, RobotWorldCollision_2, PaddingTest,
+                            DistanceSelf, DistanceWorld);
 
 REGISTER_TYPED_TEST_SUITE_P(DistanceCheckPandaTest, DistanceSingle);
 
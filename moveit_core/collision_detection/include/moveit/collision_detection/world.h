@@ -37,13 +37,18 @@
 #pragma once
 
 #include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection/aabb_tree.h>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #include <functional>
 #include <Eigen/Geometry>
 #include <eigen_stl_containers/eigen_stl_vector_container.h>
 #include <moveit/transforms/transforms.h>
+#include <moveit/utils/memory_usage.h>
 
 namespace shapes
 {
@@ -148,6 +153,38 @@ public:
   /** \brief Check if a particular object exists in the collision world*/
   bool hasObject(const std::string& object_id) const;
 
+  /** \brief Get a number identifying the current contents of the world.
+   *
+   * The version changes with every change of an object and is unique among all worlds of the process, except for
+   * copies of a world, which share its version until either of them changes. */
+  std::size_t getVersion() const
+  {
+    return version_;
+  }
+
+  /** \brief Get the ids of the objects whose axis-aligned bounding box (in the world frame) intersects \e box.
+   *
+   * Queries are answered from a bounding volume hierarchy over the objects, which is updated with the objects changed
+   * since the previous query. Objects with an unbounded shape (planes) are matched by any region they intersect. */
+  std::vector<std::string> queryAABB(const Eigen::AlignedBox3d& box) const;
+
+  /** \brief Get the ids of the objects whose axis-aligned bounding box (in the world frame) is no further than \e
+   * radius from \e center */
+  std::vector<std::string> queryRadius(const Eigen::Vector3d& center, double radius) const;
+
+  /** \brief Get the axis-aligned bounding box of the object \e object_id in the world frame, which is empty if the
+   * object does not exist */
+  Eigen::AlignedBox3d getObjectAABB(const std::string& object_id) const;
+
+  /** \brief Estimate the memory held by the world: "objects" for the ids, poses and subframes of the objects,
+   * "meshes", "octomaps" and "primitives" for their shapes and "spatial_index" for the bounding volume hierarchy.
+   * Copies of a world share the shapes, which each of them counts. */
+  moveit::MemoryUsage getMemoryUsage() const;
+
+  /** \brief Estimate the number of bytes held by the data of \e shape, e.g. the vertices and triangles of a mesh or
+   * the nodes of an octree */
+  static std::size_t getShapeMemoryUsage(const shapes::Shape& shape);
+
   /** \brief Check if an object or subframe with given name exists in the collision world.
    * A subframe name needs to be prefixed with the object's name separated by a slash. */
   bool knowsTransform(const std::string& name) const;
@@ -299,6 +336,7 @@ public:
   };
 
   using ObserverCallbackFn = std::function<void(const ObjectConstPtr&, Action)>;
+  using ObserverBatchCallbackFn = std::function<void()>;
 
   /** \brief register a callback function for notification of changes.
    * \e callback will be called right after any change occurs to any Object.
@@ -306,6 +344,12 @@ public:
    * used for identifying the callback in removeObserver(). */
   ObserverHandle addObserver(const ObserverCallbackFn& callback);
 
+  /** \brief register a callback function for notification of changes, as well as callbacks that are called before
+   * and after the notifications deferred by a BatchUpdate are delivered. This lets observers process the changes of
+   * a batch in bulk. */
+  ObserverHandle addObserver(const ObserverCallbackFn& callback, const ObserverBatchCallbackFn& batch_begin_callback,
+                             const ObserverBatchCallbackFn& batch_end_callback);
+
   /** \brief remove a notifier callback */
   void removeObserver(const ObserverHandle observer_handle);
 
@@ -313,10 +357,35 @@ public:
    * Used which switching from one world to another. */
   void notifyObserverAllObjects(const ObserverHandle observer_handle, Action action) const;
 
+  /** \brief Defers the notification of observers while in scope.
+   *
+   * When the outermost BatchUpdate of a world goes out of scope, each object that changed is notified once, with the
+   * union of the actions applied to it. Objects that were created and destroyed within the batch are not notified at
+   * all. Observers, e.g. collision environments, are therefore not up to date with the world until then. */
+  class BatchUpdate
+  {
+  public:
+    explicit BatchUpdate(World& world);
+    ~BatchUpdate();
+
+    BatchUpdate(const BatchUpdate&) = delete;
+    BatchUpdate& operator=(const BatchUpdate&) = delete;
+
+  private:
+    World& world_;
+  };
+
 private:
   /** notify all observers of a change */
   void notify(const ObjectConstPtr& /*obj*/, Action /*action*/);
 
+  /** deliver the notifications deferred by BatchUpdate */
+  void notifyPending();
+
+  /** update the bounding boxes of the changed objects and rebuild the spatial index if needed.
+   * Must be called with spatial_index_lock_ held. */
+  void updateSpatialIndex() const;
+
   /** send notification of change to all objects. */
   void notifyAll(Action action);
 
@@ -335,6 +404,9 @@ private:
   /** The objects maintained in the world */
   std::map<std::string, ObjectPtr> objects_;
 
+  /** Identifies the contents of objects_, see getVersion() */
+  std::size_t version_;
+
   /** Wrapper for a callback function to call when something changes in the world */
   class Observer
   {
@@ -343,9 +415,35 @@ private:
     {
     }
     ObserverCallbackFn callback_;
+    ObserverBatchCallbackFn batch_begin_callback_;
+    ObserverBatchCallbackFn batch_end_callback_;
   };
 
   /// All registered observers of this world representation
   std::vector<Observer*> observers_;
+
+  /** A notification deferred by BatchUpdate. Only destroyed objects are referenced, as referencing the objects still
+   * in the world would force copies on their next change. */
+  struct PendingNotification
+  {
+    std::string id_;
+    ObjectConstPtr destroyed_object_;
+    int action_;
+  };
+
+  /// Number of BatchUpdate instances in scope
+  std::size_t batch_depth_ = 0;
+  std::vector<PendingNotification> pending_notifications_;
+  /// Index of the latest entry of pending_notifications_ for each object id
+  std::unordered_map<std::string, std::size_t> latest_pending_notification_;
+
+  /** The spatial index over the objects' bounding boxes is updated lazily by the (const) queries, which may run
+   * concurrently. Changes to the world are not concurrent with queries, so they only record which objects changed. */
+  mutable std::mutex spatial_index_lock_;
+  mutable std::map<std::string, Eigen::AlignedBox3d> object_aabbs_;
+  mutable std::set<std::string> changed_object_aabbs_;
+  mutable std::vector<std::string> spatial_index_ids_;
+  mutable AABBTree spatial_index_;
+  mutable bool spatial_index_valid_ = true;
 };
 }  // namespace collision_detection
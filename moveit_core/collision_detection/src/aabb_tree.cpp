@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection/aabb_tree.h>
+#include <algorithm>
+
+namespace collision_detection
+{
+namespace
+{
+// Number of boxes below which a node is not split any further
+constexpr std::size_t MAX_LEAF_SIZE = 4;
+}  // namespace
+
+void AABBTree::build(const std::vector<Eigen::AlignedBox3d>& boxes)
+{
+  clear();
+  boxes_ = boxes;
+  for (std::size_t i = 0; i < boxes_.size(); ++i)
+  {
+    if (boxes_[i].isEmpty())
+      continue;
+    if (boxes_[i].min().allFinite() && boxes_[i].max().allFinite())
+      items_.push_back(i);
+    else
+      unbounded_items_.push_back(i);
+  }
+  if (!items_.empty())
+  {
+    nodes_.reserve(2 * (items_.size() / MAX_LEAF_SIZE + 1));
+    buildNode(0, items_.size());
+  }
+}
+
+void AABBTree::clear()
+{
+  nodes_.clear();
+  items_.clear();
+  boxes_.clear();
+  unbounded_items_.clear();
+}
+
+std::size_t AABBTree::getMemoryUsage() const
+{
+  return nodes_.capacity() * sizeof(Node) + items_.capacity() * sizeof(std::size_t) +
+         boxes_.capacity() * sizeof(Eigen::AlignedBox3d) + unbounded_items_.capacity() * sizeof(std::size_t);
+}
+
+std::size_t AABBTree::buildNode(std::size_t begin, std::size_t end)
+{
+  const std::size_t node_index = nodes_.size();
+  nodes_.push_back(Node{ Eigen::AlignedBox3d(), begin, end - begin });
+  Eigen::AlignedBox3d centers;
+  for (std::size_t i = begin; i < end; ++i)
+  {
+    nodes_[node_index].box.extend(boxes_[items_[i]]);
+    centers.extend(boxes_[items_[i]].center());
+  }
+  if (end - begin <= MAX_LEAF_SIZE)
+    return node_index;
+
+  // split at the median of the box centers along the axis they are spread the most
+  Eigen::Index axis;
+  centers.sizes().maxCoeff(&axis);
+  const std::size_t middle = begin + (end - begin) / 2;
+  std::nth_element(items_.begin() + begin, items_.begin() + middle, items_.begin() + end,
+                   [this, axis](std::size_t a, std::size_t b) {
+                     return boxes_[a].center()[axis] < boxes_[b].center()[axis];
+                   });
+  buildNode(begin, middle);
+  const std::size_t second_child = buildNode(middle, end);
+  nodes_[node_index].index = second_child;
+  nodes_[node_index].count = 0;
+  return node_index;
+}
+
+template <typename Predicate>
+void AABBTree::query(const Predicate& overlaps, std::vector<std::size_t>& result) const
+{
+  for (std::size_t item : unbounded_items_)
+    if (overlaps(boxes_[item]))
+      result.push_back(item);
+  if (nodes_.empty())
+    return;
+
+  std::vector<std::size_t> stack{ 0 };
+  while (!stack.empty())
+  {
+    const Node& node = nodes_[stack.back()];
+    const std::size_t node_index = stack.back();
+    stack.pop_back();
+    if (!overlaps(node.box))
+      continue;
+    if (node.count == 0)
+    {
+      stack.push_back(node.index);
+      stack.push_back(node_index + 1);
+      continue;
+    }
+    for (std::size_t i = node.index; i < node.index + node.count; ++i)
+      if (overlaps(boxes_[items_[i]]))
+        result.push_back(items_[i]);
+  }
+}
+
+void AABBTree::queryAABB(const Eigen::AlignedBox3d& box, std::vector<std::size_t>& result) const
+{
+  query([&box](const Eigen::AlignedBox3d& other) { return box.intersects(other); }, result);
+}
+
+void AABBTree::queryRadius(const Eigen::Vector3d& center, double radius, std::vector<std::size_t>& result) const
+{
+  const double squared_radius = radius * radius;
+  query(
+      [&center, squared_radius](const Eigen::AlignedBox3d& other) {
+        // distance of the center to the closest point of the box
+        const Eigen::Vector3d closest = center.cwiseMax(other.min()).cwiseMin(other.max());
+        return (closest - center).squaredNorm() <= squared_radius;
+      },
+      result);
+}
+}  // namespace collision_detection
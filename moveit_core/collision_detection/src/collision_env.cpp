@@ -280,6 +280,11 @@ void CollisionEnv::getScale(std::vector<moveit_msgs::msg::LinkScale>& scale) con
   }
 }
 
+moveit::MemoryUsage CollisionEnv::getMemoryUsage() const
+{
+  return moveit::MemoryUsage();
+}
+
 void CollisionEnv::updatedPaddingOrScaling(const std::vector<std::string>& /*links*/)
 {
 }
@@ -308,4 +313,25 @@ void CollisionEnv::checkCollision(const CollisionRequest& req, CollisionResult&
   if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
     checkRobotCollision(req, res, state, acm);
 }
+
+void CollisionEnv::checkRobotCollisionBatch(const CollisionRequest& req,
+                                            const std::vector<const moveit::core::RobotState*>& states,
+                                            std::vector<CollisionResult>& results) const
+{
+  results.clear();
+  results.resize(states.size());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    checkRobotCollision(req, results[i], *states[i]);
+}
+
+void CollisionEnv::checkRobotCollisionBatch(const CollisionRequest& req,
+                                            const std::vector<const moveit::core::RobotState*>& states,
+                                            std::vector<CollisionResult>& results,
+                                            const AllowedCollisionMatrix& acm) const
+{
+  results.clear();
+  results.resize(states.size());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    checkRobotCollision(req, results[i], *states[i], acm);
+}
 }  // end of namespace collision_detection
@@ -39,6 +39,7 @@
 #include <rclcpp/logging.hpp>
 #include <functional>
 #include <iomanip>
+#include <memory>
 
 namespace collision_detection
 {
@@ -49,6 +50,28 @@ AllowedCollisionMatrix::AllowedCollisionMatrix()
 {
 }
 
+AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+  : entries_(acm.entries_)
+  , allowed_contacts_(acm.allowed_contacts_)
+  , default_entries_(acm.default_entries_)
+  , default_allowed_contacts_(acm.default_allowed_contacts_)
+  , compiled_(std::atomic_load(&acm.compiled_))
+{
+}
+
+AllowedCollisionMatrix& AllowedCollisionMatrix::operator=(const AllowedCollisionMatrix& acm)
+{
+  if (this != &acm)
+  {
+    entries_ = acm.entries_;
+    allowed_contacts_ = acm.allowed_contacts_;
+    default_entries_ = acm.default_entries_;
+    default_allowed_contacts_ = acm.default_allowed_contacts_;
+    std::atomic_store(&compiled_, std::atomic_load(&acm.compiled_));
+  }
+  return *this;
+}
+
 AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, const bool allowed)
 {
   for (std::size_t i = 0; i < names.size(); ++i)
@@ -144,6 +167,7 @@ bool AllowedCollisionMatrix::hasEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, const bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
 
@@ -166,12 +190,14 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, DecideContactFn& fn)
 {
+  invalidateCompiled();
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
 {
+  invalidateCompiled();
   entries_.erase(name);
   allowed_contacts_.erase(name);
   for (auto& entry : entries_)
@@ -182,6 +208,7 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  invalidateCompiled();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -241,6 +268,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name, const bool allowe
 
 void AllowedCollisionMatrix::setEntry(const bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
@@ -249,6 +277,7 @@ void AllowedCollisionMatrix::setEntry(const bool allowed)
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, const bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
@@ -256,6 +285,7 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, const bool
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, DecideContactFn& fn)
 {
+  invalidateCompiled();
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
 }
@@ -336,6 +366,7 @@ bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const
 
 void AllowedCollisionMatrix::clear()
 {
+  invalidateCompiled();
   entries_.clear();
   allowed_contacts_.clear();
   default_entries_.clear();
@@ -447,4 +478,132 @@ void AllowedCollisionMatrix::print(std::ostream& out) const
   }
 }
 
+CompiledAllowedCollisionMatrixConstPtr AllowedCollisionMatrix::getCompiled() const
+{
+  CompiledAllowedCollisionMatrixConstPtr compiled = std::atomic_load(&compiled_);
+  if (!compiled)
+  {
+    // concurrent callers may both compile; either result is equivalent
+    compiled = std::make_shared<const CompiledAllowedCollisionMatrix>(*this);
+    std::atomic_store(&compiled_, compiled);
+  }
+  return compiled;
+}
+
+void AllowedCollisionMatrix::invalidateCompiled()
+{
+  std::atomic_store(&compiled_, CompiledAllowedCollisionMatrixConstPtr());
+}
+
+CompiledAllowedCollisionMatrix::CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+{
+  const auto add_name = [this](const std::string& name) {
+    if (indices_.emplace(name, static_cast<int>(names_.size())).second)
+      names_.push_back(name);
+  };
+  for (const auto& entry : acm.entries_)
+  {
+    add_name(entry.first);
+    for (const auto& other : entry.second)
+      add_name(other.first);
+  }
+  for (const auto& entry : acm.default_entries_)
+    add_name(entry.first);
+
+  const std::size_t count = names_.size();
+  words_per_row_ = (count + 63) / 64;
+  entry_bits_.assign(count * words_per_row_, 0);
+  always_bits_.assign(count * words_per_row_, 0);
+  conditional_bits_.assign(count * words_per_row_, 0);
+  default_types_.assign(count, NO_DEFAULT);
+  default_contact_fns_.resize(count);
+
+  for (const auto& entry : acm.entries_)
+  {
+    const int i = indices_.at(entry.first);
+    for (const auto& other : entry.second)
+    {
+      const int j = indices_.at(other.first);
+      setBit(entry_bits_, i, j);
+      if (other.second == AllowedCollision::ALWAYS)
+        setBit(always_bits_, i, j);
+      else if (other.second == AllowedCollision::CONDITIONAL)
+        setBit(conditional_bits_, i, j);
+    }
+  }
+  for (const auto& entry : acm.allowed_contacts_)
+  {
+    // all names with predicates also have entries and are therefore known
+    const int i = indices_.at(entry.first);
+    for (const auto& other : entry.second)
+      contact_fns_[pairKey(i, indices_.at(other.first))] = other.second;
+  }
+  for (const auto& entry : acm.default_entries_)
+    default_types_[indices_.at(entry.first)] = static_cast<std::int8_t>(entry.second);
+  for (const auto& entry : acm.default_allowed_contacts_)
+    default_contact_fns_[indices_.at(entry.first)] = entry.second;
+}
+
+bool CompiledAllowedCollisionMatrix::getAllowedCollision(int index1, int index2,
+                                                         AllowedCollision::Type& allowed_collision) const
+{
+  if (index1 != UNKNOWN_INDEX && index2 != UNKNOWN_INDEX && testBit(entry_bits_, index1, index2))
+  {
+    if (testBit(always_bits_, index1, index2))
+      allowed_collision = AllowedCollision::ALWAYS;
+    else if (testBit(conditional_bits_, index1, index2))
+      allowed_collision = AllowedCollision::CONDITIONAL;
+    else
+      allowed_collision = AllowedCollision::NEVER;
+    return true;
+  }
+
+  // same combination of defaults as AllowedCollisionMatrix::getDefaultEntry()
+  const std::int8_t t1 = index1 == UNKNOWN_INDEX ? NO_DEFAULT : default_types_[index1];
+  const std::int8_t t2 = index2 == UNKNOWN_INDEX ? NO_DEFAULT : default_types_[index2];
+  if (t1 == NO_DEFAULT && t2 == NO_DEFAULT)
+    return false;
+  else if (t2 == NO_DEFAULT)
+    allowed_collision = static_cast<AllowedCollision::Type>(t1);
+  else if (t1 == NO_DEFAULT)
+    allowed_collision = static_cast<AllowedCollision::Type>(t2);
+  else if (t1 == AllowedCollision::NEVER || t2 == AllowedCollision::NEVER)
+    allowed_collision = AllowedCollision::NEVER;
+  else if (t1 == AllowedCollision::CONDITIONAL || t2 == AllowedCollision::CONDITIONAL)
+    allowed_collision = AllowedCollision::CONDITIONAL;
+  else
+    allowed_collision = AllowedCollision::ALWAYS;
+  return true;
+}
+
+bool CompiledAllowedCollisionMatrix::getAllowedCollision(int index1, int index2, DecideContactFn& fn) const
+{
+  if (index1 != UNKNOWN_INDEX && index2 != UNKNOWN_INDEX && !contact_fns_.empty())
+  {
+    const auto it = contact_fns_.find(pairKey(index1, index2));
+    if (it != contact_fns_.end())
+    {
+      fn = it->second;
+      return true;
+    }
+  }
+
+  // a default predicate exists exactly for the names with a conditional default entry
+  const bool found1 = index1 != UNKNOWN_INDEX && default_types_[index1] == AllowedCollision::CONDITIONAL;
+  const bool found2 = index2 != UNKNOWN_INDEX && default_types_[index2] == AllowedCollision::CONDITIONAL;
+  if (found1 && !found2)
+    fn = default_contact_fns_[index1];
+  else if (!found1 && found2)
+    fn = default_contact_fns_[index2];
+  else if (found1 && found2)
+  {
+    const DecideContactFn& fn1 = default_contact_fns_[index1];
+    const DecideContactFn& fn2 = default_contact_fns_[index2];
+    fn = [fn1, fn2](Contact& contact) { return andDecideContact(fn1, fn2, contact); };
+  }
+  else
+    return false;
+  return true;
+}
+
 }  // end of namespace collision_detection
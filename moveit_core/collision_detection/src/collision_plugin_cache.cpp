@@ -73,8 +73,12 @@ public:
     return plugin;
   }
 
-  bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene)
+  bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene, bool keep_inactive)
   {
+    // the scene reuses an inactive environment of the plugin's type if it still holds one
+    if (keep_inactive)
+      scene->setRetainInactiveCollisionDetectors(true);
+
     std::map<std::string, CollisionPluginPtr>::iterator it = plugins_.find(name);
     if (it == plugins_.end())
     {
@@ -106,7 +110,13 @@ CollisionPluginCache::~CollisionPluginCache() = default;
 
 bool CollisionPluginCache::activate(const std::string& name, const planning_scene::PlanningScenePtr& scene)
 {
-  return cache_->activate(name, scene);
+  return cache_->activate(name, scene, false);
+}
+
+bool CollisionPluginCache::activate(const std::string& name, const planning_scene::PlanningScenePtr& scene,
+                                    bool keep_inactive)
+{
+  return cache_->activate(name, scene, keep_inactive);
 }
 
 }  // namespace collision_detection
@@ -35,7 +35,13 @@
 /* Author: Acorn Pooley, Ioan Sucan */
 
 #include <moveit/collision_detection/world.h>
+#include <moveit/robot_model/aabb.h>
 #include <geometric_shapes/check_isometry.h>
+#include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 
@@ -44,13 +50,27 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.world");
 
-World::World()
+namespace
+{
+std::size_t nextVersion()
+{
+  static std::atomic<std::size_t> version{ 0 };
+  return ++version;
+}
+}  // namespace
+
+World::World() : version_(nextVersion())
 {
 }
 
-World::World(const World& other)
+World::World(const World& other) : version_(other.version_)
 {
   objects_ = other.objects_;
+
+  std::scoped_lock lock(other.spatial_index_lock_);
+  object_aabbs_ = other.object_aabbs_;
+  changed_object_aabbs_ = other.changed_object_aabbs_;
+  spatial_index_valid_ = false;
 }
 
 World::~World()
@@ -368,6 +388,17 @@ World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback)
   return ObserverHandle(o);
 }
 
+World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback,
+                                         const ObserverBatchCallbackFn& batch_begin_callback,
+                                         const ObserverBatchCallbackFn& batch_end_callback)
+{
+  const auto o = new Observer(callback);
+  o->batch_begin_callback_ = batch_begin_callback;
+  o->batch_end_callback_ = batch_end_callback;
+  observers_.push_back(o);
+  return ObserverHandle(o);
+}
+
 void World::removeObserver(ObserverHandle observer_handle)
 {
   for (auto obs = observers_.begin(); obs != observers_.end(); ++obs)
@@ -387,10 +418,237 @@ void World::notifyAll(Action action)
     notify(it->second, action);
 }
 
+namespace
+{
+// Compute the bounding box of all shapes of an object in the world frame
+Eigen::AlignedBox3d computeObjectAABB(const World::Object& obj)
+{
+  moveit::core::AABB aabb;
+  for (std::size_t i = 0; i < obj.shapes_.size(); ++i)
+  {
+    const shapes::Shape* shape = obj.shapes_[i].get();
+    const Eigen::Isometry3d& pose = obj.global_shape_poses_[i];
+    if (shape->type == shapes::PLANE)
+    {
+      aabb.extend(Eigen::Vector3d::Constant(-std::numeric_limits<double>::infinity()));
+      aabb.extend(Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity()));
+    }
+    else if (shape->type == shapes::MESH)
+    {
+      const auto* mesh = static_cast<const shapes::Mesh*>(shape);
+      for (unsigned int j = 0; j < mesh->vertex_count; ++j)
+        aabb.extend(pose * Eigen::Map<const Eigen::Vector3d>(&mesh->vertices[3 * j]));
+    }
+    else if (shape->type == shapes::OCTREE)
+    {
+      // octrees are not centered at their origin
+      const auto* octree = static_cast<const shapes::OcTree*>(shape);
+      if (!octree->octree || octree->octree->size() == 0)
+        continue;
+      Eigen::Vector3d min, max;
+      octree->octree->getMetricMin(min.x(), min.y(), min.z());
+      octree->octree->getMetricMax(max.x(), max.y(), max.z());
+      aabb.extendWithTransformedBox(pose * Eigen::Translation3d(0.5 * (min + max)), max - min);
+    }
+    else
+      aabb.extendWithTransformedBox(pose, shapes::computeShapeExtents(shape));
+  }
+  return aabb;
+}
+}  // namespace
+
+void World::updateSpatialIndex() const
+{
+  for (const std::string& id : changed_object_aabbs_)
+  {
+    auto it = objects_.find(id);
+    if (it != objects_.end())
+      object_aabbs_[id] = computeObjectAABB(*it->second);
+    else
+      object_aabbs_.erase(id);
+    spatial_index_valid_ = false;
+  }
+  changed_object_aabbs_.clear();
+  if (spatial_index_valid_)
+    return;
+
+  spatial_index_ids_.clear();
+  std::vector<Eigen::AlignedBox3d> boxes;
+  boxes.reserve(object_aabbs_.size());
+  for (const auto& [id, box] : object_aabbs_)
+  {
+    spatial_index_ids_.push_back(id);
+    boxes.push_back(box);
+  }
+  spatial_index_.build(boxes);
+  spatial_index_valid_ = true;
+}
+
+std::vector<std::string> World::queryAABB(const Eigen::AlignedBox3d& box) const
+{
+  std::scoped_lock lock(spatial_index_lock_);
+  updateSpatialIndex();
+  std::vector<std::size_t> indices;
+  spatial_index_.queryAABB(box, indices);
+  std::sort(indices.begin(), indices.end());
+  std::vector<std::string> ids;
+  ids.reserve(indices.size());
+  for (std::size_t index : indices)
+    ids.push_back(spatial_index_ids_[index]);
+  return ids;
+}
+
+std::vector<std::string> World::queryRadius(const Eigen::Vector3d& center, double radius) const
+{
+  std::scoped_lock lock(spatial_index_lock_);
+  updateSpatialIndex();
+  std::vector<std::size_t> indices;
+  spatial_index_.queryRadius(center, radius, indices);
+  std::sort(indices.begin(), indices.end());
+  std::vector<std::string> ids;
+  ids.reserve(indices.size());
+  for (std::size_t index : indices)
+    ids.push_back(spatial_index_ids_[index]);
+  return ids;
+}
+
+Eigen::AlignedBox3d World::getObjectAABB(const std::string& object_id) const
+{
+  std::scoped_lock lock(spatial_index_lock_);
+  updateSpatialIndex();
+  auto it = object_aabbs_.find(object_id);
+  return it != object_aabbs_.end() ? it->second : Eigen::AlignedBox3d();
+}
+
+moveit::MemoryUsage World::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  for (const auto& [id, object] : objects_)
+  {
+    const std::size_t num_shapes = object->shapes_.size();
+    const std::size_t num_subframes = object->subframe_poses_.size();
+    usage.add("objects",
+              sizeof(Object) + id.capacity() +
+                  num_shapes * (sizeof(shapes::ShapeConstPtr) + 2 * sizeof(Eigen::Isometry3d)) +
+                  num_subframes * 2 * (sizeof(std::string) + sizeof(Eigen::Isometry3d)));
+    for (const shapes::ShapeConstPtr& shape : object->shapes_)
+    {
+      const char* part = "primitives";
+      if (shape->type == shapes::MESH)
+        part = "meshes";
+      else if (shape->type == shapes::OCTREE)
+        part = "octomaps";
+      usage.add(part, getShapeMemoryUsage(*shape));
+    }
+  }
+
+  std::scoped_lock lock(spatial_index_lock_);
+  const std::size_t aabb_bytes = object_aabbs_.size() * (sizeof(std::string) + sizeof(Eigen::AlignedBox3d));
+  usage.add("spatial_index", spatial_index_.getMemoryUsage() + aabb_bytes, spatial_index_ids_.size());
+  return usage;
+}
+
+std::size_t World::getShapeMemoryUsage(const shapes::Shape& shape)
+{
+  switch (shape.type)
+  {
+    case shapes::MESH:
+    {
+      const auto& mesh = static_cast<const shapes::Mesh&>(shape);
+      std::size_t bytes = sizeof(shapes::Mesh) + mesh.vertex_count * 3 * sizeof(double) +
+                          mesh.triangle_count * 3 * sizeof(unsigned int);
+      if (mesh.triangle_normals)
+        bytes += mesh.triangle_count * 3 * sizeof(double);
+      if (mesh.vertex_normals)
+        bytes += mesh.vertex_count * 3 * sizeof(double);
+      return bytes;
+    }
+    case shapes::OCTREE:
+    {
+      const auto& octree = static_cast<const shapes::OcTree&>(shape);
+      return sizeof(shapes::OcTree) + (octree.octree ? octree.octree->memoryUsage() : 0);
+    }
+    case shapes::BOX:
+      return sizeof(shapes::Box);
+    case shapes::CYLINDER:
+      return sizeof(shapes::Cylinder);
+    case shapes::CONE:
+      return sizeof(shapes::Cone);
+    case shapes::PLANE:
+      return sizeof(shapes::Plane);
+    case shapes::SPHERE:
+      return sizeof(shapes::Sphere);
+    default:
+      return sizeof(shapes::Shape);
+  }
+}
+
 void World::notify(const ObjectConstPtr& obj, Action action)
 {
+  version_ = nextVersion();
+  changed_object_aabbs_.insert(obj->id_);
+  if (batch_depth_ == 0)
+  {
+    for (Observer* observer : observers_)
+      observer->callback_(obj, action);
+    return;
+  }
+
+  // merge with the pending notification of the same object, unless that one was destroyed since
+  auto it = latest_pending_notification_.find(obj->id_);
+  if (it != latest_pending_notification_.end())
+  {
+    PendingNotification& pending = pending_notifications_[it->second];
+    if (!(pending.action_ & DESTROY))
+    {
+      if (!(action & DESTROY))
+        pending.action_ |= action;
+      else if (pending.action_ & CREATE)
+        pending.action_ = 0;  // observers never knew about this object
+      else
+      {
+        pending.action_ = DESTROY;
+        pending.destroyed_object_ = obj;
+      }
+      return;
+    }
+  }
+  latest_pending_notification_[obj->id_] = pending_notifications_.size();
+  pending_notifications_.push_back({ obj->id_, (action & DESTROY) ? obj : ObjectConstPtr(), action });
+}
+
+void World::notifyPending()
+{
+  std::vector<PendingNotification> pending_notifications;
+  pending_notifications.swap(pending_notifications_);
+  latest_pending_notification_.clear();
+  if (pending_notifications.empty())
+    return;
+
   for (Observer* observer : observers_)
-    observer->callback_(obj, action);
+    if (observer->batch_begin_callback_)
+      observer->batch_begin_callback_();
+  for (const PendingNotification& pending : pending_notifications)
+  {
+    if (pending.action_ & DESTROY)
+      notify(pending.destroyed_object_, DESTROY);
+    else if (pending.action_)
+      notify(objects_.at(pending.id_), Action(pending.action_));
+  }
+  for (Observer* observer : observers_)
+    if (observer->batch_end_callback_)
+      observer->batch_end_callback_();
+}
+
+World::BatchUpdate::BatchUpdate(World& world) : world_(world)
+{
+  ++world_.batch_depth_;
+}
+
+World::BatchUpdate::~BatchUpdate()
+{
+  if (--world_.batch_depth_ == 0)
+    world_.notifyPending();
 }
 
 void World::notifyObserverAllObjects(const ObserverHandle observer_handle, Action action) const
@@ -0,0 +1,165 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_matrix.h>
+#include <random>
+
+using namespace collision_detection;
+
+namespace
+{
+DecideContactFn makeDecideFn(double threshold)
+{
+  return [threshold](Contact& contact) { return contact.depth < threshold; };
+}
+
+/** Expect that the compiled form of \e acm answers all queries over \e names like \e acm itself */
+void expectCompiledEqual(const AllowedCollisionMatrix& acm, const std::vector<std::string>& names)
+{
+  const CompiledAllowedCollisionMatrixConstPtr compiled = acm.getCompiled();
+  ASSERT_TRUE(compiled);
+  for (const std::string& name1 : names)
+    for (const std::string& name2 : names)
+    {
+      AllowedCollision::Type type = AllowedCollision::NEVER, compiled_type = AllowedCollision::NEVER;
+      const bool found = acm.getAllowedCollision(name1, name2, type);
+      ASSERT_EQ(found, compiled->getAllowedCollision(name1, name2, compiled_type)) << name1 << " " << name2;
+      if (found)
+        EXPECT_EQ(type, compiled_type) << name1 << " " << name2;
+
+      DecideContactFn fn, compiled_fn;
+      const bool fn_found = acm.getAllowedCollision(name1, name2, fn);
+      ASSERT_EQ(fn_found, compiled->getAllowedCollision(name1, name2, compiled_fn)) << name1 << " " << name2;
+      if (fn_found)
+      {
+        Contact contact;
+        for (double depth : { 0.05, 0.15, 0.25, 0.35 })
+        {
+          contact.depth = depth;
+          EXPECT_EQ(fn(contact), compiled_fn(contact)) << name1 << " " << name2;
+        }
+      }
+    }
+}
+}  // namespace
+
+TEST(CompiledAllowedCollisionMatrix, MatchesRandomMatrix)
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < 70; ++i)
+    names.push_back("link_" + std::to_string(i));
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> pick(0, static_cast<int>(names.size()) - 1);
+  std::uniform_int_distribution<int> kind(0, 9);
+  AllowedCollisionMatrix acm;
+  for (int i = 0; i < 600; ++i)
+  {
+    const std::string& name1 = names[pick(rng)];
+    const std::string& name2 = names[pick(rng)];
+    const int k = kind(rng);
+    if (k < 4)
+      acm.setEntry(name1, name2, k < 2);
+    else if (k < 5)
+    {
+      DecideContactFn fn = makeDecideFn(0.1 * k);
+      acm.setEntry(name1, name2, fn);
+    }
+    else if (k < 6)
+      acm.removeEntry(name1, name2);
+  }
+  for (int i = 0; i < 20; ++i)
+  {
+    const std::string& name = names[pick(rng)];
+    if (i % 3 == 0)
+    {
+      DecideContactFn fn = makeDecideFn(0.2);
+      acm.setDefaultEntry(name, fn);
+    }
+    else
+      acm.setDefaultEntry(name, i % 3 == 1);
+  }
+
+  // names without any entry are known to neither form
+  names.push_back("unknown_link");
+  expectCompiledEqual(acm, names);
+  EXPECT_EQ(acm.getCompiled()->getIndex("unknown_link"), CompiledAllowedCollisionMatrix::UNKNOWN_INDEX);
+
+  // setting all entries keeps the predicates, which must still be reported
+  acm.setEntry(true);
+  expectCompiledEqual(acm, names);
+
+  acm.removeEntry(names[3]);
+  expectCompiledEqual(acm, names);
+}
+
+TEST(CompiledAllowedCollisionMatrix, RebuiltOnChange)
+{
+  AllowedCollisionMatrix acm;
+  acm.setEntry("a", "b", true);
+  const CompiledAllowedCollisionMatrixConstPtr compiled = acm.getCompiled();
+  EXPECT_EQ(compiled, acm.getCompiled());
+
+  // copies share the compiled form until modified
+  AllowedCollisionMatrix copy(acm);
+  EXPECT_EQ(compiled, copy.getCompiled());
+  copy.setEntry("a", "c", true);
+  EXPECT_NE(compiled, copy.getCompiled());
+  EXPECT_EQ(compiled, acm.getCompiled());
+
+  acm.setEntry("a", "b", false);
+  const CompiledAllowedCollisionMatrixConstPtr updated = acm.getCompiled();
+  EXPECT_NE(compiled, updated);
+  AllowedCollision::Type type;
+  ASSERT_TRUE(updated->getAllowedCollision("a", "b", type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+  ASSERT_TRUE(compiled->getAllowedCollision("a", "b", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+
+  acm.setDefaultEntry("d", true);
+  ASSERT_TRUE(acm.getCompiled()->getAllowedCollision("d", "unknown", type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+
+  acm.clear();
+  EXPECT_EQ(acm.getCompiled()->getSize(), 0u);
+  EXPECT_FALSE(acm.getCompiled()->getAllowedCollision("a", "b", type));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -372,6 +372,99 @@ TEST(World, TrackChanges)
   EXPECT_EQ(4, ta3.cnt_);
 }
 
+TEST(World, BatchUpdate)
+{
+  World world;
+  shapes::ShapePtr ball = std::make_shared<shapes::Sphere>(1.0);
+  shapes::ShapePtr box = std::make_shared<shapes::Box>(1, 2, 3);
+  world.addToObject("moved", ball, Eigen::Isometry3d::Identity());
+  world.addToObject("removed", ball, Eigen::Isometry3d::Identity());
+  world.addToObject("replaced", ball, Eigen::Isometry3d::Identity());
+
+  std::vector<std::pair<std::string, int>> notifications;
+  int batches_begun = 0;
+  int batches_ended = 0;
+  world.addObserver(
+      [&notifications](const World::ObjectConstPtr& object, World::Action action) {
+        notifications.emplace_back(object->id_, action);
+      },
+      [&batches_begun] { ++batches_begun; }, [&batches_ended] { ++batches_ended; });
+
+  {
+    World::BatchUpdate batch(world);
+    world.moveShapeInObject("moved", ball, Eigen::Isometry3d(Eigen::Translation3d(0, 0, 1)));
+    world.addToObject("moved", box, Eigen::Isometry3d::Identity());
+    world.removeObject("removed");
+    world.removeObject("replaced");
+    world.addToObject("replaced", box, Eigen::Isometry3d::Identity());
+    {
+      World::BatchUpdate nested_batch(world);
+      world.addToObject("transient", box, Eigen::Isometry3d::Identity());
+      world.addToObject("added", box, Eigen::Isometry3d::Identity());
+    }
+    world.removeObject("transient");
+
+    // nothing is delivered before the outermost batch ends
+    EXPECT_TRUE(notifications.empty());
+    EXPECT_EQ(batches_begun, 0);
+  }
+
+  EXPECT_EQ(batches_begun, 1);
+  EXPECT_EQ(batches_ended, 1);
+  const std::vector<std::pair<std::string, int>> expected{
+    { "moved", World::MOVE_SHAPE | World::ADD_SHAPE },
+    { "removed", World::DESTROY },
+    { "replaced", World::DESTROY },
+    { "replaced", World::CREATE | World::ADD_SHAPE },
+    { "added", World::CREATE | World::ADD_SHAPE },
+  };
+  EXPECT_EQ(notifications, expected);
+
+  // outside of a batch, changes are delivered right away again
+  notifications.clear();
+  world.removeObject("added");
+  ASSERT_EQ(notifications.size(), 1u);
+  EXPECT_EQ(notifications[0].second, World::DESTROY);
+  EXPECT_EQ(batches_ended, 1);
+}
+
+TEST(World, SpatialQueries)
+{
+  World world;
+  shapes::ShapePtr box = std::make_shared<shapes::Box>(1, 1, 1);
+  shapes::ShapePtr plane = std::make_shared<shapes::Plane>(0, 0, 1, 0);
+
+  // a row of unit boxes along the x axis at x = 0, 2, 4, ...
+  for (std::size_t i = 0; i < 50; ++i)
+    world.addToObject("box_" + std::to_string(i), Eigen::Isometry3d(Eigen::Translation3d(2.0 * i, 0, 0)), box,
+                      Eigen::Isometry3d::Identity());
+
+  const Eigen::AlignedBox3d aabb = world.getObjectAABB("box_3");
+  EXPECT_TRUE(aabb.min().isApprox(Eigen::Vector3d(5.5, -0.5, -0.5)));
+  EXPECT_TRUE(aabb.max().isApprox(Eigen::Vector3d(6.5, 0.5, 0.5)));
+  EXPECT_TRUE(world.getObjectAABB("unknown").isEmpty());
+
+  const Eigen::AlignedBox3d region(Eigen::Vector3d(3.0, -1.0, -1.0), Eigen::Vector3d(8.0, 1.0, 1.0));
+  EXPECT_EQ(world.queryAABB(region), std::vector<std::string>({ "box_2", "box_3", "box_4" }));
+  EXPECT_EQ(world.queryRadius(Eigen::Vector3d(20.0, 1.0, 0.0), 0.6), std::vector<std::string>({ "box_10" }));
+  EXPECT_TRUE(world.queryRadius(Eigen::Vector3d(0.0, 3.0, 0.0), 1.0).empty());
+
+  // changes of the world are reflected by the next query
+  world.setObjectPose("box_10", Eigen::Isometry3d(Eigen::Translation3d(5.0, 0, 0)));
+  world.removeObject("box_2");
+  EXPECT_EQ(world.queryAABB(region), std::vector<std::string>({ "box_10", "box_3", "box_4" }));
+
+  // a copy shares the state of the index
+  World copy(world);
+  copy.removeObject("box_3");
+  EXPECT_EQ(copy.queryAABB(region), std::vector<std::string>({ "box_10", "box_4" }));
+  EXPECT_EQ(world.queryAABB(region), std::vector<std::string>({ "box_10", "box_3", "box_4" }));
+
+  // unbounded shapes intersect everything
+  world.addToObject("ground", plane, Eigen::Isometry3d::Identity());
+  EXPECT_EQ(world.queryRadius(Eigen::Vector3d(0.0, 3.0, 0.0), 1.0), std::vector<std::string>({ "ground" }));
+}
+
 TEST(World, ObjectPoseAndSubframes)
 {
   World world;
@@ -78,6 +78,9 @@ struct ContactTestData
 
   /// Indicates if search between a single pair is finished
   bool pair_done;
+
+  /// Number of narrowphase results within the contact distance, whether or not they were added to \e res
+  std::size_t result_count{ 0 };
 };
 
 }  // namespace collision_detection_bullet
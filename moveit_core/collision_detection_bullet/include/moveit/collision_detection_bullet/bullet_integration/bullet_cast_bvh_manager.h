@@ -77,5 +77,17 @@ public:
   /**@brief Add a tesseract collision object to the manager
    * @param cow The tesseract bullet collision object */
   void addCollisionObject(const CollisionObjectWrapperPtr& cow) override;
+
+  /**@brief Number of pairs of the last contactTest() that came within the contact distance
+   *
+   * In contrast to the contacts of the collision result, this also counts the pairs which were not reported because
+   * the request did not ask for contacts or the search was finished early. */
+  std::size_t getLastResultCount() const
+  {
+    return last_result_count_;
+  }
+
+private:
+  std::size_t last_result_count_{ 0 };
 };
 }  // namespace collision_detection_bullet
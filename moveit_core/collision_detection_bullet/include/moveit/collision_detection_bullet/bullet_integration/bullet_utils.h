@@ -553,6 +553,12 @@ struct BroadphaseContactResultCallback
   // TODO: Add check for two objects attached to the same link
   bool needsCollision(const CollisionObjectWrapper* cow0, const CollisionObjectWrapper* cow1) const
   {
+    // pairs found by the broadphase before one of the objects was disabled remain in the pair cache
+    if (!cow0->m_enabled || !cow1->m_enabled)
+    {
+      return false;
+    }
+
     if (cast_)
     {
       return !collisions_.done && !isOnlyKinematic(cow0, cow1) && !acmCheck(cow0->getName(), cow1->getName(), acm_);
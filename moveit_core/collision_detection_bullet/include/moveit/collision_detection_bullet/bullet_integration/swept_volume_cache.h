@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <Eigen/Geometry>
+#include <array>
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace collision_detection_bullet
+{
+/** \brief Counters of a SweptVolumeCache, used to tune its capacity */
+struct SweptVolumeCacheStatistics
+{
+  /** \brief Number of lookups which found the segment */
+  std::size_t hits{ 0 };
+
+  /** \brief Number of lookups which did not find the segment */
+  std::size_t misses{ 0 };
+
+  /** \brief Number of segments dropped because the capacity was reached */
+  std::size_t evictions{ 0 };
+
+  /** \brief Number of segments currently stored */
+  std::size_t size{ 0 };
+};
+
+/** \brief Least recently used set of link motions whose swept volume was found to be collision free.
+ *
+ *  An entry is identified by the name of the link and its start and end pose. Poses are compared exactly, so a hit
+ *  only occurs for a segment which is checked again with bitwise identical transforms, as happens when the same
+ *  trajectory is validated repeatedly. The cache does not know what the segments were checked against: the owner must
+ *  clear() it whenever the environment, the collision geometry or the allowed collision matrix changes. */
+class SweptVolumeCache
+{
+public:
+  /** \brief Construct a cache holding at most \e capacity segments. A capacity of 0 disables the cache. */
+  explicit SweptVolumeCache(std::size_t capacity = 1024);
+
+  /** \brief Change the maximum number of segments, evicting the least recently used ones if needed */
+  void setCapacity(std::size_t capacity);
+
+  std::size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  /** \brief Returns true if the motion of \e link from \e pose1 to \e pose2 is stored. Updates the statistics and
+   *  marks the entry as most recently used. */
+  bool contains(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2);
+
+  /** \brief Store the motion of \e link from \e pose1 to \e pose2 as collision free */
+  void insert(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2);
+
+  /** \brief Remove all segments. The statistics are kept. */
+  void clear();
+
+  SweptVolumeCacheStatistics getStatistics() const;
+
+  /** \brief Estimate the number of bytes held by the stored segments */
+  std::size_t getMemoryUsage() const;
+
+  /** \brief Reset the hit, miss and eviction counters */
+  void resetStatistics();
+
+private:
+  struct Key
+  {
+    Key(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2);
+
+    bool operator==(const Key& other) const
+    {
+      return poses_ == other.poses_ && link_ == other.link_;
+    }
+
+    std::string link_;
+
+    /** \brief The 3x4 affine parts of both poses */
+    std::array<double, 24> poses_;
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  /** \brief Drop least recently used entries until at most \e capacity_ remain */
+  void evict();
+
+  std::size_t capacity_;
+
+  /** \brief Keys ordered from most to least recently used */
+  std::list<Key> lru_;
+  std::unordered_map<Key, std::list<Key>::iterator, KeyHash> entries_;
+
+  SweptVolumeCacheStatistics statistics_;
+};
+}  // namespace collision_detection_bullet
@@ -39,6 +39,7 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
+#include <moveit/collision_detection_bullet/bullet_integration/swept_volume_cache.h>
 #include <mutex>
 
 namespace collision_detection
@@ -86,6 +87,22 @@ public:
 
   void setWorld(const WorldPtr& world) override;
 
+  /** \brief Set the maximum number of link motions remembered as collision free by the continuous collision checks.
+   *
+   *  When a segment between two states is checked again with identical link poses, the links whose swept volume was
+   *  collision free before are not checked against the world again. The cache is cleared whenever the world, the
+   *  link geometry or the allowed collision matrix changes. A capacity of 0 disables the cache. */
+  void setSweptVolumeCacheCapacity(std::size_t capacity);
+
+  /** \brief Get the hit, miss and eviction counters of the swept volume cache */
+  collision_detection_bullet::SweptVolumeCacheStatistics getSweptVolumeCacheStatistics() const;
+
+  /** \brief Reset the counters of the swept volume cache */
+  void resetSweptVolumeCacheStatistics();
+
+  /** \brief Reports the swept volume cache of the continuous collision checks ("swept_volume_cache") */
+  moveit::MemoryUsage getMemoryUsage() const override;
+
 protected:
   /** \brief Updates the poses of the objects in the manager according to given robot state */
   void updateTransformsFromState(const moveit::core::RobotState& state,
@@ -126,6 +143,12 @@ protected:
   // Lock manager_ and manager_CCD_, for thread-safe collision tests
   mutable std::mutex collision_env_mutex_;
 
+  /** \brief Link motions found collision free by checkRobotCollisionHelperCCD(), protected by collision_env_mutex_ */
+  mutable collision_detection_bullet::SweptVolumeCache swept_volume_cache_;
+
+  /** \brief Compiled form of the allowed collision matrix the entries of swept_volume_cache_ were found with */
+  mutable CompiledAllowedCollisionMatrixConstPtr swept_volume_cache_acm_;
+
   /** \brief Adds a world object to the collision managers */
   void addToManager(const World::Object* obj);
 
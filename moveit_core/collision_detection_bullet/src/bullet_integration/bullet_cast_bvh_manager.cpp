@@ -147,6 +147,7 @@ void BulletCastBVHManager::contactTest(collision_detection::CollisionResult& col
   BroadphaseContactResultCallback cc(cdata, contact_distance_, acm, false, true);
   TesseractCollisionPairCallback collision_callback(dispatch_info_, dispatcher_.get(), cc);
   pair_cache->processAllOverlappingPairs(&collision_callback, dispatcher_.get());
+  last_result_count_ = cdata.result_count;
 }
 
 void BulletCastBVHManager::addCollisionObject(const CollisionObjectWrapperPtr& cow)
@@ -38,6 +38,7 @@
 #include <BulletCollision/CollisionShapes/btShapeHull.h>
 #include <BulletCollision/Gimpact/btGImpactShape.h>
 #include <geometric_shapes/shapes.h>
+#include <map>
 #include <memory>
 #include <octomap/octomap.h>
 #include <rclcpp/logger.hpp>
@@ -205,66 +206,50 @@ btCollisionShape* createShapePrimitive(const shapes::OcTree* geom, const Collisi
          collision_object_type == CollisionObjectType::SDF ||
          collision_object_type == CollisionObjectType::MULTI_SPHERE);
 
+  if (collision_object_type != CollisionObjectType::USE_SHAPE_TYPE &&
+      collision_object_type != CollisionObjectType::MULTI_SPHERE)
+  {
+    RCLCPP_ERROR(BULLET_LOGGER, "This bullet shape type (%d) is not supported for geometry octree",
+                 static_cast<int>(collision_object_type));
+    return nullptr;
+  }
+
   btCompoundShape* subshape =
       new btCompoundShape(BULLET_COMPOUND_USE_DYNAMIC_AABB, static_cast<int>(geom->octree->size()));
   double occupancy_threshold = geom->octree->getOccupancyThres();
 
-  // convert the mesh to the assigned collision object type
-  switch (collision_object_type)
+  // voxels of the same depth have the same size, so they can all share a single child shape; this keeps the number of
+  // allocated shapes at the tree depth instead of the number of occupied voxels
+  std::map<unsigned int, btCollisionShape*> voxel_shapes;
+  const unsigned int tree_depth = geom->octree->getTreeDepth();
+  for (auto it = geom->octree->begin_leafs(static_cast<unsigned char>(tree_depth)), end = geom->octree->end_leafs();
+       it != end; ++it)
   {
-    case CollisionObjectType::USE_SHAPE_TYPE:
-    {
-      for (auto it = geom->octree->begin(static_cast<unsigned char>(geom->octree->getTreeDepth())),
-                end = geom->octree->end();
-           it != end; ++it)
-      {
-        if (it->getOccupancy() >= occupancy_threshold)
-        {
-          double size = it.getSize();
-          btTransform geom_trans;
-          geom_trans.setIdentity();
-          geom_trans.setOrigin(btVector3(static_cast<btScalar>(it.getX()), static_cast<btScalar>(it.getY()),
-                                         static_cast<btScalar>(it.getZ())));
-          btScalar l = static_cast<btScalar>(size / 2);
-          btBoxShape* childshape = new btBoxShape(btVector3(l, l, l));
-          childshape->setMargin(BULLET_MARGIN);
-          cow->manage(childshape);
-
-          subshape->addChildShape(geom_trans, childshape);
-        }
-      }
-      return subshape;
-    }
-    case CollisionObjectType::MULTI_SPHERE:
+    if (it->getOccupancy() < occupancy_threshold)
+      continue;
+
+    btCollisionShape*& childshape = voxel_shapes[it.getDepth()];
+    if (!childshape)
     {
-      for (auto it = geom->octree->begin(static_cast<unsigned char>(geom->octree->getTreeDepth())),
-                end = geom->octree->end();
-           it != end; ++it)
+      double size = it.getSize();
+      if (collision_object_type == CollisionObjectType::MULTI_SPHERE)
+        childshape = new btSphereShape(static_cast<btScalar>(std::sqrt(2 * ((size / 2) * (size / 2)))));
+      else
       {
-        if (it->getOccupancy() >= occupancy_threshold)
-        {
-          double size = it.getSize();
-          btTransform geom_trans;
-          geom_trans.setIdentity();
-          geom_trans.setOrigin(btVector3(static_cast<btScalar>(it.getX()), static_cast<btScalar>(it.getY()),
-                                         static_cast<btScalar>(it.getZ())));
-          btSphereShape* childshape =
-              new btSphereShape(static_cast<btScalar>(std::sqrt(2 * ((size / 2) * (size / 2)))));
-          childshape->setMargin(BULLET_MARGIN);
-          cow->manage(childshape);
-
-          subshape->addChildShape(geom_trans, childshape);
-        }
+        btScalar l = static_cast<btScalar>(size / 2);
+        childshape = new btBoxShape(btVector3(l, l, l));
       }
-      return subshape;
-    }
-    default:
-    {
-      RCLCPP_ERROR(BULLET_LOGGER, "This bullet shape type (%d) is not supported for geometry octree",
-                   static_cast<int>(collision_object_type));
-      return nullptr;
+      childshape->setMargin(BULLET_MARGIN);
+      cow->manage(childshape);
     }
+
+    btTransform geom_trans;
+    geom_trans.setIdentity();
+    geom_trans.setOrigin(btVector3(static_cast<btScalar>(it.getX()), static_cast<btScalar>(it.getY()),
+                                   static_cast<btScalar>(it.getZ())));
+    subshape->addChildShape(geom_trans, childshape);
   }
+  return subshape;
 }
 
 void updateCollisionObjectFilters(const std::vector<std::string>& active, CollisionObjectWrapper& cow)
@@ -481,6 +466,7 @@ btScalar BroadphaseContactResultCallback::addSingleResult(btManifoldPoint& cp,
     RCLCPP_DEBUG_STREAM(BULLET_LOGGER, "Not close enough for collision with " << cp.m_distance1);
     return 0;
   }
+  ++collisions_.result_count;
 
   if (cast_)
   {
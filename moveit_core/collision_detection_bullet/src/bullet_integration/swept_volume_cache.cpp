@@ -0,0 +1,139 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/collision_detection_bullet/bullet_integration/swept_volume_cache.h>
+#include <functional>
+
+namespace collision_detection_bullet
+{
+SweptVolumeCache::Key::Key(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2)
+  : link_(link)
+{
+  // column-major storage of the affine part: the last row of the homogeneous matrix is skipped
+  for (int col = 0; col < 4; ++col)
+    for (int row = 0; row < 3; ++row)
+    {
+      poses_[3 * col + row] = pose1.matrix()(row, col);
+      poses_[12 + 3 * col + row] = pose2.matrix()(row, col);
+    }
+}
+
+std::size_t SweptVolumeCache::KeyHash::operator()(const Key& key) const
+{
+  std::size_t seed = std::hash<std::string>()(key.link_);
+  for (double value : key.poses_)
+    seed ^= std::hash<double>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+SweptVolumeCache::SweptVolumeCache(std::size_t capacity) : capacity_(capacity)
+{
+}
+
+void SweptVolumeCache::setCapacity(std::size_t capacity)
+{
+  capacity_ = capacity;
+  evict();
+}
+
+bool SweptVolumeCache::contains(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2)
+{
+  if (capacity_ == 0)
+    return false;
+
+  const auto it = entries_.find(Key(link, pose1, pose2));
+  if (it == entries_.end())
+  {
+    ++statistics_.misses;
+    return false;
+  }
+  ++statistics_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return true;
+}
+
+void SweptVolumeCache::insert(const std::string& link, const Eigen::Isometry3d& pose1, const Eigen::Isometry3d& pose2)
+{
+  if (capacity_ == 0)
+    return;
+
+  Key key(link, pose1, pose2);
+  const auto it = entries_.find(key);
+  if (it != entries_.end())
+  {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+  lru_.push_front(key);
+  entries_.emplace(std::move(key), lru_.begin());
+  evict();
+}
+
+void SweptVolumeCache::clear()
+{
+  entries_.clear();
+  lru_.clear();
+}
+
+SweptVolumeCacheStatistics SweptVolumeCache::getStatistics() const
+{
+  SweptVolumeCacheStatistics statistics = statistics_;
+  statistics.size = entries_.size();
+  return statistics;
+}
+
+std::size_t SweptVolumeCache::getMemoryUsage() const
+{
+  std::size_t bytes = entries_.bucket_count() * sizeof(void*);
+  for (const Key& key : lru_)
+    bytes += 2 * sizeof(Key) + key.link_.capacity() + sizeof(std::list<Key>::iterator);
+  return bytes;
+}
+
+void SweptVolumeCache::resetStatistics()
+{
+  statistics_ = SweptVolumeCacheStatistics();
+}
+
+void SweptVolumeCache::evict()
+{
+  while (entries_.size() > capacity_)
+  {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+    ++statistics_.evictions;
+  }
+}
+}  // namespace collision_detection_bullet
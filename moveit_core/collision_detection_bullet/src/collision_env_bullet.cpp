@@ -40,6 +40,7 @@
 #include <moveit/collision_detection_bullet/bullet_integration/contact_checker_common.h>
 #include <functional>
 #include <bullet/btBulletCollisionCommon.h>
+#include <moveit/utils/performance_counters.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 
@@ -81,17 +82,32 @@ CollisionEnvBullet::CollisionEnvBullet(const moveit::core::RobotModelConstPtr& m
 CollisionEnvBullet::CollisionEnvBullet(const CollisionEnvBullet& other, const WorldPtr& world)
   : CollisionEnv(other, world)
 {
+  // the clones share the (const) collision shapes of the links and world objects with other
+  {
+    std::lock_guard<std::mutex> guard(other.collision_env_mutex_);
+    manager_ = other.manager_->clone();
+    manager_CCD_ = other.manager_CCD_->clone();
+    active_ = other.active_;
+  }
+
   // request notifications about changes to new world
   observer_handle_ = getWorld()->addObserver(
       [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); });
 
-  for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : other.robot_model_->getURDF()->links_)
+  // only world objects which differ from the ones other was built from need to be constructed again
+  std::vector<std::string> removed_objects;
+  for (const std::pair<const std::string, collision_detection_bullet::CollisionObjectWrapperPtr>& cow :
+       manager_->getCollisionObjects())
+    if (cow.second->getTypeID() == collision_detection::BodyType::WORLD_OBJECT && !getWorld()->hasObject(cow.first))
+      removed_objects.push_back(cow.first);
+  for (const std::string& id : removed_objects)
   {
-    addLinkAsCollisionObject(link.second);
+    manager_->removeCollisionObject(id);
+    manager_CCD_->removeCollisionObject(id);
   }
-
-  // get notifications any objects already in the new world
-  getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
+  for (const std::pair<const std::string, ObjectPtr>& object : *getWorld())
+    if (!manager_->hasCollisionObject(object.first) || other.getWorld()->getObject(object.first) != object.second)
+      updateManagedObject(object.first);
 }
 
 CollisionEnvBullet::~CollisionEnvBullet()
@@ -116,6 +132,7 @@ void CollisionEnvBullet::checkSelfCollisionHelper(const CollisionRequest& req, C
                                                   const moveit::core::RobotState& state,
                                                   const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
   std::lock_guard<std::mutex> guard(collision_env_mutex_);
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> cows;
@@ -179,6 +196,7 @@ void CollisionEnvBullet::checkRobotCollisionHelper(const CollisionRequest& req,
                                                    const moveit::core::RobotState& state,
                                                    const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
   std::lock_guard<std::mutex> guard(collision_env_mutex_);
 
   if (req.distance)
@@ -210,8 +228,22 @@ void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& re
                                                       const moveit::core::RobotState& state2,
                                                       const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
   std::lock_guard<std::mutex> guard(collision_env_mutex_);
 
+  // cast links only collide with world objects, so the result for a link depends only on its motion, the world and the
+  // allowed collision matrix
+  const bool use_cache = swept_volume_cache_.getCapacity() > 0;
+  if (use_cache)
+  {
+    CompiledAllowedCollisionMatrixConstPtr compiled_acm = acm ? acm->getCompiled() : nullptr;
+    if (compiled_acm != swept_volume_cache_acm_)
+    {
+      swept_volume_cache_.clear();
+      swept_volume_cache_acm_ = std::move(compiled_acm);
+    }
+  }
+
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state1, attached_cows);
 
@@ -223,20 +255,72 @@ void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& re
         state2.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
+  std::vector<const std::string*> cached_links;
+  std::vector<const std::string*> checked_links;
   for (const std::string& link : active_)
   {
-    manager_CCD_->setCastCollisionObjectsTransform(link, state1.getCollisionBodyTransform(link, 0),
-                                                   state2.getCollisionBodyTransform(link, 0));
+    const Eigen::Isometry3d& pose1 = state1.getCollisionBodyTransform(link, 0);
+    const Eigen::Isometry3d& pose2 = state2.getCollisionBodyTransform(link, 0);
+    manager_CCD_->setCastCollisionObjectsTransform(link, pose1, pose2);
+    if (use_cache)
+    {
+      if (swept_volume_cache_.contains(link, pose1, pose2))
+      {
+        // the transform is updated first, so the object is consistent once enabled again
+        manager_CCD_->disableCollisionObject(link);
+        cached_links.push_back(&link);
+      }
+      else
+        checked_links.push_back(&link);
+    }
   }
 
   manager_CCD_->contactTest(res, req, acm, false);
 
+  for (const std::string* link : cached_links)
+    manager_CCD_->enableCollisionObject(*link);
+
+  // without any pair within the contact distance, every checked link moved freely. Otherwise the search may have
+  // stopped early and it is unknown which links were checked completely.
+  if (use_cache && manager_CCD_->getLastResultCount() == 0)
+  {
+    for (const std::string* link : checked_links)
+      swept_volume_cache_.insert(*link, state1.getCollisionBodyTransform(*link, 0),
+                                 state2.getCollisionBodyTransform(*link, 0));
+  }
+
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
     manager_CCD_->removeCollisionObject(cow->getName());
   }
 }
 
+void CollisionEnvBullet::setSweptVolumeCacheCapacity(std::size_t capacity)
+{
+  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  swept_volume_cache_.setCapacity(capacity);
+}
+
+collision_detection_bullet::SweptVolumeCacheStatistics CollisionEnvBullet::getSweptVolumeCacheStatistics() const
+{
+  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  return swept_volume_cache_.getStatistics();
+}
+
+moveit::MemoryUsage CollisionEnvBullet::getMemoryUsage() const
+{
+  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  moveit::MemoryUsage usage;
+  usage.add("swept_volume_cache", swept_volume_cache_.getMemoryUsage(), swept_volume_cache_.getStatistics().size);
+  return usage;
+}
+
+void CollisionEnvBullet::resetSweptVolumeCacheStatistics()
+{
+  std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  swept_volume_cache_.resetStatistics();
+}
+
 void CollisionEnvBullet::distanceSelf(const DistanceRequest& /*req*/, DistanceResult& /*res*/,
                                       const moveit::core::RobotState& /*state*/) const
 {
@@ -316,6 +400,7 @@ void CollisionEnvBullet::setWorld(const WorldPtr& world)
 void CollisionEnvBullet::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
   std::lock_guard<std::mutex> guard(collision_env_mutex_);
+  swept_volume_cache_.clear();
   if (action == World::DESTROY)
   {
     manager_->removeCollisionObject(obj->id_);
@@ -357,6 +442,10 @@ void CollisionEnvBullet::addAttachedOjects(const moveit::core::RobotState& state
 
 void CollisionEnvBullet::updatedPaddingOrScaling(const std::vector<std::string>& links)
 {
+  {
+    std::lock_guard<std::mutex> guard(collision_env_mutex_);
+    swept_volume_cache_.clear();
+  }
   for (const std::string& link : links)
   {
     if (robot_model_->getURDF()->links_.find(link) != robot_model_->getURDF()->links_.end())
@@ -323,6 +323,99 @@ TEST_F(BulletCollisionDetectionTester, ContinuousCollisionWorld)
   res.clear();
 }
 
+TEST_F(BulletCollisionDetectionTester, ContinuousCollisionWorldSweptVolumeCache)
+{
+  auto cenv = std::make_shared<collision_detection::CollisionEnvBullet>(robot_model_);
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 10;
+  collision_detection::CollisionResult res;
+
+  moveit::core::RobotState state1(robot_model_);
+  moveit::core::RobotState state2(robot_model_);
+  setToHome(state1);
+  state1.update();
+  setToHome(state2);
+  double joint_2{ 0.05 };
+  double joint_4{ -1.6 };
+  state2.setJointPositions("panda_joint2", &joint_2);
+  state2.setJointPositions("panda_joint4", &joint_4);
+  state2.update();
+
+  cenv->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+  const cb::SweptVolumeCacheStatistics first = cenv->getSweptVolumeCacheStatistics();
+  EXPECT_EQ(first.hits, 0u);
+  EXPECT_GT(first.size, 0u);
+
+  // the identical segment is answered from the cache
+  cenv->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+  EXPECT_EQ(cenv->getSweptVolumeCacheStatistics().hits, first.size);
+
+  // a new world object invalidates the cache
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  cenv->getWorld()->addToObject("box", shape_ptr, pos);
+  EXPECT_EQ(cenv->getSweptVolumeCacheStatistics().size, 0u);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    cenv->checkRobotCollision(req, res, state1, state2, *acm_);
+    ASSERT_TRUE(res.collision);
+    ASSERT_EQ(res.contact_count, 4u);
+    res.clear();
+  }
+
+  // a modified allowed collision matrix invalidates the cache as well
+  cenv->getWorld()->removeObject("box");
+  cenv->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+  acm_->setEntry("panda_link0", "box", true);
+  cenv->resetSweptVolumeCacheStatistics();
+  cenv->checkRobotCollision(req, res, state1, state2, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+  EXPECT_EQ(cenv->getSweptVolumeCacheStatistics().hits, 0u);
+
+  cenv->setSweptVolumeCacheCapacity(0);
+  EXPECT_EQ(cenv->getSweptVolumeCacheStatistics().size, 0u);
+}
+
+TEST(ContinuousCollisionUnit, SweptVolumeCacheEviction)
+{
+  cb::SweptVolumeCache cache(2);
+  Eigen::Isometry3d pose1 = Eigen::Isometry3d::Identity();
+  Eigen::Isometry3d pose2 = Eigen::Isometry3d::Identity();
+  pose2.translation().x() = 0.1;
+
+  cache.insert("a", pose1, pose2);
+  cache.insert("b", pose1, pose2);
+  EXPECT_TRUE(cache.contains("a", pose1, pose2));
+  EXPECT_FALSE(cache.contains("a", pose2, pose1));
+
+  // "b" is the least recently used entry
+  cache.insert("c", pose1, pose2);
+  EXPECT_FALSE(cache.contains("b", pose1, pose2));
+  EXPECT_TRUE(cache.contains("a", pose1, pose2));
+  EXPECT_TRUE(cache.contains("c", pose1, pose2));
+
+  cb::SweptVolumeCacheStatistics statistics = cache.getStatistics();
+  EXPECT_EQ(statistics.hits, 3u);
+  EXPECT_EQ(statistics.misses, 2u);
+  EXPECT_EQ(statistics.evictions, 1u);
+  EXPECT_EQ(statistics.size, 2u);
+
+  cache.setCapacity(1);
+  EXPECT_EQ(cache.getStatistics().size, 1u);
+  cache.clear();
+  EXPECT_FALSE(cache.contains("c", pose1, pose2));
+}
+
 TEST(ContinuousCollisionUnit, BulletCastBVHCollisionBoxBoxUnit)
 {
   collision_detection::CollisionResult result;
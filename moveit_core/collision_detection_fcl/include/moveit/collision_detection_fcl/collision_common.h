@@ -52,6 +52,8 @@
 #include <fcl/distance.h>
 #endif
 
+#include <limits>
+#include <map>
 #include <memory>
 #include <set>
 
@@ -127,6 +129,10 @@ struct CollisionGeometryData
    *  geometry data object. */
   int shape_index;
 
+  /** \brief Optional convex hull of the geometry, used as a conservative first test before the exact geometry when
+   *  no contacts are requested. See setConvexHullTriangleThreshold(). */
+  std::shared_ptr<const fcl::CollisionGeometryd> convex_hull;
+
   /** \brief Points to the type of body which contains the geometry. */
   union
   {
@@ -145,7 +151,12 @@ struct CollisionData
   }
 
   CollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
-    : req_(req), active_components_only_(nullptr), res_(res), acm_(acm), done_(false)
+    : req_(req)
+    , active_components_only_(nullptr)
+    , res_(res)
+    , acm_(acm)
+    , compiled_acm_(acm ? acm->getCompiled() : nullptr)
+    , done_(false)
   {
   }
 
@@ -171,14 +182,51 @@ struct CollisionData
   /** \brief The user-specified collision matrix (may be nullptr). */
   const AllowedCollisionMatrix* acm_;
 
+  /** \brief Compiled form of \e acm_ used for the per-pair lookups (nullptr if \e acm_ is nullptr). */
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm_;
+
   /** \brief Flag indicating whether collision checking is complete. */
   bool done_;
 };
 
+/** \brief Per-pair distance lower bounds kept between consecutive distance queries.
+
+    Entries are keyed by the pair of FCL geometries and hold the poses both geometries had when the bound was computed.
+    At the next query the bound is reduced by how far any point of either geometry can have moved since, which keeps it
+    a valid lower bound for the current poses. */
+struct FCLDistanceCache : public DistanceQueryCacheData
+{
+  struct Entry
+  {
+    /** \brief Keep the geometries alive so that their addresses are never reused while they serve as the key. */
+    std::shared_ptr<const fcl::CollisionGeometryd> g1, g2;
+    Eigen::Matrix3d r1, r2;
+    Eigen::Vector3d t1, t2;
+    double lower_bound = -std::numeric_limits<double>::infinity();
+  };
+
+  /** \brief Get the entry for the pair (o1, o2), creating an empty one if needed. Octrees are not cached. */
+  Entry* find(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, bool& swapped);
+
+  /** \brief Drop entries whose geometries are only referenced by this cache any more. */
+  void purge();
+
+  std::map<std::pair<const fcl::CollisionGeometryd*, const fcl::CollisionGeometryd*>, Entry> entries;
+  std::size_t queries = 0;
+};
+
+/** \brief Get the FCL cache data stored in \e cache, creating it if needed. */
+FCLDistanceCache* getFCLDistanceCache(DistanceQueryCache& cache);
+
 /** \brief Data structure which is passed to the distance callback function of the collision manager. */
 struct DistanceData
 {
-  DistanceData(const DistanceRequest* req, DistanceResult* res) : req(req), res(res), done(false)
+  DistanceData(const DistanceRequest* req, DistanceResult* res)
+    : req(req)
+    , res(res)
+    , compiled_acm(req->acm ? req->acm->getCompiled() : nullptr)
+    , cache(req->cache ? getFCLDistanceCache(*req->cache) : nullptr)
+    , done(false)
   {
   }
   ~DistanceData()
@@ -191,6 +239,12 @@ struct DistanceData
   /** \brief Distance query results information. */
   DistanceResult* res;
 
+  /** \brief Compiled form of the collision matrix of \e req (nullptr if there is none). */
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm;
+
+  /** \brief Bounds carried over from previous queries (nullptr if the request has no cache). */
+  FCLDistanceCache* cache;
+
   /** \brief Indicates if distance query is finished. */
   bool done;
 };
@@ -236,7 +290,11 @@ struct FCLGeometry
     if (!newType && collision_geometry_data_)
       if (collision_geometry_data_->ptr.raw == reinterpret_cast<const void*>(data))
         return;
+    std::shared_ptr<const fcl::CollisionGeometryd> convex_hull;
+    if (collision_geometry_data_)
+      convex_hull = collision_geometry_data_->convex_hull;
     collision_geometry_data_ = std::make_shared<CollisionGeometryData>(data, shape_index);
+    collision_geometry_data_->convex_hull = convex_hull;
     collision_geometry_->setUserData(collision_geometry_data_.get());
   }
 
@@ -317,6 +375,15 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
 /** \brief Increases the counter of the caches which can trigger the cleaning of expired entries from them. */
 void cleanCollisionGeometryCache();
 
+/** \brief Set the number of triangles from which robot link meshes also get a convex hull. Checks that request no
+ *  contacts, cost sources or contact decisions test the hulls first and only fall back to the exact meshes if the
+ *  hulls collide. Applies to link geometry created afterwards, e.g. when a robot model is loaded. 0 (the default)
+ *  disables the hulls. */
+void setConvexHullTriangleThreshold(std::size_t min_triangles);
+
+/** \brief Get the number of triangles from which robot link meshes also get a convex hull (0 if disabled). */
+std::size_t getConvexHullTriangleThreshold();
+
 /** \brief Transforms an Eigen Isometry3d to FCL coordinate transformation */
 inline void transform2fcl(const Eigen::Isometry3d& b, fcl::Transform3d& f)
 {
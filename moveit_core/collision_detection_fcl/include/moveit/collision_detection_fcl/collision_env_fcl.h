@@ -45,7 +45,12 @@
 #include <fcl/broadphase/broadphase.h>
 #endif
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_set>
 
 namespace collision_detection
 {
@@ -82,6 +87,12 @@ public:
   void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state1,
                            const moveit::core::RobotState& state2) const override;
 
+  void checkRobotCollisionBatch(const CollisionRequest& req, const std::vector<const moveit::core::RobotState*>& states,
+                                std::vector<CollisionResult>& results) const override;
+
+  void checkRobotCollisionBatch(const CollisionRequest& req, const std::vector<const moveit::core::RobotState*>& states,
+                                std::vector<CollisionResult>& results, const AllowedCollisionMatrix& acm) const override;
+
   void distanceSelf(const DistanceRequest& req, DistanceResult& res,
                     const moveit::core::RobotState& state) const override;
 
@@ -90,6 +101,11 @@ public:
 
   void setWorld(const WorldPtr& world) override;
 
+  /** \brief Reports the FCL geometry of the robot ("robot_geometry"), of the world objects of this environment
+   * ("world_geometry") and of the ones shared with its copies ("shared_world_geometry"), as well as the self collision
+   * broadphases of the querying threads. Octrees are counted by the world, which shares them with FCL. */
+  moveit::MemoryUsage getMemoryUsage() const override;
+
 protected:
   /** \brief Updates the FCL collision geometry and objects saved in the CollisionRobotFCL members to reflect a new
    *   padding or scaling of the robot links.
@@ -108,6 +124,14 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Bundles the different checkRobotCollisionBatch functions into a single function.
+   *
+   *   The states are split into contiguous ranges which are processed by separate threads. All threads share the world
+   *   manager read-only, and each constructs the robot link objects once and only updates their transforms per state. */
+  void checkRobotCollisionBatchHelper(const CollisionRequest& req,
+                                      const std::vector<const moveit::core::RobotState*>& states,
+                                      std::vector<CollisionResult>& results, const AllowedCollisionMatrix* acm) const;
+
   /** \brief Construct an FCL collision object from MoveIt's World::Object. */
   void constructFCLObjectWorld(const World::Object* obj, FCLObject& fcl_obj) const;
 
@@ -116,6 +140,12 @@ protected:
    *  If it does not exist in world, it is deleted. If it's not existing in \m fcl_objs_ yet, it's added there. */
   void updateFCLObject(const std::string& id);
 
+  /** \brief Check \e object for collisions with the world objects, both the shared and the unshared ones */
+  void collideWorld(fcl::CollisionObjectd* object, CollisionData& cd) const;
+
+  /** \brief Compute the distances of \e object to the world objects, both the shared and the unshared ones */
+  void distanceWorld(fcl::CollisionObjectd* object, DistanceData& drd) const;
+
   /** \brief Out of the current robot state and its attached bodies construct an FCLObject which can then be used to
    *   check for collision.
    *
@@ -130,6 +160,25 @@ protected:
    *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
   void allocSelfCollisionBroadPhase(const moveit::core::RobotState& state, FCLManager& manager) const;
 
+  /** \brief Get the self collision broadphase of the calling thread, updated to the link transforms of \e state.
+   *
+   *   In contrast to allocSelfCollisionBroadPhase(), the manager and the collision objects of the robot links persist
+   *   across calls: only their transforms are set and the dynamic AABB tree is refitted. Objects for the attached bodies
+   *   of \e state are constructed into \e attached_objects and registered to the manager. They must be removed again
+   *   with releaseSelfCollisionBroadPhase() once the check is done.
+   *
+   *   \param state The current robot state
+   *   \param attached_objects Output object holding the collision objects of the attached bodies
+   *   \return The broadphase manager, which must only be used by the calling thread */
+  fcl::BroadPhaseCollisionManagerd* acquireSelfCollisionBroadPhase(const moveit::core::RobotState& state,
+                                                                   FCLObject& attached_objects) const;
+
+  /** \brief Unregister the attached body objects added by acquireSelfCollisionBroadPhase() from \e manager */
+  void releaseSelfCollisionBroadPhase(fcl::BroadPhaseCollisionManagerd* manager, FCLObject& attached_objects) const;
+
+  /** \brief Construct the FCL collision objects of the bodies attached to \e state into \e fcl_obj */
+  void constructFCLObjectAttachedBodies(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
+
   /** \brief Converts all shapes which make up an attached body into a vector of FCLGeometryConstPtr.
    *
    *   When they are converted, they can be added to the FCL representation of the robot for collision checking.
@@ -145,15 +194,72 @@ protected:
   /** \brief Vector of shared pointers to the FCL collision objects which make up the robot */
   std::vector<FCLCollisionObjectConstPtr> robot_fcl_objs_;
 
-  /// FCL collision manager which handles the collision checking process
+  /// FCL collision manager which handles the collision checking process of the world objects in \m fcl_objs_
   std::unique_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
 
+  /// World objects which are not part of \m shared_fcl_objs_, because they were changed since it was built
   std::map<std::string, FCLObject> fcl_objs_;
 
+  /** \brief FCL collision manager of the world objects in \m shared_fcl_objs_.
+   *
+   *   Both are never modified once built and are shared with all environments copied from this one, so that copying
+   *   does not need to rebuild the broadphase of all world objects. */
+  std::shared_ptr<const fcl::BroadPhaseCollisionManagerd> shared_manager_;
+  std::shared_ptr<const std::map<std::string, FCLObject>> shared_fcl_objs_;
+
+  /// Ids of the objects in \m shared_fcl_objs_ which were changed or removed from the world since it was built
+  std::set<std::string> hidden_shared_fcl_objs_;
+
+  /// The collision objects of \m hidden_shared_fcl_objs_, which are skipped when querying \m shared_manager_
+  std::unordered_set<const fcl::CollisionObjectd*> hidden_shared_collision_objects_;
+
+  /// While set, world objects that change are not registered to \m manager_ until endWorldBatch()
+  bool defer_registration_ = false;
+
+  /// Ids of the objects in \m fcl_objs_ which are not registered to \m manager_ yet
+  std::set<std::string> unregistered_fcl_objs_;
+
 private:
+  /** \brief Self collision broadphase of one thread, holding one collision object per entry of robot_fcl_objs_ */
+  struct SelfCollisionBroadPhase
+  {
+    FCLManager manager_;
+
+    /** \brief Index into robot_geoms_ for each of the collision objects of \e manager_ */
+    std::vector<std::size_t> geometry_indices_;
+
+    /** \brief Value of robot_geometry_version_ the objects were constructed for */
+    std::size_t geometry_version_ = 0;
+  };
+
   /** \brief Callback function executed for each change to the world environment */
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
 
+  /** \brief Register to the world, deferring the broadphase updates of batched changes to endWorldBatch() */
+  World::ObserverHandle addWorldObserver();
+
+  /** \brief Start deferring the registration of changed world objects to the broadphase */
+  void beginWorldBatch();
+
+  /** \brief Register the world objects changed since beginWorldBatch() in bulk */
+  void endWorldBatch();
+
+  /** \brief Exclude the shared version of the world object \e id from collision checking */
+  void hideSharedFCLObject(const std::string& id);
+
+  /** \brief Merge the unshared world objects into a new shared broadphase.
+   *
+   *   Unless \e force is set, this only happens once the number of unshared and hidden objects exceeds a fraction of
+   *   the shared ones, which keeps both copying this environment and updating its world objects cheap.
+   *   Returns true if the objects were merged. */
+  bool shareFCLObjects(bool force);
+
   World::ObserverHandle observer_handle_;
+
+  /** \brief Incremented whenever robot_fcl_objs_ changes, so that the self collision broadphases are rebuilt */
+  std::size_t robot_geometry_version_ = 1;
+
+  mutable std::mutex self_collision_broadphases_lock_;
+  mutable std::map<std::thread::id, std::unique_ptr<SelfCollisionBroadPhase>> self_collision_broadphases_;
 };
 }  // namespace collision_detection
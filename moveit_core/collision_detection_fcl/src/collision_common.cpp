@@ -43,12 +43,15 @@
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/geometry/bvh/BVH_model.h>
 #include <fcl/geometry/octree/octree.h>
+#include <fcl/geometry/shape/convex.h>
+#include <geometric_shapes/bodies.h>
 #else
 #include <fcl/BVH/BVH_model.h>
 #include <fcl/shape/geometric_shapes.h>
 #include <fcl/octree.h>
 #endif
 
+#include <atomic>
 #include <memory>
 #include <type_traits>
 #include <mutex>
@@ -58,6 +61,83 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection_fcl.collision_common");
 
+namespace
+{
+std::atomic<std::size_t> convex_hull_triangle_threshold{ 0 };
+
+/** \brief Conservative test of the convex hulls of the two objects, using the exact geometry of an object that has no
+ *  hull. Returns false only if the exact geometries cannot collide either. */
+bool convexHullsMayCollide(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2,
+                           const CollisionGeometryData* cd1, const CollisionGeometryData* cd2)
+{
+  if (!cd1->convex_hull && !cd2->convex_hull)
+    return true;
+  const fcl::CollisionGeometryd* g1 = cd1->convex_hull ? cd1->convex_hull.get() : o1->collisionGeometry().get();
+  const fcl::CollisionGeometryd* g2 = cd2->convex_hull ? cd2->convex_hull.get() : o2->collisionGeometry().get();
+  fcl::CollisionResultd result;
+  return fcl::collide(g1, o1->getTransform(), g2, o2->getTransform(), fcl::CollisionRequestd(1, false), result) > 0;
+}
+
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+/** \brief Upper bound on how far any point of the geometry of \e object moved since it had the pose (r0, t0).
+
+    A point p of the local bounding sphere (center c, radius r) moves by (R1 - R0) p + (t1 - t0), whose norm is at most
+    |(R1 - R0) c + t1 - t0| + ||R1 - R0|| r. */
+double motionBound(const Eigen::Matrix3d& r0, const Eigen::Vector3d& t0, const fcl::CollisionObjectd& object)
+{
+  const fcl::Transform3d& pose = object.getTransform();
+  const Eigen::Matrix3d dr = pose.linear() - r0;
+  const fcl::CollisionGeometryd& geometry = *object.collisionGeometry();
+  return (dr * geometry.aabb_center + pose.translation() - t0).norm() + dr.norm() * geometry.aabb_radius;
+}
+#endif
+
+const std::size_t DISTANCE_CACHE_PURGE_INTERVAL = 100;
+}  // namespace
+
+FCLDistanceCache::Entry* FCLDistanceCache::find(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2,
+                                                bool& swapped)
+{
+  // octrees are updated in place, so neither their address nor their pose tells whether they changed
+  if (o1->getObjectType() == fcl::OT_OCTREE || o2->getObjectType() == fcl::OT_OCTREE)
+    return nullptr;
+  const fcl::CollisionGeometryd* g1 = o1->collisionGeometry().get();
+  const fcl::CollisionGeometryd* g2 = o2->collisionGeometry().get();
+  swapped = g2 < g1;
+  Entry& entry = swapped ? entries[std::make_pair(g2, g1)] : entries[std::make_pair(g1, g2)];
+  if (!entry.g1)
+  {
+    entry.g1 = swapped ? o2->collisionGeometry() : o1->collisionGeometry();
+    entry.g2 = swapped ? o1->collisionGeometry() : o2->collisionGeometry();
+  }
+  return &entry;
+}
+
+void FCLDistanceCache::purge()
+{
+  for (auto it = entries.begin(); it != entries.end();)
+  {
+    if (it->second.g1.use_count() == 1 || it->second.g2.use_count() == 1)
+      it = entries.erase(it);
+    else
+      ++it;
+  }
+}
+
+FCLDistanceCache* getFCLDistanceCache(DistanceQueryCache& cache)
+{
+  FCLDistanceCache* fcl_cache = dynamic_cast<FCLDistanceCache*>(cache.data.get());
+  if (!fcl_cache)
+  {
+    auto data = std::make_shared<FCLDistanceCache>();
+    fcl_cache = data.get();
+    cache.data = std::move(data);
+  }
+  if (++fcl_cache->queries % DISTANCE_CACHE_PURGE_INTERVAL == 0)
+    fcl_cache->purge();
+  return fcl_cache;
+}
+
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
 {
   CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
@@ -91,10 +171,12 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   // use the collision matrix (if any) to avoid certain collision checks
   DecideContactFn dcf;
   bool always_allow_collision = false;
-  if (cdata->acm_)
+  if (cdata->compiled_acm_)
   {
+    const int index1 = cdata->compiled_acm_->getIndex(cd1->getID());
+    const int index2 = cdata->compiled_acm_->getIndex(cd2->getID());
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata->compiled_acm_->getAllowedCollision(index1, index2, type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -110,7 +192,7 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       }
       else if (type == AllowedCollision::CONDITIONAL)
       {
-        cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
+        cdata->compiled_acm_->getAllowedCollision(index1, index2, dcf);
         if (cdata->req_->verbose)
           RCLCPP_DEBUG(LOGGER, "Collision between '%s' and '%s' is conditionally allowed", cd1->getID().c_str(),
                        cd2->getID().c_str());
@@ -328,8 +410,11 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       std::size_t num_max_cost_sources = cdata->req_->max_cost_sources;
       bool enable_contact = false;
       fcl::CollisionResultd col_result;
-      int num_contacts = fcl::collide(
-          o1, o2, fcl::CollisionRequestd(1, enable_contact, num_max_cost_sources, enable_cost), col_result);
+      // the convex hulls contain the exact geometry, so this pair is done if the hulls are apart
+      int num_contacts = 0;
+      if (enable_cost || convexHullsMayCollide(o1, o2, cd1, cd2))
+        num_contacts = fcl::collide(
+            o1, o2, fcl::CollisionRequestd(1, enable_contact, num_max_cost_sources, enable_cost), col_result);
       if (num_contacts > 0)
       {
         cdata->res_->collision = true;
@@ -460,10 +545,10 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
 
   // use the collision matrix (if any) to avoid certain distance checks
   bool always_allow_collision = false;
-  if (cdata->req->acm)
+  if (cdata->compiled_acm)
   {
     AllowedCollision::Type type;
-    bool found = cdata->req->acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata->compiled_acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -538,6 +623,22 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     }
   }
 
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  // a pair whose bound from a previous query, shrunk by how far both geometries moved since, is not below the
+  // threshold cannot be reported, so skip the narrow phase for it
+  FCLDistanceCache::Entry* cache_entry = nullptr;
+  bool cache_swapped = false;
+  if (cdata->cache && (cache_entry = cdata->cache->find(o1, o2, cache_swapped)))
+  {
+    const fcl::CollisionObjectd& c1 = cache_swapped ? *o2 : *o1;
+    const fcl::CollisionObjectd& c2 = cache_swapped ? *o1 : *o2;
+    const double bound = cache_entry->lower_bound - motionBound(cache_entry->r1, cache_entry->t1, c1) -
+                         motionBound(cache_entry->r2, cache_entry->t2, c2);
+    if (bound >= dist_threshold)  // false for NaN
+      return cdata->done;
+  }
+#endif
+
   fcl::DistanceResultd fcl_result;
   fcl_result.min_distance = dist_threshold;
   // fcl::distance segfaults when given an octree with a null root pointer (using FCL 0.6.1)
@@ -550,6 +651,20 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   }
   double distance = fcl::distance(o1, o2, fcl::DistanceRequestd(cdata->req->enable_nearest_points), fcl_result);
 
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  if (cache_entry)
+  {
+    // FCL never reports more than the true distance (it stops at the threshold), so the result is a lower bound
+    const fcl::Transform3d& p1 = cache_swapped ? o2->getTransform() : o1->getTransform();
+    const fcl::Transform3d& p2 = cache_swapped ? o1->getTransform() : o2->getTransform();
+    cache_entry->r1 = p1.linear();
+    cache_entry->t1 = p1.translation();
+    cache_entry->r2 = p2.linear();
+    cache_entry->t2 = p2.translation();
+    cache_entry->lower_bound = distance > 0 ? distance : -std::numeric_limits<double>::infinity();
+  }
+#endif
+
   // Check if either object is already in the map. If not add it or if present
   // check to see if the new distance is closer. If closer remove the existing
   // one and add the new distance information.
@@ -701,6 +816,28 @@ FCLShapeCache& GetShapeCache()
   return cache;
 }
 
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+/** \brief Create the convex hull of a mesh as FCL geometry, or nullptr if the hull is degenerate. */
+static std::shared_ptr<const fcl::CollisionGeometryd> createConvexHull(const shapes::Mesh* mesh)
+{
+  const bodies::ConvexMesh hull(mesh);
+  const EigenSTL::vector_Vector3d& vertices = hull.getVertices();
+  const std::vector<unsigned int>& triangles = hull.getTriangles();
+  if (vertices.size() < 4 || triangles.empty())
+    return nullptr;
+
+  auto points = std::make_shared<std::vector<fcl::Vector3d>>(vertices.begin(), vertices.end());
+  auto faces = std::make_shared<std::vector<int>>();
+  faces->reserve(triangles.size() / 3 * 4);
+  for (std::size_t i = 0; i + 2 < triangles.size(); i += 3)
+    faces->insert(faces->end(), { 3, static_cast<int>(triangles[i]), static_cast<int>(triangles[i + 1]),
+                                  static_cast<int>(triangles[i + 2]) });
+  auto convex = std::make_shared<fcl::Convexd>(points, static_cast<int>(triangles.size() / 3), faces);
+  convex->computeLocalAABB();
+  return convex;
+}
+#endif
+
 /** \brief Templated helper function creating new collision geometry out of general object using an arbitrary bounding
  *  volume (BV).
  *
@@ -878,6 +1015,12 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   {
     cg_g->computeLocalAABB();
     FCLGeometryConstPtr res = std::make_shared<const FCLGeometry>(cg_g, data, shape_index);
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+    const std::size_t hull_threshold = convex_hull_triangle_threshold;
+    if (std::is_same<T, moveit::core::LinkModel>::value && shape->type == shapes::MESH && hull_threshold > 0 &&
+        static_cast<const shapes::Mesh*>(shape.get())->triangle_count >= hull_threshold)
+      res->collision_geometry_data_->convex_hull = createConvexHull(static_cast<const shapes::Mesh*>(shape.get()));
+#endif
     cache.map_[wptr] = res;
     cache.bumpUseCount();
     return res;
@@ -949,6 +1092,16 @@ void cleanCollisionGeometryCache()
   }
 }
 
+void setConvexHullTriangleThreshold(std::size_t min_triangles)
+{
+  convex_hull_triangle_threshold = min_triangles;
+}
+
+std::size_t getConvexHullTriangleThreshold()
+{
+  return convex_hull_triangle_threshold;
+}
+
 void CollisionData::enableGroup(const moveit::core::RobotModelConstPtr& robot_model)
 {
   if (robot_model->hasJointModelGroup(req_->group_name))
@@ -39,11 +39,16 @@
 #include <moveit/collision_detection_fcl/collision_common.h>
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
+#include <moveit/utils/performance_counters.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
+#include <fcl/geometry/bvh/BVH_model.h>
+#else
+#include <fcl/BVH/BVH_model.h>
 #endif
 
 namespace collision_detection
@@ -74,6 +79,57 @@ void checkFCLCapabilities(const DistanceRequest& req)
   (void)(req);  // silent -Wunused-parameter
 #endif
 }
+
+// Forwards the pairs of an FCL query to the wrapped callback, unless one of the objects is hidden
+struct HiddenObjectsFilter
+{
+  void* data;
+  const std::unordered_set<const fcl::CollisionObjectd*>* hidden;
+
+  bool isHidden(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2) const
+  {
+    return hidden->find(o1) != hidden->end() || hidden->find(o2) != hidden->end();
+  }
+};
+
+bool filteredCollisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  const auto* filter = static_cast<const HiddenObjectsFilter*>(data);
+  if (filter->isHidden(o1, o2))
+    return false;
+  return collisionCallback(o1, o2, filter->data);
+}
+
+bool filteredDistanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
+{
+  const auto* filter = static_cast<const HiddenObjectsFilter*>(data);
+  if (filter->isHidden(o1, o2))
+    return false;
+  return distanceCallback(o1, o2, filter->data, min_dist);
+}
+
+// Minimum number of unshared world objects before they are merged into a new shared broadphase
+constexpr std::size_t MIN_UNSHARED_FCL_OBJECTS = 32;
+
+// Bytes of the bounding volume hierarchy of a mesh, or of the primitive
+std::size_t getGeometryMemoryUsage(const FCLGeometry& geometry)
+{
+  std::size_t bytes = sizeof(FCLGeometry) + sizeof(CollisionGeometryData);
+  const fcl::CollisionGeometryd& collision_geometry = *geometry.collision_geometry_;
+  if (collision_geometry.getObjectType() == fcl::OT_BVH && collision_geometry.getNodeType() == fcl::BV_OBBRSS)
+    bytes += static_cast<const fcl::BVHModel<fcl::OBBRSSd>&>(collision_geometry).memUsage(false);
+  else
+    bytes += sizeof(fcl::CollisionGeometryd);
+  return bytes;
+}
+
+void addObjectMemoryUsage(const std::string& name, const FCLObject& object, moveit::MemoryUsage& usage)
+{
+  std::size_t bytes = object.collision_objects_.size() * sizeof(fcl::CollisionObjectd);
+  for (const FCLGeometryConstPtr& geometry : object.collision_geometry_)
+    bytes += getGeometryMemoryUsage(*geometry);
+  usage.add(name, bytes);
+}
 }  // namespace
 
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
@@ -108,8 +164,7 @@ CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model,
   manager_ = std::make_unique<fcl::DynamicAABBTreeCollisionManagerd>();
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(
-      [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); });
+  observer_handle_ = addWorldObserver();
 }
 
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, const WorldPtr& world, double padding,
@@ -144,9 +199,11 @@ CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model,
   manager_ = std::make_unique<fcl::DynamicAABBTreeCollisionManagerd>();
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(
-      [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); });
+  observer_handle_ = addWorldObserver();
+  beginWorldBatch();
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
+  defer_registration_ = false;
+  shareFCLObjects(true);
 }
 
 CollisionEnvFCL::~CollisionEnvFCL()
@@ -161,14 +218,19 @@ CollisionEnvFCL::CollisionEnvFCL(const CollisionEnvFCL& other, const WorldPtr& w
 
   manager_ = std::make_unique<fcl::DynamicAABBTreeCollisionManagerd>();
 
+  // the broadphase of the shared world objects is reused, only the few unshared ones need to be registered again
+  shared_manager_ = other.shared_manager_;
+  shared_fcl_objs_ = other.shared_fcl_objs_;
+  hidden_shared_fcl_objs_ = other.hidden_shared_fcl_objs_;
+  hidden_shared_collision_objects_ = other.hidden_shared_collision_objects_;
+
   fcl_objs_ = other.fcl_objs_;
   for (auto& fcl_obj : fcl_objs_)
     fcl_obj.second.registerTo(manager_.get());
   // manager_->update();
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(
-      [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); });
+  observer_handle_ = addWorldObserver();
 }
 
 void CollisionEnvFCL::getAttachedBodyObjects(const moveit::core::AttachedBody* ab,
@@ -217,6 +279,13 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(coll_obj));
     }
 
+  constructFCLObjectAttachedBodies(state, fcl_obj);
+}
+
+void CollisionEnvFCL::constructFCLObjectAttachedBodies(const moveit::core::RobotState& state, FCLObject& fcl_obj) const
+{
+  fcl::Transform3d fcl_tf;
+
   // TODO: Implement a method for caching fcl::CollisionObject's for moveit::core::AttachedBody's
   std::vector<const moveit::core::AttachedBody*> ab;
   state.getAttachedBodies(ab);
@@ -246,6 +315,70 @@ void CollisionEnvFCL::allocSelfCollisionBroadPhase(const moveit::core::RobotStat
   manager.object_.registerTo(manager.manager_.get());
 }
 
+fcl::BroadPhaseCollisionManagerd*
+CollisionEnvFCL::acquireSelfCollisionBroadPhase(const moveit::core::RobotState& state,
+                                                FCLObject& attached_objects) const
+{
+  SelfCollisionBroadPhase* broadphase;
+  {
+    std::scoped_lock slock(self_collision_broadphases_lock_);
+    std::unique_ptr<SelfCollisionBroadPhase>& entry = self_collision_broadphases_[std::this_thread::get_id()];
+    if (!entry)
+      entry = std::make_unique<SelfCollisionBroadPhase>();
+    broadphase = entry.get();
+  }
+
+  fcl::Transform3d fcl_tf;
+  if (broadphase->geometry_version_ != robot_geometry_version_)
+  {
+    // (re)construct the link objects; this only happens for the first check of a thread or after the robot geometry
+    // changed, e.g. through a new padding or scaling
+    broadphase->manager_.manager_ = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
+    broadphase->manager_.object_.clear();
+    broadphase->geometry_indices_.clear();
+    for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
+      if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+      {
+        transform2fcl(state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
+                                                      robot_geoms_[i]->collision_geometry_data_->shape_index),
+                      fcl_tf);
+        auto coll_obj = std::make_shared<fcl::CollisionObjectd>(*robot_fcl_objs_[i]);
+        coll_obj->setTransform(fcl_tf);
+        coll_obj->computeAABB();
+        broadphase->manager_.object_.collision_objects_.push_back(coll_obj);
+        broadphase->manager_.object_.collision_geometry_.push_back(robot_geoms_[i]);
+        broadphase->geometry_indices_.push_back(i);
+      }
+    broadphase->manager_.object_.registerTo(broadphase->manager_.manager_.get());
+    broadphase->geometry_version_ = robot_geometry_version_;
+  }
+  else
+  {
+    // move the persistent link objects and refit the tree instead of rebuilding it
+    const std::vector<FCLCollisionObjectPtr>& objects = broadphase->manager_.object_.collision_objects_;
+    for (std::size_t k = 0; k < objects.size(); ++k)
+    {
+      const FCLGeometryConstPtr& geom = robot_geoms_[broadphase->geometry_indices_[k]];
+      transform2fcl(state.getCollisionBodyTransform(geom->collision_geometry_data_->ptr.link,
+                                                    geom->collision_geometry_data_->shape_index),
+                    fcl_tf);
+      objects[k]->setTransform(fcl_tf);
+      objects[k]->computeAABB();
+    }
+    broadphase->manager_.manager_->update();
+  }
+
+  constructFCLObjectAttachedBodies(state, attached_objects);
+  attached_objects.registerTo(broadphase->manager_.manager_.get());
+  return broadphase->manager_.manager_.get();
+}
+
+void CollisionEnvFCL::releaseSelfCollisionBroadPhase(fcl::BroadPhaseCollisionManagerd* manager,
+                                                     FCLObject& attached_objects) const
+{
+  attached_objects.unregisterFrom(manager);
+}
+
 void CollisionEnvFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                          const moveit::core::RobotState& state) const
 {
@@ -262,11 +395,13 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
                                                const moveit::core::RobotState& state,
                                                const AllowedCollisionMatrix* acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
+  FCLObject attached_objects;
+  fcl::BroadPhaseCollisionManagerd* manager = acquireSelfCollisionBroadPhase(state, attached_objects);
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
-  manager.manager_->collide(&cd, &collisionCallback);
+  manager->collide(&cd, &collisionCallback);
+  releaseSelfCollisionBroadPhase(manager, attached_objects);
   if (req.distance)
   {
     DistanceRequest dreq;
@@ -316,13 +451,14 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
                                                 const moveit::core::RobotState& state,
                                                 const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
   FCLObject fcl_obj;
   constructFCLObjectRobot(state, fcl_obj);
 
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
   for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
+    collideWorld(fcl_obj.collision_objects_[i].get(), cd);
 
   if (req.distance)
   {
@@ -341,21 +477,123 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
   }
 }
 
+void CollisionEnvFCL::checkRobotCollisionBatch(const CollisionRequest& req,
+                                               const std::vector<const moveit::core::RobotState*>& states,
+                                               std::vector<CollisionResult>& results) const
+{
+  checkRobotCollisionBatchHelper(req, states, results, nullptr);
+}
+
+void CollisionEnvFCL::checkRobotCollisionBatch(const CollisionRequest& req,
+                                               const std::vector<const moveit::core::RobotState*>& states,
+                                               std::vector<CollisionResult>& results,
+                                               const AllowedCollisionMatrix& acm) const
+{
+  checkRobotCollisionBatchHelper(req, states, results, &acm);
+}
+
+void CollisionEnvFCL::checkRobotCollisionBatchHelper(const CollisionRequest& req,
+                                                     const std::vector<const moveit::core::RobotState*>& states,
+                                                     std::vector<CollisionResult>& results,
+                                                     const AllowedCollisionMatrix* acm) const
+{
+  results.clear();
+  results.resize(states.size());
+  if (states.empty())
+    return;
+
+  const auto check_range = [this, &req, &states, &results, acm](std::size_t begin, std::size_t end) {
+    // the link objects are constructed once per range and only moved for each of its states
+    fcl::Transform3d fcl_tf;
+    std::vector<FCLCollisionObjectPtr> link_objects;
+    std::vector<std::size_t> geometry_indices;
+    for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
+      if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+      {
+        link_objects.push_back(std::make_shared<fcl::CollisionObjectd>(*robot_fcl_objs_[i]));
+        geometry_indices.push_back(i);
+      }
+
+    for (std::size_t s = begin; s < end; ++s)
+    {
+      MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::COLLISION_CHECKS);
+      const moveit::core::RobotState& state = *states[s];
+      for (std::size_t k = 0; k < link_objects.size(); ++k)
+      {
+        const FCLGeometryConstPtr& geom = robot_geoms_[geometry_indices[k]];
+        transform2fcl(state.getCollisionBodyTransform(geom->collision_geometry_data_->ptr.link,
+                                                      geom->collision_geometry_data_->shape_index),
+                      fcl_tf);
+        link_objects[k]->setTransform(fcl_tf);
+        link_objects[k]->computeAABB();
+      }
+      FCLObject attached_objects;
+      constructFCLObjectAttachedBodies(state, attached_objects);
+
+      CollisionData cd(&req, &results[s], acm);
+      cd.enableGroup(getRobotModel());
+      for (std::size_t k = 0; !cd.done_ && k < link_objects.size(); ++k)
+        collideWorld(link_objects[k].get(), cd);
+      for (std::size_t k = 0; !cd.done_ && k < attached_objects.collision_objects_.size(); ++k)
+        collideWorld(attached_objects.collision_objects_[k].get(), cd);
+
+      if (req.distance)
+      {
+        DistanceRequest dreq;
+        DistanceResult dres;
+
+        dreq.group_name = req.group_name;
+        dreq.acm = acm;
+        dreq.enableGroup(getRobotModel());
+        distanceRobot(dreq, dres, state);
+        results[s].distance = dres.minimum_distance.distance;
+        if (req.detailed_distance)
+        {
+          results[s].distance_result = dres;
+        }
+      }
+    }
+  };
+
+  // spawning threads only pays off if each of them gets a few states to check
+  static constexpr std::size_t MIN_STATES_PER_THREAD = 8;
+  const std::size_t thread_count =
+      std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                            (states.size() + MIN_STATES_PER_THREAD - 1) / MIN_STATES_PER_THREAD);
+  if (thread_count <= 1)
+  {
+    check_range(0, states.size());
+    return;
+  }
+
+  const std::size_t chunk = (states.size() + thread_count - 1) / thread_count;
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (std::size_t begin = chunk; begin < states.size(); begin += chunk)
+    threads.emplace_back(check_range, begin, std::min(begin + chunk, states.size()));
+  check_range(0, std::min(chunk, states.size()));
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
 void CollisionEnvFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                    const moveit::core::RobotState& state) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::DISTANCE_QUERIES);
   checkFCLCapabilities(req);
 
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLObject attached_objects;
+  fcl::BroadPhaseCollisionManagerd* manager = acquireSelfCollisionBroadPhase(state, attached_objects);
   DistanceData drd(&req, &res);
 
-  manager.manager_->distance(&drd, &distanceCallback);
+  manager->distance(&drd, &distanceCallback);
+  releaseSelfCollisionBroadPhase(manager, attached_objects);
 }
 
 void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult& res,
                                     const moveit::core::RobotState& state) const
 {
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::DISTANCE_QUERIES);
   checkFCLCapabilities(req);
 
   FCLObject fcl_obj;
@@ -363,16 +601,99 @@ void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult&
 
   DistanceData drd(&req, &res);
   for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
+    distanceWorld(fcl_obj.collision_objects_[i].get(), drd);
+}
+
+void CollisionEnvFCL::collideWorld(fcl::CollisionObjectd* object, CollisionData& cd) const
+{
+  if (shared_manager_)
+  {
+    if (hidden_shared_collision_objects_.empty())
+      shared_manager_->collide(object, &cd, &collisionCallback);
+    else
+    {
+      HiddenObjectsFilter filter{ &cd, &hidden_shared_collision_objects_ };
+      shared_manager_->collide(object, &filter, &filteredCollisionCallback);
+    }
+  }
+  if (!cd.done_)
+    manager_->collide(object, &cd, &collisionCallback);
+}
+
+void CollisionEnvFCL::distanceWorld(fcl::CollisionObjectd* object, DistanceData& drd) const
+{
+  if (shared_manager_)
+  {
+    if (hidden_shared_collision_objects_.empty())
+      shared_manager_->distance(object, &drd, &distanceCallback);
+    else
+    {
+      HiddenObjectsFilter filter{ &drd, &hidden_shared_collision_objects_ };
+      shared_manager_->distance(object, &filter, &filteredDistanceCallback);
+    }
+  }
+  if (!drd.done)
+    manager_->distance(object, &drd, &distanceCallback);
+}
+
+void CollisionEnvFCL::hideSharedFCLObject(const std::string& id)
+{
+  if (!shared_fcl_objs_)
+    return;
+  auto it = shared_fcl_objs_->find(id);
+  if (it == shared_fcl_objs_->end() || !hidden_shared_fcl_objs_.insert(id).second)
+    return;
+  for (const FCLCollisionObjectPtr& collision_object : it->second.collision_objects_)
+    hidden_shared_collision_objects_.insert(collision_object.get());
+}
+
+bool CollisionEnvFCL::shareFCLObjects(bool force)
+{
+  if (fcl_objs_.empty() && hidden_shared_fcl_objs_.empty())
+    return false;
+  const std::size_t shared_count = shared_fcl_objs_ ? shared_fcl_objs_->size() : 0;
+  if (!force && fcl_objs_.size() + hidden_shared_fcl_objs_.size() <= MIN_UNSHARED_FCL_OBJECTS + shared_count / 16)
+    return false;
+
+  auto fcl_objs = std::make_shared<std::map<std::string, FCLObject>>();
+  if (shared_fcl_objs_)
+  {
+    for (const std::pair<const std::string, FCLObject>& fcl_obj : *shared_fcl_objs_)
+      if (hidden_shared_fcl_objs_.find(fcl_obj.first) == hidden_shared_fcl_objs_.end())
+        fcl_objs->insert(fcl_obj);
+  }
+  manager_->clear();
+  for (std::pair<const std::string, FCLObject>& fcl_obj : fcl_objs_)
+    (*fcl_objs)[fcl_obj.first] = std::move(fcl_obj.second);
+  fcl_objs_.clear();
+  unregistered_fcl_objs_.clear();
+
+  // registering all objects at once builds a balanced tree
+  std::vector<fcl::CollisionObjectd*> collision_objects;
+  for (const std::pair<const std::string, FCLObject>& fcl_obj : *fcl_objs)
+    for (const FCLCollisionObjectPtr& collision_object : fcl_obj.second.collision_objects_)
+      collision_objects.push_back(collision_object.get());
+  auto manager = std::make_shared<fcl::DynamicAABBTreeCollisionManagerd>();
+  if (!collision_objects.empty())
+    manager->registerObjects(collision_objects);
+
+  shared_manager_ = std::move(manager);
+  shared_fcl_objs_ = std::move(fcl_objs);
+  hidden_shared_fcl_objs_.clear();
+  hidden_shared_collision_objects_.clear();
+  return true;
 }
 
 void CollisionEnvFCL::updateFCLObject(const std::string& id)
 {
+  hideSharedFCLObject(id);
+
   // remove FCL objects that correspond to this object
   auto jt = fcl_objs_.find(id);
   if (jt != fcl_objs_.end())
   {
-    jt->second.unregisterFrom(manager_.get());
+    if (unregistered_fcl_objs_.find(id) == unregistered_fcl_objs_.end())
+      jt->second.unregisterFrom(manager_.get());
     jt->second.clear();
   }
 
@@ -381,24 +702,70 @@ void CollisionEnvFCL::updateFCLObject(const std::string& id)
   if (it != getWorld()->end())
   {
     // construct FCL objects that correspond to this object
-    if (jt != fcl_objs_.end())
-    {
-      constructFCLObjectWorld(it->second.get(), jt->second);
-      jt->second.registerTo(manager_.get());
-    }
+    FCLObject& fcl_obj = jt != fcl_objs_.end() ? jt->second : fcl_objs_[id];
+    constructFCLObjectWorld(it->second.get(), fcl_obj);
+    if (defer_registration_)
+      unregistered_fcl_objs_.insert(id);
     else
-    {
-      constructFCLObjectWorld(it->second.get(), fcl_objs_[id]);
-      fcl_objs_[id].registerTo(manager_.get());
-    }
+      fcl_obj.registerTo(manager_.get());
   }
   else
   {
     if (jt != fcl_objs_.end())
       fcl_objs_.erase(jt);
+    unregistered_fcl_objs_.erase(id);
   }
 
   // manager_->update();
+  if (!defer_registration_)
+    shareFCLObjects(false);
+}
+
+World::ObserverHandle CollisionEnvFCL::addWorldObserver()
+{
+  return getWorld()->addObserver(
+      [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); },
+      [this] { beginWorldBatch(); }, [this] { endWorldBatch(); });
+}
+
+void CollisionEnvFCL::beginWorldBatch()
+{
+  defer_registration_ = true;
+}
+
+void CollisionEnvFCL::endWorldBatch()
+{
+  defer_registration_ = false;
+  // many changes are merged into a new balanced broadphase, a few are registered to the unshared one at once
+  if (shareFCLObjects(false) || unregistered_fcl_objs_.empty())
+    return;
+  std::vector<fcl::CollisionObjectd*> collision_objects;
+  for (const std::string& id : unregistered_fcl_objs_)
+    for (const FCLCollisionObjectPtr& collision_object : fcl_objs_[id].collision_objects_)
+      collision_objects.push_back(collision_object.get());
+  unregistered_fcl_objs_.clear();
+  if (!collision_objects.empty())
+    manager_->registerObjects(collision_objects);
+}
+
+moveit::MemoryUsage CollisionEnvFCL::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  for (const FCLGeometryConstPtr& geometry : robot_geoms_)
+    if (geometry)
+      usage.add("robot_geometry", getGeometryMemoryUsage(*geometry) + sizeof(fcl::CollisionObjectd));
+  for (const auto& [id, object] : fcl_objs_)
+    addObjectMemoryUsage("world_geometry", object, usage);
+  if (shared_fcl_objs_)
+    for (const auto& [id, object] : *shared_fcl_objs_)
+      addObjectMemoryUsage("shared_world_geometry", object, usage);
+
+  std::scoped_lock lock(self_collision_broadphases_lock_);
+  for (const auto& entry : self_collision_broadphases_)
+    usage.add("self_collision_broadphases",
+              entry.second->manager_.object_.collision_objects_.size() * sizeof(fcl::CollisionObjectd) +
+                  entry.second->geometry_indices_.capacity() * sizeof(std::size_t));
+  return usage;
 }
 
 void CollisionEnvFCL::setWorld(const WorldPtr& world)
@@ -412,29 +779,40 @@ void CollisionEnvFCL::setWorld(const WorldPtr& world)
   // clear out objects from old world
   manager_->clear();
   fcl_objs_.clear();
+  unregistered_fcl_objs_.clear();
+  shared_manager_.reset();
+  shared_fcl_objs_.reset();
+  hidden_shared_fcl_objs_.clear();
+  hidden_shared_collision_objects_.clear();
   cleanCollisionGeometryCache();
 
   CollisionEnv::setWorld(world);
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(
-      [this](const World::ObjectConstPtr& object, World::Action action) { notifyObjectChange(object, action); });
+  observer_handle_ = addWorldObserver();
 
-  // get notifications any objects already in the new world
+  // get notifications any objects already in the new world, which are registered in bulk
+  beginWorldBatch();
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
+  defer_registration_ = false;
+  shareFCLObjects(true);
 }
 
 void CollisionEnvFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
   if (action == World::DESTROY)
   {
+    hideSharedFCLObject(obj->id_);
     auto it = fcl_objs_.find(obj->id_);
     if (it != fcl_objs_.end())
     {
-      it->second.unregisterFrom(manager_.get());
+      if (!unregistered_fcl_objs_.erase(obj->id_))
+        it->second.unregisterFrom(manager_.get());
       it->second.clear();
       fcl_objs_.erase(it);
     }
+    if (!defer_registration_)
+      shareFCLObjects(false);
     cleanCollisionGeometryCache();
   }
   else
@@ -468,6 +846,7 @@ void CollisionEnvFCL::updatedPaddingOrScaling(const std::vector<std::string>& li
     else
       RCLCPP_ERROR(LOGGER, "Updating padding or scaling for unknown link: '%s'", link.c_str());
   }
+  ++robot_geometry_version_;
 }
 
 }  // end of namespace collision_detection
@@ -47,6 +47,10 @@
 
 #include <urdf_parser/urdf_parser.h>
 #include <geometric_shapes/shape_operations.h>
+#include <random_numbers/random_numbers.h>
+
+#include <atomic>
+#include <thread>
 
 /** \brief Brings the panda robot in user defined home position */
 inline void setToHome(moveit::core::RobotState& panda_state)
@@ -223,9 +227,245 @@ TEST_F(CollisionDetectionEnvTest, PaddingTest)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief Repeated self collision checks reuse the broadphase of the calling thread, which has to follow the state. */
+TEST_F(CollisionDetectionEnvTest, RepeatedSelfCollisionChecks)
+{
+  moveit::core::RobotState colliding_state(robot_model_);
+  colliding_state.setToDefaultValues();
+  colliding_state.update();
+
+  const auto check = [this](const moveit::core::RobotState& state) {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    c_env_->checkSelfCollision(req, res, state, *acm_);
+    return res.collision;
+  };
+
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    ASSERT_FALSE(check(*robot_state_));
+    ASSERT_TRUE(check(colliding_state));
+  }
+
+  // changing the geometry of a link needs to rebuild the cached broadphase
+  c_env_->setLinkPadding("panda_hand", 0.5);
+  ASSERT_TRUE(check(*robot_state_));
+  c_env_->setLinkPadding("panda_hand", 0.0);
+  ASSERT_FALSE(check(*robot_state_));
+
+  // every thread uses its own broadphase
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> failures{ 0 };
+  for (std::size_t t = 0; t < 4; ++t)
+    threads.emplace_back([&] {
+      for (std::size_t i = 0; i < 20; ++i)
+        if (check(*robot_state_) || !check(colliding_state))
+          ++failures;
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_EQ(failures, 0u);
+}
+
+/** \brief Checking a batch of states has to give the same results as checking them one by one. */
+TEST_F(CollisionDetectionEnvTest, RobotCollisionBatch)
+{
+  shapes::ShapeConstPtr shape_ptr = std::make_shared<shapes::Box>(0.3, 0.3, 0.3);
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation().x() = 0.45;
+  pos.translation().z() = 0.5;
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  random_numbers::RandomNumberGenerator rng(0x42);
+  const moveit::core::JointModelGroup* arm = robot_model_->getJointModelGroup("panda_arm");
+  std::vector<moveit::core::RobotState> states(100, *robot_state_);
+  std::vector<const moveit::core::RobotState*> state_ptrs;
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions(arm, rng);
+    state.update();
+    state_ptrs.push_back(&state);
+  }
+
+  collision_detection::CollisionRequest req;
+  std::vector<collision_detection::CollisionResult> results;
+  c_env_->checkRobotCollisionBatch(req, state_ptrs, results, *acm_);
+  ASSERT_EQ(results.size(), states.size());
+
+  std::size_t collisions = 0;
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::CollisionResult res;
+    c_env_->checkRobotCollision(req, res, states[i], *acm_);
+    EXPECT_EQ(results[i].collision, res.collision) << "state " << i;
+    collisions += res.collision ? 1 : 0;
+  }
+  // make sure the test covers both outcomes
+  EXPECT_GT(collisions, 0u);
+  EXPECT_LT(collisions, states.size());
+}
+
+/** \brief Copies of an environment share the world objects, but changes to the world of either are kept apart. */
+TEST_F(CollisionDetectionEnvTest, CopiedWorldObjects)
+{
+  shapes::ShapeConstPtr shape_ptr = std::make_shared<shapes::Box>(0.1, 0.1, 0.1);
+  Eigen::Isometry3d colliding{ Eigen::Isometry3d::Identity() };
+  colliding.translation().z() = 0.3;
+  Eigen::Isometry3d free{ Eigen::Isometry3d::Identity() };
+  free.translation().x() = 3.0;
+
+  const collision_detection::WorldPtr& world = c_env_->getWorld();
+  world->addToObject("box", colliding, shape_ptr, Eigen::Isometry3d::Identity());
+  for (std::size_t i = 0; i < 100; ++i)
+    world->addToObject("far_box_" + std::to_string(i), free, shape_ptr, Eigen::Isometry3d::Identity());
+
+  auto copied_world = std::make_shared<collision_detection::World>(*world);
+  collision_detection::CollisionEnvFCL copied_env(
+      static_cast<const collision_detection::CollisionEnvFCL&>(*c_env_), copied_world);
+
+  auto in_collision = [this](const collision_detection::CollisionEnv& env) {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    env.checkRobotCollision(req, res, *robot_state_, *acm_);
+    return res.collision;
+  };
+  EXPECT_TRUE(in_collision(*c_env_));
+  EXPECT_TRUE(in_collision(copied_env));
+
+  copied_world->removeObject("box");
+  EXPECT_TRUE(in_collision(*c_env_));
+  EXPECT_FALSE(in_collision(copied_env));
+
+  copied_world->setObjectPose("far_box_0", colliding);
+  EXPECT_FALSE(world->getObject("far_box_0")->pose_.isApprox(colliding));
+  EXPECT_TRUE(in_collision(copied_env));
+  world->removeObject("box");
+  EXPECT_FALSE(in_collision(*c_env_));
+
+  // move enough objects to have them merged into a new shared broadphase
+  for (std::size_t i = 0; i < 100; ++i)
+    copied_world->setObjectPose("far_box_" + std::to_string(i), i == 50 ? colliding : free);
+  EXPECT_TRUE(in_collision(copied_env));
+  copied_world->setObjectPose("far_box_50", free);
+  EXPECT_FALSE(in_collision(copied_env));
+  EXPECT_FALSE(in_collision(*c_env_));
+}
+
+TEST_F(CollisionDetectionEnvTest, BatchedWorldUpdates)
+{
+  shapes::ShapeConstPtr shape_ptr = std::make_shared<shapes::Box>(0.1, 0.1, 0.1);
+  Eigen::Isometry3d colliding{ Eigen::Isometry3d::Identity() };
+  colliding.translation().z() = 0.3;
+  Eigen::Isometry3d free{ Eigen::Isometry3d::Identity() };
+  free.translation().x() = 3.0;
+
+  auto in_collision = [this] {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+    return res.collision;
+  };
+
+  // the objects of a small and a large batch are registered to the broadphase once the batch ends
+  const collision_detection::WorldPtr& world = c_env_->getWorld();
+  for (std::size_t count : { 3, 100 })
+  {
+    {
+      collision_detection::World::BatchUpdate batch(*world);
+      for (std::size_t i = 0; i < count; ++i)
+        world->addToObject("box_" + std::to_string(i), i == 1 ? colliding : free, shape_ptr,
+                           Eigen::Isometry3d::Identity());
+      world->setObjectPose("box_1", free);
+      world->setObjectPose("box_2", colliding);
+    }
+    EXPECT_TRUE(in_collision());
+    {
+      collision_detection::World::BatchUpdate batch(*world);
+      world->removeObject("box_2");
+      world->addToObject("box_2", free, shape_ptr, Eigen::Isometry3d::Identity());
+    }
+    EXPECT_FALSE(in_collision());
+    world->clearObjects();
+  }
+}
+
 /** \brief Continuous self collision checks of the robot.
  *
  *  Functionality not supported yet. */
+/** \brief Checking the convex hulls of link meshes first must not change any collision result. */
+TEST_F(CollisionDetectionEnvTest, ConvexHullPrefilter)
+{
+  // a fresh robot model, so that its link geometry is created with hulls
+  collision_detection::setConvexHullTriangleThreshold(1);
+  moveit::core::RobotModelPtr hull_model = moveit::core::loadTestingRobotModel("panda");
+  auto hull_env = std::make_shared<collision_detection::CollisionEnvFCL>(hull_model);
+  collision_detection::setConvexHullTriangleThreshold(0);
+
+  shapes::ShapeConstPtr box(new shapes::Box(.1, .1, .1));
+  Eigen::Isometry3d box_pose = Eigen::Isometry3d(Eigen::Translation3d(0.4, 0.0, 0.5));
+  c_env_->getWorld()->addToObject("box", box, box_pose);
+  hull_env->getWorld()->addToObject("box", box, box_pose);
+
+  moveit::core::RobotState hull_state(hull_model);
+  collision_detection::CollisionRequest req;
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    robot_state_->setToRandomPositions();
+    robot_state_->update();
+    hull_state.setVariablePositions(robot_state_->getVariablePositions());
+    hull_state.update();
+
+    collision_detection::CollisionResult res, hull_res;
+    c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+    hull_env->checkSelfCollision(req, hull_res, hull_state, *acm_);
+    EXPECT_EQ(res.collision, hull_res.collision);
+
+    res.clear();
+    hull_res.clear();
+    c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+    hull_env->checkRobotCollision(req, hull_res, hull_state, *acm_);
+    EXPECT_EQ(res.collision, hull_res.collision);
+  }
+}
+
+TEST_F(CollisionDetectionEnvTest, DistanceQueryCache)
+{
+  shapes::ShapeConstPtr box(new shapes::Box(.1, .1, .1));
+  c_env_->getWorld()->addToObject("box", box, Eigen::Isometry3d(Eigen::Translation3d(0.4, 0.0, 0.5)));
+
+  collision_detection::DistanceQueryCache self_cache, robot_cache;
+  collision_detection::DistanceRequest req, cached_req;
+  req.acm = acm_.get();
+  cached_req.acm = acm_.get();
+
+  // walk along a path of small steps, as when sampling a trajectory
+  setToHome(*robot_state_);
+  std::vector<double> positions(robot_state_->getVariablePositions(),
+                                robot_state_->getVariablePositions() + robot_state_->getVariableCount());
+  random_numbers::RandomNumberGenerator rng(42);
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    for (double& position : positions)
+      position += rng.uniformReal(-0.02, 0.02);
+    robot_state_->setVariablePositions(positions);
+    robot_state_->enforceBounds();
+    robot_state_->update();
+
+    collision_detection::DistanceResult res, cached_res;
+    cached_req.cache = &self_cache;
+    c_env_->distanceSelf(req, res, *robot_state_);
+    c_env_->distanceSelf(cached_req, cached_res, *robot_state_);
+    EXPECT_NEAR(res.minimum_distance.distance, cached_res.minimum_distance.distance, 1e-9);
+
+    res.clear();
+    cached_res.clear();
+    cached_req.cache = &robot_cache;
+    c_env_->distanceRobot(req, res, *robot_state_);
+    c_env_->distanceRobot(cached_req, cached_res, *robot_state_);
+    EXPECT_NEAR(res.minimum_distance.distance, cached_res.minimum_distance.distance, 1e-9);
+  }
+}
+
 TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionSelf)
 {
   collision_detection::CollisionRequest req;
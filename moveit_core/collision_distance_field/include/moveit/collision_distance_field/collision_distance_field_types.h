@@ -38,6 +38,8 @@
 
 #include <vector>
 #include <string>
+#include <iostream>
+#include <map>
 #include <algorithm>
 #include <memory>
 #include <float.h>
@@ -203,6 +205,14 @@ protected:
 // that vector by value
 std::vector<CollisionSphere> determineCollisionSpheres(const bodies::Body* body, Eigen::Isometry3d& relativeTransform);
 
+// writes the collision spheres of each link to a stream in a plain text format,
+// so that sphere decompositions can be cached on disk
+bool writeCollisionSpheres(std::ostream& os, const std::map<std::string, std::vector<CollisionSphere>>& link_spheres);
+
+// reads collision spheres written with writeCollisionSpheres; link_spheres is
+// only modified if the whole stream could be parsed
+bool readCollisionSpheres(std::istream& is, std::map<std::string, std::vector<CollisionSphere>>& link_spheres);
+
 // determines a set of gradients of the given collision spheres in the distance
 // field
 bool getCollisionSphereGradients(const distance_field::DistanceField* distance_field,
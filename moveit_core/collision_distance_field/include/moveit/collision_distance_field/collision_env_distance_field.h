@@ -42,6 +42,7 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <rclcpp/rclcpp.hpp>
+#include <iostream>
 #include <mutex>
 
 namespace collision_detection
@@ -176,6 +177,19 @@ public:
   void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state1,
                            const moveit::core::RobotState& state2) const override;
 
+  /** \brief Check many states for collision with the world distance field.
+   *
+   *  Unless contacts are requested, the states are split into ranges which are checked by separate threads. Each
+   *  thread poses the sphere decompositions of the group links for its states and looks them up in the world distance
+   *  field, without constructing a GroupStateRepresentation per state. Only the collision flag and, if requested, the
+   *  minimum sphere clearance are computed. States with attached bodies or requests for contacts take the
+   *  checkRobotCollision() path. */
+  void checkRobotCollisionBatch(const CollisionRequest& req, const std::vector<const moveit::core::RobotState*>& states,
+                                std::vector<CollisionResult>& results) const override;
+
+  void checkRobotCollisionBatch(const CollisionRequest& req, const std::vector<const moveit::core::RobotState*>& states,
+                                std::vector<CollisionResult>& results, const AllowedCollisionMatrix& acm) const override;
+
   virtual double distanceRobot(const moveit::core::RobotState& state, bool verbose = false) const
   {
     (void)state;
@@ -200,6 +214,30 @@ public:
 
   void setWorld(const WorldPtr& world) override;
 
+  /** \brief Reports the voxels of the distance fields of the robot ("robot_distance_field") and of the world
+   * ("world_distance_field") */
+  moveit::MemoryUsage getMemoryUsage() const override;
+
+  /** \brief Get the collision spheres of all links, expressed in the link frames. The result can be stored with
+      writeCollisionSpheres() and passed back as \e link_body_decompositions on construction, so that the sphere
+      decomposition of the robot does not need to be recomputed. */
+  std::map<std::string, std::vector<CollisionSphere>> getLinkCollisionSpheres() const;
+
+  /** \brief Write the obstacle cells of the world distance field to \e os using
+      distance_field::DistanceField::writeToStream(). The output can be loaded with readStaticWorldDistanceField(). */
+  bool writeWorldDistanceField(std::ostream& os) const;
+
+  /** \brief Load obstacle cells previously written with writeWorldDistanceField() as static world geometry.
+
+      The static geometry is voxelized once and does not correspond to any object of the world: it is kept in the
+      world distance field across world changes and calls to setWorld(), and is copied to environments constructed
+      from this one. Only the distance propagation is computed when loading. Any previously loaded static geometry is
+      replaced. Fails if the stream is invalid or its resolution, size or origin do not match this environment. */
+  bool readStaticWorldDistanceField(std::istream& is);
+
+  /** \brief Remove the static world geometry loaded with readStaticWorldDistanceField() */
+  void clearStaticWorldDistanceField();
+
   distance_field::DistanceFieldConstPtr getDistanceField() const
   {
     return distance_field_cache_entry_->distance_field_;
@@ -207,6 +245,7 @@ public:
 
   collision_detection::GroupStateRepresentationConstPtr getLastGroupStateRepresentation() const
   {
+    std::scoped_lock slock(last_gsr_lock_);
     return last_gsr_;
   }
 
@@ -235,6 +274,8 @@ protected:
   void updateGroupStateRepresentationState(const moveit::core::RobotState& state,
                                            GroupStateRepresentationPtr& gsr) const;
 
+  void setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const;
+
   void generateCollisionCheckingStructures(const std::string& group_name, const moveit::core::RobotState& state,
                                            const collision_detection::AllowedCollisionMatrix* acm,
                                            GroupStateRepresentationPtr& gsr, bool generate_distance_field) const;
@@ -271,9 +312,20 @@ protected:
 
   DistanceFieldCacheEntryWorldPtr generateDistanceFieldCacheEntryWorld();
 
+  /** \brief Copy the world distance field before modifying it if it is shared with another environment */
+  void ensureUniqueDistanceFieldCacheEntryWorld();
+
+  /** \brief Whether both worlds hold the very same object instances under the same ids */
+  static bool haveSameObjects(const World& world, const World& other_world);
+
   void updateDistanceObject(const std::string& id, CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr& dfce,
                             EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
 
+  /** \brief Bundles the checkRobotCollisionBatch() functions into a single function */
+  void checkRobotCollisionBatchHelper(const CollisionRequest& req,
+                                      const std::vector<const moveit::core::RobotState*>& states,
+                                      std::vector<CollisionResult>& results, const AllowedCollisionMatrix* acm) const;
+
   bool getEnvironmentCollisions(const CollisionRequest& req, CollisionResult& res,
                                 const distance_field::DistanceFieldConstPtr& env_distance_field,
                                 GroupStateRepresentationPtr& gsr) const;
@@ -283,6 +335,9 @@ protected:
 
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
 
+  /** \brief Add the static world geometry to the world distance field, restoring cells cleared by removed objects */
+  void addStaticWorldPoints();
+
   // Logger
   static const rclcpp::Logger LOGGER;
 
@@ -305,7 +360,12 @@ protected:
 
   mutable std::mutex update_cache_lock_world_;
   DistanceFieldCacheEntryWorldPtr distance_field_cache_entry_world_;
-  GroupStateRepresentationPtr last_gsr_;
+  // queries with separate group state representations may run concurrently, e.g. in CHOMP
+  mutable std::mutex last_gsr_lock_;
+  mutable GroupStateRepresentationPtr last_gsr_;
   World::ObserverHandle observer_handle_;
+
+  /** \brief Centers of the obstacle cells loaded with readStaticWorldDistanceField() */
+  EigenSTL::vector_Vector3d static_world_points_;
 };
 }  // namespace collision_detection
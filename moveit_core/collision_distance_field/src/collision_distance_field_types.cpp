@@ -41,6 +41,7 @@
 #include <rclcpp/clock.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/time.hpp>
+#include <limits>
 #include <memory>
 
 const static double EPSILON = 0.0001;
@@ -78,6 +79,52 @@ std::vector<CollisionSphere> determineCollisionSpheres(const bodies::Body* body,
   return css;
 }
 
+bool writeCollisionSpheres(std::ostream& os, const std::map<std::string, std::vector<CollisionSphere>>& link_spheres)
+{
+  os << "links: " << link_spheres.size() << '\n';
+  os.precision(std::numeric_limits<double>::max_digits10);
+  for (const std::pair<const std::string, std::vector<CollisionSphere>>& link : link_spheres)
+  {
+    os << link.first << ' ' << link.second.size() << '\n';
+    for (const CollisionSphere& sphere : link.second)
+    {
+      os << sphere.relative_vec_.x() << ' ' << sphere.relative_vec_.y() << ' ' << sphere.relative_vec_.z() << ' '
+         << sphere.radius_ << '\n';
+    }
+  }
+  return os.good();
+}
+
+bool readCollisionSpheres(std::istream& is, std::map<std::string, std::vector<CollisionSphere>>& link_spheres)
+{
+  std::string temp;
+  std::size_t link_count;
+  if (!(is >> temp >> link_count) || temp != "links:")
+    return false;
+
+  std::map<std::string, std::vector<CollisionSphere>> result;
+  for (std::size_t i = 0; i < link_count; ++i)
+  {
+    std::string link_name;
+    std::size_t sphere_count;
+    if (!(is >> link_name >> sphere_count))
+      return false;
+
+    std::vector<CollisionSphere>& spheres = result[link_name];
+    spheres.reserve(sphere_count);
+    for (std::size_t j = 0; j < sphere_count; ++j)
+    {
+      Eigen::Vector3d center;
+      double radius;
+      if (!(is >> center.x() >> center.y() >> center.z() >> radius))
+        return false;
+      spheres.emplace_back(center, radius);
+    }
+  }
+  link_spheres = std::move(result);
+  return true;
+}
+
 bool PosedDistanceField::getCollisionSphereGradients(const std::vector<CollisionSphere>& sphere_list,
                                                      const EigenSTL::vector_Vector3d& sphere_centers,
                                                      GradientInfo& gradient, const CollisionType& type,
@@ -45,8 +45,11 @@
 #include <moveit/collision_distance_field/collision_common_distance_field.h>
 #include <moveit/distance_field/propagation_distance_field.h>
 #include <moveit/collision_distance_field/collision_detector_allocator_distance_field.h>
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <thread>
 #include <utility>
 
 namespace collision_detection
@@ -91,8 +94,6 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(
   // request notifications about changes to world
   observer_handle_ = getWorld()->addObserver(
       [this](const World::ObjectConstPtr& object, World::Action action) { return notifyObjectChange(object, action); });
-
-  getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
 CollisionEnvDistanceField::CollisionEnvDistanceField(const CollisionEnvDistanceField& other, const WorldPtr& world)
@@ -108,14 +109,19 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(const CollisionEnvDistanceF
   link_body_decomposition_vector_ = other.link_body_decomposition_vector_;
   link_body_decomposition_index_map_ = other.link_body_decomposition_index_map_;
   in_group_update_map_ = other.in_group_update_map_;
-  distance_field_cache_entry_world_ = generateDistanceFieldCacheEntryWorld();
+  static_world_points_ = other.static_world_points_;
+  // the field of other is shared until either environment modifies it, which avoids rebuilding it for every
+  // planning scene diff of an unchanged world
+  if (haveSameObjects(*getWorld(), *other.getWorld()))
+    distance_field_cache_entry_world_ = other.distance_field_cache_entry_world_;
+  else
+    distance_field_cache_entry_world_ = generateDistanceFieldCacheEntryWorld();
   pregenerated_group_state_representation_map_ = other.pregenerated_group_state_representation_map_;
   planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
 
   // request notifications about changes to world
   observer_handle_ = getWorld()->addObserver(
       [this](const World::ObjectConstPtr& object, World::Action action) { return notifyObjectChange(object, action); });
-  getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
 CollisionEnvDistanceField::~CollisionEnvDistanceField()
@@ -1408,7 +1414,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1441,7 +1447,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1465,7 +1471,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1494,7 +1500,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1514,6 +1520,131 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& /*re
   RCLCPP_ERROR(LOGGER, "Continuous collision checking not implemented");
 }
 
+void CollisionEnvDistanceField::checkRobotCollisionBatch(const CollisionRequest& req,
+                                                         const std::vector<const moveit::core::RobotState*>& states,
+                                                         std::vector<CollisionResult>& results) const
+{
+  checkRobotCollisionBatchHelper(req, states, results, nullptr);
+}
+
+void CollisionEnvDistanceField::checkRobotCollisionBatch(const CollisionRequest& req,
+                                                         const std::vector<const moveit::core::RobotState*>& states,
+                                                         std::vector<CollisionResult>& results,
+                                                         const AllowedCollisionMatrix& acm) const
+{
+  checkRobotCollisionBatchHelper(req, states, results, &acm);
+}
+
+void CollisionEnvDistanceField::checkRobotCollisionBatchHelper(
+    const CollisionRequest& req, const std::vector<const moveit::core::RobotState*>& states,
+    std::vector<CollisionResult>& results, const AllowedCollisionMatrix* acm) const
+{
+  results.clear();
+  results.resize(states.size());
+  if (states.empty())
+    return;
+
+  const auto check_state = [this, &req, acm](const moveit::core::RobotState& state, CollisionResult& res) {
+    if (acm)
+      checkRobotCollision(req, res, state, *acm);
+    else
+      checkRobotCollision(req, res, state);
+  };
+
+  if (req.contacts)
+  {
+    for (std::size_t s = 0; s < states.size(); ++s)
+      check_state(*states[s], results[s]);
+    return;
+  }
+
+  // the cache entry only depends on the group and the joints outside of it, so it is shared by all states
+  GroupStateRepresentationPtr gsr;
+  generateCollisionCheckingStructures(req.group_name, *states[0], acm, gsr, false);
+  const DistanceFieldCacheEntryConstPtr dfce = gsr->dfce_;
+  const distance_field::DistanceFieldConstPtr env_distance_field = distance_field_cache_entry_world_->distance_field_;
+
+  std::vector<const moveit::core::LinkModel*> links;
+  std::vector<const std::vector<CollisionSphere>*> link_spheres;
+  for (std::size_t i = 0; i < dfce->link_names_.size(); ++i)
+    if (dfce->link_has_geometry_[i])
+    {
+      links.push_back(robot_model_->getLinkModel(dfce->link_names_[i]));
+      link_spheres.push_back(&link_body_decomposition_vector_[dfce->link_body_indices_[i]]->getCollisionSpheres());
+    }
+
+  // states with attached bodies need their bodies decomposed, which the general path does
+  std::vector<std::size_t> general_states;
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  for (std::size_t s = 0; s < states.size(); ++s)
+  {
+    states[s]->getAttachedBodies(attached_bodies);
+    if (!attached_bodies.empty())
+      general_states.push_back(s);
+  }
+
+  const auto check_range = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t s = begin; s < end; ++s)
+    {
+      if (std::binary_search(general_states.begin(), general_states.end(), s))
+        continue;
+      const moveit::core::RobotState& state = *states[s];
+      CollisionResult& res = results[s];
+      double min_distance = std::numeric_limits<double>::max();
+      for (std::size_t l = 0; l < links.size() && (req.distance || !res.collision); ++l)
+      {
+        const Eigen::Isometry3d& link_pose = state.getGlobalLinkTransform(links[l]);
+        for (const CollisionSphere& sphere : *link_spheres[l])
+        {
+          const Eigen::Vector3d center = link_pose * sphere.relative_vec_;
+          Eigen::Vector3d grad;
+          bool in_bounds;
+          const double dist = env_distance_field->getDistanceGradient(center.x(), center.y(), center.z(), grad.x(),
+                                                                      grad.y(), grad.z(), in_bounds);
+          // same test as getCollisionSphereCollision()
+          if (max_propogation_distance_ > dist && sphere.radius_ - dist > collision_tolerance_)
+          {
+            res.collision = true;
+            if (!req.distance)
+              break;
+          }
+          min_distance = std::min(min_distance, dist - sphere.radius_);
+        }
+      }
+      if (req.distance)
+        res.distance = min_distance;
+    }
+  };
+
+  // spawning threads only pays off if each of them gets a few states to check
+  static constexpr std::size_t MIN_STATES_PER_THREAD = 8;
+  const std::size_t thread_count =
+      std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                            (states.size() + MIN_STATES_PER_THREAD - 1) / MIN_STATES_PER_THREAD);
+  if (thread_count <= 1)
+    check_range(0, states.size());
+  else
+  {
+    const std::size_t chunk = (states.size() + thread_count - 1) / thread_count;
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (std::size_t begin = chunk; begin < states.size(); begin += chunk)
+      threads.emplace_back(check_range, begin, std::min(begin + chunk, states.size()));
+    check_range(0, std::min(chunk, states.size()));
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  for (std::size_t s : general_states)
+    check_state(*states[s], results[s]);
+}
+
+void CollisionEnvDistanceField::setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const
+{
+  std::scoped_lock slock(last_gsr_lock_);
+  last_gsr_ = gsr;
+}
+
 void CollisionEnvDistanceField::getCollisionGradients(const CollisionRequest& req, CollisionResult& /*res*/,
                                                       const moveit::core::RobotState& state,
                                                       const AllowedCollisionMatrix* acm,
@@ -1534,7 +1665,7 @@ void CollisionEnvDistanceField::getCollisionGradients(const CollisionRequest& re
   getIntraGroupProximityGradients(gsr);
   getEnvironmentProximityGradients(env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1555,7 +1686,7 @@ void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, Co
   distance_field::DistanceFieldConstPtr env_distance_field = distance_field_cache_entry_world_->distance_field_;
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 bool CollisionEnvDistanceField::getEnvironmentCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1680,6 +1811,32 @@ bool CollisionEnvDistanceField::getEnvironmentProximityGradients(
   return in_collision;
 }
 
+namespace
+{
+std::size_t getDistanceFieldMemoryUsage(const distance_field::DistanceFieldConstPtr& distance_field)
+{
+  const auto* propagation_field = dynamic_cast<const distance_field::PropagationDistanceField*>(distance_field.get());
+  if (!propagation_field)
+    return 0;
+  return sizeof(distance_field::PropagationDistanceField) +
+         propagation_field->getAllocatedCellCount() * sizeof(distance_field::PropDistanceFieldVoxel);
+}
+}  // namespace
+
+moveit::MemoryUsage CollisionEnvDistanceField::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  {
+    std::scoped_lock lock(update_cache_lock_);
+    if (distance_field_cache_entry_)
+      usage.add("robot_distance_field", getDistanceFieldMemoryUsage(distance_field_cache_entry_->distance_field_));
+  }
+  std::scoped_lock lock(update_cache_lock_world_);
+  if (distance_field_cache_entry_world_)
+    usage.add("world_distance_field", getDistanceFieldMemoryUsage(distance_field_cache_entry_world_->distance_field_));
+  return usage;
+}
+
 void CollisionEnvDistanceField::setWorld(const WorldPtr& world)
 {
   if (world == getWorld())
@@ -1688,17 +1845,14 @@ void CollisionEnvDistanceField::setWorld(const WorldPtr& world)
   // turn off notifications about old world
   getWorld()->removeObserver(observer_handle_);
 
-  // clear out objects from old world
-  distance_field_cache_entry_world_->distance_field_->reset();
-
   CollisionEnv::setWorld(world);
 
+  // rebuild the field from the objects already in the new world, leaving a possibly shared field untouched
+  distance_field_cache_entry_world_ = generateDistanceFieldCacheEntryWorld();
+
   // request notifications about changes to new world
   observer_handle_ = getWorld()->addObserver(
       [this](const World::ObjectConstPtr& object, World::Action action) { return notifyObjectChange(object, action); });
-
-  // get notifications any objects already in the new world
-  getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
 void CollisionEnvDistanceField::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
@@ -1706,6 +1860,8 @@ void CollisionEnvDistanceField::notifyObjectChange(const ObjectConstPtr& obj, Wo
   rclcpp::Clock clock;
   rclcpp::Time start_time = clock.now();
 
+  ensureUniqueDistanceFieldCacheEntryWorld();
+
   EigenSTL::vector_Vector3d add_points;
   EigenSTL::vector_Vector3d subtract_points;
   updateDistanceObject(obj->id_, distance_field_cache_entry_world_, add_points, subtract_points);
@@ -1713,10 +1869,12 @@ void CollisionEnvDistanceField::notifyObjectChange(const ObjectConstPtr& obj, Wo
   if (action == World::DESTROY)
   {
     distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
+    addStaticWorldPoints();
   }
   else if (action & (World::MOVE_SHAPE | World::REMOVE_SHAPE))
   {
     distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
+    addStaticWorldPoints();
     distance_field_cache_entry_world_->distance_field_->addPointsToField(add_points);
   }
   else
@@ -1786,7 +1944,7 @@ CollisionEnvDistanceField::generateDistanceFieldCacheEntryWorld()
       size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
       origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_);
 
-  EigenSTL::vector_Vector3d add_points;
+  EigenSTL::vector_Vector3d add_points = static_world_points_;
   EigenSTL::vector_Vector3d subtract_points;
   for (const std::pair<const std::string, ObjectPtr>& object : *getWorld())
   {
@@ -1795,4 +1953,128 @@ CollisionEnvDistanceField::generateDistanceFieldCacheEntryWorld()
   dfce->distance_field_->addPointsToField(add_points);
   return dfce;
 }
+
+void CollisionEnvDistanceField::ensureUniqueDistanceFieldCacheEntryWorld()
+{
+  if (distance_field_cache_entry_world_.use_count() <= 1)
+    return;
+
+  // the posed decompositions are never modified in place, so they can stay shared with the copy
+  DistanceFieldCacheEntryWorldPtr dfce = std::make_shared<DistanceFieldCacheEntryWorld>();
+  dfce->posed_body_point_decompositions_ = distance_field_cache_entry_world_->posed_body_point_decompositions_;
+  const distance_field::DistanceField& field = *distance_field_cache_entry_world_->distance_field_;
+  dfce->distance_field_ = std::make_shared<distance_field::PropagationDistanceField>(
+      static_cast<const distance_field::PropagationDistanceField&>(field));
+  distance_field_cache_entry_world_ = dfce;
+}
+
+bool CollisionEnvDistanceField::haveSameObjects(const World& world, const World& other_world)
+{
+  if (world.size() != other_world.size())
+    return false;
+  for (World::const_iterator it = world.begin(), other_it = other_world.begin(); it != world.end(); ++it, ++other_it)
+  {
+    if (it->first != other_it->first || it->second != other_it->second)
+      return false;
+  }
+  return true;
+}
+
+void CollisionEnvDistanceField::addStaticWorldPoints()
+{
+  // cells which are already obstacles are skipped, so only cells cleared by a removal are propagated again
+  if (!static_world_points_.empty())
+    distance_field_cache_entry_world_->distance_field_->addPointsToField(static_world_points_);
+}
+
+std::map<std::string, std::vector<CollisionSphere>> CollisionEnvDistanceField::getLinkCollisionSpheres() const
+{
+  std::map<std::string, std::vector<CollisionSphere>> link_spheres;
+  for (const std::pair<const std::string, unsigned int>& link : link_body_decomposition_index_map_)
+    link_spheres[link.first] = link_body_decomposition_vector_[link.second]->getCollisionSpheres();
+  return link_spheres;
+}
+
+bool CollisionEnvDistanceField::writeWorldDistanceField(std::ostream& os) const
+{
+  return distance_field_cache_entry_world_->distance_field_->writeToStream(os);
+}
+
+bool CollisionEnvDistanceField::readStaticWorldDistanceField(std::istream& is)
+{
+  rclcpp::Clock clock;
+  rclcpp::Time start_time = clock.now();
+
+  // read into a field of the same parameters, so that mismatching files can be rejected before touching the world
+  distance_field::PropagationDistanceField static_field(
+      size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
+      origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_);
+  if (!static_field.readFromStream(is))
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to read static world distance field");
+    return false;
+  }
+
+  const distance_field::DistanceField& world_field = *distance_field_cache_entry_world_->distance_field_;
+  if (fabs(static_field.getResolution() - world_field.getResolution()) > EPSILON ||
+      fabs(static_field.getSizeX() - world_field.getSizeX()) > EPSILON ||
+      fabs(static_field.getSizeY() - world_field.getSizeY()) > EPSILON ||
+      fabs(static_field.getSizeZ() - world_field.getSizeZ()) > EPSILON ||
+      fabs(static_field.getOriginX() - world_field.getOriginX()) > EPSILON ||
+      fabs(static_field.getOriginY() - world_field.getOriginY()) > EPSILON ||
+      fabs(static_field.getOriginZ() - world_field.getOriginZ()) > EPSILON)
+  {
+    RCLCPP_ERROR(LOGGER, "Static world distance field does not match the resolution, size or origin of the "
+                         "collision environment");
+    return false;
+  }
+
+  EigenSTL::vector_Vector3d points;
+  for (int x = 0; x < static_field.getXNumCells(); ++x)
+  {
+    for (int y = 0; y < static_field.getYNumCells(); ++y)
+    {
+      for (int z = 0; z < static_field.getZNumCells(); ++z)
+      {
+        if (static_field.getCell(x, y, z).distance_square_ == 0)
+        {
+          Eigen::Vector3d point;
+          static_field.gridToWorld(x, y, z, point.x(), point.y(), point.z());
+          points.push_back(point);
+        }
+      }
+    }
+  }
+
+  clearStaticWorldDistanceField();
+  ensureUniqueDistanceFieldCacheEntryWorld();
+  static_world_points_ = std::move(points);
+  addStaticWorldPoints();
+
+  RCLCPP_DEBUG(LOGGER, "Loading %zu static world cells took %lf s", static_world_points_.size(),
+               (clock.now() - start_time).seconds());
+  return true;
+}
+
+void CollisionEnvDistanceField::clearStaticWorldDistanceField()
+{
+  if (static_world_points_.empty())
+    return;
+  ensureUniqueDistanceFieldCacheEntryWorld();
+
+  // cells shared with world objects are restored right away
+  distance_field_cache_entry_world_->distance_field_->removePointsFromField(static_world_points_);
+  static_world_points_.clear();
+  EigenSTL::vector_Vector3d object_points;
+  for (const std::pair<const std::string, std::vector<PosedBodyPointDecompositionPtr>>& object :
+       distance_field_cache_entry_world_->posed_body_point_decompositions_)
+  {
+    for (const PosedBodyPointDecompositionPtr& posed_body_point_decomposition : object.second)
+    {
+      object_points.insert(object_points.end(), posed_body_point_decomposition->getCollisionPoints().begin(),
+                           posed_body_point_decomposition->getCollisionPoints().end());
+    }
+  }
+  distance_field_cache_entry_world_->distance_field_->addPointsToField(object_points);
+}
 }  // namespace collision_detection
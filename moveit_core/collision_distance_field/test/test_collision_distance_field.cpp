@@ -330,6 +330,198 @@ TEST_F(DistanceFieldCollisionDetectionTester, AttachedBodyTester)
   ASSERT_TRUE(res.collision);
 }
 
+TEST_F(DistanceFieldCollisionDetectionTester, CollisionSpheresRoundTrip)
+{
+  const auto& df_env = static_cast<const DefaultCEnvType&>(*cenv_);
+  std::map<std::string, std::vector<collision_detection::CollisionSphere>> link_spheres =
+      df_env.getLinkCollisionSpheres();
+  ASSERT_FALSE(link_spheres.empty());
+
+  std::stringstream stream;
+  ASSERT_TRUE(collision_detection::writeCollisionSpheres(stream, link_spheres));
+
+  std::map<std::string, std::vector<collision_detection::CollisionSphere>> loaded_spheres;
+  ASSERT_TRUE(collision_detection::readCollisionSpheres(stream, loaded_spheres));
+  ASSERT_EQ(loaded_spheres.size(), link_spheres.size());
+  for (const auto& link : link_spheres)
+  {
+    const auto& loaded = loaded_spheres.at(link.first);
+    ASSERT_EQ(loaded.size(), link.second.size());
+    for (std::size_t i = 0; i < loaded.size(); ++i)
+    {
+      EXPECT_TRUE(loaded[i].relative_vec_.isApprox(link.second[i].relative_vec_));
+      EXPECT_DOUBLE_EQ(loaded[i].radius_, link.second[i].radius_);
+    }
+  }
+
+  // a truncated stream is rejected and leaves the output untouched
+  std::stringstream truncated(stream.str().substr(0, stream.str().size() / 2));
+  std::map<std::string, std::vector<collision_detection::CollisionSphere>> untouched;
+  EXPECT_FALSE(collision_detection::readCollisionSpheres(truncated, untouched));
+  EXPECT_TRUE(untouched.empty());
+
+  // an environment constructed from the cached spheres reports the same collision results
+  DefaultCEnvType cached_env(robot_model_, loaded_spheres);
+  EXPECT_EQ(cached_env.getLinkCollisionSpheres().size(), link_spheres.size());
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "whole_body";
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+  cached_env.checkSelfCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, StaticWorldDistanceField)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "right_arm";
+
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  Eigen::Isometry3d pos1 = Eigen::Isometry3d::Identity();
+  pos1.translation().x() = 1.0;
+  robot_state.updateStateWithLinkAt("r_gripper_palm_link", pos1);
+
+  // voxelize the static geometry once and store it
+  cenv_->getWorld()->addToObject("static_box", std::make_shared<const shapes::Box>(.25, .25, .25), pos1);
+  std::stringstream stream;
+  ASSERT_TRUE(static_cast<const DefaultCEnvType&>(*cenv_).writeWorldDistanceField(stream));
+
+  // a new environment with an empty world collides with the loaded static geometry
+  auto static_env = std::make_shared<DefaultCEnvType>(robot_model_);
+  static_env->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+
+  ASSERT_TRUE(static_env->readStaticWorldDistanceField(stream));
+  res = collision_detection::CollisionResult();
+  static_env->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // removing an overlapping world object keeps the static geometry
+  static_env->getWorld()->addToObject("box", std::make_shared<const shapes::Box>(.25, .25, .25), pos1);
+  static_env->getWorld()->removeObject("box");
+  res = collision_detection::CollisionResult();
+  static_env->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // copies of the environment share the static geometry
+  collision_detection::CollisionEnvPtr copy =
+      std::make_shared<DefaultCEnvType>(*static_env, std::make_shared<collision_detection::World>());
+  res = collision_detection::CollisionResult();
+  copy->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  static_env->clearStaticWorldDistanceField();
+  res = collision_detection::CollisionResult();
+  static_env->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+
+  // fields of a different resolution are rejected
+  DefaultCEnvType other_env(robot_model_, std::map<std::string, std::vector<collision_detection::CollisionSphere>>(),
+                            collision_detection::DEFAULT_SIZE_X, collision_detection::DEFAULT_SIZE_Y,
+                            collision_detection::DEFAULT_SIZE_Z, Eigen::Vector3d(0, 0, 0),
+                            collision_detection::DEFAULT_USE_SIGNED_DISTANCE_FIELD, 0.05);
+  std::stringstream mismatching(stream.str());
+  EXPECT_FALSE(other_env.readStaticWorldDistanceField(mismatching));
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, BatchMatchesSingleStateChecks)
+{
+  collision_detection::CollisionRequest req;
+  req.group_name = "right_arm";
+
+  Eigen::Isometry3d box_pose = Eigen::Isometry3d::Identity();
+  box_pose.translation().x() = 1.0;
+  cenv_->getWorld()->addToObject("box", std::make_shared<const shapes::Box>(.25, .25, .25), box_pose);
+
+  // move the gripper through the box
+  std::vector<moveit::core::RobotState> robot_states;
+  for (int i = 0; i < 40; ++i)
+  {
+    moveit::core::RobotState robot_state(robot_model_);
+    robot_state.setToDefaultValues();
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.translation().x() = 0.4 + 0.03 * i;
+    robot_state.updateStateWithLinkAt("r_gripper_palm_link", pose);
+    robot_state.update();
+    robot_states.push_back(robot_state);
+  }
+  std::vector<const moveit::core::RobotState*> states;
+  for (const moveit::core::RobotState& robot_state : robot_states)
+    states.push_back(&robot_state);
+
+  std::vector<collision_detection::CollisionResult> results;
+  cenv_->checkRobotCollisionBatch(req, states, results, *acm_);
+  ASSERT_EQ(results.size(), states.size());
+
+  req.distance = true;
+  std::vector<collision_detection::CollisionResult> distance_results;
+  cenv_->checkRobotCollisionBatch(req, states, distance_results, *acm_);
+  req.distance = false;
+
+  std::size_t collisions = 0;
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::CollisionResult res;
+    cenv_->checkRobotCollision(req, res, *states[i], *acm_);
+    EXPECT_EQ(results[i].collision, res.collision) << i;
+    EXPECT_EQ(distance_results[i].collision, res.collision) << i;
+    if (res.collision)
+    {
+      ++collisions;
+      EXPECT_LT(distance_results[i].distance, 0.0) << i;
+    }
+  }
+  EXPECT_GT(collisions, 0u);
+  EXPECT_LT(collisions, states.size());
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, CopiesShareWorldDistanceField)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "right_arm";
+
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  Eigen::Isometry3d pos1 = Eigen::Isometry3d::Identity();
+  pos1.translation().x() = 1.0;
+  robot_state.updateStateWithLinkAt("r_gripper_palm_link", pos1);
+  robot_state.update();
+
+  cenv_->getWorld()->addToObject("box", std::make_shared<const shapes::Box>(.25, .25, .25), pos1);
+
+  // a copy of an unchanged world reuses the field of the original
+  collision_detection::CollisionEnvPtr copy = std::make_shared<DefaultCEnvType>(
+      static_cast<const DefaultCEnvType&>(*cenv_), std::make_shared<collision_detection::World>(*cenv_->getWorld()));
+  copy->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // moving the object in the copy leaves the original untouched
+  Eigen::Isometry3d pos2 = Eigen::Isometry3d::Identity();
+  pos2.translation().x() = -1.0;
+  copy->getWorld()->moveObject("box", pos2 * pos1.inverse());
+  res = collision_detection::CollisionResult();
+  copy->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // and the original can be modified while the copy keeps its own field
+  cenv_->getWorld()->removeObject("box");
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -40,7 +40,11 @@
 #include <moveit/macros/class_forward.h>
 #include <random_numbers/random_numbers.h>
 #include <rclcpp/rclcpp.hpp>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <Eigen/Geometry>
 
 namespace constraint_samplers
@@ -301,6 +305,48 @@ struct IKSamplingPose
       orientation_constraint_; /**< \brief Holds the orientation constraint for sampling */
 };
 
+MOVEIT_CLASS_FORWARD(IKSolutionPool);  // Defines IKSolutionPoolPtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief A bounded pool of IK solutions found for one set of goal constraints
+ *
+ * All \ref IKConstraintSampler instances configured with the same constraints message share a pool, across threads
+ * and planning requests. They use its solutions as seeds before falling back to random ones. Once the pool is full,
+ * new solutions replace the oldest ones.
+ */
+class IKSolutionPool
+{
+public:
+  explicit IKSolutionPool(std::size_t capacity);
+
+  /** \brief Get the pool shared by all samplers of the group configured with the constraints */
+  static IKSolutionPoolPtr getPool(const std::string& group_name, const moveit_msgs::msg::Constraints& constr);
+
+  /** \brief Add a solution, given in the variable order of the joint model group */
+  void add(const std::vector<double>& solution);
+
+  /** \brief Copy a random solution of the pool into solution. Returns false if the pool is empty. */
+  bool sample(random_numbers::RandomNumberGenerator& rng, std::vector<double>& solution) const;
+
+  std::size_t size() const;
+
+  std::size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  bool full() const
+  {
+    return size() >= capacity_;
+  }
+
+private:
+  const std::size_t capacity_;
+  mutable std::mutex lock_;
+  std::vector<std::vector<double>> solutions_;
+  std::size_t next_ = 0;  // the next solution to replace once the pool is full
+};
+
 MOVEIT_CLASS_FORWARD(IKConstraintSampler);  // Defines IKConstraintSamplerPtr, ConstPtr, WeakPtr... etc
 
 /**
@@ -347,6 +393,8 @@ public:
   {
   }
 
+  ~IKConstraintSampler() override;
+
   /**
    * \brief Configures the IK constraint given a constraints message.
    *
@@ -399,6 +447,38 @@ public:
    */
   bool configure(const IKSamplingPose& sp);
 
+  /**
+   * \brief Gets the pool of solutions shared by the samplers configured with the same constraints message
+   *
+   * @return The pool, or an empty shared_ptr if the sampler was configured from an \ref IKSamplingPose
+   */
+  const IKSolutionPoolPtr& getSolutionPool() const
+  {
+    return solution_pool_;
+  }
+
+  /**
+   * \brief Sets the distance around a pooled solution within which IK seeds are drawn
+   */
+  void setSeedPerturbation(double distance)
+  {
+    seed_perturbation_ = distance;
+  }
+
+  /**
+   * \brief Starts a background thread filling the solution pool, until it is full or stopSolutionProducer() is called
+   *
+   * The producer samples with its own copy of the sampler and its own instance of the IK solver. The group state
+   * validity callback is shared and hence called from the producer thread as well.
+   *
+   * @param reference_state The reference state used for transforming the sampled poses
+   * @return False if the sampler has no solution pool or is not valid
+   */
+  bool startSolutionProducer(const moveit::core::RobotState& reference_state);
+
+  /** \brief Stops the background thread started by startSolutionProducer() and waits for it to finish */
+  void stopSolutionProducer();
+
   /**
    * \brief Gets the timeout argument passed to the IK solver
    *
@@ -552,6 +632,7 @@ protected:
   bool sampleHelper(moveit::core::RobotState& state, const moveit::core::RobotState& reference_state,
                     unsigned int max_attempts, bool project);
   bool validate(moveit::core::RobotState& state) const;
+  bool configureSamplingPose(const moveit_msgs::msg::Constraints& constr);
 
   random_numbers::RandomNumberGenerator random_number_generator_; /**< \brief Random generator used by the sampler */
   IKSamplingPose sampling_pose_;                                  /**< \brief Holder for the pose used for sampling */
@@ -563,5 +644,9 @@ protected:
   bool need_eef_to_ik_tip_transform_; /**< \brief True if the tip frame of the inverse kinematic is different than the
                                         frame of the end effector */
   Eigen::Isometry3d eef_to_ik_tip_transform_; /**< \brief Holds the transformation from end effector to IK tip frame */
+  IKSolutionPoolPtr solution_pool_;           /**< \brief Solutions shared with samplers for the same constraints */
+  double seed_perturbation_ = 0.1;            /**< \brief Distance of IK seeds around pooled solutions */
+  std::thread producer_thread_;               /**< \brief Fills the solution pool in the background */
+  std::atomic<bool> stop_producer_{ false };  /**< \brief Requests the producer thread to finish */
 };
 }  // namespace constraint_samplers
@@ -0,0 +1,123 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/constraint_samplers/constraint_sampler.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/macros/class_forward.h>
+#include <random_numbers/random_numbers.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace constraint_samplers
+{
+MOVEIT_CLASS_FORWARD(PrecomputedConstraintSampler);  // Defines PrecomputedConstraintSamplerPtr, ConstPtr, WeakPtr...
+
+/**
+ * \brief A sampler drawing from a precomputed set of valid configurations of a group
+ *
+ * The states are typically those of a constraint approximation, i.e. they all satisfy some path constraints already.
+ * On configuration, the states satisfying the given constraints as well are indexed, so that sampling picks one of
+ * them at random without any rejection. If no stored state satisfies the constraints, an optional refinement sampler
+ * projects a random stored state onto them instead.
+ */
+class PrecomputedConstraintSampler : public ConstraintSampler
+{
+public:
+  /** \brief Variable values of the joint model group, one entry per stored state */
+  using StateSet = std::vector<std::vector<double>>;
+
+  /**
+   * \brief Constructor
+   *
+   * @param [in] scene The planning scene used to check the constraint
+   * @param [in] group_name The group name associated with the stored states
+   * @param [in] states The stored states, shared with the other samplers using them
+   * @param [in] refinement_sampler Sampler whose project() is used if no stored state satisfies the constraints
+   */
+  PrecomputedConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene, const std::string& group_name,
+                               std::shared_ptr<const StateSet> states,
+                               ConstraintSamplerPtr refinement_sampler = ConstraintSamplerPtr());
+
+  /**
+   * \brief Configures the sampler to produce states satisfying the constraints
+   *
+   * This checks all stored states against the constraints once. Sampling is valid if at least one state satisfies
+   * them or a refinement sampler is available.
+   */
+  bool configure(const moveit_msgs::msg::Constraints& constr) override;
+
+  /** \brief Sets a stored state satisfying the constraints, or refines a random stored state if there is none */
+  bool sample(moveit::core::RobotState& state, const moveit::core::RobotState& reference_state,
+              unsigned int max_attempts) override;
+
+  /** \brief Replaces the state by the stored state closest to it that satisfies the constraints */
+  bool project(moveit::core::RobotState& state, unsigned int max_attempts) override;
+
+  /** \brief The number of stored states satisfying the constraints the sampler was configured with */
+  std::size_t getValidStateCount() const
+  {
+    return valid_states_.size();
+  }
+
+  const std::string& getName() const override
+  {
+    static const std::string SAMPLER_NAME = "PrecomputedConstraintSampler";
+    return SAMPLER_NAME;
+  }
+
+protected:
+  void clear() override;
+
+  /** \brief Set the group variables of state to those of the stored state and check them */
+  bool setStoredState(moveit::core::RobotState& state, std::size_t index) const;
+
+  /** \brief Refine the state with the refinement sampler and check the result */
+  bool refine(moveit::core::RobotState& state, unsigned int max_attempts);
+
+  /** \brief The precomputed states */
+  std::shared_ptr<const StateSet> states_;
+  /** \brief Projects stored states onto the constraints */
+  ConstraintSamplerPtr refinement_sampler_;
+  /** \brief The constraints to satisfy */
+  kinematic_constraints::KinematicConstraintSet constraints_;
+  /** \brief Indices of the stored states satisfying constraints_ */
+  std::vector<std::size_t> valid_states_;
+  /** \brief Picks the stored states */
+  random_numbers::RandomNumberGenerator random_number_generator_;
+};
+}  // namespace constraint_samplers
@@ -37,13 +37,22 @@
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <rclcpp/serialization.hpp>
 #include <cassert>
 #include <functional>
+#include <limits>
+#include <map>
+#include <string_view>
 
 namespace constraint_samplers
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_constraint_samplers.default_constraint_samplers");
 
+// number of solutions kept per set of goal constraints
+static const std::size_t SOLUTION_POOL_CAPACITY = 100;
+// number of pools kept alive for constraint sets no sampler is configured with anymore
+static const std::size_t MAX_UNUSED_SOLUTION_POOLS = 32;
+
 bool JointConstraintSampler::configure(const moveit_msgs::msg::Constraints& constr)
 {
   // construct the constraints
@@ -230,8 +239,88 @@ IKSamplingPose::IKSamplingPose(const kinematic_constraints::PositionConstraintPt
 {
 }
 
+IKSolutionPool::IKSolutionPool(std::size_t capacity) : capacity_(capacity)
+{
+  solutions_.reserve(capacity_);
+}
+
+IKSolutionPoolPtr IKSolutionPool::getPool(const std::string& group_name, const moveit_msgs::msg::Constraints& constr)
+{
+  // the stamps change from request to request, while the constraints stay the same
+  moveit_msgs::msg::Constraints key_constr = constr;
+  for (moveit_msgs::msg::PositionConstraint& position_constraint : key_constr.position_constraints)
+    position_constraint.header.stamp = builtin_interfaces::msg::Time();
+  for (moveit_msgs::msg::OrientationConstraint& orientation_constraint : key_constr.orientation_constraints)
+    orientation_constraint.header.stamp = builtin_interfaces::msg::Time();
+
+  rclcpp::Serialization<moveit_msgs::msg::Constraints> serializer;
+  rclcpp::SerializedMessage serialized_constr;
+  serializer.serialize_message(&key_constr, &serialized_constr);
+  const rcl_serialized_message_t& buffer = serialized_constr.get_rcl_serialized_message();
+  const std::size_t key = std::hash<std::string_view>()(std::string_view(
+                              reinterpret_cast<const char*>(buffer.buffer), buffer.buffer_length)) ^
+                          std::hash<std::string>()(group_name);
+
+  static std::mutex pools_lock;
+  static std::map<std::size_t, IKSolutionPoolPtr> pools;
+  std::lock_guard<std::mutex> slock(pools_lock);
+  IKSolutionPoolPtr& pool = pools[key];
+  if (!pool)
+  {
+    pool = std::make_shared<IKSolutionPool>(SOLUTION_POOL_CAPACITY);
+
+    // forget pools nobody else refers to, once there are too many of them
+    std::size_t unused = 0;
+    for (const auto& entry : pools)
+      unused += entry.second.use_count() == 1;
+    for (auto it = pools.begin(); it != pools.end() && unused > MAX_UNUSED_SOLUTION_POOLS;)
+      if (it->first != key && it->second.use_count() == 1)
+      {
+        it = pools.erase(it);
+        --unused;
+      }
+      else
+        ++it;
+  }
+  return pool;
+}
+
+void IKSolutionPool::add(const std::vector<double>& solution)
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  if (solutions_.size() < capacity_)
+    solutions_.push_back(solution);
+  else if (capacity_ > 0)
+  {
+    solutions_[next_] = solution;
+    next_ = (next_ + 1) % capacity_;
+  }
+}
+
+bool IKSolutionPool::sample(random_numbers::RandomNumberGenerator& rng, std::vector<double>& solution) const
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  if (solutions_.empty())
+    return false;
+  solution = solutions_[rng.uniformInteger(0, solutions_.size() - 1)];
+  return true;
+}
+
+std::size_t IKSolutionPool::size() const
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  return solutions_.size();
+}
+
+IKConstraintSampler::~IKConstraintSampler()
+{
+  stopSolutionProducer();
+}
+
 void IKConstraintSampler::clear()
 {
+  stopSolutionProducer();
+  solution_pool_.reset();
   ConstraintSampler::clear();
   kb_.reset();
   ik_frame_ = "";
@@ -281,6 +370,14 @@ bool IKConstraintSampler::configure(const IKSamplingPose& sp)
 }
 
 bool IKConstraintSampler::configure(const moveit_msgs::msg::Constraints& constr)
+{
+  if (!configureSamplingPose(constr))
+    return false;
+  solution_pool_ = IKSolutionPool::getPool(jmg_->getName(), constr);
+  return true;
+}
+
+bool IKConstraintSampler::configureSamplingPose(const moveit_msgs::msg::Constraints& constr)
 {
   for (std::size_t p = 0; p < constr.position_constraints.size(); ++p)
     for (std::size_t o = 0; o < constr.orientation_constraints.size(); ++o)
@@ -617,6 +714,45 @@ bool IKConstraintSampler::sampleHelper(moveit::core::RobotState& state, const mo
   return false;
 }
 
+bool IKConstraintSampler::startSolutionProducer(const moveit::core::RobotState& reference_state)
+{
+  const moveit::core::SolverAllocatorFn& allocator = jmg_->getGroupKinematics().first.allocator_;
+  if (!is_valid_ || !solution_pool_ || !allocator)
+  {
+    RCLCPP_WARN(LOGGER, "IKConstraintSampler can only fill the solution pool when configured "
+                        "from a constraints message");
+    return false;
+  }
+  stopSolutionProducer();
+
+  auto producer = std::make_shared<IKConstraintSampler>(
+      scene_, jmg_->getName(), random_number_generator_.uniformInteger(0, std::numeric_limits<int>::max()));
+  if (!producer->configure(sampling_pose_))
+    return false;
+  producer->kb_ = allocator(jmg_);  // the producer must not share the solver with this sampler
+  if (!producer->kb_)
+    return false;
+  producer->solution_pool_ = solution_pool_;
+  producer->group_state_validity_callback_ = group_state_validity_callback_;
+  producer->ik_timeout_ = ik_timeout_;
+  producer->seed_perturbation_ = seed_perturbation_;
+
+  stop_producer_ = false;
+  producer_thread_ = std::thread([this, producer, reference = reference_state]() {
+    moveit::core::RobotState state(reference);
+    while (!stop_producer_ && !producer->solution_pool_->full())
+      producer->sample(state, reference, 1);
+  });
+  return true;
+}
+
+void IKConstraintSampler::stopSolutionProducer()
+{
+  stop_producer_ = true;
+  if (producer_thread_.joinable())
+    producer_thread_.join();
+}
+
 bool IKConstraintSampler::project(moveit::core::RobotState& state, unsigned int max_attempts)
 {
   return sampleHelper(state, state, max_attempts, true);
@@ -639,8 +775,12 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
   std::vector<double> seed(ik_joint_bijection.size(), 0.0);
   std::vector<double> vals;
 
+  std::vector<double> pooled;
   if (use_as_seed)
     state.copyJointGroupPositions(jmg_, vals);
+  else if (solution_pool_ && solution_pool_->sample(random_number_generator_, pooled))
+    // sample a seed value near a solution found before for the same constraints
+    jmg_->getVariableRandomPositionsNearBy(random_number_generator_, vals, pooled, seed_perturbation_);
   else
     // sample a seed value
     jmg_->getVariableRandomPositions(random_number_generator_, vals);
@@ -662,7 +802,11 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
       solution[ik_joint_bijection[i]] = ik_sol[i];
     state.setJointGroupPositions(jmg_, solution);
 
-    return validate(state);
+    if (!validate(state))
+      return false;
+    if (solution_pool_)
+      solution_pool_->add(solution);
+    return true;
   }
   else
   {
@@ -0,0 +1,163 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/constraint_samplers/precomputed_constraint_sampler.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <limits>
+
+namespace constraint_samplers
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_constraint_samplers.precomputed_constraint_sampler");
+
+PrecomputedConstraintSampler::PrecomputedConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene,
+                                                           const std::string& group_name,
+                                                           std::shared_ptr<const StateSet> states,
+                                                           ConstraintSamplerPtr refinement_sampler)
+  : ConstraintSampler(scene, group_name)
+  , states_(std::move(states))
+  , refinement_sampler_(std::move(refinement_sampler))
+  , constraints_(scene->getRobotModel())
+{
+}
+
+void PrecomputedConstraintSampler::clear()
+{
+  ConstraintSampler::clear();
+  constraints_.clear();
+  valid_states_.clear();
+}
+
+bool PrecomputedConstraintSampler::configure(const moveit_msgs::msg::Constraints& constr)
+{
+  clear();
+  if (!jmg_ || !states_ || states_->empty())
+    return false;
+  if (!constraints_.add(constr, scene_->getTransforms()))
+  {
+    RCLCPP_WARN(LOGGER, "Unable to configure the constraints of the precomputed constraint sampler");
+    return false;
+  }
+
+  // index the stored states satisfying the constraints, so that sampling does not need to reject any
+  moveit::core::RobotState state = scene_->getCurrentState();
+  for (std::size_t i = 0; i < states_->size(); ++i)
+  {
+    state.setJointGroupPositions(jmg_, (*states_)[i]);
+    state.update();
+    if (constraints_.satisfied(state))
+      valid_states_.push_back(i);
+  }
+  RCLCPP_DEBUG(LOGGER, "%zu of %zu precomputed states satisfy the constraints", valid_states_.size(), states_->size());
+
+  is_valid_ = !valid_states_.empty() || refinement_sampler_;
+  return is_valid_;
+}
+
+bool PrecomputedConstraintSampler::setStoredState(moveit::core::RobotState& state, std::size_t index) const
+{
+  const std::vector<double>& values = (*states_)[index];
+  state.setJointGroupPositions(jmg_, values);
+  return !group_state_validity_callback_ || group_state_validity_callback_(&state, jmg_, values.data());
+}
+
+bool PrecomputedConstraintSampler::refine(moveit::core::RobotState& state, unsigned int max_attempts)
+{
+  if (!refinement_sampler_ || !refinement_sampler_->project(state, max_attempts))
+    return false;
+  state.update();
+  if (!constraints_.satisfied(state))
+    return false;
+  if (!group_state_validity_callback_)
+    return true;
+  std::vector<double> values;
+  state.copyJointGroupPositions(jmg_, values);
+  return group_state_validity_callback_(&state, jmg_, values.data());
+}
+
+bool PrecomputedConstraintSampler::sample(moveit::core::RobotState& state,
+                                          const moveit::core::RobotState& /* reference_state */,
+                                          unsigned int max_attempts)
+{
+  if (!is_valid_)
+  {
+    RCLCPP_WARN(LOGGER, "PrecomputedConstraintSampler not configured, won't sample");
+    return false;
+  }
+
+  for (unsigned int a = 0; a < max_attempts; ++a)
+  {
+    if (!valid_states_.empty())
+    {
+      if (setStoredState(state, valid_states_[random_number_generator_.uniformInteger(0, valid_states_.size() - 1)]))
+        return true;
+    }
+    else
+    {
+      // no stored state satisfies the constraints, so start the refinement from any of them
+      state.setJointGroupPositions(jmg_, (*states_)[random_number_generator_.uniformInteger(0, states_->size() - 1)]);
+      if (refine(state, max_attempts))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool PrecomputedConstraintSampler::project(moveit::core::RobotState& state, unsigned int max_attempts)
+{
+  if (!is_valid_)
+  {
+    RCLCPP_WARN(LOGGER, "PrecomputedConstraintSampler not configured, won't project");
+    return false;
+  }
+  if (valid_states_.empty())
+    return refine(state, max_attempts);
+
+  std::vector<double> values;
+  state.copyJointGroupPositions(jmg_, values);
+  std::size_t closest = valid_states_.front();
+  double closest_distance = std::numeric_limits<double>::infinity();
+  for (std::size_t index : valid_states_)
+  {
+    const double distance = jmg_->distance(values.data(), (*states_)[index].data());
+    if (distance < closest_distance)
+    {
+      closest_distance = distance;
+      closest = index;
+    }
+  }
+  return setStoredState(state, closest);
+}
+}  // namespace constraint_samplers
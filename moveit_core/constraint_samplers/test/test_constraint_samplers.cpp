@@ -37,6 +37,7 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
+#include <moveit/constraint_samplers/precomputed_constraint_sampler.h>
 #include <moveit/constraint_samplers/union_constraint_sampler.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/constraint_samplers/constraint_sampler_tools.h>
@@ -1236,6 +1237,110 @@ TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerSeeded)
   EXPECT_FALSE((root_to_left_tool2 * root_to_left_tool3.inverse()).matrix().isIdentity(1e-7));
 }
 
+TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerSolutionPool)
+{
+  moveit_msgs::msg::Constraints constr;
+  constr.position_constraints.resize(1);
+  moveit_msgs::msg::PositionConstraint& pcm = constr.position_constraints[0];
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[0] = 0.001;
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.x = 0.55;
+  pcm.constraint_region.primitive_poses[0].position.y = 0.2;
+  pcm.constraint_region.primitive_poses[0].position.z = 1.25;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcm.weight = 1.0;
+
+  constraint_samplers::IKConstraintSampler sampler1(ps_, "left_arm");
+  ASSERT_TRUE(sampler1.configure(constr));
+  ASSERT_TRUE(sampler1.getSolutionPool());
+
+  moveit::core::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+  ks.update();
+  const std::size_t pooled = sampler1.getSolutionPool()->size();
+  ASSERT_TRUE(sampler1.sample(ks, ks, 10));
+  EXPECT_EQ(sampler1.getSolutionPool()->size(), pooled + 1);
+
+  // the same constraints of a later request share the pool
+  pcm.header.stamp.sec = 42;
+  constraint_samplers::IKConstraintSampler sampler2(ps_, "left_arm");
+  ASSERT_TRUE(sampler2.configure(constr));
+  EXPECT_EQ(sampler1.getSolutionPool(), sampler2.getSolutionPool());
+  EXPECT_TRUE(sampler2.sample(ks, ks, 10));
+  EXPECT_TRUE(sampler2.getPositionConstraint()->decide(ks).satisfied);
+
+  // different constraints do not
+  pcm.constraint_region.primitive_poses[0].position.z = 1.2;
+  constraint_samplers::IKConstraintSampler sampler3(ps_, "left_arm");
+  ASSERT_TRUE(sampler3.configure(constr));
+  EXPECT_NE(sampler1.getSolutionPool(), sampler3.getSolutionPool());
+
+  // samplers configured without a constraints message have no pool
+  constraint_samplers::IKConstraintSampler sampler4(ps_, "left_arm");
+  ASSERT_TRUE(sampler4.configure(constraint_samplers::IKSamplingPose(sampler1.getPositionConstraint())));
+  EXPECT_FALSE(sampler4.getSolutionPool());
+}
+
+TEST_F(LoadPlanningModelsPr2, PrecomputedConstraintSampler)
+{
+  const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup("left_arm");
+  moveit::core::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+
+  random_numbers::RandomNumberGenerator rng(265358);
+  auto states = std::make_shared<constraint_samplers::PrecomputedConstraintSampler::StateSet>(1000);
+  for (std::vector<double>& values : *states)
+    jmg->getVariableRandomPositions(rng, values);
+
+  moveit_msgs::msg::Constraints constr;
+  constr.joint_constraints.resize(1);
+  constr.joint_constraints[0].joint_name = "l_shoulder_pan_joint";
+  constr.joint_constraints[0].position = 0.5;
+  constr.joint_constraints[0].tolerance_above = 0.1;
+  constr.joint_constraints[0].tolerance_below = 0.1;
+  constr.joint_constraints[0].weight = 1.0;
+  kinematic_constraints::KinematicConstraintSet kset(robot_model_);
+  ASSERT_TRUE(kset.add(constr, ps_->getTransforms()));
+
+  constraint_samplers::PrecomputedConstraintSampler sampler(ps_, "left_arm", states);
+  ASSERT_TRUE(sampler.configure(constr));
+  EXPECT_GT(sampler.getValidStateCount(), 0u);
+  EXPECT_LT(sampler.getValidStateCount(), states->size());
+  for (int t = 0; t < 100; ++t)
+  {
+    ASSERT_TRUE(sampler.sample(ks, ks, 1));
+    ks.update();
+    EXPECT_TRUE(kset.decide(ks).satisfied);
+  }
+
+  // projecting picks the closest stored state satisfying the constraints
+  ks.setVariablePosition("l_shoulder_pan_joint", 0.0);
+  EXPECT_TRUE(sampler.project(ks, 1));
+  ks.update();
+  EXPECT_TRUE(kset.decide(ks).satisfied);
+
+  // without stored states satisfying the constraints, only a refinement sampler can help
+  constr.joint_constraints[0].tolerance_above = 1e-9;
+  constr.joint_constraints[0].tolerance_below = 1e-9;
+  kinematic_constraints::KinematicConstraintSet tight_kset(robot_model_);
+  ASSERT_TRUE(tight_kset.add(constr, ps_->getTransforms()));
+  EXPECT_FALSE(sampler.configure(constr));
+
+  auto refinement = std::make_shared<constraint_samplers::JointConstraintSampler>(ps_, "left_arm");
+  ASSERT_TRUE(refinement->configure(constr));
+  constraint_samplers::PrecomputedConstraintSampler refining_sampler(ps_, "left_arm", states, refinement);
+  ASSERT_TRUE(refining_sampler.configure(constr));
+  EXPECT_EQ(refining_sampler.getValidStateCount(), 0u);
+  ASSERT_TRUE(refining_sampler.sample(ks, ks, 1));
+  ks.update();
+  EXPECT_TRUE(tight_kset.decide(ks).satisfied);
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
@@ -127,6 +127,23 @@ public:
    * Return false when the controller cannot accept the trajectory. */
   virtual bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) = 0;
 
+  /** \brief Report whether updateTrajectory() is supported by the controller. */
+  virtual bool canUpdateTrajectory() const
+  {
+    return false;
+  }
+
+  /** \brief Replace the future part of the trajectory that is currently executed, without stopping the controller.
+   *
+   * The header stamp of \e trajectory is the absolute time of the trajectory start. The controller continues with the
+   * points of \e trajectory from their time on, so for a seamless transition \e trajectory should contain the points
+   * of the current segment. Like sendTrajectory(), this function call should not block.
+   * Return false when the trajectory can not be updated, which is the default. */
+  virtual bool updateTrajectory(const moveit_msgs::msg::RobotTrajectory& /*trajectory*/)
+  {
+    return false;
+  }
+
   /** \brief Cancel the execution of any motion using this controller.
    *
    * Report false if canceling is not possible.
@@ -162,10 +162,14 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] sparse_storage Whether to store the voxels block-sparse
+   * (see \ref VoxelGrid), so that memory is only allocated for the
+   * region within the maximum distance of obstacle cells.
+   *
    */
   PropagationDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
                            double origin_y, double origin_z, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, bool sparse_storage = false);
 
   /**
    * \brief Constructor based on an OcTree and bounding box
@@ -188,10 +192,13 @@ public:
    * and all obstacle cells will be assigned zero distance.  See the
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
+   *
+   * @param [in] sparse_storage Whether to store the voxels block-sparse
+   * (see \ref VoxelGrid).
    */
   PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                            const octomap::point3d& bbx_max, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, bool sparse_storage = false);
 
   /**
    * \brief Constructor that takes an istream and reads the contents
@@ -215,6 +222,14 @@ public:
    * @return
    */
   PropagationDistanceField(std::istream& stream, double max_distance, bool propagate_negative_distances = false);
+
+  /**
+   * \brief Copy constructor, duplicating the voxels of \e other so
+   * that both fields can be updated independently.
+   */
+  PropagationDistanceField(const PropagationDistanceField& other);
+  PropagationDistanceField& operator=(const PropagationDistanceField& other) = delete;
+
   /**
    * \brief Empty destructor
    *
@@ -388,7 +403,7 @@ public:
    */
   const PropDistanceFieldVoxel& getCell(int x, int y, int z) const
   {
-    return voxel_grid_->getCell(x, y, z);
+    return getVoxelGrid().getCell(x, y, z);
   }
 
   /**
@@ -411,19 +426,20 @@ public:
    */
   const PropDistanceFieldVoxel* getNearestCell(int x, int y, int z, double& dist, Eigen::Vector3i& pos) const
   {
-    const PropDistanceFieldVoxel* cell = &voxel_grid_->getCell(x, y, z);
+    const VoxelGrid<PropDistanceFieldVoxel>& voxel_grid = getVoxelGrid();
+    const PropDistanceFieldVoxel* cell = &voxel_grid.getCell(x, y, z);
     if (cell->distance_square_ > 0)
     {
       dist = sqrt_table_[cell->distance_square_];
       pos = cell->closest_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &voxel_grid.getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     if (cell->negative_distance_square_ > 0)
     {
       dist = -sqrt_table_[cell->negative_distance_square_];
       pos = cell->closest_negative_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &voxel_grid.getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     dist = 0.0;
@@ -446,9 +462,79 @@ public:
     return max_distance_sq_;
   }
 
+  /**
+   * \brief Set the number of threads used to propagate distances.
+   *
+   * Large updates are propagated in parallel by splitting the grid
+   * into slabs along the Z axis, each of which is propagated by its
+   * own thread. Updates crossing the boundary of a slab are handed
+   * to the neighboring slab, and the slabs are propagated again
+   * until no such updates remain. Small updates are always
+   * propagated by the calling thread. As the order in which voxels
+   * are visited determines which of several equidistant obstacle
+   * cells becomes the closest point of a voxel, results of parallel
+   * and single threaded propagation may differ slightly in regions
+   * where the wavefronts of different obstacles meet.
+   *
+   * @param [in] thread_count The number of threads to use. A value
+   * of 0 uses the number of hardware threads, 1 (the default)
+   * disables parallel propagation.
+   */
+  void setThreadCount(unsigned int thread_count)
+  {
+    thread_count_ = thread_count;
+  }
+
+  /**
+   * \brief Gets the number of threads used to propagate distances, as
+   * set by \ref setThreadCount.
+   */
+  unsigned int getThreadCount() const
+  {
+    return thread_count_;
+  }
+
+  /**
+   * \brief Whether voxels are stored block-sparse
+   */
+  bool isSparse() const
+  {
+    return voxel_grid_->isSparse();
+  }
+
+  /**
+   * \brief Gets the number of voxels for which memory is allocated,
+   * which is the total number of cells unless storage is sparse.
+   */
+  std::size_t getAllocatedCellCount() const
+  {
+    return voxel_grid_->getAllocatedCellCount();
+  }
+
 private:
+  /**
+   * \brief An update of a voxel that lies outside the slab being
+   * propagated, handed over to the slab containing the voxel
+   */
+  struct BoundaryUpdate
+  {
+    Eigen::Vector3i location_;
+    Eigen::Vector3i closest_point_;
+    int distance_square_;
+    int update_direction_;
+  };
+
   /** Typedef for set of integer indices */
   typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
+  /**
+   * \brief Const access to the voxel grid, which does not allocate
+   * any storage when the grid is sparse
+   */
+  const VoxelGrid<PropDistanceFieldVoxel>& getVoxelGrid() const
+  {
+    return *voxel_grid_;
+  }
+
   /**
    * \brief Initializes the field, resetting the voxel grid and
    * building a sqrt lookup table for efficiency based on
@@ -487,6 +573,25 @@ private:
    */
   void propagateNegative();
 
+  /**
+   * \brief Propagates the contents of \e bucket_queue and clears it,
+   * in parallel if enabled by \ref setThreadCount and the update is
+   * large enough. \e Distance selects whether the positive or the
+   * negative distance data of the voxels is propagated.
+   */
+  template <typename Distance>
+  void propagate(std::vector<EigenSTL::vector_Vector3i>& bucket_queue);
+
+  /**
+   * \brief Propagates the contents of \e bucket_queue within the
+   * slab [\e z_begin, \e z_end) and clears it. Updates of voxels
+   * outside the slab are not applied but appended to \e
+   * boundary_updates.
+   */
+  template <typename Distance>
+  void propagateSlab(std::vector<EigenSTL::vector_Vector3i>& bucket_queue, int z_begin, int z_end,
+                     std::vector<BoundaryUpdate>& boundary_updates);
+
   /**
    * \brief Determines distance based on actual voxel data
    *
@@ -541,6 +646,8 @@ private:
 
   bool propagate_negative_; /**< \brief Whether or not to propagate negative distances */
 
+  bool sparse_storage_ = false; /**< \brief Whether voxels are stored block-sparse */
+
   VoxelGrid<PropDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
 
   /// \brief Structure used to hold propagation frontier
@@ -558,6 +665,8 @@ private:
   double max_distance_; /**< \brief Holds maximum distance  */
   int max_distance_sq_; /**< \brief Holds maximum distance squared in cells */
 
+  unsigned int thread_count_ = 1; /**< \brief Number of threads used for propagation */
+
   std::vector<double> sqrt_table_; /**< \brief Precomputed square root table for faster distance lookups */
 
   /**
@@ -38,6 +38,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
 #include <Eigen/Core>
 #include <moveit/macros/declare_ptr.h>
 
@@ -56,6 +58,13 @@ enum Dimension
  * given resolution, where the data is supplied as a template
  * parameter.
  *
+ * Optionally, the data can be stored block-sparse: the volume is
+ * divided into bricks of BRICK_SIZE^3 cells, and the storage of a
+ * brick is only allocated once one of its cells is accessed through
+ * a non-const accessor. Cells of unallocated bricks read as the
+ * value passed to \ref reset. Memory then scales with the part of
+ * the volume that is actually written to, and neighboring cells
+ * along all three axes share cache lines.
  */
 template <typename T>
 class VoxelGrid
@@ -90,8 +99,29 @@ public:
    */
   VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
             double origin_z, T default_object);
+
+  /**
+   * \brief Constructor for the VoxelGrid, optionally using block-sparse storage.
+   *
+   * Same as the constructor above, but if \e sparse is true, storage
+   * for the volume is allocated lazily one brick at a time. All cells
+   * initially read as \e default_object.
+   */
+  VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
+            double origin_z, T default_object, bool sparse);
+
+  /**
+   * \brief Copy constructor, duplicating the storage of \e other.
+   *
+   * Only the allocated bricks of a sparse grid are copied.
+   */
+  VoxelGrid(const VoxelGrid& other);
+  VoxelGrid& operator=(const VoxelGrid& other) = delete;
   virtual ~VoxelGrid();
 
+  /** \brief Number of cells along each axis of a brick of block-sparse storage */
+  static constexpr int BRICK_SIZE = 8;
+
   /**
    * \brief Default constructor for the VoxelGrid.
    *
@@ -120,6 +150,25 @@ public:
   void resize(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
               double origin_z, T default_object);
 
+  /**
+   * \brief Resize the VoxelGrid, selecting dense or block-sparse storage.
+   *
+   * In contrast to the dense version, all cells of a sparse grid read
+   * as \e default_object after resizing.
+   */
+  void resize(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
+              double origin_z, T default_object, bool sparse);
+
+  /** \brief Whether the grid uses block-sparse storage */
+  bool isSparse() const
+  {
+    return sparse_;
+  }
+
+  /** \brief Number of cells for which storage is allocated, the total number of cells for dense grids.
+      Linear in the number of bricks for sparse grids. */
+  std::size_t getAllocatedCellCount() const;
+
   /**
    * \brief Operator that gets the value of the given location (x, y,
    * z) given the discretization of the volume.  The location
@@ -299,6 +348,28 @@ protected:
   int stride1_;            /**< \brief The step to take when stepping between consecutive X members in the 1D array */
   int stride2_; /**< \brief The step to take when stepping between consecutive Y members given an X in the 1D array */
 
+  bool sparse_;                              /**< \brief Whether storage is allocated brick by brick */
+  T sparse_object_;                          /**< \brief Value of the cells of unallocated bricks */
+  std::vector<std::unique_ptr<T[]>> bricks_; /**< \brief Storage of each brick, nullptr while unallocated */
+  int num_bricks_[3]; /**< \brief The number of bricks in each dimension (in Dimension order) */
+
+  /** \brief Number of bits of a cell index addressing the cell within its brick */
+  static constexpr int BRICK_SHIFT = 3;
+  static constexpr int BRICK_MASK = BRICK_SIZE - 1;
+  static constexpr int BRICK_CELLS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+  /** \brief Index of the brick containing the given cell, with no validity check */
+  int brickRef(int x, int y, int z) const;
+
+  /** \brief Index of the given cell within its brick */
+  int brickCellRef(int x, int y, int z) const;
+
+  /** \brief Get a cell of a sparse grid, allocating its brick if needed */
+  T& getSparseCell(int x, int y, int z);
+
+  /** \brief Get a cell of a sparse grid without allocating, returning \ref sparse_object_ for unallocated bricks */
+  const T& getSparseCell(int x, int y, int z) const;
+
   /**
    * \brief Gets the 1D index into the array, with no validity check.
    *
@@ -343,11 +414,36 @@ VoxelGrid<T>::VoxelGrid(double size_x, double size_y, double size_z, double reso
                         double origin_y, double origin_z, T default_object)
   : data_(nullptr)
 {
-  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object);
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, false);
+}
+
+template <typename T>
+VoxelGrid<T>::VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                        double origin_y, double origin_z, T default_object, bool sparse)
+  : data_(nullptr)
+{
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, sparse);
+}
+
+template <typename T>
+VoxelGrid<T>::VoxelGrid(const VoxelGrid& other) : data_(nullptr)
+{
+  resize(other.size_[DIM_X], other.size_[DIM_Y], other.size_[DIM_Z], other.resolution_, other.origin_[DIM_X],
+         other.origin_[DIM_Y], other.origin_[DIM_Z], other.default_object_, other.sparse_);
+  sparse_object_ = other.sparse_object_;
+  if (data_)
+    std::copy(other.data_, other.data_ + num_cells_total_, data_);
+  for (std::size_t i = 0; i < bricks_.size(); ++i)
+  {
+    if (!other.bricks_[i])
+      continue;
+    bricks_[i].reset(new T[BRICK_CELLS]);
+    std::copy(other.bricks_[i].get(), other.bricks_[i].get() + BRICK_CELLS, bricks_[i].get());
+  }
 }
 
 template <typename T>
-VoxelGrid<T>::VoxelGrid() : data_(nullptr)
+VoxelGrid<T>::VoxelGrid() : data_(nullptr), sparse_(false)
 {
   for (int i = DIM_X; i <= DIM_Z; ++i)
   {
@@ -355,6 +451,7 @@ VoxelGrid<T>::VoxelGrid() : data_(nullptr)
     origin_[i] = 0;
     origin_minus_[i] = 0;
     num_cells_[i] = 0;
+    num_bricks_[i] = 0;
   }
   resolution_ = 1.0;
   oo_resolution_ = 1.0 / resolution_;
@@ -366,9 +463,18 @@ VoxelGrid<T>::VoxelGrid() : data_(nullptr)
 template <typename T>
 void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double resolution, double origin_x,
                           double origin_y, double origin_z, T default_object)
+{
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, false);
+}
+
+template <typename T>
+void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                          double origin_y, double origin_z, T default_object, bool sparse)
 {
   delete[] data_;
   data_ = nullptr;
+  bricks_.clear();
+  sparse_ = sparse;
 
   size_[DIM_X] = size_x;
   size_[DIM_Y] = size_y;
@@ -394,7 +500,19 @@ void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double re
   stride2_ = num_cells_[DIM_Z];
 
   // initialize the data:
-  if (num_cells_total_ > 0)
+  if (sparse_)
+  {
+    std::size_t num_bricks_total = 1;
+    for (int i = DIM_X; i <= DIM_Z; ++i)
+    {
+      num_bricks_[i] = (num_cells_[i] + BRICK_SIZE - 1) / BRICK_SIZE;
+      num_bricks_total *= num_bricks_[i];
+    }
+    sparse_object_ = default_object;
+    if (num_cells_total_ > 0)
+      bricks_.resize(num_bricks_total);
+  }
+  else if (num_cells_total_ > 0)
     data_ = new T[num_cells_total_];
 }
 
@@ -428,6 +546,48 @@ inline int VoxelGrid<T>::ref(int x, int y, int z) const
   return x * stride1_ + y * stride2_ + z;
 }
 
+template <typename T>
+inline int VoxelGrid<T>::brickRef(int x, int y, int z) const
+{
+  return ((x >> BRICK_SHIFT) * num_bricks_[DIM_Y] + (y >> BRICK_SHIFT)) * num_bricks_[DIM_Z] + (z >> BRICK_SHIFT);
+}
+
+template <typename T>
+inline int VoxelGrid<T>::brickCellRef(int x, int y, int z) const
+{
+  return ((x & BRICK_MASK) << (2 * BRICK_SHIFT)) | ((y & BRICK_MASK) << BRICK_SHIFT) | (z & BRICK_MASK);
+}
+
+template <typename T>
+T& VoxelGrid<T>::getSparseCell(int x, int y, int z)
+{
+  std::unique_ptr<T[]>& brick = bricks_[brickRef(x, y, z)];
+  if (!brick)
+  {
+    brick.reset(new T[BRICK_CELLS]);
+    std::fill(brick.get(), brick.get() + BRICK_CELLS, sparse_object_);
+  }
+  return brick[brickCellRef(x, y, z)];
+}
+
+template <typename T>
+inline const T& VoxelGrid<T>::getSparseCell(int x, int y, int z) const
+{
+  if (!isCellValid(x, y, z))
+    return sparse_object_;
+  const std::unique_ptr<T[]>& brick = bricks_[brickRef(x, y, z)];
+  return brick ? brick[brickCellRef(x, y, z)] : sparse_object_;
+}
+
+template <typename T>
+std::size_t VoxelGrid<T>::getAllocatedCellCount() const
+{
+  if (!sparse_)
+    return num_cells_total_;
+  return BRICK_CELLS * std::count_if(bricks_.begin(), bricks_.end(),
+                                     [](const std::unique_ptr<T[]>& brick) { return static_cast<bool>(brick); });
+}
+
 template <typename T>
 inline double VoxelGrid<T>::getSize(Dimension dim) const
 {
@@ -478,37 +638,41 @@ inline const T& VoxelGrid<T>::operator()(const Eigen::Vector3d& pos) const
 template <typename T>
 inline T& VoxelGrid<T>::getCell(int x, int y, int z)
 {
+  if (sparse_)
+    return getSparseCell(x, y, z);
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(int x, int y, int z) const
 {
+  if (sparse_)
+    return getSparseCell(x, y, z);
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos)
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos) const
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(int x, int y, int z, const T& obj)
 {
-  data_[ref(x, y, z)] = obj;
+  getCell(x, y, z) = obj;
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(const Eigen::Vector3i& pos, const T& obj)
 {
-  data_[ref(pos.x(), pos.y(), pos.z())] = obj;
+  getCell(pos.x(), pos.y(), pos.z()) = obj;
 }
 
 template <typename T>
@@ -540,6 +704,14 @@ inline double VoxelGrid<T>::getLocationFromCell(Dimension dim, int cell) const
 template <typename T>
 inline void VoxelGrid<T>::reset(const T& initial)
 {
+  if (sparse_)
+  {
+    // releasing all bricks makes every cell read as the initial value
+    for (std::unique_ptr<T[]>& brick : bricks_)
+      brick.reset();
+    sparse_object_ = initial;
+    return;
+  }
   std::fill(data_, data_ + num_cells_total_, initial);
 }
 
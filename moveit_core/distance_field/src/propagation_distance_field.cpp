@@ -41,17 +41,63 @@
 #include <boost/iostreams/filter/zlib.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <thread>
 
 namespace distance_field
 {
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_distance_field.propagation_distance_field");
 
+// Minimum number of voxels in the Z direction of a slab propagated by a single thread
+static const int MIN_SLAB_CELLS = 16;
+
+// Minimum number of queued voxels for which propagation is parallelized
+static const std::size_t MIN_PARALLEL_SEEDS = 1024;
+
+namespace
+{
+// Accessors to the positive distance data of a voxel
+struct PositiveDistance
+{
+  static int& distanceSquare(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.distance_square_;
+  }
+  static Eigen::Vector3i& closestPoint(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.closest_point_;
+  }
+  static int& updateDirection(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.update_direction_;
+  }
+};
+
+// Accessors to the negative distance data of a voxel
+struct NegativeDistance
+{
+  static int& distanceSquare(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.negative_distance_square_;
+  }
+  static Eigen::Vector3i& closestPoint(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.closest_negative_point_;
+  }
+  static int& updateDirection(PropDistanceFieldVoxel& voxel)
+  {
+    return voxel.negative_update_direction_;
+  }
+};
+}  // namespace
+
 PropagationDistanceField::PropagationDistanceField(double size_x, double size_y, double size_z, double resolution,
                                                    double origin_x, double origin_y, double origin_z,
-                                                   double max_distance, bool propagate_negative)
+                                                   double max_distance, bool propagate_negative, bool sparse_storage)
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
+  , sparse_storage_(sparse_storage)
   , max_distance_(max_distance)
 {
   initialize();
@@ -59,10 +105,11 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
 
 PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                                                    const octomap::point3d& bbx_max, double max_distance,
-                                                   bool propagate_negative_distances)
+                                                   bool propagate_negative_distances, bool sparse_storage)
   : DistanceField(bbx_max.x() - bbx_min.x(), bbx_max.y() - bbx_min.y(), bbx_max.z() - bbx_min.z(),
                   octree.getResolution(), bbx_min.x(), bbx_min.y(), bbx_min.z())
   , propagate_negative_(propagate_negative_distances)
+  , sparse_storage_(sparse_storage)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
 {
@@ -77,12 +124,29 @@ PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_
   readFromStream(is);
 }
 
+PropagationDistanceField::PropagationDistanceField(const PropagationDistanceField& other)
+  : DistanceField(other)
+  , propagate_negative_(other.propagate_negative_)
+  , sparse_storage_(other.sparse_storage_)
+  , voxel_grid_(std::make_shared<VoxelGrid<PropDistanceFieldVoxel>>(*other.voxel_grid_))
+  , bucket_queue_(other.bucket_queue_)
+  , negative_bucket_queue_(other.negative_bucket_queue_)
+  , max_distance_(other.max_distance_)
+  , max_distance_sq_(other.max_distance_sq_)
+  , thread_count_(other.thread_count_)
+  , sqrt_table_(other.sqrt_table_)
+  , neighborhoods_(other.neighborhoods_)
+  , direction_number_to_direction_(other.direction_number_to_direction_)
+{
+}
+
 void PropagationDistanceField::initialize()
 {
   max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
-  voxel_grid_ =
-      std::make_shared<VoxelGrid<PropDistanceFieldVoxel>>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_,
-                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0));
+  voxel_grid_ = std::make_shared<VoxelGrid<PropDistanceFieldVoxel>>(size_x_, size_y_, size_z_, resolution_, origin_x_,
+                                                                    origin_y_, origin_z_,
+                                                                    PropDistanceFieldVoxel(max_distance_sq_, 0),
+                                                                    sparse_storage_);
 
   initNeighborhoods();
 
@@ -219,7 +283,8 @@ void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vecto
   EigenSTL::vector_Vector3i negative_stack;
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    // the stack only grows with the region affected by the update, so reserving the whole grid is not needed
+    negative_stack.reserve(voxel_points.size());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -301,11 +366,12 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
   EigenSTL::vector_Vector3i negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
 
-  stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+  // the stacks only grow with the region affected by the update, so reserving the whole grid is not needed
+  stack.reserve(voxel_points.size());
   bucket_queue_[0].reserve(voxel_points.size());
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    negative_stack.reserve(voxel_points.size());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -383,70 +449,108 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
 
 void PropagationDistanceField::propagatePositive()
 {
-  // now process the queue:
-  for (unsigned int i = 0; i < bucket_queue_.size(); ++i)
-  {
-    EigenSTL::vector_Vector3i::iterator list_it = bucket_queue_[i].begin();
-    EigenSTL::vector_Vector3i::iterator list_end = bucket_queue_[i].end();
-    for (; list_it != list_end; ++list_it)
-    {
-      const Eigen::Vector3i& loc = *list_it;
-      PropDistanceFieldVoxel* vptr = &voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+  propagate<PositiveDistance>(bucket_queue_);
+}
 
-      // select the neighborhood list based on the update direction:
-      EigenSTL::vector_Vector3i* neighborhood;
-      int d = i;
-      if (d > 1)
-        d = 1;
+void PropagationDistanceField::propagateNegative()
+{
+  propagate<NegativeDistance>(negative_bucket_queue_);
+}
 
-      // This will never happen.  update_direction_ is always set before voxel is added to bucket queue.
-      if (vptr->update_direction_ < 0 || vptr->update_direction_ > 26)
-      {
-        RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", vptr->update_direction_);
-        continue;
-      }
+template <typename Distance>
+void PropagationDistanceField::propagate(std::vector<EigenSTL::vector_Vector3i>& bucket_queue)
+{
+  std::vector<BoundaryUpdate> boundary_updates;
 
-      neighborhood = &neighborhoods_[d][vptr->update_direction_];
+  // slabs need to be considerably thicker than the propagation distance, otherwise most updates cross boundaries
+  const int z_cells = getZNumCells();
+  const int min_slab_cells = std::max(MIN_SLAB_CELLS, 2 * static_cast<int>(ceil(max_distance_ / resolution_)));
+  unsigned int slab_count = thread_count_ ? thread_count_ : std::max(1u, std::thread::hardware_concurrency());
+  slab_count = std::min(slab_count, static_cast<unsigned int>(std::max(1, z_cells / min_slab_cells)));
 
-      for (const Eigen::Vector3i& diff : *neighborhood)
-      {
-        Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
-        if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
-          continue;
+  std::size_t seed_count = 0;
+  for (const EigenSTL::vector_Vector3i& bucket : bucket_queue)
+    seed_count += bucket.size();
 
-        // the real update code:
-        // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
-        int new_distance_sq = (vptr->closest_point_ - nloc).squaredNorm();
-        if (new_distance_sq > max_distance_sq_)
-          continue;
+  if (slab_count <= 1 || seed_count < MIN_PARALLEL_SEEDS)
+  {
+    propagateSlab<Distance>(bucket_queue, 0, z_cells, boundary_updates);
+    return;
+  }
 
-        if (new_distance_sq < neighbor->distance_square_)
-        {
-          // update the neighboring voxel
-          neighbor->distance_square_ = new_distance_sq;
-          neighbor->closest_point_ = vptr->closest_point_;
-          neighbor->update_direction_ = getDirectionNumber(diff.x(), diff.y(), diff.z());
+  // slab i covers [slab_begin[i], slab_begin[i + 1]). Boundaries are aligned to bricks, so that threads never
+  // allocate the same brick of a sparse grid
+  std::vector<int> slab_begin(slab_count + 1);
+  for (unsigned int i = 0; i <= slab_count; ++i)
+  {
+    const int begin = (i * z_cells + slab_count - 1) / slab_count;
+    slab_begin[i] = std::min(z_cells, begin - begin % VoxelGrid<PropDistanceFieldVoxel>::BRICK_SIZE);
+  }
+  slab_begin[slab_count] = z_cells;
+  const auto slab_of = [&slab_begin](int z) {
+    return std::upper_bound(slab_begin.begin(), slab_begin.end(), z) - slab_begin.begin() - 1;
+  };
+
+  std::vector<std::vector<EigenSTL::vector_Vector3i>> slab_queues(
+      slab_count, std::vector<EigenSTL::vector_Vector3i>(bucket_queue.size()));
+  for (std::size_t i = 0; i < bucket_queue.size(); ++i)
+  {
+    for (const Eigen::Vector3i& loc : bucket_queue[i])
+      slab_queues[slab_of(loc.z())][i].push_back(loc);
+    bucket_queue[i].clear();
+  }
 
-          // and put it in the queue:
-          bucket_queue_[new_distance_sq].push_back(nloc);
+  std::vector<std::vector<BoundaryUpdate>> slab_boundary_updates(slab_count);
+  std::vector<std::thread> threads;
+  threads.reserve(slab_count);
+  bool pending = true;
+  while (pending)
+  {
+    // each thread only reads and writes voxels of its own slab
+    for (unsigned int i = 0; i < slab_count; ++i)
+    {
+      threads.emplace_back([this, i, &slab_queues, &slab_begin, &slab_boundary_updates] {
+        propagateSlab<Distance>(slab_queues[i], slab_begin[i], slab_begin[i + 1], slab_boundary_updates[i]);
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+    threads.clear();
+
+    // apply the updates which crossed a slab boundary and propagate them in the next round
+    pending = false;
+    for (std::vector<BoundaryUpdate>& updates : slab_boundary_updates)
+    {
+      for (const BoundaryUpdate& update : updates)
+      {
+        const Eigen::Vector3i& loc = update.location_;
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+        if (update.distance_square_ < Distance::distanceSquare(voxel))
+        {
+          Distance::distanceSquare(voxel) = update.distance_square_;
+          Distance::closestPoint(voxel) = update.closest_point_;
+          Distance::updateDirection(voxel) = update.update_direction_;
+          slab_queues[slab_of(loc.z())][update.distance_square_].push_back(loc);
+          pending = true;
         }
       }
+      updates.clear();
     }
-    bucket_queue_[i].clear();
   }
 }
 
-void PropagationDistanceField::propagateNegative()
+template <typename Distance>
+void PropagationDistanceField::propagateSlab(std::vector<EigenSTL::vector_Vector3i>& bucket_queue, int z_begin,
+                                             int z_end, std::vector<BoundaryUpdate>& boundary_updates)
 {
   // now process the queue:
-  for (unsigned int i = 0; i < negative_bucket_queue_.size(); ++i)
+  for (unsigned int i = 0; i < bucket_queue.size(); ++i)
   {
-    EigenSTL::vector_Vector3i::iterator list_it = negative_bucket_queue_[i].begin();
-    EigenSTL::vector_Vector3i::iterator list_end = negative_bucket_queue_[i].end();
-    for (; list_it != list_end; ++list_it)
+    // voxels may be appended to the bucket being processed, so it is traversed by index
+    EigenSTL::vector_Vector3i& bucket = bucket_queue[i];
+    for (std::size_t j = 0; j < bucket.size(); ++j)
     {
-      const Eigen::Vector3i& loc = *list_it;
+      const Eigen::Vector3i loc = bucket[j];
       PropDistanceFieldVoxel* vptr = &voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
 
       // select the neighborhood list based on the update direction:
@@ -455,15 +559,15 @@ void PropagationDistanceField::propagateNegative()
       if (d > 1)
         d = 1;
 
-      // This will never happen.  negative_update_direction_ is always set before voxel is added to
-      // negative_bucket_queue_.
-      if (vptr->negative_update_direction_ < 0 || vptr->negative_update_direction_ > 26)
+      // This will never happen.  The update direction is always set before voxel is added to the bucket queue.
+      const int update_direction = Distance::updateDirection(*vptr);
+      if (update_direction < 0 || update_direction > 26)
       {
-        RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", vptr->update_direction_);
+        RCLCPP_ERROR(LOGGER, "PROGRAMMING ERROR: Invalid update direction detected: %d", update_direction);
         continue;
       }
 
-      neighborhood = &neighborhoods_[d][vptr->negative_update_direction_];
+      neighborhood = &neighborhoods_[d][update_direction];
 
       for (const Eigen::Vector3i& diff : *neighborhood)
       {
@@ -473,33 +577,45 @@ void PropagationDistanceField::propagateNegative()
 
         // the real update code:
         // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
-        int new_distance_sq = (vptr->closest_negative_point_ - nloc).squaredNorm();
+        const Eigen::Vector3i& closest_point = Distance::closestPoint(*vptr);
+        int new_distance_sq = (closest_point - nloc).squaredNorm();
         if (new_distance_sq > max_distance_sq_)
           continue;
-        // std::cout << "Looking at " << nloc.x() << " " << nloc.y() << " " << nloc.z() << " " << new_distance_sq << " "
-        // << neighbor->negative_distance_square_ << '\n';
-        if (new_distance_sq < neighbor->negative_distance_square_)
+
+        if (nloc.z() < z_begin || nloc.z() >= z_end)
+        {
+          // the neighbor is owned by another slab
+          boundary_updates.push_back(
+              { nloc, closest_point, new_distance_sq, getDirectionNumber(diff.x(), diff.y(), diff.z()) });
+          continue;
+        }
+
+        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
+        if (new_distance_sq < Distance::distanceSquare(*neighbor))
         {
-          // std::cout << "Updating " << nloc.x() << " " << nloc.y() << " " << nloc.z() << " " << new_distance_sq <<
-          // '\n';
           // update the neighboring voxel
-          neighbor->negative_distance_square_ = new_distance_sq;
-          neighbor->closest_negative_point_ = vptr->closest_negative_point_;
-          neighbor->negative_update_direction_ = getDirectionNumber(diff.x(), diff.y(), diff.z());
+          Distance::distanceSquare(*neighbor) = new_distance_sq;
+          Distance::closestPoint(*neighbor) = closest_point;
+          Distance::updateDirection(*neighbor) = getDirectionNumber(diff.x(), diff.y(), diff.z());
 
           // and put it in the queue:
-          negative_bucket_queue_[new_distance_sq].push_back(nloc);
+          bucket_queue[new_distance_sq].push_back(nloc);
         }
       }
     }
-    negative_bucket_queue_[i].clear();
+    bucket.clear();
   }
 }
 
 void PropagationDistanceField::reset()
 {
   voxel_grid_->reset(PropDistanceFieldVoxel(max_distance_sq_, 0));
+
+  // An uninitialized closest negative point is treated as the cell itself everywhere, so sparse grids don't need to
+  // touch (and allocate) every cell here
+  if (sparse_storage_)
+    return;
+
   for (int x = 0; x < getXNumCells(); ++x)
   {
     for (int y = 0; y < getYNumCells(); ++y)
@@ -592,7 +708,7 @@ double PropagationDistanceField::getDistance(double x, double y, double z) const
 
 double PropagationDistanceField::getDistance(int x, int y, int z) const
 {
-  return getDistance(voxel_grid_->getCell(x, y, z));
+  return getDistance(getVoxelGrid().getCell(x, y, z));
 }
 
 bool PropagationDistanceField::isCellValid(int x, int y, int z) const
@@ -43,6 +43,8 @@
 #include <tf2_eigen/tf2_eigen.hpp>
 #include <octomap/octomap.h>
 #include <memory>
+#include <random>
+#include <sstream>
 
 using namespace distance_field;
 
@@ -595,6 +597,118 @@ TEST(TestSignedPropagationDistanceField, TestSignedAddRemovePoints)
   }
 }
 
+TEST(TestSignedPropagationDistanceField, TestParallelPropagation)
+{
+  PropagationDistanceField serial_df(1.0, 1.0, 2.0, 0.02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, 0.1, true);
+  PropagationDistanceField parallel_df(1.0, 1.0, 2.0, 0.02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, 0.1, true);
+  parallel_df.setThreadCount(4);
+  EXPECT_EQ(parallel_df.getThreadCount(), 4u);
+
+  // enough points for the update to be propagated in parallel
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> xy(0.0, 1.0);
+  std::uniform_real_distribution<double> z(0.0, 2.0);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int i = 0; i < 3000; ++i)
+    points.push_back(Eigen::Vector3d(xy(rng), xy(rng), z(rng)));
+
+  const auto count_differences = [&] {
+    EXPECT_EQ(countOccupiedCells(serial_df), countOccupiedCells(parallel_df));
+    unsigned int differences = 0;
+    for (int x = 0; x < serial_df.getXNumCells(); ++x)
+    {
+      for (int y = 0; y < serial_df.getYNumCells(); ++y)
+      {
+        for (int z = 0; z < serial_df.getZNumCells(); ++z)
+        {
+          const PropDistanceFieldVoxel& serial_cell = serial_df.getCell(x, y, z);
+          const PropDistanceFieldVoxel& parallel_cell = parallel_df.getCell(x, y, z);
+          EXPECT_EQ(serial_cell.distance_square_ == 0, parallel_cell.distance_square_ == 0);
+          if (serial_cell.distance_square_ != parallel_cell.distance_square_ ||
+              serial_cell.negative_distance_square_ != parallel_cell.negative_distance_square_)
+            ++differences;
+        }
+      }
+    }
+    return differences;
+  };
+
+  // the closest point of cells between equidistant obstacles depends on the order of propagation,
+  // so only a tiny fraction of cells may differ
+  const unsigned int max_differences = serial_df.getXNumCells() * serial_df.getYNumCells() *
+                                       serial_df.getZNumCells() / 1000;
+
+  serial_df.addPointsToField(points);
+  parallel_df.addPointsToField(points);
+  EXPECT_LE(count_differences(), max_differences);
+
+  EigenSTL::vector_Vector3d removed(points.begin(), points.begin() + points.size() / 2);
+  serial_df.removePointsFromField(removed);
+  parallel_df.removePointsFromField(removed);
+  EXPECT_LE(count_differences(), max_differences);
+  check_distance_field(parallel_df, EigenSTL::vector_Vector3d(points.begin() + points.size() / 2, points.end()),
+                       parallel_df.getXNumCells(), parallel_df.getYNumCells(), parallel_df.getZNumCells(), true);
+}
+
+TEST(TestSignedPropagationDistanceField, TestSparseStorage)
+{
+  PropagationDistanceField dense_df(2.0, 2.0, 2.0, 0.02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, 0.1, true);
+  PropagationDistanceField sparse_df(2.0, 2.0, 2.0, 0.02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, 0.1, true, true);
+  ASSERT_FALSE(dense_df.isSparse());
+  ASSERT_TRUE(sparse_df.isSparse());
+  EXPECT_EQ(sparse_df.getAllocatedCellCount(), 0u);
+
+  // a plate and a pole, covering only a small part of the volume
+  EigenSTL::vector_Vector3d points;
+  for (double x = 0.5; x < 0.8; x += 0.01)
+  {
+    for (double y = 0.5; y < 0.8; y += 0.01)
+      points.push_back(Eigen::Vector3d(x, y, 1.0));
+  }
+  for (double z = 0.1; z < 1.9; z += 0.01)
+    points.push_back(Eigen::Vector3d(1.5, 1.5, z));
+
+  const auto expect_equal_fields = [&] {
+    EXPECT_TRUE(areDistanceFieldsDistancesEqual(dense_df, sparse_df));
+    Eigen::Vector3d dense_gradient, sparse_gradient;
+    bool dense_in_bounds, sparse_in_bounds;
+    for (double z = 0.8; z < 1.2; z += 0.05)
+    {
+      EXPECT_EQ(dense_df.getDistanceGradient(0.65, 0.65, z, dense_gradient.x(), dense_gradient.y(),
+                                             dense_gradient.z(), dense_in_bounds),
+                sparse_df.getDistanceGradient(0.65, 0.65, z, sparse_gradient.x(), sparse_gradient.y(),
+                                              sparse_gradient.z(), sparse_in_bounds));
+      EXPECT_LT((dense_gradient - sparse_gradient).norm(), 1e-9);
+    }
+  };
+
+  dense_df.addPointsToField(points);
+  sparse_df.addPointsToField(points);
+  expect_equal_fields();
+
+  // only the region within the maximum distance of obstacles is allocated
+  EXPECT_GT(sparse_df.getAllocatedCellCount(), 0u);
+  EXPECT_LT(sparse_df.getAllocatedCellCount(), dense_df.getAllocatedCellCount() / 10);
+
+  EigenSTL::vector_Vector3d removed(points.begin(), points.begin() + points.size() / 3);
+  dense_df.removePointsFromField(removed);
+  sparse_df.removePointsFromField(removed);
+
+  // queries don't allocate
+  const std::size_t allocated_cells = sparse_df.getAllocatedCellCount();
+  expect_equal_fields();
+  EXPECT_EQ(allocated_cells, sparse_df.getAllocatedCellCount());
+
+  // both serialize identically
+  std::stringstream dense_stream, sparse_stream;
+  ASSERT_TRUE(dense_df.writeToStream(dense_stream));
+  ASSERT_TRUE(sparse_df.writeToStream(sparse_stream));
+  EXPECT_EQ(dense_stream.str(), sparse_stream.str());
+
+  sparse_df.reset();
+  EXPECT_EQ(sparse_df.getAllocatedCellCount(), 0u);
+}
+
 TEST(TestSignedPropagationDistanceField, TestShape)
 {
   PropagationDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
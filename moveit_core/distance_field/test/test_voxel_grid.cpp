@@ -95,6 +95,72 @@ TEST(TestVoxelGrid, TestReadWrite)
       }
 }
 
+TEST(TestVoxelGrid, TestSparseReadWrite)
+{
+  int def = -100;
+  VoxelGrid<int> vg(0.2, 0.3, 0.25, 0.01, 0, 0, 0, def, true);
+  const VoxelGrid<int>& const_vg = vg;
+  ASSERT_TRUE(vg.isSparse());
+  EXPECT_EQ(vg.getNumCells(DIM_X), 20);
+  EXPECT_EQ(vg.getNumCells(DIM_Y), 30);
+  EXPECT_EQ(vg.getNumCells(DIM_Z), 25);
+
+  // all cells read as the default without allocating anything
+  EXPECT_EQ(const_vg.getCell(0, 0, 0), def);
+  EXPECT_EQ(const_vg.getCell(19, 29, 24), def);
+  EXPECT_EQ(vg.getAllocatedCellCount(), 0u);
+
+  // writing a cell allocates exactly its brick
+  vg.getCell(9, 17, 24) = 5;
+  vg.setCell(Eigen::Vector3i(8, 16, 24), 6);
+  EXPECT_EQ(vg.getAllocatedCellCount(), static_cast<std::size_t>(VoxelGrid<int>::BRICK_SIZE *
+                                                                 VoxelGrid<int>::BRICK_SIZE *
+                                                                 VoxelGrid<int>::BRICK_SIZE));
+  EXPECT_EQ(const_vg.getCell(9, 17, 24), 5);
+  EXPECT_EQ(const_vg.getCell(8, 16, 24), 6);
+  EXPECT_EQ(const_vg.getCell(9, 16, 24), def);
+  EXPECT_EQ(const_vg.getCell(9, 17, 23), def);
+  EXPECT_EQ(const_vg(0.09, 0.17, 0.24), 5);
+
+  // set every cell, including those of partial bricks at the upper bounds
+  int i = 0;
+  for (int x = 0; x < vg.getNumCells(DIM_X); ++x)
+    for (int y = 0; y < vg.getNumCells(DIM_Y); ++y)
+      for (int z = 0; z < vg.getNumCells(DIM_Z); ++z)
+        vg.getCell(x, y, z) = i++;
+  i = 0;
+  for (int x = 0; x < vg.getNumCells(DIM_X); ++x)
+    for (int y = 0; y < vg.getNumCells(DIM_Y); ++y)
+      for (int z = 0; z < vg.getNumCells(DIM_Z); ++z)
+        EXPECT_EQ(const_vg.getCell(x, y, z), i++);
+
+  // resetting releases all storage
+  vg.reset(7);
+  EXPECT_EQ(vg.getAllocatedCellCount(), 0u);
+  EXPECT_EQ(const_vg.getCell(3, 4, 5), 7);
+}
+
+TEST(TestVoxelGrid, TestCopy)
+{
+  int def = -100;
+  for (bool sparse : { false, true })
+  {
+    VoxelGrid<int> vg(0.2, 0.3, 0.25, 0.01, 0, 0, 0, def, sparse);
+    vg.getCell(9, 17, 24) = 5;
+
+    // the copy owns its storage
+    VoxelGrid<int> copy(vg);
+    const VoxelGrid<int>& const_copy = copy;
+    EXPECT_EQ(copy.isSparse(), sparse);
+    EXPECT_EQ(copy.getNumCells(DIM_X), 20);
+    EXPECT_EQ(copy.getAllocatedCellCount(), vg.getAllocatedCellCount());
+    EXPECT_EQ(const_copy.getCell(9, 17, 24), 5);
+    vg.getCell(9, 17, 24) = 6;
+    EXPECT_EQ(const_copy.getCell(9, 17, 24), 5);
+    EXPECT_EQ(const_copy(-1.0, 0, 0), def);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -41,6 +41,7 @@
 #include <kdl/chainidsolver_recursive_newton_euler.hpp>
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <geometry_msgs/msg/vector3.hpp>
 #include <geometry_msgs/msg/wrench.hpp>
 #include <memory>
@@ -87,6 +88,32 @@ public:
                   const std::vector<double>& joint_accelerations,
                   const std::vector<geometry_msgs::msg::Wrench>& wrenches, std::vector<double>& torques) const;
 
+  /**
+   * @brief Get the torques for all waypoints at once
+   *
+   * Each column of the input matrices is one waypoint, with rows in the order of the joints of this group in the
+   * RobotModel. No external wrenches act on the links, except for an optional payload attached to the origin of the
+   * last link of the group, as in getPayloadTorques(). All waypoints share preallocated workspaces, one per thread.
+   * @param joint_angles The joint angles, with one row per joint in the group
+   * @param joint_velocities The joint velocities, of the same size as joint_angles
+   * @param joint_accelerations The joint accelerations, of the same size as joint_angles
+   * @param torques Resized to the size of joint_angles and filled with the torques of each waypoint
+   * @param payload The payload for which to compute torques (in kg)
+   * @param thread_count The number of threads evaluating the waypoints; 0 uses all hardware threads
+   * @return False if any of the input matrices are of the wrong size or the torques could not be computed
+   */
+  bool getTorquesForTrajectory(const Eigen::MatrixXd& joint_angles, const Eigen::MatrixXd& joint_velocities,
+                               const Eigen::MatrixXd& joint_accelerations, Eigen::MatrixXd& torques,
+                               double payload = 0.0, unsigned int thread_count = 1) const;
+
+  /**
+   * @brief Get the torques for the positions, velocities and accelerations of the group at all trajectory waypoints
+   *
+   * See getTorquesForTrajectory() for matrices. Variables missing from the waypoints are taken as zero.
+   */
+  bool getTorquesForTrajectory(const robot_trajectory::RobotTrajectory& trajectory, Eigen::MatrixXd& torques,
+                               double payload = 0.0, unsigned int thread_count = 1) const;
+
   /**
    * @brief Get the maximum payload for this group (in kg). Payload is
    * the weight that this group can hold when the weight is attached to the origin
@@ -134,7 +161,15 @@ public:
   }
 
 private:
+  struct Workspace;
+
+  /** @brief Compute the torques of the waypoints [begin, end) on the given workspace */
+  bool computeTorques(Workspace& workspace, const Eigen::MatrixXd& joint_angles,
+                      const Eigen::MatrixXd& joint_velocities, const Eigen::MatrixXd& joint_accelerations,
+                      Eigen::MatrixXd& torques, double payload, Eigen::Index begin, Eigen::Index end) const;
+
   std::shared_ptr<KDL::ChainIdSolver_RNE> chain_id_solver_;  // KDL chain inverse dynamics
+  KDL::Vector gravity_vector_;                               // gravity passed in initialize()
   KDL::Chain kdl_chain_;                                     // KDL chain
 
   moveit::core::RobotModelConstPtr robot_model_;
@@ -41,6 +41,8 @@
 #include <kdl/tree.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <thread>
 
 namespace dynamics_solver
 {
@@ -65,6 +67,27 @@ inline geometry_msgs::msg::Vector3 transformVector(const Eigen::Isometry3d& tran
 }
 }  // namespace
 
+// Buffers for computing the torques of many waypoints without allocating for each of them
+struct DynamicsSolver::Workspace
+{
+  Workspace(const KDL::Chain& chain, const KDL::Vector& gravity, const moveit::core::RobotModelConstPtr& robot_model)
+    : id_solver(chain, gravity)
+    , angles(chain.getNrOfJoints())
+    , velocities(chain.getNrOfJoints())
+    , accelerations(chain.getNrOfJoints())
+    , torques(chain.getNrOfJoints())
+    , wrenches(chain.getNrOfSegments(), KDL::Wrench::Zero())
+    , state(robot_model)
+  {
+    state.setToDefaultValues();
+  }
+
+  KDL::ChainIdSolver_RNE id_solver;  // keeps internal buffers, so every workspace needs its own
+  KDL::JntArray angles, velocities, accelerations, torques;
+  KDL::Wrenches wrenches;
+  moveit::core::RobotState state;  // for transforming the payload into the tip frame
+};
+
 DynamicsSolver::DynamicsSolver(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group_name,
                                const geometry_msgs::msg::Vector3& gravity_vector)
 {
@@ -135,6 +158,7 @@ DynamicsSolver::DynamicsSolver(const moveit::core::RobotModelConstPtr& robot_mod
   KDL::Vector gravity(gravity_vector.x, gravity_vector.y,
                       gravity_vector.z);  // \todo Not sure if KDL expects the negative of this (Sachin)
   gravity_ = gravity.Norm();
+  gravity_vector_ = gravity;
   RCLCPP_DEBUG(LOGGER, "Gravity norm set to %f", gravity_);
 
   chain_id_solver_ = std::make_shared<KDL::ChainIdSolver_RNE>(kdl_chain_, gravity);
@@ -312,6 +336,120 @@ bool DynamicsSolver::getPayloadTorques(const std::vector<double>& joint_angles,
   return getTorques(joint_angles, joint_velocities, joint_accelerations, wrenches, joint_torques);
 }
 
+bool DynamicsSolver::computeTorques(Workspace& workspace, const Eigen::MatrixXd& joint_angles,
+                                    const Eigen::MatrixXd& joint_velocities,
+                                    const Eigen::MatrixXd& joint_accelerations, Eigen::MatrixXd& torques,
+                                    double payload, Eigen::Index begin, Eigen::Index end) const
+{
+  for (Eigen::Index waypoint = begin; waypoint < end; ++waypoint)
+  {
+    workspace.angles.data = joint_angles.col(waypoint);
+    workspace.velocities.data = joint_velocities.col(waypoint);
+    workspace.accelerations.data = joint_accelerations.col(waypoint);
+
+    if (payload != 0.0)
+    {
+      workspace.state.setJointGroupPositions(joint_model_group_, joint_angles.col(waypoint).data());
+      // transform the weight of the payload into the tip frame, as getPayloadTorques() does
+      const Eigen::Isometry3d& base_frame = workspace.state.getFrameTransform(base_name_);
+      const Eigen::Isometry3d& tip_frame = workspace.state.getFrameTransform(tip_name_);
+      const Eigen::Vector3d force =
+          (tip_frame.inverse() * base_frame).linear() * Eigen::Vector3d(0.0, 0.0, payload * gravity_);
+      workspace.wrenches.back().force = KDL::Vector(force.x(), force.y(), force.z());
+    }
+
+    if (workspace.id_solver.CartToJnt(workspace.angles, workspace.velocities, workspace.accelerations,
+                                      workspace.wrenches, workspace.torques) < 0)
+    {
+      RCLCPP_ERROR(LOGGER, "Something went wrong computing torques for waypoint %ld", static_cast<long>(waypoint));
+      return false;
+    }
+    torques.col(waypoint) = workspace.torques.data;
+  }
+  return true;
+}
+
+bool DynamicsSolver::getTorquesForTrajectory(const Eigen::MatrixXd& joint_angles,
+                                             const Eigen::MatrixXd& joint_velocities,
+                                             const Eigen::MatrixXd& joint_accelerations, Eigen::MatrixXd& torques,
+                                             double payload, unsigned int thread_count) const
+{
+  if (!joint_model_group_)
+  {
+    RCLCPP_DEBUG(LOGGER, "Did not construct DynamicsSolver object properly. "
+                         "Check error logs.");
+    return false;
+  }
+  if (joint_angles.rows() != static_cast<Eigen::Index>(num_joints_))
+  {
+    RCLCPP_ERROR(LOGGER, "Joint angles matrix should have %d rows", num_joints_);
+    return false;
+  }
+  if (joint_velocities.rows() != joint_angles.rows() || joint_velocities.cols() != joint_angles.cols() ||
+      joint_accelerations.rows() != joint_angles.rows() || joint_accelerations.cols() != joint_angles.cols())
+  {
+    RCLCPP_ERROR(LOGGER, "Joint velocities and accelerations should be of the same size as the joint angles");
+    return false;
+  }
+
+  const Eigen::Index waypoint_count = joint_angles.cols();
+  torques.resize(num_joints_, waypoint_count);
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  if (thread_count > waypoint_count)
+    thread_count = std::max<Eigen::Index>(1, waypoint_count);
+
+  // every thread works on its own workspace and a contiguous range of waypoints
+  std::vector<std::unique_ptr<Workspace>> workspaces;
+  for (unsigned int thread = 0; thread < thread_count; ++thread)
+    workspaces.push_back(std::make_unique<Workspace>(kdl_chain_, gravity_vector_, robot_model_));
+  std::vector<char> success(thread_count, false);
+  const auto run = [&](unsigned int thread) {
+    const Eigen::Index begin = waypoint_count * thread / thread_count;
+    const Eigen::Index end = waypoint_count * (thread + 1) / thread_count;
+    success[thread] = computeTorques(*workspaces[thread], joint_angles, joint_velocities, joint_accelerations,
+                                     torques, payload, begin, end);
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < thread_count; ++thread)
+    threads.emplace_back(run, thread);
+  run(0);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  return std::all_of(success.begin(), success.end(), [](char s) { return s; });
+}
+
+bool DynamicsSolver::getTorquesForTrajectory(const robot_trajectory::RobotTrajectory& trajectory,
+                                             Eigen::MatrixXd& torques, double payload,
+                                             unsigned int thread_count) const
+{
+  if (!joint_model_group_)
+  {
+    RCLCPP_DEBUG(LOGGER, "Did not construct DynamicsSolver object properly. "
+                         "Check error logs.");
+    return false;
+  }
+
+  const std::size_t waypoint_count = trajectory.getWayPointCount();
+  const std::size_t variable_count = joint_model_group_->getVariableCount();
+  Eigen::MatrixXd joint_angles(variable_count, waypoint_count);
+  Eigen::MatrixXd joint_velocities = Eigen::MatrixXd::Zero(variable_count, waypoint_count);
+  Eigen::MatrixXd joint_accelerations = Eigen::MatrixXd::Zero(variable_count, waypoint_count);
+  for (std::size_t i = 0; i < waypoint_count; ++i)
+  {
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+    waypoint.copyJointGroupPositions(joint_model_group_, joint_angles.col(i).data());
+    if (waypoint.hasVelocities())
+      waypoint.copyJointGroupVelocities(joint_model_group_, joint_velocities.col(i).data());
+    if (waypoint.hasAccelerations())
+      waypoint.copyJointGroupAccelerations(joint_model_group_, joint_accelerations.col(i).data());
+  }
+  return getTorquesForTrajectory(joint_angles, joint_velocities, joint_accelerations, torques, payload,
+                                 thread_count);
+}
+
 const std::vector<double>& DynamicsSolver::getMaxTorques() const
 {
   return max_torques_;
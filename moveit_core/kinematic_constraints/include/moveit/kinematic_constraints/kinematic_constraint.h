@@ -842,6 +842,19 @@ protected:
    */
   bool decideContact(const collision_detection::Contact& contact) const;
 
+  /**
+   * \brief Analytic test whether no robot link can touch the visibility cone
+   *
+   * The bounding sphere of each link's collision geometry is tested against the exact cone spanned by the sensor
+   * origin and the target disc, which contains the mesh from getVisibilityCone(). A positive answer is therefore
+   * conclusive, while a negative one requires the mesh collision check.
+   *
+   * @param [in] state The state in which to test the links
+   *
+   * @return True if no link whose collision is not allowed by decideContact() can intersect the cone
+   */
+  bool isConeClearOfRobotLinks(const moveit::core::RobotState& state) const;
+
   collision_detection::CollisionEnvPtr collision_env_; /**< \brief A copy of the collision robot maintained for
                                                               collision checking the cone against robot links */
   bool mobile_sensor_frame_;      /**< \brief True if the sensor is a non-fixed frame relative to the transform frame */
@@ -856,6 +869,7 @@ protected:
   double target_radius_;             /**< \brief Storage for the target radius */
   double max_view_angle_;            /**< \brief Storage for the max view angle */
   double max_range_angle_;           /**< \brief Storage for the max range angle */
+  std::vector<const moveit::core::LinkModel*> cone_check_links_; /**< \brief Links tested against the cone */
 };
 
 MOVEIT_CLASS_FORWARD(KinematicConstraintSet);  // Defines KinematicConstraintSetPtr, ConstPtr, WeakPtr... etc
@@ -973,6 +987,21 @@ public:
   ConstraintEvaluationResult decide(const moveit::core::RobotState& state,
                                     std::vector<ConstraintEvaluationResult>& results, bool verbose = false) const;
 
+  /**
+   * \brief Determines whether all constraints are satisfied by state,
+   * without computing the summed distance.
+   *
+   * Constraints are checked in order of increasing evaluation cost
+   * (joint, position, orientation, then visibility constraints) and
+   * checking stops at the first constraint that is not satisfied.
+   *
+   * @param [in] state The state to test
+   * @param [in] verbose Whether or not to make each checked constraint give debug output
+   *
+   * @return True if all constraints are satisfied, false otherwise
+   */
+  bool satisfied(const moveit::core::RobotState& state, bool verbose = false) const;
+
   /**
    * \brief Whether or not another KinematicConstraintSet is equal to
    * this one.
@@ -1064,9 +1093,13 @@ public:
   }
 
 protected:
+  /** \brief Sort the member constraints by evaluation cost into evaluation_order_ */
+  void updateEvaluationOrder();
+
   moveit::core::RobotModelConstPtr robot_model_; /**< \brief The kinematic model used for by the Set */
   std::vector<KinematicConstraintPtr>
       kinematic_constraints_; /**<  \brief Shared pointers to all the member constraints */
+  std::vector<const KinematicConstraint*> evaluation_order_; /**<  \brief The member constraints, cheapest first */
 
   std::vector<moveit_msgs::msg::JointConstraint> joint_constraints_; /**<  \brief Messages corresponding to all internal
                                                                    joint constraints */
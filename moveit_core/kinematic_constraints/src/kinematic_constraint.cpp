@@ -44,6 +44,7 @@
 #include <rclcpp/logging.hpp>
 #include <rclcpp/time.hpp>
 #include <tf2_eigen/tf2_eigen.hpp>
+#include <algorithm>
 #include <functional>
 #include <limits>
 #include <math.h>
@@ -775,6 +776,7 @@ void VisibilityConstraint::clear()
   target_radius_ = -1.0;
   max_view_angle_ = 0.0;
   max_range_angle_ = 0.0;
+  cone_check_links_.clear();
 }
 
 bool VisibilityConstraint::configure(const moveit_msgs::msg::VisibilityConstraint& vc,
@@ -853,6 +855,14 @@ bool VisibilityConstraint::configure(const moveit_msgs::msg::VisibilityConstrain
   max_range_angle_ = vc.max_range_angle;
   sensor_view_direction_ = vc.sensor_view_direction;
 
+  // contacts with the sensor and target links are allowed by decideContact(), so they need no test
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    if (!moveit::core::Transforms::sameFrame(link->getName(), sensor_frame_id_) &&
+        !moveit::core::Transforms::sameFrame(link->getName(), target_frame_id_))
+      cone_check_links_.push_back(link);
+  }
+
   return target_radius_ > std::numeric_limits<double>::epsilon();
 }
 
@@ -1104,6 +1114,14 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const moveit::core::Robo
     }
   }
 
+  // most states can be decided from bounding spheres, without building and colliding the cone mesh
+  if (isConeClearOfRobotLinks(state))
+  {
+    if (verbose)
+      RCLCPP_INFO(LOGGER, "Visibility constraint satisfied. No robot link is near the visibility cone.");
+    return ConstraintEvaluationResult(true, 0.0);
+  }
+
   shapes::Mesh* m = getVisibilityCone(state);
   if (!m)
     return ConstraintEvaluationResult(false, 0.0);
@@ -1138,6 +1156,51 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const moveit::core::Robo
   return ConstraintEvaluationResult(!res.collision, res.collision ? res.contacts.begin()->second.front().depth : 0.0);
 }
 
+// Distance of the point (t, q) to the triangle (0, 0), (length, 0), (length, radius), whose rotation about the t-axis
+// is a solid cone. For a point in 3D, t is the coordinate along the cone axis and q the distance to the axis.
+static double distanceToConeSection(double t, double q, double length, double radius)
+{
+  if (t >= 0.0 && t <= length && q * length <= t * radius)
+    return 0.0;
+
+  const auto distance_to_segment = [t, q](const Eigen::Vector2d& a, const Eigen::Vector2d& b) {
+    const Eigen::Vector2d p(t, q);
+    const Eigen::Vector2d ab = b - a;
+    const double s = std::clamp((p - a).dot(ab) / ab.squaredNorm(), 0.0, 1.0);
+    return (p - a - s * ab).norm();
+  };
+  const Eigen::Vector2d apex(0.0, 0.0);
+  const Eigen::Vector2d center(length, 0.0);
+  const Eigen::Vector2d rim(length, radius);
+  return std::min(
+      { distance_to_segment(apex, rim), distance_to_segment(center, rim), distance_to_segment(apex, center) });
+}
+
+bool VisibilityConstraint::isConeClearOfRobotLinks(const moveit::core::RobotState& state) const
+{
+  const Eigen::Vector3d apex =
+      (mobile_sensor_frame_ ? state.getFrameTransform(sensor_frame_id_) * sensor_pose_ : sensor_pose_).translation();
+  const Eigen::Vector3d base =
+      (mobile_target_frame_ ? state.getFrameTransform(target_frame_id_) * target_pose_ : target_pose_).translation();
+  Eigen::Vector3d axis = base - apex;
+  const double length = axis.norm();
+  if (length <= std::numeric_limits<double>::epsilon())
+    return false;
+  axis /= length;
+
+  for (const moveit::core::LinkModel* link : cone_check_links_)
+  {
+    const Eigen::Vector3d center = state.getGlobalLinkTransform(link) * link->getCenteredBoundingBoxOffset();
+    const double radius = 0.5 * link->getShapeExtentsAtOrigin().norm();
+    const Eigen::Vector3d offset = center - apex;
+    const double t = offset.dot(axis);
+    const double q = (offset - t * axis).norm();
+    if (distanceToConeSection(t, q, length, target_radius_) <= radius)
+      return false;
+  }
+  return true;
+}
+
 bool VisibilityConstraint::decideContact(const collision_detection::Contact& contact) const
 {
   if (contact.body_type_1 == collision_detection::BodyTypes::ROBOT_ATTACHED ||
@@ -1178,6 +1241,7 @@ void KinematicConstraintSet::clear()
 {
   all_constraints_ = moveit_msgs::msg::Constraints();
   kinematic_constraints_.clear();
+  evaluation_order_.clear();
   joint_constraints_.clear();
   position_constraints_.clear();
   orientation_constraints_.clear();
@@ -1196,6 +1260,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::JointConstr
     joint_constraints_.push_back(joint_constraint);
     all_constraints_.joint_constraints.push_back(joint_constraint);
   }
+  updateEvaluationOrder();
   return result;
 }
 
@@ -1212,6 +1277,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::PositionCon
     position_constraints_.push_back(position_constraint);
     all_constraints_.position_constraints.push_back(position_constraint);
   }
+  updateEvaluationOrder();
   return result;
 }
 
@@ -1228,6 +1294,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::Orientation
     orientation_constraints_.push_back(orientation_constraint);
     all_constraints_.orientation_constraints.push_back(orientation_constraint);
   }
+  updateEvaluationOrder();
   return result;
 }
 
@@ -1244,6 +1311,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::VisibilityC
     visibility_constraints_.push_back(visibility_constraint);
     all_constraints_.visibility_constraints.push_back(visibility_constraint);
   }
+  updateEvaluationOrder();
   return result;
 }
 
@@ -1285,6 +1353,28 @@ ConstraintEvaluationResult KinematicConstraintSet::decide(const moveit::core::Ro
   return result;
 }
 
+bool KinematicConstraintSet::satisfied(const moveit::core::RobotState& state, bool verbose) const
+{
+  for (const KinematicConstraint* kinematic_constraint : evaluation_order_)
+  {
+    if (!kinematic_constraint->decide(state, verbose).satisfied)
+      return false;
+  }
+  return true;
+}
+
+void KinematicConstraintSet::updateEvaluationOrder()
+{
+  // the constraint types are declared in order of increasing evaluation cost
+  evaluation_order_.clear();
+  for (const KinematicConstraintPtr& kinematic_constraint : kinematic_constraints_)
+    evaluation_order_.push_back(kinematic_constraint.get());
+  std::stable_sort(evaluation_order_.begin(), evaluation_order_.end(),
+                   [](const KinematicConstraint* a, const KinematicConstraint* b) {
+                     return a->getType() < b->getType();
+                   });
+}
+
 void KinematicConstraintSet::print(std::ostream& out) const
 {
   out << kinematic_constraints_.size() << " kinematic constraints" << '\n';
@@ -812,6 +812,7 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
 
   // but it isn't satisfied in the default state
   EXPECT_FALSE(kcs.decide(robot_state).satisfied);
+  EXPECT_FALSE(kcs.satisfied(robot_state));
 
   // now it is
   std::map<std::string, double> jvals;
@@ -819,6 +820,7 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
   robot_state.setVariablePositions(jvals);
   robot_state.update();
   EXPECT_TRUE(kcs.decide(robot_state).satisfied);
+  EXPECT_TRUE(kcs.satisfied(robot_state));
 
   // adding another constraint for a different joint
   EXPECT_FALSE(kcs.empty());
@@ -830,16 +832,19 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
 
   // now this one isn't satisfied
   EXPECT_FALSE(kcs.decide(robot_state).satisfied);
+  EXPECT_FALSE(kcs.satisfied(robot_state));
 
   // now it is
   jvals[jcv.back().joint_name] = 0.41;
   robot_state.setVariablePositions(jvals);
   EXPECT_TRUE(kcs.decide(robot_state).satisfied);
+  EXPECT_TRUE(kcs.satisfied(robot_state));
 
   // changing one joint outside the bounds makes it unsatisfied
   jvals[jcv.back().joint_name] = 0.51;
   robot_state.setVariablePositions(jvals);
   EXPECT_FALSE(kcs.decide(robot_state).satisfied);
+  EXPECT_FALSE(kcs.satisfied(robot_state));
 
   // one invalid constraint makes the add return false
   kcs.clear();
@@ -848,11 +853,13 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
 
   // but we can still evaluate it successfully for the remaining constraint
   EXPECT_TRUE(kcs.decide(robot_state).satisfied);
+  EXPECT_TRUE(kcs.satisfied(robot_state));
 
   // violating the remaining good constraint changes this
   jvals["head_pan_joint"] = 0.51;
   robot_state.setVariablePositions(jvals);
   EXPECT_FALSE(kcs.decide(robot_state).satisfied);
+  EXPECT_FALSE(kcs.satisfied(robot_state));
 }
 
 TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetEquality)
@@ -41,6 +41,7 @@
 #include <moveit/macros/class_forward.h>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/node.hpp>
+#include <atomic>
 #include <string>
 #include <functional>
 
@@ -112,6 +113,7 @@ struct KinematicsQueryOptions
     : lock_redundant_joints(false)
     , return_approximate_solution(false)
     , discretization_method(DiscretizationMethods::NO_DISCRETIZATION)
+    , parallel_seeds(1)
   {
   }
 
@@ -119,6 +121,9 @@ struct KinematicsQueryOptions
   bool return_approximate_solution;           /**<  KinematicsQueryOptions#return_approximate_solution. */
   DiscretizationMethod discretization_method; /**<  Enumeration value that indicates the method for discretizing the
                                                     redundant. joints KinematicsQueryOptions#discretization_method. */
+  unsigned int parallel_seeds;                /**<  Number of seeds searchPositionIK() tries concurrently, if the
+                                                    solver supports it. The first solution passing the callback wins;
+                                                    the callback is then called from several threads at once. */
 };
 
 /*
@@ -366,6 +371,26 @@ public:
     return false;
   }
 
+  /**
+   * @brief Given a batch of desired poses for the single tip link, search for the joint angles required to reach each
+   * of them independently. This is useful for e.g. reachability maps or ranking many grasps.
+   * The default implementation calls searchPositionIK() for one pose after the other. Solvers that can reuse their
+   * workspace between queries or solve them concurrently override this.
+   * @param ik_poses the desired poses of the tip link, in the reference frame of the kinematics solver
+   * @param ik_seed_states an initial guess solution for each pose, or a single one used for all poses
+   * @param timeout The amount of time (in seconds) available to the solver for each pose
+   * @param solutions the solution vector of each pose, empty for the poses no solution was found for
+   * @param error_codes the error code of each pose, encoding the reason for failure or success
+   * @param options container for other IK options. See definition of KinematicsQueryOptions for details.
+   * @return True if a valid solution was found for every pose, false otherwise
+   */
+  virtual bool
+  searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                        const std::vector<std::vector<double>>& ik_seed_states, double timeout,
+                        std::vector<std::vector<double>>& solutions,
+                        std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
+
   /**
    * @brief Given a set of joint angles and a set of links, compute their pose
    * @param link_names A set of links for which FK needs to be computed
@@ -504,6 +529,15 @@ public:
    */
   virtual bool supportsGroup(const moveit::core::JointModelGroup* jmg, std::string* error_text_out = nullptr) const;
 
+  /**
+   * @brief Estimate the number of bytes held by caches of the solver, e.g. of previous solutions, to monitor their
+   * growth. The default implementation returns 0.
+   */
+  virtual std::size_t getMemoryUsage() const
+  {
+    return 0;
+  }
+
   /**
    * @brief  Set the search discretization value for all the redundant joints
    */
@@ -635,6 +669,28 @@ protected:
     return false;
   }
 
+  /**
+   * @brief Helper for implementations of searchPositionIKBatch() that solve on several threads.
+   * Checks the number of seed states and sizes the outputs, then calls \e solve for every pose index on up to
+   * \e thread_count threads. The thread number passed to \e solve is below \e thread_count, so solvers can keep one
+   * workspace per thread.
+   * @return True if every pose was solved
+   */
+  bool solveBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                  const std::vector<std::vector<double>>& ik_seed_states, std::vector<std::vector<double>>& solutions,
+                  std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes, unsigned int thread_count,
+                  const std::function<bool(unsigned int thread, std::size_t index, const std::vector<double>& seed)>&
+                      solve) const;
+
+  /**
+   * @brief Helper for implementations of searchPositionIK() that race several searches on \e thread_count threads.
+   * Calls \e search with the thread number and a flag that is set once one of the searches succeeded, which the
+   * others should poll to stop early.
+   * @return The thread number of the first successful search, -1 if all failed
+   */
+  int raceSearches(unsigned int thread_count,
+                   const std::function<bool(unsigned int thread, const std::atomic<bool>& cancel)>& search) const;
+
   /** Store some core variables passed via initialize().
    *
    * @param robot_model RobotModel, this kinematics solver should act on.
@@ -38,6 +38,9 @@
 #include <moveit/robot_model/joint_model_group.h>
 #include <rclcpp/logger.hpp>
 
+#include <atomic>
+#include <thread>
+
 namespace kinematics
 {
 // Logger
@@ -195,4 +198,83 @@ bool KinematicsBase::getPositionIK(const std::vector<geometry_msgs::msg::Pose>&
 
   return true;
 }
+
+bool KinematicsBase::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                           const std::vector<std::vector<double>>& ik_seed_states, double timeout,
+                                           std::vector<std::vector<double>>& solutions,
+                                           std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  // solvers are not required to be thread-safe, so the default implementation solves one pose after the other
+  return solveBatch(ik_poses, ik_seed_states, solutions, error_codes, 1,
+                    [&](unsigned int /*thread*/, std::size_t index, const std::vector<double>& seed) {
+                      return searchPositionIK(ik_poses[index], seed, timeout, solutions[index], error_codes[index],
+                                              options);
+                    });
+}
+
+bool KinematicsBase::solveBatch(
+    const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double>>& ik_seed_states,
+    std::vector<std::vector<double>>& solutions, std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+    unsigned int thread_count,
+    const std::function<bool(unsigned int thread, std::size_t index, const std::vector<double>& seed)>& solve) const
+{
+  if (ik_seed_states.size() != 1 && ik_seed_states.size() != ik_poses.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Expected 1 or %zu seed states for the batch of poses instead of %zu", ik_poses.size(),
+                 ik_seed_states.size());
+    solutions.clear();
+    error_codes.clear();
+    return false;
+  }
+
+  solutions.assign(ik_poses.size(), std::vector<double>());
+  error_codes.assign(ik_poses.size(), moveit_msgs::msg::MoveItErrorCodes());
+
+  std::atomic<std::size_t> next_index{ 0 };
+  std::atomic<bool> all_solved{ true };
+  const auto solve_poses = [&](unsigned int thread) {
+    for (std::size_t index = next_index++; index < ik_poses.size(); index = next_index++)
+    {
+      if (!solve(thread, index, ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[index]))
+      {
+        solutions[index].clear();
+        all_solved = false;
+      }
+    }
+  };
+
+  thread_count = std::max(1u, std::min<unsigned int>(thread_count, ik_poses.size()));
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < thread_count; ++thread)
+    threads.emplace_back(solve_poses, thread);
+  solve_poses(0);
+  for (std::thread& thread : threads)
+    thread.join();
+  return all_solved;
+}
+
+int KinematicsBase::raceSearches(
+    unsigned int thread_count,
+    const std::function<bool(unsigned int thread, const std::atomic<bool>& cancel)>& search) const
+{
+  std::atomic<bool> done{ false };
+  std::atomic<int> winner{ -1 };
+  const auto run = [&](unsigned int thread) {
+    if (search(thread, done))
+    {
+      int none = -1;
+      if (winner.compare_exchange_strong(none, static_cast<int>(thread)))
+        done = true;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < std::max(1u, thread_count); ++thread)
+    threads.emplace_back(run, thread);
+  run(0);
+  for (std::thread& thread : threads)
+    thread.join();
+  return winner;
+}
 }  // end of namespace kinematics
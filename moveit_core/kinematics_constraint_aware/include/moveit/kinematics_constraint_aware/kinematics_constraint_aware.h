@@ -0,0 +1,163 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/reachability_map/reachability_map.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit_msgs/msg/move_it_error_codes.hpp>
+#include <eigen_stl_containers/eigen_stl_containers.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kinematics_constraint_aware
+{
+MOVEIT_CLASS_FORWARD(KinematicsConstraintAware);  // Defines KinematicsConstraintAwarePtr, ConstPtr, WeakPtr... etc
+
+/** \brief An IK query for KinematicsConstraintAware */
+struct KinematicsRequest
+{
+  /** poses of the tips in the model frame, one per tip */
+  EigenSTL::vector_Isometry3d poses;
+  /** links (or frames rigidly attached to them) to place at poses; empty selects the tips of the group's solver */
+  std::vector<std::string> tips;
+  /** seed for the group and values of all other joints; the scene's current state is used if this is nullptr */
+  moveit::core::RobotStateConstPtr robot_state;
+  /** constraints the solution has to satisfy, if any */
+  kinematic_constraints::KinematicConstraintSetConstPtr constraints;
+  /** additional user check of the solution, if any */
+  moveit::core::GroupStateValidityCallbackFn constraint_callback;
+  /** total time for the query; the group's default IK timeout is used if this is not positive */
+  double timeout = 0.0;
+  bool check_for_collisions = true;
+  kinematics::KinematicsQueryOptions options;
+};
+
+/** \brief The result of a KinematicsConstraintAware query */
+struct KinematicsResponse
+{
+  /** the robot state of the request with the group set to the solution, if one was found */
+  moveit::core::RobotStatePtr solution;
+  moveit_msgs::msg::MoveItErrorCodes error_code;
+};
+
+/** \brief IK solver wrapper returning solutions that are collision free and satisfy kinematic constraints
+ *
+ * Queries run in rounds of IK searches from several seeds in parallel. The first round starts from the request's
+ * seed, then from solutions of previous queries and seeds of an optional reachability map, the remaining searches
+ * from random seeds. Kinematic constraints and the user callback are checked in the IK callback, so that the solvers
+ * reject those solutions right away. The solutions of a round are then checked for collisions with the world in one
+ * batched query, and the first collision free one in seed order is returned. */
+class KinematicsConstraintAware
+{
+public:
+  struct Options
+  {
+    Options() : thread_count(0), seeds_per_round(0), solution_cache_size(16)
+    {
+    }
+
+    /** threads running IK searches in parallel (0: hardware concurrency) */
+    unsigned int thread_count;
+    /** IK searches per round (0: one per thread) */
+    unsigned int seeds_per_round;
+    /** number of solutions kept to seed later queries */
+    std::size_t solution_cache_size;
+  };
+
+  /** \brief Construct a solver for the given group
+   *
+   * Throws moveit::ConstructException if the group does not exist or neither has an IK solver nor subgroups that
+   * all have one. */
+  KinematicsConstraintAware(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group_name,
+                            const Options& options = Options());
+
+  /** \brief Solve the IK request in the given scene
+   *
+   * Returns false if no valid solution was found within the timeout. response.error_code then tells whether
+   * solutions were only rejected for collisions (GOAL_IN_COLLISION), for constraints
+   * (GOAL_VIOLATES_PATH_CONSTRAINTS), or not found at all (NO_IK_SOLUTION). */
+  bool getIK(const planning_scene::PlanningSceneConstPtr& planning_scene, const KinematicsRequest& request,
+             KinematicsResponse& response) const;
+
+  /** \brief Seed single-tip queries with the configurations stored in a reachability map of this group's tip */
+  void setReachabilityMap(const reachability_map::ReachabilityMapConstPtr& reachability_map)
+  {
+    reachability_map_ = reachability_map;
+  }
+
+  /** \brief Forget the solutions of previous queries */
+  void clearSolutionCache();
+
+  const std::string& getGroupName() const
+  {
+    return joint_model_group_->getName();
+  }
+
+  const moveit::core::RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  const Options& getOptions() const
+  {
+    return options_;
+  }
+
+private:
+  /** \brief Collect the seeds of the first round: request seed, cached solutions closest to it, reachability map */
+  void getInitialSeeds(const moveit::core::RobotState& seed_state, const KinematicsRequest& request,
+                       std::vector<std::vector<double>>& seeds) const;
+
+  /** \brief Remember a solution to seed later queries */
+  void addToSolutionCache(const std::vector<double>& solution) const;
+
+  moveit::core::RobotModelConstPtr robot_model_;
+  const moveit::core::JointModelGroup* joint_model_group_;
+  std::vector<std::string> default_tips_;
+  Options options_;
+
+  reachability_map::ReachabilityMapConstPtr reachability_map_;
+
+  mutable std::deque<std::vector<double>> solution_cache_;
+  mutable std::mutex solution_cache_lock_;
+};
+}  // namespace kinematics_constraint_aware
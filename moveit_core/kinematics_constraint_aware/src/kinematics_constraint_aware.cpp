@@ -0,0 +1,295 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/kinematics_constraint_aware/kinematics_constraint_aware.h>
+#include <moveit/collision_detection/collision_common.h>
+#include <moveit/exceptions/exceptions.h>
+#include <random_numbers/random_numbers.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace kinematics_constraint_aware
+{
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_kinematics_constraint_aware.kinematics_constraint_aware");
+
+namespace
+{
+void appendTipFrames(const kinematics::KinematicsBaseConstPtr& solver, std::vector<std::string>& tips)
+{
+  if (solver)
+    tips.insert(tips.end(), solver->getTipFrames().begin(), solver->getTipFrames().end());
+}
+}  // namespace
+
+KinematicsConstraintAware::KinematicsConstraintAware(const moveit::core::RobotModelConstPtr& robot_model,
+                                                     const std::string& group_name, const Options& options)
+  : robot_model_(robot_model), joint_model_group_(robot_model->getJointModelGroup(group_name)), options_(options)
+{
+  if (!joint_model_group_)
+    throw moveit::ConstructException("Group '" + group_name + "' does not exist");
+
+  if (joint_model_group_->getSolverInstance())
+  {
+    appendTipFrames(joint_model_group_->getSolverInstance(), default_tips_);
+  }
+  else
+  {
+    const moveit::core::JointModelGroup::KinematicsSolverMap& subgroups =
+        joint_model_group_->getGroupKinematics().second;
+    if (subgroups.empty())
+      throw moveit::ConstructException("Group '" + group_name + "' has no IK solver");
+    for (const auto& subgroup : subgroups)
+      appendTipFrames(subgroup.first->getSolverInstance(), default_tips_);
+  }
+}
+
+void KinematicsConstraintAware::clearSolutionCache()
+{
+  std::scoped_lock slock(solution_cache_lock_);
+  solution_cache_.clear();
+}
+
+void KinematicsConstraintAware::addToSolutionCache(const std::vector<double>& solution) const
+{
+  if (options_.solution_cache_size == 0)
+    return;
+  std::scoped_lock slock(solution_cache_lock_);
+  solution_cache_.push_front(solution);
+  while (solution_cache_.size() > options_.solution_cache_size)
+    solution_cache_.pop_back();
+}
+
+void KinematicsConstraintAware::getInitialSeeds(const moveit::core::RobotState& seed_state,
+                                                const KinematicsRequest& request,
+                                                std::vector<std::vector<double>>& seeds) const
+{
+  seeds.clear();
+  seeds.emplace_back();
+  seed_state.copyJointGroupPositions(joint_model_group_, seeds.back());
+
+  // recent solutions, closest to the request's seed first
+  std::vector<std::vector<double>> cached;
+  {
+    std::scoped_lock slock(solution_cache_lock_);
+    cached.assign(solution_cache_.begin(), solution_cache_.end());
+  }
+  std::vector<std::pair<double, std::size_t>> order;
+  order.reserve(cached.size());
+  for (std::size_t i = 0; i < cached.size(); ++i)
+    order.emplace_back(joint_model_group_->distance(seeds.front().data(), cached[i].data()), i);
+  std::sort(order.begin(), order.end());
+  for (const std::pair<double, std::size_t>& entry : order)
+    seeds.push_back(std::move(cached[entry.second]));
+
+  // configurations known to reach the goal of a single tip
+  const std::vector<std::string>& tips = request.tips.empty() ? default_tips_ : request.tips;
+  if (reachability_map_ && reachability_map_->getJointModelGroup() == joint_model_group_ &&
+      request.poses.size() == 1 && tips.size() == 1 && reachability_map_->getTipLink()->getName() == tips.front())
+  {
+    std::vector<reachability_map::ReachabilityMap::Seed> map_seeds;
+    const std::size_t max_count = std::max<std::size_t>(1, options_.seeds_per_round);
+    if (reachability_map_->getSeeds(request.poses.front(), max_count, map_seeds))
+      for (reachability_map::ReachabilityMap::Seed& map_seed : map_seeds)
+        if (map_seed.joint_values.size() == joint_model_group_->getVariableCount())
+          seeds.push_back(std::move(map_seed.joint_values));
+  }
+}
+
+bool KinematicsConstraintAware::getIK(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                      const KinematicsRequest& request, KinematicsResponse& response) const
+{
+  response.solution.reset();
+  if (!planning_scene)
+  {
+    RCLCPP_ERROR(LOGGER, "A planning scene is needed to solve IK for group '%s'", getGroupName().c_str());
+    response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    return false;
+  }
+
+  const std::vector<std::string>& tips = request.tips.empty() ? default_tips_ : request.tips;
+  if (request.poses.empty() || request.poses.size() != tips.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Got %zu poses for %zu tips of group '%s'", request.poses.size(), tips.size(),
+                 getGroupName().c_str());
+    response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+    return false;
+  }
+
+  moveit::core::RobotState seed_state(request.robot_state ? *request.robot_state : planning_scene->getCurrentState());
+  seed_state.update();
+
+  const double timeout = request.timeout > 0.0 ? request.timeout : joint_model_group_->getDefaultIKTimeout();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+
+  const unsigned int thread_count =
+      options_.thread_count > 0 ? options_.thread_count : std::max(1u, std::thread::hardware_concurrency());
+  const std::size_t seeds_per_round = options_.seeds_per_round > 0 ? options_.seeds_per_round : thread_count;
+
+  // visibility constraints check against a collision world of their own and must not be evaluated concurrently
+  const bool serialize_constraints = request.constraints && !request.constraints->getVisibilityConstraints().empty();
+  std::mutex constraints_lock;
+  std::atomic<std::size_t> constraint_rejections(0);
+
+  const moveit::core::GroupStateValidityCallbackFn validity_callback =
+      [&](moveit::core::RobotState* state, const moveit::core::JointModelGroup* group, const double* values) {
+        state->setJointGroupPositions(group, values);
+        state->update();
+        if (request.constraints)
+        {
+          std::unique_lock<std::mutex> ulock(constraints_lock, std::defer_lock);
+          if (serialize_constraints)
+            ulock.lock();
+          if (!request.constraints->decide(*state).satisfied)
+          {
+            ++constraint_rejections;
+            return false;
+          }
+        }
+        if (request.constraint_callback && !request.constraint_callback(state, group, values))
+        {
+          ++constraint_rejections;
+          return false;
+        }
+        return true;
+      };
+
+  std::vector<std::vector<double>> seeds;
+  getInitialSeeds(seed_state, request, seeds);
+  std::size_t next_seed = 0;
+
+  random_numbers::RandomNumberGenerator rng;
+  moveit::core::RobotState random_state(seed_state);
+
+  collision_detection::CollisionRequest collision_request;
+  collision_request.group_name = joint_model_group_->getName();
+  const collision_detection::AllowedCollisionMatrix& acm = planning_scene->getAllowedCollisionMatrix();
+
+  bool found_ik = false;
+  std::size_t round = 0;
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    // seeds of this round: known ones first, then random configurations
+    std::vector<std::vector<double>> round_seeds;
+    round_seeds.reserve(seeds_per_round);
+    while (round_seeds.size() < seeds_per_round && next_seed < seeds.size())
+      round_seeds.push_back(std::move(seeds[next_seed++]));
+    while (round_seeds.size() < seeds_per_round)
+    {
+      random_state.setToRandomPositions(joint_model_group_, rng);
+      round_seeds.emplace_back();
+      random_state.copyJointGroupPositions(joint_model_group_, round_seeds.back());
+    }
+
+    // solve IK from all seeds of the round in parallel
+    std::vector<moveit::core::RobotStatePtr> candidates(round_seeds.size());
+    std::atomic<std::size_t> next_search(0);
+    auto search = [&]() {
+      for (std::size_t i = next_search++; i < round_seeds.size(); i = next_search++)
+      {
+        const double remaining = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0.0)
+          break;
+        auto state = std::make_shared<moveit::core::RobotState>(seed_state);
+        state->setJointGroupPositions(joint_model_group_, round_seeds[i]);
+        if (state->setFromIK(joint_model_group_, request.poses, tips, remaining, validity_callback, request.options))
+        {
+          state->update();
+          candidates[i] = state;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 1; thread < std::min<std::size_t>(thread_count, round_seeds.size()); ++thread)
+      threads.emplace_back(search);
+    search();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    std::vector<const moveit::core::RobotState*> states;
+    std::vector<std::size_t> indices;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+      if (candidates[i])
+      {
+        states.push_back(candidates[i].get());
+        indices.push_back(i);
+      }
+    ++round;
+    if (states.empty())
+      continue;
+    found_ik = true;
+
+    // check all solutions of the round against the world at once, self collisions only for the survivors
+    std::vector<collision_detection::CollisionResult> results;
+    if (request.check_for_collisions)
+      planning_scene->getCollisionEnv()->checkRobotCollisionBatch(collision_request, states, results, acm);
+    for (std::size_t k = 0; k < states.size(); ++k)
+    {
+      if (request.check_for_collisions)
+      {
+        if (results[k].collision)
+          continue;
+        collision_detection::CollisionResult self_result;
+        planning_scene->checkSelfCollision(collision_request, self_result, *states[k], acm);
+        if (self_result.collision)
+          continue;
+      }
+
+      response.solution = candidates[indices[k]];
+      std::vector<double> solution;
+      response.solution->copyJointGroupPositions(joint_model_group_, solution);
+      addToSolutionCache(solution);
+      RCLCPP_DEBUG(LOGGER, "Found IK solution for group '%s' in round %zu", getGroupName().c_str(), round);
+      response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+      return true;
+    }
+  }
+
+  if (found_ik && request.check_for_collisions)
+    response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::GOAL_IN_COLLISION;
+  else if (constraint_rejections > 0)
+    response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::GOAL_VIOLATES_PATH_CONSTRAINTS;
+  else
+    response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
+  RCLCPP_DEBUG(LOGGER, "No valid IK solution for group '%s' after %zu rounds (%zu constraint rejections)",
+               getGroupName().c_str(), round, constraint_rejections.load());
+  return false;
+}
+}  // namespace kinematics_constraint_aware
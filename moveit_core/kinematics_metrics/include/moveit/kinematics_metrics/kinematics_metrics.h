@@ -37,6 +37,7 @@
 #pragma once
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 /** @brief Namespace for kinematics metrics */
 namespace kinematics_metrics
@@ -124,6 +125,49 @@ public:
   bool getManipulability(const moveit::core::RobotState& state, const moveit::core::JointModelGroup* joint_model_group,
                          double& condition_number, bool translation = false) const;
 
+  /**
+   * @brief Get the manipulability index (see getManipulabilityIndex()) of many states of the same group. The states
+   * are evaluated in parallel, each thread reusing its Jacobian and decomposition buffers.
+   * @param states Complete kinematic states for the robot, with up-to-date link transforms
+   * @param joint_model_group A pointer to the desired joint model group
+   * @param manipulability_indices The computed manipulabilities, one per state
+   * @param max_concurrency The maximum number of threads to use; 0 uses one per core
+   * @return False if the group is not a chain or the Jacobian of a state could not be computed
+   */
+  bool getManipulabilityIndices(const std::vector<const moveit::core::RobotState*>& states,
+                                const moveit::core::JointModelGroup* joint_model_group,
+                                std::vector<double>& manipulability_indices, bool translation = false,
+                                std::size_t max_concurrency = 0) const;
+
+  /** @brief Get the manipulability index of each waypoint of \e trajectory, for the group of the trajectory */
+  bool getManipulabilityIndices(const robot_trajectory::RobotTrajectory& trajectory,
+                                std::vector<double>& manipulability_indices, bool translation = false,
+                                std::size_t max_concurrency = 0) const;
+
+  /**
+   * @brief Get the (translation) manipulability ellipsoid (see getManipulabilityEllipsoid()) of many states of the
+   * same group, evaluated in parallel
+   * @return False if the group is not a chain or the Jacobian of a state could not be computed
+   */
+  bool getManipulabilityEllipsoids(const std::vector<const moveit::core::RobotState*>& states,
+                                   const moveit::core::JointModelGroup* joint_model_group,
+                                   std::vector<Eigen::MatrixXcd>& eigen_values,
+                                   std::vector<Eigen::MatrixXcd>& eigen_vectors, std::size_t max_concurrency = 0) const;
+
+  /**
+   * @brief Get the manipulability = sigma_min/sigma_max (see getManipulability()) of many states of the same group,
+   * evaluated in parallel
+   * @return False if the group is not a chain or the Jacobian of a state could not be computed
+   */
+  bool getManipulabilities(const std::vector<const moveit::core::RobotState*>& states,
+                           const moveit::core::JointModelGroup* joint_model_group,
+                           std::vector<double>& manipulabilities, bool translation = false,
+                           std::size_t max_concurrency = 0) const;
+
+  /** @brief Get the manipulability = sigma_min/sigma_max of each waypoint of \e trajectory */
+  bool getManipulabilities(const robot_trajectory::RobotTrajectory& trajectory, std::vector<double>& manipulabilities,
+                           bool translation = false, std::size_t max_concurrency = 0) const;
+
   void setPenaltyMultiplier(double multiplier)
   {
     penalty_multiplier_ = fabs(multiplier);
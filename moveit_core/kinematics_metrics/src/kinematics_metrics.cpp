@@ -42,10 +42,111 @@
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace kinematics_metrics
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kinematics_metrics.kinematics_metrics");
 
+namespace
+{
+/** \brief Buffers reused for all states evaluated by one thread */
+struct MetricsWorkspace
+{
+  Eigen::MatrixXd jacobian;
+  Eigen::MatrixXd product;
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd;
+};
+
+/** \brief Manipulability index of workspace.jacobian, without the joint limits penalty */
+double computeManipulabilityIndex(MetricsWorkspace& workspace, bool translation)
+{
+  const Eigen::Index rows = translation ? 3 : workspace.jacobian.rows();
+  if (workspace.jacobian.cols() < 6)
+  {
+    workspace.svd.compute(workspace.jacobian.topRows(rows));
+    const Eigen::VectorXd& singular_values = workspace.svd.singularValues();
+    double manipulability_index = 1.0;
+    for (Eigen::Index i = 0; i < singular_values.rows(); ++i)
+    {
+      RCLCPP_DEBUG(LOGGER, "Singular value: %ld %f", static_cast<long>(i), singular_values(i));
+      manipulability_index *= singular_values(i);
+    }
+    return manipulability_index;
+  }
+  workspace.product.noalias() = workspace.jacobian.topRows(rows) * workspace.jacobian.topRows(rows).transpose();
+  return sqrt(workspace.product.determinant());
+}
+
+/** \brief Ratio of the smallest to the largest singular value of workspace.jacobian, without joint limits penalty */
+double computeConditionNumber(MetricsWorkspace& workspace, bool translation)
+{
+  workspace.svd.compute(workspace.jacobian.topRows(translation ? 3 : workspace.jacobian.rows()));
+  const Eigen::VectorXd& singular_values = workspace.svd.singularValues();
+  for (Eigen::Index i = 0; i < singular_values.rows(); ++i)
+  {
+    RCLCPP_DEBUG(LOGGER, "Singular value: %ld %f", static_cast<long>(i), singular_values(i));
+  }
+  return singular_values.minCoeff() / singular_values.maxCoeff();
+}
+
+void computeManipulabilityEllipsoid(MetricsWorkspace& workspace, Eigen::MatrixXcd& eigen_values,
+                                    Eigen::MatrixXcd& eigen_vectors)
+{
+  // only the translation part of JJ^T is needed
+  workspace.product.noalias() = workspace.jacobian.topRows(3) * workspace.jacobian.topRows(3).transpose();
+  Eigen::EigenSolver<Eigen::MatrixXd> eigensolver(workspace.product);
+  eigen_values = eigensolver.eigenvalues();
+  eigen_vectors = eigensolver.eigenvectors();
+}
+
+/** \brief Compute the Jacobian of each state into the workspace of the evaluating thread and call \e fn(i, workspace)
+    for it. States are distributed over up to \e max_concurrency threads (0 for the number of cores). Returns false if
+    a Jacobian could not be computed; the results of that state are left as they are. */
+template <typename Fn>
+bool forEachState(const std::vector<const moveit::core::RobotState*>& states,
+                  const moveit::core::JointModelGroup* joint_model_group, std::size_t max_concurrency, const Fn& fn)
+{
+  const moveit::core::LinkModel* tip = joint_model_group->getLinkModels().back();
+  std::atomic<std::size_t> next_state{ 0 };
+  std::atomic<bool> success{ true };
+  const auto evaluate_states = [&] {
+    MetricsWorkspace workspace;
+    for (std::size_t i = next_state++; i < states.size(); i = next_state++)
+    {
+      if (states[i]->getJacobian(joint_model_group, tip, Eigen::Vector3d::Zero(), workspace.jacobian))
+        fn(i, workspace);
+      else
+        success = false;
+    }
+  };
+
+  if (max_concurrency == 0)
+    max_concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+  const std::size_t thread_count = std::min(max_concurrency, states.size());
+
+  // the calling thread is one of the workers
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(evaluate_states);
+  evaluate_states();
+  for (std::thread& thread : threads)
+    thread.join();
+  return success;
+}
+
+std::vector<const moveit::core::RobotState*> getWayPointPointers(const robot_trajectory::RobotTrajectory& trajectory)
+{
+  std::vector<const moveit::core::RobotState*> states;
+  states.reserve(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    states.push_back(&trajectory.getWayPoint(i));
+  return states;
+}
+}  // namespace
+
 double KinematicsMetrics::getJointLimitsPenalty(const moveit::core::RobotState& state,
                                                 const moveit::core::JointModelGroup* joint_model_group) const
 {
@@ -115,54 +216,12 @@ bool KinematicsMetrics::getManipulabilityIndex(const moveit::core::RobotState& s
     return false;
   }
 
-  Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
+  MetricsWorkspace workspace;
+  workspace.jacobian = state.getJacobian(joint_model_group);
   // Get joint limits penalty
   double penalty = getJointLimitsPenalty(state, joint_model_group);
-  if (translation)
-  {
-    if (jacobian.cols() < 6)
-    {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian.topLeftCorner(3, jacobian.cols()));
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
-    else
-    {
-      Eigen::MatrixXd jacobian_2 = jacobian.topLeftCorner(3, jacobian.cols());
-      Eigen::MatrixXd matrix = jacobian_2 * jacobian_2.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
-    }
-  }
-  else
-  {
-    if (jacobian.cols() < 6)
-    {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian);
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
-    else
-    {
-      Eigen::MatrixXd matrix = jacobian * jacobian.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
-    }
-  }
+  // Get manipulability index
+  manipulability_index = penalty * computeManipulabilityIndex(workspace, translation);
   return true;
 }
 
@@ -188,11 +247,9 @@ bool KinematicsMetrics::getManipulabilityEllipsoid(const moveit::core::RobotStat
     return false;
   }
 
-  Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
-  Eigen::MatrixXd matrix = jacobian * jacobian.transpose();
-  Eigen::EigenSolver<Eigen::MatrixXd> eigensolver(matrix.block(0, 0, 3, 3));
-  eigen_values = eigensolver.eigenvalues();
-  eigen_vectors = eigensolver.eigenvectors();
+  MetricsWorkspace workspace;
+  workspace.jacobian = state.getJacobian(joint_model_group);
+  computeManipulabilityEllipsoid(workspace, eigen_values, eigen_vectors);
   return true;
 }
 
@@ -215,32 +272,78 @@ bool KinematicsMetrics::getManipulability(const moveit::core::RobotState& state,
   {
     return false;
   }
+  MetricsWorkspace workspace;
+  workspace.jacobian = state.getJacobian(joint_model_group);
   // Get joint limits penalty
   double penalty = getJointLimitsPenalty(state, joint_model_group);
-  if (translation)
-  {
-    Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
-    Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian.topLeftCorner(3, jacobian.cols()));
-    Eigen::MatrixXd singular_values = svdsolver.singularValues();
-    for (int i = 0; i < singular_values.rows(); ++i)
-    {
-      RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-    }
-
-    manipulability = penalty * singular_values.minCoeff() / singular_values.maxCoeff();
-  }
-  else
-  {
-    Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
-    Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian);
-    Eigen::MatrixXd singular_values = svdsolver.singularValues();
-    for (int i = 0; i < singular_values.rows(); ++i)
-    {
-      RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-    }
-    manipulability = penalty * singular_values.minCoeff() / singular_values.maxCoeff();
-  }
+  manipulability = penalty * computeConditionNumber(workspace, translation);
   return true;
 }
 
+bool KinematicsMetrics::getManipulabilityIndices(const std::vector<const moveit::core::RobotState*>& states,
+                                                 const moveit::core::JointModelGroup* joint_model_group,
+                                                 std::vector<double>& manipulability_indices, bool translation,
+                                                 std::size_t max_concurrency) const
+{
+  if (!joint_model_group->isChain())
+    return false;
+  manipulability_indices.resize(states.size());
+  return forEachState(states, joint_model_group, max_concurrency,
+                      [&](std::size_t i, MetricsWorkspace& workspace) {
+                        manipulability_indices[i] = getJointLimitsPenalty(*states[i], joint_model_group) *
+                                                    computeManipulabilityIndex(workspace, translation);
+                      });
+}
+
+bool KinematicsMetrics::getManipulabilityIndices(const robot_trajectory::RobotTrajectory& trajectory,
+                                                 std::vector<double>& manipulability_indices, bool translation,
+                                                 std::size_t max_concurrency) const
+{
+  if (!trajectory.getGroup())
+    return false;
+  return getManipulabilityIndices(getWayPointPointers(trajectory), trajectory.getGroup(), manipulability_indices,
+                                  translation, max_concurrency);
+}
+
+bool KinematicsMetrics::getManipulabilityEllipsoids(const std::vector<const moveit::core::RobotState*>& states,
+                                                    const moveit::core::JointModelGroup* joint_model_group,
+                                                    std::vector<Eigen::MatrixXcd>& eigen_values,
+                                                    std::vector<Eigen::MatrixXcd>& eigen_vectors,
+                                                    std::size_t max_concurrency) const
+{
+  if (!joint_model_group->isChain())
+    return false;
+  eigen_values.resize(states.size());
+  eigen_vectors.resize(states.size());
+  return forEachState(states, joint_model_group, max_concurrency,
+                      [&](std::size_t i, MetricsWorkspace& workspace) {
+                        computeManipulabilityEllipsoid(workspace, eigen_values[i], eigen_vectors[i]);
+                      });
+}
+
+bool KinematicsMetrics::getManipulabilities(const std::vector<const moveit::core::RobotState*>& states,
+                                            const moveit::core::JointModelGroup* joint_model_group,
+                                            std::vector<double>& manipulabilities, bool translation,
+                                            std::size_t max_concurrency) const
+{
+  if (!joint_model_group->isChain())
+    return false;
+  manipulabilities.resize(states.size());
+  return forEachState(states, joint_model_group, max_concurrency,
+                      [&](std::size_t i, MetricsWorkspace& workspace) {
+                        manipulabilities[i] = getJointLimitsPenalty(*states[i], joint_model_group) *
+                                              computeConditionNumber(workspace, translation);
+                      });
+}
+
+bool KinematicsMetrics::getManipulabilities(const robot_trajectory::RobotTrajectory& trajectory,
+                                            std::vector<double>& manipulabilities, bool translation,
+                                            std::size_t max_concurrency) const
+{
+  if (!trajectory.getGroup())
+    return false;
+  return getManipulabilities(getWayPointPointers(trajectory), trajectory.getGroup(), manipulabilities, translation,
+                             max_concurrency);
+}
+
 }  // end of namespace kinematics_metrics
@@ -38,7 +38,11 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <optional>
+
+#include <Eigen/Core>
 
 // Auto-generated
 #include <moveit_core/moveit_butterworth_parameters.hpp>
@@ -78,6 +82,47 @@ private:
   double feedback_term_;
 };
 
+/**
+ * Class MultiChannelButterworthFilter - Butterworth low-pass filter of several signals at once, e.g. of all joints.
+ * The histories of all channels are stored in contiguous arrays, so one step updates all channels in a single
+ * vectorized pass. The filters are designed with the bilinear transform for the cutoff frequency given by the
+ * filter coefficient, like ButterworthFilter, with which the first order filter is identical. The second order
+ * filter attenuates high frequencies faster, but overshoots a step by about 4%.
+ */
+class MultiChannelButterworthFilter
+{
+public:
+  /**
+   * Constructor.
+   * @param low_pass_filter_coeff Larger filter_coeff-> more smoothing of servo commands, but more lag.
+   * @param num_channels Number of signals that are filtered together
+   * @param order Order of the filter, 1 or 2
+   */
+  MultiChannelButterworthFilter(double low_pass_filter_coeff, std::size_t num_channels, std::size_t order = 1);
+  MultiChannelButterworthFilter() = delete;
+
+  /** \brief Replace the measurements of all channels with their filtered values */
+  void filter(Eigen::Ref<Eigen::ArrayXd> measurements);
+
+  /** \brief Reset the history of all channels to the given values */
+  void reset(const Eigen::Ref<const Eigen::ArrayXd>& data);
+
+  std::size_t size() const
+  {
+    return static_cast<std::size_t>(previous_measurements_.rows());
+  }
+
+private:
+  std::size_t order_;
+  // Coefficients of y[k] = b0 x[k] + b1 x[k-1] + b2 x[k-2] - a1 y[k-1] - a2 y[k-2]
+  std::array<double, 3> b_;
+  std::array<double, 3> a_;
+  // Column i holds the values of all channels i + 1 steps ago
+  Eigen::ArrayX2d previous_measurements_;
+  Eigen::ArrayX2d previous_filtered_measurements_;
+  Eigen::ArrayXd filtered_measurements_;
+};
+
 // Plugin
 class ButterworthFilterPlugin : public SmoothingBaseClass
 {
@@ -108,7 +153,8 @@ public:
 
 private:
   rclcpp::Node::SharedPtr node_;
-  std::vector<ButterworthFilter> position_filters_;
+  // All joints are filtered in one pass
+  std::optional<MultiChannelButterworthFilter> position_filter_;
   size_t num_joints_;
 };
 }  // namespace online_signal_smoothing
@@ -40,6 +40,9 @@
 #include <rclcpp/clock.hpp>
 #include <rclcpp/logging.hpp>
 
+#include <cmath>
+#include <stdexcept>
+
 namespace online_signal_smoothing
 {
 namespace
@@ -91,52 +94,111 @@ void ButterworthFilter::reset(const double data)
   previous_filtered_measurement_ = data;
 }
 
+MultiChannelButterworthFilter::MultiChannelButterworthFilter(double low_pass_filter_coeff, std::size_t num_channels,
+                                                             std::size_t order)
+  : order_(order)
+  , b_{ 0., 0., 0. }
+  , a_{ 1., 0., 0. }
+  , previous_measurements_(Eigen::ArrayX2d::Zero(num_channels, 2))
+  , previous_filtered_measurements_(Eigen::ArrayX2d::Zero(num_channels, 2))
+  , filtered_measurements_(Eigen::ArrayXd::Zero(num_channels))
+{
+  if (low_pass_filter_coeff < 1)
+    throw std::length_error("online_signal_smoothing::MultiChannelButterworthFilter: Filter coefficient < 1. makes "
+                            "the lowpass filter unstable");
+
+  // The filter coefficient is cot(pi * cutoff / sampling frequency)
+  const double k = 1. / low_pass_filter_coeff;
+  if (order_ == 1)
+  {
+    if (std::abs(1. - low_pass_filter_coeff) < EPSILON)
+      throw std::length_error("online_signal_smoothing::MultiChannelButterworthFilter: Filter coefficient value "
+                              "resulted in feedback term of 0");
+    b_[0] = k / (1. + k);
+    b_[1] = b_[0];
+    a_[1] = (k - 1.) / (1. + k);
+  }
+  else if (order_ == 2)
+  {
+    const double norm = 1. + std::sqrt(2.) * k + k * k;
+    b_[0] = k * k / norm;
+    b_[1] = 2. * b_[0];
+    b_[2] = b_[0];
+    a_[1] = 2. * (k * k - 1.) / norm;
+    a_[2] = (1. - std::sqrt(2.) * k + k * k) / norm;
+  }
+  else
+  {
+    throw std::invalid_argument("online_signal_smoothing::MultiChannelButterworthFilter: Only first and second order "
+                                "filters are supported");
+  }
+}
+
+void MultiChannelButterworthFilter::filter(Eigen::Ref<Eigen::ArrayXd> measurements)
+{
+  if (order_ == 1)
+  {
+    filtered_measurements_ = b_[0] * measurements + b_[1] * previous_measurements_.col(0) -
+                             a_[1] * previous_filtered_measurements_.col(0);
+  }
+  else
+  {
+    filtered_measurements_ = b_[0] * measurements + b_[1] * previous_measurements_.col(0) +
+                             b_[2] * previous_measurements_.col(1) - a_[1] * previous_filtered_measurements_.col(0) -
+                             a_[2] * previous_filtered_measurements_.col(1);
+    previous_measurements_.col(1) = previous_measurements_.col(0);
+    previous_filtered_measurements_.col(1) = previous_filtered_measurements_.col(0);
+  }
+  previous_measurements_.col(0) = measurements;
+  previous_filtered_measurements_.col(0) = filtered_measurements_;
+  measurements = filtered_measurements_;
+}
+
+void MultiChannelButterworthFilter::reset(const Eigen::Ref<const Eigen::ArrayXd>& data)
+{
+  previous_measurements_.colwise() = data;
+  previous_filtered_measurements_.colwise() = data;
+}
+
 bool ButterworthFilterPlugin::initialize(rclcpp::Node::SharedPtr node, moveit::core::RobotModelConstPtr /* unused */,
                                          size_t num_joints)
 {
   node_ = node;
   num_joints_ = num_joints;
   double filter_coeff = 1.5;
+  std::size_t filter_order = 1;
   {
     online_signal_smoothing::ParamListener param_listener(node_);
     filter_coeff = param_listener.get_params().butterworth_filter_coeff;
+    filter_order = static_cast<std::size_t>(param_listener.get_params().butterworth_filter_order);
   }
 
-  for (std::size_t i = 0; i < num_joints_; ++i)
-  {
-    position_filters_.emplace_back(filter_coeff);
-  }
+  position_filter_.emplace(filter_coeff, num_joints_, filter_order);
   return true;
 };
 
 bool ButterworthFilterPlugin::doSmoothing(std::vector<double>& position_vector)
 {
-  if (position_vector.size() != position_filters_.size())
+  if (position_vector.size() != position_filter_->size())
   {
     RCLCPP_ERROR_THROTTLE(node_->get_logger(), *node_->get_clock(), 1000,
                           "Position vector to be smoothed does not have the right length.");
     return false;
   }
-  for (size_t i = 0; i < position_vector.size(); ++i)
-  {
-    // Lowpass filter the position command
-    position_vector[i] = position_filters_.at(i).filter(position_vector[i]);
-  }
+  // Lowpass filter the position commands
+  position_filter_->filter(Eigen::Map<Eigen::ArrayXd>(position_vector.data(), position_vector.size()));
   return true;
 };
 
 bool ButterworthFilterPlugin::reset(const std::vector<double>& joint_positions)
 {
-  if (joint_positions.size() != position_filters_.size())
+  if (joint_positions.size() != position_filter_->size())
   {
     RCLCPP_ERROR_THROTTLE(node_->get_logger(), *node_->get_clock(), 1000,
                           "Position vector to be reset does not have the right length.");
     return false;
   }
-  for (size_t joint_idx = 0; joint_idx < joint_positions.size(); ++joint_idx)
-  {
-    position_filters_.at(joint_idx).reset(joint_positions.at(joint_idx));
-  }
+  position_filter_->reset(Eigen::Map<const Eigen::ArrayXd>(joint_positions.data(), joint_positions.size()));
   return true;
 };
 
@@ -71,3 +71,45 @@ TEST(SMOOTHING_PLUGINS, FilterReset)
   // Then check that a different measurement changes the value
   EXPECT_NE(5.0, lpf.filter(100.0));
 }
+
+TEST(SMOOTHING_PLUGINS, MultiChannelMatchesSingleChannel)
+{
+  online_signal_smoothing::ButterworthFilter lpf_a(2.0);
+  online_signal_smoothing::ButterworthFilter lpf_b(2.0);
+  online_signal_smoothing::MultiChannelButterworthFilter multi_lpf(2.0, 2);
+  for (size_t i = 0; i < 20; ++i)
+  {
+    Eigen::ArrayXd values(2);
+    values << static_cast<double>(i), -3.0 * static_cast<double>(i % 3);
+    const double expected_a = lpf_a.filter(values[0]);
+    const double expected_b = lpf_b.filter(values[1]);
+    multi_lpf.filter(values);
+    EXPECT_NEAR(expected_a, values[0], 1e-12);
+    EXPECT_NEAR(expected_b, values[1], 1e-12);
+  }
+}
+
+TEST(SMOOTHING_PLUGINS, SecondOrderFilterConverge)
+{
+  online_signal_smoothing::MultiChannelButterworthFilter lpf(2.0, 3, 2);
+  Eigen::ArrayXd values = Eigen::ArrayXd::Zero(3);
+  lpf.filter(values);
+  EXPECT_TRUE((values == 0.0).all());
+
+  for (size_t i = 0; i < 200; ++i)
+  {
+    values.setConstant(5.0);
+    lpf.filter(values);
+  }
+  // Check that the filter converges to expected value after many identical messages
+  EXPECT_NEAR(5.0, values[0], 1e-9);
+  EXPECT_NEAR(5.0, values[2], 1e-9);
+
+  // Reset sets the steady state
+  lpf.reset(Eigen::ArrayXd::Constant(3, -1.0));
+  values.setConstant(-1.0);
+  lpf.filter(values);
+  EXPECT_DOUBLE_EQ(-1.0, values[1]);
+
+  EXPECT_THROW(online_signal_smoothing::MultiChannelButterworthFilter(2.0, 3, 3), std::invalid_argument);
+}
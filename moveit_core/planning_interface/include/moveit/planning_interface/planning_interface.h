@@ -39,6 +39,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/planning_interface/planning_request.h>
 #include <moveit/planning_interface/planning_response.h>
+#include <moveit/utils/memory_usage.h>
 #include <rclcpp/node.hpp>
 #include <string>
 #include <map>
@@ -204,6 +205,12 @@ public:
 
   virtual void getRoadmapData(int &verts, int &edges) { verts = 0; edges = 0; }
 
+  /// \brief Estimate the memory held by the planner between requests, e.g. cached contexts and roadmaps
+  virtual moveit::MemoryUsage getMemoryUsage() const
+  {
+    return moveit::MemoryUsage();
+  }
+
   /// \brief Request termination, if a solve() function is currently computing plans
   void terminate() const;
 
@@ -55,6 +55,21 @@ public:
       std::function<bool(const planning_scene::PlanningSceneConstPtr&, const planning_interface::MotionPlanRequest&,
                          planning_interface::MotionPlanResponse&)>;
 
+  /** \brief Where an adapter does its work, relative to the planner.
+   *
+   * A PlanningRequestAdapterChain runs adapters that only change the request (PRE_PLANNING) or only process the
+   * response (POST_PLANNING) as flat stages on a single copy of the request, instead of nesting them around the
+   * planner like WRAP_PLANNER adapters. */
+  enum class Stage
+  {
+    /// the adapter wraps the planner in adaptAndPlan(), e.g. because it adds states to the solution path
+    WRAP_PLANNER,
+    /// the adapter only changes the request before planning, in adaptRequest()
+    PRE_PLANNING,
+    /// the adapter only processes successful responses after planning, in adaptResponse()
+    POST_PLANNING
+  };
+
   PlanningRequestAdapter()
   {
   }
@@ -73,6 +88,28 @@ public:
     return "";
   }
 
+  /// Get where the adapter does its work, see Stage. Defaults to Stage::WRAP_PLANNER.
+  virtual Stage getStage() const
+  {
+    return Stage::WRAP_PLANNER;
+  }
+
+  /** \brief Adapt \e req in place before planning, for Stage::PRE_PLANNING adapters. Return false to fail planning. */
+  virtual bool adaptRequest(const planning_scene::PlanningSceneConstPtr& /* planning_scene */,
+                            planning_interface::MotionPlanRequest& /* req */) const
+  {
+    return true;
+  }
+
+  /** \brief Process the successful response \e res to \e req in place, for Stage::POST_PLANNING adapters. Return false
+   * to fail planning. */
+  virtual bool adaptResponse(const planning_scene::PlanningSceneConstPtr& /* planning_scene */,
+                             const planning_interface::MotionPlanRequest& /* req */,
+                             planning_interface::MotionPlanResponse& /* res */) const
+  {
+    return true;
+  }
+
   bool adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
                     const planning_scene::PlanningSceneConstPtr& planning_scene,
                     const planning_interface::MotionPlanRequest& req,
@@ -87,11 +124,13 @@ public:
       function \e planner and update the planning response if
       needed. If the response is changed, the index values of the
       states added without planning are added to \e
-      added_path_index */
+      added_path_index. Adapters of Stage::PRE_PLANNING and
+      Stage::POST_PLANNING need not override this, it calls
+      adaptRequest() or adaptResponse() by default. */
   virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
                             const planning_interface::MotionPlanRequest& req,
                             planning_interface::MotionPlanResponse& res,
-                            std::vector<std::size_t>& added_path_index) const = 0;
+                            std::vector<std::size_t>& added_path_index) const;
 
 protected:
   /** \brief Helper param for getting a parameter using a namespace **/
@@ -139,6 +178,13 @@ public:
                     std::vector<std::size_t>& added_path_index) const;
 
 private:
+  /** \brief Run the adapters from \e first on, and eventually the planner. Consecutive adapters of Stage::PRE_PLANNING
+   * and Stage::POST_PLANNING run as flat stages, the others are nested around the rest of the chain. */
+  bool adaptAndPlan(std::size_t first, const planning_interface::PlannerManager& planner,
+                    const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                    std::vector<std::vector<std::size_t> >& added_path_index_each) const;
+
   std::vector<PlanningRequestAdapterConstPtr> adapters_;
 };
 }  // namespace planning_request_adapter
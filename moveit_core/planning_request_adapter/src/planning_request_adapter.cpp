@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/utils/tracing.h>
 #include <rclcpp/logger.hpp>
 #include <functional>
 #include <algorithm>
@@ -50,9 +51,16 @@ bool callPlannerInterfaceSolve(const planning_interface::PlannerManager& planner
                                const planning_interface::MotionPlanRequest& req,
                                planning_interface::MotionPlanResponse& res)
 {
-  planning_interface::PlanningContextPtr context = planner.getPlanningContext(planning_scene, req, res.error_code_);
+  planning_interface::PlanningContextPtr context;
+  {
+    moveit::tracing::ScopedSpan span("getPlanningContext");
+    context = planner.getPlanningContext(planning_scene, req, res.error_code_);
+  }
   if (context)
+  {
+    moveit::tracing::ScopedSpan span("PlanningContext::solve");
     return context->solve(res);
+  }
   else
     return false;
 }
@@ -62,6 +70,7 @@ bool callAdapter(const PlanningRequestAdapter& adapter, const PlanningRequestAda
                  const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                  std::vector<std::size_t>& added_path_index)
 {
+  moveit::tracing::ScopedSpan span(adapter.getDescription());
   try
   {
     return adapter.adaptAndPlan(planner, planning_scene, req, res, added_path_index);
@@ -75,8 +84,71 @@ bool callAdapter(const PlanningRequestAdapter& adapter, const PlanningRequestAda
   }
 }
 
+bool callAdaptRequest(const PlanningRequestAdapter& adapter,
+                      const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      planning_interface::MotionPlanRequest& req)
+{
+  moveit::tracing::ScopedSpan span(adapter.getDescription());
+  try
+  {
+    return adapter.adaptRequest(planning_scene, req);
+  }
+  catch (std::exception& ex)
+  {
+    RCLCPP_ERROR(LOGGER, "Exception caught executing adapter '%s': %s\nSkipping adapter instead.",
+                 adapter.getDescription().c_str(), ex.what());
+    return true;
+  }
+}
+
+bool callAdaptResponse(const PlanningRequestAdapter& adapter,
+                       const planning_scene::PlanningSceneConstPtr& planning_scene,
+                       const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res)
+{
+  moveit::tracing::ScopedSpan span(adapter.getDescription());
+  try
+  {
+    return adapter.adaptResponse(planning_scene, req, res);
+  }
+  catch (std::exception& ex)
+  {
+    RCLCPP_ERROR(LOGGER, "Exception caught executing adapter '%s': %s\nSkipping adapter instead.",
+                 adapter.getDescription().c_str(), ex.what());
+    return true;
+  }
+}
+
 }  // namespace
 
+bool PlanningRequestAdapter::adaptAndPlan(const PlannerFn& planner,
+                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_interface::MotionPlanRequest& req,
+                                          planning_interface::MotionPlanResponse& res,
+                                          std::vector<std::size_t>& /*added_path_index*/) const
+{
+  switch (getStage())
+  {
+    case Stage::PRE_PLANNING:
+    {
+      planning_interface::MotionPlanRequest adapted_req = req;
+      if (!callAdaptRequest(*this, planning_scene, adapted_req))
+        return false;
+      return planner(planning_scene, adapted_req, res);
+    }
+    case Stage::POST_PLANNING:
+    {
+      bool result = planner(planning_scene, req, res);
+      if (result && res.trajectory_)
+        result = callAdaptResponse(*this, planning_scene, req, res);
+      return result;
+    }
+    default:
+      RCLCPP_ERROR(LOGGER, "Adapter '%s' wraps the planner but does not implement adaptAndPlan()",
+                   getDescription().c_str());
+      return planner(planning_scene, req, res);
+  }
+}
+
 bool PlanningRequestAdapter::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
                                           const planning_scene::PlanningSceneConstPtr& planning_scene,
                                           const planning_interface::MotionPlanRequest& req,
@@ -126,25 +198,7 @@ bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::Planner
     // the index values added by each adapter
     std::vector<std::vector<std::size_t> > added_path_index_each(adapters_.size());
 
-    // if there are adapters, construct a function for each, in order,
-    // so that in the end we have a nested sequence of functions that calls all adapters
-    // and eventually the planner in the correct order.
-    PlanningRequestAdapter::PlannerFn fn = [&planner = *planner](const planning_scene::PlanningSceneConstPtr& scene,
-                                                                 const planning_interface::MotionPlanRequest& req,
-                                                                 planning_interface::MotionPlanResponse& res) {
-      return callPlannerInterfaceSolve(planner, scene, req, res);
-    };
-
-    for (int i = adapters_.size() - 1; i >= 0; --i)
-    {
-      fn = [&adapter = *adapters_[i], fn, &added_path_index = added_path_index_each[i]](
-               const planning_scene::PlanningSceneConstPtr& scene, const planning_interface::MotionPlanRequest& req,
-               planning_interface::MotionPlanResponse& res) {
-        return callAdapter(adapter, fn, scene, req, res, added_path_index);
-      };
-    }
-
-    bool result = fn(planning_scene, req, res);
+    bool result = adaptAndPlan(0, *planner, planning_scene, req, res, added_path_index_each);
     added_path_index.clear();
 
     // merge the index values from each adapter
@@ -161,4 +215,53 @@ bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::Planner
   }
 }
 
+bool PlanningRequestAdapterChain::adaptAndPlan(std::size_t first, const planning_interface::PlannerManager& planner,
+                                               const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                               const planning_interface::MotionPlanRequest& req,
+                                               planning_interface::MotionPlanResponse& res,
+                                               std::vector<std::vector<std::size_t> >& added_path_index_each) const
+{
+  if (first == adapters_.size())
+    return callPlannerInterfaceSolve(planner, planning_scene, req, res);
+
+  const auto stage_of = [this](std::size_t i) { return adapters_[i]->getStage(); };
+  std::size_t last = first + 1;
+  switch (stage_of(first))
+  {
+    case PlanningRequestAdapter::Stage::PRE_PLANNING:
+    {
+      // adapt a single copy of the request with all consecutive pre-planning adapters, in order
+      while (last < adapters_.size() && stage_of(last) == PlanningRequestAdapter::Stage::PRE_PLANNING)
+        ++last;
+      planning_interface::MotionPlanRequest adapted_req = req;
+      for (std::size_t i = first; i < last; ++i)
+      {
+        if (!callAdaptRequest(*adapters_[i], planning_scene, adapted_req))
+          return false;
+      }
+      return adaptAndPlan(last, planner, planning_scene, adapted_req, res, added_path_index_each);
+    }
+    case PlanningRequestAdapter::Stage::POST_PLANNING:
+    {
+      // process the response with all consecutive post-planning adapters, innermost first as if they were nested
+      while (last < adapters_.size() && stage_of(last) == PlanningRequestAdapter::Stage::POST_PLANNING)
+        ++last;
+      bool result = adaptAndPlan(last, planner, planning_scene, req, res, added_path_index_each);
+      for (std::size_t i = last; i-- > first && result && res.trajectory_;)
+        result = callAdaptResponse(*adapters_[i], planning_scene, req, res);
+      return result;
+    }
+    default:
+    {
+      const PlanningRequestAdapter::PlannerFn fn = [this, last, &planner, &added_path_index_each](
+                                                       const planning_scene::PlanningSceneConstPtr& scene,
+                                                       const planning_interface::MotionPlanRequest& req,
+                                                       planning_interface::MotionPlanResponse& res) {
+        return adaptAndPlan(last, planner, scene, req, res, added_path_index_each);
+      };
+      return callAdapter(*adapters_[first], fn, planning_scene, req, res, added_path_index_each[first]);
+    }
+  }
+}
+
 }  // end of namespace planning_request_adapter
@@ -0,0 +1,124 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <geometric_shapes/shapes.h>
+#include <shape_msgs/msg/mesh.hpp>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <moveit_planning_scene_export.h>
+
+namespace planning_scene
+{
+/** \brief Counters of a MeshCache, used to tune its capacity */
+struct MeshCacheStatistics
+{
+  /** \brief Number of lookups which found an identical mesh */
+  std::size_t hits{ 0 };
+
+  /** \brief Number of lookups which had to decode the mesh */
+  std::size_t misses{ 0 };
+
+  /** \brief Number of meshes dropped because the capacity was reached */
+  std::size_t evictions{ 0 };
+
+  /** \brief Number of meshes currently stored */
+  std::size_t size{ 0 };
+};
+
+/** \brief Least recently used cache of meshes decoded from shape_msgs::msg::Mesh, keyed by their content.
+ *
+ *  Messages with identical vertices and triangles are decoded only once and map to the same shapes::Mesh instance.
+ *  As the collision detectors cache their collision geometry per shape instance, this also avoids rebuilding the
+ *  bounding volume hierarchy of a mesh which is added again, e.g. with a new id or pose. The cache is thread-safe. */
+class MOVEIT_PLANNING_SCENE_EXPORT MeshCache
+{
+public:
+  /** \brief Construct a cache holding at most \e capacity meshes. A capacity of 0 disables the cache. */
+  explicit MeshCache(std::size_t capacity = 256);
+
+  /** \brief The cache shared by all planning scenes of the process */
+  static MeshCache& getGlobal();
+
+  /** \brief Get the mesh described by \e msg, decoding it only if no identical mesh is stored.
+   *  Returns nullptr if the message does not describe a valid mesh. */
+  shapes::ShapeConstPtr getMesh(const shape_msgs::msg::Mesh& msg);
+
+  /** \brief Change the maximum number of meshes, evicting the least recently used ones if needed */
+  void setCapacity(std::size_t capacity);
+
+  std::size_t getCapacity() const;
+
+  /** \brief Remove all meshes. Shapes handed out before remain valid. The statistics are kept. */
+  void clear();
+
+  MeshCacheStatistics getStatistics() const;
+
+  /** \brief Estimate the number of bytes held by the stored meshes, including the ones still used by scenes */
+  std::size_t getMemoryUsage() const;
+
+  /** \brief Reset the hit, miss and eviction counters */
+  void resetStatistics();
+
+private:
+  struct Entry
+  {
+    std::size_t hash;
+    std::shared_ptr<const shapes::Mesh> mesh;
+  };
+
+  /** \brief Hash of the vertices and triangles of \e msg */
+  static std::size_t hashMesh(const shape_msgs::msg::Mesh& msg);
+
+  /** \brief Check whether \e mesh was decoded from a message with the same content as \e msg */
+  static bool isSameMesh(const shapes::Mesh& mesh, const shape_msgs::msg::Mesh& msg);
+
+  /** \brief Drop least recently used entries until at most \e capacity_ remain */
+  void evict();
+
+  mutable std::mutex lock_;
+
+  std::size_t capacity_;
+
+  /** \brief Entries ordered from most to least recently used */
+  std::list<Entry> lru_;
+  std::unordered_multimap<std::size_t, std::list<Entry>::iterator> entries_;
+
+  MeshCacheStatistics statistics_;
+};
+}  // namespace planning_scene
@@ -46,6 +46,7 @@
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/macros/class_forward.h>
+#include <moveit/planning_scene/state_validity_cache.h>
 #include <moveit_msgs/msg/planning_scene.hpp>
 #include <moveit_msgs/msg/robot_trajectory.hpp>
 #include <moveit_msgs/msg/constraints.hpp>
@@ -235,6 +236,43 @@ public:
    * body id or a collision object */
   bool knowsFrameTransform(const moveit::core::RobotState& state, const std::string& id) const;
 
+  /** \brief Resolve the frame \e id once, for repeated calls to getFrameTransform() that should not look the name up
+      again. Robot links and fixed transforms are then found by index; attached bodies, collision objects and their
+      subframes can change at any time and are still looked up by name. The handle is not valid if
+      knowsFrameTransform(id) is false. */
+  moveit::core::FrameHandle getFrameHandle(const std::string& id) const;
+
+  /** \brief Get the transform corresponding to a frame resolved with getFrameHandle().
+      Return identity when no transform is available. */
+  const Eigen::Isometry3d& getFrameTransform(const moveit::core::FrameHandle& frame) const
+  {
+    return getFrameTransform(getCurrentState(), frame);
+  }
+
+  /** \brief Get the transform corresponding to a frame resolved with getFrameHandle().
+      Return identity when no transform is available.
+      Because this function is non-const, the current state transforms are also updated, if needed. */
+  const Eigen::Isometry3d& getFrameTransform(const moveit::core::FrameHandle& frame)
+  {
+    if (getCurrentState().dirtyLinkTransforms())
+      return getFrameTransform(getCurrentStateNonConst(), frame);
+    return getFrameTransform(getCurrentState(), frame);
+  }
+
+  /** \brief Get the transform corresponding to a frame resolved with getFrameHandle().
+      Return identity when no transform is available. This function also updates the link transforms of \e state. */
+  const Eigen::Isometry3d& getFrameTransform(moveit::core::RobotState& state,
+                                             const moveit::core::FrameHandle& frame) const
+  {
+    state.updateLinkTransforms();
+    return getFrameTransform(static_cast<const moveit::core::RobotState&>(state), frame);
+  }
+
+  /** \brief Get the transform corresponding to a frame resolved with getFrameHandle().
+      Return identity when no transform is available. */
+  const Eigen::Isometry3d& getFrameTransform(const moveit::core::RobotState& state,
+                                             const moveit::core::FrameHandle& frame) const;
+
   /**@}*/
 
   /**
@@ -296,6 +334,54 @@ public:
 
   /**@}*/
 
+  /**
+   * \name Versions of the scene components
+   *
+   * Each version changes whenever the component may have changed and is unique among all scenes in the process, so
+   * that results computed for a scene can be reused as long as the versions of the components they depend on match.
+   * Components obtained from one of the get*NonConst() functions count as changed when they are requested, so
+   * references to them must not be kept across reuses of results.
+   */
+  /**@{*/
+
+  /** \brief Get the version of the world, see collision_detection::World::getVersion() */
+  std::size_t getWorldVersion() const
+  {
+    return world_->getVersion();
+  }
+
+  /** \brief Get the version of the current state, including its attached bodies */
+  std::size_t getCurrentStateVersion() const
+  {
+    return robot_state_ ? state_version_ : parent_->getCurrentStateVersion();
+  }
+
+  /** \brief Get the version of the fixed transforms */
+  std::size_t getTransformsVersion() const
+  {
+    return scene_transforms_ || !parent_ ? transforms_version_ : parent_->getTransformsVersion();
+  }
+
+  /** \brief Get the version of the allowed collision matrix */
+  std::size_t getAllowedCollisionMatrixVersion() const
+  {
+    return acm_ ? acm_version_ : parent_->getAllowedCollisionMatrixVersion();
+  }
+
+  /** \brief Get the version of the collision environments, which changes with their padding and scaling */
+  std::size_t getCollisionEnvVersion() const
+  {
+    return collision_env_version_;
+  }
+
+  /** \brief Get the version of the state feasibility predicate */
+  std::size_t getStateFeasibilityVersion() const
+  {
+    return feasibility_version_;
+  }
+
+  /**@}*/
+
   /**
    * \name Collision checking with respect to this planning scene
    */
@@ -646,6 +732,22 @@ public:
   /** \brief Load the geometry of the planning scene from a stream at a certain location using offset*/
   bool loadGeometryFromStream(std::istream& in, const Eigen::Isometry3d& offset);
 
+  /** \brief Save the complete scene (world objects, octomap, allowed collision matrix, robot state with attached
+      bodies, object colors and types) to a stream in the compressed binary snapshot format.
+
+      Unlike saveGeometryToStream(), the snapshot is lossless and fast to restore. Meshes used by several objects are
+      stored only once. The format is versioned; loading rejects snapshots of other versions. */
+  bool saveSnapshotToStream(std::ostream& out) const;
+
+  /** \brief Save the scene to the file \e file_name, see saveSnapshotToStream() */
+  bool saveSnapshotToFile(const std::string& file_name) const;
+
+  /** \brief Replace the scene by a snapshot written by saveSnapshotToStream(), as setPlanningSceneMsg() would */
+  bool loadSnapshotFromStream(std::istream& in);
+
+  /** \brief Replace the scene by the snapshot in the file \e file_name, which is memory-mapped rather than read */
+  bool loadSnapshotFromFile(const std::string& file_name);
+
   /** \brief Fill the message \e scene with the differences between this instance of PlanningScene with respect to the
      parent.
       If there is no parent, everything is considered to be a diff and the function behaves like getPlanningSceneMsg()
@@ -711,6 +813,16 @@ public:
                                                 EigenSTL::vector_Isometry3d& shape_poses);
 
   bool processCollisionObjectMsg(const moveit_msgs::msg::CollisionObject& object);
+
+  /** \brief Process a sequence of collision object messages, in order.
+   *
+   *  The result is the same as calling processCollisionObjectMsg() for each of them, but the shapes of the objects to
+   *  add are constructed on multiple threads first, which speeds up loading large scenes.
+   *  \param thread_count The number of threads to use; 0 selects the number of hardware threads
+   *  \return false if any of the messages could not be processed */
+  bool processCollisionObjectMsgs(const std::vector<moveit_msgs::msg::CollisionObject>& objects,
+                                  unsigned int thread_count = 0);
+
   bool processAttachedCollisionObjectMsg(const moveit_msgs::msg::AttachedCollisionObject& object);
 
   bool processPlanningSceneWorldMsg(const moveit_msgs::msg::PlanningSceneWorld& world);
@@ -774,6 +886,7 @@ public:
   void setStateFeasibilityPredicate(const StateFeasibilityFn& fn)
   {
     state_feasibility_ = fn;
+    feasibility_version_ = nextVersion();
   }
 
   /** \brief Get the predicate that decides whether states are considered valid or invalid for reasons beyond ones
@@ -828,6 +941,25 @@ public:
   /** \brief Check if a given state is valid. This means checking for collisions and feasibility */
   bool isStateValid(const moveit::core::RobotState& state, const std::string& group = "", bool verbose = false) const;
 
+  /** \brief Remember the results of up to \e capacity validity checks without constraints.
+   *
+   *  Repeated checks of the same state (up to the positions quantized to \e resolution) and its attached bodies are
+   *  answered from the cache, as long as neither the world, the allowed collision matrix, the collision environments
+   *  nor the state feasibility predicate changed. Verbose checks are never cached. The feasibility predicate must only
+   *  depend on the state positions. A capacity of 0 disables the cache, which is the default. */
+  void setStateValidityCacheCapacity(std::size_t capacity, double resolution = 1e-6);
+
+  /** \brief Get the counters of the state validity cache, all zero if it is disabled */
+  StateValidityCacheStatistics getStateValidityCacheStatistics() const;
+
+  /** \brief Estimate the memory held by this scene, e.g. to find out which part of a long-lived scene grows.
+   *
+   *  The parts are the world ("world.*"), the changes recorded for the parent ("world_diff"), the collision
+   *  environments ("collision_env.*", "collision_env_unpadded.*"), the robot state and its attached bodies, and the
+   *  state validity cache. A diff scene keeps its parents alive: "diff_chain" counts them and sums their own parts.
+   *  Shapes shared between a scene and its parents are counted by each. */
+  moveit::MemoryUsage getMemoryUsage() const;
+
   /** \brief Check if a given state is valid. This means checking for collisions, feasibility  and whether the user
    * specified validity conditions hold as well */
   bool isStateValid(const moveit_msgs::msg::RobotState& state, const moveit_msgs::msg::Constraints& constr,
@@ -897,6 +1029,29 @@ public:
   bool isPathValid(const robot_trajectory::RobotTrajectory& trajectory, const std::string& group = "",
                    bool verbose = false, std::vector<std::size_t>* invalid_index = nullptr) const;
 
+  /** \brief Check if a given path is valid, distributing the checks over multiple threads.
+   *
+   *  The waypoints are split into contiguous chunks that are checked concurrently. Each waypoint is checked for
+   *  collisions and feasibility. If \e continuous is true, the motion between consecutive waypoints is additionally
+   *  checked for collisions with the world using the continuous checkRobotCollision(state1, state2) of the active
+   *  collision detector, which requires a detector that implements it (e.g. Bullet). As soon as an invalid waypoint is
+   *  found, all checks of later waypoints are cancelled.
+   *
+   *  Each worker thread checks against its own copy of the collision environments, so that collision detectors that
+   *  serialize their calls internally are checked in parallel as well. The state feasibility predicate, if set, must be
+   *  safe to call concurrently.
+   *
+   *  \param trajectory The trajectory to check; the collision body transforms of its waypoints need to be up to date
+   *  \param group The group to check collisions for; the whole robot if empty
+   *  \param verbose Output debug information about invalid states
+   *  \param first_invalid_index If not nullptr, set to the index of the first invalid waypoint. If the motion between
+   *  two waypoints is in collision, the second one is reported.
+   *  \param thread_count The number of threads to use; 0 selects the number of hardware threads
+   *  \param continuous Whether to check the motion between consecutive waypoints */
+  bool isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory, const std::string& group = "",
+                           bool verbose = false, std::size_t* first_invalid_index = nullptr,
+                           unsigned int thread_count = 0, bool continuous = true) const;
+
   /** \brief Get the top \e max_costs cost sources for a specified trajectory. The resulting costs are stored in \e
    * costs */
   void getCostSources(const robot_trajectory::RobotTrajectory& trajectory, std::size_t max_costs,
@@ -955,6 +1110,25 @@ public:
     allocateCollisionDetector(allocator, nullptr /* no parent_detector */);
   }
 
+  /** \brief Keep collision detectors alive when another type is allocated.
+   *
+   * When enabled, allocateCollisionDetector() with a different allocator keeps the previously active detector. Its
+   * environments remain registered as observers of this scene's world and thus stay synchronized with it, so
+   * allocating the same type again later reactivates them instead of rebuilding them from the world.
+   * Disabling releases all inactive detectors. */
+  void setRetainInactiveCollisionDetectors(bool flag)
+  {
+    retain_inactive_collision_detectors_ = flag;
+    if (!flag)
+      retained_collision_detectors_.clear();
+  }
+
+  /** \brief Check whether inactive collision detectors are retained, see setRetainInactiveCollisionDetectors() */
+  bool getRetainInactiveCollisionDetectors() const
+  {
+    return retain_inactive_collision_detectors_;
+  }
+
 private:
   /* Private constructor used by the diff() methods. */
   PlanningScene(const PlanningSceneConstPtr& parent);
@@ -963,15 +1137,32 @@ private:
    * Requires a valid robot_model_ */
   void initialize();
 
+  /* Restore a snapshot from the \e size bytes at \e data */
+  bool loadSnapshot(const char* data, std::size_t size);
+
+  /* Add the parts of getMemoryUsage() which this scene holds itself, i.e. without its parents */
+  void addOwnMemoryUsage(moveit::MemoryUsage& usage) const;
+
+  /* Get a version number that was not used before, see getWorldVersion() */
+  static std::size_t nextVersion();
+
   /* helper function to create a RobotModel from a urdf/srdf. */
   static moveit::core::RobotModelPtr createRobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model,
                                                       const srdf::ModelConstSharedPtr& srdf_model);
 
   /* Helper functions for processing collision objects */
   bool processCollisionObjectAdd(const moveit_msgs::msg::CollisionObject& object);
+  bool processCollisionObjectAdd(const moveit_msgs::msg::CollisionObject& object,
+                                 const Eigen::Isometry3d& header_to_pose_transform,
+                                 const std::vector<shapes::ShapeConstPtr>& shapes,
+                                 const EigenSTL::vector_Isometry3d& shape_poses);
   bool processCollisionObjectRemove(const moveit_msgs::msg::CollisionObject& object);
   bool processCollisionObjectMove(const moveit_msgs::msg::CollisionObject& object);
 
+  /* Check whether the world object \e id differs from the one of the parent scene by its pose only, so that diffs can
+   * describe the change by a MOVE operation instead of the complete geometry */
+  bool isObjectMovedOnly(const std::string& id) const;
+
   /* For exporting and importing the planning scene */
   bool readPoseFromText(std::istream& in, Eigen::Isometry3d& pose) const;
   void writePoseToText(std::ostream& out, const Eigen::Isometry3d& pose) const;
@@ -1030,11 +1221,25 @@ private:
 
   CollisionDetectorPtr collision_detector_;  // Never nullptr.
 
+  // inactive collision detectors kept in sync with world_, indexed by name
+  bool retain_inactive_collision_detectors_ = false;
+  std::map<std::string, CollisionDetectorPtr> retained_collision_detectors_;
+
   collision_detection::AllowedCollisionMatrixPtr acm_;  // if nullptr use parent's
 
   StateFeasibilityFn state_feasibility_;
   MotionFeasibilityFn motion_feasibility_;
 
+  // versions of the components owned by this scene, see getWorldVersion()
+  std::size_t state_version_ = nextVersion();
+  std::size_t transforms_version_ = nextVersion();
+  std::size_t acm_version_ = nextVersion();
+  std::size_t collision_env_version_ = nextVersion();
+  std::size_t feasibility_version_ = nextVersion();
+
+  // nullptr unless enabled by setStateValidityCacheCapacity()
+  std::unique_ptr<StateValidityCache> validity_cache_;
+
   std::unique_ptr<ObjectColorMap> object_colors_;
 
   // a map of object types
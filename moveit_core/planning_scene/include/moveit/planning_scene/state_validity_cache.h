@@ -0,0 +1,167 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_state/robot_state.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <moveit_planning_scene_export.h>
+
+namespace planning_scene
+{
+/** \brief Counters of a StateValidityCache, used to tune its capacity */
+struct StateValidityCacheStatistics
+{
+  /** \brief Number of lookups which found a stored result */
+  std::size_t hits{ 0 };
+
+  /** \brief Number of lookups which had to check the state */
+  std::size_t misses{ 0 };
+
+  /** \brief Number of results dropped because the capacity was reached */
+  std::size_t evictions{ 0 };
+
+  /** \brief Number of results currently stored */
+  std::size_t size{ 0 };
+};
+
+/** \brief Least recently used cache of state validity results.
+ *
+ *  Results are keyed by the versions of the scene components they depend on, the group and the positions of the
+ *  state, quantized to \e resolution, as well as its attached bodies. A result never applies to another version of the
+ *  scene, so the cache does not need to be cleared when the scene changes. The cache is thread-safe. */
+class MOVEIT_PLANNING_SCENE_EXPORT StateValidityCache
+{
+public:
+  /** \brief Versions of the scene components a validity result depends on */
+  struct SceneVersion
+  {
+    std::size_t world{ 0 };
+    std::size_t allowed_collision_matrix{ 0 };
+    std::size_t collision_env{ 0 };
+    std::size_t feasibility{ 0 };
+
+    bool operator==(const SceneVersion& other) const
+    {
+      return world == other.world && allowed_collision_matrix == other.allowed_collision_matrix &&
+             collision_env == other.collision_env && feasibility == other.feasibility;
+    }
+  };
+
+  /** \brief Construct a cache holding at most \e capacity results. States whose positions differ by less than
+   * \e resolution may share results. */
+  explicit StateValidityCache(std::size_t capacity = 1024, double resolution = 1e-6);
+
+  /** \brief Look up the validity of \e state in the scene \e version for \e group. Returns false if not stored. */
+  bool find(const SceneVersion& version, const std::string& group, const moveit::core::RobotState& state,
+            bool& valid);
+
+  /** \brief Store the validity of \e state in the scene \e version for \e group */
+  void insert(const SceneVersion& version, const std::string& group, const moveit::core::RobotState& state,
+              bool valid);
+
+  /** \brief Change the maximum number of results, evicting the least recently used ones if needed */
+  void setCapacity(std::size_t capacity);
+
+  std::size_t getCapacity() const;
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** \brief Remove all results. The statistics are kept. */
+  void clear();
+
+  StateValidityCacheStatistics getStatistics() const;
+
+  /** \brief Estimate the number of bytes held by the stored results */
+  std::size_t getMemoryUsage() const;
+
+  /** \brief Reset the hit, miss and eviction counters */
+  void resetStatistics();
+
+private:
+  struct Key
+  {
+    SceneVersion version;
+    std::string group;
+    /** \brief Quantized variable positions, followed by the attached bodies' shape addresses and quantized poses */
+    std::vector<std::int64_t> values;
+    /** \brief Ids, links and touch links of the attached bodies */
+    std::vector<std::string> attached_bodies;
+
+    bool operator==(const Key& other) const
+    {
+      return version == other.version && group == other.group && values == other.values &&
+             attached_bodies == other.attached_bodies;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  struct Entry
+  {
+    Key key;
+    bool valid;
+  };
+
+  Key makeKey(const SceneVersion& version, const std::string& group, const moveit::core::RobotState& state) const;
+
+  /** \brief Drop least recently used entries until at most \e capacity_ remain */
+  void evict();
+
+  const double resolution_;
+
+  mutable std::mutex lock_;
+
+  std::size_t capacity_;
+
+  /** \brief Entries ordered from most to least recently used */
+  std::list<Entry> lru_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries_;
+
+  StateValidityCacheStatistics statistics_;
+};
+}  // namespace planning_scene
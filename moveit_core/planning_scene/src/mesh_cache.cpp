@@ -0,0 +1,175 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene/mesh_cache.h>
+#include <moveit/collision_detection/world.h>
+#include <geometric_shapes/shape_operations.h>
+#include <boost/functional/hash.hpp>
+
+namespace planning_scene
+{
+MeshCache::MeshCache(std::size_t capacity) : capacity_(capacity)
+{
+}
+
+MeshCache& MeshCache::getGlobal()
+{
+  static MeshCache cache;
+  return cache;
+}
+
+shapes::ShapeConstPtr MeshCache::getMesh(const shape_msgs::msg::Mesh& msg)
+{
+  const std::size_t hash = hashMesh(msg);
+  {
+    std::scoped_lock lock(lock_);
+    auto range = entries_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+      if (isSameMesh(*it->second->mesh, msg))
+      {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        ++statistics_.hits;
+        return it->second->mesh;
+      }
+    ++statistics_.misses;
+  }
+
+  // decode outside of the lock, meshes may be large
+  shapes::Shape* shape = shapes::constructShapeFromMsg(msg);
+  if (!shape)
+    return shapes::ShapeConstPtr();
+  std::shared_ptr<const shapes::Mesh> mesh(static_cast<shapes::Mesh*>(shape));
+
+  std::scoped_lock lock(lock_);
+  if (capacity_ == 0)
+    return mesh;
+  lru_.push_front(Entry{ hash, mesh });
+  entries_.emplace(hash, lru_.begin());
+  evict();
+  return mesh;
+}
+
+void MeshCache::setCapacity(std::size_t capacity)
+{
+  std::scoped_lock lock(lock_);
+  capacity_ = capacity;
+  evict();
+}
+
+std::size_t MeshCache::getCapacity() const
+{
+  std::scoped_lock lock(lock_);
+  return capacity_;
+}
+
+void MeshCache::clear()
+{
+  std::scoped_lock lock(lock_);
+  entries_.clear();
+  lru_.clear();
+}
+
+MeshCacheStatistics MeshCache::getStatistics() const
+{
+  std::scoped_lock lock(lock_);
+  MeshCacheStatistics statistics = statistics_;
+  statistics.size = lru_.size();
+  return statistics;
+}
+
+std::size_t MeshCache::getMemoryUsage() const
+{
+  std::scoped_lock lock(lock_);
+  std::size_t bytes = entries_.bucket_count() * sizeof(void*);
+  for (const Entry& entry : lru_)
+    bytes += sizeof(Entry) + sizeof(std::list<Entry>::iterator) +
+             collision_detection::World::getShapeMemoryUsage(*entry.mesh);
+  return bytes;
+}
+
+void MeshCache::resetStatistics()
+{
+  std::scoped_lock lock(lock_);
+  statistics_ = MeshCacheStatistics();
+}
+
+std::size_t MeshCache::hashMesh(const shape_msgs::msg::Mesh& msg)
+{
+  std::size_t hash = 0;
+  boost::hash_combine(hash, msg.vertices.size());
+  boost::hash_combine(hash, msg.triangles.size());
+  for (const geometry_msgs::msg::Point& vertex : msg.vertices)
+  {
+    boost::hash_combine(hash, vertex.x);
+    boost::hash_combine(hash, vertex.y);
+    boost::hash_combine(hash, vertex.z);
+  }
+  for (const shape_msgs::msg::MeshTriangle& triangle : msg.triangles)
+    for (const uint32_t index : triangle.vertex_indices)
+      boost::hash_combine(hash, index);
+  return hash;
+}
+
+bool MeshCache::isSameMesh(const shapes::Mesh& mesh, const shape_msgs::msg::Mesh& msg)
+{
+  if (mesh.vertex_count != msg.vertices.size() || mesh.triangle_count != msg.triangles.size())
+    return false;
+  for (std::size_t i = 0; i < msg.vertices.size(); ++i)
+    if (mesh.vertices[3 * i] != msg.vertices[i].x || mesh.vertices[3 * i + 1] != msg.vertices[i].y ||
+        mesh.vertices[3 * i + 2] != msg.vertices[i].z)
+      return false;
+  for (std::size_t i = 0; i < msg.triangles.size(); ++i)
+    for (std::size_t j = 0; j < 3; ++j)
+      if (mesh.triangles[3 * i + j] != msg.triangles[i].vertex_indices[j])
+        return false;
+  return true;
+}
+
+void MeshCache::evict()
+{
+  while (lru_.size() > capacity_)
+  {
+    const Entry& entry = lru_.back();
+    auto range = entries_.equal_range(entry.hash);
+    for (auto it = range.first; it != range.second; ++it)
+      if (it->second == std::prev(lru_.end()))
+      {
+        entries_.erase(it);
+        break;
+      }
+    lru_.pop_back();
+    ++statistics_.evictions;
+  }
+}
+}  // namespace planning_scene
@@ -36,6 +36,7 @@
 
 #include <boost/algorithm/string.hpp>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_scene/mesh_cache.h>
 #include <moveit/collision_detection/occupancy_map.h>
 #include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
 #include <geometric_shapes/shape_operations.h>
@@ -48,9 +49,23 @@
 #include <octomap_msgs/conversions.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <rclcpp/serialization.hpp>
 #include <tf2_eigen/tf2_eigen.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 namespace planning_scene
 {
@@ -88,6 +103,16 @@ public:
     return scene_->getFrameTransform(from_frame);
   }
 
+  moveit::core::FrameHandle getFrameHandle(const std::string& frame) const override
+  {
+    return scene_->getFrameHandle(frame);
+  }
+
+  const Eigen::Isometry3d& getTransform(const moveit::core::FrameHandle& frame) const override
+  {
+    return scene_->getFrameTransform(frame);
+  }
+
 private:
   // Returns true if frame_id is the name of an object or the name of a subframe on an object
   bool knowsObjectFrame(const std::string& frame_id) const
@@ -98,6 +123,39 @@ private:
   const PlanningScene* scene_;
 };
 
+// Construct the shapes of collision object messages, sharing identical meshes through the global MeshCache
+static shapes::ShapeConstPtr constructShapeFromMsg(const shape_msgs::msg::SolidPrimitive& msg)
+{
+  return shapes::ShapeConstPtr(shapes::constructShapeFromMsg(msg));
+}
+
+static shapes::ShapeConstPtr constructShapeFromMsg(const shape_msgs::msg::Plane& msg)
+{
+  return shapes::ShapeConstPtr(shapes::constructShapeFromMsg(msg));
+}
+
+static shapes::ShapeConstPtr constructShapeFromMsg(const shape_msgs::msg::Mesh& msg)
+{
+  return MeshCache::getGlobal().getMesh(msg);
+}
+
+// Check whether two versions of a world object differ in nothing but their pose
+static bool hasSameGeometry(const collision_detection::World::Object& obj,
+                            const collision_detection::World::Object& other)
+{
+  if (obj.shapes_ != other.shapes_ || obj.shape_poses_.size() != other.shape_poses_.size() ||
+      obj.subframe_poses_.size() != other.subframe_poses_.size())
+    return false;
+  for (std::size_t i = 0; i < obj.shape_poses_.size(); ++i)
+    if (obj.shape_poses_[i].matrix() != other.shape_poses_[i].matrix())
+      return false;
+  for (auto it = obj.subframe_poses_.begin(), jt = other.subframe_poses_.begin(); it != obj.subframe_poses_.end();
+       ++it, ++jt)
+    if (it->first != jt->first || it->second.matrix() != jt->second.matrix())
+      return false;
+  return true;
+}
+
 bool PlanningScene::isEmpty(const moveit_msgs::msg::PlanningScene& msg)
 {
   return moveit::core::isEmpty(msg);
@@ -144,6 +202,12 @@ PlanningScene::~PlanningScene()
     world_->removeObserver(current_world_object_update_observer_handle_);
 }
 
+std::size_t PlanningScene::nextVersion()
+{
+  static std::atomic<std::size_t> version{ 0 };
+  return ++version;
+}
+
 void PlanningScene::initialize()
 {
   name_ = DEFAULT_SCENE_NAME;
@@ -190,6 +254,9 @@ PlanningScene::PlanningScene(const PlanningSceneConstPtr& parent) : parent_(pare
 
   allocateCollisionDetector(parent_->collision_detector_->alloc_, parent_->collision_detector_);
   collision_detector_->copyPadding(*parent_->collision_detector_);
+
+  // the new environments only differ from the parent's by the world, which has its own version
+  collision_env_version_ = parent_->collision_env_version_;
 }
 
 PlanningScenePtr PlanningScene::clone(const PlanningSceneConstPtr& scene)
@@ -224,6 +291,28 @@ void PlanningScene::allocateCollisionDetector(const collision_detection::Collisi
   // Temporarily keep pointer to the previous (if any) collision detector to copy padding from
   CollisionDetectorPtr prev_coll_detector = collision_detector_;
 
+  // Optionally keep the previous detector around so that switching back does not need to rebuild it
+  CollisionDetectorPtr retained_detector;
+  auto retained = retained_collision_detectors_.find(allocator->getName());
+  if (retained != retained_collision_detectors_.end())
+  {
+    retained_detector = retained->second;
+    retained_collision_detectors_.erase(retained);
+  }
+  if (retain_inactive_collision_detectors_ && prev_coll_detector &&
+      prev_coll_detector->alloc_->getName() != allocator->getName())
+    retained_collision_detectors_[prev_coll_detector->alloc_->getName()] = prev_coll_detector;
+
+  // A retained detector was kept in sync with world_, so it only needs the current padding
+  if (retained_detector && !parent_detector)
+  {
+    collision_detector_ = retained_detector;
+    if (prev_coll_detector)
+      collision_detector_->copyPadding(*prev_coll_detector);
+    collision_env_version_ = nextVersion();
+    return;
+  }
+
   // Construct a fresh CollisionDetector and store allocator
   collision_detector_ = std::make_shared<CollisionDetector>();
   collision_detector_->alloc_ = allocator;
@@ -249,6 +338,7 @@ void PlanningScene::allocateCollisionDetector(const collision_detection::Collisi
   // Assign const pointers
   collision_detector_->cenv_const_ = collision_detector_->cenv_;
   collision_detector_->cenv_unpadded_const_ = collision_detector_->cenv_unpadded_;
+  collision_env_version_ = nextVersion();
 }
 
 const collision_detection::CollisionEnvConstPtr&
@@ -293,6 +383,8 @@ void PlanningScene::clearDiffs()
 
   // Reset collision detector to the the parent's version
   allocateCollisionDetector(parent_->collision_detector_->alloc_, parent_->collision_detector_);
+  // retained detectors observe the replaced world
+  retained_collision_detectors_.clear();
 
   scene_transforms_.reset();
   robot_state_.reset();
@@ -474,11 +566,13 @@ void PlanningScene::getCollidingLinks(std::vector<std::string>& links, const mov
 
 const collision_detection::CollisionEnvPtr& PlanningScene::getCollisionEnvNonConst()
 {
+  collision_env_version_ = nextVersion();
   return collision_detector_->cenv_;
 }
 
 moveit::core::RobotState& PlanningScene::getCurrentStateNonConst()
 {
+  state_version_ = nextVersion();
   if (!robot_state_)
   {
     robot_state_ = std::make_shared<moveit::core::RobotState>(parent_->getCurrentState());
@@ -513,6 +607,7 @@ void PlanningScene::setCollisionObjectUpdateCallback(const collision_detection::
 
 collision_detection::AllowedCollisionMatrix& PlanningScene::getAllowedCollisionMatrixNonConst()
 {
+  acm_version_ = nextVersion();
   if (!acm_)
     acm_ = std::make_shared<collision_detection::AllowedCollisionMatrix>(parent_->getAllowedCollisionMatrix());
   return *acm_;
@@ -529,6 +624,7 @@ moveit::core::Transforms& PlanningScene::getTransformsNonConst()
 {
   // Trigger an update of the robot transforms
   getCurrentStateNonConst().update();
+  transforms_version_ = nextVersion();
   if (!scene_transforms_)
   {
     // The only case when there are no transforms is if this planning scene has a parent. When a non-const version of
@@ -605,6 +701,16 @@ void PlanningScene::getPlanningSceneDiffMsg(moveit_msgs::msg::PlanningScene& sce
           scene_msg.world.collision_objects.push_back(co);
         }
       }
+      else if (it.second == collision_detection::World::MOVE_SHAPE && isObjectMovedOnly(it.first))
+      {
+        // objects which were only moved are sent without their geometry
+        moveit_msgs::msg::CollisionObject co;
+        co.header.frame_id = getPlanningFrame();
+        co.id = it.first;
+        co.pose = tf2::toMsg(world_->getObject(it.first)->pose_);
+        co.operation = moveit_msgs::msg::CollisionObject::MOVE;
+        scene_msg.world.collision_objects.push_back(co);
+      }
       else
       {
         scene_msg.world.collision_objects.emplace_back();
@@ -668,6 +774,21 @@ private:
 };
 }  // namespace
 
+bool PlanningScene::isObjectMovedOnly(const std::string& id) const
+{
+  if (!parent_)
+    return false;
+  collision_detection::World::ObjectConstPtr obj = world_->getObject(id);
+  collision_detection::World::ObjectConstPtr parent_obj = parent_->getWorld()->getObject(id);
+  if (!obj || !parent_obj || !hasSameGeometry(*obj, *parent_obj))
+    return false;
+
+  // the type of an object is only sent along with its geometry
+  if (hasObjectType(id) != parent_->hasObjectType(id))
+    return false;
+  return !hasObjectType(id) || getObjectType(id) == parent_->getObjectType(id);
+}
+
 bool PlanningScene::getCollisionObjectMsg(moveit_msgs::msg::CollisionObject& collision_obj, const std::string& ns) const
 {
   collision_detection::CollisionEnv::ObjectConstPtr obj = world_->getObject(ns);
@@ -1037,6 +1158,269 @@ bool PlanningScene::loadGeometryFromStream(std::istream& in, const Eigen::Isomet
   } while (true);
 }
 
+namespace
+{
+// Layout of snapshots: an uncompressed header of SNAPSHOT_MAGIC, the format version and the size of the payload,
+// followed by the zlib compressed payload. The payload holds the table of distinct meshes, the references of mesh
+// slots of the scene message into that table, and the scene message with the referenced meshes left empty. Messages
+// are stored in their CDR serialization, numbers in little-endian byte order.
+constexpr char SNAPSHOT_MAGIC[8] = { 'M', 'V', 'S', 'C', 'E', 'N', 'E', '\0' };
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+constexpr std::size_t SNAPSHOT_HEADER_SIZE = sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+constexpr std::uint32_t WORLD_OBJECT_MESH = 0;
+constexpr std::uint32_t ATTACHED_OBJECT_MESH = 1;
+
+void appendNumber(std::string& out, std::uint64_t value, std::size_t bytes)
+{
+  for (std::size_t i = 0; i < bytes; ++i)
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+template <typename T>
+std::string serializeMessage(const T& msg)
+{
+  static const rclcpp::Serialization<T> SERIALIZER;
+  rclcpp::SerializedMessage serialized_msg;
+  SERIALIZER.serialize_message(&msg, &serialized_msg);
+  return std::string(reinterpret_cast<const char*>(serialized_msg.get_rcl_serialized_message().buffer),
+                     serialized_msg.size());
+}
+
+template <typename T>
+void deserializeMessage(const char* data, std::size_t size, T& msg)
+{
+  static const rclcpp::Serialization<T> SERIALIZER;
+  rclcpp::SerializedMessage serialized_msg(size);
+  rcl_serialized_message_t& rcl_msg = serialized_msg.get_rcl_serialized_message();
+  std::memcpy(rcl_msg.buffer, data, size);
+  rcl_msg.buffer_length = size;
+  SERIALIZER.deserialize_message(&serialized_msg, &msg);
+}
+
+/* Bounds checked reading of a snapshot payload */
+class SnapshotReader
+{
+public:
+  SnapshotReader(const char* data, std::size_t size) : data_(data), size_(size)
+  {
+  }
+
+  bool readNumber(std::uint64_t& value, std::size_t bytes)
+  {
+    if (size_ - pos_ < bytes)
+      return false;
+    value = 0;
+    for (std::size_t i = 0; i < bytes; ++i)
+      value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+    pos_ += bytes;
+    return true;
+  }
+
+  bool readBlock(const char*& block, std::size_t& block_size)
+  {
+    std::uint64_t length;
+    if (!readNumber(length, sizeof(std::uint64_t)) || size_ - pos_ < length)
+      return false;
+    block = data_ + pos_;
+    block_size = static_cast<std::size_t>(length);
+    pos_ += block_size;
+    return true;
+  }
+
+private:
+  const char* data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+};
+
+/* Collects the distinct meshes of the objects of a scene message */
+struct MeshTable
+{
+  std::unordered_map<std::string, std::uint32_t> index;
+  std::vector<std::string> meshes;
+  std::string references;
+  std::size_t reference_count = 0;
+
+  // Move the meshes of \e object into the table, replacing duplicates by references to the first occurrence
+  void extractMeshes(moveit_msgs::msg::CollisionObject& object, std::uint32_t kind, std::size_t object_index)
+  {
+    for (std::size_t i = 0; i < object.meshes.size(); ++i)
+    {
+      std::string mesh = serializeMessage(object.meshes[i]);
+      auto entry = index.find(mesh);
+      if (entry == index.end())
+      {
+        entry = index.emplace(mesh, static_cast<std::uint32_t>(meshes.size())).first;
+        meshes.push_back(std::move(mesh));
+      }
+      appendNumber(references, kind, sizeof(std::uint32_t));
+      appendNumber(references, object_index, sizeof(std::uint32_t));
+      appendNumber(references, i, sizeof(std::uint32_t));
+      appendNumber(references, entry->second, sizeof(std::uint32_t));
+      ++reference_count;
+      object.meshes[i] = shape_msgs::msg::Mesh();
+    }
+  }
+};
+}  // namespace
+
+bool PlanningScene::saveSnapshotToStream(std::ostream& out) const
+{
+  moveit_msgs::msg::PlanningScene scene_msg;
+  getPlanningSceneMsg(scene_msg);
+
+  MeshTable table;
+  for (std::size_t i = 0; i < scene_msg.world.collision_objects.size(); ++i)
+    table.extractMeshes(scene_msg.world.collision_objects[i], WORLD_OBJECT_MESH, i);
+  for (std::size_t i = 0; i < scene_msg.robot_state.attached_collision_objects.size(); ++i)
+    table.extractMeshes(scene_msg.robot_state.attached_collision_objects[i].object, ATTACHED_OBJECT_MESH, i);
+
+  std::string payload;
+  appendNumber(payload, table.meshes.size(), sizeof(std::uint64_t));
+  for (const std::string& mesh : table.meshes)
+  {
+    appendNumber(payload, mesh.size(), sizeof(std::uint64_t));
+    payload += mesh;
+  }
+  appendNumber(payload, table.reference_count, sizeof(std::uint64_t));
+  payload += table.references;
+  const std::string scene = serializeMessage(scene_msg);
+  appendNumber(payload, scene.size(), sizeof(std::uint64_t));
+  payload += scene;
+
+  std::string header(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  appendNumber(header, SNAPSHOT_VERSION, sizeof(std::uint32_t));
+  appendNumber(header, 0, sizeof(std::uint32_t));  // reserved for flags
+  appendNumber(header, payload.size(), sizeof(std::uint64_t));
+  out.write(header.data(), header.size());
+
+  boost::iostreams::filtering_ostream compressed_out;
+  compressed_out.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_speed));
+  compressed_out.push(out);
+  compressed_out.write(payload.data(), payload.size());
+  compressed_out.reset();  // flushes the compressor
+  if (!out.good())
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to write the snapshot of scene '%s'", getName().c_str());
+    return false;
+  }
+  return true;
+}
+
+bool PlanningScene::saveSnapshotToFile(const std::string& file_name) const
+{
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot open '%s' for writing the scene snapshot", file_name.c_str());
+    return false;
+  }
+  return saveSnapshotToStream(out);
+}
+
+bool PlanningScene::loadSnapshotFromStream(std::istream& in)
+{
+  const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  return loadSnapshot(data.data(), data.size());
+}
+
+bool PlanningScene::loadSnapshotFromFile(const std::string& file_name)
+{
+  boost::iostreams::mapped_file_source file;
+  try
+  {
+    file.open(file_name);
+  }
+  catch (const std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot map the scene snapshot '%s': %s", file_name.c_str(), e.what());
+    return false;
+  }
+  return loadSnapshot(file.data(), file.size());
+}
+
+bool PlanningScene::loadSnapshot(const char* data, std::size_t size)
+{
+  if (size < SNAPSHOT_HEADER_SIZE || std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+  {
+    RCLCPP_ERROR(LOGGER, "The data is not a planning scene snapshot");
+    return false;
+  }
+  SnapshotReader header(data + sizeof(SNAPSHOT_MAGIC), SNAPSHOT_HEADER_SIZE - sizeof(SNAPSHOT_MAGIC));
+  std::uint64_t version, flags, payload_size;
+  header.readNumber(version, sizeof(std::uint32_t));
+  header.readNumber(flags, sizeof(std::uint32_t));
+  header.readNumber(payload_size, sizeof(std::uint64_t));
+  if (version != SNAPSHOT_VERSION)
+  {
+    RCLCPP_ERROR(LOGGER, "Unsupported planning scene snapshot version %u, expected %u",
+                 static_cast<unsigned int>(version), SNAPSHOT_VERSION);
+    return false;
+  }
+
+  moveit_msgs::msg::PlanningScene scene_msg;
+  try
+  {
+    std::string payload;
+    boost::iostreams::filtering_istream compressed_in;
+    compressed_in.push(boost::iostreams::zlib_decompressor());
+    compressed_in.push(boost::iostreams::array_source(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE));
+    boost::iostreams::copy(compressed_in, boost::iostreams::back_inserter(payload));
+
+    SnapshotReader reader(payload.data(), payload.size());
+    const auto fail = [&payload, payload_size](const char* part) {
+      RCLCPP_ERROR(LOGGER, "Corrupt planning scene snapshot: cannot read %s (%zu of %zu bytes decompressed)", part,
+                   payload.size(), static_cast<std::size_t>(payload_size));
+      return false;
+    };
+    const char* block;
+    std::size_t block_size;
+
+    std::uint64_t mesh_count;
+    if (payload.size() != payload_size || !reader.readNumber(mesh_count, sizeof(std::uint64_t)) ||
+        mesh_count > payload.size())
+      return fail("the mesh table");
+    std::vector<shape_msgs::msg::Mesh> meshes(mesh_count);
+    for (shape_msgs::msg::Mesh& mesh : meshes)
+    {
+      if (!reader.readBlock(block, block_size))
+        return fail("the mesh table");
+      deserializeMessage(block, block_size, mesh);
+    }
+
+    std::uint64_t reference_count;
+    if (!reader.readNumber(reference_count, sizeof(std::uint64_t)) || reference_count > payload.size())
+      return fail("the mesh references");
+    std::vector<std::array<std::uint64_t, 4>> references(reference_count);
+    for (std::array<std::uint64_t, 4>& reference : references)
+      for (std::uint64_t& field : reference)
+        if (!reader.readNumber(field, sizeof(std::uint32_t)))
+          return fail("the mesh references");
+
+    if (!reader.readBlock(block, block_size))
+      return fail("the scene");
+    deserializeMessage(block, block_size, scene_msg);
+
+    for (const auto& [kind, object_index, mesh_index, table_index] : references)
+    {
+      std::vector<shape_msgs::msg::Mesh>* object_meshes = nullptr;
+      if (kind == WORLD_OBJECT_MESH && object_index < scene_msg.world.collision_objects.size())
+        object_meshes = &scene_msg.world.collision_objects[object_index].meshes;
+      else if (kind == ATTACHED_OBJECT_MESH && object_index < scene_msg.robot_state.attached_collision_objects.size())
+        object_meshes = &scene_msg.robot_state.attached_collision_objects[object_index].object.meshes;
+      if (!object_meshes || mesh_index >= object_meshes->size() || table_index >= meshes.size())
+        return fail("the mesh references");
+      (*object_meshes)[mesh_index] = meshes[table_index];
+    }
+  }
+  catch (const std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Corrupt planning scene snapshot: %s", e.what());
+    return false;
+  }
+  return setPlanningSceneMsg(scene_msg);
+}
+
 bool PlanningScene::readPoseFromText(std::istream& in, Eigen::Isometry3d& pose) const
 {
   double x, y, z, rx, ry, rz, rw;
@@ -1067,6 +1451,7 @@ void PlanningScene::setCurrentState(const moveit_msgs::msg::RobotState& state)
   // after robot_state_ has been updated
   moveit_msgs::msg::RobotState state_no_attached(state);
   state_no_attached.attached_collision_objects.clear();
+  state_version_ = nextVersion();
 
   if (parent_)
   {
@@ -1109,16 +1494,21 @@ void PlanningScene::decoupleParent()
   {
     scene_transforms_ = std::make_shared<SceneTransforms>(this);
     scene_transforms_->setAllTransforms(parent_->getTransforms().getAllTransforms());
+    transforms_version_ = nextVersion();
   }
 
   if (!robot_state_)
   {
     robot_state_ = std::make_shared<moveit::core::RobotState>(parent_->getCurrentState());
     robot_state_->setAttachedBodyUpdateCallback(current_state_attached_body_callback_);
+    state_version_ = nextVersion();
   }
 
   if (!acm_)
+  {
     acm_ = std::make_shared<collision_detection::AllowedCollisionMatrix>(parent_->getAllowedCollisionMatrix());
+    acm_version_ = nextVersion();
+  }
 
   world_diff_.reset();
 
@@ -1174,6 +1564,7 @@ bool PlanningScene::setPlanningSceneDiffMsg(const moveit_msgs::msg::PlanningScen
     if (!scene_transforms_)
       scene_transforms_ = std::make_shared<SceneTransforms>(this);
     scene_transforms_->setTransforms(scene_msg.fixed_frame_transforms);
+    transforms_version_ = nextVersion();
   }
 
   // if at least some joints have been specified, we set them
@@ -1183,12 +1574,16 @@ bool PlanningScene::setPlanningSceneDiffMsg(const moveit_msgs::msg::PlanningScen
 
   // if at least some links are mentioned in the allowed collision matrix, then we have an update
   if (!scene_msg.allowed_collision_matrix.entry_names.empty())
+  {
     acm_ = std::make_shared<collision_detection::AllowedCollisionMatrix>(scene_msg.allowed_collision_matrix);
+    acm_version_ = nextVersion();
+  }
 
   if (!scene_msg.link_padding.empty() || !scene_msg.link_scale.empty())
   {
     collision_detector_->cenv_->setPadding(scene_msg.link_padding);
     collision_detector_->cenv_->setScale(scene_msg.link_scale);
+    collision_env_version_ = nextVersion();
   }
 
   // if any colors have been specified, replace the ones we have with the specified ones
@@ -1196,8 +1591,7 @@ bool PlanningScene::setPlanningSceneDiffMsg(const moveit_msgs::msg::PlanningScen
     setObjectColor(object_color.id, object_color.color);
 
   // process collision object updates
-  for (const moveit_msgs::msg::CollisionObject& collision_object : scene_msg.world.collision_objects)
-    result &= processCollisionObjectMsg(collision_object);
+  result &= processCollisionObjectMsgs(scene_msg.world.collision_objects);
 
   // if an octomap was specified, replace the one we have with that one
   if (!scene_msg.world.octomap.octomap.data.empty())
@@ -1220,22 +1614,24 @@ bool PlanningScene::setPlanningSceneMsg(const moveit_msgs::msg::PlanningScene& s
 
   object_types_.reset();
   scene_transforms_->setTransforms(scene_msg.fixed_frame_transforms);
+  transforms_version_ = nextVersion();
   setCurrentState(scene_msg.robot_state);
   acm_ = std::make_shared<collision_detection::AllowedCollisionMatrix>(scene_msg.allowed_collision_matrix);
+  acm_version_ = nextVersion();
   collision_detector_->cenv_->setPadding(scene_msg.link_padding);
   collision_detector_->cenv_->setScale(scene_msg.link_scale);
+  collision_env_version_ = nextVersion();
   object_colors_ = std::make_unique<ObjectColorMap>();
   for (const moveit_msgs::msg::ObjectColor& object_color : scene_msg.object_colors)
     setObjectColor(object_color.id, object_color.color);
+  collision_detection::World::BatchUpdate batch(*world_);
   world_->clearObjects();
   return processPlanningSceneWorldMsg(scene_msg.world);
 }
 
 bool PlanningScene::processPlanningSceneWorldMsg(const moveit_msgs::msg::PlanningSceneWorld& world)
 {
-  bool result = true;
-  for (const moveit_msgs::msg::CollisionObject& collision_object : world.collision_objects)
-    result &= processCollisionObjectMsg(collision_object);
+  bool result = processCollisionObjectMsgs(world.collision_objects);
   processOctomapMsg(world.octomap);
   return result;
 }
@@ -1341,19 +1737,11 @@ void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTre
       const shapes::OcTree* o = static_cast<const shapes::OcTree*>(map->shapes_[0].get());
       if (o->octree == octree)
       {
-        // if the pose changed, we update it
-        if (map->shape_poses_[0].isApprox(t, std::numeric_limits<double>::epsilon() * 100.0))
-        {
-          if (world_diff_)
-            world_diff_->set(OCTOMAP_NS, collision_detection::World::DESTROY | collision_detection::World::CREATE |
-                                             collision_detection::World::ADD_SHAPE);
-        }
-        else
-        {
-          shapes::ShapeConstPtr shape = map->shapes_[0];
-          map.reset();  // reset this pointer first so that caching optimizations can be used in CollisionWorld
-          world_->moveShapeInObject(OCTOMAP_NS, shape, t);
-        }
+        // the octree may have been updated in place, so the shape is set again even if the pose did not change:
+        // this notifies the collision environments that copy the voxels (e.g. Bullet) and marks the diff
+        shapes::ShapeConstPtr shape = map->shapes_[0];
+        map.reset();  // reset this pointer first so that caching optimizations can be used in CollisionWorld
+        world_->moveShapeInObject(OCTOMAP_NS, shape, t);
         return;
       }
     }
@@ -1384,6 +1772,7 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::At
     robot_state_->setAttachedBodyUpdateCallback(current_state_attached_body_callback_);
   }
   robot_state_->update();
+  state_version_ = nextVersion();
 
   // The ADD/REMOVE operations follow this order:
   // STEP 1: Get info about the object from either the message or the world/RobotState
@@ -1607,6 +1996,71 @@ bool PlanningScene::processCollisionObjectMsg(const moveit_msgs::msg::CollisionO
   return false;
 }
 
+bool PlanningScene::processCollisionObjectMsgs(const std::vector<moveit_msgs::msg::CollisionObject>& objects,
+                                              unsigned int thread_count)
+{
+  // observers, e.g. the collision environments, are notified of all changes at once
+  collision_detection::World::BatchUpdate batch(*world_);
+
+  // objects which add shapes; their construction does not depend on the scene, so it is done up front
+  std::vector<std::size_t> additions;
+  for (std::size_t i = 0; i < objects.size(); ++i)
+    if ((objects[i].operation == moveit_msgs::msg::CollisionObject::ADD ||
+         objects[i].operation == moveit_msgs::msg::CollisionObject::APPEND) &&
+        objects[i].id != OCTOMAP_NS)
+      additions.push_back(i);
+
+  // spawning threads does not pay off for a few objects
+  static const std::size_t MIN_ADDITIONS_PER_THREAD = 8;
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = static_cast<unsigned int>(
+      std::min<std::size_t>(thread_count, std::max<std::size_t>(1, additions.size() / MIN_ADDITIONS_PER_THREAD)));
+
+  bool result = true;
+  if (thread_count == 1)
+  {
+    for (const moveit_msgs::msg::CollisionObject& object : objects)
+      result &= processCollisionObjectMsg(object);
+    return result;
+  }
+
+  EigenSTL::vector_Isometry3d header_to_pose_transforms(additions.size());
+  std::vector<std::vector<shapes::ShapeConstPtr>> shapes(additions.size());
+  std::vector<EigenSTL::vector_Isometry3d> shape_poses(additions.size());
+  std::unique_ptr<bool[]> valid(new bool[additions.size()]);
+
+  // workers pick the next object to construct, so that a few large meshes do not stall a single thread
+  std::atomic<std::size_t> next(0);
+  const auto construct = [&] {
+    for (std::size_t i = next++; i < additions.size(); i = next++)
+      valid[i] = shapesAndPosesFromCollisionObjectMessage(objects[additions[i]], header_to_pose_transforms[i],
+                                                          shapes[i], shape_poses[i]);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(construct);
+  construct();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // apply all messages in order
+  std::size_t addition = 0;
+  for (std::size_t i = 0; i < objects.size(); ++i)
+  {
+    if (addition < additions.size() && additions[addition] == i)
+    {
+      result &= valid[addition] && processCollisionObjectAdd(objects[i], header_to_pose_transforms[addition],
+                                                             shapes[addition], shape_poses[addition]);
+      ++addition;
+    }
+    else
+      result &= processCollisionObjectMsg(objects[i]);
+  }
+  return result;
+}
+
 void PlanningScene::poseMsgToEigen(const geometry_msgs::msg::Pose& msg, Eigen::Isometry3d& out)
 {
   Eigen::Translation3d translation(msg.position.x, msg.position.y, msg.position.z);
@@ -1658,8 +2112,8 @@ bool PlanningScene::shapesAndPosesFromCollisionObjectMessage(const moveit_msgs::
                                                  // use the shape's pose as the object pose.
     }
 
-  auto append = [&object_pose, &shapes, &shape_poses,
-                 &switch_object_pose_and_shape_pose](shapes::Shape* s, const geometry_msgs::msg::Pose& pose_msg) {
+  auto append = [&object_pose, &shapes, &shape_poses, &switch_object_pose_and_shape_pose](
+                    shapes::ShapeConstPtr s, const geometry_msgs::msg::Pose& pose_msg) {
     if (!s)
       return;
     Eigen::Isometry3d pose;
@@ -1671,7 +2125,7 @@ bool PlanningScene::shapesAndPosesFromCollisionObjectMessage(const moveit_msgs::
       shape_poses.emplace_back(std::move(object_pose));
       object_pose = pose;
     }
-    shapes.emplace_back(shapes::ShapeConstPtr(s));
+    shapes.emplace_back(std::move(s));
   };
 
   auto treat_shape_vectors = [&append](const auto& shape_vector,        // the shape_msgs of each type
@@ -1686,16 +2140,16 @@ bool PlanningScene::shapesAndPosesFromCollisionObjectMessage(const moveit_msgs::
       {
         if (i >= shape_poses_vector.size())
         {
-          append(shapes::constructShapeFromMsg(shape_vector[i]),
+          append(constructShapeFromMsg(shape_vector[i]),
                  geometry_msgs::msg::Pose());  // Empty shape pose => Identity
         }
         else
-          append(shapes::constructShapeFromMsg(shape_vector[i]), shape_poses_vector[i]);
+          append(constructShapeFromMsg(shape_vector[i]), shape_poses_vector[i]);
       }
     }
     else
       for (std::size_t i = 0; i < shape_vector.size(); ++i)
-        append(shapes::constructShapeFromMsg(shape_vector[i]), shape_poses_vector[i]);
+        append(constructShapeFromMsg(shape_vector[i]), shape_poses_vector[i]);
   };
 
   treat_shape_vectors(object.primitives, object.primitive_poses, std::string("primitive_poses"));
@@ -1705,6 +2159,19 @@ bool PlanningScene::shapesAndPosesFromCollisionObjectMessage(const moveit_msgs::
 }
 
 bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionObject& object)
+{
+  Eigen::Isometry3d header_to_pose_transform;
+  std::vector<shapes::ShapeConstPtr> shapes;
+  EigenSTL::vector_Isometry3d shape_poses;
+  if (!shapesAndPosesFromCollisionObjectMessage(object, header_to_pose_transform, shapes, shape_poses))
+    return false;
+  return processCollisionObjectAdd(object, header_to_pose_transform, shapes, shape_poses);
+}
+
+bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionObject& object,
+                                              const Eigen::Isometry3d& header_to_pose_transform,
+                                              const std::vector<shapes::ShapeConstPtr>& shapes,
+                                              const EigenSTL::vector_Isometry3d& shape_poses)
 {
   if (!knowsFrameTransform(object.header.frame_id))
   {
@@ -1723,11 +2190,6 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
     world_->removeObject(object.id);
 
   const Eigen::Isometry3d& world_to_object_header_transform = getFrameTransform(object.header.frame_id);
-  Eigen::Isometry3d header_to_pose_transform;
-  std::vector<shapes::ShapeConstPtr> shapes;
-  EigenSTL::vector_Isometry3d shape_poses;
-  if (!shapesAndPosesFromCollisionObjectMessage(object, header_to_pose_transform, shapes, shape_poses))
-    return false;
   const Eigen::Isometry3d object_frame_transform = world_to_object_header_transform * header_to_pose_transform;
 
   world_->addToObject(object.id, object_frame_transform, shapes, shape_poses);
@@ -1840,6 +2302,45 @@ bool PlanningScene::knowsFrameTransform(const moveit::core::RobotState& state, c
   return getTransforms().Transforms::canTransform(frame_id);
 }
 
+moveit::core::FrameHandle PlanningScene::getFrameHandle(const std::string& frame_id) const
+{
+  if (!frame_id.empty() && frame_id[0] == '/')
+    return getFrameHandle(frame_id.substr(1));
+
+  // resolve in the same order as getFrameTransform()
+  if (frame_id == getRobotModel()->getModelFrame())
+    // the model frame is the identity, which is always held as a fixed transform
+    return getTransforms().Transforms::getFrameHandle(frame_id);
+
+  moveit::core::FrameHandle handle;
+  handle.name = frame_id;
+  bool is_link;
+  if (const moveit::core::LinkModel* link = getRobotModel()->getLinkModel(frame_id, &is_link))
+  {
+    handle.type = moveit::core::FrameHandle::ROBOT_LINK;
+    handle.index = link->getLinkIndex();
+  }
+  else if (getCurrentState().knowsFrameTransform(frame_id) || getWorld()->knowsTransform(frame_id))
+    handle.type = moveit::core::FrameHandle::OBJECT_FRAME;
+  else
+    handle = getTransforms().Transforms::getFrameHandle(frame_id);
+  return handle;
+}
+
+const Eigen::Isometry3d& PlanningScene::getFrameTransform(const moveit::core::RobotState& state,
+                                                          const moveit::core::FrameHandle& frame) const
+{
+  switch (frame.type)
+  {
+    case moveit::core::FrameHandle::ROBOT_LINK:
+      return state.getGlobalLinkTransform(getRobotModel()->getLinkModel(frame.index));
+    case moveit::core::FrameHandle::FIXED_FRAME:
+      return getTransforms().Transforms::getTransform(frame);
+    default:
+      return getFrameTransform(state, frame.name);
+  }
+}
+
 bool PlanningScene::hasObjectType(const std::string& object_id) const
 {
   if (object_types_)
@@ -2014,7 +2515,7 @@ bool PlanningScene::isStateConstrained(const moveit_msgs::msg::RobotState& state
 bool PlanningScene::isStateConstrained(const moveit::core::RobotState& state,
                                        const kinematic_constraints::KinematicConstraintSet& constr, bool verbose) const
 {
-  return constr.decide(state, verbose).satisfied;
+  return constr.satisfied(state, verbose);
 }
 
 bool PlanningScene::isStateValid(const moveit::core::RobotState& state, const std::string& group, bool verbose) const
@@ -2040,6 +2541,18 @@ bool PlanningScene::isStateValid(const moveit_msgs::msg::RobotState& state, cons
 bool PlanningScene::isStateValid(const moveit::core::RobotState& state, const moveit_msgs::msg::Constraints& constr,
                                  const std::string& group, bool verbose) const
 {
+  if (validity_cache_ && !verbose && moveit::core::isEmpty(constr))
+  {
+    const StateValidityCache::SceneVersion version{ getWorldVersion(), getAllowedCollisionMatrixVersion(),
+                                                    collision_env_version_, feasibility_version_ };
+    bool valid;
+    if (validity_cache_->find(version, group, state, valid))
+      return valid;
+    valid = !isStateColliding(state, group, verbose) && isStateFeasible(state, verbose);
+    validity_cache_->insert(version, group, state, valid);
+    return valid;
+  }
+
   if (isStateColliding(state, group, verbose))
     return false;
   if (!isStateFeasible(state, verbose))
@@ -2047,6 +2560,60 @@ bool PlanningScene::isStateValid(const moveit::core::RobotState& state, const mo
   return isStateConstrained(state, constr, verbose);
 }
 
+void PlanningScene::setStateValidityCacheCapacity(std::size_t capacity, double resolution)
+{
+  if (capacity == 0)
+    validity_cache_.reset();
+  else if (validity_cache_ && validity_cache_->getResolution() == resolution)
+    validity_cache_->setCapacity(capacity);
+  else
+    validity_cache_ = std::make_unique<StateValidityCache>(capacity, resolution);
+}
+
+StateValidityCacheStatistics PlanningScene::getStateValidityCacheStatistics() const
+{
+  return validity_cache_ ? validity_cache_->getStatistics() : StateValidityCacheStatistics();
+}
+
+moveit::MemoryUsage PlanningScene::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  addOwnMemoryUsage(usage);
+  for (PlanningSceneConstPtr parent = parent_; parent; parent = parent->parent_)
+  {
+    moveit::MemoryUsage parent_usage;
+    parent->addOwnMemoryUsage(parent_usage);
+    usage.add("diff_chain", parent_usage.getTotalBytes());
+  }
+  return usage;
+}
+
+void PlanningScene::addOwnMemoryUsage(moveit::MemoryUsage& usage) const
+{
+  usage.add("world", world_->getMemoryUsage());
+  if (world_diff_)
+    usage.add("world_diff", world_diff_->size() * (sizeof(std::string) + sizeof(collision_detection::World::Action)),
+              world_diff_->size());
+  usage.add("collision_env", collision_detector_->cenv_->getMemoryUsage());
+  if (collision_detector_->cenv_unpadded_ != collision_detector_->cenv_)
+    usage.add("collision_env_unpadded", collision_detector_->cenv_unpadded_->getMemoryUsage());
+  if (robot_state_)
+  {
+    usage.add("robot_state", robot_state_->getMemoryUsage());
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    robot_state_->getAttachedBodies(attached_bodies);
+    for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+    {
+      std::size_t bytes = 0;
+      for (const shapes::ShapeConstPtr& shape : attached_body->getShapes())
+        bytes += collision_detection::World::getShapeMemoryUsage(*shape);
+      usage.add("attached_bodies", bytes);
+    }
+  }
+  if (validity_cache_)
+    usage.add("state_validity_cache", validity_cache_->getMemoryUsage(), validity_cache_->getStatistics().size);
+}
+
 bool PlanningScene::isStateValid(const moveit::core::RobotState& state,
                                  const kinematic_constraints::KinematicConstraintSet& constr, const std::string& group,
                                  bool verbose) const
@@ -2119,7 +2686,7 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
       this_state_valid = false;
     if (!isStateFeasible(st, verbose))
       this_state_valid = false;
-    if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
+    if (!ks_p.empty() && !ks_p.satisfied(st, verbose))
       this_state_valid = false;
 
     if (!this_state_valid)
@@ -2181,6 +2748,94 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   return isPathValid(trajectory, EMP_CONSTRAINTS, EMP_CONSTRAINTS_VECTOR, group, verbose, invalid_index);
 }
 
+bool PlanningScene::isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory, const std::string& group,
+                                        bool verbose, std::size_t* first_invalid_index, unsigned int thread_count,
+                                        bool continuous) const
+{
+  const std::size_t n_wp = trajectory.getWayPointCount();
+  if (first_invalid_index)
+    *first_invalid_index = n_wp;
+  if (n_wp == 0)
+    return true;
+
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = static_cast<unsigned int>(std::min<std::size_t>(thread_count, n_wp));
+
+  collision_detection::CollisionRequest req;
+  req.verbose = verbose;
+  req.group_name = group;
+  const collision_detection::AllowedCollisionMatrix& acm = getAllowedCollisionMatrix();
+
+  // index of the first invalid waypoint found so far; checks of later waypoints are skipped
+  std::atomic<std::size_t> first_invalid(n_wp);
+
+  const auto check_range = [&](const collision_detection::CollisionEnvConstPtr& cenv,
+                               const collision_detection::CollisionEnvConstPtr& cenv_unpadded, std::size_t begin,
+                               std::size_t end) {
+    for (std::size_t i = begin; i < end && i < first_invalid.load(std::memory_order_relaxed); ++i)
+    {
+      const moveit::core::RobotState& st = trajectory.getWayPoint(i);
+      std::size_t invalid = n_wp;
+
+      collision_detection::CollisionResult res;
+      cenv->checkRobotCollision(req, res, st, acm);
+      if (!res.collision)
+        cenv_unpadded->checkSelfCollision(req, res, st, acm);
+      if (res.collision || !isStateFeasible(st, verbose))
+        invalid = i;
+      else if (continuous && i + 1 < n_wp)
+      {
+        res.clear();
+        cenv->checkRobotCollision(req, res, st, trajectory.getWayPoint(i + 1), acm);
+        if (res.collision)
+        {
+          if (verbose)
+            RCLCPP_INFO(LOGGER, "Motion between waypoints %zu and %zu is in collision", i, i + 1);
+          invalid = i + 1;
+        }
+      }
+
+      if (invalid < n_wp)
+      {
+        std::size_t current = first_invalid.load();
+        while (invalid < current && !first_invalid.compare_exchange_weak(current, invalid))
+        {
+        }
+        return;
+      }
+    }
+  };
+
+  if (thread_count == 1)
+    check_range(getCollisionEnv(), getCollisionEnvUnpadded(), 0, n_wp);
+  else
+  {
+    // the workers use copies of the collision environments, allocated up front as copying reads the originals
+    std::vector<collision_detection::CollisionEnvConstPtr> cenvs, cenvs_unpadded;
+    for (unsigned int t = 1; t < thread_count; ++t)
+    {
+      auto world = std::make_shared<collision_detection::World>(*world_);
+      cenvs.push_back(collision_detector_->alloc_->allocateEnv(getCollisionEnv(), world));
+      cenvs_unpadded.push_back(collision_detector_->alloc_->allocateEnv(getCollisionEnvUnpadded(), world));
+    }
+
+    const std::size_t chunk = (n_wp + thread_count - 1) / thread_count;
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (unsigned int t = 1; t < thread_count && t * chunk < n_wp; ++t)
+      threads.emplace_back(check_range, cenvs[t - 1], cenvs_unpadded[t - 1], t * chunk,
+                           std::min(n_wp, (t + 1) * chunk));
+    check_range(getCollisionEnv(), getCollisionEnvUnpadded(), 0, std::min(n_wp, chunk));
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  if (first_invalid_index)
+    *first_invalid_index = first_invalid;
+  return first_invalid == n_wp;
+}
+
 void PlanningScene::getCostSources(const robot_trajectory::RobotTrajectory& trajectory, std::size_t max_costs,
                                    std::set<collision_detection::CostSource>& costs, double overlap_fraction) const
 {
@@ -38,11 +38,49 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <moveit/python/pybind_rosmsg_typecasters.h>
+#include <moveit/python/pybind_numpy.h>
 #include <moveit/planning_scene/planning_scene.h>
 
 namespace py = pybind11;
 using namespace planning_scene;
 
+namespace
+{
+// Check each row of an (N, dof) array of group positions for collisions, starting from the current state of the
+// scene for all other joints. The GIL is released while checking and no Python object is created per state.
+py::array_t<bool> checkCollisionBatch(const PlanningScene& scene, const std::string& group_name,
+                                      const moveit::python::DoubleArray& positions, bool self_only)
+{
+  const moveit::core::JointModelGroup* group = scene.getRobotModel()->getJointModelGroup(group_name);
+  if (!group)
+    throw py::value_error("Unknown joint model group '" + group_name + "'");
+  const std::size_t dof = group->getVariableCount();
+  const py::ssize_t n = moveit::python::checkBatchShape(positions, dof, "positions");
+
+  py::array_t<bool> colliding(n);
+  const double* in = positions.data();
+  bool* out = colliding.mutable_data();
+  {
+    py::gil_scoped_release release;
+    moveit::core::RobotState work(scene.getCurrentState());
+    collision_detection::CollisionRequest req;
+    req.group_name = group_name;
+    for (py::ssize_t i = 0; i < n; ++i)
+    {
+      // the non-const state overloads update the collision body transforms as needed
+      work.setJointGroupPositions(group, in + i * dof);
+      collision_detection::CollisionResult res;
+      if (self_only)
+        scene.checkSelfCollision(req, res, work);
+      else
+        scene.checkCollision(req, res, work);
+      out[i] = res.collision;
+    }
+  }
+  return colliding;
+}
+}  // namespace
+
 void def_planning_scene_bindings(py::module& m)
 {
   m.doc() = "The planning scene represents the state of the world and the robot, "
@@ -110,6 +148,9 @@ void def_planning_scene_bindings(py::module& m)
            py::arg("state"), py::arg("constr"), py::arg("group"), py::arg("verbose") = false)
       .def("setCurrentState", py::overload_cast<const moveit_msgs::RobotState&>(&PlanningScene::setCurrentState))
       .def("setCurrentState", py::overload_cast<const robot_state::RobotState&>(&PlanningScene::setCurrentState))
+      .def("checkCollisionBatch", &checkCollisionBatch, py::arg("group"), py::arg("positions"),
+           py::arg("self_only") = false,
+           "Check each row of an (N, dof) array of group positions for collisions. Returns an (N,) boolean array.")
       //
       ;
 }
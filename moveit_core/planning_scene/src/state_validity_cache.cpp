@@ -0,0 +1,190 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene/state_validity_cache.h>
+#include <moveit/robot_state/attached_body.h>
+#include <boost/functional/hash.hpp>
+#include <cmath>
+
+namespace planning_scene
+{
+StateValidityCache::StateValidityCache(std::size_t capacity, double resolution)
+  : resolution_(resolution > 0.0 ? resolution : 1e-6), capacity_(capacity)
+{
+}
+
+bool StateValidityCache::find(const SceneVersion& version, const std::string& group,
+                              const moveit::core::RobotState& state, bool& valid)
+{
+  const Key key = makeKey(version, group, state);
+  std::scoped_lock lock(lock_);
+  auto it = entries_.find(key);
+  if (it == entries_.end())
+  {
+    ++statistics_.misses;
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  ++statistics_.hits;
+  valid = it->second->valid;
+  return true;
+}
+
+void StateValidityCache::insert(const SceneVersion& version, const std::string& group,
+                                const moveit::core::RobotState& state, bool valid)
+{
+  Key key = makeKey(version, group, state);
+  std::scoped_lock lock(lock_);
+  if (capacity_ == 0)
+    return;
+  auto it = entries_.find(key);
+  if (it != entries_.end())
+  {
+    it->second->valid = valid;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+  lru_.push_front(Entry{ std::move(key), valid });
+  entries_.emplace(lru_.front().key, lru_.begin());
+  evict();
+}
+
+void StateValidityCache::setCapacity(std::size_t capacity)
+{
+  std::scoped_lock lock(lock_);
+  capacity_ = capacity;
+  evict();
+}
+
+std::size_t StateValidityCache::getCapacity() const
+{
+  std::scoped_lock lock(lock_);
+  return capacity_;
+}
+
+void StateValidityCache::clear()
+{
+  std::scoped_lock lock(lock_);
+  entries_.clear();
+  lru_.clear();
+}
+
+StateValidityCacheStatistics StateValidityCache::getStatistics() const
+{
+  std::scoped_lock lock(lock_);
+  StateValidityCacheStatistics statistics = statistics_;
+  statistics.size = lru_.size();
+  return statistics;
+}
+
+std::size_t StateValidityCache::getMemoryUsage() const
+{
+  std::scoped_lock lock(lock_);
+  std::size_t bytes = entries_.bucket_count() * sizeof(void*);
+  for (const Entry& entry : lru_)
+  {
+    bytes += 2 * sizeof(Entry) + sizeof(std::list<Entry>::iterator) + 2 * entry.key.group.capacity() +
+             2 * entry.key.values.capacity() * sizeof(std::int64_t);
+    for (const std::string& attached_body : entry.key.attached_bodies)
+      bytes += 2 * (sizeof(std::string) + attached_body.capacity());
+  }
+  return bytes;
+}
+
+void StateValidityCache::resetStatistics()
+{
+  std::scoped_lock lock(lock_);
+  statistics_ = StateValidityCacheStatistics();
+}
+
+std::size_t StateValidityCache::KeyHash::operator()(const Key& key) const
+{
+  std::size_t hash = 0;
+  boost::hash_combine(hash, key.version.world);
+  boost::hash_combine(hash, key.version.allowed_collision_matrix);
+  boost::hash_combine(hash, key.version.collision_env);
+  boost::hash_combine(hash, key.version.feasibility);
+  boost::hash_combine(hash, key.group);
+  boost::hash_range(hash, key.values.begin(), key.values.end());
+  boost::hash_range(hash, key.attached_bodies.begin(), key.attached_bodies.end());
+  return hash;
+}
+
+StateValidityCache::Key StateValidityCache::makeKey(const SceneVersion& version, const std::string& group,
+                                                    const moveit::core::RobotState& state) const
+{
+  Key key{ version, group, {}, {} };
+  const auto quantize = [this](double value) { return static_cast<std::int64_t>(std::llround(value / resolution_)); };
+  const auto append_pose = [&key, &quantize](const Eigen::Isometry3d& pose) {
+    for (int row = 0; row < 3; ++row)
+      for (int col = 0; col < 4; ++col)
+        key.values.push_back(quantize(pose.matrix()(row, col)));
+  };
+
+  const double* positions = state.getVariablePositions();
+  const std::size_t variable_count = state.getVariableCount();
+  key.values.reserve(variable_count);
+  for (std::size_t i = 0; i < variable_count; ++i)
+    key.values.push_back(quantize(positions[i]));
+
+  // the collision geometry of attached bodies is shared between copies of a state, so their shapes are identified by
+  // address; their names matter for the allowed collision matrix
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* body : attached_bodies)
+  {
+    key.attached_bodies.push_back(body->getName());
+    key.attached_bodies.push_back(body->getAttachedLinkName());
+    key.attached_bodies.insert(key.attached_bodies.end(), body->getTouchLinks().begin(), body->getTouchLinks().end());
+    key.attached_bodies.emplace_back();  // separates the touch links of consecutive bodies
+    append_pose(body->getPose());
+    for (std::size_t i = 0; i < body->getShapes().size(); ++i)
+    {
+      key.values.push_back(static_cast<std::int64_t>(reinterpret_cast<std::intptr_t>(body->getShapes()[i].get())));
+      append_pose(body->getShapePosesInLinkFrame()[i]);
+    }
+  }
+  return key;
+}
+
+void StateValidityCache::evict()
+{
+  while (lru_.size() > capacity_)
+  {
+    entries_.erase(lru_.back().key);
+    lru_.pop_back();
+    ++statistics_.evictions;
+  }
+}
+}  // namespace planning_scene
@@ -0,0 +1,273 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Google Benchmark micro-benchmarks of collision checking, distance queries, allowed collision matrix lookups
+   and planning scene diff/clone on the Panda and PR2 test models, for FCL and Bullet. */
+
+#include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
+#include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <random_numbers/random_numbers.h>
+#include <benchmark/benchmark.h>
+
+namespace
+{
+constexpr std::size_t NUM_SAMPLES = 1000;
+constexpr unsigned int RANDOM_SEED = 42;
+constexpr std::size_t NUM_WORLD_OBJECTS = 20;
+
+// Indexed by the first benchmark argument
+const char* const ROBOT_NAMES[] = { "panda", "pr2" };
+const char* const GROUP_NAMES[] = { "panda_arm", "right_arm" };
+// Indexed by the second benchmark argument
+const char* const COLLISION_DETECTOR_NAMES[] = { "FCL", "Bullet" };
+
+// Planning scene with a field of boxes around the robot and seeded random states of one group
+struct SceneFixture
+{
+  SceneFixture(int robot_index, int detector_index)
+    : robot_model(moveit::core::loadTestingRobotModel(ROBOT_NAMES[robot_index]))
+    , scene(std::make_shared<planning_scene::PlanningScene>(robot_model))
+  {
+    if (detector_index == 0)
+    {
+      scene->allocateCollisionDetector(collision_detection::CollisionDetectorAllocatorFCL::create());
+    }
+    else
+    {
+      scene->allocateCollisionDetector(collision_detection::CollisionDetectorAllocatorBullet::create());
+    }
+
+    random_numbers::RandomNumberGenerator rng(RANDOM_SEED);
+    for (std::size_t i = 0; i < NUM_WORLD_OBJECTS; ++i)
+    {
+      Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+      pose.translation() =
+          Eigen::Vector3d(rng.uniformReal(-1.5, 1.5), rng.uniformReal(-1.5, 1.5), rng.uniformReal(0.0, 1.5));
+      shapes::ShapeConstPtr box = std::make_shared<shapes::Box>(0.1, 0.1, 0.1);
+      scene->getWorldNonConst()->addToObject("box_" + std::to_string(i), pose, { box },
+                                             { Eigen::Isometry3d::Identity() });
+    }
+
+    const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup(GROUP_NAMES[robot_index]);
+    moveit::core::RobotState state(robot_model);
+    state.setToDefaultValues();
+    states.reserve(NUM_SAMPLES);
+    for (std::size_t i = 0; i < NUM_SAMPLES; ++i)
+    {
+      state.setToRandomPositions(group, rng);
+      state.update();
+      states.push_back(state);
+    }
+  }
+
+  moveit::core::RobotModelPtr robot_model;
+  planning_scene::PlanningScenePtr scene;
+  std::vector<moveit::core::RobotState> states;
+};
+
+const SceneFixture& getFixture(benchmark::State& st)
+{
+  static const SceneFixture FIXTURES[2][2] = { { SceneFixture(0, 0), SceneFixture(0, 1) },
+                                               { SceneFixture(1, 0), SceneFixture(1, 1) } };
+  const int robot_index = st.range(0);
+  const int detector_index = st.range(1);
+  st.SetLabel(std::string(ROBOT_NAMES[robot_index]) + "/" + COLLISION_DETECTOR_NAMES[detector_index]);
+  return FIXTURES[robot_index][detector_index];
+}
+}  // namespace
+
+static void selfCollision(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::CollisionEnvConstPtr& env = fixture.scene->getCollisionEnv();
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  collision_detection::CollisionRequest req;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::CollisionResult res;
+    env->checkSelfCollision(req, res, fixture.states[i++ % NUM_SAMPLES], acm);
+    benchmark::DoNotOptimize(res.collision);
+  }
+}
+BENCHMARK(selfCollision)->ArgsProduct({ { 0, 1 }, { 0, 1 } });
+
+static void worldCollision(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::CollisionEnvConstPtr& env = fixture.scene->getCollisionEnv();
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  collision_detection::CollisionRequest req;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::CollisionResult res;
+    env->checkRobotCollision(req, res, fixture.states[i++ % NUM_SAMPLES], acm);
+    benchmark::DoNotOptimize(res.collision);
+  }
+}
+BENCHMARK(worldCollision)->ArgsProduct({ { 0, 1 }, { 0, 1 } });
+
+// Self and world collision with contact reporting, as used by rviz and planning scene diagnostics
+static void fullCollisionWithContacts(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 100;
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    collision_detection::CollisionResult res;
+    fixture.scene->checkCollision(req, res, fixture.states[i++ % NUM_SAMPLES]);
+    benchmark::DoNotOptimize(res.contact_count);
+  }
+}
+BENCHMARK(fullCollisionWithContacts)->ArgsProduct({ { 0, 1 }, { 0, 1 } });
+
+// Distance queries are only implemented for FCL
+static void selfDistance(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::CollisionEnvConstPtr& env = fixture.scene->getCollisionEnv();
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    benchmark::DoNotOptimize(env->distanceSelf(fixture.states[i++ % NUM_SAMPLES], acm));
+  }
+}
+BENCHMARK(selfDistance)->ArgsProduct({ { 0, 1 }, { 0 } });
+
+static void worldDistance(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::CollisionEnvConstPtr& env = fixture.scene->getCollisionEnv();
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    benchmark::DoNotOptimize(env->distanceRobot(fixture.states[i++ % NUM_SAMPLES], acm));
+  }
+}
+BENCHMARK(worldDistance)->ArgsProduct({ { 0, 1 }, { 0 } });
+
+// Lookup of all link pairs by name, as done by the narrow phase of every collision check
+static void acmLookupByName(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  const std::vector<std::string>& links = fixture.robot_model->getLinkModelNamesWithCollisionGeometry();
+  for (auto _ : st)
+  {
+    collision_detection::AllowedCollision::Type type;
+    for (const std::string& first : links)
+    {
+      for (const std::string& second : links)
+      {
+        benchmark::DoNotOptimize(acm.getAllowedCollision(first, second, type));
+      }
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * links.size() * links.size());
+}
+BENCHMARK(acmLookupByName)->ArgsProduct({ { 0, 1 }, { 0 } });
+
+static void acmLookupByIndex(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const collision_detection::AllowedCollisionMatrix& acm = fixture.scene->getAllowedCollisionMatrix();
+  std::vector<int> indices;
+  for (const std::string& link : fixture.robot_model->getLinkModelNamesWithCollisionGeometry())
+  {
+    indices.push_back(acm.getIndex(link));
+  }
+  for (auto _ : st)
+  {
+    collision_detection::AllowedCollision::Type type;
+    for (int first : indices)
+    {
+      for (int second : indices)
+      {
+        benchmark::DoNotOptimize(acm.getAllowedCollision(first, second, type));
+      }
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * indices.size() * indices.size());
+}
+BENCHMARK(acmLookupByIndex)->ArgsProduct({ { 0, 1 }, { 0 } });
+
+// A diff on top of the scene with a changed robot state, as created for every planning request
+static void planningSceneDiff(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  std::size_t i = 0;
+  for (auto _ : st)
+  {
+    planning_scene::PlanningScenePtr diff = fixture.scene->diff();
+    diff->setCurrentState(fixture.states[i++ % NUM_SAMPLES]);
+    benchmark::DoNotOptimize(diff);
+  }
+}
+BENCHMARK(planningSceneDiff)->ArgsProduct({ { 0, 1 }, { 0, 1 } });
+
+static void planningSceneDiffToMsg(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  const planning_scene::PlanningScenePtr diff = fixture.scene->diff();
+  diff->setCurrentState(fixture.states[0]);
+  for (auto _ : st)
+  {
+    moveit_msgs::msg::PlanningScene msg;
+    diff->getPlanningSceneDiffMsg(msg);
+    benchmark::DoNotOptimize(msg);
+  }
+}
+BENCHMARK(planningSceneDiffToMsg)->ArgsProduct({ { 0, 1 }, { 0 } });
+
+static void planningSceneClone(benchmark::State& st)
+{
+  const SceneFixture& fixture = getFixture(st);
+  for (auto _ : st)
+  {
+    benchmark::DoNotOptimize(planning_scene::PlanningScene::clone(fixture.scene));
+  }
+}
+BENCHMARK(planningSceneClone)->ArgsProduct({ { 0, 1 }, { 0, 1 } });
+
+BENCHMARK_MAIN();
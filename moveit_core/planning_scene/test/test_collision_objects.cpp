@@ -36,9 +36,11 @@
 
 #include <gtest/gtest.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_scene/mesh_cache.h>
 #include <moveit/utils/message_checks.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
+#include <array>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -58,6 +60,28 @@ void makeSphere(moveit_msgs::msg::CollisionObject& co)
   pose.orientation.w = 1.0;
   co.primitive_poses.push_back(pose);
 }
+
+void makeTetrahedron(moveit_msgs::msg::CollisionObject& co)
+{
+  shape_msgs::msg::Mesh mesh;
+  for (const auto& [x, y, z] : std::vector<std::array<double, 3>>{ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } })
+  {
+    mesh.vertices.emplace_back();
+    mesh.vertices.back().x = x;
+    mesh.vertices.back().y = y;
+    mesh.vertices.back().z = z;
+  }
+  for (const std::array<uint32_t, 3>& indices :
+       std::vector<std::array<uint32_t, 3>>{ { 0, 2, 1 }, { 0, 1, 3 }, { 0, 3, 2 }, { 1, 2, 3 } })
+  {
+    mesh.triangles.emplace_back();
+    mesh.triangles.back().vertex_indices = indices;
+  }
+  co.meshes.push_back(mesh);
+  geometry_msgs::msg::Pose pose;
+  pose.orientation.w = 1.0;
+  co.mesh_poses.push_back(pose);
+}
 }  // namespace
 
 TEST(PlanningScene, fillInObjectPoseFromPrimitive)
@@ -100,6 +124,98 @@ TEST(PlanningScene, fillInPrimitivePose)
       << "scene did not implicitly fill in identity pose for only primitive";
 }
 
+TEST(PlanningScene, shareIdenticalMeshes)
+{
+  moveit::core::RobotModelPtr robot_model(moveit::core::RobotModelBuilder("empty_robot", "base_link").build());
+  planning_scene::PlanningScene scene(robot_model);
+  planning_scene::MeshCache::getGlobal().clear();
+  planning_scene::MeshCache::getGlobal().resetStatistics();
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model->getModelFrame();
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  makeTetrahedron(co);
+  co.id = "bin_1";
+  scene.processCollisionObjectMsg(co);
+  co.id = "bin_2";
+  co.pose.orientation.w = 1.0;
+  co.pose.position.x = 1.0;
+  scene.processCollisionObjectMsg(co);
+
+  // a modified mesh is decoded again
+  co.id = "bin_3";
+  co.meshes[0].vertices[3].z = 2.0;
+  scene.processCollisionObjectMsg(co);
+
+  const collision_detection::WorldConstPtr& world = scene.getWorld();
+  ASSERT_TRUE(world->hasObject("bin_1") && world->hasObject("bin_2") && world->hasObject("bin_3"));
+  EXPECT_EQ(world->getObject("bin_1")->shapes_[0], world->getObject("bin_2")->shapes_[0]);
+  EXPECT_NE(world->getObject("bin_1")->shapes_[0], world->getObject("bin_3")->shapes_[0]);
+
+  const planning_scene::MeshCacheStatistics statistics = planning_scene::MeshCache::getGlobal().getStatistics();
+  EXPECT_EQ(statistics.hits, 1u);
+  EXPECT_EQ(statistics.misses, 2u);
+  EXPECT_EQ(statistics.size, 2u);
+}
+
+TEST(PlanningScene, processCollisionObjectsInParallel)
+{
+  moveit::core::RobotModelPtr robot_model(moveit::core::RobotModelBuilder("empty_robot", "base_link").build());
+
+  // many objects, some of which are moved, re-added or removed again after they were added
+  std::vector<moveit_msgs::msg::CollisionObject> objects;
+  for (std::size_t i = 0; i < 100; ++i)
+  {
+    moveit_msgs::msg::CollisionObject co;
+    co.header.frame_id = robot_model->getModelFrame();
+    co.id = "object_" + std::to_string(i);
+    co.operation = moveit_msgs::msg::CollisionObject::ADD;
+    co.pose.orientation.w = 1.0;
+    co.pose.position.x = static_cast<double>(i);
+    if (i % 2)
+      makeSphere(co);
+    else
+      makeTetrahedron(co);
+    objects.push_back(co);
+  }
+  for (std::size_t i = 0; i < 100; i += 10)
+  {
+    moveit_msgs::msg::CollisionObject co;
+    co.header.frame_id = robot_model->getModelFrame();
+    co.id = "object_" + std::to_string(i);
+    co.operation = moveit_msgs::msg::CollisionObject::MOVE;
+    co.pose.orientation.w = 1.0;
+    co.pose.position.y = 1.0;
+    objects.push_back(co);
+    co.id = "object_" + std::to_string(i + 1);
+    co.operation = moveit_msgs::msg::CollisionObject::REMOVE;
+    objects.push_back(co);
+    co.id = "object_" + std::to_string(i + 2);
+    co.operation = moveit_msgs::msg::CollisionObject::ADD;
+    makeSphere(co);
+    objects.push_back(co);
+  }
+
+  planning_scene::PlanningScene serial_scene(robot_model);
+  EXPECT_TRUE(serial_scene.processCollisionObjectMsgs(objects, 1));
+  planning_scene::PlanningScene parallel_scene(robot_model);
+  EXPECT_TRUE(parallel_scene.processCollisionObjectMsgs(objects, 4));
+
+  const collision_detection::WorldConstPtr& serial_world = serial_scene.getWorld();
+  const collision_detection::WorldConstPtr& parallel_world = parallel_scene.getWorld();
+  ASSERT_EQ(serial_world->size(), 90u);
+  ASSERT_EQ(parallel_world->size(), serial_world->size());
+  for (const auto& [id, object] : *serial_world)
+  {
+    ASSERT_TRUE(parallel_world->hasObject(id)) << id;
+    const collision_detection::World::ObjectConstPtr& other = parallel_world->getObject(id);
+    EXPECT_TRUE(other->pose_.isApprox(object->pose_)) << id;
+    ASSERT_EQ(other->shapes_.size(), object->shapes_.size()) << id;
+    for (std::size_t i = 0; i < object->shapes_.size(); ++i)
+      EXPECT_EQ(other->shapes_[i]->type, object->shapes_[i]->type) << id;
+  }
+}
+
 TEST(PlanningScene, rememberMetadataWhenAttached)
 {
   moveit::core::RobotModelPtr robot_model(moveit::core::RobotModelBuilder("empty_robot", "base_link").build());
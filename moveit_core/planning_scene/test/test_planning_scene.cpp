@@ -75,6 +75,45 @@ TEST(PlanningScene, TestOneShapeObjectPose)
   EXPECT_TRUE(expected_transfrom.isApprox(ps.getFrameTransform(object_name)));
 }
 
+TEST(PlanningScene, FrameHandles)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model = std::make_shared<srdf::Model>();
+  planning_scene::PlanningScene ps(urdf_model, srdf_model);
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = "base_footprint";
+  co.id = "object";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.push_back([] {
+    shape_msgs::msg::SolidPrimitive primitive;
+    primitive.type = shape_msgs::msg::SolidPrimitive::BOX;
+    primitive.dimensions = { 0.1, 0.1, 0.1 };
+    return primitive;
+  }());
+  co.primitive_poses.push_back(tf2::toMsg(Eigen::Isometry3d(Eigen::Translation3d(0.5, -0.25, 0.0))));
+  ps.processCollisionObjectMsg(co);
+  ps.getTransformsNonConst().setTransform(Eigen::Isometry3d(Eigen::Translation3d(1.0, 0.0, 0.0)), "fixed_frame");
+
+  moveit::core::RobotState& state = ps.getCurrentStateNonConst();
+  state.setToRandomPositions();
+  state.update();
+
+  EXPECT_EQ(ps.getFrameHandle("r_gripper_palm_link").type, moveit::core::FrameHandle::ROBOT_LINK);
+  EXPECT_EQ(ps.getFrameHandle("object").type, moveit::core::FrameHandle::OBJECT_FRAME);
+  EXPECT_EQ(ps.getFrameHandle("fixed_frame").type, moveit::core::FrameHandle::FIXED_FRAME);
+  EXPECT_FALSE(ps.getFrameHandle("no_such_frame").isValid());
+  const std::vector<std::string> frames = { "r_gripper_palm_link", "/r_gripper_palm_link", "object", "fixed_frame",
+                                            ps.getPlanningFrame() };
+  for (const std::string& frame : frames)
+  {
+    EXPECT_TRUE(ps.getFrameTransform(frame).isApprox(ps.getFrameTransform(ps.getFrameHandle(frame)))) << frame;
+    EXPECT_TRUE(ps.getTransforms().getTransform(frame).isApprox(
+        ps.getTransforms().getTransform(ps.getTransforms().getFrameHandle(frame))))
+        << frame;
+  }
+}
+
 TEST(PlanningScene, LoadRestore)
 {
   urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
@@ -149,6 +188,46 @@ TEST(PlanningScene, LoadRestoreDiff)
   EXPECT_EQ(ps->getCollisionEnvUnpadded()->getWorld()->size(), 2u);
 }
 
+TEST(PlanningScene, MovedObjectDiff)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model = std::make_shared<srdf::Model>();
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
+  ps->getWorldNonConst()->addToObject("sphere", std::make_shared<const shapes::Sphere>(0.4), id);
+  ps->getWorldNonConst()->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.2, 0.3), id);
+
+  planning_scene::PlanningScenePtr next = ps->diff();
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation().x() = 1.0;
+  next->getWorldNonConst()->setObjectPose("sphere", pose);
+  next->getWorldNonConst()->moveShapeInObject("box", next->getWorld()->getObject("box")->shapes_[0], pose);
+
+  /* moving an object only sends its new pose, changing its shapes sends the complete geometry */
+  moveit_msgs::msg::PlanningScene ps_msg;
+  next->getPlanningSceneDiffMsg(ps_msg);
+  ASSERT_EQ(ps_msg.world.collision_objects.size(), 2u);
+  for (const moveit_msgs::msg::CollisionObject& object : ps_msg.world.collision_objects)
+  {
+    if (object.id == "sphere")
+    {
+      EXPECT_EQ(object.operation, moveit_msgs::msg::CollisionObject::MOVE);
+      EXPECT_TRUE(object.primitives.empty());
+    }
+    else
+    {
+      EXPECT_EQ(object.operation, moveit_msgs::msg::CollisionObject::ADD);
+      EXPECT_EQ(object.primitives.size(), 1u);
+    }
+  }
+
+  /* applying the diff to the parent reproduces the moved objects */
+  ps->setPlanningSceneDiffMsg(ps_msg);
+  EXPECT_TRUE(ps->getWorld()->getObject("sphere")->pose_.isApprox(pose));
+  EXPECT_TRUE(ps->getWorld()->getObject("box")->global_shape_poses_[0].isApprox(pose));
+}
+
 TEST(PlanningScene, MakeAttachedDiff)
 {
   urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
@@ -391,6 +470,67 @@ TEST_P(CollisionDetectorTests, ClearDiff)
   parent.reset();
 }
 
+TEST(PlanningScene, SwitchRetainedCollisionDetectors)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model = std::make_shared<srdf::Model>();
+  auto scene = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  collision_detection::CollisionPluginCache loader;
+  if (!loader.activate("FCL", scene, true) || !loader.activate("Bullet", scene, true))
+  {
+#if defined(GTEST_SKIP_)
+    GTEST_SKIP_("Failed to load collision plugins");
+#else
+    return;
+#endif
+  }
+  EXPECT_EQ(scene->getCollisionDetectorName(), "Bullet");
+  const collision_detection::CollisionEnvConstPtr bullet_env = scene->getCollisionEnv();
+
+  moveit::core::RobotState state(scene->getRobotModel());
+  state.setToDefaultValues();
+  state.update();
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  scene->getCollisionEnv()->checkRobotCollision(req, res, state, scene->getAllowedCollisionMatrix());
+  EXPECT_FALSE(res.collision);
+
+  // objects added while Bullet is active also reach the inactive FCL environment
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = "base_link";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.id = "box";
+  co.pose.orientation.w = 1.0;
+  shape_msgs::msg::SolidPrimitive sp;
+  sp.type = shape_msgs::msg::SolidPrimitive::BOX;
+  sp.dimensions = { 1., 1., 1. };
+  co.primitives.push_back(sp);
+  geometry_msgs::msg::Pose sp_pose;
+  sp_pose.orientation.w = 1.0;
+  co.primitive_poses.push_back(sp_pose);
+  ASSERT_TRUE(scene->processCollisionObjectMsg(co));
+
+  ASSERT_TRUE(loader.activate("FCL", scene, true));
+  EXPECT_EQ(scene->getCollisionDetectorName(), "FCL");
+  res.clear();
+  scene->getCollisionEnv()->checkRobotCollision(req, res, state, scene->getAllowedCollisionMatrix());
+  EXPECT_TRUE(res.collision);
+
+  // switching back reuses the Bullet environment instead of rebuilding it
+  ASSERT_TRUE(loader.activate("Bullet", scene, true));
+  EXPECT_EQ(scene->getCollisionEnv(), bullet_env);
+  res.clear();
+  scene->getCollisionEnv()->checkRobotCollision(req, res, state, scene->getAllowedCollisionMatrix());
+  EXPECT_TRUE(res.collision);
+
+  // without retention a fresh environment is allocated
+  scene->setRetainInactiveCollisionDetectors(false);
+  ASSERT_TRUE(loader.activate("FCL", scene));
+  ASSERT_TRUE(loader.activate("Bullet", scene));
+  EXPECT_NE(scene->getCollisionEnv(), bullet_env);
+}
+
 // Returns a planning scene diff message
 moveit_msgs::msg::PlanningScene create_planning_scene_diff(const planning_scene::PlanningScene& ps,
                                                            const std::string& object_name, const int8_t operation,
@@ -609,6 +749,189 @@ TEST(PlanningScene, UpdateACMAfterObjectRemoval)
   EXPECT_FALSE(ps->getAllowedCollisionMatrix().hasEntry(object_name));
 }
 
+TEST(PlanningScene, IsPathValidParallel)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+  moveit::core::RobotState state = ps->getCurrentState();
+  state.setToDefaultValues(state.getJointModelGroup("panda_arm"), "ready");
+  state.update();
+
+  // sweep the arm about its first joint, through a box placed next to the robot
+  robot_trajectory::RobotTrajectory trajectory(robot_model, "panda_arm");
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    state.setVariablePosition("panda_joint1", -2.5 + 5.0 * i / 199.0);
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.01);
+  }
+  EXPECT_TRUE(ps->isPathValidParallel(trajectory, "", false, nullptr, 4, false));
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model->getModelFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 0.2, 0.2, 0.4 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].position.y = 0.3;
+  co.primitive_poses[0].position.z = 0.5;
+  co.primitive_poses[0].orientation.w = 1.0;
+  ps->processCollisionObjectMsg(co);
+
+  std::vector<std::size_t> invalid;
+  EXPECT_FALSE(ps->isPathValid(trajectory, "", false, &invalid));
+  ASSERT_FALSE(invalid.empty());
+  for (unsigned int thread_count : { 1u, 3u, 8u })
+  {
+    std::size_t first_invalid;
+    EXPECT_FALSE(ps->isPathValidParallel(trajectory, "", false, &first_invalid, thread_count, false));
+    EXPECT_EQ(first_invalid, invalid.front()) << thread_count << " threads";
+  }
+}
+
+TEST(PlanningScene, StateValidityCache)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+  ps->setStateValidityCacheCapacity(16);
+
+  moveit::core::RobotState state = ps->getCurrentState();
+  state.setToDefaultValues(state.getJointModelGroup("panda_arm"), "ready");
+  state.update();
+
+  EXPECT_TRUE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_TRUE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().hits, 1u);
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().misses, 1u);
+
+  // updating the current state does not invalidate cached results
+  const std::size_t state_version = ps->getCurrentStateVersion();
+  ps->getCurrentStateNonConst().setToDefaultValues();
+  EXPECT_NE(ps->getCurrentStateVersion(), state_version);
+  EXPECT_TRUE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().hits, 2u);
+
+  // a box enclosing the robot must not be hidden by the cache
+  const std::size_t world_version = ps->getWorldVersion();
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model->getModelFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 4.0, 4.0, 4.0 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].orientation.w = 1.0;
+  ps->processCollisionObjectMsg(co);
+  EXPECT_NE(ps->getWorldVersion(), world_version);
+  EXPECT_FALSE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().misses, 2u);
+
+  // allowing the collision changes the ACM version and with it the result
+  const std::size_t acm_version = ps->getAllowedCollisionMatrixVersion();
+  ps->getAllowedCollisionMatrixNonConst().setDefaultEntry("box", true);
+  EXPECT_NE(ps->getAllowedCollisionMatrixVersion(), acm_version);
+  EXPECT_TRUE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().misses, 3u);
+
+  ps->setStateValidityCacheCapacity(0);
+  EXPECT_TRUE(ps->isStateValid(state, "panda_arm"));
+  EXPECT_EQ(ps->getStateValidityCacheStatistics().hits, 0u);
+}
+
+TEST(PlanningScene, MemoryUsage)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+  const moveit::MemoryUsage empty_usage = ps->getMemoryUsage();
+  EXPECT_EQ(empty_usage.getItems().count("world.meshes"), 0u);
+  EXPECT_GT(empty_usage.getItems().at("collision_env.robot_geometry").bytes, 0u);
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model->getModelFrame();
+  co.id = "tetrahedron";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.meshes.resize(1);
+  co.meshes[0].vertices.resize(4);
+  co.meshes[0].vertices[1].x = 1.0;
+  co.meshes[0].vertices[2].y = 1.0;
+  co.meshes[0].vertices[3].z = 1.0;
+  co.meshes[0].triangles.resize(4);
+  co.meshes[0].triangles[0].vertex_indices = { 0, 1, 2 };
+  co.meshes[0].triangles[1].vertex_indices = { 0, 1, 3 };
+  co.meshes[0].triangles[2].vertex_indices = { 0, 2, 3 };
+  co.meshes[0].triangles[3].vertex_indices = { 1, 2, 3 };
+  co.mesh_poses.resize(1);
+  co.mesh_poses[0].orientation.w = 1.0;
+  ps->processCollisionObjectMsg(co);
+
+  const moveit::MemoryUsage usage = ps->getMemoryUsage();
+  EXPECT_EQ(usage.getItems().at("world.meshes").count, 1u);
+  EXPECT_GE(usage.getItems().at("world.meshes").bytes, 4 * 3 * sizeof(double) + 4 * 3 * sizeof(unsigned int));
+  EXPECT_EQ(usage.getItems().at("world.objects").count, 1u);
+  EXPECT_GT(usage.getTotalBytes(), empty_usage.getTotalBytes());
+  EXPECT_EQ(usage.getItems().count("diff_chain"), 0u);
+
+  // a diff keeps its parent alive
+  planning_scene::PlanningScenePtr child = ps->diff();
+  const moveit::MemoryUsage child_usage = child->getMemoryUsage();
+  EXPECT_EQ(child_usage.getItems().at("diff_chain").count, 1u);
+  EXPECT_GT(child_usage.getItems().at("diff_chain").bytes, 0u);
+}
+
+TEST(PlanningScene, SnapshotRoundTrip)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model->getModelFrame();
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.meshes.resize(1);
+  co.meshes[0].vertices.resize(4);
+  co.meshes[0].vertices[1].x = 1.0;
+  co.meshes[0].vertices[2].y = 1.0;
+  co.meshes[0].vertices[3].z = 1.0;
+  co.meshes[0].triangles.resize(4);
+  co.meshes[0].triangles[0].vertex_indices = { 0, 1, 2 };
+  co.meshes[0].triangles[1].vertex_indices = { 0, 1, 3 };
+  co.meshes[0].triangles[2].vertex_indices = { 0, 2, 3 };
+  co.meshes[0].triangles[3].vertex_indices = { 1, 2, 3 };
+  co.mesh_poses.resize(1);
+  co.mesh_poses[0].orientation.w = 1.0;
+  co.id = "tetrahedron1";
+  ps->processCollisionObjectMsg(co);
+  co.id = "tetrahedron2";
+  co.mesh_poses[0].position.x = 2.0;
+  ps->processCollisionObjectMsg(co);
+  ps->getAllowedCollisionMatrixNonConst().setEntry("tetrahedron1", "panda_link0", true);
+
+  std::stringstream snapshot;
+  ASSERT_TRUE(ps->saveSnapshotToStream(snapshot));
+
+  auto restored = std::make_shared<planning_scene::PlanningScene>(robot_model);
+  ASSERT_TRUE(restored->loadSnapshotFromStream(snapshot));
+  ASSERT_TRUE(restored->getWorld()->hasObject("tetrahedron1"));
+  ASSERT_TRUE(restored->getWorld()->hasObject("tetrahedron2"));
+  const auto& mesh = restored->getWorld()->getObject("tetrahedron2")->shapes_.at(0);
+  EXPECT_EQ(mesh->type, shapes::MESH);
+  EXPECT_EQ(static_cast<const shapes::Mesh&>(*mesh).vertex_count, 4u);
+  EXPECT_NEAR(restored->getWorld()->getObject("tetrahedron2")->shape_poses_.at(0).translation().x(), 2.0, 1e-9);
+  collision_detection::AllowedCollision::Type type;
+  ASSERT_TRUE(restored->getAllowedCollisionMatrix().getEntry("tetrahedron1", "panda_link0", type));
+  EXPECT_EQ(type, collision_detection::AllowedCollision::ALWAYS);
+
+  // corrupt snapshots are rejected without modifying the scene
+  std::string corrupt = snapshot.str();
+  corrupt.resize(corrupt.size() / 2);
+  std::stringstream corrupt_snapshot(corrupt);
+  EXPECT_FALSE(restored->loadSnapshotFromStream(corrupt_snapshot));
+  EXPECT_TRUE(restored->getWorld()->hasObject("tetrahedron1"));
+}
+
 #ifndef INSTANTIATE_TEST_SUITE_P  // prior to gtest 1.10
 #define INSTANTIATE_TEST_SUITE_P(...) INSTANTIATE_TEST_CASE_P(__VA_ARGS__)
 #endif
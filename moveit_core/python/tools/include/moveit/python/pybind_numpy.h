@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <string>
+
+/** Helpers for bindings that process batches of states stored in NumPy arrays */
+
+namespace moveit
+{
+namespace python
+{
+/** A C-contiguous array of doubles. NumPy arrays that already have this layout are passed without a copy,
+    all others are converted once on entry. */
+using DoubleArray = pybind11::array_t<double, pybind11::array::c_style | pybind11::array::forcecast>;
+
+/** Check that \e array has two dimensions with \e columns columns and return its number of rows */
+inline pybind11::ssize_t checkBatchShape(const DoubleArray& array, std::size_t columns, const std::string& name)
+{
+  if (array.ndim() != 2 || array.shape(1) != static_cast<pybind11::ssize_t>(columns))
+    throw pybind11::value_error("Expected '" + name + "' to have shape (N, " + std::to_string(columns) + ")");
+  return array.shape(0);
+}
+
+/** Check that \e array has shape (N, 4, 4), i.e. holds N homogeneous transforms, and return N */
+inline pybind11::ssize_t checkTransformBatchShape(const DoubleArray& array, const std::string& name)
+{
+  if (array.ndim() != 3 || array.shape(1) != 4 || array.shape(2) != 4)
+    throw pybind11::value_error("Expected '" + name + "' to have shape (N, 4, 4)");
+  return array.shape(0);
+}
+
+}  // namespace python
+}  // namespace moveit
@@ -0,0 +1,188 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/kinematics_metrics/kinematics_metrics.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reachability_map
+{
+MOVEIT_CLASS_FORWARD(ReachabilityMap);  // Defines ReachabilityMapPtr, ConstPtr, WeakPtr... etc
+
+/** \brief Voxel grid over the workspace of a group's tip link, storing configurations that reach each voxel.
+ *
+ * Every occupied voxel keeps up to Options::max_seeds_per_voxel configurations, each with the tip orientation it
+ * reaches and its manipulability index. IK queries can then start from stored configurations close to the target
+ * pose instead of random restarts, and candidate poses can be ranked by manipulability before any IK is run.
+ * Positions and orientations are expressed in the model frame. */
+class ReachabilityMap
+{
+public:
+  struct Options
+  {
+    Options() : origin(-1.0, -1.0, -1.0), size(2.0, 2.0, 2.0), resolution(0.05), max_seeds_per_voxel(8)
+    {
+    }
+
+    /** minimum corner of the covered workspace */
+    Eigen::Vector3d origin;
+    /** extent of the covered workspace */
+    Eigen::Vector3d size;
+    /** edge length of a voxel */
+    double resolution;
+    unsigned int max_seeds_per_voxel;
+  };
+
+  /** \brief A configuration reaching a voxel */
+  struct Seed
+  {
+    std::vector<double> joint_values;  ///< group variables in the order of JointModelGroup::getVariableNames()
+    Eigen::Quaterniond orientation;    ///< orientation of the tip link
+    double manipulability;
+  };
+
+  /** \brief Construct an empty map for the given group
+   *
+   * If tip_link is empty, the last link of the group is used.
+   * Throws moveit::ConstructException for unknown groups or links and invalid options. */
+  ReachabilityMap(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group_name,
+                  const std::string& tip_link = "", const Options& options = Options());
+
+  /** \brief Sample random configurations of the group on thread_count threads (0: hardware concurrency) and add
+   * them to the map */
+  void generate(std::size_t num_samples, unsigned int thread_count = 0);
+
+  /** \brief Solve IK for all poses with a single batched query and add the solutions to the map
+   *
+   * Each query is seeded with the closest configuration already stored for the pose, if there is any.
+   * The poses are given in the model frame. Returns the number of poses for which a solution was added. */
+  std::size_t addIKSolutions(const kinematics::KinematicsBase& solver, const EigenSTL::vector_Isometry3d& poses,
+                             double timeout);
+
+  /** \brief Add the configuration of the group in state, whose link transforms need to be up to date, to the map
+   *
+   * When the voxel is full, the configuration replaces the stored one with the lowest manipulability if it is better.
+   * Returns false if the tip is outside of the grid or the configuration was not stored. */
+  bool addConfiguration(const moveit::core::RobotState& state);
+
+  /** \brief Get up to max_count stored configurations for the voxel of the pose, closest in orientation first
+   *
+   * If the voxel is empty, the neighboring voxels are searched. Returns false if no configuration was found. */
+  bool getSeeds(const Eigen::Isometry3d& pose, std::size_t max_count, std::vector<Seed>& seeds) const;
+
+  /** \brief Get the best manipulability index stored for the voxel of position, 0 if it is not known to be reachable */
+  double getManipulability(const Eigen::Vector3d& position) const;
+
+  /** \brief Check whether the voxel of position holds any configuration */
+  bool isReachable(const Eigen::Vector3d& position) const;
+
+  /** \brief Number of voxels holding at least one configuration */
+  std::size_t getOccupiedVoxelCount() const
+  {
+    return voxels_.size();
+  }
+
+  const Options& getOptions() const
+  {
+    return options_;
+  }
+
+  const moveit::core::JointModelGroup* getJointModelGroup() const
+  {
+    return jmg_;
+  }
+
+  const moveit::core::LinkModel* getTipLink() const
+  {
+    return tip_link_;
+  }
+
+  /** \brief Write the map to a binary file, storing occupied voxels only */
+  bool saveToFile(const std::string& filename) const;
+
+  /** \brief Replace the map by the one stored in filename
+   *
+   * Fails if the file was generated for a different group, tip link or grid. */
+  bool loadFromFile(const std::string& filename);
+
+private:
+  /** \brief Occupied voxel: seeds stored as records of orientation (w, x, y, z), manipulability and joint values */
+  struct Voxel
+  {
+    std::vector<double> records;
+    double best_manipulability = 0.0;
+  };
+
+  /** \brief Candidate configuration for a voxel, as a record */
+  using Candidate = std::pair<std::uint32_t, std::vector<double>>;
+
+  /** \brief Compute the voxel coordinates of a position, false if it is outside of the grid */
+  bool getVoxelCoordinates(const Eigen::Vector3d& position, Eigen::Vector3i& coordinates) const;
+
+  std::uint32_t getVoxelIndex(const Eigen::Vector3i& coordinates) const
+  {
+    return coordinates.x() + cells_x_ * (coordinates.y() + cells_y_ * coordinates.z());
+  }
+
+  /** \brief Compute the candidate record for the group configuration in state */
+  bool makeCandidate(const moveit::core::RobotState& state, Candidate& candidate) const;
+
+  /** \brief Store a candidate record in voxels, possibly replacing the worst one of a full voxel */
+  bool insert(std::unordered_map<std::uint32_t, Voxel>& voxels, std::uint32_t index,
+              const std::vector<double>& record) const;
+
+  /** \brief Append the seeds stored in a voxel */
+  void appendSeeds(const Voxel& voxel, std::vector<Seed>& seeds) const;
+
+  moveit::core::RobotModelConstPtr robot_model_;
+  const moveit::core::JointModelGroup* jmg_;
+  const moveit::core::LinkModel* tip_link_;
+  kinematics_metrics::KinematicsMetrics metrics_;
+  Options options_;
+  std::uint32_t cells_x_, cells_y_, cells_z_;
+  std::size_t record_size_;
+  std::unordered_map<std::uint32_t, Voxel> voxels_;
+};
+}  // namespace reachability_map
@@ -0,0 +1,451 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/reachability_map/reachability_map.h>
+#include <moveit/exceptions/exceptions.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <tf2_eigen/tf2_eigen.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace reachability_map
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_reachability_map.reachability_map");
+
+namespace
+{
+constexpr char MAGIC[8] = { 'M', 'V', 'T', 'R', 'E', 'A', 'C', 'H' };
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+// layout of a seed record: orientation (w, x, y, z), manipulability, joint values
+constexpr std::size_t ORIENTATION_OFFSET = 0;
+constexpr std::size_t MANIPULABILITY_OFFSET = 4;
+constexpr std::size_t JOINTS_OFFSET = 5;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeString(std::ostream& out, const std::string& value)
+{
+  writeValue<std::uint32_t>(out, value.size());
+  out.write(value.data(), value.size());
+}
+
+bool readString(std::istream& in, std::string& value)
+{
+  std::uint32_t size;
+  if (!readValue(in, size))
+    return false;
+  value.resize(size);
+  return static_cast<bool>(in.read(value.data(), size));
+}
+}  // namespace
+
+ReachabilityMap::ReachabilityMap(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group_name,
+                                 const std::string& tip_link, const Options& options)
+  : robot_model_(robot_model)
+  , jmg_(robot_model->getJointModelGroup(group_name))
+  , tip_link_(nullptr)
+  , metrics_(robot_model)
+  , options_(options)
+{
+  if (!jmg_)
+    throw moveit::ConstructException("Unknown group '" + group_name + "'");
+  if (jmg_->getLinkModels().empty())
+    throw moveit::ConstructException("Group '" + group_name + "' has no links");
+  tip_link_ = tip_link.empty() ? jmg_->getLinkModels().back() : robot_model->getLinkModel(tip_link);
+  if (!tip_link_)
+    throw moveit::ConstructException("Unknown tip link '" + tip_link + "'");
+  if (options_.resolution <= 0.0 || options_.max_seeds_per_voxel == 0 || (options_.size.array() <= 0.0).any())
+    throw moveit::ConstructException("Invalid reachability map options");
+
+  const Eigen::Vector3d cells = (options_.size / options_.resolution).array().ceil();
+  if (cells.prod() > static_cast<double>(std::numeric_limits<std::uint32_t>::max()))
+    throw moveit::ConstructException("Reachability map grid is too large");
+  cells_x_ = cells.x();
+  cells_y_ = cells.y();
+  cells_z_ = cells.z();
+  record_size_ = JOINTS_OFFSET + jmg_->getVariableCount();
+}
+
+bool ReachabilityMap::getVoxelCoordinates(const Eigen::Vector3d& position, Eigen::Vector3i& coordinates) const
+{
+  const Eigen::Vector3d cell = ((position - options_.origin) / options_.resolution).array().floor();
+  if ((cell.array() < 0.0).any() || cell.x() >= cells_x_ || cell.y() >= cells_y_ || cell.z() >= cells_z_)
+    return false;
+  coordinates = cell.cast<int>();
+  return true;
+}
+
+bool ReachabilityMap::makeCandidate(const moveit::core::RobotState& state, Candidate& candidate) const
+{
+  const Eigen::Isometry3d& tip = state.getGlobalLinkTransform(tip_link_);
+  Eigen::Vector3i coordinates;
+  if (!getVoxelCoordinates(tip.translation(), coordinates))
+    return false;
+  candidate.first = getVoxelIndex(coordinates);
+
+  std::vector<double>& record = candidate.second;
+  record.resize(record_size_);
+  const Eigen::Quaterniond orientation(tip.linear());
+  record[ORIENTATION_OFFSET] = orientation.w();
+  record[ORIENTATION_OFFSET + 1] = orientation.x();
+  record[ORIENTATION_OFFSET + 2] = orientation.y();
+  record[ORIENTATION_OFFSET + 3] = orientation.z();
+  double manipulability = 0.0;
+  metrics_.getManipulabilityIndex(state, jmg_, manipulability);
+  record[MANIPULABILITY_OFFSET] = manipulability;
+  state.copyJointGroupPositions(jmg_, &record[JOINTS_OFFSET]);
+  return true;
+}
+
+bool ReachabilityMap::insert(std::unordered_map<std::uint32_t, Voxel>& voxels, std::uint32_t index,
+                             const std::vector<double>& record) const
+{
+  Voxel& voxel = voxels[index];
+  const double manipulability = record[MANIPULABILITY_OFFSET];
+  const std::size_t count = voxel.records.size() / record_size_;
+  if (count < options_.max_seeds_per_voxel)
+    voxel.records.insert(voxel.records.end(), record.begin(), record.end());
+  else
+  {
+    // replace the seed with the lowest manipulability
+    std::size_t worst = 0;
+    for (std::size_t i = 1; i < count; ++i)
+    {
+      if (voxel.records[i * record_size_ + MANIPULABILITY_OFFSET] <
+          voxel.records[worst * record_size_ + MANIPULABILITY_OFFSET])
+        worst = i;
+    }
+    if (voxel.records[worst * record_size_ + MANIPULABILITY_OFFSET] >= manipulability)
+      return false;
+    std::copy(record.begin(), record.end(), voxel.records.begin() + worst * record_size_);
+  }
+  voxel.best_manipulability = std::max(voxel.best_manipulability, manipulability);
+  return true;
+}
+
+void ReachabilityMap::generate(std::size_t num_samples, unsigned int thread_count)
+{
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, num_samples));
+
+  // every thread fills its own map from its own random number generator, the maps are merged afterwards
+  random_numbers::RandomNumberGenerator seed_rng;
+  std::vector<std::uint32_t> seeds(thread_count);
+  for (std::uint32_t& seed : seeds)
+    seed = seed_rng.uniformInteger(0, std::numeric_limits<int>::max());
+  std::vector<std::unordered_map<std::uint32_t, Voxel>> thread_voxels(thread_count);
+
+  auto sample = [&](unsigned int thread) {
+    moveit::core::RobotState state(robot_model_);
+    state.setToDefaultValues();
+    random_numbers::RandomNumberGenerator rng(seeds[thread]);
+    Candidate candidate;
+    const std::size_t begin = num_samples * thread / thread_count;
+    const std::size_t end = num_samples * (thread + 1) / thread_count;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      state.setToRandomPositions(jmg_, rng);
+      state.updateLinkTransforms();
+      if (makeCandidate(state, candidate))
+        insert(thread_voxels[thread], candidate.first, candidate.second);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < thread_count; ++thread)
+    threads.emplace_back(sample, thread);
+  sample(0);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::vector<double> record(record_size_);
+  for (const std::unordered_map<std::uint32_t, Voxel>& voxels : thread_voxels)
+  {
+    for (const auto& [index, voxel] : voxels)
+    {
+      for (auto it = voxel.records.begin(); it != voxel.records.end(); it += record_size_)
+      {
+        std::copy(it, it + record_size_, record.begin());
+        insert(voxels_, index, record);
+      }
+    }
+  }
+  RCLCPP_INFO(LOGGER, "Reachability map of group '%s' has %zu occupied voxels after %zu samples",
+              jmg_->getName().c_str(), voxels_.size(), num_samples);
+}
+
+std::size_t ReachabilityMap::addIKSolutions(const kinematics::KinematicsBase& solver,
+                                            const EigenSTL::vector_Isometry3d& poses, double timeout)
+{
+  if (solver.getTipFrame() != tip_link_->getName() || !robot_model_->hasLinkModel(solver.getBaseFrame()))
+  {
+    RCLCPP_ERROR(LOGGER, "The IK solver needs to solve for tip '%s' relative to a link of the robot model",
+                 tip_link_->getName().c_str());
+    return 0;
+  }
+
+  // map the joint order of the solver onto the group variables
+  const std::vector<std::string>& joint_names = solver.getJointNames();
+  std::vector<int> variable_indices;
+  for (const std::string& joint_name : joint_names)
+  {
+    variable_indices.push_back(jmg_->getVariableGroupIndex(joint_name));
+    if (variable_indices.back() < 0)
+    {
+      RCLCPP_ERROR(LOGGER, "IK solver joint '%s' is not a variable of group '%s'", joint_name.c_str(),
+                   jmg_->getName().c_str());
+      return 0;
+    }
+  }
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  state.updateLinkTransforms();
+  const Eigen::Isometry3d model_to_base = state.getGlobalLinkTransform(solver.getBaseFrame()).inverse();
+  std::vector<double> default_values;
+  state.copyJointGroupPositions(jmg_, default_values);
+
+  std::vector<geometry_msgs::msg::Pose> ik_poses;
+  std::vector<std::vector<double>> ik_seeds;
+  std::vector<Seed> seeds;
+  for (const Eigen::Isometry3d& pose : poses)
+  {
+    ik_poses.push_back(tf2::toMsg(model_to_base * pose));
+    const std::vector<double>& seed = getSeeds(pose, 1, seeds) ? seeds.front().joint_values : default_values;
+    std::vector<double> ik_seed;
+    for (int index : variable_indices)
+      ik_seed.push_back(seed[index]);
+    ik_seeds.push_back(std::move(ik_seed));
+  }
+
+  std::vector<std::vector<double>> solutions;
+  std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes;
+  solver.searchPositionIKBatch(ik_poses, ik_seeds, timeout, solutions, error_codes);
+
+  std::size_t added = 0;
+  for (std::size_t i = 0; i < solutions.size(); ++i)
+  {
+    if (error_codes[i].val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+      continue;
+    for (std::size_t j = 0; j < joint_names.size(); ++j)
+      state.setVariablePosition(joint_names[j], solutions[i][j]);
+    state.updateLinkTransforms();
+    if (addConfiguration(state))
+      ++added;
+  }
+  return added;
+}
+
+bool ReachabilityMap::addConfiguration(const moveit::core::RobotState& state)
+{
+  Candidate candidate;
+  return makeCandidate(state, candidate) && insert(voxels_, candidate.first, candidate.second);
+}
+
+void ReachabilityMap::appendSeeds(const Voxel& voxel, std::vector<Seed>& seeds) const
+{
+  for (auto it = voxel.records.begin(); it != voxel.records.end(); it += record_size_)
+  {
+    Seed seed;
+    seed.orientation = Eigen::Quaterniond(it[ORIENTATION_OFFSET], it[ORIENTATION_OFFSET + 1],
+                                          it[ORIENTATION_OFFSET + 2], it[ORIENTATION_OFFSET + 3]);
+    seed.manipulability = it[MANIPULABILITY_OFFSET];
+    seed.joint_values.assign(it + JOINTS_OFFSET, it + record_size_);
+    seeds.push_back(std::move(seed));
+  }
+}
+
+bool ReachabilityMap::getSeeds(const Eigen::Isometry3d& pose, std::size_t max_count, std::vector<Seed>& seeds) const
+{
+  seeds.clear();
+  Eigen::Vector3i coordinates;
+  if (!getVoxelCoordinates(pose.translation(), coordinates))
+    return false;
+
+  auto it = voxels_.find(getVoxelIndex(coordinates));
+  if (it != voxels_.end())
+    appendSeeds(it->second, seeds);
+  else
+  {
+    // fall back to the neighboring voxels
+    for (int dz = -1; dz <= 1; ++dz)
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+          const Eigen::Vector3i neighbor = coordinates + Eigen::Vector3i(dx, dy, dz);
+          if ((neighbor.array() < 0).any() || neighbor.x() >= static_cast<int>(cells_x_) ||
+              neighbor.y() >= static_cast<int>(cells_y_) || neighbor.z() >= static_cast<int>(cells_z_))
+            continue;
+          it = voxels_.find(getVoxelIndex(neighbor));
+          if (it != voxels_.end())
+            appendSeeds(it->second, seeds);
+        }
+  }
+
+  const Eigen::Quaterniond orientation(pose.linear());
+  std::sort(seeds.begin(), seeds.end(), [&orientation](const Seed& a, const Seed& b) {
+    return a.orientation.angularDistance(orientation) < b.orientation.angularDistance(orientation);
+  });
+  if (seeds.size() > max_count)
+    seeds.resize(max_count);
+  return !seeds.empty();
+}
+
+double ReachabilityMap::getManipulability(const Eigen::Vector3d& position) const
+{
+  Eigen::Vector3i coordinates;
+  if (!getVoxelCoordinates(position, coordinates))
+    return 0.0;
+  const auto it = voxels_.find(getVoxelIndex(coordinates));
+  return it == voxels_.end() ? 0.0 : it->second.best_manipulability;
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Vector3d& position) const
+{
+  Eigen::Vector3i coordinates;
+  return getVoxelCoordinates(position, coordinates) && voxels_.count(getVoxelIndex(coordinates)) > 0;
+}
+
+bool ReachabilityMap::saveToFile(const std::string& filename) const
+{
+  std::ofstream out(filename, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+  if (!out)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot open '%s' for writing", filename.c_str());
+    return false;
+  }
+
+  out.write(MAGIC, sizeof(MAGIC));
+  writeValue(out, FORMAT_VERSION);
+  writeString(out, jmg_->getName());
+  writeString(out, tip_link_->getName());
+  out.write(reinterpret_cast<const char*>(options_.origin.data()), 3 * sizeof(double));
+  out.write(reinterpret_cast<const char*>(options_.size.data()), 3 * sizeof(double));
+  writeValue(out, options_.resolution);
+  writeValue<std::uint32_t>(out, options_.max_seeds_per_voxel);
+  writeValue<std::uint32_t>(out, record_size_);
+  writeValue<std::uint64_t>(out, voxels_.size());
+  for (const auto& [index, voxel] : voxels_)
+  {
+    writeValue(out, index);
+    writeValue<std::uint32_t>(out, voxel.records.size() / record_size_);
+    writeValue(out, voxel.best_manipulability);
+    out.write(reinterpret_cast<const char*>(voxel.records.data()), voxel.records.size() * sizeof(double));
+  }
+  if (!out)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to write reachability map to '%s'", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ReachabilityMap::loadFromFile(const std::string& filename)
+{
+  std::ifstream in(filename, std::ios_base::binary | std::ios_base::in);
+  if (!in)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot open '%s' for reading", filename.c_str());
+    return false;
+  }
+
+  char magic[sizeof(MAGIC)];
+  std::uint32_t version, max_seeds, record_size;
+  std::string group_name, tip_name;
+  Eigen::Vector3d origin, size;
+  double resolution;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !readValue(in, version) ||
+      version != FORMAT_VERSION || !readString(in, group_name) || !readString(in, tip_name) ||
+      !in.read(reinterpret_cast<char*>(origin.data()), 3 * sizeof(double)) ||
+      !in.read(reinterpret_cast<char*>(size.data()), 3 * sizeof(double)) || !readValue(in, resolution) ||
+      !readValue(in, max_seeds) || !readValue(in, record_size))
+  {
+    RCLCPP_ERROR(LOGGER, "'%s' is not a reachability map of a supported version", filename.c_str());
+    return false;
+  }
+  if (group_name != jmg_->getName() || tip_name != tip_link_->getName() || origin != options_.origin ||
+      size != options_.size || resolution != options_.resolution || max_seeds != options_.max_seeds_per_voxel ||
+      record_size != record_size_)
+  {
+    RCLCPP_ERROR(LOGGER, "Reachability map '%s' was generated for a different group, tip link or grid",
+                 filename.c_str());
+    return false;
+  }
+
+  std::uint64_t voxel_count;
+  if (!readValue(in, voxel_count))
+    return false;
+  std::unordered_map<std::uint32_t, Voxel> voxels;
+  voxels.reserve(voxel_count);
+  for (std::uint64_t i = 0; i < voxel_count; ++i)
+  {
+    std::uint32_t index, count;
+    double best_manipulability;
+    if (!readValue(in, index) || !readValue(in, count) || !readValue(in, best_manipulability) || count > max_seeds ||
+        index >= cells_x_ * cells_y_ * cells_z_)
+    {
+      RCLCPP_ERROR(LOGGER, "Reachability map '%s' is corrupt", filename.c_str());
+      return false;
+    }
+    Voxel& voxel = voxels[index];
+    voxel.best_manipulability = best_manipulability;
+    voxel.records.resize(count * record_size_);
+    if (!in.read(reinterpret_cast<char*>(voxel.records.data()), voxel.records.size() * sizeof(double)))
+    {
+      RCLCPP_ERROR(LOGGER, "Reachability map '%s' is truncated", filename.c_str());
+      return false;
+    }
+  }
+  voxels_ = std::move(voxels);
+  return true;
+}
+}  // namespace reachability_map
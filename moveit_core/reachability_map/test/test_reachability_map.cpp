@@ -0,0 +1,158 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/reachability_map/reachability_map.h>
+#include <moveit/exceptions/exceptions.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+
+class ReachabilityMapTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    jmg_ = robot_model_->getJointModelGroup("panda_arm");
+    options_.origin = Eigen::Vector3d(-1.0, -1.0, -0.5);
+    options_.size = Eigen::Vector3d(2.0, 2.0, 1.8);
+    options_.resolution = 0.1;
+    options_.max_seeds_per_voxel = 4;
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  const moveit::core::JointModelGroup* jmg_;
+  reachability_map::ReachabilityMap::Options options_;
+};
+
+TEST_F(ReachabilityMapTest, RejectsInvalidConstruction)
+{
+  EXPECT_THROW(reachability_map::ReachabilityMap(robot_model_, "no_such_group"), moveit::ConstructException);
+  EXPECT_THROW(reachability_map::ReachabilityMap(robot_model_, "panda_arm", "no_such_link"),
+               moveit::ConstructException);
+  options_.resolution = 0.0;
+  EXPECT_THROW(reachability_map::ReachabilityMap(robot_model_, "panda_arm", "", options_), moveit::ConstructException);
+}
+
+TEST_F(ReachabilityMapTest, AddConfigurationAndLookup)
+{
+  reachability_map::ReachabilityMap map(robot_model_, "panda_arm", "", options_);
+  EXPECT_EQ(map.getTipLink()->getName(), "panda_link8");
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  random_numbers::RandomNumberGenerator rng(42);
+  state.setToRandomPositions(jmg_, rng);
+  state.updateLinkTransforms();
+  const Eigen::Isometry3d& tip = state.getGlobalLinkTransform(map.getTipLink());
+
+  EXPECT_FALSE(map.isReachable(tip.translation()));
+  ASSERT_TRUE(map.addConfiguration(state));
+  EXPECT_EQ(map.getOccupiedVoxelCount(), 1u);
+  EXPECT_TRUE(map.isReachable(tip.translation()));
+
+  std::vector<reachability_map::ReachabilityMap::Seed> seeds;
+  ASSERT_TRUE(map.getSeeds(tip, 5, seeds));
+  ASSERT_EQ(seeds.size(), 1u);
+  std::vector<double> joint_values;
+  state.copyJointGroupPositions(jmg_, joint_values);
+  EXPECT_EQ(seeds[0].joint_values, joint_values);
+  EXPECT_NEAR(seeds[0].orientation.angularDistance(Eigen::Quaterniond(tip.linear())), 0.0, 1e-9);
+  EXPECT_DOUBLE_EQ(map.getManipulability(tip.translation()), seeds[0].manipulability);
+
+  // a neighboring voxel falls back to the seeds around it
+  Eigen::Isometry3d neighbor = tip;
+  neighbor.translation().x() += options_.resolution;
+  if (!map.isReachable(neighbor.translation()))
+    EXPECT_TRUE(map.getSeeds(neighbor, 5, seeds));
+
+  // positions outside of the grid are never reachable
+  EXPECT_FALSE(map.isReachable(Eigen::Vector3d(10.0, 0.0, 0.0)));
+  EXPECT_EQ(map.getManipulability(Eigen::Vector3d(10.0, 0.0, 0.0)), 0.0);
+}
+
+TEST_F(ReachabilityMapTest, KeepsBestSeedsOfFullVoxels)
+{
+  options_.max_seeds_per_voxel = 1;
+  options_.resolution = 2.0;  // a single voxel covering the workspace
+  reachability_map::ReachabilityMap map(robot_model_, "panda_arm", "", options_);
+  map.generate(200, 2);
+  ASSERT_EQ(map.getOccupiedVoxelCount(), 1u);
+
+  std::vector<reachability_map::ReachabilityMap::Seed> seeds;
+  ASSERT_TRUE(map.getSeeds(Eigen::Isometry3d(Eigen::Translation3d(0.5, 0.5, 0.5)), 10, seeds));
+  ASSERT_EQ(seeds.size(), 1u);
+  EXPECT_DOUBLE_EQ(seeds[0].manipulability, map.getManipulability(Eigen::Vector3d(0.5, 0.5, 0.5)));
+}
+
+TEST_F(ReachabilityMapTest, GenerateSaveAndLoad)
+{
+  reachability_map::ReachabilityMap map(robot_model_, "panda_arm", "", options_);
+  map.generate(2000, 2);
+  EXPECT_GT(map.getOccupiedVoxelCount(), 0u);
+
+  const std::string filename = (std::filesystem::temp_directory_path() / "test_reachability_map.bin").string();
+  ASSERT_TRUE(map.saveToFile(filename));
+
+  reachability_map::ReachabilityMap loaded(robot_model_, "panda_arm", "", options_);
+  ASSERT_TRUE(loaded.loadFromFile(filename));
+  EXPECT_EQ(loaded.getOccupiedVoxelCount(), map.getOccupiedVoxelCount());
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  random_numbers::RandomNumberGenerator rng(7);
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    state.setToRandomPositions(jmg_, rng);
+    state.updateLinkTransforms();
+    const Eigen::Vector3d& position = state.getGlobalLinkTransform(map.getTipLink()).translation();
+    EXPECT_EQ(loaded.isReachable(position), map.isReachable(position));
+    EXPECT_EQ(loaded.getManipulability(position), map.getManipulability(position));
+  }
+
+  // maps of a different grid are rejected
+  options_.resolution = 0.2;
+  reachability_map::ReachabilityMap other(robot_model_, "panda_arm", "", options_);
+  EXPECT_FALSE(other.loadFromFile(filename));
+  EXPECT_EQ(other.getOccupiedVoxelCount(), 0u);
+
+  std::filesystem::remove(filename);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -48,6 +48,10 @@ class AABB : public Eigen::AlignedBox3d
 public:
   /** \brief Extend with a box transformed by the given transform. */
   void extendWithTransformedBox(const Eigen::Isometry3d& transform, const Eigen::Vector3d& box);
+
+  /** \brief Extend with a box centered at \e offset in the frame given by \e transform. */
+  void extendWithTransformedBox(const Eigen::Isometry3d& transform, const Eigen::Vector3d& offset,
+                                const Eigen::Vector3d& box);
 };
 }  // namespace core
 }  // namespace moveit
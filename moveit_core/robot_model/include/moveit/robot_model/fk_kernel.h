@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class JointModel;
+
+MOVEIT_CLASS_FORWARD(FKKernel);  // Defines FKKernelPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A forward kinematics routine specialized for a fixed kinematic chain of a particular robot.
+
+    Instances are typically generated ahead of time from the URDF (see create_fk_kernel_plugin.py in
+    moveit_kinematics) and loaded as plugins. Once registered with RobotModel::setFKKernel(), RobotState uses
+    the kernel instead of the generic per-joint computation for the links it covers, whenever the update starts at or
+    above the kernel's first link. Links below the kernel's last link are updated generically. */
+class FKKernel
+{
+public:
+  /** \brief Maximum number of input variables supported by RobotState dispatch */
+  static constexpr std::size_t MAX_VARIABLES = 16;
+
+  /** \brief Maximum number of output links supported by RobotState dispatch */
+  static constexpr std::size_t MAX_LINKS = 32;
+
+  virtual ~FKKernel() = default;
+
+  /** \brief The names of the variables the kernel depends on, in the order expected by computeLinkTransforms() */
+  virtual const std::vector<std::string>& getVariableNames() const = 0;
+
+  /** \brief The names of the links computed by the kernel, parents before children.
+      The parent of the first link must be the base link of the chain. */
+  virtual const std::vector<std::string>& getLinkNames() const = 0;
+
+  /** \brief Compute the transforms of all links in getLinkNames() relative to the base link of the chain
+      \param values The values of the variables in getVariableNames()
+      \param link_transforms Output array with getLinkNames().size() elements */
+  virtual void computeLinkTransforms(const double* values, Eigen::Isometry3d* link_transforms) const = 0;
+
+  /** \brief Compute the (6 x getVariableNames().size()) geometric Jacobian of the origin of the last link
+      relative to the base link of the chain. Rows are linear velocity followed by angular velocity. */
+  virtual void computeJacobian(const double* values, Eigen::MatrixXd& jacobian) const = 0;
+};
+
+/** \brief An FKKernel bound to the variable and link indices of a particular RobotModel */
+struct FKKernelBinding
+{
+  FKKernelConstPtr kernel;
+
+  /** \brief The parent joint of the first link computed by the kernel */
+  const JointModel* root_joint;
+
+  /** \brief For each kernel variable, the index of the variable in the robot state */
+  std::vector<int> variable_indices;
+
+  /** \brief For each kernel link, the index of the link in the robot model */
+  std::vector<int> link_indices;
+};
+}  // namespace core
+}  // namespace moveit
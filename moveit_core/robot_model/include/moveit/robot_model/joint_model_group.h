@@ -41,6 +41,7 @@
 #include <moveit/robot_model/link_model.h>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <srdfdom/model.h>
+#include <Eigen/Core>
 #include <functional>
 #include <set>
 #include <string>
@@ -221,6 +222,12 @@ public:
     return link_model_name_vector_;
   }
 
+  /** \brief Get the links that are part of this joint group and also have geometry associated with them */
+  const std::vector<const LinkModel*>& getLinkModelsWithCollisionGeometry() const
+  {
+    return link_model_with_geometry_vector_;
+  }
+
   /** \brief Get the names of the links that are part of this joint group and also have geometry associated with them */
   const std::vector<std::string>& getLinkModelNamesWithCollisionGeometry() const
   {
@@ -405,6 +412,18 @@ public:
   double distance(const double* state1, const double* state2) const;
   void interpolate(const double* from, const double* to, double t, double* state) const;
 
+  /** \brief Returns true if the group consists only of single-variable revolute and prismatic joints and has no
+      mimic joints. For such groups, enforcePositionBounds(), satisfiesPositionBounds() and distance() with the
+      default bounds operate on whole arrays of variables instead of calling each joint model. */
+  bool hasVectorizedBounds() const
+  {
+    return has_vectorized_bounds_;
+  }
+
+  /** \brief Update the bounds arrays used by hasVectorizedBounds() groups.
+      This needs to be called after the variable bounds of the joints of this group are changed. */
+  void updateVariableBounds();
+
   /** \brief Get the number of variables that describe this joint group. This includes variables necessary for mimic
       joints, so will always be >= getActiveVariableCount() */
   unsigned int getVariableCount() const
@@ -729,6 +748,19 @@ protected:
 
   bool is_single_dof_;
 
+  /** \brief True if the bounds of this group are available in the arrays below, see hasVectorizedBounds() */
+  bool has_vectorized_bounds_;
+
+  /** \brief Position bounds of the variables in group state order; infinite for continuous joints */
+  Eigen::ArrayXd variable_min_positions_;
+  Eigen::ArrayXd variable_max_positions_;
+
+  /** \brief Distance factor of the joint of each variable */
+  Eigen::ArrayXd variable_distance_factors_;
+
+  /** \brief Group state indices of the variables of continuous joints, which need wrapping */
+  std::vector<int> continuous_variable_indices_;
+
   struct GroupMimicUpdate
   {
     GroupMimicUpdate(int s, int d, double f, double o) : src(s), dest(d), factor(f), offset(o)
@@ -43,6 +43,7 @@
 
 // joint types
 #include <moveit/robot_model/joint_model_group.h>
+#include <moveit/robot_model/fk_kernel.h>
 #include <moveit/robot_model/fixed_joint_model.h>
 #include <moveit/robot_model/floating_joint_model.h>
 #include <moveit/robot_model/planar_joint_model.h>
@@ -60,6 +61,10 @@ namespace core
 {
 MOVEIT_CLASS_FORWARD(RobotModel);  // Defines RobotModelPtr, ConstPtr, WeakPtr... etc
 
+/** \brief Function type for loading the mesh of a URDF mesh geometry, with the signature of
+    shapes::createMeshFromResource(). Ownership of the returned mesh passes to the caller. */
+typedef std::function<shapes::Mesh*(const std::string& resource, const Eigen::Vector3d& scale)> MeshLoaderFn;
+
 static inline void checkInterpolationParamBounds(const rclcpp::Logger& LOGGER, double t)
 {
   if (std::isnan(t) || std::isinf(t))
@@ -78,6 +83,11 @@ public:
   /** \brief Construct a kinematic model from a parsed description and a list of planning groups */
   RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model);
 
+  /** \brief Construct a kinematic model, loading the meshes of collision geometries with \e mesh_loader
+      instead of shapes::createMeshFromResource(). This allows callers to provide previously decoded meshes. */
+  RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+             const MeshLoaderFn& mesh_loader);
+
   /** \brief Destructor. Clear all memory. */
   ~RobotModel();
 
@@ -370,6 +380,17 @@ public:
    */
   void interpolate(const double* from, const double* to, double t, double* state) const;
 
+  /**
+   * Interpolate between "from" state, to "to" state, for each of the given fractions. Mimic joints are correctly
+   * updated. Single-variable joints with linear interpolation are processed for all fractions at once.
+   *
+   * @param from interpolate from this state
+   * @param to to this state
+   * @param fractions fractions in the range [0 1]
+   * @param states holds the result, fractions.size() consecutive states of getVariableCount() values each
+   */
+  void interpolate(const double* from, const double* to, const std::vector<double>& fractions, double* states) const;
+
   /** \name Access to joint groups
    *  @{
    */
@@ -464,6 +485,18 @@ public:
   /// A map of known kinematics solvers (associated to their group name)
   void setKinematicsAllocators(const std::map<std::string, SolverAllocatorFn>& allocators);
 
+  /** \brief Register a specialized forward kinematics kernel, which RobotState uses to update the links it covers.
+      Returns false (and leaves the model unchanged) if the kernel does not match this model. */
+  bool setFKKernel(const FKKernelConstPtr& kernel);
+
+  /** \brief Get the registered FK kernel that computes the transform of \e link, or nullptr if there is none */
+  const FKKernelBinding* getFKKernelBinding(const LinkModel* link) const
+  {
+    if (fk_kernel_link_bindings_.empty())
+      return nullptr;
+    return fk_kernel_link_bindings_[link->getLinkIndex()];
+  }
+
 protected:
   /** \brief Get the transforms between link and all its rigidly attached descendants */
   void computeFixedTransforms(const LinkModel* link, const Eigen::Isometry3d& transform,
@@ -601,6 +634,15 @@ protected:
   /** \brief The array of end-effectors, in alphabetical order */
   std::vector<const JointModelGroup*> end_effectors_;
 
+  /** \brief Registered FK kernels */
+  std::vector<std::unique_ptr<FKKernelBinding>> fk_kernel_bindings_;
+
+  /** \brief For each link, the registered FK kernel computing it (or nullptr). Empty if no kernel is registered. */
+  std::vector<const FKKernelBinding*> fk_kernel_link_bindings_;
+
+  /** \brief The function used to load meshes while the model is built. Empty to use shapes::createMeshFromResource() */
+  MeshLoaderFn mesh_loader_;
+
 private:
   /** \brief Given an URDF model and a SRDF model, build a full kinematic model */
   void buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model);
@@ -45,15 +45,17 @@ void moveit::core::AABB::extendWithTransformedBox(const Eigen::Isometry3d& trans
   //
   // Here's a nice explanation why it works: https://zeuxcg.org/2010/10/17/aabb-from-obb-with-component-wise-abs/
 
-  ASSERT_ISOMETRY(transform)  // unsanitized input, could contain non-isometry
-  const Eigen::Matrix3d& r = transform.linear();
-  const Eigen::Vector3d& t = transform.translation();
+  extendWithTransformedBox(transform, Eigen::Vector3d::Zero(), box);
+}
 
-  double x_range = 0.5 * (fabs(r(0, 0) * box[0]) + fabs(r(0, 1) * box[1]) + fabs(r(0, 2) * box[2]));
-  double y_range = 0.5 * (fabs(r(1, 0) * box[0]) + fabs(r(1, 1) * box[1]) + fabs(r(1, 2) * box[2]));
-  double z_range = 0.5 * (fabs(r(2, 0) * box[0]) + fabs(r(2, 1) * box[1]) + fabs(r(2, 2) * box[2]));
+void moveit::core::AABB::extendWithTransformedBox(const Eigen::Isometry3d& transform, const Eigen::Vector3d& offset,
+                                                  const Eigen::Vector3d& box)
+{
+  ASSERT_ISOMETRY(transform)  // unsanitized input, could contain non-isometry
+  const Eigen::Vector3d center = transform * offset;
 
-  const Eigen::Vector3d v_delta(x_range, y_range, z_range);
-  extend(t + v_delta);
-  extend(t - v_delta);
+  // component-wise expressions, which Eigen evaluates with packet (SIMD) operations where available
+  const Eigen::Vector3d v_delta = 0.5 * (transform.linear().cwiseAbs() * box);
+  m_min = m_min.cwiseMin(center - v_delta);
+  m_max = m_max.cwiseMax(center + v_delta);
 }
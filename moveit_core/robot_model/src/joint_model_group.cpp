@@ -42,6 +42,8 @@
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include "order_robot_model_items.inc"
 
@@ -263,10 +265,46 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
     if (chain)
       is_chain_ = true;
   }
+
+  // check if the bounds can be handled with array operations
+  has_vectorized_bounds_ = mimic_joints_.empty() && !active_joint_model_vector_.empty();
+  for (const JointModel* joint_model : active_joint_model_vector_)
+    if (joint_model->getType() != JointModel::REVOLUTE && joint_model->getType() != JointModel::PRISMATIC)
+      has_vectorized_bounds_ = false;
+  updateVariableBounds();
 }
 
 JointModelGroup::~JointModelGroup() = default;
 
+void JointModelGroup::updateVariableBounds()
+{
+  if (!has_vectorized_bounds_)
+    return;
+
+  const std::size_t n = active_joint_model_vector_.size();
+  variable_min_positions_.resize(n);
+  variable_max_positions_.resize(n);
+  variable_distance_factors_.resize(n);
+  continuous_variable_indices_.clear();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const JointModel* joint_model = active_joint_model_vector_[i];
+    variable_distance_factors_[i] = joint_model->getDistanceFactor();
+    if (joint_model->getType() == JointModel::REVOLUTE &&
+        static_cast<const RevoluteJointModel*>(joint_model)->isContinuous())
+    {
+      variable_min_positions_[i] = -std::numeric_limits<double>::infinity();
+      variable_max_positions_[i] = std::numeric_limits<double>::infinity();
+      continuous_variable_indices_.push_back(i);
+    }
+    else
+    {
+      variable_min_positions_[i] = (*active_joint_models_bounds_[i])[0].min_position_;
+      variable_max_positions_[i] = (*active_joint_models_bounds_[i])[0].max_position_;
+    }
+  }
+}
+
 void JointModelGroup::setSubgroupNames(const std::vector<std::string>& subgroups)
 {
   subgroup_names_ = subgroups;
@@ -383,6 +421,12 @@ bool JointModelGroup::satisfiesPositionBounds(const double* state, const JointBo
                                               double margin) const
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
+  if (has_vectorized_bounds_ && &active_joint_bounds == &active_joint_models_bounds_)
+  {
+    Eigen::Map<const Eigen::ArrayXd> values(state, variable_min_positions_.size());
+    return !((values < variable_min_positions_ - margin) || (values > variable_max_positions_ + margin)).any();
+  }
+
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
     if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
                                                                 *active_joint_bounds[i], margin))
@@ -394,6 +438,31 @@ bool JointModelGroup::enforcePositionBounds(double* state, const JointBoundsVect
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   bool change = false;
+  if (has_vectorized_bounds_ && &active_joint_bounds == &active_joint_models_bounds_)
+  {
+    Eigen::Map<Eigen::ArrayXd> values(state, variable_min_positions_.size());
+    if (((values < variable_min_positions_) || (values > variable_max_positions_)).any())
+    {
+      values = values.max(variable_min_positions_).min(variable_max_positions_);
+      change = true;
+    }
+    // same normalization as RevoluteJointModel::enforcePositionBounds()
+    for (int i : continuous_variable_indices_)
+    {
+      double& v = state[i];
+      if (v <= -M_PI || v > M_PI)
+      {
+        v = fmod(v, 2.0 * M_PI);
+        if (v <= -M_PI)
+          v += 2.0 * M_PI;
+        else if (v > M_PI)
+          v -= 2.0 * M_PI;
+        change = true;
+      }
+    }
+    return change;
+  }
+
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
     if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
                                                              *active_joint_bounds[i]))
@@ -414,6 +483,23 @@ double JointModelGroup::getMaximumExtent(const JointBoundsVector& active_joint_b
 
 double JointModelGroup::distance(const double* state1, const double* state2) const
 {
+  if (has_vectorized_bounds_)
+  {
+    const std::size_t n = variable_distance_factors_.size();
+    Eigen::Map<const Eigen::ArrayXd> values1(state1, n), values2(state2, n);
+    double d = (variable_distance_factors_ * (values1 - values2).abs()).sum();
+    // correct the distance of continuous joints, as in RevoluteJointModel::distance()
+    for (int i : continuous_variable_indices_)
+    {
+      const double raw = fabs(state1[i] - state2[i]);
+      double wrapped = fmod(raw, 2.0 * M_PI);
+      if (wrapped > M_PI)
+        wrapped = 2.0 * M_PI - wrapped;
+      d += variable_distance_factors_[i] * (wrapped - raw);
+    }
+    return d;
+  }
+
   double d = 0.0;
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
     d += active_joint_model_vector_[i]->getDistanceFactor() *
@@ -59,6 +59,16 @@ RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const sr
   buildModel(*urdf_model, *srdf_model);
 }
 
+RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+                       const MeshLoaderFn& mesh_loader)
+  : mesh_loader_(mesh_loader)
+{
+  root_joint_ = nullptr;
+  urdf_ = urdf_model;
+  srdf_ = srdf_model;
+  buildModel(*urdf_model, *srdf_model);
+}
+
 RobotModel::~RobotModel()
 {
   for (std::pair<const std::string, JointModelGroup*>& it : joint_model_group_map_)
@@ -1192,7 +1202,8 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
       if (!mesh->filename.empty())
       {
         Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
-        shapes::Mesh* m = shapes::createMeshFromResource(mesh->filename, scale);
+        shapes::Mesh* m = mesh_loader_ ? mesh_loader_(mesh->filename, scale) :
+                                         shapes::createMeshFromResource(mesh->filename, scale);
         new_shape = m;
       }
     }
@@ -1426,6 +1437,113 @@ void RobotModel::interpolate(const double* from, const double* to, double t, dou
   updateMimicJoints(state);
 }
 
+void RobotModel::interpolate(const double* from, const double* to, const std::vector<double>& fractions,
+                             double* states) const
+{
+  for (double t : fractions)
+    moveit::core::checkInterpolationParamBounds(LOGGER, t);
+
+  const std::size_t count = fractions.size();
+  for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
+  {
+    const JointModel* joint = active_joint_model_vector_[i];
+    const int idx = active_joint_model_start_index_[i];
+    if (joint->getType() == JointModel::PRISMATIC ||
+        (joint->getType() == JointModel::REVOLUTE && !static_cast<const RevoluteJointModel*>(joint)->isContinuous()))
+    {
+      // same arithmetic as the joint models, hoisted out of the loop over fractions
+      const double start = from[idx];
+      const double delta = to[idx] - from[idx];
+      for (std::size_t k = 0; k < count; ++k)
+        states[k * variable_count_ + idx] = start + delta * fractions[k];
+    }
+    else
+    {
+      for (std::size_t k = 0; k < count; ++k)
+        joint->interpolate(from + idx, to + idx, fractions[k], states + k * variable_count_ + idx);
+    }
+  }
+
+  // now we update mimic as needed
+  if (!mimic_joints_.empty())
+    for (std::size_t k = 0; k < count; ++k)
+      updateMimicJoints(states + k * variable_count_);
+}
+
+bool RobotModel::setFKKernel(const FKKernelConstPtr& kernel)
+{
+  if (!kernel)
+    return false;
+
+  const std::vector<std::string>& variable_names = kernel->getVariableNames();
+  const std::vector<std::string>& link_names = kernel->getLinkNames();
+  if (link_names.empty() || link_names.size() > FKKernel::MAX_LINKS ||
+      variable_names.size() > FKKernel::MAX_VARIABLES)
+  {
+    RCLCPP_ERROR(LOGGER, "FK kernel must compute between 1 and %zu links depending on at most %zu variables",
+                 FKKernel::MAX_LINKS, FKKernel::MAX_VARIABLES);
+    return false;
+  }
+
+  auto binding = std::make_unique<FKKernelBinding>();
+  binding->kernel = kernel;
+  for (const std::string& variable_name : variable_names)
+  {
+    const auto it = joint_variables_index_map_.find(variable_name);
+    if (it == joint_variables_index_map_.end())
+    {
+      RCLCPP_ERROR(LOGGER, "FK kernel depends on unknown variable '%s'", variable_name.c_str());
+      return false;
+    }
+    binding->variable_indices.push_back(it->second);
+  }
+
+  for (const std::string& link_name : link_names)
+  {
+    const LinkModel* link = getLinkModel(link_name);
+    if (!link)
+    {
+      RCLCPP_ERROR(LOGGER, "FK kernel computes unknown link '%s'", link_name.c_str());
+      return false;
+    }
+    if (getFKKernelBinding(link))
+    {
+      RCLCPP_ERROR(LOGGER, "Link '%s' is already computed by another FK kernel", link_name.c_str());
+      return false;
+    }
+    const LinkModel* parent = link->getParentLinkModel();
+    if (binding->link_indices.empty())
+      binding->root_joint = link->getParentJointModel();
+    else if (!parent || std::find(binding->link_indices.begin(), binding->link_indices.end(),
+                                  parent->getLinkIndex()) == binding->link_indices.end())
+    {
+      RCLCPP_ERROR(LOGGER, "FK kernel links must form a subtree listed parents first, '%s' has no computed parent",
+                   link_name.c_str());
+      return false;
+    }
+
+    // the transform of the link depends on the variables of its parent joint, which need to be kernel inputs
+    for (const std::string& variable_name : link->getParentJointModel()->getVariableNames())
+      if (std::find(variable_names.begin(), variable_names.end(), variable_name) == variable_names.end())
+      {
+        RCLCPP_ERROR(LOGGER, "FK kernel computes link '%s', but does not depend on variable '%s'", link_name.c_str(),
+                     variable_name.c_str());
+        return false;
+      }
+
+    binding->link_indices.push_back(link->getLinkIndex());
+  }
+
+  if (fk_kernel_link_bindings_.empty())
+    fk_kernel_link_bindings_.resize(link_model_vector_.size(), nullptr);
+  for (int link_index : binding->link_indices)
+    fk_kernel_link_bindings_[link_index] = binding.get();
+  RCLCPP_DEBUG(LOGGER, "Using FK kernel for %zu links below joint '%s'", link_names.size(),
+               binding->root_joint->getName().c_str());
+  fk_kernel_bindings_.push_back(std::move(binding));
+  return true;
+}
+
 void RobotModel::setKinematicsAllocators(const std::map<std::string, SolverAllocatorFn>& allocators)
 {
   // we first set all the "simple" allocators -- where a group has one IK solver
@@ -172,6 +172,42 @@ TEST(FloatingJointTest, interpolation_test)
   }
 }
 
+TEST_F(LoadPlanningModelsPr2, VectorizedBounds)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("right_arm");
+  ASSERT_TRUE(group->hasVectorizedBounds());
+
+  random_numbers::RandomNumberGenerator rng(0);
+  const std::vector<const moveit::core::JointModel*>& joints = group->getActiveJointModels();
+  std::vector<double> values1(group->getVariableCount()), values2(group->getVariableCount());
+  for (int k = 0; k < 100; ++k)
+  {
+    // sample beyond the bounds, and beyond [-pi, pi] for continuous joints
+    for (std::size_t i = 0; i < values1.size(); ++i)
+    {
+      values1[i] = rng.uniformReal(-6.0, 6.0);
+      values2[i] = rng.uniformReal(-6.0, 6.0);
+    }
+
+    bool satisfied = true;
+    double expected_distance = 0.0;
+    std::vector<double> expected_enforced = values1;
+    bool expected_change = false;
+    for (std::size_t i = 0; i < joints.size(); ++i)
+    {
+      satisfied &= joints[i]->satisfiesPositionBounds(&values1[i], 0.1);
+      expected_distance += joints[i]->getDistanceFactor() * joints[i]->distance(&values1[i], &values2[i]);
+      expected_change |= joints[i]->enforcePositionBounds(&expected_enforced[i]);
+    }
+
+    EXPECT_EQ(group->satisfiesPositionBounds(values1.data(), 0.1), satisfied);
+    EXPECT_NEAR(group->distance(values1.data(), values2.data()), expected_distance, 1e-9);
+    EXPECT_EQ(group->enforcePositionBounds(values1.data()), expected_change);
+    for (std::size_t i = 0; i < values1.size(); ++i)
+      EXPECT_NEAR(values1[i], expected_enforced[i], 1e-12);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -41,8 +41,10 @@
 #include <geometric_shapes/check_isometry.h>
 #include <eigen_stl_containers/eigen_stl_containers.h>
 #include <trajectory_msgs/msg/joint_trajectory.hpp>
+#include <atomic>
 #include <set>
 #include <functional>
+#include <mutex>
 
 namespace moveit
 {
@@ -68,6 +70,9 @@ public:
                const std::set<std::string>& touch_links, const trajectory_msgs::msg::JointTrajectory& detach_posture,
                const moveit::core::FixedTransformsMap& subframe_poses = moveit::core::FixedTransformsMap());
 
+  /** \brief Copy an attached body, including its lazily computed global transforms */
+  AttachedBody(const AttachedBody& other);
+
   ~AttachedBody();
 
   /** \brief Get the name of the attached body */
@@ -106,6 +111,12 @@ public:
     return shapes_;
   }
 
+  /** \brief Get the extents of the axis-aligned bounding boxes of the shapes, in the shapes' own frames */
+  const EigenSTL::vector_Vector3d& getShapeExtents() const
+  {
+    return shape_extents_;
+  }
+
   /** \brief Get the shape poses (the transforms to the shapes of this body, relative to the pose). The returned
    *  transforms are guaranteed to be valid isometries. */
   const EigenSTL::vector_Isometry3d& getShapePoses() const
@@ -151,6 +162,8 @@ public:
   /** \brief Get subframes of this object (in the world frame) */
   const moveit::core::FixedTransformsMap& getGlobalSubframeTransforms() const
   {
+    if (subframe_transforms_dirty_.load(std::memory_order_acquire))
+      updateGlobalSubframeTransforms();
     return global_subframe_poses_;
   }
 
@@ -166,6 +179,8 @@ public:
       ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
     }
     subframe_poses_ = subframe_poses;
+    global_subframe_poses_ = subframe_poses;
+    subframe_transforms_dirty_.store(true, std::memory_order_release);
   }
 
   /** \brief Get the fixed transform to a named subframe on this body (relative to the body's pose)
@@ -191,6 +206,8 @@ public:
    *  guaranteed to be valid isometries. */
   const EigenSTL::vector_Isometry3d& getGlobalCollisionBodyTransforms() const
   {
+    if (collision_body_transforms_dirty_.load(std::memory_order_acquire))
+      updateGlobalCollisionBodyTransforms();
     return global_collision_body_transforms_;
   }
 
@@ -200,10 +217,19 @@ public:
   /** \brief Set the scale for the shapes of this attached object */
   void setScale(double scale);
 
-  /** \brief Recompute global_collision_body_transform given the transform of the parent link */
+  /** \brief Recompute the global pose given the transform of the parent link.
+   *
+   * The global transforms of the collision bodies and subframes are only marked as outdated here; they are
+   * recomputed on their first access, so bodies that are never queried do not pay for them. */
   void computeTransform(const Eigen::Isometry3d& parent_link_global_transform);
 
 private:
+  /** \brief Recompute global_collision_body_transforms_ from global_pose_ (if still outdated) */
+  void updateGlobalCollisionBodyTransforms() const;
+
+  /** \brief Recompute global_subframe_poses_ from global_pose_ (if still outdated) */
+  void updateGlobalSubframeTransforms() const;
+
   /** \brief The link that owns this attached body */
   const LinkModel* parent_link_model_;
 
@@ -219,14 +245,17 @@ private:
   /** \brief The geometries of the attached body */
   std::vector<shapes::ShapeConstPtr> shapes_;
 
+  /** \brief The extents of shapes_, cached for bounding box computations */
+  EigenSTL::vector_Vector3d shape_extents_;
+
   /** \brief The transforms from the object's pose to the object's geometries*/
   EigenSTL::vector_Isometry3d shape_poses_;
 
   /** \brief The transforms from the link to the object's geometries*/
   EigenSTL::vector_Isometry3d shape_poses_in_link_frame_;
 
-  /** \brief The global transforms for the attached bodies (computed by forward kinematics) */
-  EigenSTL::vector_Isometry3d global_collision_body_transforms_;
+  /** \brief The global transforms for the attached bodies (computed lazily from global_pose_) */
+  mutable EigenSTL::vector_Isometry3d global_collision_body_transforms_;
 
   /** \brief The set of links this body is allowed to touch */
   std::set<std::string> touch_links_;
@@ -238,8 +267,18 @@ private:
   /** \brief Transforms to subframes on the object, relative to the object's pose. */
   moveit::core::FixedTransformsMap subframe_poses_;
 
-  /** \brief Transforms to subframes on the object, relative to the model frame. */
-  moveit::core::FixedTransformsMap global_subframe_poses_;
+  /** \brief Transforms to subframes on the object, relative to the model frame (computed lazily from global_pose_) */
+  mutable moveit::core::FixedTransformsMap global_subframe_poses_;
+
+  /** \brief Flags whether global_collision_body_transforms_ / global_subframe_poses_ lag behind global_pose_ */
+  mutable std::atomic<bool> collision_body_transforms_dirty_{ false };
+  mutable std::atomic<bool> subframe_transforms_dirty_{ false };
+
+  /** \brief Recompute shape_extents_ after shapes_ changed */
+  void updateShapeExtents();
+
+  /** \brief Serializes the lazy updates, as const accessors may be called concurrently */
+  mutable std::mutex global_transforms_lock_;
 };
 }  // namespace core
 }  // namespace moveit
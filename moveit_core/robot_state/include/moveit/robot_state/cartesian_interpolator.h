@@ -225,6 +225,48 @@ public:
       const kinematics::KinematicsBase::IKCostFn& cost_function = kinematics::KinematicsBase::IKCostFn(),
       const Eigen::Isometry3d& link_offset = Eigen::Isometry3d::Identity());
 
+  /** \brief Compute a general Cartesian path like the previous function, pipelining IK and state validation.
+
+     IK for the interpolated poses proceeds seeded from the previous solution without the \e validCallback, while
+     \e validation_thread_count worker threads validate the resulting states with \e validCallback concurrently, so
+     \e validCallback must be safe to call from several threads. If a state turns out to be invalid, the path is
+     computed sequentially from that state on, with \e validCallback passed to IK as in computeCartesianPath(). As the
+     first IK solution is the one accepted by the callback, the result is the same as that of computeCartesianPath()
+     for deterministic solvers.
+
+     Absolute joint-space jumps are detected while the path is computed, which stops the computation immediately. The
+     returned percentage then corresponds to the part of the path before the jump. */
+  static Percentage computeCartesianPathPipelined(
+      RobotState* start_state, const JointModelGroup* group, std::vector<std::shared_ptr<RobotState>>& traj,
+      const LinkModel* link, const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame,
+      const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
+      const GroupStateValidityCallbackFn& validCallback, std::size_t validation_thread_count,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      const kinematics::KinematicsBase::IKCostFn& cost_function = kinematics::KinematicsBase::IKCostFn(),
+      const Eigen::Isometry3d& link_offset = Eigen::Isometry3d::Identity());
+
+  /** \brief Compute a general Cartesian path like computeCartesianPath(), computing the segments between
+     consecutive waypoints concurrently.
+
+     The start state of every segment is obtained by IK for the preceding waypoint, seeded from the start state of the
+     previous segment, and up to \e thread_count threads then interpolate the segments independently. Hence
+     \e validCallback and the kinematics solver of \e group must be safe to call from several threads. The segments are
+     stitched where the end of a segment matches the start of the next one. From the first segment that is not
+     completed or does not connect to its predecessor on, the path is computed sequentially. If the stitched path
+     contains a joint-space jump, the whole path is recomputed sequentially, so the result never contains a jump that
+     computeCartesianPath() would have avoided.
+
+     Waypoints given w.r.t. the link frame (\e global_reference_frame false), fewer than two waypoints or a
+     \e thread_count below two fall back to computeCartesianPath(). */
+  static Percentage computeCartesianPathParallel(
+      RobotState* start_state, const JointModelGroup* group, std::vector<std::shared_ptr<RobotState>>& traj,
+      const LinkModel* link, const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame,
+      const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
+      const GroupStateValidityCallbackFn& validCallback, std::size_t thread_count,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      const kinematics::KinematicsBase::IKCostFn& cost_function = kinematics::KinematicsBase::IKCostFn(),
+      const Eigen::Isometry3d& link_offset = Eigen::Isometry3d::Identity());
+
   /** \brief Tests joint space jumps of a trajectory.
 
      If \e jump_threshold_factor is non-zero, we test for relative jumps.
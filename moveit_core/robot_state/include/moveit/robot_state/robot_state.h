@@ -59,7 +59,8 @@ namespace moveit
 {
 namespace core
 {
-MOVEIT_CLASS_FORWARD(RobotState);  // Defines RobotStatePtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(RobotState);      // Defines RobotStatePtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(RobotStatePool);  // Defines RobotStatePoolPtr, ConstPtr, WeakPtr... etc
 
 /** \brief Signature for functions that can verify that if the group \e joint_group in \e robot_state is set to \e
    joint_group_variable_values
@@ -92,11 +93,30 @@ public:
   /** \brief A state can be constructed from a specified robot model. No values are initialized.
       Call setToDefaultValues() if a state needs to provide valid information. */
   RobotState(const RobotModelConstPtr& robot_model);
+
+  /** \brief Construct a state whose memory is taken from \e pool instead of the heap.
+      The pool is kept alive as long as the state exists. If the pool is exhausted, the heap is used as usual.
+      Copies of this state allocate their memory from the same pool. */
+  RobotState(const RobotModelConstPtr& robot_model, const RobotStatePoolPtr& pool);
   ~RobotState();
 
   /** \brief Copy constructor. */
   RobotState(const RobotState& other);
 
+  /** \brief Get the number of bytes a state of \e robot_model needs for positions, velocities,
+      accelerations, efforts and transforms, including padding for alignment. */
+  static std::size_t getMemorySize(const RobotModel& robot_model);
+
+  /** \brief Estimate the number of bytes held by this state: its variables and transforms, the cached Jacobians and
+      the attached bodies, without the data of their shapes. */
+  std::size_t getMemoryUsage() const;
+
+  /** \brief Get the pool the memory of this state is taken from, if any */
+  const RobotStatePoolPtr& getMemoryPool() const
+  {
+    return memory_pool_;
+  }
+
   /** \brief Copy operator */
   RobotState& operator=(const RobotState& other);
 
@@ -1159,14 +1179,12 @@ public:
    * \param use_quaternion_representation Flag indicating if the Jacobian should use a quaternion representation
    * (default is false)
    * \return True if jacobian was successfully computed, false otherwise
+   *
+   * In contrast to the const version, this version caches the result. Repeated calls with the same arguments
+   * return the cached Jacobian until the link transforms of this state are recomputed.
    */
   bool getJacobian(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
-                   Eigen::MatrixXd& jacobian, bool use_quaternion_representation = false)
-  {
-    updateLinkTransforms();
-    return static_cast<const RobotState*>(this)->getJacobian(group, link, reference_point_position, jacobian,
-                                                             use_quaternion_representation);
-  }
+                   Eigen::MatrixXd& jacobian, bool use_quaternion_representation = false);
 
   /** \brief Compute the Jacobian with reference to the last link of a specified group. If the group is not a chain, an
    * exception is thrown.
@@ -1185,9 +1203,37 @@ public:
    */
   Eigen::MatrixXd getJacobian(const JointModelGroup* group,
                               const Eigen::Vector3d& reference_point_position = Eigen::Vector3d(0.0, 0.0, 0.0))
+  {
+    Eigen::MatrixXd result;
+    if (!getJacobian(group, group->getLinkModels().back(), reference_point_position, result, false))
+      throw Exception("Unable to compute Jacobian");
+    return result;
+  }
+
+  /** \brief Compute the time derivative of the Jacobian with reference to a particular point on a given link,
+   * for a specified group moving with \e joint_velocities.
+   *
+   * The result is expressed in the same frame as getJacobian() and can be used by velocity-level controllers,
+   * e.g. to compute the Cartesian acceleration as J * qddot + Jdot * qdot. Only revolute and prismatic joints
+   * are supported.
+   * \param group The group to compute the Jacobian derivative for (must be a chain)
+   * \param link The link model to compute the Jacobian derivative for
+   * \param reference_point_position The reference point position (with respect to the link specified in link)
+   * \param joint_velocities The velocities of the variables of \e group
+   * \param jacobian_derivative The resultant (6 x group variable count) matrix
+   * \return True if the derivative was successfully computed, false otherwise
+   */
+  bool getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position, const Eigen::VectorXd& joint_velocities,
+                             Eigen::MatrixXd& jacobian_derivative) const;
+
+  bool getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position, const Eigen::VectorXd& joint_velocities,
+                             Eigen::MatrixXd& jacobian_derivative)
   {
     updateLinkTransforms();
-    return static_cast<const RobotState*>(this)->getJacobian(group, reference_point_position);
+    return static_cast<const RobotState*>(this)->getJacobianDerivative(group, link, reference_point_position,
+                                                                       joint_velocities, jacobian_derivative);
   }
 
   /** \brief Given a twist for a particular link (\e tip), compute the corresponding velocity for every variable and
@@ -1480,6 +1526,20 @@ public:
    */
   void interpolate(const RobotState& to, double t, RobotState& state) const;
 
+  /**
+   * Interpolate towards "to" state for each of the given fractions, writing the variable positions of the results
+   * into a preallocated buffer. Mimic joints are correctly updated. This avoids constructing a RobotState for each
+   * intermediate state, e.g. when densifying paths; see also RobotStateBatch::interpolate().
+   *
+   * @param to interpolate to this state
+   * @param fractions fractions in the range [0 1]
+   * @param states holds the result, fractions.size() consecutive blocks of getVariableCount() positions
+   */
+  void interpolate(const RobotState& to, const std::vector<double>& fractions, double* states) const
+  {
+    robot_model_->interpolate(position_, to.position_, fractions, states);
+  }
+
   /**
    * Interpolate towards "to" state, but only for the joints in the specified group. Mimic joints are correctly updated
    * and flags are set so that FK is recomputed when needed.
@@ -1708,6 +1768,18 @@ public:
     static_cast<const RobotState*>(this)->computeAABB(aabb);
   }
 
+  /** \brief Compute an axis-aligned bounding box that contains the links of \e group and the bodies attached to them.
+      The format for \e aabb is (minx, maxx, miny, maxy, minz, maxz) */
+  void computeAABB(const JointModelGroup* group, std::vector<double>& aabb) const;
+
+  /** \brief Compute an axis-aligned bounding box that contains the links of \e group and the bodies attached to them.
+      The format for \e aabb is (minx, maxx, miny, maxy, minz, maxz) */
+  void computeAABB(const JointModelGroup* group, std::vector<double>& aabb)
+  {
+    updateLinkTransforms();
+    static_cast<const RobotState*>(this)->computeAABB(group, aabb);
+  }
+
   /** \brief Return the instance of a random number generator */
   random_numbers::RandomNumberGenerator& getRandomNumberGenerator()
   {
@@ -1822,22 +1894,52 @@ private:
   void initTransforms();
   void copyFrom(const RobotState& other);
 
+  /** \brief Bound \e links and the attached bodies, restricted to those attached to \e group unless it is nullptr */
+  void computeAABB(const std::vector<const LinkModel*>& links, const JointModelGroup* group,
+                   std::vector<double>& aabb) const;
+
   void markDirtyJointTransforms(const JointModel* joint)
   {
     dirty_joint_transforms_[joint->getJointIndex()] = 1;
-    dirty_link_transforms_ =
-        dirty_link_transforms_ == nullptr ? joint : robot_model_->getCommonRoot(dirty_link_transforms_, joint);
+    addDirtySubtree(dirty_link_transforms_, dirty_link_transform_roots_, dirty_link_transform_root_count_, joint);
   }
 
   void markDirtyJointTransforms(const JointModelGroup* group)
   {
     for (const JointModel* jm : group->getActiveJointModels())
       dirty_joint_transforms_[jm->getJointIndex()] = 1;
-    dirty_link_transforms_ = dirty_link_transforms_ == nullptr ?
-                                 group->getCommonRoot() :
-                                 robot_model_->getCommonRoot(dirty_link_transforms_, group->getCommonRoot());
+    addDirtySubtree(dirty_link_transforms_, dirty_link_transform_roots_, dirty_link_transform_root_count_,
+                    group->getCommonRoot());
+  }
+
+  /** \brief Mark the link transforms of the whole robot dirty */
+  void markAllDirtyLinkTransforms()
+  {
+    dirty_link_transforms_ = robot_model_->getRootJoint();
+    dirty_link_transform_root_count_ = 0;
+  }
+
+  /** \brief Add the subtree starting at \e joint to a set of dirty subtrees.
+
+      A set of dirty subtrees is described by their common root \e common_root and up to
+      MAX_DIRTY_SUBTREES disjoint subtree roots. If \e root_count is 0 while \e common_root is set,
+      the whole subtree below \e common_root is dirty. */
+  void addDirtySubtree(const JointModel*& common_root, const JointModel** roots, unsigned char& root_count,
+                       const JointModel* joint) const
+  {
+    if (common_root == nullptr)
+    {
+      common_root = joint;
+      roots[0] = joint;
+      root_count = 1;
+    }
+    else if (root_count != 1 || roots[0] != joint)  // fast path for repeatedly marking the same joint
+      mergeDirtySubtree(common_root, roots, root_count, joint);
   }
 
+  void mergeDirtySubtree(const JointModel*& common_root, const JointModel** roots, unsigned char& root_count,
+                         const JointModel* joint) const;
+
   void markVelocity();
   void markAcceleration();
   void markEffort();
@@ -1879,7 +1981,20 @@ private:
     markDirtyJointTransforms(group);
   }
 
-  void updateLinkTransformsInternal(const JointModel* start);
+  /** \brief Update the link transforms below \e start, without updating attached bodies */
+  void updateSubtreeLinkTransforms(const JointModel* start);
+
+  /** \brief Update the transform of \e link from the transform of its parent link */
+  void updateLinkTransform(const LinkModel* link);
+
+  /** \brief Update the transforms of the links computed by the FK kernel of \e binding */
+  void updateFKKernelLinkTransforms(const FKKernelBinding& binding);
+
+  /** \brief Update the collision body transforms of the links below \e start */
+  void updateSubtreeCollisionBodyTransforms(const JointModel* start);
+
+  /** \brief Update the transforms of all attached bodies from their link transforms */
+  void updateAttachedBodyTransforms();
 
   void getMissingKeys(const std::map<std::string, double>& variable_map,
                       std::vector<std::string>& missing_variables) const;
@@ -1902,6 +2017,7 @@ private:
   const moveit::core::LinkModel* getLinkModelIncludingAttachedBodies(const std::string& frame) const;
 
   RobotModelConstPtr robot_model_;
+  RobotStatePoolPtr memory_pool_;
   void* memory_;
 
   double* position_;
@@ -1912,8 +2028,37 @@ private:
   bool has_acceleration_;
   bool has_effort_;
 
+  /** \brief Maximum number of disjoint dirty subtrees tracked individually before falling back to their common root */
+  static constexpr unsigned char MAX_DIRTY_SUBTREES = 4;
+
+  // Common roots of the dirty link resp. collision body transforms. If the corresponding root count is non-zero,
+  // only the subtrees below the listed roots are dirty, which avoids recomputing e.g. an idle arm when only
+  // the other arm of a dual-arm robot moved.
   const JointModel* dirty_link_transforms_;
   const JointModel* dirty_collision_body_transforms_;
+  const JointModel* dirty_link_transform_roots_[MAX_DIRTY_SUBTREES];
+  const JointModel* dirty_collision_body_transform_roots_[MAX_DIRTY_SUBTREES];
+  unsigned char dirty_link_transform_root_count_;
+  unsigned char dirty_collision_body_transform_root_count_;
+
+  /** \brief Incremented whenever global_link_transforms_ change, used to invalidate cached Jacobians */
+  unsigned int link_transforms_version_;
+
+  struct CachedJacobian
+  {
+    const JointModelGroup* group;
+    const LinkModel* link;
+    Eigen::Vector3d reference_point_position;
+    bool use_quaternion_representation;
+    unsigned int link_transforms_version;
+    Eigen::MatrixXd jacobian;
+  };
+
+  /** \brief Maximum number of Jacobians cached by getJacobian() */
+  static constexpr std::size_t MAX_CACHED_JACOBIANS = 4;
+
+  /** \brief Jacobians computed for the current link transforms. This is not copied along with the state. */
+  std::vector<CachedJacobian> jacobian_cache_;
 
   // All the following transform variables point into aligned memory in memory_
   // They are updated lazily, based on the flags in dirty_joint_transforms_
@@ -0,0 +1,229 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(RobotStateBatch);  // Defines RobotStateBatchPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A batch of robot configurations stored in structure-of-arrays form.
+
+    Each variable of the robot model is stored as one contiguous column holding its value for all
+    entries of the batch, and the global transform of each link is stored as twelve such columns
+    (the column-major 3x4 affine part). Forward kinematics is computed for all entries at once with a
+    single pass over the link tree, so that the per-joint transform math operates on whole columns and is
+    vectorized by Eigen.
+
+    In contrast to RobotState, only positions and link transforms are stored. Velocities, accelerations,
+    efforts, attached bodies and collision body transforms are not part of the batch. Use copyToRobotState()
+    to materialize a full state for a single entry when needed. */
+class RobotStateBatch
+{
+public:
+  /** \brief Construct a batch of \e size configurations for \e robot_model. No values are initialized.
+      Call setToDefaultValues() if the batch needs to provide valid information. */
+  RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size = 0);
+
+  /** \brief Get the robot model this batch is constructed for. */
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get the number of configurations in this batch */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** \brief Change the number of configurations in this batch. All values are invalidated. */
+  void resize(std::size_t size);
+
+  /** \brief Set all configurations to the default values of the robot model */
+  void setToDefaultValues();
+
+  /** \brief Set all configurations to random positions */
+  void setToRandomPositions(random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Set the full position vector (as given by RobotModel::getVariableNames()) of entry \e index */
+  void setVariablePositions(std::size_t index, const double* position);
+
+  /** \brief Set the value of variable \e variable of entry \e index */
+  void setVariablePosition(std::size_t index, int variable, double value)
+  {
+    positions_(index, variable) = value;
+    dirty_ = true;
+  }
+
+  /** \brief Get the value of variable \e variable of entry \e index */
+  double getVariablePosition(std::size_t index, int variable) const
+  {
+    return positions_(index, variable);
+  }
+
+  /** \brief Get the contiguous array holding the values of variable \e variable for all entries.
+      Writing to this array marks the transforms of the batch dirty only when done through this non-const accessor,
+      i.e. call update() afterwards. */
+  double* getVariablePositionColumn(int variable)
+  {
+    dirty_ = true;
+    return positions_.col(variable).data();
+  }
+
+  const double* getVariablePositionColumn(int variable) const
+  {
+    return positions_.col(variable).data();
+  }
+
+  /** \brief Copy the full position vector of entry \e index into \e position,
+      which must have RobotModel::getVariableCount() elements */
+  void copyVariablePositions(std::size_t index, double* position) const;
+
+  /** \brief Set the positions of the variables of \e group for entry \e index. Mimic joints of the group are updated.
+      \e gstate must have JointModelGroup::getVariableCount() elements */
+  void setJointGroupPositions(std::size_t index, const JointModelGroup* group, const double* gstate);
+
+  void setJointGroupPositions(std::size_t index, const JointModelGroup* group, const std::vector<double>& gstate)
+  {
+    assert(gstate.size() == group->getVariableCount());
+    setJointGroupPositions(index, group, gstate.data());
+  }
+
+  void setJointGroupPositions(std::size_t index, const JointModelGroup* group, const Eigen::VectorXd& values)
+  {
+    assert(static_cast<std::size_t>(values.size()) == group->getVariableCount());
+    setJointGroupPositions(index, group, values.data());
+  }
+
+  /** \brief Copy the positions of the variables of \e group for entry \e index into \e gstate */
+  void copyJointGroupPositions(std::size_t index, const JointModelGroup* group, double* gstate) const;
+
+  /** \brief Set entry \e index to the positions of \e state */
+  void setFromRobotState(std::size_t index, const RobotState& state)
+  {
+    setVariablePositions(index, state.getVariablePositions());
+  }
+
+  /** \brief Copy the positions of entry \e index into \e state. The transforms of \e state are marked dirty. */
+  void copyToRobotState(std::size_t index, RobotState& state) const;
+
+  /** \brief Set entries [first, first + count) to the states interpolated between \e from and \e to at the given
+      fractions (in the range [0 1]). Single-variable joints with linear interpolation are processed as whole columns;
+      other joints are interpolated per entry. Mimic joints are updated. */
+  void interpolate(const RobotState& from, const RobotState& to, const double* fractions, std::size_t count,
+                   std::size_t first = 0);
+
+  /** \brief Resize the batch to \e fractions.size() and set each entry to the state interpolated between \e from
+      and \e to at the corresponding fraction */
+  void interpolate(const RobotState& from, const RobotState& to, const std::vector<double>& fractions)
+  {
+    resize(fractions.size());
+    interpolate(from, to, fractions.data(), fractions.size());
+  }
+
+  /** \brief Compute the link transforms of all entries of the batch, if any of them are out of date. */
+  void update(bool force = false);
+
+  /** \brief Returns true if the link transforms do not match the positions of the batch */
+  bool dirty() const
+  {
+    return dirty_;
+  }
+
+  /** \brief Get the transform of \e link w.r.t. the model frame for entry \e index. Updates the batch if needed. */
+  Eigen::Isometry3d getGlobalLinkTransform(std::size_t index, const LinkModel* link)
+  {
+    update();
+    return static_cast<const RobotStateBatch*>(this)->getGlobalLinkTransform(index, link);
+  }
+
+  Eigen::Isometry3d getGlobalLinkTransform(std::size_t index, const std::string& link_name)
+  {
+    return getGlobalLinkTransform(index, robot_model_->getLinkModel(link_name));
+  }
+
+  /** \brief Get the transform of \e link w.r.t. the model frame for entry \e index.
+      The batch must have been updated before. */
+  Eigen::Isometry3d getGlobalLinkTransform(std::size_t index, const LinkModel* link) const;
+
+  Eigen::Isometry3d getGlobalLinkTransform(std::size_t index, const std::string& link_name) const
+  {
+    return getGlobalLinkTransform(index, robot_model_->getLinkModel(link_name));
+  }
+
+  /** \brief Get the origins of \e link w.r.t. the model frame for all entries as a (size() x 3) block.
+      The batch must have been updated before. This is the cheapest way for pre-filters (e.g. bounding sphere tests)
+      to consume the batch, as no per-entry transform is assembled. */
+  Eigen::ArrayXXd::ConstColsBlockXpr getGlobalLinkOrigins(const LinkModel* link) const
+  {
+    if (!link)
+      throw Exception("Invalid link");
+    assert(!dirty_);
+    return link_transforms_.middleCols(TRANSFORM_SIZE * link->getLinkIndex() + 9, 3);
+  }
+
+private:
+  /** \brief Number of columns used to store one affine transform (column-major 3x4 matrix) */
+  static constexpr int TRANSFORM_SIZE = 12;
+
+  void updateMimicJoints(std::size_t index, const JointModelGroup* group);
+
+  RobotModelConstPtr robot_model_;
+  std::size_t size_;
+
+  /** \brief (size_ x variable count) array of positions; each column holds one variable for all entries */
+  Eigen::ArrayXXd positions_;
+
+  /** \brief (size_ x TRANSFORM_SIZE * link count) array of global link transforms */
+  Eigen::ArrayXXd link_transforms_;
+
+  /** \brief Scratch space for the parent transform composed with the joint origin of the link being updated */
+  Eigen::ArrayXXd origin_scratch_;
+
+  /** \brief Scratch space for the variable joint transform of the joint being updated */
+  Eigen::ArrayXXd joint_scratch_;
+
+  bool dirty_;
+};
+}  // namespace core
+}  // namespace moveit
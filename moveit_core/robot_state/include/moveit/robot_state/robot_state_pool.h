@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <mutex>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief A preallocated slab of memory blocks for RobotState instances.
+
+    Every RobotState allocates a single block holding its positions, velocities, accelerations, efforts
+    and transforms. States constructed with a RobotStatePool take that block from a cache-line aligned slab
+    allocated once up front, and give it back on destruction, so that creating and destroying states in planner
+    hot loops does not touch the heap (and does not contend on the global allocator).
+    When the pool is exhausted, states silently fall back to heap allocation.
+
+    The pool is thread-safe. States keep a shared pointer to their pool, so it is only destroyed once the last
+    state using it is gone. */
+class RobotStatePool : public std::enable_shared_from_this<RobotStatePool>
+{
+public:
+  /** \brief Alignment of the memory blocks; a typical cache line size */
+  static constexpr std::size_t BLOCK_ALIGNMENT = 64;
+
+  /** \brief Allocate memory for \e capacity states of \e robot_model */
+  RobotStatePool(const RobotModelConstPtr& robot_model, std::size_t capacity);
+  ~RobotStatePool();
+
+  RobotStatePool(const RobotStatePool&) = delete;
+  RobotStatePool& operator=(const RobotStatePool&) = delete;
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get the number of states the pool can hold */
+  std::size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  /** \brief Get the number of memory blocks that are currently not in use */
+  std::size_t getAvailableCount() const;
+
+  /** \brief Get the size of a single block in bytes */
+  std::size_t getBlockSize() const
+  {
+    return block_size_;
+  }
+
+  /** \brief Create a new state, with default values, whose memory is taken from this pool */
+  RobotStatePtr createState();
+
+  /** \brief Create a copy of \e state whose memory is taken from this pool */
+  RobotStatePtr createState(const RobotState& state);
+
+  /** \brief Take a memory block from the pool. Returns nullptr if the pool is exhausted. */
+  void* allocate();
+
+  /** \brief Return a block previously obtained by allocate() */
+  void deallocate(void* block);
+
+  /** \brief Check whether \e block is part of the slab of this pool */
+  bool owns(const void* block) const
+  {
+    const char* ptr = static_cast<const char*>(block);
+    return ptr >= slab_ && ptr < slab_ + capacity_ * block_size_;
+  }
+
+private:
+  RobotModelConstPtr robot_model_;
+  std::size_t capacity_;
+  std::size_t block_size_;
+  char* slab_;
+
+  std::vector<void*> free_blocks_;
+  mutable std::mutex lock_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,190 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(RobotStatePositionView);  // Defines RobotStatePositionViewPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A compact robot state holding only positions and global link transforms.
+
+    Sampling, roadmaps and IK caches typically only need the joint positions of a state and, for validity checks,
+    the transforms of its links. RobotState additionally always carries velocities, accelerations, efforts,
+    joint and collision body transforms as well as the attached bodies. This class stores the positions followed
+    by one column-major 3x4 affine matrix per link in a single flat buffer, which is considerably smaller.
+
+    Link transforms are computed lazily on update(). Use copyToRobotState() where a full state is needed,
+    e.g. for collision checking. */
+class RobotStatePositionView
+{
+public:
+  /** \brief Construct a state for \e robot_model. No values are initialized. */
+  RobotStatePositionView(const RobotModelConstPtr& robot_model);
+
+  /** \brief Construct from the positions of a full state. Link transforms are copied if they are up to date. */
+  explicit RobotStatePositionView(const RobotState& state);
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get the number of variables that make up this state. */
+  std::size_t getVariableCount() const
+  {
+    return robot_model_->getVariableCount();
+  }
+
+  /** \brief Get the positions of all variables, in the order given by RobotModel::getVariableNames() */
+  const double* getVariablePositions() const
+  {
+    return memory_.data();
+  }
+
+  /** \brief Get the positions of all variables for writing. Link transforms are marked dirty. */
+  double* getVariablePositions()
+  {
+    dirty_ = true;
+    return memory_.data();
+  }
+
+  /** \brief Set the positions of all variables. Mimic joints are expected to be set consistently. */
+  void setVariablePositions(const double* position);
+
+  double getVariablePosition(int index) const
+  {
+    return memory_[index];
+  }
+
+  void setVariablePosition(int index, double value)
+  {
+    memory_[index] = value;
+    dirty_ = true;
+  }
+
+  /** \brief Set the positions of the variables of \e group. Mimic joints of the group are updated. */
+  void setJointGroupPositions(const JointModelGroup* group, const double* gstate);
+
+  /** \brief Copy the positions of the variables of \e group */
+  void copyJointGroupPositions(const JointModelGroup* group, double* gstate) const;
+
+  void setToDefaultValues();
+
+  void setToRandomPositions(random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Set the positions of \e state. Link transforms are copied as well if they are up to date. */
+  void setFromRobotState(const RobotState& state);
+
+  /** \brief Copy the positions into \e state. The transforms of \e state are marked dirty. */
+  void copyToRobotState(RobotState& state) const;
+
+  /** \brief Check if all variables are within their bounds (with \e margin) */
+  bool satisfiesBounds(double margin = 0.0) const
+  {
+    return robot_model_->satisfiesPositionBounds(memory_.data(), margin);
+  }
+
+  /** \brief Return the sum of joint distances to \e other. Only considers active joints. */
+  double distance(const RobotStatePositionView& other) const
+  {
+    return robot_model_->distance(memory_.data(), other.memory_.data());
+  }
+
+  /** \brief Compute the link transforms, if they are out of date. */
+  void update(bool force = false);
+
+  bool dirty() const
+  {
+    return dirty_;
+  }
+
+  /** \brief Get the link transform w.r.t. the model frame. Updates the link transforms if needed. */
+  Eigen::Isometry3d getGlobalLinkTransform(const LinkModel* link)
+  {
+    update();
+    return static_cast<const RobotStatePositionView*>(this)->getGlobalLinkTransform(link);
+  }
+
+  Eigen::Isometry3d getGlobalLinkTransform(const std::string& link_name)
+  {
+    return getGlobalLinkTransform(robot_model_->getLinkModel(link_name));
+  }
+
+  /** \brief Get the link transform w.r.t. the model frame. update() must have been called before. */
+  Eigen::Isometry3d getGlobalLinkTransform(const LinkModel* link) const;
+
+  Eigen::Isometry3d getGlobalLinkTransform(const std::string& link_name) const
+  {
+    return getGlobalLinkTransform(robot_model_->getLinkModel(link_name));
+  }
+
+  /** \brief Get the number of bytes used to store this state, for comparison with RobotState::getMemorySize() */
+  std::size_t getMemorySize() const
+  {
+    return sizeof(double) * memory_.size();
+  }
+
+private:
+  using AffineMap = Eigen::Map<Eigen::Matrix<double, 3, 4>>;
+  using ConstAffineMap = Eigen::Map<const Eigen::Matrix<double, 3, 4>>;
+
+  double* linkTransformData(const LinkModel* link)
+  {
+    return memory_.data() + robot_model_->getVariableCount() + 12 * link->getLinkIndex();
+  }
+
+  const double* linkTransformData(const LinkModel* link) const
+  {
+    return memory_.data() + robot_model_->getVariableCount() + 12 * link->getLinkIndex();
+  }
+
+  RobotModelConstPtr robot_model_;
+
+  /** \brief Variable positions, followed by the 3x4 affine transform of each link */
+  std::vector<double> memory_;
+
+  bool dirty_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -37,6 +37,7 @@
 #include <moveit/robot_state/attached_body.h>
 #include <geometric_shapes/check_isometry.h>
 #include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
 
 namespace moveit
 {
@@ -79,6 +80,30 @@ AttachedBody::AttachedBody(const LinkModel* parent, const std::string& id, const
   {
     shape_poses_in_link_frame_.push_back(pose_ * shape_pose);
   }
+  updateShapeExtents();
+}
+
+AttachedBody::AttachedBody(const AttachedBody& other)
+  : parent_link_model_(other.parent_link_model_)
+  , id_(other.id_)
+  , pose_(other.pose_)
+  , global_pose_(other.global_pose_)
+  , shapes_(other.shapes_)
+  , shape_extents_(other.shape_extents_)
+  , shape_poses_(other.shape_poses_)
+  , shape_poses_in_link_frame_(other.shape_poses_in_link_frame_)
+  , touch_links_(other.touch_links_)
+  , detach_posture_(other.detach_posture_)
+  , subframe_poses_(other.subframe_poses_)
+{
+  // the lazily computed members may be written concurrently by const accessors of other
+  std::lock_guard<std::mutex> guard(other.global_transforms_lock_);
+  global_collision_body_transforms_ = other.global_collision_body_transforms_;
+  global_subframe_poses_ = other.global_subframe_poses_;
+  collision_body_transforms_dirty_.store(other.collision_body_transforms_dirty_.load(std::memory_order_relaxed),
+                                         std::memory_order_relaxed);
+  subframe_transforms_dirty_.store(other.subframe_transforms_dirty_.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
 }
 
 AttachedBody::~AttachedBody() = default;
@@ -98,6 +123,15 @@ void AttachedBody::setScale(double scale)
       shape.reset(copy);
     }
   }
+  updateShapeExtents();
+}
+
+void AttachedBody::updateShapeExtents()
+{
+  shape_extents_.clear();
+  shape_extents_.reserve(shapes_.size());
+  for (const shapes::ShapeConstPtr& shape : shapes_)
+    shape_extents_.push_back(shapes::computeShapeExtents(shape.get()));
 }
 
 void AttachedBody::computeTransform(const Eigen::Isometry3d& parent_link_global_transform)
@@ -105,14 +139,32 @@ void AttachedBody::computeTransform(const Eigen::Isometry3d& parent_link_global_
   ASSERT_ISOMETRY(parent_link_global_transform)  // unsanitized input, could contain a non-isometry
   global_pose_ = parent_link_global_transform * pose_;
 
-  // update collision body transforms
+  // collision body and subframe transforms are derived from global_pose_ on their next access
+  collision_body_transforms_dirty_.store(!global_collision_body_transforms_.empty(), std::memory_order_release);
+  subframe_transforms_dirty_.store(!global_subframe_poses_.empty(), std::memory_order_release);
+}
+
+void AttachedBody::updateGlobalCollisionBodyTransforms() const
+{
+  std::lock_guard<std::mutex> guard(global_transforms_lock_);
+  if (!collision_body_transforms_dirty_.load(std::memory_order_relaxed))
+    return;  // another thread was faster
+
   for (std::size_t i = 0; i < global_collision_body_transforms_.size(); ++i)
     global_collision_body_transforms_[i] = global_pose_ * shape_poses_[i];  // valid isometry
+  collision_body_transforms_dirty_.store(false, std::memory_order_release);
+}
+
+void AttachedBody::updateGlobalSubframeTransforms() const
+{
+  std::lock_guard<std::mutex> guard(global_transforms_lock_);
+  if (!subframe_transforms_dirty_.load(std::memory_order_relaxed))
+    return;  // another thread was faster
 
-  // update subframe transforms
   for (auto global = global_subframe_poses_.begin(), end = global_subframe_poses_.end(), local = subframe_poses_.begin();
        global != end; ++global, ++local)
     global->second = global_pose_ * local->second;  // valid isometry
+  subframe_transforms_dirty_.store(false, std::memory_order_release);
 }
 
 void AttachedBody::setPadding(double padding)
@@ -130,6 +182,7 @@ void AttachedBody::setPadding(double padding)
       shape.reset(copy);
     }
   }
+  updateShapeExtents();
 }
 
 const Eigen::Isometry3d& AttachedBody::getSubframeTransform(const std::string& frame_name, bool* found) const
@@ -154,8 +207,9 @@ const Eigen::Isometry3d& AttachedBody::getGlobalSubframeTransform(const std::str
 {
   if (frame_name.rfind(id_, 0) == 0 && frame_name[id_.length()] == '/')
   {
-    auto it = global_subframe_poses_.find(frame_name.substr(id_.length() + 1));
-    if (it != global_subframe_poses_.end())
+    const FixedTransformsMap& global_subframe_poses = getGlobalSubframeTransforms();
+    auto it = global_subframe_poses.find(frame_name.substr(id_.length() + 1));
+    if (it != global_subframe_poses.end())
     {
       if (found)
         *found = true;
@@ -41,6 +41,13 @@
 #include <geometric_shapes/check_isometry.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 namespace moveit
 {
@@ -54,6 +61,98 @@ static const std::size_t MIN_STEPS_FOR_JUMP_THRESH = 10;
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.cartesian_interpolator");
 
+namespace
+{
+/** \brief Interpolation of a straight Cartesian motion of a virtual frame attached to a link */
+struct CartesianSegment
+{
+  Eigen::Isometry3d start_pose;
+  Eigen::Isometry3d target;
+  Eigen::Quaterniond start_quaternion;
+  Eigen::Quaterniond target_quaternion;
+  Eigen::Isometry3d offset;
+  std::size_t steps;
+};
+
+/** \brief Set up the interpolation from the current pose of the virtual link frame to target */
+bool initCartesianSegment(RobotState* start_state, const JointModelGroup* group, const LinkModel* link,
+                          const Eigen::Isometry3d& target, bool global_reference_frame, const MaxEEFStep& max_step,
+                          const JumpThreshold& jump_threshold, const Eigen::Isometry3d& link_offset,
+                          CartesianSegment& segment)
+{
+  const std::vector<const JointModel*>& cjnt = group->getContinuousJointModels();
+  // make sure that continuous joints wrap
+  for (const JointModel* joint : cjnt)
+    start_state->enforceBounds(joint);
+
+  // Cartesian pose we start from
+  segment.start_pose = start_state->getGlobalLinkTransform(link) * link_offset;
+  segment.offset = link_offset.inverse();
+
+  // the target can be in the local reference frame (in which case we rotate it)
+  segment.target = global_reference_frame ? target : segment.start_pose * target;
+
+  segment.start_quaternion = Eigen::Quaterniond(segment.start_pose.linear());
+  segment.target_quaternion = Eigen::Quaterniond(segment.target.linear());
+
+  if (max_step.translation <= 0.0 && max_step.rotation <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "Invalid MaxEEFStep passed into computeCartesianPath. Both the MaxEEFStep.rotation and "
+                         "MaxEEFStep.translation components must be non-negative and at least one component must be "
+                         "greater than zero");
+    return false;
+  }
+
+  double rotation_distance = segment.start_quaternion.angularDistance(segment.target_quaternion);
+  double translation_distance = (segment.target.translation() - segment.start_pose.translation()).norm();
+
+  // decide how many steps we will need for this trajectory
+  std::size_t translation_steps = 0;
+  if (max_step.translation > 0.0)
+    translation_steps = floor(translation_distance / max_step.translation);
+
+  std::size_t rotation_steps = 0;
+  if (max_step.rotation > 0.0)
+    rotation_steps = floor(rotation_distance / max_step.rotation);
+
+  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
+  segment.steps = std::max(translation_steps, rotation_steps) + 1;
+  if (jump_threshold.factor > 0 && segment.steps < MIN_STEPS_FOR_JUMP_THRESH)
+    segment.steps = MIN_STEPS_FOR_JUMP_THRESH;
+  return true;
+}
+
+/** \brief Link pose for step i of the interpolation */
+Eigen::Isometry3d interpolateCartesianSegment(const CartesianSegment& segment, std::size_t i)
+{
+  double percentage = (double)i / (double)segment.steps;
+
+  Eigen::Isometry3d pose(segment.start_quaternion.slerp(percentage, segment.target_quaternion));
+  pose.translation() = percentage * segment.target.translation() + (1 - percentage) * segment.start_pose.translation();
+  return pose * segment.offset;
+}
+
+/** \brief Test if any revolute or prismatic joint moves further than the absolute jump thresholds */
+bool hasAbsoluteJointSpaceJump(const JointModelGroup* group, const RobotState& from, const RobotState& to,
+                               const JumpThreshold& jump_threshold)
+{
+  for (const JointModel* joint : group->getActiveJointModels())
+  {
+    double joint_threshold = 0.0;
+    if (joint->getType() == JointModel::REVOLUTE)
+      joint_threshold = jump_threshold.revolute;
+    else if (joint->getType() == JointModel::PRISMATIC)
+      joint_threshold = jump_threshold.prismatic;
+    if (joint_threshold > 0.0 && from.distance(to, joint) > joint_threshold)
+    {
+      RCLCPP_DEBUG(LOGGER, "Stopping Cartesian path due to detected jump in joint %s", joint->getName().c_str());
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
 CartesianInterpolator::Distance CartesianInterpolator::computeCartesianPath(
     RobotState* start_state, const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
     const Eigen::Vector3d& translation, bool global_reference_frame, const MaxEEFStep& max_step,
@@ -84,45 +183,11 @@ CartesianInterpolator::Percentage CartesianInterpolator::computeCartesianPath(
   ASSERT_ISOMETRY(target)
   ASSERT_ISOMETRY(link_offset)
 
-  const std::vector<const JointModel*>& cjnt = group->getContinuousJointModels();
-  // make sure that continuous joints wrap
-  for (const JointModel* joint : cjnt)
-    start_state->enforceBounds(joint);
-
-  // Cartesian pose we start from
-  Eigen::Isometry3d start_pose = start_state->getGlobalLinkTransform(link) * link_offset;
-  Eigen::Isometry3d offset = link_offset.inverse();
-
-  // the target can be in the local reference frame (in which case we rotate it)
-  Eigen::Isometry3d rotated_target = global_reference_frame ? target : start_pose * target;
-
-  Eigen::Quaterniond start_quaternion(start_pose.linear());
-  Eigen::Quaterniond target_quaternion(rotated_target.linear());
-
-  if (max_step.translation <= 0.0 && max_step.rotation <= 0.0)
-  {
-    RCLCPP_ERROR(LOGGER, "Invalid MaxEEFStep passed into computeCartesianPath. Both the MaxEEFStep.rotation and "
-                         "MaxEEFStep.translation components must be non-negative and at least one component must be "
-                         "greater than zero");
+  CartesianSegment segment;
+  if (!initCartesianSegment(start_state, group, link, target, global_reference_frame, max_step, jump_threshold,
+                            link_offset, segment))
     return 0.0;
-  }
-
-  double rotation_distance = start_quaternion.angularDistance(target_quaternion);
-  double translation_distance = (rotated_target.translation() - start_pose.translation()).norm();
-
-  // decide how many steps we will need for this trajectory
-  std::size_t translation_steps = 0;
-  if (max_step.translation > 0.0)
-    translation_steps = floor(translation_distance / max_step.translation);
-
-  std::size_t rotation_steps = 0;
-  if (max_step.rotation > 0.0)
-    rotation_steps = floor(rotation_distance / max_step.rotation);
-
-  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
-  std::size_t steps = std::max(translation_steps, rotation_steps) + 1;
-  if (jump_threshold.factor > 0 && steps < MIN_STEPS_FOR_JUMP_THRESH)
-    steps = MIN_STEPS_FOR_JUMP_THRESH;
+  const std::size_t steps = segment.steps;
 
   // To limit absolute joint-space jumps, we pass consistency limits to the IK solver
   std::vector<double> consistency_limits;
@@ -154,13 +219,10 @@ CartesianInterpolator::Percentage CartesianInterpolator::computeCartesianPath(
   {
     double percentage = (double)i / (double)steps;
 
-    Eigen::Isometry3d pose(start_quaternion.slerp(percentage, target_quaternion));
-    pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
-
     // Explicitly use a single IK attempt only: We want a smooth trajectory.
     // Random seeding (of additional attempts) would probably create IK jumps.
-    if (start_state->setFromIK(group, pose * offset, link->getName(), consistency_limits, 0.0, validCallback, options,
-                               cost_function))
+    if (start_state->setFromIK(group, interpolateCartesianSegment(segment, i), link->getName(), consistency_limits, 0.0,
+                               validCallback, options, cost_function))
     {
       start_state->update();
       traj.push_back(std::make_shared<moveit::core::RobotState>(*start_state));
@@ -216,6 +278,267 @@ CartesianInterpolator::Percentage CartesianInterpolator::computeCartesianPath(
   return CartesianInterpolator::Percentage(percentage_solved);
 }
 
+CartesianInterpolator::Percentage CartesianInterpolator::computeCartesianPathPipelined(
+    RobotState* start_state, const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
+    const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame, const MaxEEFStep& max_step,
+    const JumpThreshold& jump_threshold, const GroupStateValidityCallbackFn& validCallback,
+    std::size_t validation_thread_count, const kinematics::KinematicsQueryOptions& options,
+    const kinematics::KinematicsBase::IKCostFn& cost_function, const Eigen::Isometry3d& link_offset)
+{
+  ASSERT_ISOMETRY(link_offset)
+
+  // Don't test joint space jumps for every waypoint, test them later on the whole trajectory.
+  static const JumpThreshold NO_JOINT_SPACE_JUMP_TEST;
+  static const std::vector<double> NO_CONSISTENCY_LIMITS;
+  constexpr std::size_t NO_STATE = std::numeric_limits<std::size_t>::max();
+
+  traj.clear();
+  if (waypoints.empty())
+    return CartesianInterpolator::Percentage(0.0);
+  traj.push_back(std::make_shared<moveit::core::RobotState>(*start_state));
+
+  // Validate the produced states on worker threads while IK proceeds along the path
+  std::mutex queue_mutex;
+  std::condition_variable queue_condition;
+  std::deque<std::pair<std::size_t, RobotStatePtr>> queue;
+  bool producing = true;
+  std::atomic<std::size_t> first_invalid{ NO_STATE };
+  const auto validate = [&](RobotState& state) {
+    std::vector<double> values;
+    while (true)
+    {
+      std::pair<std::size_t, RobotStatePtr> item;
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_condition.wait(lock, [&] { return !queue.empty() || !producing; });
+        if (queue.empty())
+          return;
+        item = std::move(queue.front());
+        queue.pop_front();
+      }
+      if (item.first >= first_invalid)
+        continue;
+      item.second->copyJointGroupPositions(group, values);
+      state.setJointGroupPositions(group, values);
+      state.update();
+      if (!validCallback(&state, group, values.data()))
+      {
+        std::size_t current = first_invalid;
+        while (item.first < current && !first_invalid.compare_exchange_weak(current, item.first))
+          ;
+      }
+    }
+  };
+  const bool validate_concurrently = validCallback && validation_thread_count > 0;
+  std::vector<RobotState> worker_states;
+  std::vector<std::thread> workers;
+  if (validate_concurrently)
+  {
+    worker_states.assign(validation_thread_count, *start_state);
+    for (RobotState& worker_state : worker_states)
+      workers.emplace_back(validate, std::ref(worker_state));
+  }
+
+  // Seed IK from the previous solution, without waiting for the validation of the states
+  std::vector<CartesianSegment> segments(waypoints.size());
+  std::vector<std::pair<std::size_t, std::size_t>> state_steps{ { 0, 0 } };  // waypoint and step of every state
+  const auto percentage_of = [&](std::size_t state_index) {
+    if (state_index == 0)
+      return 0.0;
+    const std::pair<std::size_t, std::size_t>& step = state_steps[state_index];
+    return (step.first + (double)step.second / (double)segments[step.first].steps) / (double)waypoints.size();
+  };
+  bool aborted = false;
+  for (std::size_t waypoint = 0; waypoint < waypoints.size() && !aborted; ++waypoint)
+  {
+    if (!initCartesianSegment(start_state, group, link, waypoints[waypoint], global_reference_frame, max_step,
+                              NO_JOINT_SPACE_JUMP_TEST, link_offset, segments[waypoint]))
+      break;
+    for (std::size_t i = 1; i <= segments[waypoint].steps; ++i)
+    {
+      if (first_invalid != NO_STATE ||
+          !start_state->setFromIK(group, interpolateCartesianSegment(segments[waypoint], i), link->getName(),
+                                  NO_CONSISTENCY_LIMITS, 0.0, GroupStateValidityCallbackFn(), options, cost_function))
+      {
+        aborted = true;
+        break;
+      }
+      start_state->update();
+      RobotStatePtr state = std::make_shared<moveit::core::RobotState>(*start_state);
+      // Absolute jumps do not depend on the rest of the path, so stop as soon as one occurs
+      if (hasAbsoluteJointSpaceJump(group, *traj.back(), *state, jump_threshold))
+      {
+        aborted = true;
+        break;
+      }
+      traj.push_back(state);
+      state_steps.emplace_back(waypoint, i);
+      if (validate_concurrently)
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.emplace_back(traj.size() - 1, state);
+        queue_condition.notify_one();
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    producing = false;
+  }
+  queue_condition.notify_all();
+  for (std::thread& worker : workers)
+    worker.join();
+
+  double percentage_solved = percentage_of(traj.size() - 1);
+  if (first_invalid != NO_STATE)
+  {
+    // Continue sequentially from the first invalid state on, letting IK search for valid solutions
+    const std::size_t invalid_index = first_invalid;
+    const std::size_t waypoint = state_steps[invalid_index].first;
+    const std::size_t first_step = state_steps[invalid_index].second;
+    traj.resize(invalid_index);
+    *start_state = *traj.back();
+    percentage_solved = percentage_of(invalid_index - 1);
+
+    bool solved = true;
+    for (std::size_t i = first_step; i <= segments[waypoint].steps; ++i)
+    {
+      if (!start_state->setFromIK(group, interpolateCartesianSegment(segments[waypoint], i), link->getName(),
+                                  NO_CONSISTENCY_LIMITS, 0.0, validCallback, options, cost_function))
+      {
+        solved = false;
+        break;
+      }
+      start_state->update();
+      traj.push_back(std::make_shared<moveit::core::RobotState>(*start_state));
+      percentage_solved = (waypoint + (double)i / (double)segments[waypoint].steps) / (double)waypoints.size();
+    }
+    for (std::size_t next = waypoint + 1; solved && next < waypoints.size(); ++next)
+    {
+      std::vector<RobotStatePtr> waypoint_traj;
+      double wp_percentage_solved =
+          computeCartesianPath(start_state, group, waypoint_traj, link, waypoints[next], global_reference_frame,
+                               max_step, NO_JOINT_SPACE_JUMP_TEST, validCallback, options, cost_function, link_offset);
+      if (!waypoint_traj.empty())
+        traj.insert(traj.end(), waypoint_traj.begin() + 1, waypoint_traj.end());
+      percentage_solved = (next + wp_percentage_solved) / (double)waypoints.size();
+      solved = fabs(wp_percentage_solved - 1.0) < std::numeric_limits<double>::epsilon();
+    }
+  }
+
+  percentage_solved *= checkJointSpaceJump(group, traj, jump_threshold);
+
+  return CartesianInterpolator::Percentage(percentage_solved);
+}
+
+CartesianInterpolator::Percentage CartesianInterpolator::computeCartesianPathParallel(
+    RobotState* start_state, const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
+    const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame, const MaxEEFStep& max_step,
+    const JumpThreshold& jump_threshold, const GroupStateValidityCallbackFn& validCallback, std::size_t thread_count,
+    const kinematics::KinematicsQueryOptions& options, const kinematics::KinematicsBase::IKCostFn& cost_function,
+    const Eigen::Isometry3d& link_offset)
+{
+  // Relative waypoints depend on the pose actually reached at the previous waypoint
+  if (!global_reference_frame || waypoints.size() < 2 || thread_count < 2)
+    return computeCartesianPath(start_state, group, traj, link, waypoints, global_reference_frame, max_step,
+                                jump_threshold, validCallback, options, cost_function, link_offset);
+  ASSERT_ISOMETRY(link_offset)
+
+  static const JumpThreshold NO_JOINT_SPACE_JUMP_TEST;
+  static const std::vector<double> NO_CONSISTENCY_LIMITS;
+  const RobotState initial_state(*start_state);
+
+  // Seed every segment with the IK solution for the preceding waypoint
+  const std::size_t segment_count = waypoints.size();
+  std::vector<RobotState> segment_starts(1, *start_state);
+  segment_starts.reserve(segment_count);
+  for (std::size_t i = 1; i < segment_count; ++i)
+  {
+    RobotState boundary(segment_starts.back());
+    if (!boundary.setFromIK(group, waypoints[i - 1] * link_offset.inverse(), link->getName(), NO_CONSISTENCY_LIMITS,
+                            0.0, validCallback, options, cost_function))
+      break;
+    boundary.update();
+    segment_starts.push_back(boundary);
+  }
+
+  std::vector<std::vector<RobotStatePtr>> segment_trajs(segment_starts.size());
+  std::vector<double> segment_percentages(segment_starts.size(), 0.0);
+  std::atomic<std::size_t> next_segment{ 0 };
+  const auto compute_segments = [&] {
+    for (std::size_t i = next_segment++; i < segment_starts.size(); i = next_segment++)
+    {
+      RobotState state(segment_starts[i]);
+      segment_percentages[i] =
+          computeCartesianPath(&state, group, segment_trajs[i], link, waypoints[i], true, max_step,
+                               NO_JOINT_SPACE_JUMP_TEST, validCallback, options, cost_function, link_offset);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < std::min(thread_count, segment_starts.size()); ++i)
+    workers.emplace_back(compute_segments);
+  compute_segments();
+  for (std::thread& worker : workers)
+    worker.join();
+
+  // Stitch the completed segments that connect to each other
+  const auto completed = [](double percentage) {
+    return fabs(percentage - 1.0) < std::numeric_limits<double>::epsilon();
+  };
+  traj = segment_trajs[0];
+  std::size_t stitched = completed(segment_percentages[0]) ? 1 : 0;
+  for (; stitched > 0 && stitched < segment_starts.size() && completed(segment_percentages[stitched]); ++stitched)
+  {
+    // The end of the previous segment and the boundary solution must be the same configuration up to IK accuracy,
+    // i.e. closer than any step of the previous segment
+    const std::vector<RobotStatePtr>& previous = segment_trajs[stitched - 1];
+    double max_step_distance = 0.0;
+    for (std::size_t i = 1; i < previous.size(); ++i)
+      max_step_distance = std::max(max_step_distance, previous[i]->distance(*previous[i - 1], group));
+    if (previous.back()->distance(*segment_trajs[stitched].front(), group) > max_step_distance)
+    {
+      RCLCPP_DEBUG(LOGGER, "Cartesian path segment %zu does not connect to its predecessor", stitched);
+      break;
+    }
+    traj.insert(traj.end(), segment_trajs[stitched].begin() + 1, segment_trajs[stitched].end());
+  }
+
+  double percentage_solved;
+  if (stitched == 0)
+    percentage_solved = segment_percentages[0] / (double)segment_count;
+  else
+  {
+    percentage_solved = (double)stitched / (double)segment_count;
+    if (stitched < segment_count)
+    {
+      // Compute the remaining waypoints sequentially from the end of the stitched path
+      *start_state = *traj.back();
+      std::vector<RobotStatePtr> remaining_traj;
+      EigenSTL::vector_Isometry3d remaining_waypoints(waypoints.begin() + stitched, waypoints.end());
+      double remaining_percentage =
+          computeCartesianPath(start_state, group, remaining_traj, link, remaining_waypoints, true, max_step,
+                               NO_JOINT_SPACE_JUMP_TEST, validCallback, options, cost_function, link_offset);
+      if (!remaining_traj.empty())
+        traj.insert(traj.end(), remaining_traj.begin() + 1, remaining_traj.end());
+      percentage_solved += remaining_percentage * (double)(segment_count - stitched) / (double)segment_count;
+    }
+  }
+
+  const double jump_free = checkJointSpaceJump(group, traj, jump_threshold);
+  if (!completed(jump_free))
+  {
+    // Independently seeded segments may pick other IK branches than a sequential computation
+    RCLCPP_DEBUG(LOGGER, "Recomputing Cartesian path sequentially due to a joint-space jump");
+    *start_state = initial_state;
+    traj.clear();
+    return computeCartesianPath(start_state, group, traj, link, waypoints, true, max_step, jump_threshold,
+                                validCallback, options, cost_function, link_offset);
+  }
+  *start_state = *traj.back();
+
+  return CartesianInterpolator::Percentage(percentage_solved);
+}
+
 CartesianInterpolator::Percentage CartesianInterpolator::checkJointSpaceJump(const JointModelGroup* group,
                                                                              std::vector<RobotStatePtr>& traj,
                                                                              const JumpThreshold& jump_threshold)
@@ -35,15 +35,128 @@
 /* Author: Peter Mitrano */
 
 #include <pybind11/pybind11.h>
+#include <pybind11/eigen.h>
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <moveit/python/pybind_rosmsg_typecasters.h>
+#include <moveit/python/pybind_numpy.h>
 
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/conversions.h>
 
 namespace py = pybind11;
 using namespace robot_state;
+using moveit::python::DoubleArray;
+
+namespace
+{
+const JointModelGroup* getGroup(const RobotState& state, const std::string& group_name)
+{
+  const JointModelGroup* group = state.getRobotModel()->getJointModelGroup(group_name);
+  if (!group)
+    throw py::value_error("Unknown joint model group '" + group_name + "'");
+  return group;
+}
+
+const LinkModel* getLink(const RobotState& state, const std::string& link_name)
+{
+  bool found;
+  const LinkModel* link = state.getRobotModel()->getLinkModel(link_name, &found);
+  if (!link)
+    throw py::value_error("Unknown link '" + link_name + "'");
+  return link;
+}
+
+using RowMajorTransform = Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>;
+using ConstRowMajorTransform = Eigen::Map<const Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>;
+
+// The batch functions below copy the given state once and evaluate all rows on that copy with the GIL released.
+// Inputs and outputs are plain row-major buffers, so no Python object is created per state.
+
+py::array_t<double> computeForwardKinematics(const RobotState& state, const std::string& group_name,
+                                             const std::string& link_name, const DoubleArray& positions)
+{
+  const JointModelGroup* group = getGroup(state, group_name);
+  const LinkModel* link = getLink(state, link_name);
+  const std::size_t dof = group->getVariableCount();
+  const py::ssize_t n = moveit::python::checkBatchShape(positions, dof, "positions");
+
+  py::array_t<double> poses({ n, py::ssize_t(4), py::ssize_t(4) });
+  const double* in = positions.data();
+  double* out = poses.mutable_data();
+  {
+    py::gil_scoped_release release;
+    RobotState work(state);
+    for (py::ssize_t i = 0; i < n; ++i)
+    {
+      work.setJointGroupPositions(group, in + i * dof);
+      RowMajorTransform(out + i * 16) = work.getGlobalLinkTransform(link).matrix();
+    }
+  }
+  return poses;
+}
+
+py::array_t<double> computeJacobians(const RobotState& state, const std::string& group_name,
+                                     const std::string& link_name, const DoubleArray& positions,
+                                     const Eigen::Vector3d& reference_point)
+{
+  const JointModelGroup* group = getGroup(state, group_name);
+  const LinkModel* link = getLink(state, link_name);
+  const std::size_t dof = group->getVariableCount();
+  const py::ssize_t n = moveit::python::checkBatchShape(positions, dof, "positions");
+
+  py::array_t<double> jacobians({ n, py::ssize_t(6), static_cast<py::ssize_t>(dof) });
+  const double* in = positions.data();
+  double* out = jacobians.mutable_data();
+  bool ok = true;
+  {
+    py::gil_scoped_release release;
+    RobotState work(state);
+    Eigen::MatrixXd jacobian;
+    for (py::ssize_t i = 0; i < n && ok; ++i)
+    {
+      work.setJointGroupPositions(group, in + i * dof);
+      work.updateLinkTransforms();
+      ok = static_cast<const RobotState&>(work).getJacobian(group, link, reference_point, jacobian);
+      if (ok)
+        Eigen::Map<Eigen::Matrix<double, 6, Eigen::Dynamic, Eigen::RowMajor>>(out + i * 6 * dof, 6, dof) = jacobian;
+    }
+  }
+  if (!ok)
+    throw py::value_error("Unable to compute the Jacobian of '" + link_name + "' for group '" + group_name + "'");
+  return jacobians;
+}
+
+py::tuple computeInverseKinematics(const RobotState& state, const std::string& group_name,
+                                   const std::string& tip_name, const DoubleArray& poses, double timeout)
+{
+  const JointModelGroup* group = getGroup(state, group_name);
+  const std::size_t dof = group->getVariableCount();
+  const py::ssize_t n = moveit::python::checkTransformBatchShape(poses, "poses");
+
+  py::array_t<double> positions({ n, static_cast<py::ssize_t>(dof) });
+  py::array_t<bool> success(n);
+  const double* in = poses.data();
+  double* out = positions.mutable_data();
+  bool* found = success.mutable_data();
+  {
+    py::gil_scoped_release release;
+    RobotState work(state);
+    std::vector<double> seed;
+    state.copyJointGroupPositions(group, seed);
+    for (py::ssize_t i = 0; i < n; ++i)
+    {
+      // every query starts from the seed in the given state, so results do not depend on the batch order
+      work.setJointGroupPositions(group, seed);
+      Eigen::Isometry3d pose;
+      pose.matrix() = ConstRowMajorTransform(in + i * 16);
+      found[i] = work.setFromIK(group, pose, tip_name, timeout);
+      work.copyJointGroupPositions(group, out + i * dof);
+    }
+  }
+  return py::make_tuple(positions, success);
+}
+}  // namespace
 
 void def_robot_state_bindings(py::module& m)
 {
@@ -90,6 +203,18 @@ void def_robot_state_bindings(py::module& m)
       ;
 
   m.def("jointStateToRobotState", &jointStateToRobotState);
+
+  m.def("computeForwardKinematics", &computeForwardKinematics, py::arg("state"), py::arg("group"), py::arg("link"),
+        py::arg("positions"),
+        "Compute the pose of a link for each row of an (N, dof) array of group positions. Returns an (N, 4, 4) array.");
+  m.def("computeJacobians", &computeJacobians, py::arg("state"), py::arg("group"), py::arg("link"),
+        py::arg("positions"), py::arg("reference_point") = Eigen::Vector3d::Zero(),
+        "Compute the Jacobian of a link for each row of an (N, dof) array of group positions. "
+        "Returns an (N, 6, dof) array.");
+  m.def("computeInverseKinematics", &computeInverseKinematics, py::arg("state"), py::arg("group"), py::arg("tip"),
+        py::arg("poses"), py::arg("timeout") = 0.0,
+        "Solve IK for each pose of an (N, 4, 4) array, seeded from the group positions of state. "
+        "Returns an (N, dof) array of solutions and an (N,) boolean array telling which ones succeeded.");
   m.def(
       "robotStateToRobotStateMsg",
       [](const RobotState& state, bool copy_attached_bodies) {
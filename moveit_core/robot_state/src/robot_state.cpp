@@ -39,7 +39,9 @@
 #include <geometric_shapes/shape_operations.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <moveit/transforms/transforms.h>
+#include <moveit/utils/performance_counters.h>
 #include <rclcpp/clock.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
@@ -57,26 +59,39 @@ namespace core
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.robot_state");
 
-RobotState::RobotState(const RobotModelConstPtr& robot_model)
+RobotState::RobotState(const RobotModelConstPtr& robot_model) : RobotState(robot_model, nullptr)
+{
+}
+
+RobotState::RobotState(const RobotModelConstPtr& robot_model, const RobotStatePoolPtr& pool)
   : robot_model_(robot_model)
+  , memory_pool_(pool)
   , has_velocity_(false)
   , has_acceleration_(false)
   , has_effort_(false)
   , dirty_link_transforms_(nullptr)
   , dirty_collision_body_transforms_(nullptr)
+  , dirty_link_transform_root_count_(0)
+  , dirty_collision_body_transform_root_count_(0)
+  , link_transforms_version_(0)
   , rng_(nullptr)
 {
   if (robot_model == nullptr)
   {
     throw std::invalid_argument("RobotState cannot be constructed with nullptr RobotModelConstPtr");
   }
+  if (pool && pool->getRobotModel() != robot_model)
+  {
+    throw std::invalid_argument("RobotState cannot use a RobotStatePool of a different RobotModel");
+  }
 
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllDirtyLinkTransforms();
   allocMemory();
   initTransforms();
 }
 
-RobotState::RobotState(const RobotState& other) : rng_(nullptr)
+RobotState::RobotState(const RobotState& other)
+  : memory_pool_(other.memory_pool_), link_transforms_version_(0), rng_(nullptr)
 {
   robot_model_ = other.robot_model_;
   allocMemory();
@@ -86,11 +101,37 @@ RobotState::RobotState(const RobotState& other) : rng_(nullptr)
 RobotState::~RobotState()
 {
   clearAttachedBodies();
-  free(memory_);
+  if (memory_pool_ && memory_pool_->owns(memory_))
+    memory_pool_->deallocate(memory_);
+  else
+    free(memory_);
   if (rng_)
     delete rng_;
 }
 
+std::size_t RobotState::getMemorySize(const RobotModel& robot_model)
+{
+  constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
+  // memory for the dirty joint transforms
+  const int nr_doubles_for_dirty_joint_transforms =
+      1 + robot_model.getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+  return sizeof(Eigen::Isometry3d) * (robot_model.getJointModelCount() + robot_model.getLinkModelCount() +
+                                      robot_model.getLinkGeometryCount()) +
+         sizeof(double) * (robot_model.getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
+         extra_alignment_bytes;
+}
+
+std::size_t RobotState::getMemoryUsage() const
+{
+  std::size_t bytes = sizeof(RobotState) + getMemorySize(*robot_model_);
+  for (const CachedJacobian& cached : jacobian_cache_)
+    bytes += sizeof(CachedJacobian) + cached.jacobian.size() * sizeof(double);
+  for (const auto& attached_body : attached_body_map_)
+    bytes += sizeof(AttachedBody) + attached_body.first.capacity() +
+             attached_body.second->getShapes().size() * (sizeof(shapes::ShapeConstPtr) + 2 * sizeof(Eigen::Isometry3d));
+  return bytes;
+}
+
 void RobotState::allocMemory()
 {
   static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES == sizeof(Eigen::Isometry3d),
@@ -100,12 +141,9 @@ void RobotState::allocMemory()
   // memory for the dirty joint transforms
   const int nr_doubles_for_dirty_joint_transforms =
       1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  const size_t bytes =
-      sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                   robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
-      extra_alignment_bytes;
-  memory_ = malloc(bytes);
+  memory_ = memory_pool_ ? memory_pool_->allocate() : nullptr;
+  if (!memory_)
+    memory_ = malloc(getMemorySize(*robot_model_));
 
   // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
   // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
@@ -145,15 +183,25 @@ RobotState& RobotState::operator=(const RobotState& other)
 
 void RobotState::copyFrom(const RobotState& other)
 {
+  ++link_transforms_version_;  // invalidate cached Jacobians
   has_velocity_ = other.has_velocity_;
   has_acceleration_ = other.has_acceleration_;
   has_effort_ = other.has_effort_;
 
   dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
   dirty_link_transforms_ = other.dirty_link_transforms_;
+  dirty_collision_body_transform_root_count_ = other.dirty_collision_body_transform_root_count_;
+  dirty_link_transform_root_count_ = other.dirty_link_transform_root_count_;
+  std::copy(other.dirty_collision_body_transform_roots_,
+            other.dirty_collision_body_transform_roots_ + dirty_collision_body_transform_root_count_,
+            dirty_collision_body_transform_roots_);
+  std::copy(other.dirty_link_transform_roots_, other.dirty_link_transform_roots_ + dirty_link_transform_root_count_,
+            dirty_link_transform_roots_);
 
   if (dirty_link_transforms_ == robot_model_->getRootJoint())
   {
+    // transforms are not copied in this case, so all of them need to be recomputed
+    dirty_link_transform_root_count_ = 0;
     // everything is dirty; no point in copying transforms; copy positions, potentially velocity & acceleration
     memcpy(position_, other.position_,
            robot_model_->getVariableCount() * sizeof(double) *
@@ -286,7 +334,7 @@ void RobotState::setToRandomPositions()
   random_numbers::RandomNumberGenerator& rng = getRandomNumberGenerator();
   robot_model_->getVariableRandomPositions(rng, position_);
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllDirtyLinkTransforms();
   // mimic values are correctly set in RobotModel
 }
 
@@ -364,7 +412,7 @@ void RobotState::setToDefaultValues()
   // set velocity & acceleration to 0
   memset(velocity_, 0, sizeof(double) * 2 * robot_model_->getVariableCount());
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllDirtyLinkTransforms();
 }
 
 void RobotState::setVariablePositions(const double* position)
@@ -376,7 +424,7 @@ void RobotState::setVariablePositions(const double* position)
 
   // Since all joint values have potentially changed, we will need to recompute all transforms
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllDirtyLinkTransforms();
 }
 
 void RobotState::setVariablePositions(const std::map<std::string, double>& variable_map)
@@ -659,13 +707,42 @@ void RobotState::update(bool force)
   if (force)
   {
     memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-    dirty_link_transforms_ = robot_model_->getRootJoint();
+    markAllDirtyLinkTransforms();
   }
 
   // this actually triggers all needed updates
   updateCollisionBodyTransforms();
 }
 
+void RobotState::mergeDirtySubtree(const JointModel*& common_root, const JointModel** roots,
+                                   unsigned char& root_count, const JointModel* joint) const
+{
+  const JointModel* new_common_root = robot_model_->getCommonRoot(common_root, joint);
+  if (root_count != 0)
+  {
+    // nothing to do if joint is already contained in one of the dirty subtrees
+    for (unsigned char i = 0; i < root_count; ++i)
+      if (robot_model_->getCommonRoot(roots[i], joint) == roots[i])
+        return;
+
+    // drop subtrees that are contained in the subtree of joint
+    unsigned char count = 0;
+    for (unsigned char i = 0; i < root_count; ++i)
+      if (robot_model_->getCommonRoot(roots[i], joint) != joint)
+        roots[count++] = roots[i];
+
+    // if there are too many disjoint subtrees, fall back to updating everything below their common root
+    if (count < MAX_DIRTY_SUBTREES)
+    {
+      roots[count++] = joint;
+      root_count = count;
+    }
+    else
+      root_count = 0;
+  }
+  common_root = new_common_root;
+}
+
 void RobotState::updateCollisionBodyTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
@@ -673,23 +750,31 @@ void RobotState::updateCollisionBodyTransforms()
 
   if (dirty_collision_body_transforms_ != nullptr)
   {
-    const std::vector<const LinkModel*>& links = dirty_collision_body_transforms_->getDescendantLinkModels();
+    if (dirty_collision_body_transform_root_count_ == 0)
+      updateSubtreeCollisionBodyTransforms(dirty_collision_body_transforms_);
+    else
+      for (unsigned char i = 0; i < dirty_collision_body_transform_root_count_; ++i)
+        updateSubtreeCollisionBodyTransforms(dirty_collision_body_transform_roots_[i]);
     dirty_collision_body_transforms_ = nullptr;
+    dirty_collision_body_transform_root_count_ = 0;
+  }
+}
 
-    for (const LinkModel* link : links)
+void RobotState::updateSubtreeCollisionBodyTransforms(const JointModel* start)
+{
+  for (const LinkModel* link : start->getDescendantLinkModels())
+  {
+    const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
+    const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
+    const int index_co = link->getFirstCollisionBodyTransformIndex();
+    const int index_l = link->getLinkIndex();
+    for (std::size_t j = 0, end = ot.size(); j != end; ++j)
     {
-      const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
-      const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
-      const int index_co = link->getFirstCollisionBodyTransformIndex();
-      const int index_l = link->getLinkIndex();
-      for (std::size_t j = 0, end = ot.size(); j != end; ++j)
-      {
-        if (ot_id[j])
-          global_collision_body_transforms_[index_co + j] = global_link_transforms_[index_l];
-        else
-          global_collision_body_transforms_[index_co + j].affine().noalias() =
-              global_link_transforms_[index_l].affine() * ot[j].matrix();
-      }
+      if (ot_id[j])
+        global_collision_body_transforms_[index_co + j] = global_link_transforms_[index_l];
+      else
+        global_collision_body_transforms_[index_co + j].affine().noalias() =
+            global_link_transforms_[index_l].affine() * ot[j].matrix();
     }
   }
 }
@@ -698,49 +783,105 @@ void RobotState::updateLinkTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
   {
-    updateLinkTransformsInternal(dirty_link_transforms_);
-    if (dirty_collision_body_transforms_)
-      dirty_collision_body_transforms_ =
-          robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
+    MOVEIT_PERFORMANCE_COUNT(moveit::performance_counters::FK_UPDATES);
+    if (dirty_link_transform_root_count_ == 0)
+    {
+      updateSubtreeLinkTransforms(dirty_link_transforms_);
+      addDirtySubtree(dirty_collision_body_transforms_, dirty_collision_body_transform_roots_,
+                      dirty_collision_body_transform_root_count_, dirty_link_transforms_);
+    }
     else
-      dirty_collision_body_transforms_ = dirty_link_transforms_;
+    {
+      // only recompute the disjoint subtrees that actually changed
+      for (unsigned char i = 0; i < dirty_link_transform_root_count_; ++i)
+      {
+        updateSubtreeLinkTransforms(dirty_link_transform_roots_[i]);
+        addDirtySubtree(dirty_collision_body_transforms_, dirty_collision_body_transform_roots_,
+                        dirty_collision_body_transform_root_count_, dirty_link_transform_roots_[i]);
+      }
+    }
+    updateAttachedBodyTransforms();
     dirty_link_transforms_ = nullptr;
+    dirty_link_transform_root_count_ = 0;
   }
 }
 
-void RobotState::updateLinkTransformsInternal(const JointModel* start)
+void RobotState::updateSubtreeLinkTransforms(const JointModel* start)
 {
+  ++link_transforms_version_;  // invalidate cached Jacobians
+
+  // kernels can only be used if the update includes their first link
+  const FKKernelBinding* start_binding = robot_model_->getFKKernelBinding(start->getChildLinkModel());
+  if (start_binding && start_binding->root_joint != start)
+  {
+    for (const LinkModel* link : start->getDescendantLinkModels())
+      updateLinkTransform(link);
+    return;
+  }
+
   for (const LinkModel* link : start->getDescendantLinkModels())
   {
-    int idx_link = link->getLinkIndex();
-    const LinkModel* parent = link->getParentLinkModel();
-    if (parent)  // root JointModel will not have a parent
+    const FKKernelBinding* binding = robot_model_->getFKKernelBinding(link);
+    if (!binding)
+      updateLinkTransform(link);
+    else if (binding->link_indices.front() == link->getLinkIndex())
+      updateFKKernelLinkTransforms(*binding);
+    // else: already computed by the kernel, as descendants are ordered parents first
+  }
+}
+
+void RobotState::updateFKKernelLinkTransforms(const FKKernelBinding& binding)
+{
+  double values[FKKernel::MAX_VARIABLES];
+  for (std::size_t i = 0; i < binding.variable_indices.size(); ++i)
+    values[i] = position_[binding.variable_indices[i]];
+  Eigen::Isometry3d local_transforms[FKKernel::MAX_LINKS];
+  binding.kernel->computeLinkTransforms(values, local_transforms);
+
+  const LinkModel* base = binding.root_joint->getParentLinkModel();
+  for (std::size_t i = 0; i < binding.link_indices.size(); ++i)
+  {
+    if (base)
+      global_link_transforms_[binding.link_indices[i]].affine().noalias() =
+          global_link_transforms_[base->getLinkIndex()].affine() * local_transforms[i].matrix();
+    else
+      global_link_transforms_[binding.link_indices[i]] = local_transforms[i];
+  }
+}
+
+void RobotState::updateLinkTransform(const LinkModel* link)
+{
+  int idx_link = link->getLinkIndex();
+  const LinkModel* parent = link->getParentLinkModel();
+  if (parent)  // root JointModel will not have a parent
+  {
+    int idx_parent = parent->getLinkIndex();
+    if (link->parentJointIsFixed())  // fixed joint
+      global_link_transforms_[idx_link].affine().noalias() =
+          global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix();
+    else  // non-fixed joint
     {
-      int idx_parent = parent->getLinkIndex();
-      if (link->parentJointIsFixed())  // fixed joint
+      if (link->jointOriginTransformIsIdentity())  // Link has identity transform
         global_link_transforms_[idx_link].affine().noalias() =
-            global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix();
-      else  // non-fixed joint
-      {
-        if (link->jointOriginTransformIsIdentity())  // Link has identity transform
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
-        else  // Link has non-identity transform
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
-              getJointTransform(link->getParentJointModel()).matrix();
-      }
-    }
-    else  // is the origin / root / 'model frame'
-    {
-      if (link->jointOriginTransformIsIdentity())
-        global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
-      else
+            global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
+      else  // Link has non-identity transform
         global_link_transforms_[idx_link].affine().noalias() =
-            link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
+            global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
+            getJointTransform(link->getParentJointModel()).matrix();
     }
   }
+  else  // is the origin / root / 'model frame'
+  {
+    if (link->jointOriginTransformIsIdentity())
+      global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
+    else
+      global_link_transforms_[idx_link].affine().noalias() =
+          link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
+  }
+}
 
+void RobotState::updateAttachedBodyTransforms()
+{
   // update attached bodies tf; these are usually very few, so we update them all
   for (const auto& attached_body : attached_body_map_)
     attached_body.second->computeTransform(
@@ -752,18 +893,15 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
   updateLinkTransforms();  // no link transforms must be dirty, otherwise the transform we set will be overwritten
 
   // update the fact that collision body transforms are out of date
-  if (dirty_collision_body_transforms_)
-    dirty_collision_body_transforms_ =
-        robot_model_->getCommonRoot(dirty_collision_body_transforms_, link->getParentJointModel());
-  else
-    dirty_collision_body_transforms_ = link->getParentJointModel();
+  addDirtySubtree(dirty_collision_body_transforms_, dirty_collision_body_transform_roots_,
+                  dirty_collision_body_transform_root_count_, link->getParentJointModel());
 
   global_link_transforms_[link->getLinkIndex()] = transform;
 
   // update link transforms for descendant links only (leaving the transform for the current link untouched)
   const std::vector<const JointModel*>& cj = link->getChildJointModels();
   for (const JointModel* joint : cj)
-    updateLinkTransformsInternal(joint);
+    updateSubtreeLinkTransforms(joint);
 
   // if we also need to go backward
   if (backward)
@@ -787,16 +925,14 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
       const std::vector<const JointModel*>& cj = parent_link->getChildJointModels();
       for (const JointModel* joint : cj)
         if (joint != child_link->getParentJointModel())
-          updateLinkTransformsInternal(joint);
+          updateSubtreeLinkTransforms(joint);
     }
     // all collision body transforms are invalid now
     dirty_collision_body_transforms_ = parent_link->getParentJointModel();
+    dirty_collision_body_transform_root_count_ = 0;
   }
 
-  // update attached bodies tf; these are usually very few, so we update them all
-  for (const auto& attached_body : attached_body_map_)
-    attached_body.second->computeTransform(
-        global_link_transforms_[attached_body.second->getAttachedLink()->getLinkIndex()]);
+  updateAttachedBodyTransforms();
 }
 
 const LinkModel* RobotState::getLinkModelIncludingAttachedBodies(const std::string& frame) const
@@ -848,6 +984,17 @@ bool RobotState::satisfiesBounds(double margin) const
 bool RobotState::satisfiesBounds(const JointModelGroup* group, double margin) const
 {
   const std::vector<const JointModel*>& jm = group->getActiveJointModels();
+  if (group->hasVectorizedBounds() && group->isContiguousWithinState())
+  {
+    if (!group->satisfiesPositionBounds(position_ + group->getVariableIndexList()[0], margin))
+      return false;
+    if (has_velocity_)
+      for (const JointModel* joint : jm)
+        if (!satisfiesVelocityBounds(joint, margin))
+          return false;
+    return true;
+  }
+
   for (const JointModel* joint : jm)
     if (!satisfiesBounds(joint, margin))
       return false;
@@ -864,6 +1011,20 @@ void RobotState::enforceBounds()
 void RobotState::enforceBounds(const JointModelGroup* joint_group)
 {
   const std::vector<const JointModel*>& jm = joint_group->getActiveJointModels();
+  if (joint_group->hasVectorizedBounds() && joint_group->isContiguousWithinState())
+  {
+    if (joint_group->enforcePositionBounds(position_ + joint_group->getVariableIndexList()[0]))
+      for (const JointModel* joint : jm)
+      {
+        markDirtyJointTransforms(joint);
+        updateMimicJoint(joint);
+      }
+    if (has_velocity_)
+      for (const JointModel* joint : jm)
+        enforceVelocityBounds(joint);
+    return;
+  }
+
   for (const JointModel* joint : jm)
     enforceBounds(joint);
 }
@@ -949,6 +1110,12 @@ bool RobotState::isValidVelocityMove(const RobotState& other, const JointModelGr
 
 double RobotState::distance(const RobotState& other, const JointModelGroup* joint_group) const
 {
+  if (joint_group->hasVectorizedBounds() && joint_group->isContiguousWithinState())
+  {
+    const int idx = joint_group->getVariableIndexList()[0];
+    return joint_group->distance(position_ + idx, other.position_ + idx);
+  }
+
   double d = 0.0;
   const std::vector<const JointModel*>& jm = joint_group->getActiveJointModels();
   for (const JointModel* joint : jm)
@@ -965,7 +1132,7 @@ void RobotState::interpolate(const RobotState& to, double t, RobotState& state)
   robot_model_->interpolate(getVariablePositions(), to.getVariablePositions(), t, state.getVariablePositions());
 
   memset(state.dirty_joint_transforms_, 1, state.robot_model_->getJointModelCount() * sizeof(unsigned char));
-  state.dirty_link_transforms_ = state.robot_model_->getRootJoint();
+  state.markAllDirtyLinkTransforms();
 }
 
 void RobotState::interpolate(const RobotState& to, double t, RobotState& state, const JointModelGroup* joint_group) const
@@ -1289,6 +1456,50 @@ Eigen::MatrixXd RobotState::getJacobian(const JointModelGroup* group,
   return result;
 }
 
+bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position, Eigen::MatrixXd& jacobian,
+                             bool use_quaternion_representation)
+{
+  updateLinkTransforms();
+
+  CachedJacobian* slot = nullptr;
+  for (CachedJacobian& entry : jacobian_cache_)
+  {
+    if (entry.link_transforms_version != link_transforms_version_)
+    {
+      if (!slot)
+        slot = &entry;  // reuse the memory of outdated entries
+      continue;
+    }
+    if (entry.group == group && entry.link == link &&
+        entry.use_quaternion_representation == use_quaternion_representation &&
+        entry.reference_point_position == reference_point_position)
+    {
+      jacobian = entry.jacobian;
+      return true;
+    }
+  }
+
+  if (!static_cast<const RobotState*>(this)->getJacobian(group, link, reference_point_position, jacobian,
+                                                         use_quaternion_representation))
+    return false;
+
+  if (!slot)
+  {
+    if (jacobian_cache_.size() < MAX_CACHED_JACOBIANS)
+      slot = &jacobian_cache_.emplace_back();
+    else  // all entries are up to date, evict one of them
+      slot = &jacobian_cache_[link_transforms_version_ % MAX_CACHED_JACOBIANS];
+  }
+  slot->group = group;
+  slot->link = link;
+  slot->reference_point_position = reference_point_position;
+  slot->use_quaternion_representation = use_quaternion_representation;
+  slot->link_transforms_version = link_transforms_version_;
+  slot->jacobian = jacobian;
+  return true;
+}
+
 bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link,
                              const Eigen::Vector3d& reference_point_position, Eigen::MatrixXd& jacobian,
                              bool use_quaternion_representation) const
@@ -1394,6 +1605,111 @@ bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link
   return true;
 }
 
+bool RobotState::getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                                       const Eigen::Vector3d& reference_point_position,
+                                       const Eigen::VectorXd& joint_velocities,
+                                       Eigen::MatrixXd& jacobian_derivative) const
+{
+  assert(checkLinkTransforms());
+
+  if (!group->isChain())
+  {
+    RCLCPP_ERROR(LOGGER, "The group '%s' is not a chain. Cannot compute Jacobian derivative.", group->getName().c_str());
+    return false;
+  }
+
+  if (!group->isLinkUpdated(link->getName()))
+  {
+    RCLCPP_ERROR(LOGGER, "Link name '%s' does not exist in the chain '%s' or is not a child for this chain",
+                 link->getName().c_str(), group->getName().c_str());
+    return false;
+  }
+
+  const int columns = group->getVariableCount();
+  if (joint_velocities.size() != columns)
+  {
+    RCLCPP_ERROR(LOGGER, "Expected %d joint velocities for group '%s', got %ld", columns, group->getName().c_str(),
+                 static_cast<long>(joint_velocities.size()));
+    return false;
+  }
+
+  const moveit::core::JointModel* root_joint_model = group->getJointModels()[0];
+  const moveit::core::LinkModel* root_link_model = root_joint_model->getParentLinkModel();
+  const Eigen::Isometry3d reference_transform =
+      root_link_model ? getGlobalLinkTransform(root_link_model).inverse() : Eigen::Isometry3d::Identity();
+  const Eigen::Vector3d point = reference_transform * getGlobalLinkTransform(link) * reference_point_position;
+
+  // collect the axes and origins of the chain's joints, from the tip to the root
+  struct ChainJoint
+  {
+    int index;
+    bool revolute;
+    Eigen::Vector3d axis;
+    Eigen::Vector3d origin;
+  };
+  std::vector<ChainJoint> chain;
+  while (link)
+  {
+    const JointModel* pjm = link->getParentJointModel();
+    if (pjm->getVariableCount() > 0 && group->hasJointModel(pjm->getName()))
+    {
+      const Eigen::Isometry3d joint_transform = reference_transform * getGlobalLinkTransform(link);
+      if (pjm->getType() == moveit::core::JointModel::REVOLUTE)
+        chain.push_back({ group->getVariableGroupIndex(pjm->getName()), true,
+                          joint_transform.linear() * static_cast<const RevoluteJointModel*>(pjm)->getAxis(),
+                          joint_transform.translation() });
+      else if (pjm->getType() == moveit::core::JointModel::PRISMATIC)
+        chain.push_back({ group->getVariableGroupIndex(pjm->getName()), false,
+                          joint_transform.linear() * static_cast<const PrismaticJointModel*>(pjm)->getAxis(),
+                          joint_transform.translation() });
+      else
+      {
+        RCLCPP_ERROR(LOGGER, "Jacobian derivative is only supported for revolute and prismatic joints");
+        return false;
+      }
+    }
+    if (pjm == root_joint_model)
+      break;
+    link = pjm->getParentLinkModel();
+  }
+
+  // velocity of a point rigidly attached behind the first num_joints joints of the chain (root to tip order)
+  auto point_velocity = [&](const Eigen::Vector3d& p, std::size_t num_joints) {
+    Eigen::Vector3d v = Eigen::Vector3d::Zero();
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const ChainJoint& cj = chain[chain.size() - 1 - j];
+      if (cj.revolute)
+        v += cj.axis.cross(p - cj.origin) * joint_velocities[cj.index];
+      else
+        v += cj.axis * joint_velocities[cj.index];
+    }
+    return v;
+  };
+
+  jacobian_derivative = Eigen::MatrixXd::Zero(6, columns);
+  const Eigen::Vector3d point_vel = point_velocity(point, chain.size());
+  Eigen::Vector3d angular_vel = Eigen::Vector3d::Zero();
+  for (std::size_t i = 0; i < chain.size(); ++i)
+  {
+    const ChainJoint& cj = chain[chain.size() - 1 - i];
+    // the axis of joint i rotates with the angular velocity induced by all joints up to (and including) i
+    if (cj.revolute)
+      angular_vel += cj.axis * joint_velocities[cj.index];
+    const Eigen::Vector3d axis_dot = angular_vel.cross(cj.axis);
+    if (cj.revolute)
+    {
+      const Eigen::Vector3d origin_vel = point_velocity(cj.origin, i);
+      jacobian_derivative.block<3, 1>(0, cj.index) +=
+          axis_dot.cross(point - cj.origin) + cj.axis.cross(point_vel - origin_vel);
+      jacobian_derivative.block<3, 1>(3, cj.index) += axis_dot;
+    }
+    else
+      jacobian_derivative.block<3, 1>(0, cj.index) += axis_dot;
+  }
+  return true;
+}
+
 bool RobotState::setFromDiffIK(const JointModelGroup* jmg, const Eigen::VectorXd& twist, const std::string& tip,
                                double dt, const GroupStateValidityCallbackFn& constraint)
 {
@@ -1806,6 +2122,7 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Is
   std::vector<double> ik_sol;
   moveit_msgs::msg::MoveItErrorCodes error;
 
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::IK_CALLS);
   if (solver->searchPositionIK(ik_queries, seed, timeout, consistency_limits, ik_sol, ik_callback_fn, cost_function,
                                error, options, this))
   {
@@ -1992,6 +2309,7 @@ bool RobotState::setFromIKSubgroups(const JointModelGroup* jmg, const EigenSTL::
       std::vector<double> ik_sol;
       moveit_msgs::msg::MoveItErrorCodes error;
       const std::vector<double>& climits = consistency_limits.empty() ? std::vector<double>() : consistency_limits[sg];
+      MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::IK_CALLS);
       if (solvers[sg]->searchPositionIK(ik_queries[sg], seed, (timeout - elapsed) / sub_groups.size(), climits, ik_sol,
                                         error))
       {
@@ -2056,27 +2374,36 @@ double RobotState::computeCartesianPath(const JointModelGroup* group, std::vecto
 }
 
 void RobotState::computeAABB(std::vector<double>& aabb) const
+{
+  computeAABB(robot_model_->getLinkModelsWithCollisionGeometry(), nullptr, aabb);
+}
+
+void RobotState::computeAABB(const JointModelGroup* group, std::vector<double>& aabb) const
+{
+  computeAABB(group->getLinkModelsWithCollisionGeometry(), group, aabb);
+}
+
+void RobotState::computeAABB(const std::vector<const LinkModel*>& links, const JointModelGroup* group,
+                             std::vector<double>& aabb) const
 {
   assert(checkLinkTransforms());
 
+  // the local boxes of links and attached shapes are precomputed, so this only transforms and merges them
   core::AABB bounding_box;
-  std::vector<const LinkModel*> links = robot_model_->getLinkModelsWithCollisionGeometry();
   for (const LinkModel* link : links)
   {
-    Eigen::Isometry3d transform = getGlobalLinkTransform(link);  // intentional copy, we will translate
-    const Eigen::Vector3d& extents = link->getShapeExtentsAtOrigin();
-    transform.translate(link->getCenteredBoundingBoxOffset());
-    bounding_box.extendWithTransformedBox(transform, extents);
+    const Eigen::Isometry3d& transform = getGlobalLinkTransform(link);
+    bounding_box.extendWithTransformedBox(transform, link->getCenteredBoundingBoxOffset(),
+                                          link->getShapeExtentsAtOrigin());
   }
   for (const auto& it : attached_body_map_)
   {
+    if (group && !group->hasLinkModel(it.second->getAttachedLinkName()))
+      continue;
     const EigenSTL::vector_Isometry3d& transforms = it.second->getGlobalCollisionBodyTransforms();
-    const std::vector<shapes::ShapeConstPtr>& shapes = it.second->getShapes();
+    const EigenSTL::vector_Vector3d& extents = it.second->getShapeExtents();
     for (std::size_t i = 0; i < transforms.size(); ++i)
-    {
-      Eigen::Vector3d extents = shapes::computeShapeExtents(shapes[i].get());
-      bounding_box.extendWithTransformedBox(transforms[i], extents);
-    }
+      bounding_box.extendWithTransformedBox(transforms[i], extents[i]);
   }
 
   aabb.clear();
@@ -0,0 +1,330 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_batch.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <rclcpp/logger.hpp>
+
+namespace moveit
+{
+namespace core
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.robot_state_batch");
+
+namespace
+{
+// Transforms are stored as the 12 columns of a column-major 3x4 affine matrix
+inline Eigen::Index elem(int row, int col)
+{
+  return col * 3 + row;
+}
+
+// out = a * b, where b is the same transform for all entries
+void multiplyWithConstant(const Eigen::Ref<const Eigen::ArrayXXd>& a, const Eigen::Isometry3d& b,
+                          Eigen::Ref<Eigen::ArrayXXd> out)
+{
+  for (int c = 0; c < 4; ++c)
+    for (int r = 0; r < 3; ++r)
+    {
+      out.col(elem(r, c)) = a.col(elem(r, 0)) * b(0, c) + a.col(elem(r, 1)) * b(1, c) + a.col(elem(r, 2)) * b(2, c);
+      if (c == 3)
+        out.col(elem(r, c)) += a.col(elem(r, 3));
+    }
+}
+
+// out = a * b, with a rotation-only b (its translation columns are ignored)
+void multiplyWithRotation(const Eigen::Ref<const Eigen::ArrayXXd>& a, const Eigen::Ref<const Eigen::ArrayXXd>& b,
+                          Eigen::Ref<Eigen::ArrayXXd> out)
+{
+  for (int c = 0; c < 3; ++c)
+    for (int r = 0; r < 3; ++r)
+      out.col(elem(r, c)) = a.col(elem(r, 0)) * b.col(elem(0, c)) + a.col(elem(r, 1)) * b.col(elem(1, c)) +
+                            a.col(elem(r, 2)) * b.col(elem(2, c));
+  out.middleCols(9, 3) = a.middleCols(9, 3);
+}
+
+// out = a * b, for arbitrary affine b
+void multiply(const Eigen::Ref<const Eigen::ArrayXXd>& a, const Eigen::Ref<const Eigen::ArrayXXd>& b,
+              Eigen::Ref<Eigen::ArrayXXd> out)
+{
+  for (int c = 0; c < 4; ++c)
+    for (int r = 0; r < 3; ++r)
+    {
+      out.col(elem(r, c)) = a.col(elem(r, 0)) * b.col(elem(0, c)) + a.col(elem(r, 1)) * b.col(elem(1, c)) +
+                            a.col(elem(r, 2)) * b.col(elem(2, c));
+      if (c == 3)
+        out.col(elem(r, c)) += a.col(elem(r, 3));
+    }
+}
+}  // namespace
+
+RobotStateBatch::RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size)
+  : robot_model_(robot_model), size_(0), dirty_(true)
+{
+  if (robot_model == nullptr)
+  {
+    throw std::invalid_argument("RobotStateBatch cannot be constructed with nullptr RobotModelConstPtr");
+  }
+  resize(size);
+}
+
+void RobotStateBatch::resize(std::size_t size)
+{
+  size_ = size;
+  const Eigen::Index n = static_cast<Eigen::Index>(size);
+  positions_.resize(n, robot_model_->getVariableCount());
+  link_transforms_.resize(n, TRANSFORM_SIZE * robot_model_->getLinkModelCount());
+  origin_scratch_.resize(n, TRANSFORM_SIZE);
+  joint_scratch_.resize(n, TRANSFORM_SIZE);
+  dirty_ = true;
+}
+
+void RobotStateBatch::setToDefaultValues()
+{
+  std::vector<double> values(robot_model_->getVariableCount());
+  robot_model_->getVariableDefaultPositions(values.data());
+  for (std::size_t i = 0; i < values.size(); ++i)
+    positions_.col(i).setConstant(values[i]);
+  dirty_ = true;
+}
+
+void RobotStateBatch::setToRandomPositions(random_numbers::RandomNumberGenerator& rng)
+{
+  std::vector<double> values(robot_model_->getVariableCount());
+  for (std::size_t i = 0; i < size_; ++i)
+  {
+    robot_model_->getVariableRandomPositions(rng, values.data());
+    setVariablePositions(i, values.data());
+  }
+}
+
+void RobotStateBatch::setVariablePositions(std::size_t index, const double* position)
+{
+  assert(index < size_);
+  positions_.row(index) = Eigen::Map<const Eigen::ArrayXd>(position, positions_.cols()).transpose();
+  dirty_ = true;
+}
+
+void RobotStateBatch::copyVariablePositions(std::size_t index, double* position) const
+{
+  assert(index < size_);
+  Eigen::Map<Eigen::ArrayXd>(position, positions_.cols()) = positions_.row(index).transpose();
+}
+
+void RobotStateBatch::setJointGroupPositions(std::size_t index, const JointModelGroup* group, const double* gstate)
+{
+  assert(index < size_);
+  const std::vector<int>& il = group->getVariableIndexList();
+  if (group->isContiguousWithinState())
+    positions_.row(index).segment(il[0], il.size()) = Eigen::Map<const Eigen::ArrayXd>(gstate, il.size()).transpose();
+  else
+  {
+    for (std::size_t i = 0; i < il.size(); ++i)
+      positions_(index, il[i]) = gstate[i];
+  }
+  updateMimicJoints(index, group);
+  dirty_ = true;
+}
+
+void RobotStateBatch::copyJointGroupPositions(std::size_t index, const JointModelGroup* group, double* gstate) const
+{
+  assert(index < size_);
+  const std::vector<int>& il = group->getVariableIndexList();
+  for (std::size_t i = 0; i < il.size(); ++i)
+    gstate[i] = positions_(index, il[i]);
+}
+
+void RobotStateBatch::copyToRobotState(std::size_t index, RobotState& state) const
+{
+  std::vector<double> values(robot_model_->getVariableCount());
+  copyVariablePositions(index, values.data());
+  state.setVariablePositions(values.data());
+}
+
+void RobotStateBatch::updateMimicJoints(std::size_t index, const JointModelGroup* group)
+{
+  for (const JointModel* jm : group->getMimicJointModels())
+  {
+    const int fvi = jm->getFirstVariableIndex();
+    positions_(index, fvi) =
+        jm->getMimicFactor() * positions_(index, jm->getMimic()->getFirstVariableIndex()) + jm->getMimicOffset();
+  }
+}
+
+void RobotStateBatch::interpolate(const RobotState& from, const RobotState& to, const double* fractions,
+                                  std::size_t count, std::size_t first)
+{
+  assert(first + count <= size_);
+  for (std::size_t k = 0; k < count; ++k)
+    checkInterpolationParamBounds(LOGGER, fractions[k]);
+
+  const double* from_positions = from.getVariablePositions();
+  const double* to_positions = to.getVariablePositions();
+  const Eigen::Map<const Eigen::ArrayXd> t(fractions, count);
+  std::vector<double> joint_values;
+  for (const JointModel* joint : robot_model_->getActiveJointModels())
+  {
+    const int idx = joint->getFirstVariableIndex();
+    if (joint->getType() == JointModel::PRISMATIC ||
+        (joint->getType() == JointModel::REVOLUTE && !static_cast<const RevoluteJointModel*>(joint)->isContinuous()))
+      positions_.col(idx).segment(first, count) = from_positions[idx] + (to_positions[idx] - from_positions[idx]) * t;
+    else
+    {
+      joint_values.resize(joint->getVariableCount());
+      for (std::size_t k = 0; k < count; ++k)
+      {
+        joint->interpolate(from_positions + idx, to_positions + idx, fractions[k], joint_values.data());
+        for (std::size_t v = 0; v < joint_values.size(); ++v)
+          positions_(first + k, idx + v) = joint_values[v];
+      }
+    }
+  }
+
+  for (const JointModel* joint : robot_model_->getMimicJointModels())
+    positions_.col(joint->getFirstVariableIndex()).segment(first, count) =
+        positions_.col(joint->getMimic()->getFirstVariableIndex()).segment(first, count) * joint->getMimicFactor() +
+        joint->getMimicOffset();
+  dirty_ = true;
+}
+
+void RobotStateBatch::update(bool force)
+{
+  if (!dirty_ && !force)
+    return;
+  dirty_ = false;
+  if (size_ == 0)
+    return;
+
+  std::vector<double> joint_values;
+  Eigen::Isometry3d joint_transform;
+  for (const LinkModel* link : robot_model_->getRootJoint()->getDescendantLinkModels())
+  {
+    auto out = link_transforms_.middleCols(TRANSFORM_SIZE * link->getLinkIndex(), TRANSFORM_SIZE);
+    const JointModel* joint = link->getParentJointModel();
+    const LinkModel* parent = link->getParentLinkModel();
+
+    // compose the parent transform with the (constant) joint origin transform
+    if (parent)
+    {
+      auto parent_transform = link_transforms_.middleCols(TRANSFORM_SIZE * parent->getLinkIndex(), TRANSFORM_SIZE);
+      if (link->jointOriginTransformIsIdentity())
+        origin_scratch_ = parent_transform;
+      else
+        multiplyWithConstant(parent_transform, link->getJointOriginTransform(), origin_scratch_);
+    }
+    else  // the root link is relative to the model frame
+    {
+      const Eigen::Isometry3d& origin = link->getJointOriginTransform();
+      for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 3; ++r)
+          origin_scratch_.col(elem(r, c)).setConstant(origin(r, c));
+    }
+
+    // compose with the variable joint transform, specialized for the common joint types
+    switch (joint->getType())
+    {
+      case JointModel::FIXED:
+        out = origin_scratch_;
+        break;
+      case JointModel::REVOLUTE:
+      {
+        const Eigen::Vector3d& axis = static_cast<const RevoluteJointModel*>(joint)->getAxis();
+        const auto q = positions_.col(joint->getFirstVariableIndex());
+        const Eigen::ArrayXd c = q.cos();
+        const Eigen::ArrayXd s = q.sin();
+        const Eigen::ArrayXd t = 1.0 - c;
+        // same Rodrigues formula as RevoluteJointModel::computeTransform()
+        joint_scratch_.col(elem(0, 0)) = t * (axis.x() * axis.x()) + c;
+        joint_scratch_.col(elem(1, 0)) = t * (axis.x() * axis.y()) + axis.z() * s;
+        joint_scratch_.col(elem(2, 0)) = t * (axis.x() * axis.z()) - axis.y() * s;
+        joint_scratch_.col(elem(0, 1)) = t * (axis.x() * axis.y()) - axis.z() * s;
+        joint_scratch_.col(elem(1, 1)) = t * (axis.y() * axis.y()) + c;
+        joint_scratch_.col(elem(2, 1)) = t * (axis.y() * axis.z()) + axis.x() * s;
+        joint_scratch_.col(elem(0, 2)) = t * (axis.x() * axis.z()) + axis.y() * s;
+        joint_scratch_.col(elem(1, 2)) = t * (axis.y() * axis.z()) - axis.x() * s;
+        joint_scratch_.col(elem(2, 2)) = t * (axis.z() * axis.z()) + c;
+        multiplyWithRotation(origin_scratch_, joint_scratch_, out);
+        break;
+      }
+      case JointModel::PRISMATIC:
+      {
+        const Eigen::Vector3d& axis = static_cast<const PrismaticJointModel*>(joint)->getAxis();
+        const auto q = positions_.col(joint->getFirstVariableIndex());
+        out.leftCols(9) = origin_scratch_.leftCols(9);
+        for (int r = 0; r < 3; ++r)
+          out.col(elem(r, 3)) = origin_scratch_.col(elem(r, 3)) +
+                                q * (origin_scratch_.col(elem(r, 0)) * axis.x() +
+                                     origin_scratch_.col(elem(r, 1)) * axis.y() + origin_scratch_.col(elem(r, 2)) * axis.z());
+        break;
+      }
+      default:
+      {
+        // planar and floating joints are rare; compute their transforms entry by entry
+        const int fvi = joint->getFirstVariableIndex();
+        joint_values.resize(joint->getVariableCount());
+        for (Eigen::Index i = 0; i < static_cast<Eigen::Index>(size_); ++i)
+        {
+          for (std::size_t v = 0; v < joint_values.size(); ++v)
+            joint_values[v] = positions_(i, fvi + v);
+          joint->computeTransform(joint_values.data(), joint_transform);
+          for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 3; ++r)
+              joint_scratch_(i, elem(r, c)) = joint_transform(r, c);
+        }
+        multiply(origin_scratch_, joint_scratch_, out);
+        break;
+      }
+    }
+  }
+}
+
+Eigen::Isometry3d RobotStateBatch::getGlobalLinkTransform(std::size_t index, const LinkModel* link) const
+{
+  if (!link)
+  {
+    throw Exception("Invalid link");
+  }
+  assert(!dirty_);
+  assert(index < size_);
+  Eigen::Isometry3d transform;
+  transform.makeAffine();
+  const Eigen::Index offset = TRANSFORM_SIZE * link->getLinkIndex();
+  for (int c = 0; c < 4; ++c)
+    for (int r = 0; r < 3; ++r)
+      transform(r, c) = link_transforms_(index, offset + elem(r, c));
+  return transform;
+}
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_state/robot_state_pool.h>
+#include <cstdlib>
+#include <new>
+
+namespace moveit
+{
+namespace core
+{
+RobotStatePool::RobotStatePool(const RobotModelConstPtr& robot_model, std::size_t capacity)
+  : robot_model_(robot_model), capacity_(capacity), block_size_(0), slab_(nullptr)
+{
+  if (robot_model == nullptr)
+  {
+    throw std::invalid_argument("RobotStatePool cannot be constructed with nullptr RobotModelConstPtr");
+  }
+
+  // round up, so that every block starts at a cache line boundary
+  block_size_ = (RobotState::getMemorySize(*robot_model_) + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+  if (capacity_ > 0)
+  {
+    slab_ = static_cast<char*>(std::aligned_alloc(BLOCK_ALIGNMENT, capacity_ * block_size_));
+    if (!slab_)
+      throw std::bad_alloc();
+  }
+
+  // hand out blocks in increasing address order
+  free_blocks_.reserve(capacity_);
+  for (std::size_t i = capacity_; i > 0; --i)
+    free_blocks_.push_back(slab_ + (i - 1) * block_size_);
+}
+
+RobotStatePool::~RobotStatePool()
+{
+  std::free(slab_);
+}
+
+std::size_t RobotStatePool::getAvailableCount() const
+{
+  std::scoped_lock slock(lock_);
+  return free_blocks_.size();
+}
+
+RobotStatePtr RobotStatePool::createState()
+{
+  auto state = std::make_shared<RobotState>(robot_model_, shared_from_this());
+  state->setToDefaultValues();
+  return state;
+}
+
+RobotStatePtr RobotStatePool::createState(const RobotState& state)
+{
+  auto copy = std::make_shared<RobotState>(robot_model_, shared_from_this());
+  *copy = state;
+  return copy;
+}
+
+void* RobotStatePool::allocate()
+{
+  std::scoped_lock slock(lock_);
+  if (free_blocks_.empty())
+    return nullptr;
+  void* block = free_blocks_.back();
+  free_blocks_.pop_back();
+  return block;
+}
+
+void RobotStatePool::deallocate(void* block)
+{
+  assert(owns(block));
+  std::scoped_lock slock(lock_);
+  free_blocks_.push_back(block);
+}
+}  // namespace core
+}  // namespace moveit
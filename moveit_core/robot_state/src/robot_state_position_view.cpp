@@ -0,0 +1,157 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_state/robot_state_position_view.h>
+
+namespace moveit
+{
+namespace core
+{
+RobotStatePositionView::RobotStatePositionView(const RobotModelConstPtr& robot_model)
+  : robot_model_(robot_model), dirty_(true)
+{
+  if (robot_model == nullptr)
+  {
+    throw std::invalid_argument("RobotStatePositionView cannot be constructed with nullptr RobotModelConstPtr");
+  }
+  memory_.resize(robot_model_->getVariableCount() + 12 * robot_model_->getLinkModelCount());
+}
+
+RobotStatePositionView::RobotStatePositionView(const RobotState& state)
+  : RobotStatePositionView(state.getRobotModel())
+{
+  setFromRobotState(state);
+}
+
+void RobotStatePositionView::setVariablePositions(const double* position)
+{
+  std::copy(position, position + robot_model_->getVariableCount(), memory_.begin());
+  dirty_ = true;
+}
+
+void RobotStatePositionView::setJointGroupPositions(const JointModelGroup* group, const double* gstate)
+{
+  const std::vector<int>& il = group->getVariableIndexList();
+  for (std::size_t i = 0; i < il.size(); ++i)
+    memory_[il[i]] = gstate[i];
+  for (const JointModel* jm : group->getMimicJointModels())
+    memory_[jm->getFirstVariableIndex()] =
+        jm->getMimicFactor() * memory_[jm->getMimic()->getFirstVariableIndex()] + jm->getMimicOffset();
+  dirty_ = true;
+}
+
+void RobotStatePositionView::copyJointGroupPositions(const JointModelGroup* group, double* gstate) const
+{
+  const std::vector<int>& il = group->getVariableIndexList();
+  for (std::size_t i = 0; i < il.size(); ++i)
+    gstate[i] = memory_[il[i]];
+}
+
+void RobotStatePositionView::setToDefaultValues()
+{
+  robot_model_->getVariableDefaultPositions(memory_.data());
+  dirty_ = true;
+}
+
+void RobotStatePositionView::setToRandomPositions(random_numbers::RandomNumberGenerator& rng)
+{
+  robot_model_->getVariableRandomPositions(rng, memory_.data());
+  dirty_ = true;
+}
+
+void RobotStatePositionView::setFromRobotState(const RobotState& state)
+{
+  assert(state.getRobotModel() == robot_model_);
+  setVariablePositions(state.getVariablePositions());
+  if (!state.dirtyLinkTransforms())
+  {
+    for (const LinkModel* link : robot_model_->getLinkModels())
+      AffineMap(linkTransformData(link)) = state.getGlobalLinkTransform(link).affine();
+    dirty_ = false;
+  }
+}
+
+void RobotStatePositionView::copyToRobotState(RobotState& state) const
+{
+  assert(state.getRobotModel() == robot_model_);
+  state.setVariablePositions(memory_.data());
+}
+
+void RobotStatePositionView::update(bool force)
+{
+  if (!dirty_ && !force)
+    return;
+
+  Eigen::Isometry3d local;
+  for (const LinkModel* link : robot_model_->getRootJoint()->getDescendantLinkModels())
+  {
+    const JointModel* joint = link->getParentJointModel();
+    if (link->parentJointIsFixed())
+      local = link->getJointOriginTransform();
+    else
+    {
+      joint->computeTransform(memory_.data() + joint->getFirstVariableIndex(), local);
+      if (!link->jointOriginTransformIsIdentity())
+        local = link->getJointOriginTransform() * local;
+    }
+
+    AffineMap out(linkTransformData(link));
+    if (const LinkModel* parent = link->getParentLinkModel())
+    {
+      const ConstAffineMap parent_transform(linkTransformData(parent));
+      out.leftCols<3>().noalias() = parent_transform.leftCols<3>() * local.linear();
+      out.col(3).noalias() = parent_transform.leftCols<3>() * local.translation();
+      out.col(3) += parent_transform.col(3);
+    }
+    else  // is the origin / root / 'model frame'
+      out = local.affine();
+  }
+  dirty_ = false;
+}
+
+Eigen::Isometry3d RobotStatePositionView::getGlobalLinkTransform(const LinkModel* link) const
+{
+  if (!link)
+  {
+    throw Exception("Invalid link");
+  }
+  assert(!dirty_);
+  Eigen::Isometry3d transform;
+  transform.affine() = ConstAffineMap(linkTransformData(link));
+  transform.makeAffine();
+  return transform;
+}
+}  // namespace core
+}  // namespace moveit
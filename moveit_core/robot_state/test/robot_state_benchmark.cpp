@@ -33,131 +33,261 @@
  *********************************************************************/
 
 /* Author: Robert Haschke */
+/* Author: Robert Haschke
+   Desc: Google Benchmark micro-benchmarks of RobotState hot paths: forward kinematics, Jacobians and
+   differential IK on the Panda and PR2 test models, and the Eigen transform operations they are built from.
+   Run with --benchmark_filter=<regex> to select cases; results are comparable across releases as the
+   sampled states are seeded.
+*/
+
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <eigen_stl_containers/eigen_stl_containers.h>
-#include <chrono>
-#include <gtest/gtest.h>
+#include <random_numbers/random_numbers.h>
+#include <benchmark/benchmark.h>
 
-// Helper class to measure time within a scoped block and output the result
-class ScopedTimer
+namespace
 {
-  const char* const msg_;
-  double* const gold_standard_;
-  const std::chrono::time_point<std::chrono::steady_clock> start_;
+constexpr std::size_t NUM_SAMPLES = 1000;
+constexpr unsigned int RANDOM_SEED = 42;
 
-public:
-  // if gold_standard is provided, a relative increase/decrease is shown too
-  ScopedTimer(const char* msg = "", double* gold_standard = nullptr)
-    : msg_(msg), gold_standard_(gold_standard), start_(std::chrono::steady_clock::now())
-  {
-  }
+struct TestModel
+{
+  const char* robot_name;
+  const char* group_name;
+  const char* tip_link;
+};
 
-  ~ScopedTimer()
-  {
-    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
-    std::cerr << msg_ << elapsed.count() * 1000. << "ms ";
+// Indexed by the benchmark argument
+const TestModel TEST_MODELS[] = { { "panda", "panda_arm", "panda_link8" },
+                                  { "pr2", "right_arm", "r_wrist_roll_link" } };
 
-    if (gold_standard_)
+// Model and seeded random samples of all variable positions, loaded once for each test model
+struct RobotStateFixture
+{
+  explicit RobotStateFixture(const TestModel& test_model)
+    : robot_model(moveit::core::loadTestingRobotModel(test_model.robot_name))
+    , group(robot_model->getJointModelGroup(test_model.group_name))
+    , tip_link(robot_model->getLinkModel(test_model.tip_link))
+  {
+    random_numbers::RandomNumberGenerator rng(RANDOM_SEED);
+    moveit::core::RobotState state(robot_model);
+    state.setToDefaultValues();
+    samples.resize(NUM_SAMPLES);
+    for (std::vector<double>& sample : samples)
     {
-      if (*gold_standard_ == 0)
-        *gold_standard_ = elapsed.count();
-      std::cerr << 100 * elapsed.count() / *gold_standard_ << "%";
+      state.setToRandomPositions(group, rng);
+      const double* positions = state.getVariablePositions();
+      sample.assign(positions, positions + robot_model->getVariableCount());
     }
-    std::cerr << '\n';
   }
+
+  moveit::core::RobotModelPtr robot_model;
+  const moveit::core::JointModelGroup* group;
+  const moveit::core::LinkModel* tip_link;
+  std::vector<std::vector<double>> samples;
 };
 
-class Timing : public testing::Test
+const RobotStateFixture& getFixture(const benchmark::State& st)
+{
+  static const RobotStateFixture PANDA(TEST_MODELS[0]);
+  static const RobotStateFixture PR2(TEST_MODELS[1]);
+  return st.range(0) == 0 ? PANDA : PR2;
+}
+
+void setModelLabel(benchmark::State& st)
+{
+  st.SetLabel(TEST_MODELS[st.range(0)].robot_name);
+}
+}  // namespace
+
+// Forward kinematics of the whole robot after changing the positions of one group
+static void robotStateUpdateLinkTransforms(benchmark::State& st)
 {
-protected:
-  void SetUp() override
+  const RobotStateFixture& fixture = getFixture(st);
+  moveit::core::RobotState state(fixture.robot_model);
+  std::size_t i = 0;
+  for (auto _ : st)
   {
-    Eigen::Isometry3d iso = Eigen::Translation3d(1, 2, 3) * Eigen::AngleAxisd(0.13 * M_PI, Eigen::Vector3d::UnitX()) *
-                            Eigen::AngleAxisd(0.29 * M_PI, Eigen::Vector3d::UnitY()) *
-                            Eigen::AngleAxisd(0.42 * M_PI, Eigen::Vector3d::UnitZ());
-    transforms_.push_back(Eigen::Isometry3d::Identity());  // result
-    transforms_.push_back(iso);                            // input
+    state.setVariablePositions(fixture.samples[i++ % NUM_SAMPLES]);
+    state.updateLinkTransforms();
+    benchmark::DoNotOptimize(state.getGlobalLinkTransform(fixture.tip_link));
   }
+  setModelLabel(st);
+}
+BENCHMARK(robotStateUpdateLinkTransforms)->Arg(0)->Arg(1);
 
-  void TearDown() override
+// Full state update including collision body transforms
+static void robotStateUpdate(benchmark::State& st)
+{
+  const RobotStateFixture& fixture = getFixture(st);
+  moveit::core::RobotState state(fixture.robot_model);
+  std::size_t i = 0;
+  for (auto _ : st)
   {
+    state.setVariablePositions(fixture.samples[i++ % NUM_SAMPLES]);
+    state.update();
+    benchmark::ClobberMemory();
   }
+  setModelLabel(st);
+}
+BENCHMARK(robotStateUpdate)->Arg(0)->Arg(1);
 
-public:
-  const Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
-  // put transforms into a vector to avoid compiler optimization on variables
-  EigenSTL::vector_Isometry3d transforms_;
-  volatile size_t result_idx_ = 0;
-  volatile size_t input_idx_ = 1;
-};
+static void robotStateCopy(benchmark::State& st)
+{
+  const RobotStateFixture& fixture = getFixture(st);
+  moveit::core::RobotState state(fixture.robot_model);
+  state.setVariablePositions(fixture.samples[0]);
+  state.update();
+  for (auto _ : st)
+  {
+    moveit::core::RobotState copy(state);
+    benchmark::DoNotOptimize(copy);
+  }
+  setModelLabel(st);
+}
+BENCHMARK(robotStateCopy)->Arg(0)->Arg(1);
 
-TEST_F(Timing, stateUpdate)
+static void robotStateJacobian(benchmark::State& st)
 {
-  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2");
-  ASSERT_TRUE(bool(model));
-  moveit::core::RobotState state(model);
-  ScopedTimer t("RobotState updates: ");
-  for (unsigned i = 0; i < 1e5; ++i)
+  const RobotStateFixture& fixture = getFixture(st);
+  moveit::core::RobotState state(fixture.robot_model);
+  Eigen::MatrixXd jacobian;
+  std::size_t i = 0;
+  for (auto _ : st)
   {
-    state.setToRandomPositions();
-    state.update();
+    st.PauseTiming();
+    state.setVariablePositions(fixture.samples[i++ % NUM_SAMPLES]);
+    state.updateLinkTransforms();
+    st.ResumeTiming();
+    state.getJacobian(fixture.group, fixture.tip_link, Eigen::Vector3d::Zero(), jacobian);
+    benchmark::DoNotOptimize(jacobian.data());
   }
+  setModelLabel(st);
 }
+BENCHMARK(robotStateJacobian)->Arg(0)->Arg(1);
 
-TEST_F(Timing, multiply)
+// Cartesian velocity control step, the Jacobian based IK used by servoing and differential IK tracking
+static void robotStateSetFromDiffIK(benchmark::State& st)
 {
-  size_t runs = 1e7;
-  double gold_standard = 0;
+  const RobotStateFixture& fixture = getFixture(st);
+  moveit::core::RobotState state(fixture.robot_model);
+  Eigen::VectorXd twist(6);
+  twist << 0.01, -0.02, 0.01, 0.05, 0.0, -0.05;
+  std::size_t i = 0;
+  for (auto _ : st)
   {
-    ScopedTimer t("Eigen::Affine * Eigen::Matrix: ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_].affine().noalias() = transforms_[input_idx_].affine() * transforms_[input_idx_].matrix();
+    st.PauseTiming();
+    state.setVariablePositions(fixture.samples[i++ % NUM_SAMPLES]);
+    state.updateLinkTransforms();
+    st.ResumeTiming();
+    benchmark::DoNotOptimize(state.setFromDiffIK(fixture.group, twist, fixture.tip_link->getName(), 0.01));
   }
+  setModelLabel(st);
+}
+BENCHMARK(robotStateSetFromDiffIK)->Arg(0)->Arg(1);
+
+namespace
+{
+// Transforms kept in a vector, indexed through volatile indices, to avoid compiler optimization on variables
+struct TransformFixture
+{
+  TransformFixture()
+  {
+    Eigen::Isometry3d iso = Eigen::Translation3d(1, 2, 3) * Eigen::AngleAxisd(0.13 * M_PI, Eigen::Vector3d::UnitX()) *
+                            Eigen::AngleAxisd(0.29 * M_PI, Eigen::Vector3d::UnitY()) *
+                            Eigen::AngleAxisd(0.42 * M_PI, Eigen::Vector3d::UnitZ());
+    transforms.push_back(Eigen::Isometry3d::Identity());  // result
+    transforms.push_back(iso);                            // input
+    affine.resize(1);
+    affine[0].matrix() = iso.matrix();
+  }
+
+  EigenSTL::vector_Isometry3d transforms;
+  EigenSTL::vector_Affine3d affine;
+  volatile size_t result_idx = 0;
+  volatile size_t input_idx = 1;
+};
+}  // namespace
+
+static void multiplyAffineTimesMatrix(benchmark::State& st)
+{
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Eigen::Matrix * Eigen::Matrix: ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_].matrix().noalias() = transforms_[input_idx_].matrix() * transforms_[input_idx_].matrix();
+    const Eigen::Isometry3d& input = f.transforms[f.input_idx];
+    f.transforms[f.result_idx].affine().noalias() = input.affine() * input.matrix();
+    benchmark::ClobberMemory();
   }
+}
+BENCHMARK(multiplyAffineTimesMatrix);
+
+static void multiplyMatrixTimesMatrix(benchmark::State& st)
+{
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Eigen::Isometry * Eigen::Isometry: ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_] = transforms_[input_idx_] * transforms_[input_idx_];
+    const Eigen::Isometry3d& input = f.transforms[f.input_idx];
+    f.transforms[f.result_idx].matrix().noalias() = input.matrix() * input.matrix();
+    benchmark::ClobberMemory();
   }
 }
+BENCHMARK(multiplyMatrixTimesMatrix);
 
-TEST_F(Timing, inverse)
+static void multiplyIsometryTimesIsometry(benchmark::State& st)
 {
-  EigenSTL::vector_Affine3d affine(1);
-  affine[0].matrix() = transforms_[input_idx_].matrix();
-  size_t runs = 1e7;
-  double gold_standard = 0;
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Isometry3d::inverse(): ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_] = transforms_[input_idx_].inverse();
+    f.transforms[f.result_idx] = f.transforms[f.input_idx] * f.transforms[f.input_idx];
+    benchmark::ClobberMemory();
   }
-  volatile size_t input_idx = 0;
+}
+BENCHMARK(multiplyIsometryTimesIsometry);
+
+static void inverseIsometry3d(benchmark::State& st)
+{
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Affine3d::inverse(Eigen::Isometry): ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_].affine().noalias() = affine[input_idx].inverse(Eigen::Isometry).affine();
+    f.transforms[f.result_idx] = f.transforms[f.input_idx].inverse();
+    benchmark::ClobberMemory();
   }
+}
+BENCHMARK(inverseIsometry3d);
+
+static void inverseAffineIsometry(benchmark::State& st)
+{
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Affine3d::inverse(): ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_].affine().noalias() = affine[input_idx].inverse().affine();
+    f.transforms[f.result_idx].affine().noalias() = f.affine[0].inverse(Eigen::Isometry).affine();
+    benchmark::ClobberMemory();
   }
+}
+BENCHMARK(inverseAffineIsometry);
+
+static void inverseAffine(benchmark::State& st)
+{
+  TransformFixture f;
+  for (auto _ : st)
   {
-    ScopedTimer t("Matrix4d::inverse(): ", &gold_standard);
-    for (size_t i = 0; i < runs; ++i)
-      transforms_[result_idx_].matrix().noalias() = affine[input_idx].matrix().inverse();
+    f.transforms[f.result_idx].affine().noalias() = f.affine[0].inverse().affine();
+    benchmark::ClobberMemory();
   }
 }
+BENCHMARK(inverseAffine);
 
-int main(int argc, char** argv)
+static void inverseMatrix4d(benchmark::State& st)
 {
-  testing::InitGoogleTest(&argc, argv);
-  return RUN_ALL_TESTS();
+  TransformFixture f;
+  for (auto _ : st)
+  {
+    f.transforms[f.result_idx].matrix().noalias() = f.affine[0].matrix().inverse();
+    benchmark::ClobberMemory();
+  }
 }
+BENCHMARK(inverseMatrix4d);
+
+BENCHMARK_MAIN();
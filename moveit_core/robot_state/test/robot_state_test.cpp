@@ -35,7 +35,10 @@
 /* Author: Ioan Sucan */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
+#include <moveit/robot_state/robot_state_position_view.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
 #include <urdf_parser/urdf_parser.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 #include <gtest/gtest.h>
@@ -707,6 +710,277 @@ TEST_F(OneRobot, rigidlyConnectedParent)
   EXPECT_EQ(rigid_parent_of_link_with_slash, rigid_parent_of_object);
 }
 
+TEST_F(OneRobot, lazyAttachedBodyTransforms)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  state.update();
+
+  const Eigen::Isometry3d pose(Eigen::Translation3d(1, 0, 0));
+  const Eigen::Isometry3d shape_pose(Eigen::Translation3d(0, 1, 0));
+  const Eigen::Isometry3d subframe_pose(Eigen::Translation3d(0, 0, 1));
+  state.attachBody(std::make_unique<moveit::core::AttachedBody>(
+      robot_model_->getLinkModel("link_b"), "object", pose,
+      std::vector<shapes::ShapeConstPtr>{ std::make_shared<shapes::Box>(0.1, 0.1, 0.1) },
+      EigenSTL::vector_Isometry3d{ shape_pose }, std::set<std::string>{}, trajectory_msgs::msg::JointTrajectory{},
+      moveit::core::FixedTransformsMap{ { "subframe", subframe_pose } }));
+
+  random_numbers::RandomNumberGenerator rng(42);
+  for (int i = 0; i < 5; ++i)
+  {
+    state.setToRandomPositions(rng);
+    state.update();
+    const moveit::core::AttachedBody* body = state.getAttachedBody("object");
+    ASSERT_TRUE(body);
+
+    // a copy taken before the first access must resolve the outdated transforms on its own
+    const moveit::core::RobotState copy(state);
+    const Eigen::Isometry3d expected_pose = state.getGlobalLinkTransform("link_b") * pose;
+    for (const moveit::core::AttachedBody* b : { copy.getAttachedBody("object"), body })
+    {
+      EXPECT_TRUE(b->getGlobalPose().isApprox(expected_pose));
+      ASSERT_EQ(b->getGlobalCollisionBodyTransforms().size(), 1u);
+      EXPECT_TRUE(b->getGlobalCollisionBodyTransforms()[0].isApprox(expected_pose * shape_pose));
+      bool found = false;
+      EXPECT_TRUE(b->getGlobalSubframeTransform("object/subframe", &found).isApprox(expected_pose * subframe_pose));
+      EXPECT_TRUE(found);
+      EXPECT_TRUE(state.getFrameTransform("object/subframe").isApprox(expected_pose * subframe_pose));
+    }
+  }
+}
+
+TEST(DirtySubtrees, DisjointBranches)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2");
+  ASSERT_TRUE(bool(model));
+  const moveit::core::JointModelGroup* left_arm = model->getJointModelGroup("left_arm");
+  const moveit::core::JointModelGroup* right_arm = model->getJointModelGroup("right_arm");
+  ASSERT_TRUE(left_arm && right_arm);
+
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.update();
+
+  // move both arms, which live in disjoint subtrees of the kinematic tree, then move the head as well
+  state.setToRandomPositions(left_arm);
+  state.setToRandomPositions(right_arm);
+  state.setVariablePosition("head_pan_joint", 0.3);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+
+  // a copy of the state forces a full update, which serves as ground truth
+  moveit::core::RobotState expected(model);
+  expected.setVariablePositions(state.getVariablePositions());
+  expected.update(true);
+
+  moveit::core::RobotState copy(state);
+  state.update();
+  copy.update();
+  EXPECT_FALSE(state.dirty());
+  for (const moveit::core::LinkModel* link : model->getLinkModels())
+  {
+    EXPECT_NEAR_TRACED(state.getGlobalLinkTransform(link).matrix(), expected.getGlobalLinkTransform(link).matrix(),
+                       EPSILON);
+    EXPECT_NEAR_TRACED(copy.getGlobalLinkTransform(link).matrix(), expected.getGlobalLinkTransform(link).matrix(),
+                       EPSILON);
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      EXPECT_NEAR_TRACED(state.getCollisionBodyTransform(link, i).matrix(),
+                         expected.getCollisionBodyTransform(link, i).matrix(), EPSILON);
+  }
+}
+
+TEST(RobotStatePool, RecyclesMemory)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE(bool(model));
+  auto pool = std::make_shared<moveit::core::RobotStatePool>(model, 2);
+  EXPECT_EQ(pool->getAvailableCount(), 2u);
+  EXPECT_EQ(pool->getBlockSize() % moveit::core::RobotStatePool::BLOCK_ALIGNMENT, 0u);
+
+  moveit::core::RobotState reference(model);
+  reference.setToRandomPositions();
+  reference.update();
+  {
+    moveit::core::RobotStatePtr a = pool->createState(reference);
+    EXPECT_EQ(pool->getAvailableCount(), 1u);
+    // copies take their memory from the same pool
+    moveit::core::RobotState b(*a);
+    EXPECT_EQ(b.getMemoryPool(), pool);
+    EXPECT_EQ(pool->getAvailableCount(), 0u);
+    // an exhausted pool falls back to the heap
+    moveit::core::RobotState c(b);
+    EXPECT_EQ(pool->getAvailableCount(), 0u);
+
+    for (const moveit::core::RobotState* state : { a.get(), &b, &c })
+    {
+      EXPECT_EQ(state->distance(reference), 0.0);
+      EXPECT_NEAR_TRACED(state->getGlobalLinkTransform("panda_hand").matrix(),
+                         reference.getGlobalLinkTransform("panda_hand").matrix(), EPSILON);
+    }
+  }
+  EXPECT_EQ(pool->getAvailableCount(), 2u);
+
+  // a pool can only serve states of its own model
+  moveit::core::RobotModelPtr other_model = moveit::core::loadTestingRobotModel("panda");
+  EXPECT_THROW(moveit::core::RobotState(other_model, pool), std::invalid_argument);
+}
+
+TEST(RobotStatePositionView, MatchesRobotState)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2");
+  ASSERT_TRUE(bool(model));
+  random_numbers::RandomNumberGenerator rng(0);
+
+  moveit::core::RobotStatePositionView compact(model);
+  EXPECT_LT(compact.getMemorySize(), moveit::core::RobotState::getMemorySize(*model) / 2);
+
+  moveit::core::RobotState state(model);
+  for (int i = 0; i < 10; ++i)
+  {
+    compact.setToRandomPositions(rng);
+    compact.copyToRobotState(state);
+    state.update();
+    compact.update();
+    for (const moveit::core::LinkModel* link : model->getLinkModels())
+      EXPECT_NEAR_TRACED(compact.getGlobalLinkTransform(link).matrix(), state.getGlobalLinkTransform(link).matrix(),
+                         EPSILON);
+
+    // conversion from an up-to-date full state takes over its transforms
+    moveit::core::RobotStatePositionView converted(state);
+    EXPECT_FALSE(converted.dirty());
+    EXPECT_EQ(converted.distance(compact), 0.0);
+  }
+}
+
+TEST(JacobianDerivative, MatchesFiniteDifferences)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE(bool(model));
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("panda_arm");
+  const moveit::core::LinkModel* tip = model->getLinkModel("panda_link8");
+  const Eigen::Vector3d reference_point(0.0, 0.0, 0.1);
+
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.setToRandomPositions(group);
+
+  Eigen::VectorXd positions, velocities(group->getVariableCount());
+  state.copyJointGroupPositions(group, positions);
+  velocities << 0.1, -0.2, 0.3, -0.4, 0.5, -0.6, 0.7;
+
+  Eigen::MatrixXd jacobian_derivative;
+  ASSERT_TRUE(state.getJacobianDerivative(group, tip, reference_point, velocities, jacobian_derivative));
+
+  // central differences of the Jacobian along the joint velocity direction
+  const double dt = 1e-6;
+  Eigen::MatrixXd jacobian_after, jacobian_before;
+  state.setJointGroupPositions(group, positions + dt * velocities);
+  ASSERT_TRUE(state.getJacobian(group, tip, reference_point, jacobian_after));
+  state.setJointGroupPositions(group, positions - dt * velocities);
+  ASSERT_TRUE(state.getJacobian(group, tip, reference_point, jacobian_before));
+  EXPECT_NEAR_TRACED(jacobian_derivative, (jacobian_after - jacobian_before) / (2 * dt), 1e-6);
+}
+
+TEST(JacobianCache, InvalidatedByStateChanges)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE(bool(model));
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("panda_arm");
+
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  const Eigen::MatrixXd first = state.getJacobian(group);
+  EXPECT_NEAR_TRACED(state.getJacobian(group), first, EPSILON);
+
+  // repeated queries for a different reference point must not return the cached Jacobian
+  const Eigen::MatrixXd offset = state.getJacobian(group, Eigen::Vector3d(0.0, 0.0, 0.5));
+  EXPECT_FALSE(offset.isApprox(first));
+
+  state.setVariablePosition("panda_joint2", 0.5);
+  Eigen::MatrixXd expected;
+  state.update();
+  ASSERT_TRUE(static_cast<const moveit::core::RobotState&>(state).getJacobian(group, group->getLinkModels().back(),
+                                                                              Eigen::Vector3d::Zero(), expected));
+  EXPECT_NEAR_TRACED(state.getJacobian(group), expected, EPSILON);
+  EXPECT_FALSE(expected.isApprox(first));
+}
+
+namespace
+{
+// FK of the chain a -> b of the model built in FKKernel.MatchesGenericFK, counting its invocations
+class CountingFKKernel : public moveit::core::FKKernel
+{
+public:
+  const std::vector<std::string>& getVariableNames() const override
+  {
+    static const std::vector<std::string> NAMES = { "base_link-a-joint", "a-b-joint" };
+    return NAMES;
+  }
+
+  const std::vector<std::string>& getLinkNames() const override
+  {
+    static const std::vector<std::string> NAMES = { "a", "b" };
+    return NAMES;
+  }
+
+  void computeLinkTransforms(const double* values, Eigen::Isometry3d* link_transforms) const override
+  {
+    ++calls;
+    link_transforms[0] = Eigen::AngleAxisd(values[0], Eigen::Vector3d::UnitZ());
+    link_transforms[1] = link_transforms[0] * Eigen::Translation3d(1.0, 0.0, 0.0) *
+                         Eigen::AngleAxisd(values[1], Eigen::Vector3d::UnitZ());
+  }
+
+  void computeJacobian(const double* /*values*/, Eigen::MatrixXd& jacobian) const override
+  {
+    jacobian.setZero(6, 2);
+  }
+
+  mutable unsigned int calls = 0;
+};
+}  // namespace
+
+TEST(FKKernel, MatchesGenericFK)
+{
+  moveit::core::RobotModelBuilder builder("chain", "base_link");
+  geometry_msgs::msg::Pose origin;
+  origin.orientation.w = 1.0;
+  geometry_msgs::msg::Pose offset = origin;
+  offset.position.x = 1.0;
+  builder.addChain("base_link->a->b", "revolute", { origin, offset }, urdf::Vector3(0.0, 0.0, 1.0));
+  builder.addChain("b->c", "fixed", { offset });
+  ASSERT_TRUE(builder.isValid());
+  moveit::core::RobotModelPtr model = builder.build();
+
+  moveit::core::RobotState expected(model);
+  expected.setToDefaultValues();
+  expected.setVariablePosition("base_link-a-joint", 0.3);
+  expected.setVariablePosition("a-b-joint", -0.7);
+  expected.update();
+
+  auto kernel = std::make_shared<CountingFKKernel>();
+  ASSERT_TRUE(model->setFKKernel(kernel));
+  EXPECT_FALSE(model->setFKKernel(kernel));  // links are already covered
+
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.setVariablePosition("base_link-a-joint", 0.3);
+  state.setVariablePosition("a-b-joint", -0.7);
+  state.update();
+  EXPECT_EQ(kernel->calls, 1u);
+  for (const char* link : { "a", "b", "c" })
+    EXPECT_NEAR_TRACED(state.getGlobalLinkTransform(link).matrix(), expected.getGlobalLinkTransform(link).matrix(),
+                       EPSILON);
+
+  // an update starting inside the kernel's chain uses the generic computation
+  state.setVariablePosition("a-b-joint", 0.2);
+  expected.setVariablePosition("a-b-joint", 0.2);
+  state.update();
+  expected.update();
+  EXPECT_EQ(kernel->calls, 1u);
+  EXPECT_NEAR_TRACED(state.getGlobalLinkTransform("c").matrix(), expected.getGlobalLinkTransform("c").matrix(),
+                     EPSILON);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
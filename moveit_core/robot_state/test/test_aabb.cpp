@@ -371,6 +371,18 @@ TEST_F(TestAABB, TestComplex)
   EXPECT_NEAR(complex_aabb[3], 5.05, 1e-4);
   EXPECT_NEAR(complex_aabb[4], -1.05, 1e-4);
   EXPECT_NEAR(complex_aabb[5], 2.05, 1e-4);
+
+  // the base group only contains base_footprint
+  std::vector<double> group_aabb;
+  complex_state.computeAABB(complex_state.getJointModelGroup("base"), group_aabb);
+
+  ASSERT_EQ(group_aabb.size(), 6u);
+  EXPECT_NEAR(group_aabb[0], -5.05, 1e-4);
+  EXPECT_NEAR(group_aabb[1], -4.95, 1e-4);
+  EXPECT_NEAR(group_aabb[2], -0.5, 1e-4);
+  EXPECT_NEAR(group_aabb[3], 0.5, 1e-4);
+  EXPECT_NEAR(group_aabb[4], -1.05, 1e-4);
+  EXPECT_NEAR(group_aabb[5], -0.95, 1e-4);
 }
 
 int main(int argc, char** argv)
@@ -0,0 +1,136 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_batch.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+constexpr double EPSILON{ 1.e-9 };
+constexpr std::size_t BATCH_SIZE{ 37 };  // deliberately not a multiple of the SIMD width
+}  // namespace
+
+class RobotStateBatchTest : public testing::TestWithParam<std::string>
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel(GetParam());
+    ASSERT_TRUE(bool(robot_model_));
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_P(RobotStateBatchTest, MatchesRobotStateFK)
+{
+  random_numbers::RandomNumberGenerator rng(42);
+  moveit::core::RobotStateBatch batch(robot_model_, BATCH_SIZE);
+  batch.setToRandomPositions(rng);
+  batch.update();
+
+  moveit::core::RobotState state(robot_model_);
+  for (std::size_t i = 0; i < batch.size(); ++i)
+  {
+    batch.copyToRobotState(i, state);
+    state.update();
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    {
+      const Eigen::Isometry3d expected = state.getGlobalLinkTransform(link);
+      const Eigen::Isometry3d actual = batch.getGlobalLinkTransform(i, link);
+      EXPECT_TRUE(expected.isApprox(actual, EPSILON)) << "link " << link->getName() << ", entry " << i;
+      EXPECT_TRUE(actual.translation().isApprox(batch.getGlobalLinkOrigins(link).row(i).transpose().matrix(), EPSILON));
+    }
+  }
+}
+
+TEST_P(RobotStateBatchTest, JointGroupPositions)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroups().front();
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  moveit::core::RobotStateBatch batch(robot_model_, 2);
+  batch.setToDefaultValues();
+
+  std::vector<double> values(group->getVariableCount());
+  state.setToRandomPositions(group);
+  state.copyJointGroupPositions(group, values);
+  batch.setJointGroupPositions(1, group, values);
+
+  std::vector<double> copied(group->getVariableCount());
+  batch.copyJointGroupPositions(1, group, copied.data());
+  EXPECT_EQ(values, copied);
+  EXPECT_TRUE(batch.dirty());
+
+  for (std::size_t i = 0; i < robot_model_->getVariableCount(); ++i)
+    EXPECT_NEAR(batch.getVariablePosition(1, i), state.getVariablePosition(i), EPSILON);
+}
+
+TEST_P(RobotStateBatchTest, Interpolation)
+{
+  moveit::core::RobotState from(robot_model_), to(robot_model_), expected(robot_model_);
+  from.setToRandomPositions();
+  to.setToRandomPositions();
+
+  std::vector<double> fractions(BATCH_SIZE);
+  for (std::size_t i = 0; i < fractions.size(); ++i)
+    fractions[i] = static_cast<double>(i) / (fractions.size() - 1);
+
+  moveit::core::RobotStateBatch batch(robot_model_);
+  batch.interpolate(from, to, fractions);
+  ASSERT_EQ(batch.size(), fractions.size());
+
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  std::vector<double> buffer(fractions.size() * variable_count);
+  from.interpolate(to, fractions, buffer.data());
+
+  for (std::size_t i = 0; i < fractions.size(); ++i)
+  {
+    from.interpolate(to, fractions[i], expected);
+    for (std::size_t v = 0; v < variable_count; ++v)
+    {
+      EXPECT_NEAR(batch.getVariablePosition(i, v), expected.getVariablePosition(v), EPSILON) << "entry " << i;
+      EXPECT_NEAR(buffer[i * variable_count + v], expected.getVariablePosition(v), EPSILON) << "entry " << i;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(RobotModels, RobotStateBatchTest, testing::Values("pr2", "panda"));
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,184 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <Eigen/Core>
+#include <vector>
+
+namespace robot_trajectory
+{
+MOVEIT_CLASS_FORWARD(DenseRobotTrajectory);  // Defines DenseRobotTrajectoryPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A trajectory of a joint model group stored in contiguous matrices
+
+    In contrast to RobotTrajectory, waypoints are not separate RobotStates. The positions, velocities and
+    accelerations of the group variables are columns of column-major matrices, one column per waypoint, next to a
+    vector of the durations from the previous waypoint. All variables outside the group are taken from a single
+    reference state. RobotStates are only materialized on demand by getWayPoint(), so passes over long trajectories
+    stream through memory instead of chasing one heap-allocated state per waypoint. */
+class DenseRobotTrajectory
+{
+public:
+  /** @brief Construct an empty trajectory for \e group, with the variables outside of it set as in
+      \e reference_state */
+  DenseRobotTrajectory(const moveit::core::JointModelGroup* group, const moveit::core::RobotState& reference_state);
+
+  /** @brief Copy the waypoints of \e trajectory, whose group must be set. The first waypoint is the reference state.
+      Velocities and accelerations are stored if the first waypoint has them. */
+  explicit DenseRobotTrajectory(const RobotTrajectory& trajectory);
+
+  const moveit::core::RobotModelConstPtr& getRobotModel() const
+  {
+    return reference_state_.getRobotModel();
+  }
+
+  const moveit::core::JointModelGroup* getGroup() const
+  {
+    return group_;
+  }
+
+  const moveit::core::RobotState& getReferenceState() const
+  {
+    return reference_state_;
+  }
+
+  std::size_t getWayPointCount() const
+  {
+    return static_cast<std::size_t>(durations_from_previous_.size());
+  }
+
+  bool empty() const
+  {
+    return getWayPointCount() == 0;
+  }
+
+  /** @brief Change the number of waypoints. New waypoints are zero, existing ones are kept. */
+  void resize(std::size_t count);
+
+  /** @brief Append a waypoint. \e velocities and \e accelerations may be empty if the trajectory has none. */
+  void addSuffixWayPoint(const Eigen::Ref<const Eigen::VectorXd>& positions,
+                         const Eigen::Ref<const Eigen::VectorXd>& velocities,
+                         const Eigen::Ref<const Eigen::VectorXd>& accelerations, double dt);
+
+  /** @brief Append the group variables of \e state as a waypoint */
+  void addSuffixWayPoint(const moveit::core::RobotState& state, double dt);
+
+  /** @brief The group variable positions, one column per waypoint */
+  Eigen::MatrixXd& getPositions()
+  {
+    return positions_;
+  }
+  const Eigen::MatrixXd& getPositions() const
+  {
+    return positions_;
+  }
+
+  /** @brief The group variable velocities, one column per waypoint, or an empty matrix if there are none */
+  Eigen::MatrixXd& getVelocities()
+  {
+    return velocities_;
+  }
+  const Eigen::MatrixXd& getVelocities() const
+  {
+    return velocities_;
+  }
+
+  /** @brief The group variable accelerations, one column per waypoint, or an empty matrix if there are none */
+  Eigen::MatrixXd& getAccelerations()
+  {
+    return accelerations_;
+  }
+  const Eigen::MatrixXd& getAccelerations() const
+  {
+    return accelerations_;
+  }
+
+  bool hasVelocities() const
+  {
+    return velocities_.cols() > 0;
+  }
+
+  bool hasAccelerations() const
+  {
+    return accelerations_.cols() > 0;
+  }
+
+  /** @brief Allocate zero velocities and accelerations for all waypoints, if there are none yet */
+  void enableVelocitiesAndAccelerations();
+
+  /** @brief Drop the velocities and accelerations of all waypoints */
+  void clearVelocitiesAndAccelerations();
+
+  Eigen::VectorXd& getWayPointDurations()
+  {
+    return durations_from_previous_;
+  }
+  const Eigen::VectorXd& getWayPointDurations() const
+  {
+    return durations_from_previous_;
+  }
+
+  double getDuration() const
+  {
+    return durations_from_previous_.sum();
+  }
+
+  /** @brief Materialize waypoint \e index: the reference state with the group variables of the waypoint */
+  void getWayPoint(std::size_t index, moveit::core::RobotState& state) const;
+
+  /** @brief Materialize all waypoints into \e trajectory, which is cleared first */
+  void getRobotTrajectory(RobotTrajectory& trajectory) const;
+
+  /** @brief Convert to a message, as RobotTrajectory::getRobotTrajectoryMsg() does for the active joints of the group.
+      Groups with multi-DOF joints are materialized through a RobotTrajectory. */
+  void getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& trajectory) const;
+
+  /** @brief Resample the positions at \e durations (from start, sorted increasingly) into \e output
+      by interpolating between the surrounding waypoints. Velocities and accelerations are interpolated linearly. */
+  void resample(const std::vector<double>& durations, DenseRobotTrajectory& output) const;
+
+private:
+  const moveit::core::JointModelGroup* group_;
+  moveit::core::RobotState reference_state_;
+  Eigen::MatrixXd positions_;
+  Eigen::MatrixXd velocities_;
+  Eigen::MatrixXd accelerations_;
+  Eigen::VectorXd durations_from_previous_;
+};
+}  // namespace robot_trajectory
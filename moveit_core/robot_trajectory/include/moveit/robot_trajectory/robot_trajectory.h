@@ -38,6 +38,7 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_batch.h>
 #include <moveit_msgs/msg/robot_trajectory.hpp>
 #include <moveit_msgs/msg/robot_state.hpp>
 #include <deque>
@@ -115,6 +116,9 @@ public:
     return waypoints_.size();
   }
 
+  /** \brief Estimate the number of bytes held by the waypoints and durations, see RobotState::getMemoryUsage() */
+  std::size_t getMemoryUsage() const;
+
   const moveit::core::RobotState& getWayPoint(std::size_t index) const
   {
     return *waypoints_[index];
@@ -308,6 +312,16 @@ public:
    */
   bool getStateAtDurationFromStart(const double request_duration, moveit::core::RobotStatePtr& output_state) const;
 
+  /** @brief Gets the robot states corresponding to several durations from start, using linear time interpolation.
+   *  Consecutive durations that fall between the same pair of waypoints are interpolated in a single batch call,
+   *  so resampling with sorted durations avoids per-sample allocations and waypoint searches.
+   *  @param The durations from start.
+   *  @param The resulting states; the batch is resized to the number of durations.
+   *  @return True if the states are valid, false otherwise (trajectory is empty).
+   */
+  bool getStatesAtDurationsFromStart(const std::vector<double>& request_durations,
+                                     moveit::core::RobotStateBatch& output_states) const;
+
   class Iterator
   {
     std::deque<moveit::core::RobotStatePtr>::iterator waypoint_iterator_;
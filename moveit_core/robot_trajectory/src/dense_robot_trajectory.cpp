@@ -0,0 +1,235 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_trajectory/dense_robot_trajectory.h>
+#include <rclcpp/duration.hpp>
+#include <rclcpp/time.hpp>
+#include <algorithm>
+
+namespace robot_trajectory
+{
+DenseRobotTrajectory::DenseRobotTrajectory(const moveit::core::JointModelGroup* group,
+                                           const moveit::core::RobotState& reference_state)
+  : group_(group), reference_state_(reference_state), positions_(group->getVariableCount(), 0)
+{
+}
+
+DenseRobotTrajectory::DenseRobotTrajectory(const RobotTrajectory& trajectory)
+  : DenseRobotTrajectory(trajectory.getGroup(),
+                         trajectory.empty() ? moveit::core::RobotState(trajectory.getRobotModel()) :
+                                              trajectory.getFirstWayPoint())
+{
+  const std::size_t count = trajectory.getWayPointCount();
+  resize(count);
+  if (count > 0 && trajectory.getFirstWayPoint().hasVelocities())
+    enableVelocitiesAndAccelerations();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+    waypoint.copyJointGroupPositions(group_, positions_.col(i).data());
+    if (hasVelocities() && waypoint.hasVelocities())
+      waypoint.copyJointGroupVelocities(group_, velocities_.col(i).data());
+    if (hasAccelerations() && waypoint.hasAccelerations())
+      waypoint.copyJointGroupAccelerations(group_, accelerations_.col(i).data());
+    durations_from_previous_[i] = trajectory.getWayPointDurationFromPrevious(i);
+  }
+}
+
+void DenseRobotTrajectory::resize(std::size_t count)
+{
+  const Eigen::Index old_count = durations_from_previous_.size();
+  const Eigen::Index new_count = static_cast<Eigen::Index>(count);
+  const auto resize_matrix = [&](Eigen::MatrixXd& matrix) {
+    matrix.conservativeResize(Eigen::NoChange, new_count);
+    if (new_count > old_count)
+      matrix.rightCols(new_count - old_count).setZero();
+  };
+  resize_matrix(positions_);
+  if (hasVelocities())
+    resize_matrix(velocities_);
+  if (hasAccelerations())
+    resize_matrix(accelerations_);
+  durations_from_previous_.conservativeResize(new_count);
+  if (new_count > old_count)
+    durations_from_previous_.tail(new_count - old_count).setZero();
+}
+
+void DenseRobotTrajectory::enableVelocitiesAndAccelerations()
+{
+  if (!hasVelocities())
+    velocities_ = Eigen::MatrixXd::Zero(positions_.rows(), positions_.cols());
+  if (!hasAccelerations())
+    accelerations_ = Eigen::MatrixXd::Zero(positions_.rows(), positions_.cols());
+}
+
+void DenseRobotTrajectory::clearVelocitiesAndAccelerations()
+{
+  velocities_.resize(positions_.rows(), 0);
+  accelerations_.resize(positions_.rows(), 0);
+}
+
+void DenseRobotTrajectory::addSuffixWayPoint(const Eigen::Ref<const Eigen::VectorXd>& positions,
+                                             const Eigen::Ref<const Eigen::VectorXd>& velocities,
+                                             const Eigen::Ref<const Eigen::VectorXd>& accelerations, double dt)
+{
+  const std::size_t index = getWayPointCount();
+  resize(index + 1);
+  positions_.col(index) = positions;
+  if (velocities.size() > 0 || accelerations.size() > 0)
+    enableVelocitiesAndAccelerations();
+  if (velocities.size() > 0)
+    velocities_.col(index) = velocities;
+  if (accelerations.size() > 0)
+    accelerations_.col(index) = accelerations;
+  durations_from_previous_[index] = dt;
+}
+
+void DenseRobotTrajectory::addSuffixWayPoint(const moveit::core::RobotState& state, double dt)
+{
+  const std::size_t index = getWayPointCount();
+  resize(index + 1);
+  state.copyJointGroupPositions(group_, positions_.col(index).data());
+  if (state.hasVelocities() || state.hasAccelerations())
+    enableVelocitiesAndAccelerations();
+  if (state.hasVelocities())
+    state.copyJointGroupVelocities(group_, velocities_.col(index).data());
+  if (state.hasAccelerations())
+    state.copyJointGroupAccelerations(group_, accelerations_.col(index).data());
+  durations_from_previous_[index] = dt;
+}
+
+void DenseRobotTrajectory::getWayPoint(std::size_t index, moveit::core::RobotState& state) const
+{
+  state = reference_state_;
+  state.setJointGroupPositions(group_, positions_.col(index).data());
+  if (hasVelocities())
+    state.setJointGroupVelocities(group_, velocities_.col(index).data());
+  if (hasAccelerations())
+    state.setJointGroupAccelerations(group_, accelerations_.col(index).data());
+}
+
+void DenseRobotTrajectory::getRobotTrajectory(RobotTrajectory& trajectory) const
+{
+  trajectory.clear();
+  trajectory.setGroupName(group_->getName());
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+  {
+    auto waypoint = std::make_shared<moveit::core::RobotState>(reference_state_);
+    getWayPoint(i, *waypoint);
+    trajectory.addSuffixWayPoint(waypoint, durations_from_previous_[i]);
+  }
+}
+
+void DenseRobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& trajectory) const
+{
+  trajectory = moveit_msgs::msg::RobotTrajectory();
+  if (empty())
+    return;
+
+  std::vector<Eigen::Index> rows;
+  for (const moveit::core::JointModel* joint : group_->getActiveJointModels())
+  {
+    if (joint->getVariableCount() != 1)
+    {
+      RobotTrajectory materialized(getRobotModel(), group_);
+      getRobotTrajectory(materialized);
+      materialized.getRobotTrajectoryMsg(trajectory);
+      return;
+    }
+    trajectory.joint_trajectory.joint_names.push_back(joint->getName());
+    rows.push_back(group_->getVariableGroupIndex(joint->getName()));
+  }
+  if (rows.empty())
+    return;
+
+  trajectory.joint_trajectory.header.frame_id = getRobotModel()->getModelFrame();
+  trajectory.joint_trajectory.header.stamp = rclcpp::Time(0, 0, RCL_ROS_TIME);
+  trajectory.joint_trajectory.points.resize(getWayPointCount());
+  double total_time = 0.0;
+  const auto copy_rows = [&rows](const Eigen::MatrixXd& matrix, Eigen::Index col, std::vector<double>& values) {
+    values.resize(rows.size());
+    for (std::size_t j = 0; j < rows.size(); ++j)
+      values[j] = matrix(rows[j], col);
+  };
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+  {
+    trajectory_msgs::msg::JointTrajectoryPoint& point = trajectory.joint_trajectory.points[i];
+    copy_rows(positions_, i, point.positions);
+    if (hasVelocities())
+      copy_rows(velocities_, i, point.velocities);
+    if (hasAccelerations())
+      copy_rows(accelerations_, i, point.accelerations);
+    total_time += durations_from_previous_[i];
+    point.time_from_start = rclcpp::Duration::from_seconds(total_time);
+  }
+}
+
+void DenseRobotTrajectory::resample(const std::vector<double>& durations, DenseRobotTrajectory& output) const
+{
+  output = DenseRobotTrajectory(group_, reference_state_);
+  if (empty())
+    return;
+  output.resize(durations.size());
+  if (hasVelocities() || hasAccelerations())
+    output.enableVelocitiesAndAccelerations();
+
+  // the waypoints are walked once, as the durations are sorted
+  const std::size_t last = getWayPointCount() - 1;
+  std::size_t after = 0;
+  double after_time = durations_from_previous_[0];
+  double previous_duration = 0.0;
+  for (std::size_t k = 0; k < durations.size(); ++k)
+  {
+    const double duration = durations[k];
+    while (after < last && after_time < duration)
+      after_time += durations_from_previous_[++after];
+
+    const std::size_t before = (after == 0 || after_time <= duration) ? after : after - 1;
+    const double before_time = before == after ? after_time : after_time - durations_from_previous_[after];
+    const double blend = (before == after || after_time <= before_time) ?
+                             0.0 :
+                             std::clamp((duration - before_time) / (after_time - before_time), 0.0, 1.0);
+
+    group_->interpolate(positions_.col(before).data(), positions_.col(after).data(), blend,
+                        output.positions_.col(k).data());
+    if (hasVelocities())
+      output.velocities_.col(k) = (1.0 - blend) * velocities_.col(before) + blend * velocities_.col(after);
+    if (hasAccelerations())
+      output.accelerations_.col(k) = (1.0 - blend) * accelerations_.col(before) + blend * accelerations_.col(after);
+    output.durations_from_previous_[k] = duration - previous_duration;
+    previous_duration = duration;
+  }
+}
+}  // namespace robot_trajectory
@@ -47,6 +47,43 @@
 
 namespace robot_trajectory
 {
+namespace
+{
+// Resolve the variable indices of the joint names once, instead of for every waypoint
+std::vector<int> getVariableIndices(const moveit::core::RobotModel& robot_model, const std::vector<std::string>& names)
+{
+  std::vector<int> indices;
+  indices.reserve(names.size());
+  for (const std::string& name : names)
+    indices.push_back(robot_model.getVariableIndex(name));
+  return indices;
+}
+
+// Copy the variables at indices into a message array
+void copyVariables(const double* values, const std::vector<int>& indices, std::vector<double>& msg_values)
+{
+  msg_values.resize(indices.size());
+  for (std::size_t j = 0; j < indices.size(); ++j)
+    msg_values[j] = values[indices[j]];
+}
+
+void setJointTrajectoryPoint(moveit::core::RobotState& state, const std::vector<int>& indices,
+                             const trajectory_msgs::msg::JointTrajectoryPoint& point)
+{
+  for (std::size_t j = 0; j < indices.size(); ++j)
+    state.setVariablePosition(indices[j], point.positions[j]);
+  if (!point.velocities.empty())
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableVelocity(indices[j], point.velocities[j]);
+  if (!point.accelerations.empty())
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableAcceleration(indices[j], point.accelerations[j]);
+  if (!point.effort.empty())
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableEffort(indices[j], point.effort[j]);
+}
+}  // namespace
+
 RobotTrajectory::RobotTrajectory(const moveit::core::RobotModelConstPtr& robot_model)
   : robot_model_(robot_model), group_(nullptr)
 {
@@ -84,6 +121,14 @@ const std::string& RobotTrajectory::getGroupName() const
   return EMPTY;
 }
 
+std::size_t RobotTrajectory::getMemoryUsage() const
+{
+  std::size_t bytes = sizeof(RobotTrajectory) + duration_from_previous_.size() * sizeof(double);
+  for (const moveit::core::RobotStatePtr& waypoint : waypoints_)
+    bytes += sizeof(moveit::core::RobotStatePtr) + waypoint->getMemoryUsage();
+  return bytes;
+}
+
 double RobotTrajectory::getDuration() const
 {
   return std::accumulate(duration_from_previous_.begin(), duration_from_previous_.end(), 0.0);
@@ -249,7 +294,7 @@ void RobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& t
   const std::vector<const moveit::core::JointModel*>& jnts =
       group_ ? group_->getActiveJointModels() : robot_model_->getActiveJointModels();
 
-  std::vector<const moveit::core::JointModel*> onedof;
+  std::vector<int> onedof;
   std::vector<const moveit::core::JointModel*> mdof;
   trajectory.joint_trajectory.joint_names.clear();
   trajectory.multi_dof_joint_trajectory.joint_names.clear();
@@ -264,7 +309,7 @@ void RobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& t
     if (active_joint->getVariableCount() == 1)
     {
       trajectory.joint_trajectory.joint_names.push_back(active_joint->getName());
-      onedof.push_back(active_joint);
+      onedof.push_back(active_joint->getFirstVariableIndex());
     }
     else
     {
@@ -296,38 +341,21 @@ void RobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& t
 
     if (!onedof.empty())
     {
-      trajectory.joint_trajectory.points[i].positions.resize(onedof.size());
-      trajectory.joint_trajectory.points[i].velocities.reserve(onedof.size());
-
-      for (std::size_t j = 0; j < onedof.size(); ++j)
-      {
-        trajectory.joint_trajectory.points[i].positions[j] =
-            waypoints_[i]->getVariablePosition(onedof[j]->getFirstVariableIndex());
-        // if we have velocities/accelerations/effort, copy those too
-        if (waypoints_[i]->hasVelocities())
-          trajectory.joint_trajectory.points[i].velocities.push_back(
-              waypoints_[i]->getVariableVelocity(onedof[j]->getFirstVariableIndex()));
-        if (waypoints_[i]->hasAccelerations())
-          trajectory.joint_trajectory.points[i].accelerations.push_back(
-              waypoints_[i]->getVariableAcceleration(onedof[j]->getFirstVariableIndex()));
-        if (waypoints_[i]->hasEffort())
-          trajectory.joint_trajectory.points[i].effort.push_back(
-              waypoints_[i]->getVariableEffort(onedof[j]->getFirstVariableIndex()));
-      }
-      // clear velocities if we have an incomplete specification
-      if (trajectory.joint_trajectory.points[i].velocities.size() != onedof.size())
-        trajectory.joint_trajectory.points[i].velocities.clear();
-      // clear accelerations if we have an incomplete specification
-      if (trajectory.joint_trajectory.points[i].accelerations.size() != onedof.size())
-        trajectory.joint_trajectory.points[i].accelerations.clear();
-      // clear effort if we have an incomplete specification
-      if (trajectory.joint_trajectory.points[i].effort.size() != onedof.size())
-        trajectory.joint_trajectory.points[i].effort.clear();
+      const moveit::core::RobotState& waypoint = *waypoints_[i];
+      trajectory_msgs::msg::JointTrajectoryPoint& point = trajectory.joint_trajectory.points[i];
+      copyVariables(waypoint.getVariablePositions(), onedof, point.positions);
+      // if we have velocities/accelerations/effort, copy those too
+      if (waypoint.hasVelocities())
+        copyVariables(waypoint.getVariableVelocities(), onedof, point.velocities);
+      if (waypoint.hasAccelerations())
+        copyVariables(waypoint.getVariableAccelerations(), onedof, point.accelerations);
+      if (waypoint.hasEffort())
+        copyVariables(waypoint.getVariableEffort(), onedof, point.effort);
 
       if (duration_from_previous_.size() > i)
-        trajectory.joint_trajectory.points[i].time_from_start = rclcpp::Duration::from_seconds(total_time);
+        point.time_from_start = rclcpp::Duration::from_seconds(total_time);
       else
-        trajectory.joint_trajectory.points[i].time_from_start = ZERO_DURATION;
+        point.time_from_start = ZERO_DURATION;
     }
     if (!mdof.empty())
     {
@@ -383,18 +411,13 @@ RobotTrajectory& RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::Robo
   std::size_t state_count = trajectory.points.size();
   rclcpp::Time last_time_stamp = trajectory.header.stamp;
   rclcpp::Time this_time_stamp = last_time_stamp;
+  const std::vector<int> indices = getVariableIndices(*robot_model_, trajectory.joint_names);
 
   for (std::size_t i = 0; i < state_count; ++i)
   {
     this_time_stamp = rclcpp::Time(trajectory.header.stamp) + trajectory.points[i].time_from_start;
     auto st = std::make_shared<moveit::core::RobotState>(copy);
-    st->setVariablePositions(trajectory.joint_names, trajectory.points[i].positions);
-    if (!trajectory.points[i].velocities.empty())
-      st->setVariableVelocities(trajectory.joint_names, trajectory.points[i].velocities);
-    if (!trajectory.points[i].accelerations.empty())
-      st->setVariableAccelerations(trajectory.joint_names, trajectory.points[i].accelerations);
-    if (!trajectory.points[i].effort.empty())
-      st->setVariableEffort(trajectory.joint_names, trajectory.points[i].effort);
+    setJointTrajectoryPoint(*st, indices, trajectory.points[i]);
     addSuffixWayPoint(st, (this_time_stamp - last_time_stamp).seconds());
     last_time_stamp = this_time_stamp;
   }
@@ -415,21 +438,14 @@ RobotTrajectory& RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::Robo
                                      trajectory.multi_dof_joint_trajectory.header.stamp :
                                      trajectory.joint_trajectory.header.stamp;
   rclcpp::Time this_time_stamp = last_time_stamp;
+  const std::vector<int> indices = getVariableIndices(*robot_model_, trajectory.joint_trajectory.joint_names);
 
   for (std::size_t i = 0; i < state_count; ++i)
   {
     auto st = std::make_shared<moveit::core::RobotState>(copy);
     if (trajectory.joint_trajectory.points.size() > i)
     {
-      st->setVariablePositions(trajectory.joint_trajectory.joint_names, trajectory.joint_trajectory.points[i].positions);
-      if (!trajectory.joint_trajectory.points[i].velocities.empty())
-        st->setVariableVelocities(trajectory.joint_trajectory.joint_names,
-                                  trajectory.joint_trajectory.points[i].velocities);
-      if (!trajectory.joint_trajectory.points[i].accelerations.empty())
-        st->setVariableAccelerations(trajectory.joint_trajectory.joint_names,
-                                     trajectory.joint_trajectory.points[i].accelerations);
-      if (!trajectory.joint_trajectory.points[i].effort.empty())
-        st->setVariableEffort(trajectory.joint_trajectory.joint_names, trajectory.joint_trajectory.points[i].effort);
+      setJointTrajectoryPoint(*st, indices, trajectory.joint_trajectory.points[i]);
       this_time_stamp = rclcpp::Time(trajectory.joint_trajectory.header.stamp) +
                         trajectory.joint_trajectory.points[i].time_from_start;
     }
@@ -524,6 +540,63 @@ bool RobotTrajectory::getStateAtDurationFromStart(const double request_duration,
   return true;
 }
 
+bool RobotTrajectory::getStatesAtDurationsFromStart(const std::vector<double>& request_durations,
+                                                    moveit::core::RobotStateBatch& output_states) const
+{
+  // If there are no waypoints we can't do anything
+  if (getWayPointCount() == 0)
+    return false;
+
+  // times from start of all waypoints, to find the waypoints around each duration by binary search
+  std::vector<double> durations_from_start(duration_from_previous_.begin(), duration_from_previous_.end());
+  std::partial_sum(durations_from_start.begin(), durations_from_start.end(), durations_from_start.begin());
+
+  output_states.resize(request_durations.size());
+  std::vector<double> blends;
+  std::size_t first = 0;
+  int run_before = -1, run_after = -1;
+  for (std::size_t i = 0; i <= request_durations.size(); ++i)
+  {
+    // same semantics as findWayPointIndicesForDurationAfterStart()
+    int before = -1, after = -1;
+    double blend = 1.0;
+    if (i < request_durations.size())
+    {
+      const double duration = request_durations[i];
+      const std::size_t index =
+          std::lower_bound(durations_from_start.begin(), durations_from_start.end(), duration) -
+          durations_from_start.begin();
+      if (duration < 0.0)
+      {
+        before = after = 0;
+        blend = 0.0;
+      }
+      else if (index >= durations_from_start.size())
+        before = after = durations_from_start.size() - 1;
+      else
+      {
+        before = std::max<int>(index - 1, 0);
+        after = index;
+        if (after != before)
+          blend = (duration - durations_from_start[before]) / duration_from_previous_[index];
+      }
+    }
+
+    // interpolate the run of durations between the same waypoints at once
+    if ((before != run_before || after != run_after) && !blends.empty())
+    {
+      output_states.interpolate(*waypoints_[run_before], *waypoints_[run_after], blends.data(), blends.size(), first);
+      first = i;
+      blends.clear();
+    }
+    run_before = before;
+    run_after = after;
+    if (i < request_durations.size())
+      blends.push_back(blend);
+  }
+  return true;
+}
+
 void RobotTrajectory::print(std::ostream& out, std::vector<int> variable_indexes) const
 {
   size_t num_points = getWayPointCount();
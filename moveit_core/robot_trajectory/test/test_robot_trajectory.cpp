@@ -36,6 +36,7 @@
 
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/dense_robot_trajectory.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <gtest/gtest.h>
@@ -203,6 +204,26 @@ TEST_F(RobotTrajectoryTestFixture, ChainEdits)
   EXPECT_EQ(trajectory.getWayPointCount(), initial_trajectory->getWayPointCount() * 2 + 3);
 }
 
+TEST_F(RobotTrajectoryTestFixture, MsgRoundTrip)
+{
+  robot_trajectory::RobotTrajectoryPtr initial_trajectory;
+  initTestTrajectory(initial_trajectory);
+  initial_trajectory->getWayPointPtr(2)->setVariablePosition(/*index*/ 1, /*value*/ 0.3);
+  initial_trajectory->getWayPointPtr(3)->setVariableVelocity(/*index*/ 0, /*value*/ 0.2);
+  moveit_msgs::msg::RobotTrajectory initial_trajectory_msg;
+  initial_trajectory->getRobotTrajectoryMsg(initial_trajectory_msg);
+  ASSERT_EQ(initial_trajectory_msg.joint_trajectory.points.size(), initial_trajectory->getWayPointCount());
+  EXPECT_FALSE(initial_trajectory_msg.joint_trajectory.points[0].velocities.empty());
+  EXPECT_FALSE(initial_trajectory_msg.joint_trajectory.points[0].accelerations.empty());
+
+  robot_trajectory::RobotTrajectory trajectory(robot_model_, arm_jmg_name_);
+  trajectory.setRobotTrajectoryMsg(*robot_state_, initial_trajectory_msg);
+
+  moveit_msgs::msg::RobotTrajectory trajectory_msg;
+  trajectory.getRobotTrajectoryMsg(trajectory_msg);
+  EXPECT_EQ(initial_trajectory_msg, trajectory_msg);
+}
+
 TEST_F(RobotTrajectoryTestFixture, Append)
 {
   robot_trajectory::RobotTrajectoryPtr initial_trajectory;
@@ -393,6 +414,85 @@ TEST_F(RobotTrajectoryTestFixture, RobotTrajectoryDensity)
   EXPECT_FALSE(density.has_value());
 }
 
+TEST_F(RobotTrajectoryTestFixture, RobotTrajectoryBatchResampling)
+{
+  auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, arm_jmg_name_);
+  random_numbers::RandomNumberGenerator rng(3);
+  moveit::core::RobotState state(*robot_state_);
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    state.setToRandomPositions(robot_model_->getJointModelGroup(arm_jmg_name_), rng);
+    trajectory->addSuffixWayPoint(state, 0.1 * (i + 1));
+  }
+
+  // includes durations before the start of the trajectory
+  std::vector<double> durations;
+  for (double t = -0.1; t < trajectory->getDuration(); t += 0.03)
+    durations.push_back(t);
+
+  moveit::core::RobotStateBatch batch(robot_model_);
+  ASSERT_TRUE(trajectory->getStatesAtDurationsFromStart(durations, batch));
+  ASSERT_EQ(batch.size(), durations.size());
+
+  auto expected = std::make_shared<moveit::core::RobotState>(robot_model_);
+  for (std::size_t i = 0; i < durations.size(); ++i)
+  {
+    ASSERT_TRUE(trajectory->getStateAtDurationFromStart(durations[i], expected));
+    for (std::size_t v = 0; v < robot_model_->getVariableCount(); ++v)
+      EXPECT_NEAR(batch.getVariablePosition(i, v), expected->getVariablePosition(v), 1e-9) << "duration " << durations[i];
+  }
+}
+
+TEST_F(RobotTrajectoryTestFixture, DenseRobotTrajectory)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  initTestTrajectory(trajectory);
+  std::vector<double> positions;
+  trajectory->getWayPoint(0).copyJointGroupPositions(arm_jmg_name_, positions);
+  for (std::size_t i = 0; i < trajectory->getWayPointCount(); ++i)
+  {
+    positions[1] = 0.1 * i;
+    trajectory->getWayPointPtr(i)->setJointGroupPositions(arm_jmg_name_, positions);
+  }
+
+  const robot_trajectory::DenseRobotTrajectory dense(*trajectory);
+  ASSERT_EQ(dense.getWayPointCount(), trajectory->getWayPointCount());
+  EXPECT_TRUE(dense.hasVelocities());
+  EXPECT_NEAR(dense.getDuration(), trajectory->getDuration(), 1e-12);
+  EXPECT_NEAR(dense.getPositions()(1, 3), 0.3, 1e-12);
+
+  // the message matches the one of the original trajectory
+  moveit_msgs::msg::RobotTrajectory msg, dense_msg;
+  trajectory->getRobotTrajectoryMsg(msg);
+  dense.getRobotTrajectoryMsg(dense_msg);
+  ASSERT_EQ(dense_msg.joint_trajectory.joint_names, msg.joint_trajectory.joint_names);
+  ASSERT_EQ(dense_msg.joint_trajectory.points.size(), msg.joint_trajectory.points.size());
+  for (std::size_t i = 0; i < msg.joint_trajectory.points.size(); ++i)
+  {
+    EXPECT_EQ(dense_msg.joint_trajectory.points[i].positions, msg.joint_trajectory.points[i].positions);
+    EXPECT_EQ(dense_msg.joint_trajectory.points[i].velocities, msg.joint_trajectory.points[i].velocities);
+    EXPECT_EQ(rclcpp::Duration(dense_msg.joint_trajectory.points[i].time_from_start),
+              rclcpp::Duration(msg.joint_trajectory.points[i].time_from_start));
+  }
+
+  // materialized waypoints match the original ones
+  robot_trajectory::RobotTrajectory materialized(robot_model_, arm_jmg_name_);
+  dense.getRobotTrajectory(materialized);
+  ASSERT_EQ(materialized.getWayPointCount(), trajectory->getWayPointCount());
+  for (std::size_t i = 0; i < materialized.getWayPointCount(); ++i)
+    EXPECT_NEAR(materialized.getWayPoint(i).distance(trajectory->getWayPoint(i)), 0.0, 1e-12);
+
+  // resampling halfway between the waypoints interpolates between them
+  robot_trajectory::DenseRobotTrajectory resampled(dense);
+  dense.resample({ 0.1, 0.15, 0.5, 1.0 }, resampled);
+  ASSERT_EQ(resampled.getWayPointCount(), 4u);
+  EXPECT_NEAR(resampled.getPositions()(1, 0), 0.0, 1e-9);
+  EXPECT_NEAR(resampled.getPositions()(1, 1), 0.05, 1e-9);
+  EXPECT_NEAR(resampled.getPositions()(1, 2), 0.4, 1e-9);
+  EXPECT_NEAR(resampled.getPositions()(1, 3), 0.4, 1e-9);
+  EXPECT_NEAR(resampled.getDuration(), 1.0, 1e-12);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -99,10 +99,30 @@ private:
 
   /**
    * \brief A utility function to instantiate and run Ruckig for a series of waypoints.
+   *
+   * The trajectory is split at the waypoints at which it is at rest. The parts in between are smoothed independently
+   * and in parallel, and only the durations of the parts Ruckig fails on are extended.
    * \param[in, out] trajectory      Trajectory to smooth.
    * \param[in, out] ruckig_input    Necessary input for Ruckig smoothing. Contains kinematic limits (vel, accel, jerk)
    */
   [[nodiscard]] static bool runRuckig(robot_trajectory::RobotTrajectory& trajectory,
                                       ruckig::InputParameter<ruckig::DynamicDOFs>& ruckig_input);
+
+  /**
+   * \brief Run Ruckig over the waypoints [begin, end] of a trajectory, extending the durations of this part until
+   * Ruckig reaches every waypoint.
+   * \param[in, out] trajectory      Trajectory to smooth. Only the waypoints after begin are modified.
+   * \param begin                    Index of the first waypoint of the part
+   * \param end                      Index of the last waypoint of the part
+   * \param begin_state              Copy of the first waypoint, which may be modified concurrently as the last
+   *                                 waypoint of the previous part
+   * \param[in, out] ruckig_input    Input for Ruckig. Contains kinematic limits (vel, accel, jerk)
+   * \param[out] duration_extension_factor  Factor by which the durations of the part were extended
+   * \return The Ruckig result of the last update
+   */
+  [[nodiscard]] static ruckig::Result runRuckigPart(robot_trajectory::RobotTrajectory& trajectory, std::size_t begin,
+                                                    std::size_t end, const moveit::core::RobotStatePtr& begin_state,
+                                                    ruckig::InputParameter<ruckig::DynamicDOFs>& ruckig_input,
+                                                    double& duration_extension_factor);
 };
 }  // namespace trajectory_processing
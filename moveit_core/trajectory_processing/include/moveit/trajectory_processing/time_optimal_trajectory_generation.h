@@ -39,9 +39,13 @@
 #pragma once
 
 #include <Eigen/Core>
+#include <deque>
 #include <list>
+#include <vector>
+#include <moveit/robot_trajectory/dense_robot_trajectory.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/trajectory_processing/time_parameterization.h>
+#include <trajectory_msgs/msg/joint_trajectory.hpp>
 
 namespace trajectory_processing
 {
@@ -61,7 +65,7 @@ public:
   virtual Eigen::VectorXd getConfig(double s) const = 0;
   virtual Eigen::VectorXd getTangent(double s) const = 0;
   virtual Eigen::VectorXd getCurvature(double s) const = 0;
-  virtual std::list<double> getSwitchingPoints() const = 0;
+  virtual std::vector<double> getSwitchingPoints() const = 0;
   virtual PathSegment* clone() const = 0;
 
   double position_;
@@ -80,21 +84,29 @@ public:
   Eigen::VectorXd getTangent(double s) const;
   Eigen::VectorXd getCurvature(double s) const;
   double getNextSwitchingPoint(double s, bool& discontinuity) const;
-  std::list<std::pair<double, bool>> getSwitchingPoints() const;
+  const std::vector<std::pair<double, bool>>& getSwitchingPoints() const;
+  /** @brief Path position of the point halfway between the input waypoints index and index + 1
+   *
+   * This point always lies on a linear segment, independent of the blending at the waypoints. */
+  double getWaypointMidpointPosition(std::size_t index) const;
 
 private:
   PathSegment* getPathSegment(double& s) const;
   double length_;
-  std::list<std::pair<double, bool>> switching_points_;
-  std::list<std::unique_ptr<PathSegment>> path_segments_;
+  std::vector<double> waypoint_midpoint_positions_;
+  std::vector<std::pair<double, bool>> switching_points_;  // sorted by path position
+  std::vector<std::unique_ptr<PathSegment>> path_segments_;  // sorted by position_
 };
 
 class Trajectory
 {
 public:
-  /// @brief Generates a time-optimal trajectory
+  /** @brief Generates a time-optimal trajectory
+   *
+   * The trajectory starts at initial_path_pos with initial_path_vel, which must not exceed the velocity limits
+   * there, and always ends at rest at the end of the path. */
   Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, const Eigen::VectorXd& max_acceleration,
-             double time_step = 0.001);
+             double time_step = 0.001, double initial_path_pos = 0.0, double initial_path_vel = 0.0);
 
   ~Trajectory();
 
@@ -113,6 +125,10 @@ public:
   Eigen::VectorXd getVelocity(double time) const;
   /** @brief Return the acceleration vector for a given point in time */
   Eigen::VectorXd getAcceleration(double time) const;
+  /** @brief Return the velocity along the path for a given point in time */
+  double getPathVelocity(double time) const;
+  /** @brief Return the point in time at which the given path position is reached */
+  double getTimeAtPathPosition(double path_pos) const;
 
 private:
   struct TrajectoryStep
@@ -128,14 +144,36 @@ private:
     double time_;
   };
 
+  /** @brief Result of evaluating a switching point of the path as acceleration switching point */
+  struct AccelerationSwitchingCandidate
+  {
+    TrajectoryStep switching_point_;
+    double before_acceleration_;
+    double after_acceleration_;
+    bool is_switching_point_;
+  };
+
+  /** @brief Comparison of the phase slope with the slope of the velocity limit curve at a grid point */
+  enum VelocitySlopeComparison : unsigned char
+  {
+    SLOPE_BELOW = 0,  // also used if the comparison is undefined
+    SLOPE_EQUAL = 1,
+    SLOPE_ABOVE = 2
+  };
+
+  /** @brief Evaluate the switching point conditions along the whole path, in parallel for long paths */
+  void computeSwitchingPointTables();
+  AccelerationSwitchingCandidate evaluateAccelerationSwitchingCandidate(const std::pair<double, bool>& candidate);
+  VelocitySlopeComparison compareVelocitySlope(double path_pos);
+
   bool getNextSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point, double& before_acceleration,
                              double& after_acceleration);
   bool getNextAccelerationSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
                                          double& before_acceleration, double& after_acceleration);
   bool getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep& next_switching_point, double& before_acceleration,
                                      double& after_acceleration);
-  bool integrateForward(std::list<TrajectoryStep>& trajectory, double acceleration);
-  void integrateBackward(std::list<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
+  bool integrateForward(std::vector<TrajectoryStep>& trajectory, double acceleration);
+  void integrateBackward(std::vector<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
                          double acceleration);
   double getMinMaxPathAcceleration(double path_position, double path_velocity, bool max);
   double getMinMaxPhaseSlope(double path_position, double path_velocity, bool max);
@@ -144,20 +182,27 @@ private:
   double getAccelerationMaxPathVelocityDeriv(double path_pos);
   double getVelocityMaxPathVelocityDeriv(double path_pos);
 
-  std::list<TrajectoryStep>::const_iterator getTrajectorySegment(double time) const;
+  std::vector<TrajectoryStep>::const_iterator getTrajectorySegment(double time) const;
+
+  /** @brief Per-thread storage whose capacity is handed from one Trajectory to the next */
+  static std::vector<TrajectoryStep>& getRecycledSteps();
+  static std::vector<TrajectoryStep>& getRecycledBackwardSteps();
 
   Path path_;
   Eigen::VectorXd max_velocity_;
   Eigen::VectorXd max_acceleration_;
   unsigned int joint_num_;
   bool valid_;
-  std::list<TrajectoryStep> trajectory_;
-  std::list<TrajectoryStep> end_trajectory_;  // non-empty only if the trajectory generation failed.
+  std::vector<TrajectoryStep> trajectory_;  // sorted by time_ once the generation succeeded
+  std::vector<TrajectoryStep> end_trajectory_;  // non-empty only if the trajectory generation failed.
+  std::vector<TrajectoryStep> backward_trajectory_;  // scratch buffer of integrateBackward(), in reverse order
 
-  const double time_step_;
+  /** @brief Evaluation of the path switching points that lie before the end of the path */
+  std::vector<AccelerationSwitchingCandidate> acceleration_switching_candidates_;
+  /** @brief compareVelocitySlope() of the grid positions i * DEFAULT_TIMESTEP before the end of the path */
+  std::vector<VelocitySlopeComparison> velocity_slope_comparisons_;
 
-  mutable double cached_time_;
-  mutable std::list<TrajectoryStep>::const_iterator cached_trajectory_segment_;
+  const double time_step_;
 };
 
 MOVEIT_CLASS_FORWARD(TimeOptimalTrajectoryGeneration);
@@ -174,7 +219,29 @@ public:
                          const std::unordered_map<std::string, double>& velocity_limits,
                          const std::unordered_map<std::string, double>& acceleration_limits) const override;
 
+  /** @brief Compute the time-optimal parameterization of a trajectory and write it, sampled every sample_dt, into
+   * a JointTrajectory of the active single-DOF joints of the trajectory's group
+   *
+   * In contrast to computeTimeStamps(), no RobotState is created per sample, so this is suitable for sampling at
+   * controller rate. The waypoints of trajectory are unwound but otherwise left unchanged. */
+  bool computeJointTrajectory(robot_trajectory::RobotTrajectory& trajectory, const double sample_dt,
+                              trajectory_msgs::msg::JointTrajectory& joint_trajectory,
+                              const double max_velocity_scaling_factor = 1.0,
+                              const double max_acceleration_scaling_factor = 1.0) const;
+
+  /** @brief Like computeJointTrajectory(), but sample into a dense trajectory of all group variables */
+  bool computeDenseTrajectory(robot_trajectory::RobotTrajectory& trajectory, const double sample_dt,
+                              robot_trajectory::DenseRobotTrajectory& dense_trajectory,
+                              const double max_velocity_scaling_factor = 1.0,
+                              const double max_acceleration_scaling_factor = 1.0) const;
+
 private:
+  /** @brief Unwind trajectory and parameterize the path of its diverse waypoints
+   *
+   * parameterized is left empty if the trajectory has only a single diverse waypoint. */
+  bool parameterizePath(robot_trajectory::RobotTrajectory& trajectory, const Eigen::VectorXd& max_velocity,
+                        const Eigen::VectorXd& max_acceleration, std::unique_ptr<Trajectory>& parameterized) const;
+
   bool doTimeParameterizationCalculations(robot_trajectory::RobotTrajectory& trajectory,
                                           const Eigen::VectorXd& max_velocity,
                                           const Eigen::VectorXd& max_acceleration) const;
@@ -183,4 +250,76 @@ private:
   const double resample_dt_;
   const double min_angle_change_;
 };
+
+MOVEIT_CLASS_FORWARD(OnlineTimeOptimalTrajectoryGeneration);
+/** @brief Time-optimal parameterization of a path whose waypoints become available incrementally
+ *
+ * Added waypoints are buffered. Once more than lookahead waypoints are buffered ahead of the current start, the
+ * buffered window is parameterized to end at rest at its last waypoint, and the part up to the middle between the
+ * waypoints lookahead and lookahead + 1 before the end is emitted as segment. The next window continues from there
+ * with the reached path velocity, so the emitted segments join with continuous velocity.
+ *
+ * Since every window ends at rest, the emitted motion can always be stopped within the limits: if a window cannot
+ * be parameterized from the handed over state, the remainder of the previous window, which stops at its last
+ * waypoint, is emitted instead and the next window starts from rest there. */
+class OnlineTimeOptimalTrajectoryGeneration
+{
+public:
+  OnlineTimeOptimalTrajectoryGeneration(const moveit::core::JointModelGroup* group, std::size_t lookahead = 5,
+                                        const double path_tolerance = 0.1, const double resample_dt = 0.1,
+                                        const double max_velocity_scaling_factor = 1.0,
+                                        const double max_acceleration_scaling_factor = 1.0);
+
+  /** @brief Append a waypoint to the path, using the positions of the group variables
+   *
+   * Waypoints that do not differ from the previous one are skipped. */
+  void addWaypoint(const moveit::core::RobotState& waypoint);
+
+  /** @brief Declare the path complete, so the remaining waypoints are emitted without lookahead */
+  void finish();
+
+  /** @brief Discard all buffered waypoints and start a new path */
+  void reset();
+
+  /** @brief Compute the next time-parameterized segment
+   *
+   * The segment continues the previously emitted segments: the duration of its first waypoint is measured from the
+   * last waypoint of the previous segment. The variables outside of the group are taken from the first waypoint.
+   * @return false if not enough waypoints are buffered, all waypoints have been emitted or the parameterization
+   * failed */
+  bool getNextSegment(robot_trajectory::RobotTrajectory& segment);
+
+  /** @brief True once finish() was called and all waypoints have been emitted */
+  bool isDone() const;
+
+private:
+  /** @brief Append the states of trajectory between begin and end, sampled at resample_dt_ */
+  void appendSamples(const Trajectory& trajectory, double begin, double end, bool include_begin,
+                     robot_trajectory::RobotTrajectory& segment);
+
+  const moveit::core::JointModelGroup* group_;
+  const std::size_t lookahead_;
+  const double path_tolerance_;
+  const double resample_dt_;
+  Eigen::VectorXd max_velocity_;
+  Eigen::VectorXd max_acceleration_;
+  bool valid_limits_;
+
+  /** @brief Buffered waypoints, waypoints_[0] is the first waypoint of the current window */
+  std::deque<Eigen::VectorXd> waypoints_;
+  moveit::core::RobotStatePtr reference_state_;
+  /** @brief True if any state was emitted */
+  bool emitted_;
+  /** @brief True if the current window starts between waypoints_[0] and waypoints_[1] with start_path_vel_ */
+  bool started_;
+  double start_path_vel_;
+  bool finished_;
+  bool done_;
+
+  /** @brief The last window and the time at which it was handed over to the next one */
+  std::unique_ptr<Trajectory> previous_window_;
+  double previous_handoff_time_;
+  /** @brief Index into waypoints_ of the last waypoint of previous_window_ */
+  std::size_t previous_window_end_;
+};
 }  // namespace trajectory_processing
@@ -40,6 +40,8 @@
 #include <Eigen/Geometry>
 #include <limits>
 #include <moveit/trajectory_processing/ruckig_traj_smoothing.h>
+#include <atomic>
+#include <thread>
 #include <vector>
 
 namespace trajectory_processing
@@ -52,6 +54,8 @@ constexpr double DEFAULT_MAX_ACCELERATION = 10;  // rad/s^2
 constexpr double DEFAULT_MAX_JERK = 1000;        // rad/s^3
 constexpr double MAX_DURATION_EXTENSION_FACTOR = 10.0;
 constexpr double DURATION_EXTENSION_FRACTION = 1.1;
+// The trajectory is split into independent parts at waypoints with all velocities below this threshold
+constexpr double STOP_VELOCITY_THRESHOLD = 1e-6;  // rad/s
 }  // namespace
 
 bool RuckigSmoothing::applySmoothing(robot_trajectory::RobotTrajectory& trajectory,
@@ -212,85 +216,150 @@ bool RuckigSmoothing::runRuckig(robot_trajectory::RobotTrajectory& trajectory,
 {
   const size_t num_waypoints = trajectory.getWayPointCount();
   moveit::core::JointModelGroup const* const group = trajectory.getGroup();
-  const size_t num_dof = group->getVariableCount();
-  ruckig::OutputParameter<ruckig::DynamicDOFs> ruckig_output{ num_dof };
   const std::vector<int>& move_group_idx = group->getVariableIndexList();
 
   // This lib does not work properly when angles wrap, so we need to unwind the path first
   trajectory.unwind();
 
-  // Initialize the smoother
-  double timestep = trajectory.getAverageSegmentDuration();
-  std::unique_ptr<ruckig::Ruckig<ruckig::DynamicDOFs>> ruckig_ptr;
-  ruckig_ptr = std::make_unique<ruckig::Ruckig<ruckig::DynamicDOFs>>(num_dof, timestep);
-  initializeRuckigState(*trajectory.getFirstWayPointPtr(), group, ruckig_input, ruckig_output);
+  // Split the trajectory at the waypoints at which it is at rest. Extending the durations of one part scales its
+  // velocities, which leaves the velocities at the stops unchanged, so the parts can be smoothed independently.
+  std::vector<size_t> part_starts{ 0 };
+  for (size_t waypoint_idx = 1; waypoint_idx < num_waypoints - 1; ++waypoint_idx)
+  {
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(waypoint_idx);
+    if (std::all_of(move_group_idx.begin(), move_group_idx.end(), [&waypoint](int idx) {
+          return std::abs(waypoint.getVariableVelocity(idx)) < STOP_VELOCITY_THRESHOLD;
+        }))
+      part_starts.push_back(waypoint_idx);
+  }
+  part_starts.push_back(num_waypoints - 1);
+  const size_t num_parts = part_starts.size() - 1;
+
+  // The first waypoint of a part is the last waypoint of the previous part, which may be modified concurrently
+  std::vector<moveit::core::RobotStatePtr> begin_states(num_parts);
+  for (size_t part = 0; part < num_parts; ++part)
+    begin_states[part] = std::make_shared<moveit::core::RobotState>(trajectory.getWayPoint(part_starts[part]));
+
+  std::vector<ruckig::Result> results(num_parts, ruckig::Result::Working);
+  std::vector<double> duration_extension_factors(num_parts, 1.0);
+  std::atomic<size_t> next_part{ 0 };
+  const auto run = [&] {
+    ruckig::InputParameter<ruckig::DynamicDOFs> part_input = ruckig_input;
+    for (size_t part = next_part++; part < num_parts; part = next_part++)
+    {
+      results[part] = runRuckigPart(trajectory, part_starts[part], part_starts[part + 1], begin_states[part],
+                                    part_input, duration_extension_factors[part]);
+    }
+  };
+  const size_t num_threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), num_parts));
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t thread = 1; thread < num_threads; ++thread)
+    threads.emplace_back(run);
+  run();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (size_t part = 0; part < num_parts; ++part)
+  {
+    // Smooth again from the final first waypoint if the previous part had to be extended
+    if (part > 0 && duration_extension_factors[part - 1] > 1.0 && results[part] == ruckig::Result::Finished)
+    {
+      begin_states[part] = std::make_shared<moveit::core::RobotState>(trajectory.getWayPoint(part_starts[part]));
+      results[part] = runRuckigPart(trajectory, part_starts[part], part_starts[part + 1], begin_states[part],
+                                    ruckig_input, duration_extension_factors[part]);
+    }
+    if (results[part] != ruckig::Result::Finished)
+    {
+      RCLCPP_ERROR_STREAM(LOGGER, "Ruckig trajectory smoothing failed. Ruckig error: " << results[part]);
+      return false;
+    }
+  }
 
-  // Cache the trajectory in case we need to reset it
-  robot_trajectory::RobotTrajectory original_trajectory =
-      robot_trajectory::RobotTrajectory(trajectory, true /* deep copy */);
+  return true;
+}
 
-  ruckig::Result ruckig_result;
-  double duration_extension_factor = 1;
-  bool smoothing_complete = false;
-  while ((duration_extension_factor < MAX_DURATION_EXTENSION_FACTOR) && !smoothing_complete)
+ruckig::Result RuckigSmoothing::runRuckigPart(robot_trajectory::RobotTrajectory& trajectory, std::size_t begin,
+                                              std::size_t end, const moveit::core::RobotStatePtr& begin_state,
+                                              ruckig::InputParameter<ruckig::DynamicDOFs>& ruckig_input,
+                                              double& duration_extension_factor)
+{
+  moveit::core::JointModelGroup const* const group = trajectory.getGroup();
+  const size_t num_dof = group->getVariableCount();
+  const std::vector<int>& move_group_idx = group->getVariableIndexList();
+  const size_t num_segments = end - begin;
+  const bool whole_trajectory = begin == 0 && end == trajectory.getWayPointCount() - 1;
+
+  // Cache the durations and velocities of the part in case we need to extend it
+  std::vector<double> original_durations(num_segments);
+  std::vector<double> original_velocities(num_segments * num_dof);
+  double total_duration = 0.0;
+  for (size_t segment = 0; segment < num_segments; ++segment)
   {
-    for (size_t waypoint_idx = 0; waypoint_idx < num_waypoints - 1; ++waypoint_idx)
-    {
-      moveit::core::RobotStatePtr next_waypoint = trajectory.getWayPointPtr(waypoint_idx + 1);
+    original_durations[segment] = trajectory.getWayPointDurationFromPrevious(begin + segment + 1);
+    total_duration += original_durations[segment];
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(begin + segment + 1);
+    for (size_t joint = 0; joint < num_dof; ++joint)
+      original_velocities[segment * num_dof + joint] = waypoint.getVariableVelocity(move_group_idx.at(joint));
+  }
 
-      getNextRuckigInput(trajectory.getWayPointPtr(waypoint_idx), next_waypoint, group, ruckig_input);
+  // Initialize the smoother, which is reused for every attempt
+  double timestep = whole_trajectory ? trajectory.getAverageSegmentDuration() : total_duration / num_segments;
+  ruckig::Ruckig<ruckig::DynamicDOFs> ruckig(num_dof, timestep);
+  ruckig::OutputParameter<ruckig::DynamicDOFs> ruckig_output{ num_dof };
+  initializeRuckigState(*begin_state, group, ruckig_input, ruckig_output);
 
-      // Run Ruckig
-      ruckig_result = ruckig_ptr->update(ruckig_input, ruckig_output);
+  ruckig::Result ruckig_result = ruckig::Result::Working;
+  duration_extension_factor = 1;
+  while (duration_extension_factor < MAX_DURATION_EXTENSION_FACTOR)
+  {
+    bool smoothing_complete = true;
+    for (size_t waypoint_idx = begin; waypoint_idx < end; ++waypoint_idx)
+    {
+      getNextRuckigInput(waypoint_idx == begin ? begin_state : trajectory.getWayPointPtr(waypoint_idx),
+                         trajectory.getWayPointPtr(waypoint_idx + 1), group, ruckig_input);
 
-      if ((waypoint_idx == num_waypoints - 2) && ruckig_result == ruckig::Result::Finished)
+      // Run Ruckig
+      ruckig_result = ruckig.update(ruckig_input, ruckig_output);
+      if (ruckig_result != ruckig::Result::Finished)
       {
-        smoothing_complete = true;
+        smoothing_complete = false;
         break;
       }
+    }
+    if (smoothing_complete)
+      break;
 
-      // Extend the trajectory duration if Ruckig could not reach the waypoint successfully
-      if (ruckig_result != ruckig::Result::Finished)
+    // Extend the duration of the part if Ruckig could not reach a waypoint successfully
+    duration_extension_factor *= DURATION_EXTENSION_FRACTION;
+    total_duration = 0.0;
+    for (size_t segment = 0; segment < num_segments; ++segment)
+    {
+      trajectory.setWayPointDurationFromPrevious(begin + segment + 1,
+                                                 duration_extension_factor * original_durations[segment]);
+      total_duration += duration_extension_factor * original_durations[segment];
+    }
+    timestep = whole_trajectory ? trajectory.getAverageSegmentDuration() : total_duration / num_segments;
+    for (size_t segment = 0; segment < num_segments; ++segment)
+    {
+      // re-calculate waypoint velocity and acceleration
+      const moveit::core::RobotStatePtr target_state = trajectory.getWayPointPtr(begin + segment + 1);
+      const moveit::core::RobotState& prev_state =
+          segment == 0 ? *begin_state : trajectory.getWayPoint(begin + segment);
+      for (size_t joint = 0; joint < num_dof; ++joint)
       {
-        duration_extension_factor *= DURATION_EXTENSION_FRACTION;
-        // Reset the trajectory
-        trajectory = robot_trajectory::RobotTrajectory(original_trajectory, true /* deep copy */);
-        for (size_t time_stretch_idx = 1; time_stretch_idx < num_waypoints; ++time_stretch_idx)
-        {
-          trajectory.setWayPointDurationFromPrevious(
-              time_stretch_idx,
-              duration_extension_factor * original_trajectory.getWayPointDurationFromPrevious(time_stretch_idx));
-          // re-calculate waypoint velocity and acceleration
-          auto target_state = trajectory.getWayPointPtr(time_stretch_idx);
-          const auto prev_state = trajectory.getWayPointPtr(time_stretch_idx - 1);
-          timestep = trajectory.getAverageSegmentDuration();
-          for (size_t joint = 0; joint < num_dof; ++joint)
-          {
-            target_state->setVariableVelocity(move_group_idx.at(joint),
-                                              (1 / duration_extension_factor) *
-                                                  target_state->getVariableVelocity(move_group_idx.at(joint)));
-
-            double prev_velocity = prev_state->getVariableVelocity(move_group_idx.at(joint));
-            double curr_velocity = target_state->getVariableVelocity(move_group_idx.at(joint));
-            target_state->setVariableAcceleration(move_group_idx.at(joint), (curr_velocity - prev_velocity) / timestep);
-          }
-          target_state->update();
-        }
-        ruckig_ptr = std::make_unique<ruckig::Ruckig<ruckig::DynamicDOFs>>(num_dof, timestep);
-        initializeRuckigState(*trajectory.getFirstWayPointPtr(), group, ruckig_input, ruckig_output);
-        // Begin the while() loop again
-        break;
+        const double curr_velocity = original_velocities[segment * num_dof + joint] / duration_extension_factor;
+        const double prev_velocity = prev_state.getVariableVelocity(move_group_idx.at(joint));
+        target_state->setVariableVelocity(move_group_idx.at(joint), curr_velocity);
+        target_state->setVariableAcceleration(move_group_idx.at(joint), (curr_velocity - prev_velocity) / timestep);
       }
+      target_state->update();
     }
+    ruckig.delta_time = timestep;
+    initializeRuckigState(*begin_state, group, ruckig_input, ruckig_output);
   }
 
-  if (ruckig_result != ruckig::Result::Finished)
-  {
-    RCLCPP_ERROR_STREAM(LOGGER, "Ruckig trajectory smoothing failed. Ruckig error: " << ruckig_result);
-    return false;
-  }
-
-  return true;
+  return ruckig_result;
 }
 
 void RuckigSmoothing::initializeRuckigState(const moveit::core::RobotState& first_waypoint,
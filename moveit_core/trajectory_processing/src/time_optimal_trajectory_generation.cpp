@@ -37,12 +37,14 @@
  */
 
 #include <rclcpp/logger.hpp>
+#include <rclcpp/duration.hpp>
 #include <rclcpp/logging.hpp>
 #include <limits>
 #include <Eigen/Geometry>
 #include <algorithm>
 #include <cmath>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <thread>
 #include <vector>
 
 namespace trajectory_processing
@@ -53,6 +55,29 @@ static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_trajectory_processing.time_optimal_trajectory_generation");
 constexpr double DEFAULT_TIMESTEP = 1e-3;
 constexpr double EPS = 1e-6;
+constexpr double DEFAULT_MIN_ANGLE_CHANGE = 0.001;
+// minimum number of evaluations per thread when computing the switching point tables in parallel
+constexpr std::size_t MIN_EVALUATIONS_PER_THREAD = 500;
+
+// Call function(i) for all i in [0, count), distributed over the available cores
+template <typename Function>
+void parallelFor(std::size_t count, const Function& function)
+{
+  const std::size_t thread_count = std::max<std::size_t>(
+      1, std::min<std::size_t>(std::thread::hardware_concurrency(), count / MIN_EVALUATIONS_PER_THREAD));
+  const auto run = [&](std::size_t thread_index) {
+    const std::size_t end = (thread_index + 1) * count / thread_count;
+    for (std::size_t i = thread_index * count / thread_count; i < end; ++i)
+      function(i);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (std::size_t thread_index = 1; thread_index < thread_count; ++thread_index)
+    threads.emplace_back(run, thread_index);
+  run(0);
+  for (std::thread& thread : threads)
+    thread.join();
+}
 }  // namespace
 
 class LinearPathSegment : public PathSegment
@@ -80,9 +105,9 @@ public:
     return Eigen::VectorXd::Zero(start_.size());
   }
 
-  std::list<double> getSwitchingPoints() const override
+  std::vector<double> getSwitchingPoints() const override
   {
-    return std::list<double>();
+    return std::vector<double>();
   }
 
   LinearPathSegment* clone() const override
@@ -160,10 +185,11 @@ public:
     return -1.0 / radius * (x * cos(angle) + y * sin(angle));
   }
 
-  std::list<double> getSwitchingPoints() const override
+  std::vector<double> getSwitchingPoints() const override
   {
-    std::list<double> switching_points;
+    std::vector<double> switching_points;
     const double dim = x.size();
+    switching_points.reserve(dim);
     for (unsigned int i = 0; i < dim; ++i)
     {
       double switching_angle = atan2(y[i], x[i]);
@@ -177,7 +203,7 @@ public:
         switching_points.push_back(switching_point);
       }
     }
-    switching_points.sort();
+    std::sort(switching_points.begin(), switching_points.end());
     return switching_points;
   }
 
@@ -197,6 +223,11 @@ Path::Path(const std::list<Eigen::VectorXd>& path, double max_deviation) : lengt
 {
   if (path.size() < 2)
     return;
+  // every waypoint adds at most a linear and a blend segment
+  path_segments_.reserve(2 * path.size());
+  // segment containing the midpoint of the waypoints and the offset of the midpoint in that segment
+  std::vector<std::pair<std::size_t, double>> waypoint_midpoints;
+  waypoint_midpoints.reserve(path.size() - 1);
   std::list<Eigen::VectorXd>::const_iterator path_iterator1 = path.begin();
   std::list<Eigen::VectorXd>::const_iterator path_iterator2 = path_iterator1;
   ++path_iterator2;
@@ -206,6 +237,9 @@ Path::Path(const std::list<Eigen::VectorXd>& path, double max_deviation) : lengt
   {
     path_iterator3 = path_iterator2;
     ++path_iterator3;
+    // the blends end and start at most halfway between the waypoints, so the midpoint lies on the next segment
+    waypoint_midpoints.emplace_back(path_segments_.size(),
+                                    (0.5 * (*path_iterator1 + *path_iterator2) - start_config).norm());
     if (max_deviation > 0.0 && path_iterator3 != path.end())
     {
       CircularPathSegment* blend_segment =
@@ -231,14 +265,13 @@ Path::Path(const std::list<Eigen::VectorXd>& path, double max_deviation) : lengt
 
   // Create list of switching point candidates, calculate total path length and
   // absolute positions of path segments
+  switching_points_.reserve(2 * path_segments_.size());
   for (std::unique_ptr<PathSegment>& path_segment : path_segments_)
   {
     path_segment->position_ = length_;
-    std::list<double> local_switching_points = path_segment->getSwitchingPoints();
-    for (std::list<double>::const_iterator point = local_switching_points.begin();
-         point != local_switching_points.end(); ++point)
+    for (const double point : path_segment->getSwitchingPoints())
     {
-      switching_points_.push_back(std::make_pair(length_ + *point, false));
+      switching_points_.push_back(std::make_pair(length_ + point, false));
     }
     length_ += path_segment->getLength();
     while (!switching_points_.empty() && switching_points_.back().first >= length_)
@@ -246,10 +279,18 @@ Path::Path(const std::list<Eigen::VectorXd>& path, double max_deviation) : lengt
     switching_points_.push_back(std::make_pair(length_, true));
   }
   switching_points_.pop_back();
+
+  waypoint_midpoint_positions_.reserve(waypoint_midpoints.size());
+  for (const std::pair<std::size_t, double>& midpoint : waypoint_midpoints)
+    waypoint_midpoint_positions_.push_back(path_segments_[midpoint.first]->position_ + midpoint.second);
 }
 
-Path::Path(const Path& path) : length_(path.length_), switching_points_(path.switching_points_)
+Path::Path(const Path& path)
+  : length_(path.length_)
+  , waypoint_midpoint_positions_(path.waypoint_midpoint_positions_)
+  , switching_points_(path.switching_points_)
 {
+  path_segments_.reserve(path.path_segments_.size());
   for (const std::unique_ptr<PathSegment>& path_segment : path.path_segments_)
   {
     path_segments_.emplace_back(path_segment->clone());
@@ -263,14 +304,11 @@ double Path::getLength() const
 
 PathSegment* Path::getPathSegment(double& s) const
 {
-  std::list<std::unique_ptr<PathSegment>>::const_iterator it = path_segments_.begin();
-  std::list<std::unique_ptr<PathSegment>>::const_iterator next = it;
-  ++next;
-  while (next != path_segments_.end() && s >= (*next)->position_)
-  {
-    it = next;
-    ++next;
-  }
+  // last segment starting at or before s, the first one if s lies before the path
+  auto it = std::upper_bound(
+      path_segments_.begin() + 1, path_segments_.end(), s,
+      [](double s, const std::unique_ptr<PathSegment>& segment) { return s < segment->position_; });
+  --it;
   s -= (*it)->position_;
   return (*it).get();
 }
@@ -295,11 +333,8 @@ Eigen::VectorXd Path::getCurvature(double s) const
 
 double Path::getNextSwitchingPoint(double s, bool& discontinuity) const
 {
-  std::list<std::pair<double, bool>>::const_iterator it = switching_points_.begin();
-  while (it != switching_points_.end() && it->first <= s)
-  {
-    ++it;
-  }
+  const auto it = std::upper_bound(switching_points_.begin(), switching_points_.end(), s,
+                                   [](double s, const std::pair<double, bool>& point) { return s < point.first; });
   if (it == switching_points_.end())
   {
     discontinuity = true;
@@ -309,29 +344,46 @@ double Path::getNextSwitchingPoint(double s, bool& discontinuity) const
   return it->first;
 }
 
-std::list<std::pair<double, bool>> Path::getSwitchingPoints() const
+const std::vector<std::pair<double, bool>>& Path::getSwitchingPoints() const
 {
   return switching_points_;
 }
 
+double Path::getWaypointMidpointPosition(std::size_t index) const
+{
+  return waypoint_midpoint_positions_.at(index);
+}
+
 Trajectory::Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, const Eigen::VectorXd& max_acceleration,
-                       double time_step)
+                       double time_step, double initial_path_pos, double initial_path_vel)
   : path_(path)
   , max_velocity_(max_velocity)
   , max_acceleration_(max_acceleration)
   , joint_num_(max_velocity.size())
   , valid_(true)
   , time_step_(time_step)
-  , cached_time_(std::numeric_limits<double>::max())
 {
+  // take over the capacity of the previous trajectory generated on this thread
+  trajectory_.swap(getRecycledSteps());
+  trajectory_.clear();
+  backward_trajectory_.swap(getRecycledBackwardSteps());
+
   if (time_step_ == 0)
   {
     valid_ = false;
     RCLCPP_ERROR(LOGGER, "The trajectory is invalid because the time step is 0.");
     return;
   }
-  trajectory_.push_back(TrajectoryStep(0.0, 0.0));
-  double after_acceleration = getMinMaxPathAcceleration(0.0, 0.0, true);
+  if (initial_path_vel > EPS + std::min(getVelocityMaxPathVelocity(initial_path_pos),
+                                       getAccelerationMaxPathVelocity(initial_path_pos)))
+  {
+    valid_ = false;
+    RCLCPP_ERROR(LOGGER, "The trajectory is invalid because the initial path velocity exceeds the limits.");
+    return;
+  }
+  computeSwitchingPointTables();
+  trajectory_.push_back(TrajectoryStep(initial_path_pos, initial_path_vel));
+  double after_acceleration = getMinMaxPathAcceleration(initial_path_pos, initial_path_vel, true);
   while (valid_ && !integrateForward(trajectory_, after_acceleration) && valid_)
   {
     double before_acceleration;
@@ -352,22 +404,25 @@ Trajectory::Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, co
   if (valid_)
   {
     // Calculate timing
-    std::list<TrajectoryStep>::iterator previous = trajectory_.begin();
-    std::list<TrajectoryStep>::iterator it = previous;
-    it->time_ = 0.0;
-    ++it;
-    while (it != trajectory_.end())
+    trajectory_.front().time_ = 0.0;
+    for (std::size_t i = 1; i < trajectory_.size(); ++i)
     {
-      it->time_ =
-          previous->time_ + (it->path_pos_ - previous->path_pos_) / ((it->path_vel_ + previous->path_vel_) / 2.0);
-      previous = it;
-      ++it;
+      const TrajectoryStep& previous = trajectory_[i - 1];
+      TrajectoryStep& step = trajectory_[i];
+      step.time_ =
+          previous.time_ + (step.path_pos_ - previous.path_pos_) / ((step.path_vel_ + previous.path_vel_) / 2.0);
     }
   }
 }
 
 Trajectory::~Trajectory()
 {
+  std::vector<TrajectoryStep>& recycled_steps = getRecycledSteps();
+  if (trajectory_.capacity() > recycled_steps.capacity())
+    recycled_steps.swap(trajectory_);
+  std::vector<TrajectoryStep>& recycled_backward_steps = getRecycledBackwardSteps();
+  if (backward_trajectory_.capacity() > recycled_backward_steps.capacity())
+    recycled_backward_steps.swap(backward_trajectory_);
 }
 
 // Returns true if end of path is reached.
@@ -418,86 +473,113 @@ bool Trajectory::getNextSwitchingPoint(double path_pos, TrajectoryStep& next_swi
   }
 }
 
-bool Trajectory::getNextAccelerationSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
-                                                   double& before_acceleration, double& after_acceleration)
+void Trajectory::computeSwitchingPointTables()
 {
-  double switching_path_pos = path_pos;
-  double switching_path_vel;
-  while (true)
-  {
-    bool discontinuity;
-    switching_path_pos = path_.getNextSwitchingPoint(switching_path_pos, discontinuity);
+  const std::vector<std::pair<double, bool>>& switching_points = path_.getSwitchingPoints();
+  const std::size_t candidate_count =
+      std::upper_bound(switching_points.begin(), switching_points.end(), path_.getLength() - EPS,
+                       [](double path_pos, const std::pair<double, bool>& point) { return path_pos < point.first; }) -
+      switching_points.begin();
+  acceleration_switching_candidates_.resize(candidate_count);
+  parallelFor(candidate_count, [this, &switching_points](std::size_t i) {
+    acceleration_switching_candidates_[i] = evaluateAccelerationSwitchingCandidate(switching_points[i]);
+  });
+
+  std::size_t grid_size = static_cast<std::size_t>(std::max(0.0, std::ceil(path_.getLength() / DEFAULT_TIMESTEP)));
+  while (grid_size > 0 && (grid_size - 1) * DEFAULT_TIMESTEP >= path_.getLength())
+    --grid_size;
+  velocity_slope_comparisons_.resize(grid_size);
+  parallelFor(grid_size, [this](std::size_t i) {
+    velocity_slope_comparisons_[i] = compareVelocitySlope(i * DEFAULT_TIMESTEP);
+  });
+}
 
-    if (switching_path_pos > path_.getLength() - EPS)
-    {
-      return true;
-    }
+Trajectory::AccelerationSwitchingCandidate
+Trajectory::evaluateAccelerationSwitchingCandidate(const std::pair<double, bool>& candidate)
+{
+  const double switching_path_pos = candidate.first;
+  AccelerationSwitchingCandidate result;
+  result.switching_point_.path_pos_ = switching_path_pos;
+  if (candidate.second)
+  {
+    const double before_path_vel = getAccelerationMaxPathVelocity(switching_path_pos - EPS);
+    const double after_path_vel = getAccelerationMaxPathVelocity(switching_path_pos + EPS);
+    const double switching_path_vel = std::min(before_path_vel, after_path_vel);
+    result.switching_point_.path_vel_ = switching_path_vel;
+    result.before_acceleration_ = getMinMaxPathAcceleration(switching_path_pos - EPS, switching_path_vel, false);
+    result.after_acceleration_ = getMinMaxPathAcceleration(switching_path_pos + EPS, switching_path_vel, true);
+    result.is_switching_point_ =
+        (before_path_vel > after_path_vel ||
+         getMinMaxPhaseSlope(switching_path_pos - EPS, switching_path_vel, false) >
+             getAccelerationMaxPathVelocityDeriv(switching_path_pos - 2.0 * EPS)) &&
+        (before_path_vel < after_path_vel || getMinMaxPhaseSlope(switching_path_pos + EPS, switching_path_vel, true) <
+                                                 getAccelerationMaxPathVelocityDeriv(switching_path_pos + 2.0 * EPS));
+  }
+  else
+  {
+    result.switching_point_.path_vel_ = getAccelerationMaxPathVelocity(switching_path_pos);
+    result.before_acceleration_ = 0.0;
+    result.after_acceleration_ = 0.0;
+    result.is_switching_point_ = getAccelerationMaxPathVelocityDeriv(switching_path_pos - EPS) < 0.0 &&
+                                 getAccelerationMaxPathVelocityDeriv(switching_path_pos + EPS) > 0.0;
+  }
+  return result;
+}
 
-    if (discontinuity)
-    {
-      const double before_path_vel = getAccelerationMaxPathVelocity(switching_path_pos - EPS);
-      const double after_path_vel = getAccelerationMaxPathVelocity(switching_path_pos + EPS);
-      switching_path_vel = std::min(before_path_vel, after_path_vel);
-      before_acceleration = getMinMaxPathAcceleration(switching_path_pos - EPS, switching_path_vel, false);
-      after_acceleration = getMinMaxPathAcceleration(switching_path_pos + EPS, switching_path_vel, true);
-
-      if ((before_path_vel > after_path_vel ||
-           getMinMaxPhaseSlope(switching_path_pos - EPS, switching_path_vel, false) >
-               getAccelerationMaxPathVelocityDeriv(switching_path_pos - 2.0 * EPS)) &&
-          (before_path_vel < after_path_vel || getMinMaxPhaseSlope(switching_path_pos + EPS, switching_path_vel, true) <
-                                                   getAccelerationMaxPathVelocityDeriv(switching_path_pos + 2.0 * EPS)))
-      {
-        break;
-      }
-    }
-    else
-    {
-      switching_path_vel = getAccelerationMaxPathVelocity(switching_path_pos);
-      before_acceleration = 0.0;
-      after_acceleration = 0.0;
+Trajectory::VelocitySlopeComparison Trajectory::compareVelocitySlope(double path_pos)
+{
+  const double phase_slope = getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false);
+  const double limit_slope = getVelocityMaxPathVelocityDeriv(path_pos);
+  if (phase_slope > limit_slope)
+    return SLOPE_ABOVE;
+  if (phase_slope >= limit_slope)
+    return SLOPE_EQUAL;
+  return SLOPE_BELOW;
+}
 
-      if (getAccelerationMaxPathVelocityDeriv(switching_path_pos - EPS) < 0.0 &&
-          getAccelerationMaxPathVelocityDeriv(switching_path_pos + EPS) > 0.0)
-      {
-        break;
-      }
-    }
+bool Trajectory::getNextAccelerationSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
+                                                   double& before_acceleration, double& after_acceleration)
+{
+  // first candidate after path_pos which is an acceleration switching point
+  auto it = std::upper_bound(
+      acceleration_switching_candidates_.begin(), acceleration_switching_candidates_.end(), path_pos,
+      [](double path_pos, const AccelerationSwitchingCandidate& c) { return path_pos < c.switching_point_.path_pos_; });
+  while (it != acceleration_switching_candidates_.end() && !it->is_switching_point_)
+    ++it;
+  if (it == acceleration_switching_candidates_.end())
+  {
+    return true;
   }
 
-  next_switching_point = TrajectoryStep(switching_path_pos, switching_path_vel);
+  next_switching_point = it->switching_point_;
+  before_acceleration = it->before_acceleration_;
+  after_acceleration = it->after_acceleration_;
   return false;
 }
 
 bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
                                                double& before_acceleration, double& after_acceleration)
 {
-  bool start = false;
-  path_pos -= DEFAULT_TIMESTEP;
-  do
-  {
-    path_pos += DEFAULT_TIMESTEP;
-
-    if (getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >=
-        getVelocityMaxPathVelocityDeriv(path_pos))
-    {
-      start = true;
-    }
-  } while ((!start || getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >
-                          getVelocityMaxPathVelocityDeriv(path_pos)) &&
-           path_pos < path_.getLength());
-
-  if (path_pos >= path_.getLength())
+  // Scan the precomputed grid for the first position at which the phase slope has reached the slope of the velocity
+  // limit curve and then drops below it again
+  std::size_t i = static_cast<std::size_t>(std::max(0.0, std::ceil(path_pos / DEFAULT_TIMESTEP)));
+  while (i < velocity_slope_comparisons_.size() && velocity_slope_comparisons_[i] == SLOPE_BELOW)
+    ++i;
+  while (i < velocity_slope_comparisons_.size() && velocity_slope_comparisons_[i] == SLOPE_ABOVE)
+    ++i;
+
+  if (i >= velocity_slope_comparisons_.size())
   {
     return true;  // end of trajectory reached
   }
+  path_pos = i * DEFAULT_TIMESTEP;
 
   double before_path_pos = path_pos - DEFAULT_TIMESTEP;
   double after_path_pos = path_pos;
   while (after_path_pos - before_path_pos > EPS)
   {
     path_pos = (before_path_pos + after_path_pos) / 2.0;
-    if (getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >
-        getVelocityMaxPathVelocityDeriv(path_pos))
+    if (compareVelocitySlope(path_pos) == SLOPE_ABOVE)
     {
       before_path_pos = path_pos;
     }
@@ -514,13 +596,15 @@ bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep&
 }
 
 // Returns true if end of path is reached
-bool Trajectory::integrateForward(std::list<TrajectoryStep>& trajectory, double acceleration)
+bool Trajectory::integrateForward(std::vector<TrajectoryStep>& trajectory, double acceleration)
 {
   double path_pos = trajectory.back().path_pos_;
   double path_vel = trajectory.back().path_vel_;
 
-  std::list<std::pair<double, bool>> switching_points = path_.getSwitchingPoints();
-  std::list<std::pair<double, bool>>::iterator next_discontinuity = switching_points.begin();
+  const std::vector<std::pair<double, bool>>& switching_points = path_.getSwitchingPoints();
+  auto next_discontinuity =
+      std::upper_bound(switching_points.begin(), switching_points.end(), path_pos,
+                       [](double path_pos, const std::pair<double, bool>& point) { return path_pos < point.first; });
 
   while (true)
   {
@@ -640,32 +724,34 @@ bool Trajectory::integrateForward(std::list<TrajectoryStep>& trajectory, double
   }
 }
 
-void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
+void Trajectory::integrateBackward(std::vector<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
                                    double acceleration)
 {
-  std::list<TrajectoryStep>::iterator start2 = start_trajectory.end();
+  std::vector<TrajectoryStep>::iterator start2 = start_trajectory.end();
   --start2;
-  std::list<TrajectoryStep>::iterator start1 = start2;
+  std::vector<TrajectoryStep>::iterator start1 = start2;
   --start1;
-  std::list<TrajectoryStep> trajectory;
+  // the backward trajectory is collected in reverse order, so its front is backward_trajectory_.back()
+  std::vector<TrajectoryStep>& trajectory = backward_trajectory_;
+  trajectory.clear();
   double slope;
   assert(start1->path_pos_ <= path_pos);
 
-  while (start1 != start_trajectory.begin() || path_pos >= 0.0)
+  while (start1 != start_trajectory.begin() || path_pos >= start_trajectory.front().path_pos_)
   {
     if (start1->path_pos_ <= path_pos)
     {
-      trajectory.push_front(TrajectoryStep(path_pos, path_vel));
+      trajectory.push_back(TrajectoryStep(path_pos, path_vel));
       path_vel -= time_step_ * acceleration;
-      path_pos -= time_step_ * 0.5 * (path_vel + trajectory.front().path_vel_);
+      path_pos -= time_step_ * 0.5 * (path_vel + trajectory.back().path_vel_);
       acceleration = getMinMaxPathAcceleration(path_pos, path_vel, false);
-      slope = (trajectory.front().path_vel_ - path_vel) / (trajectory.front().path_pos_ - path_pos);
+      slope = (trajectory.back().path_vel_ - path_vel) / (trajectory.back().path_pos_ - path_pos);
 
       if (path_vel < 0.0)
       {
         valid_ = false;
         RCLCPP_ERROR(LOGGER, "Error while integrating backward: Negative path velocity");
-        end_trajectory_ = trajectory;
+        end_trajectory_.assign(trajectory.rbegin(), trajectory.rend());
         return;
       }
     }
@@ -681,20 +767,20 @@ void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory,
     const double intersection_path_pos =
         (start1->path_vel_ - path_vel + slope * path_pos - start_slope * start1->path_pos_) / (slope - start_slope);
     if (std::max(start1->path_pos_, path_pos) - EPS <= intersection_path_pos &&
-        intersection_path_pos <= EPS + std::min(start2->path_pos_, trajectory.front().path_pos_))
+        intersection_path_pos <= EPS + std::min(start2->path_pos_, trajectory.back().path_pos_))
     {
       const double intersection_path_vel =
           start1->path_vel_ + start_slope * (intersection_path_pos - start1->path_pos_);
       start_trajectory.erase(start2, start_trajectory.end());
       start_trajectory.push_back(TrajectoryStep(intersection_path_pos, intersection_path_vel));
-      start_trajectory.splice(start_trajectory.end(), trajectory);
+      start_trajectory.insert(start_trajectory.end(), trajectory.rbegin(), trajectory.rend());
       return;
     }
   }
 
   valid_ = false;
   RCLCPP_ERROR(LOGGER, "Error while integrating backward: Did not hit start trajectory");
-  end_trajectory_ = trajectory;
+  end_trajectory_.assign(trajectory.rbegin(), trajectory.rend());
 }
 
 double Trajectory::getMinMaxPathAcceleration(double path_pos, double path_vel, bool max)
@@ -796,33 +882,33 @@ double Trajectory::getDuration() const
   return trajectory_.back().time_;
 }
 
-std::list<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const
+std::vector<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const
 {
   if (time >= trajectory_.back().time_)
   {
-    std::list<TrajectoryStep>::const_iterator last = trajectory_.end();
-    last--;
-    return last;
-  }
-  else
-  {
-    if (time < cached_time_)
-    {
-      cached_trajectory_segment_ = trajectory_.begin();
-    }
-    while (time >= cached_trajectory_segment_->time_)
-    {
-      ++cached_trajectory_segment_;
-    }
-    cached_time_ = time;
-    return cached_trajectory_segment_;
+    return trajectory_.end() - 1;
   }
+  // first step after time, but never the first step since the returned segment ends at this step
+  return std::upper_bound(trajectory_.begin() + 1, trajectory_.end(), time,
+                          [](double time, const TrajectoryStep& step) { return time < step.time_; });
+}
+
+std::vector<Trajectory::TrajectoryStep>& Trajectory::getRecycledSteps()
+{
+  thread_local std::vector<TrajectoryStep> steps;
+  return steps;
+}
+
+std::vector<Trajectory::TrajectoryStep>& Trajectory::getRecycledBackwardSteps()
+{
+  thread_local std::vector<TrajectoryStep> steps;
+  return steps;
 }
 
 Eigen::VectorXd Trajectory::getPosition(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -838,8 +924,8 @@ Eigen::VectorXd Trajectory::getPosition(double time) const
 
 Eigen::VectorXd Trajectory::getVelocity(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -856,8 +942,8 @@ Eigen::VectorXd Trajectory::getVelocity(double time) const
 
 Eigen::VectorXd Trajectory::getAcceleration(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -875,66 +961,20 @@ Eigen::VectorXd Trajectory::getAcceleration(double time) const
   return path_acc;
 }
 
-TimeOptimalTrajectoryGeneration::TimeOptimalTrajectoryGeneration(const double path_tolerance, const double resample_dt,
-                                                                 const double min_angle_change)
-  : path_tolerance_(path_tolerance), resample_dt_(resample_dt), min_angle_change_(min_angle_change)
+namespace
 {
-}
-
-bool TimeOptimalTrajectoryGeneration::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
-                                                        const double max_velocity_scaling_factor,
-                                                        const double max_acceleration_scaling_factor) const
+// Get the scaled velocity and acceleration limits of the variables of group
+bool getGroupLimits(const moveit::core::JointModelGroup* group, double velocity_scaling_factor,
+                    double acceleration_scaling_factor, Eigen::VectorXd& max_velocity,
+                    Eigen::VectorXd& max_acceleration)
 {
-  if (trajectory.empty())
-    return true;
-
-  const moveit::core::JointModelGroup* group = trajectory.getGroup();
-  if (!group)
-  {
-    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set the group the plan was computed for");
-    return false;
-  }
-
-  // Validate scaling
-  double velocity_scaling_factor = 1.0;
-  if (max_velocity_scaling_factor > 0.0 && max_velocity_scaling_factor <= 1.0)
-  {
-    velocity_scaling_factor = max_velocity_scaling_factor;
-  }
-  else if (max_velocity_scaling_factor == 0.0)
-  {
-    RCLCPP_DEBUG(LOGGER, "A max_velocity_scaling_factor of 0.0 was specified, defaulting to %f instead.",
-                 velocity_scaling_factor);
-  }
-  else
-  {
-    RCLCPP_WARN(LOGGER, "Invalid max_velocity_scaling_factor %f specified, defaulting to %f instead.",
-                max_velocity_scaling_factor, velocity_scaling_factor);
-  }
-
-  double acceleration_scaling_factor = 1.0;
-  if (max_acceleration_scaling_factor > 0.0 && max_acceleration_scaling_factor <= 1.0)
-  {
-    acceleration_scaling_factor = max_acceleration_scaling_factor;
-  }
-  else if (max_acceleration_scaling_factor == 0.0)
-  {
-    RCLCPP_DEBUG(LOGGER, "A max_acceleration_scaling_factor of 0.0 was specified, defaulting to %f instead.",
-                 acceleration_scaling_factor);
-  }
-  else
-  {
-    RCLCPP_WARN(LOGGER, "Invalid max_acceleration_scaling_factor %f specified, defaulting to %f instead.",
-                max_acceleration_scaling_factor, acceleration_scaling_factor);
-  }
-
   const std::vector<std::string>& vars = group->getVariableNames();
   const moveit::core::RobotModel& rmodel = group->getParentModel();
   const unsigned num_joints = group->getVariableCount();
 
   // Get the vel/accel limits
-  Eigen::VectorXd max_velocity(num_joints);
-  Eigen::VectorXd max_acceleration(num_joints);
+  max_velocity.resize(num_joints);
+  max_acceleration.resize(num_joints);
   for (size_t j = 0; j < num_joints; ++j)
   {
     const moveit::core::VariableBounds& bounds = rmodel.getVariableBounds(vars[j]);
@@ -980,6 +1020,115 @@ bool TimeOptimalTrajectoryGeneration::computeTimeStamps(robot_trajectory::RobotT
     }
   }
 
+  return true;
+}
+
+// Return the scaling factor if it is valid, 1.0 otherwise
+double verifyScalingFactor(const double requested_factor, const char* name)
+{
+  constexpr double DEFAULT_FACTOR = 1.0;
+  if (requested_factor > 0.0 && requested_factor <= 1.0)
+  {
+    return requested_factor;
+  }
+  else if (requested_factor == 0.0)
+  {
+    RCLCPP_DEBUG(LOGGER, "A %s of 0.0 was specified, defaulting to %f instead.", name, DEFAULT_FACTOR);
+  }
+  else
+  {
+    RCLCPP_WARN(LOGGER, "Invalid %s %f specified, defaulting to %f instead.", name, requested_factor,
+                DEFAULT_FACTOR);
+  }
+  return DEFAULT_FACTOR;
+}
+
+bool getScaledGroupLimits(const moveit::core::JointModelGroup* group, const double max_velocity_scaling_factor,
+                          const double max_acceleration_scaling_factor, Eigen::VectorXd& max_velocity,
+                          Eigen::VectorXd& max_acceleration)
+{
+  return getGroupLimits(group, verifyScalingFactor(max_velocity_scaling_factor, "max_velocity_scaling_factor"),
+                        verifyScalingFactor(max_acceleration_scaling_factor, "max_acceleration_scaling_factor"),
+                        max_velocity, max_acceleration);
+}
+
+// Call function(t, position, velocity, acceleration) for the samples of parameterized every sample_dt and its end
+template <typename SampleFunction>
+void sampleTrajectory(const Trajectory& parameterized, const double sample_dt, const SampleFunction& function)
+{
+  const size_t sample_count = static_cast<size_t>(std::ceil(parameterized.getDuration() / sample_dt));
+  for (size_t sample = 0; sample <= sample_count; ++sample)
+  {
+    // always sample the end of the trajectory as well
+    const double t = std::min(parameterized.getDuration(), sample * sample_dt);
+    function(t, parameterized.getPosition(t), parameterized.getVelocity(t), parameterized.getAcceleration(t));
+  }
+}
+}  // namespace
+
+double Trajectory::getPathVelocity(double time) const
+{
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
+  previous--;
+
+  double time_step = it->time_ - previous->time_;
+  const double acceleration =
+      2.0 * (it->path_pos_ - previous->path_pos_ - time_step * previous->path_vel_) / (time_step * time_step);
+
+  time_step = time - previous->time_;
+  return previous->path_vel_ + time_step * acceleration;
+}
+
+double Trajectory::getTimeAtPathPosition(double path_pos) const
+{
+  // the path position is nondecreasing along the trajectory
+  const auto it =
+      std::upper_bound(trajectory_.begin() + 1, trajectory_.end(), path_pos,
+                       [](double path_pos, const TrajectoryStep& step) { return path_pos < step.path_pos_; });
+  if (it == trajectory_.end())
+    return trajectory_.back().time_;
+  const std::vector<TrajectoryStep>::const_iterator previous = it - 1;
+
+  const double time_step = it->time_ - previous->time_;
+  const double acceleration =
+      2.0 * (it->path_pos_ - previous->path_pos_ - time_step * previous->path_vel_) / (time_step * time_step);
+
+  // solve path_pos = previous->path_pos_ + t * previous->path_vel_ + 0.5 * t * t * acceleration for t
+  const double distance = std::max(0.0, path_pos - previous->path_pos_);
+  const double denominator =
+      previous->path_vel_ +
+      std::sqrt(std::max(0.0, previous->path_vel_ * previous->path_vel_ + 2.0 * acceleration * distance));
+  const double t = denominator > 0.0 ? 2.0 * distance / denominator : 0.0;
+  return previous->time_ + std::min(t, time_step);
+}
+
+TimeOptimalTrajectoryGeneration::TimeOptimalTrajectoryGeneration(const double path_tolerance, const double resample_dt,
+                                                                 const double min_angle_change)
+  : path_tolerance_(path_tolerance), resample_dt_(resample_dt), min_angle_change_(min_angle_change)
+{
+}
+
+bool TimeOptimalTrajectoryGeneration::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
+                                                        const double max_velocity_scaling_factor,
+                                                        const double max_acceleration_scaling_factor) const
+{
+  if (trajectory.empty())
+    return true;
+
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+
+  Eigen::VectorXd max_velocity;
+  Eigen::VectorXd max_acceleration;
+  if (!getScaledGroupLimits(group, max_velocity_scaling_factor, max_acceleration_scaling_factor, max_velocity,
+                            max_acceleration))
+    return false;
+
   return doTimeParameterizationCalculations(trajectory, max_velocity, max_acceleration);
 }
 
@@ -1073,9 +1222,10 @@ bool TimeOptimalTrajectoryGeneration::computeTimeStamps(
   return doTimeParameterizationCalculations(trajectory, max_velocity, max_acceleration);
 }
 
-bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_trajectory::RobotTrajectory& trajectory,
-                                                                         const Eigen::VectorXd& max_velocity,
-                                                                         const Eigen::VectorXd& max_acceleration) const
+bool TimeOptimalTrajectoryGeneration::parameterizePath(robot_trajectory::RobotTrajectory& trajectory,
+                                                       const Eigen::VectorXd& max_velocity,
+                                                       const Eigen::VectorXd& max_acceleration,
+                                                       std::unique_ptr<Trajectory>& parameterized) const
 {
   // This lib does not actually work properly when angles wrap around, so we need to unwind the path first
   trajectory.unwind();
@@ -1119,8 +1269,32 @@ bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_t
       points.back() = new_point;
   }
 
-  // Return trajectory with only the first waypoint if there are not multiple diverse points
+  // There is nothing to parameterize if there are not multiple diverse points
+  parameterized.reset();
   if (points.size() == 1)
+    return true;
+
+  // Now actually call the algorithm
+  parameterized =
+      std::make_unique<Trajectory>(Path(points, path_tolerance_), max_velocity, max_acceleration, DEFAULT_TIMESTEP);
+  if (!parameterized->isValid())
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to parameterize trajectory.");
+    return false;
+  }
+  return true;
+}
+
+bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_trajectory::RobotTrajectory& trajectory,
+                                                                         const Eigen::VectorXd& max_velocity,
+                                                                         const Eigen::VectorXd& max_acceleration) const
+{
+  std::unique_ptr<Trajectory> parameterized;
+  if (!parameterizePath(trajectory, max_velocity, max_acceleration, parameterized))
+    return false;
+
+  // Return trajectory with only the first waypoint if there are not multiple diverse points
+  if (!parameterized)
   {
     moveit::core::RobotState waypoint = moveit::core::RobotState(trajectory.getWayPoint(0));
     waypoint.zeroVelocities();
@@ -1130,16 +1304,11 @@ bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_t
     return true;
   }
 
-  // Now actually call the algorithm
-  Trajectory parameterized(Path(points, path_tolerance_), max_velocity, max_acceleration, DEFAULT_TIMESTEP);
-  if (!parameterized.isValid())
-  {
-    RCLCPP_ERROR(LOGGER, "Unable to parameterize trajectory.");
-    return false;
-  }
+  const std::vector<int>& idx = trajectory.getGroup()->getVariableIndexList();
+  const unsigned num_joints = idx.size();
 
   // Compute sample count
-  size_t sample_count = std::ceil(parameterized.getDuration() / resample_dt_);
+  size_t sample_count = std::ceil(parameterized->getDuration() / resample_dt_);
 
   // Resample and fill in trajectory
   moveit::core::RobotState waypoint = moveit::core::RobotState(trajectory.getWayPoint(0));
@@ -1148,10 +1317,10 @@ bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_t
   for (size_t sample = 0; sample <= sample_count; ++sample)
   {
     // always sample the end of the trajectory as well
-    double t = std::min(parameterized.getDuration(), sample * resample_dt_);
-    Eigen::VectorXd position = parameterized.getPosition(t);
-    Eigen::VectorXd velocity = parameterized.getVelocity(t);
-    Eigen::VectorXd acceleration = parameterized.getAcceleration(t);
+    double t = std::min(parameterized->getDuration(), sample * resample_dt_);
+    Eigen::VectorXd position = parameterized->getPosition(t);
+    Eigen::VectorXd velocity = parameterized->getVelocity(t);
+    Eigen::VectorXd acceleration = parameterized->getAcceleration(t);
 
     for (size_t j = 0; j < num_joints; ++j)
     {
@@ -1164,6 +1333,288 @@ bool TimeOptimalTrajectoryGeneration::doTimeParameterizationCalculations(robot_t
     last_t = t;
   }
 
+  return tru
+bool TimeOptimalTrajectoryGeneration::computeJointTrajectory(robot_trajectory::RobotTrajectory& trajectory,
+                                                             const double sample_dt,
+                                                             trajectory_msgs::msg::JointTrajectory& joint_trajectory,
+                                                             const double max_velocity_scaling_factor,
+                                                             const double max_acceleration_scaling_factor) const
+{
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+  if (sample_dt <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "Invalid sample_dt %f specified, must be greater than 0.0", sample_dt);
+    return false;
+  }
+
+  // Only the single-DOF joints are part of a JointTrajectory
+  joint_trajectory.joint_names.clear();
+  joint_trajectory.points.clear();
+  std::vector<int> variable_indices;
+  for (const moveit::core::JointModel* joint : group->getActiveJointModels())
+  {
+    if (joint->getVariableCount() == 1)
+    {
+      joint_trajectory.joint_names.push_back(joint->getName());
+      variable_indices.push_back(group->getVariableGroupIndex(joint->getName()));
+    }
+  }
+  if (trajectory.empty())
+    return true;
+
+  Eigen::VectorXd max_velocity;
+  Eigen::VectorXd max_acceleration;
+  std::unique_ptr<Trajectory> parameterized;
+  if (!getScaledGroupLimits(group, max_velocity_scaling_factor, max_acceleration_scaling_factor, max_velocity,
+                            max_acceleration) ||
+      !parameterizePath(trajectory, max_velocity, max_acceleration, parameterized))
+    return false;
+
+  const auto add_point = [&](double t, const Eigen::VectorXd& position, const Eigen::VectorXd& velocity,
+                             const Eigen::VectorXd& acceleration) {
+    trajectory_msgs::msg::JointTrajectoryPoint& point = joint_trajectory.points.emplace_back();
+    point.positions.resize(variable_indices.size());
+    point.velocities.resize(variable_indices.size());
+    point.accelerations.resize(variable_indices.size());
+    for (size_t j = 0; j < variable_indices.size(); ++j)
+    {
+      point.positions[j] = position[variable_indices[j]];
+      point.velocities[j] = velocity[variable_indices[j]];
+      point.accelerations[j] = acceleration[variable_indices[j]];
+    }
+    point.time_from_start = rclcpp::Duration::from_seconds(t);
+  };
+
+  if (!parameterized)
+  {
+    Eigen::VectorXd position;
+    trajectory.getWayPoint(0).copyJointGroupPositions(group, position);
+    const Eigen::VectorXd zero = Eigen::VectorXd::Zero(position.size());
+    add_point(0.0, position, zero, zero);
+    return true;
+  }
+
+  joint_trajectory.points.reserve(static_cast<size_t>(std::ceil(parameterized->getDuration() / sample_dt)) + 1);
+  sampleTrajectory(*parameterized, sample_dt, add_point);
   return true;
 }
+
+bool TimeOptimalTrajectoryGeneration::computeDenseTrajectory(robot_trajectory::RobotTrajectory& trajectory,
+                                                             const double sample_dt,
+                                                             robot_trajectory::DenseRobotTrajectory& dense_trajectory,
+                                                             const double max_velocity_scaling_factor,
+                                                             const double max_acceleration_scaling_factor) const
+{
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+  if (sample_dt <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "Invalid sample_dt %f specified, must be greater than 0.0", sample_dt);
+    return false;
+  }
+  if (trajectory.empty())
+  {
+    dense_trajectory.resize(0);
+    return true;
+  }
+
+  Eigen::VectorXd max_velocity;
+  Eigen::VectorXd max_acceleration;
+  std::unique_ptr<Trajectory> parameterized;
+  if (!getScaledGroupLimits(group, max_velocity_scaling_factor, max_acceleration_scaling_factor, max_velocity,
+                            max_acceleration) ||
+      !parameterizePath(trajectory, max_velocity, max_acceleration, parameterized))
+    return false;
+
+  dense_trajectory = robot_trajectory::DenseRobotTrajectory(group, trajectory.getWayPoint(0));
+  dense_trajectory.enableVelocitiesAndAccelerations();
+  if (!parameterized)
+  {
+    Eigen::VectorXd position;
+    trajectory.getWayPoint(0).copyJointGroupPositions(group, position);
+    const Eigen::VectorXd zero = Eigen::VectorXd::Zero(position.size());
+    dense_trajectory.addSuffixWayPoint(position, zero, zero, 0.0);
+    return true;
+  }
+
+  // Write the samples directly into the preallocated matrices
+  dense_trajectory.resize(static_cast<size_t>(std::ceil(parameterized->getDuration() / sample_dt)) + 1);
+  Eigen::Index sample = 0;
+  double last_t = 0.0;
+  sampleTrajectory(*parameterized, sample_dt,
+                   [&](double t, const Eigen::VectorXd& position, const Eigen::VectorXd& velocity,
+                       const Eigen::VectorXd& acceleration) {
+                     dense_trajectory.getPositions().col(sample) = position;
+                     dense_trajectory.getVelocities().col(sample) = velocity;
+                     dense_trajectory.getAccelerations().col(sample) = acceleration;
+                     dense_trajectory.getWayPointDurations()[sample] = t - last_t;
+                     last_t = t;
+                     ++sample;
+                   });
+  return true;
+}
+e;
+}
+
+OnlineTimeOptimalTrajectoryGeneration::OnlineTimeOptimalTrajectoryGeneration(
+    const moveit::core::JointModelGroup* group, std::size_t lookahead, const double path_tolerance,
+    const double resample_dt, const double max_velocity_scaling_factor, const double max_acceleration_scaling_factor)
+  : group_(group)
+  , lookahead_(std::max<std::size_t>(1, lookahead))
+  , path_tolerance_(path_tolerance)
+  , resample_dt_(resample_dt)
+{
+  valid_limits_ = getScaledGroupLimits(group_, max_velocity_scaling_factor, max_acceleration_scaling_factor,
+                                       max_velocity_, max_acceleration_);
+  reset();
+}
+
+void OnlineTimeOptimalTrajectoryGeneration::addWaypoint(const moveit::core::RobotState& waypoint)
+{
+  if (finished_)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot add waypoints to a finished path");
+    return;
+  }
+  if (!reference_state_)
+    reference_state_ = std::make_shared<moveit::core::RobotState>(waypoint);
+
+  const std::vector<int>& idx = group_->getVariableIndexList();
+  Eigen::VectorXd point(idx.size());
+  for (std::size_t j = 0; j < idx.size(); ++j)
+    point[j] = waypoint.getVariablePosition(idx[j]);
+
+  // repeated points break the path (https://github.com/tobiaskunz/trajectories/issues/3)
+  if (!waypoints_.empty() && (point - waypoints_.back()).cwiseAbs().maxCoeff() <= DEFAULT_MIN_ANGLE_CHANGE)
+    return;
+  waypoints_.push_back(point);
+}
+
+void OnlineTimeOptimalTrajectoryGeneration::finish()
+{
+  finished_ = true;
+}
+
+void OnlineTimeOptimalTrajectoryGeneration::reset()
+{
+  waypoints_.clear();
+  reference_state_.reset();
+  emitted_ = false;
+  started_ = false;
+  start_path_vel_ = 0.0;
+  finished_ = false;
+  done_ = false;
+  previous_window_.reset();
+  previous_handoff_time_ = 0.0;
+  previous_window_end_ = 0;
+}
+
+bool OnlineTimeOptimalTrajectoryGeneration::isDone() const
+{
+  return done_;
+}
+
+bool OnlineTimeOptimalTrajectoryGeneration::getNextSegment(robot_trajectory::RobotTrajectory& segment)
+{
+  if (done_ || !valid_limits_)
+    return false;
+  // a window that is not the last one needs a handover point after its start
+  if (!finished_ && waypoints_.size() < lookahead_ + (started_ ? 2 : 1))
+    return false;
+
+  segment.clear();
+  if (waypoints_.size() < 2)
+  {
+    // finished path with a single waypoint
+    if (!waypoints_.empty() && !emitted_)
+    {
+      moveit::core::RobotState waypoint(*reference_state_);
+      waypoint.setJointGroupPositions(group_, waypoints_.front());
+      waypoint.zeroVelocities();
+      waypoint.zeroAccelerations();
+      segment.addSuffixWayPoint(waypoint, 0.0);
+    }
+    done_ = true;
+    return !segment.empty();
+  }
+
+  const Path path(std::list<Eigen::VectorXd>(waypoints_.begin(), waypoints_.end()), path_tolerance_);
+  auto window = std::make_unique<Trajectory>(path, max_velocity_, max_acceleration_, DEFAULT_TIMESTEP,
+                                             started_ ? path.getWaypointMidpointPosition(0) : 0.0, start_path_vel_);
+  if (!window->isValid())
+  {
+    if (!previous_window_)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to parameterize trajectory.");
+      return false;
+    }
+    // stop at the end of the previous window and continue from rest
+    RCLCPP_WARN(LOGGER, "Unable to continue the previous segment, stopping at its last waypoint.");
+    appendSamples(*previous_window_, previous_handoff_time_, previous_window_->getDuration(), false, segment);
+    waypoints_.erase(waypoints_.begin(), waypoints_.begin() + previous_window_end_);
+    started_ = false;
+    start_path_vel_ = 0.0;
+    previous_window_.reset();
+    done_ = finished_ && waypoints_.size() < 2;
+    return true;
+  }
+
+  if (finished_)
+  {
+    appendSamples(*window, 0.0, window->getDuration(), !emitted_, segment);
+    waypoints_.clear();
+    previous_window_.reset();
+    emitted_ = true;
+    done_ = true;
+    return true;
+  }
+
+  // hand over in the middle between the waypoints lookahead_ and lookahead_ + 1 before the end of the window
+  const std::size_t handoff_index = waypoints_.size() - 1 - lookahead_;
+  const double handoff_time = window->getTimeAtPathPosition(path.getWaypointMidpointPosition(handoff_index));
+  appendSamples(*window, 0.0, handoff_time, !emitted_, segment);
+  start_path_vel_ = window->getPathVelocity(handoff_time);
+  waypoints_.erase(waypoints_.begin(), waypoints_.begin() + handoff_index);
+  previous_window_end_ = waypoints_.size() - 1;
+  previous_handoff_time_ = handoff_time;
+  previous_window_ = std::move(window);
+  emitted_ = true;
+  started_ = true;
+  return true;
+}
+
+void OnlineTimeOptimalTrajectoryGeneration::appendSamples(const Trajectory& trajectory, double begin, double end,
+                                                          bool include_begin,
+                                                          robot_trajectory::RobotTrajectory& segment)
+{
+  const std::vector<int>& idx = group_->getVariableIndexList();
+  moveit::core::RobotState waypoint(*reference_state_);
+  const std::size_t sample_count = static_cast<std::size_t>(std::ceil((end - begin) / resample_dt_));
+  double last_t = begin;
+  for (std::size_t sample = include_begin ? 0 : 1; sample <= sample_count; ++sample)
+  {
+    // always sample the end as well
+    const double t = std::min(end, begin + sample * resample_dt_);
+    const Eigen::VectorXd position = trajectory.getPosition(t);
+    const Eigen::VectorXd velocity = trajectory.getVelocity(t);
+    const Eigen::VectorXd acceleration = trajectory.getAcceleration(t);
+    for (std::size_t j = 0; j < idx.size(); ++j)
+    {
+      waypoint.setVariablePosition(idx[j], position[j]);
+      waypoint.setVariableVelocity(idx[j], velocity[j]);
+      waypoint.setVariableAcceleration(idx[j], acceleration[j]);
+    }
+    segment.addSuffixWayPoint(waypoint, t - last_t);
+    last_t = t;
+  }
+}
 }  // namespace trajectory_processing
@@ -126,6 +126,30 @@ TEST_F(RuckigTests, trajectory_duration)
   EXPECT_LT(trajectory_->getWayPointDurationFromStart(trajectory_->getWayPointCount() - 1), 1.5 * ideal_duration);
 }
 
+TEST_F(RuckigTests, independent_parts)
+{
+  // The trajectory is at rest at every waypoint, so the segments are smoothed independently and only the segment
+  // which is too fast has to be extended
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.setVariablePosition("panda_joint1", 0.0);
+  robot_state.update();
+  trajectory_->addSuffixWayPoint(robot_state, 0.0);
+
+  robot_state.setVariablePosition("panda_joint1", 0.001);
+  robot_state.update();
+  trajectory_->addSuffixWayPoint(robot_state, DEFAULT_TIMESTEP);
+
+  robot_state.setVariablePosition("panda_joint1", 0.2);
+  robot_state.update();
+  trajectory_->addSuffixWayPoint(robot_state, DEFAULT_TIMESTEP);
+
+  EXPECT_TRUE(
+      smoother_.applySmoothing(*trajectory_, 1.0 /* max vel scaling factor */, 1.0 /* max accel scaling factor */));
+  EXPECT_DOUBLE_EQ(trajectory_->getWayPointDurationFromPrevious(1), DEFAULT_TIMESTEP);
+  EXPECT_GT(trajectory_->getWayPointDurationFromPrevious(2), DEFAULT_TIMESTEP);
+}
+
 TEST_F(RuckigTests, single_waypoint)
 {
   // With only one waypoint, Ruckig cannot smooth the trajectory.
@@ -39,7 +39,9 @@
 #include <gtest/gtest.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <rclcpp/duration.hpp>
 
+using trajectory_processing::OnlineTimeOptimalTrajectoryGeneration;
 using trajectory_processing::Path;
 using trajectory_processing::TimeOptimalTrajectoryGeneration;
 using trajectory_processing::Trajectory;
@@ -526,6 +528,106 @@ TEST(time_optimal_trajectory_generation, testTimeStepZeroMakesTrajectoryInvalid)
                    .isValid());
 }
 
+TEST(time_optimal_trajectory_generation, testJointTrajectorySampling)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE((bool)robot_model);
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("panda_arm");
+  ASSERT_TRUE((bool)group);
+  moveit::core::RobotState waypoint_state(robot_model);
+  waypoint_state.setToDefaultValues();
+
+  robot_trajectory::RobotTrajectory trajectory(robot_model, group);
+  waypoint_state.setJointGroupPositions(group, std::vector<double>{ -0.5, -1.52, 1.35, -2.51, -0.88, 0.63, 0.0 });
+  trajectory.addSuffixWayPoint(waypoint_state, 0.0);
+  waypoint_state.setJointGroupPositions(group, std::vector<double>{ 0.0, -1.5, 1.4, -1.2, -1.0, -0.2, 0.0 });
+  trajectory.addSuffixWayPoint(waypoint_state, 0.0);
+  waypoint_state.setJointGroupPositions(group, std::vector<double>{ 0.3, -1.0, 1.0, -1.5, -0.5, 0.2, 0.5 });
+  trajectory.addSuffixWayPoint(waypoint_state, 0.0);
+
+  // sampling directly into a message matches the resampled RobotTrajectory
+  constexpr double sample_dt = 0.01;
+  TimeOptimalTrajectoryGeneration totg(0.1, sample_dt);
+  trajectory_msgs::msg::JointTrajectory joint_trajectory;
+  robot_trajectory::DenseRobotTrajectory dense_trajectory(group, waypoint_state);
+  ASSERT_TRUE(totg.computeJointTrajectory(trajectory, sample_dt, joint_trajectory));
+  ASSERT_TRUE(totg.computeDenseTrajectory(trajectory, sample_dt, dense_trajectory));
+  ASSERT_TRUE(totg.computeTimeStamps(trajectory));
+
+  ASSERT_EQ(joint_trajectory.joint_names, group->getActiveJointModelNames());
+  ASSERT_EQ(joint_trajectory.points.size(), trajectory.getWayPointCount());
+  ASSERT_EQ(dense_trajectory.getWayPointCount(), trajectory.getWayPointCount());
+  EXPECT_NEAR(dense_trajectory.getDuration(), trajectory.getDuration(), 1e-9);
+  const std::vector<int>& idx = group->getVariableIndexList();
+  for (size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+  {
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+    EXPECT_NEAR(rclcpp::Duration(joint_trajectory.points[i].time_from_start).seconds(),
+                trajectory.getWayPointDurationFromStart(i), 1e-6);
+    for (size_t j = 0; j < idx.size(); ++j)
+    {
+      EXPECT_NEAR(joint_trajectory.points[i].positions[j], waypoint.getVariablePosition(idx[j]), 1e-9);
+      EXPECT_NEAR(joint_trajectory.points[i].velocities[j], waypoint.getVariableVelocity(idx[j]), 1e-9);
+      EXPECT_NEAR(dense_trajectory.getPositions()(j, i), waypoint.getVariablePosition(idx[j]), 1e-9);
+      EXPECT_NEAR(dense_trajectory.getAccelerations()(j, i), waypoint.getVariableAcceleration(idx[j]), 1e-9);
+    }
+  }
+}
+
+TEST(time_optimal_trajectory_generation, testOnlineParameterization)
+{
+  auto robot_model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE((bool)robot_model);
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("panda_arm");
+  ASSERT_TRUE((bool)group);
+  moveit::core::RobotState waypoint_state(robot_model);
+  waypoint_state.setToDefaultValues();
+
+  // stream a curved path, emitting segments as soon as they are available
+  OnlineTimeOptimalTrajectoryGeneration online(group, /*lookahead=*/3);
+  robot_trajectory::RobotTrajectory streamed(robot_model, group);
+  robot_trajectory::RobotTrajectory segment(robot_model, group);
+  std::vector<double> positions(group->getVariableCount());
+  constexpr std::size_t waypoint_count = 20;
+  for (std::size_t i = 0; i < waypoint_count; ++i)
+  {
+    for (std::size_t j = 0; j < positions.size(); ++j)
+      positions[j] = 0.4 * std::sin(0.2 * i + j);
+    waypoint_state.setJointGroupPositions(group, positions);
+    online.addWaypoint(waypoint_state);
+    while (online.getNextSegment(segment))
+      streamed.append(segment, 0.0);
+    // segments are only emitted with enough lookahead
+    EXPECT_EQ(streamed.empty(), i < 3);
+  }
+  online.finish();
+  while (online.getNextSegment(segment))
+    streamed.append(segment, 0.0);
+  EXPECT_TRUE(online.isDone());
+  ASSERT_GT(streamed.getWayPointCount(), 2u);
+
+  // the joined segments start and stop at rest at the first and last waypoint and stay within the velocity limits
+  const std::vector<int>& idx = group->getVariableIndexList();
+  const std::vector<std::string>& names = group->getVariableNames();
+  for (std::size_t j = 0; j < idx.size(); ++j)
+  {
+    EXPECT_NEAR(streamed.getFirstWayPoint().getVariablePosition(idx[j]), 0.4 * std::sin(j), 1e-6);
+    EXPECT_NEAR(streamed.getLastWayPoint().getVariablePosition(idx[j]), positions[j], 1e-4);
+    EXPECT_NEAR(streamed.getFirstWayPoint().getVariableVelocity(idx[j]), 0.0, 1e-6);
+    EXPECT_NEAR(streamed.getLastWayPoint().getVariableVelocity(idx[j]), 0.0, 1e-3);
+    const double max_velocity = robot_model->getVariableBounds(names[j]).max_velocity_;
+    for (std::size_t i = 0; i < streamed.getWayPointCount(); ++i)
+    {
+      EXPECT_LE(std::abs(streamed.getWayPoint(i).getVariableVelocity(idx[j])), max_velocity + 1e-3);
+      // the segments join without jumps
+      if (i > 0)
+        EXPECT_LE(std::abs(streamed.getWayPoint(i).getVariablePosition(idx[j]) -
+                           streamed.getWayPoint(i - 1).getVariablePosition(idx[j])),
+                  max_velocity * streamed.getWayPointDurationFromPrevious(i) + 1e-3);
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
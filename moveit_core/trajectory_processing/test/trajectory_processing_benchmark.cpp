@@ -0,0 +1,111 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Google Benchmark micro-benchmarks of time parameterization and smoothing on seeded reference paths of the
+   Panda arm. */
+
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/ruckig_traj_smoothing.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <random_numbers/random_numbers.h>
+#include <benchmark/benchmark.h>
+
+namespace
+{
+constexpr unsigned int RANDOM_SEED = 42;
+constexpr char JOINT_GROUP[] = "panda_arm";
+constexpr std::size_t NUM_SEGMENTS = 5;
+
+// Reference path through seeded random configurations, densely interpolated like the output of a sampling planner
+robot_trajectory::RobotTrajectory makeReferencePath(std::size_t waypoints_per_segment)
+{
+  static const moveit::core::RobotModelPtr ROBOT_MODEL = moveit::core::loadTestingRobotModel("panda");
+  const moveit::core::JointModelGroup* group = ROBOT_MODEL->getJointModelGroup(JOINT_GROUP);
+  random_numbers::RandomNumberGenerator rng(RANDOM_SEED);
+
+  robot_trajectory::RobotTrajectory trajectory(ROBOT_MODEL, group);
+  moveit::core::RobotState from(ROBOT_MODEL);
+  from.setToDefaultValues();
+  moveit::core::RobotState to(from);
+  moveit::core::RobotState waypoint(from);
+  for (std::size_t segment = 0; segment < NUM_SEGMENTS; ++segment)
+  {
+    to.setToRandomPositions(group, rng);
+    for (std::size_t i = 0; i < waypoints_per_segment; ++i)
+    {
+      from.interpolate(to, static_cast<double>(i) / waypoints_per_segment, waypoint, group);
+      trajectory.addSuffixWayPoint(waypoint, 0.0);
+    }
+    from = to;
+  }
+  trajectory.addSuffixWayPoint(to, 0.0);
+  return trajectory;
+}
+}  // namespace
+
+static void timeOptimalTrajectoryGeneration(benchmark::State& st)
+{
+  const robot_trajectory::RobotTrajectory reference_path = makeReferencePath(st.range(0));
+  const trajectory_processing::TimeOptimalTrajectoryGeneration totg;
+  for (auto _ : st)
+  {
+    st.PauseTiming();
+    robot_trajectory::RobotTrajectory trajectory(reference_path, true /* deepcopy */);
+    st.ResumeTiming();
+    benchmark::DoNotOptimize(totg.computeTimeStamps(trajectory));
+  }
+  st.SetItemsProcessed(st.iterations() * reference_path.size());
+}
+BENCHMARK(timeOptimalTrajectoryGeneration)->Arg(2)->Arg(10)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+static void ruckigSmoothing(benchmark::State& st)
+{
+  // Ruckig smooths an already time parameterized trajectory
+  robot_trajectory::RobotTrajectory reference_trajectory = makeReferencePath(st.range(0));
+  trajectory_processing::TimeOptimalTrajectoryGeneration().computeTimeStamps(reference_trajectory);
+  for (auto _ : st)
+  {
+    st.PauseTiming();
+    robot_trajectory::RobotTrajectory trajectory(reference_trajectory, true /* deepcopy */);
+    st.ResumeTiming();
+    benchmark::DoNotOptimize(trajectory_processing::RuckigSmoothing::applySmoothing(trajectory));
+  }
+  st.SetItemsProcessed(st.iterations() * reference_trajectory.size());
+}
+BENCHMARK(ruckigSmoothing)->Arg(2)->Arg(10)->Arg(50)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
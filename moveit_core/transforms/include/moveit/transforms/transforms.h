@@ -40,6 +40,7 @@
 #include <Eigen/Geometry>
 #include <moveit/macros/class_forward.h>
 #include <map>
+#include <vector>
 
 namespace moveit
 {
@@ -52,6 +53,36 @@ MOVEIT_CLASS_FORWARD(Transforms);  // Defines TransformsPtr, ConstPtr, WeakPtr..
 using FixedTransformsMap = std::map<std::string, Eigen::Isometry3d, std::less<std::string>,
                                     Eigen::aligned_allocator<std::pair<const std::string, Eigen::Isometry3d> > >;
 
+/** @brief A frame name resolved once, so that repeated transform lookups for it avoid string comparisons.
+    Handles are obtained from Transforms::getFrameHandle() (or planning_scene::PlanningScene::getFrameHandle()) and
+    remain valid as long as the frame keeps its meaning: fixed frame ids are interned process-wide and robot link
+    indices are fixed for a robot model. */
+struct FrameHandle
+{
+  enum Type
+  {
+    /** \brief The frame could not be resolved */
+    UNKNOWN,
+    /** \brief A fixed transform maintained by Transforms; index is its interned frame id */
+    FIXED_FRAME,
+    /** \brief A robot link; index is the link index in the robot model */
+    ROBOT_LINK,
+    /** \brief An attached body, a world object or one of their subframes; these are looked up by name */
+    OBJECT_FRAME
+  };
+
+  /** \brief Whether the frame was resolved */
+  bool isValid() const
+  {
+    return type != UNKNOWN;
+  }
+
+  Type type = UNKNOWN;
+  std::size_t index = 0;
+  /** \brief The resolved frame name, without a leading '/' */
+  std::string name;
+};
+
 /** @brief Provides an implementation of a snapshot of a transform tree that can be easily queried for
     transforming different quantities. Transforms are maintained as a list of transforms to a particular frame.
     All stored transforms are considered fixed. */
@@ -206,9 +237,41 @@ public:
    */
   virtual const Eigen::Isometry3d& getTransform(const std::string& from_frame) const;
 
+  /**
+   * \name Resolving frames ahead of time
+   */
+  /**@{*/
+
+  /**
+   * @brief Get the id that \e frame is interned under, adding it to the process-wide frame registry if needed.
+   * Ids never change and are shared by all Transforms instances.
+   */
+  static std::size_t getFrameId(const std::string& frame);
+
+  /**
+   * @brief Resolve \e frame once so that getTransform(const FrameHandle&) can be called repeatedly
+   * without string lookups
+   * @return The handle, which is not valid if canTransform(frame) is false
+   */
+  virtual FrameHandle getFrameHandle(const std::string& frame) const;
+
+  /**
+   * @brief Get transform for a frame previously resolved with getFrameHandle() (w.r.t target frame)
+   * @return The required transform. It is guaranteed to be a valid isometry.
+   */
+  virtual const Eigen::Isometry3d& getTransform(const FrameHandle& frame) const;
+
+  /**@}*/
+
 protected:
+  /** \brief Point the entry for the interned id of \e frame at its transform in transforms_map_ */
+  void indexTransform(const std::string& frame, const Eigen::Isometry3d& transform);
+
   std::string target_frame_;
   FixedTransformsMap transforms_map_;
+
+  /** \brief Elements of transforms_map_ indexed by interned frame id; nullptr for frames without a transform */
+  std::vector<const Eigen::Isometry3d*> transforms_by_id_;
 };
 }  // namespace core
 }  // namespace moveit
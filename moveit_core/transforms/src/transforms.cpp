@@ -40,6 +40,9 @@
 #include <rclcpp/logging.hpp>
 #include <tf2_eigen/tf2_eigen.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace moveit
 {
@@ -48,6 +51,22 @@ namespace core
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_transforms.transforms");
 
+namespace
+{
+// Frame names interned process-wide, so ids agree between all Transforms instances (e.g. a scene and its diffs)
+struct FrameRegistry
+{
+  std::shared_mutex mutex;
+  std::unordered_map<std::string, std::size_t> ids;
+};
+
+FrameRegistry& getFrameRegistry()
+{
+  static FrameRegistry registry;
+  return registry;
+}
+}  // namespace
+
 Transforms::Transforms(const std::string& target_frame) : target_frame_(target_frame)
 {
   boost::trim(target_frame_);
@@ -57,7 +76,9 @@ Transforms::Transforms(const std::string& target_frame) : target_frame_(target_f
   }
   else
   {
-    transforms_map_[target_frame_] = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d& identity = transforms_map_[target_frame_];
+    identity = Eigen::Isometry3d::Identity();
+    indexTransform(target_frame_, identity);
   }
 }
 
@@ -87,6 +108,9 @@ void Transforms::setAllTransforms(const FixedTransformsMap& transforms)
     ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
   }
   transforms_map_ = transforms;
+  transforms_by_id_.assign(transforms_by_id_.size(), nullptr);
+  for (const auto& t : transforms_map_)
+    indexTransform(t.first, t.second);
 }
 
 bool Transforms::isFixedFrame(const std::string& frame) const
@@ -131,7 +155,11 @@ void Transforms::setTransform(const Eigen::Isometry3d& t, const std::string& fro
     RCLCPP_ERROR(LOGGER, "Cannot record transform with empty name");
   }
   else
-    transforms_map_[from_frame] = t;
+  {
+    Eigen::Isometry3d& stored = transforms_map_[from_frame];
+    stored = t;
+    indexTransform(from_frame, stored);
+  }
 }
 
 void Transforms::setTransform(const geometry_msgs::msg::TransformStamped& transform)
@@ -173,5 +201,47 @@ void Transforms::copyTransforms(std::vector<geometry_msgs::msg::TransformStamped
   }
 }
 
+std::size_t Transforms::getFrameId(const std::string& frame)
+{
+  FrameRegistry& registry = getFrameRegistry();
+  {
+    std::shared_lock<std::shared_mutex> lock(registry.mutex);
+    const auto it = registry.ids.find(frame);
+    if (it != registry.ids.end())
+      return it->second;
+  }
+  std::unique_lock<std::shared_mutex> lock(registry.mutex);
+  return registry.ids.emplace(frame, registry.ids.size()).first->second;
+}
+
+FrameHandle Transforms::getFrameHandle(const std::string& frame) const
+{
+  FrameHandle handle;
+  handle.name = frame;
+  if (!frame.empty() && transforms_map_.find(frame) != transforms_map_.end())
+  {
+    handle.type = FrameHandle::FIXED_FRAME;
+    handle.index = getFrameId(frame);
+  }
+  return handle;
+}
+
+const Eigen::Isometry3d& Transforms::getTransform(const FrameHandle& frame) const
+{
+  if (frame.type == FrameHandle::FIXED_FRAME && frame.index < transforms_by_id_.size() &&
+      transforms_by_id_[frame.index])
+    return *transforms_by_id_[frame.index];
+  // the frame was resolved by a different Transforms instance, or its transform has been removed since
+  return getTransform(frame.name);
+}
+
+void Transforms::indexTransform(const std::string& frame, const Eigen::Isometry3d& transform)
+{
+  const std::size_t id = getFrameId(frame);
+  if (id >= transforms_by_id_.size())
+    transforms_by_id_.resize(id + 1, nullptr);
+  transforms_by_id_[id] = &transform;
+}
+
 }  // end of namespace core
 }  // end of namespace moveit
@@ -61,6 +61,32 @@ TEST(Transforms, Simple)
   EXPECT_TRUE(tf.isFixedFrame("global"));
 }
 
+TEST(Transforms, FrameHandles)
+{
+  moveit::core::Transforms tf("global");
+
+  Eigen::Isometry3d t1(Eigen::Translation3d(1.0, 2.0, 3.0));
+  tf.setTransform(t1, "some_frame_1");
+
+  const moveit::core::FrameHandle handle = tf.getFrameHandle("some_frame_1");
+  ASSERT_TRUE(handle.isValid());
+  EXPECT_EQ(handle.type, moveit::core::FrameHandle::FIXED_FRAME);
+  EXPECT_EQ(handle.index, moveit::core::Transforms::getFrameId("some_frame_1"));
+  EXPECT_TRUE(tf.getTransform(handle).isApprox(t1));
+  EXPECT_TRUE(tf.getTransform(tf.getFrameHandle("global")).isApprox(Eigen::Isometry3d::Identity()));
+  EXPECT_FALSE(tf.getFrameHandle("base_footprint").isValid());
+
+  // handles observe later updates of the transform
+  Eigen::Isometry3d t2(Eigen::Translation3d(0.0, 1.0, 0.0) * Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ()));
+  tf.setTransform(t2, "some_frame_1");
+  EXPECT_TRUE(tf.getTransform(handle).isApprox(t2));
+
+  // frame ids are shared between instances
+  moveit::core::Transforms other("global");
+  other.setAllTransforms(tf.getAllTransforms());
+  EXPECT_TRUE(other.getTransform(handle).isApprox(t2));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,83 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Description: Accounting of the memory held by scenes, trajectories, caches and planner contexts */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace moveit
+{
+/** \brief Estimated memory held by the parts of a component, e.g. its geometry, caches or history.
+ *
+ *  The estimates add up the sizes of the stored elements, but not the overhead of the allocator and of container
+ *  nodes. They are meant for comparing components and for spotting growth, not for matching the resident memory of
+ *  the process. Memory shared between components, e.g. a shape referenced by several scenes, is counted by each. */
+class MemoryUsage
+{
+public:
+  /** \brief Memory of one part */
+  struct Item
+  {
+    std::size_t bytes{ 0 };
+    /** \brief Number of elements, e.g. objects or cache entries */
+    std::size_t count{ 0 };
+  };
+
+  /** \brief Add \e bytes held by \e count elements to the part \e name */
+  void add(const std::string& name, std::size_t bytes, std::size_t count = 1);
+
+  /** \brief Add all parts of \e other, with their names prefixed by \e prefix and a dot */
+  void add(const std::string& prefix, const MemoryUsage& other);
+
+  /** \brief The parts by name */
+  const std::map<std::string, Item>& getItems() const
+  {
+    return items_;
+  }
+
+  /** \brief Sum of the bytes of all parts */
+  std::size_t getTotalBytes() const;
+
+  /** \brief One line "name: bytes bytes, count items" per part */
+  std::string toString() const;
+
+private:
+  std::map<std::string, Item> items_;
+};
+}  // namespace moveit
@@ -0,0 +1,150 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Description: Lightweight counters of the expensive operations a planning request performs */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace moveit
+{
+namespace performance_counters
+{
+/** \brief The operations that are counted */
+enum Counter : std::size_t
+{
+  COLLISION_CHECKS,
+  DISTANCE_QUERIES,
+  FK_UPDATES,
+  IK_CALLS,
+  STATE_VALIDITY_CHECKS,
+  NUM_COUNTERS
+};
+
+/** \brief Name of the counter, e.g. "collision_checks" */
+const char* getCounterName(Counter counter);
+
+/** \brief Counts and accumulated duration of all counters. Durations are only measured for timed counters, i.e. all
+    but FK_UPDATES. */
+struct CounterValues
+{
+  std::array<std::uint64_t, NUM_COUNTERS> counts{};
+  std::array<std::chrono::nanoseconds, NUM_COUNTERS> durations{};
+
+  /** \brief Difference to an earlier snapshot, e.g. the work done by a single planning request */
+  CounterValues operator-(const CounterValues& other) const;
+  CounterValues& operator+=(const CounterValues& other);
+};
+
+/** \brief Counters of the calling thread since it was started */
+CounterValues getThreadCounterValues();
+
+/** \brief Counters summed over all threads, including threads that have exited */
+CounterValues getTotalCounterValues();
+
+namespace detail
+{
+/** \brief Counters of one thread. Only the owning thread writes, so the counters are updated without read-modify-write
+    operations, the atomics only make concurrent reads of other threads well defined. */
+struct ThreadCounters
+{
+  std::array<std::atomic<std::uint64_t>, NUM_COUNTERS> counts{};
+  std::array<std::atomic<std::int64_t>, NUM_COUNTERS> nanoseconds{};
+};
+
+/** \brief Counters of the calling thread, registered for getTotalCounterValues() on first use */
+ThreadCounters& getThreadCounters();
+
+inline void add(std::atomic<std::uint64_t>& value, std::uint64_t increment)
+{
+  value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+}
+
+inline void add(std::atomic<std::int64_t>& value, std::int64_t increment)
+{
+  value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+}
+}  // namespace detail
+
+/** \brief Count one operation in the calling thread */
+inline void increment(Counter counter)
+{
+  detail::add(detail::getThreadCounters().counts[counter], 1);
+}
+
+/** \brief Counts the enclosing scope as one operation and adds the time spent in it */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(Counter counter) : counter_(counter), start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedTimer()
+  {
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start_;
+    detail::ThreadCounters& counters = detail::getThreadCounters();
+    detail::add(counters.counts[counter_], 1);
+    detail::add(counters.nanoseconds[counter_], std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  const Counter counter_;
+  const std::chrono::steady_clock::time_point start_;
+};
+}  // namespace performance_counters
+}  // namespace moveit
+
+// The instrumentation is compiled out unless MoveIt is built with MOVEIT_ENABLE_PERFORMANCE_COUNTERS (the default)
+#ifdef MOVEIT_ENABLE_PERFORMANCE_COUNTERS
+#define MOVEIT_PERFORMANCE_COUNTER_CONCAT_(a, b) a##b
+#define MOVEIT_PERFORMANCE_COUNTER_CONCAT(a, b) MOVEIT_PERFORMANCE_COUNTER_CONCAT_(a, b)
+/** \brief Count one operation, e.g. MOVEIT_PERFORMANCE_COUNT(moveit::performance_counters::FK_UPDATES) */
+#define MOVEIT_PERFORMANCE_COUNT(counter) ::moveit::performance_counters::increment(counter)
+/** \brief Count the enclosing scope as one operation and measure its duration */
+#define MOVEIT_PERFORMANCE_TIMER(counter)                                                                              \
+  const ::moveit::performance_counters::ScopedTimer MOVEIT_PERFORMANCE_COUNTER_CONCAT(moveit_timer_, __LINE__)(counter)
+#else
+#define MOVEIT_PERFORMANCE_COUNT(counter) ((void)0)
+#define MOVEIT_PERFORMANCE_TIMER(counter) ((void)0)
+#endif
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Description: Sampling profiler for individual requests, writing profiles in the collapsed stack format */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace moveit
+{
+namespace profiling
+{
+/** \brief The call stacks sampled while a request was processed */
+struct Profile
+{
+  /** \brief Name passed to ScopedProfile, e.g. the capability serving the request */
+  std::string request_name;
+  /** \brief Process-wide increasing number of the profiled request */
+  std::size_t request_id;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+  std::thread::id thread_id;
+  /** \brief Return addresses of the sampled stacks, innermost frame first */
+  std::vector<std::vector<void*>> stacks;
+  /** \brief Number of samples which did not fit into Options::max_samples */
+  std::size_t dropped_samples;
+};
+
+/** \brief Receives every finished profile. Called from the thread that ran the request, so it needs to be
+    thread-safe. */
+using ProfileSinkFn = std::function<void(const Profile&)>;
+
+struct Options
+{
+  /** \brief CPU time of the profiled thread between two samples */
+  std::chrono::microseconds period{ 1000 };
+  /** \brief Number of samples stored per request, later samples are counted as dropped */
+  std::size_t max_samples{ 10000 };
+  /** \brief Maximum number of frames stored per sample */
+  std::size_t max_depth{ 64 };
+  /** \brief Names of the requests to profile, all requests if empty */
+  std::vector<std::string> requests;
+};
+
+/** \brief Set the function receiving the finished profiles. Passing an empty function disables profiling, which is
+    the default.
+
+    Samples are taken by a CPU time timer of the thread constructing the ScopedProfile, which interrupts it with
+    SIGPROF. This replaces any other SIGPROF handler of the process, so it should not be combined with profilers such
+    as gperftools. Threads started by the request, e.g. for parallel planning, are not sampled. */
+void setProfileSink(const ProfileSinkFn& sink, const Options& options = Options());
+
+/** \brief Whether a profile sink is set */
+bool isEnabled();
+
+/** \brief Samples the call stack of the calling thread while in the enclosing scope, if profiling is enabled and
+    \e request_name is selected by Options::requests.
+
+    Profiles do not nest: a ScopedProfile within the scope of another one of the same thread does nothing. */
+class ScopedProfile
+{
+public:
+  explicit ScopedProfile(const char* request_name);
+  ~ScopedProfile();
+
+  ScopedProfile(const ScopedProfile&) = delete;
+  ScopedProfile& operator=(const ScopedProfile&) = delete;
+
+  /** \brief Whether this scope is sampled */
+  bool isActive() const
+  {
+    return static_cast<bool>(sampler_);
+  }
+
+  /** \brief The id of the profile, or 0 if the scope is not sampled */
+  std::size_t getRequestId() const;
+
+  class Sampler;
+
+private:
+  std::unique_ptr<Sampler> sampler_;
+};
+
+/** \brief Aggregate the stacks of \e profile by the names of their functions, as "outer;inner" without the sampler's
+    own frames. Functions are named by dladdr(), so functions of executables need -rdynamic to be resolved. */
+std::map<std::string, std::size_t> collapseStacks(const Profile& profile);
+
+/** \brief Write the collapsed stacks of \e profile with one "outer;inner count" line per stack, as read by
+    flamegraph.pl, speedscope or inferno */
+void writeCollapsedStacks(const Profile& profile, std::ostream& out);
+}  // namespace profiling
+}  // namespace moveit
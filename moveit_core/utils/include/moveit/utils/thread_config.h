@@ -0,0 +1,94 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Description: Central configuration of the names, priorities and CPU sets of MoveIt's long-running threads */
+
+#pragma once
+
+#include <rclcpp/node.hpp>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace threads
+{
+/** \brief Placement and scheduling of a thread.
+ *
+ *  Threads look up their configuration by name when they start, see configureCurrentThread(). The names used by MoveIt
+ *  are:
+ *  - planning_scene_monitor: the private executor of the PlanningSceneMonitor (state and scene updates)
+ *  - planning_scene_publisher: the scene publishing thread of the PlanningSceneMonitor
+ *  - occupancy_map_updater: threads integrating sensor data into the octomap
+ *  - servo_calcs: the main loop of ServoCalcs
+ *  - servo_collision_check: the thread running the collision checks of servo
+ *  - ompl_planner: the worker threads solving parallel OMPL planning attempts */
+struct ThreadConfig
+{
+  /** \brief Real-time (SCHED_FIFO) priority in [1, 99]; 0 keeps the default scheduling policy */
+  int priority{ 0 };
+  /** \brief CPUs the thread may run on; all CPUs if empty (and no NUMA node is given) */
+  std::vector<int> cpus;
+  /** \brief NUMA node whose CPUs are added to \e cpus; -1 for none */
+  int numa_node{ -1 };
+};
+
+/** \brief Set the configuration of the threads called \e name. Threads already running pick it up the next time they
+ *  call configureCurrentThread(). */
+void setThreadConfig(const std::string& name, const ThreadConfig& config);
+
+/** \brief Get the configuration of the threads called \e name, returns false if there is none */
+bool getThreadConfig(const std::string& name, ThreadConfig& config);
+
+/** \brief Read thread configurations from the parameters of \e node, e.g.
+ *
+ *      thread_config:
+ *        servo_calcs: { priority: 40, cpus: [2, 3] }
+ *        occupancy_map_updater: { numa_node: 1 }
+ *
+ *  Can be called by several components of a process, the configurations are merged. */
+void loadThreadConfigs(const rclcpp::Node::SharedPtr& node);
+
+/** \brief Name the calling thread \e name and apply its configuration, if any.
+ *
+ *  Cheap if the thread was already configured with the same name and the configuration did not change since, so it may
+ *  be called at the top of callbacks that run on executor threads. Returns false if applying the configuration failed,
+ *  e.g. because the process lacks the permission to use real-time priorities. */
+bool configureCurrentThread(const std::string& name);
+
+/** \brief The CPUs of NUMA node \e node, as listed by sysfs; empty if unknown */
+std::vector<int> getNumaNodeCpus(int node);
+}  // namespace threads
+}  // namespace moveit
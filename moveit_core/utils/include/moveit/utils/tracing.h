@@ -0,0 +1,93 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Description: Lightweight tracing of the stages of planning requests */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace moveit
+{
+namespace tracing
+{
+/** \brief A finished span of work, e.g. one stage of a planning request */
+struct Span
+{
+  std::string name;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+  /** \brief Number of spans of the same thread that enclose this one */
+  std::size_t depth;
+  std::thread::id thread_id;
+};
+
+/** \brief Receives every finished span. Called from the thread that ran the span, so it needs to be thread-safe. */
+using SpanSinkFn = std::function<void(const Span&)>;
+
+/** \brief Set the function receiving the finished spans, e.g. an exporter to an external tracing framework.
+    Passing an empty function disables tracing, which is the default. */
+void setSpanSink(const SpanSinkFn& sink);
+
+/** \brief Whether a span sink is set */
+bool isEnabled();
+
+/** \brief Records the time spent in the enclosing scope as a span, if tracing is enabled.
+
+    Spans are cheap when tracing is disabled: the name is not even copied. Nested spans of a thread get an increasing
+    depth, so sinks can reconstruct the hierarchy of the stages. */
+class ScopedSpan
+{
+public:
+  explicit ScopedSpan(const char* name);
+  explicit ScopedSpan(const std::string& name);
+  ~ScopedSpan();
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+private:
+  void begin();
+
+  bool enabled_;
+  std::string name_;
+  std::chrono::steady_clock::time_point start_;
+};
+}  // namespace tracing
+}  // namespace moveit
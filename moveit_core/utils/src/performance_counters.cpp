@@ -0,0 +1,161 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/utils/performance_counters.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace moveit
+{
+namespace performance_counters
+{
+namespace
+{
+CounterValues read(const detail::ThreadCounters& counters)
+{
+  CounterValues values;
+  for (std::size_t i = 0; i < NUM_COUNTERS; ++i)
+  {
+    values.counts[i] = counters.counts[i].load(std::memory_order_relaxed);
+    values.durations[i] = std::chrono::nanoseconds(counters.nanoseconds[i].load(std::memory_order_relaxed));
+  }
+  return values;
+}
+
+// Counters of all running threads, and the sum of the counters of all exited threads
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<const detail::ThreadCounters*> threads;
+  CounterValues exited_threads;
+};
+
+Registry& getRegistry()
+{
+  // Never destroyed, threads may exit after static destruction began
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// Registers the counters of a thread for its lifetime
+struct ThreadRegistration
+{
+  ThreadRegistration()
+  {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(&counters);
+  }
+
+  ~ThreadRegistration()
+  {
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.exited_threads += read(counters);
+    registry.threads.erase(std::remove(registry.threads.begin(), registry.threads.end(), &counters),
+                           registry.threads.end());
+  }
+
+  detail::ThreadCounters counters;
+};
+}  // namespace
+
+const char* getCounterName(Counter counter)
+{
+  switch (counter)
+  {
+    case COLLISION_CHECKS:
+      return "collision_checks";
+    case DISTANCE_QUERIES:
+      return "distance_queries";
+    case FK_UPDATES:
+      return "fk_updates";
+    case IK_CALLS:
+      return "ik_calls";
+    case STATE_VALIDITY_CHECKS:
+      return "state_validity_checks";
+    default:
+      return "unknown";
+  }
+}
+
+CounterValues CounterValues::operator-(const CounterValues& other) const
+{
+  CounterValues difference;
+  for (std::size_t i = 0; i < NUM_COUNTERS; ++i)
+  {
+    difference.counts[i] = counts[i] - other.counts[i];
+    difference.durations[i] = durations[i] - other.durations[i];
+  }
+  return difference;
+}
+
+CounterValues& CounterValues::operator+=(const CounterValues& other)
+{
+  for (std::size_t i = 0; i < NUM_COUNTERS; ++i)
+  {
+    counts[i] += other.counts[i];
+    durations[i] += other.durations[i];
+  }
+  return *this;
+}
+
+CounterValues getThreadCounterValues()
+{
+  return read(detail::getThreadCounters());
+}
+
+CounterValues getTotalCounterValues()
+{
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  CounterValues total = registry.exited_threads;
+  for (const detail::ThreadCounters* counters : registry.threads)
+    total += read(*counters);
+  return total;
+}
+
+namespace detail
+{
+ThreadCounters& getThreadCounters()
+{
+  thread_local ThreadRegistration registration;
+  return registration.counters;
+}
+}  // namespace detail
+}  // namespace performance_counters
+}  // namespace moveit
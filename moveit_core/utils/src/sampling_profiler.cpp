@@ -0,0 +1,287 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/utils/sampling_profiler.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace moveit
+{
+namespace profiling
+{
+namespace
+{
+// frames of the signal handler and of the signal trampoline on top of every sampled stack
+constexpr int SKIPPED_FRAMES = 2;
+
+std::atomic<bool> enabled{ false };
+std::mutex sink_mutex;
+std::shared_ptr<const ProfileSinkFn> sink;
+Options sink_options;
+std::atomic<std::size_t> next_request_id{ 1 };
+std::once_flag signal_handler_flag;
+
+// Assigned by the profiled thread before its timer is armed, so that the signal handler never allocates its storage
+thread_local ScopedProfile::Sampler* active_sampler = nullptr;
+}  // namespace
+
+class ScopedProfile::Sampler
+{
+public:
+  Sampler(const char* request_name, std::shared_ptr<const ProfileSinkFn> profile_sink, const Options& options)
+    : sink_(std::move(profile_sink))
+    , max_samples_(options.max_samples)
+    , stride_(static_cast<int>(options.max_depth) + SKIPPED_FRAMES)
+    , frames_(max_samples_ * stride_)
+    , depths_(max_samples_, 0)
+  {
+    profile_.request_name = request_name;
+    profile_.request_id = next_request_id++;
+    profile_.thread_id = std::this_thread::get_id();
+    profile_.dropped_samples = 0;
+
+    // backtrace() loads its unwinder on the first call, which must not happen in the signal handler
+    void* frame;
+    backtrace(&frame, 1);
+
+    struct sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer_) != 0)
+      return;
+
+    active_sampler = this;
+    const long period_ns = std::max<long>(std::chrono::nanoseconds(options.period).count(), 1000);
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = period_ns / 1000000000;
+    spec.it_interval.tv_nsec = period_ns % 1000000000;
+    spec.it_value = spec.it_interval;
+    profile_.start = std::chrono::steady_clock::now();
+    if (timer_settime(timer_, 0, &spec, nullptr) != 0)
+    {
+      active_sampler = nullptr;
+      timer_delete(timer_);
+      return;
+    }
+    running_ = true;
+  }
+
+  ~Sampler()
+  {
+    if (!running_)
+      return;
+    timer_delete(timer_);
+    profile_.end = std::chrono::steady_clock::now();
+    // a signal that was already pending is handled before timer_delete() returns to this thread
+    active_sampler = nullptr;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    profile_.stacks.reserve(sample_count_);
+    for (std::size_t i = 0; i < sample_count_; ++i)
+    {
+      void* const* frames = frames_.data() + i * stride_;
+      const int depth = depths_[i];
+      if (depth > SKIPPED_FRAMES)
+        profile_.stacks.emplace_back(frames + SKIPPED_FRAMES, frames + depth);
+    }
+    profile_.dropped_samples = dropped_samples_;
+    (*sink_)(profile_);
+  }
+
+  bool isRunning() const
+  {
+    return running_;
+  }
+
+  std::size_t getRequestId() const
+  {
+    return profile_.request_id;
+  }
+
+  /* Store the current stack; only called by the signal handler, on the profiled thread */
+  void record()
+  {
+    if (sample_count_ >= max_samples_)
+    {
+      ++dropped_samples_;
+      return;
+    }
+    depths_[sample_count_] = backtrace(frames_.data() + sample_count_ * stride_, stride_);
+    ++sample_count_;
+  }
+
+private:
+  std::shared_ptr<const ProfileSinkFn> sink_;
+  std::size_t max_samples_;
+  int stride_;
+  // preallocated, as the signal handler cannot allocate
+  std::vector<void*> frames_;
+  std::vector<int> depths_;
+  volatile std::size_t sample_count_ = 0;
+  volatile std::size_t dropped_samples_ = 0;
+  timer_t timer_{};
+  bool running_ = false;
+  Profile profile_;
+};
+
+namespace
+{
+void handleProfilingSignal(int /*signal*/, siginfo_t* /*info*/, void* /*context*/)
+{
+  const int saved_errno = errno;
+  if (ScopedProfile::Sampler* sampler = active_sampler)
+    sampler->record();
+  errno = saved_errno;
+}
+
+void installSignalHandler()
+{
+  struct sigaction action = {};
+  action.sa_sigaction = &handleProfilingSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, nullptr);
+}
+
+std::string getFrameName(void* address, bool return_address)
+{
+  // return addresses point behind the call, which may already belong to the next function
+  void* const lookup = return_address ? static_cast<char*>(address) - 1 : address;
+  Dl_info info;
+  if (dladdr(lookup, &info) == 0)
+    return "[unknown]";
+  if (!info.dli_sname)
+  {
+    std::string object = info.dli_fname ? info.dli_fname : "unknown";
+    return "[" + object.substr(object.find_last_of('/') + 1) + "]";
+  }
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+  std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+  std::free(demangled);
+  // ';' separates the frames of collapsed stacks
+  std::replace(name.begin(), name.end(), ';', ':');
+  return name;
+}
+}  // namespace
+
+void setProfileSink(const ProfileSinkFn& profile_sink, const Options& options)
+{
+  if (profile_sink)
+    std::call_once(signal_handler_flag, &installSignalHandler);
+  std::lock_guard<std::mutex> lock(sink_mutex);
+  sink = profile_sink ? std::make_shared<const ProfileSinkFn>(profile_sink) : nullptr;
+  sink_options = options;
+  enabled = static_cast<bool>(profile_sink);
+}
+
+bool isEnabled()
+{
+  return enabled;
+}
+
+ScopedProfile::ScopedProfile(const char* request_name)
+{
+  if (!enabled || active_sampler)
+    return;
+
+  std::shared_ptr<const ProfileSinkFn> profile_sink;
+  Options options;
+  {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    profile_sink = sink;
+    options = sink_options;
+  }
+  if (!profile_sink || options.max_samples == 0 ||
+      (!options.requests.empty() &&
+       std::find(options.requests.begin(), options.requests.end(), request_name) == options.requests.end()))
+    return;
+
+  sampler_ = std::make_unique<Sampler>(request_name, std::move(profile_sink), options);
+  if (!sampler_->isRunning())
+    sampler_.reset();
+}
+
+ScopedProfile::~ScopedProfile() = default;
+
+std::size_t ScopedProfile::getRequestId() const
+{
+  return sampler_ ? sampler_->getRequestId() : 0;
+}
+
+std::map<std::string, std::size_t> collapseStacks(const Profile& profile)
+{
+  std::map<void*, std::string> names;
+  std::map<std::string, std::size_t> stacks;
+  for (const std::vector<void*>& frames : profile.stacks)
+  {
+    std::string stack;
+    // the innermost frame is where the thread was interrupted, all outer ones are return addresses
+    for (std::size_t i = frames.size(); i-- > 0;)
+    {
+      auto name = names.find(frames[i]);
+      if (name == names.end())
+        name = names.emplace(frames[i], getFrameName(frames[i], i > 0)).first;
+      if (!stack.empty())
+        stack += ';';
+      stack += name->second;
+    }
+    ++stacks[stack];
+  }
+  return stacks;
+}
+
+void writeCollapsedStacks(const Profile& profile, std::ostream& out)
+{
+  for (const auto& [stack, count] : collapseStacks(profile))
+    out << stack << ' ' << count << '\n';
+}
+}  // namespace profiling
+}  // namespace moveit
@@ -0,0 +1,232 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/utils/thread_config.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace moveit
+{
+namespace threads
+{
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.utils.thread_config");
+const std::string PARAMETER_PREFIX = "thread_config.";
+
+struct Registry
+{
+  std::mutex lock;
+  std::map<std::string, ThreadConfig> configs;
+  // incremented on every change, so threads can tell whether their configuration is outdated
+  std::size_t generation{ 0 };
+};
+
+Registry& getRegistry()
+{
+  static Registry registry;
+  return registry;
+}
+
+// the configuration last applied to the calling thread
+struct AppliedConfig
+{
+  std::string name;
+  std::size_t generation{ 0 };
+  bool valid{ false };
+};
+thread_local AppliedConfig applied_config;
+
+bool applyConfig(const std::string& name, const ThreadConfig* config)
+{
+#ifdef __linux__
+  // names are limited to 15 characters by the kernel
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+  if (!config)
+    return true;
+
+  bool ok = true;
+  std::vector<int> cpus = config->cpus;
+  if (config->numa_node >= 0)
+  {
+    const std::vector<int> numa_cpus = getNumaNodeCpus(config->numa_node);
+    if (numa_cpus.empty())
+      RCLCPP_WARN(LOGGER, "Thread '%s': NUMA node %d has no known CPUs", name.c_str(), config->numa_node);
+    cpus.insert(cpus.end(), numa_cpus.begin(), numa_cpus.end());
+  }
+  if (!cpus.empty())
+  {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus)
+    {
+      if (cpu >= 0 && cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &cpu_set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) != 0)
+    {
+      RCLCPP_WARN(LOGGER, "Thread '%s': failed to set the CPU affinity", name.c_str());
+      ok = false;
+    }
+  }
+  if (config->priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = config->priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    {
+      RCLCPP_WARN(LOGGER, "Thread '%s': failed to set the real-time priority %d, check the permissions of the process",
+                  name.c_str(), config->priority);
+      ok = false;
+    }
+  }
+  return ok;
+#else
+  if (config)
+    RCLCPP_WARN_ONCE(LOGGER, "Thread configuration is not supported on this platform (thread '%s')", name.c_str());
+  return config == nullptr;
+#endif
+}
+}  // namespace
+
+void setThreadConfig(const std::string& name, const ThreadConfig& config)
+{
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  registry.configs[name] = config;
+  ++registry.generation;
+}
+
+bool getThreadConfig(const std::string& name, ThreadConfig& config)
+{
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> guard(registry.lock);
+  auto it = registry.configs.find(name);
+  if (it == registry.configs.end())
+    return false;
+  config = it->second;
+  return true;
+}
+
+void loadThreadConfigs(const rclcpp::Node::SharedPtr& node)
+{
+  // the parameters are read from the overrides, so they do not have to be declared for each possible thread name
+  std::map<std::string, ThreadConfig> configs;
+  for (const auto& [key, value] : node->get_node_parameters_interface()->get_parameter_overrides())
+  {
+    if (key.rfind(PARAMETER_PREFIX, 0) != 0)
+      continue;
+    const std::size_t dot = key.rfind('.');
+    if (dot <= PARAMETER_PREFIX.size())
+      continue;
+    const std::string name = key.substr(PARAMETER_PREFIX.size(), dot - PARAMETER_PREFIX.size());
+    const std::string field = key.substr(dot + 1);
+    ThreadConfig& config = configs[name];
+    if (field == "priority" && value.get_type() == rclcpp::ParameterType::PARAMETER_INTEGER)
+      config.priority = static_cast<int>(value.get<int64_t>());
+    else if (field == "numa_node" && value.get_type() == rclcpp::ParameterType::PARAMETER_INTEGER)
+      config.numa_node = static_cast<int>(value.get<int64_t>());
+    else if (field == "cpus" && value.get_type() == rclcpp::ParameterType::PARAMETER_INTEGER_ARRAY)
+    {
+      for (int64_t cpu : value.get<std::vector<int64_t>>())
+        config.cpus.push_back(static_cast<int>(cpu));
+    }
+    else
+      RCLCPP_WARN(LOGGER, "Ignoring thread configuration parameter '%s' of unknown name or type", key.c_str());
+  }
+
+  for (const auto& [name, config] : configs)
+  {
+    RCLCPP_INFO(LOGGER, "Thread '%s': priority %d, %zu CPUs, NUMA node %d", name.c_str(), config.priority,
+                config.cpus.size(), config.numa_node);
+    setThreadConfig(name, config);
+  }
+}
+
+bool configureCurrentThread(const std::string& name)
+{
+  Registry& registry = getRegistry();
+  ThreadConfig config;
+  bool configured;
+  std::size_t generation;
+  {
+    std::lock_guard<std::mutex> guard(registry.lock);
+    if (applied_config.valid && applied_config.name == name && applied_config.generation == registry.generation)
+      return true;
+    generation = registry.generation;
+    auto it = registry.configs.find(name);
+    configured = it != registry.configs.end();
+    if (configured)
+      config = it->second;
+  }
+
+  applied_config.name = name;
+  applied_config.generation = generation;
+  applied_config.valid = true;
+  return applyConfig(name, configured ? &config : nullptr);
+}
+
+std::vector<int> getNumaNodeCpus(int node)
+{
+  // the list has the form "0-3,8-11"
+  std::vector<int> cpus;
+  std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string range;
+  while (std::getline(file, range, ','))
+  {
+    std::istringstream stream(range);
+    int first, last;
+    char dash;
+    if (!(stream >> first))
+      continue;
+    last = first;
+    if (stream >> dash >> last && dash != '-')
+      continue;
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+}  // namespace threads
+}  // namespace moveit
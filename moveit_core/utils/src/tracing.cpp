@@ -0,0 +1,106 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/utils/tracing.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace moveit
+{
+namespace tracing
+{
+namespace
+{
+std::atomic<bool> enabled{ false };
+std::mutex sink_mutex;
+std::shared_ptr<const SpanSinkFn> sink;
+thread_local std::size_t depth = 0;
+
+std::shared_ptr<const SpanSinkFn> getSink()
+{
+  std::lock_guard<std::mutex> lock(sink_mutex);
+  return sink;
+}
+}  // namespace
+
+void setSpanSink(const SpanSinkFn& span_sink)
+{
+  std::lock_guard<std::mutex> lock(sink_mutex);
+  sink = span_sink ? std::make_shared<const SpanSinkFn>(span_sink) : nullptr;
+  enabled = static_cast<bool>(span_sink);
+}
+
+bool isEnabled()
+{
+  return enabled;
+}
+
+ScopedSpan::ScopedSpan(const char* name) : enabled_(enabled)
+{
+  if (enabled_)
+  {
+    name_ = name;
+    begin();
+  }
+}
+
+ScopedSpan::ScopedSpan(const std::string& name) : enabled_(enabled)
+{
+  if (enabled_)
+  {
+    name_ = name;
+    begin();
+  }
+}
+
+void ScopedSpan::begin()
+{
+  ++depth;
+  start_ = std::chrono::steady_clock::now();
+}
+
+ScopedSpan::~ScopedSpan()
+{
+  if (!enabled_)
+    return;
+  const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  --depth;
+  // The sink may have been removed while the span was running
+  if (std::shared_ptr<const SpanSinkFn> span_sink = getSink())
+    (*span_sink)(Span{ std::move(name_), start_, end, depth, std::this_thread::get_id() });
+}
+}  // namespace tracing
+}  // namespace moveit
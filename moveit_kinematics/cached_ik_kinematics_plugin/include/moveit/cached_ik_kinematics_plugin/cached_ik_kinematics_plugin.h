@@ -51,7 +51,13 @@
 #else
 #include <tf2/LinearMath/Vector3.h>
 #endif
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <filesystem>
@@ -61,7 +67,14 @@ namespace cached_ik_kinematics_plugin
 static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_cached_ik_kinematics_plugin.cached_ik_kinematics_plugin");
 
-/** \brief A cache of inverse kinematic solutions */
+/** \brief A cache of inverse kinematic solutions
+
+    Queries may run concurrently. New entries are queued and inserted in batches by a background thread, which also
+    appends them to the cache file, so that IK calls never wait for disk I/O.
+
+    The cache file may be shared by several processes: it is memory-mapped for loading under a shared file lock,
+    and every process appends its new entries behind the current end of the file under an exclusive lock.
+*/
 class IKCache
 {
 public:
@@ -123,12 +136,37 @@ public:
   void updateCache(const IKEntry& nearest, const std::vector<Pose>& poses, const std::vector<double>& config) const;
   /** verify with forward kinematics that the cache entries are correct */
   void verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const;
+  /** approximate number of bytes used by the cache entries, including queued ones and the nearest neighbor index */
+  std::size_t getMemoryUsage() const;
 
 protected:
+  /** number of independently locked parts of the nearest neighbor data structure */
+  static constexpr std::size_t NUM_STRIPES = 8;
+
+  /** part of the nearest neighbor data structure, so that insertions only block the queries of a single stripe */
+  struct Stripe
+  {
+    std::shared_mutex lock;
+    NearestNeighborsGNAT<IKEntry*> nn;
+  };
+
+  /** compute the distance between the poses of two cache entries */
+  static double entryDistance(const IKEntry* entry1, const IKEntry* entry2);
   /** compute the distance between two joint configurations */
   double configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const;
-  /** save current state of cache to disk */
-  void saveCache() const;
+  /** get the closest entry of all stripes */
+  const IKEntry& nearestEntry(IKEntry& query) const;
+  /** queue an entry for insertion by the background thread, unless the cache is full */
+  void queueEntry(IKEntry&& entry) const;
+  /** add entries to ik_cache_ and distribute them over the stripes of the nearest neighbor data structure;
+      cache_lock_ needs to be held */
+  void insertEntries(std::vector<IKEntry>& entries);
+  /** body of the background thread inserting queued entries */
+  void insertionLoop();
+  /** insert the remaining queued entries and stop the background thread */
+  void stopInsertion();
+  /** append the entries added since the last save to the cache file */
+  void saveCache();
 
   /** number of joints in the system */
   unsigned int num_joints_;
@@ -142,19 +180,35 @@ protected:
   /** file name for loading / saving cache */
   std::filesystem::path cache_file_name_;
 
+  /**
+    cache of IK solutions, only appended to by the insertion thread;
+    a deque keeps references to entries valid while it grows
+  */
+  std::deque<IKEntry> ik_cache_;
+  /** mutex for appending to ik_cache_ */
+  mutable std::mutex cache_lock_;
   /**
     the IK methods are declared const in the base class, but the
-    wrapped methods need to modify the cache, so the next four members
+    wrapped methods need to modify the cache, so the following members
     are mutable
-    cache of IK solutions
+    striped nearest neighbor data structure over IK cache entries
   */
-  mutable std::vector<IKEntry> ik_cache_;
-  /** nearest neighbor data structure over IK cache entries */
-  mutable NearestNeighborsGNAT<IKEntry*> ik_nn_;
+  mutable std::array<Stripe, NUM_STRIPES> stripes_;
+  /** number of entries in the nearest neighbor data structure */
+  std::atomic<std::size_t> num_indexed_entries_{ 0 };
+  /** number of entries in the cache including queued ones, to enforce max_cache_size_ */
+  mutable std::atomic<std::size_t> num_entries_{ 0 };
+  /** entries waiting for insertion */
+  mutable std::vector<IKEntry> pending_entries_;
+  /** mutex for pending_entries_ and stop_insertion_ */
+  mutable std::mutex pending_lock_;
+  mutable std::condition_variable pending_condition_;
+  bool stop_insertion_{ false };
+  std::thread insertion_thread_;
+  /** descriptor of the cache file, to which the insertion thread appends new entries */
+  int cache_fd_{ -1 };
   /** size of the cache when it was last saved */
-  mutable unsigned int last_saved_cache_size_{ 0 };
-  /** mutex for changing IK cache */
-  mutable std::mutex lock_;
+  unsigned int last_saved_cache_size_{ 0 };
 };
 
 /** a container of IK caches for cases where there is no fixed base frame */
@@ -164,7 +218,8 @@ public:
   using IKEntry = IKCache::IKEntry;
   using Pose = IKCache::Pose;
 
-  IKCacheMap(const std::string& robot_description, const std::string& group_name, unsigned int num_joints);
+  IKCacheMap(const std::string& robot_description, const std::string& group_name, unsigned int num_joints,
+             const IKCache::Options& opts = IKCache::Options());
   ~IKCacheMap();
   /**
     get the entry from the IK cache that best matches a given vector of
@@ -186,6 +241,8 @@ protected:
   std::string robot_description_;
   std::string group_name_;
   unsigned int num_joints_;
+  /** options of the caches, which are stored in one file per key */
+  IKCache::Options opts_;
 };
 
 // Helper class to enable/disable initialize() methods with new/old API
@@ -264,6 +321,11 @@ public:
                         const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
                         const KinematicsQueryOptions& options = KinematicsQueryOptions()) const override;
 
+  std::size_t getMemoryUsage() const override
+  {
+    return KinematicsPlugin::getMemoryUsage() + cache_.getMemoryUsage();
+  }
+
 private:
   rclcpp::Node::SharedPtr node_;
 
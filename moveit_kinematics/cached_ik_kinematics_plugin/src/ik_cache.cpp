@@ -36,42 +36,82 @@
 
 #include <numeric>
 #include <filesystem>
-#include <fstream>
+#include <limits>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
 
 namespace cached_ik_kinematics_plugin
 {
+namespace
+{
+// layout of a cache entry in the cache file
+constexpr unsigned int POSITION_SIZE = 3 * sizeof(tf2Scalar);
+constexpr unsigned int ORIENTATION_SIZE = 4 * sizeof(tf2Scalar);
+constexpr unsigned int POSE_SIZE = POSITION_SIZE + ORIENTATION_SIZE;
+// the header consists of the number of entries, the number of dofs and the number of end effectors
+constexpr std::size_t HEADER_SIZE = 3 * sizeof(unsigned int);
+
+/** holds an advisory lock on a file, to coordinate processes sharing a cache file */
+class FileLock
+{
+public:
+  FileLock(int fd, int operation) : fd_(fd)
+  {
+    while (flock(fd_, operation) != 0 && errno == EINTR)
+      ;
+  }
+  ~FileLock()
+  {
+    flock(fd_, LOCK_UN);
+  }
+
+private:
+  int fd_;
+};
+}  // namespace
+
 IKCache::IKCache()
 {
   // set distance function for nearest-neighbor queries
-  ik_nn_.setDistanceFunction([](const IKEntry* entry1, const IKEntry* entry2) {
-    double dist = 0.;
-    for (unsigned int i = 0; i < entry1->first.size(); ++i)
-      dist += entry1->first[i].distance(entry2->first[i]);
-    return dist;
-  });
+  for (Stripe& stripe : stripes_)
+    stripe.nn.setDistanceFunction(&IKCache::entryDistance);
 }
 
 IKCache::~IKCache()
 {
-  if (!ik_cache_.empty())
-    saveCache();
+  stopInsertion();
+}
+
+double IKCache::entryDistance(const IKEntry* entry1, const IKEntry* entry2)
+{
+  double dist = 0.;
+  for (unsigned int i = 0; i < entry1->first.size(); ++i)
+    dist += entry1->first[i].distance(entry2->first[i]);
+  return dist;
 }
 
 void IKCache::initializeCache(const std::string& robot_id, const std::string& group_name, const std::string& cache_name,
                               const unsigned int num_joints, const Options& opts)
 {
+  // finish a previous initialization before touching the cache
+  stopInsertion();
+
   // read ROS parameters
   max_cache_size_ = opts.max_cache_size;
-  ik_cache_.reserve(max_cache_size_);
   min_pose_distance_ = opts.min_pose_distance;
   min_config_distance2_ = opts.min_joint_config_distance;
   min_config_distance2_ *= min_config_distance2_;
   std::string cached_ik_path = opts.cached_ik_path;
 
   // use mutex lock for rest of initialization
-  std::lock_guard<std::mutex> slock(lock_);
+  std::lock_guard<std::mutex> slock(cache_lock_);
   // determine cache file name
   std::filesystem::path prefix(!cached_ik_path.empty() ? std::filesystem::path(cached_ik_path) :
                                                          std::filesystem::current_path());
@@ -83,56 +123,73 @@ void IKCache::initializeCache(const std::string& robot_id, const std::string& gr
                                std::to_string(std::sqrt(min_config_distance2_)) + ".ikcache");
 
   ik_cache_.clear();
-  ik_nn_.clear();
+  for (Stripe& stripe : stripes_)
+    stripe.nn.clear();
+  num_indexed_entries_ = 0;
   last_saved_cache_size_ = 0;
-  if (std::filesystem::exists(cache_file_name_))
+  cache_fd_ = open(cache_file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (cache_fd_ < 0)
+    RCLCPP_ERROR(LOGGER, "Cannot open cache file %s: %s", cache_file_name_.string().c_str(), strerror(errno));
+  else
   {
-    // read cache
-    std::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
-    cache_file.read((char*)&last_saved_cache_size_, sizeof(unsigned int));
-    unsigned int num_dofs;
-    cache_file.read((char*)&num_dofs, sizeof(unsigned int));
-    unsigned int num_tips;
-    cache_file.read((char*)&num_tips, sizeof(unsigned int));
-
-    RCLCPP_INFO(LOGGER, "Found %d IK solutions for a %d-dof system with %d end effectors in %s", last_saved_cache_size_,
-                num_dofs, num_tips, cache_file_name_.string().c_str());
-
-    unsigned int position_size = 3 * sizeof(tf2Scalar);
-    unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-    unsigned int pose_size = position_size + orientation_size;
-    unsigned int config_size = num_dofs * sizeof(double);
-    unsigned int offset_conf = pose_size * num_tips;
-    unsigned int bufsize = offset_conf + config_size;
-    char* buffer = new char[bufsize];
-    IKEntry entry;
-    entry.first.resize(num_tips);
-    entry.second.resize(num_dofs);
-    ik_cache_.reserve(last_saved_cache_size_);
-
-    for (unsigned i = 0; i < last_saved_cache_size_; ++i)
+    // other processes only write while holding an exclusive lock, so this sees only complete entries
+    FileLock file_lock(cache_fd_, LOCK_SH);
+    struct stat st;
+    if (fstat(cache_fd_, &st) == 0 && static_cast<std::size_t>(st.st_size) >= HEADER_SIZE)
     {
-      unsigned int j = 0;
-      cache_file.read(buffer, bufsize);
-      for (auto& pose : entry.first)
+      // map the file instead of streaming it, caches for many tip frames can be large
+      const std::size_t file_size = st.st_size;
+      void* data = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, cache_fd_, 0);
+      if (data == MAP_FAILED)
+        RCLCPP_ERROR(LOGGER, "Cannot map cache file %s: %s", cache_file_name_.string().c_str(), strerror(errno));
+      else
       {
-        memcpy(&pose.position[0], buffer + j * pose_size, position_size);
-        memcpy(&pose.orientation[0], buffer + j * pose_size + position_size, orientation_size);
-        ++j;
+        const char* file = static_cast<const char*>(data);
+        unsigned int header[3];
+        memcpy(header, file, HEADER_SIZE);
+        const unsigned int num_dofs = header[1];
+        const unsigned int num_tips = header[2];
+        RCLCPP_INFO(LOGGER, "Found %d IK solutions for a %d-dof system with %d end effectors in %s", header[0],
+                    num_dofs, num_tips, cache_file_name_.string().c_str());
+
+        const std::size_t config_size = num_dofs * sizeof(double);
+        const std::size_t offset_conf = POSE_SIZE * num_tips;
+        const std::size_t bufsize = offset_conf + config_size;
+        std::size_t num_entries = header[0];
+        if (bufsize == 0 || HEADER_SIZE + num_entries * bufsize > file_size)
+        {
+          num_entries = bufsize ? (file_size - HEADER_SIZE) / bufsize : 0;
+          RCLCPP_WARN(LOGGER, "Cache file is truncated, reading only %zu IK solutions", num_entries);
+        }
+
+        std::vector<IKEntry> entries(num_entries);
+        for (std::size_t i = 0; i < num_entries; ++i)
+        {
+          const char* record = file + HEADER_SIZE + i * bufsize;
+          IKEntry& entry = entries[i];
+          entry.first.resize(num_tips);
+          entry.second.resize(num_dofs);
+          unsigned int j = 0;
+          for (auto& pose : entry.first)
+          {
+            memcpy(&pose.position[0], record + j * POSE_SIZE, POSITION_SIZE);
+            memcpy(&pose.orientation[0], record + j * POSE_SIZE + POSITION_SIZE, ORIENTATION_SIZE);
+            ++j;
+          }
+          memcpy(&entry.second[0], record + offset_conf, config_size);
+        }
+        munmap(data, file_size);
+
+        insertEntries(entries);
+        last_saved_cache_size_ = ik_cache_.size();
       }
-      memcpy(&entry.second[0], buffer + offset_conf, config_size);
-      ik_cache_.push_back(entry);
     }
-    RCLCPP_INFO(LOGGER, "freeing buffer");
-    delete[] buffer;
-    RCLCPP_INFO(LOGGER, "freed buffer");
-    std::vector<IKEntry*> ik_entry_ptrs(last_saved_cache_size_);
-    for (unsigned int i = 0; i < last_saved_cache_size_; ++i)
-      ik_entry_ptrs[i] = &ik_cache_[i];
-    ik_nn_.add(ik_entry_ptrs);
   }
 
   num_joints_ = num_joints;
+  num_entries_ = ik_cache_.size();
+  stop_insertion_ = false;
+  insertion_thread_ = std::thread([this] { insertionLoop(); });
 
   RCLCPP_INFO(LOGGER, "cache file %s initialized!", cache_file_name_.string().c_str());
 }
@@ -148,45 +205,60 @@ double IKCache::configDistance2(const std::vector<double>& config1, const std::v
   return dist;
 }
 
+const IKCache::IKEntry& IKCache::nearestEntry(IKEntry& query) const
+{
+  const IKEntry* best = nullptr;
+  double best_distance = std::numeric_limits<double>::infinity();
+  for (Stripe& stripe : stripes_)
+  {
+    // queries share the lock, only insertions into the same stripe need to wait for it
+    std::shared_lock<std::shared_mutex> slock(stripe.lock);
+    if (stripe.nn.size() == 0)
+      continue;
+    const IKEntry* candidate = stripe.nn.nearest(&query);
+    const double distance = entryDistance(&query, candidate);
+    if (distance < best_distance)
+    {
+      best = candidate;
+      best_distance = distance;
+    }
+  }
+  return *best;
+}
+
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const Pose& pose) const
 {
-  if (ik_cache_.empty())
+  if (num_indexed_entries_ == 0)
   {
     static IKEntry dummy = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>(num_joints_, 0.));
     return dummy;
   }
   IKEntry query = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  return nearestEntry(query);
 }
 
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const std::vector<Pose>& poses) const
 {
-  if (ik_cache_.empty())
+  if (num_indexed_entries_ == 0)
   {
     static IKEntry dummy = std::make_pair(poses, std::vector<double>(num_joints_, 0.));
     return dummy;
   }
   IKEntry query = std::make_pair(poses, std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  return nearestEntry(query);
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const Pose& pose, const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity() && (nearest.first[0].distance(pose) > min_pose_distance_ ||
-                                                  configDistance2(nearest.second, config) > min_config_distance2_))
-  {
-    std::lock_guard<std::mutex> slock(lock_);
-    ik_cache_.emplace_back(std::vector<Pose>(1u, pose), config);
-    ik_nn_.add(&ik_cache_.back());
-    if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-      saveCache();
-  }
+  if (num_entries_ < max_cache_size_ && (nearest.first[0].distance(pose) > min_pose_distance_ ||
+                                         configDistance2(nearest.second, config) > min_config_distance2_))
+    queueEntry(IKEntry(std::vector<Pose>(1u, pose), config));
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses,
                           const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity())
+  if (num_entries_ < max_cache_size_)
   {
     bool add_to_cache = configDistance2(nearest.second, config) > min_config_distance2_;
     if (!add_to_cache)
@@ -203,50 +275,140 @@ void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses
       }
     }
     if (add_to_cache)
+      queueEntry(IKEntry(poses, config));
+  }
+}
+
+void IKCache::queueEntry(IKEntry&& entry) const
+{
+  // reserve a slot first, so that concurrent updates cannot exceed the maximum cache size
+  if (num_entries_.fetch_add(1) >= max_cache_size_)
+  {
+    --num_entries_;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> slock(pending_lock_);
+    pending_entries_.push_back(std::move(entry));
+  }
+  pending_condition_.notify_one();
+}
+
+void IKCache::insertEntries(std::vector<IKEntry>& entries)
+{
+  std::array<std::vector<IKEntry*>, NUM_STRIPES> stripe_entries;
+  for (IKEntry& entry : entries)
+    stripe_entries[ik_cache_.size() % NUM_STRIPES].push_back(&ik_cache_.emplace_back(std::move(entry)));
+  for (std::size_t i = 0; i < NUM_STRIPES; ++i)
+  {
+    if (stripe_entries[i].empty())
+      continue;
+    std::unique_lock<std::shared_mutex> slock(stripes_[i].lock);
+    stripes_[i].nn.add(stripe_entries[i]);
+  }
+  num_indexed_entries_ += entries.size();
+}
+
+void IKCache::insertionLoop()
+{
+  std::vector<IKEntry> batch;
+  std::unique_lock<std::mutex> slock(pending_lock_);
+  while (true)
+  {
+    pending_condition_.wait(slock, [this] { return stop_insertion_ || !pending_entries_.empty(); });
+    if (pending_entries_.empty())  // stopped and every queued entry is inserted
+      break;
+
+    // insert all entries queued in the meantime at once, without blocking further updates
+    batch.swap(pending_entries_);
+    slock.unlock();
+    {
+      std::lock_guard<std::mutex> cache_lock(cache_lock_);
+      insertEntries(batch);
+    }
+    saveCache();
+    batch.clear();
+    slock.lock();
+  }
+}
+
+void IKCache::stopInsertion()
+{
+  if (insertion_thread_.joinable())
+  {
     {
-      std::lock_guard<std::mutex> slock(lock_);
-      ik_cache_.emplace_back(poses, config);
-      ik_nn_.add(&ik_cache_.back());
-      if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-        saveCache();
+      std::lock_guard<std::mutex> slock(pending_lock_);
+      stop_insertion_ = true;
     }
+    pending_condition_.notify_one();
+    insertion_thread_.join();
+  }
+  if (cache_fd_ >= 0)
+  {
+    close(cache_fd_);
+    cache_fd_ = -1;
   }
 }
 
-void IKCache::saveCache() const
+void IKCache::saveCache()
 {
-  if (cache_file_name_.empty())
+  if (cache_fd_ < 0)
+  {
     RCLCPP_ERROR(LOGGER, "can't save cache before initialization");
+    return;
+  }
+  if (ik_cache_.size() <= last_saved_cache_size_)
+    return;
 
-  RCLCPP_INFO(LOGGER, "writing %ld IK solutions to %s", ik_cache_.size(), cache_file_name_.string().c_str());
+  const std::size_t num_new_entries = ik_cache_.size() - last_saved_cache_size_;
+  RCLCPP_DEBUG(LOGGER, "appending %zu IK solutions to %s", num_new_entries, cache_file_name_.string().c_str());
 
-  std::ofstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::out);
-  unsigned int position_size = 3 * sizeof(tf2Scalar);
-  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-  unsigned int pose_size = position_size + orientation_size;
   unsigned int num_tips = ik_cache_[0].first.size();
-  unsigned int config_size = ik_cache_[0].second.size() * sizeof(double);
-  unsigned int offset_conf = num_tips * pose_size;
-  unsigned int bufsize = offset_conf + config_size;
-  char* buffer = new char[bufsize];
-
-  // write number of IK entries and size of each configuration first
-  last_saved_cache_size_ = ik_cache_.size();
-  cache_file.write((char*)&last_saved_cache_size_, sizeof(unsigned int));
   unsigned int sz = ik_cache_[0].second.size();
-  cache_file.write((char*)&sz, sizeof(unsigned int));
-  cache_file.write((char*)&num_tips, sizeof(unsigned int));
-  for (const auto& entry : ik_cache_)
+  std::size_t config_size = sz * sizeof(double);
+  std::size_t offset_conf = num_tips * POSE_SIZE;
+  std::size_t bufsize = offset_conf + config_size;
+  std::vector<char> buffer(num_new_entries * bufsize);
+  for (std::size_t n = 0; n < num_new_entries; ++n)
   {
+    const IKEntry& entry = ik_cache_[last_saved_cache_size_ + n];
+    char* record = buffer.data() + n * bufsize;
     for (unsigned int i = 0; i < num_tips; ++i)
     {
-      memcpy(buffer + i * pose_size, &entry.first[i].position[0], position_size);
-      memcpy(buffer + i * pose_size + position_size, &entry.first[i].orientation[0], orientation_size);
+      memcpy(record + i * POSE_SIZE, &entry.first[i].position[0], POSITION_SIZE);
+      memcpy(record + i * POSE_SIZE + POSITION_SIZE, &entry.first[i].orientation[0], ORIENTATION_SIZE);
     }
-    memcpy(buffer + offset_conf, &entry.second[0], config_size);
-    cache_file.write(buffer, bufsize);
+    memcpy(record + offset_conf, &entry.second[0], config_size);
+  }
+
+  // other processes may have appended entries in the meantime, so append behind the entries listed in the header
+  FileLock file_lock(cache_fd_, LOCK_EX);
+  unsigned int header[3];
+  if (pread(cache_fd_, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE))
+  {
+    // start a new cache file without any entries
+    header[0] = 0;
+    header[1] = sz;
+    header[2] = num_tips;
+  }
+  else if (header[1] != sz || header[2] != num_tips)
+  {
+    RCLCPP_ERROR(LOGGER, "cache file %s holds IK solutions of a different size, not saving",
+                 cache_file_name_.string().c_str());
+    return;
+  }
+
+  // the entries are written before the number of entries in the header is updated,
+  // so that an interrupted write does not corrupt the cache
+  const off_t offset = HEADER_SIZE + static_cast<off_t>(header[0]) * bufsize;
+  header[0] += num_new_entries;
+  if (pwrite(cache_fd_, buffer.data(), buffer.size(), offset) != static_cast<ssize_t>(buffer.size()) ||
+      pwrite(cache_fd_, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE))
+  {
+    RCLCPP_ERROR(LOGGER, "failed to write IK solutions to %s: %s", cache_file_name_.string().c_str(), strerror(errno));
+    return;
   }
-  delete[] buffer;
+  last_saved_cache_size_ = ik_cache_.size();
 }
 
 void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
@@ -255,6 +417,7 @@ void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
   std::vector<geometry_msgs::msg::Pose> poses(tip_names.size());
   double error, max_error = 0.;
 
+  std::lock_guard<std::mutex> slock(cache_lock_);
   for (const auto& entry : ik_cache_)
   {
     fk.getPositionFK(tip_names, entry.second, poses);
@@ -271,6 +434,28 @@ void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
   RCLCPP_INFO(LOGGER, "Max. error in cache entries is %g", max_error);
 }
 
+std::size_t IKCache::getMemoryUsage() const
+{
+  // every entry is stored once in ik_cache_ and referenced by pointer from one of the nearest neighbor stripes
+  auto entry_bytes = [](const IKEntry& entry) {
+    return sizeof(IKEntry) + sizeof(IKEntry*) + entry.first.capacity() * sizeof(Pose) +
+           entry.second.capacity() * sizeof(double);
+  };
+
+  std::size_t bytes = 0;
+  {
+    std::lock_guard<std::mutex> slock(cache_lock_);
+    for (const auto& entry : ik_cache_)
+      bytes += entry_bytes(entry);
+  }
+  {
+    std::lock_guard<std::mutex> plock(pending_lock_);
+    for (const auto& entry : pending_entries_)
+      bytes += entry_bytes(entry);
+  }
+  return bytes;
+}
+
 IKCache::Pose::Pose(const geometry_msgs::msg::Pose& pose)
 {
   position.setX(pose.position.x);
@@ -284,8 +469,9 @@ double IKCache::Pose::distance(const Pose& pose) const
   return (position - pose.position).length() + (orientation.angleShortestPath(pose.orientation));
 }
 
-IKCacheMap::IKCacheMap(const std::string& robot_description, const std::string& group_name, unsigned int num_joints)
-  : robot_description_(robot_description), group_name_(group_name), num_joints_(num_joints)
+IKCacheMap::IKCacheMap(const std::string& robot_description, const std::string& group_name, unsigned int num_joints,
+                       const IKCache::Options& opts)
+  : robot_description_(robot_description), group_name_(group_name), num_joints_(num_joints), opts_(opts)
 {
 }
 
@@ -323,16 +509,15 @@ void IKCacheMap::updateCache(const IKEntry& nearest, const std::vector<std::stri
     value_type val = std::make_pair(key, nullptr);
     auto it = insert(val).first;
     it->second = new IKCache;
-    it->second->initializeCache(robot_description_, group_name_, key, num_joints_);
+    it->second->initializeCache(robot_description_, group_name_, key, num_joints_, opts_);
+    it->second->updateCache(nearest, poses, config);
   }
 }
 
 std::string IKCacheMap::getKey(const std::vector<std::string>& fixed, const std::vector<std::string>& active) const
 {
-  std::string key;
-  std::accumulate(fixed.begin(), fixed.end(), key);
+  std::string key = std::accumulate(fixed.begin(), fixed.end(), std::string());
   key += '_';
-  std::accumulate(active.begin(), active.end(), key);
-  return key;
+  return std::accumulate(active.begin(), active.end(), key);
 }
 }  // namespace cached_ik_kinematics_plugin
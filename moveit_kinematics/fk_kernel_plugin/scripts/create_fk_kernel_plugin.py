@@ -0,0 +1,355 @@
+#! /usr/bin/env python
+"""
+FK Kernel Plugin Generator for MoveIt
+
+Creates a moveit::core::FKKernel plugin for a kinematic chain of a URDF.
+The generated code contains the joint origins and axes of the chain as
+constants and computes the link transforms with straight-line code, so
+the compiler can fold the fixed parts of the chain. Once the plugin is
+built, set the parameter robot_description_kinematics.<group>.fk_kernel
+to the printed plugin name to have RobotModelLoader register it.
+
+Date: 2024
+
+"""
+"""
+Copyright (c) 2024, PickNik Robotics
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+* Neither the name of PickNik Robotics nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+IABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+"""
+
+import re
+import os
+import math
+import argparse
+import xml.etree.ElementTree as etree
+
+try:
+    from ament_index_python.packages import (
+        get_package_share_directory,
+        PackageNotFoundError,
+    )
+except ImportError:
+    print(
+        "Failed to import ament_index_python. No ROS2 environment available? Trying without."
+    )
+    # define stubs
+    class PackageNotFoundError(Exception):
+        pass
+
+    def get_package_share_directory(pkg_name):
+        raise PackageNotFoundError
+
+
+# Package containing this file
+plugin_gen_pkg = "moveit_kinematics"
+# Maximum sizes supported by RobotState dispatch, see FKKernel::MAX_VARIABLES and FKKernel::MAX_LINKS
+max_variables = 16
+max_links = 32
+
+
+def create_parser():
+    parser = argparse.ArgumentParser(
+        description="Generate a specialized forward kinematics plugin for a chain of a URDF"
+    )
+    parser.add_argument("robot_name", help="The name of your robot")
+    parser.add_argument(
+        "planning_group_name",
+        help="The name of the planning group the kernel is used for",
+    )
+    parser.add_argument(
+        "fk_kernel_plugin_pkg",
+        help="The name of the package to be created for the plugin",
+    )
+    parser.add_argument("base_link_name", help="The name of the base link of the chain")
+    parser.add_argument("tip_link_name", help="The name of the tip link of the chain")
+    parser.add_argument("urdf_path", help="The full path to the URDF of the robot")
+    parser.add_argument(
+        "--output_dir",
+        default=".",
+        help="The directory in which the plugin package is created",
+    )
+    return parser
+
+
+def parse_floats(text, default):
+    if text is None:
+        return default
+    return [float(v) for v in text.split()]
+
+
+def rpy_to_matrix(rpy):
+    sr, cr = math.sin(rpy[0]), math.cos(rpy[0])
+    sp, cp = math.sin(rpy[1]), math.cos(rpy[1])
+    sy, cy = math.sin(rpy[2]), math.cos(rpy[2])
+    return [
+        [cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr],
+        [sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr],
+        [-sp, cp * sr, cp * cr],
+    ]
+
+
+def read_chain(urdf_path, base_link, tip_link):
+    """Return the joints from base_link to tip_link as a list of dicts, base first"""
+    robot = etree.parse(urdf_path).getroot()
+    joint_by_child = {}
+    for joint in robot.findall("joint"):
+        joint_by_child[joint.find("child").get("link")] = joint
+
+    chain = []
+    link = tip_link
+    while link != base_link:
+        if link not in joint_by_child:
+            raise Exception(
+                "Link '%s' is not a descendant of link '%s'" % (tip_link, base_link)
+            )
+        joint = joint_by_child[link]
+        if joint.find("mimic") is not None:
+            raise Exception("Mimic joint '%s' is not supported" % joint.get("name"))
+        origin = joint.find("origin")
+        axis = joint.find("axis")
+        jtype = joint.get("type")
+        if jtype == "continuous":
+            jtype = "revolute"
+        if jtype not in ["revolute", "prismatic", "fixed"]:
+            raise Exception(
+                "Joint '%s' of type '%s' is not supported" % (joint.get("name"), jtype)
+            )
+        axis = parse_floats(axis.get("xyz") if axis is not None else None, [1.0, 0.0, 0.0])
+        norm = math.sqrt(sum(a * a for a in axis))
+        chain.append(
+            dict(
+                name=joint.get("name"),
+                type=jtype,
+                child=link,
+                xyz=parse_floats(origin.get("xyz") if origin is not None else None, [0.0] * 3),
+                rpy=parse_floats(origin.get("rpy") if origin is not None else None, [0.0] * 3),
+                axis=[a / norm for a in axis],
+            )
+        )
+        link = joint.find("parent").get("link")
+    chain.reverse()
+    return chain
+
+
+def literal(value):
+    return repr(float(value))
+
+
+def matrix_literal(m):
+    return ", ".join(literal(v) for row in m for v in row)
+
+
+def generate_link_transforms(chain):
+    """Generate the body of computeLinkTransforms()"""
+    lines = []
+    variable = 0
+    indent = "    "
+    for i, joint in enumerate(chain):
+        origin_r = rpy_to_matrix(joint["rpy"])
+        lines.append(indent + "// %s (%s)" % (joint["name"], joint["type"]))
+        if joint["type"] == "revolute":
+            x, y, z = joint["axis"]
+            lines.append(indent + "s = std::sin(values[%d]);" % variable)
+            lines.append(indent + "c = std::cos(values[%d]);" % variable)
+            # Rodrigues' formula with the axis folded in as constants
+            rot = [
+                ["c + %s * (1.0 - c)" % literal(x * x), "%s * (1.0 - c) - %s * s" % (literal(x * y), literal(z)),
+                 "%s * (1.0 - c) + %s * s" % (literal(x * z), literal(y))],
+                ["%s * (1.0 - c) + %s * s" % (literal(x * y), literal(z)), "c + %s * (1.0 - c)" % literal(y * y),
+                 "%s * (1.0 - c) - %s * s" % (literal(y * z), literal(x))],
+                ["%s * (1.0 - c) - %s * s" % (literal(x * z), literal(y)),
+                 "%s * (1.0 - c) + %s * s" % (literal(y * z), literal(x)), "c + %s * (1.0 - c)" % literal(z * z)],
+            ]
+            lines.append(indent + "r << %s;" % ", ".join(v for row in rot for v in row))
+            lines.append(
+                indent + "r = (Eigen::Matrix3d() << %s).finished() * r;" % matrix_literal(origin_r)
+            )
+            lines.append(indent + "t = Eigen::Vector3d(%s);" % ", ".join(literal(v) for v in joint["xyz"]))
+        elif joint["type"] == "prismatic":
+            lines.append(indent + "r = (Eigen::Matrix3d() << %s).finished();" % matrix_literal(origin_r))
+            lines.append(
+                indent
+                + "t = Eigen::Vector3d(%s) + r * Eigen::Vector3d(%s) * values[%d];"
+                % (", ".join(literal(v) for v in joint["xyz"]), ", ".join(literal(v) for v in joint["axis"]), variable)
+            )
+        else:
+            lines.append(indent + "r = (Eigen::Matrix3d() << %s).finished();" % matrix_literal(origin_r))
+            lines.append(indent + "t = Eigen::Vector3d(%s);" % ", ".join(literal(v) for v in joint["xyz"]))
+
+        if i == 0:
+            lines.append(indent + "link_transforms[0].linear() = r;")
+            lines.append(indent + "link_transforms[0].translation() = t;")
+        else:
+            lines.append(
+                indent + "link_transforms[%d].linear().noalias() = link_transforms[%d].linear() * r;" % (i, i - 1)
+            )
+            lines.append(
+                indent
+                + "link_transforms[%d].translation().noalias() = link_transforms[%d].translation() + "
+                "link_transforms[%d].linear() * t;" % (i, i - 1, i - 1)
+            )
+        if joint["type"] != "fixed":
+            variable += 1
+    return "\n".join(lines)
+
+
+def generate_jacobian_columns(chain):
+    """Generate the body of computeJacobian() following the conventions of RobotState::getJacobian()"""
+    lines = []
+    variable = 0
+    indent = "    "
+    for i, joint in enumerate(chain):
+        if joint["type"] == "fixed":
+            continue
+        axis = "link_transforms[%d].linear() * Eigen::Vector3d(%s)" % (
+            i,
+            ", ".join(literal(v) for v in joint["axis"]),
+        )
+        lines.append(indent + "{")
+        lines.append(indent + "  const Eigen::Vector3d axis = %s;" % axis)
+        if joint["type"] == "revolute":
+            lines.append(
+                indent
+                + "  jacobian.block<3, 1>(0, %d) = axis.cross(tip - link_transforms[%d].translation());"
+                % (variable, i)
+            )
+            lines.append(indent + "  jacobian.block<3, 1>(3, %d) = axis;" % variable)
+        else:
+            lines.append(indent + "  jacobian.block<3, 1>(0, %d) = axis;" % variable)
+        lines.append(indent + "}")
+        variable += 1
+    return "\n".join(lines)
+
+
+def find_template_dir():
+    for candidate in [os.path.dirname(__file__) + "/../templates"]:
+        if os.path.exists(candidate) and os.path.exists(candidate + "/fk_kernel_plugin_template.cpp"):
+            return os.path.realpath(candidate)
+    try:
+        return os.path.join(
+            get_package_share_directory(plugin_gen_pkg), "fk_kernel_plugin/templates"
+        )
+    except PackageNotFoundError:
+        raise Exception("Can't find package %s" % plugin_gen_pkg)
+
+
+def copy_file(src_path, dest_path, description, replacements=None):
+    if not os.path.exists(src_path):
+        raise Exception("Can't find %s at '%s'" % (description, src_path))
+
+    if replacements is None:
+        replacements = dict()
+
+    with open(src_path, "r") as f:
+        content = f.read()
+
+    # replace templates
+    for key, value in replacements.items():
+        content = re.sub(key, lambda m: value, content)
+
+    with open(dest_path, "w") as f:
+        f.write(content)
+    print("Created %s at '%s'" % (description, dest_path))
+
+
+def create_fk_kernel_package(args):
+    chain = read_chain(args.urdf_path, args.base_link_name, args.tip_link_name)
+    variables = [j["name"] for j in chain if j["type"] != "fixed"]
+    links = [j["child"] for j in chain]
+    if len(variables) > max_variables or len(links) > max_links:
+        raise Exception(
+            "The chain has %d variables and %d links, at most %d and %d are supported"
+            % (len(variables), len(links), max_variables, max_links)
+        )
+
+    package_path = os.path.join(args.output_dir, args.fk_kernel_plugin_pkg)
+    os.makedirs(os.path.join(package_path, "src"), exist_ok=True)
+    template_dir = find_template_dir()
+
+    namespace = args.robot_name + "_" + args.planning_group_name
+    library_name = namespace + "_moveit_fk_kernel"
+    replacements = dict(
+        _ROBOT_NAME_=args.robot_name,
+        _GROUP_NAME_=args.planning_group_name,
+        _BASE_LINK_=args.base_link_name,
+        _TIP_LINK_=args.tip_link_name,
+        _PACKAGE_NAME_=args.fk_kernel_plugin_pkg,
+        _NAMESPACE_=namespace,
+        _LIBRARY_NAME_=library_name,
+        _VARIABLE_NAMES_=", ".join('"%s"' % v for v in variables),
+        _LINK_NAMES_=", ".join('"%s"' % l for l in links),
+        _VARIABLE_COUNT_=str(len(variables)),
+        _LINK_COUNT_=str(len(links)),
+        _LINK_TRANSFORMS_=generate_link_transforms(chain),
+        _JACOBIAN_COLUMNS_=generate_jacobian_columns(chain),
+    )
+
+    copy_file(
+        template_dir + "/fk_kernel_plugin_template.cpp",
+        os.path.join(package_path, "src", namespace + "_fk_kernel.cpp"),
+        "fk kernel plugin file",
+        replacements,
+    )
+    copy_file(
+        template_dir + "/CMakeLists.txt",
+        os.path.join(package_path, "CMakeLists.txt"),
+        "cmake file",
+        replacements,
+    )
+
+    # Create plugin definition .xml file
+    plugin_name = namespace + "/FKKernel"
+    plugin_def = etree.Element("library", path=library_name)
+    cl = etree.SubElement(
+        plugin_def,
+        "class",
+        name=plugin_name,
+        type=namespace + "::FKKernel",
+        base_class_type="moveit::core::FKKernel",
+    )
+    desc = etree.SubElement(cl, "description")
+    desc.text = "Specialized forward kinematics of %s %s" % (
+        args.robot_name,
+        args.planning_group_name,
+    )
+    plugin_file_path = os.path.join(package_path, library_name + "_description.xml")
+    etree.ElementTree(plugin_def).write(plugin_file_path, xml_declaration=True, encoding="UTF-8")
+    print("Created plugin definition at '%s'" % plugin_file_path)
+    print(
+        "Set robot_description_kinematics.%s.fk_kernel to '%s' to use the kernel"
+        % (args.planning_group_name, plugin_name)
+    )
+
+
+def main():
+    parser = create_parser()
+    args = parser.parse_args()
+    create_fk_kernel_package(args)
+
+
+if __name__ == "__main__":
+    main()
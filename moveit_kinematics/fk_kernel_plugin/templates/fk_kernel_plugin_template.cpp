@@ -1,8 +1,7 @@
 /*********************************************************************
- *
  * Software License Agreement (BSD License)
  *
- *  Copyright (c) 2012, Willow Garage, Inc.
+ *  Copyright (c) 2024, PickNik Robotics
  *  All rights reserved.
  *
  *  Redistribution and use in source and binary forms, with or without
@@ -15,7 +14,7 @@
  *     copyright notice, this list of conditions and the following
  *     disclaimer in the documentation and/or other materials provided
  *     with the distribution.
- *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *   * Neither the name of PickNik Robotics nor the names of its
  *     contributors may be used to endorse or promote products derived
  *     from this software without specific prior written permission.
  *
@@ -31,76 +30,51 @@
  *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
  *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  *  POSSIBILITY OF SUCH DAMAGE.
- *
- * Author: Sachin Chitta
  *********************************************************************/
 
-#pragma once
-
-// ROS msgs
-#include <geometry_msgs/PoseStamped.h>
-
-// MoveIt
-#include <moveit_msgs/msg/move_it_error_codes.hpp>
-#include <moveit/robot_model/robot_model.h>
-#include <moveit/robot_state/robot_state.h>
-#include <moveit/robot_model/robot_model.h>
-#include <moveit/kinematic_constraints/kinematic_constraint.h>
+/* Generated by create_fk_kernel_plugin.py for the chain _BASE_LINK_ -> _TIP_LINK_ of _ROBOT_NAME_. Do not edit. */
 
-// std
-#include <memory>
+#include <moveit/robot_model/fk_kernel.h>
+#include <class_loader/class_loader.hpp>
+#include <cmath>
 
-namespace kinematics_constraint_aware
+namespace _NAMESPACE_
 {
-/**
- * @class A kinematics request
- */
-class KinematicsRequest
+class FKKernel : public moveit::core::FKKernel
 {
 public:
-  KinematicsRequest()
+  const std::vector<std::string>& getVariableNames() const override
   {
+    static const std::vector<std::string> NAMES = { _VARIABLE_NAMES_ };
+    return NAMES;
   }
 
-  virtual ~KinematicsRequest(){};
-
-  std::vector<geometry_msgs::PoseStamped> pose_stamped_vector_;
-
-  std::vector<std::string> ik_link_names_;
-
-  moveit::core::RobotStatePtr robot_state_;
-
-  kinematic_constraints::KinematicConstraintSetPtr constraints_;
-
-  ros::Duration timeout_;
-
-  std::string group_name_;
-
-  bool check_for_collisions_;
-
-  moveit::core::StateValidityCallbackFn constraint_callback_;
-};
-
-/**
- * @class A kinematics response
- */
-class KinematicsResponse
-{
-public:
-  KinematicsResponse()
+  const std::vector<std::string>& getLinkNames() const override
   {
+    static const std::vector<std::string> NAMES = { _LINK_NAMES_ };
+    return NAMES;
   }
 
-  virtual ~KinematicsResponse(){};
-
-  moveit::core::RobotStatePtr solution_;
-
-  std::vector<kinematic_constraints::ConstraintEvaluationResult> constraint_eval_results_;
-
-  collision_detection::CollisionResult collision_result_;
-
-  moveit_msgs::msg::MoveItErrorCodes error_code_;
+  void computeLinkTransforms(const double* values, Eigen::Isometry3d* link_transforms) const override
+  {
+    Eigen::Matrix3d r;
+    Eigen::Vector3d t;
+    double s, c;
+    (void)values;
+    (void)s;
+    (void)c;
+_LINK_TRANSFORMS_
+  }
 
-  bool result_;
+  void computeJacobian(const double* values, Eigen::MatrixXd& jacobian) const override
+  {
+    Eigen::Isometry3d link_transforms[_LINK_COUNT_];
+    computeLinkTransforms(values, link_transforms);
+    const Eigen::Vector3d& tip = link_transforms[_LINK_COUNT_ - 1].translation();
+    jacobian.setZero(6, _VARIABLE_COUNT_);
+_JACOBIAN_COLUMNS_
+  }
 };
-}  // namespace kinematics_constraint_aware
+}  // namespace _NAMESPACE_
+
+CLASS_LOADER_REGISTER_CLASS(_NAMESPACE_::FKKernel, moveit::core::FKKernel);
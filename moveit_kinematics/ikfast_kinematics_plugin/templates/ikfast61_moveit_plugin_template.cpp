@@ -156,6 +156,10 @@ class IKFastKinematicsPlugin : public kinematics::KinematicsBase
   std::vector<double> joint_min_vector_;
   std::vector<double> joint_max_vector_;
   std::vector<bool> joint_has_limits_vector_;
+  // the joint limits as arrays, for evaluating all solution branches at once
+  Eigen::ArrayXd joint_min_array_;
+  Eigen::ArrayXd joint_max_array_;
+  Eigen::Array<bool, Eigen::Dynamic, 1> joint_has_limits_array_;
   std::vector<std::string> link_names_;
   const size_t num_joints_;
   std::vector<int> free_params_;
@@ -238,6 +242,37 @@ public:
                      std::vector<std::vector<double>>& solutions, kinematics::KinematicsResult& result,
                      const kinematics::KinematicsQueryOptions& options) const override;
 
+  /**
+   * @brief Compute all IK branches for a pose at once, as the columns of a dense matrix
+   *
+   * In contrast to getPositionIK(), the branches of all sampled values of the redundant joint are evaluated for joint
+   * limits and distance to the seed in a single pass over the whole matrix instead of one solution at a time.
+   *
+   * @param ik_pose The desired pose of the tip link
+   * @param ik_seed_state The seed; limited joints are rotated by +/-360° towards it where possible
+   * @param solutions One column per branch within the joint limits, ordered by increasing distance to the seed
+   * @param seed_distances The L1 distance of each column of solutions to the seed
+   * @param result A struct that reports the results of the query
+   * @param options The discretization method used for the redundant joint
+   * @return True if at least one branch is within the joint limits
+   */
+  bool getAllPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        Eigen::MatrixXd& solutions, Eigen::VectorXd& seed_distances,
+                        kinematics::KinematicsResult& result,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
+
+  /**
+   * @brief getAllPositionIK() for several poses, e.g. for ranking many grasp candidates
+   *
+   * solutions, seed_distances and results are resized to the number of poses.
+   * @return True if at least one pose has a branch within the joint limits
+   */
+  bool getAllPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+      std::vector<Eigen::MatrixXd>& solutions, std::vector<Eigen::VectorXd>& seed_distances,
+      std::vector<kinematics::KinematicsResult>& results,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
+
   /**
    * @brief Given a desired pose of the end-effector, search for the joint angles required to reach it.
    * This particular method is intended for "searching" for a solutions by stepping through the redundancy
@@ -507,6 +542,12 @@ bool IKFastKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node,
                                                        << joint_max_vector_[joint_id] << " "
                                                        << joint_has_limits_vector_[joint_id]);
 
+  joint_min_array_ = Eigen::Map<const Eigen::ArrayXd>(joint_min_vector_.data(), num_joints_);
+  joint_max_array_ = Eigen::Map<const Eigen::ArrayXd>(joint_max_vector_.data(), num_joints_);
+  joint_has_limits_array_.resize(num_joints_);
+  for (size_t joint_id = 0; joint_id < num_joints_; ++joint_id)
+    joint_has_limits_array_[joint_id] = joint_has_limits_vector_[joint_id];
+
   initialized_ = true;
   return true;
 }
@@ -1335,6 +1376,140 @@ bool IKFastKinematicsPlugin::getPositionIK(const std::vector<geometry_msgs::msg:
   return false;
 }
 
+bool IKFastKinematicsPlugin::getAllPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                              const std::vector<double>& ik_seed_state, Eigen::MatrixXd& solutions,
+                                              Eigen::VectorXd& seed_distances, kinematics::KinematicsResult& result,
+                                              const kinematics::KinematicsQueryOptions& options) const
+{
+  solutions.resize(num_joints_, 0);
+  seed_distances.resize(0);
+
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics not active");
+    result.kinematic_error = kinematics::KinematicErrors::SOLVER_NOT_ACTIVE;
+    return false;
+  }
+
+  if (ik_seed_state.size() < num_joints_)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "ik_seed_state only has " << ik_seed_state.size()
+                                                          << " entries, this ikfast solver requires " << num_joints_);
+    result.kinematic_error = kinematics::KinematicErrors::NO_SOLUTION;
+    return false;
+  }
+
+  std::vector<double> sampled_joint_vals;
+  if (!redundant_joint_indices_.empty())
+  {
+    const int index = redundant_joint_indices_.front();
+    sampled_joint_vals.push_back(ik_seed_state[index]);
+    if (options.discretization_method == kinematics::DiscretizationMethods::NO_DISCRETIZATION &&
+        joint_has_limits_vector_[index] &&
+        !((sampled_joint_vals[0] > (joint_min_vector_[index] - LIMIT_TOLERANCE)) &&
+          (sampled_joint_vals[0] < (joint_max_vector_[index] + LIMIT_TOLERANCE))))
+    {
+      result.kinematic_error = kinematics::KinematicErrors::IK_SEED_OUTSIDE_LIMITS;
+      RCLCPP_ERROR_STREAM(LOGGER, "ik seed is out of bounds");
+      return false;
+    }
+    if (!sampleRedundantJoint(options.discretization_method, sampled_joint_vals))
+    {
+      result.kinematic_error = kinematics::KinematicErrors::UNSUPORTED_DISCRETIZATION_REQUESTED;
+      return false;
+    }
+  }
+
+  KDL::Frame frame;
+  transformToChainFrame(ik_pose, frame);
+
+  // collect the raw branches of all sampled redundant joint values, one column each
+  IkSolutionList<IkReal> ik_solutions;
+  std::vector<double> vfree;
+  std::vector<double> raw_solutions;
+  std::vector<IkReal> vsolfree;
+  Eigen::Index count = 0;
+  for (std::size_t sample = 0; sample < std::max<std::size_t>(1, sampled_joint_vals.size()); ++sample)
+  {
+    if (!sampled_joint_vals.empty())
+      vfree.assign(1, sampled_joint_vals[sample]);
+    const std::size_t numsol = solve(frame, vfree, ik_solutions);
+    raw_solutions.resize((count + numsol) * num_joints_);
+    for (std::size_t s = 0; s < numsol; ++s, ++count)
+    {
+      const IkSolutionBase<IkReal>& sol = ik_solutions.GetSolution(s);
+      vsolfree.resize(sol.GetFree().size());
+      sol.GetSolution(&raw_solutions[count * num_joints_], vsolfree.empty() ? nullptr : &vsolfree[0]);
+    }
+  }
+  RCLCPP_DEBUG_STREAM(LOGGER, "Found " << count << " solutions from IKFast");
+  if (count == 0)
+  {
+    result.kinematic_error = kinematics::KinematicErrors::NO_SOLUTION;
+    return false;
+  }
+
+  Eigen::ArrayXXd values = Eigen::Map<const Eigen::ArrayXXd>(raw_solutions.data(), num_joints_, count);
+  const Eigen::ArrayXd seed = Eigen::Map<const Eigen::ArrayXd>(ik_seed_state.data(), num_joints_);
+  const Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> limited = joint_has_limits_array_.replicate(1, count);
+  const double two_pi = 2 * M_PI;
+
+  // wrap limited joints into their bounds as enforceLimits() does ...
+  Eigen::ArrayXXd wrapped = values - two_pi * ((values.colwise() - joint_max_array_) / two_pi).ceil().max(0.0);
+  wrapped += two_pi * ((-(wrapped.colwise() - joint_min_array_)) / two_pi).ceil().max(0.0);
+  // ... and rotate them by +/-360° towards the seed as far as the bounds allow, like getSolution()
+  const Eigen::ArrayXXd turns = ((wrapped.colwise() - seed) / two_pi).round();
+  const Eigen::ArrayXXd max_turns_down =
+      ((wrapped.colwise() - (joint_min_array_ - LIMIT_TOLERANCE)) / two_pi).floor().max(0.0);
+  const Eigen::ArrayXXd max_turns_up =
+      ((-(wrapped.colwise() - (joint_max_array_ + LIMIT_TOLERANCE))) / two_pi).floor().max(0.0);
+  wrapped -= two_pi * turns.max(-max_turns_up).min(max_turns_down);
+  values = limited.select(wrapped, values);
+
+  const Eigen::ArrayXXd lower = (joint_min_array_ - LIMIT_TOLERANCE).replicate(1, count);
+  const Eigen::ArrayXXd upper = (joint_max_array_ + LIMIT_TOLERANCE).replicate(1, count);
+  const Eigen::Array<bool, 1, Eigen::Dynamic> obeys_limits =
+      !(limited && (values < lower || values > upper)).colwise().any();
+  const Eigen::ArrayXd distances = (values.colwise() - seed).abs().colwise().sum().transpose();
+
+  std::vector<Eigen::Index> order;
+  for (Eigen::Index s = 0; s < count; ++s)
+    if (obeys_limits[s])
+      order.push_back(s);
+  std::sort(order.begin(), order.end(), [&](Eigen::Index a, Eigen::Index b) { return distances[a] < distances[b]; });
+
+  solutions.resize(num_joints_, order.size());
+  seed_distances.resize(order.size());
+  for (std::size_t s = 0; s < order.size(); ++s)
+  {
+    solutions.col(s) = values.col(order[s]).matrix();
+    seed_distances[s] = distances[order[s]];
+  }
+
+  result.kinematic_error = order.empty() ? kinematics::KinematicErrors::NO_SOLUTION : kinematics::KinematicErrors::OK;
+  return !order.empty();
+}
+
+bool IKFastKinematicsPlugin::getAllPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                   const std::vector<double>& ik_seed_state,
+                                                   std::vector<Eigen::MatrixXd>& solutions,
+                                                   std::vector<Eigen::VectorXd>& seed_distances,
+                                                   std::vector<kinematics::KinematicsResult>& results,
+                                                   const kinematics::KinematicsQueryOptions& options) const
+{
+  solutions.resize(ik_poses.size());
+  seed_distances.resize(ik_poses.size());
+  results.resize(ik_poses.size());
+
+  bool solutions_found = false;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    solutions_found |=
+        getAllPositionIK(ik_poses[i], ik_seed_state, solutions[i], seed_distances[i], results[i], options);
+  }
+  return solutions_found;
+}
+
 bool IKFastKinematicsPlugin::sampleRedundantJoint(kinematics::DiscretizationMethod method,
                                                   std::vector<double>& sampled_joint_vals) const
 {
@@ -103,6 +103,7 @@ private:
   ChainJntToJacSolver jnt2jac_;
 
   Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
+  Eigen::MatrixXd jac_weighted_;  // weighted (position rows of the) reduced Jacobian, preallocated for svd_
   Eigen::VectorXd qdot_out_reduced_;
 
   Jacobian jac_;          // full Jacobian
@@ -52,6 +52,8 @@
 #include <kdl/chainfksolver.hpp>
 #include <kdl/chainiksolver.hpp>
 
+#include <Eigen/Geometry>
+
 // MoveIt
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/kdl_kinematics_plugin/joint_mimic.hpp>
@@ -59,6 +61,8 @@
 #include <moveit/robot_state/robot_state.h>
 
 #include <cfloat>
+#include <memory>
+#include <mutex>
 
 namespace KDL
 {
@@ -79,6 +83,8 @@ public:
    */
   KDLKinematicsPlugin();
 
+  ~KDLKinematicsPlugin() override;
+
   bool
   getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
                 std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
@@ -107,6 +113,23 @@ public:
       const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
 
+  /** @brief Eigen-native variant of searchPositionIK() for latency-critical callers
+   *
+   * Seed and solution need to be of the size of getJointNames(). The call works on a preallocated workspace of solvers
+   * and buffers, so that no memory is allocated once the plugin served a first request at this level of concurrency.
+   */
+  bool searchPositionIK(const Eigen::Isometry3d& ik_pose, const Eigen::Ref<const Eigen::VectorXd>& ik_seed_state,
+                        double timeout, Eigen::Ref<Eigen::VectorXd> solution,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
+
+  /** Solves the poses concurrently, with one set of KDL solvers per thread */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double>>& ik_seed_states,
+      double timeout, std::vector<std::vector<double>>& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -127,16 +150,69 @@ public:
 protected:
   typedef Eigen::Matrix<double, 6, 1> Twist;
 
+  /// Buffers of CartToJnt(), which are allocated once and reused across iterations and calls
+  struct CartToJntBuffers
+  {
+    CartToJntBuffers(unsigned int dimension, std::size_t num_weights);
+
+    KDL::JntArray delta_q;
+    KDL::JntArray q_backup;
+    Eigen::ArrayXd extra_joint_weights;
+    Eigen::VectorXd weights;  ///< product of the joint weights and the extra weights
+  };
+
   /// Solve position IK given initial joint values
   // NOLINTNEXTLINE(readability-identifier-naming)
   int CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init, const KDL::Frame& p_in,
                 KDL::JntArray& q_out, const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
                 const Twist& cartesian_weights) const;
 
+  /// Solve position IK given initial joint values, using the given forward kinematics solver
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
+                const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const;
+
+  /// Solve position IK given initial joint values, using the given solvers and buffers, without allocating memory
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
+                const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights,
+                CartToJntBuffers& buffers) const;
+
 private:
+  /// Solvers, random number generator and buffers needed by a single IK query
+  struct Workspace;
+
   void getJointWeights();
   bool timedOut(const rclcpp::Time& start_time, double duration) const;
 
+  /// Take a workspace from the pool, creating a new one if all of them are in use
+  std::unique_ptr<Workspace> acquireWorkspace() const;
+  /// Return a workspace to the pool
+  void releaseWorkspace(std::unique_ptr<Workspace> workspace) const;
+
+  /** @brief searchPositionIK() for message types on the given workspace, which is not shared with other threads */
+  bool searchPositionIK(Workspace& workspace, const geometry_msgs::msg::Pose& ik_pose,
+                        const std::vector<double>& ik_seed_state, double timeout,
+                        const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options, bool random_start = false,
+                        const std::atomic<bool>* cancel = nullptr) const;
+
+  /** @brief Implementation of searchPositionIK() on the given workspace
+   *
+   * solution_check is called for solutions passing the consistency check and may reject them by setting an error code
+   * other than SUCCESS. With random_start, even the first attempt starts from a random configuration. The search stops
+   * early once cancel is set. */
+  bool searchPositionIK(Workspace& workspace, const KDL::Frame& pose_desired,
+                        const Eigen::Ref<const Eigen::VectorXd>& ik_seed_state, double timeout,
+                        const std::vector<double>& consistency_limits, Eigen::Ref<Eigen::VectorXd> solution,
+                        const std::function<void(moveit_msgs::msg::MoveItErrorCodes&)>& solution_check,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options, bool random_start = false,
+                        const std::atomic<bool>* cancel = nullptr) const;
+
   /** @brief Check whether the solution lies within the consistency limits of the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
@@ -146,15 +222,15 @@ private:
   bool checkConsistency(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
                         const Eigen::VectorXd& solution) const;
 
-  void getRandomConfiguration(Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, Eigen::VectorXd& jnt_array) const;
 
   /** @brief Get a random configuration within consistency limits close to the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
-                              Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, const Eigen::VectorXd& seed_state,
+                              const std::vector<double>& consistency_limits, Eigen::VectorXd& jnt_array) const;
 
   /// clip q_delta such that joint limits will not be violated
   void clipToJointLimits(const KDL::JntArray& q, KDL::JntArray& q_delta, Eigen::ArrayXd& weighting) const;
@@ -167,7 +243,6 @@ private:
   moveit_msgs::msg::KinematicSolverInfo solver_info_;  ///< Stores information for the inverse kinematics solver
 
   const moveit::core::JointModelGroup* joint_model_group_;
-  moveit::core::RobotStatePtr state_;
   KDL::Chain kdl_chain_;
   std::unique_ptr<KDL::ChainFkSolverPos> fk_solver_;
   std::vector<JointMimic> mimic_joints_;
@@ -182,5 +257,8 @@ private:
    * > 1.0: orientation has more importance than position
    * = 0.0: perform position-only IK */
   double orientation_vs_position_weight_;
+
+  mutable std::mutex workspaces_mutex_;
+  mutable std::vector<std::unique_ptr<Workspace>> workspaces_;  ///< idle workspaces
 };
 }  // namespace kdl_kinematics_plugin
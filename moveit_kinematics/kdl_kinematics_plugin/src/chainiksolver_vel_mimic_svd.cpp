@@ -51,6 +51,8 @@ ChainIkSolverVelMimicSVD::ChainIkSolverVelMimicSVD(const Chain& chain,
   // Performing a position-only IK, we just need to consider the first 3 rows of the Jacobian for SVD
   // SVD doesn't consider mimic joints, but only their driving joints
   , svd_(position_ik ? 3 : 6, chain_.getNrOfJoints() - num_mimic_joints_, Eigen::ComputeThinU | Eigen::ComputeThinV)
+  , jac_weighted_(svd_.rows(), svd_.cols())
+  , qdot_out_reduced_(svd_.cols())
   , jac_(chain_.getNrOfJoints())
   , jac_reduced_(svd_.cols())
 {
@@ -98,11 +100,10 @@ int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in,
   else
     jnt2jac_.JntToJac(q_in, jac_reduced_);
 
-  // weight Jacobian
-  auto& jac = jac_reduced_.data;
+  // weight Jacobian, writing into a preallocated matrix as svd_.compute() would copy a block expression
   const Eigen::Index rows = svd_.rows();  // only operate on position rows?
-  jac.topRows(rows) *= joint_weights.asDiagonal();
-  jac.topRows(rows).transpose() *= cartesian_weights.topRows(rows).asDiagonal();
+  jac_weighted_ =
+      cartesian_weights.topRows(rows).asDiagonal() * jac_reduced_.data.topRows(rows) * joint_weights.asDiagonal();
 
   // transform v_in to 6D Eigen::Vector
   Eigen::Matrix<double, 6, 1> vin;
@@ -110,18 +111,24 @@ int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in,
   vin.bottomRows<3>() = Eigen::Map<const Eigen::Array3d>(v_in.rot.data, 3) * cartesian_weights.bottomRows<3>().array();
 
   // Do a singular value decomposition: J = U*S*V^t
-  svd_.compute(jac.topRows(rows));
+  svd_.compute(jac_weighted_);
+
+  // Solve like svd_.solve(), but with a fixed-size intermediate instead of a dynamically allocated one
+  const Eigen::Index rank = svd_.rank();
+  Eigen::Matrix<double, 6, 1> tmp;
+  tmp.head(rank).noalias() = svd_.matrixU().leftCols(rank).adjoint() * vin.topRows(rows);
+  tmp.head(rank).array() /= svd_.singularValues().head(rank).array();
 
   if (num_mimic_joints_ > 0)
   {
-    qdot_out_reduced_.noalias() = svd_.solve(vin.topRows(rows));
+    qdot_out_reduced_.noalias() = svd_.matrixV().leftCols(rank) * tmp.head(rank);
     qdot_out_reduced_.array() *= joint_weights.array();
     for (unsigned int i = 0; i < chain_.getNrOfJoints(); ++i)
       qdot_out(i) = qdot_out_reduced_[mimic_joints_[i].map_index] * mimic_joints_[i].multiplier;
   }
   else
   {
-    qdot_out.data.noalias() = svd_.solve(vin.topRows(rows));
+    qdot_out.data.noalias() = svd_.matrixV().leftCols(rank) * tmp.head(rank);
     qdot_out.data.array() *= joint_weights.array();
   }
 
@@ -50,28 +50,61 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <thread>
+
 namespace kdl_kinematics_plugin
 {
 static rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kdl_kinematics_plugin.kdl_kinematics_plugin");
 
 rclcpp::Clock KDLKinematicsPlugin::steady_clock_{ RCL_STEADY_TIME };
 
+struct KDLKinematicsPlugin::Workspace
+{
+  Workspace(const KDL::Chain& chain, const std::vector<JointMimic>& mimic_joints, bool position_ik,
+            unsigned int dimension, std::size_t num_weights)
+    : fk_solver(chain)
+    , ik_solver_vel(chain, mimic_joints, position_ik)
+    , jnt_seed_state(dimension)
+    , jnt_pos_in(dimension)
+    , jnt_pos_out(dimension)
+    , buffers(dimension, num_weights)
+  {
+    consistency_limits_mimic.reserve(dimension);
+  }
+
+  KDL::ChainFkSolverPos_recursive fk_solver;
+  KDL::ChainIkSolverVelMimicSVD ik_solver_vel;
+  random_numbers::RandomNumberGenerator rng;
+  KDL::JntArray jnt_seed_state;
+  KDL::JntArray jnt_pos_in;
+  KDL::JntArray jnt_pos_out;
+  CartToJntBuffers buffers;
+  std::vector<double> consistency_limits_mimic;
+};
+
+KDLKinematicsPlugin::CartToJntBuffers::CartToJntBuffers(unsigned int dimension, std::size_t num_weights)
+  : delta_q(dimension), q_backup(dimension), extra_joint_weights(num_weights), weights(num_weights)
+{
+}
+
 KDLKinematicsPlugin::KDLKinematicsPlugin() : initialized_(false)
 {
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+KDLKinematicsPlugin::~KDLKinematicsPlugin() = default;
+
+void KDLKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  joint_model_group_->getVariableRandomPositions(rng, &jnt_array[0]);
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void KDLKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(rng, &jnt_array[0], &seed_state[0], consistency_limits);
 }
 
 bool KDLKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -263,9 +296,6 @@ bool KDLKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const
     }
   }
 
-  // Setup the joint state groups that we need
-  state_ = std::make_shared<moveit::core::RobotState>(robot_model_);
-
   fk_solver_ = std::make_unique<KDL::ChainFkSolverPos_recursive>(kdl_chain_);
 
   initialized_ = true;
@@ -278,6 +308,27 @@ bool KDLKinematicsPlugin::timedOut(const rclcpp::Time& start_time, double durati
   return ((steady_clock_.now() - start_time).seconds() >= duration);
 }
 
+std::unique_ptr<KDLKinematicsPlugin::Workspace> KDLKinematicsPlugin::acquireWorkspace() const
+{
+  {
+    std::lock_guard<std::mutex> lock(workspaces_mutex_);
+    if (!workspaces_.empty())
+    {
+      std::unique_ptr<Workspace> workspace = std::move(workspaces_.back());
+      workspaces_.pop_back();
+      return workspace;
+    }
+  }
+  return std::make_unique<Workspace>(kdl_chain_, mimic_joints_, orientation_vs_position_weight_ == 0.0, dimension_,
+                                     joint_weights_.size());
+}
+
+void KDLKinematicsPlugin::releaseWorkspace(std::unique_ptr<Workspace> workspace) const
+{
+  std::lock_guard<std::mutex> lock(workspaces_mutex_);
+  workspaces_.push_back(std::move(workspace));
+}
+
 bool KDLKinematicsPlugin::getPositionIK(const geometry_msgs::msg::Pose& ik_pose,
                                         const std::vector<double>& ik_seed_state, std::vector<double>& solution,
                                         moveit_msgs::msg::MoveItErrorCodes& error_code,
@@ -329,6 +380,116 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            const IKCallbackFn& solution_callback,
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
+{
+  if (options.parallel_seeds > 1)
+  {
+    // race the given seed against random restarts, each search on its own workspace
+    std::vector<std::unique_ptr<Workspace>> workspaces;
+    for (unsigned int thread = 0; thread < options.parallel_seeds; ++thread)
+      workspaces.push_back(acquireWorkspace());
+    std::vector<std::vector<double>> solutions(options.parallel_seeds);
+    std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes(options.parallel_seeds);
+
+    const int winner =
+        raceSearches(options.parallel_seeds, [&](unsigned int thread, const std::atomic<bool>& cancel) {
+          return searchPositionIK(*workspaces[thread], ik_pose, ik_seed_state, timeout, consistency_limits,
+                                  solutions[thread], solution_callback, error_codes[thread], options, thread > 0,
+                                  &cancel);
+        });
+    for (std::unique_ptr<Workspace>& workspace : workspaces)
+      releaseWorkspace(std::move(workspace));
+
+    error_code = error_codes[std::max(winner, 0)];
+    if (winner < 0)
+      return false;
+    solution = std::move(solutions[winner]);
+    return true;
+  }
+
+  std::unique_ptr<Workspace> workspace = acquireWorkspace();
+  const bool result = searchPositionIK(*workspace, ik_pose, ik_seed_state, timeout, consistency_limits, solution,
+                                       solution_callback, error_code, options);
+  releaseWorkspace(std::move(workspace));
+  return result;
+}
+
+bool KDLKinematicsPlugin::searchPositionIK(const Eigen::Isometry3d& ik_pose,
+                                           const Eigen::Ref<const Eigen::VectorXd>& ik_seed_state, double timeout,
+                                           Eigen::Ref<Eigen::VectorXd> solution,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options) const
+{
+  const Eigen::Matrix3d& rotation = ik_pose.linear();
+  const KDL::Frame pose_desired(KDL::Rotation(rotation(0, 0), rotation(0, 1), rotation(0, 2), rotation(1, 0),
+                                              rotation(1, 1), rotation(1, 2), rotation(2, 0), rotation(2, 1),
+                                              rotation(2, 2)),
+                                KDL::Vector(ik_pose.translation().x(), ik_pose.translation().y(),
+                                            ik_pose.translation().z()));
+
+  std::unique_ptr<Workspace> workspace = acquireWorkspace();
+  const bool result = searchPositionIK(*workspace, pose_desired, ik_seed_state, timeout, std::vector<double>(),
+                                       solution, nullptr, error_code, options);
+  releaseWorkspace(std::move(workspace));
+  return result;
+}
+
+bool KDLKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double>>& ik_seed_states, double timeout,
+                                                std::vector<std::vector<double>>& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options) const
+{
+  // every thread works on its own workspace, while the chain is shared
+  const unsigned int thread_count =
+      std::max(1u, std::min<unsigned int>(std::thread::hardware_concurrency(), ik_poses.size()));
+  std::vector<std::unique_ptr<Workspace>> workspaces;
+  for (unsigned int thread = 0; thread < thread_count; ++thread)
+    workspaces.push_back(acquireWorkspace());
+
+  const bool result = solveBatch(ik_poses, ik_seed_states, solutions, error_codes, thread_count,
+                                 [&](unsigned int thread, std::size_t index, const std::vector<double>& seed) {
+                                   return searchPositionIK(*workspaces[thread], ik_poses[index], seed, timeout,
+                                                           std::vector<double>(), solutions[index], IKCallbackFn(),
+                                                           error_codes[index], options);
+                                 });
+  for (std::unique_ptr<Workspace>& workspace : workspaces)
+    releaseWorkspace(std::move(workspace));
+  return result;
+}
+
+bool KDLKinematicsPlugin::searchPositionIK(Workspace& workspace, const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options, bool random_start,
+                                           const std::atomic<bool>* cancel) const
+{
+  KDL::Frame pose_desired;
+  tf2::fromMsg(ik_pose, pose_desired);
+
+  RCLCPP_DEBUG_STREAM(LOGGER, "searchPositionIK: Position request pose is "
+                                  << ik_pose.position.x << " " << ik_pose.position.y << " " << ik_pose.position.z << " "
+                                  << ik_pose.orientation.x << " " << ik_pose.orientation.y << " "
+                                  << ik_pose.orientation.z << " " << ik_pose.orientation.w);
+
+  solution.resize(dimension_);
+  std::function<void(moveit_msgs::msg::MoveItErrorCodes&)> solution_check;
+  if (solution_callback)
+    solution_check = [&](moveit_msgs::msg::MoveItErrorCodes& code) { solution_callback(ik_pose, solution, code); };
+
+  return searchPositionIK(workspace, pose_desired,
+                          Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size()), timeout,
+                          consistency_limits, Eigen::Map<Eigen::VectorXd>(solution.data(), solution.size()),
+                          solution_check, error_code, options, random_start, cancel);
+}
+
+bool KDLKinematicsPlugin::searchPositionIK(
+    Workspace& workspace, const KDL::Frame& pose_desired, const Eigen::Ref<const Eigen::VectorXd>& ik_seed_state,
+    double timeout, const std::vector<double>& consistency_limits, Eigen::Ref<Eigen::VectorXd> solution,
+    const std::function<void(moveit_msgs::msg::MoveItErrorCodes&)>& solution_check,
+    moveit_msgs::msg::MoveItErrorCodes& error_code, const kinematics::KinematicsQueryOptions& options,
+    bool random_start, const std::atomic<bool>* cancel) const
 {
   const rclcpp::Time start_time = steady_clock_.now();
   if (!initialized_)
@@ -338,15 +499,23 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
-  if (ik_seed_state.size() != dimension_)
+  if (ik_seed_state.size() != static_cast<Eigen::Index>(dimension_))
+  {
+    RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %ld\n", dimension_, ik_seed_state.size());
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  if (solution.size() != static_cast<Eigen::Index>(dimension_))
   {
-    RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %zu\n", dimension_, ik_seed_state.size());
+    RCLCPP_ERROR(LOGGER, "Solution must have size %d instead of size %ld\n", dimension_, solution.size());
     error_code.val = error_code.NO_IK_SOLUTION;
     return false;
   }
 
   // Resize consistency limits to remove mimic joints
-  std::vector<double> consistency_limits_mimic;
+  std::vector<double>& consistency_limits_mimic = workspace.consistency_limits_mimic;
+  consistency_limits_mimic.clear();
   if (!consistency_limits.empty())
   {
     if (consistency_limits.size() != dimension_)
@@ -367,49 +536,39 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   cartesian_weights.topRows<3>().setConstant(1.0);
   cartesian_weights.bottomRows<3>().setConstant(orientation_vs_position_weight_);
 
-  KDL::JntArray jnt_seed_state(dimension_);
-  KDL::JntArray jnt_pos_in(dimension_);
-  KDL::JntArray jnt_pos_out(dimension_);
-  jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
+  KDL::JntArray& jnt_seed_state = workspace.jnt_seed_state;
+  KDL::JntArray& jnt_pos_in = workspace.jnt_pos_in;
+  KDL::JntArray& jnt_pos_out = workspace.jnt_pos_out;
+  jnt_seed_state.data = ik_seed_state;
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverVelMimicSVD ik_solver_vel(kdl_chain_, mimic_joints_, orientation_vs_position_weight_ == 0.0);
-  solution.resize(dimension_);
-
-  KDL::Frame pose_desired;
-  tf2::fromMsg(ik_pose, pose_desired);
-
-  RCLCPP_DEBUG_STREAM(LOGGER, "searchPositionIK: Position request pose is "
-                                  << ik_pose.position.x << " " << ik_pose.position.y << " " << ik_pose.position.z << " "
-                                  << ik_pose.orientation.x << " " << ik_pose.orientation.y << " "
-                                  << ik_pose.orientation.z << " " << ik_pose.orientation.w);
-
   unsigned int attempt = 0;
   do
   {
     ++attempt;
-    if (attempt > 1)  // randomly re-seed after first attempt
+    if (attempt > 1 || random_start)  // randomly re-seed after first attempt
     {
       if (!consistency_limits_mimic.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
+        getRandomConfiguration(workspace.rng, jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(workspace.rng, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
-    int ik_valid =
-        CartToJnt(ik_solver_vel, jnt_pos_in, pose_desired, jnt_pos_out, max_solver_iterations_,
-                  Eigen::Map<const Eigen::VectorXd>(joint_weights_.data(), joint_weights_.size()), cartesian_weights);
+    int ik_valid = CartToJnt(workspace.fk_solver, workspace.ik_solver_vel, jnt_pos_in, pose_desired, jnt_pos_out,
+                             max_solver_iterations_,
+                             Eigen::Map<const Eigen::VectorXd>(joint_weights_.data(), joint_weights_.size()),
+                             cartesian_weights, workspace.buffers);
     if (ik_valid == 0 || options.return_approximate_solution)  // found acceptable solution
     {
       if (!consistency_limits_mimic.empty() &&
           !checkConsistency(jnt_seed_state.data, consistency_limits_mimic, jnt_pos_out.data))
         continue;
 
-      Eigen::Map<Eigen::VectorXd>(solution.data(), solution.size()) = jnt_pos_out.data;
-      if (solution_callback)
+      solution = jnt_pos_out.data;
+      if (solution_check)
       {
-        solution_callback(ik_pose, solution, error_code);
+        solution_check(error_code);
         if (error_code.val != error_code.SUCCESS)
           continue;
       }
@@ -420,7 +579,7 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                                   << "s and " << attempt << " attempts");
       return true;
     }
-  } while (!timedOut(start_time, timeout));
+  } while (!timedOut(start_time, timeout) && !(cancel && *cancel));
 
   RCLCPP_DEBUG_STREAM(LOGGER, "IK timed out after " << (steady_clock_.now() - start_time).seconds() << " > " << timeout
                                                     << "s and " << attempt << " attempts");
@@ -432,13 +591,33 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
 int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init,
                                    const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
                                    const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const
+{
+  return CartToJnt(*fk_solver_, ik_solver, q_init, p_in, q_out, max_iter, joint_weights, cartesian_weights);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                                   const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out,
+                                   const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
+                                   const Twist& cartesian_weights) const
+{
+  CartToJntBuffers buffers(q_out.rows(), joint_weights.rows());
+  return CartToJnt(fk_solver, ik_solver, q_init, p_in, q_out, max_iter, joint_weights, cartesian_weights, buffers);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(KDL::ChainFkSolverPos& fk_solver, KDL::ChainIkSolverVelMimicSVD& ik_solver,
+                                   const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out,
+                                   const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
+                                   const Twist& cartesian_weights, CartToJntBuffers& buffers) const
 {
   double last_delta_twist_norm = DBL_MAX;
   double step_size = 1.0;
   KDL::Frame f;
   KDL::Twist delta_twist;
-  KDL::JntArray delta_q(q_out.rows()), q_backup(q_out.rows());
-  Eigen::ArrayXd extra_joint_weights(joint_weights.rows());
+  KDL::JntArray& delta_q = buffers.delta_q;
+  KDL::JntArray& q_backup = buffers.q_backup;
+  Eigen::ArrayXd& extra_joint_weights = buffers.extra_joint_weights;
   extra_joint_weights.setOnes();
 
   q_out = q_init;
@@ -448,7 +627,7 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
   bool success = false;
   for (i = 0; i < max_iter; ++i)
   {
-    fk_solver_->JntToCart(q_out, f);
+    fk_solver.JntToCart(q_out, f);
     delta_twist = diff(f, p_in);
     RCLCPP_DEBUG_STREAM(LOGGER, "[" << std::setw(3) << i << "] delta_twist: " << delta_twist);
 
@@ -478,7 +657,8 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
       step_size = 1.0;   // reset step size
       last_delta_twist_norm = delta_twist_norm;
 
-      ik_solver.CartToJnt(q_out, delta_twist, delta_q, extra_joint_weights * joint_weights.array(), cartesian_weights);
+      buffers.weights.array() = extra_joint_weights * joint_weights.array();
+      ik_solver.CartToJnt(q_out, delta_twist, delta_q, buffers.weights, cartesian_weights);
     }
 
     clipToJointLimits(q_out, delta_q, extra_joint_weights);
@@ -99,6 +99,13 @@ public:
       const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
 
+  /** Solves the poses concurrently, with one LMA solver per thread */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double>>& ik_seed_states,
+      double timeout, std::vector<std::vector<double>>& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -119,6 +126,21 @@ public:
 private:
   bool timedOut(const rclcpp::Time& start_time, double duration) const;
 
+  /** Construct the LMA position IK solver for the chain, with the configured weights and tolerances */
+  std::unique_ptr<KDL::ChainIkSolverPos> createPositionIKSolver() const;
+
+  /** @brief Implementation of searchPositionIK() on the given solver and random number generator, which are not shared
+   * with other threads
+   *
+   * With random_start, even the first attempt starts from a random configuration. The search stops early once cancel
+   * is set. */
+  bool searchPositionIK(KDL::ChainIkSolverPos& ik_solver_pos, random_numbers::RandomNumberGenerator& rng,
+                        const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options, bool random_start = false,
+                        const std::atomic<bool>* cancel = nullptr) const;
+
   /** @brief Check whether the solution lies within the consistency limits of the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
@@ -132,15 +154,15 @@ private:
   /** Harmonize revolute joint values into the range -2 Pi .. 2 Pi */
   void harmonize(Eigen::VectorXd& values) const;
 
-  void getRandomConfiguration(Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, Eigen::VectorXd& jnt_array) const;
 
   /** @brief Get a random configuration within consistency limits close to the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
-                              Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, const Eigen::VectorXd& seed_state,
+                              const std::vector<double>& consistency_limits, Eigen::VectorXd& jnt_array) const;
 
   bool initialized_;  ///< Internal variable that indicates whether solver is configured and ready
 
@@ -43,6 +43,8 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <thread>
+
 // register as a KinematicsBase implementation
 #include <class_loader/class_loader.hpp>
 CLASS_LOADER_REGISTER_CLASS(lma_kinematics_plugin::LMAKinematicsPlugin, kinematics::KinematicsBase)
@@ -55,18 +57,18 @@ LMAKinematicsPlugin::LMAKinematicsPlugin() : initialized_(false)
 {
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+void LMAKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  joint_model_group_->getVariableRandomPositions(rng, &jnt_array[0]);
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void LMAKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(rng, &jnt_array[0], &seed_state[0], consistency_limits);
 }
 
 bool LMAKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -217,6 +219,85 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            const IKCallbackFn& solution_callback,
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
+{
+  if (options.parallel_seeds > 1)
+  {
+    // race the given seed against random restarts, each search on its own solver and random number generator
+    std::vector<std::unique_ptr<KDL::ChainIkSolverPos>> ik_solvers_pos;
+    std::vector<random_numbers::RandomNumberGenerator> rngs(options.parallel_seeds);
+    for (unsigned int thread = 0; thread < options.parallel_seeds; ++thread)
+      ik_solvers_pos.push_back(createPositionIKSolver());
+    std::vector<std::vector<double>> solutions(options.parallel_seeds);
+    std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes(options.parallel_seeds);
+
+    const int winner =
+        raceSearches(options.parallel_seeds, [&](unsigned int thread, const std::atomic<bool>& cancel) {
+          return searchPositionIK(*ik_solvers_pos[thread], rngs[thread], ik_pose, ik_seed_state, timeout,
+                                  consistency_limits, solutions[thread], solution_callback, error_codes[thread],
+                                  options, thread > 0, &cancel);
+        });
+
+    error_code = error_codes[std::max(winner, 0)];
+    if (winner < 0)
+      return false;
+    solution = std::move(solutions[winner]);
+    return true;
+  }
+
+  std::unique_ptr<KDL::ChainIkSolverPos> ik_solver_pos = createPositionIKSolver();
+  return searchPositionIK(*ik_solver_pos, state_->getRandomNumberGenerator(), ik_pose, ik_seed_state, timeout,
+                          consistency_limits, solution, solution_callback, error_code, options);
+}
+
+bool LMAKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double>>& ik_seed_states, double timeout,
+                                                std::vector<std::vector<double>>& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options) const
+{
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    return false;
+  }
+
+  // every thread works on its own solver and random number generator, while the chain is shared
+  const unsigned int thread_count =
+      std::max(1u, std::min<unsigned int>(std::thread::hardware_concurrency(), ik_poses.size()));
+  std::vector<std::unique_ptr<KDL::ChainIkSolverPos>> ik_solvers_pos;
+  std::vector<random_numbers::RandomNumberGenerator> rngs(thread_count);
+  for (unsigned int thread = 0; thread < thread_count; ++thread)
+    ik_solvers_pos.push_back(createPositionIKSolver());
+
+  return solveBatch(ik_poses, ik_seed_states, solutions, error_codes, thread_count,
+                    [&](unsigned int thread, std::size_t index, const std::vector<double>& seed) {
+                      return searchPositionIK(*ik_solvers_pos[thread], rngs[thread], ik_poses[index], seed, timeout,
+                                              std::vector<double>(), solutions[index], IKCallbackFn(),
+                                              error_codes[index], options);
+                    });
+}
+
+std::unique_ptr<KDL::ChainIkSolverPos> LMAKinematicsPlugin::createPositionIKSolver() const
+{
+  Eigen::Matrix<double, 6, 1> cartesian_weights;
+  cartesian_weights(0) = 1;
+  cartesian_weights(1) = 1;
+  cartesian_weights(2) = 1;
+  cartesian_weights(3) = orientation_vs_position_weight_;
+  cartesian_weights(4) = orientation_vs_position_weight_;
+  cartesian_weights(5) = orientation_vs_position_weight_;
+  return std::make_unique<KDL::ChainIkSolverPos_LMA>(kdl_chain_, cartesian_weights, epsilon_, max_solver_iterations_);
+}
+
+bool LMAKinematicsPlugin::searchPositionIK(KDL::ChainIkSolverPos& ik_solver_pos,
+                                           random_numbers::RandomNumberGenerator& rng,
+                                           const geometry_msgs::msg::Pose& ik_pose,
+                                           const std::vector<double>& ik_seed_state, double timeout,
+                                           const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                                           const IKCallbackFn& solution_callback,
+                                           moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                           const kinematics::KinematicsQueryOptions& options, bool random_start,
+                                           const std::atomic<bool>* cancel) const
 {
   rclcpp::Time start_time = node_->now();
   if (!initialized_)
@@ -241,21 +322,12 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
-  Eigen::Matrix<double, 6, 1> cartesian_weights;
-  cartesian_weights(0) = 1;
-  cartesian_weights(1) = 1;
-  cartesian_weights(2) = 1;
-  cartesian_weights(3) = orientation_vs_position_weight_;
-  cartesian_weights(4) = orientation_vs_position_weight_;
-  cartesian_weights(5) = orientation_vs_position_weight_;
-
   KDL::JntArray jnt_seed_state(dimension_);
   KDL::JntArray jnt_pos_in(dimension_);
   KDL::JntArray jnt_pos_out(dimension_);
   jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverPos_LMA ik_solver_pos(kdl_chain_, cartesian_weights, epsilon_, max_solver_iterations_);
   solution.resize(dimension_);
 
   KDL::Frame pose_desired;
@@ -269,12 +341,12 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   do
   {
     ++attempt;
-    if (attempt > 1)  // randomly re-seed after first attempt
+    if (attempt > 1 || random_start)  // randomly re-seed after first attempt
     {
       if (!consistency_limits.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
@@ -301,7 +373,7 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                                   << "s and " << attempt << " attempts");
       return true;
     }
-  } while (!timedOut(start_time, timeout));
+  } while (!timedOut(start_time, timeout) && !(cancel && *cancel));
 
   RCLCPP_DEBUG_STREAM(LOGGER, "IK timed out after " << (node_->now() - start_time).seconds() << " > " << timeout
                                                     << "s and " << attempt << " attempts");
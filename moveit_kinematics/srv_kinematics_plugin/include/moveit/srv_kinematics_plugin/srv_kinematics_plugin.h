@@ -46,11 +46,13 @@
 
 // System
 #include <memory>
+#include <thread>
 
 // ROS msgs
 #include <geometry_msgs/msg/pose.hpp>
 #include <moveit_msgs/msg/kinematic_solver_info.hpp>
 #include <moveit_msgs/msg/move_it_error_codes.hpp>
+#include <moveit_msgs/srv/get_position_ik.hpp>
 
 // MoveIt
 #include <moveit/kinematics_base/kinematics_base.h>
@@ -69,6 +71,7 @@ public:
    *  @brief Default constructor
    */
   SrvKinematicsPlugin();
+  ~SrvKinematicsPlugin() override;
 
   bool
   getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
@@ -148,8 +151,14 @@ private:
 
   int num_possible_redundant_joints_;
 
+  /** Persistent client shared by all calls; concurrent calls keep their requests in flight at the same time */
   rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedPtr ik_service_client_;
 
   rclcpp::Node::SharedPtr node_;
+
+  /** The client lives on its own node, spun by client_thread_, so calls neither spin nor depend on node_'s executor */
+  rclcpp::Node::SharedPtr client_node_;
+  rclcpp::executors::SingleThreadedExecutor::SharedPtr client_executor_;
+  std::thread client_thread_;
 };
 }  // namespace srv_kinematics_plugin
@@ -55,6 +55,14 @@ SrvKinematicsPlugin::SrvKinematicsPlugin() : active_(false)
 {
 }
 
+SrvKinematicsPlugin::~SrvKinematicsPlugin()
+{
+  if (client_executor_)
+    client_executor_->cancel();
+  if (client_thread_.joinable())
+    client_thread_.join();
+}
+
 bool SrvKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const moveit::core::RobotModel& robot_model,
                                      const std::string& group_name, const std::string& base_frame,
                                      const std::vector<std::string>& tip_frames, double search_discretization)
@@ -117,8 +125,17 @@ bool SrvKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const
   robot_state_ = std::make_shared<moveit::core::RobotState>(robot_model_);
   robot_state_->setToDefaultValues();
 
-  // Create the ROS2 service client
-  ik_service_client_ = node_->create_client<moveit_msgs::srv::GetPositionIK>(ik_service_name);
+  // Create the ROS2 service client on a private node whose responses are processed in the background. This way,
+  // calls from several threads (e.g. parallel planners) can have their requests in flight at the same time.
+  rclcpp::NodeOptions options;
+  options.arguments({ "--ros-args", "-r",
+                      "__node:=" + std::string("srv_kinematics_plugin_") +
+                          std::to_string(reinterpret_cast<std::size_t>(this)) });
+  client_node_ = rclcpp::Node::make_shared("_", node_->get_namespace(), options);
+  ik_service_client_ = client_node_->create_client<moveit_msgs::srv::GetPositionIK>(ik_service_name);
+  client_executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+  client_executor_->add_node(client_node_);
+  client_thread_ = std::thread([this] { client_executor_->spin(); });
 
   if (!ik_service_client_->wait_for_service(std::chrono::seconds(1)))  // wait 0.1 seconds, blocking
     RCLCPP_WARN_STREAM(LOGGER,
@@ -231,7 +248,7 @@ bool SrvKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
 }
 
 bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
-                                           const std::vector<double>& ik_seed_state, double /*timeout*/,
+                                           const std::vector<double>& ik_seed_state, double timeout,
                                            const std::vector<double>& /*consistency_limits*/,
                                            std::vector<double>& solution, const IKCallbackFn& solution_callback,
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
@@ -265,14 +282,21 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
     return false;
   }
 
+  // Each call gets its own timeout, which is also passed on to the remote solver
+  if (timeout <= 0.0)
+    timeout = default_timeout_;
+  const auto call_timeout = std::chrono::duration<double>(timeout);
+
   // Create the service message
   auto ik_srv = std::make_shared<moveit_msgs::srv::GetPositionIK::Request>();
   ik_srv->ik_request.avoid_collisions = true;
   ik_srv->ik_request.group_name = getGroupName();
+  ik_srv->ik_request.timeout = rclcpp::Duration::from_seconds(timeout);
 
-  // Copy seed state into virtual robot state and convert into moveit_msg
-  robot_state_->setJointGroupPositions(joint_model_group_, ik_seed_state);
-  moveit::core::robotStateToRobotStateMsg(*robot_state_, ik_srv->ik_request.robot_state);
+  // Copy seed state into a robot state local to this call and convert into moveit_msg
+  moveit::core::RobotState state(*robot_state_);
+  state.setJointGroupPositions(joint_model_group_, ik_seed_state);
+  moveit::core::robotStateToRobotStateMsg(state, ik_srv->ik_request.robot_state);
 
   // Load the poses into the request in difference places depending if there is more than one or not
   geometry_msgs::msg::PoseStamped ik_pose_st;
@@ -296,42 +320,51 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
     ik_srv->ik_request.ik_link_name = getTipFrames()[0];
   }
 
+  if (!ik_service_client_->service_is_ready() && !ik_service_client_->wait_for_service(call_timeout))
+  {
+    RCLCPP_DEBUG_STREAM(LOGGER,
+                        "Service call failed to connect to service: " << ik_service_client_->get_service_name());
+    error_code.val = error_code.FAILURE;
+    return false;
+  }
+
   RCLCPP_DEBUG(LOGGER, "Calling service: %s", ik_service_client_->get_service_name());
   auto result_future = ik_service_client_->async_send_request(ik_srv);
-  const auto& response = result_future.get();
-  if (rclcpp::spin_until_future_complete(node_, result_future) == rclcpp::FutureReturnCode::SUCCESS)
+  if (result_future.wait_for(call_timeout) != std::future_status::ready)
   {
-    // Check error code
-    error_code.val = response->error_code.val;
-    if (error_code.val != error_code.SUCCESS)
-    {
-      // TODO (JafarAbdi) Print the entire message for ROS2?
-      // RCLCPP_DEBUG("srv", "An IK that satisifes the constraints and is collision free could not be found."
-      //                                   << "\nRequest was: \n"
-      //                                   << ik_srv.request.ik_request << "\nResponse was: \n"
-      //                                   << ik_srv.response.solution);
-      switch (error_code.val)
-      {
-        case moveit_msgs::msg::MoveItErrorCodes::FAILURE:
-          RCLCPP_ERROR(LOGGER, "Service failed with with error code: FAILURE");
-          break;
-        case moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION:
-          RCLCPP_DEBUG(LOGGER, "Service failed with with error code: NO IK SOLUTION");
-          break;
-        default:
-          RCLCPP_DEBUG_STREAM(LOGGER, "Service failed with with error code: " << error_code.val);
-      }
-      return false;
-    }
+    // forget the request, a late response is dropped by the client
+    ik_service_client_->remove_pending_request(result_future);
+    RCLCPP_DEBUG_STREAM(LOGGER, "Service call to " << ik_service_client_->get_service_name() << " timed out after "
+                                                    << timeout << "s");
+    error_code.val = error_code.TIMED_OUT;
+    return false;
   }
-  else
+  const auto response = result_future.get();
+  // Check error code
+  error_code.val = response->error_code.val;
+  if (error_code.val != error_code.SUCCESS)
   {
-    RCLCPP_DEBUG_STREAM(LOGGER, "Service call failed to connect to service: " << ik_service_client_->get_service_name());
-    error_code.val = error_code.FAILURE;
+    // TODO (JafarAbdi) Print the entire message for ROS2?
+    // RCLCPP_DEBUG("srv", "An IK that satisifes the constraints and is collision free could not be found."
+    //                                   << "\nRequest was: \n"
+    //                                   << ik_srv.request.ik_request << "\nResponse was: \n"
+    //                                   << ik_srv.response.solution);
+    switch (error_code.val)
+    {
+      case moveit_msgs::msg::MoveItErrorCodes::FAILURE:
+        RCLCPP_ERROR(LOGGER, "Service failed with with error code: FAILURE");
+        break;
+      case moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION:
+        RCLCPP_DEBUG(LOGGER, "Service failed with with error code: NO IK SOLUTION");
+        break;
+      default:
+        RCLCPP_DEBUG_STREAM(LOGGER, "Service failed with with error code: " << error_code.val);
+    }
     return false;
   }
+
   // Convert the robot state message to our robot_state representation
-  if (!moveit::core::robotStateMsgToRobotState(response->solution, *robot_state_))
+  if (!moveit::core::robotStateMsgToRobotState(response->solution, state))
   {
     RCLCPP_ERROR(LOGGER, "An error occurred converting received robot state message into internal robot state.");
     error_code.val = error_code.FAILURE;
@@ -339,7 +372,7 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
   }
 
   // Get just the joints we are concerned about in our planning group
-  robot_state_->copyJointGroupPositions(joint_model_group_, solution);
+  state.copyJointGroupPositions(joint_model_group_, solution);
 
   // Run the solution callback (i.e. collision checker) if available
   if (solution_callback)
@@ -560,6 +560,124 @@ TEST_F(KinematicsTest, searchIK)
   EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
 }
 
+TEST_F(KinematicsTest, searchIKParallelSeeds)
+{
+  std::vector<double> seed(kinematics_solver_->getJointNames().size(), 0.0), fk_values, solution;
+  moveit_msgs::msg::MoveItErrorCodes error_code;
+  const std::vector<std::string>& fk_names = kinematics_solver_->getTipFrames();
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  kinematics::KinematicsQueryOptions options;
+  options.parallel_seeds = 4;
+  unsigned int success = 0;
+  for (unsigned int i = 0; i < num_ik_tests_; ++i)
+  {
+    robot_state.setToRandomPositions(jmg_, this->rng_);
+    robot_state.copyJointGroupPositions(jmg_, fk_values);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    ASSERT_TRUE(kinematics_solver_->getPositionFK(fk_names, fk_values, poses));
+
+    kinematics_solver_->searchPositionIK(poses[0], seed, timeout_, solution, error_code, options);
+    if (error_code.val != error_code.SUCCESS)
+      continue;
+    success++;
+
+    std::vector<geometry_msgs::msg::Pose> reached_poses;
+    kinematics_solver_->getPositionFK(fk_names, solution, reached_poses);
+    EXPECT_NEAR_POSES(poses, reached_poses, tolerance_);
+  }
+  EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
+}
+
+TEST_F(KinematicsTest, searchIKBatch)
+{
+  const std::vector<std::string>& fk_names = kinematics_solver_->getTipFrames();
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  std::vector<geometry_msgs::msg::Pose> batch_poses;
+  std::vector<double> fk_values;
+  for (unsigned int i = 0; i < num_ik_tests_; ++i)
+  {
+    robot_state.setToRandomPositions(jmg_, this->rng_);
+    robot_state.copyJointGroupPositions(jmg_, fk_values);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    ASSERT_TRUE(kinematics_solver_->getPositionFK(fk_names, fk_values, poses));
+    batch_poses.push_back(poses[0]);
+  }
+
+  // a single seed state is used for all poses
+  std::vector<std::vector<double>> seeds(1, std::vector<double>(kinematics_solver_->getJointNames().size(), 0.0));
+  std::vector<std::vector<double>> solutions;
+  std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes;
+  kinematics_solver_->searchPositionIKBatch(batch_poses, seeds, timeout_, solutions, error_codes);
+  ASSERT_EQ(solutions.size(), batch_poses.size());
+  ASSERT_EQ(error_codes.size(), batch_poses.size());
+
+  unsigned int success = 0;
+  for (std::size_t i = 0; i < batch_poses.size(); ++i)
+  {
+    if (error_codes[i].val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+    {
+      EXPECT_TRUE(solutions[i].empty());
+      continue;
+    }
+    success++;
+
+    std::vector<geometry_msgs::msg::Pose> poses{ batch_poses[i] }, reached_poses;
+    kinematics_solver_->getPositionFK(fk_names, solutions[i], reached_poses);
+    EXPECT_NEAR_POSES(poses, reached_poses, tolerance_);
+  }
+  EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
+
+  // the number of seed states has to match the number of poses unless there is only one
+  seeds.resize(2, seeds[0]);
+  if (batch_poses.size() != 2)
+    EXPECT_FALSE(kinematics_solver_->searchPositionIKBatch(batch_poses, seeds, timeout_, solutions, error_codes));
+}
+
+TEST_F(KinematicsTest, searchIKEigen)
+{
+  const auto* kdl_solver = dynamic_cast<const kdl_kinematics_plugin::KDLKinematicsPlugin*>(kinematics_solver_.get());
+  if (!kdl_solver)
+    GTEST_SKIP() << "The Eigen-native IK API is specific to the KDL plugin";
+
+  const std::vector<std::string>& fk_names = kinematics_solver_->getTipFrames();
+  const std::size_t dimension = kinematics_solver_->getJointNames().size();
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  std::vector<double> fk_values;
+  const Eigen::VectorXd seed = Eigen::VectorXd::Zero(dimension);
+  Eigen::VectorXd solution(dimension);
+  moveit_msgs::msg::MoveItErrorCodes error_code;
+  unsigned int success = 0;
+  for (unsigned int i = 0; i < num_ik_tests_; ++i)
+  {
+    robot_state.setToRandomPositions(jmg_, this->rng_);
+    robot_state.copyJointGroupPositions(jmg_, fk_values);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    ASSERT_TRUE(kinematics_solver_->getPositionFK(fk_names, fk_values, poses));
+
+    Eigen::Isometry3d pose;
+    tf2::fromMsg(poses[0], pose);
+    if (!kdl_solver->searchPositionIK(pose, seed, timeout_, solution, error_code))
+      continue;
+    success++;
+
+    std::vector<geometry_msgs::msg::Pose> reached_poses;
+    kinematics_solver_->getPositionFK(fk_names, std::vector<double>(solution.data(), solution.data() + dimension),
+                                      reached_poses);
+    EXPECT_NEAR_POSES(poses, reached_poses, tolerance_);
+  }
+  EXPECT_GE(success, EXPECTED_SUCCESS_RATE * num_ik_tests_);
+
+  // the solution has to be sized by the caller
+  Eigen::VectorXd wrong_size(dimension + 1);
+  EXPECT_FALSE(kdl_solver->searchPositionIK(Eigen::Isometry3d::Identity(), seed, timeout_, wrong_size, error_code));
+}
+
 TEST_F(KinematicsTest, searchIKWithCallback)
 {
   std::vector<double> seed, fk_values, solution;
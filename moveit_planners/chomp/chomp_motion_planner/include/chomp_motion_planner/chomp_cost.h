@@ -39,12 +39,18 @@
 #include <chomp_motion_planner/chomp_trajectory.h>
 
 #include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Sparse>
+#include <eigen3/Eigen/SparseCholesky>
+#include <memory>
 #include <vector>
 
 namespace chomp
 {
 /**
  * \brief Represents the smoothness cost for CHOMP, for a single joint
+ *
+ * The quadratic cost is a sum of squared finite differencing matrices and hence banded. It is stored sparse and
+ * factorized once, so that applying the cost or its inverse is linear in the length of the trajectory.
  */
 class ChompCost
 {
@@ -53,12 +59,30 @@ public:
             double ridge_factor = 0.0);
   virtual ~ChompCost();
 
+  /**
+   * \brief Get a cost for trajectories of the length and discretization of \e trajectory.
+   *
+   * Costs are kept for the most recently used trajectory shapes and weights, so that repeated requests of similar
+   * trajectories reuse the factorization.
+   */
+  static std::shared_ptr<const ChompCost> getShared(const ChompTrajectory& trajectory,
+                                                    const std::vector<double>& derivative_costs,
+                                                    double ridge_factor = 0.0);
+
   template <typename Derived>
   void getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory, Eigen::MatrixBase<Derived>& derivative) const;
 
-  const Eigen::MatrixXd& getQuadraticCostInverse() const;
+  /** \brief Multiply \e rhs by the inverse of the quadratic cost of the free variables */
+  template <typename Derived>
+  Eigen::VectorXd solveQuadraticCost(const Eigen::MatrixBase<Derived>& rhs) const;
+
+  /** \brief Column \e index of the inverse of the quadratic cost of the free variables */
+  Eigen::VectorXd getQuadraticCostInverseColumn(int index) const;
+
+  /** \brief Diagonal of the inverse of the quadratic cost of the free variables */
+  const Eigen::VectorXd& getQuadraticCostInverseDiagonal() const;
 
-  const Eigen::MatrixXd& getQuadraticCost() const;
+  const Eigen::SparseMatrix<double>& getQuadraticCost() const;
 
   double getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const;
 
@@ -67,12 +91,17 @@ public:
   void scale(double scale);
 
 private:
-  Eigen::MatrixXd quad_cost_full_;
-  Eigen::MatrixXd quad_cost_;
+  // the natural ordering keeps the factor within the band of the cost
+  using Solver = Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>>;
+
+  Eigen::SparseMatrix<double> quad_cost_full_;
+  Eigen::SparseMatrix<double> quad_cost_;
   // Eigen::VectorXd linear_cost_;
-  Eigen::MatrixXd quad_cost_inv_;
+  std::shared_ptr<const Solver> quad_cost_solver_;  // factorization of the unscaled quad_cost_
+  double inv_scale_;
+  Eigen::VectorXd quad_cost_inv_diagonal_;
 
-  Eigen::MatrixXd getDiffMatrix(int size, const double* diff_rule) const;
+  Eigen::SparseMatrix<double> getDiffMatrix(int size, const double* diff_rule) const;
 };
 
 template <typename Derived>
@@ -82,12 +111,18 @@ void ChompCost::getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory,
   derivative = (quad_cost_full_ * (2.0 * joint_trajectory));
 }
 
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCostInverse() const
+template <typename Derived>
+Eigen::VectorXd ChompCost::solveQuadraticCost(const Eigen::MatrixBase<Derived>& rhs) const
+{
+  return inv_scale_ * quad_cost_solver_->solve(Eigen::VectorXd(rhs));
+}
+
+inline const Eigen::VectorXd& ChompCost::getQuadraticCostInverseDiagonal() const
 {
-  return quad_cost_inv_;
+  return quad_cost_inv_diagonal_;
 }
 
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCost() const
+inline const Eigen::SparseMatrix<double>& ChompCost::getQuadraticCost() const
 {
   return quad_cost_;
 }
@@ -108,7 +108,7 @@ private:
   //                     const std::string& group_name,
   //                     Eigen::VectorXd& state_vec);
 
-  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i);
+  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state);
 
   // collision_proximity::CollisionProximitySpace::TrajectorySafety checkCurrentIterValidity();
 
@@ -168,11 +168,21 @@ private:
   Eigen::MatrixXd collision_increments_;
   Eigen::MatrixXd final_increments_;
 
+  /** \brief Temporary variables of a thread computing the collision costs of trajectory points */
+  struct ThreadScratch
+  {
+    ThreadScratch(const moveit::core::RobotState& robot_state, int num_joints);
+
+    moveit::core::RobotState state;
+    collision_detection::GroupStateRepresentationPtr gsr;
+    Eigen::MatrixXd jacobian;
+    Eigen::MatrixXd jacobian_pseudo_inverse;
+    Eigen::MatrixXd jacobian_jacobian_tranpose;
+  };
+  std::vector<ThreadScratch> thread_scratch_;
+
   // temporary variables for all functions:
   Eigen::VectorXd smoothness_derivative_;
-  Eigen::MatrixXd jacobian_;
-  Eigen::MatrixXd jacobian_pseudo_inverse_;
-  Eigen::MatrixXd jacobian_jacobian_tranpose_;
   Eigen::VectorXd random_state_;
   Eigen::VectorXd joint_state_velocities_;
 
@@ -212,8 +222,8 @@ private:
   void getRandomMomentum();
   void updateMomentum();
   void updatePositionFromMomentum();
-  void calculatePseudoInverse();
-  void computeJointProperties(int trajectoryPoint);
+  void calculatePseudoInverse(ThreadScratch& scratch) const;
+  void computeJointProperties(int trajectoryPoint, const moveit::core::RobotState& state);
   bool isCurrentTrajectoryMeshToMeshCollisionFree() const;
 };
 }  // namespace chomp
@@ -94,6 +94,9 @@ public:
                                     an initial path is not found with the specified chomp parameters */
   int max_recovery_attempts_;    /*!< this the maximum recovery attempts to find a collision free path after an initial
                                     failure to find a solution */
+  int num_threads_; /*!< number of threads computing the collision costs of the trajectory points in each iteration */
+  double cost_plateau_tolerance_; /*!< stop once the cost decreased by less than this fraction over the last 10
+                                     iterations, 0 disables the criterion */
 };
 
 }  // namespace chomp
@@ -37,20 +37,64 @@
 #include <chomp_motion_planner/chomp_cost.h>
 #include <chomp_motion_planner/chomp_utils.h>
 
-#include <eigen3/Eigen/LU>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <utility>
 
 using namespace Eigen;
 using namespace std;
 
 namespace chomp
 {
+namespace
+{
+/**
+ * Diagonal of the inverse of a banded matrix from its LDL^T factorization, using the recurrence of Takahashi et al.
+ * Only the band of the inverse is computed, so this takes O(size * bandwidth^2).
+ */
+template <typename Solver>
+VectorXd computeInverseDiagonal(const Solver& solver, int bandwidth)
+{
+  const SparseMatrix<double>& l = solver.matrixL().nestedExpression();
+  const VectorXd& d = solver.vectorD();
+  const int size = d.size();
+
+  // band of the upper triangle of the inverse, band(i, k) = inverse(i, i + k)
+  MatrixXd band = MatrixXd::Zero(size, bandwidth + 1);
+  const auto inverse = [&band](int i, int j) { return i <= j ? band(i, j - i) : band(j, i - j); };
+  std::vector<std::pair<int, double>> column;
+  for (int i = size - 1; i >= 0; --i)
+  {
+    column.clear();
+    for (SparseMatrix<double>::InnerIterator it(l, i); it; ++it)
+      if (it.row() > i)
+        column.emplace_back(it.row(), it.value());
+
+    for (int j = std::min(i + bandwidth, size - 1); j >= i; --j)
+    {
+      double value = (j == i) ? 1.0 / d(i) : 0.0;
+      for (const std::pair<int, double>& entry : column)
+        value -= entry.second * inverse(entry.first, j);
+      band(i, j - i) = value;
+    }
+  }
+  return band.col(0);
+}
+
+// number of costs kept by ChompCost::getShared()
+constexpr std::size_t MAX_SHARED_COSTS = 8;
+}  // namespace
+
 ChompCost::ChompCost(const ChompTrajectory& trajectory, int /* joint_number */,
                      const std::vector<double>& derivative_costs, double ridge_factor)
+  : inv_scale_(1.0)
 {
   int num_vars_all = trajectory.getNumPoints();
   int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
-  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
-  quad_cost_full_ = MatrixXd::Zero(num_vars_all, num_vars_all);
+  SparseMatrix<double> diff_matrix;
+  quad_cost_full_.resize(num_vars_all, num_vars_all);
 
   // construct the quad cost for all variables, as a sum of squared differentiation matrices
   double multiplier = 1.0;
@@ -58,22 +102,47 @@ ChompCost::ChompCost(const ChompTrajectory& trajectory, int /* joint_number */,
   {
     multiplier *= trajectory.getDiscretization();
     diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
-    quad_cost_full_ += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+    quad_cost_full_ += (derivative_costs[i] * multiplier) * SparseMatrix<double>(diff_matrix.transpose() * diff_matrix);
   }
-  quad_cost_full_ += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
+  SparseMatrix<double> identity(num_vars_all, num_vars_all);
+  identity.setIdentity();
+  quad_cost_full_ += identity * ridge_factor;
 
   // extract the quad cost just for the free variables:
   quad_cost_ = quad_cost_full_.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
 
-  // invert the matrix:
-  quad_cost_inv_ = quad_cost_.inverse();
+  // factorize the matrix, the squared differentiation matrices have a bandwidth of DIFF_RULE_LENGTH - 1:
+  auto solver = std::make_shared<Solver>(quad_cost_);
+  quad_cost_inv_diagonal_ = computeInverseDiagonal(*solver, DIFF_RULE_LENGTH - 1);
+  quad_cost_solver_ = std::move(solver);
+}
+
+std::shared_ptr<const ChompCost> ChompCost::getShared(const ChompTrajectory& trajectory,
+                                                     const std::vector<double>& derivative_costs, double ridge_factor)
+{
+  using Key = std::tuple<std::size_t, double, std::vector<double>, double>;
+  static std::mutex lock;
+  static std::list<std::pair<Key, std::shared_ptr<const ChompCost>>> costs;  // most recently used first
+
+  Key key(trajectory.getNumPoints(), trajectory.getDiscretization(), derivative_costs, ridge_factor);
+  std::scoped_lock slock(lock);
+  auto it = std::find_if(costs.begin(), costs.end(), [&key](const auto& entry) { return entry.first == key; });
+  if (it != costs.end())
+  {
+    costs.splice(costs.begin(), costs, it);
+    return it->second;
+  }
 
-  // cout << quad_cost_inv_ << endl;
+  costs.emplace_front(key, std::make_shared<const ChompCost>(trajectory, 0, derivative_costs, ridge_factor));
+  if (costs.size() > MAX_SHARED_COSTS)
+    costs.pop_back();
+  return costs.front().second;
 }
 
-Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) const
+Eigen::SparseMatrix<double> ChompCost::getDiffMatrix(int size, const double* diff_rule) const
 {
-  MatrixXd matrix = MatrixXd::Zero(size, size);
+  std::vector<Triplet<double>> entries;
+  entries.reserve(size * DIFF_RULE_LENGTH);
   for (int i = 0; i < size; ++i)
   {
     for (int j = -DIFF_RULE_LENGTH / 2; j <= DIFF_RULE_LENGTH / 2; ++j)
@@ -83,21 +152,30 @@ Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) cons
         continue;
       if (index >= size)
         continue;
-      matrix(i, index) = diff_rule[j + DIFF_RULE_LENGTH / 2];
+      entries.emplace_back(i, index, diff_rule[j + DIFF_RULE_LENGTH / 2]);
     }
   }
+  SparseMatrix<double> matrix(size, size);
+  matrix.setFromTriplets(entries.begin(), entries.end());
   return matrix;
 }
 
+Eigen::VectorXd ChompCost::getQuadraticCostInverseColumn(int index) const
+{
+  return solveQuadraticCost(VectorXd::Unit(quad_cost_.rows(), index));
+}
+
 double ChompCost::getMaxQuadCostInvValue() const
 {
-  return quad_cost_inv_.maxCoeff();
+  // the inverse is positive definite, so its largest coefficient lies on the diagonal
+  return quad_cost_inv_diagonal_.maxCoeff();
 }
 
 void ChompCost::scale(double scale)
 {
   double inv_scale = 1.0 / scale;
-  quad_cost_inv_ *= inv_scale;
+  inv_scale_ *= inv_scale;
+  quad_cost_inv_diagonal_ *= inv_scale;
   quad_cost_ *= scale;
   quad_cost_full_ *= scale;
 }
@@ -44,6 +44,9 @@
 #include <rclcpp/logging.hpp>
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/LU>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
 #include <random>
 #include <visualization_msgs/msg/marker_array.hpp>
 
@@ -84,6 +87,14 @@ ChompOptimizer::ChompOptimizer(ChompTrajectory* trajectory, const planning_scene
   initialize();
 }
 
+ChompOptimizer::ThreadScratch::ThreadScratch(const moveit::core::RobotState& robot_state, int num_joints)
+  : state(robot_state)
+  , jacobian(Eigen::MatrixXd::Zero(3, num_joints))
+  , jacobian_pseudo_inverse(Eigen::MatrixXd::Zero(num_joints, 3))
+  , jacobian_jacobian_tranpose(Eigen::MatrixXd::Zero(3, 3))
+{
+}
+
 void ChompOptimizer::initialize()
 {
   // init some variables:
@@ -108,6 +119,16 @@ void ChompOptimizer::initialize()
     num_collision_points_ += gradient.gradients.size();
   }
 
+  // every thread poses its own robot state and collision spheres, the first thread shares them with the optimizer
+  thread_scratch_.reserve(std::max(parameters_->num_threads_, 1));
+  thread_scratch_.emplace_back(state_, num_joints_);
+  thread_scratch_.back().gsr = gsr_;
+  while (static_cast<int>(thread_scratch_.size()) < parameters_->num_threads_)
+  {
+    ThreadScratch& scratch = thread_scratch_.emplace_back(state_, num_joints_);
+    hy_env_->getCollisionGradients(req, res, scratch.state, &planning_scene_->getAllowedCollisionMatrix(), scratch.gsr);
+  }
+
   // set up the joint costs:
   joint_costs_.reserve(num_joints_);
 
@@ -124,7 +145,7 @@ void ChompOptimizer::initialize()
     derivative_costs[0] = joint_cost * parameters_->smoothness_cost_velocity_;
     derivative_costs[1] = joint_cost * parameters_->smoothness_cost_acceleration_;
     derivative_costs[2] = joint_cost * parameters_->smoothness_cost_jerk_;
-    joint_costs_.push_back(ChompCost(group_trajectory_, i, derivative_costs, parameters_->ridge_factor_));
+    joint_costs_.push_back(*ChompCost::getShared(group_trajectory_, derivative_costs, parameters_->ridge_factor_));
     double cost_scale = joint_costs_[i].getMaxQuadCostInvValue();
     if (max_cost_scale < cost_scale)
       max_cost_scale = cost_scale;
@@ -141,9 +162,6 @@ void ChompOptimizer::initialize()
   collision_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   final_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   smoothness_derivative_ = Eigen::VectorXd::Zero(num_vars_all_);
-  jacobian_ = Eigen::MatrixXd::Zero(3, num_joints_);
-  jacobian_pseudo_inverse_ = Eigen::MatrixXd::Zero(num_joints_, 3);
-  jacobian_jacobian_tranpose_ = Eigen::MatrixXd::Zero(3, 3);
   random_state_ = Eigen::VectorXd::Zero(num_joints_);
   joint_state_velocities_ = Eigen::VectorXd::Zero(num_joints_);
 
@@ -175,13 +193,14 @@ void ChompOptimizer::initialize()
   // momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_joint_momentum_ = Eigen::VectorXd::Zero(num_vars_free_);
+  // the sampling of the momentum from the dense inverse quadratic costs is disabled along with HMC:
   multivariate_gaussian_.clear();
   stochasticity_factor_ = 1.0;
-  for (int i = 0; i < num_joints_; ++i)
-  {
-    multivariate_gaussian_.push_back(
-        MultivariateGaussian(Eigen::VectorXd::Zero(num_vars_free_), joint_costs_[i].getQuadraticCostInverse()));
-  }
+  // for (int i = 0; i < num_joints_; ++i)
+  // {
+  //   multivariate_gaussian_.push_back(MultivariateGaussian(
+  //       Eigen::VectorXd::Zero(num_vars_free_), Eigen::MatrixXd(joint_costs_[i].getQuadraticCost()).inverse()));
+  // }
 
   std::map<std::string, std::string> fixed_link_resolution_map;
   for (int i = 0; i < num_joints_; ++i)
@@ -352,6 +371,7 @@ bool ChompOptimizer::optimize()
       best_group_trajectory_cost_ = cost;
       last_improvement_iteration_ = iteration_;
     }
+
     calculateSmoothnessIncrements();
     calculateCollisionIncrements();
     calculateTotalIncrements();
@@ -485,6 +505,16 @@ bool ChompOptimizer::optimize()
     //  averageCostVelocity = 0.0;
     //}
 
+    // stop refining once the cost barely changed over the last cost_window iterations
+    double& window_cost = costs[iteration_ % cost_window];
+    if (parameters_->cost_plateau_tolerance_ > 0.0 && iteration_ >= cost_window &&
+        window_cost - cost <= parameters_->cost_plateau_tolerance_ * std::abs(window_cost))
+    {
+      RCLCPP_INFO(LOGGER, "Cost plateaued at %f, breaking out early at iteration %d", cost, iteration_);
+      break;
+    }
+    window_cost = cost;
+
     if (should_break_out)
     {
       collision_free_iteration_++;
@@ -592,15 +622,6 @@ void ChompOptimizer::calculateSmoothnessIncrements()
 
 void ChompOptimizer::calculateCollisionIncrements()
 {
-  double potential;
-  double vel_mag_sq;
-  double vel_mag;
-  Eigen::Vector3d potential_gradient;
-  Eigen::Vector3d normalized_velocity;
-  Eigen::Matrix3d orthogonal_projector;
-  Eigen::Vector3d curvature_vector;
-  Eigen::Vector3d cartesian_gradient;
-
   collision_increments_.setZero(num_vars_free_, num_joints_);
 
   int start_point = 0;
@@ -622,8 +643,21 @@ void ChompOptimizer::calculateCollisionIncrements()
     start_point = free_vars_start_;
   }
 
+  // the increments of the trajectory points are independent of each other
+  const int num_threads = static_cast<int>(thread_scratch_.size());
+#pragma omp parallel for schedule(static) num_threads(num_threads) if (num_threads > 1 && end_point > start_point)
   for (int i = start_point; i <= end_point; ++i)
   {
+    ThreadScratch& scratch = thread_scratch_[omp_get_thread_num()];
+    double potential;
+    double vel_mag_sq;
+    double vel_mag;
+    Eigen::Vector3d potential_gradient;
+    Eigen::Vector3d normalized_velocity;
+    Eigen::Matrix3d orthogonal_projector;
+    Eigen::Vector3d curvature_vector;
+    Eigen::Vector3d cartesian_gradient;
+
     for (int j = 0; j < num_collision_points_; ++j)
     {
       potential = collision_point_potential_[i][j];
@@ -644,16 +678,18 @@ void ChompOptimizer::calculateCollisionIncrements()
       cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
 
       // pass it through the jacobian transpose to get the increments
-      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian_);
+      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], scratch.jacobian);
 
       if (parameters_->use_pseudo_inverse_)
       {
-        calculatePseudoInverse();
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse_ * cartesian_gradient;
+        calculatePseudoInverse(scratch);
+        collision_increments_.row(i - free_vars_start_).transpose() -=
+            scratch.jacobian_pseudo_inverse * cartesian_gradient;
       }
       else
       {
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_.transpose() * cartesian_gradient;
+        collision_increments_.row(i - free_vars_start_).transpose() -=
+            scratch.jacobian.transpose() * cartesian_gradient;
       }
 
       /*
@@ -667,11 +703,11 @@ void ChompOptimizer::calculateCollisionIncrements()
   // cout << collision_increments_ << endl;
 }
 
-void ChompOptimizer::calculatePseudoInverse()
+void ChompOptimizer::calculatePseudoInverse(ThreadScratch& scratch) const
 {
-  jacobian_jacobian_tranpose_ =
-      jacobian_ * jacobian_.transpose() + Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
-  jacobian_pseudo_inverse_ = jacobian_.transpose() * jacobian_jacobian_tranpose_.inverse();
+  scratch.jacobian_jacobian_tranpose = scratch.jacobian * scratch.jacobian.transpose() +
+                                       Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
+  scratch.jacobian_pseudo_inverse = scratch.jacobian.transpose() * scratch.jacobian_jacobian_tranpose.inverse();
 }
 
 void ChompOptimizer::calculateTotalIncrements()
@@ -679,9 +715,9 @@ void ChompOptimizer::calculateTotalIncrements()
   for (int i = 0; i < num_joints_; ++i)
   {
     final_increments_.col(i) =
-        parameters_->learning_rate_ * (joint_costs_[i].getQuadraticCostInverse() *
-                                       (parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
-                                        parameters_->obstacle_cost_weight_ * collision_increments_.col(i)));
+        parameters_->learning_rate_ *
+        joint_costs_[i].solveQuadraticCost(parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
+                                           parameters_->obstacle_cost_weight_ * collision_increments_.col(i));
   }
 }
 
@@ -759,11 +795,11 @@ double ChompOptimizer::getCollisionCost()
   return parameters_->obstacle_cost_weight_ * collision_cost;
 }
 
-void ChompOptimizer::computeJointProperties(int trajectory_point)
+void ChompOptimizer::computeJointProperties(int trajectory_point, const moveit::core::RobotState& state)
 {
   for (int j = 0; j < num_joints_; ++j)
   {
-    const moveit::core::JointModel* joint_model = state_.getJointModel(joint_names_[j]);
+    const moveit::core::JointModel* joint_model = state.getJointModel(joint_names_[j]);
     const moveit::core::RevoluteJointModel* revolute_joint =
         dynamic_cast<const moveit::core::RevoluteJointModel*>(joint_model);
     const moveit::core::PrismaticJointModel* prismatic_joint =
@@ -771,9 +807,9 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
 
     std::string parent_link_name = joint_model->getParentLinkModel()->getName();
     std::string child_link_name = joint_model->getChildLinkModel()->getName();
-    Eigen::Isometry3d joint_transform = state_.getGlobalLinkTransform(parent_link_name) *
+    Eigen::Isometry3d joint_transform = state.getGlobalLinkTransform(parent_link_name) *
                                         (robot_model_->getLinkModel(child_link_name)->getJointOriginTransform() *
-                                         (state_.getJointTransform(joint_model)));
+                                         (state.getJointTransform(joint_model)));
 
     // joint_transform = inverseWorldTransform * jointTransform;
     Eigen::Vector3d axis;
@@ -893,10 +929,9 @@ void ChompOptimizer::handleJointLimits()
       if (violation)
       {
         int free_var_index = max_violation_index - free_vars_start_;
-        double multiplier =
-            max_violation / joint_costs_[joint_i].getQuadraticCostInverse()(free_var_index, free_var_index);
+        double multiplier = max_violation / joint_costs_[joint_i].getQuadraticCostInverseDiagonal()(free_var_index);
         group_trajectory_.getFreeJointTrajectoryBlock(joint_i) +=
-            multiplier * joint_costs_[joint_i].getQuadraticCostInverse().col(free_var_index);
+            multiplier * joint_costs_[joint_i].getQuadraticCostInverseColumn(free_var_index);
       }
       if (++count > 10)
         break;
@@ -918,29 +953,30 @@ void ChompOptimizer::performForwardKinematics()
     end = num_vars_all_ - 1;
   }
 
-  is_collision_free_ = true;
-
-  auto total_dur = std::chrono::duration<double>::zero();
+  bool is_collision_free = true;
 
-  // for each point in the trajectory
+  // for each point in the trajectory, each thread posing its own robot state
+  const int num_threads = static_cast<int>(thread_scratch_.size());
+#pragma omp parallel for schedule(static) num_threads(num_threads) if (num_threads > 1) \
+    reduction(&& : is_collision_free)
   for (int i = start; i <= end; ++i)
   {
+    ThreadScratch& scratch = thread_scratch_[omp_get_thread_num()];
+
     // Set Robot state from trajectory point...
     collision_detection::CollisionRequest req;
     collision_detection::CollisionResult res;
     req.group_name = planning_group_;
-    setRobotStateFromPoint(group_trajectory_, i);
-    auto grad = std::chrono::system_clock::now();
+    setRobotStateFromPoint(group_trajectory_, i, scratch.state);
 
-    hy_env_->getCollisionGradients(req, res, state_, nullptr, gsr_);
-    total_dur += (std::chrono::system_clock::now() - grad);
-    computeJointProperties(i);
+    hy_env_->getCollisionGradients(req, res, scratch.state, nullptr, scratch.gsr);
+    computeJointProperties(i, scratch.state);
     state_is_in_collision_[i] = false;
 
     // Keep vars in scope
     {
       size_t j = 0;
-      for (const collision_detection::GradientInfo& info : gsr_->gradients_)
+      for (const collision_detection::GradientInfo& info : scratch.gsr->gradients_)
       {
         for (size_t k = 0; k < info.sphere_locations.size(); ++k)
         {
@@ -969,15 +1005,14 @@ void ChompOptimizer::performForwardKinematics()
             //   collision_point_potential_[i][j]);
             // }
 
-            is_collision_free_ = false;
+            is_collision_free = false;
           }
           j++;
         }
       }
     }
   }
-
-  // RCLCPP_INFO(LOGGER,"Total dur " << total_dur << " total checks " << end-start+1);
+  is_collision_free_ = is_collision_free;
 
   // now, get the vel and acc for each collision point (using finite differencing)
   for (int i = free_vars_start_; i <= free_vars_end_; ++i)
@@ -1000,7 +1035,7 @@ void ChompOptimizer::performForwardKinematics()
   }
 }
 
-void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i)
+void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state)
 {
   const Eigen::MatrixXd::RowXpr& point = group_trajectory.getTrajectoryPoint(i);
 
@@ -1009,8 +1044,8 @@ void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, i
   for (size_t j = 0; j < group_trajectory.getNumJoints(); ++j)
     joint_states.emplace_back(point(0, j));
 
-  state_.setJointGroupPositions(planning_group_, joint_states);
-  state_.update();
+  state.setJointGroupPositions(planning_group_, joint_states);
+  state.update();
 }
 
 void ChompOptimizer::perturbTrajectory()
@@ -1042,7 +1077,7 @@ void ChompOptimizer::perturbTrajectory()
   for (int i = 0; i < num_joints_; ++i)
   {
     group_trajectory_.getFreeJointTrajectoryBlock(i) +=
-        joint_costs_[i].getQuadraticCostInverse().col(mp_free_vars_index) * random_state_(i);
+        joint_costs_[i].getQuadraticCostInverseColumn(mp_free_vars_index) * random_state_(i);
   }
 }
 
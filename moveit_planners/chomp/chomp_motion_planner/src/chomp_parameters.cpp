@@ -64,6 +64,8 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  num_threads_ = 1;
+  cost_plateau_tolerance_ = 0.0;
 }
 
 ChompParameters::~ChompParameters() = default;
@@ -49,16 +49,47 @@
 #include <rclcpp/logging.hpp>
 #include <rclcpp/node.hpp>
 #include <rclcpp/parameter_value.hpp>
+#include <mutex>
 #include <vector>
 
 namespace chomp
 {
 static rclcpp::Logger LOGGER = rclcpp::get_logger("chomp_planner");
 
+/**
+ * \brief Allocates hybrid collision environments, keeping a copy of the last one allocated.
+ *
+ * Building the distance field of the world dominates the cost of a new environment. Environments for worlds of the
+ * same version as the kept one are copied from it instead, which shares its distance field.
+ */
+class CachingAllocatorHybrid : public collision_detection::CollisionDetectorAllocatorHybrid
+{
+public:
+  using collision_detection::CollisionDetectorAllocatorHybrid::allocateEnv;
+
+  collision_detection::CollisionEnvPtr allocateEnv(const collision_detection::WorldPtr& world,
+                                                   const moveit::core::RobotModelConstPtr& robot_model) const override
+  {
+    std::scoped_lock lock(env_lock_);
+    if (!env_ || env_->getRobotModel() != robot_model || env_->getWorld()->getVersion() != world->getVersion())
+    {
+      // the kept environment observes a private copy of the world, so that it never changes
+      env_ = CollisionDetectorAllocatorHybrid::allocateEnv(std::make_shared<collision_detection::World>(*world),
+                                                           robot_model);
+    }
+    return allocateEnv(env_, world);
+  }
+
+private:
+  mutable std::mutex env_lock_;
+  mutable collision_detection::CollisionEnvConstPtr env_;
+};
+
 class OptimizerAdapter : public planning_request_adapter::PlanningRequestAdapter
 {
 public:
-  OptimizerAdapter() : planning_request_adapter::PlanningRequestAdapter()
+  OptimizerAdapter()
+    : planning_request_adapter::PlanningRequestAdapter(), hybrid_cd_(std::make_shared<CachingAllocatorHybrid>())
   {
   }
 
@@ -155,6 +186,18 @@ public:
       RCLCPP_DEBUG(LOGGER, "Param use_stochastic_descent was not set. Using default value: %d",
                    params_.use_stochastic_descent_);
     }
+    if (!node->get_parameter("chomp.num_threads", params_.num_threads_))
+    {
+      params_.num_threads_ = 1;
+      RCLCPP_DEBUG(LOGGER, "Param num_threads was not set. Using default value: %d", params_.num_threads_);
+    }
+    if (!node->get_parameter("chomp.cost_plateau_tolerance", params_.cost_plateau_tolerance_))
+    {
+      // the seed is usually close to a local optimum already, so stop refining it once the cost stalls
+      params_.cost_plateau_tolerance_ = 1e-3;
+      RCLCPP_DEBUG(LOGGER, "Param cost_plateau_tolerance was not set. Using default value: %f",
+                   params_.cost_plateau_tolerance_);
+    }
     params_.trajectory_initialization_method_ = "quintic-spline";
     std::string method;
     if (node->get_parameter("chomp.trajectory_initialization_method", method) &&
@@ -183,14 +226,10 @@ public:
     if (!planner(ps, req, res))
       return false;
 
-    // create a hybrid collision detector to set the collision checker as hybrid
-    collision_detection::CollisionDetectorAllocatorPtr hybrid_cd(
-        collision_detection::CollisionDetectorAllocatorHybrid::create());
-
     // create a writable planning scene
     planning_scene::PlanningScenePtr planning_scene = ps->diff();
     RCLCPP_DEBUG(LOGGER, "Configuring Planning Scene for CHOMP ...");
-    planning_scene->allocateCollisionDetector(hybrid_cd);
+    planning_scene->allocateCollisionDetector(hybrid_cd_);
 
     chomp::ChompPlanner chomp_planner;
     planning_interface::MotionPlanDetailedResponse res_detailed;
@@ -210,6 +249,8 @@ public:
 
 private:
   chomp::ChompParameters params_;
+  // the hybrid collision detector is kept across requests to reuse the distance field of an unchanged world
+  collision_detection::CollisionDetectorAllocatorPtr hybrid_cd_;
 };
 }  // namespace chomp
 
@@ -0,0 +1,62 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <ompl/base/objectives/StateCostIntegralObjective.h>
+
+namespace ompl_interface
+{
+/** @class ClearanceObjective
+ *  @brief Optimization objective integrating the inverse clearance of the states along the path.
+ *
+ * Short paths that keep their distance to obstacles are preferred. The clearance of a state is obtained from the
+ * state validity checker, which caches it in MoveIt's state types, so each state pays for at most one distance
+ * query (see StateValidityChecker::setClearanceCachedWithValidity()). */
+class ClearanceObjective : public ompl::base::StateCostIntegralObjective
+{
+public:
+  /** @brief Constructor
+   *  @param si The space information of the planning problem
+   *  @param epsilon Added to the clearance before inverting it, bounds the cost of states in contact */
+  ClearanceObjective(const ompl::base::SpaceInformationPtr& si, double epsilon = 0.01);
+
+  /** @brief The inverse clearance of the state; 0 for states with unbounded clearance */
+  ompl::base::Cost stateCost(const ompl::base::State* state) const override;
+
+private:
+  double epsilon_;
+};
+}  // namespace ompl_interface
@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <ompl/base/DiscreteMotionValidator.h>
+#include <ompl/base/MotionValidator.h>
+#include <Eigen/Core>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class ConservativeAdvancementMotionValidator
+    @brief A motion validator that skips intervals of a motion which are provably collision free.
+
+    Along a joint space motion, no point of a link moves further than the sum over the joints above it of the joint
+    displacement times a lever arm: the largest distance from the joint origin to any point of the link (for revolute
+    joints) or one (for prismatic joints). The lever arms are bounded from the robot model once, so the distance swept by
+    the robot along an interval of the motion is bounded by a single matrix-vector product. The clearance of an
+    intermediate state (computed with CollisionEnv::distanceRobot() and distanceSelf()) then certifies that the motion
+    is free until the swept distance reaches it, and the next check is placed there.
+
+    The validator never advances by less than the resolution of the ompl::base::DiscreteMotionValidator, so it performs
+    at most as many checks as the discrete validator, and far fewer in open workspaces. It falls back to the discrete
+    validator when the bound does not apply: for groups with mimic joints or joints that are neither revolute nor
+    prismatic, for state spaces that do not interpolate in joint space, when path constraints or a state feasibility
+    predicate are set, and for collision detectors other than FCL, which do not implement distance queries. */
+class ConservativeAdvancementMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  ConservativeAdvancementMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const override;
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>& last_valid) const override;
+
+  /** \brief Returns true if conservative advancement can be used, false if all checks are done by the
+      discrete validator */
+  bool isConservativeAdvancementEnabled() const;
+
+  /** \brief Get an upper bound on the distance any point of the robot moves along the motion from \e s1 to \e s2 */
+  double getSweptDistanceBound(const ompl::base::State* s1, const ompl::base::State* s2) const;
+
+private:
+  /** \brief Compute the lever arm of each group variable for each link moved by the group */
+  void computeLeverArms();
+
+  /** \brief Get the largest distance of any point of the collision geometry of \e link (and the bodies attached to it)
+      from the origin of the link frame, including padding and scaling */
+  double getLinkExtent(const moveit::core::LinkModel* link) const;
+
+  /** \brief Get the distance the robot can move from \e state before it can collide, or a value of at least
+      \e threshold if it is further than that from any collision. Negative or zero if \e state is in collision. */
+  double getClearance(const moveit::core::RobotState& state, double threshold) const;
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>* last_valid) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  TSStateStorage tss_;
+  ompl::base::DiscreteMotionValidator discrete_validator_;
+
+  /** \brief True if the lever arms bound the motion of all links moved by the group */
+  bool supported_;
+
+  /** \brief (links moved by the group x group variables) matrix of lever arms */
+  Eigen::MatrixXd lever_arms_;
+};
+}  // namespace ompl_interface
@@ -36,7 +36,10 @@
 
 #pragma once
 
+#include <filesystem>
 #include <map>
+#include <mutex>
+#include <moveit/constraint_samplers/precomputed_constraint_sampler.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
@@ -71,6 +74,12 @@ public:
 
   InterpolationFunction getInterpolationFunction() const;
 
+  /** \brief The sampled states of the approximation as group variable values, computed on first use
+   *
+   * Returns an empty pointer if the state space of the planning context does not match the approximation. */
+  std::shared_ptr<const constraint_samplers::PrecomputedConstraintSampler::StateSet>
+  getGroupStates(const ModelBasedPlanningContext* pcontext) const;
+
   const std::vector<int>& getSpaceSignature() const
   {
     return space_signature_;
@@ -124,6 +133,9 @@ protected:
   ompl::base::StateStoragePtr state_storage_ptr_;
   ConstraintApproximationStateStorage* state_storage_;
   std::size_t milestones_;
+
+  mutable std::mutex group_states_lock_;
+  mutable std::shared_ptr<const constraint_samplers::PrecomputedConstraintSampler::StateSet> group_states_;
 };
 
 struct ConstraintApproximationConstructionOptions
@@ -135,6 +147,7 @@ struct ConstraintApproximationConstructionOptions
     , explicit_motions(false)
     , explicit_points_resolution(0.0)
     , max_explicit_points(0)
+    , thread_count(0)
   {
   }
 
@@ -145,6 +158,8 @@ struct ConstraintApproximationConstructionOptions
   bool explicit_motions;
   double explicit_points_resolution;
   unsigned int max_explicit_points;
+  /** \brief Number of threads used for sampling and connecting states; 0 uses all hardware threads */
+  unsigned int thread_count;
 };
 
 struct ConstraintApproximationConstructionResults
@@ -199,5 +214,9 @@ private:
 
   ModelBasedPlanningContext* context_;
   std::map<std::string, ConstraintApproximationPtr> constraint_approximations_;
+
+  /** \brief The folder and manifest timestamp of the last successful load, used to skip reloading unchanged data */
+  std::string loaded_path_;
+  std::filesystem::file_time_type loaded_manifest_time_;
 };
 }  // namespace ompl_interface
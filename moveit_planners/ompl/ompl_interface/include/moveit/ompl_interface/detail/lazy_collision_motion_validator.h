@@ -0,0 +1,82 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/collision_common.h>
+#include <moveit/robot_state/robot_state.h>
+#include <ompl/base/MotionValidator.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class LazyCollisionMotionValidator
+    @brief A motion validator that collision checks all states of a motion in one batch.
+
+    This validator is meant to be combined with a StateValidityChecker that defers collision checking (see
+    StateValidityChecker::setCollisionCheckingDeferred()), so that sampled states are only checked for bounds, path
+    constraints and feasibility. Collisions are checked once a motion is validated, which lazy planners like LazyPRM and
+    LazyRRT only do for the motions of candidate paths. The states of the motion, including both end states, are
+    checked against the world with CollisionEnv::checkRobotCollisionBatch() and then for self collisions. End states
+    found valid are marked as such, so they are not checked again as part of other motions. Constrained state spaces
+    are not supported. */
+class LazyCollisionMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  LazyCollisionMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const override;
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>& last_valid) const override;
+
+private:
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>* last_valid) const;
+
+  /** \brief Get at least \e count robot states owned by the calling thread */
+  std::vector<moveit::core::RobotStatePtr>& getStateStorage(std::size_t count) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  collision_detection::CollisionRequest collision_request_;
+
+  mutable std::map<std::thread::id, std::vector<moveit::core::RobotStatePtr>> thread_states_;
+  mutable std::mutex lock_;
+};
+}  // namespace ompl_interface
@@ -52,7 +52,10 @@ namespace ompl_interface
 class ModelBasedPlanningContext;
 
 /** @class ProjectionEvaluatorLinkPose
-    @brief */
+    @brief Projects a state onto the position of a link of the planning group.
+
+    Only the joints on the chain from the link to the robot root are evaluated, the joints that are not planned for
+    are taken from the initial state of the planning context. */
 class ProjectionEvaluatorLinkPose : public ompl::base::ProjectionEvaluator
 {
 public:
@@ -62,10 +65,31 @@ public:
   void defaultCellSizes() override;
   void project(const ompl::base::State* state, OMPLProjection projection) const override;
 
+  /** \brief Remember the position of the projected link in \e robot_state, whose link transforms are up to date for
+      \e state (e.g. after a validity check). The next projection of \e state on the calling thread reuses it. */
+  void storeLinkPosition(const ompl::base::State* state, const moveit::core::RobotState& robot_state) const;
+
 private:
+  struct ChainLink
+  {
+    const moveit::core::JointModel* joint;
+    /** \brief Joint origin, including the transform of the joint if it is not planned for */
+    Eigen::Isometry3d origin;
+    /** \brief Index of the first variable of the joint in the state values, -1 if the joint is not planned for */
+    int variable_index;
+  };
+
   const ModelBasedPlanningContext* planning_context_;
   const moveit::core::LinkModel* link_;
   TSStateStorage tss_;
+
+  /** \brief False if the chain cannot be evaluated from the state values (mimic joints, constrained state spaces) */
+  bool use_chain_;
+  Eigen::Isometry3d chain_base_;
+  std::vector<ChainLink> chain_;
+  std::size_t variable_count_;
+  /** \brief Distinguishes the positions stored by this instance from those of other instances */
+  std::size_t id_;
 };
 
 /** @class ProjectionEvaluatorJointValue
@@ -41,6 +41,12 @@
  * - Kinematic path constraints.
  * - Generic user-specified feasibility using the `isStateFeasible` of the planning scene.
  *
+ * Collision checking can be deferred to a LazyCollisionMotionValidator, see setCollisionCheckingDeferred().
+ *
+ * The clearance of a state is cached in the state once computed. With setClearanceCachedWithValidity(), the
+ * collision check of isValid also computes the clearance, so clearance-based optimization objectives do not have to
+ * query the distance to the obstacles a second time.
+ *
  * IMPORTANT: Although the isValid method takes the state as `const ompl::base::State* state`,
  * it uses const_cast to modify the validity of the state with `markInvalid` and `markValid` for caching.
  * **/
@@ -48,6 +54,7 @@
 #pragma once
 
 #include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 #include <moveit/collision_detection/collision_common.h>
 #include <ompl/base/StateValidityChecker.h>
 
@@ -82,11 +89,33 @@ public:
   virtual bool isValid(const ompl::base::State* state, double& dist, bool verbose) const;
 
   virtual double cost(const ompl::base::State* state) const;
+
+  /** \brief Distance to the closest obstacle (0 when in collision). Uses the value cached in the state, if any. */
   double clearance(const ompl::base::State* state) const override;
 
   void setVerbose(bool flag);
 
+  /** \brief When \e flag is true, states are only checked for bounds, path constraints and feasibility. Collisions have
+   * to be checked by the motion validator then, see LazyCollisionMotionValidator. */
+  void setCollisionCheckingDeferred(bool flag);
+
+  /** \brief When \e flag is true, the collision check of isValid also computes the distance to the obstacles and caches
+   * it in the state as its clearance. This makes the validity check more expensive, so it is only worth it when the
+   * optimization objective asks for the clearance of most states. */
+  void setClearanceCachedWithValidity(bool flag);
+
 protected:
+  /** \brief Compute the clearance of \e state, caching it in \e model_state (which may be wrapped by \e state) */
+  double computeClearance(const ompl::base::State* state, const ModelBasedStateSpace::StateType* model_state) const;
+
+  /** \brief Check collisions of \e robot_state, caching the clearance in \e model_state if requested */
+  bool checkCollision(const moveit::core::RobotState& robot_state, const ModelBasedStateSpace::StateType* model_state,
+                      bool verbose) const;
+
+  /** \brief Cache the clearance reported by a collision check that computed distances */
+  static void storeClearance(const ModelBasedStateSpace::StateType* model_state,
+                             const collision_detection::CollisionResult& res);
+
   const ModelBasedPlanningContext* planning_context_;
   std::string group_name_;
   TSStateStorage tss_;
@@ -97,6 +126,8 @@ protected:
 
   collision_detection::CollisionRequest collision_request_with_cost_;
   bool verbose_;
+  bool defer_collision_checking_;
+  bool cache_clearance_with_validity_;
 };
 
 /** \brief A StateValidityChecker that can handle states of type `ompl::base::ConstraintStateSpace::StateType`.
@@ -153,5 +184,7 @@ public:
    **/
   bool isValid(const ompl::base::State* wrapped_state, bool verbose) const override;
   bool isValid(const ompl::base::State* wrapped_state, double& dist, bool verbose) const override;
+
+  double clearance(const ompl::base::State* wrapped_state) const override;
 };
 }  // namespace ompl_interface
@@ -37,6 +37,7 @@
 #pragma once
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <thread>
 #include <mutex>
 
@@ -53,6 +54,7 @@ public:
 
 private:
   moveit::core::RobotState start_state_;
+  moveit::core::RobotStatePoolPtr state_pool_;
   mutable std::map<std::thread::id, moveit::core::RobotState*> thread_states_;
   mutable std::mutex lock_;
 };
@@ -38,23 +38,34 @@
 
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
+#include <moveit/ompl_interface/state_sampler_allocator.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_scene/state_validity_cache.h>
 
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/tools/benchmark/Benchmark.h>
-#include <ompl/tools/multiplan/ParallelPlan.h>
+#include <ompl/tools/experience/ExperienceSetup.h>
 #include <ompl/base/StateStorage.h>
 #include <ompl/base/spaces/constraint/ConstrainedStateSpace.h>
 
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <thread>
+
 namespace ompl_interface
 {
 namespace ob = ompl::base;
 namespace og = ompl::geometric;
 namespace ot = ompl::tools;
 
-MOVEIT_CLASS_FORWARD(ModelBasedPlanningContext);  // Defines ModelBasedPlanningContextPtr, ConstPtr, WeakPtr... etc
-MOVEIT_CLASS_FORWARD(ConstraintsLibrary);         // Defines ConstraintsLibraryPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(ModelBasedPlanningContext);    // Defines ModelBasedPlanningContextPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(ConstraintsLibrary);           // Defines ConstraintsLibraryPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(ProjectionEvaluatorLinkPose);  // Defines ProjectionEvaluatorLinkPosePtr, ConstPtr, WeakPtr... etc
+
+/// receives the trajectory improved by the background simplification of a solution
+typedef std::function<void(const robot_trajectory::RobotTrajectoryPtr& trajectory)> ImprovedSolutionCallback;
 
 struct ModelBasedPlanningContextSpecification;
 typedef std::function<ob::PlannerPtr(const ompl::base::SpaceInformationPtr& si, const std::string& name,
@@ -71,6 +82,12 @@ struct ModelBasedPlanningContextSpecification
   ModelBasedStateSpacePtr state_space_;
   og::SimpleSetupPtr ompl_simple_setup_;  // pass in the correct simple setup type
 
+  /// file the experience database is saved to when ompl_simple_setup_ is an ompl::tools::ExperienceSetup
+  std::string experience_database_path_;
+
+  /// plugin replacing the default state sampler for requests without path constraints, if any
+  StateSamplerAllocatorPtr state_sampler_allocator_;
+
   /** \brief OMPL constrained state space to handle path constraints.
    *
    * When the parameter "use_ompl_constrained_planning" is set to true in ompl_planning.yaml,
@@ -92,6 +109,7 @@ public:
 
   ~ModelBasedPlanningContext() override
   {
+    cancelSimplification();
   }
 
   bool solve(planning_interface::MotionPlanResponse& res) override;
@@ -245,6 +263,19 @@ public:
 
   void setProjectionEvaluator(const std::string& peval);
 
+  /** \brief The default projection if it is the position of a link (nullptr otherwise). State validity checkers pass
+      it the link positions they compute, see ProjectionEvaluatorLinkPose::storeLinkPosition(). */
+  const ProjectionEvaluatorLinkPose* getLinkPoseProjection() const
+  {
+    return link_pose_projection_.get();
+  }
+
+  /** \brief Select the motion validator by name: "discrete" (the OMPL default), "conservative_advancement"
+      (see ConservativeAdvancementMotionValidator) or "lazy_collision" (see LazyCollisionMotionValidator), which defers
+      the collision checks of the state validity checker to the motion checks. Call after the state validity checker
+      is set. */
+  void setMotionValidator(const std::string& name);
+
   void setPlanningVolume(const moveit_msgs::msg::WorkspaceParameters& wparams);
 
   void setCompleteInitialState(const moveit::core::RobotState& complete_initial_robot_state);
@@ -290,6 +321,28 @@ public:
     hybridize_ = flag;
   }
 
+  /* @brief If set, solve() returns the first feasible path right away and simplifies it in a background thread,
+     within the remaining planning time. The improved trajectory is passed to the callback set with
+     setImprovedSolutionCallback(). */
+  void setSimplifyAsynchronously(bool flag)
+  {
+    simplify_asynchronously_ = flag;
+  }
+
+  /* @brief Set the callback receiving the result of the background simplification. It is called from the background
+     thread. The improved trajectory keeps the waypoints of the first segment of the trajectory returned by solve(),
+     so it can replace that trajectory while the first segment is executed. */
+  void setImprovedSolutionCallback(const ImprovedSolutionCallback& callback)
+  {
+    improved_solution_callback_ = callback;
+  }
+
+  /* @brief Block until the background simplification of the last solution is done */
+  void waitForSimplification();
+
+  /* @brief Stop the background simplification of the last solution, if it is still running */
+  void cancelSimplification();
+
   /* @brief Solve the planning problem. Return true if the problem is solved
      @param timeout The time to spend on solving
      @param count The number of runs to combine the paths of, in an attempt to generate better quality paths
@@ -304,6 +357,12 @@ public:
   */
   bool benchmark(double timeout, unsigned int count, const std::string& filename = "");
 
+  /* @brief Get, for each planner of the configured portfolio, the number of requests it found the best solution for */
+  const std::map<std::string, unsigned int>& getPortfolioWins() const
+  {
+    return portfolio_wins_;
+  }
+
   /* @brief Get the amount of time spent computing the last plan */
   double getLastPlanTime() const
   {
@@ -345,10 +404,23 @@ public:
    * */
   virtual void configure(const rclcpp::Node::SharedPtr& node, bool use_constraints_approximations);
 
+  /** \brief Do the request independent part of the setup ahead of the first request: load the constraint
+   * approximations, set up the state space and, for multi-query planners, allocate the planner and its roadmap.
+   * \param node ROS node used to load the constraint approximations.
+   * */
+  void warmUp(const rclcpp::Node::SharedPtr& node);
+
 protected:
   void preSolve();
   void postSolve();
 
+  /** \brief Invalidate the roadmap of a multi-query planner if the scene or the path constraints changed since the
+   * previous query. Lazy planners only forget the validity of their vertices and edges, others drop the roadmap. */
+  void updateRoadmapValidity(const ob::PlannerPtr& planner);
+
+  /** \brief Add the last solution to the experience database, if experience-based planning is configured */
+  void storeExperience();
+
   void startSampling();
   void stopSampling();
 
@@ -385,6 +457,10 @@ protected:
   virtual ob::PlannerTerminationCondition constructPlannerTerminationCondition(double timeout,
                                                                                const ompl::time::point& start);
 
+  /** \brief Run \e count planning attempts on the problem of ompl_simple_setup_, using up to max_planning_threads_
+   * threads. Returns true if an exact solution was found. */
+  bool solveParallel(const ob::PlannerTerminationCondition& ptc, unsigned int count);
+
   void registerTerminationCondition(const ob::PlannerTerminationCondition& ptc);
   void unregisterTerminationCondition();
 
@@ -401,9 +477,6 @@ protected:
   /// the OMPL tool for benchmarking planners
   ot::Benchmark ompl_benchmark_;
 
-  /// tool used to compute multiple plans in parallel; this uses the problem definition maintained by ompl_simple_setup_
-  ot::ParallelPlan ompl_parallel_plan_;
-
   std::vector<int> space_signature_;
 
   kinematic_constraints::KinematicConstraintSetPtr path_constraints_;
@@ -444,8 +517,14 @@ protected:
   /// when false, clears planners before running solve()
   bool multi_query_planning_enabled_;
 
+  /// the versions of the scene and the path constraints the roadmap of a multi-query planner was last used with
+  std::optional<planning_scene::StateValidityCache::SceneVersion> roadmap_scene_version_;
+  moveit_msgs::msg::Constraints roadmap_path_constraints_;
+
   ConstraintsLibraryPtr constraints_library_;
 
+  ProjectionEvaluatorLinkPoseConstPtr link_pose_projection_;
+
   bool simplify_solutions_;
 
   // if false the final solution is not interpolated
@@ -453,5 +532,21 @@ protected:
 
   // if false parallel plan returns the first solution found
   bool hybridize_;
+
+  /// planner types and allocators of the portfolio raced on each request, empty if only 'type' is used
+  std::vector<std::pair<std::string, ob::PlannerAllocator>> portfolio_;
+
+  /// number of requests for which each planner of the portfolio found the best solution
+  std::map<std::string, unsigned int> portfolio_wins_;
+
+  /// if true, solutions are simplified in simplification_thread_ after solve() has returned them
+  bool simplify_asynchronously_;
+  ImprovedSolutionCallback improved_solution_callback_;
+  std::thread simplification_thread_;
+  std::atomic<bool> cancel_simplification_;
+
+  /* @brief Start simplifying \e raw_path in the background, for at most \e timeout seconds. \e returned_path is the
+     (interpolated) path returned to the caller, whose first segment is kept. */
+  void startAsynchronousSimplification(og::PathGeometric raw_path, og::PathGeometric returned_path, double timeout);
 };
 }  // namespace ompl_interface
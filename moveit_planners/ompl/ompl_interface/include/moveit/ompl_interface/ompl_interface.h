@@ -42,9 +42,13 @@
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit_msgs/msg/motion_plan_request.hpp>
 #include <moveit_msgs/msg/motion_plan_response.hpp>
+#include <pluginlib/class_loader.hpp>
 #include <rclcpp/node.hpp>
 #include <string>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 /** \brief The MoveIt interface to OMPL */
 namespace ompl_interface
@@ -116,6 +120,10 @@ public:
     return use_constraints_approximations_;
   }
 
+  /** @brief Construct and cache the planning contexts of the planner configurations \e config_names in the background,
+      so that the first requests using them are served from the cache. Requests arriving earlier wait for this. */
+  void prewarmPlanningContexts(const std::vector<std::string>& config_names);
+
   /** @brief Print the status of this node*/
   void printStatus();
 
@@ -131,12 +139,18 @@ protected:
   /** @brief Load the additional plugins for sampling constraints */
   void loadConstraintSamplers();
 
+  /** @brief Load the state sampler plugins selected by the planner configurations that are not loaded yet */
+  void loadStateSamplers();
+
   /** \brief Configure the OMPL planning context for a new planning request */
   ModelBasedPlanningContextPtr prepareForSolve(const planning_interface::MotionPlanRequest& req,
                                                const planning_scene::PlanningSceneConstPtr& planning_scene,
                                                moveit_msgs::msg::MoveItErrorCodes* error_code, unsigned int* attempts,
                                                double* timeout) const;
 
+  /** \brief Block until the planning contexts requested by prewarmPlanningContexts() are constructed */
+  void waitForPrewarming() const;
+
   rclcpp::Node::SharedPtr node_;  /// The ROS node
   const std::string parameter_namespace_;
 
@@ -145,10 +159,16 @@ protected:
 
   constraint_samplers::ConstraintSamplerManagerPtr constraint_sampler_manager_;
 
+  /// loader of the state sampler plugins, which must outlive the plugin instances held by context_manager_
+  std::unique_ptr<pluginlib::ClassLoader<StateSamplerAllocator>> state_sampler_loader_;
+
   PlanningContextManager context_manager_;
 
   bool use_constraints_approximations_;
 
+  mutable std::thread prewarm_thread_;
+  mutable std::mutex prewarm_lock_;
+
 private:
   constraint_sampler_manager_loader::ConstraintSamplerManagerLoaderPtr constraint_sampler_manager_loader_;
 };
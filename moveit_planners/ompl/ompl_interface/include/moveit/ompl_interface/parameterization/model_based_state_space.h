@@ -83,10 +83,11 @@ public:
       GOAL_DISTANCE_KNOWN = 2,
       VALIDITY_TRUE = 4,
       IS_START_STATE = 8,
-      IS_GOAL_STATE = 16
+      IS_GOAL_STATE = 16,
+      CLEARANCE_KNOWN = 32
     };
 
-    StateType() : ompl::base::State(), values(nullptr), tag(-1), flags(0), distance(0.0)
+    StateType() : ompl::base::State(), values(nullptr), tag(-1), flags(0), distance(0.0), clearance(0.0)
     {
     }
 
@@ -135,6 +136,18 @@ public:
       return flags & GOAL_DISTANCE_KNOWN;
     }
 
+    /** \brief Cache the distance of this state to the closest obstacle */
+    void markClearance(double c)
+    {
+      clearance = c;
+      flags |= CLEARANCE_KNOWN;
+    }
+
+    bool isClearanceKnown() const
+    {
+      return flags & CLEARANCE_KNOWN;
+    }
+
     bool isStartState() const
     {
       return flags & IS_START_STATE;
@@ -164,6 +177,7 @@ public:
     int tag;
     int flags;
     double distance;
+    double clearance;
   };
 
   ModelBasedStateSpace(ModelBasedStateSpaceSpecification spec);
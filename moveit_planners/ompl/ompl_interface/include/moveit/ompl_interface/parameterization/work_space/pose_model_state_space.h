@@ -106,6 +106,19 @@ public:
   bool computeStateIK(ompl::base::State* state) const;
   bool computeStateK(ompl::base::State* state) const;
 
+  /** \brief Interpolated states keep the joint space interpolation instead of running IK if the poses it reaches
+      deviate from the Cartesian interpolation by at most \e tolerance (translation in m plus rotation angle in rad).
+      A tolerance of 0 always runs IK. */
+  void setInterpolationTolerance(double tolerance)
+  {
+    interpolation_tolerance_ = tolerance;
+  }
+
+  double getInterpolationTolerance() const
+  {
+    return interpolation_tolerance_;
+  }
+
   void setPlanningVolume(double minX, double maxX, double minY, double maxY, double minZ, double maxZ) override;
   void copyToOMPLState(ompl::base::State* state, const moveit::core::RobotState& rstate) const override;
   void sanityChecks() const override;
@@ -116,6 +129,8 @@ public:
   }
 
 private:
+  bool jointInterpolationWithinTolerance(StateType* state) const;
+
   struct PoseComponent
   {
     PoseComponent(const moveit::core::JointModelGroup* subgroup,
@@ -138,5 +153,6 @@ private:
 
   std::vector<PoseComponent> poses_;
   double jump_factor_;
+  double interpolation_tolerance_;
 };
 }  // namespace ompl_interface
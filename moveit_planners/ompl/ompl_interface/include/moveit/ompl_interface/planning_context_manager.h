@@ -40,6 +40,7 @@
 #include <moveit/ompl_interface/parameterization/model_based_state_space_factory.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/macros/class_forward.h>
+#include <moveit/utils/memory_usage.h>
 
 #include <ompl/base/Planner.h>
 #include <ompl/base/PlannerDataStorage.h>
@@ -60,6 +61,10 @@ public:
                                  const ModelBasedPlanningContextSpecification& spec);
   ob::Planner *getFirstPlanner() { return planners_.size() ? planners_.begin()->second.get() : nullptr; }
 
+  /** \brief Estimate the memory of the roadmaps of the multi-query planners, one part per planner. The planner data
+   *  is read without synchronization, so this should not be called while one of the planners is solving. */
+  moveit::MemoryUsage getMemoryUsage() const;
+
 private:
   template <typename T>
   ob::PlannerPtr allocatePlannerImpl(const ob::SpaceInformationPtr& si, const std::string& new_name,
@@ -186,11 +191,26 @@ public:
                                                   const rclcpp::Node::SharedPtr& node,
                                                   bool use_constraints_approximations) const;
 
+  /** \brief Construct and cache the planning context of the planner configuration \e config_name ("group" or
+   * "group[planner_id]") without a request, so that the first request for it is served from the cache. */
+  bool prewarmPlanningContext(const std::string& config_name, const rclcpp::Node::SharedPtr& node) const;
+
   void registerPlannerAllocator(const std::string& planner_id, const ConfiguredPlannerAllocator& pa)
   {
     known_planners_[planner_id] = pa;
   }
 
+  /** \brief Register the state sampler plugin that planner configurations select with 'state_sampler: \e name' */
+  void registerStateSamplerAllocator(const std::string& name, const StateSamplerAllocatorPtr& allocator)
+  {
+    state_sampler_allocators_[name] = allocator;
+  }
+
+  const std::map<std::string, StateSamplerAllocatorPtr>& getRegisteredStateSamplerAllocators() const
+  {
+    return state_sampler_allocators_;
+  }
+
   void registerStateSpaceFactory(const ModelBasedStateSpaceFactoryPtr& factory)
   {
     state_space_factories_[factory->getType()] = factory;
@@ -210,6 +230,9 @@ public:
 
   ConfiguredPlannerSelector getPlannerSelector() const;
 
+  /** \brief Estimate the memory of the cached planning contexts and of the roadmaps of multi-query planners */
+  moveit::MemoryUsage getMemoryUsage() const;
+
 protected:
   ConfiguredPlannerAllocator plannerSelector(const std::string& planner) const;
 
@@ -219,6 +242,10 @@ protected:
   template <typename T>
   void registerPlannerAllocatorHelper(const std::string& planner_id);
 
+  /** \brief Construct the simple setup for a new planning context, which is an experience-based one if the
+   * configuration asks for it. The experience parameters are removed from the configuration. */
+  og::SimpleSetupPtr allocateSimpleSetup(ModelBasedPlanningContextSpecification& context_spec) const;
+
   /** \brief This is the function that constructs new planning contexts if no previous ones exist that are suitable */
   ModelBasedPlanningContextPtr getPlanningContext(const planning_interface::PlannerConfigurationSettings& config,
                                                   const ModelBasedStateSpaceFactoryPtr& factory,
@@ -235,6 +262,7 @@ protected:
 
   std::map<std::string, ConfiguredPlannerAllocator> known_planners_;
   std::map<std::string, ModelBasedStateSpaceFactoryPtr> state_space_factories_;
+  std::map<std::string, StateSamplerAllocatorPtr> state_sampler_allocators_;
 
   /** \brief All the existing planning configurations. The name
       of the configuration is the key of the map. This name can
@@ -0,0 +1,73 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <ompl/base/StateSampler.h>
+#include <ompl/geometric/PathGeometric.h>
+#include <rclcpp/node.hpp>
+#include <string>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+MOVEIT_CLASS_FORWARD(StateSamplerAllocator);  // Defines StateSamplerAllocatorPtr, ConstPtr, WeakPtr... etc
+
+/** @class StateSamplerAllocator
+ *  Base class for plugins that provide the state samplers of planning contexts, for example samplers drawing from a
+ *  learned distribution or biased towards regions that previously solved problems passed through. A plugin is selected
+ *  per group or planner configuration with the 'state_sampler' parameter. It replaces the uniform sampler of the state
+ *  space for requests without path constraints; requests with path constraints keep using the constraint samplers. */
+class StateSamplerAllocator
+{
+public:
+  virtual ~StateSamplerAllocator() = default;
+
+  /** \brief Initialize the plugin; \e parameter_namespace is the namespace of the OMPL planning parameters */
+  virtual bool initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) = 0;
+
+  /** \brief Allocate a sampler for \e state_space, the state space of \e context. Returning nullptr falls back to the
+   *  default sampler of the state space. Called concurrently by the threads of parallel planning attempts. */
+  virtual ompl::base::StateSamplerPtr alloc(const ModelBasedPlanningContext* context,
+                                            const ompl::base::StateSpace* state_space) = 0;
+
+  /** \brief Called with the (simplified) solution of each successfully solved request of \e context */
+  virtual void recordSolution(const ModelBasedPlanningContext* /*context*/,
+                              const ompl::geometric::PathGeometric& /*path*/)
+  {
+  }
+};
+}  // namespace ompl_interface
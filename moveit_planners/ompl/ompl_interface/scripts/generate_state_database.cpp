@@ -95,6 +95,9 @@ struct GenerateStateDatabaseParameters
     node->get_parameter_or("explicit_points_resolution", construction_opts.explicit_points_resolution, 0.05);
     get_uint_parameter_or(node, "max_explicit_points", construction_opts.max_explicit_points, 200);
 
+    // number of threads used for sampling and connecting states, 0 uses all hardware threads
+    get_uint_parameter_or(node, "thread_count", construction_opts.thread_count, 0);
+
     // local planning in JointModel state space
     node->get_parameter_or("state_space_parameterization", construction_opts.state_space_parameterization,
                            std::string("JointModel"));
@@ -0,0 +1,294 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/conservative_advancement_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <geometric_shapes/shape_operations.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ompl_interface
+{
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit.ompl_planning.conservative_advancement_motion_validator");
+
+ConservativeAdvancementMotionValidator::ConservativeAdvancementMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::MotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , planning_context_(pc)
+  , tss_(pc->getCompleteInitialRobotState())
+  , discrete_validator_(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , supported_(false)
+{
+  const moveit::core::JointModelGroup* jmg = planning_context_->getJointModelGroup();
+  if (planning_context_->getOMPLStateSpace()->getParameterizationType() != JointModelStateSpace::PARAMETERIZATION_TYPE)
+  {
+    RCLCPP_INFO(LOGGER, "State space of group '%s' does not interpolate in joint space, using discrete motion checks",
+                jmg->getName().c_str());
+    return;
+  }
+  if (!jmg->getMimicJointModels().empty())
+  {
+    RCLCPP_INFO(LOGGER, "Group '%s' contains mimic joints, using discrete motion checks", jmg->getName().c_str());
+    return;
+  }
+  for (const moveit::core::JointModel* joint : jmg->getActiveJointModels())
+    if (joint->getType() != moveit::core::JointModel::REVOLUTE &&
+        joint->getType() != moveit::core::JointModel::PRISMATIC)
+    {
+      RCLCPP_INFO(LOGGER, "Group '%s' contains multi-dof joint '%s', using discrete motion checks",
+                  jmg->getName().c_str(), joint->getName().c_str());
+      return;
+    }
+
+  computeLeverArms();
+  supported_ = lever_arms_.allFinite();
+  if (!supported_)
+    RCLCPP_INFO(LOGGER, "The motion of group '%s' cannot be bounded, using discrete motion checks",
+                jmg->getName().c_str());
+}
+
+void ConservativeAdvancementMotionValidator::computeLeverArms()
+{
+  const moveit::core::JointModelGroup* jmg = planning_context_->getJointModelGroup();
+  const std::vector<const moveit::core::LinkModel*>& links = jmg->getUpdatedLinkModelsWithGeometry();
+  lever_arms_.setZero(links.size(), jmg->getVariableCount());
+
+  for (std::size_t row = 0; row < links.size(); ++row)
+  {
+    // walk up to the root, keeping a bound on the distance of the link geometry from the frame of the current link
+    double arm = getLinkExtent(links[row]);
+    for (const moveit::core::LinkModel* link = links[row]; link && link->getParentJointModel();
+         link = link->getParentJointModel()->getParentLinkModel())
+    {
+      const moveit::core::JointModel* joint = link->getParentJointModel();
+      if (jmg->hasJointModel(joint->getName()) && !joint->getMimic() && joint->getVariableCount() == 1)
+      {
+        const int column = jmg->getVariableGroupIndex(joint->getVariableNames()[0]);
+        lever_arms_(row, column) = joint->getType() == moveit::core::JointModel::PRISMATIC ? 1.0 : arm;
+      }
+
+      // the origin of the child link frame moves relative to the parent link frame only through prismatic,
+      // planar and floating joints
+      arm += link->getJointOriginTransform().translation().norm();
+      if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+      {
+        const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[0];
+        arm += bounds.position_bounded_ ? std::max(std::fabs(bounds.min_position_), std::fabs(bounds.max_position_)) :
+                                          std::numeric_limits<double>::infinity();
+      }
+      else if (joint->getType() == moveit::core::JointModel::PLANAR ||
+               joint->getType() == moveit::core::JointModel::FLOATING)
+        arm = std::numeric_limits<double>::infinity();
+    }
+  }
+}
+
+double ConservativeAdvancementMotionValidator::getLinkExtent(const moveit::core::LinkModel* link) const
+{
+  const collision_detection::CollisionEnvConstPtr& cenv = planning_context_->getPlanningScene()->getCollisionEnv();
+  const double padding = cenv->getLinkPadding(link->getName());
+  const double scale = cenv->getLinkScale(link->getName());
+
+  double extent = 0.0;
+  const auto add_shape = [&extent, padding, scale](const shapes::ShapeConstPtr& shape, const Eigen::Isometry3d& pose) {
+    if (shape->type == shapes::PLANE || shape->type == shapes::OCTREE)
+    {
+      extent = std::numeric_limits<double>::infinity();
+      return;
+    }
+    Eigen::Vector3d center;
+    double radius;
+    shapes::computeShapeBoundingSphere(shape.get(), center, radius);
+    extent = std::max(extent, pose.translation().norm() + scale * (center.norm() + radius) + padding);
+  };
+
+  for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    add_shape(link->getShapes()[i], link->getCollisionOriginTransforms()[i]);
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  planning_context_->getCompleteInitialRobotState().getAttachedBodies(attached_bodies, link);
+  for (const moveit::core::AttachedBody* body : attached_bodies)
+    for (std::size_t i = 0; i < body->getShapes().size(); ++i)
+      add_shape(body->getShapes()[i], body->getShapePosesInLinkFrame()[i]);
+
+  return extent;
+}
+
+bool ConservativeAdvancementMotionValidator::isConservativeAdvancementEnabled() const
+{
+  if (!supported_)
+    return false;
+  const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
+  if (kset && !kset->empty())
+    return false;
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  return !scene->getStateFeasibilityPredicate() && scene->getCollisionDetectorName() == "FCL";
+}
+
+double ConservativeAdvancementMotionValidator::getSweptDistanceBound(const ompl::base::State* s1,
+                                                                    const ompl::base::State* s2) const
+{
+  if (!supported_)
+    return std::numeric_limits<double>::infinity();
+  if (lever_arms_.rows() == 0)
+    return 0.0;
+
+  const double* values1 = s1->as<ModelBasedStateSpace::StateType>()->values;
+  const double* values2 = s2->as<ModelBasedStateSpace::StateType>()->values;
+  Eigen::VectorXd displacement(lever_arms_.cols());
+  for (const moveit::core::JointModel* joint : planning_context_->getJointModelGroup()->getActiveJointModels())
+  {
+    const int index = planning_context_->getJointModelGroup()->getVariableGroupIndex(joint->getVariableNames()[0]);
+    // distance() accounts for the wrap-around of continuous joints
+    displacement[index] = joint->distance(values1 + index, values2 + index);
+  }
+  return (lever_arms_ * displacement).maxCoeff();
+}
+
+double ConservativeAdvancementMotionValidator::getClearance(const moveit::core::RobotState& state,
+                                                            double threshold) const
+{
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  collision_detection::DistanceRequest req;
+  req.group_name = planning_context_->getGroupName();
+  req.enableGroup(planning_context_->getRobotModel());
+  req.acm = &scene->getAllowedCollisionMatrix();
+
+  // distances to the world are traversed by the moving links alone
+  collision_detection::DistanceResult res;
+  req.distance_threshold = threshold;
+  scene->getCollisionEnv()->distanceRobot(req, res, state);
+  const double world_clearance = res.minimum_distance.distance;
+  if (world_clearance <= 0.0)
+    return world_clearance;
+
+  // two links of the robot may move towards each other
+  res.clear();
+  req.distance_threshold = 2.0 * threshold;
+  scene->getCollisionEnvUnpadded()->distanceSelf(req, res, state);
+  return std::min(world_clearance, 0.5 * res.minimum_distance.distance);
+}
+
+bool ConservativeAdvancementMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                         const ompl::base::State* s2) const
+{
+  return checkMotion(s1, s2, nullptr);
+}
+
+bool ConservativeAdvancementMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                         std::pair<ompl::base::State*, double>& last_valid) const
+{
+  return checkMotion(s1, s2, &last_valid);
+}
+
+bool ConservativeAdvancementMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                         std::pair<ompl::base::State*, double>* last_valid) const
+{
+  const double bound = isConservativeAdvancementEnabled() ? getSweptDistanceBound(s1, s2) :
+                                                            std::numeric_limits<double>::infinity();
+  if (!std::isfinite(bound))
+  {
+    const bool valid =
+        last_valid ? discrete_validator_.checkMotion(s1, s2, *last_valid) : discrete_validator_.checkMotion(s1, s2);
+    if (valid)
+      valid_++;
+    else
+      invalid_++;
+    return valid;
+  }
+
+  // like the discrete validator, reject motions to invalid states before looking at the motion itself
+  if (!last_valid && !si_->isValid(s2))
+  {
+    invalid_++;
+    return false;
+  }
+
+  const ompl::base::StateSpacePtr& state_space = si_->getStateSpace();
+  const double min_step = 1.0 / std::max(1u, state_space->validSegmentCount(s1, s2));
+  moveit::core::RobotState* robot_state = tss_.getStateStorage();
+  ompl::base::State* state = si_->allocState();
+
+  // s1 is assumed to be valid; every state at or before last_valid_time is known to be valid
+  bool valid = true;
+  double time = 0.0;
+  double last_valid_time = 0.0;
+  if (bound > 0.0)
+  {
+    while (true)
+    {
+      state_space->interpolate(s1, s2, time, state);
+      planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_state, state);
+
+      const double remaining = (1.0 - time) * bound;
+      const double clearance = getClearance(*robot_state, remaining);
+      // a state close to a collision is decided by the validity checker, as distance queries are approximate
+      if (clearance <= 0.0 && time > 0.0 && !si_->isValid(state))
+      {
+        valid = false;
+        break;
+      }
+      last_valid_time = time;
+      if (clearance >= remaining)
+        break;
+
+      time += std::max(min_step, clearance / bound);
+      if (time >= 1.0)
+        break;
+    }
+  }
+
+  if (valid && last_valid && !si_->isValid(s2))
+    valid = false;
+
+  if (!valid && last_valid)
+  {
+    if (last_valid->first)
+      state_space->interpolate(s1, s2, last_valid_time, last_valid->first);
+    last_valid->second = last_valid_time;
+  }
+  si_->freeState(state);
+
+  if (valid)
+    valid_++;
+  else
+    invalid_++;
+  return valid;
+}
+}  // namespace ompl_interface
@@ -34,9 +34,12 @@
 
 /* Author: Ioan Sucan */
 
+#include <atomic>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
 
@@ -252,6 +255,30 @@ ompl_interface::ConstraintApproximation::getStateSamplerAllocator(const moveit_m
     return allocConstraintApproximationStateSampler(ss, space_signature_, state_storage_, milestones_);
   };
 }
+std::shared_ptr<const constraint_samplers::PrecomputedConstraintSampler::StateSet>
+ompl_interface::ConstraintApproximation::getGroupStates(const ModelBasedPlanningContext* pcontext) const
+{
+  std::lock_guard<std::mutex> slock(group_states_lock_);
+  if (group_states_)
+    return group_states_;
+
+  std::vector<int> signature;
+  pcontext->getOMPLStateSpace()->computeSignature(signature);
+  if (signature != space_signature_)
+    return group_states_;
+
+  // only the milestones are sampled states, the states after them are explicit motion points
+  auto group_states = std::make_shared<constraint_samplers::PrecomputedConstraintSampler::StateSet>(milestones_);
+  moveit::core::RobotState robot_state = pcontext->getCompleteInitialRobotState();
+  for (std::size_t i = 0; i < milestones_; ++i)
+  {
+    pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, state_storage_->getState(i));
+    robot_state.copyJointGroupPositions(pcontext->getJointModelGroup(), (*group_states)[i]);
+  }
+  group_states_ = group_states;
+  return group_states_;
+}
+
 /*
 void ompl_interface::ConstraintApproximation::visualizeDistribution(const
 std::string &link_name, unsigned int count,
@@ -297,7 +324,18 @@ robot_state.getLinkState(link_name)->getGlobalLinkTransform().translation();
 
 void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std::string& path)
 {
+  // the manifest is rewritten whenever the approximations are saved, so an unchanged manifest means the loaded
+  // approximations are still current
+  std::error_code ec;
+  const std::filesystem::file_time_type manifest_time = std::filesystem::last_write_time(path + "/manifest", ec);
+  if (!ec && path == loaded_path_ && manifest_time == loaded_manifest_time_)
+  {
+    RCLCPP_DEBUG(LOGGER, "Constraint approximations from '%s' are already loaded", path.c_str());
+    return;
+  }
+
   constraint_approximations_.clear();
+  loaded_path_.clear();
   std::ifstream fin((path + "/manifest").c_str());
   if (!fin.good())
   {
@@ -310,44 +348,72 @@ void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std:
 
   RCLCPP_INFO(LOGGER, "Loading constrained space approximations from '%s'...", path.c_str());
 
-  while (fin.good() && !fin.eof())
+  struct ManifestEntry
   {
-    std::string group, state_space_parameterization, serialization, filename;
+    std::string group, state_space_parameterization, filename;
     bool explicit_motions;
     unsigned int milestones;
-    fin >> group;
+    moveit_msgs::msg::Constraints msg;
+    ConstraintApproximationStateStorage* cass;
+  };
+  std::vector<ManifestEntry> entries;
+
+  while (fin.good() && !fin.eof())
+  {
+    ManifestEntry entry;
+    std::string serialization;
+    fin >> entry.group;
     if (fin.eof())
       break;
-    fin >> state_space_parameterization;
+    fin >> entry.state_space_parameterization;
     if (fin.eof())
       break;
-    fin >> explicit_motions;
+    fin >> entry.explicit_motions;
     if (fin.eof())
       break;
-    fin >> milestones;
+    fin >> entry.milestones;
     if (fin.eof())
       break;
     fin >> serialization;
     if (fin.eof())
       break;
-    fin >> filename;
+    fin >> entry.filename;
 
-    if (context_->getGroupName() != group &&
-        context_->getOMPLStateSpace()->getParameterizationType() != state_space_parameterization)
+    if (context_->getGroupName() != entry.group &&
+        context_->getOMPLStateSpace()->getParameterizationType() != entry.state_space_parameterization)
     {
       RCLCPP_INFO(LOGGER, "Ignoring constraint approximation of type '%s' for group '%s' from '%s'...",
-                  state_space_parameterization.c_str(), group.c_str(), filename.c_str());
+                  entry.state_space_parameterization.c_str(), entry.group.c_str(), entry.filename.c_str());
       continue;
     }
 
     RCLCPP_INFO(LOGGER, "Loading constraint approximation of type '%s' for group '%s' from '%s'...",
-                state_space_parameterization.c_str(), group.c_str(), filename.c_str());
-    moveit_msgs::msg::Constraints msg;
-    hexToMsg(serialization, msg);
-    auto* cass = new ConstraintApproximationStateStorage(context_->getOMPLSimpleSetup()->getStateSpace());
-    cass->load((std::string{ path }.append("/").append(filename)).c_str());
-    auto cap = std::make_shared<ConstraintApproximation>(group, state_space_parameterization, explicit_motions, msg,
-                                                         filename, ompl::base::StateStoragePtr(cass), milestones);
+                entry.state_space_parameterization.c_str(), entry.group.c_str(), entry.filename.c_str());
+    hexToMsg(serialization, entry.msg);
+    entry.cass = new ConstraintApproximationStateStorage(context_->getOMPLSimpleSetup()->getStateSpace());
+    entries.push_back(std::move(entry));
+  }
+
+  // the state storages are independent of each other, so they are deserialized concurrently
+  std::atomic<std::size_t> next_entry{ 0 };
+  const auto load_storages = [&]() {
+    for (std::size_t e = next_entry++; e < entries.size(); e = next_entry++)
+      entries[e].cass->load((std::string{ path }.append("/").append(entries[e].filename)).c_str());
+  };
+  std::vector<std::thread> threads;
+  const std::size_t thread_count = std::min<std::size_t>(entries.size(), std::thread::hardware_concurrency());
+  for (std::size_t t = 1; t < thread_count; ++t)
+    threads.emplace_back(load_storages);
+  load_storages();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (ManifestEntry& entry : entries)
+  {
+    ConstraintApproximationStateStorage* cass = entry.cass;
+    auto cap = std::make_shared<ConstraintApproximation>(entry.group, entry.state_space_parameterization,
+                                                         entry.explicit_motions, entry.msg, entry.filename,
+                                                         ompl::base::StateStoragePtr(cass), entry.milestones);
     if (constraint_approximations_.find(cap->getName()) != constraint_approximations_.end())
       RCLCPP_WARN(LOGGER, "Overwriting constraint approximation named '%s'", cap->getName().c_str());
     constraint_approximations_[cap->getName()] = cap;
@@ -358,7 +424,13 @@ void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std:
                 "Loaded %lu states (%lu milestones) and %lu connections (%0.1lf per state) "
                 "for constraint named '%s'%s",
                 cass->size(), cap->getMilestoneCount(), sum, (double)sum / (double)cap->getMilestoneCount(),
-                msg.name.c_str(), explicit_motions ? ". Explicit motions included." : "");
+                entry.msg.name.c_str(), entry.explicit_motions ? ". Explicit motions included." : "");
+  }
+
+  if (!ec)
+  {
+    loaded_path_ = path;
+    loaded_manifest_time_ = manifest_time;
   }
   RCLCPP_INFO(LOGGER, "Done loading constrained space approximations.");
 }
@@ -394,11 +466,20 @@ void ompl_interface::ConstraintsLibrary::saveConstraintApproximations(const std:
   else
     RCLCPP_ERROR(LOGGER, "Unable to save constraint approximation to '%s'", path.c_str());
   fout.close();
+
+  // what was just written matches what is in memory, so there is no need to load it back
+  std::error_code ec;
+  loaded_manifest_time_ = std::filesystem::last_write_time(path + "/manifest", ec);
+  if (ec)
+    loaded_path_.clear();
+  else
+    loaded_path_ = path;
 }
 
 void ompl_interface::ConstraintsLibrary::clearConstraintApproximations()
 {
   constraint_approximations_.clear();
+  loaded_path_.clear();
 }
 
 void ompl_interface::ConstraintsLibrary::printConstraintApproximations(std::ostream& out) const
@@ -494,74 +575,99 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
 
   const moveit::core::RobotState& default_state = pcontext->getCompleteInitialRobotState();
 
-  unsigned int attempts = 0;
+  const unsigned int thread_count =
+      std::max(1u, options.thread_count > 0 ? options.thread_count : std::thread::hardware_concurrency());
 
   double bounds_val = std::numeric_limits<double>::max() / 2.0 - 1.0;
   pcontext->getOMPLStateSpace()->setPlanningVolume(-bounds_val, bounds_val, -bounds_val, bounds_val, -bounds_val,
                                                    bounds_val);
   pcontext->getOMPLStateSpace()->setup();
 
-  // construct the constrained states
-
-  moveit::core::RobotState robot_state(default_state);
+  // construct the constrained states; every thread gets its own sampler, while the constraint set is shared
   const constraint_samplers::ConstraintSamplerManagerPtr& csmng = pcontext->getConstraintSamplerManager();
-  ConstrainedSampler* constrained_sampler = nullptr;
-  if (csmng)
+  std::vector<ConstrainedSampler*> constrained_samplers(thread_count, nullptr);
+  std::vector<ob::StateSamplerPtr> samplers(thread_count);
+  for (unsigned int t = 0; t < thread_count; ++t)
   {
-    constraint_samplers::ConstraintSamplerPtr constraint_sampler =
-        csmng->selectSampler(pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
-    if (constraint_sampler)
-      constrained_sampler = new ConstrainedSampler(pcontext, constraint_sampler);
+    if (csmng)
+    {
+      constraint_samplers::ConstraintSamplerPtr constraint_sampler = csmng->selectSampler(
+          pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
+      if (constraint_sampler)
+        constrained_samplers[t] = new ConstrainedSampler(pcontext, constraint_sampler);
+    }
+    samplers[t] = constrained_samplers[t] ? ob::StateSamplerPtr(constrained_samplers[t]) :
+                                            pcontext->getOMPLStateSpace()->allocDefaultStateSampler();
   }
 
-  ob::StateSamplerPtr ss(constrained_sampler ? ob::StateSamplerPtr(constrained_sampler) :
-                                               pcontext->getOMPLStateSpace()->allocDefaultStateSampler());
-
-  ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
+  std::mutex storage_lock;
+  unsigned int attempts = 0;
   int done = -1;
   bool slow_warn = false;
+  bool failed = false;
   ompl::time::point start = ompl::time::now();
-  while (state_storage->size() < options.samples)
-  {
-    ++attempts;
-    int done_now = 100 * state_storage->size() / options.samples;
-    if (done != done_now)
-    {
-      done = done_now;
-      RCLCPP_INFO(LOGGER, "%d%% complete (kept %0.1lf%% sampled states)", done,
-                  100.0 * (double)state_storage->size() / (double)attempts);
-    }
 
-    if (!slow_warn && attempts > 10 && attempts > state_storage->size() * 100)
+  const auto sample_states = [&](unsigned int t) {
+    moveit::core::RobotState robot_state(default_state);
+    ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
+    bool satisfied = false;
+    while (true)
     {
-      slow_warn = true;
-      RCLCPP_WARN(LOGGER, "Computation of valid state database is very slow...");
-    }
+      {
+        std::scoped_lock lock(storage_lock);
+        if (satisfied && state_storage->size() < options.samples)
+        {
+          temp->as<ModelBasedStateSpace::StateType>()->tag = state_storage->size();
+          state_storage->addState(temp.get());
+        }
+        if (failed || state_storage->size() >= options.samples)
+          break;
 
-    if (attempts > options.samples && state_storage->size() == 0)
-    {
-      RCLCPP_ERROR(LOGGER, "Unable to generate any samples");
-      break;
-    }
+        ++attempts;
+        int done_now = 100 * state_storage->size() / options.samples;
+        if (done != done_now)
+        {
+          done = done_now;
+          RCLCPP_INFO(LOGGER, "%d%% complete (kept %0.1lf%% sampled states)", done,
+                      100.0 * (double)state_storage->size() / (double)attempts);
+        }
 
-    ss->sampleUniform(temp.get());
-    pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, temp.get());
-    if (kset.decide(robot_state).satisfied)
-    {
-      if (state_storage->size() < options.samples)
-      {
-        temp->as<ModelBasedStateSpace::StateType>()->tag = state_storage->size();
-        state_storage->addState(temp.get());
+        if (!slow_warn && attempts > 10 && attempts > state_storage->size() * 100)
+        {
+          slow_warn = true;
+          RCLCPP_WARN(LOGGER, "Computation of valid state database is very slow...");
+        }
+
+        if (attempts > options.samples && state_storage->size() == 0)
+        {
+          RCLCPP_ERROR(LOGGER, "Unable to generate any samples");
+          failed = true;
+          break;
+        }
       }
+
+      samplers[t]->sampleUniform(temp.get());
+      pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, temp.get());
+      satisfied = kset.satisfied(robot_state);
     }
-  }
+  };
+
+  std::vector<std::thread> sampling_threads;
+  for (unsigned int t = 1; t < thread_count; ++t)
+    sampling_threads.emplace_back(sample_states, t);
+  sample_states(0);
+  for (std::thread& thread : sampling_threads)
+    thread.join();
 
   result.state_sampling_time = ompl::time::seconds(ompl::time::now() - start);
-  RCLCPP_INFO(LOGGER, "Generated %u states in %lf seconds", (unsigned int)state_storage->size(),
-              result.state_sampling_time);
-  if (constrained_sampler)
+  RCLCPP_INFO(LOGGER, "Generated %u states in %lf seconds using %u threads", (unsigned int)state_storage->size(),
+              result.state_sampling_time, thread_count);
+  if (constrained_samplers[0])
   {
-    result.sampling_success_rate = constrained_sampler->getConstrainedSamplingRate();
+    double rate = 0.0;
+    for (const ConstrainedSampler* constrained_sampler : constrained_samplers)
+      rate += constrained_sampler->getConstrainedSamplingRate();
+    result.sampling_success_rate = rate / (double)thread_count;
     RCLCPP_INFO(LOGGER, "Constrained sampling rate: %lf", result.sampling_success_rate);
   }
 
@@ -572,13 +678,73 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
 
     // construct connections
     const ob::StateSpacePtr& space = pcontext->getOMPLSimpleSetup()->getStateSpace();
-    unsigned int milestones = state_storage->size();
-    std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->allocStates(int_states);
+    const ob::SpaceInformationPtr& si = pcontext->getOMPLSimpleSetup()->getSpaceInformation();
+    const std::size_t milestones = state_storage->size();
+
+    // interpolate from milestone i to milestone j into int_states and, if requested, check the constraints along the
+    // way; returns false if the milestones are too far apart or an intermediate state violates the constraints
+    const auto connect = [&](std::size_t i, std::size_t j, bool check, moveit::core::RobotState& robot_state,
+                             std::vector<ob::State*>& int_states, unsigned int& isteps) {
+      const ob::State* sj = state_storage->getState(j);
+      double d = space->distance(state_storage->getState(i), sj);
+      if (d >= options.max_edge_length)
+        return false;
+      isteps = std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
+      double step = 1.0 / (double)isteps;
+      space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
+      for (unsigned int k = 1; k < isteps; ++k)
+      {
+        double this_step = step / (1.0 - (k - 1) * step);
+        space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
+        if (!check)
+          continue;
+        pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, int_states[k]);
+        if (!kset.satisfied(robot_state))
+          return false;
+      }
+      return true;
+    };
 
     ompl::time::point start = ompl::time::now();
+
+    // The expensive part is validating the edges. This is done speculatively in parallel: for every milestone j,
+    // the candidates i > j are checked in order until edges_per_sample valid ones are found. Bookkeeping which
+    // milestones are already saturated is left to the sequential pass below, so the resulting graph is the same as
+    // the one built by a single thread.
+    std::vector<std::vector<std::size_t>> valid_edges(milestones);
+    std::vector<std::size_t> checked_until(milestones, milestones);
+    std::atomic<std::size_t> next_milestone{ 0 };
+    const auto check_edges = [&]() {
+      moveit::core::RobotState robot_state(default_state);
+      std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
+      si->allocStates(int_states);
+      unsigned int isteps;
+      for (std::size_t j = next_milestone++; j < milestones; j = next_milestone++)
+        for (std::size_t i = j + 1; i < milestones; ++i)
+          if (connect(i, j, true, robot_state, int_states, isteps))
+          {
+            valid_edges[j].push_back(i);
+            if (valid_edges[j].size() >= options.edges_per_sample)
+            {
+              checked_until[j] = i + 1;
+              break;
+            }
+          }
+      si->freeStates(int_states);
+    };
+
+    std::vector<std::thread> connection_threads;
+    for (unsigned int t = 1; t < thread_count; ++t)
+      connection_threads.emplace_back(check_edges);
+    check_edges();
+    for (std::thread& thread : connection_threads)
+      thread.join();
+
+    moveit::core::RobotState robot_state(default_state);
+    std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
+    si->allocStates(int_states);
     int good = 0;
-    int done = -1;
+    done = -1;
 
     for (std::size_t j = 0; j < milestones; ++j)
     {
@@ -591,31 +757,24 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
       if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
         continue;
 
-      const ob::State* sj = state_storage->getState(j);
-
+      auto candidate = valid_edges[j].begin();
       for (std::size_t i = j + 1; i < milestones; ++i)
       {
         if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
           continue;
-        double d = space->distance(state_storage->getState(i), sj);
-        if (d >= options.max_edge_length)
-          continue;
-        unsigned int isteps =
-            std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
-        double step = 1.0 / (double)isteps;
-        bool ok = true;
-        space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
-        for (unsigned int k = 1; k < isteps; ++k)
+        unsigned int isteps = 0;
+        bool ok;
+        if (i < checked_until[j])
         {
-          double this_step = step / (1.0 - (k - 1) * step);
-          space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
-          pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, int_states[k]);
-          if (!kset.decide(robot_state).satisfied)
-          {
-            ok = false;
-            break;
-          }
+          while (candidate != valid_edges[j].end() && *candidate < i)
+            ++candidate;
+          ok = candidate != valid_edges[j].end() && *candidate == i;
+          // the intermediate states are only needed when they are stored
+          if (ok && options.explicit_motions)
+            connect(i, j, false, robot_state, int_states, isteps);
         }
+        else
+          ok = connect(i, j, true, robot_state, int_states, isteps);
 
         if (ok)
         {
@@ -644,7 +803,7 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
     result.state_connection_time = ompl::time::seconds(ompl::time::now() - start);
     RCLCPP_INFO(LOGGER, "Computed possible connexions in %lf seconds. Added %d connexions",
                 result.state_connection_time, good);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->freeStates(int_states);
+    si->freeStates(int_states);
 
     return state_storage;
   }
@@ -0,0 +1,161 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/lazy_collision_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <algorithm>
+
+namespace ompl_interface
+{
+LazyCollisionMotionValidator::LazyCollisionMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::MotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation()), planning_context_(pc)
+{
+  collision_request_.group_name = planning_context_->getGroupName();
+}
+
+std::vector<moveit::core::RobotStatePtr>& LazyCollisionMotionValidator::getStateStorage(std::size_t count) const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  std::vector<moveit::core::RobotStatePtr>& states = thread_states_[std::this_thread::get_id()];
+  while (states.size() < count)
+    states.push_back(std::make_shared<moveit::core::RobotState>(planning_context_->getCompleteInitialRobotState()));
+  return states;
+}
+
+bool LazyCollisionMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const
+{
+  return checkMotion(s1, s2, nullptr);
+}
+
+bool LazyCollisionMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                               std::pair<ompl::base::State*, double>& last_valid) const
+{
+  return checkMotion(s1, s2, &last_valid);
+}
+
+bool LazyCollisionMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                               std::pair<ompl::base::State*, double>* last_valid) const
+{
+  const ompl::base::StateSpacePtr& state_space = si_->getStateSpace();
+  const unsigned int segments = std::max(1u, state_space->validSegmentCount(s1, s2));
+  std::vector<moveit::core::RobotStatePtr>& robot_states = getStateStorage(segments + 1);
+  ompl::base::State* state = si_->allocState();
+
+  // check bounds, path constraints and feasibility in order along the motion, collect the states to collision check
+  std::size_t first_invalid = segments + 1;
+  std::vector<const moveit::core::RobotState*> batch;
+  std::vector<std::size_t> batch_indices;
+  batch.reserve(segments + 1);
+  batch_indices.reserve(segments + 1);
+  for (std::size_t i = 0; i <= segments; ++i)
+  {
+    const ompl::base::State* s = s2;
+    if (i == 0)
+    {
+      s = s1;
+    }
+    else if (i < segments)
+    {
+      state_space->interpolate(s1, s2, static_cast<double>(i) / segments, state);
+      s = state;
+    }
+
+    const ModelBasedStateSpace::StateType* model_state = s->as<ModelBasedStateSpace::StateType>();
+    if (model_state->isValidityKnown() && model_state->isMarkedValid())
+      continue;
+    if (!si_->isValid(s))
+    {
+      first_invalid = i;
+      break;
+    }
+    planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_states[i], s);
+    batch.push_back(robot_states[i].get());
+    batch_indices.push_back(i);
+  }
+
+  // the collected states all precede the first invalid one; find the first one in collision
+  if (!batch.empty())
+  {
+    const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+    const collision_detection::AllowedCollisionMatrix& acm = scene->getAllowedCollisionMatrix();
+    std::vector<collision_detection::CollisionResult> results;
+    scene->getCollisionEnv()->checkRobotCollisionBatch(collision_request_, batch, results, acm);
+    for (std::size_t k = 0; k < batch.size(); ++k)
+    {
+      bool colliding = results[k].collision;
+      if (!colliding)
+      {
+        // like PlanningScene::checkCollision(), self collisions are checked without padding
+        collision_detection::CollisionResult self_result;
+        scene->getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, self_result, *batch[k], acm);
+        colliding = self_result.collision;
+      }
+      if (colliding)
+      {
+        first_invalid = batch_indices[k];
+        break;
+      }
+    }
+  }
+
+  // remember the validity of the end states for other motions
+  auto mark = [](const ompl::base::State* s, bool valid) {
+    ModelBasedStateSpace::StateType* model_state =
+        const_cast<ompl::base::State*>(s)->as<ModelBasedStateSpace::StateType>();
+    if (valid)
+      model_state->markValid();
+    else
+      model_state->markInvalid();
+  };
+  mark(s1, first_invalid != 0);
+  if (first_invalid >= segments)
+    mark(s2, first_invalid > segments);
+
+  const bool valid = first_invalid > segments;
+  if (!valid && last_valid)
+  {
+    const double last_valid_time = first_invalid == 0 ? 0.0 : static_cast<double>(first_invalid - 1) / segments;
+    if (last_valid->first)
+      state_space->interpolate(s1, s2, last_valid_time, last_valid->first);
+    last_valid->second = last_valid_time;
+  }
+  si_->freeState(state);
+
+  if (valid)
+    valid_++;
+  else
+    invalid_++;
+  return valid;
+}
+}  // namespace ompl_interface
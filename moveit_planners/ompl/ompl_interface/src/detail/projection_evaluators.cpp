@@ -38,15 +38,68 @@
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 
+#include <algorithm>
+#include <atomic>
 #include <utility>
 
+namespace
+{
+std::atomic<std::size_t> next_projection_id{ 1 };
+
+/** \brief The link position stored last on this thread by ProjectionEvaluatorLinkPose::storeLinkPosition() */
+struct StoredLinkPosition
+{
+  std::size_t projection_id = 0;
+  std::vector<double> values;
+  Eigen::Vector3d position;
+};
+thread_local StoredLinkPosition stored_link_position;
+}  // namespace
+
 ompl_interface::ProjectionEvaluatorLinkPose::ProjectionEvaluatorLinkPose(const ModelBasedPlanningContext* pc,
                                                                          const std::string& link)
   : ompl::base::ProjectionEvaluator(pc->getOMPLStateSpace())
   , planning_context_(pc)
   , link_(planning_context_->getJointModelGroup()->getLinkModel(link))
   , tss_(planning_context_->getCompleteInitialRobotState())
+  , use_chain_(!pc->getSpecification().constrained_state_space_)
+  , chain_base_(Eigen::Isometry3d::Identity())
+  , variable_count_(pc->getJointModelGroup()->getVariableCount())
+  , id_(next_projection_id++)
 {
+  const moveit::core::JointModelGroup* jmg = pc->getJointModelGroup();
+  moveit::core::RobotState initial_state(pc->getCompleteInitialRobotState());
+  initial_state.update();
+
+  std::vector<const moveit::core::LinkModel*> path;
+  for (const moveit::core::LinkModel* l = link_; l; l = l->getParentLinkModel())
+    path.push_back(l);
+  std::reverse(path.begin(), path.end());
+
+  // the links above the first joint that is planned for do not move
+  const auto is_planned = [jmg](const moveit::core::JointModel* joint) {
+    return joint->getVariableCount() > 0 && jmg->hasJointModel(joint->getName());
+  };
+  auto first = std::find_if(path.begin(), path.end(),
+                            [&](const moveit::core::LinkModel* l) { return is_planned(l->getParentJointModel()); });
+  if (first == path.end())
+  {
+    chain_base_ = initial_state.getGlobalLinkTransform(link_);
+    return;
+  }
+  if (first != path.begin())
+    chain_base_ = initial_state.getGlobalLinkTransform(*(first - 1));
+
+  for (auto it = first; it != path.end(); ++it)
+  {
+    const moveit::core::JointModel* joint = (*it)->getParentJointModel();
+    if (joint->getMimic())
+      use_chain_ = false;
+    if (is_planned(joint))
+      chain_.push_back({ joint, (*it)->getJointOriginTransform(), jmg->getVariableGroupIndex(joint->getName()) });
+    else
+      chain_.push_back({ joint, (*it)->getJointOriginTransform() * initial_state.getJointTransform(joint), -1 });
+  }
 }
 
 unsigned int ompl_interface::ProjectionEvaluatorLinkPose::getDimension() const
@@ -65,13 +118,54 @@ void ompl_interface::ProjectionEvaluatorLinkPose::defaultCellSizes()
 void ompl_interface::ProjectionEvaluatorLinkPose::project(const ompl::base::State* state,
                                                           OMPLProjection projection) const
 {
-  moveit::core::RobotState* s = tss_.getStateStorage();
-  planning_context_->getOMPLStateSpace()->copyToRobotState(*s, state);
+  if (!use_chain_)
+  {
+    moveit::core::RobotState* s = tss_.getStateStorage();
+    planning_context_->getOMPLStateSpace()->copyToRobotState(*s, state);
+
+    const Eigen::Vector3d& o = s->getGlobalLinkTransform(link_).translation();
+    projection(0) = o.x();
+    projection(1) = o.y();
+    projection(2) = o.z();
+    return;
+  }
+
+  const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+  if (stored_link_position.projection_id == id_ &&
+      std::equal(values, values + variable_count_, stored_link_position.values.begin()))
+  {
+    projection(0) = stored_link_position.position.x();
+    projection(1) = stored_link_position.position.y();
+    projection(2) = stored_link_position.position.z();
+    return;
+  }
 
-  const Eigen::Vector3d& o = s->getGlobalLinkTransform(link_).translation();
-  projection(0) = o.x();
-  projection(1) = o.y();
-  projection(2) = o.z();
+  Eigen::Isometry3d pose = chain_base_;
+  Eigen::Isometry3d joint_transform;
+  for (const ChainLink& link : chain_)
+  {
+    if (link.variable_index < 0)
+      pose.affine() = pose.affine() * link.origin.matrix();
+    else
+    {
+      link.joint->computeTransform(values + link.variable_index, joint_transform);
+      pose.affine() = pose.affine() * link.origin.matrix() * joint_transform.matrix();
+    }
+  }
+  projection(0) = pose.translation().x();
+  projection(1) = pose.translation().y();
+  projection(2) = pose.translation().z();
+}
+
+void ompl_interface::ProjectionEvaluatorLinkPose::storeLinkPosition(const ompl::base::State* state,
+                                                                    const moveit::core::RobotState& robot_state) const
+{
+  if (!use_chain_)
+    return;
+  const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+  stored_link_position.projection_id = id_;
+  stored_link_position.values.assign(values, values + variable_count_);
+  stored_link_position.position = robot_state.getGlobalLinkTransform(link_).translation();
 }
 
 ompl_interface::ProjectionEvaluatorJointValue::ProjectionEvaluatorJointValue(const ModelBasedPlanningContext* pc,
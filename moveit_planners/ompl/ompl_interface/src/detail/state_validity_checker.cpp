@@ -36,6 +36,8 @@
 
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/detail/projection_evaluators.h>
+#include <moveit/utils/performance_counters.h>
 #include <ompl/base/spaces/constraint/ConstrainedStateSpace.h>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
@@ -50,6 +52,8 @@ ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlann
   , group_name_(pc->getGroupName())
   , tss_(pc->getCompleteInitialRobotState())
   , verbose_(false)
+  , defer_collision_checking_(false)
+  , cache_clearance_with_validity_(false)
 {
   specs_.clearanceComputationType = ompl::base::StateValidityCheckerSpecs::APPROXIMATE;
   specs_.hasValidDirectionComputation = false;
@@ -73,6 +77,42 @@ void ompl_interface::StateValidityChecker::setVerbose(bool flag)
   verbose_ = flag;
 }
 
+void ompl_interface::StateValidityChecker::setCollisionCheckingDeferred(bool flag)
+{
+  defer_collision_checking_ = flag;
+}
+
+void ompl_interface::StateValidityChecker::setClearanceCachedWithValidity(bool flag)
+{
+  cache_clearance_with_validity_ = flag;
+}
+
+bool StateValidityChecker::checkCollision(const moveit::core::RobotState& robot_state,
+                                          const ModelBasedStateSpace::StateType* model_state, bool verbose) const
+{
+  collision_detection::CollisionResult res;
+  if (cache_clearance_with_validity_)
+  {
+    planning_context_->getPlanningScene()->checkCollision(
+        verbose ? collision_request_with_distance_verbose_ : collision_request_with_distance_, res, robot_state);
+    storeClearance(model_state, res);
+  }
+  else
+  {
+    planning_context_->getPlanningScene()->checkCollision(
+        verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, robot_state);
+  }
+  return !res.collision;
+}
+
+void StateValidityChecker::storeClearance(const ModelBasedStateSpace::StateType* model_state,
+                                          const collision_detection::CollisionResult& res)
+{
+  const double clearance =
+      res.collision ? 0.0 : (res.distance < 0.0 ? std::numeric_limits<double>::infinity() : res.distance);
+  const_cast<ModelBasedStateSpace::StateType*>(model_state)->markClearance(clearance);
+}
+
 bool StateValidityChecker::isValid(const ompl::base::State* state, bool verbose) const
 {
   assert(state != nullptr);
@@ -82,6 +122,9 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, bool verbose)
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
   }
 
+  // Cached results are not counted, only states that are actually checked
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::STATE_VALIDITY_CHECKS);
+
   if (!si_->satisfiesBounds(state))
   {
     if (verbose)
@@ -97,7 +140,7 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, bool verbose)
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*robot_state, verbose).satisfied)
+  if (kset && !kset->satisfied(*robot_state, verbose))
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
@@ -110,11 +153,17 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, bool verbose)
     return false;
   }
 
+  // the validity is not marked, as collisions are checked later
+  if (defer_collision_checking_)
+  {
+    return true;
+  }
+
   // check collision avoidance
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *robot_state);
-  if (!res.collision)
+  const bool collision_free = checkCollision(*robot_state, state->as<ModelBasedStateSpace::StateType>(), verbose);
+  if (const ProjectionEvaluatorLinkPose* projection = planning_context_->getLinkPoseProjection())
+    projection->storeLinkPosition(state, *robot_state);
+  if (collision_free)
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
   }
@@ -122,7 +171,7 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, bool verbose)
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
   }
-  return !res.collision;
+  return collision_free;
 }
 
 bool StateValidityChecker::isValid(const ompl::base::State* state, double& dist, bool verbose) const
@@ -136,6 +185,8 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, double& dist,
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
   }
 
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::STATE_VALIDITY_CHECKS);
+
   if (!si_->satisfiesBounds(state))
   {
     if (verbose)
@@ -169,10 +220,19 @@ bool StateValidityChecker::isValid(const ompl::base::State* state, double& dist,
     return false;
   }
 
+  if (defer_collision_checking_)
+  {
+    dist = std::numeric_limits<double>::max();
+    return true;
+  }
+
   // check collision avoidance
   collision_detection::CollisionResult res;
   planning_context_->getPlanningScene()->checkCollision(
       verbose ? collision_request_with_distance_verbose_ : collision_request_with_distance_, res, *robot_state);
+  if (const ProjectionEvaluatorLinkPose* projection = planning_context_->getLinkPoseProjection())
+    projection->storeLinkPosition(state, *robot_state);
+  storeClearance(state->as<ModelBasedStateSpace::StateType>(), res);
   dist = res.distance;
   return !res.collision;
 }
@@ -200,12 +260,23 @@ double StateValidityChecker::cost(const ompl::base::State* state) const
 double StateValidityChecker::clearance(const ompl::base::State* state) const
 {
   assert(state != nullptr);
+  return computeClearance(state, state->as<ModelBasedStateSpace::StateType>());
+}
+
+double StateValidityChecker::computeClearance(const ompl::base::State* state,
+                                              const ModelBasedStateSpace::StateType* model_state) const
+{
+  // Use cached clearance if it is available
+  if (model_state->isClearanceKnown())
+    return model_state->clearance;
+
   moveit::core::RobotState* robot_state = tss_.getStateStorage();
   planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_state, state);
 
   collision_detection::CollisionResult res;
   planning_context_->getPlanningScene()->checkCollision(collision_request_with_distance_, res, *robot_state);
-  return res.collision ? 0.0 : (res.distance < 0.0 ? std::numeric_limits<double>::infinity() : res.distance);
+  storeClearance(model_state, res);
+  return model_state->clearance;
 }
 
 /*******************************************
@@ -223,6 +294,8 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
   }
 
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::STATE_VALIDITY_CHECKS);
+
   // do not use the unwrapped state here, as satisfiesBounds expects a state of type ConstrainedStateSpace::StateType
   if (!si_->satisfiesBounds(wrapped_state))  // si_ = ompl::base::SpaceInformation
   {
@@ -237,7 +310,7 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*robot_state, verbose).satisfied)
+  if (kset && !kset->satisfied(*robot_state, verbose))
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
@@ -251,10 +324,8 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
   }
 
   // check collision avoidance
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *robot_state);
-  if (!res.collision)
+  const bool collision_free = checkCollision(*robot_state, state->as<ModelBasedStateSpace::StateType>(), verbose);
+  if (collision_free)
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
   }
@@ -262,7 +333,7 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
   }
-  return !res.collision;
+  return collision_free;
 }
 
 bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* wrapped_state, double& dist,
@@ -280,6 +351,8 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
   }
 
+  MOVEIT_PERFORMANCE_TIMER(moveit::performance_counters::STATE_VALIDITY_CHECKS);
+
   // do not use the unwrapped state here, as satisfiesBounds expects a state of type ConstrainedStateSpace::StateType
   if (!si_->satisfiesBounds(wrapped_state))  // si_ = ompl::base::SpaceInformation
   {
@@ -295,7 +368,7 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*robot_state, verbose).satisfied)
+  if (kset && !kset->satisfied(*robot_state, verbose))
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
@@ -312,7 +385,17 @@ bool ConstrainedPlanningStateValidityChecker::isValid(const ompl::base::State* w
   collision_detection::CollisionResult res;
   planning_context_->getPlanningScene()->checkCollision(
       verbose ? collision_request_with_distance_verbose_ : collision_request_with_distance_, res, *robot_state);
+  storeClearance(state->as<ModelBasedStateSpace::StateType>(), res);
   dist = res.distance;
   return !res.collision;
 }
+
+double ConstrainedPlanningStateValidityChecker::clearance(const ompl::base::State* wrapped_state) const
+{
+  assert(wrapped_state != nullptr);
+  // cache the clearance in the unwrapped state, but compute it for the wrapped one (see isValid)
+  return computeClearance(wrapped_state, wrapped_state->as<ompl::base::ConstrainedStateSpace::StateType>()
+                                             ->getState()
+                                             ->as<ModelBasedStateSpace::StateType>());
+}
 }  // namespace ompl_interface
@@ -38,11 +38,15 @@
 
 ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotModelPtr& robot_model)
   : start_state_(robot_model)
+  , state_pool_(std::make_shared<moveit::core::RobotStatePool>(robot_model, std::thread::hardware_concurrency()))
 {
   start_state_.setToDefaultValues();
 }
 
-ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state) : start_state_(start_state)
+ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state)
+  : start_state_(start_state)
+  , state_pool_(std::make_shared<moveit::core::RobotStatePool>(start_state.getRobotModel(),
+                                                               std::thread::hardware_concurrency()))
 {
 }
 
@@ -62,7 +66,9 @@ moveit::core::RobotState* ompl_interface::TSStateStorage::getStateStorage() cons
       thread_states_.find(std::this_thread::get_id());
   if (it == thread_states_.end())
   {
-    st = new moveit::core::RobotState(start_state_);
+    // per-thread states are allocated from a common slab to avoid contention on the heap
+    st = new moveit::core::RobotState(start_state_.getRobotModel(), state_pool_);
+    *st = start_state_;
     thread_states_[std::this_thread::get_id()] = st;
   }
   else
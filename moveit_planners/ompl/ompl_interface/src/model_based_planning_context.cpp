@@ -34,6 +34,9 @@
 
 /* Author: Ioan Sucan */
 
+#include <atomic>
+#include <thread>
+
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -41,15 +44,21 @@
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/detail/conservative_advancement_motion_validator.h>
+#include <moveit/ompl_interface/detail/lazy_collision_motion_validator.h>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constrained_goal_sampler.h>
 #include <moveit/ompl_interface/detail/goal_union.h>
+#include <moveit/ompl_interface/detail/clearance_objective.h>
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
+#include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space.h>
 
 #include <moveit/kinematic_constraints/utils.h>
 
 #include <moveit/utils/lexical_casts.h>
+#include <moveit/utils/thread_config.h>
+#include <moveit/utils/tracing.h>
 
 #include <ompl/config.h>
 #include <ompl/base/samplers/UniformValidStateSampler.h>
@@ -57,6 +66,7 @@
 #include <ompl/tools/config/SelfConfig.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 #include <ompl/datastructures/PDF.h>
+#include <ompl/geometric/PathHybridization.h>
 #include <ompl/base/terminationconditions/IterationTerminationCondition.h>
 #include <ompl/base/terminationconditions/CostConvergenceTerminationCondition.h>
 
@@ -79,7 +89,6 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , complete_initial_robot_state_(spec.state_space_->getRobotModel())
   , ompl_simple_setup_(spec.ompl_simple_setup_)
   , ompl_benchmark_(*ompl_simple_setup_)
-  , ompl_parallel_plan_(ompl_simple_setup_->getProblemDefinition())
   , ptc_(nullptr)
   , last_plan_time_(0.0)
   , last_simplify_time_(0.0)
@@ -93,6 +102,8 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , simplify_solutions_(true)
   , interpolate_(true)
   , hybridize_(true)
+  , simplify_asynchronously_(false)
+  , cancel_simplification_(false)
 {
   complete_initial_robot_state_.setToDefaultValues();  // avoid uninitialized memory
   complete_initial_robot_state_.update();
@@ -146,6 +157,25 @@ void ompl_interface::ModelBasedPlanningContext::configure(const rclcpp::Node::Sh
     ompl_simple_setup_->setup();
 }
 
+void ompl_interface::ModelBasedPlanningContext::warmUp(const rclcpp::Node::SharedPtr& node)
+{
+  loadConstraintApproximations(node);
+  auto it = spec_.config_.find("projection_evaluator");
+  if (it != spec_.config_.end())
+    setProjectionEvaluator(boost::trim_copy(it->second));
+  ompl_simple_setup_->getStateSpace()->setup();
+
+  // multi-query planners are kept by the allocator, so the first request reuses the roadmap allocated here
+  it = spec_.config_.find("multi_query_planning_enabled");
+  auto type_it = spec_.config_.find("type");
+  if (it != spec_.config_.end() && boost::lexical_cast<bool>(it->second) && type_it != spec_.config_.end())
+  {
+    ConfiguredPlannerAllocator allocator = spec_.planner_selector_(type_it->second);
+    if (allocator)
+      allocator(ompl_simple_setup_->getSpaceInformation(), getGroupName() + "/" + name_, spec_);
+  }
+}
+
 void ompl_interface::ModelBasedPlanningContext::setProjectionEvaluator(const std::string& peval)
 {
   if (!spec_.state_space_)
@@ -155,7 +185,42 @@ void ompl_interface::ModelBasedPlanningContext::setProjectionEvaluator(const std
   }
   ob::ProjectionEvaluatorPtr projection_eval = getProjectionEvaluator(peval);
   if (projection_eval)
+  {
     spec_.state_space_->registerDefaultProjection(projection_eval);
+    link_pose_projection_ = std::dynamic_pointer_cast<const ProjectionEvaluatorLinkPose>(projection_eval);
+  }
+}
+
+void ompl_interface::ModelBasedPlanningContext::setMotionValidator(const std::string& name)
+{
+  const ompl::base::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  if (name == "discrete")
+    si->setMotionValidator(std::make_shared<ompl::base::DiscreteMotionValidator>(si));
+  else if (name == "lazy_collision")
+  {
+    auto state_validity_checker =
+        std::dynamic_pointer_cast<StateValidityChecker>(ompl_simple_setup_->getStateValidityChecker());
+    if (spec_.constrained_state_space_ || !state_validity_checker)
+    {
+      RCLCPP_WARN(LOGGER, "%s: The lazy collision motion validator does not support constrained state spaces",
+                  name_.c_str());
+    }
+    else
+    {
+      state_validity_checker->setCollisionCheckingDeferred(true);
+      si->setMotionValidator(std::make_shared<LazyCollisionMotionValidator>(this));
+    }
+  }
+  else if (name == "conservative_advancement")
+  {
+    if (spec_.constrained_state_space_)
+      RCLCPP_WARN(LOGGER, "%s: The conservative advancement motion validator does not support constrained state spaces",
+                  name_.c_str());
+    else
+      si->setMotionValidator(std::make_shared<ConservativeAdvancementMotionValidator>(this));
+  }
+  else
+    RCLCPP_ERROR(LOGGER, "%s: Unknown motion validator '%s'", name_.c_str(), name.c_str());
 }
 
 ompl::base::ProjectionEvaluatorPtr
@@ -268,6 +333,15 @@ ompl_interface::ModelBasedPlanningContext::allocPathConstrainedSampler(const omp
       return std::make_shared<ConstrainedSampler>(this, constraint_sampler);
     }
   }
+  else if (spec_.state_sampler_allocator_)
+  {
+    ompl::base::StateSamplerPtr state_sampler = spec_.state_sampler_allocator_->alloc(this, state_space);
+    if (state_sampler)
+    {
+      RCLCPP_DEBUG(LOGGER, "%s: Allocating state sampler from plugin", name_.c_str());
+      return state_sampler;
+    }
+  }
   RCLCPP_DEBUG(LOGGER, "%s: Allocating default state sampler for state space", name_.c_str());
   return state_space->allocDefaultStateSampler();
 }
@@ -312,6 +386,23 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg.erase(it);
   }
 
+  // set the motion validator
+  it = cfg.find("motion_validator");
+  if (it != cfg.end())
+  {
+    setMotionValidator(boost::trim_copy(it->second));
+    cfg.erase(it);
+  }
+
+  // set how far interpolated work space states may deviate from the Cartesian interpolation without running IK
+  it = cfg.find("pose_interpolation_tolerance");
+  if (it != cfg.end())
+  {
+    if (auto pose_space = std::dynamic_pointer_cast<PoseModelStateSpace>(spec_.state_space_))
+      pose_space->setInterpolationTolerance(moveit::core::toDouble(it->second));
+    cfg.erase(it);
+  }
+
   if (cfg.empty())
   {
     return;
@@ -348,6 +439,10 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
       objective =
           std::make_shared<ompl::base::MaximizeMinClearanceObjective>(ompl_simple_setup_->getSpaceInformation());
     }
+    else if (optimizer == "ClearanceObjective")
+    {
+      objective = std::make_shared<ClearanceObjective>(ompl_simple_setup_->getSpaceInformation());
+    }
     else
     {
       objective =
@@ -355,6 +450,14 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     }
 
     ompl_simple_setup_->setOptimizationObjective(objective);
+
+    // clearance objectives ask for the distance of (nearly) every state, compute it with the validity check
+    if (auto state_validity_checker =
+            std::dynamic_pointer_cast<StateValidityChecker>(ompl_simple_setup_->getStateValidityChecker()))
+    {
+      state_validity_checker->setClearanceCachedWithValidity(optimizer == "ClearanceObjective" ||
+                                                             optimizer == "MaximizeMinClearanceObjective");
+    }
   }
 
   // Don't clear planner data if multi-query planning is enabled
@@ -380,6 +483,14 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg.erase(it);
   }
 
+  // check whether solutions should be simplified after they are returned
+  it = cfg.find("simplify_asynchronously");
+  if (it != cfg.end())
+  {
+    simplify_asynchronously_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+
   // check whether solution paths from parallel planning should be hybridized
   it = cfg.find("hybridize");
   if (it != cfg.end())
@@ -388,6 +499,28 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg.erase(it);
   }
 
+  // a portfolio of planner types that race each other on every request, taking turns over the planning attempts
+  portfolio_.clear();
+  it = cfg.find("portfolio");
+  if (it != cfg.end())
+  {
+    std::vector<std::string> portfolio_types;
+    boost::split(portfolio_types, it->second, boost::is_any_of(" ,"), boost::token_compress_on);
+    for (const std::string& type : portfolio_types)
+    {
+      ConfiguredPlannerAllocator allocator = type.empty() ? ConfiguredPlannerAllocator() : spec_.planner_selector_(type);
+      if (!allocator)
+        continue;
+      const std::string planner_name = getGroupName() + "/" + name_ + "/" + type;
+      portfolio_.emplace_back(type, [planner_name, &spec = this->spec_, allocator](const ob::SpaceInformationPtr& si) {
+        return allocator(si, planner_name, spec);
+      });
+    }
+    RCLCPP_INFO(LOGGER, "Planner configuration '%s' will race a portfolio of %zu planners", name_.c_str(),
+                portfolio_.size());
+    cfg.erase(it);
+  }
+
   // remove the 'type' parameter; the rest are parameters for the planner itself
   it = cfg.find("type");
   if (it == cfg.end())
@@ -437,6 +570,7 @@ void ompl_interface::ModelBasedPlanningContext::setPlanningVolume(const moveit_m
 
 void ompl_interface::ModelBasedPlanningContext::simplifySolution(double timeout)
 {
+  moveit::tracing::ScopedSpan span("OMPL simplifySolution");
   ompl::time::point start = ompl::time::now();
   ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
   registerTerminationCondition(ptc);
@@ -445,8 +579,68 @@ void ompl_interface::ModelBasedPlanningContext::simplifySolution(double timeout)
   unregisterTerminationCondition();
 }
 
+void ompl_interface::ModelBasedPlanningContext::startAsynchronousSimplification(og::PathGeometric raw_path,
+                                                                                og::PathGeometric returned_path,
+                                                                                double timeout)
+{
+  cancelSimplification();
+  cancel_simplification_ = false;
+  simplification_thread_ = std::thread([this, raw_path = std::move(raw_path), returned_path = std::move(returned_path),
+                                        timeout] {
+    // without intermediate states there is nothing to shortcut beyond the first segment
+    if (raw_path.getStateCount() < 3)
+      return;
+    const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+    ompl::time::point start = ompl::time::now();
+    ob::PlannerTerminationCondition ptc = ob::plannerOrTerminationCondition(
+        ob::timedPlannerTerminationCondition(timeout),
+        ob::PlannerTerminationCondition([this] { return cancel_simplification_.load(); }));
+
+    // the robot may be executing the first segment already, so the returned waypoints up to its end are kept
+    std::size_t prefix = 1;
+    while (prefix < returned_path.getStateCount() &&
+           !si->equalStates(returned_path.getState(prefix), raw_path.getState(1)))
+      ++prefix;
+
+    og::PathGeometric suffix(si);
+    for (std::size_t i = 1; i < raw_path.getStateCount(); ++i)
+      suffix.append(raw_path.getState(i));
+    og::PathSimplifier(si).simplify(suffix, ptc);
+    if (cancel_simplification_)
+      return;
+    if (interpolate_)
+      suffix.interpolate();
+
+    og::PathGeometric improved(si);
+    for (std::size_t i = 0; i < prefix; ++i)
+      improved.append(returned_path.getState(i));
+    improved.append(suffix);
+    RCLCPP_DEBUG(LOGGER, "%s: Simplified the solution in the background in %lf seconds, from %zu to %zu states",
+                 getName().c_str(), ompl::time::seconds(ompl::time::now() - start), returned_path.getStateCount(),
+                 improved.getStateCount());
+
+    auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(getRobotModel(), getGroupName());
+    convertPath(improved, *trajectory);
+    if (improved_solution_callback_)
+      improved_solution_callback_(trajectory);
+  });
+}
+
+void ompl_interface::ModelBasedPlanningContext::waitForSimplification()
+{
+  if (simplification_thread_.joinable())
+    simplification_thread_.join();
+}
+
+void ompl_interface::ModelBasedPlanningContext::cancelSimplification()
+{
+  cancel_simplification_ = true;
+  waitForSimplification();
+}
+
 void ompl_interface::ModelBasedPlanningContext::interpolateSolution()
 {
+  moveit::tracing::ScopedSpan span("OMPL interpolateSolution");
   if (ompl_simple_setup_->haveSolutionPath())
   {
     og::PathGeometric& pg = ompl_simple_setup_->getSolutionPath();
@@ -516,6 +710,27 @@ ompl::base::GoalPtr ompl_interface::ModelBasedPlanningContext::constructGoal()
                                                                             goal_constraint->getAllConstraints());
     }
 
+    // with an approximation of the path constraints, draw the goals from its states satisfying the goal constraints
+    if (path_constraints_ && constraints_library_)
+    {
+      const ConstraintApproximationPtr& constraint_approx =
+          constraints_library_->getConstraintApproximation(path_constraints_msg_);
+      if (constraint_approx)
+      {
+        if (auto group_states = constraint_approx->getGroupStates(this))
+        {
+          auto precomputed_sampler = std::make_shared<constraint_samplers::PrecomputedConstraintSampler>(
+              getPlanningScene(), getGroupName(), group_states, constraint_sampler);
+          if (precomputed_sampler->configure(goal_constraint->getAllConstraints()))
+          {
+            RCLCPP_DEBUG(LOGGER, "%s: Sampling goals from %zu precomputed states for constraint '%s'", name_.c_str(),
+                         precomputed_sampler->getValidStateCount(), path_constraints_msg_.name.c_str());
+            constraint_sampler = precomputed_sampler;
+          }
+        }
+      }
+    }
+
     if (constraint_sampler)
     {
       ob::GoalPtr goal = std::make_shared<ConstrainedGoalSampler>(this, goal_constraint, constraint_sampler);
@@ -617,25 +832,13 @@ void ompl_interface::ModelBasedPlanningContext::setCompleteInitialState(
 
 void ompl_interface::ModelBasedPlanningContext::clear()
 {
+  // the background simplification uses the scene and validity checker of the previous request
+  cancelSimplification();
+  // the roadmap of multi-query planners is kept and invalidated in preSolve(), once the new scene is known
   if (!multi_query_planning_enabled_)
   {
     ompl_simple_setup_->clear();
   }
-// TODO: remove when ROS Melodic and older are no longer supported
-#if OMPL_VERSION_VALUE >= 1005000
-  else
-  {
-    // For LazyPRM and LazyPRMstar we assume that the environment *could* have changed
-    // This means that we need to reset the validity flags for every node and edge in
-    // the roadmap. For PRM and PRMstar we assume that the environment is static. If
-    // this is not the case, then multi-query planning should not be enabled.
-    auto planner = dynamic_cast<ompl::geometric::LazyPRM*>(ompl_simple_setup_->getPlanner().get());
-    if (planner != nullptr)
-    {
-      planner->clearValidity();
-    }
-  }
-#endif
   ompl_simple_setup_->clearStartStates();
   ompl_simple_setup_->setGoal(ob::GoalPtr());
   ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr());
@@ -743,10 +946,67 @@ void ompl_interface::ModelBasedPlanningContext::preSolve()
   {
     planner->clear();
   }
+  else if (planner)
+  {
+    updateRoadmapValidity(planner);
+  }
   startSampling();
   ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->resetMotionCounter();
 }
 
+void ompl_interface::ModelBasedPlanningContext::updateRoadmapValidity(const ob::PlannerPtr& planner)
+{
+  const planning_scene::PlanningSceneConstPtr& scene = getPlanningScene();
+  const planning_scene::StateValidityCache::SceneVersion version{ scene->getWorldVersion(),
+                                                                  scene->getAllowedCollisionMatrixVersion(),
+                                                                  scene->getCollisionEnvVersion(),
+                                                                  scene->getStateFeasibilityVersion() };
+  const bool unchanged = roadmap_scene_version_ && *roadmap_scene_version_ == version &&
+                         roadmap_path_constraints_ == path_constraints_msg_;
+  const bool first_query = !roadmap_scene_version_;
+  roadmap_scene_version_ = version;
+  roadmap_path_constraints_ = path_constraints_msg_;
+  if (unchanged)
+  {
+    RCLCPP_DEBUG(LOGGER, "%s: Scene did not change, reusing the roadmap of the previous query", name_.c_str());
+    return;
+  }
+
+// TODO: remove when ROS Melodic and older are no longer supported
+#if OMPL_VERSION_VALUE >= 1005000
+  // For LazyPRM and LazyPRMstar it is enough to reset the validity flags for every node and edge in the roadmap,
+  // they are checked again when a path is searched
+  if (auto lazy_planner = dynamic_cast<ompl::geometric::LazyPRM*>(planner.get()))
+  {
+    RCLCPP_DEBUG(LOGGER, "%s: Scene changed, invalidating the roadmap", name_.c_str());
+    lazy_planner->clearValidity();
+    return;
+  }
+#endif
+
+  // Other planners assume that their roadmap is valid. A roadmap that was loaded or built before this context was
+  // used is kept, as it is assumed to match the environment.
+  if (!first_query)
+  {
+    RCLCPP_INFO(LOGGER, "%s: Scene changed, clearing the roadmap of the multi-query planner", name_.c_str());
+    planner->clear();
+  }
+}
+
+void ompl_interface::ModelBasedPlanningContext::storeExperience()
+{
+  auto experience_setup = std::dynamic_pointer_cast<ot::ExperienceSetup>(ompl_simple_setup_);
+  if (!experience_setup)
+    return;
+
+  // add the paths that were planned from scratch to the database and write it, if a file is configured
+  experience_setup->doPostProcessing();
+  if (!spec_.experience_database_path_.empty() && !experience_setup->saveIfChanged())
+    RCLCPP_ERROR(LOGGER, "%s: Unable to save the experience database", name_.c_str());
+  RCLCPP_DEBUG(LOGGER, "%s: Experience database holds %zu experiences", name_.c_str(),
+               experience_setup->getExperiencesCount());
+}
+
 void ompl_interface::ModelBasedPlanningContext::postSolve()
 {
   stopSampling();
@@ -770,21 +1030,40 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
   if (res.error_code_.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
   {
     double ptime = getLastPlanTime();
-    if (simplify_solutions_)
+    const bool simplify_asynchronously = simplify_solutions_ && simplify_asynchronously_;
+    if (simplify_solutions_ && !simplify_asynchronously)
     {
       simplifySolution(request_.allowed_planning_time - ptime);
       ptime += getLastSimplifyTime();
     }
 
+    if (spec_.state_sampler_allocator_)
+    {
+      spec_.state_sampler_allocator_->recordSolution(this, getOMPLSimpleSetup()->getSolutionPath());
+    }
+
+    std::optional<og::PathGeometric> raw_path;
+    if (simplify_asynchronously)
+    {
+      raw_path = getOMPLSimpleSetup()->getSolutionPath();
+    }
+
     if (interpolate_)
     {
       interpolateSolution();
     }
 
+    if (raw_path)
+    {
+      startAsynchronousSimplification(std::move(*raw_path), getOMPLSimpleSetup()->getSolutionPath(),
+                                      request_.allowed_planning_time - ptime);
+    }
+
     // fill the response
     RCLCPP_DEBUG(LOGGER, "%s: Returning successful solution with %lu states", getName().c_str(),
                  getOMPLSimpleSetup()->getSolutionPath().getStateCount());
 
+    moveit::tracing::ScopedSpan span("OMPL getSolutionPath");
     res.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(getRobotModel(), getGroupName());
     getSolutionPath(*res.trajectory_);
     res.planning_time_ = ptime;
@@ -851,12 +1130,14 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
 const moveit_msgs::msg::MoveItErrorCodes ompl_interface::ModelBasedPlanningContext::solve(double timeout,
                                                                                           unsigned int count)
 {
+  moveit::tracing::ScopedSpan span("OMPL solve");
   ompl::time::point start = ompl::time::now();
   preSolve();
 
   moveit_msgs::msg::MoveItErrorCodes result;
   result.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
-  if (count <= 1 || multi_query_planning_enabled_)  // multi-query planners should always run in single instances
+  // multi-query planners should always run in single instances, portfolios always race
+  if ((count <= 1 && portfolio_.empty()) || multi_query_planning_enabled_)
   {
     RCLCPP_DEBUG(LOGGER, "%s: Solving the planning problem once...", name_.c_str());
     ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
@@ -866,98 +1147,100 @@ const moveit_msgs::msg::MoveItErrorCodes ompl_interface::ModelBasedPlanningConte
     unregisterTerminationCondition();
     // fill the result status code
     result.val = logPlannerStatus(ompl_simple_setup_);
+    storeExperience();
   }
   else
   {
+    count = std::max<unsigned int>(count, portfolio_.size());
     RCLCPP_DEBUG(LOGGER, "%s: Solving the planning problem %u times...", name_.c_str(), count);
-    ompl_parallel_plan_.clearHybridizationPaths();
-    if (count <= max_planning_threads_)
+    ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
+    registerTerminationCondition(ptc);
+    if (solveParallel(ptc, count))
     {
-      ompl_parallel_plan_.clearPlanners();
-      if (ompl_simple_setup_->getPlannerAllocator())
-        for (unsigned int i = 0; i < count; ++i)
-        {
-          ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
-        }
-      else
-      {
-        for (unsigned int i = 0; i < count; ++i)
-        {
-          ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-        }
-      }
-
-      ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
-      registerTerminationCondition(ptc);
-      if (ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION)
-      {
-        result.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
-      }
-      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
-      unregisterTerminationCondition();
+      result.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
     }
-    else
+    last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+    unregisterTerminationCondition();
+  }
+
+  postSolve();
+  return result;
+}
+
+bool ompl_interface::ModelBasedPlanningContext::solveParallel(const ob::PlannerTerminationCondition& ptc,
+                                                              unsigned int count)
+{
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+
+  // Without hybridization the first solution ends all attempts. Otherwise all attempts run to completion, unless a
+  // solution satisfying the optimization objective was found already.
+  const bool hybridize = hybridize_;
+  const ob::PlannerTerminationCondition attempt_ptc = ob::plannerOrTerminationCondition(
+      ptc, ob::PlannerTerminationCondition(
+               [&pdef, hybridize] { return pdef->hasExactSolution() && (!hybridize || pdef->hasOptimizedSolution()); },
+               0.01));
+
+  // Workers pick up the next attempt as soon as their previous one finished, so no thread waits for a whole round
+  std::atomic<unsigned int> next_attempt{ 0 };
+  std::atomic<unsigned int> finished_attempts{ 0 };
+  const auto run_attempts = [&] {
+    unsigned int attempt;
+    while (!attempt_ptc() && (attempt = next_attempt++) < count)
     {
-      ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
-      registerTerminationCondition(ptc);
-      int n = count / max_planning_threads_;
-      result.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
-      for (int i = 0; i < n && !ptc(); ++i)
-      {
-        ompl_parallel_plan_.clearPlanners();
-        if (ompl_simple_setup_->getPlannerAllocator())
-        {
-          for (unsigned int i = 0; i < max_planning_threads_; ++i)
-          {
-            ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
-          }
-        }
-        else
-        {
-          for (unsigned int i = 0; i < max_planning_threads_; ++i)
-          {
-            ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-          }
-        }
+      ob::PlannerPtr planner;
+      if (!portfolio_.empty())
+        planner = portfolio_[attempt % portfolio_.size()].second(si);
+      else if (ompl_simple_setup_->getPlannerAllocator())
+        planner = ompl_simple_setup_->getPlannerAllocator()(si);
+      else
+        planner = ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal());
+      planner->setProblemDefinition(pdef);
+      if (!planner->isSetup())
+        planner->setup();
+      std::ignore = planner->solve(attempt_ptc);
+      ++finished_attempts;
+    }
+  };
 
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-        // Was this latest call successful too?
-        result.val = (result.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS && r) ?
-                         moveit_msgs::msg::MoveItErrorCodes::SUCCESS :
-                         moveit_msgs::msg::MoveItErrorCodes::FAILURE;
-      }
-      n = count % max_planning_threads_;
-      if (n && !ptc())
-      {
-        ompl_parallel_plan_.clearPlanners();
-        if (ompl_simple_setup_->getPlannerAllocator())
-        {
-          for (int i = 0; i < n; ++i)
-          {
-            ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
-          }
-        }
-        else
-        {
-          for (int i = 0; i < n; ++i)
-          {
-            ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-          }
-        }
+  std::vector<std::thread> workers;
+  const unsigned int worker_count = std::min(count, std::max(max_planning_threads_, 1u));
+  workers.reserve(worker_count - 1);
+  for (unsigned int i = 1; i < worker_count; ++i)
+  {
+    workers.emplace_back([&run_attempts] {
+      moveit::threads::configureCurrentThread("ompl_planner");
+      run_attempts();
+    });
+  }
+  run_attempts();
+  for (std::thread& worker : workers)
+    worker.join();
+  RCLCPP_DEBUG(LOGGER, "%s: Finished %u of %u planning attempts in %u threads", name_.c_str(),
+               finished_attempts.load(), count, worker_count);
 
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-        // Was this latest call successful too?
-        result.val = (result.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS && r) ?
-                         moveit_msgs::msg::MoveItErrorCodes::SUCCESS :
-                         moveit_msgs::msg::MoveItErrorCodes::FAILURE;
-      }
-      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
-      unregisterTerminationCondition();
+  if (hybridize_ && pdef->getSolutionCount() > 1)
+  {
+    og::PathHybridization hybridization(si);
+    for (const ob::PlannerSolution& solution : pdef->getSolutions())
+    {
+      if (!solution.approximate_)
+        hybridization.recordPath(solution.path_, false);
     }
+    hybridization.computeHybridPath();
+    const auto& hybrid_path = hybridization.getHybridPath();
+    if (hybrid_path)
+      pdef->addSolutionPath(hybrid_path, false, 0.0, "Hybrid");
   }
 
-  postSolve();
-  return result;
+  if (!portfolio_.empty() && pdef->hasExactSolution())
+  {
+    const std::string& winner = pdef->getSolutions().front().plannerName_;
+    const unsigned int wins = ++portfolio_wins_[winner];
+    RCLCPP_INFO(LOGGER, "%s: Best solution found by '%s', which won %u times so far", name_.c_str(), winner.c_str(),
+                wins);
+  }
+  return pdef->hasExactSolution();
 }
 
 void ompl_interface::ModelBasedPlanningContext::registerTerminationCondition(const ob::PlannerTerminationCondition& ptc)
@@ -40,6 +40,7 @@
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
 
 #include <moveit/utils/lexical_casts.h>
+#include <moveit/utils/thread_config.h>
 #include <fstream>
 
 namespace ompl_interface
@@ -56,6 +57,7 @@ OMPLInterface::OMPLInterface(const moveit::core::RobotModelConstPtr& robot_model
   , use_constraints_approximations_(true)
 {
   RCLCPP_DEBUG(LOGGER, "Initializing OMPL interface using ROS parameters");
+  moveit::threads::loadThreadConfigs(node_);
   loadPlannerConfigurations();
   loadConstraintSamplers();
 }
@@ -71,14 +73,20 @@ OMPLInterface::OMPLInterface(const moveit::core::RobotModelConstPtr& robot_model
   , use_constraints_approximations_(true)
 {
   RCLCPP_DEBUG(LOGGER, "Initializing OMPL interface using specified configuration");
+  if (node_)
+    moveit::threads::loadThreadConfigs(node_);
   setPlannerConfigurations(pconfig);
   loadConstraintSamplers();
 }
 
-OMPLInterface::~OMPLInterface() = default;
+OMPLInterface::~OMPLInterface()
+{
+  waitForPrewarming();
+}
 
 void OMPLInterface::setPlannerConfigurations(const planning_interface::PlannerConfigurationMap& pconfig)
 {
+  waitForPrewarming();
   planning_interface::PlannerConfigurationMap pconfig2 = pconfig;
 
   // construct default configurations for planning groups that don't have configs already passed in
@@ -93,6 +101,37 @@ void OMPLInterface::setPlannerConfigurations(const planning_interface::PlannerCo
   }
 
   context_manager_.setPlannerConfigurations(pconfig2);
+  loadStateSamplers();
+}
+
+void OMPLInterface::loadStateSamplers()
+{
+  for (const auto& [name, config_settings] : context_manager_.getPlannerConfigurations())
+  {
+    auto it = config_settings.config.find("state_sampler");
+    if (it == config_settings.config.end() ||
+        context_manager_.getRegisteredStateSamplerAllocators().count(it->second) > 0)
+      continue;
+
+    try
+    {
+      if (!state_sampler_loader_)
+        state_sampler_loader_ = std::make_unique<pluginlib::ClassLoader<StateSamplerAllocator>>(
+            "moveit_planners_ompl", "ompl_interface::StateSamplerAllocator");
+      StateSamplerAllocatorPtr allocator = state_sampler_loader_->createUniqueInstance(it->second);
+      if (!allocator->initialize(node_, parameter_namespace_))
+      {
+        RCLCPP_ERROR(LOGGER, "Unable to initialize state sampler plugin '%s'", it->second.c_str());
+        continue;
+      }
+      context_manager_.registerStateSamplerAllocator(it->second, allocator);
+      RCLCPP_INFO(LOGGER, "Loaded state sampler plugin '%s'", it->second.c_str());
+    }
+    catch (pluginlib::PluginlibException& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Exception while loading state sampler plugin '%s': %s", it->second.c_str(), ex.what());
+    }
+  }
 }
 
 ModelBasedPlanningContextPtr
@@ -108,6 +147,7 @@ OMPLInterface::getPlanningContext(const planning_scene::PlanningSceneConstPtr& p
                                   const planning_interface::MotionPlanRequest& req,
                                   moveit_msgs::msg::MoveItErrorCodes& error_code) const
 {
+  waitForPrewarming();
   ModelBasedPlanningContextPtr ctx =
       context_manager_.getPlanningContext(planning_scene, req, error_code, node_, use_constraints_approximations_);
   return ctx;
@@ -162,7 +202,10 @@ void OMPLInterface::loadPlannerConfigurations()
     // with their expected parameter type
     static const std::pair<std::string, rclcpp::ParameterType> KNOWN_GROUP_PARAMS[] = {
       { "projection_evaluator", rclcpp::ParameterType::PARAMETER_STRING },
+      { "motion_validator", rclcpp::ParameterType::PARAMETER_STRING },
+      { "state_sampler", rclcpp::ParameterType::PARAMETER_STRING },
       { "longest_valid_segment_fraction", rclcpp::ParameterType::PARAMETER_DOUBLE },
+      { "pose_interpolation_tolerance", rclcpp::ParameterType::PARAMETER_DOUBLE },
       { "enforce_joint_model_state_space", rclcpp::ParameterType::PARAMETER_BOOL },
       { "enforce_constrained_state_space", rclcpp::ParameterType::PARAMETER_BOOL }
     };
@@ -246,6 +289,28 @@ void OMPLInterface::loadPlannerConfigurations()
   setPlannerConfigurations(pconfig);
 }
 
+void OMPLInterface::prewarmPlanningContexts(const std::vector<std::string>& config_names)
+{
+  waitForPrewarming();
+  std::lock_guard<std::mutex> lock(prewarm_lock_);
+  prewarm_thread_ = std::thread([this, config_names] {
+    rclcpp::Clock clock;
+    const rclcpp::Time start = clock.now();
+    std::size_t count = 0;
+    for (const std::string& config_name : config_names)
+      if (context_manager_.prewarmPlanningContext(config_name, node_))
+        ++count;
+    RCLCPP_INFO(LOGGER, "Pre-warmed %zu planning contexts in %lf seconds", count, (clock.now() - start).seconds());
+  });
+}
+
+void OMPLInterface::waitForPrewarming() const
+{
+  std::lock_guard<std::mutex> lock(prewarm_lock_);
+  if (prewarm_thread_.joinable())
+    prewarm_thread_.join();
+}
+
 void OMPLInterface::printStatus()
 {
   RCLCPP_INFO(LOGGER, "OMPL ROS interface is running.");
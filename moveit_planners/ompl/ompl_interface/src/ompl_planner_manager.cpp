@@ -88,6 +88,12 @@ public:
   {
     ompl_interface_ = std::make_unique<OMPLInterface>(model, node, parameter_namespace);
     setPlannerConfigurations(ompl_interface_->getPlannerConfigurations());
+
+    // planner configurations ("group" or "group[planner_id]") whose planning contexts are constructed at startup
+    std::vector<std::string> prewarm_configs;
+    if (node->get_parameter(parameter_namespace + ".prewarm_planning_contexts", prewarm_configs) &&
+        !prewarm_configs.empty())
+      ompl_interface_->prewarmPlanningContexts(prewarm_configs);
     return true;
   }
 
@@ -126,6 +132,11 @@ public:
     edges = data.numEdges();
   }
 
+  moveit::MemoryUsage getMemoryUsage() const override
+  {
+    return ompl_interface_->getPlanningContextManager().getMemoryUsage();
+  }
+
   void setPlannerConfigurations(const planning_interface::PlannerConfigurationMap& pconfig) override
   {
     // this call can add a few more configs than we pass in (adds defaults)
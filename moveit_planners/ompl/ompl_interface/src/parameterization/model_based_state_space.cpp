@@ -121,6 +121,7 @@ void ompl_interface::ModelBasedStateSpace::copyState(ompl::base::State* destinat
   destination->as<StateType>()->tag = source->as<StateType>()->tag;
   destination->as<StateType>()->flags = source->as<StateType>()->flags;
   destination->as<StateType>()->distance = source->as<StateType>()->distance;
+  destination->as<StateType>()->clearance = source->as<StateType>()->clearance;
 }
 
 unsigned int ompl_interface::ModelBasedStateSpace::getSerializationLength() const
@@ -37,11 +37,36 @@
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <utility>
 
 namespace ompl_interface
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.pose_model_state_space");
+
+namespace
+{
+/** \brief Results of the interpolations of the last edge interpolated on this thread. Motion validators and path
+    interpolation interpolate the same edges repeatedly, with IK being the expensive part. */
+struct InterpolationCache
+{
+  struct Result
+  {
+    std::vector<double> values;
+    int flags;
+  };
+
+  const ompl::base::StateSpace* space = nullptr;
+  std::vector<double> from, to;
+  std::map<double, Result> results;
+};
+thread_local InterpolationCache interpolation_cache;
+const std::size_t MAX_CACHED_INTERPOLATIONS = 256;
+}  // namespace
 }  // namespace ompl_interface
 
 const std::string ompl_interface::PoseModelStateSpace::PARAMETERIZATION_TYPE = "PoseModel";
@@ -50,6 +75,7 @@ ompl_interface::PoseModelStateSpace::PoseModelStateSpace(const ModelBasedStateSp
   : ModelBasedStateSpace(spec)
 {
   jump_factor_ = 3;  // \todo make this a param
+  interpolation_tolerance_ = 1e-3;
 
   if (spec.joint_model_group_->getGroupKinematics().first)
     poses_.emplace_back(spec.joint_model_group_, spec.joint_model_group_->getGroupKinematics().first);
@@ -129,29 +155,98 @@ void ompl_interface::PoseModelStateSpace::interpolate(const ompl::base::State* f
 {
   // we want to interpolate in Cartesian space; we do not have a guarantee that from and to
   // have their poses computed, but this is very unlikely to happen (depends how the planner gets its input states)
+  const StateType* from_state = from->as<StateType>();
+  const StateType* to_state = to->as<StateType>();
+  StateType* result = state->as<StateType>();
+
+  // the joint values of the endpoints identify the edge, if they are known
+  InterpolationCache& cache = interpolation_cache;
+  const bool cacheable = from_state->jointsComputed() && to_state->jointsComputed();
+  const auto same_values = [this](const StateType* s, const std::vector<double>& values) {
+    return std::equal(s->values, s->values + variable_count_, values.begin());
+  };
+  if (cacheable && (cache.space != this || !same_values(from_state, cache.from) || !same_values(to_state, cache.to)))
+  {
+    cache.space = this;
+    cache.from.assign(from_state->values, from_state->values + variable_count_);
+    cache.to.assign(to_state->values, to_state->values + variable_count_);
+    cache.results.clear();
+  }
 
   // interpolate in joint space
   ModelBasedStateSpace::interpolate(from, to, t, state);
 
-  // interpolate SE3 components
-  for (std::size_t i = 0; i < poses_.size(); ++i)
-    poses_[i].state_space_->interpolate(from->as<StateType>()->poses[i], to->as<StateType>()->poses[i], t,
-                                        state->as<StateType>()->poses[i]);
+  const auto interpolate_poses = [&] {
+    // interpolate SE3 components
+    for (std::size_t i = 0; i < poses_.size(); ++i)
+      poses_[i].state_space_->interpolate(from_state->poses[i], to_state->poses[i], t, result->poses[i]);
 
-  // the call above may reset all flags for state; but we know the pose we want flag should be set
-  state->as<StateType>()->setPoseComputed(true);
+    // the call above may reset all flags for state; but we know the pose we want flag should be set
+    result->setPoseComputed(true);
+  };
+  interpolate_poses();
 
-  /*
-  std::cout << "*********** interpolate\n";
-  printState(from, std::cout);
-  printState(to, std::cout);
-  printState(state, std::cout);
-  std::cout << "\n\n";
-  */
+  if (cacheable)
+  {
+    auto cached = cache.results.find(t);
+    if (cached != cache.results.end())
+    {
+      std::copy(cached->second.values.begin(), cached->second.values.end(), result->values);
+      result->flags = cached->second.flags;
+      return;
+    }
+  }
+
+  const auto store_result = [&] {
+    if (!cacheable)
+      return;
+    if (cache.results.size() >= MAX_CACHED_INTERPOLATIONS)
+      cache.results.clear();
+    cache.results[t] = { std::vector<double>(result->values, result->values + variable_count_), result->flags };
+  };
 
-  // after interpolation we cannot be sure about the joint values (we use them as seed only)
-  // so we recompute IK if needed
-  if (computeStateIK(state))
+  // when the joint space interpolation stays close enough to the Cartesian one, IK is not needed
+  if (interpolation_tolerance_ > 0.0)
+  {
+    if (jointInterpolationWithinTolerance(result))
+    {
+      result->setJointsComputed(true);
+      store_result();
+      return;
+    }
+    interpolate_poses();
+  }
+
+  // after interpolation we cannot be sure about the joint values (we use them as seed only), so we recompute IK;
+  // the solution of the closest interpolation already computed on this edge is the best seed
+  if (cacheable && !cache.results.empty())
+  {
+    const InterpolationCache::Result* seed = nullptr;
+    double seed_distance = std::numeric_limits<double>::infinity();
+    auto next = cache.results.lower_bound(t);
+    if (next != cache.results.end())
+    {
+      seed = &next->second;
+      seed_distance = next->first - t;
+    }
+    if (next != cache.results.begin() && t - std::prev(next)->first < seed_distance)
+      seed = &std::prev(next)->second;
+    if (seed && (seed->flags & StateType::VALIDITY_TRUE))
+      std::copy(seed->values.begin(), seed->values.end(), result->values);
+  }
+
+  bool solved = computeStateIK(state);
+  if (!solved)
+  {
+    // retry from the endpoint closer to the interpolated state
+    const StateType* seed = t < 0.5 ? from_state : to_state;
+    std::copy(seed->values, seed->values + variable_count_, result->values);
+    result->clearKnownInformation();
+    result->setPoseComputed(true);
+    solved = computeStateIK(state);
+  }
+
+  if (solved)
   {
     double dj = jump_factor_ * ModelBasedStateSpace::distance(from, to);
     double d_from = ModelBasedStateSpace::distance(from, state);
@@ -159,8 +254,30 @@ void ompl_interface::PoseModelStateSpace::interpolate(const ompl::base::State* f
 
     // if the joint value jumped too much
     if (d_from + d_to > std::max(0.2, dj))  // \todo make 0.2 a param
-      state->as<StateType>()->markInvalid();
+      result->markInvalid();
   }
+  store_result();
+}
+
+bool ompl_interface::PoseModelStateSpace::jointInterpolationWithinTolerance(StateType* state) const
+{
+  for (std::size_t i = 0; i < poses_.size(); ++i)
+  {
+    const ompl::base::SE3StateSpace::StateType* se3_state = state->poses[i];
+    const Eigen::Vector3d position(se3_state->getX(), se3_state->getY(), se3_state->getZ());
+    const ompl::base::SO3StateSpace::StateType& so3_state = se3_state->rotation();
+    const Eigen::Quaterniond orientation(so3_state.w, so3_state.x, so3_state.y, so3_state.z);
+
+    // replaces the interpolated pose by the one reached by the joint values
+    if (!poses_[i].computeStateFK(state, i))
+      return false;
+
+    const Eigen::Vector3d fk_position(se3_state->getX(), se3_state->getY(), se3_state->getZ());
+    const Eigen::Quaterniond fk_orientation(so3_state.w, so3_state.x, so3_state.y, so3_state.z);
+    if ((fk_position - position).norm() + fk_orientation.angularDistance(orientation) > interpolation_tolerance_)
+      return false;
+  }
+  return true;
 }
 
 void ompl_interface::PoseModelStateSpace::setPlanningVolume(double minX, double maxX, double minY, double maxY,
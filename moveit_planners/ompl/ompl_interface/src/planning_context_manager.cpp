@@ -37,6 +37,9 @@
 #include <moveit/ompl_interface/planning_context_manager.h>
 #include <moveit/robot_state/conversions.h>
 
+#include <boost/algorithm/string/trim.hpp>
+
+#include <type_traits>
 #include <utility>
 
 #include <ompl/geometric/planners/AnytimePathShortening.h>
@@ -68,9 +71,17 @@
 #include <ompl/geometric/planners/prm/SPARStwo.h>
 #include <ompl/geometric/planners/prm/PRMcustom.h>
 
+#include <ompl/datastructures/NearestNeighborsGNAT.h>
+#include <ompl/datastructures/NearestNeighborsGNATNoThreadSafety.h>
+#include <ompl/datastructures/NearestNeighborsLinear.h>
+#include <ompl/datastructures/NearestNeighborsSqrtApprox.h>
+
 #include <ompl/base/ConstrainedSpaceInformation.h>
 #include <ompl/base/spaces/constraint/ProjectedStateSpace.h>
 
+#include <ompl/tools/lightning/Lightning.h>
+#include <ompl/tools/thunder/Thunder.h>
+
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space_factory.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
 #include <moveit/ompl_interface/parameterization/joint_space/constrained_planning_state_space_factory.h>
@@ -90,6 +101,43 @@ struct PlanningContextManager::CachedContexts
   std::mutex lock_;
 };
 
+namespace
+{
+// Planners that keep their motions in a nearest neighbors structure expose a setNearestNeighbors<NN>() template
+template <typename T, typename = void>
+struct HasNearestNeighbors : std::false_type
+{
+};
+template <typename T>
+struct HasNearestNeighbors<
+    T, std::void_t<decltype(std::declval<T&>().template setNearestNeighbors<ompl::NearestNeighborsLinear>())>>
+  : std::true_type
+{
+};
+
+template <typename T>
+void setNearestNeighbors(T& planner, const std::string& type)
+{
+  if constexpr (HasNearestNeighbors<T>::value)
+  {
+    // GNAT supports arbitrary metrics, so it works with the weighted joint distance of ModelBasedStateSpace
+    if (type == "gnat")
+      planner.template setNearestNeighbors<ompl::NearestNeighborsGNAT>();
+    else if (type == "gnat_no_thread_safety")
+      planner.template setNearestNeighbors<ompl::NearestNeighborsGNATNoThreadSafety>();
+    else if (type == "sqrt_approx")
+      planner.template setNearestNeighbors<ompl::NearestNeighborsSqrtApprox>();
+    else if (type == "linear")
+      planner.template setNearestNeighbors<ompl::NearestNeighborsLinear>();
+    else
+      RCLCPP_ERROR(LOGGER, "%s: Unknown nearest neighbors structure '%s'", planner.getName().c_str(), type.c_str());
+  }
+  else
+    RCLCPP_WARN(LOGGER, "%s: The planner does not support choosing the nearest neighbors structure",
+                planner.getName().c_str());
+}
+}  // namespace
+
 MultiQueryPlannerAllocator::~MultiQueryPlannerAllocator()
 {
   // Store all planner data
@@ -103,6 +151,22 @@ MultiQueryPlannerAllocator::~MultiQueryPlannerAllocator()
   }
 }
 
+moveit::MemoryUsage MultiQueryPlannerAllocator::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  for (const auto& [name, planner] : planners_)
+  {
+    const ob::SpaceInformationPtr& si = planner->getSpaceInformation();
+    ob::PlannerData data(si);
+    planner->getPlannerData(data);
+    // the planner data only references the states of the planner, their size is approximated by the serialized size
+    const std::size_t vertex_bytes = si->getStateSpace()->getSerializationLength() + sizeof(ob::PlannerDataVertex);
+    const std::size_t edge_bytes = sizeof(ob::PlannerDataEdge) + sizeof(ob::Cost) + 2 * sizeof(unsigned int);
+    usage.add(name, data.numVertices() * vertex_bytes + data.numEdges() * edge_bytes, data.numVertices());
+  }
+  return usage;
+}
+
 template <typename T>
 ompl::base::PlannerPtr MultiQueryPlannerAllocator::allocatePlanner(const ob::SpaceInformationPtr& si,
                                                                    const std::string& new_name,
@@ -194,6 +258,7 @@ MultiQueryPlannerAllocator::allocatePlannerImpl(const ob::SpaceInformationPtr& s
     }
   }
 
+  bool restored = planner != nullptr;
   if (!planner)
   {
     planner = std::make_shared<T>(si);
@@ -204,6 +269,13 @@ MultiQueryPlannerAllocator::allocatePlannerImpl(const ob::SpaceInformationPtr& s
     planner->setName(new_name);
   }
 
+  // Replacing the nearest neighbors structure clears the planner, so it is only done for planners without loaded data
+  auto nn_it = spec.config_.find("nearest_neighbors");
+  if (nn_it != spec.config_.end() && !restored)
+  {
+    setNearestNeighbors(static_cast<T&>(*planner), boost::trim_copy(nn_it->second));
+  }
+
   planner->params().setParams(spec.config_, true);
   //  Remember which planner instances to store when the destructor is called
   if (store_planner_data)
@@ -329,6 +401,23 @@ void PlanningContextManager::registerDefaultStateSpaces()
   registerStateSpaceFactory(std::make_shared<ConstrainedPlanningStateSpaceFactory>());
 }
 
+moveit::MemoryUsage PlanningContextManager::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  {
+    std::lock_guard<std::mutex> slock(cached_contexts_->lock_);
+    for (const auto& [key, contexts] : cached_contexts_->contexts_)
+    {
+      std::size_t bytes = 0;
+      for (const ModelBasedPlanningContextPtr& context : contexts)
+        bytes += sizeof(ModelBasedPlanningContext) + context->getCompleteInitialRobotState().getMemoryUsage();
+      usage.add("cached_contexts", bytes, contexts.size());
+    }
+  }
+  usage.add("multi_query_planners", planner_allocator_.getMemoryUsage());
+  return usage;
+}
+
 ConfiguredPlannerSelector PlanningContextManager::getPlannerSelector() const
 {
   return [this](const std::string& planner) { return plannerSelector(planner); };
@@ -339,6 +428,53 @@ void PlanningContextManager::setPlannerConfigurations(const planning_interface::
   planner_configs_ = pconfig;
 }
 
+og::SimpleSetupPtr PlanningContextManager::allocateSimpleSetup(ModelBasedPlanningContextSpecification& context_spec) const
+{
+  // Experience-based planning recalls and repairs paths from a database of previous solutions, the parameter
+  // 'experience_planning' selects the type of database (lightning or thunder) and 'experience_database_path' the file
+  // it is loaded from and saved to. Instances sharing the file load each other's experiences on startup.
+  auto it = context_spec.config_.find("experience_planning");
+  if (it == context_spec.config_.end())
+    return std::make_shared<og::SimpleSetup>(context_spec.state_space_);
+
+  const std::string experience_planning = it->second;
+  context_spec.config_.erase(it);
+  std::string& database_path = context_spec.experience_database_path_;
+  it = context_spec.config_.find("experience_database_path");
+  if (it != context_spec.config_.end())
+  {
+    database_path = it->second;
+    context_spec.config_.erase(it);
+  }
+
+  std::shared_ptr<ot::ExperienceSetup> experience_setup;
+  if (experience_planning == "lightning")
+  {
+    experience_setup = std::make_shared<ot::Lightning>(context_spec.state_space_);
+  }
+  else if (experience_planning == "thunder")
+  {
+    experience_setup = std::make_shared<ot::Thunder>(context_spec.state_space_);
+  }
+  else
+  {
+    RCLCPP_ERROR(LOGGER, "Unknown experience planning type '%s', planning without experience",
+                 experience_planning.c_str());
+    return std::make_shared<og::SimpleSetup>(context_spec.state_space_);
+  }
+
+  if (database_path.empty())
+  {
+    RCLCPP_WARN(LOGGER, "No 'experience_database_path' set, experiences are not kept across restarts");
+  }
+  else
+  {
+    experience_setup->setFilePath(database_path);
+  }
+  RCLCPP_INFO(LOGGER, "Using %s experience database '%s'", experience_planning.c_str(), database_path.c_str());
+  return experience_setup;
+}
+
 ModelBasedPlanningContextPtr
 PlanningContextManager::getPlanningContext(const planning_interface::PlannerConfigurationSettings& config,
                                            const ModelBasedStateSpaceFactoryPtr& factory,
@@ -372,6 +508,18 @@ PlanningContextManager::getPlanningContext(const planning_interface::PlannerConf
     context_spec.constraint_sampler_manager_ = constraint_sampler_manager_;
     context_spec.state_space_ = factory->getNewStateSpace(space_spec);
 
+    auto state_sampler_it = context_spec.config_.find("state_sampler");
+    if (state_sampler_it != context_spec.config_.end())
+    {
+      auto allocator_it = state_sampler_allocators_.find(state_sampler_it->second);
+      if (allocator_it != state_sampler_allocators_.end())
+        context_spec.state_sampler_allocator_ = allocator_it->second;
+      else
+        RCLCPP_ERROR(LOGGER, "State sampler plugin '%s' is not loaded, using the default sampler",
+                     state_sampler_it->second.c_str());
+      context_spec.config_.erase(state_sampler_it);
+    }
+
     if (factory->getType() == ConstrainedPlanningStateSpace::PARAMETERIZATION_TYPE)
     {
       RCLCPP_DEBUG_STREAM(LOGGER, "planning_context_manager: Using OMPL's constrained state space for planning.");
@@ -394,7 +542,7 @@ PlanningContextManager::getPlanningContext(const planning_interface::PlannerConf
     else
     {
       // Choose the correct simple setup type to load
-      context_spec.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(context_spec.state_space_);
+      context_spec.ompl_simple_setup_ = allocateSimpleSetup(context_spec);
     }
 
     RCLCPP_DEBUG(LOGGER, "Creating new planning context");
@@ -609,4 +757,40 @@ ModelBasedPlanningContextPtr PlanningContextManager::getPlanningContext(
 
   return context;
 }
+
+bool PlanningContextManager::prewarmPlanningContext(const std::string& config_name,
+                                                    const rclcpp::Node::SharedPtr& node) const
+{
+  auto pc = planner_configs_.find(config_name);
+  if (pc == planner_configs_.end())
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot pre-warm unknown planning configuration '%s'", config_name.c_str());
+    return false;
+  }
+
+  // requests without path constraints select the same state space as an empty request
+  moveit_msgs::msg::MotionPlanRequest req;
+  req.group_name = pc->second.group;
+  auto joint_space_planning_iterator = pc->second.config.find("enforce_joint_model_state_space");
+  const ModelBasedStateSpaceFactoryPtr& factory =
+      joint_space_planning_iterator != pc->second.config.end() &&
+              boost::lexical_cast<bool>(joint_space_planning_iterator->second) ?
+          getStateSpaceFactory(JointModelStateSpace::PARAMETERIZATION_TYPE) :
+          getStateSpaceFactory(pc->second.group, req);
+  if (!factory)
+    return false;
+
+  try
+  {
+    ModelBasedPlanningContextPtr context = getPlanningContext(pc->second, factory, req);
+    context->warmUp(node);
+    RCLCPP_DEBUG(LOGGER, "Pre-warmed planning context '%s'", config_name.c_str());
+  }
+  catch (ompl::Exception& ex)
+  {
+    RCLCPP_ERROR(LOGGER, "OMPL encountered an error while pre-warming '%s': %s", config_name.c_str(), ex.what());
+    return false;
+  }
+  return true;
+}
 }  // namespace ompl_interface
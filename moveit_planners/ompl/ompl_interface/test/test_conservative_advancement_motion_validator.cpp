@@ -0,0 +1,223 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/** This test checks the ConservativeAdvancementMotionValidator and the LazyCollisionMotionValidator:
+ *    - The swept distance bound is an upper bound on the motion of the robot links.
+ *    - Free and colliding motions are classified like the discrete validator does.
+ *    - With deferred collision checking, colliding states are only rejected by the lazy motion validator.
+ **/
+
+#include "load_test_robot.h"
+
+#include <gtest/gtest.h>
+
+#include <moveit/ompl_interface/detail/conservative_advancement_motion_validator.h>
+#include <moveit/ompl_interface/detail/lazy_collision_motion_validator.h>
+#include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <ompl/base/DiscreteMotionValidator.h>
+#include <ompl/geometric/SimpleSetup.h>
+
+class PandaMotionValidator : public ompl_interface_testing::LoadTestRobot, public testing::Test
+{
+protected:
+  PandaMotionValidator() : LoadTestRobot("panda", "panda_arm")
+  {
+  }
+
+  void SetUp() override
+  {
+    ompl_interface::ModelBasedStateSpaceSpecification space_spec(robot_model_, group_name_);
+    state_space_ = std::make_shared<ompl_interface::JointModelStateSpace>(space_spec);
+    state_space_->computeLocations();
+
+    planning_context_spec_.state_space_ = state_space_;
+    planning_context_spec_.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(state_space_);
+    planning_context_ =
+        std::make_shared<ompl_interface::ModelBasedPlanningContext>(group_name_, planning_context_spec_);
+
+    planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    planning_context_->setPlanningScene(planning_scene_);
+    moveit::core::RobotState start_state(robot_model_);
+    start_state.setToDefaultValues();
+    planning_context_->setCompleteInitialState(start_state);
+
+    const ompl::base::SpaceInformationPtr& si = planning_context_->getOMPLSimpleSetup()->getSpaceInformation();
+    si->setStateValidityChecker(std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get()));
+    si->setup();
+  }
+
+  /** \brief Set \e state to the panda "ready" state rotated about the first joint by \e joint1 */
+  void setReadyState(ompl::base::State* state, double joint1)
+  {
+    robot_state_->setJointGroupPositions(joint_model_group_, { joint1, -0.785, 0., -2.356, 0., 1.571, 0.785 });
+    robot_state_->update();
+    state_space_->copyToOMPLState(state, *robot_state_);
+  }
+
+  ompl_interface::ModelBasedStateSpacePtr state_space_;
+  ompl_interface::ModelBasedPlanningContextSpecification planning_context_spec_;
+  ompl_interface::ModelBasedPlanningContextPtr planning_context_;
+  planning_scene::PlanningScenePtr planning_scene_;
+};
+
+TEST_F(PandaMotionValidator, SweptDistanceBound)
+{
+  ompl_interface::ConservativeAdvancementMotionValidator validator(planning_context_.get());
+  ASSERT_TRUE(validator.isConservativeAdvancementEnabled());
+
+  ompl::base::ScopedState<> s1(state_space_), s2(state_space_), s(state_space_);
+  moveit::core::RobotState from(robot_model_), to(robot_model_);
+  for (std::size_t i = 0; i < 50; ++i)
+  {
+    s1.random();
+    s2.random();
+    const double bound = validator.getSweptDistanceBound(s1.get(), s2.get());
+
+    // no link origin may move further than the bound between two states of a fine subdivision of the motion
+    static const std::size_t STEPS = 20;
+    state_space_->copyToRobotState(from, s1.get());
+    for (std::size_t k = 1; k <= STEPS; ++k)
+    {
+      state_space_->interpolate(s1.get(), s2.get(), static_cast<double>(k) / STEPS, s.get());
+      state_space_->copyToRobotState(to, s.get());
+      for (const moveit::core::LinkModel* link : joint_model_group_->getUpdatedLinkModelsWithGeometry())
+      {
+        const double moved =
+            (to.getGlobalLinkTransform(link).translation() - from.getGlobalLinkTransform(link).translation()).norm();
+        EXPECT_LE(moved, bound / STEPS + 1e-9) << link->getName();
+      }
+      from = to;
+    }
+  }
+}
+
+TEST_F(PandaMotionValidator, CheckMotion)
+{
+  const ompl::base::SpaceInformationPtr& si = planning_context_->getOMPLSimpleSetup()->getSpaceInformation();
+  ompl_interface::ConservativeAdvancementMotionValidator validator(planning_context_.get());
+  ompl::base::DiscreteMotionValidator discrete_validator(si);
+
+  ompl::base::ScopedState<> s1(state_space_), s2(state_space_);
+  setReadyState(s1.get(), -1.5);
+  setReadyState(s2.get(), 1.5);
+
+  EXPECT_TRUE(discrete_validator.checkMotion(s1.get(), s2.get()));
+  EXPECT_TRUE(validator.checkMotion(s1.get(), s2.get()));
+
+  // place a box where the hand passes in the middle of the motion
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model_->getModelFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 0.2, 0.2, 0.2 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].position.x = 0.35;
+  co.primitive_poses[0].position.z = 0.5;
+  co.primitive_poses[0].orientation.w = 1.0;
+  planning_scene_->processCollisionObjectMsg(co);
+
+  // the end states are still valid, only the motion is not
+  s1->as<ompl_interface::ModelBasedStateSpace::StateType>()->clearKnownInformation();
+  s2->as<ompl_interface::ModelBasedStateSpace::StateType>()->clearKnownInformation();
+  EXPECT_TRUE(si->isValid(s1.get()));
+  EXPECT_TRUE(si->isValid(s2.get()));
+
+  EXPECT_FALSE(discrete_validator.checkMotion(s1.get(), s2.get()));
+  EXPECT_FALSE(validator.checkMotion(s1.get(), s2.get()));
+
+  std::pair<ompl::base::State*, double> last_valid(si->allocState(), 0.0);
+  EXPECT_FALSE(validator.checkMotion(s1.get(), s2.get(), last_valid));
+  EXPECT_GT(last_valid.second, 0.0);
+  EXPECT_LT(last_valid.second, 0.5);
+  EXPECT_TRUE(si->isValid(last_valid.first));
+  si->freeState(last_valid.first);
+}
+
+TEST_F(PandaMotionValidator, LazyCollisionCheckMotion)
+{
+  const ompl::base::SpaceInformationPtr& si = planning_context_->getOMPLSimpleSetup()->getSpaceInformation();
+  auto state_validity_checker = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+  state_validity_checker->setCollisionCheckingDeferred(true);
+  si->setStateValidityChecker(state_validity_checker);
+  ompl_interface::LazyCollisionMotionValidator validator(planning_context_.get());
+
+  ompl::base::ScopedState<> s1(state_space_), s2(state_space_), s3(state_space_);
+  setReadyState(s1.get(), -1.5);
+  setReadyState(s2.get(), 1.5);
+  setReadyState(s3.get(), 0.0);
+  EXPECT_TRUE(validator.checkMotion(s1.get(), s2.get()));
+
+  // place a box at the hand in the middle of the motion
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = robot_model_->getModelFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 0.2, 0.2, 0.2 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].position.x = 0.35;
+  co.primitive_poses[0].position.z = 0.5;
+  co.primitive_poses[0].orientation.w = 1.0;
+  planning_scene_->processCollisionObjectMsg(co);
+  s1->as<ompl_interface::ModelBasedStateSpace::StateType>()->clearKnownInformation();
+  s2->as<ompl_interface::ModelBasedStateSpace::StateType>()->clearKnownInformation();
+
+  // the state in the box passes the deferred checks, the motions through or to it do not
+  EXPECT_TRUE(si->isValid(s3.get()));
+  EXPECT_FALSE(validator.checkMotion(s1.get(), s2.get()));
+  EXPECT_FALSE(validator.checkMotion(s1.get(), s3.get()));
+  EXPECT_FALSE(si->isValid(s3.get()));
+
+  std::pair<ompl::base::State*, double> last_valid(si->allocState(), 0.0);
+  EXPECT_FALSE(validator.checkMotion(s1.get(), s2.get(), last_valid));
+  EXPECT_GT(last_valid.second, 0.0);
+  EXPECT_LT(last_valid.second, 0.5);
+  si->freeState(last_valid.first);
+  EXPECT_EQ(validator.getValidMotionCount(), 1u);
+  EXPECT_EQ(validator.getInvalidMotionCount(), 3u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
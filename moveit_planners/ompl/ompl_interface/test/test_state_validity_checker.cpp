@@ -55,6 +55,7 @@
 
 #include <gtest/gtest.h>
 
+#include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
@@ -192,6 +193,61 @@ public:
     EXPECT_FALSE(checker->isValid(ompl_state.get()));
   }
 
+  /** The link pose projection must match full FK, also when it reuses the link position of a validity check. **/
+  void testLinkPoseProjection()
+  {
+    SCOPED_TRACE("testLinkPoseProjection");
+
+    planning_context_->setProjectionEvaluator("link(" + ee_link_name_ + ")");
+    const ompl_interface::ProjectionEvaluatorLinkPose* projection = planning_context_->getLinkPoseProjection();
+    ASSERT_NE(projection, nullptr);
+
+    auto checker = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+    checker->setVerbose(VERBOSE);
+
+    ompl::base::ScopedState<> ompl_state(state_space_);
+    Eigen::VectorXd projected(3);
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+      robot_state_->setToRandomPositions(joint_model_group_);
+      robot_state_->update();
+      state_space_->copyToOMPLState(ompl_state.get(), *robot_state_);
+      const Eigen::Vector3d expected = robot_state_->getGlobalLinkTransform(ee_link_name_).translation();
+
+      projection->project(ompl_state.get(), projected);
+      EXPECT_NEAR((projected - expected).norm(), 0.0, 1e-9);
+
+      checker->isValid(ompl_state.get());
+      projection->project(ompl_state.get(), projected);
+      EXPECT_NEAR((projected - expected).norm(), 0.0, 1e-9);
+    }
+  }
+
+  /** The clearance computed along with the validity check must be cached and match a separate distance query. **/
+  void testClearanceCaching(const std::vector<double>& position_in_limits)
+  {
+    SCOPED_TRACE("testClearanceCaching");
+
+    auto checker = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+    checker->setVerbose(VERBOSE);
+    checker->setClearanceCachedWithValidity(true);
+
+    robot_state_->setJointGroupPositions(joint_model_group_, position_in_limits);
+    ompl::base::ScopedState<> ompl_state(state_space_);
+    state_space_->copyToOMPLState(ompl_state.get(), *robot_state_);
+    auto model_state = ompl_state->as<ompl_interface::JointModelStateSpace::StateType>();
+
+    EXPECT_TRUE(checker->isValid(ompl_state.get()));
+    ASSERT_TRUE(model_state->isClearanceKnown());
+    const double cached_clearance = checker->clearance(ompl_state.get());
+
+    // a fresh distance query, without the values cached by the validity check
+    model_state->clearKnownInformation();
+    EXPECT_DOUBLE_EQ(checker->clearance(ompl_state.get()), cached_clearance);
+    EXPECT_TRUE(model_state->isClearanceKnown());
+    EXPECT_FALSE(model_state->isValidityKnown());
+  }
+
 protected:
   void SetUp() override
   {
@@ -292,6 +348,16 @@ TEST_F(PandaValidity, testPathConstraints)
   testPathConstraints({ 0., -0.785, 0., -2.356, 0., 1.571, 0.785 });
 }
 
+TEST_F(PandaValidity, testLinkPoseProjection)
+{
+  testLinkPoseProjection();
+}
+
+TEST_F(PandaValidity, testClearanceCaching)
+{
+  testClearanceCaching({ 0., -0.785, 0., -2.356, 0., 1.571, 0.785 });
+}
+
 /***************************************************************************
  * Run all tests on the Fanuc robot
  * ************************************************************************/
@@ -327,6 +393,16 @@ TEST_F(FanucTest, testPathConstraints)
   testPathConstraints({ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
 }
 
+TEST_F(FanucTest, testLinkPoseProjection)
+{
+  testLinkPoseProjection();
+}
+
+TEST_F(FanucTest, testClearanceCaching)
+{
+  testClearanceCaching({ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
+}
+
 /***************************************************************************
  * MAIN
  * ************************************************************************/
@@ -36,7 +36,9 @@
 
 #include <string>
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <functional>
 
 #include <moveit/planning_interface/planning_interface.h>
@@ -62,6 +64,8 @@ CREATE_MOVEIT_ERROR_CODE_EXCEPTION(OverlappingBlendRadiiException,
                                    moveit_msgs::msg::MoveItErrorCodes::INVALID_MOTION_PLAN);
 CREATE_MOVEIT_ERROR_CODE_EXCEPTION(PlanningPipelineException, moveit_msgs::msg::MoveItErrorCodes::FAILURE);
 
+class CachingTrajectoryBlender;
+
 /**
  * @brief This class orchestrates the planning of single commands and
  * command lists.
@@ -100,6 +104,13 @@ public:
    * which it belongs to. Starts states can even be incomplete. In this case
    * default values are set for the unset joints.
    *
+   * Solved sequence items and blends are cached, see
+   * sequence_segment_cache_size. An item is reused if its request and
+   * resolved start state, the robot state, world and allowed collision
+   * matrix of the planning scene and the planning pipeline are unchanged.
+   * Sequences which only differ in their last items therefore replan only
+   * those.
+   *
    * @return Contains the calculated/generated trajectories.
    */
   RobotTrajCont solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
@@ -125,6 +136,9 @@ private:
   /**
    * @brief Solve each sequence item individually.
    *
+   * The items of different groups are solved concurrently, the items of
+   * one group are solved in order.
+   *
    * @param planning_scene The planning_scene to be used for trajectory
    * generation.
    * @param req_list Container of requests for calculation/generation.
@@ -135,6 +149,21 @@ private:
                                         const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
                                         const moveit_msgs::msg::MotionSequenceRequest& req_list) const;
 
+  /**
+   * @brief Solve a single request, or take its response from the cache.
+   */
+  planning_interface::MotionPlanResponse
+  solveSequenceItem(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                    const planning_interface::MotionPlanRequest& req) const;
+
+  /**
+   * @brief Drop all cached segments and blends if the planning scene or the
+   * planning pipeline differ from the ones they were planned with.
+   */
+  void updateCacheScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_pipeline::PlanningPipelinePtr& planning_pipeline);
+
   /**
    * @return TRUE if the blending radii of specified trajectories overlap,
    * otherwise FALSE. The functions returns FALSE if both trajectories are from
@@ -218,6 +247,19 @@ private:
   //! @brief Builder to construct the container containing the final
   //! trajectories.
   PlanComponentsBuilder plan_comp_builder_;
+
+  //! Maximal number of cached sequence items, zero disables caching
+  std::size_t segment_cache_size_{ 0 };
+
+  //! Identifies the planning scene and pipeline of the cached segments
+  std::string cache_scene_key_;
+
+  //! Responses of solved sequence items by their serialized request
+  mutable std::map<std::string, planning_interface::MotionPlanResponse> segment_cache_;
+  mutable std::mutex segment_cache_mutex_;
+
+  //! Blender of plan_comp_builder_, which caches its results
+  CachingTrajectoryBlender* blend_cache_{ nullptr };
 };
 
 inline void CommandListManager::checkLastBlendRadiusZero(const moveit_msgs::msg::MotionSequenceRequest& req_list)
@@ -79,6 +79,31 @@ bool computePoseIK(const planning_scene::PlanningSceneConstPtr& scene, const std
                    const std::map<std::string, double>& seed, std::map<std::string, double>& solution,
                    bool check_self_collision = true, const double timeout = 0.0);
 
+/**
+ * @brief track a pose close to the seed with damped least squares steps on the
+ * Jacobian of the link, also check robot self collision
+ *
+ * Meant for densely sampled Cartesian paths, where the seed is the solution of
+ * the previous sample. Unlike computePoseIK the kinematics plugin is not called,
+ * so failing to converge is no proof that the pose has no solution.
+ * @param scene: planning scene
+ * @param robot_state: scratch state reused between calls, all variables outside
+ * of the group keep their values
+ * @param group_name: name of planning group
+ * @param link_name: name of target link
+ * @param pose: target pose in model frame
+ * @param seed: seed joint positions, close to the solution
+ * @param solution: solution of IK
+ * @param check_self_collision: true to enable self collision checking of the
+ * solution
+ * @return true if the pose was reached within the iteration limit
+ */
+bool computePoseDifferentialIK(const planning_scene::PlanningSceneConstPtr& scene,
+                               moveit::core::RobotState& robot_state, const std::string& group_name,
+                               const std::string& link_name, const Eigen::Isometry3d& pose,
+                               const std::map<std::string, double>& seed, std::map<std::string, double>& solution,
+                               bool check_self_collision = true);
+
 /**
  * @brief compute the pose of a link at a given robot state
  * @param robot_state: an arbitrary robot state (with collision objects attached)
@@ -205,6 +230,18 @@ bool linearSearchIntersectionPoint(const std::string& link_name, const Eigen::Ve
                                    const double& r, const robot_trajectory::RobotTrajectoryPtr& traj, bool inverseOrder,
                                    std::size_t& index);
 
+/**
+ * @brief Performs a bisection search for the intersection point of the
+ * trajectory with the blending radius.
+ *
+ * Same as linearSearchIntersectionPoint(), but assumes that the distance to the
+ * blending sphere center changes monotonically along the trajectory, as it does
+ * for LIN and CIRC commands. Falls back to the linear search if the bisection
+ * does not find an intersection.
+ */
+bool bisectIntersectionPoint(const std::string& link_name, const Eigen::Vector3d& center_position, const double& r,
+                             const robot_trajectory::RobotTrajectoryPtr& traj, bool inverseOrder, std::size_t& index);
+
 bool intersectionFound(const Eigen::Vector3d& p_center, const Eigen::Vector3d& p_current, const Eigen::Vector3d& p_next,
                        const double& r);
 
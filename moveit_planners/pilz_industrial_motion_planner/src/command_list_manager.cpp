@@ -36,9 +36,15 @@
 
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <functional>
 #include <sstream>
+#include <thread>
+#include <tuple>
+
+#include <rclcpp/serialization.hpp>
 
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/robot_state/conversions.h>
@@ -52,6 +58,75 @@ namespace pilz_industrial_motion_planner
 {
 static const std::string PARAM_NAMESPACE_LIMITS = "robot_description_planning";
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.pilz_industrial_motion_planner.command_list_manager");
+static const std::string PARAM_SEGMENT_CACHE_SIZE = "sequence_segment_cache_size";
+static constexpr int DEFAULT_SEGMENT_CACHE_SIZE = 64;
+
+template <typename MessageT>
+static void appendSerialized(const MessageT& msg, std::string& key)
+{
+  rclcpp::Serialization<MessageT> serializer;
+  rclcpp::SerializedMessage serialized_msg;
+  serializer.serialize_message(&msg, &serialized_msg);
+  const rcl_serialized_message_t& buffer = serialized_msg.get_rcl_serialized_message();
+  key.append(reinterpret_cast<const char*>(buffer.buffer), buffer.buffer_length);
+}
+
+/**
+ * @brief Blender which reuses the result of a previous blend of the same
+ * trajectories.
+ *
+ * Trajectories are identified by address, which is stable since both cached
+ * sequence items and the cached results of earlier blends are handed out
+ * unchanged. The cached requests keep their trajectories alive, so an
+ * address cannot be taken by another trajectory while it is a key.
+ */
+class CachingTrajectoryBlender : public TrajectoryBlender
+{
+public:
+  CachingTrajectoryBlender(const LimitsContainer& limits) : TrajectoryBlender(limits), blender_(limits)
+  {
+  }
+
+  bool blend(const planning_scene::PlanningSceneConstPtr& planning_scene, const TrajectoryBlendRequest& req,
+             TrajectoryBlendResponse& res) override
+  {
+    const BlendKey key{ req.first_trajectory.get(), req.second_trajectory.get(), req.blend_radius, req.link_name };
+    auto it = cache_.find(key);
+    if (it != cache_.end())
+    {
+      res = it->second.second;
+      return true;
+    }
+    if (!blender_.blend(planning_scene, req, res))
+    {
+      return false;
+    }
+    if (cache_.size() >= max_size_)
+    {
+      cache_.clear();
+    }
+    cache_.emplace(key, std::make_pair(req, res));
+    return true;
+  }
+
+  void setMaxSize(std::size_t max_size)
+  {
+    max_size_ = max_size;
+  }
+
+  void clear()
+  {
+    cache_.clear();
+  }
+
+private:
+  using BlendKey = std::tuple<const robot_trajectory::RobotTrajectory*, const robot_trajectory::RobotTrajectory*,
+                              double, std::string>;
+
+  TrajectoryBlenderTransitionWindow blender_;
+  std::size_t max_size_{ 0 };
+  std::map<BlendKey, std::pair<TrajectoryBlendRequest, TrajectoryBlendResponse>> cache_;
+};
 
 CommandListManager::CommandListManager(const rclcpp::Node::SharedPtr& node,
                                        const moveit::core::RobotModelConstPtr& model)
@@ -71,9 +146,23 @@ CommandListManager::CommandListManager(const rclcpp::Node::SharedPtr& node,
   limits.setJointLimits(aggregated_limit_active_joints);
   limits.setCartesianLimits(cartesian_limit);
 
+  int segment_cache_size;
+  node_->get_parameter_or(PARAM_SEGMENT_CACHE_SIZE, segment_cache_size, DEFAULT_SEGMENT_CACHE_SIZE);
+  segment_cache_size_ = static_cast<std::size_t>(std::max(segment_cache_size, 0));
+
   plan_comp_builder_.setModel(model);
-  plan_comp_builder_.setBlender(std::unique_ptr<pilz_industrial_motion_planner::TrajectoryBlender>(
-      new pilz_industrial_motion_planner::TrajectoryBlenderTransitionWindow(limits)));
+  if (segment_cache_size_ > 0)
+  {
+    auto blender = std::make_unique<CachingTrajectoryBlender>(limits);
+    blender->setMaxSize(segment_cache_size_);
+    blend_cache_ = blender.get();
+    plan_comp_builder_.setBlender(std::move(blender));
+  }
+  else
+  {
+    plan_comp_builder_.setBlender(std::unique_ptr<pilz_industrial_motion_planner::TrajectoryBlender>(
+        new pilz_industrial_motion_planner::TrajectoryBlenderTransitionWindow(limits)));
+  }
 }
 
 RobotTrajCont CommandListManager::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
@@ -89,6 +178,11 @@ RobotTrajCont CommandListManager::solve(const planning_scene::PlanningSceneConst
   checkLastBlendRadiusZero(req_list);
   checkStartStates(req_list);
 
+  if (segment_cache_size_ > 0)
+  {
+    updateCacheScene(planning_scene, planning_pipeline);
+  }
+
   MotionResponseCont resp_cont{ solveSequenceItems(planning_scene, planning_pipeline, req_list) };
 
   assert(model_);
@@ -104,7 +198,100 @@ RobotTrajCont CommandListManager::solve(const planning_scene::PlanningSceneConst
                               // therefore: "i-1".
                               (i > 0 ? radii.at(i - 1) : 0.));
   }
-  return plan_comp_builder_.build();
+  RobotTrajCont result{ plan_comp_builder_.build() };
+  if (segment_cache_size_ > 0)
+  {
+    // The result shares its waypoints with the cached segments and blends, which must stay untouched
+    for (robot_trajectory::RobotTrajectoryPtr& trajectory : result)
+    {
+      trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(*trajectory, true);
+    }
+  }
+  return result;
+}
+
+void CommandListManager::updateCacheScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_pipeline::PlanningPipelinePtr& planning_pipeline)
+{
+  // The world is identified by its version, the comparably small robot state and collision matrix by value
+  moveit_msgs::msg::PlanningScene scene_msg;
+  planning_scene->getPlanningSceneMsg(scene_msg, [] {
+    moveit_msgs::msg::PlanningSceneComponents components;
+    components.components = moveit_msgs::msg::PlanningSceneComponents::ROBOT_STATE |
+                            moveit_msgs::msg::PlanningSceneComponents::ROBOT_STATE_ATTACHED_OBJECTS |
+                            moveit_msgs::msg::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX;
+    return components;
+  }());
+  scene_msg.robot_state.joint_state.header.stamp = builtin_interfaces::msg::Time();
+
+  std::ostringstream os;
+  os << planning_scene->getWorld()->getVersion() << ' ' << planning_pipeline.get() << ' ';
+  std::string scene_key{ os.str() };
+  appendSerialized(scene_msg, scene_key);
+
+  if (scene_key != cache_scene_key_)
+  {
+    std::lock_guard<std::mutex> lock(segment_cache_mutex_);
+    segment_cache_.clear();
+    blend_cache_->clear();
+    cache_scene_key_ = std::move(scene_key);
+  }
+}
+
+planning_interface::MotionPlanResponse
+CommandListManager::solveSequenceItem(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                      const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                                      const planning_interface::MotionPlanRequest& req) const
+{
+  std::string key;
+  if (segment_cache_size_ > 0)
+  {
+    // the stamps change from request to request, while the motions stay the same
+    planning_interface::MotionPlanRequest key_req{ req };
+    key_req.start_state.joint_state.header.stamp = builtin_interfaces::msg::Time();
+    for (moveit_msgs::msg::Constraints& goal : key_req.goal_constraints)
+    {
+      for (moveit_msgs::msg::PositionConstraint& position_constraint : goal.position_constraints)
+        position_constraint.header.stamp = builtin_interfaces::msg::Time();
+      for (moveit_msgs::msg::OrientationConstraint& orientation_constraint : goal.orientation_constraints)
+        orientation_constraint.header.stamp = builtin_interfaces::msg::Time();
+    }
+    for (moveit_msgs::msg::PositionConstraint& position_constraint : key_req.path_constraints.position_constraints)
+      position_constraint.header.stamp = builtin_interfaces::msg::Time();
+    for (moveit_msgs::msg::OrientationConstraint& orientation_constraint :
+         key_req.path_constraints.orientation_constraints)
+      orientation_constraint.header.stamp = builtin_interfaces::msg::Time();
+    appendSerialized(key_req, key);
+
+    std::lock_guard<std::mutex> lock(segment_cache_mutex_);
+    auto it = segment_cache_.find(key);
+    if (it != segment_cache_.end())
+    {
+      return it->second;
+    }
+  }
+
+  planning_interface::MotionPlanResponse res;
+  planning_pipeline->generatePlan(planning_scene, req, res);
+  if (res.error_code_.val != res.error_code_.SUCCESS)
+  {
+    std::ostringstream os;
+    os << "Could not solve request\n";  // TODO(henning): re-enable "---\n" << req << "\n---\n";
+    throw PlanningPipelineException(os.str(), res.error_code_.val);
+  }
+
+  if (segment_cache_size_ > 0)
+  {
+    std::lock_guard<std::mutex> lock(segment_cache_mutex_);
+    if (segment_cache_.size() >= segment_cache_size_)
+    {
+      // The cached blends refer to the cached segments, so both are dropped together
+      segment_cache_.clear();
+      blend_cache_->clear();
+    }
+    segment_cache_.emplace(std::move(key), res);
+  }
+  return res;
 }
 
 bool CommandListManager::checkRadiiForOverlap(const robot_trajectory::RobotTrajectory& traj_A, const double radii_A,
@@ -230,24 +417,58 @@ CommandListManager::solveSequenceItems(const planning_scene::PlanningSceneConstP
                                        const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
                                        const moveit_msgs::msg::MotionSequenceRequest& req_list) const
 {
-  MotionResponseCont motion_plan_responses;
-  size_t curr_req_index{ 0 };
   const size_t num_req{ req_list.items.size() };
-  for (const auto& seq_item : req_list.items)
+  MotionResponseCont motion_plan_responses(num_req);
+  std::vector<std::exception_ptr> errors(num_req);
+
+  // Each request starts where the previous request of the same group ended, whereas the requests of different
+  // groups are independent of each other. Therefore, the requests of each group are solved in a thread of their own.
+  const auto solve_group = [&](const std::string& group_name) {
+    MotionResponseCont group_responses;
+    for (size_t curr_req_index = 0; curr_req_index < num_req; ++curr_req_index)
+    {
+      const auto& seq_item{ req_list.items.at(curr_req_index) };
+      if (seq_item.req.group_name != group_name)
+      {
+        continue;
+      }
+      try
+      {
+        planning_interface::MotionPlanRequest req{ seq_item.req };
+        setStartState(group_responses, req.group_name, req.start_state);
+
+        planning_interface::MotionPlanResponse res{ solveSequenceItem(planning_scene, planning_pipeline, req) };
+        group_responses.emplace_back(res);
+        motion_plan_responses.at(curr_req_index) = res;
+        RCLCPP_DEBUG_STREAM(LOGGER, "Solved [" << curr_req_index + 1 << "/" << num_req << "]");
+      }
+      catch (...)
+      {
+        errors.at(curr_req_index) = std::current_exception();
+        return;
+      }
+    }
+  };
+
+  GroupNamesCont group_names{ getGroupNames(req_list) };
+  std::vector<std::thread> threads;
+  for (GroupNamesCont::size_type i = 1; i < group_names.size(); ++i)
+  {
+    threads.emplace_back(solve_group, std::cref(group_names.at(i)));
+  }
+  solve_group(group_names.front());
+  for (std::thread& thread : threads)
   {
-    planning_interface::MotionPlanRequest req{ seq_item.req };
-    setStartState(motion_plan_responses, req.group_name, req.start_state);
+    thread.join();
+  }
 
-    planning_interface::MotionPlanResponse res;
-    planning_pipeline->generatePlan(planning_scene, req, res);
-    if (res.error_code_.val != res.error_code_.SUCCESS)
+  // Report the failure of the first request which could not be solved
+  for (const std::exception_ptr& error : errors)
+  {
+    if (error)
     {
-      std::ostringstream os;
-      os << "Could not solve request\n";  // TODO(henning): re-enable "---\n" << req << "\n---\n";
-      throw PlanningPipelineException(os.str(), res.error_code_.val);
+      std::rethrow_exception(error);
     }
-    motion_plan_responses.emplace_back(res);
-    RCLCPP_DEBUG_STREAM(LOGGER, "Solved [" << ++curr_req_index << "/" << num_req << "]");
   }
   return motion_plan_responses;
 }
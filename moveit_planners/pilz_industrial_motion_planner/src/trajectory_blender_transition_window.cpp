@@ -273,16 +273,16 @@ bool pilz_industrial_motion_planner::TrajectoryBlenderTransitionWindow::searchIn
   Eigen::Isometry3d circ_pose = req.first_trajectory->getLastWayPoint().getFrameTransform(req.link_name);
 
   // Searh for intersection points according to distance
-  if (!linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.first_trajectory,
-                                     true, first_interse_index))
+  if (!bisectIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.first_trajectory, true,
+                               first_interse_index))
   {
     RCLCPP_ERROR_STREAM(LOGGER, "Intersection point of first trajectory not found.");
     return false;
   }
   RCLCPP_INFO_STREAM(LOGGER, "Intersection point of first trajectory found, index: " << first_interse_index);
 
-  if (!linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.second_trajectory,
-                                     false, second_interse_index))
+  if (!bisectIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.second_trajectory, false,
+                               second_interse_index))
   {
     RCLCPP_ERROR_STREAM(LOGGER, "Intersection point of second trajectory not found.");
     return false;
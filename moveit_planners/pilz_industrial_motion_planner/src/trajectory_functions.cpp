@@ -118,6 +118,66 @@ bool pilz_industrial_motion_planner::computePoseIK(const planning_scene::Plannin
                        timeout);
 }
 
+bool pilz_industrial_motion_planner::computePoseDifferentialIK(
+    const planning_scene::PlanningSceneConstPtr& scene, moveit::core::RobotState& robot_state,
+    const std::string& group_name, const std::string& link_name, const Eigen::Isometry3d& pose,
+    const std::map<std::string, double>& seed, std::map<std::string, double>& solution, bool check_self_collision)
+{
+  const moveit::core::RobotModelConstPtr& robot_model = scene->getRobotModel();
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group_name);
+  if (jmg == nullptr || !robot_model->hasLinkModel(link_name))
+    return false;
+  const moveit::core::LinkModel* link = robot_model->getLinkModel(link_name);
+
+  // the steps are taken in the variables of the group, which must be all active
+  const std::vector<std::string>& variable_names = jmg->getVariableNames();
+  if (variable_names.size() != jmg->getActiveJointModelNames().size())
+    return false;
+
+  robot_state.setVariablePositions(seed);
+  Eigen::VectorXd positions;
+  robot_state.copyJointGroupPositions(jmg, positions);
+
+  static constexpr int MAX_ITERATIONS{ 10 };
+  static constexpr double TOLERANCE{ 1e-6 };
+  static constexpr double SQUARED_DAMPING{ 1e-6 };
+  Eigen::MatrixXd jacobian;
+  bool converged = false;
+  for (int iteration = 0; iteration <= MAX_ITERATIONS; ++iteration)
+  {
+    robot_state.setJointGroupPositions(jmg, positions);
+    robot_state.updateLinkTransforms();
+    const Eigen::Isometry3d& current = robot_state.getGlobalLinkTransform(link);
+
+    // error twist in model frame
+    Eigen::Matrix<double, 6, 1> error;
+    error.head<3>() = pose.translation() - current.translation();
+    const Eigen::AngleAxisd rotation_error(pose.linear() * current.linear().transpose());
+    error.tail<3>() = rotation_error.angle() * rotation_error.axis();
+    if (error.norm() < TOLERANCE)
+    {
+      converged = true;
+      break;
+    }
+    if (iteration == MAX_ITERATIONS || !robot_state.getJacobian(jmg, link, Eigen::Vector3d::Zero(), jacobian))
+      break;
+
+    const Eigen::MatrixXd damped = jacobian * jacobian.transpose() + SQUARED_DAMPING * Eigen::MatrixXd::Identity(6, 6);
+    positions += jacobian.transpose() * damped.ldlt().solve(error);
+  }
+
+  if (!converged || !jmg->satisfiesPositionBounds(positions.data()))
+    return false;
+  if (check_self_collision && !isStateColliding(scene, &robot_state, jmg, positions.data()))
+    return false;
+
+  for (std::size_t i = 0; i < variable_names.size(); ++i)
+  {
+    solution[variable_names[i]] = positions[i];
+  }
+  return true;
+}
+
 bool pilz_industrial_motion_planner::computeLinkFK(moveit::core::RobotState& robot_state, const std::string& link_name,
                                                    const std::map<std::string, double>& joint_state,
                                                    Eigen::Isometry3d& pose)
@@ -230,13 +290,17 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
   {
     joint_velocity_last[item.first] = 0.0;
   }
+  moveit::core::RobotState tracking_state{ scene->getCurrentState() };
 
   for (std::vector<double>::const_iterator time_iter = time_samples.begin(); time_iter != time_samples.end();
        ++time_iter)
   {
     tf2::transformKDLToEigen(trajectory.Pos(*time_iter), pose_sample);
 
-    if (!computePoseIK(scene, group_name, link_name, pose_sample, robot_model->getModelFrame(), ik_solution_last,
+    // consecutive samples are close, so track them differentially and only fall back to the IK solver on failure
+    if (!computePoseDifferentialIK(scene, tracking_state, group_name, link_name, pose_sample, ik_solution_last,
+                                   ik_solution, check_self_collision) &&
+        !computePoseIK(scene, group_name, link_name, pose_sample, robot_model->getModelFrame(), ik_solution_last,
                        ik_solution, check_self_collision))
     {
       RCLCPP_ERROR(LOGGER, "Failed to compute inverse kinematics solution for sampled Cartesian pose.");
@@ -341,11 +405,16 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
     joint_trajectory.joint_names.push_back(joint_position.first);
   }
   std::map<std::string, double> ik_solution;
+  moveit::core::RobotState tracking_state{ scene->getCurrentState() };
+  Eigen::Isometry3d pose_sample;
   for (size_t i = 0; i < trajectory.points.size(); ++i)
   {
-    // compute inverse kinematics
-    if (!computePoseIK(scene, group_name, link_name, trajectory.points.at(i).pose, robot_model->getModelFrame(),
-                       ik_solution_last, ik_solution, check_self_collision))
+    // compute inverse kinematics, differentially from the last sample if possible
+    tf2::fromMsg(trajectory.points.at(i).pose, pose_sample);
+    if (!computePoseDifferentialIK(scene, tracking_state, group_name, link_name, pose_sample, ik_solution_last,
+                                   ik_solution, check_self_collision) &&
+        !computePoseIK(scene, group_name, link_name, pose_sample, robot_model->getModelFrame(), ik_solution_last,
+                       ik_solution, check_self_collision))
     {
       RCLCPP_ERROR(LOGGER, "Failed to compute inverse kinematics solution for sampled "
                            "Cartesian pose.");
@@ -564,6 +633,51 @@ bool pilz_industrial_motion_planner::linearSearchIntersectionPoint(const std::st
   return false;
 }
 
+bool pilz_industrial_motion_planner::bisectIntersectionPoint(const std::string& link_name,
+                                                             const Eigen::Vector3d& center_position, const double& r,
+                                                             const robot_trajectory::RobotTrajectoryPtr& traj,
+                                                             bool inverseOrder, std::size_t& index)
+{
+  RCLCPP_DEBUG(LOGGER, "Start bisection search for intersection point.");
+
+  const size_t waypoint_num = traj->getWayPointCount();
+  if (waypoint_num < 2)
+  {
+    return false;
+  }
+
+  const auto position = [&](size_t i) -> Eigen::Vector3d {
+    return traj->getWayPointPtr(i)->getFrameTransform(link_name).translation();
+  };
+  const auto inside = [&](size_t i) { return (position(i) - center_position).norm() <= r; };
+
+  // The waypoint at index "inside_index" is always within the sphere, the one at "outside_index" is not
+  size_t inside_index = inverseOrder ? waypoint_num - 1 : 0;
+  size_t outside_index = inverseOrder ? 0 : waypoint_num - 1;
+  if (inside(inside_index) && !inside(outside_index))
+  {
+    while ((inverseOrder ? inside_index - outside_index : outside_index - inside_index) > 1)
+    {
+      const size_t mid = (inside_index + outside_index) / 2;
+      if (inside(mid))
+      {
+        inside_index = mid;
+      }
+      else
+      {
+        outside_index = mid;
+      }
+    }
+    if (intersectionFound(center_position, position(inside_index), position(outside_index), r))
+    {
+      index = inside_index;
+      return true;
+    }
+  }
+
+  return linearSearchIntersectionPoint(link_name, center_position, r, traj, inverseOrder, index);
+}
+
 bool pilz_industrial_motion_planner::intersectionFound(const Eigen::Vector3d& p_center,
                                                        const Eigen::Vector3d& p_current, const Eigen::Vector3d& p_next,
                                                        const double& r)
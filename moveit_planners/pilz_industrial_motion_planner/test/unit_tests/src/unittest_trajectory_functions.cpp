@@ -558,6 +558,50 @@ TEST_F(TrajectoryFunctionsTestFlangeAndGripper, testComputePoseIK)
   }
 }
 
+/**
+ * @brief Test computePoseDifferentialIK from a seed close to the solution
+ */
+TEST_F(TrajectoryFunctionsTestFlangeAndGripper, testComputePoseDifferentialIK)
+{
+  // robot state
+  moveit::core::RobotState rstate(robot_model_);
+  moveit::core::RobotState tracking_state(robot_model_);
+  tracking_state.setToDefaultValues();
+
+  const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup(planning_group_);
+  const double seed_offset = 0.01;
+
+  while (random_test_number_ > 0)
+  {
+    // sample random robot state
+    rstate.setToRandomPositions(jmg, rng_);
+
+    Eigen::Isometry3d pose_expect = rstate.getFrameTransform(tcp_link_);
+
+    std::map<std::string, double> ik_seed;
+    for (const auto& joint_name : jmg->getActiveJointModelNames())
+    {
+      ik_seed[joint_name] = rstate.getVariablePosition(joint_name) + seed_offset;
+    }
+
+    // the solver may give up close to the joint limits, a solution must reach the pose and stay close to the seed
+    std::map<std::string, double> ik_actual;
+    if (pilz_industrial_motion_planner::computePoseDifferentialIK(planning_scene_, tracking_state, planning_group_,
+                                                                  tcp_link_, pose_expect, ik_seed, ik_actual, false))
+    {
+      Eigen::Isometry3d pose_actual;
+      ASSERT_TRUE(pilz_industrial_motion_planner::computeLinkFK(tracking_state, tcp_link_, ik_actual, pose_actual));
+      EXPECT_TRUE(tfNear(pose_expect, pose_actual, 10 * EPSILON));
+      for (const auto& joint_pair : ik_actual)
+      {
+        EXPECT_NEAR(joint_pair.second, ik_seed.at(joint_pair.first), 4 * seed_offset);
+      }
+    }
+
+    --random_test_number_;
+  }
+}
+
 /**
  * @brief Test computePoseIK for invalid group_name
  */
@@ -1153,6 +1197,46 @@ TEST_F(TrajectoryFunctionsTestFlangeAndGripper, testIsRobotStateStationaryAccele
   EXPECT_FALSE(pilz_industrial_motion_planner::isRobotStateStationary(rstate_1, planning_group_, epsilon));
 }
 
+/**
+ * @brief Check that bisectIntersectionPoint() finds the same intersection
+ * points as linearSearchIntersectionPoint().
+ *
+ * Test Sequence:
+ *    1. Create a trajectory along which the tcp moves on an arc.
+ *    2. Search the intersection points from the end and from the start.
+ *
+ * Expected Results:
+ *    1. -
+ *    2. Both searches find the same indices.
+ */
+TEST_F(TrajectoryFunctionsTestFlangeAndGripper, testBisectIntersectionPoint)
+{
+  auto traj = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, planning_group_);
+  moveit::core::RobotState rstate(robot_model_);
+  rstate.setToDefaultValues();
+  for (size_t i = 0; i <= 100; ++i)
+  {
+    std::vector<double> positions{ 0.01 * i, 0.5, 0.5, 0.0, 0.5, 0.0 };
+    rstate.setJointGroupPositions(planning_group_, positions);
+    rstate.update();
+    traj->addSuffixWayPoint(rstate, 0.1);
+  }
+
+  const double r{ 0.1 };
+  for (bool inverse_order : { true, false })
+  {
+    const Eigen::Vector3d center = (inverse_order ? traj->getLastWayPoint() : traj->getFirstWayPoint())
+                                       .getFrameTransform(tcp_link_)
+                                       .translation();
+    std::size_t linear_index, bisect_index;
+    ASSERT_TRUE(pilz_industrial_motion_planner::linearSearchIntersectionPoint(tcp_link_, center, r, traj,
+                                                                              inverse_order, linear_index));
+    ASSERT_TRUE(pilz_industrial_motion_planner::bisectIntersectionPoint(tcp_link_, center, r, traj, inverse_order,
+                                                                        bisect_index));
+    EXPECT_EQ(linear_index, bisect_index);
+  }
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
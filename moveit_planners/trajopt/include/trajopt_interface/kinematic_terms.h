@@ -90,4 +90,26 @@ struct JointVelJacobianCalculator : sco::MatrixOfVector
   Eigen::MatrixXd operator()(const Eigen::VectorXd& var_vals) const;
 };
 
+/**
+ * @brief Used to calculate the error for CollisionTermInfo
+ *
+ * The variables are the joint values of two consecutive timesteps. The motion of the robot between them is checked
+ * against the world with the continuous collision checks of the planning scene, so the collision detector needs to
+ * support them, like Bullet does. The error is the amount by which the distance falls short of the safety margin.
+ */
+struct CollisionErrCalculator : public sco::VectorOfVector
+{
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  const moveit::core::JointModelGroup* joint_model_group_;
+  double safety_margin_;
+
+  CollisionErrCalculator(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                         const moveit::core::JointModelGroup* joint_model_group, double safety_margin)
+    : planning_scene_(planning_scene), joint_model_group_(joint_model_group), safety_margin_(safety_margin)
+  {
+  }
+
+  Eigen::VectorXd operator()(const Eigen::VectorXd& dof_vals) const override;
+};
+
 }  // namespace trajopt_interface
@@ -52,6 +52,9 @@ MOVEIT_CLASS_FORWARD(CartPoseTermInfo);  // Defines CartPoseTermInfoPtr, ConstPt
 struct JointVelTermInfo;
 MOVEIT_CLASS_FORWARD(JointVelTermInfo);  // Defines JointVelTermInfoPtr, ConstPtr, WeakPtr... etc
 
+struct CollisionTermInfo;
+MOVEIT_CLASS_FORWARD(CollisionTermInfo);  // Defines CollisionTermInfoPtr, ConstPtr, WeakPtr... etc
+
 struct ProblemInfo;
 TrajOptProblemPtr ConstructProblem(const ProblemInfo&);
 
@@ -229,6 +232,11 @@ public:
   {
     return planning_scene_;
   }
+  /** @brief Returns the name of the planned joint model group */
+  const std::string& GetPlanningGroup() const
+  {
+    return planning_group_;
+  }
   void SetInitTraj(const trajopt::TrajArray& x)
   {
     matrix_init_traj = x;
@@ -363,6 +371,38 @@ struct JointVelTermInfo : public TermInfo
   }
 };
 
+/**
+  \brief Collision avoidance between the world and the robot moving from each time step to the next
+
+  The swept volume of the robot links between consecutive steps is checked with the continuous collision checks of the
+  planning scene, see CollisionErrCalculator. TT_COST applies a hinge cost scaled by coeff whenever the distance to the
+  world is less than safety_margin, TT_CNT an inequality constraint.
+ */
+struct CollisionTermInfo : public TermInfo
+{
+  /** @brief Distance to the world below which the term is active */
+  double safety_margin = 0.025;
+  /** @brief Coefficient that scales the cost */
+  double coeff = 20.0;
+  /** @brief First time step to which the term is applied. Default: 0 */
+  int first_step = 0;
+  /** @brief Last time step to which the term is applied. Default: prob.GetNumSteps() - 1*/
+  int last_step = -1;
+
+  /** @brief Initialize term with it's supported types */
+  CollisionTermInfo() : TermInfo(TT_COST | TT_CNT)
+  {
+  }
+
+  /** @brief Converts term info into cost/constraint and adds it to trajopt problem */
+  void addObjectiveTerms(TrajOptProblem& prob) override;
+
+  static TermInfoPtr create()
+  {
+    return std::make_shared<CollisionTermInfo>();
+  }
+};
+
 void generateInitialTrajectory(const ProblemInfo& pci, const std::vector<double>& current_joint_values,
                                trajopt::TrajArray& init_traj);
 
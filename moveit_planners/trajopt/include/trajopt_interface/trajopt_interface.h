@@ -35,9 +35,10 @@
 /* Author: Omid Heidari */
 #pragma once
 
-#include <ros/ros.h>
+#include <rclcpp/node.hpp>
 #include <trajopt_sco/sco_common.hpp>
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit_msgs/msg/motion_plan_detailed_response.hpp>
 #include "problem_description.h"
 
 namespace trajopt_interface
@@ -47,7 +48,7 @@ MOVEIT_CLASS_FORWARD(TrajOptInterface);  // Defines TrajOptInterfacePtr, ConstPt
 class TrajOptInterface
 {
 public:
-  TrajOptInterface(const ros::NodeHandle& nh = ros::NodeHandle("~"));
+  TrajOptInterface(const rclcpp::Node::SharedPtr& node);
 
   const sco::BasicTrustRegionSQPParameters& getParams() const
   {
@@ -55,22 +56,32 @@ public:
   }
 
   bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
-             const planning_interface::MotionPlanRequest& req, moveit_msgs::MotionPlanDetailedResponse& res);
+             const planning_interface::MotionPlanRequest& req, moveit_msgs::msg::MotionPlanDetailedResponse& res);
 
 protected:
-  /** @brief Configure everything using the param server */
+  /** @brief Configure everything using the node parameters */
   void setTrajOptParams(sco::BasicTrustRegionSQPParameters& param);
   void setDefaultTrajOPtParams();
   void setProblemInfoParam(ProblemInfo& problem_info);
   void setJointPoseTermInfoParams(JointPoseTermInfoPtr& jp, std::string name);
+  void setCollisionTermInfoParams(CollisionTermInfoPtr& collision);
   trajopt::DblVec extractStartJointValues(const planning_interface::MotionPlanRequest& req,
                                           const std::vector<std::string>& group_joint_names);
 
-  ros::NodeHandle nh_;  /// The ROS node handle
+  /** @brief Initial trajectory shifted from the previous solution, empty if it does not fit the problem
+   *
+   * The previous solution is deformed linearly so that it starts at start_joint_values and ends at goal_joint_values,
+   * keeping the shape of the path found for a nearby query. */
+  trajopt::TrajArray warmStartTrajectory(const trajopt::DblVec& start_joint_values,
+                                         const trajopt::DblVec& goal_joint_values, int n_steps) const;
+
+  rclcpp::Node::SharedPtr node_;  /// The ROS node
   sco::BasicTrustRegionSQPParameters params_;
   std::vector<sco::Optimizer::Callback> optimizer_callbacks_;
   TrajOptProblemPtr trajopt_problem_;
   std::string name_;
+  /** @brief Joint values of the last solution, one row per time step */
+  trajopt::TrajArray last_solution_;
 };
 
 void callBackFunc(sco::OptProb* opt_prob, sco::OptResults& opt_res);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <moveit/planning_interface/planning_interface.h>
+#include <rclcpp/node.hpp>
 
 #include <trajopt_interface/problem_description.h>
 #include <trajopt_interface/trajopt_interface.h>
@@ -13,7 +14,7 @@ class TrajOptPlanningContext : public planning_interface::PlanningContext
 {
 public:
   TrajOptPlanningContext(const std::string& name, const std::string& group,
-                         const moveit::core::RobotModelConstPtr& model);
+                         const moveit::core::RobotModelConstPtr& model, const rclcpp::Node::SharedPtr& node);
   ~TrajOptPlanningContext() override
   {
   }
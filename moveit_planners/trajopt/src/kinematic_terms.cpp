@@ -1,4 +1,5 @@
 #include <Eigen/Geometry>
+#include <algorithm>
 #include <boost/format.hpp>
 
 #include <trajopt_sco/expr_ops.hpp>
@@ -61,4 +62,27 @@ MatrixXd JointVelJacobianCalculator::operator()(const VectorXd& var_vals) const
   return jac;
 }
 
+VectorXd CollisionErrCalculator::operator()(const VectorXd& dof_vals) const
+{
+  const int n_dof = static_cast<int>(joint_model_group_->getActiveVariableCount());
+  moveit::core::RobotState state1 = planning_scene_->getCurrentState();
+  moveit::core::RobotState state2 = state1;
+  state1.setJointGroupActivePositions(joint_model_group_, VectorXd(dof_vals.head(n_dof)));
+  state2.setJointGroupActivePositions(joint_model_group_, VectorXd(dof_vals.tail(n_dof)));
+  state1.updateCollisionBodyTransforms();
+  state2.updateCollisionBodyTransforms();
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = joint_model_group_->getName();
+  req.distance = true;
+  planning_scene_->getCollisionEnv()->checkRobotCollision(req, res, state1, state2,
+                                                          planning_scene_->getAllowedCollisionMatrix());
+
+  // the result keeps the largest double as distance if nothing came within the contact distance
+  VectorXd err(1);
+  err(0) = std::max(0.0, safety_margin_ - res.distance);
+  return err;
+}
+
 }  // namespace trajopt_interface
@@ -31,13 +31,17 @@
  *  http://opensource.org/licenses/BSD-2-Clause
  *********************************************************************/
 
+#include <algorithm>
+#include <string>
+
 #include <boost/algorithm/string.hpp>
 
-#include <ros/ros.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
 
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_scene/planning_scene.h>
-#include <moveit_msgs/MotionPlanRequest.h>
+#include <moveit_msgs/msg/motion_plan_request.hpp>
 
 #include <trajopt/trajectory_costs.hpp>
 #include <trajopt_sco/expr_op_overloads.hpp>
@@ -49,6 +53,11 @@
 #include <trajopt_interface/problem_description.h>
 #include <trajopt_interface/kinematic_terms.h>
 
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("trajopt_planner");
+}  // namespace
+
 /**
  * @brief Checks the size of the parameter given and throws if incorrect
  * @param parameter The vector whose size is getting checked
@@ -62,7 +71,7 @@ void checkParameterSize(trajopt::DblVec& parameter, const unsigned int& expected
   if (apply_first == true && parameter.size() == 1)
   {
     parameter = trajopt::DblVec(expected_size, parameter[0]);
-    ROS_INFO("1 %s given. Applying to all %i joints", name.c_str(), expected_size);
+    RCLCPP_INFO(LOGGER, "1 %s given. Applying to all %i joints", name.c_str(), expected_size);
   }
   else if (parameter.size() != expected_size)
   {
@@ -90,7 +99,7 @@ TrajOptProblem::TrajOptProblem(const ProblemInfo& problem_info)
 
   int n_steps = problem_info.basic_info.n_steps;
 
-  ROS_INFO(" ======================================= problem_description: limits");
+  RCLCPP_DEBUG(LOGGER, " ======================================= problem_description: limits");
   Eigen::MatrixX2d limits(dof_, 2);
   for (int k = 0; k < limits.size() / 2; ++k)
   {
@@ -101,7 +110,8 @@ TrajOptProblem::TrajOptProblem(const ProblemInfo& problem_info)
     limits(k, 0) = joint_bound.min_position_;
     limits(k, 1) = joint_bound.max_position_;
 
-    ROS_INFO("joint %i with lower bound: %f, upper bound: %f", k, joint_bound.min_position_, joint_bound.max_position_);
+    RCLCPP_DEBUG(LOGGER, "joint %i with lower bound: %f, upper bound: %f", k, joint_bound.min_position_,
+                 joint_bound.max_position_);
   }
 
   Eigen::VectorXd lower, upper;
@@ -145,7 +155,7 @@ TrajOptProblemPtr ConstructProblem(const ProblemInfo& pci)
   for (TermInfoPtr cost : pci.cost_infos)
   {
     if (cost->term_type & TT_CNT)
-      ROS_WARN("%s is listed as a type TT_CNT but was added to cost_infos", (cost->name).c_str());
+      RCLCPP_WARN(LOGGER, "%s is listed as a type TT_CNT but was added to cost_infos", (cost->name).c_str());
     if (!(cost->getSupportedTypes() & TT_COST))
       PRINT_AND_THROW(boost::format("%s is only a constraint, but you listed it as a cost") % cost->name);
     if (cost->term_type & TT_USE_TIME)
@@ -158,7 +168,7 @@ TrajOptProblemPtr ConstructProblem(const ProblemInfo& pci)
   for (TermInfoPtr cnt : pci.cnt_infos)
   {
     if (cnt->term_type & TT_COST)
-      ROS_WARN("%s is listed as a type TT_COST but was added to cnt_infos", (cnt->name).c_str());
+      RCLCPP_WARN(LOGGER, "%s is listed as a type TT_COST but was added to cnt_infos", (cnt->name).c_str());
     if (!(cnt->getSupportedTypes() & TT_CNT))
       PRINT_AND_THROW(boost::format("%s is only a cost, but you listed it as a constraint") % cnt->name);
     if (cnt->term_type & TT_USE_TIME)
@@ -283,11 +293,11 @@ void CartPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
 
   if (term_type == (TT_COST | TT_USE_TIME))
   {
-    ROS_ERROR("Use time version of this term has not been defined.");
+    RCLCPP_ERROR(LOGGER, "Use time version of this term has not been defined.");
   }
   else if (term_type == (TT_CNT | TT_USE_TIME))
   {
-    ROS_ERROR("Use time version of this term has not been defined.");
+    RCLCPP_ERROR(LOGGER, "Use time version of this term has not been defined.");
   }
   else if ((term_type & TT_COST) && ~(term_type | ~TT_USE_TIME))
   {
@@ -303,7 +313,7 @@ void CartPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
   else
   {
-    ROS_WARN("CartPoseTermInfo does not have a valid term_type defined. No cost/constraint applied");
+    RCLCPP_WARN(LOGGER, "CartPoseTermInfo does not have a valid term_type defined. No cost/constraint applied");
   }
 }
 
@@ -333,7 +343,7 @@ void JointPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
     int tmp = first_step;
     first_step = last_step;
     last_step = tmp;
-    ROS_WARN("Last time step for JointPosTerm comes before first step. Reversing them.");
+    RCLCPP_WARN(LOGGER, "Last time step for JointPosTerm comes before first step. Reversing them.");
   }
   if (last_step == -1)  // last_step not set
     last_step = first_step;
@@ -354,7 +364,7 @@ void JointPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   trajopt::VarArray vars = prob.GetVars();
   trajopt::VarArray joint_vars = vars.block(0, 0, vars.rows(), static_cast<int>(n_dof));
   if (prob.GetHasTime())
-    ROS_INFO("JointPoseTermInfo does not differ based on setting of TT_USE_TIME");
+    RCLCPP_INFO(LOGGER, "JointPoseTermInfo does not differ based on setting of TT_USE_TIME");
 
   if (term_type & TT_COST)
   {
@@ -392,7 +402,7 @@ void JointPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
   else
   {
-    ROS_WARN("JointPosTermInfo does not have a valid term_type defined. No cost/constraint applied");
+    RCLCPP_WARN(LOGGER, "JointPosTermInfo does not have a valid term_type defined. No cost/constraint applied");
   }
 }
 
@@ -422,7 +432,7 @@ void JointVelTermInfo::addObjectiveTerms(TrajOptProblem& prob)
     int tmp = first_step;
     first_step = last_step;
     last_step = tmp;
-    ROS_WARN("Last time step for JointVelTerm comes before first step. Reversing them.");
+    RCLCPP_WARN(LOGGER, "Last time step for JointVelTerm comes before first step. Reversing them.");
   }
 
   // Check if parameters are the correct size.
@@ -541,7 +551,42 @@ void JointVelTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
   else
   {
-    ROS_WARN("JointVelTermInfo does not have a valid term_type defined. No cost/constraint applied");
+    RCLCPP_WARN(LOGGER, "JointVelTermInfo does not have a valid term_type defined. No cost/constraint applied");
+  }
+}
+
+void CollisionTermInfo::addObjectiveTerms(TrajOptProblem& prob)
+{
+  const int n_dof = prob.GetActiveGroupNumDOF();
+  const moveit::core::JointModelGroup* joint_model_group =
+      prob.GetPlanningScene()->getRobotModel()->getJointModelGroup(prob.GetPlanningGroup());
+
+  if (last_step <= -1 || last_step > prob.GetNumSteps() - 1)
+    last_step = prob.GetNumSteps() - 1;
+  first_step = std::clamp(first_step, 0, last_step);
+
+  // every motion between two consecutive time steps gets its own term, so that each depends on 2 * n_dof variables
+  for (int step = first_step; step < last_step; ++step)
+  {
+    sco::VarVector vars = concatVector(prob.GetVarRow(step, 0, n_dof), prob.GetVarRow(step + 1, 0, n_dof));
+    sco::VectorOfVectorPtr f =
+        std::make_shared<CollisionErrCalculator>(prob.GetPlanningScene(), joint_model_group, safety_margin);
+    const std::string step_name = name + "_" + std::to_string(step);
+    if (term_type & TT_COST)
+    {
+      prob.addCost(
+          std::make_shared<sco::CostFromErrFunc>(f, vars, Eigen::VectorXd::Constant(1, coeff), sco::HINGE, step_name));
+    }
+    else if (term_type & TT_CNT)
+    {
+      prob.addConstraint(std::make_shared<sco::ConstraintFromErrFunc>(f, vars, Eigen::VectorXd::Constant(1, coeff),
+                                                                      sco::INEQ, step_name));
+    }
+    else
+    {
+      RCLCPP_WARN(LOGGER, "CollisionTermInfo does not have a valid term_type defined. No cost/constraint applied");
+      return;
+    }
   }
 }
 
@@ -36,8 +36,9 @@
 
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
 
-#include <moveit_msgs/MotionPlanRequest.h>
+#include <moveit_msgs/msg/motion_plan_request.hpp>
 
 #include <trajopt_sco/sco_common.hpp>
 #include <trajopt_sco/optimizers.hpp>
@@ -45,9 +46,11 @@
 
 #include <trajopt/trajectory_costs.hpp>
 
-#include <ros/ros.h>
-#include <rosparam_shortcuts/rosparam_shortcuts.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <rclcpp/clock.hpp>
 
+#include <cmath>
 #include <limits>
 #include <vector>
 #include <Eigen/Geometry>
@@ -58,7 +61,12 @@
 
 namespace trajopt_interface
 {
-TrajOptInterface::TrajOptInterface(const ros::NodeHandle& nh) : nh_(nh), name_("TrajOptInterface")
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("trajopt_planner");
+}  // namespace
+
+TrajOptInterface::TrajOptInterface(const rclcpp::Node::SharedPtr& node) : node_(node), name_("TrajOptInterface")
 {
   trajopt_problem_ = std::make_shared<TrajOptProblem>();
   setDefaultTrajOPtParams();
@@ -69,86 +77,105 @@ TrajOptInterface::TrajOptInterface(const ros::NodeHandle& nh) : nh_(nh), name_("
 
 bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
                              const planning_interface::MotionPlanRequest& req,
-                             moveit_msgs::MotionPlanDetailedResponse& res)
+                             moveit_msgs::msg::MotionPlanDetailedResponse& res)
 {
-  ROS_INFO(" ======================================= From trajopt_interface, solve is called");
+  RCLCPP_DEBUG(LOGGER, "TrajOpt solve is called");
   setTrajOptParams(params_);
 
   if (!planning_scene)
   {
-    ROS_ERROR_STREAM_NAMED(name_, "No planning scene initialized.");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    RCLCPP_ERROR(LOGGER, "No planning scene initialized.");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
     return false;
   }
 
-  ROS_INFO(" ======================================= Extract current state information");
-  ros::WallTime start_time = ros::WallTime::now();
+  RCLCPP_DEBUG(LOGGER, "Extract current state information");
+  rclcpp::Clock clock(RCL_STEADY_TIME);
+  const rclcpp::Time start_time = clock.now();
   moveit::core::RobotModelConstPtr robot_model = planning_scene->getRobotModel();
-  bool robot_model_ok = static_cast<bool>(robot_model);
-  if (!robot_model_ok)
-    ROS_ERROR_STREAM_NAMED(name_, "robot model is not loaded properly");
-  auto current_state = std::make_shared<moveit::core::RobotState>(robot_model);
-  *current_state = planning_scene->getCurrentState();
+  if (!robot_model)
+  {
+    RCLCPP_ERROR(LOGGER, "robot model is not loaded properly");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    return false;
+  }
+  auto current_state = std::make_shared<moveit::core::RobotState>(planning_scene->getCurrentState());
   const moveit::core::JointModelGroup* joint_model_group = current_state->getJointModelGroup(req.group_name);
   if (joint_model_group == nullptr)
-    ROS_ERROR_STREAM_NAMED(name_, "joint model group is empty");
+  {
+    RCLCPP_ERROR(LOGGER, "joint model group is empty");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GROUP_NAME;
+    return false;
+  }
   std::vector<std::string> group_joint_names = joint_model_group->getActiveJointModelNames();
   int dof = group_joint_names.size();
-  std::vector<double> current_joint_values;
-  current_state->copyJointGroupPositions(joint_model_group, current_joint_values);
 
-  // Current state is different from star state in general
-  ROS_INFO(" ======================================= Extract start state information");
+  RCLCPP_DEBUG(LOGGER, "Extract start state information");
   trajopt::DblVec start_joint_values = extractStartJointValues(req, group_joint_names);
 
   // check the start state for being empty or joint limit violiation
   if (start_joint_values.empty())
   {
-    ROS_ERROR_STREAM_NAMED(name_, "Start_state is empty");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+    RCLCPP_ERROR(LOGGER, "Start_state is empty");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_ROBOT_STATE;
     return false;
   }
 
   if (not joint_model_group->satisfiesPositionBounds(start_joint_values.data()))
   {
-    ROS_ERROR_STREAM_NAMED(name_, "Start state violates joint limits");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+    RCLCPP_ERROR(LOGGER, "Start state violates joint limits");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_ROBOT_STATE;
     return false;
   }
 
-  ROS_INFO(" ======================================= Create ProblemInfo");
+  RCLCPP_DEBUG(LOGGER, "Create Constraints");
+  if (req.goal_constraints.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "No goal constraints specified!");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+    return false;
+  }
+
+  RCLCPP_DEBUG(LOGGER, "Create ProblemInfo");
   ProblemInfo problem_info(planning_scene, req.group_name);
 
   setProblemInfoParam(problem_info);
 
-  ROS_INFO(" ======================================= Populate init info, hard-coded");
+  // The goal of the last goal constraints seeds the interpolated and warm started initial trajectories
+  trajopt::DblVec goal_joint_values;
+  for (const moveit_msgs::msg::JointConstraint& joint_goal_constraint : req.goal_constraints.back().joint_constraints)
+    goal_joint_values.push_back(joint_goal_constraint.position);
+  if (static_cast<int>(goal_joint_values.size()) != dof)
+    goal_joint_values = start_joint_values;
+
+  RCLCPP_DEBUG(LOGGER, "Populate init info");
   // TODO: init info should be defined by user. To this end, we need to add seed trajectories to MotionPlanRequest.
-  // JOINT_INTERPOLATED: data is the current joint values
-  // GIVEN_TRAJ: data is the joint values of the current state copied to all timesteps
-  Eigen::VectorXd current_joint_values_eigen(dof);
-  for (int joint_index = 0; joint_index < dof; ++joint_index)
-  {
-    current_joint_values_eigen(joint_index) = current_joint_values[joint_index];
-  }
+  // JOINT_INTERPOLATED: data is the goal joint values
+  // GIVEN_TRAJ: data is the previous solution shifted to the new endpoints, or the start state copied to all timesteps
+  Eigen::VectorXd start_joint_values_eigen = Eigen::Map<const Eigen::VectorXd>(start_joint_values.data(), dof);
+
+  bool use_warm_start;
+  node_->get_parameter_or("trajopt.warm_start", use_warm_start, true);
+  trajopt::TrajArray warm_start;
+  if (use_warm_start)
+    warm_start = warmStartTrajectory(start_joint_values, goal_joint_values, problem_info.basic_info.n_steps);
 
-  if (problem_info.init_info.type == InitInfo::JOINT_INTERPOLATED)
+  if (warm_start.size() > 0)
   {
-    problem_info.init_info.data = current_joint_values_eigen;
+    RCLCPP_DEBUG(LOGGER, "Warm starting from the previous solution");
+    problem_info.init_info.type = InitInfo::GIVEN_TRAJ;
+    problem_info.init_info.data = warm_start;
   }
-  else if (problem_info.init_info.type == InitInfo::GIVEN_TRAJ)
+  else if (problem_info.init_info.type == InitInfo::JOINT_INTERPOLATED)
   {
-    problem_info.init_info.data = current_joint_values_eigen.transpose().replicate(problem_info.basic_info.n_steps, 1);
+    problem_info.init_info.data = Eigen::Map<const Eigen::VectorXd>(goal_joint_values.data(), dof);
   }
-
-  ROS_INFO(" ======================================= Create Constraints");
-  if (req.goal_constraints.empty())
+  else if (problem_info.init_info.type == InitInfo::GIVEN_TRAJ)
   {
-    ROS_ERROR_STREAM_NAMED("trajopt_planner", "No goal constraints specified!");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
-    return false;
+    problem_info.init_info.data = start_joint_values_eigen.transpose().replicate(problem_info.basic_info.n_steps, 1);
   }
 
-  ROS_INFO(" ======================================= Cartesian Constraints");
+  RCLCPP_DEBUG(LOGGER, "Cartesian Constraints");
   if (!req.goal_constraints[0].position_constraints.empty() && !req.goal_constraints[0].orientation_constraints.empty())
   {
     CartPoseTermInfoPtr cart_goal_pos = std::make_shared<CartPoseTermInfo>();
@@ -162,27 +189,27 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   else if (req.goal_constraints[0].position_constraints.empty() &&
            !req.goal_constraints[0].orientation_constraints.empty())
   {
-    ROS_ERROR_STREAM_NAMED("trajopt_planner", "position constraint is not defined");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+    RCLCPP_ERROR(LOGGER, "position constraint is not defined");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
     return false;
   }
-  else if (!req.goal_constraints[0].orientation_constraints.empty() &&
+  else if (!req.goal_constraints[0].position_constraints.empty() &&
            req.goal_constraints[0].orientation_constraints.empty())
   {
-    ROS_ERROR_STREAM_NAMED("trajopt_planner", "orientation constraint is not defined");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+    RCLCPP_ERROR(LOGGER, "orientation constraint is not defined");
+    res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
     return false;
   }
 
-  ROS_INFO(" ======================================= Constraints from request goal_constraints");
-  for (auto goal_cnt : req.goal_constraints)
+  RCLCPP_DEBUG(LOGGER, "Constraints from request goal_constraints");
+  for (const auto& goal_cnt : req.goal_constraints)
   {
     JointPoseTermInfoPtr joint_pos_term = std::make_shared<JointPoseTermInfo>();
     // When using MotionPlanning Display in RViz, the created request has no name for the constriant
     setJointPoseTermInfoParams(joint_pos_term, (goal_cnt.name != "") ? goal_cnt.name : "goal_tmp");
 
     trajopt::DblVec joint_goal_constraints;
-    for (const moveit_msgs::JointConstraint& joint_goal_constraint : goal_cnt.joint_constraints)
+    for (const moveit_msgs::msg::JointConstraint& joint_goal_constraint : goal_cnt.joint_constraints)
     {
       joint_goal_constraints.push_back(joint_goal_constraint.position);
     }
@@ -190,7 +217,7 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
     problem_info.cnt_infos.push_back(joint_pos_term);
   }
 
-  ROS_INFO(" ======================================= Constraints from request start_state");
+  RCLCPP_DEBUG(LOGGER, "Constraints from request start_state");
   // add the start pos from request as a constraint
   auto joint_start_pos = std::make_shared<JointPoseTermInfo>();
 
@@ -198,7 +225,7 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   setJointPoseTermInfoParams(joint_start_pos, "start_pos");
   problem_info.cnt_infos.push_back(joint_start_pos);
 
-  ROS_INFO(" ======================================= Velocity Constraints, hard-coded");
+  RCLCPP_DEBUG(LOGGER, "Velocity Constraints, hard-coded");
   // TODO: should be defined by user, its parameters should be added to setup.yaml
   auto joint_vel = std::make_shared<JointVelTermInfo>();
 
@@ -210,31 +237,42 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   joint_vel->term_type = trajopt_interface::TT_COST;
   problem_info.cost_infos.push_back(joint_vel);
 
-  ROS_INFO(" ======================================= Visibility Constraints");
+  RCLCPP_DEBUG(LOGGER, "Collision avoidance");
+  auto collision = std::make_shared<CollisionTermInfo>();
+  setCollisionTermInfoParams(collision);
+  collision->name = "collision";
+  collision->first_step = 0;
+  collision->last_step = problem_info.basic_info.n_steps - 1;
+  if (collision->term_type == TT_CNT)
+    problem_info.cnt_infos.push_back(collision);
+  else
+    problem_info.cost_infos.push_back(collision);
+
+  RCLCPP_DEBUG(LOGGER, "Visibility Constraints");
   if (!req.goal_constraints[0].visibility_constraints.empty())
   {
     // TODO: Add visibility constraint
   }
 
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.improve_ratio_threshold: " << params_.improve_ratio_threshold);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.min_trust_box_size: " << params_.min_trust_box_size);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.min_approx_improve: " << params_.min_approx_improve);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.params_.min_approx_improve_frac: " << params_.min_approx_improve_frac);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.max_iter: " << params_.max_iter);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.trust_shrink_ratio: " << params_.trust_shrink_ratio);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.trust_expand_ratio: " << params_.trust_expand_ratio);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.cnt_tolerance: " << params_.cnt_tolerance);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.max_merit_coeff_increases: " << params_.max_merit_coeff_increases);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.merit_coeff_increase_ratio: " << params_.merit_coeff_increase_ratio);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.max_time: " << params_.max_time);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.merit_error_coeff: " << params_.merit_error_coeff);
-  ROS_DEBUG_STREAM_NAMED(name_, "trajopt_param.trust_box_size: " << params_.trust_box_size);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.n_steps: " << problem_info.basic_info.n_steps);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.dt_upper_lim: " << problem_info.basic_info.dt_upper_lim);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.dt_lower_lim: " << problem_info.basic_info.dt_lower_lim);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.start_fixed: " << problem_info.basic_info.start_fixed);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.use_time: " << problem_info.basic_info.use_time);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.convex_solver: " << problem_info.basic_info.convex_solver);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.improve_ratio_threshold: " << params_.improve_ratio_threshold);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.min_trust_box_size: " << params_.min_trust_box_size);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.min_approx_improve: " << params_.min_approx_improve);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.min_approx_improve_frac: " << params_.min_approx_improve_frac);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.max_iter: " << params_.max_iter);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.trust_shrink_ratio: " << params_.trust_shrink_ratio);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.trust_expand_ratio: " << params_.trust_expand_ratio);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.cnt_tolerance: " << params_.cnt_tolerance);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.max_merit_coeff_increases: " << params_.max_merit_coeff_increases);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.merit_coeff_increase_ratio: " << params_.merit_coeff_increase_ratio);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.max_time: " << params_.max_time);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.merit_error_coeff: " << params_.merit_error_coeff);
+  RCLCPP_DEBUG_STREAM(LOGGER, "trajopt_param.trust_box_size: " << params_.trust_box_size);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.n_steps: " << problem_info.basic_info.n_steps);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.dt_upper_lim: " << problem_info.basic_info.dt_upper_lim);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.dt_lower_lim: " << problem_info.basic_info.dt_lower_lim);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.start_fixed: " << problem_info.basic_info.start_fixed);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.use_time: " << problem_info.basic_info.use_time);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.convex_solver: " << problem_info.basic_info.convex_solver);
 
   std::string problem_info_type;
   switch (problem_info.init_info.type)
@@ -249,16 +287,16 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
       problem_info_type = "GIVEN_TRAJ";
       break;
   }
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.type: " << problem_info_type);
-  ROS_DEBUG_STREAM_NAMED(name_, "problem_info.basic_info.dt: " << problem_info.init_info.dt);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.type: " << problem_info_type);
+  RCLCPP_DEBUG_STREAM(LOGGER, "problem_info.basic_info.dt: " << problem_info.init_info.dt);
 
-  ROS_INFO(" ======================================= Construct problem");
+  RCLCPP_DEBUG(LOGGER, "Construct problem");
   trajopt_problem_ = ConstructProblem(problem_info);
 
-  ROS_INFO_STREAM_NAMED("num_cost", trajopt_problem_->getNumCosts());
-  ROS_INFO_STREAM_NAMED("num_constraints", trajopt_problem_->getNumConstraints());
+  RCLCPP_DEBUG_STREAM(LOGGER, "num_cost: " << trajopt_problem_->getNumCosts()
+                                           << ", num_constraints: " << trajopt_problem_->getNumConstraints());
 
-  ROS_INFO(" ======================================= TrajOpt Optimization");
+  RCLCPP_DEBUG(LOGGER, "TrajOpt Optimization");
   sco::BasicTrustRegionSQP opt(trajopt_problem_);
 
   opt.setParameters(params_);
@@ -271,15 +309,14 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   }
 
   // Optimize
-  ros::WallTime create_time = ros::WallTime::now();
   opt.optimize();
 
-  ROS_INFO(" ======================================= TrajOpt Solution");
+  RCLCPP_DEBUG(LOGGER, "TrajOpt Solution");
   trajopt::TrajArray opt_solution = trajopt::getTraj(opt.x(), trajopt_problem_->GetVars());
 
   // assume that the trajectory is now optimized, fill in the output structure:
-  ROS_INFO_STREAM_NAMED("num_rows", opt_solution.rows());
-  ROS_INFO_STREAM_NAMED("num_cols", opt_solution.cols());
+  RCLCPP_DEBUG(LOGGER, "Solution has %ld rows and %ld columns", static_cast<long>(opt_solution.rows()),
+               static_cast<long>(opt_solution.cols()));
 
   res.trajectory.resize(1);
   res.trajectory[0].joint_trajectory.joint_names = group_joint_names;
@@ -289,59 +326,63 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   res.trajectory[0].joint_trajectory.points.resize(opt_solution.rows());
   for (int i = 0; i < opt_solution.rows(); ++i)
   {
-    res.trajectory[0].joint_trajectory.points[i].positions.resize(opt_solution.cols());
-    for (size_t j = 0; j < opt_solution.cols(); ++j)
+    res.trajectory[0].joint_trajectory.points[i].positions.resize(dof);
+    for (int j = 0; j < dof; ++j)
     {
       res.trajectory[0].joint_trajectory.points[i].positions[j] = opt_solution(i, j);
     }
     // Further filtering is required to set valid timestamps accounting for velocity and acceleration constraints.
-    res.trajectory[0].joint_trajectory.points[i].time_from_start = ros::Duration(0.0);
+    res.trajectory[0].joint_trajectory.points[i].time_from_start = rclcpp::Duration(0, 0);
   }
 
-  res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
-  res.processing_time.push_back((ros::WallTime::now() - start_time).toSec());
+  res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  res.processing_time.push_back((clock.now() - start_time).seconds());
 
-  ROS_INFO(" ======================================= check if final state is within goal tolerances");
+  RCLCPP_DEBUG(LOGGER, "check if final state is within goal tolerances");
   kinematic_constraints::JointConstraint joint_cnt(planning_scene->getRobotModel());
   moveit::core::RobotState last_state(*current_state);
   last_state.setJointGroupPositions(req.group_name, res.trajectory[0].joint_trajectory.points.back().positions);
 
-  for (int jn = 0; jn < res.trajectory[0].joint_trajectory.points.back().positions.size(); ++jn)
-  {
-    ROS_INFO_STREAM_NAMED("joint_value", res.trajectory[0].joint_trajectory.points.back().positions[jn]
-                                             << "   " << req.goal_constraints.back().joint_constraints[jn].position);
-  }
-
-  bool constraints_are_ok = true;
-  int joint_cnt_index = 0;
-  for (const moveit_msgs::JointConstraint& constraint : req.goal_constraints.back().joint_constraints)
+  for (const moveit_msgs::msg::JointConstraint& constraint : req.goal_constraints.back().joint_constraints)
   {
-    ROS_INFO("index %i: jc.configure(constraint)=> %d, jc.decide(last_state).satisfied=> %d, tolerance %f",
-             joint_cnt_index, joint_cnt.configure(constraint), joint_cnt.decide(last_state).satisfied,
-             constraint.tolerance_above);
-    constraints_are_ok = constraints_are_ok and joint_cnt.configure(constraint);
-    constraints_are_ok = constraints_are_ok and joint_cnt.decide(last_state).satisfied;
-    if (not constraints_are_ok)
+    if (!joint_cnt.configure(constraint) || !joint_cnt.decide(last_state).satisfied)
     {
-      ROS_ERROR_STREAM_NAMED("trajopt_planner", "Goal constraints are violated: " << constraint.joint_name);
-      res.error_code.val = moveit_msgs::MoveItErrorCodes::GOAL_CONSTRAINTS_VIOLATED;
+      RCLCPP_ERROR_STREAM(LOGGER, "Goal constraints are violated: " << constraint.joint_name);
+      res.error_code.val = moveit_msgs::msg::MoveItErrorCodes::GOAL_CONSTRAINTS_VIOLATED;
       return false;
     }
-    joint_cnt_index = joint_cnt_index + 1;
   }
 
-  ROS_INFO(" ==================================== Response");
-  res.trajectory_start = req.start_state;
+  // Keep the joint columns of the solution to warm start the next query
+  last_solution_ = opt_solution.leftCols(dof);
 
-  ROS_INFO(" ==================================== Debug Response");
-  ROS_INFO_STREAM_NAMED("group_name", res.group_name);
-  ROS_INFO_STREAM_NAMED("start_traj_name_size", res.trajectory_start.joint_state.name.size());
-  ROS_INFO_STREAM_NAMED("start_traj_position_size", res.trajectory_start.joint_state.position.size());
-  ROS_INFO_STREAM_NAMED("traj_name_size", res.trajectory[0].joint_trajectory.joint_names.size());
-  ROS_INFO_STREAM_NAMED("traj_point_size", res.trajectory[0].joint_trajectory.points.size());
+  res.trajectory_start = req.start_state;
+  RCLCPP_DEBUG(LOGGER, "Response has %zu trajectory points", res.trajectory[0].joint_trajectory.points.size());
   return true;
 }
 
+trajopt::TrajArray TrajOptInterface::warmStartTrajectory(const trajopt::DblVec& start_joint_values,
+                                                         const trajopt::DblVec& goal_joint_values, int n_steps) const
+{
+  const int dof = start_joint_values.size();
+  if (last_solution_.rows() != n_steps || last_solution_.cols() != dof || n_steps < 2 ||
+      static_cast<int>(goal_joint_values.size()) != dof)
+    return trajopt::TrajArray();
+
+  const Eigen::VectorXd start_offset =
+      Eigen::Map<const Eigen::VectorXd>(start_joint_values.data(), dof) - last_solution_.row(0).transpose();
+  const Eigen::VectorXd goal_offset =
+      Eigen::Map<const Eigen::VectorXd>(goal_joint_values.data(), dof) - last_solution_.row(n_steps - 1).transpose();
+
+  trajopt::TrajArray warm_start = last_solution_;
+  for (int i = 0; i < n_steps; ++i)
+  {
+    const double s = static_cast<double>(i) / (n_steps - 1);
+    warm_start.row(i) += ((1.0 - s) * start_offset + s * goal_offset).transpose();
+  }
+  return warm_start;
+}
+
 void TrajOptInterface::setDefaultTrajOPtParams()
 {
   sco::BasicTrustRegionSQPParameters params;
@@ -350,31 +391,35 @@ void TrajOptInterface::setDefaultTrajOPtParams()
 
 void TrajOptInterface::setTrajOptParams(sco::BasicTrustRegionSQPParameters& params)
 {
-  nh_.param("trajopt_param/improve_ratio_threshold", params.improve_ratio_threshold, 0.25);
-  nh_.param("trajopt_param/min_trust_box_size", params.min_trust_box_size, 1e-4);
-  nh_.param("trajopt_param/min_approx_improve", params.min_approx_improve, 1e-4);
-  nh_.param("trajopt_param/min_approx_improve_frac", params.min_approx_improve_frac, -static_cast<double>(INFINITY));
-  nh_.param("trajopt_param/max_iter", params.max_iter, 100.0);
-  nh_.param("trajopt_param/trust_shrink_ratio", params.trust_shrink_ratio, 0.1);
-
-  nh_.param("trajopt_param/trust_expand_ratio", params.trust_expand_ratio, 1.5);
-  nh_.param("trajopt_param/cnt_tolerance", params.cnt_tolerance, 1e-4);
-  nh_.param("trajopt_param/max_merit_coeff_increases", params.max_merit_coeff_increases, 5.0);
-  nh_.param("trajopt_param/merit_coeff_increase_ratio", params.merit_coeff_increase_ratio, 10.0);
-  nh_.param("trajopt_param/max_time", params.max_time, static_cast<double>(INFINITY));
-  nh_.param("trajopt_param/merit_error_coeff", params.merit_error_coeff, 10.0);
-  nh_.param("trajopt_param/trust_box_size", params.trust_box_size, 1e-1);
+  const std::string prefix = "trajopt.trajopt_param.";
+  node_->get_parameter_or(prefix + "improve_ratio_threshold", params.improve_ratio_threshold, 0.25);
+  node_->get_parameter_or(prefix + "min_trust_box_size", params.min_trust_box_size, 1e-4);
+  node_->get_parameter_or(prefix + "min_approx_improve", params.min_approx_improve, 1e-4);
+  node_->get_parameter_or(prefix + "min_approx_improve_frac", params.min_approx_improve_frac,
+                          -std::numeric_limits<double>::infinity());
+  node_->get_parameter_or(prefix + "max_iter", params.max_iter, 100.0);
+  node_->get_parameter_or(prefix + "trust_shrink_ratio", params.trust_shrink_ratio, 0.1);
+
+  node_->get_parameter_or(prefix + "trust_expand_ratio", params.trust_expand_ratio, 1.5);
+  node_->get_parameter_or(prefix + "cnt_tolerance", params.cnt_tolerance, 1e-4);
+  node_->get_parameter_or(prefix + "max_merit_coeff_increases", params.max_merit_coeff_increases, 5.0);
+  node_->get_parameter_or(prefix + "merit_coeff_increase_ratio", params.merit_coeff_increase_ratio, 10.0);
+  node_->get_parameter_or(prefix + "max_time", params.max_time, std::numeric_limits<double>::infinity());
+  node_->get_parameter_or(prefix + "merit_error_coeff", params.merit_error_coeff, 10.0);
+  node_->get_parameter_or(prefix + "trust_box_size", params.trust_box_size, 1e-1);
 }
 
 void TrajOptInterface::setProblemInfoParam(ProblemInfo& problem_info)
 {
-  nh_.param("problem_info/basic_info/n_steps", problem_info.basic_info.n_steps, 20);
-  nh_.param("problem_info/basic_info/dt_upper_lim", problem_info.basic_info.dt_upper_lim, 2.0);
-  nh_.param("problem_info/basic_info/dt_lower_lim", problem_info.basic_info.dt_lower_lim, 100.0);
-  nh_.param("problem_info/basic_info/start_fixed", problem_info.basic_info.start_fixed, true);
-  nh_.param("problem_info/basic_info/use_time", problem_info.basic_info.use_time, false);
+  const std::string prefix = "trajopt.problem_info.";
+  node_->get_parameter_or(prefix + "basic_info.n_steps", problem_info.basic_info.n_steps, 20);
+  node_->get_parameter_or(prefix + "basic_info.dt_upper_lim", problem_info.basic_info.dt_upper_lim, 2.0);
+  node_->get_parameter_or(prefix + "basic_info.dt_lower_lim", problem_info.basic_info.dt_lower_lim, 100.0);
+  node_->get_parameter_or(prefix + "basic_info.start_fixed", problem_info.basic_info.start_fixed, true);
+  node_->get_parameter_or(prefix + "basic_info.use_time", problem_info.basic_info.use_time, false);
   int convex_solver_index;
-  nh_.param("problem_info/basic_info/convex_solver", convex_solver_index, 1);
+  // OSQP is shipped with trajopt_sco and needs no commercial license
+  node_->get_parameter_or(prefix + "basic_info.convex_solver", convex_solver_index, 3);
   switch (convex_solver_index)
   {
     case 1:
@@ -394,9 +439,9 @@ void TrajOptInterface::setProblemInfoParam(ProblemInfo& problem_info)
       break;
   }
 
-  nh_.param("problem_info/init_info/dt", problem_info.init_info.dt, 0.5);
+  node_->get_parameter_or(prefix + "init_info.dt", problem_info.init_info.dt, 0.5);
   int type_index;
-  nh_.param("problem_info/init_info/type", type_index, 1);
+  node_->get_parameter_or(prefix + "init_info.type", type_index, 1);
   switch (type_index)
   {
     case 1:
@@ -413,9 +458,9 @@ void TrajOptInterface::setProblemInfoParam(ProblemInfo& problem_info)
 
 void TrajOptInterface::setJointPoseTermInfoParams(JointPoseTermInfoPtr& jp, std::string name)
 {
+  const std::string prefix = "trajopt.joint_pos_term_info." + name + ".";
   int term_type_index;
-  std::string term_type_address = "joint_pos_term_info/" + name + "/term_type";
-  nh_.param(term_type_address, term_type_index, 1);
+  node_->get_parameter_or(prefix + "term_type", term_type_index, 1);
 
   switch (term_type_index)
   {
@@ -430,9 +475,19 @@ void TrajOptInterface::setJointPoseTermInfoParams(JointPoseTermInfoPtr& jp, std:
       break;
   }
 
-  nh_.getParam("joint_pos_term_info/" + name + "/first_timestep", jp->first_step);
-  nh_.getParam("joint_pos_term_info/" + name + "/last_timestep", jp->last_step);
-  nh_.getParam("joint_pos_term_info/" + name + "/name", jp->name);
+  node_->get_parameter_or(prefix + "first_timestep", jp->first_step, jp->first_step);
+  node_->get_parameter_or(prefix + "last_timestep", jp->last_step, jp->last_step);
+  node_->get_parameter_or(prefix + "name", jp->name, jp->name);
+}
+
+void TrajOptInterface::setCollisionTermInfoParams(CollisionTermInfoPtr& collision)
+{
+  const std::string prefix = "trajopt.collision.";
+  int term_type_index;
+  node_->get_parameter_or(prefix + "term_type", term_type_index, 1);
+  collision->term_type = (term_type_index == 2) ? TT_CNT : TT_COST;
+  node_->get_parameter_or(prefix + "safety_margin", collision->safety_margin, collision->safety_margin);
+  node_->get_parameter_or(prefix + "coeff", collision->coeff, collision->coeff);
 }
 
 trajopt::DblVec TrajOptInterface::extractStartJointValues(const planning_interface::MotionPlanRequest& req,
@@ -441,15 +496,21 @@ trajopt::DblVec TrajOptInterface::extractStartJointValues(const planning_interfa
   std::unordered_map<std::string, double> all_joints;
   trajopt::DblVec start_joint_vals;
 
-  for (int joint_index = 0; joint_index < req.start_state.joint_state.position.size(); ++joint_index)
+  for (std::size_t joint_index = 0; joint_index < req.start_state.joint_state.position.size(); ++joint_index)
   {
     all_joints[req.start_state.joint_state.name[joint_index]] = req.start_state.joint_state.position[joint_index];
   }
 
-  for (auto joint_name : group_joint_names)
+  for (const auto& joint_name : group_joint_names)
   {
-    ROS_INFO(" joint position from start state, name: %s, value: %f", joint_name.c_str(), all_joints[joint_name]);
-    start_joint_vals.push_back(all_joints[joint_name]);
+    auto it = all_joints.find(joint_name);
+    if (it == all_joints.end())
+    {
+      RCLCPP_ERROR(LOGGER, "Joint %s is missing from the start state", joint_name.c_str());
+      return trajopt::DblVec();
+    }
+    RCLCPP_DEBUG(LOGGER, "joint position from start state, name: %s, value: %f", joint_name.c_str(), it->second);
+    start_joint_vals.push_back(it->second);
   }
 
   return start_joint_vals;
@@ -37,15 +37,24 @@
 */
 
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/robot_state/conversions.h>
 
-#include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
+#include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
 
-#include <class_loader/class_loader.hpp>
+#include <pluginlib/class_list_macros.hpp>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <rclcpp/node.hpp>
 
 #include <trajopt_interface/trajopt_planning_context.h>
 
 namespace trajopt_interface
 {
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("trajopt_planner_manager");
+}  // namespace
+
 class TrajOptPlannerManager : public planning_interface::PlannerManager
 {
 public:
@@ -53,25 +62,21 @@ public:
   {
   }
 
-  bool initialize(const moveit::core::RobotModelConstPtr& model, const std::string& ns) override
+  bool initialize(const moveit::core::RobotModelConstPtr& model, const rclcpp::Node::SharedPtr& node,
+                  const std::string& /* unused */) override
   {
-    ROS_INFO(" ======================================= initialize gets called");
-
-    if (!ns.empty())
-      nh_ = ros::NodeHandle(ns);
-    std::string trajopt_ns = ns.empty() ? "trajopt" : ns + "/trajopt";
-
     for (const std::string& gpName : model->getJointModelGroupNames())
     {
-      ROS_INFO(" ======================================= group name: %s, robot model: %s", gpName.c_str(),
-               model->getName().c_str());
-      planning_contexts_[gpName] = std::make_shared<TrajOptPlanningContext>("trajopt_planning_context", gpName, model);
+      RCLCPP_DEBUG(LOGGER, "Creating TrajOpt planning context for group %s of robot model %s", gpName.c_str(),
+                   model->getName().c_str());
+      planning_contexts_[gpName] =
+          std::make_shared<TrajOptPlanningContext>("trajopt_planning_context", gpName, model, node);
     }
 
     return true;
   }
 
-  bool canServiceRequest(const moveit_msgs::MotionPlanRequest& req) const override
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& req) const override
   {
     return req.trajectory_constraints.constraints.empty();
   }
@@ -87,49 +92,54 @@ public:
     algs.push_back("trajopt");
   }
 
-  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                                            const planning_interface::MotionPlanRequest& req,
-                                                            moveit_msgs::MoveItErrorCodes& error_code) const override
+  planning_interface::PlanningContextPtr
+  getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                     const planning_interface::MotionPlanRequest& req,
+                     moveit_msgs::msg::MoveItErrorCodes& error_code) const override
   {
-    ROS_INFO(" ======================================= getPlanningContext() is called ");
-    error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
 
     if (req.group_name.empty())
     {
-      ROS_ERROR("No group specified to plan for");
-      error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
+      RCLCPP_ERROR(LOGGER, "No group specified to plan for");
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GROUP_NAME;
       return planning_interface::PlanningContextPtr();
     }
 
     if (!planning_scene)
     {
-      ROS_ERROR("No planning scene supplied as input");
-      error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+      RCLCPP_ERROR(LOGGER, "No planning scene supplied as input");
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
       return planning_interface::PlanningContextPtr();
     }
 
-    // create PlanningScene using hybrid collision detector
+    auto context_it = planning_contexts_.find(req.group_name);
+    if (context_it == planning_contexts_.end())
+    {
+      RCLCPP_ERROR(LOGGER, "No planning context for group %s", req.group_name.c_str());
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_GROUP_NAME;
+      return planning_interface::PlanningContextPtr();
+    }
+
+    // The collision term uses continuous collision checking between consecutive time steps, which Bullet provides
     planning_scene::PlanningScenePtr ps = planning_scene->diff();
+    ps->allocateCollisionDetector(collision_detection::CollisionDetectorAllocatorBullet::create());
 
-    // set FCL for the collision
-    ps->allocateCollisionDetector(collision_detection::CollisionDetectorAllocatorFCL::create());
+    // The problem is built around the current state of the scene, so make it the requested start state
+    moveit::core::RobotState start_state = ps->getCurrentState();
+    moveit::core::robotStateMsgToRobotState(req.start_state, start_state);
+    ps->setCurrentState(start_state);
 
     // retrieve and configure existing context
-    const TrajOptPlanningContextPtr& context = planning_contexts_.at(req.group_name);
-
-    ROS_INFO(" ======================================= context is made ");
-
+    const TrajOptPlanningContextPtr& context = context_it->second;
     context->setPlanningScene(ps);
     context->setMotionPlanRequest(req);
 
-    error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
 
     return context;
   }
 
-private:
-  ros::NodeHandle nh_;
-
 protected:
   std::map<std::string, TrajOptPlanningContextPtr> planning_contexts_;
 };
@@ -137,4 +147,4 @@ protected:
 }  // namespace trajopt_interface
 
 // register the TrajOptPlannerManager class as a plugin
-CLASS_LOADER_REGISTER_CLASS(trajopt_interface::TrajOptPlannerManager, planning_interface::PlannerManager);
+PLUGINLIB_EXPORT_CLASS(trajopt_interface::TrajOptPlannerManager, planning_interface::PlannerManager)
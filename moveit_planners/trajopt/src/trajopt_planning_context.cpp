@@ -1,9 +1,10 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/planning_interface/planning_interface.h>
-#include <moveit_msgs/MotionPlanRequest.h>
+#include <moveit_msgs/msg/motion_plan_request.hpp>
 #include <moveit/planning_scene/planning_scene.h>
 
-#include <ros/console.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
 
 #include <Eigen/Geometry>
 
@@ -12,17 +13,22 @@
 
 namespace trajopt_interface
 {
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("trajopt_planning_context");
+}  // namespace
+
 TrajOptPlanningContext::TrajOptPlanningContext(const std::string& context_name, const std::string& group_name,
-                                               const moveit::core::RobotModelConstPtr& model)
+                                               const moveit::core::RobotModelConstPtr& model,
+                                               const rclcpp::Node::SharedPtr& node)
   : planning_interface::PlanningContext(context_name, group_name), robot_model_(model)
 {
-  ROS_INFO(" ======================================= TrajOptPlanningContext is constructed");
-  trajopt_interface_ = std::make_shared<TrajOptInterface>();
+  trajopt_interface_ = std::make_shared<TrajOptInterface>(node);
 }
 
 bool TrajOptPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& res)
 {
-  moveit_msgs::MotionPlanDetailedResponse res_msg;
+  moveit_msgs::msg::MotionPlanDetailedResponse res_msg;
   bool trajopt_solved = trajopt_interface_->solve(planning_scene_, request_, res_msg);
 
   if (trajopt_solved)
@@ -65,7 +71,7 @@ bool TrajOptPlanningContext::solve(planning_interface::MotionPlanResponse& res)
 
 bool TrajOptPlanningContext::terminate()
 {
-  ROS_ERROR_STREAM_NAMED("trajopt_planning_context", "TrajOpt is not interruptible yet");
+  RCLCPP_ERROR(LOGGER, "TrajOpt is not interruptible yet");
   return false;
 }
 void TrajOptPlanningContext::clear()
@@ -16,7 +16,8 @@
 #include <cmath>
 
 // ROS
-#include <ros/ros.h>
+#include <rclcpp/rclcpp.hpp>
+#include <pluginlib/class_loader.hpp>
 
 // Testing
 #include <gtest/gtest.h>
@@ -36,7 +37,7 @@
 #include <moveit/move_group_interface/move_group_interface.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
-#include <moveit_msgs/MotionPlanResponse.h>
+#include <moveit_msgs/msg/motion_plan_response.hpp>
 
 class TrajectoryTest : public ::testing::Test
 {
@@ -48,11 +49,11 @@ public:
 protected:
   void SetUp() override
   {
-    node_handle_ = ros::NodeHandle("~");
+    rclcpp::NodeOptions node_options;
+    node_options.automatically_declare_parameters_from_overrides(true);
+    node_ = rclcpp::Node::make_shared("trajectory_test", node_options);
     robot_model_ = moveit::core::loadTestingRobotModel("panda");
-    bool robot_model_ok_ = static_cast<bool>(robot_model_);
-    if (!robot_model_ok_)
-      ROS_ERROR_STREAM_NAMED("trajectory_test", "robot model is not loaded correctly");
+    ASSERT_TRUE(static_cast<bool>(robot_model_)) << "robot model is not loaded correctly";
   }
 
 protected:
@@ -60,7 +61,7 @@ protected:
   std::vector<std::string> group_joint_names_;
   const std::string PLANNING_GROUP = "panda_arm";
   const double GOAL_TOLERANCE = 0.1;
-  ros::NodeHandle node_handle_;
+  rclcpp::Node::SharedPtr node_;
 };  // class TrajectoryTest
 
 TEST_F(TrajectoryTest, concatVectorValidation)
@@ -88,8 +89,6 @@ TEST_F(TrajectoryTest, concatVectorValidation)
 
 TEST_F(TrajectoryTest, goalTolerance)
 {
-  const std::string NODE_NAME = "trajectory_test";
-
   // Create a RobotState and JointModelGroup to keep track of the current robot pose and planning group
   auto current_state = std::make_shared<moveit::core::RobotState>(robot_model_);
   current_state->setToDefaultValues();
@@ -123,11 +122,12 @@ TEST_F(TrajectoryTest, goalTolerance)
   std::vector<double> goal_joint_values = { 0.8, 0.7, 1, -1.3, 1.9, 2.2, -0.1 };
   goal_state->setJointGroupPositions(joint_model_group, goal_joint_values);
   goal_state->update();
-  moveit_msgs::Constraints joint_goal = kinematic_constraints::constructGoalConstraints(*goal_state, joint_model_group);
+  moveit_msgs::msg::Constraints joint_goal =
+      kinematic_constraints::constructGoalConstraints(*goal_state, joint_model_group);
   req.goal_constraints.push_back(joint_goal);
   req.goal_constraints[0].name = "goal_pos";
   // Set joint tolerance
-  std::vector<moveit_msgs::JointConstraint> goal_joint_constraint = req.goal_constraints[0].joint_constraints;
+  std::vector<moveit_msgs::msg::JointConstraint> goal_joint_constraint = req.goal_constraints[0].joint_constraints;
   for (std::size_t x = 0; x < goal_joint_constraint.size(); ++x)
   {
     req.goal_constraints[0].joint_constraints[x].tolerance_above = 0.001;
@@ -138,14 +138,10 @@ TEST_F(TrajectoryTest, goalTolerance)
   // ======================================================================================
   // We will now construct a loader to load a planner, by name.
   // Note that we are using the ROS pluginlib library here.
-  std::unique_ptr<pluginlib::ClassLoader<planning_interface::PlannerManager>> planner_plugin_loader;
+  std::shared_ptr<pluginlib::ClassLoader<planning_interface::PlannerManager>> planner_plugin_loader;
   planning_interface::PlannerManagerPtr planner_instance;
 
-  std::string planner_plugin_name = "trajopt_interface/TrajOptPlanner";
-  node_handle_.setParam("planning_plugin", planner_plugin_name);
-
-  // Make sure the planner plugin is loaded
-  EXPECT_TRUE(node_handle_.getParam("planning_plugin", planner_plugin_name));
+  const std::string planner_plugin_name = "trajopt_interface/TrajOptPlanner";
   try
   {
     planner_plugin_loader = std::make_shared<pluginlib::ClassLoader<planning_interface::PlannerManager>>(
@@ -153,14 +149,12 @@ TEST_F(TrajectoryTest, goalTolerance)
   }
   catch (pluginlib::PluginlibException& ex)
   {
-    ROS_FATAL_STREAM_NAMED(NODE_NAME, "Exception while creating planning plugin loader " << ex.what());
+    FAIL() << "Exception while creating planning plugin loader " << ex.what();
   }
   try
   {
     planner_instance.reset(planner_plugin_loader->createUnmanagedInstance(planner_plugin_name));
-    if (!planner_instance->initialize(robot_model_, node_handle_.getNamespace()))
-      ROS_FATAL_STREAM_NAMED(NODE_NAME, "Could not initialize planner instance");
-    ROS_INFO_STREAM_NAMED(NODE_NAME, "Using planning interface '" << planner_instance->getDescription() << "'");
+    ASSERT_TRUE(planner_instance->initialize(robot_model_, node_, "")) << "Could not initialize planner instance";
   }
   catch (pluginlib::PluginlibException& ex)
   {
@@ -168,9 +162,8 @@ TEST_F(TrajectoryTest, goalTolerance)
     std::stringstream ss;
     for (std::size_t i = 0; i < classes.size(); ++i)
       ss << classes[i] << " ";
-    ROS_ERROR_STREAM_NAMED(NODE_NAME, "Exception while loading planner '" << planner_plugin_name << "': " << ex.what()
-                                                                          << '\n'
-                                                                          << "Available plugins: " << ss.str());
+    FAIL() << "Exception while loading planner '" << planner_plugin_name << "': " << ex.what() << '\n'
+           << "Available plugins: " << ss.str();
   }
 
   // Create planning context
@@ -181,7 +174,7 @@ TEST_F(TrajectoryTest, goalTolerance)
   context->solve(res);
   EXPECT_EQ(res.error_code_.val, res.error_code_.SUCCESS);
 
-  moveit_msgs::MotionPlanResponse response;
+  moveit_msgs::msg::MotionPlanResponse response;
   res.getMessage(response);
 
   // Check the difference between the last step in the solution and the goal
@@ -190,8 +183,8 @@ TEST_F(TrajectoryTest, goalTolerance)
 
   for (std::size_t joint_index = 0; joint_index < joints_values_last_step.size(); ++joint_index)
   {
-    double goal_error =
-        abs(joints_values_last_step[joint_index] - req.goal_constraints[0].joint_constraints[joint_index].position);
+    double goal_error = std::abs(joints_values_last_step[joint_index] -
+                                 req.goal_constraints[0].joint_constraints[joint_index].position);
     std::cerr << "goal_error: " << goal_error << '\n';
     EXPECT_LT(goal_error, GOAL_TOLERANCE);
   }
@@ -200,13 +193,10 @@ TEST_F(TrajectoryTest, goalTolerance)
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
-  ros::init(argc, argv, "trajectory_test");
-
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+  rclcpp::init(argc, argv);
 
   int result = RUN_ALL_TESTS();
-  ros::shutdown();
+  rclcpp::shutdown();
 
   return result;
 }
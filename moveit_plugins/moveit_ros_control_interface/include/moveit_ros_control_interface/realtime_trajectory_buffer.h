@@ -0,0 +1,138 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <trajectory_msgs/msg/joint_trajectory.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace moveit_ros_control_interface
+{
+/**
+ * \brief A trajectory handover between MoveIt and a ros2_control controller running in the same process.
+ *
+ * MoveIt writes trajectories into the buffer instead of sending them through an action. A companion controller takes
+ * them in its realtime update loop, and reports back the state of their execution. There is one buffer per
+ * controller name, obtained with get(); the companion controller uses its fully qualified name.
+ *
+ * The realtime side (attachConsumer(), detachConsumer(), takeTrajectory(), takeCancelRequest() and reportState()) does
+ * not block or allocate. The buffer keeps its own reference to each written trajectory until the consumer took a newer
+ * one, so a consumer that drops its previous trajectory when taking the next one never frees it in the realtime loop.
+ */
+class RealtimeTrajectoryBuffer
+{
+public:
+  enum class State : std::uint8_t
+  {
+    IDLE,
+    PENDING,  // written, but not taken by the consumer yet
+    EXECUTING,
+    SUCCEEDED,
+    ABORTED,
+    PREEMPTED
+  };
+
+  /// Get the buffer of the controller \e name, which is shared by all users in this process
+  static std::shared_ptr<RealtimeTrajectoryBuffer> get(const std::string& name);
+
+  /// Whether a controller currently consumes the trajectories of this buffer
+  bool isConsumerAttached() const
+  {
+    return consumer_attached_;
+  }
+
+  /// Hand \e trajectory over to the consumer, replacing a trajectory that was not taken yet
+  void writeTrajectory(const trajectory_msgs::msg::JointTrajectory& trajectory);
+
+  /// Ask the consumer to stop executing, and drop a trajectory that was not taken yet
+  void cancel();
+
+  /// Get the state of the execution of the last written trajectory
+  State getState() const;
+
+  /// Wait up to \e timeout for the last written trajectory to finish, or forever if \e timeout is negative
+  State waitForCompletion(const std::chrono::nanoseconds& timeout) const;
+
+  /// Attach or detach the consumer, typically on activation and deactivation of the controller
+  void attachConsumer()
+  {
+    consumer_attached_ = true;
+  }
+  void detachConsumer()
+  {
+    consumer_attached_ = false;
+  }
+
+  /// Take the trajectory that was written since the last call, or nullptr if there is none. Its state is EXECUTING
+  std::shared_ptr<const trajectory_msgs::msg::JointTrajectory> takeTrajectory();
+
+  /// Whether the execution was canceled since the last call
+  bool takeCancelRequest()
+  {
+    return cancel_requested_.exchange(false);
+  }
+
+  /// Report the state of the execution of the trajectory that was taken last
+  void reportState(State state)
+  {
+    state_ = state;
+  }
+
+private:
+  struct Entry
+  {
+    std::uint64_t sequence_;
+    trajectory_msgs::msg::JointTrajectory trajectory_;
+  };
+
+  std::shared_ptr<const Entry> pending_;  // accessed with std::atomic_load(), std::atomic_store() and exchange
+  std::atomic<std::uint64_t> written_sequence_{ 0 };
+  std::atomic<std::uint64_t> taken_sequence_{ 0 };
+  std::atomic<std::uint64_t> canceled_sequence_{ 0 };
+  std::atomic<State> state_{ State::IDLE };
+  std::atomic<bool> cancel_requested_{ false };
+  std::atomic<bool> consumer_attached_{ false };
+
+  std::mutex write_mutex_;  // serializes the writers, never taken by the consumer
+  std::deque<std::shared_ptr<const Entry>> retained_;
+};
+}  // namespace moveit_ros_control_interface
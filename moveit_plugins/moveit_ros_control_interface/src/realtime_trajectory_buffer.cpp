@@ -0,0 +1,120 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit_ros_control_interface/realtime_trajectory_buffer.h>
+
+#include <map>
+#include <thread>
+
+namespace moveit_ros_control_interface
+{
+namespace
+{
+// the granularity at which the non-realtime side polls the state reported by the consumer
+constexpr std::chrono::milliseconds POLL_PERIOD(1);
+}  // namespace
+
+std::shared_ptr<RealtimeTrajectoryBuffer> RealtimeTrajectoryBuffer::get(const std::string& name)
+{
+  static std::mutex registry_mutex;
+  static std::map<std::string, std::shared_ptr<RealtimeTrajectoryBuffer>> registry;
+
+  std::scoped_lock slock(registry_mutex);
+  std::shared_ptr<RealtimeTrajectoryBuffer>& buffer = registry[name];
+  if (!buffer)
+    buffer = std::make_shared<RealtimeTrajectoryBuffer>();
+  return buffer;
+}
+
+void RealtimeTrajectoryBuffer::writeTrajectory(const trajectory_msgs::msg::JointTrajectory& trajectory)
+{
+  std::scoped_lock slock(write_mutex_);
+  auto entry = std::make_shared<Entry>();
+  entry->sequence_ = written_sequence_ + 1;
+  entry->trajectory_ = trajectory;
+
+  // the consumer released the trajectories before the one it took last
+  while (!retained_.empty() && retained_.front()->sequence_ < taken_sequence_)
+    retained_.pop_front();
+  retained_.push_back(entry);
+
+  std::atomic_store(&pending_, std::shared_ptr<const Entry>(entry));
+  written_sequence_ = entry->sequence_;
+}
+
+void RealtimeTrajectoryBuffer::cancel()
+{
+  std::scoped_lock slock(write_mutex_);
+  std::atomic_store(&pending_, std::shared_ptr<const Entry>());
+  canceled_sequence_ = written_sequence_.load();
+  cancel_requested_ = true;
+}
+
+RealtimeTrajectoryBuffer::State RealtimeTrajectoryBuffer::getState() const
+{
+  // read the state before the sequence, the consumer updates them in the opposite order
+  const State state = state_;
+  const std::uint64_t taken = taken_sequence_;
+  const std::uint64_t written = written_sequence_;
+  if (taken < written)
+    return canceled_sequence_ >= written ? State::PREEMPTED : State::PENDING;
+  return state;
+}
+
+RealtimeTrajectoryBuffer::State
+RealtimeTrajectoryBuffer::waitForCompletion(const std::chrono::nanoseconds& timeout) const
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  State state = getState();
+  while (state == State::PENDING || state == State::EXECUTING)
+  {
+    if (timeout.count() >= 0 && std::chrono::steady_clock::now() >= deadline)
+      break;
+    std::this_thread::sleep_for(POLL_PERIOD);
+    state = getState();
+  }
+  return state;
+}
+
+std::shared_ptr<const trajectory_msgs::msg::JointTrajectory> RealtimeTrajectoryBuffer::takeTrajectory()
+{
+  std::shared_ptr<const Entry> entry = std::atomic_exchange(&pending_, std::shared_ptr<const Entry>());
+  if (!entry)
+    return nullptr;
+  state_ = State::EXECUTING;
+  taken_sequence_ = entry->sequence_;
+  return std::shared_ptr<const trajectory_msgs::msg::JointTrajectory>(entry, &entry->trajectory_);
+}
+}  // namespace moveit_ros_control_interface
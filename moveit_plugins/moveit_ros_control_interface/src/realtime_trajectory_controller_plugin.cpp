@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit_ros_control_interface/ControllerHandle.h>
+#include <moveit_ros_control_interface/realtime_trajectory_buffer.h>
+#include <pluginlib/class_list_macros.hpp>
+#include <rclcpp/logging.hpp>
+#include <memory>
+
+namespace moveit_ros_control_interface
+{
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.plugins.ros_control_interface.realtime_trajectory");
+}  // namespace
+
+/**
+ * \brief Controller handle that hands trajectories to a ros2_control controller in the same process, through a
+ * RealtimeTrajectoryBuffer instead of an action.
+ */
+class RealtimeTrajectoryControllerHandle : public moveit_controller_manager::MoveItControllerHandle
+{
+public:
+  RealtimeTrajectoryControllerHandle(const std::string& name)
+    : moveit_controller_manager::MoveItControllerHandle(name), buffer_(RealtimeTrajectoryBuffer::get(name))
+  {
+  }
+
+  bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override
+  {
+    if (!trajectory.multi_dof_joint_trajectory.points.empty())
+    {
+      RCLCPP_ERROR(LOGGER, "%s cannot execute multi-dof trajectories.", name_.c_str());
+      return false;
+    }
+    if (!buffer_->isConsumerAttached())
+    {
+      RCLCPP_ERROR(LOGGER, "No realtime controller consumes the trajectories of %s in this process.", name_.c_str());
+      return false;
+    }
+    buffer_->writeTrajectory(trajectory.joint_trajectory);
+    return true;
+  }
+
+  bool canUpdateTrajectory() const override
+  {
+    return true;
+  }
+
+  bool updateTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override
+  {
+    const RealtimeTrajectoryBuffer::State state = buffer_->getState();
+    if (state != RealtimeTrajectoryBuffer::State::PENDING && state != RealtimeTrajectoryBuffer::State::EXECUTING)
+      return false;
+    return sendTrajectory(trajectory);
+  }
+
+  bool cancelExecution() override
+  {
+    buffer_->cancel();
+    return true;
+  }
+
+  bool waitForExecution(const rclcpp::Duration& timeout) override
+  {
+    const RealtimeTrajectoryBuffer::State state =
+        buffer_->waitForCompletion(std::chrono::nanoseconds(timeout.nanoseconds()));
+    return state != RealtimeTrajectoryBuffer::State::PENDING && state != RealtimeTrajectoryBuffer::State::EXECUTING;
+  }
+
+  moveit_controller_manager::ExecutionStatus getLastExecutionStatus() override
+  {
+    switch (buffer_->getState())
+    {
+      case RealtimeTrajectoryBuffer::State::PENDING:
+      case RealtimeTrajectoryBuffer::State::EXECUTING:
+        return moveit_controller_manager::ExecutionStatus::RUNNING;
+      case RealtimeTrajectoryBuffer::State::SUCCEEDED:
+        return moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+      case RealtimeTrajectoryBuffer::State::ABORTED:
+        return moveit_controller_manager::ExecutionStatus::ABORTED;
+      case RealtimeTrajectoryBuffer::State::PREEMPTED:
+        return moveit_controller_manager::ExecutionStatus::PREEMPTED;
+      default:
+        return moveit_controller_manager::ExecutionStatus::UNKNOWN;
+    }
+  }
+
+private:
+  const std::shared_ptr<RealtimeTrajectoryBuffer> buffer_;
+};
+
+/**
+ * \brief Allocator for RealtimeTrajectoryControllerHandle instances.
+ */
+class RealtimeTrajectoryControllerAllocator : public ControllerHandleAllocator
+{
+public:
+  moveit_controller_manager::MoveItControllerHandlePtr alloc(const rclcpp::Node::SharedPtr& /* node */,
+                                                             const std::string& name,
+                                                             const std::vector<std::string>& /* resources */) override
+  {
+    return std::make_shared<RealtimeTrajectoryControllerHandle>(name);
+  }
+};
+
+}  // namespace moveit_ros_control_interface
+
+PLUGINLIB_EXPORT_CLASS(moveit_ros_control_interface::RealtimeTrajectoryControllerAllocator,
+                       moveit_ros_control_interface::ControllerHandleAllocator);
@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <moveit_ros_control_interface/realtime_trajectory_buffer.h>
+
+using moveit_ros_control_interface::RealtimeTrajectoryBuffer;
+
+namespace
+{
+trajectory_msgs::msg::JointTrajectory makeTrajectory(const std::string& joint)
+{
+  trajectory_msgs::msg::JointTrajectory trajectory;
+  trajectory.joint_names.push_back(joint);
+  trajectory.points.resize(2);
+  return trajectory;
+}
+}  // namespace
+
+TEST(RealtimeTrajectoryBuffer, SharedByName)
+{
+  EXPECT_EQ(RealtimeTrajectoryBuffer::get("/arm_controller"), RealtimeTrajectoryBuffer::get("/arm_controller"));
+  EXPECT_NE(RealtimeTrajectoryBuffer::get("/arm_controller"), RealtimeTrajectoryBuffer::get("/hand_controller"));
+}
+
+TEST(RealtimeTrajectoryBuffer, HandsOverTrajectories)
+{
+  RealtimeTrajectoryBuffer buffer;
+  EXPECT_EQ(buffer.getState(), RealtimeTrajectoryBuffer::State::IDLE);
+  EXPECT_EQ(buffer.takeTrajectory(), nullptr);
+
+  buffer.writeTrajectory(makeTrajectory("a"));
+  buffer.writeTrajectory(makeTrajectory("b"));
+  EXPECT_EQ(buffer.getState(), RealtimeTrajectoryBuffer::State::PENDING);
+
+  // only the latest trajectory is taken
+  auto trajectory = buffer.takeTrajectory();
+  ASSERT_NE(trajectory, nullptr);
+  EXPECT_EQ(trajectory->joint_names.front(), "b");
+  EXPECT_EQ(buffer.takeTrajectory(), nullptr);
+  EXPECT_EQ(buffer.getState(), RealtimeTrajectoryBuffer::State::EXECUTING);
+  EXPECT_EQ(buffer.waitForCompletion(std::chrono::milliseconds(5)), RealtimeTrajectoryBuffer::State::EXECUTING);
+
+  buffer.reportState(RealtimeTrajectoryBuffer::State::SUCCEEDED);
+  EXPECT_EQ(buffer.waitForCompletion(std::chrono::milliseconds(-1)), RealtimeTrajectoryBuffer::State::SUCCEEDED);
+
+  // a state reported for the previous trajectory does not apply to a newly written one
+  buffer.writeTrajectory(makeTrajectory("c"));
+  EXPECT_EQ(buffer.getState(), RealtimeTrajectoryBuffer::State::PENDING);
+}
+
+TEST(RealtimeTrajectoryBuffer, CancelsPendingTrajectories)
+{
+  RealtimeTrajectoryBuffer buffer;
+  buffer.writeTrajectory(makeTrajectory("a"));
+  buffer.cancel();
+  EXPECT_EQ(buffer.getState(), RealtimeTrajectoryBuffer::State::PREEMPTED);
+  EXPECT_EQ(buffer.takeTrajectory(), nullptr);
+  EXPECT_TRUE(buffer.takeCancelRequest());
+  EXPECT_FALSE(buffer.takeCancelRequest());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
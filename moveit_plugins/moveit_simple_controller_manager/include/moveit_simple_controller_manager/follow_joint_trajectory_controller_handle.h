@@ -61,6 +61,17 @@ public:
 
   bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
 
+  bool canUpdateTrajectory() const override
+  {
+    return true;
+  }
+
+  /**
+   * @brief Sends the trajectory as a new goal, which preempts the current one. The controller replaces the points of
+   * the current trajectory from the time of the first point of the new one on.
+   */
+  bool updateTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
+
   // TODO(JafarAbdi): Revise parameter lookup
   // void configure(XmlRpc::XmlRpcValue& config) override;
 
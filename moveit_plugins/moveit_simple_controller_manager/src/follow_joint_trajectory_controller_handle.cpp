@@ -89,6 +89,17 @@ bool FollowJointTrajectoryControllerHandle::sendTrajectory(const moveit_msgs::ms
   return true;
 }
 
+bool FollowJointTrajectoryControllerHandle::updateTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  if (done_)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "No trajectory is executed by " << name_ << " that could be updated");
+    return false;
+  }
+  // the result of the preempted goal is not requested, so waitForExecution() reports the result of the new goal
+  return sendTrajectory(trajectory);
+}
+
 // TODO(JafarAbdi): Revise parameter lookup
 // void FollowJointTrajectoryControllerHandle::configure(XmlRpc::XmlRpcValue& config)
 //{
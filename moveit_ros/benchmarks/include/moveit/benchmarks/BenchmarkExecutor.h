@@ -136,6 +136,17 @@ protected:
     std::string name;
   };
 
+  /// Statistics of one numeric metric over all runs of a planner for a query
+  struct MetricSummary
+  {
+    std::string query;
+    std::string planner;
+    std::string metric;
+    std::size_t count;
+    double mean;
+    double stddev;
+  };
+
   virtual bool initializeBenchmarks(const BenchmarkOptions& opts, moveit_msgs::msg::PlanningScene& scene_msg,
                                     std::vector<BenchmarkRequest>& queries);
 
@@ -165,6 +176,18 @@ protected:
 
   virtual void writeOutput(const BenchmarkRequest& brequest, const std::string& start_time, double benchmark_duration);
 
+  /// Add the statistics of all numeric metrics of the last benchmarked query to result_summaries_
+  void summarizeResults(const BenchmarkRequest& brequest);
+
+  /// Write result_summaries_ as tab separated values, one metric of one planner and query per line
+  bool writeResultSummaries(const std::string& filename) const;
+
+  /// Read result summaries written by writeResultSummaries()
+  bool readResultSummaries(const std::string& filename, std::vector<MetricSummary>& summaries) const;
+
+  /// Compare result_summaries_ against the baseline, returns false if any metric regressed beyond its tolerance
+  bool compareToBaseline(const std::vector<MetricSummary>& baseline) const;
+
   void shiftConstraintsByOffset(moveit_msgs::msg::Constraints& constraints, const std::vector<double>& offset);
 
   /// Check that the desired planner plugins and algorithms exist for the given group
@@ -215,6 +238,7 @@ protected:
   std::map<std::string, planning_pipeline::PlanningPipelinePtr> planning_pipelines_;
 
   std::vector<PlannerBenchmarkData> benchmark_data_;
+  std::vector<MetricSummary> result_summaries_;
 
   std::vector<PreRunEventFunction> pre_event_fns_;
   std::vector<PostRunEventFunction> post_event_fns_;
@@ -66,6 +66,10 @@ public:
 
   /** \brief Get the specified number of benchmark query runs */
   int getNumRuns() const;
+  /** \brief Get the number of threads the runs of a planner are distributed over */
+  int getNumWorkers() const;
+  /** \brief Whether each worker thread is pinned to its own CPU */
+  bool getPinWorkers() const;
   /** \brief Get the maximum timeout per planning attempt */
   double getTimeout() const;
   /** \brief Get the reference name of the benchmark */
@@ -100,6 +104,19 @@ public:
   /* \brief Get the parameter set of the planning workspace */
   const moveit_msgs::msg::WorkspaceParameters& getWorkspaceParameters() const;
 
+  /** \brief Get the file the machine-readable result summary is written to, empty if none is written */
+  const std::string& getResultsFile() const;
+  /** \brief Get the result summary of a previous benchmark to compare against, empty if no comparison is done */
+  const std::string& getBaselineFile() const;
+  /** \brief Get the names of the metrics that must not increase compared to the baseline, e.g. "time REAL" */
+  const std::vector<std::string>& getRegressionMetrics() const;
+  /** \brief Get the tolerated increase of a metric's mean relative to the baseline mean */
+  double getMaxRelativeIncrease() const;
+  /** \brief Get the tolerated absolute drop of the success rate compared to the baseline */
+  double getMaxSuccessRateDrop() const;
+  /** \brief Get the z-score of the confidence interval a regression must exceed the tolerance with */
+  double getConfidenceZScore() const;
+
 protected:
   void readBenchmarkOptions(const rclcpp::Node::SharedPtr& node);
 
@@ -109,6 +126,7 @@ protected:
 
   void readWorkspaceParameters(const rclcpp::Node::SharedPtr& node);
   void readGoalOffset(const rclcpp::Node::SharedPtr& node);
+  void readRegressionOptions(const rclcpp::Node::SharedPtr& node);
 
   /// warehouse parameters
   std::string hostname_;
@@ -117,6 +135,8 @@ protected:
 
   /// benchmark parameters
   int runs_;
+  int workers_;
+  bool pin_workers_;
   double timeout_;
   std::string benchmark_name_;
   std::string group_name_;
@@ -134,5 +154,13 @@ protected:
   std::map<std::string, std::vector<std::string>> planning_pipelines_;
 
   moveit_msgs::msg::WorkspaceParameters workspace_;
+
+  /// regression tracking parameters
+  std::string results_file_;
+  std::string baseline_file_;
+  std::vector<std::string> regression_metrics_;
+  double max_relative_increase_;
+  double max_success_rate_drop_;
+  double confidence_z_score_;
 };
 }  // namespace moveit_ros_benchmarks
@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/controller_manager/controller_manager.h>
+#include <rclcpp/node.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moveit_ros_benchmarks
+{
+/** \brief A trajectory that was received by a simulated controller */
+struct SimulatedCommand
+{
+  /** \brief The name of the controller */
+  std::string controller;
+  /** \brief When the trajectory was received */
+  std::chrono::steady_clock::time_point time;
+  /** \brief Whether the trajectory replaced the one that was executed (see updateTrajectory()) */
+  bool update = false;
+};
+
+/** \brief The commands received by all controllers of a SimulatedControllerManager */
+class SimulatedCommandLog
+{
+public:
+  void add(const SimulatedCommand& command);
+  std::vector<SimulatedCommand> get() const;
+  void clear();
+
+private:
+  std::vector<SimulatedCommand> commands_;
+  mutable std::mutex mutex_;
+};
+
+/** \brief A controller that completes each trajectory after its duration, without moving anything */
+class SimulatedControllerHandle : public moveit_controller_manager::MoveItControllerHandle
+{
+public:
+  SimulatedControllerHandle(const std::string& name, const rclcpp::Node::SharedPtr& node,
+                            const std::shared_ptr<SimulatedCommandLog>& log, double command_latency);
+
+  bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
+  bool canUpdateTrajectory() const override
+  {
+    return true;
+  }
+  bool updateTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
+  bool cancelExecution() override;
+  bool waitForExecution(const rclcpp::Duration& timeout = rclcpp::Duration::from_nanoseconds(-1)) override;
+  moveit_controller_manager::ExecutionStatus getLastExecutionStatus() override;
+
+private:
+  /** \brief Start executing \e trajectory, which ends command_latency_ after its last point */
+  void startTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory, bool update);
+
+  rclcpp::Node::SharedPtr node_;
+  std::shared_ptr<SimulatedCommandLog> log_;
+  std::chrono::duration<double> command_latency_;
+
+  std::chrono::steady_clock::time_point end_time_;
+  moveit_controller_manager::ExecutionStatus status_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+/** \brief A controller manager plugin with simulated controllers, to measure the latency of the execution pipeline.
+
+    The controllers are configured with the parameters simulated_controller_manager.controller_names and
+    simulated_controller_manager.<controller>.joints. The parameter simulated_controller_manager.command_latency delays
+    the completion of every trajectory, e.g. to emulate the transport to real controllers. */
+class SimulatedControllerManager : public moveit_controller_manager::MoveItControllerManager
+{
+public:
+  SimulatedControllerManager();
+
+  void initialize(const rclcpp::Node::SharedPtr& node) override;
+  moveit_controller_manager::MoveItControllerHandlePtr getControllerHandle(const std::string& name) override;
+  void getControllersList(std::vector<std::string>& names) override;
+  void getActiveControllers(std::vector<std::string>& names) override;
+  void getControllerJoints(const std::string& name, std::vector<std::string>& joints) override;
+  ControllerState getControllerState(const std::string& name) override;
+  bool switchControllers(const std::vector<std::string>& activate, const std::vector<std::string>& deactivate) override;
+
+  /** \brief The commands that were received by the controllers */
+  const std::shared_ptr<SimulatedCommandLog>& getCommandLog() const
+  {
+    return log_;
+  }
+
+private:
+  std::shared_ptr<SimulatedCommandLog> log_;
+  std::map<std::string, std::vector<std::string>> controller_joints_;
+  std::map<std::string, moveit_controller_manager::MoveItControllerHandlePtr> handles_;
+};
+}  // namespace moveit_ros_benchmarks
@@ -36,6 +36,7 @@
 
 #include <moveit/benchmarks/BenchmarkExecutor.h>
 #include <moveit/utils/lexical_casts.h>
+#include <moveit/utils/performance_counters.h>
 #include <moveit/version.h>
 #include <tf2_eigen/tf2_eigen.hpp>
 
@@ -50,6 +51,15 @@
 #include <math.h>
 #include <limits>
 #include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 #ifndef _WIN32
 #include <unistd.h>
 #else
@@ -78,6 +88,22 @@ boost::posix_time::ptime toBoost(const std::chrono::time_point<Clock, Duration>&
 #endif
 }
 
+// Restrict the thread to a single CPU to reduce timing noise from migrations, the CPUs are assigned round robin
+static void pinThreadToCpu(std::thread& thread, std::size_t index)
+{
+#ifdef __linux__
+  const unsigned int num_cpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(index % num_cpus, &cpu_set);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set) != 0)
+    RCLCPP_WARN(LOGGER, "Failed to pin benchmark worker %zu to CPU %zu", index, index % num_cpus);
+#else
+  (void)thread;
+  RCLCPP_WARN_ONCE(LOGGER, "Pinning benchmark workers to CPUs is not supported on this platform (worker %zu)", index);
+#endif
+}
+
 static std::string getHostname()
 {
   static const int BUF_SIZE = 1024;
@@ -180,6 +206,7 @@ void BenchmarkExecutor::clear()
   }
 
   benchmark_data_.clear();
+  result_summaries_.clear();
   pre_event_fns_.clear();
   post_event_fns_.clear();
   planner_start_fns_.clear();
@@ -234,6 +261,8 @@ bool BenchmarkExecutor::runBenchmarks(const BenchmarkOptions& opts)
     if (!queriesAndPlannersCompatible(queries, opts.getPlanningPipelineConfigurations()))
       return false;
 
+    result_summaries_.clear();
+
     for (std::size_t i = 0; i < queries.size(); ++i)
     {
       // Configure planning scene
@@ -263,8 +292,19 @@ bool BenchmarkExecutor::runBenchmarks(const BenchmarkOptions& opts)
         query_end_fn(queries[i].request, planning_scene_);
 
       writeOutput(queries[i], boost::posix_time::to_iso_extended_string(toBoost(start_time)), duration);
+      summarizeResults(queries[i]);
     }
 
+    if (!options_.getResultsFile().empty() && !writeResultSummaries(options_.getResultsFile()))
+      return false;
+
+    if (!options_.getBaselineFile().empty())
+    {
+      std::vector<MetricSummary> baseline;
+      if (!readResultSummaries(options_.getBaselineFile(), baseline))
+        return false;
+      return compareToBaseline(baseline);
+    }
     return true;
   }
   return false;
@@ -627,10 +667,19 @@ bool BenchmarkExecutor::loadQueries(const std::string& regex, const std::string&
   if (regex.empty())
     return true;
 
-  std::vector<std::string> query_names;
+  // stream the queries rather than looking up each one by name
+  const std::size_t num_queries = queries.size();
+  auto add_query = [&queries](const std::string& query_name,
+                              const moveit_warehouse::MotionPlanRequestWithMetadata& planning_query) {
+    BenchmarkRequest query;
+    query.name = query_name;
+    query.request = static_cast<const moveit_msgs::msg::MotionPlanRequest&>(*planning_query);
+    queries.push_back(std::move(query));
+    return true;
+  };
   try
   {
-    pss_->getPlanningQueriesNames(regex, query_names, scene_name);
+    pss_->forEachPlanningQuery(scene_name, regex, add_query);
   }
   catch (std::exception& ex)
   {
@@ -638,30 +687,11 @@ bool BenchmarkExecutor::loadQueries(const std::string& regex, const std::string&
     return false;
   }
 
-  if (query_names.empty())
+  if (queries.size() == num_queries)
   {
     RCLCPP_ERROR(LOGGER, "Scene '%s' has no associated queries", scene_name.c_str());
     return false;
   }
-
-  for (const std::string& query_name : query_names)
-  {
-    moveit_warehouse::MotionPlanRequestWithMetadata planning_query;
-    try
-    {
-      pss_->getPlanningQuery(planning_query, scene_name, query_name);
-    }
-    catch (std::exception& ex)
-    {
-      RCLCPP_ERROR(LOGGER, "Error loading motion planning query '%s': %s", query_name.c_str(), ex.what());
-      continue;
-    }
-
-    BenchmarkRequest query;
-    query.name = query_name;
-    query.request = static_cast<moveit_msgs::msg::MotionPlanRequest>(*planning_query);
-    queries.push_back(query);
-  }
   RCLCPP_INFO(LOGGER, "Loaded queries successfully");
   return true;
 }
@@ -786,6 +816,16 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
 
   boost::progress_display progress(num_planners * runs, std::cout);
 
+  // The runs of each planner are distributed over the workers: worker w solves the runs w, w + num_workers, ... on its
+  // own copy of the planning scene, so that results do not depend on thread scheduling
+  const std::size_t num_workers = std::max(1, std::min(options_.getNumWorkers(), runs));
+  std::vector<planning_scene::PlanningScenePtr> worker_scenes(num_workers, planning_scene_);
+  if (num_workers > 1)
+  {
+    for (planning_scene::PlanningScenePtr& worker_scene : worker_scenes)
+      worker_scene = planning_scene::PlanningScene::clone(planning_scene_);
+  }
+
   // Iterate through all planning pipelines
   for (const std::pair<const std::string, std::vector<std::string>>& pipeline_entry : pipeline_map)
   {
@@ -807,47 +847,98 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
       for (PlannerStartEventFunction& planner_start_fn : planner_start_fns_)
         planner_start_fn(request, planner_data);
 
-      planning_interface::PlanningContextPtr planning_context;
-      if (use_planning_context)
-        planning_context = planning_pipeline->getPlannerManager()->getPlanningContext(planning_scene_, request);
-
-      // Iterate runs
+      // Pre-run events are invoked in order before any run is solved, each run solves the request they produced
+      std::vector<moveit_msgs::msg::MotionPlanRequest> run_requests(runs);
       for (int j = 0; j < runs; ++j)
       {
-        // Pre-run events
         for (PreRunEventFunction& pre_event_fn : pre_event_fns_)
           pre_event_fn(request);
+        run_requests[j] = request;
+      }
 
-        // Solve problem
-        std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+      // Solve all runs, the results are written to slots owned by a single worker only
+      std::vector<double> total_times(runs);
+      std::vector<char> run_solved(runs, false);
+      std::vector<moveit::performance_counters::CounterValues> run_counters(runs);
+      const auto solve_runs = [&, use_planning_context](std::size_t worker) {
+        const planning_scene::PlanningScenePtr& worker_scene = worker_scenes[worker];
+        planning_interface::PlanningContextPtr planning_context;
         if (use_planning_context)
+          planning_context = planning_pipeline->getPlannerManager()->getPlanningContext(worker_scene, request);
+
+        for (std::size_t j = worker; j < static_cast<std::size_t>(runs); j += num_workers)
         {
-          solved[j] = planning_context->solve(responses[j]);
-        }
-        else
-        {
-          // The planning pipeline does not support MotionPlanDetailedResponse
-          planning_interface::MotionPlanResponse response;
-          solved[j] = planning_pipeline->generatePlan(planning_scene_, request, response);
-          responses[j].error_code_ = response.error_code_;
-          if (response.trajectory_)
+          // With a single worker, threads spawned by the planner are counted as well. Concurrent workers can only
+          // count the operations performed on their own thread.
+          const auto get_counters = [num_workers] {
+            return num_workers == 1 ? moveit::performance_counters::getTotalCounterValues() :
+                                      moveit::performance_counters::getThreadCounterValues();
+          };
+          const moveit::performance_counters::CounterValues counters_start = get_counters();
+
+          // Solve problem
+          std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+          if (use_planning_context)
+          {
+            run_solved[j] = planning_context->solve(responses[j]);
+          }
+          else
           {
-            responses[j].description_.push_back("plan");
-            responses[j].trajectory_.push_back(response.trajectory_);
-            responses[j].processing_time_.push_back(response.planning_time_);
+            // The planning pipeline does not support MotionPlanDetailedResponse
+            planning_interface::MotionPlanResponse response;
+            run_solved[j] = planning_pipeline->generatePlan(worker_scene, run_requests[j], response);
+            responses[j].error_code_ = response.error_code_;
+            if (response.trajectory_)
+            {
+              responses[j].description_.push_back("plan");
+              responses[j].trajectory_.push_back(response.trajectory_);
+              responses[j].processing_time_.push_back(response.planning_time_);
+            }
           }
+          std::chrono::duration<double> dt = std::chrono::system_clock::now() - start;
+          total_times[j] = dt.count();
+          run_counters[j] = get_counters() - counters_start;
         }
-        std::chrono::duration<double> dt = std::chrono::system_clock::now() - start;
-        double total_time = dt.count();
+      };
 
-        // Collect data
-        start = std::chrono::system_clock::now();
+      if (num_workers == 1)
+      {
+        solve_runs(0);
+      }
+      else
+      {
+        std::vector<std::thread> workers;
+        for (std::size_t worker = 0; worker < num_workers; ++worker)
+        {
+          workers.emplace_back(solve_runs, worker);
+          if (options_.getPinWorkers())
+            pinThreadToCpu(workers.back(), worker);
+        }
+        for (std::thread& worker : workers)
+          worker.join();
+      }
+
+      // Collect data of all runs in order
+      for (int j = 0; j < runs; ++j)
+      {
+        solved[j] = run_solved[j];
+        std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
 
         // Post-run events
         for (PostRunEventFunction& post_event_fn : post_event_fns_)
-          post_event_fn(request, responses[j], planner_data[j]);
-        collectMetrics(planner_data[j], responses[j], solved[j], total_time);
-        dt = std::chrono::system_clock::now() - start;
+          post_event_fn(run_requests[j], responses[j], planner_data[j]);
+        collectMetrics(planner_data[j], responses[j], solved[j], total_times[j]);
+#ifdef MOVEIT_ENABLE_PERFORMANCE_COUNTERS
+        for (std::size_t i = 0; i < moveit::performance_counters::NUM_COUNTERS; ++i)
+        {
+          const std::string name =
+              moveit::performance_counters::getCounterName(static_cast<moveit::performance_counters::Counter>(i));
+          planner_data[j][name + " INTEGER"] = std::to_string(run_counters[j].counts[i]);
+          planner_data[j][name + "_time REAL"] =
+              moveit::core::toString(std::chrono::duration<double>(run_counters[j].durations[i]).count());
+        }
+#endif
+        std::chrono::duration<double> dt = std::chrono::system_clock::now() - start;
         double metrics_time = dt.count();
         RCLCPP_DEBUG(LOGGER, "Spent %lf seconds collecting metrics", metrics_time);
 
@@ -1049,6 +1140,185 @@ bool BenchmarkExecutor::computeTrajectoryDistance(const robot_trajectory::RobotT
   return true;
 }
 
+void BenchmarkExecutor::summarizeResults(const BenchmarkRequest& brequest)
+{
+  size_t run_id = 0;
+  for (const std::pair<const std::string, std::vector<std::string>>& pipeline :
+       options_.getPlanningPipelineConfigurations())
+  {
+    for (std::size_t i = 0; i < pipeline.second.size(); ++i, ++run_id)
+    {
+      // Collect the values of all numeric metrics over the runs of this planner
+      std::map<std::string, std::vector<double>> values;
+      for (const PlannerRunData& planner_run_data : benchmark_data_[run_id])
+      {
+        for (const std::pair<const std::string, std::string>& metric : planner_run_data)
+        {
+          if (metric.second == "true" || metric.second == "false")
+          {
+            values[metric.first].push_back(metric.second == "true" ? 1.0 : 0.0);
+            continue;
+          }
+          try
+          {
+            values[metric.first].push_back(moveit::core::toDouble(metric.second));
+          }
+          catch (const std::runtime_error&)
+          {
+            // Not a numeric metric
+          }
+        }
+      }
+
+      for (const std::pair<const std::string, std::vector<double>>& metric_values : values)
+      {
+        const std::vector<double>& v = metric_values.second;
+        MetricSummary summary;
+        summary.query = brequest.name;
+        summary.planner = pipeline.second[i] + " (" + pipeline.first + ")";
+        summary.metric = metric_values.first;
+        summary.count = v.size();
+        summary.mean = std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+        double squared_deviations = 0.0;
+        for (double value : v)
+          squared_deviations += (value - summary.mean) * (value - summary.mean);
+        summary.stddev = v.size() > 1 ? std::sqrt(squared_deviations / (v.size() - 1)) : 0.0;
+        result_summaries_.push_back(summary);
+      }
+    }
+  }
+}
+
+bool BenchmarkExecutor::writeResultSummaries(const std::string& filename) const
+{
+  const std::filesystem::path parent_path = std::filesystem::path(filename).parent_path();
+  if (!parent_path.empty())
+    std::filesystem::create_directories(parent_path);
+
+  std::ofstream out(filename.c_str());
+  if (!out)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to open '%s' for the benchmark result summary", filename.c_str());
+    return false;
+  }
+  out << "# MoveIt version " << MOVEIT_VERSION_STR << '\n';
+  out << "query\tplanner\tmetric\tcount\tmean\tstddev" << '\n';
+  for (const MetricSummary& summary : result_summaries_)
+  {
+    out << summary.query << '\t' << summary.planner << '\t' << summary.metric << '\t' << summary.count << '\t'
+        << moveit::core::toString(summary.mean) << '\t' << moveit::core::toString(summary.stddev) << '\n';
+  }
+  RCLCPP_INFO(LOGGER, "Benchmark result summary saved to '%s'", filename.c_str());
+  return true;
+}
+
+bool BenchmarkExecutor::readResultSummaries(const std::string& filename, std::vector<MetricSummary>& summaries) const
+{
+  std::ifstream in(filename.c_str());
+  if (!in)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to open benchmark baseline '%s'", filename.c_str());
+    return false;
+  }
+
+  summaries.clear();
+  std::string line;
+  bool header_read = false;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (!header_read)
+    {
+      header_read = true;
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream line_stream(line);
+    std::string field;
+    while (std::getline(line_stream, field, '\t'))
+      fields.push_back(field);
+
+    try
+    {
+      if (fields.size() != 6)
+        throw std::runtime_error("unexpected number of fields");
+      MetricSummary summary;
+      summary.query = fields[0];
+      summary.planner = fields[1];
+      summary.metric = fields[2];
+      summary.count = std::stoul(fields[3]);
+      summary.mean = moveit::core::toDouble(fields[4]);
+      summary.stddev = moveit::core::toDouble(fields[5]);
+      summaries.push_back(summary);
+    }
+    catch (const std::exception& e)
+    {
+      RCLCPP_ERROR(LOGGER, "Invalid line in benchmark baseline '%s': %s", filename.c_str(), e.what());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BenchmarkExecutor::compareToBaseline(const std::vector<MetricSummary>& baseline) const
+{
+  const std::vector<std::string>& metrics = options_.getRegressionMetrics();
+  const double z = options_.getConfidenceZScore();
+
+  std::map<std::tuple<std::string, std::string, std::string>, const MetricSummary*> baseline_map;
+  for (const MetricSummary& summary : baseline)
+    baseline_map[std::make_tuple(summary.query, summary.planner, summary.metric)] = &summary;
+
+  std::size_t regressions = 0;
+  for (const MetricSummary& current : result_summaries_)
+  {
+    const bool is_success_rate = current.metric == "solved BOOLEAN";
+    if (!is_success_rate && std::find(metrics.begin(), metrics.end(), current.metric) == metrics.end())
+      continue;
+
+    const auto it = baseline_map.find(std::make_tuple(current.query, current.planner, current.metric));
+    if (it == baseline_map.end())
+    {
+      RCLCPP_WARN(LOGGER, "No baseline for '%s' of planner '%s' on query '%s'", current.metric.c_str(),
+                  current.planner.c_str(), current.query.c_str());
+      continue;
+    }
+    const MetricSummary& base = *it->second;
+
+    // Confidence interval of the difference of both means (Welch), the regression is only reported if even the
+    // lower bound of the interval exceeds the tolerance
+    const double standard_error = std::sqrt(current.stddev * current.stddev / std::max<std::size_t>(current.count, 1) +
+                                            base.stddev * base.stddev / std::max<std::size_t>(base.count, 1));
+    // A success rate regresses if it drops, all other metrics regress if they increase
+    const double difference = is_success_rate ? base.mean - current.mean : current.mean - base.mean;
+    const double tolerance =
+        is_success_rate ? options_.getMaxSuccessRateDrop() : options_.getMaxRelativeIncrease() * std::abs(base.mean);
+    if (difference - z * standard_error > tolerance)
+    {
+      ++regressions;
+      RCLCPP_ERROR(LOGGER, "Regression of '%s' for planner '%s' on query '%s': %f (baseline %f, +/- %f)",
+                   current.metric.c_str(), current.planner.c_str(), current.query.c_str(), current.mean, base.mean,
+                   z * standard_error);
+    }
+    else
+    {
+      RCLCPP_DEBUG(LOGGER, "'%s' for planner '%s' on query '%s': %f (baseline %f, +/- %f)", current.metric.c_str(),
+                   current.planner.c_str(), current.query.c_str(), current.mean, base.mean, z * standard_error);
+    }
+  }
+
+  if (regressions > 0)
+  {
+    RCLCPP_ERROR(LOGGER, "%zu benchmark metrics regressed compared to baseline '%s'", regressions,
+                 options_.getBaselineFile().c_str());
+    return false;
+  }
+  RCLCPP_INFO(LOGGER, "No benchmark regressions compared to baseline '%s'", options_.getBaselineFile().c_str());
+  return true;
+}
+
 void BenchmarkExecutor::writeOutput(const BenchmarkRequest& brequest, const std::string& start_time,
                                     double benchmark_duration)
 {
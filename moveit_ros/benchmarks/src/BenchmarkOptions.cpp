@@ -63,6 +63,7 @@ void BenchmarkOptions::readBenchmarkOptions(const rclcpp::Node::SharedPtr& node)
     readWarehouseOptions(node);
     readBenchmarkParameters(node);
     readPlannerConfigs(node);
+    readRegressionOptions(node);
   }
   else
   {
@@ -90,6 +91,16 @@ int BenchmarkOptions::getNumRuns() const
   return runs_;
 }
 
+int BenchmarkOptions::getNumWorkers() const
+{
+  return workers_;
+}
+
+bool BenchmarkOptions::getPinWorkers() const
+{
+  return pin_workers_;
+}
+
 double BenchmarkOptions::getTimeout() const
 {
   return timeout_;
@@ -173,6 +184,36 @@ const moveit_msgs::msg::WorkspaceParameters& BenchmarkOptions::getWorkspaceParam
   return workspace_;
 }
 
+const std::string& BenchmarkOptions::getResultsFile() const
+{
+  return results_file_;
+}
+
+const std::string& BenchmarkOptions::getBaselineFile() const
+{
+  return baseline_file_;
+}
+
+const std::vector<std::string>& BenchmarkOptions::getRegressionMetrics() const
+{
+  return regression_metrics_;
+}
+
+double BenchmarkOptions::getMaxRelativeIncrease() const
+{
+  return max_relative_increase_;
+}
+
+double BenchmarkOptions::getMaxSuccessRateDrop() const
+{
+  return max_success_rate_drop_;
+}
+
+double BenchmarkOptions::getConfidenceZScore() const
+{
+  return confidence_z_score_;
+}
+
 void BenchmarkOptions::readWarehouseOptions(const rclcpp::Node::SharedPtr& node)
 {
   node->get_parameter_or(std::string("benchmark_config.warehouse.host"), hostname_, std::string("127.0.0.1"));
@@ -190,6 +231,8 @@ void BenchmarkOptions::readBenchmarkParameters(const rclcpp::Node::SharedPtr& no
 {
   node->get_parameter_or(std::string("benchmark_config.parameters.name"), benchmark_name_, std::string(""));
   node->get_parameter_or(std::string("benchmark_config.parameters.runs"), runs_, 10);
+  node->get_parameter_or(std::string("benchmark_config.parameters.workers"), workers_, 1);
+  node->get_parameter_or(std::string("benchmark_config.parameters.pin_workers"), pin_workers_, false);
   node->get_parameter_or(std::string("benchmark_config.parameters.timeout"), timeout_, 10.0);
   node->get_parameter_or(std::string("benchmark_config.parameters.output_directory"), output_directory_,
                          std::string(""));
@@ -221,6 +264,7 @@ void BenchmarkOptions::readBenchmarkParameters(const rclcpp::Node::SharedPtr& no
 
   RCLCPP_INFO(LOGGER, "Benchmark name: '%s'", benchmark_name_.c_str());
   RCLCPP_INFO(LOGGER, "Benchmark #runs: %d", runs_);
+  RCLCPP_INFO(LOGGER, "Benchmark #workers: %d%s", workers_, pin_workers_ ? " (pinned)" : "");
   RCLCPP_INFO(LOGGER, "Benchmark timeout: %f secs", timeout_);
   RCLCPP_INFO(LOGGER, "Benchmark group: %s", group_name_.c_str());
   RCLCPP_INFO(LOGGER, "Benchmark query regex: '%s'", query_regex_.c_str());
@@ -297,3 +341,22 @@ void BenchmarkOptions::readPlannerConfigs(const rclcpp::Node::SharedPtr& node)
     planning_pipelines_[pipeline_name] = planners;
   }
 }
+
+void BenchmarkOptions::readRegressionOptions(const rclcpp::Node::SharedPtr& node)
+{
+  const std::string ns = "benchmark_config.regression.";
+  node->get_parameter_or(ns + "results_file", results_file_, std::string(""));
+  node->get_parameter_or(ns + "baseline_file", baseline_file_, std::string(""));
+  node->get_parameter_or(ns + "metrics", regression_metrics_,
+                         std::vector<std::string>{ "time REAL", "final_path_length REAL" });
+  node->get_parameter_or(ns + "max_relative_increase", max_relative_increase_, 0.1);
+  node->get_parameter_or(ns + "max_success_rate_drop", max_success_rate_drop_, 0.05);
+  // 95% two-sided confidence interval
+  node->get_parameter_or(ns + "confidence_z_score", confidence_z_score_, 1.96);
+
+  if (!results_file_.empty())
+    RCLCPP_INFO(LOGGER, "Benchmark result summary: %s", results_file_.c_str());
+  if (!baseline_file_.empty())
+    RCLCPP_INFO(LOGGER, "Benchmark baseline: %s (max relative increase %f, max success rate drop %f)",
+                baseline_file_.c_str(), max_relative_increase_, max_success_rate_drop_);
+}
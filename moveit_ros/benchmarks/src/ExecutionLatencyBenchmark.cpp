@@ -0,0 +1,264 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Measures the latency of the trajectory execution pipeline with simulated controllers: the time from the execute call
+ * until the first controller command, the stages of the TrajectoryExecutionManager and PlanExecution for each
+ * trajectory, and the gap between consecutive trajectories. */
+
+#include <moveit/benchmarks/SimulatedControllerManager.h>
+#include <moveit/plan_execution/plan_execution.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
+#include <rclcpp/executors.hpp>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <rclcpp/node.hpp>
+#include <rclcpp/node_options.hpp>
+#include <rclcpp/utilities.hpp>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <thread>
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.benchmarks.ExecutionLatencyBenchmark");
+
+static const std::string CONTROLLER_NAME = "simulated_controller";
+
+namespace
+{
+using Samples = std::map<std::string, std::vector<double>>;
+
+/** \brief Create \e count consecutive trajectories between random states of \e group */
+std::vector<robot_trajectory::RobotTrajectoryPtr> createTrajectories(const moveit::core::RobotModelConstPtr& model,
+                                                                     const std::string& group, std::size_t count,
+                                                                     std::size_t waypoints, double duration)
+{
+  const moveit::core::JointModelGroup* jmg = model->getJointModelGroup(group);
+  moveit::core::RobotState start(model);
+  start.setToDefaultValues();
+  start.setToRandomPositions(jmg);
+  moveit::core::RobotState end(start);
+  moveit::core::RobotState waypoint(start);
+
+  std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    end.setToRandomPositions(jmg);
+    auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(model, jmg);
+    const std::size_t num_points = std::max<std::size_t>(2, waypoints);
+    for (std::size_t j = 0; j < num_points; ++j)
+    {
+      const double t = static_cast<double>(j) / static_cast<double>(num_points - 1);
+      start.interpolate(end, t, waypoint, jmg);
+      trajectory->addSuffixWayPoint(waypoint, j == 0 ? 0.0 : duration / static_cast<double>(num_points - 1));
+    }
+    trajectories.push_back(trajectory);
+    start = end;
+  }
+  return trajectories;
+}
+
+/** \brief Add the latency of the trajectory execution manager for the last execution to \e samples */
+void addExecutionLatency(const trajectory_execution_manager::TrajectoryExecutionManager& tem,
+                         const moveit_ros_benchmarks::SimulatedCommandLog& log,
+                         std::chrono::steady_clock::time_point execute_time, double expected_duration,
+                         Samples& samples)
+{
+  // streamed chunks of a trajectory are updates, only the first command of each trajectory is considered
+  std::vector<std::chrono::steady_clock::time_point> command_times;
+  for (const moveit_ros_benchmarks::SimulatedCommand& command : log.get())
+    if (!command.update)
+      command_times.push_back(command.time);
+  if (!command_times.empty())
+    samples["execute_to_first_command"].push_back(
+        std::chrono::duration<double>(command_times.front() - execute_time).count());
+  // the time between the end of a trajectory at the controller and the command of the next one
+  for (std::size_t i = 1; i < command_times.size(); ++i)
+    samples["command_gap"].push_back(
+        std::chrono::duration<double>(command_times[i] - command_times[i - 1]).count() - expected_duration);
+
+  const std::vector<trajectory_execution_manager::TrajectoryExecutionManager::ExecutionLatency> latencies =
+      tem.getLastExecutionLatency();
+  for (std::size_t i = 0; i < latencies.size(); ++i)
+  {
+    samples["tem_preparation"].push_back(latencies[i].preparation);
+    samples["tem_dispatch"].push_back(latencies[i].dispatch);
+    samples["tem_execution_overhead"].push_back(latencies[i].execution - expected_duration);
+    if (i > 0)
+      samples["tem_gap"].push_back(latencies[i].gap);
+  }
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+  const std::size_t index = std::min(sorted.size() - 1, static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  rclcpp::NodeOptions node_options;
+  node_options.allow_undeclared_parameters(true);
+  node_options.automatically_declare_parameters_from_overrides(true);
+  rclcpp::Node::SharedPtr node = rclcpp::Node::make_shared("moveit_execution_latency_benchmark", node_options);
+
+  const std::string group = node->get_parameter_or<std::string>("group", "");
+  const auto repeats = static_cast<std::size_t>(node->get_parameter_or<int>("repeats", 20));
+  const auto num_trajectories = static_cast<std::size_t>(node->get_parameter_or<int>("trajectories", 5));
+  const auto waypoints = static_cast<std::size_t>(node->get_parameter_or<int>("waypoints", 10));
+  const double duration = node->get_parameter_or<double>("trajectory_duration", 0.2);
+  const double command_latency = node->get_parameter_or<double>("command_latency", 0.0);
+  const double streaming_lookahead = node->get_parameter_or<double>("streaming_lookahead", 0.0);
+  const bool use_plan_execution = node->get_parameter_or<bool>("use_plan_execution", false);
+  const std::string output_file = node->get_parameter_or<std::string>("output_file", "");
+
+  auto robot_model_loader = std::make_shared<robot_model_loader::RobotModelLoader>(node);
+  const moveit::core::RobotModelConstPtr& robot_model = robot_model_loader->getModel();
+  if (!robot_model || !robot_model->hasJointModelGroup(group))
+  {
+    RCLCPP_ERROR(LOGGER, "The robot model is not loaded or has no group '%s' (parameter 'group')", group.c_str());
+    return 1;
+  }
+
+  // The trajectory execution manager loads the simulated controllers with the parameters of its node
+  std::vector<rclcpp::Parameter> overrides = {
+    { "moveit_controller_manager", "moveit_ros_benchmarks/SimulatedControllerManager" },
+    { "simulated_controller_manager.controller_names", std::vector<std::string>{ CONTROLLER_NAME } },
+    { "simulated_controller_manager." + CONTROLLER_NAME + ".joints",
+      robot_model->getJointModelGroup(group)->getActiveJointModelNames() },
+    { "simulated_controller_manager.command_latency", command_latency },
+  };
+  rclcpp::NodeOptions execution_node_options = node_options;
+  execution_node_options.parameter_overrides(overrides);
+  auto execution_node = rclcpp::Node::make_shared("moveit_execution_latency_benchmark_execution",
+                                                  execution_node_options);
+  rclcpp::executors::MultiThreadedExecutor executor;
+  executor.add_node(execution_node);
+  std::thread spinner([&executor] { executor.spin(); });
+
+  auto psm = std::make_shared<planning_scene_monitor::PlanningSceneMonitor>(execution_node, robot_model_loader);
+  psm->startStateMonitor();
+  auto tem = std::make_shared<trajectory_execution_manager::TrajectoryExecutionManager>(
+      execution_node, robot_model, psm->getStateMonitor());
+  // nothing reports the state of the simulated controllers, so the start state can not be validated
+  tem->setAllowedStartTolerance(0.0);
+  tem->setStreamingLookahead(streaming_lookahead);
+  plan_execution::PlanExecution plan_execution(execution_node, psm, tem);
+
+  const auto controller_manager =
+      std::dynamic_pointer_cast<moveit_ros_benchmarks::SimulatedControllerManager>(tem->getControllerManager());
+  if (!controller_manager)
+  {
+    RCLCPP_ERROR(LOGGER, "The simulated controller manager could not be loaded");
+    executor.cancel();
+    spinner.join();
+    return 1;
+  }
+  const std::shared_ptr<moveit_ros_benchmarks::SimulatedCommandLog>& log = controller_manager->getCommandLog();
+
+  Samples samples;
+  std::size_t failures = 0;
+  for (std::size_t repeat = 0; repeat < repeats && rclcpp::ok(); ++repeat)
+  {
+    const std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories =
+        createTrajectories(robot_model, group, num_trajectories, waypoints, duration);
+    log->clear();
+
+    bool succeeded = false;
+    const auto start = std::chrono::steady_clock::now();
+    if (use_plan_execution)
+    {
+      plan_execution::ExecutableMotionPlan plan;
+      for (const robot_trajectory::RobotTrajectoryPtr& trajectory : trajectories)
+        plan.plan_components_.emplace_back(trajectory, "benchmark", std::vector<std::string>{ CONTROLLER_NAME });
+      succeeded = plan_execution.executeAndMonitor(plan).val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+      const plan_execution::PlanExecution::ExecutionLatency latency = plan_execution.getLastExecutionLatency();
+      samples["plan_execution_preparation"].push_back(latency.preparation);
+      samples["plan_execution_completion"].push_back(latency.completion);
+    }
+    else
+    {
+      for (const robot_trajectory::RobotTrajectoryPtr& trajectory : trajectories)
+      {
+        moveit_msgs::msg::RobotTrajectory msg;
+        trajectory->getRobotTrajectoryMsg(msg);
+        tem->push(msg, CONTROLLER_NAME);
+      }
+      tem->execute();
+      succeeded = tem->waitForExecution() == moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+    }
+    const std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+
+    if (!succeeded)
+    {
+      ++failures;
+      continue;
+    }
+    samples["total_overhead"].push_back(total.count() - num_trajectories * (duration + command_latency));
+    addExecutionLatency(*tem, *log, start, duration + command_latency, samples);
+  }
+
+  RCLCPP_INFO(LOGGER, "%zu of %zu executions failed", failures, repeats);
+  RCLCPP_INFO(LOGGER, "%-28s %6s %10s %10s %10s %10s", "latency [ms]", "n", "mean", "median", "p95", "max");
+  for (auto& [name, values] : samples)
+  {
+    if (values.empty())
+      continue;
+    std::sort(values.begin(), values.end());
+    const double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    RCLCPP_INFO(LOGGER, "%-28s %6zu %10.3f %10.3f %10.3f %10.3f", name.c_str(), values.size(), 1e3 * mean,
+                1e3 * percentile(values, 0.5), 1e3 * percentile(values, 0.95), 1e3 * values.back());
+  }
+
+  if (!output_file.empty())
+  {
+    std::ofstream out(output_file);
+    out << "metric,seconds" << '\n';
+    for (const auto& [name, values] : samples)
+      for (double value : values)
+        out << name << ',' << value << '\n';
+    RCLCPP_INFO(LOGGER, "Wrote the latency samples to '%s'", output_file.c_str());
+  }
+
+  executor.cancel();
+  spinner.join();
+  rclcpp::shutdown();
+  return failures == 0 ? 0 : 1;
+}
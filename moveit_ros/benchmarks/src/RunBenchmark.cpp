@@ -66,7 +66,15 @@ int main(int argc, char** argv)
 
   // Running benchmarks
   if (!server.runBenchmarks(opts))
+  {
     RCLCPP_ERROR(LOGGER, "Failed to run all benchmarks");
+    // A failed baseline comparison needs to be visible to the caller, e.g. a CI job gating upgrades
+    if (!opts.getBaselineFile().empty())
+    {
+      rclcpp::shutdown();
+      return 1;
+    }
+  }
 
   rclcpp::spin(node);
 }
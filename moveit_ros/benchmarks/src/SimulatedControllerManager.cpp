@@ -0,0 +1,234 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/benchmarks/SimulatedControllerManager.h>
+#include <pluginlib/class_list_macros.hpp>
+#include <rclcpp/logging.hpp>
+#include <algorithm>
+
+namespace moveit_ros_benchmarks
+{
+namespace
+{
+const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.benchmarks.simulated_controller_manager");
+const std::string PARAM_NAMESPACE = "simulated_controller_manager";
+
+rclcpp::Duration getTrajectoryDuration(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  rclcpp::Duration duration = rclcpp::Duration::from_nanoseconds(0);
+  if (!trajectory.joint_trajectory.points.empty())
+    duration = std::max(duration, rclcpp::Duration(trajectory.joint_trajectory.points.back().time_from_start));
+  if (!trajectory.multi_dof_joint_trajectory.points.empty())
+    duration =
+        std::max(duration, rclcpp::Duration(trajectory.multi_dof_joint_trajectory.points.back().time_from_start));
+  return duration;
+}
+}  // namespace
+
+void SimulatedCommandLog::add(const SimulatedCommand& command)
+{
+  std::scoped_lock slock(mutex_);
+  commands_.push_back(command);
+}
+
+std::vector<SimulatedCommand> SimulatedCommandLog::get() const
+{
+  std::scoped_lock slock(mutex_);
+  return commands_;
+}
+
+void SimulatedCommandLog::clear()
+{
+  std::scoped_lock slock(mutex_);
+  commands_.clear();
+}
+
+SimulatedControllerHandle::SimulatedControllerHandle(const std::string& name, const rclcpp::Node::SharedPtr& node,
+                                                     const std::shared_ptr<SimulatedCommandLog>& log,
+                                                     double command_latency)
+  : MoveItControllerHandle(name)
+  , node_(node)
+  , log_(log)
+  , command_latency_(command_latency)
+  , status_(moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+{
+}
+
+bool SimulatedControllerHandle::sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  startTrajectory(trajectory, false);
+  return true;
+}
+
+bool SimulatedControllerHandle::updateTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  startTrajectory(trajectory, true);
+  return true;
+}
+
+void SimulatedControllerHandle::startTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory, bool update)
+{
+  const auto now = std::chrono::steady_clock::now();
+  log_->add({ name_, now, update });
+
+  // trajectories with a header stamp start at that time, all others start right away
+  rclcpp::Duration remaining = getTrajectoryDuration(trajectory);
+  const rclcpp::Time stamp(trajectory.joint_trajectory.header.stamp, node_->get_clock()->get_clock_type());
+  if (stamp.nanoseconds() != 0)
+    remaining = remaining + (stamp - node_->now());
+
+  {
+    std::scoped_lock slock(mutex_);
+    end_time_ = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          command_latency_ + std::chrono::nanoseconds(std::max<int64_t>(0, remaining.nanoseconds())));
+    status_ = moveit_controller_manager::ExecutionStatus::RUNNING;
+  }
+  condition_.notify_all();
+}
+
+bool SimulatedControllerHandle::cancelExecution()
+{
+  {
+    std::scoped_lock slock(mutex_);
+    if (status_ == moveit_controller_manager::ExecutionStatus::RUNNING)
+      status_ = moveit_controller_manager::ExecutionStatus::PREEMPTED;
+  }
+  condition_.notify_all();
+  return true;
+}
+
+bool SimulatedControllerHandle::waitForExecution(const rclcpp::Duration& timeout)
+{
+  std::unique_lock<std::mutex> ulock(mutex_);
+  const auto deadline = timeout.nanoseconds() < 0 ?
+                            std::chrono::steady_clock::time_point::max() :
+                            std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeout.nanoseconds());
+  // an updated trajectory moves the end time, so it is checked again after every notification
+  while (status_ == moveit_controller_manager::ExecutionStatus::RUNNING)
+  {
+    const auto wake_up = std::min(end_time_, deadline);
+    condition_.wait_until(ulock, wake_up);
+    if (status_ != moveit_controller_manager::ExecutionStatus::RUNNING)
+      break;
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= end_time_)
+      status_ = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+    else if (now >= deadline)
+      return false;
+  }
+  return true;
+}
+
+moveit_controller_manager::ExecutionStatus SimulatedControllerHandle::getLastExecutionStatus()
+{
+  std::scoped_lock slock(mutex_);
+  if (status_ == moveit_controller_manager::ExecutionStatus::RUNNING && std::chrono::steady_clock::now() >= end_time_)
+    status_ = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+  return status_;
+}
+
+SimulatedControllerManager::SimulatedControllerManager() : log_(std::make_shared<SimulatedCommandLog>())
+{
+}
+
+void SimulatedControllerManager::initialize(const rclcpp::Node::SharedPtr& node)
+{
+  std::vector<std::string> controller_names;
+  if (!node->get_parameter(PARAM_NAMESPACE + ".controller_names", controller_names))
+    RCLCPP_ERROR(LOGGER, "No controllers configured in '%s.controller_names'", PARAM_NAMESPACE.c_str());
+  double command_latency = 0.0;
+  node->get_parameter(PARAM_NAMESPACE + ".command_latency", command_latency);
+
+  for (const std::string& name : controller_names)
+  {
+    std::vector<std::string> joints;
+    if (!node->get_parameter(PARAM_NAMESPACE + "." + name + ".joints", joints) || joints.empty())
+    {
+      RCLCPP_ERROR(LOGGER, "No joints configured for simulated controller '%s'", name.c_str());
+      continue;
+    }
+    controller_joints_[name] = joints;
+    handles_[name] = std::make_shared<SimulatedControllerHandle>(name, node, log_, command_latency);
+    RCLCPP_INFO(LOGGER, "Added simulated controller '%s' for %zu joints", name.c_str(), joints.size());
+  }
+}
+
+moveit_controller_manager::MoveItControllerHandlePtr
+SimulatedControllerManager::getControllerHandle(const std::string& name)
+{
+  const auto it = handles_.find(name);
+  return it == handles_.end() ? moveit_controller_manager::MoveItControllerHandlePtr() : it->second;
+}
+
+void SimulatedControllerManager::getControllersList(std::vector<std::string>& names)
+{
+  names.clear();
+  for (const auto& [name, joints] : controller_joints_)
+    names.push_back(name);
+}
+
+void SimulatedControllerManager::getActiveControllers(std::vector<std::string>& names)
+{
+  getControllersList(names);
+}
+
+void SimulatedControllerManager::getControllerJoints(const std::string& name, std::vector<std::string>& joints)
+{
+  const auto it = controller_joints_.find(name);
+  if (it != controller_joints_.end())
+    joints = it->second;
+  else
+    joints.clear();
+}
+
+moveit_controller_manager::MoveItControllerManager::ControllerState
+SimulatedControllerManager::getControllerState(const std::string& name)
+{
+  ControllerState state;
+  state.active_ = controller_joints_.count(name) > 0;
+  state.default_ = state.active_;
+  return state;
+}
+
+bool SimulatedControllerManager::switchControllers(const std::vector<std::string>& /*activate*/,
+                                                   const std::vector<std::string>& /*deactivate*/)
+{
+  // all simulated controllers are always active
+  return true;
+}
+}  // namespace moveit_ros_benchmarks
+
+PLUGINLIB_EXPORT_CLASS(moveit_ros_benchmarks::SimulatedControllerManager,
+                       moveit_controller_manager::MoveItControllerManager);
@@ -167,8 +167,10 @@ void GlobalPlannerComponent::globalPlanningRequestCallback(
 
   if (planning_solution.error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
   {
-    // Publish global planning solution to the local planner
-    global_trajectory_pub_->publish(planning_solution);
+    // Publish global planning solution to the local planner. Publishing an owned message lets intra-process
+    // subscribers in the same container receive it without serialization.
+    global_trajectory_pub_->publish(
+        std::make_unique<moveit_msgs::msg::MotionPlanResponse>(std::move(planning_solution)));
     goal_handle->succeed(result);
   }
   else
@@ -58,7 +58,23 @@ public:
       override;
 
 private:
+  /**
+   * Replan only the invalidated window of the last solution, between the last valid waypoint before and the first
+   * valid waypoint after the invalid ones, and splice the result into the remainder of the last solution.
+   * @return The repaired trajectory starting at the current state, or nullptr if the last solution cannot be repaired
+   */
+  robot_trajectory::RobotTrajectoryPtr
+  repairLastSolution(const moveit_msgs::msg::MotionPlanRequest& motion_plan_req,
+                     const moveit_cpp::PlanningComponent::PlanRequestParameters& plan_params);
+
   rclcpp::Node::SharedPtr node_ptr_;
   std::shared_ptr<moveit_cpp::MoveItCpp> moveit_cpp_;
+
+  // Repair invalidated trajectories instead of planning from scratch
+  bool repair_invalidated_trajectory_;
+
+  // Last solution and the request it solved, kept to repair it when it gets invalidated
+  moveit_msgs::msg::MotionPlanRequest last_request_;
+  robot_trajectory::RobotTrajectoryPtr last_solution_;
 };
 }  // namespace moveit::hybrid_planning
@@ -36,9 +36,15 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace
 {
 const rclcpp::Logger LOGGER = rclcpp::get_logger("global_planner_component");
+// The current state must be this close to a waypoint of the last solution to continue from it: rad, L1-norm sum for
+// all joints, like the waypoint tolerance of the simple sampler
+constexpr double WAYPOINT_RADIAN_TOLERANCE = 0.2;
 }
 
 namespace moveit::hybrid_planning
@@ -79,6 +85,9 @@ bool MoveItPlanningPipeline::initialize(const rclcpp::Node::SharedPtr& node)
   // Trajectory Execution Functionality (required by the MoveItPlanningPipeline but not used within hybrid planning)
   node->declare_parameter<std::string>("moveit_controller_manager", UNDEFINED);
 
+  // Repair the invalidated part of the last solution instead of replanning the whole motion
+  repair_invalidated_trajectory_ = node->declare_parameter<bool>("repair_invalidated_trajectory", true);
+
   node_ptr_ = node;
 
   // Initialize MoveItCpp API
@@ -124,6 +133,24 @@ moveit_msgs::msg::MotionPlanResponse MoveItPlanningPipeline::plan(
   plan_params.max_velocity_scaling_factor = motion_plan_req.max_velocity_scaling_factor;
   plan_params.max_acceleration_scaling_factor = motion_plan_req.max_acceleration_scaling_factor;
 
+  // A replan for the goal of the last solution only needs to repair the part which got invalidated
+  if (repair_invalidated_trajectory_ && last_solution_ && motion_plan_req.group_name == last_request_.group_name &&
+      motion_plan_req.goal_constraints == last_request_.goal_constraints)
+  {
+    robot_trajectory::RobotTrajectoryPtr repaired_trajectory = repairLastSolution(motion_plan_req, plan_params);
+    if (repaired_trajectory)
+    {
+      last_solution_ = repaired_trajectory;
+      moveit::core::robotStateToRobotStateMsg(repaired_trajectory->getFirstWayPoint(), response.trajectory_start);
+      response.group_name = motion_plan_req.group_name;
+      repaired_trajectory->getRobotTrajectoryMsg(response.trajectory);
+      response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+      return response;
+    }
+    RCLCPP_INFO(LOGGER, "Unable to repair the last solution, planning the whole motion again");
+  }
+  last_solution_.reset();
+
   // Create planning component
   auto planning_components = std::make_shared<moveit_cpp::PlanningComponent>(motion_plan_req.group_name, moveit_cpp_);
 
@@ -138,6 +165,9 @@ moveit_msgs::msg::MotionPlanResponse MoveItPlanningPipeline::plan(
     return response;
   }
 
+  last_request_ = motion_plan_req;
+  last_solution_ = plan_solution.trajectory;
+
   // Transform solution into MotionPlanResponse and publish it
   response.trajectory_start = plan_solution.start_state;
   response.group_name = motion_plan_req.group_name;
@@ -146,6 +176,94 @@ moveit_msgs::msg::MotionPlanResponse MoveItPlanningPipeline::plan(
 
   return response;
 }
+
+robot_trajectory::RobotTrajectoryPtr
+MoveItPlanningPipeline::repairLastSolution(const moveit_msgs::msg::MotionPlanRequest& motion_plan_req,
+                                           const moveit_cpp::PlanningComponent::PlanRequestParameters& plan_params)
+{
+  const moveit::core::RobotStatePtr current_state = moveit_cpp_->getCurrentState();
+  const planning_scene::PlanningSceneConstPtr planning_scene =
+      moveit_cpp_->getPlanningSceneMonitor()->getPlanningSceneSnapshot();
+  if (!current_state || last_solution_->empty())
+  {
+    return nullptr;
+  }
+  const moveit::core::JointModelGroup* joint_model_group = last_solution_->getGroup();
+  const std::size_t waypoint_count = last_solution_->getWayPointCount();
+
+  // Find the progress of the robot along the last solution
+  std::size_t progress_index = 0;
+  double min_distance = std::numeric_limits<double>::max();
+  for (std::size_t i = 0; i < waypoint_count; ++i)
+  {
+    const double distance = last_solution_->getWayPoint(i).distance(*current_state, joint_model_group);
+    if (distance < min_distance)
+    {
+      min_distance = distance;
+      progress_index = i;
+    }
+  }
+  if (min_distance > WAYPOINT_RADIAN_TOLERANCE)
+  {
+    RCLCPP_DEBUG(LOGGER, "The robot left the last solution, it cannot be repaired");
+    return nullptr;
+  }
+
+  // Find the window of invalid waypoints in the remainder of the last solution
+  const auto is_valid = [&](std::size_t index) {
+    return planning_scene->isStateValid(last_solution_->getWayPoint(index), motion_plan_req.path_constraints,
+                                        joint_model_group->getName());
+  };
+  std::size_t first_invalid = waypoint_count;
+  std::size_t last_invalid = waypoint_count;
+  for (std::size_t i = progress_index + 1; i < waypoint_count; ++i)
+  {
+    if (!is_valid(i))
+    {
+      if (first_invalid == waypoint_count)
+      {
+        first_invalid = i;
+      }
+      last_invalid = i;
+    }
+  }
+  if (first_invalid == waypoint_count || last_invalid + 1 >= waypoint_count)
+  {
+    // Either nothing to repair, or the goal itself became invalid
+    return nullptr;
+  }
+  const std::size_t window_start = first_invalid - 1;
+  const std::size_t window_end = last_invalid + 1;
+
+  // Plan between the valid waypoints around the window. The robot is at window_start if it is the progress index.
+  auto planning_component = std::make_shared<moveit_cpp::PlanningComponent>(motion_plan_req.group_name, moveit_cpp_);
+  const moveit::core::RobotState& window_start_state =
+      window_start == progress_index ? *current_state : last_solution_->getWayPoint(window_start);
+  planning_component->setStartState(window_start_state);
+  planning_component->setGoal(last_solution_->getWayPoint(window_end));
+  const moveit_cpp::PlanningComponent::PlanSolution window_solution = planning_component->plan(plan_params);
+  if (window_solution.error_code != moveit_msgs::msg::MoveItErrorCodes::SUCCESS || !window_solution.trajectory ||
+      window_solution.trajectory->empty())
+  {
+    return nullptr;
+  }
+  RCLCPP_INFO(LOGGER, "Repaired waypoints %zu to %zu of %zu of the last solution", window_start, window_end,
+              waypoint_count);
+
+  // Splice: current state, remaining valid prefix, repaired window, remaining suffix
+  auto repaired_trajectory =
+      std::make_shared<robot_trajectory::RobotTrajectory>(last_solution_->getRobotModel(), joint_model_group);
+  repaired_trajectory->addSuffixWayPoint(*current_state, 0.0);
+  repaired_trajectory->append(*last_solution_, last_solution_->getWayPointDurationFromPrevious(progress_index + 1),
+                              progress_index + 1, window_start + 1);
+  // The window starts at the state the prefix ends with
+  const robot_trajectory::RobotTrajectory& window = *window_solution.trajectory;
+  const double window_dt = window.getWayPointDurationFromPrevious(std::min<std::size_t>(1, window.size() - 1));
+  repaired_trajectory->append(window, window_dt, 1, window.size());
+  repaired_trajectory->append(*last_solution_, last_solution_->getWayPointDurationFromPrevious(window_end + 1),
+                              window_end + 1, waypoint_count);
+  return repaired_trajectory;
+}
 }  // namespace moveit::hybrid_planning
 
 #include <pluginlib/class_list_macros.hpp>
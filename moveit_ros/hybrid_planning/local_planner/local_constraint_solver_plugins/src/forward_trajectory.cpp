@@ -92,17 +92,11 @@ ForwardTrajectory::solve(const robot_trajectory::RobotTrajectory& local_trajecto
   }
   else
   {
-    // Get current planning scene
-    planning_scene_monitor_->updateFrameTransforms();
-
-    moveit::core::RobotStatePtr current_state;
-    bool is_path_valid = false;
-    // Lock the planning scene as briefly as possible
-    {
-      planning_scene_monitor::LockedPlanningSceneRO locked_planning_scene(planning_scene_monitor_);
-      current_state = std::make_shared<moveit::core::RobotState>(locked_planning_scene->getCurrentState());
-      is_path_valid = locked_planning_scene->isPathValid(local_trajectory, local_trajectory.getGroupName(), false);
-    }
+    // Get current planning scene. The snapshot neither waits for nor blocks the updates of the monitor, and it
+    // shares the robot state instead of copying it
+    const planning_scene::PlanningSceneConstPtr planning_scene = planning_scene_monitor_->getPlanningSceneSnapshot();
+    const moveit::core::RobotState* current_state = &planning_scene->getCurrentState();
+    const bool is_path_valid = planning_scene->isPathValid(local_trajectory, local_trajectory.getGroupName(), false);
 
     // Check if path is valid
     if (is_path_valid)
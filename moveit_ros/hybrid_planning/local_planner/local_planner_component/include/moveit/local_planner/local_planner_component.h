@@ -113,6 +113,7 @@ public:
                                      undefined, node);
       declareOrGetParam<std::string>("local_planning_action_name", local_planning_action_name, undefined, node);
       declareOrGetParam<double>("local_planning_frequency", local_planning_frequency, 1.0, node);
+      declareOrGetParam<int>("local_planning_thread_priority", local_planning_thread_priority, 0, node);
       declareOrGetParam<std::string>("global_solution_topic", global_solution_topic, undefined, node);
       declareOrGetParam<std::string>("local_solution_topic", local_solution_topic, undefined, node);
       declareOrGetParam<std::string>("local_solution_topic_type", local_solution_topic_type, undefined, node);
@@ -137,6 +138,7 @@ public:
     bool publish_joint_positions;
     bool publish_joint_velocities;
     double local_planning_frequency;
+    int local_planning_thread_priority;
     std::string monitored_planning_scene_topic;
     std::string collision_object_topic;
     std::string joint_states_topic;
@@ -149,6 +151,7 @@ public:
   ~LocalPlannerComponent()
   {
     // Join the thread used for long-running callbacks
+    planning_loop_active_ = false;
     if (long_callback_thread_.joinable())
     {
       long_callback_thread_.join();
@@ -179,6 +182,16 @@ private:
   /** \brief Reset internal data members including state_ = LocalPlannerState::AWAIT_GLOBAL_TRAJECTORY */
   void reset();
 
+  /**
+   * Call executeIteration() at the absolute deadlines of the local planning frequency until reset() ends the loop.
+   * A deadline which has passed when an iteration returns is counted as overrun and skipped, so that late iterations
+   * do not cause bursts of catch-up iterations.
+   */
+  void runPlanningLoop();
+
+  /** \brief Hand the latest global solution, if any, to the trajectory operator */
+  void takeReferenceTrajectory();
+
   std::shared_ptr<rclcpp::Node> node_;
 
   // Planner configuration
@@ -187,8 +200,16 @@ private:
   // Current planner state. Must be thread-safe
   std::atomic<LocalPlannerState> state_;
 
-  // Timer to periodically call executeIteration()
-  rclcpp::TimerBase::SharedPtr timer_;
+  // Keeps runPlanningLoop() running while a local planning goal is active
+  std::atomic<bool> planning_loop_active_{ false };
+
+  // Iterations and missed deadlines of the current local planning goal
+  std::size_t num_iterations_{ 0 };
+  std::size_t num_overruns_{ 0 };
+
+  // Latest global solution, handed from the subscriber to the planning loop. Only accessed through
+  // std::atomic_load/store/exchange so that neither of them blocks the other.
+  robot_trajectory::RobotTrajectoryPtr pending_reference_trajectory_;
 
   // Latest action goal handle
   std::shared_ptr<rclcpp_action::ServerGoalHandle<moveit_msgs::action::LocalPlanner>> local_planning_goal_handle_;
@@ -225,7 +246,7 @@ private:
   // Trajectory_operator instance handle trajectory matching and blending
   std::shared_ptr<TrajectoryOperatorInterface> trajectory_operator_instance_;
 
-  // This thread is used for long-running callbacks. It's a member so they do not go out of scope.
+  // This thread runs the local planning loop. It's a member so it does not go out of scope.
   std::thread long_callback_thread_;
 
   // A unique callback group, to avoid mixing callbacks with other action servers
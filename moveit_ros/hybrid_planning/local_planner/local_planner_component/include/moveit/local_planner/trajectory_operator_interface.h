@@ -84,6 +84,19 @@ public:
   virtual moveit_msgs::action::LocalPlanner::Feedback
   addTrajectorySegment(const robot_trajectory::RobotTrajectory& new_trajectory) = 0;
 
+  /**
+   * Add a new reference trajectory segment whose ownership is passed to the trajectory operator. Operators that store
+   * the reference trajectory can take the pointer instead of copying the dense trajectory. The default implementation
+   * copies it with addTrajectorySegment().
+   * @param new_trajectory New reference trajectory segment to add, it must not be used by the caller afterwards
+   * @return True if segment was successfully added
+   */
+  virtual moveit_msgs::action::LocalPlanner::Feedback
+  takeTrajectorySegment(const robot_trajectory::RobotTrajectoryPtr& new_trajectory)
+  {
+    return addTrajectorySegment(*new_trajectory);
+  }
+
   /**
    * Return the current local constraints based on the newest robot state
    * @param current_state Current RobotState
@@ -41,10 +41,13 @@
 
 #include <moveit_msgs/msg/constraints.hpp>
 
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
 namespace moveit::hybrid_planning
 {
-using namespace std::chrono_literals;
-
 namespace
 {
 const rclcpp::Logger LOGGER = rclcpp::get_logger("local_planner_component");
@@ -191,11 +194,8 @@ bool LocalPlannerComponent::initialize()
         }
         // Start a local planning loop.
         // This needs to return quickly to avoid blocking the executor, so run the local planner in a new thread.
-        auto local_planner_timer = [&]() {
-          timer_ =
-              node_->create_wall_timer(1s / config_.local_planning_frequency, [this]() { return executeIteration(); });
-        };
-        long_callback_thread_ = std::thread(local_planner_timer);
+        planning_loop_active_ = true;
+        long_callback_thread_ = std::thread([this]() { runPlanningLoop(); });
       },
       rcl_action_server_get_default_options(), cb_group_);
 
@@ -203,22 +203,13 @@ bool LocalPlannerComponent::initialize()
   global_solution_subscriber_ = node_->create_subscription<moveit_msgs::msg::MotionPlanResponse>(
       config_.global_solution_topic, rclcpp::SystemDefaultsQoS(),
       [this](const moveit_msgs::msg::MotionPlanResponse::ConstSharedPtr& msg) {
-        // Add received trajectory to internal reference trajectory
-        robot_trajectory::RobotTrajectory new_trajectory(planning_scene_monitor_->getRobotModel(), msg->group_name);
-        moveit::core::RobotState start_state(planning_scene_monitor_->getRobotModel());
+        // Convert the received trajectory here, the planning loop only picks up the result
+        const moveit::core::RobotModelConstPtr& robot_model = planning_scene_monitor_->getRobotModel();
+        auto new_trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, msg->group_name);
+        moveit::core::RobotState start_state(robot_model);
         moveit::core::robotStateMsgToRobotState(msg->trajectory_start, start_state);
-        new_trajectory.setRobotTrajectoryMsg(start_state, msg->trajectory);
-        *local_planner_feedback_ = trajectory_operator_instance_->addTrajectorySegment(new_trajectory);
-
-        // Feedback is only send when the hybrid planning architecture should react to a discrete event that occurred
-        // when the reference trajectory is updated
-        if (!local_planner_feedback_->feedback.empty())
-        {
-          local_planning_goal_handle_->publish_feedback(local_planner_feedback_);
-        }
-
-        // Update local planner state
-        state_ = LocalPlannerState::LOCAL_PLANNING_ACTIVE;
+        new_trajectory->setRobotTrajectoryMsg(start_state, msg->trajectory);
+        std::atomic_store(&pending_reference_trajectory_, std::move(new_trajectory));
       });
 
   // Initialize local solution publisher
@@ -242,10 +233,80 @@ bool LocalPlannerComponent::initialize()
   return true;
 }
 
+void LocalPlannerComponent::runPlanningLoop()
+{
+#ifdef __linux__
+  if (config_.local_planning_thread_priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = config_.local_planning_thread_priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    {
+      RCLCPP_WARN(LOGGER, "Unable to run the local planner with realtime priority %d, check the permissions",
+                  config_.local_planning_thread_priority);
+    }
+  }
+#endif
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / config_.local_planning_frequency));
+  num_iterations_ = 0;
+  num_overruns_ = 0;
+  auto deadline = std::chrono::steady_clock::now() + period;
+  while (planning_loop_active_)
+  {
+    executeIteration();
+    ++num_iterations_;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now > deadline)
+    {
+      // Skip the missed deadlines and keep the phase of the schedule
+      const auto missed = (now - deadline) / period + 1;
+      num_overruns_ += missed;
+      deadline += missed * period;
+      RCLCPP_WARN_THROTTLE(LOGGER, *node_->get_clock(), 2000 /* ms */,
+                           "Local planning iteration missed its deadline, %zu of %zu iterations overran so far",
+                           num_overruns_, num_iterations_);
+    }
+    std::this_thread::sleep_until(deadline);
+    deadline += period;
+  }
+  RCLCPP_INFO(LOGGER, "Local planning loop stopped after %zu iterations, %zu missed deadlines", num_iterations_,
+              num_overruns_);
+}
+
+void LocalPlannerComponent::takeReferenceTrajectory()
+{
+  const robot_trajectory::RobotTrajectoryPtr new_trajectory =
+      std::atomic_exchange(&pending_reference_trajectory_, robot_trajectory::RobotTrajectoryPtr());
+  if (!new_trajectory)
+  {
+    return;
+  }
+
+  // Add received trajectory to internal reference trajectory
+  *local_planner_feedback_ = trajectory_operator_instance_->takeTrajectorySegment(new_trajectory);
+
+  // Feedback is only send when the hybrid planning architecture should react to a discrete event that occurred
+  // when the reference trajectory is updated
+  if (!local_planner_feedback_->feedback.empty())
+  {
+    local_planning_goal_handle_->publish_feedback(local_planner_feedback_);
+  }
+
+  // Update local planner state, unless the goal was aborted meanwhile
+  LocalPlannerState expected = LocalPlannerState::AWAIT_GLOBAL_TRAJECTORY;
+  state_.compare_exchange_strong(expected, LocalPlannerState::LOCAL_PLANNING_ACTIVE);
+}
+
 void LocalPlannerComponent::executeIteration()
 {
   auto result = std::make_shared<moveit_msgs::action::LocalPlanner::Result>();
 
+  // The trajectory operator is only used by the planning loop, so updates of the reference trajectory are applied here
+  takeReferenceTrajectory();
+
   // Do different things depending on the planner's internal state
   switch (state_)
   {
@@ -265,13 +326,10 @@ void LocalPlannerComponent::executeIteration()
     // If the planner received an action request and a global solution it starts to plan locally
     case LocalPlannerState::LOCAL_PLANNING_ACTIVE:
     {
-      planning_scene_monitor_->updateSceneWithCurrentState();
-
-      // Read current robot state
-      const moveit::core::RobotState current_robot_state = [this] {
-        planning_scene_monitor::LockedPlanningSceneRO ls(planning_scene_monitor_);
-        return ls->getCurrentState();
-      }();
+      // Read current robot state from the state monitor, which does not need to lock the planning scene
+      const moveit::core::RobotStatePtr current_robot_state_ptr =
+          planning_scene_monitor_->getStateMonitor()->getCurrentState();
+      const moveit::core::RobotState& current_robot_state = *current_robot_state_ptr;
 
       // Check if the global goal is reached
       if (trajectory_operator_instance_->getTrajectoryProgress(current_robot_state) > PROGRESS_THRESHOLD)
@@ -359,7 +417,7 @@ void LocalPlannerComponent::reset()
 {
   local_constraint_solver_instance_->reset();
   trajectory_operator_instance_->reset();
-  timer_->cancel();
+  planning_loop_active_ = false;
   state_ = LocalPlannerState::AWAIT_GLOBAL_TRAJECTORY;
 }
 }  // namespace moveit::hybrid_planning
@@ -54,6 +54,8 @@ public:
   moveit_msgs::action::LocalPlanner::Feedback
   addTrajectorySegment(const robot_trajectory::RobotTrajectory& new_trajectory) override;
   moveit_msgs::action::LocalPlanner::Feedback
+  takeTrajectorySegment(const robot_trajectory::RobotTrajectoryPtr& new_trajectory) override;
+  moveit_msgs::action::LocalPlanner::Feedback
   getLocalTrajectory(const moveit::core::RobotState& current_state,
                      robot_trajectory::RobotTrajectory& local_trajectory) override;
   double getTrajectoryProgress([[maybe_unused]] const moveit::core::RobotState& current_state) override;
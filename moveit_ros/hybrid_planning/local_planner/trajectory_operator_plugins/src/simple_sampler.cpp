@@ -55,12 +55,18 @@ bool SimpleSampler::initialize([[maybe_unused]] const rclcpp::Node::SharedPtr& n
 
 moveit_msgs::action::LocalPlanner::Feedback
 SimpleSampler::addTrajectorySegment(const robot_trajectory::RobotTrajectory& new_trajectory)
+{
+  return takeTrajectorySegment(std::make_shared<robot_trajectory::RobotTrajectory>(new_trajectory));
+}
+
+moveit_msgs::action::LocalPlanner::Feedback
+SimpleSampler::takeTrajectorySegment(const robot_trajectory::RobotTrajectoryPtr& new_trajectory)
 {
   // Reset trajectory operator to delete old reference trajectory
   reset();
 
   // Throw away old reference trajectory and use trajectory update
-  reference_trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(new_trajectory);
+  reference_trajectory_ = new_trajectory;
 
   // Parametrize trajectory and calculate velocity and accelerations
   time_parametrization_.computeTimeStamps(*reference_trajectory_);
@@ -90,7 +96,7 @@ SimpleSampler::getLocalTrajectory(const moveit::core::RobotState& current_state,
   local_trajectory.clear();
 
   // Get next desired robot state
-  const moveit::core::RobotState next_desired_goal_state = reference_trajectory_->getWayPoint(next_waypoint_index_);
+  const moveit::core::RobotState& next_desired_goal_state = reference_trajectory_->getWayPoint(next_waypoint_index_);
 
   // Check if state is reached
   if (next_desired_goal_state.distance(current_state, joint_group_) <= WAYPOINT_RADIAN_TOLERANCE)
@@ -118,6 +118,7 @@ def generate_common_hybrid_launch_description():
                     planning_pipelines_config,
                     moveit_controllers,
                 ],
+                extra_arguments=[{"use_intra_process_comms": True}],
             ),
             ComposableNode(
                 package="moveit_hybrid_planning",
@@ -130,6 +131,7 @@ def generate_common_hybrid_launch_description():
                     robot_description_semantic,
                     kinematics_yaml,
                 ],
+                extra_arguments=[{"use_intra_process_comms": True}],
             ),
             ComposableNode(
                 package="moveit_hybrid_planning",
@@ -139,6 +141,7 @@ def generate_common_hybrid_launch_description():
                     common_hybrid_planning_param,
                     hybrid_planning_manager_param,
                 ],
+                extra_arguments=[{"use_intra_process_comms": True}],
             ),
         ],
         output="screen",
@@ -62,4 +62,8 @@ static const std::string APPLY_PLANNING_SCENE_SERVICE_NAME =
     "apply_planning_scene";  // name of the service that applies a given planning scene
 static const std::string CLEAR_OCTOMAP_SERVICE_NAME =
     "clear_octomap";  // name of the service that can be used to clear the octomap
+static const std::string MEMORY_USAGE_SERVICE_NAME =
+    "get_memory_usage";  // name of the service that reports the estimated memory of scenes, caches and planners
+static const std::string ENABLE_REQUEST_PROFILING_SERVICE_NAME =
+    "enable_request_profiling";  // name of the service that switches the sampling of request profiles
 }  // namespace move_group
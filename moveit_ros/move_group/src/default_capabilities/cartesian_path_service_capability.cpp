@@ -46,6 +46,9 @@
 #include <moveit/robot_state/cartesian_interpolator.h>
 #include <moveit_msgs/msg/display_trajectory.hpp>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/utils/sampling_profiler.h>
+
+#include <algorithm>
 
 namespace
 {
@@ -56,7 +59,7 @@ bool isStateValid(const planning_scene::PlanningScene* planning_scene,
   state->setJointGroupPositions(group, ik_solution);
   state->update();
   return (!planning_scene || !planning_scene->isStateColliding(*state, group->getName())) &&
-         (!constraint_set || constraint_set->decide(*state).satisfied);
+         (!constraint_set || constraint_set->satisfied(*state));
 }
 }  // namespace
 
@@ -66,12 +69,18 @@ static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_move_group_default_capabilities.cartersian_path_service_capability");
 
 MoveGroupCartesianPathService::MoveGroupCartesianPathService()
-  : MoveGroupCapability("CartesianPathService"), display_computed_paths_(true)
+  : MoveGroupCapability("CartesianPathService"), display_computed_paths_(true), segment_threads_(1)
 {
 }
 
 void MoveGroupCartesianPathService::initialize()
 {
+  // Segments between waypoints are computed concurrently by this many threads
+  int segment_threads = 4;
+  context_->moveit_cpp_->getNode()->get_parameter_or("cartesian_path_service.segment_threads", segment_threads,
+                                                     segment_threads);
+  segment_threads_ = static_cast<std::size_t>(std::max(segment_threads, 1));
+
   display_path_ = context_->moveit_cpp_->getNode()->create_publisher<moveit_msgs::msg::DisplayTrajectory>(
       planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC, 10);
 
@@ -90,6 +99,7 @@ bool MoveGroupCartesianPathService::computeService(
     const std::shared_ptr<moveit_msgs::srv::GetCartesianPath::Request>& req,
     const std::shared_ptr<moveit_msgs::srv::GetCartesianPath::Response>& res)
 {
+  moveit::profiling::ScopedProfile profile(CARTESIAN_PATH_SERVICE_NAME.c_str());
   RCLCPP_INFO(LOGGER, "Received request to compute Cartesian path");
   context_->planning_scene_monitor_->updateFrameTransforms();
 
@@ -165,9 +175,10 @@ bool MoveGroupCartesianPathService::computeService(
                       (unsigned int)waypoints.size(), link_name.c_str(), req->max_step, req->jump_threshold,
                       global_frame ? "global" : "link");
           std::vector<moveit::core::RobotStatePtr> traj;
-          res->fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
+          res->fraction = moveit::core::CartesianInterpolator::computeCartesianPathParallel(
               &start_state, jmg, traj, start_state.getLinkModel(link_name), waypoints, global_frame,
-              moveit::core::MaxEEFStep(req->max_step), moveit::core::JumpThreshold(req->jump_threshold), constraint_fn);
+              moveit::core::MaxEEFStep(req->max_step), moveit::core::JumpThreshold(req->jump_threshold), constraint_fn,
+              segment_threads_);
           moveit::core::robotStateToRobotStateMsg(start_state, res->start_state);
 
           robot_trajectory::RobotTrajectory rt(context_->planning_scene_monitor_->getRobotModel(), req->group_name);
@@ -40,6 +40,7 @@
 #include <moveit/utils/message_checks.h>
 #include <tf2_eigen/tf2_eigen.hpp>
 #include <moveit/move_group/capability_names.h>
+#include <moveit/utils/sampling_profiler.h>
 
 namespace move_group
 {
@@ -76,7 +77,7 @@ bool isIKSolutionValid(const planning_scene::PlanningScene* planning_scene,
   state->setJointGroupPositions(jmg, ik_solution);
   state->update();
   return (!planning_scene || !planning_scene->isStateColliding(*state, jmg->getName())) &&
-         (!constraint_set || constraint_set->decide(*state).satisfied);
+         (!constraint_set || constraint_set->satisfied(*state));
 }
 }  // namespace
 
@@ -162,6 +163,7 @@ bool MoveGroupKinematicsService::computeIKService(const std::shared_ptr<rmw_requ
                                                   const std::shared_ptr<moveit_msgs::srv::GetPositionIK::Request>& req,
                                                   const std::shared_ptr<moveit_msgs::srv::GetPositionIK::Response>& res)
 {
+  moveit::profiling::ScopedProfile profile(IK_SERVICE_NAME.c_str());
   context_->planning_scene_monitor_->updateFrameTransforms();
 
   // check if the planning scene needs to be kept locked; if so, call computeIK() in the scope of the lock
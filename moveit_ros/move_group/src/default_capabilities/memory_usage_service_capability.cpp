@@ -0,0 +1,87 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "memory_usage_service_capability.h"
+#include <moveit/moveit_cpp/moveit_cpp.h>
+#include <moveit/move_group/capability_names.h>
+#include <moveit/planning_scene/mesh_cache.h>
+#include <moveit/utils/memory_usage.h>
+
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_move_group_default_capabilities.memory_usage_service_capability");
+
+move_group::MemoryUsageService::MemoryUsageService() : MoveGroupCapability("MemoryUsageService")
+{
+}
+
+void move_group::MemoryUsageService::initialize()
+{
+  service_ = context_->moveit_cpp_->getNode()->create_service<std_srvs::srv::Trigger>(
+      MEMORY_USAGE_SERVICE_NAME,
+      [this](const std::shared_ptr<std_srvs::srv::Trigger::Request>& req,
+             const std::shared_ptr<std_srvs::srv::Trigger::Response>& res) { return computeService(req, res); });
+}
+
+void move_group::MemoryUsageService::computeService(const std::shared_ptr<std_srvs::srv::Trigger::Request>& /*req*/,
+                                                    const std::shared_ptr<std_srvs::srv::Trigger::Response>& res)
+{
+  moveit::MemoryUsage usage;
+  if (context_->planning_scene_monitor_)
+  {
+    planning_scene_monitor::LockedPlanningSceneRO ls(context_->planning_scene_monitor_);
+    usage.add("planning_scene", ls->getMemoryUsage());
+  }
+
+  const planning_scene::MeshCacheStatistics mesh_cache = planning_scene::MeshCache::getGlobal().getStatistics();
+  usage.add("mesh_cache", planning_scene::MeshCache::getGlobal().getMemoryUsage(), mesh_cache.size);
+
+  for (const auto& [name, pipeline] : context_->moveit_cpp_->getPlanningPipelines())
+    usage.add("pipeline." + name, pipeline->getMemoryUsage());
+
+  for (const moveit::core::JointModelGroup* jmg : context_->moveit_cpp_->getRobotModel()->getJointModelGroups())
+  {
+    const kinematics::KinematicsBaseConstPtr solver = jmg->getSolverInstance();
+    if (solver)
+      usage.add("kinematics." + jmg->getName(), solver->getMemoryUsage());
+  }
+
+  res->success = true;
+  res->message = usage.toString() + "total: " + std::to_string(usage.getTotalBytes()) + " bytes\n";
+  RCLCPP_DEBUG(LOGGER, "Memory usage:\n%s", res->message.c_str());
+}
+
+#include <pluginlib/class_list_macros.hpp>
+
+PLUGINLIB_EXPORT_CLASS(move_group::MemoryUsageService, move_group::MoveGroupCapability)
@@ -43,6 +43,8 @@
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/utils/message_checks.h>
 #include <moveit/move_group/capability_names.h>
+#include <moveit/utils/sampling_profiler.h>
+#include <moveit/utils/tracing.h>
 
 namespace move_group
 {
@@ -73,6 +75,7 @@ void MoveGroupMoveAction::initialize()
 
 void MoveGroupMoveAction::executeMoveCallback(const std::shared_ptr<MGActionGoal>& goal)
 {
+  moveit::profiling::ScopedProfile profile(MOVE_ACTION.c_str());
   RCLCPP_INFO(LOGGER, "executing..");
   setMoveState(PLANNING, goal);
   // before we start planning, ensure that we have the latest robot state received...
@@ -169,6 +172,7 @@ void MoveGroupMoveAction::executeMoveCallbackPlanOnly(const std::shared_ptr<MGAc
                                                       std::shared_ptr<MGAction::Result>& action_res)
 {
   RCLCPP_INFO(LOGGER, "Planning request received for MoveGroup action. Forwarding to planning pipeline.");
+  moveit::tracing::ScopedSpan span("MoveGroupMoveAction::executeMoveCallbackPlanOnly");
 
   planning_interface::MotionPlanResponse res;
 
@@ -190,8 +194,12 @@ void MoveGroupMoveAction::executeMoveCallbackPlanOnly(const std::shared_ptr<MGAc
 
   try
   {
-    auto scene =
-        context_->planning_scene_monitor_->copyPlanningScene(goal->get_goal()->planning_options.planning_scene_diff);
+    planning_scene::PlanningScenePtr scene;
+    {
+      moveit::tracing::ScopedSpan scene_span("planning scene copy");
+      scene =
+          context_->planning_scene_monitor_->copyPlanningScene(goal->get_goal()->planning_options.planning_scene_diff);
+    }
     planning_pipeline->generatePlan(scene, goal->get_goal()->request, res);
   }
   catch (std::exception& ex)
@@ -200,6 +208,7 @@ void MoveGroupMoveAction::executeMoveCallbackPlanOnly(const std::shared_ptr<MGAc
     res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
   }
 
+  moveit::tracing::ScopedSpan response_span("motion plan response conversion");
   convertToMsg(res.trajectory_, action_res->trajectory_start, action_res->planned_trajectory);
   action_res->error_code = res.error_code_;
   action_res->planning_time = res.planning_time_;
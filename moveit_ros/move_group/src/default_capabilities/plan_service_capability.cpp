@@ -39,24 +39,105 @@
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/move_group/capability_names.h>
+#include <moveit/utils/sampling_profiler.h>
+#include <moveit/utils/tracing.h>
+
+#include <algorithm>
+#include <memory>
 
 namespace move_group
 {
 static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_move_group_default_capabilities.plan_service_capability");
 
-MoveGroupPlanService::MoveGroupPlanService() : MoveGroupCapability("MotionPlanService")
+MoveGroupPlanService::MoveGroupPlanService()
+  : MoveGroupCapability("MotionPlanService")
+  , max_concurrent_requests_(1)
+  , max_queued_requests_(0)
+  , active_requests_(0)
+  , queued_requests_(0)
+  , rejected_requests_(0)
+  , shutting_down_(false)
 {
 }
 
+MoveGroupPlanService::~MoveGroupPlanService()
+{
+  {
+    std::lock_guard<std::mutex> lock(admission_mutex_);
+    shutting_down_ = true;
+  }
+  admission_condition_.notify_all();
+  if (callback_executor_)
+    callback_executor_->cancel();
+  if (callback_thread_.joinable())
+    callback_thread_.join();
+}
+
 void MoveGroupPlanService::initialize()
 {
-  plan_service_ = context_->moveit_cpp_->getNode()->create_service<moveit_msgs::srv::GetMotionPlan>(
-      PLANNER_SERVICE_NAME, [this](const std::shared_ptr<rmw_request_id_t>& request_header,
-                                   const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Request>& req,
-                                   const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response>& res) {
+  auto node = context_->moveit_cpp_->getNode();
+
+  int max_concurrent_requests = 4;
+  int max_queued_requests = 8;
+  node->get_parameter_or("plan_service.max_concurrent_requests", max_concurrent_requests, max_concurrent_requests);
+  node->get_parameter_or("plan_service.max_queued_requests", max_queued_requests, max_queued_requests);
+  max_concurrent_requests_ = static_cast<std::size_t>(std::max(max_concurrent_requests, 1));
+  max_queued_requests_ = static_cast<std::size_t>(std::max(max_queued_requests, 0));
+  RCLCPP_INFO(LOGGER, "Serving up to %zu planning requests concurrently, with up to %zu more waiting",
+              max_concurrent_requests_, max_queued_requests_);
+
+  // One thread per planning slot and per waiting request, plus a spare one that turns requests away when all of them
+  // are taken. Otherwise, surplus requests would silently wait in the middleware instead of being rejected.
+  callback_group_ = node->create_callback_group(rclcpp::CallbackGroupType::Reentrant,
+                                                false /* don't spin with node executor */);
+  callback_executor_ = std::make_unique<rclcpp::executors::MultiThreadedExecutor>(
+      rclcpp::ExecutorOptions(), max_concurrent_requests_ + max_queued_requests_ + 1);
+  callback_executor_->add_callback_group(callback_group_, node->get_node_base_interface());
+  callback_thread_ = std::thread([this]() { callback_executor_->spin(); });
+
+  plan_service_ = node->create_service<moveit_msgs::srv::GetMotionPlan>(
+      PLANNER_SERVICE_NAME,
+      [this](const std::shared_ptr<rmw_request_id_t>& request_header,
+             const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Request>& req,
+             const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response>& res) {
         return computePlanService(request_header, req, res);
-      });
+      },
+      rmw_qos_profile_services_default, callback_group_);
+}
+
+bool MoveGroupPlanService::admitRequest()
+{
+  std::unique_lock<std::mutex> lock(admission_mutex_);
+  if (active_requests_ >= max_concurrent_requests_)
+  {
+    if (queued_requests_ >= max_queued_requests_)
+    {
+      ++rejected_requests_;
+      RCLCPP_WARN(LOGGER, "Rejecting planning request: %zu requests are being planned and %zu are waiting "
+                          "(%zu rejected so far)",
+                  active_requests_, queued_requests_, rejected_requests_);
+      return false;
+    }
+    ++queued_requests_;
+    admission_condition_.wait(lock, [this] { return shutting_down_ || active_requests_ < max_concurrent_requests_; });
+    --queued_requests_;
+    if (shutting_down_)
+      return false;
+  }
+  ++active_requests_;
+  RCLCPP_DEBUG(LOGGER, "Admitted planning request: %zu requests are being planned and %zu are waiting",
+               active_requests_, queued_requests_);
+  return true;
+}
+
+void MoveGroupPlanService::releaseRequest()
+{
+  {
+    std::lock_guard<std::mutex> lock(admission_mutex_);
+    --active_requests_;
+  }
+  admission_condition_.notify_one();
 }
 
 bool MoveGroupPlanService::computePlanService(const std::shared_ptr<rmw_request_id_t>& /* unused */,
@@ -64,6 +145,17 @@ bool MoveGroupPlanService::computePlanService(const std::shared_ptr<rmw_request_
                                               const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response>& res)
 {
   RCLCPP_INFO(LOGGER, "Received new planning service request...");
+  moveit::profiling::ScopedProfile profile(PLANNER_SERVICE_NAME.c_str());
+  moveit::tracing::ScopedSpan span("MoveGroupPlanService::computePlanService");
+  if (!admitRequest())
+  {
+    res->motion_plan_response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    return true;
+  }
+
+  // release the planning slot on every return path
+  std::shared_ptr<void> release(nullptr, [this](void* /* unused */) { releaseRequest(); });
+
   // before we start planning, ensure that we have the latest robot state received...
   if (static_cast<bool>(req->motion_plan_request.start_state.is_diff))
     context_->planning_scene_monitor_->waitForCurrentRobotState(context_->moveit_cpp_->getNode()->get_clock()->now());
@@ -78,11 +170,33 @@ bool MoveGroupPlanService::computePlanService(const std::shared_ptr<rmw_request_
     return true;
   }
 
-  planning_scene_monitor::LockedPlanningSceneRO ps(context_->planning_scene_monitor_);
+  // Each request plans on its own snapshot of the scene, so concurrent requests neither wait for the monitor's writers
+  // nor hold them up. The octree is shared with the monitored scene though: unless it is double buffered, fall back to
+  // planning under the (shared) read lock of the monitor, which also keeps the octomap updates out.
+  const auto& psm = context_->planning_scene_monitor_;
+  const bool use_snapshot = !psm->getOccupancyMapMonitor() || psm->isOctomapDoubleBuffered();
   try
   {
     planning_interface::MotionPlanResponse mp_res;
-    planning_pipeline->generatePlan(ps, req->motion_plan_request, mp_res);
+    if (use_snapshot)
+    {
+      planning_scene::PlanningSceneConstPtr scene;
+      {
+        moveit::tracing::ScopedSpan scene_span("planning scene snapshot");
+        scene = psm->getPlanningSceneSnapshot();
+      }
+      planning_pipeline->generatePlan(scene, req->motion_plan_request, mp_res);
+    }
+    else
+    {
+      std::unique_ptr<planning_scene_monitor::LockedPlanningSceneRO> ps;
+      {
+        moveit::tracing::ScopedSpan scene_span("planning scene lock");
+        ps = std::make_unique<planning_scene_monitor::LockedPlanningSceneRO>(psm);
+      }
+      planning_pipeline->generatePlan(*ps, req->motion_plan_request, mp_res);
+    }
+    moveit::tracing::ScopedSpan response_span("motion plan response conversion");
     mp_res.getMessage(res->motion_plan_response);
   }
   catch (std::exception& ex)
@@ -38,6 +38,9 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/srv/get_motion_plan.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace move_group
 {
@@ -45,6 +48,7 @@ class MoveGroupPlanService : public MoveGroupCapability
 {
 public:
   MoveGroupPlanService();
+  ~MoveGroupPlanService() override;
 
   void initialize() override;
 
@@ -53,6 +57,25 @@ private:
                           const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Request>& req,
                           const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response>& res);
 
+  /** @brief Wait for one of the planning slots, or return false right away if too many requests are waiting already */
+  bool admitRequest();
+  void releaseRequest();
+
   rclcpp::Service<moveit_msgs::srv::GetMotionPlan>::SharedPtr plan_service_;
+
+  // requests are served by a private pool of threads, so that planning does not hold up the node's executor
+  rclcpp::CallbackGroup::SharedPtr callback_group_;
+  std::unique_ptr<rclcpp::executors::MultiThreadedExecutor> callback_executor_;
+  std::thread callback_thread_;
+
+  // admission control of the requests, guarded by admission_mutex_
+  std::mutex admission_mutex_;
+  std::condition_variable admission_condition_;
+  std::size_t max_concurrent_requests_;
+  std::size_t max_queued_requests_;
+  std::size_t active_requests_;
+  std::size_t queued_requests_;
+  std::size_t rejected_requests_;
+  bool shutting_down_;
 };
 }  // namespace move_group
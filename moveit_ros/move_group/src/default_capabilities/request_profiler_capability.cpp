@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "request_profiler_capability.h"
+#include <moveit/moveit_cpp/moveit_cpp.h>
+#include <moveit/move_group/capability_names.h>
+#include <algorithm>
+#include <fstream>
+
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_move_group_default_capabilities.request_profiler_capability");
+
+move_group::RequestProfiler::RequestProfiler() : MoveGroupCapability("RequestProfiler")
+{
+}
+
+move_group::RequestProfiler::~RequestProfiler()
+{
+  moveit::profiling::setProfileSink(moveit::profiling::ProfileSinkFn());
+}
+
+void move_group::RequestProfiler::initialize()
+{
+  auto node = context_->moveit_cpp_->getNode();
+  std::string output_directory = (std::filesystem::temp_directory_path() / "move_group_profiles").string();
+  int period_us = 1000;
+  int max_samples = 10000;
+  bool enabled = true;
+  node->get_parameter_or("request_profiler.output_directory", output_directory, output_directory);
+  node->get_parameter_or("request_profiler.period_us", period_us, period_us);
+  node->get_parameter_or("request_profiler.max_samples", max_samples, max_samples);
+  node->get_parameter_or("request_profiler.requests", options_.requests, options_.requests);
+  node->get_parameter_or("request_profiler.enabled", enabled, enabled);
+  options_.period = std::chrono::microseconds(std::max(period_us, 1));
+  options_.max_samples = static_cast<std::size_t>(std::max(max_samples, 0));
+  output_directory_ = output_directory;
+
+  std::error_code error;
+  std::filesystem::create_directories(output_directory_, error);
+  if (error)
+    RCLCPP_ERROR(LOGGER, "Cannot create the profile directory %s: %s", output_directory_.c_str(),
+                 error.message().c_str());
+
+  service_ = node->create_service<std_srvs::srv::SetBool>(
+      ENABLE_REQUEST_PROFILING_SERVICE_NAME,
+      [this](const std::shared_ptr<std_srvs::srv::SetBool::Request>& req,
+             const std::shared_ptr<std_srvs::srv::SetBool::Response>& res) { return enableService(req, res); });
+  setEnabled(enabled);
+}
+
+void move_group::RequestProfiler::enableService(const std::shared_ptr<std_srvs::srv::SetBool::Request>& req,
+                                                const std::shared_ptr<std_srvs::srv::SetBool::Response>& res)
+{
+  setEnabled(req->data);
+  res->success = true;
+  res->message = req->data ? "request profiling enabled" : "request profiling disabled";
+}
+
+void move_group::RequestProfiler::setEnabled(bool enabled)
+{
+  if (!enabled)
+  {
+    moveit::profiling::setProfileSink(moveit::profiling::ProfileSinkFn());
+    RCLCPP_INFO(LOGGER, "Request profiling disabled");
+    return;
+  }
+
+  // the sink may outlive this capability in requests which are still running, so it must not capture this
+  moveit::profiling::setProfileSink(
+      [output_directory = output_directory_](const moveit::profiling::Profile& profile) {
+        const std::filesystem::path file =
+            output_directory / (profile.request_name + "_" + std::to_string(profile.request_id) + ".folded");
+        std::ofstream out(file);
+        moveit::profiling::writeCollapsedStacks(profile, out);
+        if (!out)
+        {
+          RCLCPP_ERROR(LOGGER, "Cannot write the profile of request %s #%zu to %s", profile.request_name.c_str(),
+                       profile.request_id, file.c_str());
+          return;
+        }
+        RCLCPP_INFO(LOGGER, "Profiled request %s #%zu: %.3f ms, %zu samples (%zu dropped) in %s",
+                    profile.request_name.c_str(), profile.request_id,
+                    std::chrono::duration<double, std::milli>(profile.end - profile.start).count(),
+                    profile.stacks.size(), profile.dropped_samples, file.c_str());
+      },
+      options_);
+  RCLCPP_INFO(LOGGER, "Profiling move_group requests every %ld us of CPU time into %s",
+              static_cast<long>(options_.period.count()), output_directory_.c_str());
+}
+
+#include <pluginlib/class_list_macros.hpp>
+
+PLUGINLIB_EXPORT_CLASS(move_group::RequestProfiler, move_group::MoveGroupCapability)
@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/move_group/move_group_capability.h>
+#include <moveit/utils/sampling_profiler.h>
+#include <std_srvs/srv/set_bool.hpp>
+#include <filesystem>
+
+namespace move_group
+{
+/** \brief Samples the call stacks of selected move_group requests and writes one profile per request.
+
+    The profiles are written to request_profiler.output_directory as <request>_<request id>.folded files in the
+    collapsed stack format, ready for flamegraph.pl or speedscope. request_profiler.requests selects the requests by
+    the name of their service or action, e.g. "plan_kinematic_path", all are profiled if it is empty. The sampling
+    period is request_profiler.period_us of CPU time. Profiling can be switched off and on at runtime via the
+    enable_request_profiling service. */
+class RequestProfiler : public MoveGroupCapability
+{
+public:
+  RequestProfiler();
+  ~RequestProfiler() override;
+
+  void initialize() override;
+
+private:
+  void enableService(const std::shared_ptr<std_srvs::srv::SetBool::Request>& req,
+                     const std::shared_ptr<std_srvs::srv::SetBool::Response>& res);
+  void setEnabled(bool enabled);
+
+  moveit::profiling::Options options_;
+  std::filesystem::path output_directory_;
+  rclcpp::Service<std_srvs::srv::SetBool>::SharedPtr service_;
+};
+}  // namespace move_group
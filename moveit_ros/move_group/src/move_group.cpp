@@ -42,6 +42,7 @@
 #include <boost/tokenizer.hpp>
 #include <moveit/macros/console_colors.h>
 #include <moveit/move_group/move_group_context.h>
+#include <moveit/utils/tracing.h>
 #include <memory>
 #include <set>
 
@@ -302,6 +303,17 @@ int main(int argc, char** argv)
       planning_scene_monitor->getStateMonitor()->enableCopyDynamics(true);
     }
 
+    bool trace_planning_stages;
+    if (nh->get_parameter("trace_planning_stages", trace_planning_stages) && trace_planning_stages)
+    {
+      RCLCPP_INFO(LOGGER, "MoveGroup logs the latency of the stages of planning requests");
+      const rclcpp::Logger trace_logger = rclcpp::get_logger("move_group.trace");
+      moveit::tracing::setSpanSink([trace_logger](const moveit::tracing::Span& span) {
+        RCLCPP_INFO(trace_logger, "%*s%s: %.3f ms", static_cast<int>(2 * span.depth), "", span.name.c_str(),
+                    std::chrono::duration<double, std::milli>(span.end - span.start).count());
+      });
+    }
+
     planning_scene_monitor->publishDebugInformation(debug);
 
     mge.status();
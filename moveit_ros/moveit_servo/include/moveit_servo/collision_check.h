@@ -38,10 +38,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 #include <rclcpp/rclcpp.hpp>
 
+#include <moveit/distance_field/propagation_distance_field.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <sensor_msgs/msg/joint_state.hpp>
@@ -76,10 +80,55 @@ public:
   /** \brief Pause or unpause processing servo commands while keeping the timers alive */
   void setPaused(bool paused);
 
+  /**
+   * \brief Run one collision checking cycle in the calling thread instead of the timer, e.g. to step servo
+   * deterministically. Do not combine with start().
+   * \return the collision velocity scale of the group of the parameters, also published as usual
+   */
+  double runOnce();
+
+  /**
+   * Set the joint velocities of the move group that servo currently commands, before collision scaling.
+   * They are projected over collision_lookahead_time to check future states. Thread-safe.
+   */
+  void setCommandedJointVelocities(const Eigen::ArrayXd& velocities);
+
+  /**
+   * Also compute the collision velocity scale of another move group, e.g. of a second arm served by another Servo
+   * instance on the same planning scene monitor. All groups share one robot and one self distance query per cycle
+   * and use the thresholds of their own parameters. The scale of the added group is handed to the callback from the
+   * collision checking timer. Call this before start().
+   */
+  void addGroup(const ServoParameters::SharedConstPtr& parameters,
+                const std::function<void(double)>& velocity_scale_callback);
+
 private:
   /** \brief Run one iteration of collision checking */
   void run();
 
+  /**
+   * \brief Compute the scene and self-collision distances of a state
+   * \return true if the state is in collision
+   */
+  bool checkState(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& state,
+                  double& scene_distance, double& self_distance);
+
+  /** \brief Lower the distances to the closest ones along the commanded velocity over the lookahead horizon */
+  void checkLookahead(const planning_scene::PlanningScene& scene, double& scene_distance, double& self_distance);
+
+  /** \brief Compute the scales of this and the added groups from one batched distance query */
+  void runGroups(const planning_scene::PlanningScene& scene);
+
+  /** \brief Approximate the collision geometry of every robot link by spheres for distance field lookups */
+  void initLinkSpheres();
+
+  /** \brief Bring the distance field of the world up to date if the scene geometry changed since the last call */
+  void updateDistanceField(const planning_scene::PlanningScene& scene);
+
+  /** \brief Distance between the robot spheres and the world according to the distance field */
+  double getSceneDistanceFromField(const planning_scene::PlanningScene& scene,
+                                   const moveit::core::RobotState& state) const;
+
   // Pointer to the ROS node
   const std::shared_ptr<rclcpp::Node> node_;
 
@@ -108,6 +157,48 @@ private:
   collision_detection::CollisionRequest collision_request_;
   collision_detection::CollisionResult collision_result_;
 
+  // Groups added with addGroup(), checked in the same distance queries as the group of parameters_
+  struct CollisionGroup
+  {
+    ServoParameters::SharedConstPtr parameters;
+    const moveit::core::JointModelGroup* joint_model_group;
+    std::function<void(double)> velocity_scale_callback;
+    double scene_velocity_scale_coefficient;
+    double self_velocity_scale_coefficient;
+  };
+  std::vector<CollisionGroup> groups_;
+  collision_detection::DistanceRequest distance_request_;
+  collision_detection::DistanceResult distance_result_;
+  collision_detection::DistanceResult self_distance_result_;
+
+  // Commanded joint velocities for the lookahead check (mutex protected)
+  std::mutex commanded_velocity_mutex_;
+  Eigen::ArrayXd commanded_velocities_;
+  rclcpp::Time commanded_velocity_stamp_;
+  // Scratch buffers for the lookahead check
+  const moveit::core::JointModelGroup* joint_model_group_;
+  Eigen::ArrayXd lookahead_velocities_;
+  std::vector<double> lookahead_positions_;
+  std::unique_ptr<moveit::core::RobotState> lookahead_state_;
+
+  // Sphere approximating part of a link's collision geometry, relative to the collision body transform
+  struct LinkSphere
+  {
+    const moveit::core::LinkModel* link;
+    std::size_t shape_index;
+    Eigen::Vector3d center;
+    double radius;
+  };
+
+  // Distance field of the world for scene proximity checks, used instead of FCL if enabled in the parameters
+  std::vector<LinkSphere> link_spheres_;
+  std::unique_ptr<distance_field::PropagationDistanceField> distance_field_;
+  Eigen::AlignedBox3d distance_field_bounds_;
+  EigenSTL::vector_Vector3d world_points_;
+  double max_field_distance_ = 0;
+  // Set by the planning scene monitor whenever the world geometry changes
+  std::shared_ptr<std::atomic<bool>> distance_field_dirty_;
+
   // ROS
   rclcpp::TimerBase::SharedPtr timer_;
   double period_;  // The loop period, in seconds
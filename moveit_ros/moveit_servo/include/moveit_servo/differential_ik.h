@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+
+#include <moveit/robot_model/joint_model_group.h>
+
+namespace moveit_servo
+{
+/**
+ * \brief Incremental differential inverse kinematics with joint bounds
+ *
+ * Solves the bounded least squares problem
+ *   min 0.5 * ||J * dq - dx||^2 + 0.5 * damping * ||dq||^2   s.t.   lower <= dq <= upper
+ * with a primal active-set method. The solution and the active bounds of the previous call are the starting point
+ * of the next one, so in a servo loop most cycles converge within one or two iterations.
+ */
+class DifferentialIKSolver
+{
+public:
+  /**
+   * \param damping Damping of the joint deltas, keeps the problem well conditioned near singularities
+   * \param max_iterations Maximum number of active-set changes per solve, 0 selects three times the number of joints
+   */
+  explicit DifferentialIKSolver(double damping = 1e-4, std::size_t max_iterations = 0);
+
+  /**
+   * \brief Compute the joint deltas that best achieve a Cartesian delta within the given bounds
+   * \param jacobian Jacobian of the controlled dimensions
+   * \param delta_x Cartesian delta of the controlled dimensions
+   * \param lower Lower bounds of the joint deltas, at most zero
+   * \param upper Upper bounds of the joint deltas, at least zero
+   * \param delta_theta The joint deltas. They are within the bounds even if the solver did not converge
+   * \return True if the solver converged to the optimum
+   */
+  bool solve(const Eigen::MatrixXd& jacobian, const Eigen::VectorXd& delta_x, const Eigen::VectorXd& lower,
+             const Eigen::VectorXd& upper, Eigen::VectorXd& delta_theta);
+
+  /** \brief Forget the warm start, e.g. after the robot was halted */
+  void reset();
+
+  /** \brief Number of iterations of the last solve */
+  std::size_t getLastIterationCount() const
+  {
+    return last_iteration_count_;
+  }
+
+private:
+  enum BoundStatus : std::int8_t
+  {
+    AT_LOWER = -1,
+    FREE = 0,
+    AT_UPPER = 1
+  };
+
+  double damping_;
+  std::size_t max_iterations_;
+  std::size_t last_iteration_count_ = 0;
+
+  // Warm start
+  Eigen::VectorXd solution_;
+  std::vector<BoundStatus> status_;
+
+  // Buffers reused by every solve
+  Eigen::MatrixXd hessian_;
+  Eigen::VectorXd gradient_;
+  std::vector<Eigen::Index> free_indices_;
+  Eigen::MatrixXd free_hessian_;
+  Eigen::VectorXd free_rhs_;
+  Eigen::LDLT<Eigen::MatrixXd> free_ldlt_;
+};
+
+/**
+ * \brief Bounds of the joint deltas of one servo cycle from the joint position and velocity limits
+ *
+ * A joint that is already within the margin of a position limit may not move further towards it, but may move away.
+ * \param joint_model_group Active joint models to take the limits from
+ * \param positions Current positions of the active joints
+ * \param publish_period Duration of one servo cycle
+ * \param joint_limit_margin Distance to keep from the position limits
+ * \param lower Lower bounds of the joint deltas
+ * \param upper Upper bounds of the joint deltas
+ */
+void computeDifferentialIKBounds(const moveit::core::JointModelGroup* joint_model_group,
+                                 const Eigen::VectorXd& positions, double publish_period, double joint_limit_margin,
+                                 Eigen::VectorXd& lower, Eigen::VectorXd& upper);
+}  // namespace moveit_servo
@@ -40,6 +40,7 @@
 
 #include <atomic>
 #include <control_toolbox/pid.hpp>
+#include <moveit_msgs/msg/cartesian_trajectory.hpp>
 #include <moveit_servo/make_shared_from_pool.h>
 #include <moveit_servo/servo_parameters.h>
 #include <moveit_servo/servo.h>
@@ -117,6 +118,14 @@ public:
   /** \brief Re-initialize the target pose to an empty message. Can be used to reset motion between waypoints. */
   void resetTargetPose();
 
+  /**
+   * Track a time-parameterized Cartesian trajectory of the command frame instead of a single pose. The target pose
+   * and velocity are interpolated at the current time, measured from the header stamp. The velocity is fed forward
+   * and the PID controllers only correct the remaining error. After the last point, the last pose is held.
+   * The trajectory can also be sent on the target_trajectory topic.
+   */
+  void setTargetTrajectory(const moveit_msgs::msg::CartesianTrajectory& trajectory);
+
   // moveit_servo::Servo instance. Public so we can access member functions like setPaused()
   std::unique_ptr<moveit_servo::Servo> servo_;
 
@@ -139,6 +148,18 @@ private:
   /** \brief Subscribe to the target pose on this topic */
   void targetPoseCallback(const geometry_msgs::msg::PoseStamped::ConstSharedPtr& msg);
 
+  /**
+   * \brief Get the transform from the planning frame to a frame. Robot links and scene objects are resolved from the
+   * planning scene, other frames from the latest TF data without waiting.
+   */
+  bool getPlanningFrameTransform(const std::string& frame, Eigen::Isometry3d& transform);
+
+  /** \brief Set target_pose_ and target_twist_ from the target trajectory, target_pose_mtx_ must be locked */
+  void sampleTargetTrajectory(const rclcpp::Time& now);
+
+  /** \brief True while the target trajectory has points left, target_pose_mtx_ must be locked */
+  bool isTrackingTrajectory(const rclcpp::Time& now) const;
+
   /** \brief Update PID controller target positions & orientations */
   void updateControllerSetpoints();
 
@@ -173,10 +194,16 @@ private:
   Eigen::Isometry3d command_frame_transform_;
   rclcpp::Time command_frame_transform_stamp_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
   geometry_msgs::msg::PoseStamped target_pose_;
+  // Feed-forward velocity of the target, in the planning frame
+  geometry_msgs::msg::Twist target_twist_;
+  // Target trajectory in the planning frame, empty when tracking a single pose
+  moveit_msgs::msg::CartesianTrajectory target_trajectory_;
+  rclcpp::Time target_trajectory_start_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
   mutable std::mutex target_pose_mtx_;
 
   // Subscribe to target pose
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr target_pose_sub_;
+  rclcpp::Subscription<moveit_msgs::msg::CartesianTrajectory>::SharedPtr target_trajectory_sub_;
 
   tf2_ros::Buffer transform_buffer_;
   tf2_ros::TransformListener transform_listener_;
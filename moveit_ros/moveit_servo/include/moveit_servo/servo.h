@@ -85,6 +85,29 @@ public:
   bool getEEFrameTransform(Eigen::Isometry3d& transform);
   bool getEEFrameTransform(geometry_msgs::msg::TransformStamped& transform);
 
+  /** \brief Pass a Cartesian command from within the process, see ServoCalcs::setTwistCommand() */
+  bool setTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg);
+
+  /** \brief Pass a joint command from within the process, see ServoCalcs::setJointCommand() */
+  bool setJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg);
+
+  /** \brief Hand the outgoing commands to a function, see ServoCalcs::setCommandOutputCallback() */
+  void setCommandOutputCallback(const std::function<void(const trajectory_msgs::msg::JointTrajectory&)>& callback);
+
+  /**
+   * Check collisions of the group of another Servo instance in the collision checking timer of this instance, in the
+   * same distance queries as this group. The other instance does not check collisions on its own anymore.
+   * Both instances should use the same planning scene monitor and the other one must outlive this one.
+   * Call this before start().
+   */
+  void shareCollisionCheck(Servo& other);
+
+  /** \brief Get the durations of the stages of the calculation loop, see ServoCalcs::getTimingStatistics() */
+  ServoTimingStatistics getTimingStatistics() const;
+
+  /** \brief Restart collecting the timing statistics */
+  void resetTimingStatistics();
+
   /** \brief Get the parameters used by servo node. */
   const ServoParameters::SharedConstPtr& getParameters() const;
 
@@ -100,6 +123,9 @@ private:
 
   ServoCalcs servo_calcs_;
   CollisionCheck collision_checker_;
+
+  // True if another instance checks the collisions of this one, see shareCollisionCheck()
+  bool collision_check_shared_ = false;
 };
 
 // ServoPtr using alias
@@ -40,12 +40,14 @@
 
 // C++
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <atomic>
 
 // ROS
 #include <control_msgs/msg/joint_jog.hpp>
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <geometry_msgs/msg/twist_stamped.hpp>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
@@ -65,6 +67,9 @@
 
 // moveit_servo
 #include <moveit_servo/servo_parameters.h>
+#include <moveit_servo/differential_ik.h>
+#include <moveit_servo/servo_timing.h>
+#include <moveit_servo/spsc_queue.h>
 #include <moveit_servo/status_codes.h>
 #include <moveit/online_signal_smoothing/smoothing_base_class.h>
 
@@ -111,6 +116,55 @@ public:
   /** \brief Pause or unpause processing servo commands while keeping the timers alive */
   void setPaused(bool paused);
 
+  /**
+   * Get the durations of the stages of the calculation loop and the number of cycles that missed the publish
+   * period. The statistics are also published on /diagnostics once per second. Thread-safe.
+   */
+  ServoTimingStatistics getTimingStatistics() const;
+
+  /** \brief Restart collecting the timing statistics. Thread-safe. */
+  void resetTimingStatistics();
+
+  /**
+   * Pass a Cartesian command from within the process, without the command topic.
+   * The message is shared with the calculation thread without copying and without waiting for its lock.
+   * Only call this from one thread.
+   *
+   * @return false if the command queue is full, because the calculation loop did not consume the previous commands
+   */
+  bool setTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg);
+
+  /**
+   * Pass a joint command from within the process, without the command topic.
+   * The message is shared with the calculation thread without copying and without waiting for its lock.
+   * Only call this from one thread.
+   *
+   * @return false if the command queue is full, because the calculation loop did not consume the previous commands
+   */
+  bool setJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg);
+
+  /**
+   * Hand the outgoing commands to a function instead of publishing them, e.g. to write them to a ros2_control
+   * hardware interface. The function is called from the calculation thread and must not block.
+   * Call this before start(). An empty function restores publishing.
+   */
+  void setCommandOutputCallback(const std::function<void(const trajectory_msgs::msg::JointTrajectory&)>& callback);
+
+  /**
+   * Report the joint velocities requested by each command before collision scaling, e.g. to check the states
+   * they lead to. The function is called from the calculation thread. Call this before start().
+   */
+  void setCommandedVelocityCallback(const std::function<void(const Eigen::ArrayXd&)>& callback);
+
+  /**
+   * Take the collision velocity scale from a collision checker in the same process, e.g. one shared by several
+   * groups, instead of the ~/collision_velocity_scale topic. Call this before start().
+   */
+  void useInProcessCollisionVelocityScale();
+
+  /** \brief Set the collision velocity scale, see useInProcessCollisionVelocityScale(). Thread-safe. */
+  void setCollisionVelocityScale(double scale);
+
 protected:
   /** \brief Run the main calculation loop */
   void mainCalcLoop();
@@ -118,6 +172,12 @@ protected:
   /** \brief Do calculations for a single iteration. Publish one outgoing command */
   void calculateSingleIteration();
 
+  /**
+   * Set up the last sent command, the buffers reused by every iteration and the frame transforms from the current
+   * state, before the first calculateSingleIteration(). Called by start().
+   */
+  void initializeIterations();
+
   /** \brief Stop the currently running thread */
   void stop();
 
@@ -149,7 +209,7 @@ protected:
    * Also, multiply by timestep to calculate a position change.
    * @return a vector of position deltas
    */
-  Eigen::VectorXd scaleCartesianCommand(const geometry_msgs::msg::TwistStamped& command);
+  Eigen::Matrix<double, 6, 1> scaleCartesianCommand(const geometry_msgs::msg::TwistStamped& command);
 
   /** \brief If incoming velocity commands are from a unitless joystick, scale them to physical units.
    * Also, multiply by timestep to calculate a position change.
@@ -203,21 +263,16 @@ protected:
   void insertRedundantPointsIntoTrajectory(trajectory_msgs::msg::JointTrajectory& joint_trajectory, int count) const;
 
   /**
-   * Remove the Jacobian row and the delta-x element of one Cartesian dimension, to take advantage of task redundancy
-   *
-   * @param matrix The Jacobian matrix.
-   * @param delta_x Vector of Cartesian delta commands, should be the same size as matrix.rows()
-   * @param row_to_remove Dimension that will be allowed to drift, e.g. row_to_remove = 2 allows z-translation drift.
-   */
-  void removeDimension(Eigen::MatrixXd& matrix, Eigen::VectorXd& delta_x, unsigned int row_to_remove) const;
-
-  /**
-   * Removes all of the drift dimensions from the jacobian and delta-x element
+   * Copies the Jacobian rows and delta-x elements of all dimensions which are not allowed to drift.
+   * The output buffers are only reallocated when the number of drift dimensions changes.
    *
-   * @param matrix The Jacobian matrix.
-   * @param delta_x Vector of Cartesian delta commands, should be the same size as matrix.rows()
+   * @param matrix The full 6-row Jacobian matrix.
+   * @param delta_x Vector of Cartesian delta commands
+   * @param reduced_matrix The Jacobian rows of the controlled dimensions
+   * @param reduced_delta_x The Cartesian delta commands of the controlled dimensions
    */
-  void removeDriftDimensions(Eigen::MatrixXd& matrix, Eigen::VectorXd& delta_x);
+  void removeDriftDimensions(const Eigen::MatrixXd& matrix, const Eigen::Matrix<double, 6, 1>& delta_x,
+                             Eigen::MatrixXd& reduced_matrix, Eigen::VectorXd& reduced_delta_x) const;
 
   /**
    * Uses control_dimensions_ to set the incoming twist command values to 0 in uncontrolled directions
@@ -232,6 +287,15 @@ protected:
   /* \brief Command callbacks */
   void twistStampedCB(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg);
   void jointCmdCB(const control_msgs::msg::JointJog::ConstSharedPtr& msg);
+
+  /* \brief Set the latest commands, main_loop_mutex_ must be locked */
+  void updateTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg);
+  void updateJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg);
+
+  /* \brief Take over the commands passed with setTwistCommand() and setJointCommand(), main_loop_mutex_ must be
+   * locked
+   */
+  void consumeCommandQueues();
   void collisionVelocityScaleCB(const std_msgs::msg::Float64::ConstSharedPtr& msg);
 
   /**
@@ -304,6 +368,8 @@ protected:
   rclcpp::Subscription<control_msgs::msg::JointJog>::SharedPtr joint_cmd_sub_;
   rclcpp::Subscription<std_msgs::msg::Float64>::SharedPtr collision_velocity_scale_sub_;
   rclcpp::Publisher<std_msgs::msg::Int8>::SharedPtr status_pub_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr timing_diagnostics_pub_;
+  rclcpp::TimerBase::SharedPtr timing_diagnostics_timer_;
   rclcpp::Publisher<trajectory_msgs::msg::JointTrajectory>::SharedPtr trajectory_outgoing_cmd_pub_;
   rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr multiarray_outgoing_cmd_pub_;
   rclcpp::Service<moveit_msgs::srv::ChangeControlDimensions>::SharedPtr control_dimensions_server_;
@@ -321,11 +387,41 @@ protected:
   bool twist_command_is_stale_ = false;
   bool joint_command_is_stale_ = false;
   bool ok_to_publish_ = false;
-  double collision_velocity_scale_ = 1.0;
+  std::atomic<double> collision_velocity_scale_{ 1.0 };
 
   // Use ArrayXd type to enable more coefficient-wise operations
   Eigen::ArrayXd delta_theta_;
 
+  // Durations of the stages of the calculation loop
+  ServoTiming timing_;
+  std::uint64_t published_deadline_misses_ = 0;
+
+  /** \brief Publish the timing statistics as diagnostics */
+  void publishTimingDiagnostics();
+
+  // Buffers reused by every iteration to avoid allocating memory in the calculation loop
+  trajectory_msgs::msg::JointTrajectory joint_trajectory_;
+  std_msgs::msg::Float64MultiArray multiarray_outgoing_cmd_;
+  Eigen::MatrixXd jacobian_;
+  Eigen::MatrixXd controlled_jacobian_;
+  Eigen::VectorXd delta_x_;
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
+  Eigen::MatrixXd pseudo_inverse_;
+  // Cheap condition number estimation between full SVDs, see singularity_full_svd_period
+  Eigen::MatrixXd jjt_;
+  Eigen::LDLT<Eigen::MatrixXd> jjt_ldlt_;
+  Eigen::VectorXd max_singular_vector_;
+  Eigen::VectorXd min_singular_vector_;
+  double jacobian_condition_ = 1;
+  int cycles_since_full_svd_ = 0;
+  std::vector<double> ik_solution_;
+  // Bounded differential IK, see use_differential_ik
+  DifferentialIKSolver differential_ik_;
+  Eigen::VectorXd differential_ik_positions_;
+  Eigen::VectorXd differential_ik_lower_;
+  Eigen::VectorXd differential_ik_upper_;
+  Eigen::VectorXd differential_ik_solution_;
+
   const int gazebo_redundant_message_count_ = 30;
 
   unsigned int num_joints_;
@@ -351,6 +447,18 @@ protected:
   std::condition_variable input_cv_;
   bool new_input_cmd_ = false;
 
+  // Commands passed from within the process, which bypass main_loop_mutex_
+  static constexpr std::size_t COMMAND_QUEUE_SIZE = 8;
+  SPSCQueue<geometry_msgs::msg::TwistStamped::ConstSharedPtr, COMMAND_QUEUE_SIZE> twist_command_queue_;
+  SPSCQueue<control_msgs::msg::JointJog::ConstSharedPtr, COMMAND_QUEUE_SIZE> joint_command_queue_;
+
+  // Replaces the publication of outgoing commands, if set
+  std::function<void(const trajectory_msgs::msg::JointTrajectory&)> command_output_callback_;
+
+  // Receives the joint velocities of each command before collision scaling, if set
+  std::function<void(const Eigen::ArrayXd&)> commanded_velocity_callback_;
+  Eigen::ArrayXd commanded_velocity_;
+
   // dynamic parameters
   std::string robot_link_command_frame_;
   rcl_interfaces::msg::SetParametersResult robotLinkCommandFrameCallback(const rclcpp::Parameter& parameter);
@@ -58,6 +58,8 @@ public:
 
 private:
   std::shared_ptr<rclcpp::Node> node_;
+  // Servo instances of the additional_servo_namespaces, declared first so that servo_ is destroyed before them
+  std::vector<std::unique_ptr<moveit_servo::Servo>> additional_servos_;
   std::unique_ptr<moveit_servo::Servo> servo_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::shared_ptr<planning_scene_monitor::PlanningSceneMonitor> planning_scene_monitor_;
@@ -98,6 +98,10 @@ struct ServoParameters
   double lower_singularity_threshold{ 17.0 };
   double hard_stop_singularity_threshold{ 30.0 };
   double leaving_singularity_threshold_multiplier{ 2.0 };
+  int singularity_full_svd_period{ 1 };
+  // Bounded differential IK instead of the IK plugin or the pseudo-inverse
+  bool use_differential_ik{ false };
+  double differential_ik_damping{ 1e-4 };
   double joint_limit_margin{ 0.1 };
   bool low_latency_mode{ false };
   // Collision checking
@@ -105,6 +109,10 @@ struct ServoParameters
   double collision_check_rate{ 10.0 };
   double self_collision_proximity_threshold{ 0.01 };
   double scene_collision_proximity_threshold{ 0.02 };
+  bool use_distance_field_for_scene_collisions{ false };
+  double collision_lookahead_time{ 0.0 };
+  int collision_lookahead_steps{ 3 };
+  double distance_field_resolution{ 0.02 };
 
   /**
    * Declares, reads, and validates parameters used for moveit_servo
@@ -0,0 +1,173 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace moveit_servo
+{
+/** \brief Stages of a servo calculation cycle whose durations are measured */
+enum class ServoStage : std::size_t
+{
+  STATE_UPDATE = 0,    // current joint state and frame transforms
+  JACOBIAN,            // Jacobian and its (pseudo-)inverse
+  INVERSE_KINEMATICS,  // joint deltas from the IK plugin or the pseudo-inverse, singularity scaling
+  FILTERING,           // joint update and smoothing
+  LIMIT_ENFORCEMENT,   // velocity and position limits
+  PUBLISHING,          // outgoing command
+  CYCLE,               // the whole calculation cycle
+  COUNT
+};
+
+constexpr std::size_t NUM_SERVO_STAGES = static_cast<std::size_t>(ServoStage::COUNT);
+
+/** \brief Name of a stage for logging and diagnostics */
+const char* toString(ServoStage stage);
+
+/** \brief Histogram of durations with bucket bounds growing by powers of two from one microsecond */
+struct DurationHistogram
+{
+  // The last bucket counts everything above about half a second
+  static constexpr std::size_t NUM_BUCKETS = 20;
+
+  /** \brief Upper bound of a bucket in seconds */
+  static double bucketUpperBound(std::size_t bucket);
+
+  void add(double seconds);
+
+  /** \brief Upper bound of the bucket below which the given fraction of the durations lies, 0 if empty */
+  double percentile(double fraction) const;
+
+  double mean() const
+  {
+    return count > 0 ? total_seconds / count : 0.0;
+  }
+
+  std::array<std::uint64_t, NUM_BUCKETS> counts{};
+  std::uint64_t count = 0;
+  double total_seconds = 0;
+  double max_seconds = 0;
+  double last_seconds = 0;
+};
+
+/** \brief Timing statistics of the servo calculation loop since the start or the last reset */
+struct ServoTimingStatistics
+{
+  std::array<DurationHistogram, NUM_SERVO_STAGES> stages;
+  std::uint64_t cycles = 0;
+  // Cycles that took longer than the publish period
+  std::uint64_t deadline_misses = 0;
+
+  const DurationHistogram& stage(ServoStage stage) const
+  {
+    return stages[static_cast<std::size_t>(stage)];
+  }
+};
+
+/**
+ * Stage timer of the servo calculation loop. The durations of a cycle are collected without locking by the
+ * calculation thread and merged into the statistics once per cycle, so that other threads can read them.
+ */
+class ServoTiming
+{
+public:
+  /** \brief Ends the measurement of a stage when it goes out of scope */
+  class ScopedStage
+  {
+  public:
+    ScopedStage(ServoTiming& timing, ServoStage stage) : timing_(timing), stage_(stage)
+    {
+      timing_.startStage(stage_);
+    }
+    ~ScopedStage()
+    {
+      timing_.endStage(stage_);
+    }
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+  private:
+    ServoTiming& timing_;
+    const ServoStage stage_;
+  };
+
+  /** \brief Measure a stage until the returned object goes out of scope */
+  ScopedStage measure(ServoStage stage)
+  {
+    return ScopedStage(*this, stage);
+  }
+
+  void startStage(ServoStage stage)
+  {
+    stage_start_[static_cast<std::size_t>(stage)] = Clock::now();
+  }
+
+  void endStage(ServoStage stage)
+  {
+    const auto index = static_cast<std::size_t>(stage);
+    cycle_seconds_[index] += std::chrono::duration<double>(Clock::now() - stage_start_[index]).count();
+    stage_ran_[index] = true;
+  }
+
+  void startCycle();
+
+  /**
+   * \brief Add the durations of the cycle to the statistics
+   * \param period The deadline of the cycle in seconds
+   * \return the duration of the cycle in seconds
+   */
+  double endCycle(double period);
+
+  ServoTimingStatistics getStatistics() const;
+
+  void resetStatistics();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Only used by the calculation thread
+  std::array<Clock::time_point, NUM_SERVO_STAGES> stage_start_;
+  std::array<double, NUM_SERVO_STAGES> cycle_seconds_{};
+  std::array<bool, NUM_SERVO_STAGES> stage_ran_{};
+
+  mutable std::mutex statistics_mutex_;
+  ServoTimingStatistics statistics_;
+};
+}  // namespace moveit_servo
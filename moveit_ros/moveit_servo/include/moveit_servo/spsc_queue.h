@@ -0,0 +1,92 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace moveit_servo
+{
+/**
+ * Bounded lock-free single-producer single-consumer queue.
+ * push() must only be called from one thread and pop() from one other thread.
+ */
+template <typename T, std::size_t Capacity>
+class SPSCQueue
+{
+public:
+  /** \brief Add an element, fails if the queue is full. Only call from the producer thread. */
+  bool push(T value)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t next = increment(tail);
+    if (next == head_.load(std::memory_order_acquire))
+      return false;
+    buffer_[tail] = std::move(value);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /** \brief Remove the oldest element, fails if the queue is empty. Only call from the consumer thread. */
+  bool pop(T& value)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    value = std::move(buffer_[head]);
+    head_.store(increment(head), std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const
+  {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  static std::size_t increment(std::size_t index)
+  {
+    return (index + 1) % (Capacity + 1);
+  }
+
+  // One slot stays empty to distinguish a full queue from an empty one
+  std::array<T, Capacity + 1> buffer_;
+  // Keep the indices of the two threads in different cache lines
+  alignas(64) std::atomic<std::size_t> head_{ 0 };
+  alignas(64) std::atomic<std::size_t> tail_{ 0 };
+};
+}  // namespace moveit_servo
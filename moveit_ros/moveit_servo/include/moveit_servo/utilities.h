@@ -34,6 +34,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include <control_msgs/msg/joint_jog.hpp>
 #include <geometry_msgs/msg/twist_stamped.hpp>
 #include <moveit/robot_model/joint_model_group.h>
@@ -78,4 +80,36 @@ double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup*
                                            const double leaving_singularity_threshold_multiplier, rclcpp::Clock& clock,
                                            moveit::core::RobotStatePtr& current_state, StatusCode& status);
 
+/** \brief Possibly calculate a velocity scaling factor, due to proximity of
+ * singularity and direction of motion, from a given condition number instead of an SVD
+ * @param[in] vector_toward_singularity  Left singular vector of the smallest singular value, of either sign
+ * @param[in] ini_condition              The condition number of the Jacobian
+ * @param[in] condition_number           Computes the condition number of the Jacobian of a nearby state
+ * The other parameters are the same as above.
+ */
+double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup* joint_model_group,
+                                           const Eigen::VectorXd& commanded_twist,
+                                           const Eigen::VectorXd& vector_toward_singularity,
+                                           const double ini_condition,
+                                           const std::function<double(const Eigen::MatrixXd&)>& condition_number,
+                                           const Eigen::MatrixXd& pseudo_inverse,
+                                           const double hard_stop_singularity_threshold,
+                                           const double lower_singularity_threshold,
+                                           const double leaving_singularity_threshold_multiplier, rclcpp::Clock& clock,
+                                           moveit::core::RobotStatePtr& current_state, StatusCode& status);
+
+/** \brief Estimate the condition number of a Jacobian J without an SVD
+ *
+ * The left singular vectors of the largest and smallest singular values are refined by one step of power and
+ * inverse iteration on J * J^T. Starting from the vectors of the previous servo cycle this converges quickly,
+ * because the Jacobian changes little between cycles. The estimate never exceeds the true condition number.
+ * @param[in] jjt               J * J^T
+ * @param[in] jjt_ldlt          A factorization of J * J^T
+ * @param[in, out] max_vector   Unit vector estimate of the left singular vector of the largest singular value
+ * @param[in, out] min_vector   Unit vector estimate of the left singular vector of the smallest singular value
+ * @return the estimated condition number, infinity if J * J^T is singular
+ */
+double estimateJacobianCondition(const Eigen::MatrixXd& jjt, const Eigen::LDLT<Eigen::MatrixXd>& jjt_ldlt,
+                                 Eigen::VectorXd& max_vector, Eigen::VectorXd& min_vector);
+
 }  // namespace moveit_servo
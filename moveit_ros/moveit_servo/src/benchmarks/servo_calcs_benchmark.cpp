@@ -0,0 +1,385 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Steps ServoCalcs with synthetic twist and joint jog command streams on the Panda test model, without sleeping
+ * between iterations, and reports the latency percentiles, the jitter and the deadline misses of the iterations for
+ * several loop rates, with and without collision checking. The joint states fed back to servo are its own commands. */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+#include <geometric_shapes/shapes.h>
+#include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit/rdf_loader/rdf_loader.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <rclcpp/rclcpp.hpp>
+
+#include <moveit_servo/collision_check.h>
+#include <moveit_servo/servo_calcs.h>
+#include <moveit_servo/servo_parameters.h>
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_servo.servo_calcs_benchmark");
+
+namespace
+{
+constexpr double STREAM_FREQUENCY = 0.5;  // Hz, of the synthetic command streams
+constexpr double PI = 3.14159265358979323846;
+
+/** \brief Joint state middleware which hands the joint state callback to the benchmark instead of subscribing */
+class FeedbackMiddlewareHandle : public planning_scene_monitor::CurrentStateMonitor::MiddlewareHandle
+{
+public:
+  FeedbackMiddlewareHandle(const rclcpp::Node::SharedPtr& node,
+                           planning_scene_monitor::JointStateUpdateCallback& joint_state_callback)
+    : node_(node), joint_state_callback_(joint_state_callback)
+  {
+  }
+
+  rclcpp::Time now() const override
+  {
+    return node_->now();
+  }
+  void createJointStateSubscription(const std::string& /*topic*/,
+                                    planning_scene_monitor::JointStateUpdateCallback callback) override
+  {
+    joint_state_callback_ = std::move(callback);
+  }
+  void createStaticTfSubscription(TfCallback /*callback*/) override
+  {
+  }
+  void createDynamicTfSubscription(TfCallback /*callback*/) override
+  {
+  }
+  void resetJointStateSubscription() override
+  {
+    joint_state_callback_ = nullptr;
+  }
+  void resetTfSubscriptions() override
+  {
+  }
+  std::string getJointStateTopicName() const override
+  {
+    return "joint_states";
+  }
+  std::string getStaticTfTopicName() const override
+  {
+    return "tf_static";
+  }
+  std::string getDynamicTfTopicName() const override
+  {
+    return "tf";
+  }
+  bool sleepFor(const std::chrono::nanoseconds& nanoseconds) const override
+  {
+    rclcpp::sleep_for(nanoseconds);
+    return true;
+  }
+  bool ok() const override
+  {
+    return rclcpp::ok();
+  }
+
+private:
+  const rclcpp::Node::SharedPtr node_;
+  planning_scene_monitor::JointStateUpdateCallback& joint_state_callback_;
+};
+
+/** \brief ServoCalcs whose iterations are run by the caller instead of the loop thread */
+class SteppedServoCalcs : public moveit_servo::ServoCalcs
+{
+public:
+  using ServoCalcs::ServoCalcs;
+
+  void initialize()
+  {
+    initializeIterations();
+  }
+
+  /** \brief Run one iteration like the calculation loop does */
+  void step()
+  {
+    const std::lock_guard<std::mutex> lock(main_loop_mutex_);
+    consumeCommandQueues();
+    timing_.startCycle();
+    calculateSingleIteration();
+    timing_.endCycle(parameters_->publish_period);
+  }
+};
+
+enum class Stream
+{
+  TWIST,
+  JOINT_JOG
+};
+
+struct Configuration
+{
+  Stream stream;
+  bool check_collisions;
+  double rate;
+};
+
+struct Result
+{
+  Configuration configuration;
+  std::vector<double> latencies;  // seconds, sorted
+  double mean = 0;
+  double stddev = 0;
+  double jitter = 0;  // mean difference of consecutive latencies
+  std::size_t deadline_misses = 0;
+  std::size_t collision_checks = 0;
+  double collision_check_mean = 0;
+};
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+  const std::size_t index = std::min(sorted.size() - 1, static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+/** \brief Load the URDF and SRDF the Panda test model is built from */
+robot_model_loader::RobotModelLoaderPtr loadPandaModel(const rclcpp::Node::SharedPtr& node)
+{
+  std::string urdf, srdf;
+  if (!rdf_loader::RDFLoader::loadPkgFileToString(urdf, "moveit_resources_panda_description", "urdf/panda.urdf", {}) ||
+      !rdf_loader::RDFLoader::loadPkgFileToString(srdf, "moveit_resources_panda_moveit_config", "config/panda.srdf",
+                                                  {}))
+  {
+    return nullptr;
+  }
+  robot_model_loader::RobotModelLoader::Options options(urdf, srdf);
+  // Like the test model, without a kinematics plugin servo uses the inverse Jacobian
+  options.load_kinematics_solvers_ = false;
+  return std::make_shared<robot_model_loader::RobotModelLoader>(node, options);
+}
+
+Result runConfiguration(const Configuration& configuration, std::size_t iterations, std::size_t warmup_iterations)
+{
+  rclcpp::NodeOptions node_options;
+  node_options.parameter_overrides({ { "moveit_servo.publish_period", 1.0 / configuration.rate },
+                                     { "moveit_servo.check_collisions", configuration.check_collisions } });
+  const auto node = std::make_shared<rclcpp::Node>("servo_calcs_benchmark", node_options);
+  const auto parameters = moveit_servo::ServoParameters::makeServoParameters(node);
+  if (!parameters)
+    throw std::runtime_error("Invalid servo parameters");
+
+  const robot_model_loader::RobotModelLoaderPtr loader = loadPandaModel(node);
+  if (!loader || !loader->getModel())
+    throw std::runtime_error("Cannot load the Panda model, is moveit_resources_panda_moveit_config installed?");
+  // Joint states are fed back by the benchmark, not received from a topic. Declared first, the state monitor of the
+  // planning scene monitor resets it when destroyed.
+  planning_scene_monitor::JointStateUpdateCallback joint_state_callback;
+  const auto psm = std::make_shared<planning_scene_monitor::PlanningSceneMonitor>(node, loader);
+  psm->getStateMonitorNonConst() = std::make_shared<planning_scene_monitor::CurrentStateMonitor>(
+      std::make_unique<FeedbackMiddlewareHandle>(node, joint_state_callback), psm->getRobotModel(),
+      std::make_shared<tf2_ros::Buffer>(node->get_clock()), false);
+  psm->getStateMonitor()->startStateMonitor();
+
+  // An obstacle in front of the arm, so that the scene distances vary while servoing
+  {
+    planning_scene_monitor::LockedPlanningSceneRW scene(psm);
+    scene->getWorldNonConst()->addToObject("obstacle", std::make_shared<shapes::Box>(0.1, 0.4, 0.4),
+                                           Eigen::Isometry3d(Eigen::Translation3d(0.6, 0.0, 0.4)));
+  }
+
+  const moveit::core::JointModelGroup* group = psm->getRobotModel()->getJointModelGroup(parameters->move_group_name);
+  moveit::core::RobotState ready(psm->getRobotModel());
+  ready.setToDefaultValues(group, "ready");
+  auto joint_state = std::make_shared<sensor_msgs::msg::JointState>();
+  joint_state->name = group->getActiveJointModelNames();
+  ready.copyJointGroupPositions(group, joint_state->position);
+  joint_state->velocity.assign(joint_state->name.size(), 0.0);
+  joint_state->header.stamp = node->now();
+  joint_state_callback(joint_state);
+
+  SteppedServoCalcs servo_calcs(node, parameters, psm);
+  servo_calcs.setCommandOutputCallback([&](const trajectory_msgs::msg::JointTrajectory& trajectory) {
+    if (trajectory.points.empty())
+      return;
+    auto feedback = std::make_shared<sensor_msgs::msg::JointState>();
+    feedback->header.stamp = node->now();
+    feedback->name = trajectory.joint_names;
+    feedback->position = trajectory.points.front().positions;
+    feedback->velocity = trajectory.points.front().velocities;
+    joint_state_callback(feedback);
+  });
+
+  std::unique_ptr<moveit_servo::CollisionCheck> collision_check;
+  if (configuration.check_collisions)
+  {
+    collision_check = std::make_unique<moveit_servo::CollisionCheck>(node, parameters, psm);
+    servo_calcs.useInProcessCollisionVelocityScale();
+    servo_calcs.setCommandedVelocityCallback([&collision_check](const Eigen::ArrayXd& velocities) {
+      collision_check->setCommandedJointVelocities(velocities);
+    });
+  }
+  servo_calcs.initialize();
+
+  Result result;
+  result.configuration = configuration;
+  result.latencies.reserve(iterations);
+  double collision_check_total = 0;
+  const double period = 1.0 / configuration.rate;
+  for (std::size_t i = 0; i < warmup_iterations + iterations; ++i)
+  {
+    // The streams follow the simulated time of the loop, not the wall time
+    const double t = static_cast<double>(i) * period;
+    const double phase = 2.0 * PI * STREAM_FREQUENCY * t;
+    if (configuration.stream == Stream::TWIST)
+    {
+      auto twist = std::make_shared<geometry_msgs::msg::TwistStamped>();
+      twist->header.stamp = node->now();
+      twist->header.frame_id = parameters->robot_link_command_frame;
+      twist->twist.linear.x = 0.5 * std::sin(phase);
+      twist->twist.linear.y = 0.5 * std::cos(phase);
+      twist->twist.angular.z = 0.3 * std::sin(2.0 * phase);
+      servo_calcs.setTwistCommand(twist);
+    }
+    else
+    {
+      auto jog = std::make_shared<control_msgs::msg::JointJog>();
+      jog->header.stamp = node->now();
+      jog->joint_names = joint_state->name;
+      for (std::size_t j = 0; j < jog->joint_names.size(); ++j)
+        jog->velocities.push_back(0.5 * std::sin(phase + static_cast<double>(j)));
+      servo_calcs.setJointCommand(jog);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    // The collision check runs at its own rate, on the iterations its timer would have fired
+    const bool run_check = collision_check && std::floor(t * parameters->collision_check_rate) !=
+                                                  std::floor((t - period) * parameters->collision_check_rate);
+    if (run_check)
+    {
+      const auto check_start = std::chrono::steady_clock::now();
+      servo_calcs.setCollisionVelocityScale(collision_check->runOnce());
+      if (i >= warmup_iterations)
+      {
+        collision_check_total += std::chrono::duration<double>(std::chrono::steady_clock::now() - check_start).count();
+        ++result.collision_checks;
+      }
+    }
+    servo_calcs.step();
+    const double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (i < warmup_iterations)
+      continue;
+    if (!result.latencies.empty())
+      result.jitter += std::abs(latency - result.latencies.back());
+    result.latencies.push_back(latency);
+    if (latency > period)
+      ++result.deadline_misses;
+  }
+
+  const double n = static_cast<double>(result.latencies.size());
+  result.mean = std::accumulate(result.latencies.begin(), result.latencies.end(), 0.0) / n;
+  for (double latency : result.latencies)
+    result.stddev += (latency - result.mean) * (latency - result.mean);
+  result.stddev = std::sqrt(result.stddev / n);
+  result.jitter /= std::max(1.0, n - 1);
+  if (result.collision_checks > 0)
+    result.collision_check_mean = collision_check_total / static_cast<double>(result.collision_checks);
+  std::sort(result.latencies.begin(), result.latencies.end());
+  return result;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  rclcpp::NodeOptions node_options;
+  node_options.allow_undeclared_parameters(true);
+  node_options.automatically_declare_parameters_from_overrides(true);
+  const auto node = std::make_shared<rclcpp::Node>("servo_calcs_benchmark_options", node_options);
+  const auto iterations = static_cast<std::size_t>(std::max(1, node->get_parameter_or<int>("iterations", 5000)));
+  const auto warmup_iterations =
+      static_cast<std::size_t>(std::max(0, node->get_parameter_or<int>("warmup_iterations", 100)));
+  const std::vector<double> rates =
+      node->get_parameter_or("rates", std::vector<double>{ 500.0, 1000.0, 2000.0 });
+  const std::string output_file = node->get_parameter_or<std::string>("output_file", "");
+
+  std::vector<Result> results;
+  try
+  {
+    for (Stream stream : { Stream::TWIST, Stream::JOINT_JOG })
+      for (bool check_collisions : { false, true })
+        for (double rate : rates)
+          results.push_back(runConfiguration({ stream, check_collisions, rate }, iterations, warmup_iterations));
+  }
+  catch (const std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "%s", e.what());
+    rclcpp::shutdown();
+    return 1;
+  }
+
+  std::ofstream out;
+  if (!output_file.empty())
+  {
+    out.open(output_file);
+    out << "stream,collision_checking,rate_hz,iterations,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,stddev_us,"
+           "jitter_us,deadline_misses,collision_checks,collision_check_mean_us\n";
+  }
+  for (const Result& result : results)
+  {
+    const Configuration& c = result.configuration;
+    const char* stream = c.stream == Stream::TWIST ? "twist" : "joint_jog";
+    RCLCPP_INFO(LOGGER,
+                "%-9s collisions %-3s %6.0f Hz: mean %7.1f us, p50 %7.1f, p99 %7.1f, p99.9 %7.1f, max %7.1f, "
+                "jitter %6.1f us, deadline misses %zu / %zu",
+                stream, c.check_collisions ? "on" : "off", c.rate, result.mean * 1e6,
+                percentile(result.latencies, 0.5) * 1e6, percentile(result.latencies, 0.99) * 1e6,
+                percentile(result.latencies, 0.999) * 1e6, result.latencies.back() * 1e6, result.jitter * 1e6,
+                result.deadline_misses, result.latencies.size());
+    if (out.is_open())
+    {
+      out << stream << ',' << c.check_collisions << ',' << c.rate << ',' << result.latencies.size() << ','
+          << result.mean * 1e6 << ',' << percentile(result.latencies, 0.5) * 1e6 << ','
+          << percentile(result.latencies, 0.9) * 1e6 << ',' << percentile(result.latencies, 0.99) * 1e6 << ','
+          << percentile(result.latencies, 0.999) * 1e6 << ',' << result.latencies.back() * 1e6 << ','
+          << result.stddev * 1e6 << ',' << result.jitter * 1e6 << ',' << result.deadline_misses << ','
+          << result.collision_checks << ',' << result.collision_check_mean * 1e6 << '\n';
+    }
+  }
+  if (out.is_open())
+    RCLCPP_INFO(LOGGER, "Wrote the results to '%s'", output_file.c_str());
+
+  rclcpp::shutdown();
+  return 0;
+}
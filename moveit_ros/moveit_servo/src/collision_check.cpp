@@ -37,8 +37,17 @@
  *      Author    : Brian O'Neil, Andy Zelenak, Blake Anderson
  */
 
+#include <algorithm>
+#include <limits>
+
+#include <geometric_shapes/bodies.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 #include <std_msgs/msg/float64.hpp>
 
+#include <moveit/collision_distance_field/collision_distance_field_types.h>
+#include <moveit/distance_field/find_internal_points.h>
+#include <moveit/utils/thread_config.h>
 #include <moveit_servo/collision_check.h>
 // #include <moveit_servo/make_shared_from_pool.h>
 
@@ -48,6 +57,128 @@ constexpr size_t ROS_LOG_THROTTLE_PERIOD = 30 * 1000;  // Milliseconds to thrott
 
 namespace moveit_servo
 {
+namespace
+{
+// Collect the occupied points of all world objects at the given resolution, together with their bounding box
+void collectWorldPoints(const collision_detection::World& world, double resolution, EigenSTL::vector_Vector3d& points,
+                        Eigen::AlignedBox3d& bounds)
+{
+  points.clear();
+  bounds.setEmpty();
+  for (const auto& object : world)
+  {
+    for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+    {
+      const shapes::ShapeConstPtr& shape = object.second->shapes_[i];
+      const Eigen::Isometry3d& pose = object.second->global_shape_poses_[i];
+      if (shape->type == shapes::OCTREE)
+      {
+        const std::shared_ptr<const octomap::OcTree>& octree = static_cast<const shapes::OcTree&>(*shape).octree;
+        for (auto it = octree->begin_leafs(), end = octree->end_leafs(); it != end; ++it)
+        {
+          if (!octree->isNodeOccupied(*it))
+            continue;
+          // Coarse leaves are sampled at the field resolution so that they are filled completely
+          const double half_size = it.getSize() / 2.0;
+          const Eigen::Vector3d center(it.getX(), it.getY(), it.getZ());
+          const double start = half_size > resolution ? -half_size + resolution / 2.0 : 0.0;
+          for (double x = start; x <= -start; x += resolution)
+          {
+            for (double y = start; y <= -start; y += resolution)
+            {
+              for (double z = start; z <= -start; z += resolution)
+              {
+                points.push_back(pose * (center + Eigen::Vector3d(x, y, z)));
+                bounds.extend(points.back());
+              }
+            }
+          }
+        }
+        continue;
+      }
+
+      std::unique_ptr<bodies::Body> body(bodies::createBodyFromShape(shape.get()));
+      if (!body || shape->type == shapes::PLANE)
+      {
+        RCLCPP_WARN_STREAM(LOGGER, "Shape of world object '" << object.first
+                                                             << "' cannot be added to the distance field, ignoring it");
+        continue;
+      }
+      body->setPose(pose);
+      const std::size_t previous_size = points.size();
+      EigenSTL::vector_Vector3d body_points;
+      distance_field::findInternalPointsConvex(*body, resolution, body_points);
+      points.insert(points.end(), body_points.begin(), body_points.end());
+      for (std::size_t j = previous_size; j < points.size(); ++j)
+        bounds.extend(points[j]);
+    }
+  }
+}
+}
+
+// Scale robot velocity according to collision proximity and the thresholds of the parameters
+double proximityVelocityScale(bool collision, double scene_distance, double self_distance,
+                              const ServoParameters& parameters, double scene_coefficient, double self_coefficient)
+{
+  double velocity_scale = 1;
+  // If we're definitely in collision, stop immediately
+  if (collision)
+  {
+    velocity_scale = 0;
+  }
+  else
+  {
+    // If we are far from a collision, velocity_scale should be 1.
+    // If we are very close to a collision, velocity_scale should be ~zero.
+    // When scene_collision_proximity_threshold is breached, start decelerating exponentially.
+    if (scene_distance < parameters.scene_collision_proximity_threshold)
+    {
+      // velocity_scale = e ^ k * (collision_distance - threshold)
+      // k = - ln(0.001) / collision_proximity_threshold
+      // velocity_scale should equal one when collision_distance is at collision_proximity_threshold.
+      // velocity_scale should equal 0.001 when collision_distance is at zero.
+      velocity_scale = std::min(
+          velocity_scale, exp(scene_coefficient * (scene_distance - parameters.scene_collision_proximity_threshold)));
+    }
+
+    if (self_distance < parameters.self_collision_proximity_threshold)
+    {
+      velocity_scale = std::min(
+          velocity_scale, exp(self_coefficient * (self_distance - parameters.self_collision_proximity_threshold)));
+    }
+  }
+  return velocity_scale;
+}
+
+// Minimum distance of the pairs that involve a link moved by the group, or an object attached to one
+double groupDistance(const collision_detection::DistanceResult& result, const moveit::core::JointModelGroup& group,
+                     const moveit::core::RobotState& state)
+{
+  const std::set<std::string>& links = group.getUpdatedLinkModelsWithGeometryNamesSet();
+  const auto involves_group = [&](const collision_detection::DistanceResultsData& data, std::size_t i) {
+    if (data.body_types[i] == collision_detection::BodyTypes::ROBOT_LINK)
+      return links.count(data.link_names[i]) > 0;
+    if (data.body_types[i] == collision_detection::BodyTypes::ROBOT_ATTACHED)
+    {
+      const moveit::core::AttachedBody* attached_body = state.getAttachedBody(data.link_names[i]);
+      return attached_body && links.count(attached_body->getAttachedLinkName()) > 0;
+    }
+    return false;
+  };
+
+  double distance = std::numeric_limits<double>::max();
+  for (const auto& pair : result.distances)
+  {
+    for (const collision_detection::DistanceResultsData& data : pair.second)
+    {
+      if (involves_group(data, 0) || involves_group(data, 1))
+        distance = std::min(distance, data.distance);
+    }
+  }
+  return distance;
+}
+}  // namespace
+
 // Constructor for the class that handles collision checking
 CollisionCheck::CollisionCheck(const rclcpp::Node::SharedPtr& node, const ServoParameters::SharedConstPtr& parameters,
                                const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor)
@@ -75,6 +206,205 @@ CollisionCheck::CollisionCheck(const rclcpp::Node::SharedPtr& node, const ServoP
       node_->create_publisher<std_msgs::msg::Float64>("~/collision_velocity_scale", rclcpp::SystemDefaultsQoS());
 
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  joint_model_group_ = current_state_->getJointModelGroup(parameters_->move_group_name);
+  commanded_velocity_stamp_ = node_->now();
+  if (parameters_->collision_lookahead_time > 0)
+    lookahead_state_ = std::make_unique<moveit::core::RobotState>(*current_state_);
+
+  if (parameters_->use_distance_field_for_scene_collisions)
+  {
+    initLinkSpheres();
+    // The flag is shared with the callback, which may outlive this object inside the planning scene monitor
+    distance_field_dirty_ = std::make_shared<std::atomic<bool>>(true);
+    planning_scene_monitor_->addUpdateCallback(
+        [dirty = distance_field_dirty_](planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType type) {
+          if (type & planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY)
+            dirty->store(true);
+        });
+  }
+}
+
+void CollisionCheck::initLinkSpheres()
+{
+  link_spheres_.clear();
+  double max_radius = 0;
+  for (const moveit::core::LinkModel* link : current_state_->getRobotModel()->getLinkModelsWithCollisionGeometry())
+  {
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      // The body stays at the identity, so the spheres are relative to the link's collision body transform
+      std::unique_ptr<bodies::Body> body(bodies::createBodyFromShape(link->getShapes()[i].get()));
+      if (!body)
+        continue;
+      Eigen::Isometry3d relative_transform = Eigen::Isometry3d::Identity();
+      std::vector<collision_detection::CollisionSphere> spheres =
+          collision_detection::determineCollisionSpheres(body.get(), relative_transform);
+      // Short and thick shapes do not get a cylinder decomposition
+      if (spheres.empty())
+      {
+        bodies::BoundingSphere bounding_sphere;
+        body->computeBoundingSphere(bounding_sphere);
+        spheres.emplace_back(bounding_sphere.center, bounding_sphere.radius);
+      }
+      for (const collision_detection::CollisionSphere& sphere : spheres)
+      {
+        link_spheres_.push_back({ link, i, sphere.relative_vec_, sphere.radius_ });
+        max_radius = std::max(max_radius, sphere.radius_);
+      }
+    }
+  }
+
+  // Sphere centers must see obstacles up to the proximity threshold away from the sphere surface
+  max_field_distance_ =
+      parameters_->scene_collision_proximity_threshold + max_radius + parameters_->distance_field_resolution;
+  RCLCPP_INFO_STREAM(LOGGER, "Approximated the robot by " << link_spheres_.size()
+                                                          << " spheres for distance field collision checking");
+}
+
+void CollisionCheck::updateDistanceField(const planning_scene::PlanningScene& scene)
+{
+  if (!distance_field_dirty_->exchange(false))
+    return;
+
+  const double resolution = parameters_->distance_field_resolution;
+  EigenSTL::vector_Vector3d points;
+  Eigen::AlignedBox3d bounds;
+  collectWorldPoints(*scene.getWorld(), resolution, points, bounds);
+  if (points.empty())
+  {
+    distance_field_.reset();
+    world_points_.clear();
+    return;
+  }
+
+  bounds.min().array() -= max_field_distance_;
+  bounds.max().array() += max_field_distance_;
+  if (distance_field_ && distance_field_bounds_.contains(bounds))
+  {
+    // Only the cells around the points that were added or removed are propagated again
+    distance_field_->updatePointsInField(world_points_, points);
+  }
+  else
+  {
+    distance_field_bounds_ = bounds;
+    const Eigen::Vector3d size = bounds.sizes();
+    distance_field_ = std::make_unique<distance_field::PropagationDistanceField>(
+        size.x(), size.y(), size.z(), resolution, bounds.min().x(), bounds.min().y(), bounds.min().z(),
+        max_field_distance_);
+    distance_field_->addPointsToField(points);
+  }
+  world_points_ = std::move(points);
+}
+
+double CollisionCheck::getSceneDistanceFromField(const planning_scene::PlanningScene& scene,
+                                                 const moveit::core::RobotState& state) const
+{
+  double min_distance = std::numeric_limits<double>::max();
+  if (!distance_field_)
+    return min_distance;
+
+  // Cells outside of the field report the maximum distance, which is beyond the proximity threshold
+  const collision_detection::CollisionEnvConstPtr& env = scene.getCollisionEnv();
+  for (const LinkSphere& sphere : link_spheres_)
+  {
+    const Eigen::Vector3d center =
+        state.getCollisionBodyTransform(sphere.link, sphere.shape_index) * sphere.center;
+    const double distance = distance_field_->getDistance(center.x(), center.y(), center.z()) - sphere.radius -
+                            env->getLinkPadding(sphere.link->getName());
+    min_distance = std::min(min_distance, distance);
+  }
+
+  // Attached objects change at runtime, so they are approximated by one bounding sphere per shape
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    for (std::size_t i = 0; i < attached_body->getShapes().size(); ++i)
+    {
+      std::unique_ptr<bodies::Body> body(bodies::createBodyFromShape(attached_body->getShapes()[i].get()));
+      if (!body)
+        continue;
+      body->setPose(attached_body->getGlobalCollisionBodyTransforms()[i]);
+      bodies::BoundingSphere bounding_sphere;
+      body->computeBoundingSphere(bounding_sphere);
+      const Eigen::Vector3d& center = bounding_sphere.center;
+      min_distance = std::min(min_distance, distance_field_->getDistance(center.x(), center.y(), center.z()) -
+                                                bounding_sphere.radius);
+    }
+  }
+  return min_distance;
+}
+
+bool CollisionCheck::checkState(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& state,
+                                double& scene_distance, double& self_distance)
+{
+  bool collision = false;
+  collision_result_.clear();
+  if (parameters_->use_distance_field_for_scene_collisions)
+  {
+    scene_distance = getSceneDistanceFromField(scene, state);
+    collision |= scene_distance <= 0;
+  }
+  else
+  {
+    scene.getCollisionEnv()->checkRobotCollision(collision_request_, collision_result_, state,
+                                                 scene.getAllowedCollisionMatrix());
+    scene_distance = collision_result_.distance;
+    collision |= collision_result_.collision;
+    collision_result_.print();
+  }
+
+  collision_result_.clear();
+  // Self-collisions and scene collisions are checked separately so different thresholds can be used
+  scene.getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, collision_result_, state,
+                                                      scene.getAllowedCollisionMatrix());
+  self_distance = collision_result_.distance;
+  collision |= collision_result_.collision;
+  collision_result_.print();
+  return collision;
+}
+
+void CollisionCheck::setCommandedJointVelocities(const Eigen::ArrayXd& velocities)
+{
+  const std::lock_guard<std::mutex> lock(commanded_velocity_mutex_);
+  commanded_velocities_ = velocities;
+  commanded_velocity_stamp_ = node_->now();
+}
+
+void CollisionCheck::checkLookahead(const planning_scene::PlanningScene& scene, double& scene_distance,
+                                    double& self_distance)
+{
+  {
+    const std::lock_guard<std::mutex> lock(commanded_velocity_mutex_);
+    // Servo stops when the commands time out, so old velocities do not predict anything
+    if ((node_->now() - commanded_velocity_stamp_).seconds() > parameters_->incoming_command_timeout)
+      return;
+    lookahead_velocities_ = commanded_velocities_;
+  }
+  if (lookahead_velocities_.size() != static_cast<Eigen::Index>(joint_model_group_->getVariableCount()) ||
+      lookahead_velocities_.isZero())
+    return;
+
+  *lookahead_state_ = *current_state_;
+  current_state_->copyJointGroupPositions(joint_model_group_, lookahead_positions_);
+  const double time_step = parameters_->collision_lookahead_time / parameters_->collision_lookahead_steps;
+  for (int step = 1; step <= parameters_->collision_lookahead_steps; ++step)
+  {
+    for (std::size_t i = 0; i < lookahead_positions_.size(); ++i)
+      lookahead_positions_[i] += lookahead_velocities_[i] * time_step;
+    lookahead_state_->setJointGroupPositions(joint_model_group_, lookahead_positions_);
+    lookahead_state_->enforceBounds(joint_model_group_);
+    lookahead_state_->updateCollisionBodyTransforms();
+
+    // A predicted collision slows down to the minimum scale instead of halting, so the robot can still be
+    // commanded away from it
+    double future_scene_distance, future_self_distance;
+    const bool collision = checkState(scene, *lookahead_state_, future_scene_distance, future_self_distance);
+    scene_distance = std::min(scene_distance, collision ? 0.0 : future_scene_distance);
+    self_distance = std::min(self_distance, collision ? 0.0 : future_self_distance);
+    if (collision)
+      break;
+  }
 }
 
 void CollisionCheck::start()
@@ -84,6 +414,8 @@ void CollisionCheck::start()
 
 void CollisionCheck::run()
 {
+  // the timer runs on an executor thread, which is only reconfigured when it was last used for something else
+  moveit::threads::configureCurrentThread("servo_collision_check");
   if (paused_)
   {
     return;
@@ -92,55 +424,29 @@ void CollisionCheck::run()
   // Update to the latest current state
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
   current_state_->updateCollisionBodyTransforms();
-  collision_detected_ = false;
 
   // Do a timer-safe distance-based collision detection
-  collision_result_.clear();
   auto locked_scene = planning_scene_monitor::LockedPlanningSceneRO(planning_scene_monitor_);
-  locked_scene->getCollisionEnv()->checkRobotCollision(collision_request_, collision_result_, *current_state_,
-                                                       locked_scene->getAllowedCollisionMatrix());
-  scene_collision_distance_ = collision_result_.distance;
-  collision_detected_ |= collision_result_.collision;
-  collision_result_.print();
-
-  collision_result_.clear();
-  // Self-collisions and scene collisions are checked separately so different thresholds can be used
-  locked_scene->getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, collision_result_, *current_state_,
-                                                              locked_scene->getAllowedCollisionMatrix());
-  self_collision_distance_ = collision_result_.distance;
-  collision_detected_ |= collision_result_.collision;
-  collision_result_.print();
-
-  velocity_scale_ = 1;
-  // If we're definitely in collision, stop immediately
-  if (collision_detected_)
+  if (!groups_.empty())
   {
-    velocity_scale_ = 0;
+    runGroups(*locked_scene);
   }
   else
   {
-    // If we are far from a collision, velocity_scale should be 1.
-    // If we are very close to a collision, velocity_scale should be ~zero.
-    // When scene_collision_proximity_threshold is breached, start decelerating exponentially.
-    if (scene_collision_distance_ < parameters_->scene_collision_proximity_threshold)
-    {
-      // velocity_scale = e ^ k * (collision_distance - threshold)
-      // k = - ln(0.001) / collision_proximity_threshold
-      // velocity_scale should equal one when collision_distance is at collision_proximity_threshold.
-      // velocity_scale should equal 0.001 when collision_distance is at zero.
-      velocity_scale_ = std::min(velocity_scale_,
-                                 exp(scene_velocity_scale_coefficient_ *
-                                     (scene_collision_distance_ - parameters_->scene_collision_proximity_threshold)));
-    }
+    if (parameters_->use_distance_field_for_scene_collisions)
+      updateDistanceField(*locked_scene);
+    collision_detected_ =
+        checkState(*locked_scene, *current_state_, scene_collision_distance_, self_collision_distance_);
 
-    if (self_collision_distance_ < parameters_->self_collision_proximity_threshold)
-    {
-      velocity_scale_ =
-          std::min(velocity_scale_, exp(self_velocity_scale_coefficient_ *
-                                        (self_collision_distance_ - parameters_->self_collision_proximity_threshold)));
-    }
+    // Decelerate early if the states the robot is commanded to reach soon are close to a collision
+    if (!collision_detected_ && lookahead_state_)
+      checkLookahead(*locked_scene, scene_collision_distance_, self_collision_distance_);
   }
 
+  velocity_scale_ = proximityVelocityScale(collision_detected_, scene_collision_distance_, self_collision_distance_,
+                                           *parameters_, scene_velocity_scale_coefficient_,
+                                           self_velocity_scale_coefficient_);
+
   // publish message
   {
     auto msg = std::make_unique<std_msgs::msg::Float64>();
@@ -149,9 +455,63 @@ void CollisionCheck::run()
   }
 }
 
+void CollisionCheck::addGroup(const ServoParameters::SharedConstPtr& parameters,
+                              const std::function<void(double)>& velocity_scale_callback)
+{
+  if (groups_.empty())
+  {
+    if (parameters_->use_distance_field_for_scene_collisions || lookahead_state_)
+    {
+      RCLCPP_WARN(LOGGER, "Collision checking of several groups ignores 'use_distance_field_for_scene_collisions' "
+                          "and 'collision_lookahead_time'");
+    }
+    // One query per cycle reports the closest distance of every pair, from which each group takes its own minimum
+    distance_request_.type = collision_detection::DistanceRequestType::SINGLE;
+    distance_request_.enable_signed_distance = true;
+    distance_request_.distance_threshold =
+        std::max(parameters_->scene_collision_proximity_threshold, parameters_->self_collision_proximity_threshold);
+  }
+  distance_request_.distance_threshold =
+      std::max({ distance_request_.distance_threshold, parameters->scene_collision_proximity_threshold,
+                 parameters->self_collision_proximity_threshold });
+
+  groups_.push_back({ parameters, current_state_->getJointModelGroup(parameters->move_group_name),
+                      velocity_scale_callback, -log(0.001) / parameters->scene_collision_proximity_threshold,
+                      -log(0.001) / parameters->self_collision_proximity_threshold });
+}
+
+void CollisionCheck::runGroups(const planning_scene::PlanningScene& scene)
+{
+  distance_request_.acm = &scene.getAllowedCollisionMatrix();
+  distance_result_.clear();
+  scene.getCollisionEnv()->distanceRobot(distance_request_, distance_result_, *current_state_);
+  self_distance_result_.clear();
+  scene.getCollisionEnvUnpadded()->distanceSelf(distance_request_, self_distance_result_, *current_state_);
+
+  scene_collision_distance_ = groupDistance(distance_result_, *joint_model_group_, *current_state_);
+  self_collision_distance_ = groupDistance(self_distance_result_, *joint_model_group_, *current_state_);
+  collision_detected_ = scene_collision_distance_ <= 0 || self_collision_distance_ <= 0;
+
+  for (const CollisionGroup& group : groups_)
+  {
+    const double scene_distance = groupDistance(distance_result_, *group.joint_model_group, *current_state_);
+    const double self_distance = groupDistance(self_distance_result_, *group.joint_model_group, *current_state_);
+    group.velocity_scale_callback(proximityVelocityScale(scene_distance <= 0 || self_distance <= 0, scene_distance,
+                                                         self_distance, *group.parameters,
+                                                         group.scene_velocity_scale_coefficient,
+                                                         group.self_velocity_scale_coefficient));
+  }
+}
+
 void CollisionCheck::setPaused(bool paused)
 {
   paused_ = paused;
 }
 
+double CollisionCheck::runOnce()
+{
+  run();
+  return velocity_scale_;
+}
+
 }  // namespace moveit_servo
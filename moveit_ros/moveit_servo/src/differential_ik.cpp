@@ -0,0 +1,207 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include <moveit_servo/differential_ik.h>
+
+namespace moveit_servo
+{
+namespace
+{
+// Tolerance on the Lagrange multipliers of the active bounds
+constexpr double OPTIMALITY_TOLERANCE = 1e-12;
+}  // namespace
+
+DifferentialIKSolver::DifferentialIKSolver(double damping, std::size_t max_iterations)
+  : damping_(damping), max_iterations_(max_iterations)
+{
+}
+
+bool DifferentialIKSolver::solve(const Eigen::MatrixXd& jacobian, const Eigen::VectorXd& delta_x,
+                                 const Eigen::VectorXd& lower, const Eigen::VectorXd& upper,
+                                 Eigen::VectorXd& delta_theta)
+{
+  const Eigen::Index num_joints = jacobian.cols();
+
+  // Objective 0.5 * dq^T * H * dq + g^T * dq
+  hessian_.noalias() = jacobian.transpose() * jacobian;
+  hessian_.diagonal().array() += damping_;
+  gradient_.noalias() = -jacobian.transpose() * delta_x;
+
+  // Start from the previous solution and active bounds, moved into the current bounds
+  if (solution_.size() != num_joints)
+  {
+    solution_.setZero(num_joints);
+    status_.assign(num_joints, FREE);
+  }
+  for (Eigen::Index i = 0; i < num_joints; ++i)
+  {
+    if (status_[i] == AT_LOWER)
+      solution_[i] = lower[i];
+    else if (status_[i] == AT_UPPER)
+      solution_[i] = upper[i];
+    else
+      solution_[i] = std::clamp(solution_[i], lower[i], upper[i]);
+  }
+
+  const std::size_t max_iterations = max_iterations_ > 0 ? max_iterations_ : 3 * static_cast<std::size_t>(num_joints);
+  bool converged = false;
+  last_iteration_count_ = 0;
+  while (!converged && last_iteration_count_ < max_iterations)
+  {
+    ++last_iteration_count_;
+
+    // Minimize over the free joints with the others fixed at their bounds
+    free_indices_.clear();
+    for (Eigen::Index i = 0; i < num_joints; ++i)
+    {
+      if (status_[i] == FREE)
+        free_indices_.push_back(i);
+    }
+    const Eigen::Index num_free = static_cast<Eigen::Index>(free_indices_.size());
+    if (num_free > 0)
+    {
+      free_hessian_.resize(num_free, num_free);
+      free_rhs_.resize(num_free);
+      for (Eigen::Index r = 0; r < num_free; ++r)
+      {
+        const Eigen::Index i = free_indices_[r];
+        double rhs = -gradient_[i];
+        for (Eigen::Index j = 0; j < num_joints; ++j)
+        {
+          if (status_[j] != FREE)
+            rhs -= hessian_(i, j) * solution_[j];
+        }
+        free_rhs_[r] = rhs;
+        for (Eigen::Index c = 0; c < num_free; ++c)
+          free_hessian_(r, c) = hessian_(i, free_indices_[c]);
+      }
+      free_ldlt_.compute(free_hessian_);
+      free_rhs_ = free_ldlt_.solve(free_rhs_);
+
+      // Step towards the unconstrained minimum until the first bound blocks
+      double step = 1.0;
+      Eigen::Index blocking_index = -1;
+      BoundStatus blocking_status = FREE;
+      for (Eigen::Index r = 0; r < num_free; ++r)
+      {
+        const Eigen::Index i = free_indices_[r];
+        const double direction = free_rhs_[r] - solution_[i];
+        if (free_rhs_[r] < lower[i] && direction < 0 && (lower[i] - solution_[i]) / direction < step)
+        {
+          step = (lower[i] - solution_[i]) / direction;
+          blocking_index = i;
+          blocking_status = AT_LOWER;
+        }
+        else if (free_rhs_[r] > upper[i] && direction > 0 && (upper[i] - solution_[i]) / direction < step)
+        {
+          step = (upper[i] - solution_[i]) / direction;
+          blocking_index = i;
+          blocking_status = AT_UPPER;
+        }
+      }
+      for (Eigen::Index r = 0; r < num_free; ++r)
+      {
+        const Eigen::Index i = free_indices_[r];
+        solution_[i] += step * (free_rhs_[r] - solution_[i]);
+      }
+      if (blocking_index >= 0)
+      {
+        status_[blocking_index] = blocking_status;
+        solution_[blocking_index] = blocking_status == AT_LOWER ? lower[blocking_index] : upper[blocking_index];
+        continue;
+      }
+    }
+
+    // Release the active bound whose multiplier has the wrong sign the most
+    Eigen::Index release_index = -1;
+    double largest_violation = OPTIMALITY_TOLERANCE;
+    for (Eigen::Index i = 0; i < num_joints; ++i)
+    {
+      if (status_[i] == FREE)
+        continue;
+      const double derivative = hessian_.row(i).dot(solution_) + gradient_[i];
+      const double violation = status_[i] == AT_LOWER ? -derivative : derivative;
+      if (violation > largest_violation)
+      {
+        largest_violation = violation;
+        release_index = i;
+      }
+    }
+    if (release_index >= 0)
+      status_[release_index] = FREE;
+    else
+      converged = true;
+  }
+
+  delta_theta = solution_;
+  return converged;
+}
+
+void DifferentialIKSolver::reset()
+{
+  solution_.resize(0);
+  status_.clear();
+}
+
+void computeDifferentialIKBounds(const moveit::core::JointModelGroup* joint_model_group,
+                                 const Eigen::VectorXd& positions, double publish_period, double joint_limit_margin,
+                                 Eigen::VectorXd& lower, Eigen::VectorXd& upper)
+{
+  lower.setConstant(positions.size(), -std::numeric_limits<double>::infinity());
+  upper.setConstant(positions.size(), std::numeric_limits<double>::infinity());
+  Eigen::Index index = 0;
+  for (const moveit::core::JointModel* joint : joint_model_group->getActiveJointModels())
+  {
+    for (const moveit::core::VariableBounds& bounds : joint->getVariableBounds())
+    {
+      if (index >= positions.size())
+        return;
+      if (bounds.position_bounded_)
+      {
+        lower[index] = std::min(bounds.min_position_ + joint_limit_margin - positions[index], 0.0);
+        upper[index] = std::max(bounds.max_position_ - joint_limit_margin - positions[index], 0.0);
+      }
+      if (bounds.velocity_bounded_)
+      {
+        lower[index] = std::max(lower[index], std::min(bounds.min_velocity_ * publish_period, 0.0));
+        upper[index] = std::min(upper[index], std::max(bounds.max_velocity_ * publish_period, 0.0));
+      }
+      ++index;
+    }
+  }
+}
+}  // namespace moveit_servo
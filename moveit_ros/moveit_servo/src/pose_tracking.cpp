@@ -36,6 +36,7 @@
 #include <moveit_servo/servo_parameters.h>
 
 #include <chrono>
+#include <tf2_eigen/tf2_eigen.hpp>
 using namespace std::literals;
 
 namespace
@@ -68,6 +69,18 @@ void declareOrGetParam(T& output_value, const std::string& param_name, const rcl
 
   RCLCPP_INFO_STREAM(logger, "Found parameter - " << param_name << ": " << output_value);
 }
+
+// Rotate a twist by the rotation of a transform
+geometry_msgs::msg::Twist rotateTwist(const Eigen::Isometry3d& transform, const geometry_msgs::msg::Twist& twist)
+{
+  Eigen::Vector3d linear, angular;
+  tf2::fromMsg(twist.linear, linear);
+  tf2::fromMsg(twist.angular, angular);
+  geometry_msgs::msg::Twist rotated;
+  rotated.linear = tf2::toMsg2(transform.linear() * linear);
+  rotated.angular = tf2::toMsg2(transform.linear() * angular);
+  return rotated;
+}
 }  // namespace
 
 namespace moveit_servo
@@ -100,6 +113,9 @@ PoseTracking::PoseTracking(const rclcpp::Node::SharedPtr& node, const ServoParam
   target_pose_sub_ = node_->create_subscription<geometry_msgs::msg::PoseStamped>(
       "target_pose", rclcpp::SystemDefaultsQoS(),
       [this](const geometry_msgs::msg::PoseStamped::ConstSharedPtr& msg) { return targetPoseCallback(msg); });
+  target_trajectory_sub_ = node_->create_subscription<moveit_msgs::msg::CartesianTrajectory>(
+      "target_trajectory", rclcpp::SystemDefaultsQoS(),
+      [this](const moveit_msgs::msg::CartesianTrajectory::ConstSharedPtr& msg) { setTargetTrajectory(*msg); });
 
   // Publish outgoing twist commands to the Servo object
   twist_stamped_pub_ = node_->create_publisher<geometry_msgs::msg::TwistStamped>(
@@ -164,8 +180,13 @@ PoseTrackingStatusCode PoseTracking::moveToPose(const Eigen::Vector3d& positiona
       return PoseTrackingStatusCode::STOP_REQUESTED;
     }
 
-    // Compute servo command from PID controller output and send it to the Servo object, for execution
-    twist_stamped_pub_->publish(*calculateTwistCommand());
+    // Compute servo command from PID controller output and pass it to the Servo object, for execution.
+    // The command bypasses the topic, so Servo can act on it in its next cycle.
+    if (!servo_->setTwistCommand(calculateTwistCommand()))
+    {
+      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, *node_->get_clock(), LOG_THROTTLE_PERIOD,
+                                  "Servo did not take the previous commands in time");
+    }
 
     if (!loop_rate_.sleep())
     {
@@ -249,32 +270,147 @@ bool PoseTracking::satisfiesPoseTolerance(const Eigen::Vector3d& positional_tole
   if (!angular_error_)
     return false;
 
+  // A trajectory is only done once its end is reached
+  if (isTrackingTrajectory(node_->now()))
+    return false;
+
   return ((std::abs(x_error) < positional_tolerance(0)) && (std::abs(y_error) < positional_tolerance(1)) &&
           (std::abs(z_error) < positional_tolerance(2)) && (std::abs(*angular_error_) < angular_tolerance));
 }
 
 void PoseTracking::targetPoseCallback(const geometry_msgs::msg::PoseStamped::ConstSharedPtr& msg)
 {
+  // If the target pose is not defined in planning frame, transform the target pose.
+  Eigen::Isometry3d target_to_planning_frame = Eigen::Isometry3d::Identity();
+  if (msg->header.frame_id != planning_frame_ &&
+      !getPlanningFrameTransform(msg->header.frame_id, target_to_planning_frame))
+    return;
+
   std::lock_guard<std::mutex> lock(target_pose_mtx_);
+  target_trajectory_.points.clear();
+  target_twist_ = geometry_msgs::msg::Twist();
   target_pose_ = *msg;
-  // If the target pose is not defined in planning frame, transform the target pose.
-  if (target_pose_.header.frame_id != planning_frame_)
+  if (msg->header.frame_id != planning_frame_)
   {
-    try
-    {
-      geometry_msgs::msg::TransformStamped target_to_planning_frame = transform_buffer_.lookupTransform(
-          planning_frame_, target_pose_.header.frame_id, rclcpp::Time(0), rclcpp::Duration(100ms));
-      tf2::doTransform(target_pose_, target_pose_, target_to_planning_frame);
+    Eigen::Isometry3d pose;
+    tf2::fromMsg(msg->pose, pose);
+    target_pose_.pose = tf2::toMsg(target_to_planning_frame * pose);
+    target_pose_.header.frame_id = planning_frame_;
+
+    // Prevent a stamp of 0 from the transform, which will cause the haveRecentTargetPose check to fail servo motions
+    target_pose_.header.stamp = node_->now();
+  }
+}
+
+void PoseTracking::setTargetTrajectory(const moveit_msgs::msg::CartesianTrajectory& trajectory)
+{
+  if (trajectory.points.empty())
+  {
+    RCLCPP_WARN_STREAM(LOGGER, "Ignoring an empty target trajectory");
+    return;
+  }
 
-      // Prevent doTransform from copying a stamp of 0, which will cause the haveRecentTargetPose check to fail servo motions
-      target_pose_.header.stamp = node_->now();
+  // Express all points in the planning frame once, so that sampling does not need any transforms
+  Eigen::Isometry3d trajectory_to_planning_frame = Eigen::Isometry3d::Identity();
+  if (trajectory.header.frame_id != planning_frame_ &&
+      !getPlanningFrameTransform(trajectory.header.frame_id, trajectory_to_planning_frame))
+    return;
+
+  moveit_msgs::msg::CartesianTrajectory planning_frame_trajectory = trajectory;
+  planning_frame_trajectory.header.frame_id = planning_frame_;
+  if (trajectory.header.frame_id != planning_frame_)
+  {
+    for (moveit_msgs::msg::CartesianTrajectoryPoint& point : planning_frame_trajectory.points)
+    {
+      Eigen::Isometry3d pose;
+      tf2::fromMsg(point.point.pose, pose);
+      point.point.pose = tf2::toMsg(trajectory_to_planning_frame * pose);
+      point.point.velocity = rotateTwist(trajectory_to_planning_frame, point.point.velocity);
     }
-    catch (const tf2::TransformException& ex)
+  }
+
+  std::lock_guard<std::mutex> lock(target_pose_mtx_);
+  target_trajectory_ = std::move(planning_frame_trajectory);
+  // A stamp of 0 starts the trajectory immediately
+  const rclcpp::Time stamp(trajectory.header.stamp, RCL_ROS_TIME);
+  target_trajectory_start_ = stamp.nanoseconds() == 0 ? node_->now() : stamp;
+  sampleTargetTrajectory(node_->now());
+}
+
+bool PoseTracking::getPlanningFrameTransform(const std::string& frame, Eigen::Isometry3d& transform)
+{
+  {
+    auto locked_scene = planning_scene_monitor::LockedPlanningSceneRO(planning_scene_monitor_);
+    if (locked_scene->knowsFrameTransform(frame) && locked_scene->knowsFrameTransform(planning_frame_))
     {
-      RCLCPP_WARN_STREAM(LOGGER, ex.what());
-      return;
+      transform = locked_scene->getFrameTransform(planning_frame_).inverse() * locked_scene->getFrameTransform(frame);
+      return true;
     }
   }
+
+  try
+  {
+    transform = tf2::transformToEigen(transform_buffer_.lookupTransform(planning_frame_, frame, rclcpp::Time(0)));
+    return true;
+  }
+  catch (const tf2::TransformException& ex)
+  {
+    RCLCPP_WARN_STREAM(LOGGER, ex.what());
+    return false;
+  }
+}
+
+bool PoseTracking::isTrackingTrajectory(const rclcpp::Time& now) const
+{
+  return !target_trajectory_.points.empty() &&
+         (now - target_trajectory_start_) < rclcpp::Duration(target_trajectory_.points.back().time_from_start);
+}
+
+void PoseTracking::sampleTargetTrajectory(const rclcpp::Time& now)
+{
+  const auto& points = target_trajectory_.points;
+  const double time = (now - target_trajectory_start_).seconds();
+
+  // Find the first point after the current time
+  std::size_t next = 0;
+  while (next < points.size() && rclcpp::Duration(points[next].time_from_start).seconds() <= time)
+    ++next;
+
+  target_pose_.header.frame_id = planning_frame_;
+  target_pose_.header.stamp = now;
+  if (next == 0 || next == points.size())
+  {
+    // Before the first point and after the last one, its pose is held
+    target_pose_.pose = points[next == 0 ? 0 : points.size() - 1].point.pose;
+    target_twist_ = geometry_msgs::msg::Twist();
+    return;
+  }
+
+  const auto& previous_point = points[next - 1];
+  const auto& next_point = points[next];
+  const double previous_time = rclcpp::Duration(previous_point.time_from_start).seconds();
+  const double duration = rclcpp::Duration(next_point.time_from_start).seconds() - previous_time;
+  const double fraction = duration > 0 ? (time - previous_time) / duration : 1.0;
+
+  Eigen::Isometry3d previous_pose, next_pose;
+  tf2::fromMsg(previous_point.point.pose, previous_pose);
+  tf2::fromMsg(next_point.point.pose, next_pose);
+  const Eigen::Vector3d position =
+      previous_pose.translation() + fraction * (next_pose.translation() - previous_pose.translation());
+  const Eigen::Quaterniond orientation =
+      Eigen::Quaterniond(previous_pose.linear()).slerp(fraction, Eigen::Quaterniond(next_pose.linear()));
+  target_pose_.pose.position = tf2::toMsg(position);
+  target_pose_.pose.orientation = tf2::toMsg(orientation);
+
+  const auto interpolate = [fraction](double a, double b) { return a + fraction * (b - a); };
+  const geometry_msgs::msg::Twist& a = previous_point.point.velocity;
+  const geometry_msgs::msg::Twist& b = next_point.point.velocity;
+  target_twist_.linear.x = interpolate(a.linear.x, b.linear.x);
+  target_twist_.linear.y = interpolate(a.linear.y, b.linear.y);
+  target_twist_.linear.z = interpolate(a.linear.z, b.linear.z);
+  target_twist_.angular.x = interpolate(a.angular.x, b.angular.x);
+  target_twist_.angular.y = interpolate(a.angular.y, b.angular.y);
+  target_twist_.angular.z = interpolate(a.angular.z, b.angular.z);
 }
 
 geometry_msgs::msg::TwistStamped::ConstSharedPtr PoseTracking::calculateTwistCommand()
@@ -286,18 +422,30 @@ geometry_msgs::msg::TwistStamped::ConstSharedPtr PoseTracking::calculateTwistCom
   geometry_msgs::msg::Twist& twist = msg->twist;
   Eigen::Quaterniond q_desired;
 
+  // Feed-forward velocity of a target trajectory, zero for a single target pose
+  geometry_msgs::msg::Twist feed_forward;
+
   // Scope mutex locking only to operations which require access to target pose.
   {
     std::lock_guard<std::mutex> lock(target_pose_mtx_);
+    if (!target_trajectory_.points.empty())
+      sampleTargetTrajectory(node_->now());
+    feed_forward = target_twist_;
     msg->header.frame_id = target_pose_.header.frame_id;
 
     // Position
-    twist.linear.x = cartesian_position_pids_[0].computeCommand(
-        target_pose_.pose.position.x - command_frame_transform_.translation()(0), loop_rate_.period().count());
-    twist.linear.y = cartesian_position_pids_[1].computeCommand(
-        target_pose_.pose.position.y - command_frame_transform_.translation()(1), loop_rate_.period().count());
-    twist.linear.z = cartesian_position_pids_[2].computeCommand(
-        target_pose_.pose.position.z - command_frame_transform_.translation()(2), loop_rate_.period().count());
+    twist.linear.x = feed_forward.linear.x +
+                     cartesian_position_pids_[0].computeCommand(
+                         target_pose_.pose.position.x - command_frame_transform_.translation()(0),
+                         loop_rate_.period().count());
+    twist.linear.y = feed_forward.linear.y +
+                     cartesian_position_pids_[1].computeCommand(
+                         target_pose_.pose.position.y - command_frame_transform_.translation()(1),
+                         loop_rate_.period().count());
+    twist.linear.z = feed_forward.linear.z +
+                     cartesian_position_pids_[2].computeCommand(
+                         target_pose_.pose.position.z - command_frame_transform_.translation()(2),
+                         loop_rate_.period().count());
 
     // Orientation algorithm:
     // - Find the orientation error as a quaternion: q_error = q_desired * q_current ^ -1
@@ -317,9 +465,9 @@ geometry_msgs::msg::TwistStamped::ConstSharedPtr PoseTracking::calculateTwistCom
 
   double ang_vel_magnitude =
       cartesian_orientation_pids_[0].computeCommand(*angular_error_, loop_rate_.period().count());
-  twist.angular.x = ang_vel_magnitude * axis_angle.axis()[0];
-  twist.angular.y = ang_vel_magnitude * axis_angle.axis()[1];
-  twist.angular.z = ang_vel_magnitude * axis_angle.axis()[2];
+  twist.angular.x = feed_forward.angular.x + ang_vel_magnitude * axis_angle.axis()[0];
+  twist.angular.y = feed_forward.angular.y + ang_vel_magnitude * axis_angle.axis()[1];
+  twist.angular.z = feed_forward.angular.z + ang_vel_magnitude * axis_angle.axis()[2];
 
   msg->header.stamp = node_->now();
 
@@ -400,6 +548,8 @@ void PoseTracking::resetTargetPose()
   std::lock_guard<std::mutex> lock(target_pose_mtx_);
   target_pose_ = geometry_msgs::msg::PoseStamped();
   target_pose_.header.stamp = rclcpp::Time(RCL_ROS_TIME);
+  target_twist_ = geometry_msgs::msg::Twist();
+  target_trajectory_.points.clear();
 }
 
 bool PoseTracking::getCommandFrameTransform(geometry_msgs::msg::TransformStamped& transform)
@@ -39,6 +39,7 @@
 
 #include <moveit_servo/make_shared_from_pool.h>
 #include <moveit_servo/servo.h>
+#include <moveit/utils/thread_config.h>
 
 namespace moveit_servo
 {
@@ -55,6 +56,12 @@ Servo::Servo(const rclcpp::Node::SharedPtr& node, const ServoParameters::SharedC
   , servo_calcs_{ node, parameters, planning_scene_monitor_ }
   , collision_checker_{ node, parameters, planning_scene_monitor_ }
 {
+  moveit::threads::loadThreadConfigs(node);
+  if (parameters_->check_collisions && parameters_->collision_lookahead_time > 0)
+  {
+    servo_calcs_.setCommandedVelocityCallback(
+        [this](const Eigen::ArrayXd& velocities) { collision_checker_.setCommandedJointVelocities(velocities); });
+  }
 }
 
 void Servo::start()
@@ -72,13 +79,15 @@ void Servo::start()
   servo_calcs_.start();
 
   // Check collisions in this timer
-  if (parameters_->check_collisions)
+  if (parameters_->check_collisions && !collision_check_shared_)
     collision_checker_.start();
 }
 
 Servo::~Servo()
 {
   setPaused(true);
+  // The collision checker is destroyed before the calculation thread stops
+  servo_calcs_.setCommandedVelocityCallback({});
 }
 
 void Servo::setPaused(bool paused)
@@ -107,6 +116,44 @@ bool Servo::getEEFrameTransform(geometry_msgs::msg::TransformStamped& transform)
   return servo_calcs_.getEEFrameTransform(transform);
 }
 
+bool Servo::setTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg)
+{
+  return servo_calcs_.setTwistCommand(msg);
+}
+
+bool Servo::setJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg)
+{
+  return servo_calcs_.setJointCommand(msg);
+}
+
+void Servo::setCommandOutputCallback(
+    const std::function<void(const trajectory_msgs::msg::JointTrajectory&)>& callback)
+{
+  servo_calcs_.setCommandOutputCallback(callback);
+}
+
+void Servo::shareCollisionCheck(Servo& other)
+{
+  // Without a collision checking timer of this instance, the other one keeps its own
+  if (!parameters_->check_collisions || !other.parameters_->check_collisions)
+    return;
+
+  other.collision_check_shared_ = true;
+  other.servo_calcs_.useInProcessCollisionVelocityScale();
+  collision_checker_.addGroup(other.parameters_,
+                              [&other](double scale) { other.servo_calcs_.setCollisionVelocityScale(scale); });
+}
+
+ServoTimingStatistics Servo::getTimingStatistics() const
+{
+  return servo_calcs_.getTimingStatistics();
+}
+
+void Servo::resetTimingStatistics()
+{
+  servo_calcs_.resetTimingStatistics();
+}
+
 const ServoParameters::SharedConstPtr& Servo::getParameters() const
 {
   return parameters_;
@@ -37,6 +37,7 @@
  *      Author    : Brian O'Neil, Andy Zelenak, Blake Anderson
  */
 
+#include <algorithm>
 #include <cassert>
 #include <thread>
 #include <chrono>
@@ -49,6 +50,7 @@
 #include <moveit_servo/enforce_limits.hpp>
 #include <moveit_servo/servo_calcs.h>
 #include <moveit_servo/utilities.h>
+#include <moveit/utils/thread_config.h>
 
 using namespace std::chrono_literals;  // for s, ms, etc.
 
@@ -58,6 +60,7 @@ namespace
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_servo.servo_calcs");
 constexpr auto ROS_LOG_THROTTLE_PERIOD = std::chrono::milliseconds(3000).count();
+constexpr double TIMING_DIAGNOSTICS_PERIOD = 1.0;  // seconds
 static constexpr double STOPPED_VELOCITY_EPS = 1e-4;  // rad/s
 }  // namespace
 
@@ -145,6 +148,12 @@ ServoCalcs::ServoCalcs(const rclcpp::Node::SharedPtr& node,
   // Publish status
   status_pub_ = node_->create_publisher<std_msgs::msg::Int8>(parameters_->status_topic, rclcpp::SystemDefaultsQoS());
 
+  // Publish the loop timing
+  timing_diagnostics_pub_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+      "/diagnostics", rclcpp::SystemDefaultsQoS());
+  timing_diagnostics_timer_ = node_->create_wall_timer(std::chrono::duration<double>(TIMING_DIAGNOSTICS_PERIOD),
+                                                       [this] { publishTimingDiagnostics(); });
+
   internal_joint_state_.name = joint_model_group_->getActiveJointModelNames();
   num_joints_ = internal_joint_state_.name.size();
   internal_joint_state_.position.resize(num_joints_);
@@ -184,7 +193,13 @@ ServoCalcs::ServoCalcs(const rclcpp::Node::SharedPtr& node,
 
   // Get the IK solver for the group
   ik_solver_ = joint_model_group_->getSolverInstance();
-  if (!ik_solver_)
+  if (parameters_->use_differential_ik)
+  {
+    differential_ik_ = DifferentialIKSolver(parameters_->differential_ik_damping);
+    RCLCPP_INFO(LOGGER, "Using bounded differential IK for servo calculations of group '%s'.",
+                joint_model_group_->getName().c_str());
+  }
+  else if (!ik_solver_)
   {
     use_inv_jacobian_ = true;
     RCLCPP_WARN(
@@ -212,6 +227,15 @@ void ServoCalcs::start()
   // Stop the thread if we are currently running
   stop();
 
+  initializeIterations();
+
+  stop_requested_ = false;
+  thread_ = std::thread([this] { mainCalcLoop(); });
+  new_input_cmd_ = false;
+}
+
+void ServoCalcs::initializeIterations()
+{
   // Set up the "last" published message, in case we need to send it first
   auto initial_joint_trajectory = std::make_unique<trajectory_msgs::msg::JointTrajectory>();
   initial_joint_trajectory->header.stamp = node_->now();
@@ -237,6 +261,11 @@ void ServoCalcs::start()
   initial_joint_trajectory->points.push_back(point);
   last_sent_command_ = std::move(initial_joint_trajectory);
 
+  // Preallocate the buffers which every iteration reuses, so the loop does not allocate memory while servoing
+  joint_trajectory_ = *last_sent_command_;
+  jacobian_.resize(6, num_joints_);
+  ik_solution_.resize(num_joints_);
+
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
   tf_moveit_to_ee_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
                            current_state_->getGlobalLinkTransform(parameters_->ee_frame_name);
@@ -247,10 +276,6 @@ void ServoCalcs::start()
     ik_base_to_tip_frame_ = current_state_->getGlobalLinkTransform(ik_solver_->getBaseFrame()).inverse() *
                             current_state_->getGlobalLinkTransform(ik_solver_->getTipFrame());
   }
-
-  stop_requested_ = false;
-  thread_ = std::thread([this] { mainCalcLoop(); });
-  new_input_cmd_ = false;
 }
 
 void ServoCalcs::stop()
@@ -276,6 +301,7 @@ void ServoCalcs::stop()
 
 void ServoCalcs::mainCalcLoop()
 {
+  moveit::threads::configureCurrentThread("servo_calcs");
   rclcpp::WallRate rate(1.0 / parameters_->publish_period);
 
   while (rclcpp::ok() && !stop_requested_)
@@ -286,24 +312,36 @@ void ServoCalcs::mainCalcLoop()
     // low latency mode -- begin calculations as soon as a new command is received.
     if (parameters_->low_latency_mode)
     {
-      input_cv_.wait(main_loop_lock, [this] { return (new_input_cmd_ || stop_requested_); });
+      // Commands passed through the queues do not lock the mutex, so their notification may be missed.
+      // Check the queues at least once per period.
+      const auto has_input = [this] {
+        return new_input_cmd_ || stop_requested_ || !twist_command_queue_.empty() || !joint_command_queue_.empty();
+      };
+      if (!input_cv_.wait_for(main_loop_lock, std::chrono::duration<double>(parameters_->publish_period), has_input))
+      {
+        continue;
+      }
+      if (stop_requested_)
+      {
+        break;
+      }
     }
 
     // reset new_input_cmd_ flag
     new_input_cmd_ = false;
+    consumeCommandQueues();
 
     // run servo calcs
-    const auto start_time = node_->now();
+    timing_.startCycle();
     calculateSingleIteration();
-    const auto run_duration = node_->now() - start_time;
+    const double run_duration = timing_.endCycle(parameters_->publish_period);
 
     // Log warning when the run duration was longer than the period
-    if (run_duration.seconds() > parameters_->publish_period)
+    if (run_duration > parameters_->publish_period)
     {
       rclcpp::Clock& clock = *node_->get_clock();
       RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD,
-                                  "run_duration: " << run_duration.seconds() << " (" << parameters_->publish_period
-                                                   << ")");
+                                  "run_duration: " << run_duration << " (" << parameters_->publish_period << ")");
     }
 
     // normal mode, unlock input mutex and wait for the period of the loop
@@ -318,51 +356,51 @@ void ServoCalcs::mainCalcLoop()
 void ServoCalcs::calculateSingleIteration()
 {
   // Publish status each loop iteration
-  auto status_msg = std::make_unique<std_msgs::msg::Int8>();
-  status_msg->data = static_cast<int8_t>(status_);
-  status_pub_->publish(std::move(status_msg));
+  std_msgs::msg::Int8 status_msg;
+  status_msg.data = static_cast<int8_t>(status_);
+  status_pub_->publish(status_msg);
 
   // After we publish, status, reset it back to no warnings
   status_ = StatusCode::NO_WARNING;
 
-  // Always update the joints and end-effector transform for 2 reasons:
-  // 1) in case the getCommandFrameTransform() method is being used
-  // 2) so the low-pass filters are up to date and don't cause a jump
-  updateJoints();
-
-  // Update from latest state
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
-
-  if (latest_twist_stamped_)
-    twist_stamped_cmd_ = *latest_twist_stamped_;
-  if (latest_joint_cmd_)
-    joint_servo_cmd_ = *latest_joint_cmd_;
-
-  // Check for stale cmds
-  twist_command_is_stale_ = ((node_->now() - latest_twist_command_stamp_) >=
-                             rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
-  joint_command_is_stale_ = ((node_->now() - latest_joint_command_stamp_) >=
-                             rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
-
-  have_nonzero_twist_stamped_ = latest_twist_cmd_is_nonzero_;
-  have_nonzero_joint_command_ = latest_joint_cmd_is_nonzero_;
-
-  // Get the transform from MoveIt planning frame to servoing command frame
-  // Calculate this transform to ensure it is available via C++ API
-  // We solve (planning_frame -> base -> robot_link_command_frame)
-  // by computing (base->planning_frame)^-1 * (base->robot_link_command_frame)
-  tf_moveit_to_robot_cmd_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
-                                  current_state_->getGlobalLinkTransform(robot_link_command_frame_);
-
-  // Calculate the transform from MoveIt planning frame to End Effector frame
-  // Calculate this transform to ensure it is available via C++ API
-  tf_moveit_to_ee_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
-                           current_state_->getGlobalLinkTransform(parameters_->ee_frame_name);
-
-  if (!use_inv_jacobian_)
   {
-    ik_base_to_tip_frame_ = current_state_->getGlobalLinkTransform(ik_solver_->getBaseFrame()).inverse() *
-                            current_state_->getGlobalLinkTransform(ik_solver_->getTipFrame());
+    const auto stage = timing_.measure(ServoStage::STATE_UPDATE);
+    // Always update the joints and end-effector transform for 2 reasons:
+    // 1) in case the getCommandFrameTransform() method is being used
+    // 2) so the low-pass filters are up to date and don't cause a jump
+    updateJoints();
+
+    if (latest_twist_stamped_)
+      twist_stamped_cmd_ = *latest_twist_stamped_;
+    if (latest_joint_cmd_)
+      joint_servo_cmd_ = *latest_joint_cmd_;
+
+    // Check for stale cmds
+    twist_command_is_stale_ = ((node_->now() - latest_twist_command_stamp_) >=
+                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
+    joint_command_is_stale_ = ((node_->now() - latest_joint_command_stamp_) >=
+                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
+
+    have_nonzero_twist_stamped_ = latest_twist_cmd_is_nonzero_;
+    have_nonzero_joint_command_ = latest_joint_cmd_is_nonzero_;
+
+    // Get the transform from MoveIt planning frame to servoing command frame
+    // Calculate this transform to ensure it is available via C++ API
+    // We solve (planning_frame -> base -> robot_link_command_frame)
+    // by computing (base->planning_frame)^-1 * (base->robot_link_command_frame)
+    tf_moveit_to_robot_cmd_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
+                                    current_state_->getGlobalLinkTransform(robot_link_command_frame_);
+
+    // Calculate the transform from MoveIt planning frame to End Effector frame
+    // Calculate this transform to ensure it is available via C++ API
+    tf_moveit_to_ee_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
+                             current_state_->getGlobalLinkTransform(parameters_->ee_frame_name);
+
+    if (!use_inv_jacobian_)
+    {
+      ik_base_to_tip_frame_ = current_state_->getGlobalLinkTransform(ik_solver_->getBaseFrame()).inverse() *
+                              current_state_->getGlobalLinkTransform(ik_solver_->getTipFrame());
+    }
   }
 
   have_nonzero_command_ = have_nonzero_twist_stamped_ || have_nonzero_joint_command_;
@@ -386,8 +424,8 @@ void ServoCalcs::calculateSingleIteration()
 
   // If not waiting for initial command, and not paused.
   // Do servoing calculations only if the robot should move, for efficiency
-  // Create new outgoing joint trajectory command message
-  auto joint_trajectory = std::make_unique<trajectory_msgs::msg::JointTrajectory>();
+  // Reuse the outgoing joint trajectory command message of the previous iteration
+  trajectory_msgs::msg::JointTrajectory* joint_trajectory = &joint_trajectory_;
 
   // Prioritize cartesian servoing above joint servoing
   // Only run commands if not stale and nonzero
@@ -464,6 +502,8 @@ void ServoCalcs::calculateSingleIteration()
 
   if (ok_to_publish_ && !paused_)
   {
+    const auto stage = timing_.measure(ServoStage::PUBLISHING);
+
     // Clear out position commands if user did not request them (can cause interpolation issues)
     if (!parameters_->publish_joint_positions)
     {
@@ -487,17 +527,23 @@ void ServoCalcs::calculateSingleIteration()
       // See http://wiki.ros.org/joint_trajectory_controller#Trajectory_replacement
       joint_trajectory->header.stamp = rclcpp::Time(0);
       *last_sent_command_ = *joint_trajectory;
-      trajectory_outgoing_cmd_pub_->publish(std::move(joint_trajectory));
+      if (command_output_callback_)
+        command_output_callback_(*joint_trajectory);
+      else
+        trajectory_outgoing_cmd_pub_->publish(*joint_trajectory);
     }
     else if (parameters_->command_out_type == "std_msgs/Float64MultiArray")
     {
-      auto joints = std::make_unique<std_msgs::msg::Float64MultiArray>();
+      std_msgs::msg::Float64MultiArray& joints = multiarray_outgoing_cmd_;
       if (parameters_->publish_joint_positions && !joint_trajectory->points.empty())
-        joints->data = joint_trajectory->points[0].positions;
+        joints.data = joint_trajectory->points[0].positions;
       else if (parameters_->publish_joint_velocities && !joint_trajectory->points.empty())
-        joints->data = joint_trajectory->points[0].velocities;
+        joints.data = joint_trajectory->points[0].velocities;
       *last_sent_command_ = *joint_trajectory;
-      multiarray_outgoing_cmd_pub_->publish(std::move(joints));
+      if (command_output_callback_)
+        command_output_callback_(*joint_trajectory);
+      else
+        multiarray_outgoing_cmd_pub_->publish(joints);
     }
   }
 
@@ -566,20 +612,61 @@ bool ServoCalcs::cartesianServoCalcs(geometry_msgs::msg::TwistStamped& cmd,
     cmd.twist.angular.z = angular_vector(2);
   }
 
-  Eigen::VectorXd delta_x = scaleCartesianCommand(cmd);
+  const Eigen::Matrix<double, 6, 1> full_delta_x = scaleCartesianCommand(cmd);
 
-  Eigen::MatrixXd jacobian = current_state_->getJacobian(joint_model_group_);
+  timing_.startStage(ServoStage::JACOBIAN);
+  // The buffers below are only resized when the drift dimensions change
+  const moveit::core::LinkModel* tip_link = joint_model_group_->getLinkModels().back();
+  if (!current_state_->getJacobian(joint_model_group_, tip_link, Eigen::Vector3d::Zero(), jacobian_))
+    throw moveit::Exception("Unable to compute Jacobian");
 
-  removeDriftDimensions(jacobian, delta_x);
+  removeDriftDimensions(jacobian_, full_delta_x, controlled_jacobian_, delta_x_);
+  const Eigen::VectorXd& delta_x = delta_x_;
 
-  Eigen::JacobiSVD<Eigen::MatrixXd> svd =
-      Eigen::JacobiSVD<Eigen::MatrixXd>(jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
-  Eigen::MatrixXd matrix_s = svd.singularValues().asDiagonal();
-  Eigen::MatrixXd pseudo_inverse = svd.matrixV() * matrix_s.inverse() * svd.matrixU().transpose();
+  // A full SVD is computed every singularity_full_svd_period cycles and whenever the drift dimensions change.
+  // In between, the condition number is estimated from the previous singular vectors.
+  const Eigen::Index num_dimensions = controlled_jacobian_.rows();
+  const bool full_svd = ++cycles_since_full_svd_ >= parameters_->singularity_full_svd_period ||
+                        min_singular_vector_.size() != num_dimensions;
+  if (full_svd)
+  {
+    cycles_since_full_svd_ = 0;
+    svd_.compute(controlled_jacobian_, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    pseudo_inverse_.noalias() =
+        svd_.matrixV() * svd_.singularValues().cwiseInverse().asDiagonal() * svd_.matrixU().transpose();
+    max_singular_vector_ = svd_.matrixU().col(0);
+    min_singular_vector_ = svd_.matrixU().col(num_dimensions - 1);
+  }
+  else
+  {
+    // J^+ = J^T * (J * J^T)^-1 for a Jacobian of full row rank
+    jjt_.noalias() = controlled_jacobian_ * controlled_jacobian_.transpose();
+    jjt_ldlt_.compute(jjt_);
+    jacobian_condition_ = estimateJacobianCondition(jjt_, jjt_ldlt_, max_singular_vector_, min_singular_vector_);
+    pseudo_inverse_.noalias() =
+        controlled_jacobian_.transpose() * jjt_ldlt_.solve(Eigen::MatrixXd::Identity(num_dimensions, num_dimensions));
+  }
+  const Eigen::MatrixXd& pseudo_inverse = pseudo_inverse_;
+  timing_.endStage(ServoStage::JACOBIAN);
 
   // Convert from cartesian commands to joint commands
-  // Use an IK solver plugin if we have one, otherwise use inverse Jacobian.
-  if (!use_inv_jacobian_)
+  // Use the bounded differential IK if configured, an IK solver plugin if we have one, otherwise inverse Jacobian.
+  timing_.startStage(ServoStage::INVERSE_KINEMATICS);
+  if (parameters_->use_differential_ik)
+  {
+    // The joint limits are constraints of the solver, so the deltas need no scaling to stay within them
+    current_state_->copyJointGroupPositions(joint_model_group_, differential_ik_positions_);
+    computeDifferentialIKBounds(joint_model_group_, differential_ik_positions_, parameters_->publish_period,
+                                parameters_->joint_limit_margin, differential_ik_lower_, differential_ik_upper_);
+    if (!differential_ik_.solve(controlled_jacobian_, delta_x, differential_ik_lower_, differential_ik_upper_,
+                                differential_ik_solution_))
+    {
+      RCLCPP_DEBUG(LOGGER, "Differential IK did not converge within %zu iterations, using the last feasible deltas",
+                   differential_ik_.getLastIterationCount());
+    }
+    delta_theta_ = differential_ik_solution_.array();
+  }
+  else if (!use_inv_jacobian_)
   {
     // get a transformation matrix with the desired position change &
     // get a transformation matrix with desired orientation change
@@ -617,7 +704,7 @@ bool ServoCalcs::cartesianServoCalcs(geometry_msgs::msg::TwistStamped& cmd,
     geometry_msgs::msg::Pose next_pose = tf2::toMsg(tf);
 
     // setup for IK call
-    std::vector<double> solution(num_joints_);
+    std::vector<double>& solution = ik_solution_;
     moveit_msgs::msg::MoveItErrorCodes err;
     kinematics::KinematicsQueryOptions opts;
     opts.return_approximate_solution = true;
@@ -633,20 +720,39 @@ bool ServoCalcs::cartesianServoCalcs(geometry_msgs::msg::TwistStamped& cmd,
     else
     {
       RCLCPP_WARN(LOGGER, "Could not find IK solution for requested motion, got error code %d", err.val);
+      timing_.endStage(ServoStage::INVERSE_KINEMATICS);
       return false;
     }
   }
   else
   {
     // no supported IK plugin, use inverse Jacobian
-    delta_theta_ = pseudo_inverse * delta_x;
+    delta_theta_.matrix().noalias() = pseudo_inverse * delta_x;
   }
 
-  delta_theta_ *= velocityScalingFactorForSingularity(joint_model_group_, delta_x, svd, pseudo_inverse,
-                                                      parameters_->hard_stop_singularity_threshold,
-                                                      parameters_->lower_singularity_threshold,
-                                                      parameters_->leaving_singularity_threshold_multiplier,
-                                                      *node_->get_clock(), current_state_, status_);
+  if (full_svd)
+  {
+    delta_theta_ *= velocityScalingFactorForSingularity(joint_model_group_, delta_x, svd_, pseudo_inverse,
+                                                        parameters_->hard_stop_singularity_threshold,
+                                                        parameters_->lower_singularity_threshold,
+                                                        parameters_->leaving_singularity_threshold_multiplier,
+                                                        *node_->get_clock(), current_state_, status_);
+  }
+  else
+  {
+    // The look-ahead of the scaling estimates the condition of a nearby state from the same singular vectors
+    const auto condition_number = [this](const Eigen::MatrixXd& jacobian) {
+      const Eigen::MatrixXd jjt = jacobian * jacobian.transpose();
+      Eigen::VectorXd max_vector = max_singular_vector_;
+      Eigen::VectorXd min_vector = min_singular_vector_;
+      return estimateJacobianCondition(jjt, jjt.ldlt(), max_vector, min_vector);
+    };
+    delta_theta_ *= velocityScalingFactorForSingularity(
+        joint_model_group_, delta_x, min_singular_vector_, jacobian_condition_, condition_number, pseudo_inverse,
+        parameters_->hard_stop_singularity_threshold, parameters_->lower_singularity_threshold,
+        parameters_->leaving_singularity_threshold_multiplier, *node_->get_clock(), current_state_, status_);
+  }
+  timing_.endStage(ServoStage::INVERSE_KINEMATICS);
 
   return internalServoUpdate(delta_theta_, joint_trajectory, ServoType::CARTESIAN_SPACE);
 }
@@ -679,6 +785,12 @@ bool ServoCalcs::internalServoUpdate(Eigen::ArrayXd& delta_theta,
   // Set internal joint state from original
   internal_joint_state_ = original_joint_state_;
 
+  if (commanded_velocity_callback_)
+  {
+    commanded_velocity_ = delta_theta / parameters_->publish_period;
+    commanded_velocity_callback_(commanded_velocity_);
+  }
+
   // Apply collision scaling
   double collision_scale = collision_velocity_scale_;
   if (collision_scale > 0 && collision_scale < 1)
@@ -696,12 +808,16 @@ bool ServoCalcs::internalServoUpdate(Eigen::ArrayXd& delta_theta,
   delta_theta *= collision_scale;
 
   // Loop thru joints and update them, calculate velocities, and filter
-  if (!applyJointUpdate(delta_theta, internal_joint_state_))
-    return false;
+  {
+    const auto stage = timing_.measure(ServoStage::FILTERING);
+    if (!applyJointUpdate(delta_theta, internal_joint_state_))
+      return false;
+  }
 
   // Mark the lowpass filters as updated for this cycle
   updated_filters_ = true;
 
+  timing_.startStage(ServoStage::LIMIT_ENFORCEMENT);
   // Enforce SRDF velocity limits
   enforceVelocityLimits(joint_model_group_, parameters_->publish_period, internal_joint_state_,
                         parameters_->override_velocity_scaling_factor);
@@ -721,6 +837,7 @@ bool ServoCalcs::internalServoUpdate(Eigen::ArrayXd& delta_theta,
       suddenHalt(internal_joint_state_, joint_model_group_->getActiveJointModels());
     }
   }
+  timing_.endStage(ServoStage::LIMIT_ENFORCEMENT);
 
   // compose outgoing message
   composeJointTrajMessage(internal_joint_state_, joint_trajectory);
@@ -786,6 +903,7 @@ void ServoCalcs::resetLowPassFilters(const sensor_msgs::msg::JointState& joint_s
 {
   smoother_->reset(joint_state.position);
   updated_filters_ = true;
+  differential_ik_.reset();
 }
 
 void ServoCalcs::composeJointTrajMessage(const sensor_msgs::msg::JointState& joint_state,
@@ -797,21 +915,28 @@ void ServoCalcs::composeJointTrajMessage(const sensor_msgs::msg::JointState& joi
   joint_trajectory.header.frame_id = parameters_->planning_frame;
   joint_trajectory.joint_names = joint_state.name;
 
-  trajectory_msgs::msg::JointTrajectoryPoint point;
+  // Overwrite the point of the reused message, so its arrays keep their memory
+  joint_trajectory.points.resize(1);
+  trajectory_msgs::msg::JointTrajectoryPoint& point = joint_trajectory.points[0];
   point.time_from_start = rclcpp::Duration::from_seconds(parameters_->publish_period);
   if (parameters_->publish_joint_positions)
     point.positions = joint_state.position;
+  else
+    point.positions.clear();
   if (parameters_->publish_joint_velocities)
     point.velocities = joint_state.velocity;
+  else
+    point.velocities.clear();
   if (parameters_->publish_joint_accelerations)
   {
     // I do not know of a robot that takes acceleration commands.
     // However, some controllers check that this data is non-empty.
     // Send all zeros, for now.
-    std::vector<double> acceleration(num_joints_);
-    point.accelerations = acceleration;
+    point.accelerations.assign(num_joints_, 0.0);
   }
-  joint_trajectory.points.push_back(point);
+  else
+    point.accelerations.clear();
+  point.effort.clear();
 }
 
 std::vector<const moveit::core::JointModel*>
@@ -869,9 +994,11 @@ ServoCalcs::enforcePositionLimits(sensor_msgs::msg::JointState& joint_state) con
 
 void ServoCalcs::filteredHalt(trajectory_msgs::msg::JointTrajectory& joint_trajectory)
 {
-  // Prepare the joint trajectory message to stop the robot
-  joint_trajectory.points.clear();
-  joint_trajectory.points.emplace_back();
+  // Prepare the joint trajectory message to stop the robot, reusing the memory of its first point
+  joint_trajectory.points.resize(1);
+  joint_trajectory.points[0].velocities.clear();
+  joint_trajectory.points[0].accelerations.clear();
+  joint_trajectory.points[0].effort.clear();
 
   // Deceleration algorithm:
   // Set positions to original_joint_state_
@@ -885,7 +1012,7 @@ void ServoCalcs::filteredHalt(trajectory_msgs::msg::JointTrajectory& joint_traje
   done_stopping_ = true;
   if (parameters_->publish_joint_velocities)
   {
-    joint_trajectory.points[0].velocities = std::vector<double>(num_joints_, 0);
+    joint_trajectory.points[0].velocities.assign(num_joints_, 0);
     for (std::size_t i = 0; i < num_joints_; ++i)
     {
       joint_trajectory.points[0].velocities.at(i) =
@@ -906,7 +1033,7 @@ void ServoCalcs::filteredHalt(trajectory_msgs::msg::JointTrajectory& joint_traje
 
   if (parameters_->publish_joint_accelerations)
   {
-    joint_trajectory.points[0].accelerations = std::vector<double>(num_joints_, 0);
+    joint_trajectory.points[0].accelerations.assign(num_joints_, 0);
     for (std::size_t i = 0; i < num_joints_; ++i)
     {
       joint_trajectory.points[0].accelerations.at(i) =
@@ -936,8 +1063,8 @@ void ServoCalcs::suddenHalt(sensor_msgs::msg::JointState& joint_state,
 
 void ServoCalcs::updateJoints()
 {
-  // Get the latest joint group positions
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  // Get the latest joint group positions, copied into the existing state to avoid allocating a new one
+  planning_scene_monitor_->getStateMonitor()->setToCurrentState(*current_state_);
   current_state_->copyJointGroupPositions(joint_model_group_, internal_joint_state_.position);
   current_state_->copyJointGroupVelocities(joint_model_group_, internal_joint_state_.velocity);
 
@@ -988,9 +1115,9 @@ bool ServoCalcs::checkValidCommand(const geometry_msgs::msg::TwistStamped& cmd)
 }
 
 // Scale the incoming jog command. Returns a vector of position deltas
-Eigen::VectorXd ServoCalcs::scaleCartesianCommand(const geometry_msgs::msg::TwistStamped& command)
+Eigen::Matrix<double, 6, 1> ServoCalcs::scaleCartesianCommand(const geometry_msgs::msg::TwistStamped& command)
 {
-  Eigen::VectorXd result(6);
+  Eigen::Matrix<double, 6, 1> result;
   result.setZero();  // Or the else case below leads to misery
 
   // Apply user-defined scaling if inputs are unitless [-1:1]
@@ -1057,33 +1184,29 @@ Eigen::VectorXd ServoCalcs::scaleJointCommand(const control_msgs::msg::JointJog&
   return result;
 }
 
-void ServoCalcs::removeDimension(Eigen::MatrixXd& jacobian, Eigen::VectorXd& delta_x, unsigned int row_to_remove) const
-{
-  unsigned int num_rows = jacobian.rows() - 1;
-  unsigned int num_cols = jacobian.cols();
-
-  if (row_to_remove < num_rows)
-  {
-    jacobian.block(row_to_remove, 0, num_rows - row_to_remove, num_cols) =
-        jacobian.block(row_to_remove + 1, 0, num_rows - row_to_remove, num_cols);
-    delta_x.segment(row_to_remove, num_rows - row_to_remove) =
-        delta_x.segment(row_to_remove + 1, num_rows - row_to_remove);
-  }
-  jacobian.conservativeResize(num_rows, num_cols);
-  delta_x.conservativeResize(num_rows);
-}
-
-void ServoCalcs::removeDriftDimensions(Eigen::MatrixXd& matrix, Eigen::VectorXd& delta_x)
+void ServoCalcs::removeDriftDimensions(const Eigen::MatrixXd& matrix, const Eigen::Matrix<double, 6, 1>& delta_x,
+                                       Eigen::MatrixXd& reduced_matrix, Eigen::VectorXd& reduced_delta_x) const
 {
   // May allow some dimensions to drift, based on drift_dimensions
   // i.e. take advantage of task redundancy.
-  // Remove the Jacobian rows corresponding to True in the vector drift_dimensions
-  // Work backwards through the 6-vector so indices don't get out of order
-  for (auto dimension = matrix.rows() - 1; dimension >= 0; --dimension)
+  // Copy the Jacobian rows corresponding to False in the vector drift_dimensions.
+  // At least the first dimension is kept, even if all of them may drift.
+  Eigen::Index num_rows = std::count(drift_dimensions_.cbegin(), drift_dimensions_.cend(), false);
+  const bool keep_first = num_rows == 0;
+  if (keep_first)
+    num_rows = 1;
+
+  // Resizing to the current size does not reallocate
+  reduced_matrix.resize(num_rows, matrix.cols());
+  reduced_delta_x.resize(num_rows);
+  Eigen::Index row = 0;
+  for (Eigen::Index dimension = 0; dimension < matrix.rows(); ++dimension)
   {
-    if (drift_dimensions_[dimension] && matrix.rows() > 1)
+    if (!drift_dimensions_[dimension] || (keep_first && dimension == 0))
     {
-      removeDimension(matrix, delta_x, dimension);
+      reduced_matrix.row(row) = matrix.row(dimension);
+      reduced_delta_x[row] = delta_x[dimension];
+      ++row;
     }
   }
 }
@@ -1154,11 +1277,7 @@ bool ServoCalcs::getEEFrameTransform(geometry_msgs::msg::TransformStamped& trans
 void ServoCalcs::twistStampedCB(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg)
 {
   const std::lock_guard<std::mutex> lock(main_loop_mutex_);
-  latest_twist_stamped_ = msg;
-  latest_twist_cmd_is_nonzero_ = isNonZero(*latest_twist_stamped_);
-
-  if (msg->header.stamp != rclcpp::Time(0.))
-    latest_twist_command_stamp_ = msg->header.stamp;
+  updateTwistCommand(msg);
 
   // notify that we have a new input
   new_input_cmd_ = true;
@@ -1168,15 +1287,132 @@ void ServoCalcs::twistStampedCB(const geometry_msgs::msg::TwistStamped::ConstSha
 void ServoCalcs::jointCmdCB(const control_msgs::msg::JointJog::ConstSharedPtr& msg)
 {
   const std::lock_guard<std::mutex> lock(main_loop_mutex_);
+  updateJointCommand(msg);
+
+  // notify that we have a new input
+  new_input_cmd_ = true;
+  input_cv_.notify_all();
+}
+
+void ServoCalcs::updateTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg)
+{
+  latest_twist_stamped_ = msg;
+  latest_twist_cmd_is_nonzero_ = isNonZero(*latest_twist_stamped_);
+
+  if (msg->header.stamp != rclcpp::Time(0.))
+    latest_twist_command_stamp_ = msg->header.stamp;
+}
+
+void ServoCalcs::updateJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg)
+{
   latest_joint_cmd_ = msg;
   latest_joint_cmd_is_nonzero_ = isNonZero(*latest_joint_cmd_);
 
   if (msg->header.stamp != rclcpp::Time(0.))
     latest_joint_command_stamp_ = msg->header.stamp;
+}
 
-  // notify that we have a new input
-  new_input_cmd_ = true;
+bool ServoCalcs::setTwistCommand(const geometry_msgs::msg::TwistStamped::ConstSharedPtr& msg)
+{
+  if (!twist_command_queue_.push(msg))
+    return false;
   input_cv_.notify_all();
+  return true;
+}
+
+bool ServoCalcs::setJointCommand(const control_msgs::msg::JointJog::ConstSharedPtr& msg)
+{
+  if (!joint_command_queue_.push(msg))
+    return false;
+  input_cv_.notify_all();
+  return true;
+}
+
+void ServoCalcs::consumeCommandQueues()
+{
+  // Apply the commands in order, so the latest one and its stamp take effect
+  geometry_msgs::msg::TwistStamped::ConstSharedPtr twist_msg;
+  while (twist_command_queue_.pop(twist_msg))
+    updateTwistCommand(twist_msg);
+  control_msgs::msg::JointJog::ConstSharedPtr joint_msg;
+  while (joint_command_queue_.pop(joint_msg))
+    updateJointCommand(joint_msg);
+}
+
+void ServoCalcs::setCommandOutputCallback(
+    const std::function<void(const trajectory_msgs::msg::JointTrajectory&)>& callback)
+{
+  const std::lock_guard<std::mutex> lock(main_loop_mutex_);
+  command_output_callback_ = callback;
+}
+
+void ServoCalcs::setCommandedVelocityCallback(const std::function<void(const Eigen::ArrayXd&)>& callback)
+{
+  const std::lock_guard<std::mutex> lock(main_loop_mutex_);
+  commanded_velocity_callback_ = callback;
+}
+
+void ServoCalcs::useInProcessCollisionVelocityScale()
+{
+  collision_velocity_scale_sub_.reset();
+}
+
+void ServoCalcs::setCollisionVelocityScale(double scale)
+{
+  collision_velocity_scale_ = scale;
+}
+
+ServoTimingStatistics ServoCalcs::getTimingStatistics() const
+{
+  return timing_.getStatistics();
+}
+
+void ServoCalcs::resetTimingStatistics()
+{
+  timing_.resetStatistics();
+}
+
+void ServoCalcs::publishTimingDiagnostics()
+{
+  const ServoTimingStatistics statistics = timing_.getStatistics();
+
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.name = "moveit_servo: " + parameters_->move_group_name + " loop timing";
+  status.hardware_id = parameters_->move_group_name;
+  // Warn if cycles missed the publish period since the last publication
+  if (statistics.deadline_misses > published_deadline_misses_)
+  {
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+    status.message = "Cycles exceeded the publish period";
+  }
+  else
+  {
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.message = "OK";
+  }
+  published_deadline_misses_ = statistics.deadline_misses;
+
+  const auto add_value = [&status](const std::string& key, const auto& value) {
+    diagnostic_msgs::msg::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = std::to_string(value);
+    status.values.push_back(key_value);
+  };
+  add_value("cycles", statistics.cycles);
+  add_value("deadline_misses", statistics.deadline_misses);
+  for (std::size_t i = 0; i < NUM_SERVO_STAGES; ++i)
+  {
+    const DurationHistogram& histogram = statistics.stages[i];
+    const std::string name = toString(static_cast<ServoStage>(i));
+    add_value(name + ".mean [s]", histogram.mean());
+    add_value(name + ".p99 [s]", histogram.percentile(0.99));
+    add_value(name + ".max [s]", histogram.max_seconds);
+  }
+
+  diagnostic_msgs::msg::DiagnosticArray msg;
+  msg.header.stamp = node_->now();
+  msg.status.push_back(std::move(status));
+  timing_diagnostics_pub_->publish(msg);
 }
 
 void ServoCalcs::collisionVelocityScaleCB(const std_msgs::msg::Float64::ConstSharedPtr& msg)
@@ -106,12 +106,31 @@ ServoNode::ServoNode(const rclcpp::NodeOptions& options)
 
   // Create Servo
   servo_ = std::make_unique<moveit_servo::Servo>(node_, servo_parameters, planning_scene_monitor_);
+
+  // Further groups, e.g. a second arm, are served by the same node. Each namespace holds a complete set of servo
+  // parameters with its own topics. All instances share the planning scene monitor, and the collisions of all
+  // groups are checked in the collision checking timer of the first one.
+  const auto additional_namespaces =
+      node_->declare_parameter<std::vector<std::string>>("additional_servo_namespaces", std::vector<std::string>{});
+  for (const std::string& ns : additional_namespaces)
+  {
+    auto parameters = moveit_servo::ServoParameters::makeServoParameters(node_, ns);
+    if (parameters == nullptr)
+    {
+      RCLCPP_ERROR_STREAM(LOGGER, "Failed to load the servo parameters in namespace '" << ns << "'");
+      throw std::runtime_error("Failed to load the servo parameters");
+    }
+    additional_servos_.push_back(std::make_unique<moveit_servo::Servo>(node_, parameters, planning_scene_monitor_));
+    servo_->shareCollisionCheck(*additional_servos_.back());
+  }
 }
 
 void ServoNode::startCB(const std::shared_ptr<std_srvs::srv::Trigger::Request>& /* unused */,
                         const std::shared_ptr<std_srvs::srv::Trigger::Response>& response)
 {
   servo_->start();
+  for (const auto& servo : additional_servos_)
+    servo->start();
   response->success = true;
 }
 
@@ -119,6 +138,8 @@ void ServoNode::stopCB(const std::shared_ptr<std_srvs::srv::Trigger::Request>& /
                        const std::shared_ptr<std_srvs::srv::Trigger::Response>& response)
 {
   servo_->setPaused(true);
+  for (const auto& servo : additional_servos_)
+    servo->setPaused(true);
   response->success = true;
 }
 
@@ -126,6 +147,8 @@ void ServoNode::pauseCB(const std::shared_ptr<std_srvs::srv::Trigger::Request>&
                         const std::shared_ptr<std_srvs::srv::Trigger::Response>& response)
 {
   servo_->setPaused(true);
+  for (const auto& servo : additional_servos_)
+    servo->setPaused(true);
   response->success = true;
 }
 
@@ -133,6 +156,8 @@ void ServoNode::unpauseCB(const std::shared_ptr<std_srvs::srv::Trigger::Request>
                           const std::shared_ptr<std_srvs::srv::Trigger::Response>& response)
 {
   servo_->setPaused(false);
+  for (const auto& servo : additional_servos_)
+    servo->setPaused(false);
   response->success = true;
 }
 
@@ -242,6 +242,24 @@ void ServoParameters::declare(const std::string& ns,
           .type(PARAMETER_DOUBLE)
           .description("When 'lower_singularity_threshold' is triggered, but we are moving away from singularity, move "
                        "this many times faster than if we were moving further into singularity"));
+  node_parameters->declare_parameter(
+      ns + ".singularity_full_svd_period", ParameterValue{ parameters.singularity_full_svd_period },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_INTEGER)
+          .description("Compute a full SVD of the Jacobian every this many cycles and estimate its condition number "
+                       "from the previous singular vectors in between. 1 computes the full SVD every cycle"));
+  node_parameters->declare_parameter(
+      ns + ".use_differential_ik", ParameterValue{ parameters.use_differential_ik },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_BOOL)
+          .description("Compute the joint deltas with a bounded differential IK solver that respects the joint "
+                       "position and velocity limits, instead of the IK plugin or the Jacobian pseudo-inverse"));
+  node_parameters->declare_parameter(
+      ns + ".differential_ik_damping", ParameterValue{ parameters.differential_ik_damping },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_DOUBLE)
+          .description("Damping of the joint deltas of the differential IK solver. Larger values are more robust "
+                       "near singularities but track the command less accurately"));
 
   // Collision checking
   node_parameters->declare_parameter(ns + ".check_collisions", ParameterValue{ parameters.check_collisions },
@@ -262,6 +280,29 @@ void ServoParameters::declare(const std::string& ns,
                                      ParameterDescriptorBuilder{}
                                          .type(PARAMETER_DOUBLE)
                                          .description("Start decelerating when a scene collision is this far [m]"));
+  node_parameters->declare_parameter(
+      ns + ".use_distance_field_for_scene_collisions",
+      ParameterValue{ parameters.use_distance_field_for_scene_collisions },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_BOOL)
+          .description("Look up scene proximity in a distance field of the world instead of querying FCL. The robot "
+                       "is approximated by spheres and the allowed collision matrix is not applied to world objects"));
+  node_parameters->declare_parameter(
+      ns + ".collision_lookahead_time", ParameterValue{ parameters.collision_lookahead_time },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_DOUBLE)
+          .description("Also check the states reached by the commanded joint velocities within this time [s]. "
+                       "0 only checks the current state"));
+  node_parameters->declare_parameter(
+      ns + ".collision_lookahead_steps", ParameterValue{ parameters.collision_lookahead_steps },
+      ParameterDescriptorBuilder{}
+          .type(PARAMETER_INTEGER)
+          .description("Number of future states checked within 'collision_lookahead_time'"));
+  node_parameters->declare_parameter(ns + ".distance_field_resolution",
+                                     ParameterValue{ parameters.distance_field_resolution },
+                                     ParameterDescriptorBuilder{}
+                                         .type(PARAMETER_DOUBLE)
+                                         .description("Cell size of the world distance field [m]"));
 }
 
 ServoParameters ServoParameters::get(const std::string& ns,
@@ -340,6 +381,11 @@ ServoParameters ServoParameters::get(const std::string& ns,
                         "https://github.com/ros-planning/moveit2/pull/620 for more information.");
   }
 
+  parameters.singularity_full_svd_period =
+      node_parameters->get_parameter(ns + ".singularity_full_svd_period").as_int();
+  parameters.use_differential_ik = node_parameters->get_parameter(ns + ".use_differential_ik").as_bool();
+  parameters.differential_ik_damping = node_parameters->get_parameter(ns + ".differential_ik_damping").as_double();
+
   // Collision checking
   parameters.check_collisions = node_parameters->get_parameter(ns + ".check_collisions").as_bool();
   parameters.collision_check_rate = node_parameters->get_parameter(ns + ".collision_check_rate").as_double();
@@ -347,6 +393,11 @@ ServoParameters ServoParameters::get(const std::string& ns,
       node_parameters->get_parameter(ns + ".self_collision_proximity_threshold").as_double();
   parameters.scene_collision_proximity_threshold =
       node_parameters->get_parameter(ns + ".scene_collision_proximity_threshold").as_double();
+  parameters.use_distance_field_for_scene_collisions =
+      node_parameters->get_parameter(ns + ".use_distance_field_for_scene_collisions").as_bool();
+  parameters.collision_lookahead_time = node_parameters->get_parameter(ns + ".collision_lookahead_time").as_double();
+  parameters.collision_lookahead_steps = node_parameters->get_parameter(ns + ".collision_lookahead_steps").as_int();
+  parameters.distance_field_resolution = node_parameters->get_parameter(ns + ".distance_field_resolution").as_double();
 
   return parameters;
 }
@@ -371,6 +422,17 @@ std::optional<ServoParameters> ServoParameters::validate(ServoParameters paramet
                 "Parameter 'leaving_singularity_threshold_multiplier' should be greater than zero. Check yaml file.");
     return std::nullopt;
   }
+  if (parameters.singularity_full_svd_period < 1)
+  {
+    RCLCPP_WARN(LOGGER, "Parameter 'singularity_full_svd_period' should be at least one. Check yaml file.");
+    return std::nullopt;
+  }
+  if (parameters.differential_ik_damping < 0.)
+  {
+    RCLCPP_WARN(LOGGER, "Parameter 'differential_ik_damping' should be greater than or equal to zero. "
+                        "Check yaml file.");
+    return std::nullopt;
+  }
   if (parameters.hard_stop_singularity_threshold <= parameters.lower_singularity_threshold)
   {
     RCLCPP_WARN(LOGGER, "Parameter 'hard_stop_singularity_threshold' "
@@ -444,6 +506,19 @@ std::optional<ServoParameters> ServoParameters::validate(ServoParameters paramet
     RCLCPP_WARN(LOGGER, "Parameter 'self_collision_proximity_threshold' should probably be less "
                         "than or equal to 'scene_collision_proximity_threshold'. Check yaml file.");
   }
+  if (parameters.use_distance_field_for_scene_collisions && parameters.distance_field_resolution <= 0.)
+  {
+    RCLCPP_WARN(LOGGER, "Parameter 'distance_field_resolution' should be "
+                        "greater than zero. Check yaml file.");
+    return std::nullopt;
+  }
+  if (parameters.collision_lookahead_time < 0. ||
+      (parameters.collision_lookahead_time > 0. && parameters.collision_lookahead_steps < 1))
+  {
+    RCLCPP_WARN(LOGGER, "Parameter 'collision_lookahead_time' should not be negative and "
+                        "'collision_lookahead_steps' should be at least one. Check yaml file.");
+    return std::nullopt;
+  }
   if (parameters.collision_check_rate <= 0)
   {
     RCLCPP_WARN(LOGGER, "Parameter 'collision_check_rate' should be "
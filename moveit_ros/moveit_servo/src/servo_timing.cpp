@@ -0,0 +1,141 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <moveit_servo/servo_timing.h>
+
+namespace moveit_servo
+{
+namespace
+{
+constexpr double SMALLEST_BUCKET_BOUND = 1e-6;  // seconds
+}  // namespace
+
+const char* toString(ServoStage stage)
+{
+  switch (stage)
+  {
+    case ServoStage::STATE_UPDATE:
+      return "state_update";
+    case ServoStage::JACOBIAN:
+      return "jacobian";
+    case ServoStage::INVERSE_KINEMATICS:
+      return "inverse_kinematics";
+    case ServoStage::FILTERING:
+      return "filtering";
+    case ServoStage::LIMIT_ENFORCEMENT:
+      return "limit_enforcement";
+    case ServoStage::PUBLISHING:
+      return "publishing";
+    case ServoStage::CYCLE:
+      return "cycle";
+    case ServoStage::COUNT:
+      break;
+  }
+  return "unknown";
+}
+
+double DurationHistogram::bucketUpperBound(std::size_t bucket)
+{
+  return std::ldexp(SMALLEST_BUCKET_BOUND, static_cast<int>(bucket));
+}
+
+void DurationHistogram::add(double seconds)
+{
+  std::size_t bucket = 0;
+  while (bucket + 1 < NUM_BUCKETS && seconds > bucketUpperBound(bucket))
+    ++bucket;
+  ++counts[bucket];
+  ++count;
+  total_seconds += seconds;
+  max_seconds = std::max(max_seconds, seconds);
+  last_seconds = seconds;
+}
+
+double DurationHistogram::percentile(double fraction) const
+{
+  if (count == 0)
+    return 0.0;
+
+  const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * count));
+  std::uint64_t cumulative = 0;
+  for (std::size_t bucket = 0; bucket + 1 < NUM_BUCKETS; ++bucket)
+  {
+    cumulative += counts[bucket];
+    if (cumulative >= rank)
+      return std::min(bucketUpperBound(bucket), max_seconds);
+  }
+  return max_seconds;
+}
+
+void ServoTiming::startCycle()
+{
+  cycle_seconds_.fill(0.0);
+  stage_ran_.fill(false);
+  startStage(ServoStage::CYCLE);
+}
+
+double ServoTiming::endCycle(double period)
+{
+  endStage(ServoStage::CYCLE);
+  const double cycle_seconds = cycle_seconds_[static_cast<std::size_t>(ServoStage::CYCLE)];
+
+  const std::lock_guard<std::mutex> lock(statistics_mutex_);
+  for (std::size_t i = 0; i < NUM_SERVO_STAGES; ++i)
+  {
+    // Stages that did not run in this cycle, e.g. the Jacobian for joint commands, are not counted
+    if (stage_ran_[i])
+      statistics_.stages[i].add(cycle_seconds_[i]);
+  }
+  ++statistics_.cycles;
+  if (cycle_seconds > period)
+    ++statistics_.deadline_misses;
+  return cycle_seconds;
+}
+
+ServoTimingStatistics ServoTiming::getStatistics() const
+{
+  const std::lock_guard<std::mutex> lock(statistics_mutex_);
+  return statistics_;
+}
+
+void ServoTiming::resetStatistics()
+{
+  const std::lock_guard<std::mutex> lock(statistics_mutex_);
+  statistics_ = ServoTimingStatistics();
+}
+}  // namespace moveit_servo
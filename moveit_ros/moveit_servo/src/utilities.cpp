@@ -32,6 +32,8 @@
    Project   : moveit_servo
 */
 
+#include <limits>
+
 #include <moveit_servo/utilities.h>
 
 namespace moveit_servo
@@ -94,16 +96,35 @@ double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup*
                                            const double leaving_singularity_threshold_multiplier, rclcpp::Clock& clock,
                                            moveit::core::RobotStatePtr& current_state, StatusCode& status)
 {
-  double velocity_scale = 1;
-  std::size_t num_dimensions = commanded_twist.size();
-
   // Find the direction away from nearest singularity.
   // The last column of U from the SVD of the Jacobian points directly toward or away from the singularity.
   // The sign can flip at any time, so we have to do some extra checking.
   // Look ahead to see if the Jacobian's condition will decrease.
-  Eigen::VectorXd vector_toward_singularity = svd.matrixU().col(num_dimensions - 1);
+  const auto condition_number = [](const Eigen::MatrixXd& jacobian) {
+    Eigen::JacobiSVD<Eigen::MatrixXd> new_svd(jacobian);
+    return new_svd.singularValues()(0) / new_svd.singularValues()(new_svd.singularValues().size() - 1);
+  };
+  return velocityScalingFactorForSingularity(
+      joint_model_group, commanded_twist, svd.matrixU().col(commanded_twist.size() - 1),
+      svd.singularValues()(0) / svd.singularValues()(svd.singularValues().size() - 1), condition_number,
+      pseudo_inverse, hard_stop_singularity_threshold, lower_singularity_threshold,
+      leaving_singularity_threshold_multiplier, clock, current_state, status);
+}
 
-  double ini_condition = svd.singularValues()(0) / svd.singularValues()(svd.singularValues().size() - 1);
+double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup* joint_model_group,
+                                           const Eigen::VectorXd& commanded_twist,
+                                           const Eigen::VectorXd& vector_toward_singularity_in,
+                                           const double ini_condition,
+                                           const std::function<double(const Eigen::MatrixXd&)>& condition_number,
+                                           const Eigen::MatrixXd& pseudo_inverse,
+                                           const double hard_stop_singularity_threshold,
+                                           const double lower_singularity_threshold,
+                                           const double leaving_singularity_threshold_multiplier, rclcpp::Clock& clock,
+                                           moveit::core::RobotStatePtr& current_state, StatusCode& status)
+{
+  double velocity_scale = 1;
+  std::size_t num_dimensions = commanded_twist.size();
+  Eigen::VectorXd vector_toward_singularity = vector_toward_singularity_in;
 
   // This singular vector tends to flip direction unpredictably. See R. Bro,
   // "Resolving the Sign Ambiguity in the Singular Value Decomposition".
@@ -120,8 +141,7 @@ double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup*
   current_state->setJointGroupPositions(joint_model_group, new_theta);
   Eigen::MatrixXd new_jacobian = current_state->getJacobian(joint_model_group);
 
-  Eigen::JacobiSVD<Eigen::MatrixXd> new_svd(new_jacobian);
-  double new_condition = new_svd.singularValues()(0) / new_svd.singularValues()(new_svd.singularValues().size() - 1);
+  double new_condition = condition_number(new_jacobian);
   // If new_condition < ini_condition, the singular vector does point towards a
   // singularity. Otherwise, flip its direction.
   if (ini_condition >= new_condition)
@@ -156,4 +176,18 @@ double velocityScalingFactorForSingularity(const moveit::core::JointModelGroup*
   return velocity_scale;
 }
 
+double estimateJacobianCondition(const Eigen::MatrixXd& jjt, const Eigen::LDLT<Eigen::MatrixXd>& jjt_ldlt,
+                                 Eigen::VectorXd& max_vector, Eigen::VectorXd& min_vector)
+{
+  max_vector = (jjt * max_vector).normalized();
+  min_vector = jjt_ldlt.solve(min_vector).normalized();
+
+  // The Rayleigh quotients of J * J^T are the squared singular values of J
+  const double max_eigenvalue = max_vector.dot(jjt * max_vector);
+  const double min_eigenvalue = min_vector.dot(jjt * min_vector);
+  if (!(min_eigenvalue > 0))
+    return std::numeric_limits<double>::infinity();
+  return std::sqrt(max_eigenvalue / min_eigenvalue);
+}
+
 }  // namespace moveit_servo
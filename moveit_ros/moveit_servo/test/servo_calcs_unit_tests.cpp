@@ -37,12 +37,15 @@
 */
 
 #include <gtest/gtest.h>
+#include <thread>
 
 #include <moveit/utils/robot_model_test_utils.h>
 
+#include <moveit_servo/differential_ik.h>
 #include <moveit_servo/enforce_limits.hpp>
 #include <moveit_servo/servo_calcs.h>
 #include <moveit_servo/servo_parameters.h>
+#include <moveit_servo/spsc_queue.h>
 #include <moveit_servo/status_codes.h>
 #include <moveit_servo/utilities.h>
 
@@ -168,6 +171,171 @@ TEST_F(ServoCalcsUnitTests, SingularityScaling)
   EXPECT_EQ(scaling_factor, 0);
 }
 
+TEST_F(ServoCalcsUnitTests, EstimateJacobianCondition)
+{
+  // Start with the singular vectors of a nearby state, as in the previous servo cycle
+  std::shared_ptr<moveit::core::RobotState> robot_state = std::make_shared<moveit::core::RobotState>(robot_model_);
+  robot_state->setToDefaultValues();
+  robot_state->setVariablePosition("panda_joint4", -1.5);
+  Eigen::JacobiSVD<Eigen::MatrixXd> previous_svd(robot_state->getJacobian(joint_model_group_),
+                                                 Eigen::ComputeThinU | Eigen::ComputeThinV);
+  Eigen::VectorXd max_vector = previous_svd.matrixU().col(0);
+  Eigen::VectorXd min_vector = previous_svd.matrixU().col(5);
+
+  robot_state->setVariablePosition("panda_joint2", 0.01);
+  robot_state->setVariablePosition("panda_joint4", -1.49);
+  const Eigen::MatrixXd jacobian = robot_state->getJacobian(joint_model_group_);
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian);
+  const double condition = svd.singularValues()(0) / svd.singularValues()(5);
+
+  const Eigen::MatrixXd jjt = jacobian * jacobian.transpose();
+  double estimate = 0;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const double next_estimate = moveit_servo::estimateJacobianCondition(jjt, jjt.ldlt(), max_vector, min_vector);
+    EXPECT_LE(next_estimate, condition * (1 + 1e-9));
+    estimate = next_estimate;
+  }
+  EXPECT_NEAR(estimate, condition, 0.05 * condition);
+}
+
+TEST_F(ServoCalcsUnitTests, DifferentialIKRespectsBounds)
+{
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.setVariablePosition("panda_joint4", -1.5);
+  const Eigen::MatrixXd jacobian = robot_state.getJacobian(joint_model_group_);
+  Eigen::VectorXd positions;
+  robot_state.copyJointGroupPositions(joint_model_group_, positions);
+
+  moveit_servo::DifferentialIKSolver solver(1e-10);
+  Eigen::VectorXd delta_x(6);
+  delta_x << 0.001, 0.0, 0.001, 0.0, 0.0, 0.0;
+  Eigen::VectorXd lower, upper;
+  moveit_servo::computeDifferentialIKBounds(joint_model_group_, positions, PUBLISH_PERIOD, 0.1, lower, upper);
+
+  // Small commands are solved exactly like the pseudo-inverse
+  Eigen::VectorXd delta_theta;
+  EXPECT_TRUE(solver.solve(jacobian, delta_x, lower, upper, delta_theta));
+  EXPECT_TRUE((jacobian * delta_theta).isApprox(delta_x, 1e-9));
+  const Eigen::VectorXd pseudo_inverse_delta = jacobian.completeOrthogonalDecomposition().solve(delta_x);
+  EXPECT_TRUE(delta_theta.isApprox(pseudo_inverse_delta, 1e-6));
+
+  // The warm start converges immediately for the same command
+  EXPECT_TRUE(solver.solve(jacobian, delta_x, lower, upper, delta_theta));
+  EXPECT_EQ(solver.getLastIterationCount(), 1u);
+
+  // Large commands are limited by the velocity bounds
+  delta_x *= 100.0;
+  EXPECT_TRUE(solver.solve(jacobian, delta_x, lower, upper, delta_theta));
+  EXPECT_TRUE((delta_theta.array() >= lower.array()).all());
+  EXPECT_TRUE((delta_theta.array() <= upper.array()).all());
+  EXPECT_TRUE(((delta_theta - lower).array().abs() < 1e-12 || (delta_theta - upper).array().abs() < 1e-12).any());
+}
+
+TEST_F(ServoCalcsUnitTests, DifferentialIKBounds)
+{
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  const auto& joint4_bounds = robot_model_->getVariableBounds("panda_joint4");
+  robot_state.setVariablePosition("panda_joint4", joint4_bounds.min_position_ + 0.05);
+  Eigen::VectorXd positions;
+  robot_state.copyJointGroupPositions(joint_model_group_, positions);
+
+  Eigen::VectorXd lower, upper;
+  moveit_servo::computeDifferentialIKBounds(joint_model_group_, positions, PUBLISH_PERIOD, 0.1, lower, upper);
+  const int joint4_index = joint_model_group_->getVariableGroupIndex("panda_joint4");
+
+  // Within the margin of the lower limit, the joint may only move away from it
+  EXPECT_DOUBLE_EQ(lower[joint4_index], 0.0);
+  EXPECT_DOUBLE_EQ(upper[joint4_index], joint4_bounds.max_velocity_ * PUBLISH_PERIOD);
+}
+
+TEST(ServoTiming, DurationHistogram)
+{
+  moveit_servo::DurationHistogram histogram;
+  EXPECT_EQ(histogram.percentile(0.5), 0.0);
+
+  for (std::size_t i = 0; i < 99; ++i)
+    histogram.add(1.5e-6);  // second bucket, up to 2 microseconds
+  histogram.add(0.1);
+  EXPECT_EQ(histogram.count, 100u);
+  EXPECT_EQ(histogram.counts[1], 99u);
+  EXPECT_DOUBLE_EQ(histogram.max_seconds, 0.1);
+  EXPECT_DOUBLE_EQ(histogram.percentile(0.5), 2e-6);
+  EXPECT_DOUBLE_EQ(histogram.percentile(1.0), 0.1);
+  EXPECT_NEAR(histogram.mean(), (99 * 1.5e-6 + 0.1) / 100, 1e-12);
+}
+
+TEST(ServoTiming, DeadlineMisses)
+{
+  moveit_servo::ServoTiming timing;
+  timing.startCycle();
+  {
+    const auto stage = timing.measure(moveit_servo::ServoStage::FILTERING);
+  }
+  EXPECT_LT(timing.endCycle(1.0), 1.0);
+
+  timing.startCycle();
+  const double duration = timing.endCycle(0.0);
+  EXPECT_GE(duration, 0.0);
+
+  const moveit_servo::ServoTimingStatistics statistics = timing.getStatistics();
+  EXPECT_EQ(statistics.cycles, 2u);
+  EXPECT_EQ(statistics.stage(moveit_servo::ServoStage::CYCLE).count, 2u);
+  EXPECT_EQ(statistics.stage(moveit_servo::ServoStage::FILTERING).count, 1u);
+  EXPECT_EQ(statistics.stage(moveit_servo::ServoStage::JACOBIAN).count, 0u);
+  // A zero period is missed unless the clock did not advance at all
+  EXPECT_EQ(statistics.deadline_misses, duration > 0.0 ? 1u : 0u);
+
+  timing.resetStatistics();
+  EXPECT_EQ(timing.getStatistics().cycles, 0u);
+}
+
+TEST(SPSCQueue, PushPop)
+{
+  moveit_servo::SPSCQueue<int, 2> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  EXPECT_FALSE(queue.push(3));  // full
+
+  int value = 0;
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 1);
+  EXPECT_TRUE(queue.push(3));
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 3);
+  EXPECT_FALSE(queue.pop(value));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueue, Threads)
+{
+  moveit_servo::SPSCQueue<int, 4> queue;
+  constexpr int count = 10000;
+  std::thread producer([&queue] {
+    for (int i = 0; i < count;)
+    {
+      if (queue.push(i))
+        ++i;
+    }
+  });
+  int expected = 0;
+  int value;
+  while (expected < count)
+  {
+    if (queue.pop(value))
+    {
+      ASSERT_EQ(value, expected);
+      ++expected;
+    }
+  }
+  producer.join();
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
@@ -38,12 +38,15 @@
 
 #include <moveit/collision_detection/occupancy_map.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
+#include <moveit/occupancy_map_monitor/occupancy_map_window.h>
 #include <moveit_msgs/srv/load_map.hpp>
 #include <moveit_msgs/srv/save_map.hpp>
 
 #include <rclcpp/rclcpp.hpp>
 #include <tf2_ros/buffer.h>
 
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -53,6 +56,17 @@
 
 namespace occupancy_map_monitor
 {
+/**
+ * @brief      The changes of the octree between two versions of the map.
+ */
+struct OccupancyMapChanges
+{
+  std::uint64_t version = 0; /*!< The version of the map the changes lead to */
+  bool is_keyframe = false;  /*!< True if the cells are the complete map, which replaces the previous one */
+  std::vector<std::pair<octomap::OcTreeKey, float>> updated_cells; /*!< Cells and their new log-odds */
+  std::vector<octomap::OcTreeKey> removed_cells;                   /*!< Cells that no longer exist */
+};
+
 class OccupancyMapMonitor
 {
 public:
@@ -64,6 +78,10 @@ public:
     double map_resolution;
     std::string map_frame;
     std::vector<std::pair<std::string, std::string>> sensor_plugins;
+    double window_radius = 0.0;         /*!< Radius of the rolling window of the map, disabled if not positive */
+    double window_tile_size = 1.0;      /*!< Edge length of the tiles evicted from the window */
+    std::string window_center_frame;    /*!< Frame the window is centered on, e.g. the base of the robot */
+    std::string window_tile_directory;  /*!< Directory evicted tiles are written to, dropped if empty */
   };
 
   /**
@@ -246,9 +264,42 @@ public:
    */
   void setUpdateCallback(const std::function<void()>& update_callback)
   {
-    tree_->setUpdateCallback(update_callback);
+    std::lock_guard<std::mutex> _(changes_lock_);
+    update_callback_ = update_callback;
   }
 
+  /**
+   * @brief      Gets the version of the map, which increases with every update of the octree.
+   *
+   * @return     The version.
+   */
+  std::uint64_t getMapVersion() const;
+
+  /**
+   * @brief      Gets the changes of the octree since a version of the map.
+   *
+   * If the version is older than the recorded history of changes, or the map was replaced since then, the changes are
+   * a keyframe holding all leaves of the map.
+   *
+   * @param[in]  version  The version of the map the changes start from, e.g. of the previous call
+   * @param[out] changes  The changes up to the current version
+   */
+  void getMapChangesSince(std::uint64_t version, OccupancyMapChanges& changes) const;
+
+  /**
+   * @brief      Mark the map as replaced, e.g. after the octree was cleared outside of the updaters.
+   *
+   * The changes since any earlier version are then a keyframe.
+   */
+  void resetMapChanges();
+
+  /**
+   * @brief      Sets the number of map versions whose changes are kept. Defaults to 100.
+   *
+   * @param[in]  size  The number of versions
+   */
+  void setChangeHistorySize(std::size_t size);
+
   /**
    * @brief      Sets the transform cache callback.
    *
@@ -313,6 +364,20 @@ private:
   bool getShapeTransformCache(std::size_t index, const std::string& target_frame, const rclcpp::Time& target_time,
                               ShapeTransformCache& cache) const;
 
+  /**
+   * @brief      Records the cells changed by an update of the octree as a new version, then calls the update callback.
+   */
+  void treeUpdateCallback();
+
+  /**
+   * @brief      Looks up the center of the rolling window in the map frame.
+   *
+   * @param[out] center  The center
+   *
+   * @return     True on success, False otherwise.
+   */
+  bool getWindowCenter(octomap::point3d& center);
+
   std::unique_ptr<MiddlewareHandle> middleware_handle_; /*!< The abstract interface to ros */
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;          /*!< TF buffer */
   Parameters parameters_;
@@ -329,5 +394,14 @@ private:
   std::size_t mesh_handle_count_; /*!< Count of mesh handles */
 
   bool active_; /*!< True when actively monitoring updaters */
+
+  mutable std::mutex changes_lock_;  /*!< Protects the fields below */
+  std::function<void()> update_callback_;  /*!< Called after each update of the octree */
+  std::uint64_t map_version_;              /*!< Current version of the map */
+  std::uint64_t keyframe_version_;         /*!< Version at which the map was last replaced */
+  std::deque<std::pair<std::uint64_t, octomap::KeySet>> change_history_; /*!< Changed cells of each version */
+  std::size_t change_history_size_;                                      /*!< Maximum length of change_history_ */
+
+  std::unique_ptr<OccupancyMapWindow> window_;  /*!< Rolling window of the map, nullptr if disabled */
 };
 }  // namespace occupancy_map_monitor
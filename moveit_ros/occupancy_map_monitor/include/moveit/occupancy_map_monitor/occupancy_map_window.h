@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/collision_detection/occupancy_map.h>
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace occupancy_map_monitor
+{
+/**
+ * @brief      Bounds an octree to a window around a moving center, e.g. the base of a mobile robot.
+ *
+ * The map is divided into square tiles in the xy plane. Tiles that leave the radius around the center are removed
+ * from the octree and are either written to a directory or dropped. Written tiles are read back into the octree once
+ * they are inside of the radius again.
+ */
+class OccupancyMapWindow
+{
+public:
+  /**
+   * @brief      Constructor
+   *
+   * @param[in]  radius          The radius of the window around the center
+   * @param[in]  tile_size       The edge length of the tiles
+   * @param[in]  tile_directory  The directory evicted tiles are written to, or empty to drop them
+   */
+  OccupancyMapWindow(double radius, double tile_size, const std::string& tile_directory = "");
+
+  /**
+   * @brief      Moves the window to a new center. The octree must be locked for writing.
+   *
+   * The tiles are only checked once the center moved more than a tenth of the tile size since the last check.
+   *
+   * @param[in]  tree    The octree
+   * @param[in]  center  The center of the window in the frame of the octree
+   *
+   * @return     True if cells were removed from or added to the octree
+   */
+  bool update(collision_detection::OccMapTree& tree, const octomap::point3d& center);
+
+  /**
+   * @brief      Gets the number of tiles that are currently evicted to the tile directory.
+   */
+  std::size_t getStoredTileCount() const
+  {
+    return stored_tiles_.size();
+  }
+
+private:
+  using TileIndex = std::pair<int, int>;
+
+  TileIndex getTileIndex(double x, double y) const;
+  bool isTileInside(const TileIndex& tile, const octomap::point3d& center) const;
+  std::string getTileFilename(const TileIndex& tile) const;
+
+  double radius_;
+  double tile_size_;
+  std::string tile_directory_;
+
+  std::map<TileIndex, std::string> stored_tiles_; /*!< The evicted tiles and their files */
+  octomap::point3d last_center_;
+  bool has_last_center_;
+};
+}  // namespace occupancy_map_monitor
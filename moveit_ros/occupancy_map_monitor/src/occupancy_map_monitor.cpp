@@ -37,12 +37,14 @@
 #include <moveit/collision_detection/occupancy_map.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor_middleware_handle.hpp>
+#include <moveit/utils/thread_config.h>
 #include <moveit_msgs/srv/load_map.hpp>
 #include <moveit_msgs/srv/save_map.hpp>
 #include <rclcpp/clock.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/node.hpp>
+#include <tf2/exceptions.h>
 #include <memory>
 #include <string>
 #include <utility>
@@ -58,6 +60,7 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.occupancy_ma
 OccupancyMapMonitor::OccupancyMapMonitor(const rclcpp::Node::SharedPtr& node, double map_resolution)
   : OccupancyMapMonitor{ std::make_unique<OccupancyMapMonitorMiddlewareHandle>(node, map_resolution, ""), nullptr }
 {
+  moveit::threads::loadThreadConfigs(node);
 }
 
 OccupancyMapMonitor::OccupancyMapMonitor(const rclcpp::Node::SharedPtr& node,
@@ -66,6 +69,7 @@ OccupancyMapMonitor::OccupancyMapMonitor(const rclcpp::Node::SharedPtr& node,
   : OccupancyMapMonitor{ std::make_unique<OccupancyMapMonitorMiddlewareHandle>(node, map_resolution, map_frame),
                          tf_buffer }
 {
+  moveit::threads::loadThreadConfigs(node);
 }
 
 OccupancyMapMonitor::OccupancyMapMonitor(std::unique_ptr<MiddlewareHandle> middleware_handle,
@@ -76,6 +80,9 @@ OccupancyMapMonitor::OccupancyMapMonitor(std::unique_ptr<MiddlewareHandle> middl
   , debug_info_{ false }
   , mesh_handle_count_{ 0 }
   , active_{ false }
+  , map_version_{ 0 }
+  , keyframe_version_{ 0 }
+  , change_history_size_{ 100 }
 {
   if (middleware_handle_ == nullptr)
   {
@@ -99,6 +106,25 @@ OccupancyMapMonitor::OccupancyMapMonitor(std::unique_ptr<MiddlewareHandle> middl
 
   tree_ = std::make_shared<collision_detection::OccMapTree>(parameters_.map_resolution);
   tree_const_ = tree_;
+  // the cells changed by the updaters are recorded as versions of the map
+  tree_->enableChangeDetection(true);
+  tree_->setUpdateCallback([this] { treeUpdateCallback(); });
+
+  if (parameters_.window_radius > 0.0)
+  {
+    if (tf_buffer_ == nullptr || parameters_.map_frame.empty() || parameters_.window_center_frame.empty())
+      RCLCPP_ERROR(LOGGER, "The rolling octomap window needs a map frame, a center frame and a TF buffer. "
+                           "Keeping the whole map instead.");
+    else if (parameters_.window_tile_size <= 0.0)
+      RCLCPP_ERROR(LOGGER, "The tile size of the rolling octomap window must be positive. Keeping the whole map.");
+    else
+    {
+      window_ = std::make_unique<OccupancyMapWindow>(parameters_.window_radius, parameters_.window_tile_size,
+                                                     parameters_.window_tile_directory);
+      RCLCPP_INFO(LOGGER, "Keeping octomap within %g m of '%s'", parameters_.window_radius,
+                  parameters_.window_center_frame.c_str());
+    }
+  }
 
   for (const auto& [sensor_name, sensor_type] : parameters_.sensor_plugins)
   {
@@ -307,11 +333,130 @@ bool OccupancyMapMonitor::loadMapCallback(const std::shared_ptr<rmw_request_id_t
   tree_->unlockWrite();
 
   if (response->success)
+  {
+    resetMapChanges();
     tree_->triggerUpdateCallback();
+  }
 
   return true;
 }
 
+void OccupancyMapMonitor::treeUpdateCallback()
+{
+  octomap::point3d window_center;
+  const bool move_window = window_ && getWindowCenter(window_center);
+
+  std::function<void()> update_callback;
+  {
+    // resetting the change detection modifies the tree
+    collision_detection::OccMapTree::WriteLock tree_lock = tree_->writing();
+    // the cells removed by the window are not detected as changes, so the moved window is a new keyframe
+    const bool window_moved = move_window && window_->update(*tree_, window_center);
+    std::lock_guard<std::mutex> _(changes_lock_);
+    octomap::KeySet changed_cells;
+    changed_cells.reserve(tree_->numChangesDetected());
+    for (auto it = tree_->changedKeysBegin(); it != tree_->changedKeysEnd(); ++it)
+      changed_cells.insert(it->first);
+    tree_->resetChangeDetection();
+
+    change_history_.emplace_back(++map_version_, std::move(changed_cells));
+    while (change_history_.size() > change_history_size_)
+      change_history_.pop_front();
+    if (window_moved)
+    {
+      change_history_.clear();
+      keyframe_version_ = map_version_;
+    }
+    update_callback = update_callback_;
+  }
+
+  if (update_callback)
+    update_callback();
+}
+
+bool OccupancyMapMonitor::getWindowCenter(octomap::point3d& center)
+{
+  std::string map_frame;
+  {
+    std::lock_guard<std::mutex> _(parameters_lock_);
+    map_frame = parameters_.map_frame;
+  }
+  try
+  {
+    const geometry_msgs::msg::TransformStamped transform =
+        tf_buffer_->lookupTransform(map_frame, parameters_.window_center_frame, tf2::TimePointZero);
+    center = octomap::point3d(transform.transform.translation.x, transform.transform.translation.y,
+                              transform.transform.translation.z);
+    return true;
+  }
+  catch (const tf2::TransformException& ex)
+  {
+    rclcpp::Clock steady_clock(RCL_STEADY_TIME);
+    RCLCPP_WARN_THROTTLE(LOGGER, steady_clock, 5000, "Not moving the octomap window: %s", ex.what());
+    return false;
+  }
+}
+
+std::uint64_t OccupancyMapMonitor::getMapVersion() const
+{
+  std::lock_guard<std::mutex> _(changes_lock_);
+  return map_version_;
+}
+
+void OccupancyMapMonitor::getMapChangesSince(std::uint64_t version, OccupancyMapChanges& changes) const
+{
+  changes.updated_cells.clear();
+  changes.removed_cells.clear();
+
+  collision_detection::OccMapTree::ReadLock tree_lock = tree_->reading();
+  std::lock_guard<std::mutex> _(changes_lock_);
+  changes.version = map_version_;
+
+  // the history holds the versions (front().first, map_version_]
+  const bool history_covers_version =
+      version == map_version_ || (!change_history_.empty() && version + 1 >= change_history_.front().first);
+  changes.is_keyframe = version < keyframe_version_ || version > map_version_ || !history_covers_version;
+  if (changes.is_keyframe)
+  {
+    for (auto it = tree_->begin_leafs(), end = tree_->end_leafs(); it != end; ++it)
+      changes.updated_cells.emplace_back(it.getKey(), it->getLogOdds());
+    return;
+  }
+
+  octomap::KeySet changed_cells;
+  for (const auto& [cells_version, cells] : change_history_)
+  {
+    if (cells_version > version)
+      changed_cells.insert(cells.begin(), cells.end());
+  }
+  for (const octomap::OcTreeKey& key : changed_cells)
+  {
+    // the changed leaf may have been pruned into one of its parents
+    const octomap::OcTreeNode* node = tree_->search(key);
+    if (node)
+      changes.updated_cells.emplace_back(key, node->getLogOdds());
+    else
+      changes.removed_cells.push_back(key);
+  }
+}
+
+void OccupancyMapMonitor::resetMapChanges()
+{
+  collision_detection::OccMapTree::WriteLock tree_lock = tree_->writing();
+  std::lock_guard<std::mutex> _(changes_lock_);
+  tree_->resetChangeDetection();
+  change_history_.clear();
+  keyframe_version_ = ++map_version_;
+}
+
+void OccupancyMapMonitor::setChangeHistorySize(std::size_t size)
+{
+  std::lock_guard<std::mutex> _(changes_lock_);
+  change_history_size_ = size;
+  while (change_history_.size() > change_history_size_)
+    change_history_.pop_front();
+}
+
 void OccupancyMapMonitor::startMonitor()
 {
   active_ = true;
@@ -88,6 +88,12 @@ OccupancyMapMonitorMiddlewareHandle::OccupancyMapMonitorMiddlewareHandle(const r
     }
   }
 
+  // optional rolling window, which keeps the map around the robot on long missions of a mobile base
+  node_->get_parameter("octomap_window_radius", parameters_.window_radius);
+  node_->get_parameter("octomap_window_tile_size", parameters_.window_tile_size);
+  node_->get_parameter("octomap_window_center_frame", parameters_.window_center_frame);
+  node_->get_parameter("octomap_window_tile_directory", parameters_.window_tile_directory);
+
   std::vector<std::string> sensor_names;
   if (!node_->get_parameter("sensors", sensor_names))
   {
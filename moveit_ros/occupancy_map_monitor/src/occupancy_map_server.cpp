@@ -48,6 +48,9 @@
 #include <rclcpp/qos_event.hpp>
 #include <rclcpp/time.hpp>
 #include <rclcpp/utilities.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <sstream>
 
@@ -77,6 +80,30 @@ static void publishOctomap(const rclcpp::Publisher<octomap_msgs::msg::Octomap>::
   octree_binary_pub->publish(map);
 }
 
+// Publishes the cells changed since the previous message as a full octree of only these cells. Removed cells have a
+// log-odds of NaN. Receivers apply the cells to their copy of the keyframe published as the binary octree.
+static void publishOctomapChanges(const rclcpp::Publisher<octomap_msgs::msg::Octomap>::SharedPtr& octree_changes_pub,
+                                  occupancy_map_monitor::OccupancyMapMonitor& server,
+                                  const occupancy_map_monitor::OccupancyMapChanges& changes)
+{
+  octomap::OcTree changed_cells(server.getMapResolution());
+  for (const auto& [key, log_odds] : changes.updated_cells)
+    changed_cells.setNodeValue(key, log_odds);
+  for (const octomap::OcTreeKey& key : changes.removed_cells)
+    changed_cells.setNodeValue(key, std::numeric_limits<float>::quiet_NaN());
+
+  octomap_msgs::msg::Octomap map;
+  map.header.frame_id = server.getMapFrame();
+  map.header.stamp = rclcpp::Clock().now();
+  if (octomap_msgs::fullMapToMsg(changed_cells, map))
+    octree_changes_pub->publish(map);
+  else
+  {
+    rclcpp::Clock steady_clock(RCL_STEADY_TIME);
+    RCLCPP_ERROR_THROTTLE(LOGGER, steady_clock, 1000, "Could not generate OctoMap changes message");
+  }
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
@@ -87,7 +114,32 @@ int main(int argc, char** argv)
   std::shared_ptr<tf2_ros::Buffer> buffer = std::make_shared<tf2_ros::Buffer>(clock_ptr, tf2::durationFromSec(5.0));
   tf2_ros::TransformListener listener(*buffer, node, false /* spin_thread - disables executor */);
   occupancy_map_monitor::OccupancyMapMonitor server(node, buffer);
-  server.setUpdateCallback([&octree_binary_pub, &server] { return publishOctomap(octree_binary_pub, server); });
+
+  // With a keyframe period above one, only every that many updates publish the complete octree, the others publish
+  // the changed cells on octomap_changes
+  const int keyframe_period = std::max<int>(node->declare_parameter<int>("octomap_keyframe_period", 1), 1);
+  rclcpp::Publisher<octomap_msgs::msg::Octomap>::SharedPtr octree_changes_pub;
+  if (keyframe_period > 1)
+    octree_changes_pub = node->create_publisher<octomap_msgs::msg::Octomap>("octomap_changes", rclcpp::QoS(10));
+  std::uint64_t published_version = 0;
+  int updates_since_keyframe = 0;
+  occupancy_map_monitor::OccupancyMapChanges changes;
+  server.setUpdateCallback([&, keyframe_period] {
+    if (octree_changes_pub && updates_since_keyframe + 1 < keyframe_period)
+    {
+      server.getMapChangesSince(published_version, changes);
+      if (!changes.is_keyframe)
+      {
+        publishOctomapChanges(octree_changes_pub, server, changes);
+        published_version = changes.version;
+        ++updates_since_keyframe;
+        return;
+      }
+    }
+    published_version = server.getMapVersion();
+    updates_since_keyframe = 0;
+    publishOctomap(octree_binary_pub, server);
+  });
   server.startMonitor();
 
   rclcpp::spin(node);
@@ -0,0 +1,200 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/occupancy_map_monitor/occupancy_map_window.h>
+
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace occupancy_map_monitor
+{
+namespace
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.occupancy_map_monitor.window");
+
+// Sets the cells of a leaf in another tree. Leaves above the maximum depth were pruned, so they are expanded into the
+// cells of the maximum depth which the target tree prunes again.
+void copyLeaf(octomap::OcTree& target, const octomap::point3d& leaf_center, double leaf_size, float log_odds)
+{
+  const double resolution = target.getResolution();
+  const int cells = std::max(static_cast<int>(std::lround(leaf_size / resolution)), 1);
+  const double offset = 0.5 * (resolution - leaf_size);
+  octomap::OcTreeKey key;
+  for (int i = 0; i < cells; ++i)
+    for (int j = 0; j < cells; ++j)
+      for (int k = 0; k < cells; ++k)
+      {
+        const octomap::point3d cell(leaf_center.x() + offset + i * resolution,
+                                    leaf_center.y() + offset + j * resolution,
+                                    leaf_center.z() + offset + k * resolution);
+        if (target.coordToKeyChecked(cell, key))
+          target.setNodeValue(key, log_odds, true);
+      }
+}
+}  // namespace
+
+OccupancyMapWindow::OccupancyMapWindow(double radius, double tile_size, const std::string& tile_directory)
+  : radius_{ radius }, tile_size_{ tile_size }, tile_directory_{ tile_directory }, has_last_center_{ false }
+{
+  if (radius_ <= 0.0 || tile_size_ <= 0.0)
+    throw std::invalid_argument("OccupancyMapWindow needs a positive radius and tile size");
+  if (!tile_directory_.empty() && tile_directory_.back() != '/')
+    tile_directory_ += '/';
+}
+
+OccupancyMapWindow::TileIndex OccupancyMapWindow::getTileIndex(double x, double y) const
+{
+  return { static_cast<int>(std::floor(x / tile_size_)), static_cast<int>(std::floor(y / tile_size_)) };
+}
+
+bool OccupancyMapWindow::isTileInside(const TileIndex& tile, const octomap::point3d& center) const
+{
+  // distance from the center to the closest point of the tile
+  const double dx =
+      std::max({ tile.first * tile_size_ - center.x(), center.x() - (tile.first + 1) * tile_size_, 0.0 });
+  const double dy =
+      std::max({ tile.second * tile_size_ - center.y(), center.y() - (tile.second + 1) * tile_size_, 0.0 });
+  return dx * dx + dy * dy <= radius_ * radius_;
+}
+
+std::string OccupancyMapWindow::getTileFilename(const TileIndex& tile) const
+{
+  std::stringstream filename;
+  filename << tile_directory_ << "octomap_tile_" << tile.first << '_' << tile.second << ".ot";
+  return filename.str();
+}
+
+bool OccupancyMapWindow::update(collision_detection::OccMapTree& tree, const octomap::point3d& center)
+{
+  if (has_last_center_ && (center - last_center_).norm() < 0.1 * tile_size_)
+    return false;
+  has_last_center_ = true;
+  last_center_ = center;
+
+  // collect the leaves of the tiles outside of the window
+  struct Leaf
+  {
+    octomap::OcTreeKey key;
+    unsigned int depth;
+    octomap::point3d center;
+    double size;
+    float log_odds;
+  };
+  std::map<TileIndex, std::vector<Leaf>> evicted_tiles;
+  for (auto it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it)
+  {
+    const TileIndex tile = getTileIndex(it.getX(), it.getY());
+    if (!isTileInside(tile, center))
+      evicted_tiles[tile].push_back({ it.getKey(), it.getDepth(), it.getCoordinate(), it.getSize(), it->getLogOdds() });
+  }
+
+  bool changed = false;
+  for (const auto& [tile, leaves] : evicted_tiles)
+  {
+    if (!tile_directory_.empty())
+    {
+      octomap::OcTree tile_tree(tree.getResolution());
+      // cells that were added to a stored tile while it was outside of the window are merged into its file
+      auto stored_tile = stored_tiles_.find(tile);
+      if (stored_tile != stored_tiles_.end())
+      {
+        std::unique_ptr<octomap::AbstractOcTree> stored_tree(octomap::AbstractOcTree::read(stored_tile->second));
+        if (auto* stored_octree = dynamic_cast<octomap::OcTree*>(stored_tree.get()))
+          tile_tree.swapContent(*stored_octree);
+      }
+      for (const Leaf& leaf : leaves)
+        copyLeaf(tile_tree, leaf.center, leaf.size, leaf.log_odds);
+      tile_tree.updateInnerOccupancy();
+      tile_tree.prune();
+
+      const std::string filename = getTileFilename(tile);
+      if (tile_tree.write(filename))
+        stored_tiles_[tile] = filename;
+      else
+        RCLCPP_ERROR(LOGGER, "Failed to write octomap tile to %s, dropping it", filename.c_str());
+    }
+    for (const Leaf& leaf : leaves)
+      tree.deleteNode(leaf.key, leaf.depth);
+    changed = true;
+  }
+
+  // read the stored tiles back that are inside of the window again
+  bool restored = false;
+  for (auto stored_tile = stored_tiles_.begin(); stored_tile != stored_tiles_.end();)
+  {
+    if (!isTileInside(stored_tile->first, center))
+    {
+      ++stored_tile;
+      continue;
+    }
+
+    std::unique_ptr<octomap::AbstractOcTree> stored_tree(octomap::AbstractOcTree::read(stored_tile->second));
+    if (auto* tile_tree = dynamic_cast<octomap::OcTree*>(stored_tree.get()))
+    {
+      for (auto it = tile_tree->begin_leafs(), end = tile_tree->end_leafs(); it != end; ++it)
+      {
+        // keep the cells that were observed since the tile was evicted
+        if (!tree.search(it.getCoordinate()))
+          copyLeaf(tree, it.getCoordinate(), it.getSize(), it->getLogOdds());
+      }
+      restored = true;
+    }
+    else
+      RCLCPP_ERROR(LOGGER, "Failed to read octomap tile from %s", stored_tile->second.c_str());
+
+    std::remove(stored_tile->second.c_str());
+    stored_tile = stored_tiles_.erase(stored_tile);
+  }
+  if (restored)
+  {
+    tree.updateInnerOccupancy();
+    tree.prune();
+    changed = true;
+  }
+
+  if (changed)
+    RCLCPP_DEBUG(LOGGER, "Moved octomap window to (%g, %g): evicted %zu tiles, %zu tiles stored", center.x(),
+                 center.y(), evicted_tiles.size(), stored_tiles_.size());
+  return changed;
+}
+}  // namespace occupancy_map_monitor
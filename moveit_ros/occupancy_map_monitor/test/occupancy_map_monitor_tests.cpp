@@ -40,6 +40,8 @@
 #include <gtest/gtest.h>
 #include <tf2_ros/buffer.h>
 
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <utility>
@@ -77,6 +79,74 @@ TEST(OccupancyMapMonitorTests, ConstructorTest)
   };
 }
 
+TEST(OccupancyMapMonitorTests, MapChangesTest)
+{
+  // GIVEN an occupancy map monitor with a map resolution
+  auto mock_middleware_handle = std::make_unique<testing::NiceMock<MockMiddlewareHandle>>();
+  ON_CALL(*mock_middleware_handle, getParameters)
+      .WillByDefault(testing::Return(occupancy_map_monitor::OccupancyMapMonitor::Parameters{ 0.1, "", {} }));
+  occupancy_map_monitor::OccupancyMapMonitor occupancy_map_monitor{
+    std::move(mock_middleware_handle), std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>())
+  };
+  const occupancy_map_monitor::OccMapTreePtr tree = occupancy_map_monitor.getOcTreePtr();
+
+  // WHEN a cell is updated
+  tree->lockWrite();
+  tree->updateNode(octomap::point3d(0.5, 0.5, 0.5), true);
+  tree->unlockWrite();
+  tree->triggerUpdateCallback();
+
+  // THEN the changes since the initial version contain the cell
+  occupancy_map_monitor::OccupancyMapChanges changes;
+  occupancy_map_monitor.getMapChangesSince(0, changes);
+  EXPECT_FALSE(changes.is_keyframe);
+  EXPECT_EQ(changes.updated_cells.size(), 1u);
+  EXPECT_TRUE(changes.removed_cells.empty());
+  EXPECT_EQ(changes.version, occupancy_map_monitor.getMapVersion());
+
+  // THEN there are no changes since the latest version
+  occupancy_map_monitor.getMapChangesSince(changes.version, changes);
+  EXPECT_FALSE(changes.is_keyframe);
+  EXPECT_TRUE(changes.updated_cells.empty());
+
+  // WHEN the map is reset
+  const std::uint64_t old_version = changes.version;
+  occupancy_map_monitor.resetMapChanges();
+
+  // THEN the changes since an older version are a keyframe of the whole map
+  occupancy_map_monitor.getMapChangesSince(old_version, changes);
+  EXPECT_TRUE(changes.is_keyframe);
+  EXPECT_EQ(changes.updated_cells.size(), 1u);
+}
+
+TEST(OccupancyMapMonitorTests, MapWindowTest)
+{
+  // GIVEN a map with a cell close to the origin and one far away
+  collision_detection::OccMapTree tree(0.1);
+  const octomap::point3d near_cell(0.55, 0.55, 0.55);
+  const octomap::point3d far_cell(10.55, 0.55, 0.55);
+  tree.updateNode(near_cell, true);
+  tree.updateNode(far_cell, true);
+
+  // WHEN the window is centered on the origin
+  occupancy_map_monitor::OccupancyMapWindow window(2.0, 1.0, std::filesystem::temp_directory_path().string());
+  EXPECT_TRUE(window.update(tree, octomap::point3d(0.0, 0.0, 0.0)));
+
+  // THEN only the far cell is evicted
+  EXPECT_NE(tree.search(near_cell), nullptr);
+  EXPECT_EQ(tree.search(far_cell), nullptr);
+  EXPECT_EQ(window.getStoredTileCount(), 1u);
+
+  // WHEN the window moves to the far cell
+  EXPECT_TRUE(window.update(tree, octomap::point3d(10.0, 0.0, 0.0)));
+
+  // THEN the far cell is read back and the near cell is evicted
+  ASSERT_NE(tree.search(far_cell), nullptr);
+  EXPECT_TRUE(tree.isNodeOccupied(tree.search(far_cell)));
+  EXPECT_EQ(tree.search(near_cell), nullptr);
+  EXPECT_EQ(window.getStoredTileCount(), 1u);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -60,9 +60,12 @@ public:
   ShapeHandle excludeShape(const shapes::ShapeConstPtr& shape) override;
   void forgetShape(ShapeHandle handle) override;
 
-private:
+  /** \brief Integrate a depth image into the octomap. This is called for every received image, and can be called
+      directly to integrate images that are not received on the topic, e.g. recorded ones */
   void depthImageCallback(const sensor_msgs::msg::Image::ConstSharedPtr& depth_msg,
                           const sensor_msgs::msg::CameraInfo::ConstSharedPtr& info_msg);
+
+private:
   bool getShapeTransform(mesh_filter::MeshHandle h, Eigen::Isometry3d& transform) const;
   void stopHelper();
 
@@ -36,6 +36,7 @@
 
 #include <moveit/depth_image_octomap_updater/depth_image_octomap_updater.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
+#include <moveit/utils/thread_config.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 // TODO: Remove conditional includes when released to all active distros.
 #if __has_include(<tf2/LinearMath/Vector3.hpp>)
@@ -52,6 +53,7 @@
 #include <sensor_msgs/image_encodings.hpp>
 #include <stdint.h>
 
+#include <algorithm>
 #include <memory>
 
 namespace occupancy_map_monitor
@@ -103,6 +105,26 @@ bool DepthImageOctomapUpdater::setParams(const std::string& name_space)
         node_->get_parameter(name_space + ".skip_horizontal_pixels", skip_horizontal_pixels_) &&
         node_->get_parameter(name_space + ".filtered_cloud_topic", filtered_cloud_topic_) &&
         node_->get_parameter(name_space + ".ns", ns_);
+
+    // The number of threads that clear the free space is optional
+    int num_threads = 1;
+    node_->get_parameter_or(name_space + ".num_threads", num_threads, 1);
+    if (free_space_updater_)
+      free_space_updater_->setNumThreads(static_cast<unsigned int>(std::max(num_threads, 1)));
+
+    // The cells waiting for the free space computation are bounded, the oldest are merged or dropped
+    int free_space_queue_size = 20;
+    std::string free_space_queue_policy = "merge";
+    node_->get_parameter_or(name_space + ".free_space_queue_size", free_space_queue_size, 20);
+    node_->get_parameter_or(name_space + ".free_space_queue_policy", free_space_queue_policy, std::string("merge"));
+    if (free_space_queue_policy != "merge" && free_space_queue_policy != "drop_oldest")
+      RCLCPP_WARN(LOGGER, "Unknown free_space_queue_policy '%s', merging the oldest cells",
+                  free_space_queue_policy.c_str());
+    if (free_space_updater_)
+      free_space_updater_->setMaxQueueSize(static_cast<std::size_t>(std::max(free_space_queue_size, 0)),
+                                           free_space_queue_policy == "drop_oldest" ?
+                                               LazyFreeSpaceUpdater::QueuePolicy::DROP_OLDEST :
+                                               LazyFreeSpaceUpdater::QueuePolicy::MERGE);
     return true;
   }
   catch (const rclcpp::exceptions::InvalidParameterTypeException& e)
@@ -123,9 +145,12 @@ bool DepthImageOctomapUpdater::initialize(const rclcpp::Node::SharedPtr& node)
   tf_buffer_ = monitor_->getTFClient();
   free_space_updater_ = std::make_unique<LazyFreeSpaceUpdater>(tree_);
 
-  // create our mesh filter
+  // create our mesh filter, optionally rendering in the same OpenGL context as the filters of the other cameras
+  bool share_mesh_filter_context = false;
+  node_->get_parameter_or("share_mesh_filter_context", share_mesh_filter_context, false);
   mesh_filter_ = std::make_unique<mesh_filter::MeshFilter<mesh_filter::StereoCameraModel>>(
-      mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS);
+      mesh_filter::MeshFilterBase::TransformCallback(), mesh_filter::StereoCameraModel::REGISTERED_PSDK_PARAMS,
+      share_mesh_filter_context ? mesh_filter::GLRenderThread::getShared() : mesh_filter::GLRenderThreadPtr());
   mesh_filter_->parameters().setDepthRange(near_clipping_plane_distance_, far_clipping_plane_distance_);
   mesh_filter_->setShadowThreshold(shadow_threshold_);
   mesh_filter_->setPaddingOffset(padding_offset_);
@@ -226,6 +251,7 @@ static const bool HOST_IS_BIG_ENDIAN = host_is_big_endian();
 void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::msg::Image::ConstSharedPtr& depth_msg,
                                                   const sensor_msgs::msg::CameraInfo::ConstSharedPtr& info_msg)
 {
+  moveit::threads::configureCurrentThread("occupancy_map_updater");
   RCLCPP_DEBUG(LOGGER, "Received a new depth image message (frame = '%s', encoding='%s')",
                depth_msg->header.frame_id.c_str(), depth_msg->encoding.c_str());
   rclcpp::Time start = node_->now();
@@ -37,22 +37,57 @@
 #pragma once
 
 #include <moveit/collision_detection/occupancy_map.h>
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <unordered_map>
 #include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
 class LazyFreeSpaceUpdater
 {
 public:
+  /** \brief What happens to the oldest cell sets when more are pushed than can be processed */
+  enum class QueuePolicy
+  {
+    DROP_OLDEST, /*!< The oldest sets are discarded */
+    MERGE        /*!< The oldest sets are merged into the next ones if the sensor did not move, else discarded */
+  };
+
+  /** \brief Counters to tell whether the free space computation falls behind the sensor */
+  struct Statistics
+  {
+    std::size_t pushed_sets = 0;       /*!< Sets of cells pushed with pushLazyUpdate() */
+    std::size_t merged_sets = 0;       /*!< Sets merged into others because the queue was full */
+    std::size_t dropped_sets = 0;      /*!< Sets discarded because the queue was full */
+    std::size_t queued_sets = 0;       /*!< Sets currently waiting to be batched */
+    std::size_t merged_batches = 0;    /*!< Batches merged into the next one because they were not processed yet */
+    std::size_t dropped_batches = 0;   /*!< Batches discarded because they were not processed yet */
+    std::size_t processed_batches = 0; /*!< Batches whose free cells were marked in the octree */
+    double last_lag = 0.0; /*!< Seconds from the push of the oldest set of the last batch until it was marked */
+    double max_lag = 0.0;  /*!< Largest lag of any batch */
+  };
+
   LazyFreeSpaceUpdater(const collision_detection::OccMapTreePtr& tree, unsigned int max_batch_size = 10);
   ~LazyFreeSpaceUpdater();
 
   void pushLazyUpdate(octomap::KeySet* occupied_cells, octomap::KeySet* model_cells,
                       const octomap::point3d& sensor_origin);
 
+  /** \brief Set the number of threads that cast the rays of a batch. Defaults to one */
+  void setNumThreads(unsigned int num_threads);
+
+  /** \brief Bound the number of sets that wait to be batched, and the behavior when they exceed it. Defaults to 20
+   *  sets which are merged. A size of zero does not bound the queue. */
+  void setMaxQueueSize(std::size_t max_queue_size, QueuePolicy policy = QueuePolicy::MERGE);
+
+  Statistics getStatistics() const;
+
 private:
 #ifdef __APPLE__
   typedef std::unordered_map<octomap::OcTreeKey, unsigned int, octomap::OcTreeKey::KeyHash> OcTreeKeyCountMap;
@@ -62,8 +97,25 @@ private:
   typedef std::tr1::unordered_map<octomap::OcTreeKey, unsigned int, octomap::OcTreeKey::KeyHash> OcTreeKeyCountMap;
 #endif
 
-  void pushBatchToProcess(OcTreeKeyCountMap* occupied_cells, octomap::KeySet* model_cells,
-                          const octomap::point3d& sensor_origin);
+  /** \brief A set of cells pushed by pushLazyUpdate() */
+  struct CellSets
+  {
+    octomap::KeySet* occupied_cells;
+    octomap::KeySet* model_cells;
+    octomap::point3d sensor_origin;
+    std::chrono::steady_clock::time_point stamp;
+  };
+
+  /** \brief The merged sets of cells with the same sensor origin, which are marked at once */
+  struct Batch
+  {
+    OcTreeKeyCountMap* occupied_cells = nullptr;
+    octomap::KeySet* model_cells = nullptr;
+    octomap::point3d sensor_origin;
+    std::chrono::steady_clock::time_point stamp; /*!< When the oldest of the sets was pushed */
+  };
+
+  void pushBatchToProcess(Batch batch);
 
   void lazyUpdateThread();
   void processThread();
@@ -72,19 +124,21 @@ private:
   bool running_;
   std::size_t max_batch_size_;
   double max_sensor_delta_;
+  std::atomic<unsigned int> num_threads_;
 
-  std::deque<octomap::KeySet*> occupied_cells_sets_;
-  std::deque<octomap::KeySet*> model_cells_sets_;
-  std::deque<octomap::point3d> sensor_origins_;
+  std::deque<CellSets> cell_sets_;
+  std::size_t max_queue_size_;
+  QueuePolicy queue_policy_;
   std::condition_variable update_condition_;
   std::mutex update_cell_sets_lock_;
 
-  OcTreeKeyCountMap* process_occupied_cells_set_;
-  octomap::KeySet* process_model_cells_set_;
-  octomap::point3d process_sensor_origin_;
+  Batch process_batch_;
   std::condition_variable process_condition_;
   std::mutex cell_process_lock_;
 
+  Statistics statistics_;
+  mutable std::mutex statistics_lock_;
+
   std::thread update_thread_;
   std::thread process_thread_;
 };
@@ -35,9 +35,14 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/lazy_free_space_updater/lazy_free_space_updater.h>
+#include <moveit/utils/thread_config.h>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/clock.hpp>
 
+#include <algorithm>
+
+#include <omp.h>
+
 namespace occupancy_map_monitor
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.lazy_free_space_updater");
@@ -47,8 +52,9 @@ LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const collision_detection::OccMapTree
   , running_(true)
   , max_batch_size_(max_batch_size)
   , max_sensor_delta_(1e-3)  // 1mm
-  , process_occupied_cells_set_(nullptr)
-  , process_model_cells_set_(nullptr)
+  , num_threads_(1)
+  , max_queue_size_(20)
+  , queue_policy_(QueuePolicy::MERGE)
   , update_thread_([this] { lazyUpdateThread(); })
   , process_thread_([this] { processThread(); })
 {
@@ -67,6 +73,14 @@ LazyFreeSpaceUpdater::~LazyFreeSpaceUpdater()
   }
   update_thread_.join();
   process_thread_.join();
+
+  for (CellSets& sets : cell_sets_)
+  {
+    delete sets.occupied_cells;
+    delete sets.model_cells;
+  }
+  delete process_batch_.occupied_cells;
+  delete process_batch_.model_cells;
 }
 
 void LazyFreeSpaceUpdater::pushLazyUpdate(octomap::KeySet* occupied_cells, octomap::KeySet* model_cells,
@@ -75,111 +89,189 @@ void LazyFreeSpaceUpdater::pushLazyUpdate(octomap::KeySet* occupied_cells, octom
   RCLCPP_DEBUG(LOGGER, "Pushing %lu occupied cells and %lu model cells for lazy updating...",
                (long unsigned int)occupied_cells->size(), (long unsigned int)model_cells->size());
   std::scoped_lock _(update_cell_sets_lock_);
-  occupied_cells_sets_.push_back(occupied_cells);
-  model_cells_sets_.push_back(model_cells);
-  sensor_origins_.push_back(sensor_origin);
+  cell_sets_.push_back({ occupied_cells, model_cells, sensor_origin, std::chrono::steady_clock::now() });
+
+  // when the sensor is faster than the batching, the oldest sets make room for the new one
+  std::size_t merged_sets = 0;
+  std::size_t dropped_sets = 0;
+  while (max_queue_size_ > 0 && cell_sets_.size() > max_queue_size_)
+  {
+    CellSets oldest = cell_sets_.front();
+    cell_sets_.pop_front();
+    CellSets& next = cell_sets_.front();
+    if (queue_policy_ == QueuePolicy::MERGE && (next.sensor_origin - oldest.sensor_origin).norm() <= max_sensor_delta_)
+    {
+      // cells occupied in both sets only count once
+      next.occupied_cells->insert(oldest.occupied_cells->begin(), oldest.occupied_cells->end());
+      next.model_cells->insert(oldest.model_cells->begin(), oldest.model_cells->end());
+      next.stamp = oldest.stamp;
+      ++merged_sets;
+    }
+    else
+      ++dropped_sets;
+    delete oldest.occupied_cells;
+    delete oldest.model_cells;
+  }
+  if (dropped_sets > 0)
+  {
+    rclcpp::Clock steady_clock(RCL_STEADY_TIME);
+    RCLCPP_WARN_THROTTLE(LOGGER, steady_clock, 1000, "Free space updates fall behind, dropping the oldest cells");
+  }
+
+  {
+    std::scoped_lock lock(statistics_lock_);
+    ++statistics_.pushed_sets;
+    statistics_.merged_sets += merged_sets;
+    statistics_.dropped_sets += dropped_sets;
+    statistics_.queued_sets = cell_sets_.size();
+  }
   update_condition_.notify_one();
 }
 
-void LazyFreeSpaceUpdater::pushBatchToProcess(OcTreeKeyCountMap* occupied_cells, octomap::KeySet* model_cells,
-                                              const octomap::point3d& sensor_origin)
+void LazyFreeSpaceUpdater::setNumThreads(unsigned int num_threads)
+{
+  num_threads_ = std::max(num_threads, 1u);
+}
+
+void LazyFreeSpaceUpdater::setMaxQueueSize(std::size_t max_queue_size, QueuePolicy policy)
+{
+  std::scoped_lock _(update_cell_sets_lock_);
+  max_queue_size_ = max_queue_size;
+  queue_policy_ = policy;
+}
+
+LazyFreeSpaceUpdater::Statistics LazyFreeSpaceUpdater::getStatistics() const
+{
+  std::scoped_lock _(statistics_lock_);
+  return statistics_;
+}
+
+void LazyFreeSpaceUpdater::pushBatchToProcess(Batch batch)
 {
-  // this is basically a queue of size 1. if this function is called repeatedly without any work being done by
-  // processThread(),
-  // data can be lost; this is intentional, to avoid spending too much time clearing the octomap
-  if (cell_process_lock_.try_lock())
+  // this is basically a queue of size 1, to avoid spending too much time clearing the octomap. A batch that
+  // processThread() did not start on yet is merged into the new one or dropped, following the queue policy
+  bool merged = false;
+  bool dropped = false;
   {
-    process_occupied_cells_set_ = occupied_cells;
-    process_model_cells_set_ = model_cells;
-    process_sensor_origin_ = sensor_origin;
+    std::scoped_lock _(cell_process_lock_);
+    if (process_batch_.occupied_cells)
+    {
+      if (queue_policy_ == QueuePolicy::MERGE &&
+          (batch.sensor_origin - process_batch_.sensor_origin).norm() <= max_sensor_delta_)
+      {
+        for (const std::pair<const octomap::OcTreeKey, unsigned int>& it : *process_batch_.occupied_cells)
+          (*batch.occupied_cells)[it.first] += it.second;
+        batch.model_cells->insert(process_batch_.model_cells->begin(), process_batch_.model_cells->end());
+        batch.stamp = process_batch_.stamp;
+        merged = true;
+      }
+      else
+        dropped = true;
+      delete process_batch_.occupied_cells;
+      delete process_batch_.model_cells;
+    }
+    process_batch_ = batch;
     process_condition_.notify_one();
-    cell_process_lock_.unlock();
-  }
-  else
-  {
-    RCLCPP_WARN(LOGGER, "Previous batch update did not complete. Ignoring set of cells to be freed.");
-    delete occupied_cells;
-    delete model_cells;
   }
+
+  if (dropped)
+    RCLCPP_WARN(LOGGER, "Previous batch update did not complete. Ignoring its set of cells to be freed.");
+  std::scoped_lock _(statistics_lock_);
+  statistics_.merged_batches += merged ? 1 : 0;
+  statistics_.dropped_batches += dropped ? 1 : 0;
 }
 
 void LazyFreeSpaceUpdater::processThread()
 {
+  moveit::threads::configureCurrentThread("occupancy_map_updater");
   const float lg_0 = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
   const float lg_miss = tree_->getProbMissLog();
 
-  octomap::KeyRay key_ray1, key_ray2;
-  OcTreeKeyCountMap free_cells1, free_cells2;
+  // Ray ends with the number of times they were seen, and the free cells found by each thread
+  std::vector<std::pair<octomap::OcTreeKey, unsigned int>> ray_ends;
+  std::vector<octomap::KeyRay> key_rays;
+  std::vector<OcTreeKeyCountMap> thread_free_cells;
+  OcTreeKeyCountMap free_cells;
 
   while (running_)
   {
-    free_cells1.clear();
-    free_cells2.clear();
+    free_cells.clear();
 
-    std::unique_lock<std::mutex> ulock(cell_process_lock_);
-    while (!process_occupied_cells_set_ && running_)
-      process_condition_.wait(ulock);
+    // take the batch, so the next one can be pushed while this one is processed
+    Batch batch;
+    {
+      std::unique_lock<std::mutex> ulock(cell_process_lock_);
+      while (!process_batch_.occupied_cells && running_)
+        process_condition_.wait(ulock);
 
-    if (!running_)
-      break;
+      if (!running_)
+        break;
+      batch = process_batch_;
+      process_batch_ = Batch();
+    }
 
     RCLCPP_DEBUG(LOGGER,
                  "Begin processing batched update: marking free cells due to %lu occupied cells and %lu model cells",
-                 (long unsigned int)process_occupied_cells_set_->size(),
-                 (long unsigned int)process_model_cells_set_->size());
+                 (long unsigned int)batch.occupied_cells->size(),
+                 (long unsigned int)batch.model_cells->size());
 
     rclcpp::Clock clock;
     rclcpp::Time start = clock.now();
+
+    /* the rays that end at occupied cells and at model cells are distributed over all threads */
+    ray_ends.clear();
+    ray_ends.reserve(batch.occupied_cells->size() + batch.model_cells->size());
+    ray_ends.insert(ray_ends.end(), batch.occupied_cells->begin(), batch.occupied_cells->end());
+    for (const octomap::OcTreeKey& it : *batch.model_cells)
+      ray_ends.emplace_back(it, 1);
+
+    const unsigned int num_threads = num_threads_;
+    key_rays.resize(num_threads);
+    thread_free_cells.resize(num_threads);
+    for (OcTreeKeyCountMap& cells : thread_free_cells)
+      cells.clear();
+
     tree_->lockRead();
 
-#pragma omp sections
+    const int num_rays = static_cast<int>(ray_ends.size());
+#pragma omp parallel for schedule(static) num_threads(num_threads) if (num_threads > 1)
+    for (int i = 0; i < num_rays; ++i)
     {
-#pragma omp section
-      {
-        /* compute the free cells along each ray that ends at an occupied cell */
-        for (std::pair<const octomap::OcTreeKey, unsigned int>& it : *process_occupied_cells_set_)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(it.first), key_ray1))
-            for (octomap::OcTreeKey& jt : key_ray1)
-              free_cells1[jt] += it.second;
-      }
-
-#pragma omp section
-      {
-        /* compute the free cells along each ray that ends at a model cell */
-        for (const octomap::OcTreeKey& it : *process_model_cells_set_)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(it), key_ray2))
-            for (octomap::OcTreeKey& jt : key_ray2)
-              free_cells2[jt]++;
-      }
+      const int thread = omp_get_thread_num();
+      octomap::KeyRay& key_ray = key_rays[thread];
+      OcTreeKeyCountMap& cells = thread_free_cells[thread];
+      /* compute the free cells along each ray that ends at an occupied or model cell */
+      if (tree_->computeRayKeys(batch.sensor_origin, tree_->keyToCoord(ray_ends[i].first), key_ray))
+        for (octomap::OcTreeKey& jt : key_ray)
+          cells[jt] += ray_ends[i].second;
     }
 
     tree_->unlockRead();
 
-    for (std::pair<const octomap::OcTreeKey, unsigned int>& it : *process_occupied_cells_set_)
+    free_cells.swap(thread_free_cells[0]);
+    for (std::size_t thread = 1; thread < thread_free_cells.size(); ++thread)
     {
-      free_cells1.erase(it.first);
-      free_cells2.erase(it.first);
+      for (const std::pair<const octomap::OcTreeKey, unsigned int>& it : thread_free_cells[thread])
+        free_cells[it.first] += it.second;
     }
 
-    for (const octomap::OcTreeKey& it : *process_model_cells_set_)
-    {
-      free_cells1.erase(it);
-      free_cells2.erase(it);
-    }
-    RCLCPP_DEBUG(LOGGER, "Marking %lu cells as free...", (long unsigned int)(free_cells1.size() + free_cells2.size()));
+    for (std::pair<const octomap::OcTreeKey, unsigned int>& it : *batch.occupied_cells)
+      free_cells.erase(it.first);
+
+    for (const octomap::OcTreeKey& it : *batch.model_cells)
+      free_cells.erase(it);
+    RCLCPP_DEBUG(LOGGER, "Marking %lu cells as free...", (long unsigned int)free_cells.size());
 
     tree_->lockWrite();
 
     try
     {
       // set the logodds to the minimum for the cells that are part of the model
-      for (const octomap::OcTreeKey& it : *process_model_cells_set_)
+      for (const octomap::OcTreeKey& it : *batch.model_cells)
         tree_->updateNode(it, lg_0);
 
       /* mark free cells only if not seen occupied in this cloud */
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells1)
-        tree_->updateNode(it.first, it.second * lg_miss);
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells2)
+      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells)
         tree_->updateNode(it.first, it.second * lg_miss);
     }
     catch (...)
@@ -189,26 +281,31 @@ void LazyFreeSpaceUpdater::processThread()
     tree_->unlockWrite();
     tree_->triggerUpdateCallback();
 
-    RCLCPP_DEBUG(LOGGER, "Marked free cells in %lf ms", (clock.now() - start).seconds() * 1000.0);
+    const double lag = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch.stamp).count();
+    RCLCPP_DEBUG(LOGGER, "Marked free cells in %lf ms, %lf ms after the cells were pushed",
+                 (clock.now() - start).seconds() * 1000.0, lag * 1000.0);
+    {
+      std::scoped_lock _(statistics_lock_);
+      ++statistics_.processed_batches;
+      statistics_.last_lag = lag;
+      statistics_.max_lag = std::max(statistics_.max_lag, lag);
+    }
 
-    delete process_occupied_cells_set_;
-    process_occupied_cells_set_ = nullptr;
-    delete process_model_cells_set_;
-    process_model_cells_set_ = nullptr;
+    delete batch.occupied_cells;
+    delete batch.model_cells;
   }
 }
 
 void LazyFreeSpaceUpdater::lazyUpdateThread()
 {
-  OcTreeKeyCountMap* occupied_cells_set = nullptr;
-  octomap::KeySet* model_cells_set = nullptr;
-  octomap::point3d sensor_origin;
+  moveit::threads::configureCurrentThread("occupancy_map_updater");
+  Batch batch;
   unsigned int batch_size = 0;
 
   while (running_)
   {
     std::unique_lock<std::mutex> ulock(update_cell_sets_lock_);
-    while (occupied_cells_sets_.empty() && running_)
+    while (cell_sets_.empty() && running_)
       update_condition_.wait(ulock);
 
     if (!running_)
@@ -216,50 +313,54 @@ void LazyFreeSpaceUpdater::lazyUpdateThread()
 
     if (batch_size == 0)
     {
-      occupied_cells_set = new OcTreeKeyCountMap();
-      octomap::KeySet* s = occupied_cells_sets_.front();
-      occupied_cells_sets_.pop_front();
-      for (const octomap::OcTreeKey& it : *s)
-        (*occupied_cells_set)[it]++;
-      delete s;
-      model_cells_set = model_cells_sets_.front();
-      model_cells_sets_.pop_front();
-      sensor_origin = sensor_origins_.front();
-      sensor_origins_.pop_front();
+      CellSets& sets = cell_sets_.front();
+      batch.occupied_cells = new OcTreeKeyCountMap();
+      for (const octomap::OcTreeKey& it : *sets.occupied_cells)
+        (*batch.occupied_cells)[it]++;
+      delete sets.occupied_cells;
+      batch.model_cells = sets.model_cells;
+      batch.sensor_origin = sets.sensor_origin;
+      batch.stamp = sets.stamp;
+      cell_sets_.pop_front();
       batch_size++;
     }
 
-    while (!occupied_cells_sets_.empty())
+    while (!cell_sets_.empty())
     {
-      if ((sensor_origins_.front() - sensor_origin).norm() > max_sensor_delta_)
+      CellSets& sets = cell_sets_.front();
+      if ((sets.sensor_origin - batch.sensor_origin).norm() > max_sensor_delta_)
       {
         RCLCPP_DEBUG(LOGGER, "Pushing %u sets of occupied/model cells to free cells update thread (origin changed)",
                      batch_size);
-        pushBatchToProcess(occupied_cells_set, model_cells_set, sensor_origin);
+        pushBatchToProcess(batch);
         batch_size = 0;
         break;
       }
-      sensor_origins_.pop_front();
-
-      octomap::KeySet* add_occ = occupied_cells_sets_.front();
-      for (const octomap::OcTreeKey& it : *add_occ)
-        (*occupied_cells_set)[it]++;
-      occupied_cells_sets_.pop_front();
-      delete add_occ;
-      octomap::KeySet* mod_occ = model_cells_sets_.front();
-      model_cells_set->insert(mod_occ->begin(), mod_occ->end());
-      model_cells_sets_.pop_front();
-      delete mod_occ;
+
+      for (const octomap::OcTreeKey& it : *sets.occupied_cells)
+        (*batch.occupied_cells)[it]++;
+      delete sets.occupied_cells;
+      batch.model_cells->insert(sets.model_cells->begin(), sets.model_cells->end());
+      delete sets.model_cells;
+      cell_sets_.pop_front();
       batch_size++;
     }
 
     if (batch_size >= max_batch_size_)
     {
       RCLCPP_DEBUG(LOGGER, "Pushing %u sets of occupied/model cells to free cells update thread", batch_size);
-      pushBatchToProcess(occupied_cells_set, model_cells_set, sensor_origin);
-      occupied_cells_set = nullptr;
+      pushBatchToProcess(batch);
       batch_size = 0;
     }
+
+    std::scoped_lock _(statistics_lock_);
+    statistics_.queued_sets = cell_sets_.size();
+  }
+
+  if (batch_size > 0)
+  {
+    delete batch.occupied_cells;
+    delete batch.model_cells;
   }
 }
 }  // namespace occupancy_map_monitor
@@ -37,6 +37,9 @@
 #pragma once
 
 #include <moveit/macros/class_forward.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 namespace mesh_filter
 {
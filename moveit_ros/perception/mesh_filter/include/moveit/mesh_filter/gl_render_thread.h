@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/mesh_filter/filter_job.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// forward declarations
+namespace shapes
+{
+class Mesh;
+}
+
+namespace mesh_filter
+{
+MOVEIT_CLASS_FORWARD(GLMesh);          // Defines GLMeshPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(GLRenderThread);  // Defines GLRenderThreadPtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief The thread that holds the OpenGL context of mesh filters and executes their jobs.
+ *
+ * Each mesh filter runs on its own render thread by default. Filters of several cameras can share one, so they render
+ * in the same OpenGL context without switching between threads, and identical meshes are only uploaded once.
+ */
+class GLRenderThread
+{
+public:
+  /** \brief Starts the thread */
+  GLRenderThread();
+
+  /** \brief Cancels the jobs that were not executed yet and joins the thread */
+  ~GLRenderThread();
+
+  /**
+   * \brief Gets the render thread shared by all users of this function in the process. It is created on first use
+   * and stops once no filter uses it anymore.
+   */
+  static GLRenderThreadPtr getShared();
+
+  /** \brief Adds a job to the end of the queue */
+  void addJob(const JobPtr& job);
+
+  /** \brief Adds several jobs to the end of the queue, so no other job is executed in between */
+  void addJobs(const std::vector<JobPtr>& jobs);
+
+  /**
+   * \brief Gets the OpenGL mesh of a mesh with a label, reusing the mesh of another filter if it is identical.
+   * \note Must only be called from a job of this thread
+   * \param[in] mesh the mesh to be uploaded
+   * \param[in] label the label the mesh is rendered with
+   */
+  GLMeshPtr getMesh(const shapes::Mesh& mesh, unsigned int label);
+
+private:
+  /** \brief executes the jobs until the thread is stopped */
+  void run();
+
+  /** \brief The label, vertex and triangle count and a hash of the data of a mesh */
+  using MeshKey = std::tuple<unsigned int, unsigned int, unsigned int, std::uint64_t>;
+
+  /** \brief the meshes uploaded for any filter of this thread */
+  std::map<MeshKey, GLMeshWeakPtr> meshes_;
+
+  /** \brief the thread that holds the OpenGL context */
+  std::thread thread_;
+
+  /** \brief condition variable to notify the thread if a new job arrived */
+  std::condition_variable jobs_condition_;
+
+  /** \brief mutex required for synchronization of condition states */
+  std::mutex jobs_mutex_;
+
+  /** \brief OpenGL job queue that need to be processed by the thread */
+  std::queue<JobPtr> jobs_queue_;
+
+  /** \brief indicates whether the loop should stop */
+  bool stop_;
+};
+}  // namespace mesh_filter
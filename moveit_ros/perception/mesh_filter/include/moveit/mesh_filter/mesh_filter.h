@@ -66,11 +66,13 @@ public:
    * \brief Constructor
    * \author Suat Gedikli (gedikli@willowgarage.com)
    * \param[in] transform_callback Callback function that is called for each mesh to obtain the current transformation.
+   * \param[in] render_thread Thread that holds the OpenGL context, a thread of its own if empty
    * \note the callback expects the mesh handle but no time stamp. Its the users responsibility to return the correct
    * transformation.
    */
   MeshFilter(const TransformCallback& transform_callback = TransformCallback(),
-             const typename SensorType::Parameters& sensor_parameters = typename SensorType::Parameters());
+             const typename SensorType::Parameters& sensor_parameters = typename SensorType::Parameters(),
+             const GLRenderThreadPtr& render_thread = GLRenderThreadPtr());
 
   /**
    * \brief returns the Sensor Parameters
@@ -89,10 +91,11 @@ public:
 
 template <typename SensorType>
 MeshFilter<SensorType>::MeshFilter(const TransformCallback& transform_callback,
-                                   const typename SensorType::Parameters& sensor_parameters)
+                                   const typename SensorType::Parameters& sensor_parameters,
+                                   const GLRenderThreadPtr& render_thread)
   : MeshFilterBase(transform_callback, sensor_parameters, SensorType::RENDER_VERTEX_SHADER_SOURCE,
                    SensorType::RENDER_FRAGMENT_SHADER_SOURCE, SensorType::FILTER_VERTEX_SHADER_SOURCE,
-                   SensorType::FILTER_FRAGMENT_SHADER_SOURCE)
+                   SensorType::FILTER_FRAGMENT_SHADER_SOURCE, render_thread)
 {
 }
 
@@ -39,11 +39,9 @@
 #include <map>
 #include <moveit/macros/class_forward.h>
 #include <moveit/mesh_filter/gl_renderer.h>
+#include <moveit/mesh_filter/gl_render_thread.h>
 #include <moveit/mesh_filter/sensor_model.h>
 #include <Eigen/Geometry>  // for Isometry3d
-#include <queue>
-#include <thread>
-#include <condition_variable>
 #include <mutex>
 
 // forward declarations
@@ -54,9 +52,6 @@ class Mesh;
 
 namespace mesh_filter
 {
-MOVEIT_CLASS_FORWARD(Job);     // Defines JobPtr, ConstPtr, WeakPtr... etc
-MOVEIT_CLASS_FORWARD(GLMesh);  // Defines GLMeshPtr, ConstPtr, WeakPtr... etc
-
 typedef unsigned int MeshHandle;
 typedef uint32_t LabelType;
 
@@ -82,12 +77,15 @@ public:
    * \brief Constructor
    * \author Suat Gedikli (gedikli@willowgarage.com)
    * \param[in] transform_callback Callback function that is called for each mesh to obtain the current transformation.
+   * \param[in] render_thread Thread that holds the OpenGL context, e.g. GLRenderThread::getShared() to share it
+   * with the filters of other cameras. A thread of its own if empty.
    * \note the callback expects the mesh handle but no time stamp. Its the users responsibility to return the correct
    * transformation.
    */
   MeshFilterBase(const TransformCallback& transform_callback, const SensorModel::Parameters& sensor_parameters,
                  const std::string& render_vertex_shader = "", const std::string& render_fragment_shader = "",
-                 const std::string& filter_vertex_shader = "", const std::string& filter_fragment_shader = "");
+                 const std::string& filter_vertex_shader = "", const std::string& filter_fragment_shader = "",
+                 const GLRenderThreadPtr& render_thread = GLRenderThreadPtr());
 
   /** \brief Destructor */
   ~MeshFilterBase();
@@ -192,12 +190,6 @@ protected:
    */
   void deInitialize();
 
-  /**
-   * \brief filtering thread
-   */
-  void run(const std::string& render_vertex_shader, const std::string& render_fragment_shader,
-           const std::string& filter_vertex_shader, const std::string& filter_fragment_shader);
-
   /**
    * \brief the filter method that does the magic
    * \param[in] sensor_data pointer to the buffer containing the depth readings
@@ -219,7 +211,7 @@ protected:
   bool removeMeshHelper(MeshHandle handle);
 
   /**
-   * \brief add a Job for the main thread that needs to be executed there
+   * \brief add a Job for the render thread that needs to be executed there
    * \param[in] job the job object that has the function o be executed
    */
   void addJob(const JobPtr& job) const;
@@ -245,17 +237,8 @@ protected:
    * next_label_) */
   MeshHandle min_handle_;
 
-  /** \brief the filtering thread that also holds the OpenGL context*/
-  std::thread filter_thread_;
-
-  /** \brief condition variable to notify the filtering thread if a new image arrived*/
-  mutable std::condition_variable jobs_condition_;
-
-  /** \brief mutex required for synchronization of condition states*/
-  mutable std::mutex jobs_mutex_;
-
-  /** \brief OpenGL job queue that need to be processed by the worker thread*/
-  mutable std::queue<JobPtr> jobs_queue_;
+  /** \brief the thread that holds the OpenGL context and executes the jobs, possibly shared with other filters*/
+  GLRenderThreadPtr render_thread_;
 
   /** \brief mutex for synchronization of updating filtered meshes */
   mutable std::mutex meshes_mutex_;
@@ -263,9 +246,6 @@ protected:
   /** \brief mutex for synchronization of setting/calling transform_callback_ */
   mutable std::mutex transform_callback_mutex_;
 
-  /** \brief indicates whether the filtering loop should stop*/
-  bool stop_;
-
   /** \brief first pass renderer for rendering the mesh*/
   GLRendererPtr mesh_renderer_;
 
@@ -0,0 +1,151 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/mesh_filter/gl_render_thread.h>
+#include <moveit/mesh_filter/gl_mesh.h>
+
+#include <geometric_shapes/shapes.h>
+
+namespace mesh_filter
+{
+namespace
+{
+// FNV-1a hash of the bytes of an array
+template <typename T>
+void hashArray(const T* data, std::size_t size, std::uint64_t& hash)
+{
+  if (!data)
+    return;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size * sizeof(T); ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+}  // namespace
+
+GLRenderThread::GLRenderThread() : stop_(false)
+{
+  thread_ = std::thread([this] { run(); });
+}
+
+GLRenderThread::~GLRenderThread()
+{
+  {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    stop_ = true;
+    while (!jobs_queue_.empty())
+    {
+      jobs_queue_.front()->cancel();
+      jobs_queue_.pop();
+    }
+  }
+  jobs_condition_.notify_one();
+  thread_.join();
+}
+
+GLRenderThreadPtr GLRenderThread::getShared()
+{
+  static std::mutex shared_mutex;
+  static GLRenderThreadWeakPtr shared;
+  std::unique_lock<std::mutex> _(shared_mutex);
+  GLRenderThreadPtr render_thread = shared.lock();
+  if (!render_thread)
+  {
+    render_thread = std::make_shared<GLRenderThread>();
+    shared = render_thread;
+  }
+  return render_thread;
+}
+
+void GLRenderThread::addJob(const JobPtr& job)
+{
+  {
+    std::unique_lock<std::mutex> _(jobs_mutex_);
+    jobs_queue_.push(job);
+  }
+  jobs_condition_.notify_one();
+}
+
+void GLRenderThread::addJobs(const std::vector<JobPtr>& jobs)
+{
+  {
+    std::unique_lock<std::mutex> _(jobs_mutex_);
+    for (const JobPtr& job : jobs)
+      jobs_queue_.push(job);
+  }
+  jobs_condition_.notify_one();
+}
+
+GLMeshPtr GLRenderThread::getMesh(const shapes::Mesh& mesh, unsigned int label)
+{
+  std::uint64_t hash = 14695981039346656037ull;
+  hashArray(mesh.vertices, 3 * mesh.vertex_count, hash);
+  hashArray(mesh.vertex_normals, 3 * mesh.vertex_count, hash);
+  hashArray(mesh.triangles, 3 * mesh.triangle_count, hash);
+  const MeshKey key(label, mesh.vertex_count, mesh.triangle_count, hash);
+
+  // forget the meshes that no filter uses anymore
+  for (auto it = meshes_.begin(); it != meshes_.end();)
+    it = it->second.expired() ? meshes_.erase(it) : std::next(it);
+
+  GLMeshPtr gl_mesh = meshes_[key].lock();
+  if (!gl_mesh)
+  {
+    gl_mesh = std::make_shared<GLMesh>(mesh, label);
+    meshes_[key] = gl_mesh;
+  }
+  return gl_mesh;
+}
+
+void GLRenderThread::run()
+{
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    // check if we have new jobs to be processed. If not, wait until we get notified.
+    while (jobs_queue_.empty() && !stop_)
+      jobs_condition_.wait(lock);
+    if (stop_)
+      break;
+
+    JobPtr job = jobs_queue_.front();
+    jobs_queue_.pop();
+    lock.unlock();
+    job->execute();
+  }
+}
+}  // namespace mesh_filter
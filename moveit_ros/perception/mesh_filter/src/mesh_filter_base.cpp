@@ -56,20 +56,22 @@ mesh_filter::MeshFilterBase::MeshFilterBase(const TransformCallback& transform_c
                                             const std::string& render_vertex_shader,
                                             const std::string& render_fragment_shader,
                                             const std::string& filter_vertex_shader,
-                                            const std::string& filter_fragment_shader)
+                                            const std::string& filter_fragment_shader,
+                                            const GLRenderThreadPtr& render_thread)
   : sensor_parameters_(sensor_parameters.clone())
   , next_handle_(FIRST_LABEL)  // 0 and 1 are reserved!
   , min_handle_(FIRST_LABEL)
-  , stop_(false)
+  , render_thread_(render_thread ? render_thread : std::make_shared<GLRenderThread>())
   , transform_callback_(transform_callback)
   , padding_scale_(1.0)
   , padding_offset_(0.01)
   , shadow_threshold_(0.5)
 {
-  filter_thread_ =
-      std::thread([this, render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader] {
-        run(render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader);
-      });
+  // the jobs of the thread are executed in order, so later jobs find the renderers initialized
+  addJob(std::make_shared<FilterJob<void>>(
+      [this, render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader] {
+        initialize(render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader);
+      }));
 }
 
 void mesh_filter::MeshFilterBase::initialize(const std::string& render_vertex_shader,
@@ -122,26 +124,15 @@ void mesh_filter::MeshFilterBase::initialize(const std::string& render_vertex_sh
 
 mesh_filter::MeshFilterBase::~MeshFilterBase()
 {
-  {
-    std::unique_lock<std::mutex> lock(jobs_mutex_);
-    stop_ = true;
-    while (!jobs_queue_.empty())
-    {
-      jobs_queue_.front()->cancel();
-      jobs_queue_.pop();
-    }
-  }
-  jobs_condition_.notify_one();
-  filter_thread_.join();
+  // the OpenGL resources of this filter are released in the context they were created in, after its pending jobs
+  JobPtr job = std::make_shared<FilterJob<void>>([this] { deInitialize(); });
+  addJob(job);
+  job->wait();
 }
 
 void mesh_filter::MeshFilterBase::addJob(const JobPtr& job) const
 {
-  {
-    std::unique_lock<std::mutex> _(jobs_mutex_);
-    jobs_queue_.push(job);
-  }
-  jobs_condition_.notify_one();
+  render_thread_->addJob(job);
 }
 
 void mesh_filter::MeshFilterBase::deInitialize()
@@ -190,7 +181,7 @@ mesh_filter::MeshHandle mesh_filter::MeshFilterBase::addMesh(const shapes::Mesh&
 
 void mesh_filter::MeshFilterBase::addMeshHelper(MeshHandle handle, const shapes::Mesh& cmesh)
 {
-  meshes_[handle] = std::make_shared<GLMesh>(cmesh, handle);
+  meshes_[handle] = render_thread_->getMesh(cmesh, handle);
 }
 
 void mesh_filter::MeshFilterBase::removeMesh(MeshHandle handle)
@@ -231,12 +222,7 @@ void mesh_filter::MeshFilterBase::getModelDepth(float* depth) const
       std::make_shared<FilterJob<void>>([&renderer = *mesh_renderer_, depth] { renderer.getDepthBuffer(depth); });
   JobPtr job2 = std::make_shared<FilterJob<void>>(
       [&parameters = *sensor_parameters_, depth] { parameters.transformModelDepthToMetricDepth(depth); });
-  {
-    std::unique_lock<std::mutex> lock(jobs_mutex_);
-    jobs_queue_.push(job1);
-    jobs_queue_.push(job2);
-  }
-  jobs_condition_.notify_one();
+  render_thread_->addJobs({ job1, job2 });
   job1->wait();
   job2->wait();
 }
@@ -246,12 +232,7 @@ void mesh_filter::MeshFilterBase::getFilteredDepth(float* depth) const
   JobPtr job1 = std::make_shared<FilterJob<void>>([&filter = *depth_filter_, depth] { filter.getDepthBuffer(depth); });
   JobPtr job2 = std::make_shared<FilterJob<void>>(
       [&parameters = *sensor_parameters_, depth] { parameters.transformFilteredDepthToMetricDepth(depth); });
-  {
-    std::unique_lock<std::mutex> lock(jobs_mutex_);
-    jobs_queue_.push(job1);
-    jobs_queue_.push(job2);
-  }
-  jobs_condition_.notify_one();
+  render_thread_->addJobs({ job1, job2 });
   job1->wait();
   job2->wait();
 }
@@ -264,32 +245,6 @@ void mesh_filter::MeshFilterBase::getFilteredLabels(LabelType* labels) const
   job->wait();
 }
 
-void mesh_filter::MeshFilterBase::run(const std::string& render_vertex_shader,
-                                      const std::string& render_fragment_shader,
-                                      const std::string& filter_vertex_shader,
-                                      const std::string& filter_fragment_shader)
-{
-  initialize(render_vertex_shader, render_fragment_shader, filter_vertex_shader, filter_fragment_shader);
-
-  while (!stop_)
-  {
-    std::unique_lock<std::mutex> lock(jobs_mutex_);
-    // check if we have new sensor data to be processed. If not, wait until we get notified.
-    if (jobs_queue_.empty())
-      jobs_condition_.wait(lock);
-
-    if (!jobs_queue_.empty())
-    {
-      JobPtr job = jobs_queue_.front();
-      jobs_queue_.pop();
-      lock.unlock();
-      job->execute();
-      lock.lock();
-    }
-  }
-  deInitialize();
-}
-
 void mesh_filter::MeshFilterBase::filter(const void* sensor_data, GLushort type, bool wait) const
 {
   if (type != GL_FLOAT && type != GL_UNSIGNED_SHORT)
@@ -0,0 +1,423 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Replays recorded point clouds and depth images through the octomap updaters and the self filter, as fast as
+ * possible and without subscriptions, and reports their throughput, the update latency and how long readers of the
+ * octomap wait for the lock.
+ *
+ * Parameters:
+ *   bag                      Path of the rosbag2 recording. Its /tf and /tf_static messages are used to place the
+ *                            robot links. The octomap is built in the frame of the sensor data
+ *   octomap_resolution       Resolution of the octomap (default 0.025)
+ *   max_messages             Maximum number of sensor messages to replay per sensor, 0 for all (default 0)
+ *   point_cloud.*            Configuration of the PointCloudOctomapUpdater, as in sensors_3d.yaml. Its
+ *                            point_cloud_topic is replayed from the bag
+ *   depth_image.*            Configuration of the DepthImageOctomapUpdater, as in sensors_3d.yaml. Its image_topic
+ *                            and the matching camera_info topic are replayed from the bag
+ *   robot_description        If set, the collision geometry of the robot is filtered from the sensor data */
+
+#include <moveit/collision_detection/occupancy_map.h>
+#include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
+#include <moveit/point_containment_filter/shape_mask.h>
+#include <moveit/pointcloud_octomap_updater/pointcloud_octomap_updater.h>
+#include <moveit/robot_model/robot_model.h>
+#ifdef MOVEIT_PERCEPTION_BENCHMARK_DEPTH
+#include <moveit/depth_image_octomap_updater/depth_image_octomap_updater.h>
+#include <image_transport/camera_common.hpp>
+#endif
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp/serialization.hpp>
+#include <rosbag2_cpp/reader.hpp>
+#include <sensor_msgs/msg/camera_info.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <tf2_eigen/tf2_eigen.hpp>
+#include <tf2_msgs/msg/tf_message.hpp>
+#include <tf2_ros/buffer.h>
+#include <urdf_parser/urdf_parser.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <thread>
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.perception_benchmark");
+
+namespace
+{
+/** \brief A collision shape of a robot link, to be filtered from the sensor data */
+struct LinkShape
+{
+  std::string link;
+  shapes::ShapeConstPtr shape;
+  Eigen::Isometry3d origin;
+};
+
+/** \brief The sensor data and transforms of a recording */
+struct Recording
+{
+  std::vector<sensor_msgs::msg::PointCloud2::ConstSharedPtr> clouds;
+  std::vector<std::pair<sensor_msgs::msg::Image::ConstSharedPtr, sensor_msgs::msg::CameraInfo::ConstSharedPtr>>
+      depth_images;
+};
+
+template <typename MessageT>
+std::shared_ptr<MessageT> deserialize(const rosbag2_storage::SerializedBagMessage& bag_message)
+{
+  static rclcpp::Serialization<MessageT> serialization;
+  rclcpp::SerializedMessage serialized(*bag_message.serialized_data);
+  auto message = std::make_shared<MessageT>();
+  serialization.deserialize_message(&serialized, message.get());
+  return message;
+}
+
+/** \brief Read the sensor messages of the given topics and all transforms of the bag into memory */
+bool readRecording(const std::string& bag, const std::string& cloud_topic, const std::string& image_topic,
+                   const std::string& info_topic, std::size_t max_messages, tf2_ros::Buffer& tf_buffer,
+                   Recording& recording)
+{
+  rosbag2_cpp::Reader reader;
+  try
+  {
+    reader.open(bag);
+  }
+  catch (const std::exception& ex)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to open bag '%s': %s", bag.c_str(), ex.what());
+    return false;
+  }
+
+  const auto below_limit = [max_messages](std::size_t count) { return max_messages == 0 || count < max_messages; };
+  sensor_msgs::msg::CameraInfo::ConstSharedPtr last_info;
+  while (reader.has_next())
+  {
+    const std::shared_ptr<rosbag2_storage::SerializedBagMessage> bag_message = reader.read_next();
+    const std::string& topic = bag_message->topic_name;
+    if (topic == "/tf" || topic == "/tf_static")
+    {
+      for (const geometry_msgs::msg::TransformStamped& transform :
+           deserialize<tf2_msgs::msg::TFMessage>(*bag_message)->transforms)
+        tf_buffer.setTransform(transform, "bag", topic == "/tf_static");
+    }
+    else if (!cloud_topic.empty() && topic == cloud_topic && below_limit(recording.clouds.size()))
+      recording.clouds.push_back(deserialize<sensor_msgs::msg::PointCloud2>(*bag_message));
+    else if (!info_topic.empty() && topic == info_topic)
+      last_info = deserialize<sensor_msgs::msg::CameraInfo>(*bag_message);
+    else if (!image_topic.empty() && topic == image_topic && last_info && below_limit(recording.depth_images.size()))
+      recording.depth_images.emplace_back(deserialize<sensor_msgs::msg::Image>(*bag_message), last_info);
+  }
+  return true;
+}
+
+/** \brief Load the collision shapes of all robot links from robot_description, if it is set */
+std::vector<LinkShape> loadLinkShapes(const rclcpp::Node::SharedPtr& node)
+{
+  std::vector<LinkShape> link_shapes;
+  std::string robot_description;
+  if (!node->get_parameter("robot_description", robot_description) || robot_description.empty())
+    return link_shapes;
+
+  const urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(robot_description);
+  if (!urdf_model)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to parse robot_description, the robot is not filtered");
+    return link_shapes;
+  }
+  const auto srdf_model = std::make_shared<srdf::Model>();
+  const moveit::core::RobotModel robot_model(urdf_model, srdf_model);
+  for (const moveit::core::LinkModel* link : robot_model.getLinkModelsWithCollisionGeometry())
+  {
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      link_shapes.push_back({ link->getName(), link->getShapes()[i], link->getCollisionOriginTransforms()[i] });
+  }
+  return link_shapes;
+}
+
+/** \brief Look up the transform at \e stamp, or the latest one if the recording does not cover \e stamp */
+bool lookupTransform(const tf2_ros::Buffer& tf_buffer, const std::string& target, const std::string& source,
+                     const rclcpp::Time& stamp, Eigen::Isometry3d& transform)
+{
+  try
+  {
+    transform = tf2::transformToEigen(tf_buffer.lookupTransform(target, source, tf2_ros::fromRclcpp(stamp)));
+    return true;
+  }
+  catch (tf2::TransformException&)
+  {
+  }
+  try
+  {
+    transform = tf2::transformToEigen(tf_buffer.lookupTransform(target, source, tf2::TimePointZero));
+    return true;
+  }
+  catch (tf2::TransformException& ex)
+  {
+    RCLCPP_WARN_ONCE(LOGGER, "%s", ex.what());
+    return false;
+  }
+}
+
+/** \brief Repeatedly lock the octomap for reading, like a planner, and record how long each lock takes to acquire */
+class LockWaitRecorder
+{
+public:
+  explicit LockWaitRecorder(const collision_detection::OccMapTreePtr& tree)
+    : tree_(tree), thread_([this] { run(); })
+  {
+  }
+
+  ~LockWaitRecorder()
+  {
+    stop();
+  }
+
+  std::vector<double> stop()
+  {
+    running_ = false;
+    if (thread_.joinable())
+      thread_.join();
+    return waits_;
+  }
+
+private:
+  void run()
+  {
+    while (running_)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      tree_->lockRead();
+      waits_.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      tree_->unlockRead();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  collision_detection::OccMapTreePtr tree_;
+  std::atomic<bool> running_{ true };
+  std::vector<double> waits_;
+  std::thread thread_;
+};
+
+void report(const std::string& name, std::vector<double> values, double scale, const std::string& unit)
+{
+  if (values.empty())
+    return;
+  std::sort(values.begin(), values.end());
+  const auto at = [&values](double p) { return values[static_cast<std::size_t>(p * (values.size() - 1) + 0.5)]; };
+  const double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  RCLCPP_INFO(LOGGER, "%-36s n %6zu  mean %10.3f  median %10.3f  p95 %10.3f  max %10.3f %s", name.c_str(),
+              values.size(), scale * mean, scale * at(0.5), scale * at(0.95), scale * values.back(), unit.c_str());
+}
+
+/** \brief Time \e integrate for each message, while another thread measures the lock waits of octomap readers */
+template <typename MessageT, typename IntegrateFn, typename PointCountFn>
+void benchmarkUpdater(const std::string& name, const std::vector<MessageT>& messages,
+                      occupancy_map_monitor::OccupancyMapMonitor& monitor, const IntegrateFn& integrate,
+                      const PointCountFn& point_count)
+{
+  std::vector<double> latencies;
+  std::size_t points = 0;
+  LockWaitRecorder lock_waits(monitor.getOcTreePtr());
+  for (const MessageT& message : messages)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    integrate(message);
+    latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    points += point_count(message);
+  }
+  const std::vector<double> waits = lock_waits.stop();
+
+  const double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+  RCLCPP_INFO(LOGGER, "%s: %zu messages, %.0f points per second", name.c_str(), messages.size(),
+              total > 0.0 ? points / total : 0.0);
+  report(name + " update latency", latencies, 1e3, "ms");
+  report(name + " reader lock wait", waits, 1e3, "ms");
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  rclcpp::NodeOptions node_options;
+  node_options.allow_undeclared_parameters(true);
+  node_options.automatically_declare_parameters_from_overrides(true);
+  auto node = rclcpp::Node::make_shared("moveit_perception_benchmark", node_options);
+
+  const std::string bag = node->get_parameter_or<std::string>("bag", "");
+  const std::string cloud_topic = node->get_parameter_or<std::string>("point_cloud.point_cloud_topic", "");
+  const std::string image_topic = node->get_parameter_or<std::string>("depth_image.image_topic", "");
+  const auto max_messages = static_cast<std::size_t>(node->get_parameter_or<int>("max_messages", 0));
+  std::string info_topic;
+#ifdef MOVEIT_PERCEPTION_BENCHMARK_DEPTH
+  if (!image_topic.empty())
+    info_topic = image_transport::getCameraInfoTopic(image_topic);
+#else
+  if (!image_topic.empty())
+    RCLCPP_WARN(LOGGER, "Built without OpenGL, depth images are not replayed");
+#endif
+
+  // The transform cache covers the whole recording, so lookups do not depend on the replay time
+  auto tf_buffer = std::make_shared<tf2_ros::Buffer>(node->get_clock(), tf2::Duration(std::chrono::hours(24)));
+  Recording recording;
+  if (bag.empty() || !readRecording(bag, cloud_topic, image_topic, info_topic, max_messages, *tf_buffer, recording))
+  {
+    RCLCPP_ERROR(LOGGER, "A recording needs to be specified with the parameter 'bag'");
+    return 1;
+  }
+
+  const double resolution = node->get_parameter_or<double>("octomap_resolution", 0.025);
+
+  // The robot links are excluded with their transforms from the recording, in the frame of the sensor data
+  const std::vector<LinkShape> link_shapes = loadLinkShapes(node);
+  const auto shape_transforms = [&](const std::string& frame, const rclcpp::Time& stamp,
+                                    const std::vector<occupancy_map_monitor::ShapeHandle>& handles,
+                                    occupancy_map_monitor::ShapeTransformCache& cache) {
+    for (std::size_t i = 0; i < link_shapes.size(); ++i)
+    {
+      Eigen::Isometry3d transform;
+      if (!lookupTransform(*tf_buffer, frame, link_shapes[i].link, stamp, transform))
+        return false;
+      cache[handles[i]] = transform * link_shapes[i].origin;
+    }
+    return true;
+  };
+
+  std::size_t replayed = 0;
+  if (!recording.clouds.empty())
+  {
+    occupancy_map_monitor::OccupancyMapMonitor monitor(node, tf_buffer, recording.clouds.front()->header.frame_id,
+                                                       resolution);
+    auto updater = std::make_shared<occupancy_map_monitor::PointCloudOctomapUpdater>();
+    updater->setMonitor(&monitor);
+    updater->initialize(node);
+    if (!updater->setParams("point_cloud"))
+    {
+      RCLCPP_ERROR(LOGGER, "The configuration of the point cloud updater in 'point_cloud' is incomplete");
+      return 1;
+    }
+    monitor.addUpdater(updater);
+    std::vector<occupancy_map_monitor::ShapeHandle> handles;
+    for (const LinkShape& link_shape : link_shapes)
+      handles.push_back(monitor.excludeShape(link_shape.shape));
+    monitor.setTransformCacheCallback(
+        [&](const std::string& frame, const rclcpp::Time& stamp, occupancy_map_monitor::ShapeTransformCache& cache) {
+          return shape_transforms(frame, stamp, handles, cache);
+        });
+
+    const auto cloud_points = [](const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud) {
+      return static_cast<std::size_t>(cloud->width) * cloud->height;
+    };
+    benchmarkUpdater(
+        "PointCloudOctomapUpdater", recording.clouds, monitor,
+        [&updater](const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud) { updater->cloudMsgCallback(cloud); },
+        cloud_points);
+
+    // The self filter on its own, with the same shapes as the updater
+    point_containment_filter::ShapeMask shape_mask;
+    shape_mask.setNumThreads(static_cast<unsigned int>(node->get_parameter_or<int>("point_cloud.num_threads", 1)));
+    std::vector<occupancy_map_monitor::ShapeHandle> mask_handles;
+    const double padding_scale = node->get_parameter_or<double>("point_cloud.padding_scale", 1.0);
+    const double padding_offset = node->get_parameter_or<double>("point_cloud.padding_offset", 0.0);
+    for (const LinkShape& link_shape : link_shapes)
+      mask_handles.push_back(shape_mask.addShape(link_shape.shape, padding_scale, padding_offset));
+    std::vector<double> mask_latencies;
+    std::size_t mask_points = 0;
+    std::vector<int> mask;
+    for (const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud : recording.clouds)
+    {
+      occupancy_map_monitor::ShapeTransformCache cache;
+      if (!shape_transforms(cloud->header.frame_id, cloud->header.stamp, mask_handles, cache))
+        continue;
+      shape_mask.setTransformCallback([&cache](point_containment_filter::ShapeHandle handle, Eigen::Isometry3d& tf) {
+        const auto it = cache.find(handle);
+        if (it == cache.end())
+          return false;
+        tf = it->second;
+        return true;
+      });
+      const auto start = std::chrono::steady_clock::now();
+      shape_mask.maskContainment(*cloud, Eigen::Vector3d::Zero(), 0.0,
+                                 node->get_parameter_or<double>("point_cloud.max_range", 5.0), mask);
+      mask_latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      mask_points += cloud_points(cloud);
+    }
+    const double mask_total = std::accumulate(mask_latencies.begin(), mask_latencies.end(), 0.0);
+    RCLCPP_INFO(LOGGER, "ShapeMask: %zu shapes, %.0f points per second", link_shapes.size(),
+                mask_total > 0.0 ? mask_points / mask_total : 0.0);
+    report("ShapeMask latency", mask_latencies, 1e3, "ms");
+    replayed += recording.clouds.size();
+  }
+
+#ifdef MOVEIT_PERCEPTION_BENCHMARK_DEPTH
+  if (!recording.depth_images.empty())
+  {
+    occupancy_map_monitor::OccupancyMapMonitor monitor(
+        node, tf_buffer, recording.depth_images.front().first->header.frame_id, resolution);
+    auto updater = std::make_shared<occupancy_map_monitor::DepthImageOctomapUpdater>();
+    updater->setMonitor(&monitor);
+    updater->initialize(node);
+    if (!updater->setParams("depth_image"))
+    {
+      RCLCPP_ERROR(LOGGER, "The configuration of the depth image updater in 'depth_image' is incomplete");
+      return 1;
+    }
+    monitor.addUpdater(updater);
+    std::vector<occupancy_map_monitor::ShapeHandle> handles;
+    for (const LinkShape& link_shape : link_shapes)
+      handles.push_back(monitor.excludeShape(link_shape.shape));
+    monitor.setTransformCacheCallback(
+        [&](const std::string& frame, const rclcpp::Time& stamp, occupancy_map_monitor::ShapeTransformCache& cache) {
+          return shape_transforms(frame, stamp, handles, cache);
+        });
+
+    using DepthMessage =
+        std::pair<sensor_msgs::msg::Image::ConstSharedPtr, sensor_msgs::msg::CameraInfo::ConstSharedPtr>;
+    benchmarkUpdater(
+        "DepthImageOctomapUpdater", recording.depth_images, monitor,
+        [&updater](const DepthMessage& message) { updater->depthImageCallback(message.first, message.second); },
+        [](const DepthMessage& message) {
+          return static_cast<std::size_t>(message.first->width) * message.first->height;
+        });
+    replayed += recording.depth_images.size();
+  }
+#endif
+
+  if (replayed == 0)
+    RCLCPP_ERROR(LOGGER, "No sensor data of the configured topics found in '%s'", bag.c_str());
+
+  rclcpp::shutdown();
+  return replayed > 0 ? 0 : 1;
+}
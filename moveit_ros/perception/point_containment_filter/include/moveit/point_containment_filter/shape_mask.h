@@ -73,6 +73,9 @@ public:
 
   void setTransformCallback(const TransformCallback& transform_callback);
 
+  /** \brief Set the number of threads that compute the containment mask of a pointcloud. Defaults to one */
+  void setNumThreads(unsigned int num_threads);
+
   /** \brief Compute the containment mask (INSIDE or OUTSIDE) for a given pointcloud. If a mask element is INSIDE, the
      point
       is inside the robot. The point is outside if the mask element is OUTSIDE.
@@ -114,6 +117,7 @@ protected:
   };
 
   TransformCallback transform_callback_;
+  unsigned int num_threads_ = 1;
 
   /** \brief Protects, bodies_ and bspheres_. All public methods acquire this mutex for their whole duration. */
   mutable std::mutex shapes_lock_;
@@ -121,9 +125,36 @@ protected:
   std::vector<bodies::BoundingSphere> bspheres_;
 
 private:
+  /** \brief A body posed for the current pointcloud, with the data of its batched containment test */
+  struct PosedBody
+  {
+    const bodies::Body* body;
+    shapes::ShapeType type;
+    Eigen::Matrix3f world_to_body; /*!< Rotation into the frame of the body */
+    Eigen::Vector3f position;
+    Eigen::Vector3f dimensions;    /*!< Scaled and padded half extents (box), radius (sphere), or radius and half
+                                        length (cylinder) */
+    bodies::BoundingSphere bsphere;
+  };
+
   /** \brief Free memory. */
   void freeMemory();
 
+  /** \brief Test a contiguous range of points against a body, setting inside to 1 for the points it contains */
+  static void containsPoints(const PosedBody& posed_body, const float* x, const float* y, const float* z,
+                             std::size_t count, unsigned char* inside);
+
+  /* Buffers of maskContainment(), kept to avoid allocations for every pointcloud. The points within the bounding
+     sphere of the robot are sorted by the cells of a grid, so each cell is tested only against the bodies that
+     overlap it. */
+  std::vector<PosedBody> posed_bodies_;
+  std::vector<int> point_cells_;
+  std::vector<unsigned int> cell_start_;
+  std::vector<std::vector<std::size_t>> cell_bodies_;
+  std::vector<unsigned int> sorted_points_;
+  std::vector<float> sorted_x_, sorted_y_, sorted_z_;
+  std::vector<unsigned char> sorted_inside_;
+
   ShapeHandle next_handle_;
   ShapeHandle min_handle_;
   std::map<ShapeHandle, std::set<SeeShape, SortBodies>::iterator> used_handles_;
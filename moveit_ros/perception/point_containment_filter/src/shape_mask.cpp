@@ -39,6 +39,8 @@
 #include <sensor_msgs/point_cloud2_iterator.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <cmath>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.shape_mask");
 
@@ -115,6 +117,68 @@ void point_containment_filter::ShapeMask::removeShape(ShapeHandle handle)
     RCLCPP_ERROR(LOGGER, "Unable to remove shape handle %u", handle);
 }
 
+void point_containment_filter::ShapeMask::setNumThreads(unsigned int num_threads)
+{
+  std::scoped_lock _(shapes_lock_);
+  num_threads_ = std::max(num_threads, 1u);
+}
+
+void point_containment_filter::ShapeMask::containsPoints(const PosedBody& posed_body, const float* x, const float* y,
+                                                         const float* z, std::size_t count, unsigned char* inside)
+{
+  const Eigen::Matrix3f& r = posed_body.world_to_body;
+  const Eigen::Vector3f& t = posed_body.position;
+  const Eigen::Vector3f& d = posed_body.dimensions;
+  const int n = static_cast<int>(count);
+
+  // the primitive bodies are tested without branches, so the loops are vectorized
+  switch (posed_body.type)
+  {
+    case shapes::BOX:
+#pragma omp simd
+      for (int i = 0; i < n; ++i)
+      {
+        const float dx = x[i] - t.x(), dy = y[i] - t.y(), dz = z[i] - t.z();
+        const float bx = r(0, 0) * dx + r(0, 1) * dy + r(0, 2) * dz;
+        const float by = r(1, 0) * dx + r(1, 1) * dy + r(1, 2) * dz;
+        const float bz = r(2, 0) * dx + r(2, 1) * dy + r(2, 2) * dz;
+        inside[i] |= (std::abs(bx) <= d.x()) & (std::abs(by) <= d.y()) & (std::abs(bz) <= d.z());
+      }
+      break;
+    case shapes::SPHERE:
+    {
+      const float radius_squared = d.x() * d.x();
+#pragma omp simd
+      for (int i = 0; i < n; ++i)
+      {
+        const float dx = x[i] - t.x(), dy = y[i] - t.y(), dz = z[i] - t.z();
+        inside[i] |= (dx * dx + dy * dy + dz * dz <= radius_squared);
+      }
+      break;
+    }
+    case shapes::CYLINDER:
+    {
+      const float radius_squared = d.x() * d.x();
+#pragma omp simd
+      for (int i = 0; i < n; ++i)
+      {
+        const float dx = x[i] - t.x(), dy = y[i] - t.y(), dz = z[i] - t.z();
+        const float bx = r(0, 0) * dx + r(0, 1) * dy + r(0, 2) * dz;
+        const float by = r(1, 0) * dx + r(1, 1) * dy + r(1, 2) * dz;
+        const float bz = r(2, 0) * dx + r(2, 1) * dy + r(2, 2) * dz;
+        inside[i] |= (std::abs(bz) <= d.y()) & (bx * bx + by * by <= radius_squared);
+      }
+      break;
+    }
+    default:
+      // meshes and other bodies are tested one point at a time, after the cheaper bodies had their chance
+      for (int i = 0; i < n; ++i)
+        if (!inside[i])
+          inside[i] = posed_body.body->containsPoint(Eigen::Vector3d(x[i], y[i], z[i]));
+      break;
+  }
+}
+
 void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::msg::PointCloud2& data_in,
                                                           const Eigen::Vector3d& /*sensor_origin*/,
                                                           const double min_sensor_dist, const double max_sensor_dist,
@@ -125,56 +189,147 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::msg
   mask.resize(np);
 
   if (bodies_.empty())
+  {
     std::fill(mask.begin(), mask.end(), static_cast<int>(OUTSIDE));
-  else
+    return;
+  }
+
+  Eigen::Isometry3d tmp;
+  bspheres_.clear();
+  posed_bodies_.clear();
+  for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
   {
-    Eigen::Isometry3d tmp;
-    bspheres_.resize(bodies_.size());
-    std::size_t j = 0;
-    for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
+    if (!transform_callback_(it->handle, tmp))
     {
-      if (!transform_callback_(it->handle, tmp))
-      {
-        if (!it->body)
-          RCLCPP_ERROR_STREAM(LOGGER, "Missing transform for shape with handle " << it->handle << " without a body");
-        else
-          RCLCPP_ERROR_STREAM(LOGGER,
-                              "Missing transform for shape " << it->body->getType() << " with handle " << it->handle);
-      }
+      if (!it->body)
+        RCLCPP_ERROR_STREAM(LOGGER, "Missing transform for shape with handle " << it->handle << " without a body");
       else
-      {
-        it->body->setPose(tmp);
-        it->body->computeBoundingSphere(bspheres_[j++]);
-      }
+        RCLCPP_ERROR_STREAM(LOGGER,
+                            "Missing transform for shape " << it->body->getType() << " with handle " << it->handle);
+      continue;
     }
 
-    // compute a sphere that bounds the entire robot
-    bodies::BoundingSphere bound;
-    bodies::mergeBoundingSpheres(bspheres_, bound);
-    const double radius_squared = bound.radius * bound.radius;
+    it->body->setPose(tmp);
+    PosedBody posed_body;
+    posed_body.body = it->body;
+    posed_body.type = it->body->getType();
+    posed_body.world_to_body = tmp.linear().transpose().cast<float>();
+    posed_body.position = tmp.translation().cast<float>();
+    const std::vector<double> dimensions = it->body->getScaledDimensions();
+    if (posed_body.type == shapes::BOX)
+      posed_body.dimensions = 0.5f * Eigen::Vector3f(dimensions[0], dimensions[1], dimensions[2]);
+    else if (posed_body.type == shapes::SPHERE)
+      posed_body.dimensions = Eigen::Vector3f(dimensions[0], 0.0f, 0.0f);
+    else if (posed_body.type == shapes::CYLINDER)
+      posed_body.dimensions = Eigen::Vector3f(dimensions[0], 0.5 * dimensions[1], 0.0f);
+    it->body->computeBoundingSphere(posed_body.bsphere);
+    bspheres_.push_back(posed_body.bsphere);
+    posed_bodies_.push_back(posed_body);
+  }
+
+  // compute a sphere that bounds the entire robot
+  bodies::BoundingSphere bound;
+  bodies::mergeBoundingSpheres(bspheres_, bound);
+  const double radius_squared = bound.radius * bound.radius;
+
+  // the points within the bounding sphere are binned into a grid over its bounding box
+  constexpr int GRID_SIZE = 16;
+  const Eigen::Vector3d grid_min = bound.center - Eigen::Vector3d::Constant(bound.radius);
+  const double cell_scale = GRID_SIZE / std::max(2.0 * bound.radius, 1e-9);
+  const auto to_cell = [&](double value, int axis) {
+    return std::clamp(static_cast<int>((value - grid_min[axis]) * cell_scale), 0, GRID_SIZE - 1);
+  };
 
-    // we now decide which points we keep
-    sensor_msgs::PointCloud2ConstIterator<float> iter_x(data_in, "x");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_y(data_in, "y");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
+  // we now decide which points we keep
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(data_in, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(data_in, "y");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
 
-    // Cloud iterators are not incremented in the for loop, because of the pragma
-    // Comment out below parallelization as it can result in very high CPU consumption
-    //#pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < static_cast<int>(np); ++i)
+  point_cells_.resize(np);
+  // Cloud iterators are not incremented in the for loop, because of the pragma
+  // Only parallelized on request, as it can result in very high CPU consumption
+#pragma omp parallel for schedule(static) num_threads(num_threads_) if (num_threads_ > 1)
+  for (int i = 0; i < static_cast<int>(np); ++i)
+  {
+    Eigen::Vector3d pt = Eigen::Vector3d(*(iter_x + i), *(iter_y + i), *(iter_z + i));
+    double d = pt.norm();
+    point_cells_[i] = -1;
+    if (d < min_sensor_dist || d > max_sensor_dist)
+      mask[i] = CLIP;
+    else
     {
-      Eigen::Vector3d pt = Eigen::Vector3d(*(iter_x + i), *(iter_y + i), *(iter_z + i));
-      double d = pt.norm();
-      int out = OUTSIDE;
-      if (d < min_sensor_dist || d > max_sensor_dist)
-        out = CLIP;
-      else if ((bound.center - pt).squaredNorm() < radius_squared)
-        for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end() && out == OUTSIDE; ++it)
-          if (it->body->containsPoint(pt))
-            out = INSIDE;
-      mask[i] = out;
+      mask[i] = OUTSIDE;
+      if ((bound.center - pt).squaredNorm() < radius_squared)
+        point_cells_[i] = (to_cell(pt.x(), 0) * GRID_SIZE + to_cell(pt.y(), 1)) * GRID_SIZE + to_cell(pt.z(), 2);
     }
   }
+
+  // sort the coordinates of the candidate points by cell, so the containment tests run over contiguous arrays
+  constexpr int CELL_COUNT = GRID_SIZE * GRID_SIZE * GRID_SIZE;
+  cell_start_.assign(CELL_COUNT + 1, 0);
+  for (int cell : point_cells_)
+    if (cell >= 0)
+      ++cell_start_[cell + 1];
+  for (int cell = 0; cell < CELL_COUNT; ++cell)
+    cell_start_[cell + 1] += cell_start_[cell];
+  const unsigned int candidate_count = cell_start_[CELL_COUNT];
+  if (candidate_count == 0)
+    return;
+
+  sorted_points_.resize(candidate_count);
+  sorted_x_.resize(candidate_count);
+  sorted_y_.resize(candidate_count);
+  sorted_z_.resize(candidate_count);
+  sorted_inside_.assign(candidate_count, 0);
+  {
+    std::vector<unsigned int> next(cell_start_.begin(), cell_start_.end() - 1);
+    for (unsigned int i = 0; i < np; ++i)
+    {
+      const int cell = point_cells_[i];
+      if (cell < 0)
+        continue;
+      const unsigned int k = next[cell]++;
+      sorted_points_[k] = i;
+      sorted_x_[k] = *(iter_x + i);
+      sorted_y_[k] = *(iter_y + i);
+      sorted_z_[k] = *(iter_z + i);
+    }
+  }
+
+  // the bodies that may contain points of each cell, in the order of bodies_
+  cell_bodies_.resize(CELL_COUNT);
+  for (std::vector<std::size_t>& cell : cell_bodies_)
+    cell.clear();
+  for (std::size_t b = 0; b < posed_bodies_.size(); ++b)
+  {
+    const bodies::BoundingSphere& bsphere = posed_bodies_[b].bsphere;
+    int lower[3], upper[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      lower[axis] = to_cell(bsphere.center[axis] - bsphere.radius, axis);
+      upper[axis] = to_cell(bsphere.center[axis] + bsphere.radius, axis);
+    }
+    for (int cx = lower[0]; cx <= upper[0]; ++cx)
+      for (int cy = lower[1]; cy <= upper[1]; ++cy)
+        for (int cz = lower[2]; cz <= upper[2]; ++cz)
+          cell_bodies_[(cx * GRID_SIZE + cy) * GRID_SIZE + cz].push_back(b);
+  }
+
+  // the cells hold disjoint ranges of points, so they are tested in parallel
+#pragma omp parallel for schedule(dynamic, 16) num_threads(num_threads_) if (num_threads_ > 1)
+  for (int cell = 0; cell < CELL_COUNT; ++cell)
+  {
+    const unsigned int begin = cell_start_[cell];
+    const std::size_t count = cell_start_[cell + 1] - begin;
+    if (count == 0)
+      continue;
+    for (std::size_t b : cell_bodies_[cell])
+      containsPoints(posed_bodies_[b], &sorted_x_[begin], &sorted_y_[begin], &sorted_z_[begin], count,
+                     &sorted_inside_[begin]);
+    for (unsigned int k = begin; k < begin + count; ++k)
+      if (sorted_inside_[k])
+        mask[sorted_points_[k]] = INSIDE;
+  }
 }
 
 int point_containment_filter::ShapeMask::getMaskContainment(const Eigen::Vector3d& pt) const
@@ -46,6 +46,7 @@
 #include <moveit/point_containment_filter/shape_mask.h>
 
 #include <memory>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
@@ -63,13 +64,16 @@ public:
   ShapeHandle excludeShape(const shapes::ShapeConstPtr& shape) override;
   void forgetShape(ShapeHandle handle) override;
 
+  /** \brief Integrate a point cloud into the octomap. This is called for every received cloud, and can be called
+      directly to integrate clouds that are not received on the topic, e.g. recorded ones */
+  void cloudMsgCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud_msg);
+
 protected:
   virtual void updateMask(const sensor_msgs::msg::PointCloud2& cloud, const Eigen::Vector3d& sensor_origin,
                           std::vector<int>& mask);
 
 private:
   bool getShapeTransform(ShapeHandle h, Eigen::Isometry3d& transform) const;
-  void cloudMsgCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud_msg);
   void stopHelper();
 
   // TODO: Enable private node for publishing filtered point cloud
@@ -90,6 +94,7 @@ private:
   double max_range_;
   unsigned int point_subsample_;
   double max_update_rate_;
+  unsigned int num_threads_;
   std::string filtered_cloud_topic_;
   std::string ns_;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr filtered_cloud_publisher_;
@@ -97,9 +102,22 @@ private:
   message_filters::Subscriber<sensor_msgs::msg::PointCloud2>* point_cloud_subscriber_;
   tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>* point_cloud_filter_;
 
-  /* used to store all cells in the map which a given ray passes through during raycasting.
-     we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
-  octomap::KeyRay key_ray_;
+  /* cells found by one thread while integrating a cloud. These are cached across clouds because the key ray
+     dynamically pre-allocates a lot of memory in its constructor */
+  struct ThreadCells
+  {
+    octomap::KeySet occupied_cells;
+    octomap::KeySet model_cells;
+    octomap::KeySet clip_cells;
+    octomap::KeySet free_cells;
+    /* used to store all cells in the map which a given ray passes through during raycasting */
+    octomap::KeyRay key_ray;
+    /* valid points in the sensor frame, if the filtered cloud is published */
+    std::vector<float> filtered_points;
+  };
+  std::vector<ThreadCells> thread_cells_;
+  /* end cells of all rays of a cloud */
+  std::vector<octomap::OcTreeKey> ray_end_cells_;
 
   std::unique_ptr<point_containment_filter::ShapeMask> shape_mask_;
   std::vector<int> mask_;
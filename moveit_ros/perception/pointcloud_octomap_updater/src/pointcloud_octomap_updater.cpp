@@ -37,6 +37,7 @@
 #include <cmath>
 #include <moveit/pointcloud_octomap_updater/pointcloud_octomap_updater.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
+#include <moveit/utils/thread_config.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 // TODO: Remove conditional includes when released to all active distros.
 #if __has_include(<tf2/LinearMath/Vector3.hpp>)
@@ -53,8 +54,11 @@
 #include <tf2_ros/create_timer_interface.h>
 #include <tf2_ros/create_timer_ros.h>
 
+#include <algorithm>
 #include <memory>
 
+#include <omp.h>
+
 namespace occupancy_map_monitor
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.pointcloud_octomap_updater");
@@ -65,6 +69,7 @@ PointCloudOctomapUpdater::PointCloudOctomapUpdater()
   , max_range_(std::numeric_limits<double>::infinity())
   , point_subsample_(1)
   , max_update_rate_(0)
+  , num_threads_(1)
   , point_cloud_subscriber_(nullptr)
   , point_cloud_filter_(nullptr)
 {
@@ -77,8 +82,13 @@ PointCloudOctomapUpdater::~PointCloudOctomapUpdater()
 
 bool PointCloudOctomapUpdater::setParams(const std::string& name_space)
 {
-  // This parameter is optional
+  // These parameters are optional
   node_->get_parameter_or(name_space + ".ns", ns_, std::string());
+  int num_threads = 1;
+  node_->get_parameter_or(name_space + ".num_threads", num_threads, 1);
+  num_threads_ = static_cast<unsigned int>(std::max(num_threads, 1));
+  if (shape_mask_)
+    shape_mask_->setNumThreads(num_threads_);
   return node_->get_parameter(name_space + ".point_cloud_topic", point_cloud_topic_) &&
          node_->get_parameter(name_space + ".max_range", max_range_) &&
          node_->get_parameter(name_space + ".padding_offset", padding_) &&
@@ -187,6 +197,7 @@ void PointCloudOctomapUpdater::updateMask(const sensor_msgs::msg::PointCloud2& /
 
 void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::msg::PointCloud2::ConstSharedPtr& cloud_msg)
 {
+  moveit::threads::configureCurrentThread("occupancy_map_updater");
   RCLCPP_DEBUG(LOGGER, "Received a new point cloud message");
   rclcpp::Time start = rclcpp::Clock(RCL_ROS_TIME).now();
 
@@ -237,113 +248,148 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::msg::PointClo
   shape_mask_->maskContainment(*cloud_msg, sensor_origin_eigen, 0.0, max_range_, mask_);
   updateMask(*cloud_msg, sensor_origin_eigen, mask_);
 
-  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
-  std::unique_ptr<sensor_msgs::msg::PointCloud2> filtered_cloud;
-
-  // We only use these iterators if we are creating a filtered_cloud for
-  // publishing. We cannot default construct these, so we use unique_ptr's
-  // to defer construction
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float>> iter_filtered_x;
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float>> iter_filtered_y;
-  std::unique_ptr<sensor_msgs::PointCloud2Iterator<float>> iter_filtered_z;
-
-  if (!filtered_cloud_topic_.empty())
+  thread_cells_.resize(num_threads_);
+  for (ThreadCells& cells : thread_cells_)
   {
-    filtered_cloud = std::make_unique<sensor_msgs::msg::PointCloud2>();
-    filtered_cloud->header = cloud_msg->header;
-    sensor_msgs::PointCloud2Modifier pcd_modifier(*filtered_cloud);
-    pcd_modifier.setPointCloud2FieldsByString(1, "xyz");
-    pcd_modifier.resize(cloud_msg->width * cloud_msg->height);
-
-    // we have created a filtered_out, so we can create the iterators now
-    iter_filtered_x = std::make_unique<sensor_msgs::PointCloud2Iterator<float>>(*filtered_cloud, "x");
-    iter_filtered_y = std::make_unique<sensor_msgs::PointCloud2Iterator<float>>(*filtered_cloud, "y");
-    iter_filtered_z = std::make_unique<sensor_msgs::PointCloud2Iterator<float>>(*filtered_cloud, "z");
+    cells.occupied_cells.clear();
+    cells.model_cells.clear();
+    cells.clip_cells.clear();
+    cells.free_cells.clear();
+    cells.filtered_points.clear();
   }
-  size_t filtered_cloud_size = 0;
+  const bool publish_filtered_cloud = !filtered_cloud_topic_.empty();
+  const int num_rows = static_cast<int>((cloud_msg->height + point_subsample_ - 1) / point_subsample_);
+  bool failed = false;
+
+  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
 
   tree_->lockRead();
 
-  try
+  /* do ray tracing to find which cells this point cloud indicates should be free, and which it indicates
+   * should be occupied. Each thread collects the cells of a contiguous block of rows, so that the filtered
+   * points keep the order of the cloud */
+#pragma omp parallel for schedule(static) num_threads(num_threads_) if (num_threads_ > 1) reduction(|| : failed)
+  for (int row_index = 0; row_index < num_rows; ++row_index)
   {
-    /* do ray tracing to find which cells this point cloud indicates should be free, and which it indicates
-     * should be occupied */
-    for (unsigned int row = 0; row < cloud_msg->height; row += point_subsample_)
+    ThreadCells& cells = thread_cells_[omp_get_thread_num()];
+    try
     {
+      const unsigned int row = row_index * point_subsample_;
       unsigned int row_c = row * cloud_msg->width;
       sensor_msgs::PointCloud2ConstIterator<float> pt_iter(*cloud_msg, "x");
       // set iterator to point at start of the current row
       pt_iter += row_c;
 
+      // Neighboring points of dense clouds mostly fall into the same leaf. Consecutive repetitions of a leaf are
+      // skipped before the more expensive insertion into the hashed key sets
+      octomap::OcTreeKey previous_key;
+      int previous_mask = -1;
+      const auto insert_cell = [&](octomap::KeySet& cell_set, const tf2::Vector3& point_tf, int mask) {
+        const octomap::OcTreeKey key = tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ());
+        if (mask != previous_mask || key != previous_key)
+        {
+          cell_set.insert(key);
+          previous_key = key;
+          previous_mask = mask;
+        }
+      };
+
       for (unsigned int col = 0; col < cloud_msg->width; col += point_subsample_, pt_iter += point_subsample_)
       {
-        // if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
-        //  continue;
-
         /* check for NaN */
         if (!std::isnan(pt_iter[0]) && !std::isnan(pt_iter[1]) && !std::isnan(pt_iter[2]))
         {
           /* occupied cell at ray endpoint if ray is shorter than max range and this point
              isn't on a part of the robot*/
-          if (mask_[row_c + col] == point_containment_filter::ShapeMask::INSIDE)
+          const int mask = mask_[row_c + col];
+          if (mask == point_containment_filter::ShapeMask::INSIDE)
           {
             // transform to map frame
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]);
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            insert_cell(cells.model_cells, map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]), mask);
           }
-          else if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
+          else if (mask == point_containment_filter::ShapeMask::CLIP)
           {
-            tf2::Vector3 clipped_point_tf =
-                map_h_sensor * (tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]).normalize() * max_range_);
-            clip_cells.insert(
-                tree_->coordToKey(clipped_point_tf.getX(), clipped_point_tf.getY(), clipped_point_tf.getZ()));
+            insert_cell(cells.clip_cells,
+                        map_h_sensor * (tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]).normalize() * max_range_),
+                        mask);
           }
           else
           {
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]);
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            insert_cell(cells.occupied_cells, map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]), mask);
             // build list of valid points if we want to publish them
-            if (filtered_cloud)
-            {
-              **iter_filtered_x = pt_iter[0];
-              **iter_filtered_y = pt_iter[1];
-              **iter_filtered_z = pt_iter[2];
-              ++filtered_cloud_size;
-              ++*iter_filtered_x;
-              ++*iter_filtered_y;
-              ++*iter_filtered_z;
-            }
+            if (publish_filtered_cloud)
+              cells.filtered_points.insert(cells.filtered_points.end(), { pt_iter[0], pt_iter[1], pt_iter[2] });
           }
         }
       }
     }
-
-    /* compute the free cells along each ray that ends at an occupied cell */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(occupied_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-
-    /* compute the free cells along each ray that ends at a model cell */
-    for (const octomap::OcTreeKey& model_cell : model_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(model_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-
-    /* compute the free cells along each ray that ends at a clipped cell */
-    for (const octomap::OcTreeKey& clip_cell : clip_cells)
+    catch (...)
     {
-      free_cells.insert(clip_cell);
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(clip_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+      failed = true;
     }
   }
-  catch (...)
+
+  if (failed)
   {
     tree_->unlockRead();
     return;
   }
 
+  /* merge the cells of all threads, so that the ray to each leaf is only cast once, from the sensor to the center
+   * of the leaf. The sets of the first thread are taken over instead of copied */
+  occupied_cells.swap(thread_cells_[0].occupied_cells);
+  model_cells.swap(thread_cells_[0].model_cells);
+  clip_cells.swap(thread_cells_[0].clip_cells);
+  for (std::size_t i = 1; i < thread_cells_.size(); ++i)
+  {
+    occupied_cells.insert(thread_cells_[i].occupied_cells.begin(), thread_cells_[i].occupied_cells.end());
+    model_cells.insert(thread_cells_[i].model_cells.begin(), thread_cells_[i].model_cells.end());
+    clip_cells.insert(thread_cells_[i].clip_cells.begin(), thread_cells_[i].clip_cells.end());
+  }
+
+  /* a leaf may be the end of rays of several kinds, its ray is still only cast once */
+  ray_end_cells_.clear();
+  ray_end_cells_.reserve(occupied_cells.size() + model_cells.size() + clip_cells.size());
+  ray_end_cells_.insert(ray_end_cells_.end(), occupied_cells.begin(), occupied_cells.end());
+  for (const octomap::OcTreeKey& model_cell : model_cells)
+  {
+    if (occupied_cells.find(model_cell) == occupied_cells.end())
+      ray_end_cells_.push_back(model_cell);
+  }
+  for (const octomap::OcTreeKey& clip_cell : clip_cells)
+  {
+    if (occupied_cells.find(clip_cell) == occupied_cells.end() && model_cells.find(clip_cell) == model_cells.end())
+      ray_end_cells_.push_back(clip_cell);
+  }
+  RCLCPP_DEBUG(LOGGER, "Casting %zu rays for a cloud of %u points", ray_end_cells_.size(),
+               cloud_msg->width * cloud_msg->height);
+
+  /* compute the free cells along each ray that ends at an occupied, model or clipped cell */
+  const int num_rays = static_cast<int>(ray_end_cells_.size());
+#pragma omp parallel for schedule(static) num_threads(num_threads_) if (num_threads_ > 1) reduction(|| : failed)
+  for (int ray = 0; ray < num_rays; ++ray)
+  {
+    ThreadCells& cells = thread_cells_[omp_get_thread_num()];
+    try
+    {
+      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(ray_end_cells_[ray]), cells.key_ray))
+        cells.free_cells.insert(cells.key_ray.begin(), cells.key_ray.end());
+    }
+    catch (...)
+    {
+      failed = true;
+    }
+  }
+
   tree_->unlockRead();
 
+  if (failed)
+    return;
+
+  free_cells.insert(clip_cells.begin(), clip_cells.end());
+  for (const ThreadCells& cells : thread_cells_)
+    free_cells.insert(cells.free_cells.begin(), cells.free_cells.end());
+
   /* cells that overlap with the model are not occupied */
   for (const octomap::OcTreeKey& model_cell : model_cells)
     occupied_cells.erase(model_cell);
@@ -377,11 +423,32 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::msg::PointClo
   RCLCPP_DEBUG(LOGGER, "Processed point cloud in %lf ms", (node_->now() - start).seconds() * 1000.0);
   tree_->triggerUpdateCallback();
 
-  if (filtered_cloud)
+  if (publish_filtered_cloud)
   {
-    sensor_msgs::PointCloud2Modifier pcd_modifier(*filtered_cloud);
+    std::size_t filtered_cloud_size = 0;
+    for (const ThreadCells& cells : thread_cells_)
+      filtered_cloud_size += cells.filtered_points.size() / 3;
+
+    sensor_msgs::msg::PointCloud2 filtered_cloud;
+    filtered_cloud.header = cloud_msg->header;
+    sensor_msgs::PointCloud2Modifier pcd_modifier(filtered_cloud);
+    pcd_modifier.setPointCloud2FieldsByString(1, "xyz");
     pcd_modifier.resize(filtered_cloud_size);
-    filtered_cloud_publisher_->publish(*filtered_cloud);
+
+    sensor_msgs::PointCloud2Iterator<float> iter_filtered_x(filtered_cloud, "x");
+    sensor_msgs::PointCloud2Iterator<float> iter_filtered_y(filtered_cloud, "y");
+    sensor_msgs::PointCloud2Iterator<float> iter_filtered_z(filtered_cloud, "z");
+    for (const ThreadCells& cells : thread_cells_)
+    {
+      for (std::size_t i = 0; i < cells.filtered_points.size();
+           i += 3, ++iter_filtered_x, ++iter_filtered_y, ++iter_filtered_z)
+      {
+        *iter_filtered_x = cells.filtered_points[i];
+        *iter_filtered_y = cells.filtered_points[i + 1];
+        *iter_filtered_z = cells.filtered_points[i + 2];
+      }
+    }
+    filtered_cloud_publisher_->publish(filtered_cloud);
   }
 }
 }  // namespace occupancy_map_monitor
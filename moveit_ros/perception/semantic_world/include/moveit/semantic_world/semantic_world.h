@@ -41,7 +41,10 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <object_recognition_msgs/msg/table_array.hpp>
 #include <moveit_msgs/msg/collision_object.hpp>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 namespace shapes
 {
@@ -66,9 +69,14 @@ public:
   /**
    * @brief A (simple) semantic world representation for pick and place and other tasks.
    * Currently this is used only to represent tables.
+   *
+   * Received tables are processed on a worker thread, which also runs the table callback. When several table
+   * messages arrive while one is processed, only the latest one is processed next.
    */
   SemanticWorld(const rclcpp::Node::SharedPtr& node, const planning_scene::PlanningSceneConstPtr& planning_scene);
 
+  ~SemanticWorld();
+
   /**
    * @brief Get all the tables within a region of interest
    */
@@ -105,7 +113,8 @@ public:
    * the given resolution (in meters) in both X and Y directions. The locations are sampled at the
    * specified height above the table (in meters) and then at subsequent additional heights (num_heights
    * times) incremented by delta_height. Locations are only accepted if they are at least min_distance_from_edge
-   * meters from the edge of the table.
+   * meters from the edge of the table. The distances of the grid to the table edge are cached per table and
+   * resolution until the tables are updated.
    */
   std::vector<geometry_msgs::msg::PoseStamped> generatePlacePoses(const object_recognition_msgs::msg::Table& table,
                                                                   double resolution, double height_above_table,
@@ -120,6 +129,7 @@ public:
   visualization_msgs::msg::MarkerArray
   getPlaceLocationsMarker(const std::vector<geometry_msgs::msg::PoseStamped>& poses) const;
 
+  /** @brief Set the callback run on the processing thread after new tables have been received */
   void addTableCallback(const TableCallbackFn& table_callback)
   {
     table_callback_ = table_callback;
@@ -132,6 +142,18 @@ public:
                             double min_distance_from_edge = 0.0, double min_vertical_offset = 0.0) const;
 
 private:
+  /** @brief The contour of a table and the distances of sampling grids to it */
+  struct TableGeometry;
+
+  /** @brief Get the cached geometry of \e table, computing it if needed. Returns nullptr for degenerate tables. */
+  std::shared_ptr<TableGeometry> getTableGeometry(const object_recognition_msgs::msg::Table& table) const;
+
+  /** @brief Get the distances to the table edge of the grid points sampled at \e resolution, in row-major order */
+  const std::vector<double>& getEdgeDistances(TableGeometry& geometry, double resolution) const;
+
+  /** @brief Process the latest received table array on processing_thread_ until destruction */
+  void processTables();
+
   shapes::Mesh* createSolidMeshFromPlanarPolygon(const shapes::Mesh& polygon, double thickness) const;
 
   shapes::Mesh* orientPlanarPolygon(const shapes::Mesh& polygon) const;
@@ -150,6 +172,20 @@ private:
 
   std::map<std::string, object_recognition_msgs::msg::Table> current_tables_in_collision_world_;
 
+  /** @brief Protects table_array_ and current_tables_in_collision_world_ */
+  mutable std::mutex table_lock_;
+
+  /** @brief Geometry of recently used tables, cleared when new tables arrive */
+  mutable std::vector<std::shared_ptr<TableGeometry>> table_geometry_cache_;
+  mutable std::mutex table_geometry_lock_;
+
+  /** @brief The latest table array not yet processed, handed from the subscriber to processing_thread_ */
+  object_recognition_msgs::msg::TableArray::ConstSharedPtr pending_table_array_;
+  bool stop_processing_ = false;
+  std::mutex pending_lock_;
+  std::condition_variable pending_condition_;
+  std::thread processing_thread_;
+
   rclcpp::Subscription<object_recognition_msgs::msg::TableArray>::SharedPtr table_subscriber_;
 
   rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr visualization_publisher_;
@@ -60,6 +60,20 @@ namespace semantic_world
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.perception.semantic_world");
 
+// tables are rasterized with this many pixels per meter for contour computations
+static const int SCALE_FACTOR = 100;
+
+// number of tables whose geometry is cached, to bound the cache for tables not in the collision world
+static const std::size_t MAX_CACHED_TABLES = 32;
+
+struct SemanticWorld::TableGeometry
+{
+  object_recognition_msgs::msg::Table table;
+  float x_min, x_max, y_min, y_max;
+  std::vector<cv::Point> contour;  // in pixels, relative to (x_min, y_min)
+  std::map<double, std::vector<double>> edge_distances;  // per grid resolution
+};
+
 SemanticWorld::SemanticWorld(const rclcpp::Node::SharedPtr& node,
                              const planning_scene::PlanningSceneConstPtr& planning_scene)
   : planning_scene_(planning_scene), node_handle_(node)
@@ -73,6 +87,18 @@ SemanticWorld::SemanticWorld(const rclcpp::Node::SharedPtr& node,
   collision_object_publisher_ =
       node_handle_->create_publisher<moveit_msgs::msg::CollisionObject>("/collision_object", 20);
   planning_scene_diff_publisher_ = node_handle_->create_publisher<moveit_msgs::msg::PlanningScene>("planning_scene", 1);
+  processing_thread_ = std::thread([this] { processTables(); });
+}
+
+SemanticWorld::~SemanticWorld()
+{
+  table_subscriber_.reset();
+  {
+    std::lock_guard<std::mutex> lock(pending_lock_);
+    stop_processing_ = true;
+  }
+  pending_condition_.notify_all();
+  processing_thread_.join();
 }
 
 visualization_msgs::msg::MarkerArray
@@ -107,6 +133,7 @@ bool SemanticWorld::addTablesToCollisionWorld()
 {
   moveit_msgs::msg::PlanningScene planning_scene;
   planning_scene.is_diff = true;
+  std::lock_guard<std::mutex> lock(table_lock_);
 
   // Remove the existing tables
   std::map<std::string, object_recognition_msgs::msg::Table>::iterator it;
@@ -184,6 +211,7 @@ object_recognition_msgs::msg::TableArray SemanticWorld::getTablesInROI(double mi
                                                                        double maxx, double maxy, double maxz) const
 {
   object_recognition_msgs::msg::TableArray tables_in_roi;
+  std::lock_guard<std::mutex> lock(table_lock_);
   std::map<std::string, object_recognition_msgs::msg::Table>::const_iterator it;
   for (it = current_tables_in_collision_world_.begin(); it != current_tables_in_collision_world_.end(); ++it)
   {
@@ -201,6 +229,7 @@ std::vector<std::string> SemanticWorld::getTableNamesInROI(double minx, double m
                                                            double maxy, double maxz) const
 {
   std::vector<std::string> result;
+  std::lock_guard<std::mutex> lock(table_lock_);
   std::map<std::string, object_recognition_msgs::msg::Table>::const_iterator it;
   for (it = current_tables_in_collision_world_.begin(); it != current_tables_in_collision_world_.end(); ++it)
   {
@@ -216,8 +245,13 @@ std::vector<std::string> SemanticWorld::getTableNamesInROI(double minx, double m
 
 void SemanticWorld::clear()
 {
-  table_array_.tables.clear();
-  current_tables_in_collision_world_.clear();
+  {
+    std::lock_guard<std::mutex> lock(table_lock_);
+    table_array_.tables.clear();
+    current_tables_in_collision_world_.clear();
+  }
+  std::lock_guard<std::mutex> lock(table_geometry_lock_);
+  table_geometry_cache_.clear();
 }
 
 std::vector<geometry_msgs::msg::PoseStamped>
@@ -226,15 +260,21 @@ SemanticWorld::generatePlacePoses(const std::string& table_name, const shapes::S
                                   double delta_height, unsigned int num_heights) const
 {
   object_recognition_msgs::msg::Table chosen_table;
-  std::map<std::string, object_recognition_msgs::msg::Table>::const_iterator it =
-      current_tables_in_collision_world_.find(table_name);
-
-  if (it != current_tables_in_collision_world_.end())
+  bool found = false;
   {
-    chosen_table = it->second;
-    return generatePlacePoses(chosen_table, object_shape, object_orientation, resolution, delta_height, num_heights);
+    std::lock_guard<std::mutex> lock(table_lock_);
+    std::map<std::string, object_recognition_msgs::msg::Table>::const_iterator it =
+        current_tables_in_collision_world_.find(table_name);
+    if (it != current_tables_in_collision_world_.end())
+    {
+      chosen_table = it->second;
+      found = true;
+    }
   }
 
+  if (found)
+    return generatePlacePoses(chosen_table, object_shape, object_orientation, resolution, delta_height, num_heights);
+
   std::vector<geometry_msgs::msg::PoseStamped> place_poses;
   RCLCPP_ERROR(LOGGER, "Did not find table %s to place on", table_name.c_str());
   return place_poses;
@@ -323,86 +363,61 @@ SemanticWorld::generatePlacePoses(const object_recognition_msgs::msg::Table& tab
 {
   std::vector<geometry_msgs::msg::PoseStamped> place_poses;
   // Assumption that the table's normal is along the Z axis
-  if (table.convex_hull.empty())
+  const std::shared_ptr<TableGeometry> geometry = getTableGeometry(table);
+  if (!geometry)
     return place_poses;
-  const int scale_factor = 100;
-  std::vector<cv::Point2f> table_contour;
-  float x_min = table.convex_hull[0].x, x_max = x_min, y_min = table.convex_hull[0].y, y_max = y_min;
-  for (std::size_t j = 1; j < table.convex_hull.size(); ++j)
-  {
-    if (table.convex_hull[j].x < x_min)
-      x_min = table.convex_hull[j].x;
-    else if (table.convex_hull[j].x > x_max)
-      x_max = table.convex_hull[j].x;
-    if (table.convex_hull[j].y < y_min)
-      y_min = table.convex_hull[j].y;
-    else if (table.convex_hull[j].y > y_max)
-      y_max = table.convex_hull[j].y;
-  }
-  for (const geometry_msgs::msg::Point& vertex : table.convex_hull)
-    table_contour.push_back(cv::Point((vertex.x - x_min) * scale_factor, (vertex.y - y_min) * scale_factor));
 
-  double x_range = fabs(x_max - x_min);
-  double y_range = fabs(y_max - y_min);
-  int max_range = static_cast<int>(x_range) + 1;
-  if (max_range < static_cast<int>(y_range) + 1)
-    max_range = static_cast<int>(y_range) + 1;
-
-  int image_scale = std::max<int>(max_range, 4);
-  cv::Mat src = cv::Mat::zeros(image_scale * scale_factor, image_scale * scale_factor, CV_8UC1);
-
-  for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
-  {
-    cv::line(src, table_contour[j], table_contour[(j + 1) % table.convex_hull.size()], cv::Scalar(255), 3, 8);
-  }
-
-  unsigned int num_x = fabs(x_max - x_min) / resolution + 1;
-  unsigned int num_y = fabs(y_max - y_min) / resolution + 1;
+  unsigned int num_x = fabs(geometry->x_max - geometry->x_min) / resolution + 1;
+  unsigned int num_y = fabs(geometry->y_max - geometry->y_min) / resolution + 1;
 
   RCLCPP_DEBUG(LOGGER, "Num points for possible place operations: %d %d", num_x, num_y);
 
-  std::vector<std::vector<cv::Point> > contours;
-  std::vector<cv::Vec4i> hierarchy;
-  cv::findContours(src, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+  const std::vector<double>& edge_distances = getEdgeDistances(*geometry, resolution);
+  Eigen::Isometry3d pose;
+  tf2::fromMsg(table.pose, pose);
 
   for (std::size_t j = 0; j < num_x; ++j)
   {
-    int point_x = j * resolution * scale_factor;
+    int point_x = j * resolution * SCALE_FACTOR;
     for (std::size_t k = 0; k < num_y; ++k)
     {
+      int point_y = k * resolution * SCALE_FACTOR;
+      double result = edge_distances[j * num_y + k];
+      if (static_cast<int>(result) < static_cast<int>(min_distance_from_edge * SCALE_FACTOR))
+        continue;
       for (std::size_t mm = 0; mm < num_heights; ++mm)
       {
-        int point_y = k * resolution * scale_factor;
-        cv::Point2f point2f(point_x, point_y);
-        double result = cv::pointPolygonTest(contours[0], point2f, true);
-        if (static_cast<int>(result) >= static_cast<int>(min_distance_from_edge * scale_factor))
-        {
-          Eigen::Vector3d point((double)(point_x) / scale_factor + x_min, (double)(point_y) / scale_factor + y_min,
-                                height_above_table + mm * delta_height);
-          Eigen::Isometry3d pose;
-          tf2::fromMsg(table.pose, pose);
-          point = pose * point;
-          geometry_msgs::msg::PoseStamped place_pose;
-          place_pose.pose.orientation.w = 1.0;
-          place_pose.pose.position.x = point.x();
-          place_pose.pose.position.y = point.y();
-          place_pose.pose.position.z = point.z();
-          place_pose.header = table.header;
-          place_poses.push_back(place_pose);
-        }
+        Eigen::Vector3d point((double)(point_x) / SCALE_FACTOR + geometry->x_min,
+                              (double)(point_y) / SCALE_FACTOR + geometry->y_min,
+                              height_above_table + mm * delta_height);
+        point = pose * point;
+        geometry_msgs::msg::PoseStamped place_pose;
+        place_pose.pose.orientation.w = 1.0;
+        place_pose.pose.position.x = point.x();
+        place_pose.pose.position.y = point.y();
+        place_pose.pose.position.z = point.z();
+        place_pose.header = table.header;
+        place_poses.push_back(place_pose);
       }
     }
   }
   return place_poses;
 }
 
-bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
-                                         const object_recognition_msgs::msg::Table& table,
-                                         double min_distance_from_edge, double min_vertical_offset) const
+std::shared_ptr<SemanticWorld::TableGeometry>
+SemanticWorld::getTableGeometry(const object_recognition_msgs::msg::Table& table) const
 {
-  // Assumption that the table's normal is along the Z axis
   if (table.convex_hull.empty())
-    return false;
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(table_geometry_lock_);
+  for (const std::shared_ptr<TableGeometry>& geometry : table_geometry_cache_)
+  {
+    if (geometry->table == table)
+      return geometry;
+  }
+
+  auto geometry = std::make_shared<TableGeometry>();
   float x_min = table.convex_hull[0].x, x_max = x_min, y_min = table.convex_hull[0].y, y_max = y_min;
   for (std::size_t j = 1; j < table.convex_hull.size(); ++j)
   {
@@ -415,10 +430,9 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
     else if (table.convex_hull[j].y > y_max)
       y_max = table.convex_hull[j].y;
   }
-  const int scale_factor = 100;
   std::vector<cv::Point2f> table_contour;
   for (const geometry_msgs::msg::Point& vertex : table.convex_hull)
-    table_contour.push_back(cv::Point((vertex.x - x_min) * scale_factor, (vertex.y - y_min) * scale_factor));
+    table_contour.push_back(cv::Point((vertex.x - x_min) * SCALE_FACTOR, (vertex.y - y_min) * SCALE_FACTOR));
 
   double x_range = fabs(x_max - x_min);
   double y_range = fabs(y_max - y_min);
@@ -427,7 +441,7 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
     max_range = static_cast<int>(y_range) + 1;
 
   int image_scale = std::max<int>(max_range, 4);
-  cv::Mat src = cv::Mat::zeros(image_scale * scale_factor, image_scale * scale_factor, CV_8UC1);
+  cv::Mat src = cv::Mat::zeros(image_scale * SCALE_FACTOR, image_scale * SCALE_FACTOR, CV_8UC1);
 
   for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
   {
@@ -437,6 +451,55 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
   std::vector<std::vector<cv::Point> > contours;
   std::vector<cv::Vec4i> hierarchy;
   cv::findContours(src, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+  if (contours.empty())
+    return nullptr;
+
+  geometry->table = table;
+  geometry->x_min = x_min;
+  geometry->x_max = x_max;
+  geometry->y_min = y_min;
+  geometry->y_max = y_max;
+  geometry->contour = std::move(contours[0]);
+
+  if (table_geometry_cache_.size() >= MAX_CACHED_TABLES)
+    table_geometry_cache_.erase(table_geometry_cache_.begin());
+  table_geometry_cache_.push_back(geometry);
+  return geometry;
+}
+
+const std::vector<double>& SemanticWorld::getEdgeDistances(TableGeometry& geometry, double resolution) const
+{
+  std::lock_guard<std::mutex> lock(table_geometry_lock_);
+  std::map<double, std::vector<double>>::const_iterator it = geometry.edge_distances.find(resolution);
+  if (it != geometry.edge_distances.end())
+    return it->second;
+
+  unsigned int num_x = fabs(geometry.x_max - geometry.x_min) / resolution + 1;
+  unsigned int num_y = fabs(geometry.y_max - geometry.y_min) / resolution + 1;
+  std::vector<double> edge_distances;
+  edge_distances.reserve(num_x * num_y);
+  for (std::size_t j = 0; j < num_x; ++j)
+  {
+    int point_x = j * resolution * SCALE_FACTOR;
+    for (std::size_t k = 0; k < num_y; ++k)
+    {
+      int point_y = k * resolution * SCALE_FACTOR;
+      cv::Point2f point2f(point_x, point_y);
+      edge_distances.push_back(cv::pointPolygonTest(geometry.contour, point2f, true));
+    }
+  }
+  // entries are never removed, so the returned reference stays valid for the lifetime of geometry
+  return geometry.edge_distances.emplace(resolution, std::move(edge_distances)).first->second;
+}
+
+bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
+                                         const object_recognition_msgs::msg::Table& table,
+                                         double min_distance_from_edge, double min_vertical_offset) const
+{
+  // Assumption that the table's normal is along the Z axis
+  const std::shared_ptr<TableGeometry> geometry = getTableGeometry(table);
+  if (!geometry)
+    return false;
 
   Eigen::Vector3d point(pose.position.x, pose.position.y, pose.position.z);
   Eigen::Isometry3d pose_table;
@@ -451,18 +514,19 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::msg::Pose& pose,
     return false;
   }
 
-  int point_x = (point.x() - x_min) * scale_factor;
-  int point_y = (point.y() - y_min) * scale_factor;
+  int point_x = (point.x() - geometry->x_min) * SCALE_FACTOR;
+  int point_y = (point.y() - geometry->y_min) * SCALE_FACTOR;
   cv::Point2f point2f(point_x, point_y);
-  double result = cv::pointPolygonTest(contours[0], point2f, true);
+  double result = cv::pointPolygonTest(geometry->contour, point2f, true);
   RCLCPP_DEBUG(LOGGER, "table distance: %f", result);
 
-  return static_cast<int>(result) >= static_cast<int>(min_distance_from_edge * scale_factor);
+  return static_cast<int>(result) >= static_cast<int>(min_distance_from_edge * SCALE_FACTOR);
 }
 
 std::string SemanticWorld::findObjectTable(const geometry_msgs::msg::Pose& pose, double min_distance_from_edge,
                                            double min_vertical_offset) const
 {
+  std::lock_guard<std::mutex> lock(table_lock_);
   std::map<std::string, object_recognition_msgs::msg::Table>::const_iterator it;
   for (it = current_tables_in_collision_world_.begin(); it != current_tables_in_collision_world_.end(); ++it)
   {
@@ -475,14 +539,48 @@ std::string SemanticWorld::findObjectTable(const geometry_msgs::msg::Pose& pose,
 
 void SemanticWorld::tableCallback(const object_recognition_msgs::msg::TableArray::ConstSharedPtr& msg)
 {
-  table_array_ = *msg;
-  RCLCPP_INFO(LOGGER, "Table callback with %d tables", static_cast<int>(table_array_.tables.size()));
-  transformTableArray(table_array_);
-  // Callback on an update
-  if (table_callback_)
+  // only hand the message over, so bursts of table updates do not block the executor
   {
-    RCLCPP_INFO(LOGGER, "Calling table callback");
-    table_callback_();
+    std::lock_guard<std::mutex> lock(pending_lock_);
+    if (pending_table_array_)
+      RCLCPP_DEBUG(LOGGER, "Dropping unprocessed table array in favor of a newer one");
+    pending_table_array_ = msg;
+  }
+  pending_condition_.notify_one();
+}
+
+void SemanticWorld::processTables()
+{
+  while (true)
+  {
+    object_recognition_msgs::msg::TableArray::ConstSharedPtr msg;
+    {
+      std::unique_lock<std::mutex> lock(pending_lock_);
+      pending_condition_.wait(lock, [this] { return stop_processing_ || pending_table_array_; });
+      if (stop_processing_)
+        return;
+      msg = std::move(pending_table_array_);
+      pending_table_array_.reset();
+    }
+
+    object_recognition_msgs::msg::TableArray table_array = *msg;
+    RCLCPP_INFO(LOGGER, "Table callback with %d tables", static_cast<int>(table_array.tables.size()));
+    transformTableArray(table_array);
+    {
+      std::lock_guard<std::mutex> lock(table_lock_);
+      table_array_ = std::move(table_array);
+    }
+    {
+      std::lock_guard<std::mutex> lock(table_geometry_lock_);
+      table_geometry_cache_.clear();
+    }
+
+    // Callback on an update
+    if (table_callback_)
+    {
+      RCLCPP_INFO(LOGGER, "Calling table callback");
+      table_callback_();
+    }
   }
 }
 
@@ -83,7 +83,8 @@ public:
   moveit::core::SolverAllocatorFn getLoaderFunction();
 
   /** \brief Get a function pointer that allocates and initializes a kinematics solver. If not previously called, this
-   * function reads ROS parameters for the groups defined in the SRDF. */
+   * function reads ROS parameters for the groups defined in the SRDF. The returned function may be called
+   * concurrently; solvers for different groups are then initialized in parallel. */
   moveit::core::SolverAllocatorFn getLoaderFunction(const srdf::ModelSharedPtr& srdf_model);
 
   /** \brief Get the groups for which the function pointer returned by getLoaderFunction() can allocate a solver */
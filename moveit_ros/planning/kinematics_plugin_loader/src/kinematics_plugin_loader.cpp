@@ -175,13 +175,16 @@ public:
                                   links.front()->getParentJointModel()->getParentLinkModel()->getName() :
                                   jmg->getParentModel().getModelFrame();
 
-    // just to be sure, do not call the same pluginlib instance allocation function in parallel
-    std::scoped_lock slock(lock_);
     for (std::size_t i = 0; !result && i < it->second.size(); ++i)
     {
       try
       {
-        result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        {
+          // do not call the same pluginlib instance allocation function in parallel; the (potentially slow)
+          // initialization of the solvers of different groups below may run concurrently
+          std::scoped_lock slock(lock_);
+          result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        }
         if (result)
         {
           // choose the tip of the IK solver
@@ -195,6 +198,7 @@ public:
           {
             RCLCPP_ERROR(LOGGER, "Kinematics solver of type '%s' could not be initialized for group '%s'",
                          it->second[i].c_str(), jmg->getName().c_str());
+            std::scoped_lock slock(lock_);
             result.reset();
             continue;
           }
@@ -224,10 +228,16 @@ public:
   // cache solver between two consecutive calls
   // first call in RobotModelLoader::loadKinematicsSolvers() is just to check suitability for jmg
   // second call in JointModelGroup::setSolverAllocators() is to actually retrieve the instance for use
+  // Only the slot of the given group is locked while allocating, so solvers for different groups can be allocated
+  // concurrently.
   kinematics::KinematicsBasePtr allocKinematicsSolverWithCache(const moveit::core::JointModelGroup* jmg)
   {
-    std::scoped_lock slock(cache_lock_);
-    kinematics::KinematicsBasePtr& cached = instances_[jmg];
+    std::unique_lock<std::mutex> cache_lock(cache_lock_);
+    CachedInstance& slot = instances_[jmg];  // map nodes are stable, so the slot outlives the lock
+    cache_lock.unlock();
+
+    std::scoped_lock slock(slot.lock);
+    kinematics::KinematicsBasePtr& cached = slot.instance;
     if (cached.unique())
       return std::move(cached);  // pass on unique instance
 
@@ -257,7 +267,12 @@ private:
   std::map<std::string, std::vector<std::string>> iksolver_to_tip_links_;  // a map between each ik solver and a vector
                                                                            // of custom-specified tip link(s)
   std::shared_ptr<pluginlib::ClassLoader<kinematics::KinematicsBase>> kinematics_loader_;
-  std::map<const moveit::core::JointModelGroup*, kinematics::KinematicsBasePtr> instances_;
+  struct CachedInstance
+  {
+    std::mutex lock;
+    kinematics::KinematicsBasePtr instance;
+  };
+  std::map<const moveit::core::JointModelGroup*, CachedInstance> instances_;
   std::mutex lock_;
   std::mutex cache_lock_;
 };
@@ -160,6 +160,13 @@ public:
   const planning_scene_monitor::PlanningSceneMonitorPtr& getPlanningSceneMonitor() const;
   planning_scene_monitor::PlanningSceneMonitorPtr getPlanningSceneMonitorNonConst();
 
+  /** \brief Get an immutable snapshot of the current planning scene, without locking the monitor or cloning the scene.
+   *
+   * Snapshots are cheap to take and to keep, and never change. Call diff() on one for a scene that can be modified
+   * locally. See planning_scene_monitor::PlanningSceneMonitor::getPlanningSceneSnapshot() for how the octomap, if
+   * monitored, is shared with the monitored scene. */
+  planning_scene::PlanningSceneConstPtr getPlanningSceneSnapshot() const;
+
   const std::shared_ptr<tf2_ros::Buffer>& getTFBuffer() const;
 
   /** \brief Get the stored instance of the trajectory execution manager */
@@ -44,6 +44,8 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/utils/moveit_error_code.h>
 
+#include <functional>
+
 namespace moveit_cpp
 {
 MOVEIT_CLASS_FORWARD(PlanningComponent);  // Defines PlanningComponentPtr, ConstPtr, WeakPtr... etc
@@ -83,9 +85,9 @@ public:
     double max_velocity_scaling_factor;
     double max_acceleration_scaling_factor;
 
-    void load(const rclcpp::Node::SharedPtr& node)
+    void load(const rclcpp::Node::SharedPtr& node, const std::string& param_namespace = "plan_request_params")
     {
-      std::string ns = "plan_request_params.";
+      std::string ns = param_namespace + ".";
       node->get_parameter_or(ns + "planner_id", planner_id, std::string(""));
       node->get_parameter_or(ns + "planning_pipeline", planning_pipeline, std::string(""));
       node->get_parameter_or(ns + "planning_time", planning_time, 1.0);
@@ -95,6 +97,49 @@ public:
     }
   };
 
+  /// Planner parameters for planning the same request with several pipelines in parallel
+  struct MultiPipelinePlanRequestParameters
+  {
+    /// One set of parameters per parallel planning run. Runs may share a pipeline, e.g. with different planner ids.
+    std::vector<PlanRequestParameters> multi_plan_request_parameters;
+
+    /// Global deadline of all runs in seconds. Runs still planning at the deadline are terminated.
+    /// If not positive, the longest planning_time of the runs is used.
+    double timeout = 0.0;
+
+    MultiPipelinePlanRequestParameters() = default;
+
+    /** \brief Load the parameters of each run from the namespace named like the run, e.g. "ompl_rrtc.planner_id" */
+    MultiPipelinePlanRequestParameters(const rclcpp::Node::SharedPtr& node, const std::vector<std::string>& run_names)
+    {
+      multi_plan_request_parameters.reserve(run_names.size());
+      for (const auto& run_name : run_names)
+      {
+        PlanRequestParameters parameters;
+        parameters.load(node, run_name);
+        multi_plan_request_parameters.push_back(parameters);
+      }
+    }
+  };
+
+  /** \brief Select the returned solution out of the solutions of all runs, given in the order they finished (the
+   * solutions of runs that failed are included) */
+  using SolutionCallbackFunction = std::function<PlanSolution(const std::vector<PlanSolution>& solutions)>;
+
+  /** \brief Return true once the solutions found so far are good enough, which terminates the runs still planning */
+  using StoppingCriterionFunction = std::function<bool(const std::vector<PlanSolution>& solutions,
+                                                       const MultiPipelinePlanRequestParameters& parameters)>;
+
+  /** \brief Select the first successful solution, which is the one found first */
+  static PlanSolution getFirstSolution(const std::vector<PlanSolution>& solutions);
+  /** \brief Select the successful solution with the shortest path in joint space */
+  static PlanSolution getShortestSolution(const std::vector<PlanSolution>& solutions);
+  /** \brief Select the successful solution with the smoothest path, i.e. the lowest smoothness() measure */
+  static PlanSolution getSmoothestSolution(const std::vector<PlanSolution>& solutions);
+  /** \brief Stop planning as soon as any run found a solution */
+  static bool stopAtFirstSolution(const std::vector<PlanSolution>& solutions,
+                                  const MultiPipelinePlanRequestParameters& parameters);
+
   /** \brief Constructor */
   PlanningComponent(const std::string& group_name, const rclcpp::Node::SharedPtr& node);
   PlanningComponent(const std::string& group_name, const MoveItCppPtr& moveit_cpp);
@@ -160,6 +205,14 @@ public:
   /** \brief Run a plan from start or current state to fulfill the last goal constraints provided by setGoal() using the
    * provided PlanRequestParameters. */
   PlanSolution plan(const PlanRequestParameters& parameters);
+  /** \brief Run the same plan request on several pipelines in parallel and select one of their solutions.
+   *
+   * Planning stops once all runs have finished, once \e stopping_criterion_callback holds or at the global deadline
+   * of \e parameters, whichever comes first. Runs that are still planning then are terminated. By default, the
+   * shortest of all solutions is returned once all runs have finished. */
+  PlanSolution plan(const MultiPipelinePlanRequestParameters& parameters,
+                    const SolutionCallbackFunction& solution_selection_callback = &getShortestSolution,
+                    const StoppingCriterionFunction& stopping_criterion_callback = nullptr);
 
   /** \brief Execute the latest computed solution trajectory computed by plan(). By default this function terminates
    * after the execution is complete. The execution can be run in background by setting blocking to false. */
@@ -169,6 +222,16 @@ public:
   const PlanSolutionPtr getLastPlanSolution();
 
 private:
+  /** \brief Copy the current planning scene and set its state to the start state of planning, or return nullptr if no
+   * goal is set. The start state is also written to \e start_state. */
+  planning_scene::PlanningScenePtr getPlanningScene(moveit_msgs::msg::RobotState& start_state);
+
+  /** \brief Plan on \e planning_scene with the given parameters. This does not touch last_plan_solution_ and may be
+   * called from several threads at once. */
+  PlanSolution computePlan(const PlanRequestParameters& parameters,
+                           const planning_scene::PlanningSceneConstPtr& planning_scene,
+                           const moveit_msgs::msg::RobotState& start_state) const;
+
   // Core properties and instances
   rclcpp::Node::SharedPtr node_;
   MoveItCppPtr moveit_cpp_;
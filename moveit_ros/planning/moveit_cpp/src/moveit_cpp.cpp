@@ -234,6 +234,11 @@ planning_scene_monitor::PlanningSceneMonitorPtr MoveItCpp::getPlanningSceneMonit
   return planning_scene_monitor_;
 }
 
+planning_scene::PlanningSceneConstPtr MoveItCpp::getPlanningSceneSnapshot() const
+{
+  return planning_scene_monitor_->getPlanningSceneSnapshot();
+}
+
 const trajectory_execution_manager::TrajectoryExecutionManagerPtr& MoveItCpp::getTrajectoryExecutionManager() const
 {
   return trajectory_execution_manager_;
@@ -34,13 +34,20 @@
 
 /* Author: Henning Kayser */
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 
 #include <moveit/moveit_cpp/planning_component.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 namespace moveit_cpp
 {
@@ -107,52 +114,56 @@ bool PlanningComponent::setPathConstraints(const moveit_msgs::msg::Constraints&
   return true;
 }
 
-PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+planning_scene::PlanningScenePtr PlanningComponent::getPlanningScene(moveit_msgs::msg::RobotState& start_state_msg)
 {
-  last_plan_solution_ = std::make_shared<PlanSolution>();
-  if (!joint_model_group_)
-  {
-    RCLCPP_ERROR(LOGGER, "Failed to retrieve joint model group for name '%s'.", group_name_.c_str());
-    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GROUP_NAME;
-    return *last_plan_solution_;
-  }
-
-  // Clone current planning scene
+  // Plan on a diff of a snapshot of the current planning scene, which is much cheaper than cloning the scene. The
+  // octree of a snapshot is shared with the monitored scene though, so clone the scene if the octomap is updated in
+  // place.
   planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor =
       moveit_cpp_->getPlanningSceneMonitorNonConst();
   planning_scene_monitor->updateFrameTransforms();
-  const planning_scene::PlanningScenePtr planning_scene = planning_scene_monitor->copyPlanningScene();
+  const planning_scene::PlanningScenePtr planning_scene =
+      !planning_scene_monitor->getOccupancyMapMonitor() || planning_scene_monitor->isOctomapDoubleBuffered() ?
+          planning_scene_monitor->getPlanningSceneSnapshot()->diff() :
+          planning_scene_monitor->copyPlanningScene();
   planning_scene_monitor.reset();  // release this pointer
 
-  // Init MotionPlanRequest
-  ::planning_interface::MotionPlanRequest req;
-  req.group_name = group_name_;
-  req.planner_id = parameters.planner_id;
-  req.num_planning_attempts = std::max(1, parameters.planning_attempts);
-  req.allowed_planning_time = parameters.planning_time;
-  req.max_velocity_scaling_factor = parameters.max_velocity_scaling_factor;
-  req.max_acceleration_scaling_factor = parameters.max_acceleration_scaling_factor;
-  if (workspace_parameters_set_)
-    req.workspace_parameters = workspace_parameters_;
-
   // Set start state
   moveit::core::RobotStatePtr start_state = considered_start_state_;
   if (!start_state)
     start_state = moveit_cpp_->getCurrentState();
   start_state->update();
-  moveit::core::robotStateToRobotStateMsg(*start_state, req.start_state);
+  moveit::core::robotStateToRobotStateMsg(*start_state, start_state_msg);
   planning_scene->setCurrentState(*start_state);
 
-  // Set goal constraints
+  // Check goal constraints
   if (current_goal_constraints_.empty())
   {
     RCLCPP_ERROR(LOGGER, "No goal constraints set for planning request");
-    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GOAL_CONSTRAINTS;
-    return *last_plan_solution_;
+    return nullptr;
   }
-  req.goal_constraints = current_goal_constraints_;
+  return planning_scene;
+}
+
+PlanningComponent::PlanSolution
+PlanningComponent::computePlan(const PlanRequestParameters& parameters,
+                               const planning_scene::PlanningSceneConstPtr& planning_scene,
+                               const moveit_msgs::msg::RobotState& start_state) const
+{
+  PlanSolution solution;
 
-  // Set path constraints
+  // Init MotionPlanRequest
+  ::planning_interface::MotionPlanRequest req;
+  req.group_name = group_name_;
+  req.planner_id = parameters.planner_id;
+  req.num_planning_attempts = std::max(1, parameters.planning_attempts);
+  req.allowed_planning_time = parameters.planning_time;
+  req.max_velocity_scaling_factor = parameters.max_velocity_scaling_factor;
+  req.max_acceleration_scaling_factor = parameters.max_acceleration_scaling_factor;
+  if (workspace_parameters_set_)
+    req.workspace_parameters = workspace_parameters_;
+  req.start_state = start_state;
+  req.goal_constraints = current_goal_constraints_;
   req.path_constraints = current_path_constraints_;
 
   // Run planning attempt
@@ -160,20 +171,42 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
   if (planning_pipeline_names_.find(parameters.planning_pipeline) == planning_pipeline_names_.end())
   {
     RCLCPP_ERROR(LOGGER, "No planning pipeline available for name '%s'", parameters.planning_pipeline.c_str());
-    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::FAILURE;
-    return *last_plan_solution_;
+    solution.error_code = moveit::core::MoveItErrorCode::FAILURE;
+    return solution;
   }
   const planning_pipeline::PlanningPipelinePtr pipeline =
       moveit_cpp_->getPlanningPipelines().at(parameters.planning_pipeline);
   pipeline->generatePlan(planning_scene, req, res);
-  last_plan_solution_->error_code = res.error_code_.val;
+  solution.error_code = res.error_code_.val;
   if (res.error_code_.val != res.error_code_.SUCCESS)
   {
     RCLCPP_ERROR(LOGGER, "Could not compute plan successfully");
+    return solution;
+  }
+  solution.start_state = req.start_state;
+  solution.trajectory = res.trajectory_;
+  return solution;
+}
+
+PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+{
+  last_plan_solution_ = std::make_shared<PlanSolution>();
+  if (!joint_model_group_)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to retrieve joint model group for name '%s'.", group_name_.c_str());
+    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GROUP_NAME;
+    return *last_plan_solution_;
+  }
+
+  moveit_msgs::msg::RobotState start_state;
+  const planning_scene::PlanningScenePtr planning_scene = getPlanningScene(start_state);
+  if (!planning_scene)
+  {
+    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GOAL_CONSTRAINTS;
     return *last_plan_solution_;
   }
-  last_plan_solution_->start_state = req.start_state;
-  last_plan_solution_->trajectory = res.trajectory_;
+
+  *last_plan_solution_ = computePlan(parameters, planning_scene, start_state);
   // TODO(henningkayser): Visualize trajectory
   // std::vector<const moveit::core::LinkModel*> eef_links;
   // if (joint_model_group->getEndEffectorTips(eef_links))
@@ -189,6 +222,150 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
   return *last_plan_solution_;
 }
 
+PlanningComponent::PlanSolution
+PlanningComponent::plan(const MultiPipelinePlanRequestParameters& parameters,
+                        const SolutionCallbackFunction& solution_selection_callback,
+                        const StoppingCriterionFunction& stopping_criterion_callback)
+{
+  last_plan_solution_ = std::make_shared<PlanSolution>();
+  if (!joint_model_group_)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to retrieve joint model group for name '%s'.", group_name_.c_str());
+    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GROUP_NAME;
+    return *last_plan_solution_;
+  }
+  const auto& runs = parameters.multi_plan_request_parameters;
+  if (runs.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "No plan request parameters given for parallel planning");
+    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::FAILURE;
+    return *last_plan_solution_;
+  }
+
+  // All runs plan on the same (read-only) copy of the scene
+  moveit_msgs::msg::RobotState start_state;
+  const planning_scene::PlanningScenePtr planning_scene = getPlanningScene(start_state);
+  if (!planning_scene)
+  {
+    last_plan_solution_->error_code = moveit::core::MoveItErrorCode::INVALID_GOAL_CONSTRAINTS;
+    return *last_plan_solution_;
+  }
+
+  double timeout = parameters.timeout;
+  if (timeout <= 0.0)
+  {
+    for (const auto& run : runs)
+      timeout = std::max(timeout, run.planning_time);
+  }
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+
+  std::mutex solutions_mutex;
+  std::condition_variable solutions_condition;
+  std::vector<PlanSolution> solutions;  // in the order the runs finished
+  std::vector<bool> finished(runs.size(), false);
+  solutions.reserve(runs.size());
+
+  std::vector<std::thread> threads;
+  threads.reserve(runs.size());
+  for (std::size_t i = 0; i < runs.size(); ++i)
+  {
+    threads.emplace_back([&, i] {
+      PlanSolution solution = computePlan(runs[i], planning_scene, start_state);
+      {
+        std::lock_guard<std::mutex> lock(solutions_mutex);
+        solutions.push_back(std::move(solution));
+        finished[i] = true;
+      }
+      solutions_condition.notify_all();
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(solutions_mutex);
+    const bool done = solutions_condition.wait_until(lock, deadline, [&] {
+      return solutions.size() == runs.size() ||
+             (stopping_criterion_callback && stopping_criterion_callback(solutions, parameters));
+    });
+    if (!done)
+      RCLCPP_WARN(LOGGER, "Parallel planning reached its deadline of %.3fs", timeout);
+
+    // Terminate the runs that are still planning, they cannot win anymore
+    const auto& pipelines = moveit_cpp_->getPlanningPipelines();
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+      if (finished[i])
+        continue;
+      const auto pipeline = pipelines.find(runs[i].planning_pipeline);
+      if (pipeline != pipelines.end())
+      {
+        RCLCPP_DEBUG(LOGGER, "Terminating planning with pipeline '%s'", runs[i].planning_pipeline.c_str());
+        pipeline->second->terminate();
+      }
+    }
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  *last_plan_solution_ =
+      solution_selection_callback ? solution_selection_callback(solutions) : getShortestSolution(solutions);
+  return *last_plan_solution_;
+}
+
+PlanningComponent::PlanSolution PlanningComponent::getFirstSolution(const std::vector<PlanSolution>& solutions)
+{
+  for (const auto& solution : solutions)
+  {
+    if (solution)
+      return solution;
+  }
+  PlanSolution no_solution;
+  no_solution.error_code = solutions.empty() ? moveit::core::MoveItErrorCode::TIMED_OUT : solutions.front().error_code;
+  return no_solution;
+}
+
+PlanningComponent::PlanSolution PlanningComponent::getShortestSolution(const std::vector<PlanSolution>& solutions)
+{
+  const PlanSolution* best = nullptr;
+  double best_length = std::numeric_limits<double>::infinity();
+  for (const auto& solution : solutions)
+  {
+    if (!solution || !solution.trajectory)
+      continue;
+    const double length = robot_trajectory::path_length(*solution.trajectory);
+    if (length < best_length)
+    {
+      best = &solution;
+      best_length = length;
+    }
+  }
+  return best ? *best : getFirstSolution(solutions);
+}
+
+PlanningComponent::PlanSolution PlanningComponent::getSmoothestSolution(const std::vector<PlanSolution>& solutions)
+{
+  const PlanSolution* best = nullptr;
+  double best_smoothness = std::numeric_limits<double>::infinity();
+  for (const auto& solution : solutions)
+  {
+    if (!solution || !solution.trajectory)
+      continue;
+    // trajectories too short to have a smoothness measure are perfectly smooth
+    const double smoothness = robot_trajectory::smoothness(*solution.trajectory).value_or(0.0);
+    if (!best || smoothness < best_smoothness)
+    {
+      best = &solution;
+      best_smoothness = smoothness;
+    }
+  }
+  return best ? *best : getFirstSolution(solutions);
+}
+
+bool PlanningComponent::stopAtFirstSolution(const std::vector<PlanSolution>& solutions,
+                                            const MultiPipelinePlanRequestParameters& /* unused */)
+{
+  return std::any_of(solutions.begin(), solutions.end(), [](const PlanSolution& solution) { return bool(solution); });
+}
+
 PlanningComponent::PlanSolution PlanningComponent::plan()
 {
   return plan(plan_request_parameters_);
@@ -45,6 +45,9 @@
 #include <pluginlib/class_loader.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
 
 /** \brief This namespace includes functionality specific to the execution and monitoring of motion plans */
 namespace plan_execution
@@ -90,6 +93,15 @@ public:
     std::function<void()> done_callback_;
   };
 
+  /// The time in seconds that a call to executeAndMonitor() spent before and after the trajectory execution
+  struct ExecutionLatency
+  {
+    /// Unwinding the plan components and pushing them to the trajectory execution manager
+    double preparation = 0.0;
+    /// From the completion reported by the trajectory execution manager until executeAndMonitor() returned
+    double completion = 0.0;
+  };
+
   PlanExecution(const rclcpp::Node::SharedPtr& node,
                 const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor,
                 const trajectory_execution_manager::TrajectoryExecutionManagerPtr& trajectory_execution);
@@ -140,6 +152,10 @@ public:
 
   void stop();
 
+  /** \brief Return the latency of the last call to executeAndMonitor(). The latency of the trajectory execution itself
+      is reported by TrajectoryExecutionManager::getLastExecutionLatency() */
+  ExecutionLatency getLastExecutionLatency() const;
+
   std::string getErrorCodeString(const moveit_msgs::msg::MoveItErrorCodes& error_code);
 
 private:
@@ -147,6 +163,15 @@ private:
   bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
 
   void planningSceneUpdatedCallback(const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
+
+  /** \brief Start recording the regions of the world that change during the execution of \e plan */
+  void startTrackingSceneChanges(const ExecutableMotionPlan& plan);
+  void stopTrackingSceneChanges();
+  void worldChangedCallback(const collision_detection::World::ObjectConstPtr& object,
+                            collision_detection::World::Action action);
+  /** \brief Move the regions that changed since the last call to \e regions.
+      Return false if some changes are not covered by the regions, e.g. after the scene was replaced */
+  bool takeChangedRegions(std::vector<Eigen::AlignedBox3d>& regions);
   void doneWithTrajectoryExecution(const moveit_controller_manager::ExecutionStatus& status);
   void successfulTrajectorySegmentExecution(const ExecutableMotionPlan& plan, std::size_t index);
 
@@ -178,9 +203,27 @@ private:
 
   bool new_scene_update_;
 
+  // regions of the world that changed since the remaining path was last checked
+  collision_detection::WorldPtr tracked_world_;
+  collision_detection::World::ObserverHandle world_observer_;
+  std::map<std::string, Eigen::AlignedBox3d> object_regions_;  // last known region of each world object
+  std::vector<Eigen::AlignedBox3d> changed_regions_;
+  bool changes_localized_;
+  std::uint64_t octomap_version_;
+  std::mutex changed_regions_mutex_;
+
+  // the boxes around the robot links at each waypoint of the last plan component that was completely validated
+  int validated_component_;
+  std::vector<std::vector<Eigen::AlignedBox3d>> waypoint_regions_;
+  std::mutex path_validation_mutex_;
+
   bool execution_complete_;
   bool path_became_invalid_;
 
+  ExecutionLatency last_execution_latency_;
+  std::chrono::steady_clock::time_point execution_completion_time_;
+  mutable std::mutex execution_latency_mutex_;
+
   // class DynamicReconfigureImpl;
   // DynamicReconfigureImpl* reconfigure_impl_;
 };
@@ -39,7 +39,12 @@
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <moveit/utils/message_checks.h>
+#include <moveit/robot_model/aabb.h>
+#include <geometric_shapes/shape_operations.h>
 #include <boost/algorithm/string/join.hpp>
+#include <array>
+#include <cmath>
+#include <set>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/node.hpp>
@@ -54,6 +59,72 @@ namespace plan_execution
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.plan_execution");
 
+// margin around the robot links, within which changes of the world trigger a collision check of a waypoint
+static const double CHANGED_REGION_PADDING = 0.01;
+// changed octomap cells are merged into regions of this size
+static const double CHANGED_REGION_BIN_SIZE = 0.2;
+
+namespace
+{
+Eigen::AlignedBox3d padded(Eigen::AlignedBox3d box, double padding)
+{
+  box.min().array() -= padding;
+  box.max().array() += padding;
+  return box;
+}
+
+// Extend box by the bounding spheres of shapes. Return false if a shape has no finite bound
+bool extendWithShapes(Eigen::AlignedBox3d& box, const std::vector<shapes::ShapeConstPtr>& shapes,
+                      const EigenSTL::vector_Isometry3d& poses)
+{
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    if (shapes[i]->type == shapes::PLANE || shapes[i]->type == shapes::OCTREE)
+      return false;
+    Eigen::Vector3d center;
+    double radius;
+    shapes::computeShapeBoundingSphere(shapes[i].get(), center, radius);
+    center = poses[i] * center;
+    box.extend(center - Eigen::Vector3d::Constant(radius));
+    box.extend(center + Eigen::Vector3d::Constant(radius));
+  }
+  return true;
+}
+
+// The boxes around the links and attached bodies of a robot state
+std::vector<Eigen::AlignedBox3d> computeWaypointRegions(const moveit::core::RobotState& state)
+{
+  std::vector<Eigen::AlignedBox3d> regions;
+  for (const moveit::core::LinkModel* link : state.getRobotModel()->getLinkModelsWithCollisionGeometry())
+  {
+    Eigen::Isometry3d transform = state.getGlobalLinkTransform(link);  // intentional copy, we will translate
+    transform.translate(link->getCenteredBoundingBoxOffset());
+    moveit::core::AABB box;
+    box.extendWithTransformedBox(transform, link->getShapeExtentsAtOrigin());
+    regions.push_back(padded(box, CHANGED_REGION_PADDING));
+  }
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    Eigen::AlignedBox3d box;
+    if (!extendWithShapes(box, attached_body->getShapes(), attached_body->getGlobalCollisionBodyTransforms()))
+      box = Eigen::AlignedBox3d(Eigen::Vector3d::Constant(-INFINITY), Eigen::Vector3d::Constant(INFINITY));
+    regions.push_back(padded(box, CHANGED_REGION_PADDING));
+  }
+  return regions;
+}
+
+bool intersects(const std::vector<Eigen::AlignedBox3d>& regions, const std::vector<Eigen::AlignedBox3d>& others)
+{
+  for (const Eigen::AlignedBox3d& region : regions)
+    for (const Eigen::AlignedBox3d& other : others)
+      if (region.intersects(other))
+        return true;
+  return false;
+}
+}  // namespace
+
 // class PlanExecution::DynamicReconfigureImpl
 // {
 // public:
@@ -88,6 +159,9 @@ plan_execution::PlanExecution::PlanExecution(
   default_max_replan_attempts_ = 5;
 
   new_scene_update_ = false;
+  changes_localized_ = false;
+  octomap_version_ = 0;
+  validated_component_ = -1;
 
   // we want to be notified when new information is available
   planning_scene_monitor_->addUpdateCallback(
@@ -295,10 +369,30 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
     const collision_detection::AllowedCollisionMatrix* acm =
         plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
     std::size_t wpc = t.getWayPointCount();
+
+    // the validation state is shared by the monitoring loop and the callback of completed trajectory components
+    std::scoped_lock validation_lock(path_validation_mutex_);
+
+    // if the remaining path was completely validated before, only the waypoints near changed regions of the world
+    // can have become invalid
+    std::vector<Eigen::AlignedBox3d> changed_regions;
+    const bool incremental = takeChangedRegions(changed_regions) && validated_component_ == path_segment.first &&
+                             !plan.planning_scene_->getStateFeasibilityPredicate();
+    if (!incremental)
+    {
+      validated_component_ = -1;
+      waypoint_regions_.resize(wpc);
+    }
+
     collision_detection::CollisionRequest req;
     req.group_name = t.getGroupName();
     for (std::size_t i = std::max(path_segment.second - 1, 0); i < wpc; ++i)
     {
+      if (!incremental)
+        waypoint_regions_[i] = computeWaypointRegions(t.getWayPoint(i));
+      else if (!intersects(waypoint_regions_[i], changed_regions))
+        continue;
+
       collision_detection::CollisionResult res;
       if (acm)
         plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
@@ -321,10 +415,135 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
         return false;
       }
     }
+    validated_component_ = path_segment.first;
   }
   return true;
 }
 
+void plan_execution::PlanExecution::startTrackingSceneChanges(const ExecutableMotionPlan& plan)
+{
+  validated_component_ = -1;
+
+  // changes can only be tracked in the world of the monitored scene
+  planning_scene_monitor::LockedPlanningSceneRW lscene(planning_scene_monitor_);
+  if (plan.planning_scene_ != planning_scene_monitor_->getPlanningScene())
+    return;
+
+  {
+    std::scoped_lock slock(changed_regions_mutex_);
+    tracked_world_ = lscene->getWorldNonConst();
+    changes_localized_ = true;
+    changed_regions_.clear();
+    object_regions_.clear();
+    for (const auto& [id, object] : *tracked_world_)
+    {
+      Eigen::AlignedBox3d region;
+      if (extendWithShapes(region, object->shapes_, object->global_shape_poses_))
+        object_regions_[id] = region;
+    }
+    if (const occupancy_map_monitor::OccupancyMapMonitor* octomap_monitor =
+            planning_scene_monitor_->getOccupancyMapMonitor())
+      octomap_version_ = octomap_monitor->getMapVersion();
+  }
+  world_observer_ = tracked_world_->addObserver(
+      [this](const collision_detection::World::ObjectConstPtr& object, collision_detection::World::Action action) {
+        worldChangedCallback(object, action);
+      });
+}
+
+void plan_execution::PlanExecution::stopTrackingSceneChanges()
+{
+  planning_scene_monitor::LockedPlanningSceneRW lscene(planning_scene_monitor_);
+  std::scoped_lock slock(changed_regions_mutex_);
+  if (tracked_world_)
+  {
+    tracked_world_->removeObserver(world_observer_);
+    tracked_world_.reset();
+  }
+  changed_regions_.clear();
+  object_regions_.clear();
+}
+
+void plan_execution::PlanExecution::worldChangedCallback(const collision_detection::World::ObjectConstPtr& object,
+                                                         collision_detection::World::Action action)
+{
+  std::scoped_lock slock(changed_regions_mutex_);
+
+  // the changed cells of the octomap are taken from the occupancy map monitor instead
+  if (object->id_ == planning_scene::PlanningScene::OCTOMAP_NS && planning_scene_monitor_->getOccupancyMapMonitor())
+    return;
+
+  // the change covers both the previous and the new region of the object
+  Eigen::AlignedBox3d region;
+  std::map<std::string, Eigen::AlignedBox3d>::iterator it = object_regions_.find(object->id_);
+  if (it != object_regions_.end())
+    region = it->second;
+  else if (!(action & collision_detection::World::CREATE))
+    changes_localized_ = false;
+
+  if (action & collision_detection::World::DESTROY)
+    object_regions_.erase(object->id_);
+  else
+  {
+    Eigen::AlignedBox3d current;
+    if (extendWithShapes(current, object->shapes_, object->global_shape_poses_))
+    {
+      object_regions_[object->id_] = current;
+      region.extend(current);
+    }
+    else
+    {
+      object_regions_.erase(object->id_);
+      changes_localized_ = false;
+    }
+  }
+  if (!region.isEmpty())
+    changed_regions_.push_back(region);
+}
+
+bool plan_execution::PlanExecution::takeChangedRegions(std::vector<Eigen::AlignedBox3d>& regions)
+{
+  std::scoped_lock slock(changed_regions_mutex_);
+  bool localized = changes_localized_ && tracked_world_ &&
+                   tracked_world_ == planning_scene_monitor_->getPlanningScene()->getWorld();
+  regions.swap(changed_regions_);
+  changed_regions_.clear();
+  changes_localized_ = true;
+
+  const occupancy_map_monitor::OccupancyMapMonitor* octomap_monitor = planning_scene_monitor_->getOccupancyMapMonitor();
+  if (localized && octomap_monitor)
+  {
+    occupancy_map_monitor::OccupancyMapChanges changes;
+    octomap_monitor->getMapChangesSince(octomap_version_, changes);
+    octomap_version_ = changes.version;
+    if (changes.is_keyframe)
+      return false;
+
+    // merge the changed cells into coarse bins, so the number of regions stays small
+    const collision_detection::OccMapTreeConstPtr& tree = octomap_monitor->getOcTreePtr();
+    std::set<std::array<int, 3>> bins;
+    const auto add_cell = [&tree, &bins](const octomap::OcTreeKey& key) {
+      const octomap::point3d p = tree->keyToCoord(key);
+      bins.insert({ static_cast<int>(std::floor(p.x() / CHANGED_REGION_BIN_SIZE)),
+                    static_cast<int>(std::floor(p.y() / CHANGED_REGION_BIN_SIZE)),
+                    static_cast<int>(std::floor(p.z() / CHANGED_REGION_BIN_SIZE)) });
+    };
+    for (const auto& cell : changes.updated_cells)
+      add_cell(cell.first);
+    for (const octomap::OcTreeKey& key : changes.removed_cells)
+      add_cell(key);
+
+    const double half_cell = 0.5 * tree->getResolution();
+    for (const std::array<int, 3>& bin : bins)
+    {
+      const Eigen::Vector3d corner = Eigen::Vector3d(bin[0], bin[1], bin[2]) * CHANGED_REGION_BIN_SIZE;
+      regions.emplace_back(corner - Eigen::Vector3d::Constant(half_cell),
+                           corner + Eigen::Vector3d::Constant(CHANGED_REGION_BIN_SIZE + half_cell));
+    }
+  }
+  return localized;
+}
+
 moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(ExecutableMotionPlan& plan,
                                                                                     bool reset_preempted)
 {
@@ -355,6 +574,7 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
   }
 
   execution_complete_ = false;
+  const auto preparation_start = std::chrono::steady_clock::now();
 
   // push the trajectories we have slated for execution to the trajectory execution manager
   int prev = -1;
@@ -417,6 +637,17 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
   if (trajectory_monitor_)
     trajectory_monitor_->startTrajectoryMonitor();
 
+  // record where the world changes, so the remaining path is only checked again close to these changes
+  startTrackingSceneChanges(plan);
+
+  {
+    std::scoped_lock slock(execution_latency_mutex_);
+    last_execution_latency_ = ExecutionLatency();
+    last_execution_latency_.preparation =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - preparation_start).count();
+    execution_completion_time_ = std::chrono::steady_clock::time_point();
+  }
+
   // start a trajectory execution thread
   trajectory_execution_manager_->execute(
       [this](const moveit_controller_manager::ExecutionStatus& status) { doneWithTrajectoryExecution(status); },
@@ -467,6 +698,8 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
     trajectory_execution_manager_->stopExecution();
   }
 
+  stopTrackingSceneChanges();
+
   // stop recording trajectory states
   if (trajectory_monitor_)
   {
@@ -497,20 +730,45 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
         result.val = moveit_msgs::msg::MoveItErrorCodes::CONTROL_FAILED;
     }
   }
+
+  {
+    std::scoped_lock slock(execution_latency_mutex_);
+    if (execution_completion_time_ != std::chrono::steady_clock::time_point())
+      last_execution_latency_.completion =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - execution_completion_time_).count();
+  }
   return result;
 }
 
+plan_execution::PlanExecution::ExecutionLatency plan_execution::PlanExecution::getLastExecutionLatency() const
+{
+  std::scoped_lock slock(execution_latency_mutex_);
+  return last_execution_latency_;
+}
+
 void plan_execution::PlanExecution::planningSceneUpdatedCallback(
     const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
 {
   if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
                      planning_scene_monitor::PlanningSceneMonitor::UPDATE_TRANSFORMS))
     new_scene_update_ = true;
+
+  // a replaced scene, or changes such as a new allowed collision matrix, can not be localized
+  if ((update_type & planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE) ==
+      planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE)
+  {
+    std::scoped_lock slock(changed_regions_mutex_);
+    changes_localized_ = false;
+  }
 }
 
 void plan_execution::PlanExecution::doneWithTrajectoryExecution(
     const moveit_controller_manager::ExecutionStatus& /*status*/)
 {
+  {
+    std::scoped_lock slock(execution_latency_mutex_);
+    execution_completion_time_ = std::chrono::steady_clock::now();
+  }
   execution_complete_ = true;
 }
 
@@ -0,0 +1,344 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Measures how the collision checking throughput of the available collision detectors scales with the complexity of
+ * the world (number of objects, mesh triangles, octomap occupancy) and the number of checking threads. */
+
+#include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
+#include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
+#include <moveit/collision_distance_field/collision_detector_allocator_distance_field.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <geometric_shapes/shape_operations.h>
+#include <random_numbers/random_numbers.h>
+#include <octomap/octomap.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <tuple>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("collision_scaling_benchmark");
+
+/** \brief Half extent of the region around the robot base that is filled with world geometry. */
+static const double WORLD_EXTENT = 1.0;
+
+/** \brief Resolution of the octomaps that are generated for the octomap sweep. */
+static const double OCTOMAP_RESOLUTION = 0.05;
+
+/** \brief Number of mesh objects in the world for the triangle sweep. */
+static const std::size_t NUM_MESHES = 5;
+
+namespace
+{
+std::vector<double> parseValues(const std::string& values)
+{
+  std::vector<std::string> tokens;
+  boost::split(tokens, values, boost::is_any_of(","), boost::token_compress_on);
+  std::vector<double> result;
+  for (const std::string& token : tokens)
+  {
+    if (!token.empty())
+      result.push_back(std::stod(token));
+  }
+  return result;
+}
+
+Eigen::Isometry3d randomPose(random_numbers::RandomNumberGenerator& rng)
+{
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation() = Eigen::Vector3d(rng.uniformReal(-WORLD_EXTENT, WORLD_EXTENT),
+                                       rng.uniformReal(-WORLD_EXTENT, WORLD_EXTENT),
+                                       rng.uniformReal(0.0, WORLD_EXTENT));
+  double quat[4];
+  rng.quaternion(quat);
+  pose.linear() = Eigen::Quaterniond(quat[3], quat[0], quat[1], quat[2]).toRotationMatrix();
+  return pose;
+}
+
+/** \brief Creates a sphere mesh with approximately the requested number of triangles. */
+shapes::Mesh* createSphereMesh(double radius, std::size_t num_triangles)
+{
+  // A sphere with r rings and 2r segments consists of 4r(r - 1) triangles
+  const std::size_t rings = std::max<std::size_t>(2, std::lround(std::sqrt(num_triangles / 4.0)));
+  const std::size_t segments = 2 * rings;
+
+  EigenSTL::vector_Vector3d vertices;
+  vertices.emplace_back(0.0, 0.0, radius);
+  for (std::size_t i = 1; i < rings; ++i)
+  {
+    const double theta = M_PI * i / rings;
+    for (std::size_t j = 0; j < segments; ++j)
+    {
+      const double phi = 2.0 * M_PI * j / segments;
+      vertices.emplace_back(radius * std::sin(theta) * std::cos(phi), radius * std::sin(theta) * std::sin(phi),
+                            radius * std::cos(theta));
+    }
+  }
+  vertices.emplace_back(0.0, 0.0, -radius);
+
+  const auto ring_vertex = [segments](std::size_t ring, std::size_t segment) {
+    return static_cast<unsigned int>(1 + (ring - 1) * segments + segment % segments);
+  };
+  const auto bottom = static_cast<unsigned int>(vertices.size() - 1);
+  std::vector<unsigned int> triangles;
+  for (std::size_t j = 0; j < segments; ++j)
+  {
+    triangles.insert(triangles.end(), { 0, ring_vertex(1, j), ring_vertex(1, j + 1) });
+    for (std::size_t i = 1; i + 1 < rings; ++i)
+    {
+      triangles.insert(triangles.end(), { ring_vertex(i, j), ring_vertex(i + 1, j), ring_vertex(i + 1, j + 1) });
+      triangles.insert(triangles.end(), { ring_vertex(i, j), ring_vertex(i + 1, j + 1), ring_vertex(i, j + 1) });
+    }
+    triangles.insert(triangles.end(), { ring_vertex(rings - 1, j), bottom, ring_vertex(rings - 1, j + 1) });
+  }
+  return shapes::createMeshFromVertices(vertices, triangles);
+}
+
+void addBoxes(collision_detection::World& world, std::size_t num_objects, random_numbers::RandomNumberGenerator& rng)
+{
+  for (std::size_t i = 0; i < num_objects; ++i)
+  {
+    const auto box = std::make_shared<const shapes::Box>(rng.uniformReal(0.05, 0.2), rng.uniformReal(0.05, 0.2),
+                                                         rng.uniformReal(0.05, 0.2));
+    world.addToObject("box_" + std::to_string(i), box, randomPose(rng));
+  }
+}
+
+void addMeshes(collision_detection::World& world, std::size_t num_triangles, random_numbers::RandomNumberGenerator& rng)
+{
+  for (std::size_t i = 0; i < NUM_MESHES; ++i)
+  {
+    const shapes::ShapeConstPtr mesh(createSphereMesh(rng.uniformReal(0.05, 0.2), num_triangles));
+    world.addToObject("mesh_" + std::to_string(i), mesh, randomPose(rng));
+  }
+}
+
+void addOctomap(collision_detection::World& world, double occupancy, random_numbers::RandomNumberGenerator& rng)
+{
+  auto tree = std::make_shared<octomap::OcTree>(OCTOMAP_RESOLUTION);
+  for (double x = -WORLD_EXTENT; x < WORLD_EXTENT; x += OCTOMAP_RESOLUTION)
+  {
+    for (double y = -WORLD_EXTENT; y < WORLD_EXTENT; y += OCTOMAP_RESOLUTION)
+    {
+      for (double z = 0.0; z < WORLD_EXTENT; z += OCTOMAP_RESOLUTION)
+      {
+        if (rng.uniform01() < occupancy)
+          tree->updateNode(octomap::point3d(x, y, z), true);
+      }
+    }
+  }
+  tree->updateInnerOccupancy();
+  world.addToObject(planning_scene::PlanningScene::OCTOMAP_NS, std::make_shared<const shapes::OcTree>(tree),
+                    Eigen::Isometry3d::Identity());
+}
+
+/** \brief Checks all states repeatedly with each thread and returns the total number of checks per second.
+ *
+ *  Each thread checks its own copy of the scene, as not all collision detectors support concurrent queries. */
+double measureThroughput(const planning_scene::PlanningSceneConstPtr& scene,
+                         const std::vector<moveit::core::RobotState>& states, std::size_t trials, std::size_t threads,
+                         double& collision_fraction)
+{
+  std::vector<planning_scene::PlanningScenePtr> scenes;
+  for (std::size_t i = 0; i < threads; ++i)
+    scenes.push_back(planning_scene::PlanningScene::clone(scene));
+
+  std::atomic<std::size_t> collisions{ 0 };
+  const auto run = [&](std::size_t thread) {
+    collision_detection::CollisionRequest req;
+    std::size_t thread_collisions = 0;
+    for (std::size_t i = 0; i < trials; ++i)
+    {
+      collision_detection::CollisionResult res;
+      scenes[thread]->checkCollision(req, res, states[(i + thread) % states.size()]);
+      thread_collisions += res.collision;
+    }
+    collisions += thread_collisions;
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (std::size_t i = 0; i < threads; ++i)
+    workers.emplace_back(run, i);
+  for (std::thread& worker : workers)
+    worker.join();
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+  collision_fraction = static_cast<double>(collisions) / static_cast<double>(threads * trials);
+  return static_cast<double>(threads * trials) / duration.count();
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  auto node = rclcpp::Node::make_shared("collision_scaling_benchmark");
+
+  std::size_t trials = 1000;
+  std::size_t num_states = 100;
+  std::string objects = "0,10,50,200";
+  std::string triangles = "100,1000,10000,100000";
+  std::string occupancy = "0.01,0.05,0.2";
+  std::string threads = "1,2,4,8";
+  std::string detectors = "FCL,Bullet,DistanceField";
+  std::string output;
+  boost::program_options::options_description desc;
+  desc.add_options()("help", "this screen")(
+      "trials", boost::program_options::value<std::size_t>(&trials)->default_value(trials),
+      "Number of collision checks to perform with each thread")(
+      "states", boost::program_options::value<std::size_t>(&num_states)->default_value(num_states),
+      "Number of random robot states that are checked in turn")(
+      "objects", boost::program_options::value<std::string>(&objects)->default_value(objects),
+      "Comma-separated numbers of box objects in the world")(
+      "triangles", boost::program_options::value<std::string>(&triangles)->default_value(triangles),
+      "Comma-separated numbers of triangles of each mesh object in the world")(
+      "occupancy", boost::program_options::value<std::string>(&occupancy)->default_value(occupancy),
+      "Comma-separated fractions of occupied octomap cells")(
+      "threads", boost::program_options::value<std::string>(&threads)->default_value(threads),
+      "Comma-separated numbers of checking threads")(
+      "detectors", boost::program_options::value<std::string>(&detectors)->default_value(detectors),
+      "Comma-separated collision detectors to evaluate (FCL, Bullet, DistanceField)")(
+      "output", boost::program_options::value<std::string>(&output),
+      "CSV file to write the results to, instead of standard output");
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << '\n';
+    return 0;
+  }
+
+  robot_model_loader::RobotModelLoader loader(node, ROBOT_DESCRIPTION);
+  const moveit::core::RobotModelPtr& robot_model = loader.getModel();
+  if (!robot_model)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to load the robot model from '%s'", ROBOT_DESCRIPTION.c_str());
+    return 1;
+  }
+
+  // The same states are checked in every configuration, so the results of all detectors are comparable
+  std::vector<moveit::core::RobotState> states(std::max<std::size_t>(1, num_states),
+                                               moveit::core::RobotState(robot_model));
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions();
+    state.update();
+  }
+
+  std::vector<collision_detection::CollisionDetectorAllocatorPtr> allocators;
+  std::vector<std::string> detector_names;
+  boost::split(detector_names, detectors, boost::is_any_of(","), boost::token_compress_on);
+  for (const std::string& name : detector_names)
+  {
+    if (name == "FCL")
+      allocators.push_back(collision_detection::CollisionDetectorAllocatorFCL::create());
+    else if (name == "Bullet")
+      allocators.push_back(collision_detection::CollisionDetectorAllocatorBullet::create());
+    else if (name == "DistanceField")
+      allocators.push_back(collision_detection::CollisionDetectorAllocatorDistanceField::create());
+    else if (!name.empty())
+      RCLCPP_WARN(LOGGER, "Unknown collision detector '%s'", name.c_str());
+  }
+
+  // Each sweep varies one property of the world, starting from an empty world
+  using WorldGenerator =
+      std::function<void(collision_detection::World&, double, random_numbers::RandomNumberGenerator&)>;
+  const std::vector<std::tuple<std::string, std::vector<double>, WorldGenerator>> sweeps = {
+    { "objects", parseValues(objects),
+      [](collision_detection::World& world, double value, random_numbers::RandomNumberGenerator& rng) {
+        addBoxes(world, static_cast<std::size_t>(value), rng);
+      } },
+    { "triangles", parseValues(triangles),
+      [](collision_detection::World& world, double value, random_numbers::RandomNumberGenerator& rng) {
+        addMeshes(world, static_cast<std::size_t>(value), rng);
+      } },
+    { "occupancy", parseValues(occupancy), addOctomap },
+  };
+
+  std::ofstream output_file;
+  if (!output.empty())
+  {
+    output_file.open(output);
+    if (!output_file)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to open '%s' for writing", output.c_str());
+      return 1;
+    }
+  }
+  std::ostream& out = output.empty() ? std::cout : output_file;
+  out << "detector,sweep,value,threads,checks_per_second,collision_fraction" << '\n';
+
+  for (const auto& [sweep, values, generator] : sweeps)
+  {
+    for (double value : values)
+    {
+      // Generate the world once per value, so all detectors check the same geometry
+      auto world = std::make_shared<collision_detection::World>();
+      random_numbers::RandomNumberGenerator rng(42);
+      generator(*world, value, rng);
+
+      for (const collision_detection::CollisionDetectorAllocatorPtr& allocator : allocators)
+      {
+        auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model, world);
+        scene->allocateCollisionDetector(allocator);
+        for (double thread_count : parseValues(threads))
+        {
+          double collision_fraction = 0.0;
+          const double throughput = measureThroughput(
+              scene, states, trials, std::max<std::size_t>(1, static_cast<std::size_t>(thread_count)),
+              collision_fraction);
+          out << allocator->getName() << ',' << sweep << ',' << value << ',' << thread_count << ',' << throughput
+              << ',' << collision_fraction << '\n';
+          RCLCPP_INFO(LOGGER, "%s with %s = %g and %g threads: %.1f checks per second", allocator->getName().c_str(),
+                      sweep.c_str(), value, thread_count, throughput);
+        }
+      }
+    }
+  }
+
+  rclcpp::shutdown();
+  return 0;
+}
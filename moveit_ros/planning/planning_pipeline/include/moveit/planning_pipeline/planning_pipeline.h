@@ -43,7 +43,11 @@
 #include <moveit_msgs/msg/display_trajectory.hpp>
 #include <visualization_msgs/msg/marker_array.hpp>
 
+#include <array>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 
 #include <moveit_planning_pipeline_export.h>
 
@@ -108,6 +112,45 @@ public:
    * This is true by default.  */
   void checkSolutionPaths(bool flag);
 
+  /** \brief Set how many results of generatePlan() are cached for repeated requests. 0 disables the cache, which is
+   * the default unless the plan_cache.size parameter is set.
+   *
+   * A request is looked up by a fingerprint of its start state, quantized to the resolution set by
+   * setPlanCacheStateResolution(), and of all its other fields except the planning time and attempts. A cached
+   * trajectory is returned right away if the scene has not changed since it was planned or validated, and is
+   * re-validated against the scene otherwise. */
+  void setPlanCacheSize(std::size_t size);
+
+  /** \brief Set the resolution (in the units of the joint variables) to which start states are quantized for looking
+   * up the plan cache. Default is 1e-4, or the plan_cache.state_resolution parameter. */
+  void setPlanCacheStateResolution(double resolution);
+
+  /** \brief Remove all results from the plan cache */
+  void clearPlanCache();
+
+  /** \brief Provides stored trajectories that may solve a request, e.g. the nearest entries of a trajectory library */
+  using PlanCandidateSourceFn = std::function<std::vector<robot_trajectory::RobotTrajectoryConstPtr>(
+      const planning_scene::PlanningSceneConstPtr& planning_scene, const planning_interface::MotionPlanRequest& req)>;
+
+  /** \brief Try the trajectories of \e source before planning, right after the plan cache. The first candidate that
+   * starts at the start state of the request (within setPlanCandidateStartTolerance()), ends in one of its goals and
+   * is valid in the scene is returned as it is, without passing through the planning request adapters. An empty
+   * function, the default, disables candidates. Not thread-safe with generatePlan(). */
+  void setPlanCandidateSource(const PlanCandidateSourceFn& source);
+
+  /** \brief Set the maximum difference of each joint variable between the start state of a request and the first
+   * waypoint of a usable candidate. Default is 1e-3, or the plan_candidates.start_tolerance parameter. */
+  void setPlanCandidateStartTolerance(double tolerance);
+
+  /** \brief Get the size set by setPlanCacheSize() */
+  std::size_t getPlanCacheSize() const
+  {
+    return plan_cache_size_;
+  }
+
+  /** \brief Estimate the memory of the plan cache ("plan_cache") and of the planner plugin ("planner.*") */
+  moveit::MemoryUsage getMemoryUsage() const;
+
   /** \brief Get the flag set by displayComputedMotionPlans() */
   bool getDisplayComputedMotionPlans() const
   {
@@ -146,6 +189,23 @@ public:
                     const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                     std::vector<std::size_t>& adapter_added_state_index) const;
 
+  /** \brief Called by generatePlans() for each request once it is done, with its index and response. Calls are
+   * serialized, but come from the planning threads. */
+  using PlanCallbackFn = std::function<void(std::size_t, const planning_interface::MotionPlanResponse&)>;
+
+  /** \brief Plan a batch of requests concurrently on the same scene and return their responses, in request order.
+      \param planning_scene The planning scene where motion planning is to be done, shared by all requests. This is
+     typically a snapshot of the monitored scene.
+      \param reqs The requests for motion planning
+      \param allowed_planning_time The budget of the whole batch in seconds. A request is allowed the remaining budget
+     at most when it starts planning, and requests that did not start within the budget fail with TIMED_OUT.
+      \param max_concurrency The number of requests planned at once. 0 uses one thread per hardware thread.
+      \param callback If set, called for each request as soon as it is done */
+  std::vector<planning_interface::MotionPlanResponse>
+  generatePlans(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                const std::vector<planning_interface::MotionPlanRequest>& reqs, double allowed_planning_time,
+                std::size_t max_concurrency = 0, const PlanCallbackFn& callback = PlanCallbackFn()) const;
+
   /** \brief Request termination, if a generatePlan() function is currently computing plans */
   void terminate() const;
 
@@ -176,6 +236,23 @@ public:
 private:
   void configure();
 
+  /** \brief Compute the fingerprint of \e req by which results are looked up in the plan cache */
+  std::size_t computePlanCacheKey(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                  const planning_interface::MotionPlanRequest& req) const;
+
+  /** \brief Fill \e res with a cached result for \e key that is valid in \e planning_scene, if there is one */
+  bool lookUpPlanCache(std::size_t key, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                       const planning_interface::MotionPlanRequest& req,
+                       planning_interface::MotionPlanResponse& res) const;
+
+  void storeInPlanCache(std::size_t key, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_interface::MotionPlanResponse& res) const;
+
+  /** \brief Fill \e res with the first usable trajectory of the plan candidate source, if there is one */
+  bool lookUpPlanCandidates(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest& req,
+                            planning_interface::MotionPlanResponse& res) const;
+
   std::shared_ptr<rclcpp::Node> node_;
   std::string parameter_namespace_;
   /// Flag indicating whether motion plans should be published as a moveit_msgs::msg::DisplayTrajectory
@@ -200,6 +277,23 @@ private:
   /// Flag indicating whether the reported plans should be checked once again, by the planning pipeline itself
   bool check_solution_paths_;
   rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr contacts_publisher_;
+
+  /// A cached result of generatePlan(), along with the versions of the scene it was last known to be valid in
+  struct PlanCacheEntry
+  {
+    std::size_t key;
+    std::array<std::size_t, 5> scene_versions;
+    robot_trajectory::RobotTrajectoryConstPtr trajectory;
+  };
+
+  std::size_t plan_cache_size_;
+  double plan_cache_state_resolution_;
+  /// The cached results, the most recently used first. Guarded by plan_cache_mutex_, as generatePlan() is const.
+  mutable std::list<PlanCacheEntry> plan_cache_;
+  mutable std::mutex plan_cache_mutex_;
+
+  PlanCandidateSourceFn plan_candidate_source_;
+  double plan_candidate_start_tolerance_;
 };
 
 MOVEIT_CLASS_FORWARD(PlanningPipeline);  // Defines PlanningPipelinePtr, ConstPtr, WeakPtr... etc
@@ -37,13 +37,73 @@
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/collision_detection/collision_tools.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
+#include <moveit/utils/performance_counters.h>
+#include <moveit/utils/tracing.h>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <boost/functional/hash.hpp>
+#include <rclcpp/serialization.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <sstream>
+#include <string_view>
+#include <thread>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros_planning.planning_pipeline");
 
+namespace
+{
+// The versions of the scene components a planned trajectory depends on, in addition to the request
+std::array<std::size_t, 5> getSceneVersions(const planning_scene::PlanningScene& planning_scene)
+{
+  return { planning_scene.getWorldVersion(), planning_scene.getAllowedCollisionMatrixVersion(),
+           planning_scene.getTransformsVersion(), planning_scene.getCollisionEnvVersion(),
+           planning_scene.getStateFeasibilityVersion() };
+}
+
+// Time stamps of constraints do not change their meaning, but would make every request look new
+void clearStamps(moveit_msgs::msg::Constraints& constraints)
+{
+  for (auto& constraint : constraints.position_constraints)
+    constraint.header.stamp = builtin_interfaces::msg::Time();
+  for (auto& constraint : constraints.orientation_constraints)
+    constraint.header.stamp = builtin_interfaces::msg::Time();
+  for (auto& constraint : constraints.visibility_constraints)
+    constraint.target_pose.header.stamp = builtin_interfaces::msg::Time();
+}
+
+// Logs the operations performed while planning a request. The counters are summed over all threads, so requests
+// planned concurrently are included in each other's numbers.
+class RequestCounterReport
+{
+public:
+  RequestCounterReport() : start_(moveit::performance_counters::getTotalCounterValues())
+  {
+  }
+
+  ~RequestCounterReport()
+  {
+    const moveit::performance_counters::CounterValues values =
+        moveit::performance_counters::getTotalCounterValues() - start_;
+    std::stringstream ss;
+    for (std::size_t i = 0; i < moveit::performance_counters::NUM_COUNTERS; ++i)
+    {
+      const auto counter = static_cast<moveit::performance_counters::Counter>(i);
+      ss << ' ' << moveit::performance_counters::getCounterName(counter) << ": " << values.counts[i] << " ("
+         << std::chrono::duration<double>(values.durations[i]).count() << "s)";
+    }
+    RCLCPP_DEBUG(LOGGER, "Planning request performed%s", ss.str().c_str());
+  }
+
+private:
+  const moveit::performance_counters::CounterValues start_;
+};
+}  // namespace
+
 const std::string planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC = "display_planned_path";
 const std::string planning_pipeline::PlanningPipeline::MOTION_PLAN_REQUEST_TOPIC = "motion_plan_request";
 const std::string planning_pipeline::PlanningPipeline::MOTION_CONTACTS_TOPIC = "display_contacts";
@@ -99,6 +159,25 @@ void planning_pipeline::PlanningPipeline::configure()
   check_solution_paths_ = false;  // this is set to true below
   publish_received_requests_ = false;
   display_computed_motion_plans_ = false;  // this is set to true below
+  plan_cache_size_ = 0;
+  plan_cache_state_resolution_ = 1e-4;
+  plan_candidate_start_tolerance_ = 1e-3;
+
+  const std::string plan_cache_ns =
+      parameter_namespace_.empty() ? "plan_cache." : parameter_namespace_ + ".plan_cache.";
+  if (node_->has_parameter(plan_cache_ns + "size"))
+  {
+    const int64_t plan_cache_size = node_->get_parameter(plan_cache_ns + "size").as_int();
+    plan_cache_size_ = static_cast<std::size_t>(std::max<int64_t>(plan_cache_size, 0));
+  }
+  if (node_->has_parameter(plan_cache_ns + "state_resolution"))
+    setPlanCacheStateResolution(node_->get_parameter(plan_cache_ns + "state_resolution").as_double());
+  if (plan_cache_size_ > 0)
+    RCLCPP_INFO(LOGGER, "Caching up to %zu planning results", plan_cache_size_);
+  const std::string plan_candidates_ns =
+      parameter_namespace_.empty() ? "plan_candidates." : parameter_namespace_ + ".plan_candidates.";
+  if (node_->has_parameter(plan_candidates_ns + "start_tolerance"))
+    setPlanCandidateStartTolerance(node_->get_parameter(plan_candidates_ns + "start_tolerance").as_double());
 
   // load the planning plugin
   try
@@ -229,6 +308,208 @@ void planning_pipeline::PlanningPipeline::checkSolutionPaths(bool flag)
   check_solution_paths_ = flag;
 }
 
+void planning_pipeline::PlanningPipeline::setPlanCacheSize(std::size_t size)
+{
+  std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+  plan_cache_size_ = size;
+  if (plan_cache_.size() > plan_cache_size_)
+    plan_cache_.resize(plan_cache_size_);
+}
+
+void planning_pipeline::PlanningPipeline::setPlanCacheStateResolution(double resolution)
+{
+  if (resolution <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "The state resolution of the plan cache must be positive, ignoring %f", resolution);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+  plan_cache_state_resolution_ = resolution;
+  plan_cache_.clear();  // the keys depend on the resolution
+}
+
+void planning_pipeline::PlanningPipeline::clearPlanCache()
+{
+  std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+  plan_cache_.clear();
+}
+
+void planning_pipeline::PlanningPipeline::setPlanCandidateSource(const PlanCandidateSourceFn& source)
+{
+  plan_candidate_source_ = source;
+}
+
+void planning_pipeline::PlanningPipeline::setPlanCandidateStartTolerance(double tolerance)
+{
+  if (tolerance < 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "The plan candidate start tolerance must not be negative, keeping %g",
+                 plan_candidate_start_tolerance_);
+    return;
+  }
+  plan_candidate_start_tolerance_ = tolerance;
+}
+
+moveit::MemoryUsage planning_pipeline::PlanningPipeline::getMemoryUsage() const
+{
+  moveit::MemoryUsage usage;
+  {
+    std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+    std::size_t bytes = 0;
+    for (const PlanCacheEntry& entry : plan_cache_)
+      bytes += sizeof(PlanCacheEntry) + (entry.trajectory ? entry.trajectory->getMemoryUsage() : 0);
+    usage.add("plan_cache", bytes, plan_cache_.size());
+  }
+  if (planner_instance_)
+    usage.add("planner", planner_instance_->getMemoryUsage());
+  return usage;
+}
+
+std::size_t
+planning_pipeline::PlanningPipeline::computePlanCacheKey(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                         const planning_interface::MotionPlanRequest& req) const
+{
+  std::size_t key = 0;
+
+  // the start state, quantized so that states within the resolution share a key
+  moveit::core::RobotState start_state = planning_scene->getCurrentState();
+  moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+  for (std::size_t i = 0; i < start_state.getVariableCount(); ++i)
+    boost::hash_combine(key, std::llround(start_state.getVariablePosition(i) / plan_cache_state_resolution_));
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  start_state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    boost::hash_combine(key, attached_body->getName());
+    boost::hash_combine(key, attached_body->getAttachedLinkName());
+  }
+
+  // all other fields of the request that may change its result
+  planning_interface::MotionPlanRequest rest = req;
+  rest.start_state = moveit_msgs::msg::RobotState();
+  rest.allowed_planning_time = 0.0;
+  rest.num_planning_attempts = 0;
+  rest.workspace_parameters.header.stamp = builtin_interfaces::msg::Time();
+  for (auto& goal_constraints : rest.goal_constraints)
+    clearStamps(goal_constraints);
+  clearStamps(rest.path_constraints);
+  rclcpp::Serialization<moveit_msgs::msg::MotionPlanRequest> serialization;
+  rclcpp::SerializedMessage serialized_rest;
+  serialization.serialize_message(&rest, &serialized_rest);
+  const rcl_serialized_message_t& buffer = serialized_rest.get_rcl_serialized_message();
+  boost::hash_combine(key, std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(buffer.buffer),
+                                                                          buffer.buffer_length)));
+  return key;
+}
+
+bool planning_pipeline::PlanningPipeline::lookUpPlanCache(std::size_t key,
+                                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                          const planning_interface::MotionPlanRequest& req,
+                                                          planning_interface::MotionPlanResponse& res) const
+{
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto matches_key = [key](const PlanCacheEntry& entry) { return entry.key == key; };
+
+  std::unique_lock<std::mutex> lock(plan_cache_mutex_);
+  auto it = std::find_if(plan_cache_.begin(), plan_cache_.end(), matches_key);
+  if (it == plan_cache_.end() || it->trajectory->getGroupName() != req.group_name)
+    return false;
+  plan_cache_.splice(plan_cache_.begin(), plan_cache_, it);
+  const PlanCacheEntry entry = plan_cache_.front();
+  lock.unlock();
+
+  // re-validate the trajectory, unless the scene has not changed since it was last found valid
+  const std::array<std::size_t, 5> scene_versions = getSceneVersions(*planning_scene);
+  if (entry.scene_versions != scene_versions)
+  {
+    const bool valid = planning_scene->isPathValid(*entry.trajectory, req.path_constraints, req.group_name);
+    lock.lock();
+    it = std::find_if(plan_cache_.begin(), plan_cache_.end(), matches_key);
+    if (!valid)
+    {
+      RCLCPP_DEBUG(LOGGER, "Cached plan is not valid in the current scene anymore");
+      if (it != plan_cache_.end())
+        plan_cache_.erase(it);
+      return false;
+    }
+    if (it != plan_cache_.end())
+      it->scene_versions = scene_versions;
+    lock.unlock();
+  }
+
+  res.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(*entry.trajectory, true /* deepcopy */);
+  res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  res.planning_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  RCLCPP_DEBUG(LOGGER, "Reusing a cached plan, found in %fs", res.planning_time_);
+  return true;
+}
+
+void planning_pipeline::PlanningPipeline::storeInPlanCache(std::size_t key,
+                                                           const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                           const planning_interface::MotionPlanResponse& res) const
+{
+  PlanCacheEntry entry;
+  entry.key = key;
+  entry.scene_versions = getSceneVersions(*planning_scene);
+  entry.trajectory = std::make_shared<const robot_trajectory::RobotTrajectory>(*res.trajectory_, true /* deepcopy */);
+
+  std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+  plan_cache_.remove_if([key](const PlanCacheEntry& cached) { return cached.key == key; });
+  plan_cache_.push_front(std::move(entry));
+  if (plan_cache_.size() > plan_cache_size_)
+    plan_cache_.resize(plan_cache_size_);
+}
+
+bool planning_pipeline::PlanningPipeline::lookUpPlanCandidates(
+    const planning_scene::PlanningSceneConstPtr& planning_scene, const planning_interface::MotionPlanRequest& req,
+    planning_interface::MotionPlanResponse& res) const
+{
+  const auto start_time = std::chrono::steady_clock::now();
+  if (!robot_model_->hasJointModelGroup(req.group_name))
+    return false;
+  const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup(req.group_name);
+  const std::vector<robot_trajectory::RobotTrajectoryConstPtr> candidates = plan_candidate_source_(planning_scene, req);
+  if (candidates.empty())
+    return false;
+
+  moveit::core::RobotState start_state = planning_scene->getCurrentState();
+  moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+  std::vector<double> start_values;
+  start_state.copyJointGroupPositions(jmg, start_values);
+
+  std::vector<std::unique_ptr<kinematic_constraints::KinematicConstraintSet>> goals;
+  for (const moveit_msgs::msg::Constraints& goal : req.goal_constraints)
+  {
+    goals.push_back(std::make_unique<kinematic_constraints::KinematicConstraintSet>(robot_model_));
+    goals.back()->add(goal, planning_scene->getTransforms());
+  }
+
+  std::vector<double> values;
+  for (const robot_trajectory::RobotTrajectoryConstPtr& candidate : candidates)
+  {
+    if (!candidate || candidate->empty() || candidate->getGroupName() != req.group_name)
+      continue;
+    candidate->getFirstWayPoint().copyJointGroupPositions(jmg, values);
+    bool at_start = true;
+    for (std::size_t i = 0; i < values.size() && at_start; ++i)
+      at_start = std::fabs(values[i] - start_values[i]) <= plan_candidate_start_tolerance_;
+    const moveit::core::RobotState& last = candidate->getLastWayPoint();
+    const bool at_goal = goals.empty() || std::any_of(goals.begin(), goals.end(), [&last](const auto& goal) {
+                           return goal->satisfied(last);
+                         });
+    if (!at_start || !at_goal || !planning_scene->isPathValid(*candidate, req.path_constraints, req.group_name))
+      continue;
+
+    res.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(*candidate, true /* deepcopy */);
+    res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+    res.planning_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    RCLCPP_DEBUG(LOGGER, "Reusing a stored trajectory out of %zu candidates, found in %fs", candidates.size(),
+                 res.planning_time_);
+    return true;
+  }
+  return false;
+}
+
 bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::PlanningSceneConstPtr& planning_scene,
                                                        const planning_interface::MotionPlanRequest& req,
                                                        planning_interface::MotionPlanResponse& res) const
@@ -242,6 +523,11 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
                                                        planning_interface::MotionPlanResponse& res,
                                                        std::vector<std::size_t>& adapter_added_state_index) const
 {
+  moveit::tracing::ScopedSpan span("PlanningPipeline::generatePlan");
+#ifdef MOVEIT_ENABLE_PERFORMANCE_COUNTERS
+  const RequestCounterReport counter_report;
+#endif
+
   // broadcast the request we are about to work on, if needed
   if (publish_received_requests_)
     received_request_publisher_->publish(req);
@@ -253,11 +539,32 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     return false;
   }
 
+  std::size_t plan_cache_key = 0;
+  if (plan_cache_size_ > 0)
+  {
+    moveit::tracing::ScopedSpan cache_span("plan cache lookup");
+    plan_cache_key = computePlanCacheKey(planning_scene, req);
+    if (lookUpPlanCache(plan_cache_key, planning_scene, req, res))
+      return true;
+  }
+
+  if (plan_candidate_source_)
+  {
+    moveit::tracing::ScopedSpan candidates_span("plan candidate lookup");
+    if (lookUpPlanCandidates(planning_scene, req, res))
+    {
+      if (plan_cache_size_ > 0)
+        storeInPlanCache(plan_cache_key, planning_scene, res);
+      return true;
+    }
+  }
+
   bool solved = false;
   try
   {
     if (adapter_chain_)
     {
+      moveit::tracing::ScopedSpan chain_span("planning request adapter chain");
       solved = adapter_chain_->adaptAndPlan(planner_instance_, planning_scene, req, res, adapter_added_state_index);
       if (!adapter_added_state_index.empty())
       {
@@ -269,8 +576,12 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     }
     else
     {
-      planning_interface::PlanningContextPtr context =
-          planner_instance_->getPlanningContext(planning_scene, req, res.error_code_);
+      planning_interface::PlanningContextPtr context;
+      {
+        moveit::tracing::ScopedSpan context_span("getPlanningContext");
+        context = planner_instance_->getPlanningContext(planning_scene, req, res.error_code_);
+      }
+      moveit::tracing::ScopedSpan solve_span("PlanningContext::solve");
       solved = context ? context->solve(res) : false;
     }
   }
@@ -287,6 +598,7 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     RCLCPP_DEBUG(LOGGER, "Motion planner reported a solution path with %ld states", state_count);
     if (check_solution_paths_)
     {
+      moveit::tracing::ScopedSpan check_span("solution path validity check");
       visualization_msgs::msg::MarkerArray arr;
       visualization_msgs::msg::Marker m;
       m.action = visualization_msgs::msg::Marker::DELETEALL;
@@ -400,9 +712,71 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
                           "equivalent?");
   }
 
+  if (solved && valid && res.trajectory_ && plan_cache_size_ > 0)
+    storeInPlanCache(plan_cache_key, planning_scene, res);
+
   return solved && valid;
 }
 
+std::vector<planning_interface::MotionPlanResponse>
+planning_pipeline::PlanningPipeline::generatePlans(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                   const std::vector<planning_interface::MotionPlanRequest>& reqs,
+                                                   double allowed_planning_time, std::size_t max_concurrency,
+                                                   const PlanCallbackFn& callback) const
+{
+  std::vector<planning_interface::MotionPlanResponse> responses(reqs.size());
+  if (reqs.empty())
+    return responses;
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(allowed_planning_time);
+  std::atomic<std::size_t> next_request(0);
+  std::mutex callback_mutex;
+
+  // each worker plans the next request that has not been started yet, until all requests are done
+  const auto plan_requests = [&]() {
+    for (std::size_t i = next_request++; i < reqs.size(); i = next_request++)
+    {
+      planning_interface::MotionPlanResponse& res = responses[i];
+      const double remaining_time =
+          std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+      if (remaining_time <= 0.0)
+      {
+        res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::TIMED_OUT;
+      }
+      else
+      {
+        planning_interface::MotionPlanRequest req = reqs[i];
+        if (req.allowed_planning_time <= 0.0 || req.allowed_planning_time > remaining_time)
+          req.allowed_planning_time = remaining_time;
+        const bool solved = generatePlan(planning_scene, req, res);
+        if (!solved && res.error_code_.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+          res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+      }
+      if (callback)
+      {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        callback(i, res);
+      }
+    }
+  };
+
+  if (max_concurrency == 0)
+    max_concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+  const std::size_t thread_count = std::min(max_concurrency, reqs.size());
+  RCLCPP_DEBUG(LOGGER, "Planning %zu requests with %zu threads within %fs", reqs.size(), thread_count,
+               allowed_planning_time);
+
+  // the calling thread is one of the workers
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (std::size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(plan_requests);
+  plan_requests();
+  for (std::thread& thread : threads)
+    thread.join();
+  return responses;
+}
+
 void planning_pipeline::PlanningPipeline::terminate() const
 {
   if (planner_instance_)
@@ -60,21 +60,17 @@ public:
     return "Add Ruckig trajectory smoothing.";
   }
 
-  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                    std::vector<std::size_t>& /*added_path_index*/) const override
+  Stage getStage() const override
   {
-    bool result = planner(planning_scene, req, res);
-    if (result && res.trajectory_)
-    {
-      if (!smoother_.applySmoothing(*res.trajectory_, req.max_velocity_scaling_factor,
-                                    req.max_acceleration_scaling_factor))
-      {
-        result = false;
-      }
-    }
+    return Stage::POST_PLANNING;
+  }
 
-    return result;
+  bool adaptResponse(const planning_scene::PlanningSceneConstPtr& /*planning_scene*/,
+                     const planning_interface::MotionPlanRequest& req,
+                     planning_interface::MotionPlanResponse& res) const override
+  {
+    return smoother_.applySmoothing(*res.trajectory_, req.max_velocity_scaling_factor,
+                                    req.max_acceleration_scaling_factor);
   }
 
 private:
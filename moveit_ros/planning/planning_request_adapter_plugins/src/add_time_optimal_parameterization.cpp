@@ -64,24 +64,24 @@ public:
     return "Add Time Optimal Parameterization";
   }
 
-  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                    std::vector<std::size_t>& /*added_path_index*/) const override
+  Stage getStage() const override
   {
-    bool result = planner(planning_scene, req, res);
-    if (result && res.trajectory_)
+    return Stage::POST_PLANNING;
+  }
+
+  bool adaptResponse(const planning_scene::PlanningSceneConstPtr& /*planning_scene*/,
+                     const planning_interface::MotionPlanRequest& req,
+                     planning_interface::MotionPlanResponse& res) const override
+  {
+    RCLCPP_DEBUG(LOGGER, " Running '%s'", getDescription().c_str());
+    TimeOptimalTrajectoryGeneration totg(path_tolerance_, resample_dt_, min_angle_change_);
+    if (!totg.computeTimeStamps(*res.trajectory_, req.max_velocity_scaling_factor,
+                                req.max_acceleration_scaling_factor))
     {
-      RCLCPP_DEBUG(LOGGER, " Running '%s'", getDescription().c_str());
-      TimeOptimalTrajectoryGeneration totg(path_tolerance_, resample_dt_, min_angle_change_);
-      if (!totg.computeTimeStamps(*res.trajectory_, req.max_velocity_scaling_factor,
-                                  req.max_acceleration_scaling_factor))
-      {
-        RCLCPP_WARN(LOGGER, " Time parametrization for the solution path failed.");
-        result = false;
-      }
+      RCLCPP_WARN(LOGGER, " Time parametrization for the solution path failed.");
+      return false;
     }
-
-    return result;
+    return true;
   }
 
 protected:
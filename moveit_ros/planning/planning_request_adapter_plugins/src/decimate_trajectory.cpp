@@ -0,0 +1,184 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <class_loader/class_loader.hpp>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace default_planner_request_adapters
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.decimate_trajectory");
+
+/** @brief This adapter removes the waypoints of a path that is not time parameterized yet, which lie within a
+ * joint-space tolerance of the straight segment between the remaining waypoints. A waypoint is only removed if the
+ * states along that segment are valid in the planning scene. Run it before the time parameterization, so that the
+ * following stages process fewer waypoints. */
+class DecimateTrajectory : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  void initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) override
+  {
+    path_tolerance_ = getParam(node, LOGGER, parameter_namespace, "decimation_path_tolerance", 0.01);
+    check_resolution_ = getParam(node, LOGGER, parameter_namespace, "decimation_check_resolution", 0.05);
+    if (check_resolution_ <= 0.0)
+    {
+      check_resolution_ = 0.05;
+      RCLCPP_WARN(LOGGER, "Param 'decimation_check_resolution' needs to be positive.");
+    }
+  }
+
+  std::string getDescription() const override
+  {
+    return "Decimate Trajectory";
+  }
+
+  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                    std::vector<std::size_t>& added_path_index) const override
+  {
+    bool result = planner(planning_scene, req, res);
+    if (result && res.trajectory_ && res.trajectory_->getGroup() && res.trajectory_->getWayPointCount() > 2)
+    {
+      RCLCPP_DEBUG(LOGGER, " Running '%s'", getDescription().c_str());
+      if (res.trajectory_->getDuration() > 0.0)
+      {
+        RCLCPP_DEBUG(LOGGER, "Not decimating a trajectory that is already time parameterized.");
+        return result;
+      }
+      decimate(*planning_scene, req, *res.trajectory_, added_path_index);
+    }
+    return result;
+  }
+
+private:
+  /** @brief Greedily connect each kept waypoint to the farthest following one that keeps the skipped waypoints within
+   * tolerance and a valid segment. Waypoints added by other adapters are always kept. */
+  void decimate(const planning_scene::PlanningScene& planning_scene, const planning_interface::MotionPlanRequest& req,
+                robot_trajectory::RobotTrajectory& trajectory, std::vector<std::size_t>& added_path_index) const
+  {
+    const std::size_t waypoint_count = trajectory.getWayPointCount();
+    std::vector<bool> fixed(waypoint_count, false);
+    for (std::size_t index : added_path_index)
+    {
+      if (index < waypoint_count)
+        fixed[index] = true;
+    }
+
+    moveit::core::RobotState state(trajectory.getFirstWayPoint());
+    std::vector<std::size_t> kept{ 0 };
+    std::size_t anchor = 0;
+    while (anchor + 1 < waypoint_count)
+    {
+      std::size_t end = anchor + 1;
+      while (end + 1 < waypoint_count && !fixed[end] && isWithinTolerance(trajectory, anchor, end + 1, state))
+        ++end;
+      // The original segments are valid, so shortening the segment eventually succeeds
+      while (end > anchor + 1 &&
+             !(isWithinTolerance(trajectory, anchor, end, state) &&
+               isSegmentValid(planning_scene, req, trajectory, anchor, end, state)))
+        end = anchor + (end - anchor) / 2;
+      kept.push_back(end);
+      anchor = end;
+    }
+
+    if (kept.size() == waypoint_count)
+      return;
+    RCLCPP_DEBUG(LOGGER, "Decimated trajectory from %zu to %zu waypoints", waypoint_count, kept.size());
+
+    robot_trajectory::RobotTrajectory decimated(trajectory.getRobotModel(), trajectory.getGroup());
+    for (std::size_t index : kept)
+      decimated.addSuffixWayPoint(trajectory.getWayPointPtr(index), trajectory.getWayPointDurationFromPrevious(index));
+    trajectory.swap(decimated);
+
+    for (std::size_t& index : added_path_index)
+      index = std::lower_bound(kept.begin(), kept.end(), index) - kept.begin();
+  }
+
+  /** @brief Test if the waypoints between begin and end are tolerance-close to the straight segment between them */
+  bool isWithinTolerance(const robot_trajectory::RobotTrajectory& trajectory, std::size_t begin, std::size_t end,
+                         moveit::core::RobotState& state) const
+  {
+    const moveit::core::JointModelGroup* group = trajectory.getGroup();
+    std::vector<double> lengths{ 0.0 };
+    for (std::size_t i = begin + 1; i <= end; ++i)
+    {
+      lengths.push_back(lengths.back() + trajectory.getWayPoint(i).distance(trajectory.getWayPoint(i - 1), group));
+    }
+    if (lengths.back() <= 0.0)
+      return true;
+
+    const moveit::core::RobotState& from = trajectory.getWayPoint(begin);
+    const moveit::core::RobotState& to = trajectory.getWayPoint(end);
+    for (std::size_t i = begin + 1; i < end; ++i)
+    {
+      from.interpolate(to, lengths[i - begin] / lengths.back(), state);
+      if (state.distance(trajectory.getWayPoint(i), group) > path_tolerance_)
+        return false;
+    }
+    return true;
+  }
+
+  /** @brief Test the states along the straight segment between begin and end at the check resolution */
+  bool isSegmentValid(const planning_scene::PlanningScene& planning_scene,
+                      const planning_interface::MotionPlanRequest& req,
+                      const robot_trajectory::RobotTrajectory& trajectory, std::size_t begin, std::size_t end,
+                      moveit::core::RobotState& state) const
+  {
+    const moveit::core::RobotState& from = trajectory.getWayPoint(begin);
+    const moveit::core::RobotState& to = trajectory.getWayPoint(end);
+    const std::size_t steps =
+        static_cast<std::size_t>(std::ceil(from.distance(to, trajectory.getGroup()) / check_resolution_));
+    for (std::size_t i = 1; i < steps; ++i)
+    {
+      from.interpolate(to, static_cast<double>(i) / static_cast<double>(steps), state);
+      state.update();
+      if (!planning_scene.isStateValid(state, req.path_constraints, req.group_name))
+        return false;
+    }
+    return true;
+  }
+
+  double path_tolerance_;
+  double check_resolution_;
+};
+
+}  // namespace default_planner_request_adapters
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::DecimateTrajectory,
+                            planning_request_adapter::PlanningRequestAdapter)
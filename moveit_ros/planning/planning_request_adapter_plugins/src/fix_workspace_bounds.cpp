@@ -62,25 +62,25 @@ public:
     return "Fix Workspace Bounds";
   }
 
-  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                    std::vector<std::size_t>& /*added_path_index*/) const override
+  Stage getStage() const override
+  {
+    return Stage::PRE_PLANNING;
+  }
+
+  bool adaptRequest(const planning_scene::PlanningSceneConstPtr& /*planning_scene*/,
+                    planning_interface::MotionPlanRequest& req) const override
   {
     RCLCPP_DEBUG(LOGGER, "Running '%s'", getDescription().c_str());
-    const moveit_msgs::msg::WorkspaceParameters& wparams = req.workspace_parameters;
+    moveit_msgs::msg::WorkspaceParameters& wparams = req.workspace_parameters;
     if (wparams.min_corner.x == wparams.max_corner.x && wparams.min_corner.x == 0.0 &&
         wparams.min_corner.y == wparams.max_corner.y && wparams.min_corner.y == 0.0 &&
         wparams.min_corner.z == wparams.max_corner.z && wparams.min_corner.z == 0.0)
     {
       RCLCPP_DEBUG(LOGGER, "It looks like the planning volume was not specified. Using default values.");
-      planning_interface::MotionPlanRequest req2 = req;
-      moveit_msgs::msg::WorkspaceParameters& default_wp = req2.workspace_parameters;
-      default_wp.min_corner.x = default_wp.min_corner.y = default_wp.min_corner.z = -workspace_extent_;
-      default_wp.max_corner.x = default_wp.max_corner.y = default_wp.max_corner.z = workspace_extent_;
-      return planner(planning_scene, req2, res);
+      wparams.min_corner.x = wparams.min_corner.y = wparams.min_corner.z = -workspace_extent_;
+      wparams.max_corner.x = wparams.max_corner.y = wparams.max_corner.z = workspace_extent_;
     }
-    else
-      return planner(planning_scene, req, res);
+    return true;
   }
 
 private:
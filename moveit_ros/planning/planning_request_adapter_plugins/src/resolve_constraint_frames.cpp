@@ -58,16 +58,19 @@ public:
     return "Resolve constraint frames to robot links";
   }
 
-  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                    std::vector<std::size_t>& /*added_path_index*/) const override
+  Stage getStage() const override
+  {
+    return Stage::PRE_PLANNING;
+  }
+
+  bool adaptRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    planning_interface::MotionPlanRequest& req) const override
   {
     RCLCPP_DEBUG(LOGGER, "Running '%s'", getDescription().c_str());
-    planning_interface::MotionPlanRequest modified = req;
-    kinematic_constraints::resolveConstraintFrames(planning_scene->getCurrentState(), modified.path_constraints);
-    for (moveit_msgs::msg::Constraints& constraint : modified.goal_constraints)
+    kinematic_constraints::resolveConstraintFrames(planning_scene->getCurrentState(), req.path_constraints);
+    for (moveit_msgs::msg::Constraints& constraint : req.goal_constraints)
       kinematic_constraints::resolveConstraintFrames(planning_scene->getCurrentState(), constraint);
-    return planner(planning_scene, modified, res);
+    return true;
   }
 };
 
@@ -36,7 +36,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <condition_variable>
@@ -51,6 +53,7 @@
 #include <tf2_ros/buffer.h>
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/planning_scene_monitor/state_history.h>
 
 namespace planning_scene_monitor
 {
@@ -253,6 +256,15 @@ public:
    *  @return Returns the current state */
   moveit::core::RobotStatePtr getCurrentState() const;
 
+  /** @brief Get an immutable snapshot of the current state, with up-to-date link transforms.
+   *
+   *  Snapshots are shared by all callers until the state changes, so repeated reads of an unchanged state neither
+   *  lock nor copy. Use getLatestStateTime() for the time stamp of the state. */
+  std::shared_ptr<const moveit::core::RobotState> getLatestState() const;
+
+  /** @brief Get the time stamp of the last state update, without locking */
+  rclcpp::Time getLatestStateTime() const;
+
   /** @brief Set the state \e upd to the current state maintained by this class. */
   void setToCurrentState(moveit::core::RobotState& upd) const;
 
@@ -263,10 +275,31 @@ public:
    *  @return Returns a pair of the current state and its time stamp */
   std::pair<moveit::core::RobotStatePtr, rclcpp::Time> getCurrentStateAndTime() const;
 
+  /** @brief Copy the variable positions of the current state into \e positions, without copying the robot state
+   *  @return Returns the time stamp of the current state */
+  rclcpp::Time getCurrentStatePositions(std::vector<double>& positions) const;
+
   /** @brief Get the current state values as a map from joint names to joint state values
    *  @return Returns the map from joint names to joint state values*/
   std::map<std::string, double> getCurrentStateValues() const;
 
+  /** @brief Set \e state to the robot state at time \e t, interpolated from the recorded history of states.
+   *
+   *  Times more recent than the last update yield the current state. This does not block on state updates.
+   *  @return false if the history does not reach back to \e t */
+  bool getStateAtTime(const rclcpp::Time& t, moveit::core::RobotState& state) const;
+
+  /** @brief Set the number of past states to keep for getStateAtTime(). This clears the history, 0 disables it. */
+  void setStateHistoryCapacity(std::size_t capacity);
+
+  /** @brief Get the number of past states kept for getStateAtTime() */
+  std::size_t getStateHistoryCapacity() const;
+
+  /** @brief Get the recorded history of states, or nullptr if it is disabled.
+   *
+   *  Its entries hold the positions of all variables of the robot model and can be read without copying robot states */
+  std::shared_ptr<const StateHistory> getStateHistory() const;
+
   /** @brief Wait for at most \e wait_time_s seconds (default 1s) for a robot state more recent than t
    *  @return true on success, false if up-to-date robot state wasn't received within \e wait_time_s
    */
@@ -326,6 +359,16 @@ private:
   void updateMultiDofJoints();
   void transformCallback(const tf2_msgs::msg::TFMessage::ConstSharedPtr& msg, const bool is_static);
 
+  /** @brief Record the current state in the state history. Must be called with state_update_lock_ held. */
+  void recordStateHistory();
+
+  /** @brief A snapshot returned by getLatestState() and the state version it was copied from */
+  struct LatestState
+  {
+    std::shared_ptr<const moveit::core::RobotState> state;
+    std::size_t version;
+  };
+
   std::unique_ptr<MiddlewareHandle> middleware_handle_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   moveit::core::RobotModelConstPtr robot_model_;
@@ -338,6 +381,14 @@ private:
   rclcpp::Time current_state_time_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
 
   mutable std::mutex state_update_lock_;
+  // replaced while holding state_update_lock_, read with std::atomic_load() by getStateAtTime()
+  std::shared_ptr<StateHistory> state_history_;
+  // incremented (while holding state_update_lock_) whenever robot_state_ changes
+  std::atomic<std::size_t> state_version_{ 0 };
+  // current_state_time_ in nanoseconds, for reading it without the lock
+  std::atomic<int64_t> current_state_time_ns_{ 0 };
+  // replaced with std::atomic_compare_exchange_strong(), read with std::atomic_load()
+  mutable std::shared_ptr<const LatestState> latest_state_;
   mutable std::condition_variable state_update_condition_;
   std::vector<JointStateUpdateCallback> update_callbacks_;
 
@@ -46,6 +46,7 @@
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
 #include <moveit/collision_plugin_loader/collision_plugin_loader.h>
 #include <moveit_msgs/srv/get_planning_scene.hpp>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <shared_mutex>
@@ -93,6 +94,22 @@ public:
     UPDATE_SCENE = 8 + UPDATE_STATE + UPDATE_TRANSFORMS + UPDATE_GEOMETRY
   };
 
+  /** \brief Counters of the robot state updates received from the CurrentStateMonitor */
+  struct StateUpdateStatistics
+  {
+    /** \brief Number of state updates received from the CurrentStateMonitor */
+    std::size_t received{ 0 };
+
+    /** \brief Number of times the current state was applied to the scene */
+    std::size_t applied{ 0 };
+
+    /** \brief Number of received updates which were merged into a later one because of the update frequency */
+    std::size_t coalesced{ 0 };
+
+    /** \brief Number of updates postponed to the update timer because the scene was locked */
+    std::size_t deferred{ 0 };
+  };
+
   /// The name of the topic used by default for receiving joint states
   static const std::string DEFAULT_JOINT_STATES_TOPIC;  // "/joint_states"
 
@@ -222,6 +239,18 @@ public:
     return scene_const_;
   }
 
+  /** @brief Returns an immutable snapshot of the monitored planning scene, without locking the monitor.
+   *
+   *  The snapshot is republished whenever the monitored scene changes: state updates produce a cheap diff() child of
+   *  an immutable base copy of the scene, while any other update copies the base anew. Readers holding a snapshot keep
+   *  it alive and are never blocked by (nor do they block) the monitor's writers. The first call enables the
+   *  maintenance of snapshots and builds the initial one.
+   *
+   *  @note The octree of the octomap is shared between the snapshot and the monitored scene, so it still needs to be
+   *        read under the lock of getOcTreePtr()->reading() if the octomap monitor is active, unless the octomap is
+   *        double buffered, see setOctomapDoubleBuffering(). */
+  planning_scene::PlanningSceneConstPtr getPlanningSceneSnapshot();
+
   /** @brief Returns a copy of the current planning scene. */
   planning_scene::PlanningScenePtr
   copyPlanningScene(const moveit_msgs::msg::PlanningScene& diff = moveit_msgs::msg::PlanningScene());
@@ -307,6 +336,13 @@ public:
     return current_state_monitor_;
   }
 
+  /** @brief Get the occupancy map monitor, if startWorldGeometryMonitor() started one
+   *  @return The occupancy map monitor, or nullptr */
+  const occupancy_map_monitor::OccupancyMapMonitor* getOccupancyMapMonitor() const
+  {
+    return octomap_monitor_.get();
+  }
+
   CurrentStateMonitorPtr& getStateMonitorNonConst()
   {
     return current_state_monitor_;
@@ -341,6 +377,12 @@ public:
       @param hz the update frequency. By default this is 10Hz. */
   void setStateUpdateFrequency(double hz);
 
+  /** @brief Get the counters of the state updates since construction or the last resetStateUpdateStatistics() */
+  StateUpdateStatistics getStateUpdateStatistics() const;
+
+  /** @brief Reset the counters returned by getStateUpdateStatistics() */
+  void resetStateUpdateStatistics();
+
   /** @brief Get the maximum frequency (Hz) at which the current state of the planning scene is updated.*/
   double getStateUpdateFrequency() const
   {
@@ -420,6 +462,22 @@ public:
 
   void clearOctomap();
 
+  /** @brief Double buffer the octomap of the monitored planning scene.
+   *
+   *  When enabled, the scene holds a copy of the octree of the octomap monitor, which is only changed under the unique
+   *  lock of the scene. The updaters then only write to their own tree, so collision checks and the serialization
+   *  of published scenes never wait for them, and lockSceneRead() no longer locks the octree. After each update of the
+   *  monitor, the cells it changed are applied to the copy, which also keeps the collision geometry of the octomap in
+   *  the collision environments. The whole octree is only copied again when the map was replaced or cleared. This can
+   *  also be set with the parameter octomap_double_buffering. */
+  void setOctomapDoubleBuffering(bool enabled);
+
+  /** @brief True if the octomap is double buffered, see setOctomapDoubleBuffering() */
+  bool isOctomapDoubleBuffered() const
+  {
+    return octomap_double_buffering_;
+  }
+
   // Called to update the planning scene with a new message.
   bool newPlanningSceneMessage(const moveit_msgs::msg::PlanningScene& scene);
 
@@ -540,6 +598,17 @@ protected:
   // this is used by MoveGroup and related application nodes
   rclcpp::Service<moveit_msgs::srv::GetPlanningScene>::SharedPtr get_scene_service_;
 
+  // The world geometry and the octomap of the scene are the expensive parts of the responses of get_scene_service_.
+  // They are kept as messages and reused as long as the version of the world they were built for does not change.
+  // The octree may change in place though, so the octomap is also rebuilt after every update of the octomap.
+  std::mutex scene_msg_cache_mutex_;
+  std::size_t cached_collision_objects_world_version_ = 0;  // world versions start at 1
+  std::vector<moveit_msgs::msg::CollisionObject> cached_collision_objects_;
+  std::size_t cached_octomap_world_version_ = 0;
+  std::size_t cached_octomap_update_count_ = 0;
+  octomap_msgs::msg::OctomapWithPose cached_octomap_;
+  std::size_t octomap_update_count_ = 0;  // guarded by scene_update_mutex_
+
   // include a octomap monitor
   std::unique_ptr<occupancy_map_monitor::OccupancyMapMonitor> octomap_monitor_;
 
@@ -564,7 +633,30 @@ protected:
   std::vector<std::function<void(SceneUpdateType)> > update_callbacks_;  /// List of callbacks to trigger when updates
                                                                          /// are received
 
+  // lock-free snapshots of the planning scene, see getPlanningSceneSnapshot()
+  planning_scene::PlanningSceneConstPtr scene_snapshot_;  /// only accessed through std::atomic_load/store
+  planning_scene::PlanningScenePtr snapshot_base_;        /// immutable copy of scene_ the snapshots are diffs of
+  std::mutex snapshot_update_mutex_;                      /// serializes updates of snapshot_base_ and scene_snapshot_
+  std::atomic<int> pending_snapshot_update_{ UPDATE_NONE };  /// SceneUpdateType bits not yet in scene_snapshot_
+  std::atomic<bool> snapshots_enabled_{ false };
+
+  // the scene holds a copy of the octree, only changed under a unique lock of scene_update_mutex_
+  std::atomic<bool> octomap_double_buffering_{ false };
+  collision_detection::OccMapTreePtr octomap_front_buffer_;
+  std::uint64_t octomap_front_buffer_version_ = 0;  // version of the octomap monitor the copy is synchronized with
+  occupancy_map_monitor::OccupancyMapChanges octomap_changes_;
+
+  /** @brief Give the scene the current octree of the octomap monitor, or a copy of it if double buffered. Requires a
+   *  unique lock of scene_update_mutex_ */
+  void processOctomapUpdate();
+
+  /** @brief Lock the octree for reading if the scene shares it with the octomap monitor */
+  collision_detection::OccMapTree::ReadLock readOctomapOfScene();
+
 private:
+  /** @brief Publish a new snapshot of the planning scene covering the pending snapshot updates */
+  void updatePlanningSceneSnapshot();
+
   void getUpdatedFrameTransforms(std::vector<geometry_msgs::msg::TransformStamped>& transforms);
 
   // publish planning scene update diffs (runs in its own thread)
@@ -589,6 +681,12 @@ private:
   /// True if current_state_monitor_ has a newer RobotState than scene_
   std::atomic<bool> state_update_pending_;
 
+  /// Counters reported by getStateUpdateStatistics()
+  std::atomic<std::size_t> state_updates_received_{ 0 };
+  std::atomic<std::size_t> state_updates_applied_{ 0 };
+  std::atomic<std::size_t> state_updates_coalesced_{ 0 };
+  std::atomic<std::size_t> state_updates_deferred_{ 0 };
+
   // Lock for writing last_robot_state_update_wall_time_ and dt_state_update_
   std::mutex state_update_mutex_;
 
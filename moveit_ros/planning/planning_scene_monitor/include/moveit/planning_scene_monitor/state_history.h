@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace planning_scene_monitor
+{
+/** @brief Fixed-size ring buffer of timestamped robot state variable positions.
+ *
+ *  There must be only one writer at a time, which push()es entries with non-decreasing time stamps. Readers never
+ *  block: each slot is guarded by a sequence number, so a reader detects (and skips) entries which are being
+ *  overwritten concurrently. Once the buffer is full, the oldest entries are overwritten. */
+class StateHistory
+{
+public:
+  /** @brief Construct a buffer holding the last \e capacity states of \e variable_count variables each */
+  StateHistory(std::size_t capacity, std::size_t variable_count);
+
+  StateHistory(const StateHistory&) = delete;
+  StateHistory& operator=(const StateHistory&) = delete;
+
+  std::size_t getCapacity() const
+  {
+    return slots_.size();
+  }
+
+  std::size_t getVariableCount() const
+  {
+    return variable_count_;
+  }
+
+  /** @brief Append the variable positions \e positions recorded at time \e stamp (in seconds).
+   *
+   *  A time stamp older than the newest entry is replaced by the one of the newest entry, so that the entries stay
+   *  sorted. */
+  void push(double stamp, const double* positions);
+
+  /** @brief Remove all entries. Like push(), this must only be called by the writer. */
+  void clear();
+
+  /** @brief Get the two entries enclosing time \e t.
+   *
+   *  On success, \e before and \e after hold the positions of the newest entry recorded no later than \e t and of the
+   *  entry following it, and \e fraction is the relative position of \e t between their time stamps, such that
+   *  interpolating from \e before to \e after by \e fraction estimates the state at \e t. For times newer than the
+   *  newest entry, both hold the newest entry. Returns false if the buffer is empty or \e t is older than the oldest
+   *  entry still available. */
+  bool getEnclosingEntries(double t, std::vector<double>& before, std::vector<double>& after, double& fraction) const;
+
+  /** @brief Get the time stamps of the oldest and newest entry. Returns false if the buffer is empty. */
+  bool getTimeRange(double& oldest, double& newest) const;
+
+  /** @brief Get the number of entries that are currently available */
+  std::size_t getSize() const;
+
+  /** @brief Get the \e i th oldest available entry. Returns false if there is no such entry, or if it was overwritten
+   *  while reading it. */
+  bool getEntry(std::size_t i, double& stamp, std::vector<double>& positions) const;
+
+private:
+  struct Slot
+  {
+    /** @brief 2 * index + 2 of the entry stored in the slot, or an odd number while the slot is written to */
+    std::atomic<std::uint64_t> sequence{ 0 };
+    std::atomic<double> stamp{ 0.0 };
+    std::unique_ptr<std::atomic<double>[]> positions;
+  };
+
+  /** @brief Read the time stamp of the entry with \e index. Returns false if the entry is not available anymore. */
+  bool readStamp(std::uint64_t index, double& stamp) const;
+
+  /** @brief Read the time stamp and positions of the entry with \e index. Returns false if the entry is not available
+   *  anymore. */
+  bool readEntry(std::uint64_t index, double& stamp, std::vector<double>& positions) const;
+
+  const std::size_t variable_count_;
+  std::vector<Slot> slots_;
+
+  /** @brief Number of entries pushed so far */
+  std::atomic<std::uint64_t> count_{ 0 };
+
+  /** @brief Time stamp of the newest entry, only accessed by the writer */
+  double newest_stamp_{ 0.0 };
+};
+}  // namespace planning_scene_monitor
@@ -39,6 +39,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/planning_scene_monitor/state_history.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <rclcpp/time.hpp>
 #include <memory>
@@ -52,7 +53,10 @@ using TrajectoryStateAddedCallback = std::function<void(const moveit::core::Robo
 MOVEIT_CLASS_FORWARD(TrajectoryMonitor);  // Defines TrajectoryMonitorPtr, ConstPtr, WeakPtr... etc
 
 /** @class TrajectoryMonitor
-    @brief Monitors the joint_states topic and tf to record the trajectory of the robot. */
+    @brief Monitors the joint_states topic and tf to record the trajectory of the robot.
+
+    The recorded variable positions are kept in a fixed-capacity ring buffer, so recording at high rates does not
+    allocate. The trajectory is only built from them when it is requested. */
 class TrajectoryMonitor
 {
 public:
@@ -108,17 +112,21 @@ public:
 
   void setSamplingFrequency(double sampling_frequency);
 
-  /// Return the current maintained trajectory. This function is not thread safe (hence NOT const), because the
-  /// trajectory could be modified.
-  const robot_trajectory::RobotTrajectory& getTrajectory()
+  std::size_t getRecordingCapacity() const
   {
-    return trajectory_;
+    return recorded_states_->getCapacity();
   }
 
-  void swapTrajectory(robot_trajectory::RobotTrajectory& other)
-  {
-    trajectory_.swap(other);
-  }
+  /// Set the number of states that are kept, the oldest states are dropped once that many were recorded. This clears
+  /// the recorded trajectory.
+  void setRecordingCapacity(std::size_t capacity);
+
+  /// Return the trajectory of the recorded states (positions only). This function is not thread safe (hence NOT
+  /// const), because the trajectory is rebuilt from the recorded states.
+  const robot_trajectory::RobotTrajectory& getTrajectory();
+
+  /// Move the trajectory of the recorded states into \e other and clear the recorded states
+  void swapTrajectory(robot_trajectory::RobotTrajectory& other);
 
   void setOnStateAddCallback(const TrajectoryStateAddedCallback& callback)
   {
@@ -127,6 +135,7 @@ public:
 
 private:
   void recordStates();
+  void buildTrajectory();
 
   // Samples robot states.
   CurrentStateMonitorConstPtr current_state_monitor_;
@@ -134,6 +143,8 @@ private:
   std::unique_ptr<MiddlewareHandle> middleware_handle_;
   double sampling_frequency_;
 
+  // times are stored relative to trajectory_start_time_
+  std::unique_ptr<StateHistory> recorded_states_;
   robot_trajectory::RobotTrajectory trajectory_;
   rclcpp::Time trajectory_start_time_;
   rclcpp::Time last_recorded_state_time_;
@@ -51,6 +51,7 @@ using namespace std::chrono_literals;
 namespace
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.current_state_monitor");
+constexpr std::size_t DEFAULT_STATE_HISTORY_CAPACITY = 1024;
 }
 
 CurrentStateMonitor::CurrentStateMonitor(std::unique_ptr<CurrentStateMonitor::MiddlewareHandle> middleware_handle,
@@ -66,6 +67,8 @@ CurrentStateMonitor::CurrentStateMonitor(std::unique_ptr<CurrentStateMonitor::Mi
   , use_sim_time_(use_sim_time)
 {
   robot_state_.setToDefaultValues();
+  if (robot_model_)
+    state_history_ = std::make_shared<StateHistory>(DEFAULT_STATE_HISTORY_CAPACITY, robot_model_->getVariableCount());
 }
 
 CurrentStateMonitor::CurrentStateMonitor(const rclcpp::Node::SharedPtr& node,
@@ -88,6 +91,34 @@ moveit::core::RobotStatePtr CurrentStateMonitor::getCurrentState() const
   return moveit::core::RobotStatePtr(result);
 }
 
+std::shared_ptr<const moveit::core::RobotState> CurrentStateMonitor::getLatestState() const
+{
+  std::shared_ptr<const LatestState> latest = std::atomic_load(&latest_state_);
+  if (latest && latest->version == state_version_.load(std::memory_order_acquire))
+    return latest->state;
+
+  // the state changed since the last snapshot, take a new one
+  std::unique_lock<std::mutex> slock(state_update_lock_);
+  auto state = std::make_shared<moveit::core::RobotState>(robot_state_);
+  const std::size_t version = state_version_.load(std::memory_order_relaxed);
+  slock.unlock();
+  state->update();  // so the snapshot can be read concurrently
+
+  // do not replace a more recent snapshot taken concurrently
+  auto snapshot = std::make_shared<const LatestState>(LatestState{ state, version });
+  while (!latest || latest->version < version)
+  {
+    if (std::atomic_compare_exchange_weak(&latest_state_, &latest, snapshot))
+      break;
+  }
+  return state;
+}
+
+rclcpp::Time CurrentStateMonitor::getLatestStateTime() const
+{
+  return rclcpp::Time(current_state_time_ns_.load(std::memory_order_relaxed), RCL_ROS_TIME);
+}
+
 rclcpp::Time CurrentStateMonitor::getCurrentStateTime() const
 {
   std::unique_lock<std::mutex> slock(state_update_lock_);
@@ -101,6 +132,14 @@ std::pair<moveit::core::RobotStatePtr, rclcpp::Time> CurrentStateMonitor::getCur
   return std::make_pair(moveit::core::RobotStatePtr(result), current_state_time_);
 }
 
+rclcpp::Time CurrentStateMonitor::getCurrentStatePositions(std::vector<double>& positions) const
+{
+  std::unique_lock<std::mutex> slock(state_update_lock_);
+  const double* pos = robot_state_.getVariablePositions();
+  positions.assign(pos, pos + robot_state_.getVariableCount());
+  return current_state_time_;
+}
+
 std::map<std::string, double> CurrentStateMonitor::getCurrentStateValues() const
 {
   std::map<std::string, double> m;
@@ -137,6 +176,49 @@ void CurrentStateMonitor::setToCurrentState(moveit::core::RobotState& upd) const
   }
 }
 
+bool CurrentStateMonitor::getStateAtTime(const rclcpp::Time& t, moveit::core::RobotState& state) const
+{
+  const std::shared_ptr<const StateHistory> history = std::atomic_load(&state_history_);
+  if (!history)
+    return false;
+
+  std::vector<double> before, after;
+  double fraction;
+  if (!history->getEnclosingEntries(t.seconds(), before, after, fraction))
+    return false;
+
+  std::vector<double> positions(before.size());
+  robot_model_->interpolate(before.data(), after.data(), fraction, positions.data());
+  state.setVariablePositions(positions);
+  return true;
+}
+
+void CurrentStateMonitor::setStateHistoryCapacity(std::size_t capacity)
+{
+  std::unique_lock<std::mutex> slock(state_update_lock_);
+  std::shared_ptr<StateHistory> history;
+  if (capacity > 0 && robot_model_)
+    history = std::make_shared<StateHistory>(capacity, robot_model_->getVariableCount());
+  std::atomic_store(&state_history_, history);
+}
+
+std::size_t CurrentStateMonitor::getStateHistoryCapacity() const
+{
+  const std::shared_ptr<const StateHistory> history = std::atomic_load(&state_history_);
+  return history ? history->getCapacity() : 0;
+}
+
+std::shared_ptr<const StateHistory> CurrentStateMonitor::getStateHistory() const
+{
+  return std::atomic_load(&state_history_);
+}
+
+void CurrentStateMonitor::recordStateHistory()
+{
+  if (state_history_)
+    state_history_->push(current_state_time_.seconds(), robot_state_.getVariablePositions());
+}
+
 void CurrentStateMonitor::addUpdateCallback(const JointStateUpdateCallback& fn)
 {
   if (fn)
@@ -330,6 +412,7 @@ void CurrentStateMonitor::jointStateCallback(const sensor_msgs::msg::JointState:
     // read the received values, and update their time stamps
     std::size_t n = joint_state->name.size();
     current_state_time_ = joint_state->header.stamp;
+    current_state_time_ns_.store(current_state_time_.nanoseconds(), std::memory_order_relaxed);
     for (std::size_t i = 0; i < n; ++i)
     {
       const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
@@ -382,6 +465,9 @@ void CurrentStateMonitor::jointStateCallback(const sensor_msgs::msg::JointState:
         }
       }
     }
+    if (update)
+      state_version_.fetch_add(1, std::memory_order_release);
+    recordStateHistory();
   }
 
   // callbacks, if needed
@@ -449,6 +535,11 @@ void CurrentStateMonitor::updateMultiDofJoints()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+    if (update)
+    {
+      state_version_.fetch_add(1, std::memory_order_release);
+      recordStateHistory();
+    }
   }
 
   // callbacks, if needed
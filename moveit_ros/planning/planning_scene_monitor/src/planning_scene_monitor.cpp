@@ -37,6 +37,7 @@
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/utils/message_checks.h>
+#include <moveit/utils/thread_config.h>
 #include <moveit/exceptions/exceptions.h>
 #include <moveit_msgs/srv/get_planning_scene.hpp>
 
@@ -145,6 +146,8 @@ PlanningSceneMonitor::~PlanningSceneMonitor()
   private_executor_.reset();
 
   current_state_monitor_.reset();
+  std::atomic_store(&scene_snapshot_, planning_scene::PlanningSceneConstPtr());
+  snapshot_base_.reset();
   scene_const_.reset();
   scene_.reset();
   parent_scene_.reset();
@@ -241,7 +244,11 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
   private_executor_->add_node(pnode_);
 
   // start executor on a different thread now
-  private_executor_thread_ = std::thread([this]() { private_executor_->spin(); });
+  moveit::threads::loadThreadConfigs(node_);
+  private_executor_thread_ = std::thread([this]() {
+    moveit::threads::configureCurrentThread("planning_scene_monitor");
+    private_executor_->spin();
+  });
 
   auto declare_parameter = [this](const std::string& param_name, auto default_val,
                                   const std::string& description) -> auto
@@ -266,6 +273,10 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
         "publish_planning_scene_hz", 4.0, "Set the maximum frequency at which planning scene updates are published");
     updatePublishSettings(publish_geometry_updates, publish_state_updates, publish_transform_updates,
                           publish_planning_scene, publish_planning_scene_hz);
+    setOctomapDoubleBuffering(declare_parameter("octomap_double_buffering", false,
+                                                "Set to True to check collisions against a copy of the octomap that "
+                                                "is replaced after each update, so that readers never wait for the "
+                                                "octomap updaters"));
   }
   catch (const rclcpp::exceptions::InvalidParameterTypeException& e)
   {
@@ -319,6 +330,8 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
         publish_transform_updates = parameter.as_bool();
       else if (name == "planning_scene_monitor.publish_planning_scene_hz")
         publish_planning_scene_hz = parameter.as_double();
+      else if (name == "planning_scene_monitor.octomap_double_buffering")
+        setOctomapDoubleBuffering(parameter.as_bool());
     }
 
     if (result.successful)
@@ -408,15 +421,14 @@ void PlanningSceneMonitor::startPublishingPlanningScene(SceneUpdateType update_t
 
 void PlanningSceneMonitor::scenePublishingThread()
 {
+  moveit::threads::configureCurrentThread("planning_scene_publisher");
   RCLCPP_DEBUG(LOGGER, "Started scene publishing thread ...");
 
   // publish the full planning scene once
   {
     moveit_msgs::msg::PlanningScene msg;
     {
-      collision_detection::OccMapTree::ReadLock lock;
-      if (octomap_monitor_)
-        lock = octomap_monitor_->getOcTreePtr()->reading();
+      collision_detection::OccMapTree::ReadLock lock = readOctomapOfScene();
       scene_->getPlanningSceneMsg(msg);
     }
     planning_scene_publisher_->publish(msg);
@@ -441,9 +453,7 @@ void PlanningSceneMonitor::scenePublishingThread()
             is_full = true;
           else
           {
-            collision_detection::OccMapTree::ReadLock lock;
-            if (octomap_monitor_)
-              lock = octomap_monitor_->getOcTreePtr()->reading();
+            collision_detection::OccMapTree::ReadLock lock = readOctomapOfScene();
             scene_->getPlanningSceneDiffMsg(msg);
             if (new_scene_update_ == UPDATE_STATE)
             {
@@ -473,9 +483,7 @@ void PlanningSceneMonitor::scenePublishingThread()
           }
           if (is_full)
           {
-            collision_detection::OccMapTree::ReadLock lock;
-            if (octomap_monitor_)
-              lock = octomap_monitor_->getOcTreePtr()->reading();
+            collision_detection::OccMapTree::ReadLock lock = readOctomapOfScene();
             scene_->getPlanningSceneMsg(msg);
           }
           // also publish timestamp of this robot_state
@@ -547,6 +555,51 @@ void PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type)
     update_callback(update_type);
   new_scene_update_ = (SceneUpdateType)(static_cast<int>(new_scene_update_) | static_cast<int>(update_type));
   new_scene_update_condition_.notify_all();
+
+  if (snapshots_enabled_)
+  {
+    pending_snapshot_update_ |= update_type;
+    updatePlanningSceneSnapshot();
+  }
+}
+
+planning_scene::PlanningSceneConstPtr PlanningSceneMonitor::getPlanningSceneSnapshot()
+{
+  if (!snapshots_enabled_.exchange(true))
+  {
+    pending_snapshot_update_ |= UPDATE_SCENE;
+    updatePlanningSceneSnapshot();
+  }
+  return std::atomic_load(&scene_snapshot_);
+}
+
+void PlanningSceneMonitor::updatePlanningSceneSnapshot()
+{
+  std::scoped_lock lock(snapshot_update_mutex_);
+  const int update_type = pending_snapshot_update_.exchange(UPDATE_NONE);
+  if (update_type == UPDATE_NONE && snapshot_base_)
+    return;
+
+  planning_scene::PlanningSceneConstPtr snapshot;
+  {
+    std::shared_lock<std::shared_mutex> ulock(scene_update_mutex_);
+    if (!scene_)
+      return;
+    if (!snapshot_base_ || (update_type & ~UPDATE_STATE))
+    {
+      // anything but the robot state changed: take a new immutable copy, which also flattens diffs of the scene
+      snapshot_base_ = planning_scene::PlanningScene::clone(scene_);
+      snapshot = snapshot_base_;
+    }
+    else
+    {
+      // the diff only owns a copy of the robot state and shares everything else with the base
+      planning_scene::PlanningScenePtr diff = snapshot_base_->diff();
+      diff->setCurrentState(scene_->getCurrentState());
+      snapshot = diff;
+    }
+  }
+  std::atomic_store(&scene_snapshot_, snapshot);
 }
 
 bool PlanningSceneMonitor::requestPlanningSceneState(const std::string& service_name)
@@ -611,11 +664,53 @@ void PlanningSceneMonitor::getPlanningSceneServiceCallback(
   if (req->components.components & moveit_msgs::msg::PlanningSceneComponents::TRANSFORMS)
     updateFrameTransforms();
 
-  moveit_msgs::msg::PlanningSceneComponents all_components;
-  all_components.components = UINT_MAX;  // Return all scene components if nothing is specified.
+  // Return all scene components if nothing is specified.
+  const uint32_t components = req->components.components ? req->components.components : UINT_MAX;
+  const uint32_t cached_components = moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY |
+                                     moveit_msgs::msg::PlanningSceneComponents::OCTOMAP;
 
-  std::unique_lock<std::shared_mutex> ulock(scene_update_mutex_);
-  scene_->getPlanningSceneMsg(res->scene, req->components.components ? req->components : all_components);
+  // the cheap components are built anew
+  moveit_msgs::msg::PlanningSceneComponents built_components;
+  built_components.components = components & ~cached_components;
+
+  std::shared_lock<std::shared_mutex> slock(scene_update_mutex_);
+  scene_->getPlanningSceneMsg(res->scene, built_components);
+
+  const std::size_t world_version = scene_->getWorldVersion();
+  std::lock_guard<std::mutex> cache_lock(scene_msg_cache_mutex_);
+  if (components & moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY)
+  {
+    if (cached_collision_objects_world_version_ != world_version)
+    {
+      cached_collision_objects_.clear();
+      scene_->getCollisionObjectMsgs(cached_collision_objects_);
+      cached_collision_objects_world_version_ = world_version;
+    }
+    res->scene.world.collision_objects = cached_collision_objects_;
+    // object types can change without changing the world
+    for (moveit_msgs::msg::CollisionObject& collision_object : res->scene.world.collision_objects)
+    {
+      if (scene_->hasObjectType(collision_object.id))
+        collision_object.type = scene_->getObjectType(collision_object.id);
+      else
+        collision_object.type = object_recognition_msgs::msg::ObjectType();
+    }
+  }
+  if (components & moveit_msgs::msg::PlanningSceneComponents::OCTOMAP)
+  {
+    if (cached_octomap_world_version_ != world_version || cached_octomap_update_count_ != octomap_update_count_)
+    {
+      // the updaters write to the octree of the scene, unless it is double buffered
+      collision_detection::OccMapTree::ReadLock tree_lock;
+      if (octomap_monitor_ && !octomap_double_buffering_)
+        tree_lock = octomap_monitor_->getOcTreePtr()->reading();
+      cached_octomap_ = octomap_msgs::msg::OctomapWithPose();
+      scene_->getOctomapMsg(cached_octomap_);
+      cached_octomap_world_version_ = world_version;
+      cached_octomap_update_count_ = octomap_update_count_;
+    }
+    res->scene.world.octomap = cached_octomap_;
+  }
 }
 
 void PlanningSceneMonitor::updatePublishSettings(bool publish_geom_updates, bool publish_state_updates,
@@ -658,6 +753,7 @@ void PlanningSceneMonitor::clearOctomap()
       octomap_monitor_->getOcTreePtr()->lockWrite();
       octomap_monitor_->getOcTreePtr()->clear();
       octomap_monitor_->getOcTreePtr()->unlockWrite();
+      octomap_monitor_->resetMapChanges();
     }
     else
     {
@@ -713,6 +809,7 @@ bool PlanningSceneMonitor::newPlanningSceneMessage(const moveit_msgs::msg::Plann
         octomap_monitor_->getOcTreePtr()->lockWrite();
         octomap_monitor_->getOcTreePtr()->clear();
         octomap_monitor_->getOcTreePtr()->unlockWrite();
+        octomap_monitor_->resetMapChanges();
       }
     }
     robot_model_ = scene_->getRobotModel();
@@ -769,6 +866,7 @@ void PlanningSceneMonitor::newPlanningSceneWorldCallback(
           octomap_monitor_->getOcTreePtr()->lockWrite();
           octomap_monitor_->getOcTreePtr()->clear();
           octomap_monitor_->getOcTreePtr()->unlockWrite();
+          octomap_monitor_->resetMapChanges();
         }
       }
     }
@@ -1074,13 +1172,14 @@ bool PlanningSceneMonitor::waitForCurrentRobotState(const rclcpp::Time& t, doubl
 void PlanningSceneMonitor::lockSceneRead()
 {
   scene_update_mutex_.lock_shared();
-  if (octomap_monitor_)
+  // octomap_double_buffering_ cannot change while scene_update_mutex_ is locked
+  if (octomap_monitor_ && !octomap_double_buffering_)
     octomap_monitor_->getOcTreePtr()->lockRead();
 }
 
 void PlanningSceneMonitor::unlockSceneRead()
 {
-  if (octomap_monitor_)
+  if (octomap_monitor_ && !octomap_double_buffering_)
     octomap_monitor_->getOcTreePtr()->unlockRead();
   scene_update_mutex_.unlock_shared();
 }
@@ -1097,6 +1196,13 @@ void PlanningSceneMonitor::unlockSceneWrite()
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->unlockWrite();
   scene_update_mutex_.unlock();
+
+  // the scene may have been modified arbitrarily through a LockedPlanningSceneRW
+  if (snapshots_enabled_)
+  {
+    pending_snapshot_update_ |= UPDATE_SCENE;
+    updatePlanningSceneSnapshot();
+  }
 }
 
 void PlanningSceneMonitor::startSceneMonitor(const std::string& scene_topic)
@@ -1302,7 +1408,10 @@ void PlanningSceneMonitor::stopStateMonitor()
 
 void PlanningSceneMonitor::onStateUpdate(const sensor_msgs::msg::JointState::ConstSharedPtr& /*joint_state */)
 {
-  state_update_pending_.store(true);
+  ++state_updates_received_;
+  // updates arriving while one is pending are merged into it, as the state monitor only keeps the latest state
+  if (state_update_pending_.exchange(true))
+    ++state_updates_coalesced_;
 
   // Read access to last_robot_state_update_wall_time_ and dt_state_update_ is unprotected here
   // as reading invalid values is not critical (just postpones the next state update)
@@ -1329,17 +1438,74 @@ void PlanningSceneMonitor::octomapUpdateCallback()
   {
     std::unique_lock<std::shared_mutex> ulock(scene_update_mutex_);
     last_update_time_ = rclcpp::Clock().now();
-    octomap_monitor_->getOcTreePtr()->lockRead();
-    try
+    processOctomapUpdate();
+    ++octomap_update_count_;
+  }
+  triggerSceneUpdateEvent(UPDATE_GEOMETRY);
+}
+
+void PlanningSceneMonitor::processOctomapUpdate()
+{
+  const collision_detection::OccMapTreePtr& tree = octomap_monitor_->getOcTreePtr();
+  if (octomap_double_buffering_)
+  {
+    // the updaters keep writing to the tree of the monitor, the scene only reads the copy
+    const collision_detection::World::ObjectConstPtr map = scene_->getWorld()->getObject(scene_->OCTOMAP_NS);
+    const bool scene_holds_copy =
+        octomap_front_buffer_ && map && map->shapes_.size() == 1 && map->shapes_[0]->type == shapes::OCTREE &&
+        static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree == octomap_front_buffer_;
+    if (scene_holds_copy)
+      octomap_monitor_->getMapChangesSince(octomap_front_buffer_version_, octomap_changes_);
+
+    if (scene_holds_copy && !octomap_changes_.is_keyframe)
     {
-      scene_->processOctomapPtr(octomap_monitor_->getOcTreePtr(), Eigen::Isometry3d::Identity());
-      octomap_monitor_->getOcTreePtr()->unlockRead();
+      // the octree pointer stays the same, so the collision environments keep their geometry of the octomap
+      for (const auto& [key, log_odds] : octomap_changes_.updated_cells)
+        octomap_front_buffer_->setNodeValue(key, log_odds);
+      for (const octomap::OcTreeKey& key : octomap_changes_.removed_cells)
+        octomap_front_buffer_->deleteNode(key);
+      octomap_front_buffer_version_ = octomap_changes_.version;
     }
-    catch (...)
+    else
     {
-      octomap_monitor_->getOcTreePtr()->unlockRead();  // unlock and rethrow
-      throw;
+      // the copy may be newer than the version, applying the changes of that version again later does not alter it
+      octomap_front_buffer_version_ = octomap_monitor_->getMapVersion();
+      collision_detection::OccMapTree::ReadLock lock = tree->reading();
+      octomap_front_buffer_ =
+          std::make_shared<collision_detection::OccMapTree>(static_cast<const octomap::OcTree&>(*tree));
+      octomap_front_buffer_->enableChangeDetection(false);
+      octomap_front_buffer_->resetChangeDetection();
     }
+    scene_->processOctomapPtr(octomap_front_buffer_, Eigen::Isometry3d::Identity());
+  }
+  else
+  {
+    collision_detection::OccMapTree::ReadLock lock = tree->reading();
+    scene_->processOctomapPtr(tree, Eigen::Isometry3d::Identity());
+  }
+}
+
+collision_detection::OccMapTree::ReadLock PlanningSceneMonitor::readOctomapOfScene()
+{
+  collision_detection::OccMapTree::ReadLock lock;
+  if (octomap_monitor_ && !octomap_double_buffering_)
+    lock = octomap_monitor_->getOcTreePtr()->reading();
+  return lock;
+}
+
+void PlanningSceneMonitor::setOctomapDoubleBuffering(bool enabled)
+{
+  {
+    // no reader is between lockSceneRead() and unlockSceneRead() while the flag changes
+    std::unique_lock<std::shared_mutex> ulock(scene_update_mutex_);
+    if (octomap_double_buffering_ == enabled)
+      return;
+    octomap_double_buffering_ = enabled;
+    if (!enabled)
+      octomap_front_buffer_.reset();
+    if (!octomap_monitor_ || !scene_ || !scene_->getWorld()->hasObject(scene_->OCTOMAP_NS))
+      return;
+    processOctomapUpdate();
   }
   triggerSceneUpdateEvent(UPDATE_GEOMETRY);
 }
@@ -1373,6 +1539,24 @@ void PlanningSceneMonitor::setStateUpdateFrequency(double hz)
     updateSceneWithCurrentState();
 }
 
+PlanningSceneMonitor::StateUpdateStatistics PlanningSceneMonitor::getStateUpdateStatistics() const
+{
+  StateUpdateStatistics statistics;
+  statistics.received = state_updates_received_;
+  statistics.applied = state_updates_applied_;
+  statistics.coalesced = state_updates_coalesced_;
+  statistics.deferred = state_updates_deferred_;
+  return statistics;
+}
+
+void PlanningSceneMonitor::resetStateUpdateStatistics()
+{
+  state_updates_received_ = 0;
+  state_updates_applied_ = 0;
+  state_updates_coalesced_ = 0;
+  state_updates_deferred_ = 0;
+}
+
 void PlanningSceneMonitor::updateSceneWithCurrentState(bool skip_update_if_locked)
 {
   rclcpp::Time time = node_->now();
@@ -1396,7 +1580,9 @@ void PlanningSceneMonitor::updateSceneWithCurrentState(bool skip_update_if_locke
       }
       else if (!ulock.try_lock())
       {
-        // Return if we can't lock scene_update_mutex, thus not blocking CurrentStateMonitor
+        // Return if we can't lock scene_update_mutex, thus not blocking CurrentStateMonitor.
+        // The update stays pending and is applied by the next update or stateUpdateTimerCallback()
+        ++state_updates_deferred_;
         return;
       }
       last_update_time_ = last_robot_motion_time_ = current_state_monitor_->getCurrentStateTime();
@@ -1411,6 +1597,7 @@ void PlanningSceneMonitor::updateSceneWithCurrentState(bool skip_update_if_locke
       last_robot_state_update_wall_time_ = std::chrono::system_clock::now();
       state_update_pending_.store(false);
     }
+    ++state_updates_applied_;
 
     triggerSceneUpdateEvent(UPDATE_STATE);
   }
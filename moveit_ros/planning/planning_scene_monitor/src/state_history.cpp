@@ -0,0 +1,156 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/state_history.h>
+#include <algorithm>
+
+namespace planning_scene_monitor
+{
+StateHistory::StateHistory(std::size_t capacity, std::size_t variable_count)
+  : variable_count_(variable_count), slots_(std::max<std::size_t>(capacity, 1))
+{
+  for (Slot& slot : slots_)
+    slot.positions = std::make_unique<std::atomic<double>[]>(variable_count_);
+}
+
+void StateHistory::push(double stamp, const double* positions)
+{
+  const std::uint64_t index = count_.load(std::memory_order_relaxed);
+  if (index > 0)
+    stamp = std::max(stamp, newest_stamp_);
+  newest_stamp_ = stamp;
+
+  Slot& slot = slots_[index % slots_.size()];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.stamp.store(stamp, std::memory_order_relaxed);
+  for (std::size_t i = 0; i < variable_count_; ++i)
+    slot.positions[i].store(positions[i], std::memory_order_relaxed);
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+  count_.store(index + 1, std::memory_order_release);
+}
+
+void StateHistory::clear()
+{
+  // reset the sequence numbers, so that an old entry is never mistaken for a new one with the same index
+  const std::uint64_t count = count_.load(std::memory_order_relaxed);
+  for (std::uint64_t index = count > slots_.size() ? count - slots_.size() : 0; index < count; ++index)
+    slots_[index % slots_.size()].sequence.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_release);
+  newest_stamp_ = 0.0;
+}
+
+bool StateHistory::readStamp(std::uint64_t index, double& stamp) const
+{
+  const Slot& slot = slots_[index % slots_.size()];
+  if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2)
+    return false;
+  stamp = slot.stamp.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == 2 * index + 2;
+}
+
+bool StateHistory::readEntry(std::uint64_t index, double& stamp, std::vector<double>& positions) const
+{
+  const Slot& slot = slots_[index % slots_.size()];
+  if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2)
+    return false;
+  stamp = slot.stamp.load(std::memory_order_relaxed);
+  positions.resize(variable_count_);
+  for (std::size_t i = 0; i < variable_count_; ++i)
+    positions[i] = slot.positions[i].load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == 2 * index + 2;
+}
+
+bool StateHistory::getTimeRange(double& oldest, double& newest) const
+{
+  const std::uint64_t count = count_.load(std::memory_order_acquire);
+  if (count == 0 || !readStamp(count - 1, newest))
+    return false;
+  // the oldest entries may be overwritten while we read them, so try the next newer ones
+  for (std::uint64_t index = count > slots_.size() ? count - slots_.size() : 0; index < count; ++index)
+    if (readStamp(index, oldest))
+      return true;
+  return false;
+}
+
+std::size_t StateHistory::getSize() const
+{
+  return std::min<std::uint64_t>(count_.load(std::memory_order_acquire), slots_.size());
+}
+
+bool StateHistory::getEntry(std::size_t i, double& stamp, std::vector<double>& positions) const
+{
+  const std::uint64_t count = count_.load(std::memory_order_acquire);
+  const std::uint64_t index = (count > slots_.size() ? count - slots_.size() : 0) + i;
+  return index < count && readEntry(index, stamp, positions);
+}
+
+bool StateHistory::getEnclosingEntries(double t, std::vector<double>& before, std::vector<double>& after,
+                                       double& fraction) const
+{
+  const std::uint64_t count = count_.load(std::memory_order_acquire);
+  if (count == 0)
+    return false;
+  const std::uint64_t first = count > slots_.size() ? count - slots_.size() : 0;
+
+  // most queries are for recent times, so search backwards from the newest entry
+  double before_stamp;
+  double after_stamp;
+  std::uint64_t index = count - 1;
+  if (!readEntry(index, before_stamp, before))
+    return false;
+  if (before_stamp <= t)
+  {
+    after = before;
+    fraction = 0.0;
+    return true;
+  }
+  while (true)
+  {
+    after.swap(before);
+    after_stamp = before_stamp;
+    if (index == first)
+      return false;
+    --index;
+    if (!readEntry(index, before_stamp, before))
+      return false;  // overwritten, so t is older than the oldest available entry
+    if (before_stamp <= t)
+      break;
+  }
+  fraction = after_stamp > before_stamp ? (t - before_stamp) / (after_stamp - before_stamp) : 1.0;
+  return true;
+}
+}  // namespace planning_scene_monitor
@@ -41,6 +41,7 @@
 #include <memory>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.planning_scene_monitor.trajectory_monitor");
+static const std::size_t DEFAULT_RECORDING_CAPACITY = 60000;  // 2 minutes at 500 Hz
 
 planning_scene_monitor::TrajectoryMonitor::TrajectoryMonitor(const CurrentStateMonitorConstPtr& state_monitor,
                                                              double sampling_frequency)
@@ -55,6 +56,8 @@ planning_scene_monitor::TrajectoryMonitor::TrajectoryMonitor(
   : current_state_monitor_(state_monitor)
   , middleware_handle_(std::move(middleware_handle))
   , sampling_frequency_(sampling_frequency)
+  , recorded_states_(std::make_unique<StateHistory>(DEFAULT_RECORDING_CAPACITY,
+                                                    current_state_monitor_->getRobotModel()->getVariableCount()))
   , trajectory_(current_state_monitor_->getRobotModel(), "")
 {
   setSamplingFrequency(sampling_frequency);
@@ -102,16 +105,58 @@ void planning_scene_monitor::TrajectoryMonitor::stopTrajectoryMonitor()
   }
 }
 
+void planning_scene_monitor::TrajectoryMonitor::setRecordingCapacity(std::size_t capacity)
+{
+  bool restart = isActive();
+  if (restart)
+    stopTrajectoryMonitor();
+  recorded_states_ = std::make_unique<StateHistory>(capacity, recorded_states_->getVariableCount());
+  trajectory_.clear();
+  if (restart)
+    startTrajectoryMonitor();
+}
+
 void planning_scene_monitor::TrajectoryMonitor::clearTrajectory()
 {
   bool restart = isActive();
   if (restart)
     stopTrajectoryMonitor();
+  recorded_states_->clear();
   trajectory_.clear();
   if (restart)
     startTrajectoryMonitor();
 }
 
+const robot_trajectory::RobotTrajectory& planning_scene_monitor::TrajectoryMonitor::getTrajectory()
+{
+  buildTrajectory();
+  return trajectory_;
+}
+
+void planning_scene_monitor::TrajectoryMonitor::swapTrajectory(robot_trajectory::RobotTrajectory& other)
+{
+  buildTrajectory();
+  trajectory_.swap(other);
+  clearTrajectory();
+}
+
+void planning_scene_monitor::TrajectoryMonitor::buildTrajectory()
+{
+  trajectory_.clear();
+  const moveit::core::RobotModelConstPtr& robot_model = current_state_monitor_->getRobotModel();
+  std::vector<double> positions;
+  double stamp;
+  double previous_stamp = 0.0;
+  for (std::size_t i = 0; recorded_states_->getEntry(i, stamp, positions); ++i)
+  {
+    auto state = std::make_shared<moveit::core::RobotState>(robot_model);
+    state->setVariablePositions(positions);
+    state->update();
+    trajectory_.addSuffixWayPoint(state, trajectory_.empty() ? 0.0 : stamp - previous_stamp);
+    previous_stamp = stamp;
+  }
+}
+
 void planning_scene_monitor::TrajectoryMonitor::recordStates()
 {
   if (!current_state_monitor_)
@@ -119,22 +164,25 @@ void planning_scene_monitor::TrajectoryMonitor::recordStates()
 
   middleware_handle_->setRate(sampling_frequency_);
 
+  std::vector<double> positions;
   while (record_states_thread_)
   {
     middleware_handle_->sleep();
-    std::pair<moveit::core::RobotStatePtr, rclcpp::Time> state = current_state_monitor_->getCurrentStateAndTime();
-    if (trajectory_.empty())
-    {
-      trajectory_.addSuffixWayPoint(state.first, 0.0);
-      trajectory_start_time_ = state.second;
-      last_recorded_state_time_ = state.second;
-    }
-    else
+    const rclcpp::Time stamp = current_state_monitor_->getCurrentStatePositions(positions);
+    if (positions.size() != recorded_states_->getVariableCount())
+      continue;
+    if (recorded_states_->getSize() == 0)
+      trajectory_start_time_ = stamp;
+    recorded_states_->push((stamp - trajectory_start_time_).seconds(), positions.data());
+    last_recorded_state_time_ = stamp;
+
+    // only the callback needs a robot state for each sample
+    if (state_add_callback_)
     {
-      trajectory_.addSuffixWayPoint(state.first, (state.second - last_recorded_state_time_).seconds());
-      last_recorded_state_time_ = state.second;
+      auto state = std::make_shared<moveit::core::RobotState>(current_state_monitor_->getRobotModel());
+      state->setVariablePositions(positions);
+      state->update();
+      state_add_callback_(state, stamp);
     }
-    if (state_add_callback_)
-      state_add_callback_(state.first, state.second);
   }
 }
@@ -199,6 +199,95 @@ TEST(CurrentStateMonitorTests, WaitForCompleteStateWaits)
   EXPECT_NEAR(nanoseconds_slept.count(), 1e+9, 1e3);
 }
 
+TEST(CurrentStateMonitorTests, GetStateAtTimeInterpolates)
+{
+  auto mock_middleware_handle = std::make_unique<MockMiddlewareHandle>();
+  planning_scene_monitor::JointStateUpdateCallback joint_state_callback;
+  EXPECT_CALL(*mock_middleware_handle, createJointStateSubscription)
+      .WillOnce(testing::SaveArg<1>(&joint_state_callback));
+
+  // GIVEN a started CurrentStateMonitor
+  const moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  planning_scene_monitor::CurrentStateMonitor current_state_monitor{
+    std::move(mock_middleware_handle), robot_model,
+    std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>()), false
+  };
+  current_state_monitor.startStateMonitor();
+  ASSERT_TRUE(joint_state_callback);
+
+  // WHEN it receives joint states at t = 1s and t = 2s
+  const auto send = [&joint_state_callback](int32_t sec, double position) {
+    auto joint_state = std::make_shared<sensor_msgs::msg::JointState>();
+    joint_state->header.stamp = rclcpp::Time(sec, 0, RCL_ROS_TIME);
+    joint_state->name = { "panda_joint1" };
+    joint_state->position = { position };
+    joint_state_callback(joint_state);
+  };
+  send(1, 0.0);
+  send(2, 1.0);
+
+  // THEN states in between are interpolated, newer ones are the last state and older ones are not available
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  ASSERT_TRUE(current_state_monitor.getStateAtTime(rclcpp::Time(1, 500000000, RCL_ROS_TIME), state));
+  EXPECT_NEAR(state.getVariablePosition("panda_joint1"), 0.5, 1e-9);
+  ASSERT_TRUE(current_state_monitor.getStateAtTime(rclcpp::Time(3, 0, RCL_ROS_TIME), state));
+  EXPECT_NEAR(state.getVariablePosition("panda_joint1"), 1.0, 1e-9);
+  EXPECT_FALSE(current_state_monitor.getStateAtTime(rclcpp::Time(0, 500000000, RCL_ROS_TIME), state));
+
+  // WHEN the history is shorter than the updates received
+  current_state_monitor.setStateHistoryCapacity(2);
+  send(3, 0.2);
+  send(4, 0.3);
+  send(5, 0.4);
+
+  // THEN only the most recent states are available
+  EXPECT_FALSE(current_state_monitor.getStateAtTime(rclcpp::Time(3, 500000000, RCL_ROS_TIME), state));
+  ASSERT_TRUE(current_state_monitor.getStateAtTime(rclcpp::Time(4, 250000000, RCL_ROS_TIME), state));
+  EXPECT_NEAR(state.getVariablePosition("panda_joint1"), 0.325, 1e-9);
+}
+
+TEST(CurrentStateMonitorTests, LatestStateIsSharedUntilUpdate)
+{
+  auto mock_middleware_handle = std::make_unique<MockMiddlewareHandle>();
+  planning_scene_monitor::JointStateUpdateCallback joint_state_callback;
+  EXPECT_CALL(*mock_middleware_handle, createJointStateSubscription)
+      .WillOnce(testing::SaveArg<1>(&joint_state_callback));
+
+  // GIVEN a started CurrentStateMonitor that received a joint state
+  planning_scene_monitor::CurrentStateMonitor current_state_monitor{
+    std::move(mock_middleware_handle), moveit::core::loadTestingRobotModel("panda"),
+    std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>()), false
+  };
+  current_state_monitor.startStateMonitor();
+  ASSERT_TRUE(joint_state_callback);
+  const auto send = [&joint_state_callback](int32_t sec, double position) {
+    auto joint_state = std::make_shared<sensor_msgs::msg::JointState>();
+    joint_state->header.stamp = rclcpp::Time(sec, 0, RCL_ROS_TIME);
+    joint_state->name = { "panda_joint1" };
+    joint_state->position = { position };
+    joint_state_callback(joint_state);
+  };
+  send(1, 0.5);
+
+  // THEN repeated reads share the same snapshot, with up-to-date transforms
+  const std::shared_ptr<const moveit::core::RobotState> first = current_state_monitor.getLatestState();
+  EXPECT_EQ(first, current_state_monitor.getLatestState());
+  EXPECT_NEAR(first->getVariablePosition("panda_joint1"), 0.5, 1e-9);
+  EXPECT_FALSE(first->dirty());
+  EXPECT_EQ(current_state_monitor.getLatestStateTime(), rclcpp::Time(1, 0, RCL_ROS_TIME));
+
+  // WHEN the state changes
+  send(2, 0.7);
+
+  // THEN a new snapshot is taken, the old one stays unchanged
+  const std::shared_ptr<const moveit::core::RobotState> second = current_state_monitor.getLatestState();
+  EXPECT_NE(first, second);
+  EXPECT_NEAR(second->getVariablePosition("panda_joint1"), 0.7, 1e-9);
+  EXPECT_NEAR(first->getVariablePosition("panda_joint1"), 0.5, 1e-9);
+  EXPECT_EQ(current_state_monitor.getLatestStateTime(), rclcpp::Time(2, 0, RCL_ROS_TIME));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
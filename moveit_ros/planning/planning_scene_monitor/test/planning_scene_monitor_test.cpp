@@ -147,6 +147,47 @@ TEST_F(PlanningSceneMonitorTest, UpdateTypes)
   TRIGGERS_UPDATE(msg, UpdateType::UPDATE_SCENE);
 }
 
+TEST_F(PlanningSceneMonitorTest, SnapshotsAreImmutable)
+{
+  const planning_scene::PlanningSceneConstPtr initial = planning_scene_monitor_->getPlanningSceneSnapshot();
+  ASSERT_TRUE(initial);
+  EXPECT_NE(initial, planning_scene_monitor_->getPlanningScene());
+
+  moveit_msgs::msg::PlanningScene msg;
+  msg.is_diff = msg.robot_state.is_diff = true;
+  moveit_msgs::msg::CollisionObject collision_object;
+  collision_object.header.frame_id = "base_link";
+  collision_object.id = "object";
+  collision_object.operation = moveit_msgs::msg::CollisionObject::ADD;
+  collision_object.pose.orientation.w = 1.0;
+  collision_object.primitives.emplace_back();
+  collision_object.primitives.back().type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  collision_object.primitives.back().dimensions = { 1.0 };
+  msg.world.collision_objects.emplace_back(collision_object);
+  planning_scene_monitor_->newPlanningSceneMessage(msg);
+
+  // the geometry update is published in a new snapshot, the one held by the reader stays untouched
+  const planning_scene::PlanningSceneConstPtr with_object = planning_scene_monitor_->getPlanningSceneSnapshot();
+  EXPECT_NE(initial, with_object);
+  EXPECT_FALSE(initial->getWorld()->hasObject("object"));
+  EXPECT_TRUE(with_object->getWorld()->hasObject("object"));
+
+  // state updates are published as a diff of the last full snapshot
+  moveit::core::RobotState state = scene_->getCurrentState();
+  state.setToRandomPositions();
+  msg.world.collision_objects.clear();
+  moveit::core::robotStateToRobotStateMsg(state, msg.robot_state, false);
+  msg.robot_state.is_diff = true;
+  planning_scene_monitor_->newPlanningSceneMessage(msg);
+
+  const planning_scene::PlanningSceneConstPtr with_state = planning_scene_monitor_->getPlanningSceneSnapshot();
+  EXPECT_EQ(with_state->getParent(), with_object);
+  EXPECT_TRUE(with_state->getWorld()->hasObject("object"));
+  const std::vector<std::string>& names = state.getVariableNames();
+  for (std::size_t i = 0; i < names.size(); ++i)
+    EXPECT_DOUBLE_EQ(with_state->getCurrentState().getVariablePosition(i), state.getVariablePosition(i)) << names[i];
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
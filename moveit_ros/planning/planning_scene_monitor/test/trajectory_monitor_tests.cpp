@@ -110,6 +110,36 @@ TEST(TrajectoryMonitorTests, SleepAtLeastOnce)
   waitFor(10s, [&]() { return static_cast<bool>(callback_called); });
 }
 
+TEST(TrajectoryMonitorTests, RecordingKeepsTheNewestStates)
+{
+  auto mock_trajectory_monitor_middleware_handle = std::make_unique<MockTrajectoryMonitorMiddlewareHandle>();
+  auto mock_current_state_monitor_middleware_handle = std::make_unique<MockCurrentStateMonitorMiddlewareHandle>();
+
+  // GIVEN a TrajectoryMonitor that can only keep 5 states
+  auto current_state_monitor = std::make_shared<planning_scene_monitor::CurrentStateMonitor>(
+      std::move(mock_current_state_monitor_middleware_handle), moveit::core::loadTestingRobotModel("panda"),
+      std::make_shared<tf2_ros::Buffer>(std::make_shared<rclcpp::Clock>()), false);
+
+  planning_scene_monitor::TrajectoryMonitor trajectory_monitor{ current_state_monitor,
+                                                                std::move(mock_trajectory_monitor_middleware_handle),
+                                                                500.0 };
+  trajectory_monitor.setRecordingCapacity(5);
+
+  std::atomic<int> samples{ 0 };
+  trajectory_monitor.setOnStateAddCallback(
+      [&](const moveit::core::RobotStateConstPtr& /* unused */, const rclcpp::Time& /* unused */) { ++samples; });
+
+  // WHEN more states than that are recorded
+  trajectory_monitor.startTrajectoryMonitor();
+  waitFor(10s, [&]() { return samples >= 10; });
+  trajectory_monitor.stopTrajectoryMonitor();
+
+  // THEN the trajectory holds the newest 5 states, until it is cleared
+  EXPECT_EQ(trajectory_monitor.getTrajectory().getWayPointCount(), 5u);
+  trajectory_monitor.clearTrajectory();
+  EXPECT_TRUE(trajectory_monitor.getTrajectory().empty());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_model/robot_model.h>
+#include <geometric_shapes/shapes.h>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace robot_model_loader
+{
+MOVEIT_CLASS_FORWARD(RobotModelCache);  // Defines RobotModelCachePtr, ConstPtr, WeakPtr... etc
+
+/** @class RobotModelCache
+    @brief A versioned binary cache of the data that is expensive to obtain when building a moveit::core::RobotModel.
+
+    Building a robot model is dominated by loading and decoding the mesh resources of the collision geometry.
+    The cache stores the decoded meshes in a single binary file, keyed on a hash of the URDF and SRDF documents.
+    The kinematic tree and groups are rebuilt from the (already parsed) documents, which is cheap in comparison,
+    and bounding volumes are recomputed from the cached meshes. */
+class RobotModelCache
+{
+public:
+  /** @brief Version of the file format. Files written with a different version are ignored. */
+  static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+  /** @brief Create a cache for the given robot description documents, stored in \e cache_directory */
+  RobotModelCache(const std::string& cache_directory, const std::string& urdf_string, const std::string& srdf_string);
+
+  /** @brief The file the cache is read from and written to */
+  const std::string& getFileName() const
+  {
+    return file_name_;
+  }
+
+  /** @brief Read the cache file. Returns false if it does not exist or does not match the documents. */
+  bool load();
+
+  /** @brief Write the cache file, if meshes were added since it was loaded. Returns false on failure. */
+  bool save() const;
+
+  /** @brief Get a mesh loader for moveit::core::RobotModel that serves meshes from the cache,
+      and loads (and adds) the meshes it does not contain. The loader must not outlive the cache. */
+  moveit::core::MeshLoaderFn getMeshLoader();
+
+  /** @brief Build a robot model, using the cache for its meshes */
+  moveit::core::RobotModelPtr buildModel(const urdf::ModelInterfaceSharedPtr& urdf_model,
+                                         const srdf::ModelConstSharedPtr& srdf_model);
+
+  /** @brief Compute the 64-bit FNV-1a hash of the robot description documents */
+  static std::uint64_t computeHash(const std::string& urdf_string, const std::string& srdf_string);
+
+private:
+  shapes::Mesh* loadMesh(const std::string& resource, const Eigen::Vector3d& scale);
+
+  std::string file_name_;
+  std::uint64_t hash_;
+
+  /** @brief Decoded meshes, keyed on resource name and scale */
+  std::map<std::pair<std::string, std::array<double, 3>>, std::shared_ptr<const shapes::Mesh>> meshes_;
+  bool modified_;
+};
+}  // namespace robot_model_loader
@@ -40,6 +40,7 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/rdf_loader/rdf_loader.h>
 #include <moveit/kinematics_plugin_loader/kinematics_plugin_loader.h>
+#include <pluginlib/class_loader.hpp>
 
 namespace robot_model_loader
 {
@@ -74,6 +75,16 @@ public:
     /** @brief Flag indicating whether the kinematics solvers should be loaded as well, using specified ROS parameters
      */
     bool load_kinematics_solvers_;
+
+    /** @brief Directory of the binary model cache (see RobotModelCache), which is used to avoid decoding meshes on
+        every start. If empty, the ROS param with the "_planning.model_cache_directory" suffix is used;
+        the cache is disabled if neither is set. */
+    std::string model_cache_directory_;
+
+    /** @brief Flag indicating whether decoded meshes should be shared with co-located processes through
+        shared memory (see SharedMeshStore). If false, the ROS param with the "_planning.shared_meshes" suffix is used.
+     */
+    bool shared_meshes_ = false;
   };
 
   /** @brief Default constructor */
@@ -126,12 +137,20 @@ public:
   void loadKinematicsSolvers(const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader =
                                  kinematics_plugin_loader::KinematicsPluginLoaderPtr());
 
+  /** @brief Load the specialized forward kinematics kernels configured for the groups of the robot model.
+      For each group, the name of an moveit::core::FKKernel plugin can be specified with the parameter
+      "<robot_description>_kinematics.<group>.fk_kernel". This is done by default when kinematics solvers are loaded. */
+  void loadFKKernels();
+
 private:
   void configure(const Options& opt);
+  std::string getModelCacheDirectory(const Options& opt) const;
+  bool useSharedMeshes(const Options& opt) const;
 
   moveit::core::RobotModelPtr model_;
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
+  std::unique_ptr<pluginlib::ClassLoader<moveit::core::FKKernel>> fk_kernel_loader_;
   const rclcpp::Node::SharedPtr node_;
 };
 }  // namespace robot_model_loader
@@ -0,0 +1,108 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_model/robot_model.h>
+#include <geometric_shapes/shapes.h>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace robot_model_loader
+{
+MOVEIT_CLASS_FORWARD(SharedMeshStore);  // Defines SharedMeshStorePtr, ConstPtr, WeakPtr... etc
+
+/** @class SharedMeshStore
+    @brief Decoded meshes of a robot model in a read-only POSIX shared-memory segment, shared by co-located processes.
+
+    The first process to load a robot model decodes its meshes as usual and publishes them into a segment named
+    after the hash of the robot description. Later processes map the segment and build their robot model with
+    shapes::Mesh instances that point into it, instead of holding a private copy of the geometry.
+    The mapping is kept alive as long as any of these meshes exists. Their data is mapped read-only, so they must
+    not be modified in place (e.g. padded or scaled); clone() them first. Segments are intentionally left in place
+    when the processes exit, so that relaunching is fast; use remove() to clean up. */
+class SharedMeshStore
+{
+public:
+  /** @brief Version of the segment layout. Segments with a different version are ignored. */
+  static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+  /** @brief Map the segment \e segment_name, if it exists. Otherwise, prepare for publishing it. */
+  SharedMeshStore(const std::string& segment_name);
+
+  /** @brief Get the segment name used for the given robot description documents */
+  static std::string getSegmentName(const std::string& urdf_string, const std::string& srdf_string);
+
+  /** @brief Remove the segment \e segment_name. Processes that mapped it keep their mapping. */
+  static bool remove(const std::string& segment_name);
+
+  /** @brief Returns true if an existing segment was mapped */
+  bool isMapped() const
+  {
+    return static_cast<bool>(mapping_);
+  }
+
+  /** @brief Get a mesh loader for moveit::core::RobotModel that serves meshes from the segment.
+      Meshes not found in the segment are loaded with \e fallback (or shapes::createMeshFromResource() if empty),
+      and are recorded for publish() if no segment was mapped. The loader must not outlive the store. */
+  moveit::core::MeshLoaderFn getMeshLoader(const moveit::core::MeshLoaderFn& fallback = moveit::core::MeshLoaderFn());
+
+  /** @brief Create the segment from the meshes recorded by the mesh loader, if no segment was mapped.
+      Returns false if the segment could not be created (e.g. because another process created it concurrently). */
+  bool publish();
+
+  struct Mapping;
+  struct Entry;
+
+private:
+  shapes::Mesh* loadMesh(const std::string& resource, const Eigen::Vector3d& scale,
+                         const moveit::core::MeshLoaderFn& fallback);
+
+  typedef std::pair<std::string, std::array<double, 3>> Key;
+
+  std::string segment_name_;
+
+  /** @brief The mapped segment, if it exists */
+  std::shared_ptr<const Mapping> mapping_;
+  std::map<Key, const Entry*> entries_;
+
+  /** @brief Meshes loaded while no segment was mapped, to be published */
+  std::map<Key, std::shared_ptr<const shapes::Mesh>> recorded_meshes_;
+};
+}  // namespace robot_model_loader
@@ -0,0 +1,241 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_model_loader/robot_model_cache.h>
+#include <geometric_shapes/shape_operations.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace robot_model_loader
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.robot_model_cache");
+
+namespace
+{
+constexpr char MAGIC[8] = { 'M', 'V', 'T', 'M', 'O', 'D', 'E', 'L' };
+
+// flags stored with each mesh
+constexpr std::uint8_t HAS_VERTEX_NORMALS = 1;
+
+template <typename T>
+void write(std::ostream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read(std::istream& in, T& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+}  // namespace
+
+RobotModelCache::RobotModelCache(const std::string& cache_directory, const std::string& urdf_string,
+                                 const std::string& srdf_string)
+  : hash_(computeHash(urdf_string, srdf_string)), modified_(false)
+{
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash_ << ".moveit_model";
+  file_name_ = (std::filesystem::path(cache_directory) / ss.str()).string();
+}
+
+std::uint64_t RobotModelCache::computeHash(const std::string& urdf_string, const std::string& srdf_string)
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  auto add = [&hash](const std::string& data) {
+    for (const char c : data)
+    {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+  };
+  add(urdf_string);
+  add(std::string(1, '\0'));  // separate the documents, so that moving text between them changes the hash
+  add(srdf_string);
+  return hash;
+}
+
+bool RobotModelCache::load()
+{
+  std::ifstream in(file_name_, std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(MAGIC)];
+  std::uint32_t version, count;
+  std::uint64_t hash;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !read(in, version) ||
+      version != FORMAT_VERSION || !read(in, hash) || hash != hash_ || !read(in, count))
+  {
+    RCLCPP_WARN(LOGGER, "Ignoring robot model cache '%s' written for a different model or format version",
+                file_name_.c_str());
+    return false;
+  }
+
+  std::map<std::pair<std::string, std::array<double, 3>>, std::shared_ptr<const shapes::Mesh>> meshes;
+  for (std::uint32_t i = 0; i < count; ++i)
+  {
+    std::uint32_t name_length, vertex_count, triangle_count;
+    std::array<double, 3> scale;
+    std::uint8_t flags;
+    if (!read(in, name_length))
+      break;
+    std::string name(name_length, '\0');
+    if (!in.read(&name[0], name_length) || !read(in, scale) || !read(in, vertex_count) || !read(in, triangle_count) ||
+        !read(in, flags))
+      break;
+
+    auto mesh = std::make_shared<shapes::Mesh>(vertex_count, triangle_count);
+    if (!in.read(reinterpret_cast<char*>(mesh->vertices), sizeof(double) * 3 * vertex_count))
+      break;
+    for (unsigned int j = 0; j < 3 * triangle_count; ++j)
+    {
+      std::uint32_t index;
+      if (!read(in, index))
+        break;
+      mesh->triangles[j] = index;
+    }
+    if (!in)
+      break;
+
+    // normals are cheap to recompute and not worth the file size
+    mesh->computeTriangleNormals();
+    if (flags & HAS_VERTEX_NORMALS)
+      mesh->computeVertexNormals();
+    meshes[std::make_pair(name, scale)] = mesh;
+  }
+
+  if (meshes.size() != count)
+  {
+    RCLCPP_WARN(LOGGER, "Robot model cache '%s' is truncated, ignoring it", file_name_.c_str());
+    return false;
+  }
+
+  meshes_ = std::move(meshes);
+  modified_ = false;
+  RCLCPP_INFO(LOGGER, "Loaded %zu meshes from robot model cache '%s'", meshes_.size(), file_name_.c_str());
+  return true;
+}
+
+bool RobotModelCache::save() const
+{
+  if (!modified_)
+    return true;
+
+  std::error_code ec;
+  const std::filesystem::path path(file_name_);
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+  // write to a temporary file first, so that concurrently starting processes never read a partial cache
+  const std::string tmp_file_name = file_name_ + ".tmp" + std::to_string(reinterpret_cast<std::uintptr_t>(this));
+  {
+    std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to write robot model cache '%s'", file_name_.c_str());
+      return false;
+    }
+
+    out.write(MAGIC, sizeof(MAGIC));
+    write(out, FORMAT_VERSION);
+    write(out, hash_);
+    write(out, static_cast<std::uint32_t>(meshes_.size()));
+    for (const auto& [key, mesh] : meshes_)
+    {
+      write(out, static_cast<std::uint32_t>(key.first.size()));
+      out.write(key.first.data(), key.first.size());
+      write(out, key.second);
+      write(out, static_cast<std::uint32_t>(mesh->vertex_count));
+      write(out, static_cast<std::uint32_t>(mesh->triangle_count));
+      write(out, static_cast<std::uint8_t>(mesh->vertex_normals ? HAS_VERTEX_NORMALS : 0));
+      out.write(reinterpret_cast<const char*>(mesh->vertices), sizeof(double) * 3 * mesh->vertex_count);
+      for (unsigned int j = 0; j < 3 * mesh->triangle_count; ++j)
+        write(out, static_cast<std::uint32_t>(mesh->triangles[j]));
+    }
+    if (!out)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to write robot model cache '%s'", file_name_.c_str());
+      std::filesystem::remove(tmp_file_name, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmp_file_name, file_name_, ec);
+  if (ec)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to write robot model cache '%s': %s", file_name_.c_str(), ec.message().c_str());
+    std::filesystem::remove(tmp_file_name, ec);
+    return false;
+  }
+  RCLCPP_INFO(LOGGER, "Wrote %zu meshes to robot model cache '%s'", meshes_.size(), file_name_.c_str());
+  return true;
+}
+
+shapes::Mesh* RobotModelCache::loadMesh(const std::string& resource, const Eigen::Vector3d& scale)
+{
+  const auto key = std::make_pair(resource, std::array<double, 3>{ scale.x(), scale.y(), scale.z() });
+  const auto it = meshes_.find(key);
+  if (it != meshes_.end())
+    return it->second->clone();
+
+  shapes::Mesh* mesh = shapes::createMeshFromResource(resource, scale);
+  if (mesh)
+  {
+    meshes_[key] = std::shared_ptr<const shapes::Mesh>(mesh->clone());
+    modified_ = true;
+  }
+  return mesh;
+}
+
+moveit::core::MeshLoaderFn RobotModelCache::getMeshLoader()
+{
+  return [this](const std::string& resource, const Eigen::Vector3d& scale) { return loadMesh(resource, scale); };
+}
+
+moveit::core::RobotModelPtr RobotModelCache::buildModel(const urdf::ModelInterfaceSharedPtr& urdf_model,
+                                                        const srdf::ModelConstSharedPtr& srdf_model)
+{
+  load();
+  auto model = std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model, getMeshLoader());
+  save();
+  return model;
+}
+}  // namespace robot_model_loader
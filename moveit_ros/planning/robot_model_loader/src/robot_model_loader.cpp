@@ -35,12 +35,18 @@
 /* Author: Ioan Sucan, E. Gil Jones */
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_model_loader/robot_model_cache.h>
+#include <moveit/robot_model_loader/shared_mesh_store.h>
 #include <rclcpp/clock.hpp>
 #include <rclcpp/duration.hpp>
 #include <rclcpp/logger.hpp>
 #include <rclcpp/logging.hpp>
 #include <rclcpp/parameter_value.hpp>
 #include <rclcpp/time.hpp>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <typeinfo>
 
 namespace robot_model_loader
@@ -71,6 +77,7 @@ RobotModelLoader::~RobotModelLoader()
   model_.reset();
   rdf_loader_.reset();
   kinematics_loader_.reset();
+  fk_kernel_loader_.reset();
 }
 
 namespace
@@ -101,6 +108,46 @@ bool canSpecifyPosition(const moveit::core::JointModel* jmodel, const unsigned i
 }
 }  // namespace
 
+std::string RobotModelLoader::getModelCacheDirectory(const Options& opt) const
+{
+  if (!opt.model_cache_directory_.empty() || rdf_loader_->getRobotDescription().empty())
+    return opt.model_cache_directory_;
+
+  std::string directory;
+  const std::string param_name = rdf_loader_->getRobotDescription() + "_planning.model_cache_directory";
+  try
+  {
+    if (!node_->has_parameter(param_name))
+      node_->declare_parameter(param_name, rclcpp::ParameterType::PARAMETER_STRING);
+    node_->get_parameter(param_name, directory);
+  }
+  catch (const rclcpp::ParameterTypeException& e)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "When getting the parameter " << param_name.c_str() << ": " << e.what());
+  }
+  return directory;
+}
+
+bool RobotModelLoader::useSharedMeshes(const Options& opt) const
+{
+  if (opt.shared_meshes_ || rdf_loader_->getRobotDescription().empty())
+    return opt.shared_meshes_;
+
+  bool shared_meshes = false;
+  const std::string param_name = rdf_loader_->getRobotDescription() + "_planning.shared_meshes";
+  try
+  {
+    if (!node_->has_parameter(param_name))
+      node_->declare_parameter(param_name, rclcpp::ParameterType::PARAMETER_BOOL);
+    node_->get_parameter(param_name, shared_meshes);
+  }
+  catch (const rclcpp::ParameterTypeException& e)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "When getting the parameter " << param_name.c_str() << ": " << e.what());
+  }
+  return shared_meshes;
+}
+
 void RobotModelLoader::configure(const Options& opt)
 {
   rclcpp::Clock clock;
@@ -113,7 +160,35 @@ void RobotModelLoader::configure(const Options& opt)
   {
     const srdf::ModelSharedPtr& srdf =
         rdf_loader_->getSRDF() ? rdf_loader_->getSRDF() : std::make_shared<srdf::Model>();
-    model_ = std::make_shared<moveit::core::RobotModel>(rdf_loader_->getURDF(), srdf);
+
+    // meshes are looked up in shared memory first, then in the binary cache, and only then decoded from resources
+    moveit::core::MeshLoaderFn mesh_loader;
+    std::unique_ptr<RobotModelCache> cache;
+    const std::string cache_directory = getModelCacheDirectory(opt);
+    if (!cache_directory.empty())
+    {
+      cache = std::make_unique<RobotModelCache>(cache_directory, rdf_loader_->getURDFString(),
+                                                rdf_loader_->getSRDFString());
+      cache->load();
+      mesh_loader = cache->getMeshLoader();
+    }
+    std::unique_ptr<SharedMeshStore> shared_meshes;
+    if (useSharedMeshes(opt))
+    {
+      shared_meshes = std::make_unique<SharedMeshStore>(
+          SharedMeshStore::getSegmentName(rdf_loader_->getURDFString(), rdf_loader_->getSRDFString()));
+      mesh_loader = shared_meshes->getMeshLoader(mesh_loader);
+    }
+
+    if (mesh_loader)
+      model_ = std::make_shared<moveit::core::RobotModel>(rdf_loader_->getURDF(), srdf, mesh_loader);
+    else
+      model_ = std::make_shared<moveit::core::RobotModel>(rdf_loader_->getURDF(), srdf);
+
+    if (cache)
+      cache->save();
+    if (shared_meshes)
+      shared_meshes->publish();
   }
 
   if (model_ && !rdf_loader_->getRobotDescription().empty())
@@ -240,10 +315,15 @@ void RobotModelLoader::configure(const Options& opt)
       }
       joint_model->setVariableBounds(joint_limit);
     }
+    for (moveit::core::JointModelGroup* jmg : model_->getJointModelGroups())
+      jmg->updateVariableBounds();
   }
 
   if (model_ && opt.load_kinematics_solvers_)
+  {
     loadKinematicsSolvers();
+    loadFKKernels();
+  }
 
   RCLCPP_DEBUG(node_->get_logger(), "Loaded kinematic model in %f seconds", (clock.now() - start).seconds());
 }
@@ -267,16 +347,53 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     if (groups.empty() && !model_->getJointModelGroups().empty())
       RCLCPP_WARN(LOGGER, "No kinematics plugins defined. Fill and load kinematics.yaml!");
 
-    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    std::vector<const moveit::core::JointModelGroup*> jmgs;
     for (const std::string& group : groups)
     {
       // Check if a group in kinematics.yaml exists in the srdf
-      if (!model_->hasJointModelGroup(group))
-        continue;
+      if (model_->hasJointModelGroup(group))
+        jmgs.push_back(model_->getJointModelGroup(group));
+    }
 
-      const moveit::core::JointModelGroup* jmg = model_->getJointModelGroup(group);
+    // Allocating a solver includes its initialization, which can be slow (e.g. loading an IK cache from disk), so the
+    // solvers of all groups are allocated concurrently. The loader keeps each instance until it is handed to its
+    // group by setKinematicsAllocators() below.
+    std::vector<kinematics::KinematicsBasePtr> solvers(jmgs.size());
+    std::atomic<std::size_t> next_group{ 0 };
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const auto allocate_solvers = [&] {
+      for (std::size_t i = next_group++; i < jmgs.size(); i = next_group++)
+      {
+        try
+        {
+          solvers[i] = kinematics_allocator(jmgs[i]);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error)
+            error = std::current_exception();
+        }
+      }
+    };
+    const std::size_t thread_count =
+        std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), jmgs.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i)
+      threads.emplace_back(allocate_solvers);
+    allocate_solvers();  // the calling thread is one of the workers
+    for (std::thread& thread : threads)
+      thread.join();
+    if (error)
+      std::rethrow_exception(error);
 
-      kinematics::KinematicsBasePtr solver = kinematics_allocator(jmg);
+    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    for (std::size_t i = 0; i < jmgs.size(); ++i)
+    {
+      const moveit::core::JointModelGroup* jmg = jmgs[i];
+      const std::string& group = jmg->getName();
+      const kinematics::KinematicsBasePtr& solver = solvers[i];
       if (solver)
       {
         std::string error_msg;
@@ -296,6 +413,7 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
         RCLCPP_ERROR(LOGGER, "Kinematics solver could not be instantiated for joint group %s.", group.c_str());
       }
     }
+    solvers.clear();  // release our references, so that the cached instances are passed on to the groups
     model_->setKinematicsAllocators(imap);
 
     // set the default IK timeouts
@@ -309,4 +427,45 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     }
   }
 }
+
+void RobotModelLoader::loadFKKernels()
+{
+  if (!rdf_loader_ || !model_ || rdf_loader_->getRobotDescription().empty())
+    return;
+
+  for (const moveit::core::JointModelGroup* jmg : model_->getJointModelGroups())
+  {
+    std::string param_name = rdf_loader_->getRobotDescription() + "_kinematics." + jmg->getName() + ".fk_kernel";
+    std::string kernel_name;
+    try
+    {
+      if (!node_->has_parameter(param_name))
+        node_->declare_parameter(param_name, rclcpp::ParameterType::PARAMETER_STRING);
+      if (!node_->get_parameter(param_name, kernel_name) || kernel_name.empty())
+        continue;
+    }
+    catch (const rclcpp::ParameterTypeException& e)
+    {
+      RCLCPP_ERROR_STREAM(LOGGER, "When getting the parameter " << param_name.c_str() << ": " << e.what());
+      continue;
+    }
+
+    try
+    {
+      if (!fk_kernel_loader_)
+        fk_kernel_loader_ = std::make_unique<pluginlib::ClassLoader<moveit::core::FKKernel>>(
+            "moveit_core", "moveit::core::FKKernel");
+      moveit::core::FKKernelConstPtr kernel = fk_kernel_loader_->createSharedInstance(kernel_name);
+      if (!model_->setFKKernel(kernel))
+        RCLCPP_ERROR(LOGGER, "FK kernel '%s' does not match the robot model, not used for group '%s'",
+                     kernel_name.c_str(), jmg->getName().c_str());
+      else
+        RCLCPP_INFO(LOGGER, "Using FK kernel '%s' for group '%s'", kernel_name.c_str(), jmg->getName().c_str());
+    }
+    catch (pluginlib::PluginlibException& e)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to load FK kernel '%s': %s", kernel_name.c_str(), e.what());
+    }
+  }
+}
 }  // namespace robot_model_loader
@@ -0,0 +1,295 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_model_loader/shared_mesh_store.h>
+#include <moveit/robot_model_loader/robot_model_cache.h>
+#include <geometric_shapes/shape_operations.h>
+#include <rclcpp/logger.hpp>
+#include <rclcpp/logging.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace robot_model_loader
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.shared_mesh_store");
+
+namespace
+{
+constexpr char MAGIC[8] = { 'M', 'V', 'T', 'M', 'E', 'S', 'H', 'M' };
+
+struct Header
+{
+  char magic[8];
+  std::uint32_t version;
+  /** Set last by the creating process, once the segment is complete */
+  std::atomic<std::uint32_t> ready;
+  std::uint64_t count;
+};
+
+std::uint64_t align(std::uint64_t offset)
+{
+  return (offset + 7) & ~std::uint64_t(7);
+}
+}  // namespace
+
+struct SharedMeshStore::Entry
+{
+  std::uint64_t name_offset;
+  std::uint64_t vertices_offset;
+  std::uint64_t triangles_offset;
+  std::uint64_t triangle_normals_offset;  // 0 if not available
+  std::uint64_t vertex_normals_offset;    // 0 if not available
+  double scale[3];
+  std::uint32_t name_length;
+  std::uint32_t vertex_count;
+  std::uint32_t triangle_count;
+};
+
+struct SharedMeshStore::Mapping
+{
+  Mapping(void* data, std::size_t size) : data(static_cast<char*>(data)), size(size)
+  {
+  }
+
+  ~Mapping()
+  {
+    munmap(data, size);
+  }
+
+  char* data;
+  std::size_t size;
+};
+
+namespace
+{
+/** A mesh whose data lives in a shared-memory segment, which is kept mapped while the mesh exists */
+class SharedMesh : public shapes::Mesh
+{
+public:
+  SharedMesh(const std::shared_ptr<const SharedMeshStore::Mapping>& mapping, const SharedMeshStore::Entry& entry)
+    : mapping_(mapping)
+  {
+    // the data is mapped read-only and must not be written through these pointers
+    char* data = mapping->data;
+    vertex_count = entry.vertex_count;
+    triangle_count = entry.triangle_count;
+    vertices = reinterpret_cast<double*>(data + entry.vertices_offset);
+    triangles = reinterpret_cast<unsigned int*>(data + entry.triangles_offset);
+    triangle_normals =
+        entry.triangle_normals_offset ? reinterpret_cast<double*>(data + entry.triangle_normals_offset) : nullptr;
+    vertex_normals =
+        entry.vertex_normals_offset ? reinterpret_cast<double*>(data + entry.vertex_normals_offset) : nullptr;
+  }
+
+  ~SharedMesh() override
+  {
+    // the memory belongs to the segment, prevent shapes::Mesh from freeing it
+    vertices = nullptr;
+    triangles = nullptr;
+    triangle_normals = nullptr;
+    vertex_normals = nullptr;
+  }
+
+private:
+  std::shared_ptr<const SharedMeshStore::Mapping> mapping_;
+};
+}  // namespace
+
+SharedMeshStore::SharedMeshStore(const std::string& segment_name) : segment_name_(segment_name)
+{
+  int fd = shm_open(segment_name_.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header))
+  {
+    close(fd);
+    return;
+  }
+  const std::size_t size = st.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return;
+  auto mapping = std::make_shared<const Mapping>(data, size);
+
+  const Header* header = reinterpret_cast<const Header*>(mapping->data);
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != FORMAT_VERSION ||
+      !header->ready.load(std::memory_order_acquire))
+  {
+    RCLCPP_WARN(LOGGER, "Ignoring incomplete or incompatible shared mesh segment '%s'", segment_name_.c_str());
+    return;
+  }
+
+  const Entry* entries = reinterpret_cast<const Entry*>(mapping->data + align(sizeof(Header)));
+  for (std::uint64_t i = 0; i < header->count; ++i)
+  {
+    const Entry& entry = entries[i];
+    std::string name(mapping->data + entry.name_offset, entry.name_length);
+    entries_[Key(name, { entry.scale[0], entry.scale[1], entry.scale[2] })] = &entry;
+  }
+  mapping_ = mapping;
+  RCLCPP_INFO(LOGGER, "Mapped %zu shared meshes from segment '%s'", entries_.size(), segment_name_.c_str());
+}
+
+std::string SharedMeshStore::getSegmentName(const std::string& urdf_string, const std::string& srdf_string)
+{
+  std::stringstream ss;
+  ss << "/moveit_meshes_" << std::hex << std::setw(16) << std::setfill('0')
+     << RobotModelCache::computeHash(urdf_string, srdf_string);
+  return ss.str();
+}
+
+bool SharedMeshStore::remove(const std::string& segment_name)
+{
+  return shm_unlink(segment_name.c_str()) == 0;
+}
+
+shapes::Mesh* SharedMeshStore::loadMesh(const std::string& resource, const Eigen::Vector3d& scale,
+                                        const moveit::core::MeshLoaderFn& fallback)
+{
+  const Key key(resource, { scale.x(), scale.y(), scale.z() });
+  const auto it = entries_.find(key);
+  if (it != entries_.end())
+    return new SharedMesh(mapping_, *it->second);
+
+  shapes::Mesh* mesh = fallback ? fallback(resource, scale) : shapes::createMeshFromResource(resource, scale);
+  if (mesh && !mapping_)
+    recorded_meshes_[key] = std::shared_ptr<const shapes::Mesh>(mesh->clone());
+  return mesh;
+}
+
+moveit::core::MeshLoaderFn SharedMeshStore::getMeshLoader(const moveit::core::MeshLoaderFn& fallback)
+{
+  return [this, fallback](const std::string& resource, const Eigen::Vector3d& scale) {
+    return loadMesh(resource, scale, fallback);
+  };
+}
+
+bool SharedMeshStore::publish()
+{
+  if (mapping_ || recorded_meshes_.empty())
+    return true;
+
+  // compute the layout: header, entries, then names and mesh data
+  const std::uint64_t entries_offset = align(sizeof(Header));
+  std::uint64_t size = entries_offset + recorded_meshes_.size() * sizeof(Entry);
+  std::vector<Entry> entries;
+  for (const auto& [key, mesh] : recorded_meshes_)
+  {
+    Entry entry{};
+    entry.name_length = key.first.size();
+    entry.vertex_count = mesh->vertex_count;
+    entry.triangle_count = mesh->triangle_count;
+    std::copy(key.second.begin(), key.second.end(), entry.scale);
+    entry.name_offset = size;
+    size = align(size + key.first.size());
+    entry.vertices_offset = size;
+    size = align(size + sizeof(double) * 3 * mesh->vertex_count);
+    entry.triangles_offset = size;
+    size = align(size + sizeof(unsigned int) * 3 * mesh->triangle_count);
+    if (mesh->triangle_normals)
+    {
+      entry.triangle_normals_offset = size;
+      size = align(size + sizeof(double) * 3 * mesh->triangle_count);
+    }
+    if (mesh->vertex_normals)
+    {
+      entry.vertex_normals_offset = size;
+      size = align(size + sizeof(double) * 3 * mesh->vertex_count);
+    }
+    entries.push_back(entry);
+  }
+
+  // O_EXCL makes sure only one of several concurrently starting processes creates the segment
+  int fd = shm_open(segment_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+  {
+    RCLCPP_DEBUG(LOGGER, "Shared mesh segment '%s' was not created: %s", segment_name_.c_str(), strerror(errno));
+    return false;
+  }
+  if (ftruncate(fd, size) != 0)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to allocate shared mesh segment '%s': %s", segment_name_.c_str(), strerror(errno));
+    close(fd);
+    shm_unlink(segment_name_.c_str());
+    return false;
+  }
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to map shared mesh segment '%s': %s", segment_name_.c_str(), strerror(errno));
+    shm_unlink(segment_name_.c_str());
+    return false;
+  }
+
+  char* bytes = static_cast<char*>(data);
+  Header* header = new (bytes) Header();
+  std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+  header->version = FORMAT_VERSION;
+  header->count = entries.size();
+  std::memcpy(bytes + entries_offset, entries.data(), entries.size() * sizeof(Entry));
+  std::size_t i = 0;
+  for (const auto& [key, mesh] : recorded_meshes_)
+  {
+    const Entry& entry = entries[i++];
+    std::memcpy(bytes + entry.name_offset, key.first.data(), key.first.size());
+    std::memcpy(bytes + entry.vertices_offset, mesh->vertices, sizeof(double) * 3 * mesh->vertex_count);
+    std::memcpy(bytes + entry.triangles_offset, mesh->triangles, sizeof(unsigned int) * 3 * mesh->triangle_count);
+    if (entry.triangle_normals_offset)
+      std::memcpy(bytes + entry.triangle_normals_offset, mesh->triangle_normals,
+                  sizeof(double) * 3 * mesh->triangle_count);
+    if (entry.vertex_normals_offset)
+      std::memcpy(bytes + entry.vertex_normals_offset, mesh->vertex_normals, sizeof(double) * 3 * mesh->vertex_count);
+  }
+  header->ready.store(1, std::memory_order_release);
+  munmap(data, size);
+
+  RCLCPP_INFO(LOGGER, "Published %zu meshes to shared segment '%s'", entries.size(), segment_name_.c_str());
+  recorded_meshes_.clear();
+  return true;
+}
+}  // namespace robot_model_loader
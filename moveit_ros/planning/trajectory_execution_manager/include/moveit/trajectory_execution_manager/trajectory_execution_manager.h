@@ -47,8 +47,10 @@
 #include <pluginlib/class_loader.hpp>
 
 #include <memory>
+#include <chrono>
 #include <deque>
 #include <thread>
+#include <tuple>
 
 #include <moveit_trajectory_execution_manager_export.h>
 
@@ -81,6 +83,25 @@ public:
     // The trajectory to execute, split in different parts (by joints), each set of joints corresponding to one
     // controller
     std::vector<moveit_msgs::msg::RobotTrajectory> trajectory_parts_;
+
+    /// If not negative, the trajectory starts this many seconds after the start of the previous trajectory, instead of
+    /// after its completion
+    double start_offset_ = -1.0;
+  };
+
+  /// The time in seconds that the execution of a pushed trajectory spent in each stage
+  struct ExecutionLatency
+  {
+    /// Making sure the controllers are active and retrieving their handles
+    double preparation = 0.0;
+    /// Sending the trajectory parts to the controllers
+    double dispatch = 0.0;
+    /// From the dispatch until the controllers that were waited for reported completion
+    double execution = 0.0;
+    /// From the completion of the previous trajectory until the dispatch of this one
+    double gap = 0.0;
+    /// From the call to execute() until the dispatch of this trajectory
+    double since_execute = 0.0;
   };
 
   /// Load the controller manager plugin, start listening for events on a topic.
@@ -153,6 +174,13 @@ public:
   /// If no controller is specified, a default is used.
   bool push(const moveit_msgs::msg::RobotTrajectory& trajectory, const std::vector<std::string>& controllers);
 
+  /// Add a trajectory that starts \e start_offset seconds after the start of the previously pushed trajectory, instead
+  /// of after its completion, e.g. to open a gripper during the approach motion of an arm. Both are scheduled on the
+  /// same timeline, so the trajectory must not use any of the controllers of the previous one. Trajectories pushed
+  /// after it can start relative to it in the same way.
+  bool pushWithStartOffset(const moveit_msgs::msg::RobotTrajectory& trajectory, double start_offset,
+                           const std::vector<std::string>& controllers = std::vector<std::string>());
+
   /// Get the trajectories to be executed
   const std::vector<TrajectoryExecutionContext*>& getTrajectories() const;
 
@@ -218,6 +246,9 @@ public:
   /// Return the controller status for the last attempted execution
   moveit_controller_manager::ExecutionStatus getLastExecutionStatus() const;
 
+  /// Return the latency of the stages of each trajectory of the last (or current) call to execute()
+  std::vector<ExecutionLatency> getLastExecutionLatency() const;
+
   /// Stop whatever executions are active, if any
   void stopExecution(bool auto_clear = true);
 
@@ -243,12 +274,56 @@ public:
   /// Enable or disable waiting for trajectory completion
   void setWaitForTrajectoryCompletion(bool flag);
 
+  /// Stream trajectories to the controllers in chunks that reach \e lookahead seconds ahead of the current time,
+  /// instead of sending each trajectory at once. A value of 0 (the default) disables streaming. Trajectories are only
+  /// streamed if all their controllers support updating the executed trajectory.
+  void setStreamingLookahead(double lookahead);
+
+  /// Start the next pushed trajectory as soon as the controllers it uses are done, instead of waiting for all
+  /// controllers of the current trajectory. This lets independent controllers (e.g. arm and gripper) overlap, so it
+  /// should only be enabled if consecutive trajectories do not depend on each other's completion. Disabled by default
+  void setOverlapIndependentControllers(bool flag);
+
+  /// Abort the execution as soon as a joint deviates more than \e tolerance from the expected trajectory (radians for
+  /// revolute joints). The deviation is sampled from the state history of the current state monitor, which needs to be
+  /// enabled (see CurrentStateMonitor::setStateHistoryCapacity()). A value of 0 (the default) disables the monitoring
+  void setAllowedTrackingError(double tolerance);
+
+  /// Set the rate (Hz) at which the tracking error is sampled, see setAllowedTrackingError(). By default, this is 100
+  void setTrackingMonitorRate(double rate);
+
+  /** \brief Replace the remainder of the trajectory that is currently streamed to the controllers.
+   *
+   * The trajectory starts at its header stamp, or now if that is zero. Its points replace the points of the executed
+   * trajectory from then on, and are sent to the controllers with the next chunk. The expected trajectory index
+   * (getCurrentExpectedTrajectoryIndex()) keeps referring to the original trajectory.
+   * @return False if no trajectory is streamed, or if the trajectory does not match the executed one */
+  bool spliceTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory);
+
   rclcpp::Node::SharedPtr getControllerManagerNode()
   {
     return controller_mgr_node_;
   }
 
 private:
+  /// The trajectory parts that are currently streamed, see setStreamingLookahead()
+  struct StreamingState
+  {
+    std::vector<std::string> controllers_;
+    std::vector<moveit_msgs::msg::RobotTrajectory> trajectory_parts_;
+    rclcpp::Time start_time_;
+    double sent_until_;  // time from start up to which the points were sent to the controllers
+    bool spliced_;
+  };
+
+  /// The expected trajectory of a controller during execution, to compare the recorded states against
+  struct TrackedPart
+  {
+    trajectory_msgs::msg::JointTrajectory trajectory_;
+    rclcpp::Time start_time_;
+    std::vector<const moveit::core::JointModel*> joints_;  // the single-variable joints of trajectory_, in its order
+  };
+
   struct ControllerInformation
   {
     std::string name_;
@@ -273,6 +348,9 @@ private:
   bool validate(const TrajectoryExecutionContext& context) const;
   bool configure(TrajectoryExecutionContext& context, const moveit_msgs::msg::RobotTrajectory& trajectory,
                  const std::vector<std::string>& controllers);
+  static std::size_t hashTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory);
+  void cacheConfiguration(std::size_t hash, const moveit_msgs::msg::RobotTrajectory& trajectory,
+                          const std::vector<std::string>& controllers, const TrajectoryExecutionContext& context);
 
   void updateControllersState(const rclcpp::Duration& age);
   void updateControllerState(const std::string& controller, const rclcpp::Duration& age);
@@ -282,6 +360,19 @@ private:
                             const std::vector<std::string>& controllers,
                             std::vector<moveit_msgs::msg::RobotTrajectory>& parts);
 
+  /// The joints of the trajectory part of a controller, and their indices in the distributed trajectory
+  struct TrajectoryPartJoints
+  {
+    std::vector<std::string> joint_names_;
+    std::vector<std::size_t> joint_indices_;
+    std::vector<std::string> multi_dof_joint_names_;
+    std::vector<std::size_t> multi_dof_joint_indices_;
+  };
+  /// Get the (cached) joints of the trajectory parts of \e controllers, or nullptr if a controller is unknown
+  std::shared_ptr<const std::vector<TrajectoryPartJoints>>
+  getTrajectoryDistribution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                            const std::vector<std::string>& controllers);
+
   bool findControllers(const std::set<std::string>& actuated_joints, std::size_t controller_count,
                        const std::vector<std::string>& available_controllers,
                        std::vector<std::string>& selected_controllers);
@@ -298,6 +389,25 @@ private:
   void executeThread(const ExecutionCompleteCallback& callback, const PathSegmentCompleteCallback& part_callback,
                      bool auto_clear);
   bool executePart(std::size_t part_index);
+  /// Start comparing the recorded states against the parts of \e context. The parts start at \e start_time if it is
+  /// nonzero (streamed parts), and otherwise at their header stamp or \e current_time, whichever is later
+  void startTrackingMonitor(const TrajectoryExecutionContext& context, const rclcpp::Time& start_time,
+                            const rclcpp::Time& current_time);
+  /// Stop the tracking monitor, and return true if it stopped the execution because of a tracking error
+  bool stopTrackingMonitor();
+  void trackingMonitorThread();
+  /// Get the largest deviation of \e positions from \e part at time \e t, and the joint it occurs at
+  double computeTrackingError(const TrackedPart& part, const rclcpp::Time& t, const std::vector<double>& positions,
+                              const moveit::core::JointModel*& joint) const;
+  /// Wait for the deferred handles of controllers that overlap with \e controllers, or for all of them if
+  /// \e controllers is null. Return false if one of them failed or timed out
+  bool waitForDeferredHandles(const std::vector<std::string>* controllers);
+  /// Check whether controller shares joints with any of \e controllers
+  bool overlapsControllers(const std::string& controller, const std::vector<std::string>& controllers) const;
+  /// Send the chunks of the streamed trajectory to the handles until all points are sent. On success, \e end_time is
+  /// set to the time at which the streamed (and possibly spliced) trajectory ends
+  bool streamTrajectory(const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles,
+                        rclcpp::Time& end_time);
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
   void continuousExecutionThread();
 
@@ -321,6 +431,26 @@ private:
   planning_scene_monitor::CurrentStateMonitorPtr csm_;
   rclcpp::Subscription<std_msgs::msg::String>::SharedPtr event_topic_subscriber_;
   std::map<std::string, ControllerInformation> known_controllers_;
+
+  // selected controllers for a set of joints and the available controllers, cleared when a controller state changes
+  using ControllerSelectionKey = std::pair<std::set<std::string>, std::vector<std::string>>;
+  std::map<ControllerSelectionKey, std::vector<std::string>> controller_selection_cache_;
+  // the joints of the trajectory parts for the joint names of a trajectory and the controllers
+  using TrajectoryDistributionKey =
+      std::tuple<std::vector<std::string>, std::vector<std::string>, std::vector<std::string>>;
+  std::map<TrajectoryDistributionKey, std::shared_ptr<const std::vector<TrajectoryPartJoints>>>
+      trajectory_distribution_cache_;
+  // configured trajectory parts of recently pushed trajectories, valid while the generation of the caches is the same
+  struct ConfiguredTrajectory
+  {
+    moveit_msgs::msg::RobotTrajectory trajectory_;
+    std::vector<std::string> requested_controllers_;
+    TrajectoryExecutionContext context_;
+    std::size_t generation_;
+  };
+  std::map<std::size_t, ConfiguredTrajectory> configured_trajectory_cache_;
+  std::size_t controller_cache_generation_ = 0;  // incremented whenever the controller selections are invalidated
+  std::mutex controller_cache_mutex_;
   bool manage_controllers_;
 
   // thread used to execute trajectories using the execute() command
@@ -368,6 +498,36 @@ private:
   double execution_velocity_scaling_;
   bool wait_for_trajectory_completion_;
 
+  double streaming_lookahead_;
+
+  /// A controller that is still executing a trajectory part whose completion was not waited for yet
+  struct DeferredHandle
+  {
+    moveit_controller_manager::MoveItControllerHandlePtr handle_;
+    rclcpp::Time deadline_;
+  };
+  bool overlap_independent_controllers_;
+  std::vector<DeferredHandle> deferred_handles_;  // protected by execution_state_mutex_
+  int prepared_part_;  // index of the part whose controllers were checked while the previous part executed
+  rclcpp::Time last_part_start_time_;  // when the last executed part started, for parts with a start offset
+
+  std::vector<ExecutionLatency> execution_latency_;
+  std::chrono::steady_clock::time_point last_part_completion_;
+  std::chrono::steady_clock::time_point execute_call_time_;
+  mutable std::mutex execution_latency_mutex_;
+  std::unique_ptr<StreamingState> streaming_;
+  std::mutex streaming_mutex_;
+  std::condition_variable streaming_condition_;
+
+  double allowed_tracking_error_;
+  double tracking_monitor_rate_;
+  std::vector<TrackedPart> tracked_parts_;  // protected by tracking_mutex_
+  std::unique_ptr<std::thread> tracking_thread_;
+  bool tracking_active_;
+  bool tracking_error_exceeded_;
+  std::mutex tracking_mutex_;
+  std::condition_variable tracking_condition_;
+
   rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr callback_handler_;
 };
 }  // namespace trajectory_execution_manager
@@ -38,6 +38,10 @@
 #include <moveit/robot_state/robot_state.h>
 #include <geometric_shapes/check_isometry.h>
 #include <tf2_eigen/tf2_eigen.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <future>
 
 namespace trajectory_execution_manager
 {
@@ -46,6 +50,8 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.trajectory_e
 const std::string TrajectoryExecutionManager::EXECUTION_EVENT_TOPIC = "trajectory_execution_event";
 
 static const auto DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE = rclcpp::Duration::from_seconds(1);
+static const std::size_t MAX_CONTROLLER_CACHE_SIZE = 64;  // cached controller selections and trajectory distributions
+static const std::size_t MAX_CONFIGURED_TRAJECTORY_CACHE_SIZE = 16;
 static const double DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN = 0.5;  // allow 0.5s more than the expected execution time
                                                                     // before triggering a trajectory cancel (applied
                                                                     // after scaling)
@@ -93,6 +99,13 @@ void TrajectoryExecutionManager::initialize()
   execution_velocity_scaling_ = 1.0;
   allowed_start_tolerance_ = 0.01;
   wait_for_trajectory_completion_ = true;
+  streaming_lookahead_ = 0.0;
+  overlap_independent_controllers_ = false;
+  prepared_part_ = -1;
+  allowed_tracking_error_ = 0.0;
+  tracking_monitor_rate_ = 100.0;
+  tracking_active_ = false;
+  tracking_error_exceeded_ = false;
 
   allowed_execution_duration_scaling_ = DEFAULT_CONTROLLER_GOAL_DURATION_SCALING;
   allowed_goal_duration_margin_ = DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN;
@@ -197,6 +210,11 @@ void TrajectoryExecutionManager::initialize()
   controller_mgr_node_->get_parameter("trajectory_execution.allowed_goal_duration_margin",
                                       allowed_goal_duration_margin_);
   controller_mgr_node_->get_parameter("trajectory_execution.allowed_start_tolerance", allowed_start_tolerance_);
+  controller_mgr_node_->get_parameter("trajectory_execution.streaming_lookahead", streaming_lookahead_);
+  controller_mgr_node_->get_parameter("trajectory_execution.overlap_independent_controllers",
+                                      overlap_independent_controllers_);
+  controller_mgr_node_->get_parameter("trajectory_execution.allowed_tracking_error", allowed_tracking_error_);
+  controller_mgr_node_->get_parameter("trajectory_execution.tracking_monitor_rate", tracking_monitor_rate_);
 
   if (manage_controllers_)
     RCLCPP_INFO(LOGGER, "Trajectory execution is managing controllers");
@@ -221,6 +239,14 @@ void TrajectoryExecutionManager::initialize()
         setAllowedStartTolerance(parameter.as_double());
       else if (name == "trajectory_execution.wait_for_trajectory_completion")
         setWaitForTrajectoryCompletion(parameter.as_bool());
+      else if (name == "trajectory_execution.streaming_lookahead")
+        setStreamingLookahead(parameter.as_double());
+      else if (name == "trajectory_execution.overlap_independent_controllers")
+        setOverlapIndependentControllers(parameter.as_bool());
+      else if (name == "trajectory_execution.allowed_tracking_error")
+        setAllowedTrackingError(parameter.as_double());
+      else if (name == "trajectory_execution.tracking_monitor_rate")
+        setTrackingMonitorRate(parameter.as_double());
       else
         result.successful = false;
     }
@@ -259,6 +285,29 @@ void TrajectoryExecutionManager::setWaitForTrajectoryCompletion(bool flag)
   wait_for_trajectory_completion_ = flag;
 }
 
+void TrajectoryExecutionManager::setStreamingLookahead(double lookahead)
+{
+  streaming_lookahead_ = std::max(lookahead, 0.0);
+}
+
+void TrajectoryExecutionManager::setOverlapIndependentControllers(bool flag)
+{
+  overlap_independent_controllers_ = flag;
+}
+
+void TrajectoryExecutionManager::setAllowedTrackingError(double tolerance)
+{
+  allowed_tracking_error_ = std::max(tolerance, 0.0);
+}
+
+void TrajectoryExecutionManager::setTrackingMonitorRate(double rate)
+{
+  if (rate > 0.0)
+    tracking_monitor_rate_ = rate;
+  else
+    RCLCPP_ERROR(LOGGER, "The tracking monitor rate needs to be positive, keeping %f Hz", tracking_monitor_rate_);
+}
+
 bool TrajectoryExecutionManager::isManagingControllers() const
 {
   return manage_controllers_;
@@ -344,6 +393,41 @@ bool TrajectoryExecutionManager::push(const moveit_msgs::msg::RobotTrajectory& t
   return false;
 }
 
+bool TrajectoryExecutionManager::pushWithStartOffset(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                     double start_offset, const std::vector<std::string>& controllers)
+{
+  if (trajectories_.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot start a trajectory relative to the previous one, because none was pushed");
+    return false;
+  }
+  if (start_offset < 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "The start offset of a trajectory cannot be negative (%f)", start_offset);
+    return false;
+  }
+
+  const TrajectoryExecutionContext& previous = *trajectories_.back();
+  if (!push(trajectory, controllers))
+    return false;
+
+  TrajectoryExecutionContext& context = *trajectories_.back();
+  for (const std::string& controller : context.controllers_)
+    if (overlapsControllers(controller, previous.controllers_))
+    {
+      RCLCPP_ERROR(LOGGER,
+                   "Controller '%s' is used by the previous trajectory, so the trajectory cannot start before the "
+                   "previous one completed",
+                   controller.c_str());
+      delete trajectories_.back();
+      trajectories_.pop_back();
+      last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+      return false;
+    }
+  context.start_offset_ = start_offset;
+  return true;
+}
+
 bool TrajectoryExecutionManager::pushAndExecute(const moveit_msgs::msg::RobotTrajectory& trajectory,
                                                 const std::string& controller)
 {
@@ -562,6 +646,7 @@ void TrajectoryExecutionManager::continuousExecutionThread()
 
 void TrajectoryExecutionManager::reloadControllerInformation()
 {
+  const std::map<std::string, ControllerInformation> previous_controllers = std::move(known_controllers_);
   known_controllers_.clear();
   if (controller_manager_)
   {
@@ -609,6 +694,34 @@ void TrajectoryExecutionManager::reloadControllerInformation()
   {
     RCLCPP_ERROR(LOGGER, "Failed to reload controllers: `controller_manager_` does not exist.");
   }
+
+  // keep the states that were read before, unless the controller was (de)activated since, and keep the cached
+  // selections and distributions unless the controllers changed
+  bool changed = known_controllers_.size() != previous_controllers.size();
+  for (std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
+  {
+    std::map<std::string, ControllerInformation>::const_iterator previous =
+        previous_controllers.find(known_controller.first);
+    if (previous == previous_controllers.end() || previous->second.joints_ != known_controller.second.joints_)
+    {
+      changed = true;
+      continue;
+    }
+    if (previous->second.state_.active_ == known_controller.second.state_.active_)
+    {
+      known_controller.second.state_ = previous->second.state_;
+      known_controller.second.last_update_ = previous->second.last_update_;
+    }
+    else
+      changed = true;
+  }
+  if (changed)
+  {
+    std::scoped_lock slock(controller_cache_mutex_);
+    controller_selection_cache_.clear();
+    trajectory_distribution_cache_.clear();
+    ++controller_cache_generation_;
+  }
 }
 
 void TrajectoryExecutionManager::updateControllerState(const std::string& controller, const rclcpp::Duration& age)
@@ -628,8 +741,17 @@ void TrajectoryExecutionManager::updateControllerState(ControllerInformation& ci
     {
       if (verbose_)
         RCLCPP_INFO(LOGGER, "Updating information for controller '%s'.", ci.name_.c_str());
+      const moveit_controller_manager::MoveItControllerManager::ControllerState previous_state = ci.state_;
       ci.state_ = controller_manager_->getControllerState(ci.name_);
       ci.last_update_ = node_->now();
+
+      // the selection of controllers depends on their states
+      if (ci.state_.active_ != previous_state.active_ || ci.state_.default_ != previous_state.default_)
+      {
+        std::scoped_lock slock(controller_cache_mutex_);
+        controller_selection_cache_.clear();
+        ++controller_cache_generation_;
+      }
     }
   }
   else if (verbose_)
@@ -838,6 +960,25 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
                                                    const std::vector<std::string>& available_controllers,
                                                    std::vector<std::string>& selected_controllers)
 {
+  // the selection only depends on the joints, the available controllers and their states, so it is cached until one
+  // of these states changes
+  for (const std::string& controller : available_controllers)
+  {
+    std::map<std::string, ControllerInformation>::iterator it = known_controllers_.find(controller);
+    if (it != known_controllers_.end())
+      updateControllerState(it->second, DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
+  }
+  ControllerSelectionKey key(actuated_joints, available_controllers);
+  {
+    std::scoped_lock slock(controller_cache_mutex_);
+    auto it = controller_selection_cache_.find(key);
+    if (it != controller_selection_cache_.end())
+    {
+      selected_controllers = it->second;
+      return true;
+    }
+  }
+
   for (std::size_t i = 1; i <= available_controllers.size(); ++i)
     if (findControllers(actuated_joints, i, available_controllers, selected_controllers))
     {
@@ -855,6 +996,11 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
             }
           }
       }
+
+      std::scoped_lock slock(controller_cache_mutex_);
+      if (controller_selection_cache_.size() >= MAX_CONTROLLER_CACHE_SIZE)
+        controller_selection_cache_.clear();
+      controller_selection_cache_[key] = selected_controllers;
       return true;
     }
   return false;
@@ -867,6 +1013,112 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
   parts.clear();
   parts.resize(controllers.size());
 
+  const std::shared_ptr<const std::vector<TrajectoryPartJoints>> distribution =
+      getTrajectoryDistribution(trajectory, controllers);
+  if (!distribution)
+    return false;
+
+  for (std::size_t i = 0; i < controllers.size(); ++i)
+  {
+    const TrajectoryPartJoints& part_joints = (*distribution)[i];
+    if (!part_joints.multi_dof_joint_names_.empty())
+    {
+      parts[i].multi_dof_joint_trajectory.joint_names = part_joints.multi_dof_joint_names_;
+      const std::vector<std::size_t>& bijection = part_joints.multi_dof_joint_indices_;
+      parts[i].multi_dof_joint_trajectory.header.frame_id = trajectory.multi_dof_joint_trajectory.header.frame_id;
+      parts[i].multi_dof_joint_trajectory.points.resize(trajectory.multi_dof_joint_trajectory.points.size());
+      for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.points.size(); ++j)
+      {
+        parts[i].multi_dof_joint_trajectory.points[j].time_from_start =
+            trajectory.multi_dof_joint_trajectory.points[j].time_from_start;
+        parts[i].multi_dof_joint_trajectory.points[j].transforms.resize(bijection.size());
+        for (std::size_t k = 0; k < bijection.size(); ++k)
+        {
+          parts[i].multi_dof_joint_trajectory.points[j].transforms[k] =
+              trajectory.multi_dof_joint_trajectory.points[j].transforms[bijection[k]];
+
+          if (!trajectory.multi_dof_joint_trajectory.points[j].velocities.empty())
+          {
+            parts[i].multi_dof_joint_trajectory.points[j].velocities.resize(bijection.size());
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.x =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.x * execution_velocity_scaling_;
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.y =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.y * execution_velocity_scaling_;
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.z =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.z * execution_velocity_scaling_;
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.x =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.x * execution_velocity_scaling_;
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.y =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.y * execution_velocity_scaling_;
+
+            parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.z =
+                trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.z * execution_velocity_scaling_;
+          }
+        }
+      }
+    }
+    if (!part_joints.joint_names_.empty())
+    {
+      parts[i].joint_trajectory.joint_names = part_joints.joint_names_;
+      parts[i].joint_trajectory.header = trajectory.joint_trajectory.header;
+      const std::vector<std::size_t>& bijection = part_joints.joint_indices_;
+      parts[i].joint_trajectory.points.resize(trajectory.joint_trajectory.points.size());
+      for (std::size_t j = 0; j < trajectory.joint_trajectory.points.size(); ++j)
+      {
+        parts[i].joint_trajectory.points[j].time_from_start = trajectory.joint_trajectory.points[j].time_from_start;
+        if (!trajectory.joint_trajectory.points[j].positions.empty())
+        {
+          parts[i].joint_trajectory.points[j].positions.resize(bijection.size());
+          for (std::size_t k = 0; k < bijection.size(); ++k)
+            parts[i].joint_trajectory.points[j].positions[k] =
+                trajectory.joint_trajectory.points[j].positions[bijection[k]];
+        }
+        if (!trajectory.joint_trajectory.points[j].velocities.empty())
+        {
+          parts[i].joint_trajectory.points[j].velocities.resize(bijection.size());
+          for (std::size_t k = 0; k < bijection.size(); ++k)
+            parts[i].joint_trajectory.points[j].velocities[k] =
+                trajectory.joint_trajectory.points[j].velocities[bijection[k]] * execution_velocity_scaling_;
+        }
+        if (!trajectory.joint_trajectory.points[j].accelerations.empty())
+        {
+          parts[i].joint_trajectory.points[j].accelerations.resize(bijection.size());
+          for (std::size_t k = 0; k < bijection.size(); ++k)
+            parts[i].joint_trajectory.points[j].accelerations[k] =
+                trajectory.joint_trajectory.points[j].accelerations[bijection[k]];
+        }
+        if (!trajectory.joint_trajectory.points[j].effort.empty())
+        {
+          parts[i].joint_trajectory.points[j].effort.resize(bijection.size());
+          for (std::size_t k = 0; k < bijection.size(); ++k)
+            parts[i].joint_trajectory.points[j].effort[k] =
+                trajectory.joint_trajectory.points[j].effort[bijection[k]];
+        }
+      }
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<const std::vector<TrajectoryExecutionManager::TrajectoryPartJoints>>
+TrajectoryExecutionManager::getTrajectoryDistribution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                      const std::vector<std::string>& controllers)
+{
+  // the joints of each part only depend on the joint names of the trajectory and the controllers
+  TrajectoryDistributionKey key(trajectory.joint_trajectory.joint_names,
+                                trajectory.multi_dof_joint_trajectory.joint_names, controllers);
+  {
+    std::scoped_lock slock(controller_cache_mutex_);
+    auto it = trajectory_distribution_cache_.find(key);
+    if (it != trajectory_distribution_cache_.end())
+      return it->second;
+  }
+
   std::set<std::string> actuated_joints_mdof;
   actuated_joints_mdof.insert(trajectory.multi_dof_joint_trajectory.joint_names.begin(),
                               trajectory.multi_dof_joint_trajectory.joint_names.end());
@@ -882,119 +1134,40 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
     }
   }
 
+  std::map<std::string, std::size_t> index_mdof;
+  for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.joint_names.size(); ++j)
+    index_mdof[trajectory.multi_dof_joint_trajectory.joint_names[j]] = j;
+  std::map<std::string, std::size_t> index_single;
+  for (std::size_t j = 0; j < trajectory.joint_trajectory.joint_names.size(); ++j)
+    index_single[trajectory.joint_trajectory.joint_names[j]] = j;
+
+  auto distribution = std::make_shared<std::vector<TrajectoryPartJoints>>(controllers.size());
   for (std::size_t i = 0; i < controllers.size(); ++i)
   {
     std::map<std::string, ControllerInformation>::iterator it = known_controllers_.find(controllers[i]);
     if (it == known_controllers_.end())
     {
       RCLCPP_ERROR_STREAM(LOGGER, "Controller " << controllers[i] << " not found.");
-      return false;
+      return nullptr;
     }
-    std::vector<std::string> intersect_mdof;
+    TrajectoryPartJoints& part_joints = (*distribution)[i];
     std::set_intersection(it->second.joints_.begin(), it->second.joints_.end(), actuated_joints_mdof.begin(),
-                          actuated_joints_mdof.end(), std::back_inserter(intersect_mdof));
-    std::vector<std::string> intersect_single;
+                          actuated_joints_mdof.end(), std::back_inserter(part_joints.multi_dof_joint_names_));
     std::set_intersection(it->second.joints_.begin(), it->second.joints_.end(), actuated_joints_single.begin(),
-                          actuated_joints_single.end(), std::back_inserter(intersect_single));
-    if (intersect_mdof.empty() && intersect_single.empty())
+                          actuated_joints_single.end(), std::back_inserter(part_joints.joint_names_));
+    if (part_joints.multi_dof_joint_names_.empty() && part_joints.joint_names_.empty())
       RCLCPP_WARN_STREAM(LOGGER, "No joints to be distributed for controller " << controllers[i]);
-    {
-      if (!intersect_mdof.empty())
-      {
-        std::vector<std::string>& jnames = parts[i].multi_dof_joint_trajectory.joint_names;
-        jnames.insert(jnames.end(), intersect_mdof.begin(), intersect_mdof.end());
-        std::map<std::string, std::size_t> index;
-        for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.joint_names.size(); ++j)
-          index[trajectory.multi_dof_joint_trajectory.joint_names[j]] = j;
-        std::vector<std::size_t> bijection(jnames.size());
-        for (std::size_t j = 0; j < jnames.size(); ++j)
-          bijection[j] = index[jnames[j]];
-
-        parts[i].multi_dof_joint_trajectory.header.frame_id = trajectory.multi_dof_joint_trajectory.header.frame_id;
-        parts[i].multi_dof_joint_trajectory.points.resize(trajectory.multi_dof_joint_trajectory.points.size());
-        for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.points.size(); ++j)
-        {
-          parts[i].multi_dof_joint_trajectory.points[j].time_from_start =
-              trajectory.multi_dof_joint_trajectory.points[j].time_from_start;
-          parts[i].multi_dof_joint_trajectory.points[j].transforms.resize(bijection.size());
-          for (std::size_t k = 0; k < bijection.size(); ++k)
-          {
-            parts[i].multi_dof_joint_trajectory.points[j].transforms[k] =
-                trajectory.multi_dof_joint_trajectory.points[j].transforms[bijection[k]];
-
-            if (!trajectory.multi_dof_joint_trajectory.points[j].velocities.empty())
-            {
-              parts[i].multi_dof_joint_trajectory.points[j].velocities.resize(bijection.size());
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.x =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.x * execution_velocity_scaling_;
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.y =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.y * execution_velocity_scaling_;
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].linear.z =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].linear.z * execution_velocity_scaling_;
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.x =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.x * execution_velocity_scaling_;
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.y =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.y * execution_velocity_scaling_;
-
-              parts[i].multi_dof_joint_trajectory.points[j].velocities[0].angular.z =
-                  trajectory.multi_dof_joint_trajectory.points[j].velocities[0].angular.z * execution_velocity_scaling_;
-            }
-          }
-        }
-      }
-      if (!intersect_single.empty())
-      {
-        std::vector<std::string>& jnames = parts[i].joint_trajectory.joint_names;
-        jnames.insert(jnames.end(), intersect_single.begin(), intersect_single.end());
-        parts[i].joint_trajectory.header = trajectory.joint_trajectory.header;
-        std::map<std::string, std::size_t> index;
-        for (std::size_t j = 0; j < trajectory.joint_trajectory.joint_names.size(); ++j)
-          index[trajectory.joint_trajectory.joint_names[j]] = j;
-        std::vector<std::size_t> bijection(jnames.size());
-        for (std::size_t j = 0; j < jnames.size(); ++j)
-          bijection[j] = index[jnames[j]];
-        parts[i].joint_trajectory.points.resize(trajectory.joint_trajectory.points.size());
-        for (std::size_t j = 0; j < trajectory.joint_trajectory.points.size(); ++j)
-        {
-          parts[i].joint_trajectory.points[j].time_from_start = trajectory.joint_trajectory.points[j].time_from_start;
-          if (!trajectory.joint_trajectory.points[j].positions.empty())
-          {
-            parts[i].joint_trajectory.points[j].positions.resize(bijection.size());
-            for (std::size_t k = 0; k < bijection.size(); ++k)
-              parts[i].joint_trajectory.points[j].positions[k] =
-                  trajectory.joint_trajectory.points[j].positions[bijection[k]];
-          }
-          if (!trajectory.joint_trajectory.points[j].velocities.empty())
-          {
-            parts[i].joint_trajectory.points[j].velocities.resize(bijection.size());
-            for (std::size_t k = 0; k < bijection.size(); ++k)
-              parts[i].joint_trajectory.points[j].velocities[k] =
-                  trajectory.joint_trajectory.points[j].velocities[bijection[k]] * execution_velocity_scaling_;
-          }
-          if (!trajectory.joint_trajectory.points[j].accelerations.empty())
-          {
-            parts[i].joint_trajectory.points[j].accelerations.resize(bijection.size());
-            for (std::size_t k = 0; k < bijection.size(); ++k)
-              parts[i].joint_trajectory.points[j].accelerations[k] =
-                  trajectory.joint_trajectory.points[j].accelerations[bijection[k]];
-          }
-          if (!trajectory.joint_trajectory.points[j].effort.empty())
-          {
-            parts[i].joint_trajectory.points[j].effort.resize(bijection.size());
-            for (std::size_t k = 0; k < bijection.size(); ++k)
-              parts[i].joint_trajectory.points[j].effort[k] =
-                  trajectory.joint_trajectory.points[j].effort[bijection[k]];
-          }
-        }
-      }
-    }
+    for (const std::string& joint_name : part_joints.multi_dof_joint_names_)
+      part_joints.multi_dof_joint_indices_.push_back(index_mdof[joint_name]);
+    for (const std::string& joint_name : part_joints.joint_names_)
+      part_joints.joint_indices_.push_back(index_single[joint_name]);
   }
-  return true;
+
+  std::scoped_lock slock(controller_cache_mutex_);
+  if (trajectory_distribution_cache_.size() >= MAX_CONTROLLER_CACHE_SIZE)
+    trajectory_distribution_cache_.clear();
+  trajectory_distribution_cache_[key] = distribution;
+  return distribution;
 }
 
 bool TrajectoryExecutionManager::validate(const TrajectoryExecutionContext& context) const
@@ -1105,6 +1278,21 @@ bool TrajectoryExecutionManager::configure(TrajectoryExecutionContext& context,
   }
 
   reloadControllerInformation();
+
+  // a stored trajectory that is pushed again is configured the same way, as long as the controllers did not change
+  const std::size_t trajectory_hash = hashTrajectory(trajectory);
+  {
+    std::scoped_lock slock(controller_cache_mutex_);
+    std::map<std::size_t, ConfiguredTrajectory>::const_iterator it = configured_trajectory_cache_.find(trajectory_hash);
+    if (it != configured_trajectory_cache_.end() && it->second.generation_ == controller_cache_generation_ &&
+        it->second.requested_controllers_ == controllers && it->second.trajectory_ == trajectory)
+    {
+      context.controllers_ = it->second.context_.controllers_;
+      context.trajectory_parts_ = it->second.context_.trajectory_parts_;
+      return true;
+    }
+  }
+
   std::set<std::string> actuated_joints;
 
   auto is_actuated = [this](const std::string& joint_name) -> bool {
@@ -1138,7 +1326,10 @@ bool TrajectoryExecutionManager::configure(TrajectoryExecutionContext& context,
       if (selectControllers(actuated_joints, all_controller_names, context.controllers_))
       {
         if (distributeTrajectory(trajectory, context.controllers_, context.trajectory_parts_))
+        {
+          cacheConfiguration(trajectory_hash, trajectory, controllers, context);
           return true;
+        }
       }
       else
       {
@@ -1174,7 +1365,10 @@ bool TrajectoryExecutionManager::configure(TrajectoryExecutionContext& context,
     if (selectControllers(actuated_joints, controllers, context.controllers_))
     {
       if (distributeTrajectory(trajectory, context.controllers_, context.trajectory_parts_))
+      {
+        cacheConfiguration(trajectory_hash, trajectory, controllers, context);
         return true;
+      }
     }
   }
   std::stringstream ss;
@@ -1199,6 +1393,42 @@ bool TrajectoryExecutionManager::configure(TrajectoryExecutionContext& context,
   return false;
 }
 
+std::size_t TrajectoryExecutionManager::hashTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  // only the joints, the duration and the end points are hashed, the cached trajectories are compared completely
+  std::size_t hash = 0;
+  for (const std::string& joint_name : trajectory.joint_trajectory.joint_names)
+    boost::hash_combine(hash, joint_name);
+  for (const std::string& joint_name : trajectory.multi_dof_joint_trajectory.joint_names)
+    boost::hash_combine(hash, joint_name);
+  const std::vector<trajectory_msgs::msg::JointTrajectoryPoint>& points = trajectory.joint_trajectory.points;
+  boost::hash_combine(hash, points.size());
+  boost::hash_combine(hash, trajectory.multi_dof_joint_trajectory.points.size());
+  if (!points.empty())
+  {
+    boost::hash_range(hash, points.front().positions.begin(), points.front().positions.end());
+    boost::hash_range(hash, points.back().positions.begin(), points.back().positions.end());
+    boost::hash_combine(hash, rclcpp::Duration(points.back().time_from_start).nanoseconds());
+  }
+  return hash;
+}
+
+void TrajectoryExecutionManager::cacheConfiguration(std::size_t hash,
+                                                    const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                    const std::vector<std::string>& controllers,
+                                                    const TrajectoryExecutionContext& context)
+{
+  std::scoped_lock slock(controller_cache_mutex_);
+  if (configured_trajectory_cache_.size() >= MAX_CONFIGURED_TRAJECTORY_CACHE_SIZE)
+    configured_trajectory_cache_.clear();
+  ConfiguredTrajectory& configured = configured_trajectory_cache_[hash];
+  configured.trajectory_ = trajectory;
+  configured.requested_controllers_ = controllers;
+  configured.context_.controllers_ = context.controllers_;
+  configured.context_.trajectory_parts_ = context.trajectory_parts_;
+  configured.generation_ = controller_cache_generation_;
+}
+
 moveit_controller_manager::ExecutionStatus TrajectoryExecutionManager::executeAndWait(bool auto_clear)
 {
   execute(ExecutionCompleteCallback(), auto_clear);
@@ -1217,6 +1447,15 @@ void TrajectoryExecutionManager::stopExecutionInternal()
     {
       RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution.", ex.what());
     }
+  for (DeferredHandle& deferred_handle : deferred_handles_)
+    try
+    {
+      deferred_handle.handle_->cancelExecution();
+    }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution.", ex.what());
+    }
 }
 
 void TrajectoryExecutionManager::stopExecution(bool auto_clear)
@@ -1275,6 +1514,7 @@ void TrajectoryExecutionManager::execute(const ExecutionCompleteCallback& callba
 void TrajectoryExecutionManager::execute(const ExecutionCompleteCallback& callback,
                                          const PathSegmentCompleteCallback& part_callback, bool auto_clear)
 {
+  const auto execute_call_time = std::chrono::steady_clock::now();
   stopExecution(false);
 
   // check whether first trajectory starts at current robot state
@@ -1288,6 +1528,11 @@ void TrajectoryExecutionManager::execute(const ExecutionCompleteCallback& callba
     return;
   }
 
+  {
+    std::scoped_lock slock(execution_latency_mutex_);
+    execute_call_time_ = execute_call_time;
+  }
+
   // start the execution thread
   execution_complete_ = false;
   execution_thread_ = std::make_unique<std::thread>(&TrajectoryExecutionManager::executeThread, this, callback,
@@ -1349,6 +1594,11 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
   RCLCPP_INFO(LOGGER, "Starting trajectory execution ...");
   // assume everything will be OK
   last_execution_status_ = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+  prepared_part_ = -1;
+  {
+    std::scoped_lock slock(execution_latency_mutex_);
+    execution_latency_.clear();
+  }
 
   // execute each trajectory, one after the other (executePart() is blocking) or until one fails.
   // on failure, the status is set by executePart(). Otherwise, it will remain as set above (success)
@@ -1365,6 +1615,14 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
     }
   }
 
+  // controllers that were not waited for because of overlapping execution need to finish as well
+  if (!execution_complete_)
+    waitForDeferredHandles(nullptr);
+  {
+    std::scoped_lock slock(execution_state_mutex_);
+    deferred_handles_.clear();
+  }
+
   // only report that execution finished successfully when the robot actually stopped moving
   if (last_execution_status_ == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
   {
@@ -1392,18 +1650,99 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
     callback(last_execution_status_);
 }
 
+namespace
+{
+double toSeconds(const builtin_interfaces::msg::Duration& duration)
+{
+  return rclcpp::Duration(duration).seconds();
+}
+
+// The points needed to execute a trajectory from time from until time until, both measured from its start. This
+// includes the point before from, so the controller does not interpolate from its current state
+template <typename Trajectory>
+Trajectory extractPoints(const Trajectory& trajectory, double from, double until, bool& complete)
+{
+  Trajectory chunk;
+  chunk.header = trajectory.header;
+  chunk.joint_names = trajectory.joint_names;
+  const std::size_t n = trajectory.points.size();
+  std::size_t i = 0;
+  while (i + 1 < n && toSeconds(trajectory.points[i + 1].time_from_start) <= from)
+    ++i;
+  for (; i < n; ++i)
+  {
+    chunk.points.push_back(trajectory.points[i]);
+    if (toSeconds(trajectory.points[i].time_from_start) >= until)
+      break;
+  }
+  complete = complete && i + 1 >= n;
+  return chunk;
+}
+
+moveit_msgs::msg::RobotTrajectory extractChunk(const moveit_msgs::msg::RobotTrajectory& trajectory, double from,
+                                               double until, bool& complete)
+{
+  moveit_msgs::msg::RobotTrajectory chunk;
+  chunk.joint_trajectory = extractPoints(trajectory.joint_trajectory, from, until, complete);
+  chunk.multi_dof_joint_trajectory = extractPoints(trajectory.multi_dof_joint_trajectory, from, until, complete);
+  return chunk;
+}
+
+// Replace the points of a trajectory from time offset on by the points of tail, which starts at time offset
+template <typename Trajectory>
+bool splicePoints(Trajectory& trajectory, const Trajectory& tail, double offset)
+{
+  if (tail.points.empty())
+    return true;
+  if (tail.joint_names != trajectory.joint_names)
+    return false;
+  auto replaced = std::find_if(trajectory.points.begin(), trajectory.points.end(), [offset](const auto& point) {
+    return toSeconds(point.time_from_start) >= offset;
+  });
+  trajectory.points.erase(replaced, trajectory.points.end());
+  for (const auto& point : tail.points)
+  {
+    trajectory.points.push_back(point);
+    trajectory.points.back().time_from_start =
+        rclcpp::Duration(point.time_from_start) + rclcpp::Duration::from_seconds(offset);
+  }
+  return true;
+}
+}  // namespace
+
 bool TrajectoryExecutionManager::executePart(std::size_t part_index)
 {
   TrajectoryExecutionContext& context = *trajectories_[part_index];
+  const auto preparation_start = std::chrono::steady_clock::now();
+
+  // controllers that still execute a previous part need to finish before they are used again
+  if (!waitForDeferredHandles(&context.controllers_))
+    return false;
 
-  // first make sure desired controllers are active
-  if (ensureActiveControllers(context.controllers_))
+  // first make sure desired controllers are active, unless that was checked while the previous part executed
+  if (prepared_part_ == static_cast<int>(part_index) || ensureActiveControllers(context.controllers_))
   {
     // stop if we are already asked to do so
     if (execution_complete_)
       return false;
 
+    // a part with a start offset is scheduled relative to the start of the previous part, unless that time passed
+    if (context.start_offset_ >= 0.0 && part_index > 0)
+    {
+      rclcpp::Time start_time = last_part_start_time_ + rclcpp::Duration::from_seconds(context.start_offset_);
+      if (start_time <= node_->now())
+        start_time = rclcpp::Time(0, 0, RCL_ROS_TIME);
+      for (moveit_msgs::msg::RobotTrajectory& part : context.trajectory_parts_)
+      {
+        part.joint_trajectory.header.stamp = start_time;
+        part.multi_dof_joint_trajectory.header.stamp = start_time;
+      }
+    }
+
     std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+    bool streaming = false;
+    rclcpp::Time stream_start_time(0, 0, RCL_ROS_TIME);
+    std::chrono::steady_clock::time_point dispatch_start, dispatch_end;
     {
       std::scoped_lock slock(execution_state_mutex_);
       if (!execution_complete_)
@@ -1435,38 +1774,93 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
           active_handles_[i] = h;
         }
         handles = active_handles_;  // keep a copy for later, to avoid thread safety issues
-        for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
+        dispatch_start = std::chrono::steady_clock::now();
+
+        // stream the trajectory only if all controllers can continue with later chunks
+        std::scoped_lock streaming_lock(streaming_mutex_);
+        if (streaming_lookahead_ > 0.0 &&
+            std::all_of(handles.begin(), handles.end(),
+                        [](const moveit_controller_manager::MoveItControllerHandlePtr& handle) {
+                          return handle->canUpdateTrajectory();
+                        }))
         {
-          bool ok = false;
-          try
-          {
-            ok = active_handles_[i]->sendTrajectory(context.trajectory_parts_[i]);
-          }
-          catch (std::exception& ex)
+          // the chunks need a common absolute start time: now, unless a part is stamped to start in the future
+          rclcpp::Time start_time = node_->now();
+          for (const moveit_msgs::msg::RobotTrajectory& part : context.trajectory_parts_)
+            start_time = std::max({ start_time, rclcpp::Time(part.joint_trajectory.header.stamp),
+                                    rclcpp::Time(part.multi_dof_joint_trajectory.header.stamp) });
+          streaming_ = std::make_unique<StreamingState>();
+          streaming_->controllers_ = context.controllers_;
+          streaming_->trajectory_parts_ = context.trajectory_parts_;
+          for (moveit_msgs::msg::RobotTrajectory& part : streaming_->trajectory_parts_)
           {
-            RCLCPP_ERROR(LOGGER, "Caught %s when sending trajectory to controller", ex.what());
+            part.joint_trajectory.header.stamp = start_time;
+            part.multi_dof_joint_trajectory.header.stamp = start_time;
           }
-          if (!ok)
+          streaming_->start_time_ = start_time;
+          stream_start_time = start_time;
+          streaming_->sent_until_ = streaming_lookahead_;
+          streaming_->spliced_ = false;
+        }
+        bool streamed_completely = true;
+        std::vector<moveit_msgs::msg::RobotTrajectory> chunks;
+        if (streaming_)
+          for (const moveit_msgs::msg::RobotTrajectory& part : streaming_->trajectory_parts_)
+            chunks.push_back(extractChunk(part, 0.0, streaming_lookahead_, streamed_completely));
+        const std::vector<moveit_msgs::msg::RobotTrajectory>& sent_parts =
+            streaming_ ? chunks : context.trajectory_parts_;
+
+        // send to all controllers at once, so their goal round-trips overlap instead of staggering their starts
+        std::vector<std::future<bool>> sending;
+        for (std::size_t i = 0; i < sent_parts.size(); ++i)
+          sending.push_back(std::async(i == 0 ? std::launch::deferred : std::launch::async,
+                                       [&handle = handles[i], &part = sent_parts[i]] {
+                                         try
+                                         {
+                                           return handle->sendTrajectory(part);
+                                         }
+                                         catch (std::exception& ex)
+                                         {
+                                           RCLCPP_ERROR(LOGGER, "Caught %s when sending trajectory to controller",
+                                                        ex.what());
+                                           return false;
+                                         }
+                                       }));
+        std::vector<bool> sent;
+        for (std::future<bool>& future : sending)
+          sent.push_back(future.get());
+
+        if (std::find(sent.begin(), sent.end(), false) != sent.end())
+        {
+          for (std::size_t i = 0; i < sent.size(); ++i)
           {
-            for (std::size_t j = 0; j < i; ++j)
-              try
-              {
-                active_handles_[j]->cancelExecution();
-              }
-              catch (std::exception& ex)
-              {
-                RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution", ex.what());
-              }
-            RCLCPP_ERROR(LOGGER, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
-                         context.trajectory_parts_.size(), active_handles_[i]->getName().c_str());
-            if (i > 0)
-              RCLCPP_ERROR(LOGGER, "Cancelling previously sent trajectory parts");
-            active_handles_.clear();
-            current_context_ = -1;
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-            return false;
+            if (!sent[i])
+            {
+              RCLCPP_ERROR(LOGGER, "Failed to send trajectory part %zu of %zu to controller %s", i + 1, sent.size(),
+                           handles[i]->getName().c_str());
+              continue;
+            }
+            try
+            {
+              handles[i]->cancelExecution();
+            }
+            catch (std::exception& ex)
+            {
+              RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution", ex.what());
+            }
           }
+          if (std::find(sent.begin(), sent.end(), true) != sent.end())
+            RCLCPP_ERROR(LOGGER, "Cancelling the trajectory parts that were sent");
+          streaming_.reset();
+          active_handles_.clear();
+          current_context_ = -1;
+          last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+          return false;
         }
+        if (streamed_completely)
+          streaming_.reset();
+        streaming = streaming_ != nullptr;
+        dispatch_end = std::chrono::steady_clock::now();
       }
     }
 
@@ -1549,30 +1943,86 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
       }
     }
 
+    if (allowed_tracking_error_ > 0.0)
+      startTrackingMonitor(context, stream_start_time, current_time);
+
+    // check the controllers of the next part while this one executes, so the next part can be sent right away
+    std::future<bool> next_part_active;
+    if (part_index + 1 < trajectories_.size())
+      next_part_active = std::async(std::launch::async, [this, part_index] {
+        return areControllersActive(trajectories_[part_index + 1]->controllers_);
+      });
+
     bool result = true;
+
+    // send the remaining chunks of a streamed trajectory, and allow for the duration of spliced tails
+    if (streaming)
+    {
+      rclcpp::Time end_time = current_time;
+      if (streamTrajectory(handles, end_time))
+      {
+        const rclcpp::Duration streamed_duration =
+            (end_time - current_time) * allowed_execution_duration_scaling_ +
+            rclcpp::Duration::from_seconds(allowed_goal_duration_margin_);
+        expected_trajectory_duration = std::max(expected_trajectory_duration, streamed_duration);
+      }
+      else if (!execution_complete_)
+      {
+        {
+          std::scoped_lock slock(execution_state_mutex_);
+          stopExecutionInternal();
+        }
+        last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+        handles.clear();  // the canceled controllers report their own status, which is not waited for
+        result = false;
+      }
+    }
+
+    // the parts that start relative to this one are scheduled from its start
+    last_part_start_time_ = stream_start_time.nanoseconds() != 0 ? stream_start_time : current_time;
+    for (const moveit_msgs::msg::RobotTrajectory& part : context.trajectory_parts_)
+      last_part_start_time_ = std::max({ last_part_start_time_, rclcpp::Time(part.joint_trajectory.header.stamp),
+                                         rclcpp::Time(part.multi_dof_joint_trajectory.header.stamp) });
+    const bool next_starts_early =
+        part_index + 1 < trajectories_.size() && trajectories_[part_index + 1]->start_offset_ >= 0.0;
+
+    // wait for all controllers at once, so the expected duration bounds the part rather than each controller in turn
+    std::vector<std::pair<moveit_controller_manager::MoveItControllerHandlePtr, std::future<bool>>> waiting;
     for (moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
     {
-      if (execution_duration_monitoring_)
+      // with overlapping execution, the next part does not wait for the controllers it does not use
+      if ((overlap_independent_controllers_ || next_starts_early) && part_index + 1 < trajectories_.size() &&
+          !overlapsControllers(handle->getName(), trajectories_[part_index + 1]->controllers_))
       {
-        if (!handle->waitForExecution(expected_trajectory_duration))
-          if (!execution_complete_ && node_->now() - current_time > expected_trajectory_duration)
+        std::scoped_lock slock(execution_state_mutex_);
+        deferred_handles_.push_back({ handle, current_time + expected_trajectory_duration });
+        continue;
+      }
+      // without duration monitoring, the wait has no timeout
+      const rclcpp::Duration timeout =
+          execution_duration_monitoring_ ? expected_trajectory_duration : rclcpp::Duration::from_nanoseconds(-1);
+      waiting.emplace_back(handle, std::async(waiting.empty() ? std::launch::deferred : std::launch::async,
+                                              [&handle, timeout] { return handle->waitForExecution(timeout); }));
+    }
+
+    for (auto& [handle, finished] : waiting)
+    {
+      if (!finished.get())
+        if (!execution_complete_ && node_->now() - current_time > expected_trajectory_duration)
+        {
+          RCLCPP_ERROR(LOGGER,
+                       "Controller is taking too long to execute trajectory (the expected upper "
+                       "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
+                       expected_trajectory_duration.seconds());
           {
-            RCLCPP_ERROR(LOGGER,
-                         "Controller is taking too long to execute trajectory (the expected upper "
-                         "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
-                         expected_trajectory_duration.seconds());
-            {
-              std::scoped_lock slock(execution_state_mutex_);
-              stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
-                                        // internal function only
-            }
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
-            result = false;
-            break;
+            std::scoped_lock slock(execution_state_mutex_);
+            stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
+                                      // internal function only
           }
-      }
-      else
-        handle->waitForExecution();
+          last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
+          result = false;
+          break;
+        }
 
       // if something made the trajectory stop, we stop this thread too
       if (execution_complete_)
@@ -1589,6 +2039,33 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
       }
     }
 
+    if (stopTrackingMonitor())
+    {
+      last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+      result = false;
+    }
+
+    prepared_part_ = next_part_active.valid() && next_part_active.get() ? static_cast<int>(part_index) + 1 : -1;
+
+    const auto completion = std::chrono::steady_clock::now();
+    {
+      std::scoped_lock slock(execution_latency_mutex_);
+      ExecutionLatency latency;
+      latency.preparation = std::chrono::duration<double>(dispatch_start - preparation_start).count();
+      latency.dispatch = std::chrono::duration<double>(dispatch_end - dispatch_start).count();
+      latency.execution = std::chrono::duration<double>(completion - dispatch_end).count();
+      if (part_index > 0)
+        latency.gap = std::chrono::duration<double>(dispatch_end - last_part_completion_).count();
+      latency.since_execute = std::chrono::duration<double>(dispatch_end - execute_call_time_).count();
+      last_part_completion_ = completion;
+      execution_latency_.push_back(latency);
+      RCLCPP_DEBUG(LOGGER,
+                   "Trajectory part %zu: preparation %.4fs, dispatch %.4fs, execution %.4fs, gap %.4fs, "
+                   "%.4fs after execute()",
+                   part_index, latency.preparation, latency.dispatch, latency.execution, latency.gap,
+                   latency.since_execute);
+    }
+
     // clear the active handles
     execution_state_mutex_.lock();
     active_handles_.clear();
@@ -1610,6 +2087,301 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
   }
 }
 
+bool TrajectoryExecutionManager::streamTrajectory(
+    const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles, rclcpp::Time& end_time)
+{
+  std::unique_lock<std::mutex> ulock(streaming_mutex_);
+  while (streaming_ && !execution_complete_)
+  {
+    const double now = (node_->now() - streaming_->start_time_).seconds();
+
+    // send the next chunk when less than half the lookahead is left, or right after a splice
+    if (streaming_->spliced_ || now + 0.5 * streaming_lookahead_ >= streaming_->sent_until_)
+    {
+      bool complete = true;
+      for (std::size_t i = 0; i < handles.size(); ++i)
+      {
+        bool ok = false;
+        try
+        {
+          ok = handles[i]->updateTrajectory(
+              extractChunk(streaming_->trajectory_parts_[i], now, now + streaming_lookahead_, complete));
+        }
+        catch (std::exception& ex)
+        {
+          RCLCPP_ERROR(LOGGER, "Caught %s when streaming trajectory to controller", ex.what());
+        }
+        if (!ok)
+        {
+          RCLCPP_ERROR(LOGGER, "Failed to stream trajectory part %zu of %zu to controller %s", i + 1, handles.size(),
+                       handles[i]->getName().c_str());
+          streaming_.reset();
+          return false;
+        }
+      }
+      streaming_->sent_until_ = now + streaming_lookahead_;
+      streaming_->spliced_ = false;
+
+      if (complete)
+      {
+        end_time = streaming_->start_time_;
+        for (const moveit_msgs::msg::RobotTrajectory& part : streaming_->trajectory_parts_)
+        {
+          double duration = 0.0;
+          if (!part.joint_trajectory.points.empty())
+            duration = toSeconds(part.joint_trajectory.points.back().time_from_start);
+          if (!part.multi_dof_joint_trajectory.points.empty())
+            duration = std::max(duration, toSeconds(part.multi_dof_joint_trajectory.points.back().time_from_start));
+          end_time = std::max(end_time, streaming_->start_time_ + rclcpp::Duration::from_seconds(duration));
+        }
+        streaming_.reset();
+        return true;
+      }
+    }
+    streaming_condition_.wait_for(ulock, std::chrono::duration<double>(0.25 * streaming_lookahead_));
+  }
+  streaming_.reset();
+  return false;
+}
+
+bool TrajectoryExecutionManager::spliceTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  std::scoped_lock slock(streaming_mutex_);
+  if (!streaming_)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot splice a trajectory, because no trajectory is streamed");
+    return false;
+  }
+
+  std::vector<moveit_msgs::msg::RobotTrajectory> tail_parts;
+  if (!distributeTrajectory(trajectory, streaming_->controllers_, tail_parts))
+    return false;
+
+  rclcpp::Time tail_start = rclcpp::Time(trajectory.joint_trajectory.header.stamp);
+  if (tail_start.nanoseconds() == 0)
+    tail_start = node_->now();
+  const double offset = (tail_start - streaming_->start_time_).seconds();
+  if (offset < (node_->now() - streaming_->start_time_).seconds())
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot splice a trajectory that starts in the past");
+    return false;
+  }
+
+  std::vector<moveit_msgs::msg::RobotTrajectory> spliced = streaming_->trajectory_parts_;
+  for (std::size_t i = 0; i < spliced.size(); ++i)
+    if (!splicePoints(spliced[i].joint_trajectory, tail_parts[i].joint_trajectory, offset) ||
+        !splicePoints(spliced[i].multi_dof_joint_trajectory, tail_parts[i].multi_dof_joint_trajectory, offset))
+    {
+      RCLCPP_ERROR(LOGGER, "The joints of the spliced trajectory do not match the ones of controller %s",
+                   streaming_->controllers_[i].c_str());
+      return false;
+    }
+  streaming_->trajectory_parts_ = spliced;
+  streaming_->spliced_ = true;
+  {
+    // the tracking error is measured against the spliced tail from now on
+    std::scoped_lock tracking_lock(tracking_mutex_);
+    if (tracked_parts_.size() == spliced.size())
+      for (std::size_t i = 0; i < spliced.size(); ++i)
+        tracked_parts_[i].trajectory_ = spliced[i].joint_trajectory;
+  }
+  streaming_condition_.notify_all();
+  return true;
+}
+
+void TrajectoryExecutionManager::startTrackingMonitor(const TrajectoryExecutionContext& context,
+                                                      const rclcpp::Time& start_time, const rclcpp::Time& current_time)
+{
+  if (!csm_->getStateHistory())
+  {
+    RCLCPP_WARN_ONCE(LOGGER, "Tracking error monitoring needs the state history of the current state monitor, "
+                             "which is disabled. Not monitoring the tracking error.");
+    return;
+  }
+
+  std::scoped_lock slock(tracking_mutex_);
+  tracked_parts_.clear();
+  for (const moveit_msgs::msg::RobotTrajectory& part : context.trajectory_parts_)
+  {
+    TrackedPart tracked;
+    tracked.trajectory_ = part.joint_trajectory;
+    if (start_time.nanoseconds() != 0)
+      tracked.start_time_ = start_time;
+    else
+      tracked.start_time_ = std::max(current_time, rclcpp::Time(part.joint_trajectory.header.stamp));
+    for (const std::string& joint_name : part.joint_trajectory.joint_names)
+    {
+      const moveit::core::JointModel* joint = robot_model_->getJointModel(joint_name);
+      tracked.joints_.push_back(joint && joint->getVariableCount() == 1 ? joint : nullptr);
+    }
+    tracked_parts_.push_back(std::move(tracked));
+  }
+  tracking_active_ = true;
+  tracking_error_exceeded_ = false;
+  tracking_thread_ = std::make_unique<std::thread>([this] { trackingMonitorThread(); });
+}
+
+bool TrajectoryExecutionManager::stopTrackingMonitor()
+{
+  if (!tracking_thread_)
+    return false;
+  {
+    std::scoped_lock slock(tracking_mutex_);
+    tracking_active_ = false;
+  }
+  tracking_condition_.notify_all();
+  tracking_thread_->join();
+  tracking_thread_.reset();
+
+  std::scoped_lock slock(tracking_mutex_);
+  tracked_parts_.clear();
+  return tracking_error_exceeded_;
+}
+
+void TrajectoryExecutionManager::trackingMonitorThread()
+{
+  const std::shared_ptr<const planning_scene_monitor::StateHistory> history = csm_->getStateHistory();
+  const auto period = std::chrono::duration<double>(1.0 / tracking_monitor_rate_);
+  std::vector<double> before, after, positions(robot_model_->getVariableCount());
+  double fraction, oldest, newest;
+  double last_checked = 0.0;
+
+  std::unique_lock<std::mutex> ulock(tracking_mutex_);
+  while (!tracking_condition_.wait_for(ulock, period, [this] { return !tracking_active_; }))
+  {
+    // compare the most recent recorded state, so the delay of the state updates does not count as tracking error
+    if (!history->getTimeRange(oldest, newest) || newest <= last_checked ||
+        !history->getEnclosingEntries(newest, before, after, fraction) || before.size() != positions.size())
+      continue;
+    last_checked = newest;
+    robot_model_->interpolate(before.data(), after.data(), fraction, positions.data());
+
+    const rclcpp::Time stamp = rclcpp::Time(static_cast<int64_t>(newest * 1e9), node_->now().get_clock_type());
+    for (const TrackedPart& part : tracked_parts_)
+    {
+      const moveit::core::JointModel* joint = nullptr;
+      const double error = computeTrackingError(part, stamp, positions, joint);
+      if (error <= allowed_tracking_error_)
+        continue;
+
+      RCLCPP_ERROR(LOGGER,
+                   "Joint '%s' deviates %f from the expected trajectory, more than the allowed tracking error of %f. "
+                   "Stopping trajectory.",
+                   joint->getName().c_str(), error, allowed_tracking_error_);
+      tracking_error_exceeded_ = true;
+      ulock.unlock();
+      {
+        std::scoped_lock slock(execution_state_mutex_);
+        stopExecutionInternal();
+      }
+      return;
+    }
+  }
+}
+
+double TrajectoryExecutionManager::computeTrackingError(const TrackedPart& part, const rclcpp::Time& t,
+                                                        const std::vector<double>& positions,
+                                                        const moveit::core::JointModel*& joint) const
+{
+  // only the time span of the trajectory is checked; settling at the goal is up to the controller
+  const std::vector<trajectory_msgs::msg::JointTrajectoryPoint>& points = part.trajectory_.points;
+  const double time_from_start = (t - part.start_time_).seconds();
+  if (points.empty() || time_from_start < 0.0 ||
+      time_from_start > rclcpp::Duration(points.back().time_from_start).seconds())
+    return 0.0;
+
+  std::size_t after = 1;
+  while (after < points.size() && rclcpp::Duration(points[after].time_from_start).seconds() < time_from_start)
+    ++after;
+  const std::size_t before = after - 1;
+  after = std::min(after, points.size() - 1);
+  const double before_time = rclcpp::Duration(points[before].time_from_start).seconds();
+  const double span = rclcpp::Duration(points[after].time_from_start).seconds() - before_time;
+  const double fraction = span > 0.0 ? std::clamp((time_from_start - before_time) / span, 0.0, 1.0) : 1.0;
+
+  double max_error = 0.0;
+  for (std::size_t i = 0; i < part.joints_.size(); ++i)
+  {
+    const moveit::core::JointModel* tracked_joint = part.joints_[i];
+    if (!tracked_joint || points[before].positions.size() <= i || points[after].positions.size() <= i)
+      continue;
+    double expected;
+    tracked_joint->interpolate(&points[before].positions[i], &points[after].positions[i], fraction, &expected);
+    const double error = tracked_joint->distance(&expected, &positions[tracked_joint->getFirstVariableIndex()]);
+    if (error > max_error)
+    {
+      max_error = error;
+      joint = tracked_joint;
+    }
+  }
+  return max_error;
+}
+
+bool TrajectoryExecutionManager::overlapsControllers(const std::string& controller,
+                                                     const std::vector<std::string>& controllers) const
+{
+  std::map<std::string, ControllerInformation>::const_iterator it = known_controllers_.find(controller);
+  for (const std::string& other : controllers)
+    if (other == controller || (it != known_controllers_.end() && it->second.overlapping_controllers_.count(other)))
+      return true;
+  return false;
+}
+
+bool TrajectoryExecutionManager::waitForDeferredHandles(const std::vector<std::string>* controllers)
+{
+  const auto is_waited_for = [this, controllers](const DeferredHandle& deferred_handle) {
+    return !controllers || overlapsControllers(deferred_handle.handle_->getName(), *controllers);
+  };
+  std::vector<DeferredHandle> waiting;
+  {
+    std::scoped_lock slock(execution_state_mutex_);
+    std::copy_if(deferred_handles_.begin(), deferred_handles_.end(), std::back_inserter(waiting), is_waited_for);
+  }
+
+  bool result = true;
+  for (const DeferredHandle& deferred_handle : waiting)
+  {
+    const moveit_controller_manager::MoveItControllerHandlePtr& handle = deferred_handle.handle_;
+    if (execution_duration_monitoring_)
+    {
+      const rclcpp::Duration left = deferred_handle.deadline_ - node_->now();
+      if (!handle->waitForExecution(std::max(left, rclcpp::Duration::from_seconds(0))) && !execution_complete_)
+      {
+        RCLCPP_ERROR(LOGGER, "Controller %s is taking too long to execute its trajectory. Stopping trajectory.",
+                     handle->getName().c_str());
+        {
+          std::scoped_lock slock(execution_state_mutex_);
+          stopExecutionInternal();
+        }
+        last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
+        result = false;
+        break;
+      }
+    }
+    else
+      handle->waitForExecution();
+
+    if (execution_complete_)
+    {
+      result = false;
+      break;
+    }
+    else if (handle->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+    {
+      RCLCPP_WARN_STREAM(LOGGER, "Controller handle " << handle->getName() << " reports status "
+                                                      << handle->getLastExecutionStatus().asString());
+      last_execution_status_ = handle->getLastExecutionStatus();
+      result = false;
+    }
+  }
+
+  std::scoped_lock slock(execution_state_mutex_);
+  if (result)
+    deferred_handles_.erase(std::remove_if(deferred_handles_.begin(), deferred_handles_.end(), is_waited_for),
+                            deferred_handles_.end());
+  return result;
+}
+
 bool TrajectoryExecutionManager::waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time)
 {
   // skip waiting for convergence?
@@ -1689,6 +2461,12 @@ TrajectoryExecutionManager::getTrajectories() const
   return trajectories_;
 }
 
+std::vector<TrajectoryExecutionManager::ExecutionLatency> TrajectoryExecutionManager::getLastExecutionLatency() const
+{
+  std::scoped_lock slock(execution_latency_mutex_);
+  return execution_latency_;
+}
+
 moveit_controller_manager::ExecutionStatus TrajectoryExecutionManager::getLastExecutionStatus() const
 {
   return last_execution_status_;
@@ -57,7 +57,10 @@
 
 #include <rclcpp_action/rclcpp_action.hpp>
 
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
 #include <utility>
 #include <tf2_ros/buffer.h>
 
@@ -121,6 +124,33 @@ public:
     double planning_time_;
   };
 
+  /// The result of a request sent with sendPlanRequest()
+  struct PlanResult
+  {
+    /// Reason why planning failed, if it did
+    moveit::core::MoveItErrorCode error_code;
+
+    /// The plan, if planning succeeded
+    Plan plan;
+  };
+
+  /// Receives the state reported in the feedback of a request sent with sendPlanRequest() or sendExecuteRequest()
+  using FeedbackCallback = std::function<void(const std::string& state)>;
+
+  /// Handle of a request that was sent without waiting for it to be done
+  template <typename ResultT>
+  struct AsyncRequest
+  {
+    /// Becomes ready once the request is done, also if it was rejected, failed or was canceled
+    std::shared_future<ResultT> result;
+
+    /// Request to cancel the request without waiting for it. A request that was not accepted yet is canceled upon
+    /// acceptance.
+    std::function<void()> cancel;
+  };
+  using AsyncPlanRequest = AsyncRequest<PlanResult>;
+  using AsyncExecuteRequest = AsyncRequest<moveit::core::MoveItErrorCode>;
+
   /**
       \brief Construct a MoveGroupInterface instance call using a specified set of options \e opt.
 
@@ -719,6 +749,20 @@ public:
       target. No execution is performed. The resulting plan is stored in \e plan*/
   moveit::core::MoveItErrorCode plan(Plan& plan);
 
+  /** \brief Send a request to compute a motion plan like plan() does, without waiting for it.
+      Requests are sent through the same action client, so several of them can be on their way at once, e.g. planning
+      the next motion while the current one executes. The state of the request is passed to \e feedback_callback, if
+      set. */
+  AsyncPlanRequest sendPlanRequest(const FeedbackCallback& feedback_callback = FeedbackCallback());
+
+  /** \brief Send a request to execute \e plan, without waiting for it. See sendPlanRequest(). */
+  AsyncExecuteRequest sendExecuteRequest(const Plan& plan,
+                                         const FeedbackCallback& feedback_callback = FeedbackCallback());
+
+  /** \brief Send a request to execute \e trajectory, without waiting for it. See sendPlanRequest(). */
+  AsyncExecuteRequest sendExecuteRequest(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                         const FeedbackCallback& feedback_callback = FeedbackCallback());
+
   /** \brief Given a \e plan, execute it without waiting for completion. */
   moveit::core::MoveItErrorCode asyncExecute(const Plan& plan);
 
@@ -916,6 +960,16 @@ public:
       getCurrentState() will not take so long and are less likely to fail. */
   bool startStateMonitor(double wait = 1.0);
 
+  /** \brief Accept current states that are at most \e seconds old, instead of waiting for the next state update.
+
+      The current state monitor is shared by all MoveGroupInterface instances of the process. With a positive age,
+      functions such as getCurrentPose() read its latest state without waiting or copying, which makes them cheap to
+      call in loops. The default of 0 waits for a state newer than the time of the call. */
+  void setMaxCurrentStateAge(double seconds);
+
+  /** \brief Get the maximum age of current states used without waiting, see setMaxCurrentStateAge() */
+  double getMaxCurrentStateAge() const;
+
   /** \brief Get the current joint values for the joints planned for by this instance (see getJoints()) */
   std::vector<double> getCurrentJointValues() const;
 
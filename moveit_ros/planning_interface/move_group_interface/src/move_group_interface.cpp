@@ -39,6 +39,7 @@
 #include <stdexcept>
 #include <sstream>
 #include <memory>
+#include <mutex>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 #include <moveit/warehouse/constraints_storage.h>
 #include <moveit/kinematic_constraints/utils.h>
@@ -134,6 +135,7 @@ public:
     replan_delay_ = 2.0;
     replan_attempts_ = 1;
     goal_joint_tolerance_ = 1e-4;
+    max_current_state_age_ = 0.0;
     goal_position_tolerance_ = 1e-4;     // 0.1 mm
     goal_orientation_tolerance_ = 1e-3;  // ~0.1 deg
     allowed_planning_time_ = 5.0;
@@ -600,6 +602,16 @@ public:
   }
 
   bool getCurrentState(moveit::core::RobotStatePtr& current_state, double wait_seconds = 1.0)
+  {
+    std::shared_ptr<const moveit::core::RobotState> latest_state;
+    if (!getLatestState(latest_state, wait_seconds))
+      return false;
+    current_state = std::make_shared<moveit::core::RobotState>(*latest_state);
+    return true;
+  }
+
+  /** \brief Get the shared snapshot of the current state, which is not copied and has up-to-date transforms */
+  bool getLatestState(std::shared_ptr<const moveit::core::RobotState>& latest_state, double wait_seconds = 1.0)
   {
     if (!current_state_monitor_)
     {
@@ -611,16 +623,30 @@ public:
     if (!current_state_monitor_->isActive())
       current_state_monitor_->startStateMonitor();
 
-    if (!current_state_monitor_->waitForCurrentState(node_->now(), wait_seconds))
+    // a recent enough state is used right away, otherwise wait for the next update
+    const rclcpp::Time now = node_->now();
+    const bool recent = max_current_state_age_ > 0.0 &&
+                        (now - current_state_monitor_->getLatestStateTime()).seconds() <= max_current_state_age_;
+    if (!recent && !current_state_monitor_->waitForCurrentState(now, wait_seconds))
     {
       RCLCPP_ERROR(LOGGER, "Failed to fetch current robot state");
       return false;
     }
 
-    current_state = current_state_monitor_->getCurrentState();
+    latest_state = current_state_monitor_->getLatestState();
     return true;
   }
 
+  void setMaxCurrentStateAge(double seconds)
+  {
+    max_current_state_age_ = seconds;
+  }
+
+  double getMaxCurrentStateAge() const
+  {
+    return max_current_state_age_;
+  }
+
   /** \brief Convert a vector of PoseStamped to a vector of PlaceLocation */
   //  std::vector<moveit_msgs::msg::PlaceLocation>
   //  posesToPlaceLocations(const std::vector<geometry_msgs::msg::PoseStamped>& poses) const
@@ -743,6 +769,16 @@ public:
   //    return pick(constructPickupGoal(object.id, std::move(response->grasps), plan_only));
   //  }
 
+  void constructPlanGoal(moveit_msgs::action::MoveGroup::Goal& goal) const
+  {
+    constructGoal(goal);
+    goal.planning_options.plan_only = true;
+    goal.planning_options.look_around = false;
+    goal.planning_options.replan = false;
+    goal.planning_options.planning_scene_diff.is_diff = true;
+    goal.planning_options.planning_scene_diff.robot_state.is_diff = true;
+  }
+
   moveit::core::MoveItErrorCode plan(Plan& plan)
   {
     if (!move_action_client_ || !move_action_client_->action_server_is_ready())
@@ -753,12 +789,7 @@ public:
     RCLCPP_INFO_STREAM(LOGGER, "MoveGroup action client/server ready");
 
     moveit_msgs::action::MoveGroup::Goal goal;
-    constructGoal(goal);
-    goal.planning_options.plan_only = true;
-    goal.planning_options.look_around = false;
-    goal.planning_options.replan = false;
-    goal.planning_options.planning_scene_diff.is_diff = true;
-    goal.planning_options.planning_scene_diff.robot_state.is_diff = true;
+    constructPlanGoal(goal);
 
     bool done = false;
     rclcpp_action::ResultCode code = rclcpp_action::ResultCode::UNKNOWN;
@@ -957,6 +988,58 @@ public:
     return res->error_code;
   }
 
+  AsyncPlanRequest sendPlanRequest(const FeedbackCallback& feedback_callback)
+  {
+    PlanResult failure;
+    failure.error_code = moveit::core::MoveItErrorCode::FAILURE;
+    failure.plan.planning_time_ = 0.0;
+    if (!move_action_client_ || !move_action_client_->action_server_is_ready())
+    {
+      RCLCPP_INFO_STREAM(LOGGER, "MoveGroup action client/server not ready");
+      return makeFailedRequest(failure);
+    }
+
+    moveit_msgs::action::MoveGroup::Goal goal;
+    constructPlanGoal(goal);
+    return sendAsyncGoal<moveit_msgs::action::MoveGroup, PlanResult>(
+        move_action_client_, goal, feedback_callback,
+        [failure](const rclcpp_action::ClientGoalHandle<moveit_msgs::action::MoveGroup>::WrappedResult& result) {
+          PlanResult plan_result = failure;
+          if (!result.result)
+            return plan_result;
+          plan_result.error_code = getAsyncErrorCode(result.code, result.result->error_code);
+          if (result.code == rclcpp_action::ResultCode::SUCCEEDED)
+          {
+            plan_result.plan.trajectory_ = result.result->planned_trajectory;
+            plan_result.plan.start_state_ = result.result->trajectory_start;
+            plan_result.plan.planning_time_ = result.result->planning_time;
+          }
+          return plan_result;
+        },
+        failure);
+  }
+
+  AsyncExecuteRequest sendExecuteRequest(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                         const FeedbackCallback& feedback_callback)
+  {
+    const moveit::core::MoveItErrorCode failure = moveit::core::MoveItErrorCode::FAILURE;
+    if (!execute_action_client_ || !execute_action_client_->action_server_is_ready())
+    {
+      RCLCPP_INFO_STREAM(LOGGER, "execute_action_client_ client/server not ready");
+      return makeFailedRequest(failure);
+    }
+
+    using ExecuteGoalHandle = rclcpp_action::ClientGoalHandle<moveit_msgs::action::ExecuteTrajectory>;
+    moveit_msgs::action::ExecuteTrajectory::Goal goal;
+    goal.trajectory = trajectory;
+    return sendAsyncGoal<moveit_msgs::action::ExecuteTrajectory, moveit::core::MoveItErrorCode>(
+        execute_action_client_, goal, feedback_callback,
+        [failure](const ExecuteGoalHandle::WrappedResult& result) {
+          return result.result ? getAsyncErrorCode(result.code, result.result->error_code) : failure;
+        },
+        failure);
+  }
+
   double computeCartesianPath(const std::vector<geometry_msgs::msg::Pose>& waypoints, double step,
                               double jump_threshold, moveit_msgs::msg::RobotTrajectory& msg,
                               const moveit_msgs::msg::Constraints& path_constraints, bool avoid_collisions,
@@ -1333,6 +1416,87 @@ private:
     initializing_constraints_ = false;
   }
 
+  template <typename ResultT>
+  static AsyncRequest<ResultT> makeFailedRequest(const ResultT& failure)
+  {
+    std::promise<ResultT> promise;
+    promise.set_value(failure);
+    AsyncRequest<ResultT> request;
+    request.result = promise.get_future().share();
+    request.cancel = [] {};
+    return request;
+  }
+
+  /** \brief The error code of a finished asynchronous request, which reports cancellation even if the server did not */
+  static moveit::core::MoveItErrorCode getAsyncErrorCode(rclcpp_action::ResultCode code,
+                                                         const moveit_msgs::msg::MoveItErrorCodes& error_code)
+  {
+    if (code == rclcpp_action::ResultCode::CANCELED && error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+      return moveit::core::MoveItErrorCode::PREEMPTED;
+    return error_code;
+  }
+
+  /** \brief Send \e goal through \e client and return a handle to its result, which is made by \e get_result */
+  template <typename ActionT, typename ResultT>
+  static AsyncRequest<ResultT> sendAsyncGoal(
+      const std::shared_ptr<rclcpp_action::Client<ActionT>>& client, const typename ActionT::Goal& goal,
+      const FeedbackCallback& feedback_callback,
+      const std::function<ResultT(const typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult&)>& get_result,
+      const ResultT& failure)
+  {
+    using GoalHandle = rclcpp_action::ClientGoalHandle<ActionT>;
+
+    // Shared by the handle and the callbacks of the goal. It also keeps the goal handle alive until the result is in,
+    // since the action client only keeps weak references to it.
+    struct GoalState
+    {
+      std::mutex mutex;
+      bool cancel_requested = false;
+      typename GoalHandle::SharedPtr goal_handle;
+    };
+    const auto state = std::make_shared<GoalState>();
+    const auto promise = std::make_shared<std::promise<ResultT>>();
+
+    AsyncRequest<ResultT> request;
+    request.result = promise->get_future().share();
+    request.cancel = [client, state] {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->cancel_requested = true;
+      if (state->goal_handle)
+        client->async_cancel_goal(state->goal_handle);
+    };
+
+    auto send_goal_opts = typename rclcpp_action::Client<ActionT>::SendGoalOptions();
+    send_goal_opts.goal_response_callback = [client, state, promise,
+                                             failure](const typename GoalHandle::SharedPtr& goal_handle) {
+      if (!goal_handle)
+      {
+        RCLCPP_INFO(LOGGER, "Asynchronous request rejected");
+        promise->set_value(failure);
+        return;
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->goal_handle = goal_handle;
+      if (state->cancel_requested)
+        client->async_cancel_goal(goal_handle);
+    };
+    if (feedback_callback)
+    {
+      using FeedbackConstPtr = std::shared_ptr<const typename ActionT::Feedback>;
+      send_goal_opts.feedback_callback = [feedback_callback](const typename GoalHandle::SharedPtr& /* unused */,
+                                                             const FeedbackConstPtr& feedback) {
+        feedback_callback(feedback->state);
+      };
+    }
+    send_goal_opts.result_callback = [state, promise, get_result](const typename GoalHandle::WrappedResult& result) {
+      promise->set_value(get_result(result));
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->goal_handle.reset();
+    };
+    client->async_send_goal(goal, send_goal_opts);
+    return request;
+  }
+
   Options opt_;
   rclcpp::Node::SharedPtr node_;
   rclcpp::CallbackGroup::SharedPtr callback_group_;
@@ -1357,6 +1521,7 @@ private:
   double max_velocity_scaling_factor_;
   double max_acceleration_scaling_factor_;
   double goal_joint_tolerance_;
+  double max_current_state_age_;
   double goal_position_tolerance_;
   double goal_orientation_tolerance_;
   bool can_look_;
@@ -1534,6 +1699,24 @@ moveit::core::MoveItErrorCode MoveGroupInterface::move()
   return impl_->move(true);
 }
 
+MoveGroupInterface::AsyncPlanRequest MoveGroupInterface::sendPlanRequest(const FeedbackCallback& feedback_callback)
+{
+  return impl_->sendPlanRequest(feedback_callback);
+}
+
+MoveGroupInterface::AsyncExecuteRequest
+MoveGroupInterface::sendExecuteRequest(const Plan& plan, const FeedbackCallback& feedback_callback)
+{
+  return impl_->sendExecuteRequest(plan.trajectory_, feedback_callback);
+}
+
+MoveGroupInterface::AsyncExecuteRequest
+MoveGroupInterface::sendExecuteRequest(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                       const FeedbackCallback& feedback_callback)
+{
+  return impl_->sendExecuteRequest(trajectory, feedback_callback);
+}
+
 moveit::core::MoveItErrorCode MoveGroupInterface::asyncExecute(const Plan& plan)
 {
   return impl_->execute(plan.trajectory_, false);
@@ -2101,11 +2284,21 @@ bool MoveGroupInterface::startStateMonitor(double wait)
   return impl_->startStateMonitor(wait);
 }
 
+void MoveGroupInterface::setMaxCurrentStateAge(double seconds)
+{
+  impl_->setMaxCurrentStateAge(seconds);
+}
+
+double MoveGroupInterface::getMaxCurrentStateAge() const
+{
+  return impl_->getMaxCurrentStateAge();
+}
+
 std::vector<double> MoveGroupInterface::getCurrentJointValues() const
 {
-  moveit::core::RobotStatePtr current_state;
+  std::shared_ptr<const moveit::core::RobotState> current_state;
   std::vector<double> values;
-  if (impl_->getCurrentState(current_state))
+  if (impl_->getLatestState(current_state))
     current_state->copyJointGroupPositions(getName(), values);
   return values;
 }
@@ -2151,8 +2344,8 @@ geometry_msgs::msg::PoseStamped MoveGroupInterface::getCurrentPose(const std::st
     RCLCPP_ERROR(LOGGER, "No end-effector specified");
   else
   {
-    moveit::core::RobotStatePtr current_state;
-    if (impl_->getCurrentState(current_state))
+    std::shared_ptr<const moveit::core::RobotState> current_state;
+    if (impl_->getLatestState(current_state))
     {
       const moveit::core::LinkModel* lm = current_state->getLinkModel(eef);
       if (lm)
@@ -2174,8 +2367,8 @@ std::vector<double> MoveGroupInterface::getCurrentRPY(const std::string& end_eff
     RCLCPP_ERROR(LOGGER, "No end-effector specified");
   else
   {
-    moveit::core::RobotStatePtr current_state;
-    if (impl_->getCurrentState(current_state))
+    std::shared_ptr<const moveit::core::RobotState> current_state;
+    if (impl_->getLatestState(current_state))
     {
       const moveit::core::LinkModel* lm = current_state->getLinkModel(eef);
       if (lm)
@@ -42,6 +42,7 @@
 #include <moveit_msgs/msg/collision_object.hpp>
 #include <moveit_msgs/msg/attached_collision_object.hpp>
 #include <moveit_msgs/msg/planning_scene.hpp>
+#include <future>
 
 namespace moveit
 {
@@ -127,6 +128,24 @@ public:
       Other PlanningSceneMonitors will NOT receive the update unless they subscribe to move_group's monitored scene */
   bool applyPlanningScene(const moveit_msgs::msg::PlanningScene& ps);
 
+  /** \brief Apply collision objects to the planning scene of the move_group node asynchronously.
+
+      Updates issued within the batch window (see setAsyncBatchWindow()) are merged into a single diff, which is sent
+      via the ApplyPlanningScene service. The returned future completes once move_group applied that diff, with its
+      success. Updates are applied in the order they were issued, later ADD operations replace earlier updates of the
+      same object within a batch. */
+  std::shared_future<bool> applyCollisionObjectsAsync(
+      const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects,
+      const std::vector<moveit_msgs::msg::ObjectColor>& object_colors = std::vector<moveit_msgs::msg::ObjectColor>());
+
+  /** \brief Apply attached collision objects to the planning scene of the move_group node asynchronously, batched
+      with the other asynchronous updates (see applyCollisionObjectsAsync()). */
+  std::shared_future<bool> applyAttachedCollisionObjectsAsync(
+      const std::vector<moveit_msgs::msg::AttachedCollisionObject>& attached_collision_objects);
+
+  /** \brief Set how long (in seconds) asynchronous updates are collected before they are sent. Default is 0.01 s. */
+  void setAsyncBatchWindow(double seconds);
+
   /** \brief Add collision objects to the world via /planning_scene.
       Make sure object.operation is set to object.ADD.
 
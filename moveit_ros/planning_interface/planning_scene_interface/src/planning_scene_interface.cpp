@@ -39,6 +39,12 @@
 #include <moveit_msgs/srv/get_planning_scene.hpp>
 #include <moveit_msgs/srv/apply_planning_scene.hpp>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <rclcpp/executors.hpp>
 #include <rclcpp/future_return_code.hpp>
 
@@ -52,6 +58,7 @@ class PlanningSceneInterface::PlanningSceneInterfaceImpl
 {
 public:
   explicit PlanningSceneInterfaceImpl(const std::string& ns = "", bool wait = true)
+    : ns_(ns), batch_window_(std::chrono::milliseconds(10)), stop_batching_(false)
   {
     rclcpp::NodeOptions options;
     options.arguments({ "--ros-args", "-r",
@@ -71,6 +78,17 @@ public:
     }
   }
 
+  ~PlanningSceneInterfaceImpl()
+  {
+    {
+      std::lock_guard<std::mutex> guard(batch_lock_);
+      stop_batching_ = true;
+    }
+    batch_condition_.notify_all();
+    if (batch_thread_.joinable())
+      batch_thread_.join();
+  }
+
   std::vector<std::string> getKnownObjectNames(bool with_type)
   {
     auto request = std::make_shared<moveit_msgs::srv::GetPlanningScene::Request>();
@@ -270,7 +288,127 @@ public:
     planning_scene_diff_publisher_->publish(planning_scene);
   }
 
+  std::shared_future<bool> applyPlanningSceneAsync(const moveit_msgs::msg::PlanningScene& diff)
+  {
+    std::lock_guard<std::mutex> guard(batch_lock_);
+    if (!batch_thread_.joinable())
+      startBatching();
+
+    // attached objects are applied before the world objects of a diff, so they cannot follow world objects in a batch
+    if (batches_.empty() || (!batches_.back()->scene.world.collision_objects.empty() &&
+                             !diff.robot_state.attached_collision_objects.empty()))
+    {
+      batches_.push_back(std::make_unique<Batch>());
+      batches_.back()->scene.is_diff = true;
+      batches_.back()->scene.robot_state.is_diff = true;
+      batches_.back()->future = batches_.back()->promise.get_future().share();
+      batches_.back()->opened = std::chrono::steady_clock::now();
+    }
+
+    moveit_msgs::msg::PlanningScene& scene = batches_.back()->scene;
+    for (const moveit_msgs::msg::CollisionObject& object : diff.world.collision_objects)
+    {
+      // adding an object replaces it, so earlier updates of the same object in this batch are obsolete
+      if (object.operation == moveit_msgs::msg::CollisionObject::ADD)
+      {
+        auto& objects = scene.world.collision_objects;
+        auto same_id = [&object](const moveit_msgs::msg::CollisionObject& o) { return o.id == object.id; };
+        objects.erase(std::remove_if(objects.begin(), objects.end(), same_id), objects.end());
+      }
+      scene.world.collision_objects.push_back(object);
+    }
+    scene.object_colors.insert(scene.object_colors.end(), diff.object_colors.begin(), diff.object_colors.end());
+    scene.robot_state.attached_collision_objects.insert(scene.robot_state.attached_collision_objects.end(),
+                                                         diff.robot_state.attached_collision_objects.begin(),
+                                                         diff.robot_state.attached_collision_objects.end());
+    batch_condition_.notify_all();
+    return batches_.back()->future;
+  }
+
+  void setAsyncBatchWindow(double seconds)
+  {
+    std::lock_guard<std::mutex> guard(batch_lock_);
+    batch_window_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(std::max(seconds, 0.0)));
+  }
+
 private:
+  /** \brief Updates merged into one diff, sent by a single ApplyPlanningScene call */
+  struct Batch
+  {
+    moveit_msgs::msg::PlanningScene scene;
+    std::promise<bool> promise;
+    std::shared_future<bool> future;
+    std::chrono::steady_clock::time_point opened;
+  };
+
+  // called with batch_lock_ held
+  void startBatching()
+  {
+    // the batches are sent from their own node, as node_ is spun by the synchronous calls of the user's thread
+    rclcpp::NodeOptions options;
+    options.arguments({ "--ros-args", "-r",
+                        "__node:=" + std::string("planning_scene_interface_batch_") +
+                            std::to_string(reinterpret_cast<std::size_t>(this)) });
+    batch_node_ = rclcpp::Node::make_shared("_", ns_, options);
+    batch_apply_planning_scene_service_ =
+        batch_node_->create_client<moveit_msgs::srv::ApplyPlanningScene>(move_group::APPLY_PLANNING_SCENE_SERVICE_NAME);
+    batch_thread_ = std::thread([this] { batchThread(); });
+  }
+
+  void batchThread()
+  {
+    std::unique_lock<std::mutex> lock(batch_lock_);
+    while (true)
+    {
+      batch_condition_.wait(lock, [this] { return stop_batching_ || !batches_.empty(); });
+      if (stop_batching_)
+        break;
+
+      // collect updates until the window closes, unless an update could not be merged into this batch
+      batch_condition_.wait_until(lock, batches_.front()->opened + batch_window_,
+                                  [this] { return stop_batching_ || batches_.size() > 1; });
+      if (stop_batching_)
+        break;
+
+      std::unique_ptr<Batch> batch = std::move(batches_.front());
+      batches_.pop_front();
+      lock.unlock();
+      batch->promise.set_value(sendBatch(batch->scene));
+      lock.lock();
+    }
+
+    for (std::unique_ptr<Batch>& batch : batches_)
+      batch->promise.set_value(false);
+    batches_.clear();
+  }
+
+  bool sendBatch(const moveit_msgs::msg::PlanningScene& scene)
+  {
+    auto request = std::make_shared<moveit_msgs::srv::ApplyPlanningScene::Request>();
+    request->scene = scene;
+    if (!batch_apply_planning_scene_service_->wait_for_service(std::chrono::seconds(1)))
+    {
+      RCLCPP_WARN(LOGGER, "ApplyPlanningScene service is not available, dropping a batch of scene updates");
+      return false;
+    }
+
+    auto res = batch_apply_planning_scene_service_->async_send_request(request);
+    // wake up regularly, so destruction does not wait for a move_group that went away
+    rclcpp::FutureReturnCode code;
+    do
+    {
+      code = rclcpp::spin_until_future_complete(batch_node_, res, std::chrono::milliseconds(100));
+    } while (code == rclcpp::FutureReturnCode::TIMEOUT && !stop_batching_);
+    if (code != rclcpp::FutureReturnCode::SUCCESS)
+    {
+      RCLCPP_WARN(LOGGER, "Failed to call ApplyPlanningScene service for %zu batched collision objects",
+                  scene.world.collision_objects.size());
+      return false;
+    }
+    return res.get()->success;
+  }
+
   void waitForService(const std::shared_ptr<rclcpp::ClientBase>& srv)
   {
     // rclcpp::Duration time_before_warning(5.0);
@@ -289,6 +427,16 @@ private:
   rclcpp::Client<moveit_msgs::srv::ApplyPlanningScene>::SharedPtr apply_planning_scene_service_;
   rclcpp::Publisher<moveit_msgs::msg::PlanningScene>::SharedPtr planning_scene_diff_publisher_;
   moveit::core::RobotModelConstPtr robot_model_;
+
+  std::string ns_;
+  rclcpp::Node::SharedPtr batch_node_;
+  rclcpp::Client<moveit_msgs::srv::ApplyPlanningScene>::SharedPtr batch_apply_planning_scene_service_;
+  std::thread batch_thread_;
+  std::mutex batch_lock_;
+  std::condition_variable batch_condition_;
+  std::deque<std::unique_ptr<Batch>> batches_;
+  std::chrono::steady_clock::duration batch_window_;
+  std::atomic<bool> stop_batching_;
 };
 
 PlanningSceneInterface::PlanningSceneInterface(const std::string& ns, bool wait)
@@ -404,6 +552,39 @@ bool PlanningSceneInterface::applyPlanningScene(const moveit_msgs::msg::Planning
   return impl_->applyPlanningScene(ps);
 }
 
+std::shared_future<bool> PlanningSceneInterface::applyCollisionObjectsAsync(
+    const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects,
+    const std::vector<moveit_msgs::msg::ObjectColor>& object_colors)
+{
+  moveit_msgs::msg::PlanningScene ps;
+  ps.world.collision_objects = collision_objects;
+  ps.object_colors = object_colors;
+
+  // fill in the ids here, as the colors are merged with those of other updates
+  for (size_t i = 0; i < ps.object_colors.size(); ++i)
+  {
+    if (ps.object_colors[i].id.empty() && i < collision_objects.size())
+      ps.object_colors[i].id = collision_objects[i].id;
+    else
+      break;
+  }
+
+  return impl_->applyPlanningSceneAsync(ps);
+}
+
+std::shared_future<bool> PlanningSceneInterface::applyAttachedCollisionObjectsAsync(
+    const std::vector<moveit_msgs::msg::AttachedCollisionObject>& collision_objects)
+{
+  moveit_msgs::msg::PlanningScene ps;
+  ps.robot_state.attached_collision_objects = collision_objects;
+  return impl_->applyPlanningSceneAsync(ps);
+}
+
+void PlanningSceneInterface::setAsyncBatchWindow(double seconds)
+{
+  impl_->setAsyncBatchWindow(seconds);
+}
+
 void PlanningSceneInterface::addCollisionObjects(const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects,
                                                  const std::vector<moveit_msgs::msg::ObjectColor>& object_colors) const
 {
@@ -235,10 +235,11 @@ private:
                           const visualization_msgs::msg::InteractiveMarkerFeedback::ConstSharedPtr& feedback,
                           StateChangeCallbackFn& callback);
 
-  // Update RobotState for a new pose of an eef.
+  // Update RobotState with the IK solution for a new pose of an eef, which was computed in \e solution without holding
+  // state_lock_. Only the variables of the eef parent group are copied, \e ok tells whether IK succeeded.
   // YOU MUST LOCK state_lock_ BEFORE CALLING THIS.
   void updateStateEndEffector(moveit::core::RobotState& state, const EndEffectorInteraction& eef,
-                              const geometry_msgs::msg::Pose& pose, StateChangeCallbackFn& callback);
+                              const moveit::core::RobotState& solution, bool ok, StateChangeCallbackFn& callback);
 
   // Update RobotState for a new joint position.
   // YOU MUST LOCK state_lock_ BEFORE CALLING THIS.
@@ -244,12 +244,23 @@ void InteractionHandler::handleEndEffector(
   else
     return;
 
+  // Solve IK on a copy of the state, seeded with the previous solution, so that readers of the state are not blocked
+  // by slow IK solvers. Feedback arriving meanwhile is coalesced by RobotInteraction, so the next solve always uses the
+  // latest marker pose.
+  moveit::core::RobotState solution(*getState());
+  KinematicOptions kinematic_options;
+  {
+    std::scoped_lock slock(state_lock_);
+    kinematic_options = kinematic_options_map_->getOptions(eef.parent_group);
+  }
+  const bool ok = kinematic_options.setStateFromIK(solution, eef.parent_group, eef.parent_link, tpose.pose);
+
   StateChangeCallbackFn callback;
 
   // modify the RobotState in-place with state_lock_ held.
   // This locks state_lock_ before calling updateState()
-  LockedRobotState::modifyState([this, &eef, &pose = tpose.pose, &callback](moveit::core::RobotState* state) {
-    updateStateEndEffector(*state, eef, pose, callback);
+  LockedRobotState::modifyState([this, &eef, &solution, ok, &callback](moveit::core::RobotState* state) {
+    updateStateEndEffector(*state, eef, solution, ok, callback);
   });
 
   // This calls update_callback_ to notify client that state changed.
@@ -304,13 +315,17 @@ void InteractionHandler::updateStateGeneric(
 
 // MUST hold state_lock_ when calling this!
 void InteractionHandler::updateStateEndEffector(moveit::core::RobotState& state, const EndEffectorInteraction& eef,
-                                                const geometry_msgs::msg::Pose& pose, StateChangeCallbackFn& callback)
+                                                const moveit::core::RobotState& solution, bool ok,
+                                                StateChangeCallbackFn& callback)
 {
-  // This is called with state_lock_ held, so no additional locking needed to
-  // access kinematic_options_map_.
-  KinematicOptions kinematic_options = kinematic_options_map_->getOptions(eef.parent_group);
+  // only take over the group, the rest of the state may have changed while IK was running
+  if (const moveit::core::JointModelGroup* jmg = state.getJointModelGroup(eef.parent_group))
+  {
+    std::vector<double> positions;
+    solution.copyJointGroupPositions(jmg, positions);
+    state.setJointGroupPositions(jmg, positions);
+  }
 
-  bool ok = kinematic_options.setStateFromIK(state, eef.parent_group, eef.parent_link, pose);
   bool error_state_changed = setErrorState(eef.parent_group, !ok);
   if (update_callback_)
     callback = [cb = this->update_callback_, error_state_changed](robot_interaction::InteractionHandler* handler) {
@@ -218,6 +218,7 @@ protected:
   rviz_common::properties::FloatProperty* scene_display_time_property_;
   rviz_common::properties::EnumProperty* octree_render_property_;
   rviz_common::properties::EnumProperty* octree_coloring_property_;
+  rviz_common::properties::FloatProperty* octree_detail_angle_property_;
 
   // rclcpp node
   rclcpp::Node::SharedPtr node_;
@@ -50,8 +50,11 @@
 #include <rviz_common/properties/color_property.hpp>
 #include <rviz_common/properties/enum_property.hpp>
 #include <rviz_common/display_context.hpp>
+#include <rviz_common/view_controller.hpp>
+#include <rviz_common/view_manager.hpp>
 #include <tf2_ros/buffer.h>
 
+#include <OgreCamera.h>
 #include <OgreSceneManager.h>
 #include <OgreSceneNode.h>
 
@@ -120,6 +123,13 @@ PlanningSceneDisplay::PlanningSceneDisplay(bool listen_to_planning_scene, bool s
   octree_coloring_property_->addOption("Z-Axis", OCTOMAP_Z_AXIS_COLOR);
   octree_coloring_property_->addOption("Cell Probability", OCTOMAP_PROBABLILTY_COLOR);
 
+  octree_detail_angle_property_ = new rviz_common::properties::FloatProperty(
+      "Voxel Detail Angle", 0.1f,
+      "Voxels are rendered at the finest depth at which they still span this angle (degrees) from the camera. "
+      "0 renders all depths.",
+      scene_category_);
+  octree_detail_angle_property_->setMin(0.0);
+
   scene_display_time_property_ =
       new rviz_common::properties::FloatProperty("Scene Display Time", 0.01f,
                                                  "The amount of wall-time to wait in between rendering "
@@ -672,6 +682,11 @@ void PlanningSceneDisplay::updateInternal(float wall_dt, float /*ros_dt*/)
     robot_state_needs_render_ = false;
     planning_scene_needs_render_ = false;
   }
+
+  rviz_common::ViewController* view = context_->getViewManager()->getCurrent();
+  if (planning_scene_render_ && view && view->getCamera())
+    planning_scene_render_->updateLevelOfDetail(view->getCamera()->getDerivedPosition(),
+                                                octree_detail_angle_property_->getFloat() * M_PI / 180.0);
 }
 
 void PlanningSceneDisplay::load(const rviz_common::Config& config)
@@ -41,6 +41,8 @@
 #include <OgrePrerequisites.h>
 #include <rviz_common/properties/color_property.hpp>
 #include <rviz_default_plugins/displays/pointcloud/point_cloud_helpers.hpp>
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 namespace octomap
@@ -63,6 +65,10 @@ enum OctreeVoxelColorMode
   OCTOMAP_PROBABLILTY_COLOR,
 };
 
+/** \brief Renders the surface voxels of an octree as point clouds of boxes, one per depth.
+
+    The voxels are decoded per chunk of the octree key space. update() only decodes the chunks whose voxels changed,
+    and their neighbors, again, so rendering a sequence of maps that differ locally stays cheap. */
 class OcTreeRender
 {
 public:
@@ -73,12 +79,26 @@ public:
   void setPosition(const Ogre::Vector3& position);
   void setOrientation(const Ogre::Quaternion& orientation);
 
+  /** \brief Render \e octree instead, which can also be the same octree modified in place */
+  void update(const std::shared_ptr<const octomap::OcTree>& octree);
+
+  /** \brief Render the octree only down to the depth at which voxels subtend at least \e min_voxel_angle (rad) as
+      seen from \e camera_position in world coordinates, but not deeper than the maximum depth passed on construction.
+      An angle of 0 renders all depths. */
+  void updateLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle);
+
 private:
+  // decoded surface voxels of a chunk, by depth
+  struct Chunk
+  {
+    std::uint64_t hash;
+    std::vector<std::vector<rviz_rendering::PointCloud::Point>> points;
+  };
+
   void setColor(double z_pos, double min_z, double max_z, double color_factor, rviz_rendering::PointCloud::Point* point);
   void setProbColor(double prob, rviz_rendering::PointCloud::Point* point);
 
-  void octreeDecoding(const std::shared_ptr<const octomap::OcTree>& octree,
-                      OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode);
+  void octreeDecoding();
 
   // Ogre-rviz point clouds
   std::vector<rviz_rendering::PointCloud*> cloud_;
@@ -86,7 +106,15 @@ private:
 
   Ogre::SceneNode* scene_node_;
 
+  OctreeVoxelRenderMode octree_voxel_rendering_;
+  OctreeVoxelColorMode octree_color_mode_;
+
   double colorFactor_;
+  std::size_t max_octree_depth_;
   std::size_t octree_depth_;
+
+  std::unordered_map<std::uint64_t, Chunk> chunks_;
+  double chunk_min_z_;
+  double chunk_max_z_;
 };
 }  // namespace moveit_rviz_plugin
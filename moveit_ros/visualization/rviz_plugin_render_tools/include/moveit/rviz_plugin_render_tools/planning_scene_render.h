@@ -41,6 +41,7 @@
 #include <moveit/rviz_plugin_render_tools/render_shapes.h>
 #include <rviz_common/properties/color_property.hpp>
 #include <OgreMaterial.h>
+#include <map>
 
 namespace moveit_rviz_plugin
 {
@@ -48,6 +49,11 @@ MOVEIT_CLASS_FORWARD(RobotStateVisualization);  // Defines RobotStateVisualizati
 MOVEIT_CLASS_FORWARD(RenderShapes);             // Defines RenderShapesPtr, ConstPtr, WeakPtr... etc
 MOVEIT_CLASS_FORWARD(PlanningSceneRender);      // Defines PlanningSceneRenderPtr, ConstPtr, WeakPtr... etc
 
+/** \brief Renders the robot and the world objects of a planning scene.
+
+    World objects are rendered incrementally: each object has its own scene node, and on an update only objects that
+    were added, removed, recolored or whose shapes changed are rebuilt, while objects that only moved have their node
+    moved. Octomaps are updated in place, decoding only the regions of the octree that changed. */
 class PlanningSceneRender
 {
 public:
@@ -73,10 +79,28 @@ public:
                            OctreeVoxelColorMode voxel_color_mode, float default_scene_alpha);
   void clear();
 
+  /** \brief Render octrees only down to the depth at which voxels subtend at least \e min_voxel_angle (rad) as seen
+      from \e camera_position (world coordinates); 0 renders all depths */
+  void updateLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle);
+
 private:
+  struct RenderedObject
+  {
+    collision_detection::World::ObjectConstPtr object;
+    Ogre::ColourValue color;
+    float alpha;
+    Ogre::SceneNode* node;
+    RenderShapesPtr shapes;
+  };
+
+  void removeObject(RenderedObject& rendered);
+
   Ogre::SceneNode* planning_scene_geometry_node_;
   rviz_common::DisplayContext* context_;
-  RenderShapesPtr render_shapes_;
   RobotStateVisualizationPtr scene_robot_;
+
+  std::map<std::string, RenderedObject> rendered_objects_;
+  OctreeVoxelRenderMode octree_voxel_rendering_;
+  OctreeVoxelColorMode octree_color_mode_;
 };
 }  // namespace moveit_rviz_plugin
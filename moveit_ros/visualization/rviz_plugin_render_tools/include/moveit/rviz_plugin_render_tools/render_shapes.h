@@ -43,7 +43,9 @@
 #include <rviz_common/display_context.hpp>
 #include <rviz_rendering/objects/shape.hpp>
 #include <OgreColourValue.h>
+#include <OgrePrerequisites.h>
 #include <Eigen/Geometry>
+#include <cstdint>
 #include <memory>
 
 namespace moveit_rviz_plugin
@@ -51,6 +53,10 @@ namespace moveit_rviz_plugin
 MOVEIT_CLASS_FORWARD(OcTreeRender);  // Defines OcTreeRenderPtr, ConstPtr, WeakPtr... etc
 MOVEIT_CLASS_FORWARD(RenderShapes);  // Defines RenderShapesPtr, ConstPtr, WeakPtr... etc
 
+/** \brief Renders shapes as rviz shapes.
+
+    Meshes are converted to Ogre meshes once and shared by all shapes rendering the same vertices and triangles, in
+    this and all other instances, so repeated meshes only cost a scene entity each. */
 class RenderShapes
 {
 public:
@@ -63,10 +69,28 @@ public:
   void updateShapeColors(float r, float g, float b, float a);
   void clear();
 
+  /** \brief Number of octrees rendered */
+  std::size_t getOcTreeCount() const
+  {
+    return octree_voxel_grids_.size();
+  }
+
+  /** \brief Render \e octree at pose \e p in place of the \e index-th rendered octree, decoding only the regions
+      that changed */
+  void updateOcTree(std::size_t index, const std::shared_ptr<const octomap::OcTree>& octree,
+                    const Eigen::Isometry3d& p);
+
+  /** \brief Limit the depth of all rendered octrees, see OcTreeRender::updateLevelOfDetail() */
+  void updateOcTreeLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle);
+
 private:
+  Ogre::MeshPtr acquireMesh(const shapes::Mesh& mesh);
+
   rviz_common::DisplayContext* context_;
 
   std::vector<std::unique_ptr<rviz_rendering::Shape> > scene_shapes_;
   std::vector<OcTreeRenderPtr> octree_voxel_grids_;
+  // keys of the shared meshes used by scene_shapes_
+  std::vector<std::uint64_t> mesh_keys_;
 };
 }  // namespace moveit_rviz_plugin
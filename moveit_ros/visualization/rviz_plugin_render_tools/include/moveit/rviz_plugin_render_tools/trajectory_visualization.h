@@ -145,7 +145,10 @@ protected:
 
   robot_trajectory::RobotTrajectoryPtr displaying_trajectory_message_;
   robot_trajectory::RobotTrajectoryPtr trajectory_message_to_display_;
+  // trail robots are reused for the next trajectory, since loading the robot is the expensive part
   std::vector<RobotStateVisualizationUniquePtr> trajectory_trail_;
+  // the waypoint shown by each trail robot
+  std::vector<std::size_t> trail_waypoints_;
   rclcpp::Subscription<moveit_msgs::msg::DisplayTrajectory>::SharedPtr trajectory_topic_sub_;
   bool animating_path_;
   bool drop_displaying_trajectory_;
@@ -178,6 +181,7 @@ protected:
   rviz_common::properties::ColorProperty* robot_color_property_;
   rviz_common::properties::BoolProperty* enable_robot_color_property_;
   rviz_common::properties::IntProperty* trail_step_size_property_;
+  rviz_common::properties::IntProperty* trail_max_states_property_;
 };
 
 }  // namespace moveit_rviz_plugin
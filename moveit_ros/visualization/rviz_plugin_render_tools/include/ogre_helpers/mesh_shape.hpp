@@ -30,6 +30,7 @@
 #pragma once
 
 #include <rviz_rendering/objects/shape.hpp>
+#include <OgrePrerequisites.h>
 
 namespace Ogre
 {
@@ -120,6 +121,10 @@ public:
    * no longer be called unless clear() was called. */
   void endTriangles();
 
+  /** \brief Render \e mesh instead of triangles added to this shape. The mesh can be shared by many shapes, each with
+      its own material, and is not removed by clear(). */
+  void setMesh(const Ogre::MeshPtr& mesh);
+
   /** \brief Clear the mesh */
   void clear();
 
@@ -132,6 +137,8 @@ public:
 private:
   // true in between calls to beginTriangles() and endTriangles()
   bool started_;
+  // false if the entity renders a mesh set with setMesh()
+  bool owns_mesh_;
   Ogre::ManualObject* manual_object_;
 };
 
@@ -43,7 +43,7 @@
 namespace rviz_rendering
 {
 MeshShape::MeshShape(Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node)
-  : Shape(Shape::Mesh, scene_manager, parent_node), started_(false)
+  : Shape(Shape::Mesh, scene_manager, parent_node), started_(false), owns_mesh_(true)
 {
   static uint32_t count = 0;
   manual_object_ = scene_manager->createManualObject("MeshShape_ManualObject" + std::to_string(count++));
@@ -123,6 +123,7 @@ void MeshShape::endTriangles()
     std::string name = "ConvertedMeshShape@" + std::to_string(count++);
     manual_object_->convertToMesh(name);
     entity_ = scene_manager_->createEntity(name);
+    owns_mesh_ = true;
     if (entity_)
     {
       entity_->setMaterialName(material_name_, "rviz_rendering");
@@ -135,13 +136,23 @@ void MeshShape::endTriangles()
     RVIZ_COMMON_LOG_ERROR("No triangles added");
 }
 
+void MeshShape::setMesh(const Ogre::MeshPtr& mesh)
+{
+  clear();
+  entity_ = scene_manager_->createEntity(mesh);
+  entity_->setMaterialName(material_name_, "rviz_rendering");
+  offset_node_->attachObject(entity_);
+  owns_mesh_ = false;
+}
+
 void MeshShape::clear()
 {
   if (entity_)
   {
     entity_->detachFromParent();
     const auto& mesh_name = entity_->getMesh()->getName();
-    if (Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().getByName(mesh_name))
+    Ogre::MeshPtr mesh = Ogre::MeshManager::getSingleton().getByName(mesh_name);
+    if (owns_mesh_ && mesh)
     {
       Ogre::MeshManager::getSingleton().remove(mesh);
     }
@@ -42,15 +42,58 @@
 #include <OgreSceneNode.h>
 #include <OgreSceneManager.h>
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
 namespace moveit_rviz_plugin
 {
 typedef std::vector<rviz_rendering::PointCloud::Point> VPoint;
 typedef std::vector<VPoint> VVPoint;
 
+namespace
+{
+// chunks hold voxels of 2^CHUNK_DEPTH_SPAN render depth voxels per side
+constexpr unsigned int CHUNK_DEPTH_SPAN = 6;
+constexpr unsigned int CHUNK_BITS = 21;
+constexpr std::uint64_t CHUNK_MASK = (1ULL << CHUNK_BITS) - 1;
+// voxels larger than a chunk can be occluded by voxels of non-adjacent chunks, they are decoded on every change
+constexpr std::uint64_t LARGE_VOXELS = ~0ULL;
+
+struct Leaf
+{
+  octomap::OcTreeKey key;
+  unsigned int depth;
+  double x, y, z;
+  float occupancy;
+};
+
+std::uint64_t chunkId(std::uint64_t x, std::uint64_t y, std::uint64_t z)
+{
+  return (x << (2 * CHUNK_BITS)) | (y << CHUNK_BITS) | z;
+}
+
+void hashValue(std::uint64_t& hash, const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+}
+}  // namespace
+
 OcTreeRender::OcTreeRender(const std::shared_ptr<const octomap::OcTree>& octree,
                            OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
                            std::size_t max_octree_depth, Ogre::SceneNode* parent_node)
-  : octree_(octree), colorFactor_(0.8)
+  : octree_(octree)
+  , octree_voxel_rendering_(octree_voxel_rendering)
+  , octree_color_mode_(octree_color_mode)
+  , colorFactor_(0.8)
+  , max_octree_depth_(max_octree_depth)
+  , chunk_min_z_(0.0)
+  , chunk_max_z_(0.0)
 {
   if (!max_octree_depth)
   {
@@ -63,9 +106,10 @@ OcTreeRender::OcTreeRender(const std::shared_ptr<const octomap::OcTree>& octree,
 
   scene_node_ = parent_node->createChildSceneNode();
 
-  cloud_.resize(octree_depth_);
+  // one cloud per depth of the tree, as the level of detail can change the rendered depth
+  cloud_.resize(octree->getTreeDepth());
 
-  for (std::size_t i = 0; i < octree_depth_; ++i)
+  for (std::size_t i = 0; i < cloud_.size(); ++i)
   {
     std::stringstream sname;
     sname << "PointCloud Nr." << i;
@@ -75,16 +119,16 @@ OcTreeRender::OcTreeRender(const std::shared_ptr<const octomap::OcTree>& octree,
     scene_node_->attachObject(cloud_[i]);
   }
 
-  octreeDecoding(octree, octree_voxel_rendering, octree_color_mode);
+  octreeDecoding();
 }
 
 OcTreeRender::~OcTreeRender()
 {
   scene_node_->detachAllObjects();
 
-  for (std::size_t i = 0; i < octree_depth_; ++i)
+  for (rviz_rendering::PointCloud* cloud : cloud_)
   {
-    delete cloud_[i];
+    delete cloud;
   }
 }
 
@@ -98,6 +142,47 @@ void moveit_rviz_plugin::OcTreeRender::setOrientation(const Ogre::Quaternion& or
   scene_node_->setOrientation(orientation);
 }
 
+void OcTreeRender::update(const std::shared_ptr<const octomap::OcTree>& octree)
+{
+  // chunks are only comparable between trees of the same layout
+  if (octree->getTreeDepth() != octree_->getTreeDepth() || octree->getResolution() != octree_->getResolution())
+    chunks_.clear();
+  octree_ = octree;
+  octreeDecoding();
+}
+
+void OcTreeRender::updateLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle)
+{
+  std::size_t depth = octree_->getTreeDepth();
+  if (max_octree_depth_)
+    depth = std::min(max_octree_depth_, depth);
+
+  if (min_voxel_angle > 0.0)
+  {
+    // distance from the camera to the bounding box of the octree
+    const Ogre::Vector3 camera = scene_node_->convertWorldToLocalPosition(camera_position);
+    double min[3], max[3];
+    octree_->getMetricMin(min[0], min[1], min[2]);
+    octree_->getMetricMax(max[0], max[1], max[2]);
+    double distance2 = 0.0;
+    for (int i = 0; i < 3; ++i)
+    {
+      const double d = std::max({ min[i] - camera[i], camera[i] - max[i], 0.0 });
+      distance2 += d * d;
+    }
+    const double min_voxel_size = std::sqrt(distance2) * min_voxel_angle;
+    while (depth > 1 && octree_->getNodeSize(depth) < min_voxel_size)
+      --depth;
+  }
+
+  if (depth != octree_depth_)
+  {
+    octree_depth_ = depth;
+    chunks_.clear();
+    octreeDecoding();
+  }
+}
+
 // method taken from octomap_server package
 void OcTreeRender::setColor(double z_pos, double min_z, double max_z, double color_factor,
                             rviz_rendering::PointCloud::Point* point)
@@ -146,117 +231,186 @@ void OcTreeRender::setColor(double z_pos, double min_z, double max_z, double col
   }
 }
 
-void OcTreeRender::octreeDecoding(const std::shared_ptr<const octomap::OcTree>& octree,
-                                  OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode)
+void OcTreeRender::octreeDecoding()
 {
-  VVPoint point_buf;
-  point_buf.resize(octree_depth_);
+  const std::shared_ptr<const octomap::OcTree>& octree = octree_;
+  const unsigned int tree_depth = octree->getTreeDepth();
 
   // get dimensions of octree
   double min_x, min_y, min_z, max_x, max_y, max_z;
   octree->getMetricMin(min_x, min_y, min_z);
   octree->getMetricMax(max_x, max_y, max_z);
 
-  unsigned int render_mode_mask = static_cast<unsigned int>(octree_voxel_rendering);
+  // colors along the z axis depend on the extent of the whole tree
+  if (octree_color_mode_ == OCTOMAP_Z_AXIS_COLOR && (min_z != chunk_min_z_ || max_z != chunk_max_z_))
+    chunks_.clear();
+  chunk_min_z_ = min_z;
+  chunk_max_z_ = max_z;
+
+  unsigned int render_mode_mask = static_cast<unsigned int>(octree_voxel_rendering_);
+  const unsigned int chunk_shift = std::min<unsigned int>(tree_depth, tree_depth - octree_depth_ + CHUNK_DEPTH_SPAN);
+
+  // group the rendered leafs by chunk and hash their contents
+  std::unordered_map<std::uint64_t, std::vector<Leaf>> leafs;
+  for (octomap::OcTree::iterator it = octree->begin(octree_depth_), end = octree->end(); it != end; ++it)
+  {
+    // the left part evaluates to 1 for free voxels and 2 for occupied voxels
+    if (!((static_cast<int>(octree->isNodeOccupied(*it)) + 1) & render_mode_mask))
+      continue;
+    const octomap::OcTreeKey key = it.getIndexKey();
+    const std::uint64_t id = tree_depth - it.getDepth() > chunk_shift ?
+                                 LARGE_VOXELS :
+                                 chunkId(key[0] >> chunk_shift, key[1] >> chunk_shift, key[2] >> chunk_shift);
+    leafs[id].push_back(Leaf{ key, it.getDepth(), it.getX(), it.getY(), it.getZ(), it->getOccupancy() });
+  }
 
-  size_t point_count = 0;
+  std::unordered_map<std::uint64_t, std::uint64_t> hashes;
+  for (const auto& [id, chunk_leafs] : leafs)
   {
-    int step_size = 1 << (octree->getTreeDepth() - octree_depth_);  // for pruning of occluded voxels
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const Leaf& leaf : chunk_leafs)
+    {
+      hashValue(hash, &leaf.key, sizeof(leaf.key));
+      hashValue(hash, &leaf.depth, sizeof(leaf.depth));
+      if (octree_color_mode_ == OCTOMAP_PROBABLILTY_COLOR)
+        hashValue(hash, &leaf.occupancy, sizeof(leaf.occupancy));
+    }
+    hashes[id] = hash;
+  }
 
-    // traverse all leafs in the tree:
-    for (octomap::OcTree::iterator it = octree->begin(octree_depth_), end = octree->end(); it != end; ++it)
+  // chunks that changed are decoded again together with their neighbors, which they can occlude
+  const bool decoded = !chunks_.empty();
+  std::vector<std::uint64_t> changed;
+  for (auto it = chunks_.begin(); it != chunks_.end();)
+  {
+    if (hashes.count(it->first))
+      ++it;
+    else
     {
-      bool display_voxel = false;
+      changed.push_back(it->first);
+      it = chunks_.erase(it);
+    }
+  }
+  for (const auto& [id, hash] : hashes)
+  {
+    auto chunk = chunks_.find(id);
+    if (chunk == chunks_.end() || chunk->second.hash != hash)
+      changed.push_back(id);
+  }
+  if (changed.empty() && decoded)
+    return;
 
-      // the left part evaluates to 1 for free voxels and 2 for occupied voxels
-      if ((static_cast<int>(octree->isNodeOccupied(*it)) + 1) & render_mode_mask)
+  std::unordered_set<std::uint64_t> dirty = { LARGE_VOXELS };
+  const std::uint64_t chunk_count = 1ULL << (tree_depth - chunk_shift);
+  for (std::uint64_t id : changed)
+  {
+    if (id == LARGE_VOXELS)
+      continue;
+    dirty.insert(id);
+    const std::uint64_t c[3] = { id >> (2 * CHUNK_BITS), (id >> CHUNK_BITS) & CHUNK_MASK, id & CHUNK_MASK };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      for (int d : { -1, 1 })
       {
-        // check if current voxel has neighbors on all sides -> no need to be displayed
-        bool all_neighbors_found = true;
+        std::uint64_t n[3] = { c[0], c[1], c[2] };
+        if ((d < 0 && n[axis] == 0) || (d > 0 && n[axis] + 1 >= chunk_count))
+          continue;
+        n[axis] += d;
+        dirty.insert(chunkId(n[0], n[1], n[2]));
+      }
+    }
+  }
 
-        octomap::OcTreeKey key;
-        octomap::OcTreeKey n_key = it.getIndexKey();  // key of the maximum-depth voxel at the current voxel corner
+  int step_size = 1 << (tree_depth - octree_depth_);  // for pruning of occluded voxels
+  for (std::uint64_t id : dirty)
+  {
+    auto chunk_leafs = leafs.find(id);
+    if (chunk_leafs == leafs.end())
+      continue;
+
+    Chunk& chunk = chunks_[id];
+    chunk.hash = hashes[id];
+    chunk.points.assign(octree_depth_, VPoint());
+    for (const Leaf& leaf : chunk_leafs->second)
+    {
+      // check if current voxel has neighbors on all sides -> no need to be displayed
+      bool all_neighbors_found = true;
 
-        // determine indices of potentially neighboring voxels for depths < maximum tree depth
-        // +/-1 at maximum depth, -1 and +depth_difference on other depths
-        int diff_base = 1 << (octree->getTreeDepth() - it.getDepth());
-        int diff[2] = { -1, diff_base };
+      octomap::OcTreeKey key;
+      const octomap::OcTreeKey& n_key = leaf.key;  // key of the maximum-depth voxel at the current voxel corner
 
-        // cells with adjacent faces can occlude a voxel, iterate over the cases x,y,z (idxCase) and +/- (diff)
-        for (unsigned int idx_case = 0; idx_case < 3; ++idx_case)
-        {
-          int idx_0 = idx_case % 3;
-          int idx_1 = (idx_case + 1) % 3;
-          int idx_2 = (idx_case + 2) % 3;
+      // determine indices of potentially neighboring voxels for depths < maximum tree depth
+      // +/-1 at maximum depth, -1 and +depth_difference on other depths
+      int diff_base = 1 << (tree_depth - leaf.depth);
+      int diff[2] = { -1, diff_base };
+
+      // cells with adjacent faces can occlude a voxel, iterate over the cases x,y,z (idxCase) and +/- (diff)
+      for (unsigned int idx_case = 0; idx_case < 3; ++idx_case)
+      {
+        int idx_0 = idx_case % 3;
+        int idx_1 = (idx_case + 1) % 3;
+        int idx_2 = (idx_case + 2) % 3;
 
-          for (int i = 0; all_neighbors_found && i < 2; ++i)
+        for (int i = 0; all_neighbors_found && i < 2; ++i)
+        {
+          key[idx_0] = n_key[idx_0] + diff[i];
+          // if rendering is restricted to treeDepth < maximum tree depth inner nodes with distance step_size can
+          // already occlude a voxel
+          for (key[idx_1] = n_key[idx_1] + diff[0] + 1; all_neighbors_found && key[idx_1] < n_key[idx_1] + diff[1];
+               key[idx_1] += step_size)
           {
-            key[idx_0] = n_key[idx_0] + diff[i];
-            // if rendering is restricted to treeDepth < maximum tree depth inner nodes with distance step_size can
-            // already occlude a voxel
-            for (key[idx_1] = n_key[idx_1] + diff[0] + 1; all_neighbors_found && key[idx_1] < n_key[idx_1] + diff[1];
-                 key[idx_1] += step_size)
+            for (key[idx_2] = n_key[idx_2] + diff[0] + 1; all_neighbors_found && key[idx_2] < n_key[idx_2] + diff[1];
+                 key[idx_2] += step_size)
             {
-              for (key[idx_2] = n_key[idx_2] + diff[0] + 1; all_neighbors_found && key[idx_2] < n_key[idx_2] + diff[1];
-                   key[idx_2] += step_size)
+              octomap::OcTreeNode* node = octree->search(key, octree_depth_);
+
+              // the left part evaluates to 1 for free voxels and 2 for occupied voxels
+              if (!(node && (((static_cast<int>(octree->isNodeOccupied(node))) + 1) & render_mode_mask)))
               {
-                octomap::OcTreeNode* node = octree->search(key, octree_depth_);
-
-                // the left part evaluates to 1 for free voxels and 2 for occupied voxels
-                if (!(node && (((static_cast<int>(octree->isNodeOccupied(node))) + 1) & render_mode_mask)))
-                {
-                  // we do not have a neighbor => break!
-                  all_neighbors_found = false;
-                }
+                // we do not have a neighbor => break!
+                all_neighbors_found = false;
               }
             }
           }
         }
-
-        display_voxel |= !all_neighbors_found;
       }
 
-      if (display_voxel)
-      {
-        rviz_rendering::PointCloud::Point new_point;
-
-        new_point.position.x = it.getX();
-        new_point.position.y = it.getY();
-        new_point.position.z = it.getZ();
+      if (all_neighbors_found)
+        continue;
 
-        float cell_probability;
+      rviz_rendering::PointCloud::Point new_point;
 
-        switch (octree_color_mode)
-        {
-          case OCTOMAP_Z_AXIS_COLOR:
-            setColor(new_point.position.z, min_z, max_z, colorFactor_, &new_point);
-            break;
-          case OCTOMAP_PROBABLILTY_COLOR:
-            cell_probability = it->getOccupancy();
-            new_point.setColor((1.0f - cell_probability), cell_probability, 0.0);
-            break;
-          default:
-            break;
-        }
+      new_point.position.x = leaf.x;
+      new_point.position.y = leaf.y;
+      new_point.position.z = leaf.z;
 
-        // push to point vectors
-        unsigned int depth = it.getDepth();
-        point_buf[depth - 1].push_back(new_point);
-
-        ++point_count;
+      switch (octree_color_mode_)
+      {
+        case OCTOMAP_Z_AXIS_COLOR:
+          setColor(new_point.position.z, min_z, max_z, colorFactor_, &new_point);
+          break;
+        case OCTOMAP_PROBABLILTY_COLOR:
+          new_point.setColor((1.0f - leaf.occupancy), leaf.occupancy, 0.0);
+          break;
+        default:
+          break;
       }
+
+      // push to point vectors
+      chunk.points[leaf.depth - 1].push_back(new_point);
     }
   }
 
-  for (size_t i = 0; i < octree_depth_; ++i)
+  for (size_t i = 0; i < cloud_.size(); ++i)
   {
     double size = octree->getNodeSize(i + 1);
 
     cloud_[i]->clear();
     cloud_[i]->setDimensions(size, size, size);
 
-    cloud_[i]->addPoints(point_buf[i].begin(), point_buf[i].end());
-    point_buf[i].clear();
+    for (const auto& [id, chunk] : chunks_)
+      if (i < chunk.points.size())
+        cloud_[i]->addPoints(chunk.points[i].begin(), chunk.points[i].end());
   }
 }
 }  // namespace moveit_rviz_plugin
@@ -46,13 +46,17 @@ namespace moveit_rviz_plugin
 {
 PlanningSceneRender::PlanningSceneRender(Ogre::SceneNode* node, rviz_common::DisplayContext* context,
                                          const RobotStateVisualizationPtr& robot)
-  : planning_scene_geometry_node_(node->createChildSceneNode()), context_(context), scene_robot_(robot)
+  : planning_scene_geometry_node_(node->createChildSceneNode())
+  , context_(context)
+  , scene_robot_(robot)
+  , octree_voxel_rendering_(OCTOMAP_OCCUPIED_VOXELS)
+  , octree_color_mode_(OCTOMAP_Z_AXIS_COLOR)
 {
-  render_shapes_ = std::make_shared<RenderShapes>(context);
 }
 
 PlanningSceneRender::~PlanningSceneRender()
 {
+  clear();
   context_->getSceneManager()->destroySceneNode(planning_scene_geometry_node_);
 }
 
@@ -68,9 +72,50 @@ void PlanningSceneRender::updateRobotPosition(const planning_scene::PlanningScen
 
 void PlanningSceneRender::clear()
 {
-  render_shapes_->clear();
+  for (auto& [id, rendered] : rendered_objects_)
+    removeObject(rendered);
+  rendered_objects_.clear();
+}
+
+void PlanningSceneRender::removeObject(RenderedObject& rendered)
+{
+  // the shapes destroy their own child nodes
+  rendered.shapes->clear();
+  context_->getSceneManager()->destroySceneNode(rendered.node);
 }
 
+void PlanningSceneRender::updateLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle)
+{
+  for (auto& [id, rendered] : rendered_objects_)
+    rendered.shapes->updateOcTreeLevelOfDetail(camera_position, min_voxel_angle);
+}
+
+namespace
+{
+bool isOcTree(const collision_detection::World::Object& object)
+{
+  return object.shapes_.size() == 1 && object.shapes_[0]->type == shapes::OCTREE;
+}
+
+bool sameGeometry(const collision_detection::World::Object& a, const collision_detection::World::Object& b)
+{
+  if (a.shapes_ != b.shapes_ || a.shape_poses_.size() != b.shape_poses_.size())
+    return false;
+  for (std::size_t i = 0; i < a.shape_poses_.size(); ++i)
+    if (a.shape_poses_[i].matrix() != b.shape_poses_[i].matrix())
+      return false;
+  return true;
+}
+
+void setNodePose(Ogre::SceneNode* node, const Eigen::Isometry3d& pose)
+{
+  const Eigen::Vector3d& t = pose.translation();
+  const Eigen::Quaterniond q(pose.linear());
+  node->setPosition(Ogre::Vector3(t.x(), t.y(), t.z()));
+  node->setOrientation(Ogre::Quaternion(q.w(), q.x(), q.y(), q.z()));
+}
+}  // namespace
+
 void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene,
                                               const Ogre::ColourValue& default_env_color,
                                               const Ogre::ColourValue& default_attached_color,
@@ -80,7 +125,12 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
   if (!scene)
     return;
 
-  clear();
+  if (octree_voxel_rendering != octree_voxel_rendering_ || octree_color_mode != octree_color_mode_)
+  {
+    clear();
+    octree_voxel_rendering_ = octree_voxel_rendering;
+    octree_color_mode_ = octree_color_mode;
+  }
 
   if (scene_robot_)
   {
@@ -97,10 +147,22 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
     scene_robot_->update(moveit::core::RobotStateConstPtr(rs), color, color_map);
   }
 
-  const std::vector<std::string>& ids = scene->getWorld()->getObjectIds();
+  const collision_detection::WorldConstPtr& world = scene->getWorld();
+  for (auto it = rendered_objects_.begin(); it != rendered_objects_.end();)
+  {
+    if (world->hasObject(it->first))
+      ++it;
+    else
+    {
+      removeObject(it->second);
+      it = rendered_objects_.erase(it);
+    }
+  }
+
+  const std::vector<std::string>& ids = world->getObjectIds();
   for (const std::string& id : ids)
   {
-    collision_detection::CollisionEnv::ObjectConstPtr object = scene->getWorld()->getObject(id);
+    collision_detection::CollisionEnv::ObjectConstPtr object = world->getObject(id);
     Ogre::ColourValue color = default_env_color;
     float alpha = default_scene_alpha;
     if (scene->hasObjectColor(id))
@@ -112,11 +174,43 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
       color.a = c.a;
       alpha = c.a;
     }
+
+    auto [it, inserted] = rendered_objects_.try_emplace(id);
+    RenderedObject& rendered = it->second;
+    if (!inserted && rendered.color == color && rendered.alpha == alpha)
+    {
+      // octrees can also be modified in place, OcTreeRender only decodes the regions that changed
+      if (isOcTree(*rendered.object) && isOcTree(*object) && rendered.shapes->getOcTreeCount() == 1)
+      {
+        setNodePose(rendered.node, object->pose_);
+        rendered.shapes->updateOcTree(0, static_cast<const shapes::OcTree&>(*object->shapes_[0]).octree,
+                                      object->shape_poses_[0]);
+        rendered.object = object;
+        continue;
+      }
+      // objects are copied on write, so an unchanged pointer means an unchanged object
+      if (rendered.object == object)
+        continue;
+      if (sameGeometry(*rendered.object, *object))
+      {
+        setNodePose(rendered.node, object->pose_);
+        rendered.object = object;
+        continue;
+      }
+    }
+    if (!inserted)
+      removeObject(rendered);
+
+    rendered.object = object;
+    rendered.color = color;
+    rendered.alpha = alpha;
+    rendered.node = planning_scene_geometry_node_->createChildSceneNode();
+    rendered.shapes = std::make_shared<RenderShapes>(context_);
+    setNodePose(rendered.node, object->pose_);
     for (std::size_t j = 0; j < object->shapes_.size(); ++j)
     {
-      render_shapes_->renderShape(planning_scene_geometry_node_, object->shapes_[j].get(),
-                                  object->global_shape_poses_[j], octree_voxel_rendering, octree_color_mode, color,
-                                  alpha);
+      rendered.shapes->renderShape(rendered.node, object->shapes_[j].get(), object->shape_poses_[j],
+                                   octree_voxel_rendering, octree_color_mode, color, alpha);
     }
   }
 }
@@ -43,17 +43,99 @@
 #include <OgreSceneManager.h>
 #include <OgreManualObject.h>
 #include <OgreMaterialManager.h>
+#include <OgreMeshManager.h>
 #include <rviz_rendering/objects/shape.hpp>
 #include <ogre_helpers/mesh_shape.hpp>
 #include <rviz_common/display_context.hpp>
 #include <rviz_default_plugins/robot/robot.hpp>
 
 #include <math.h>
+#include <map>
 #include <memory>
 #include <string>
 
 namespace moveit_rviz_plugin
 {
+namespace
+{
+struct SharedMesh
+{
+  Ogre::MeshPtr mesh;
+  std::size_t users = 0;
+};
+
+// Ogre meshes by content, shared by all RenderShapes; only accessed from the render thread
+std::map<std::uint64_t, SharedMesh>& sharedMeshes()
+{
+  static std::map<std::uint64_t, SharedMesh> meshes;
+  return meshes;
+}
+
+void hashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+}
+
+// 64-bit FNV-1a hash of the mesh geometry
+std::uint64_t meshKey(const shapes::Mesh& mesh)
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  const bool normals[2] = { mesh.vertex_normals != nullptr, mesh.triangle_normals != nullptr };
+  hashBytes(hash, &mesh.vertex_count, sizeof(mesh.vertex_count));
+  hashBytes(hash, &mesh.triangle_count, sizeof(mesh.triangle_count));
+  hashBytes(hash, normals, sizeof(normals));
+  hashBytes(hash, mesh.vertices, 3 * mesh.vertex_count * sizeof(double));
+  hashBytes(hash, mesh.triangles, 3 * mesh.triangle_count * sizeof(unsigned int));
+  if (mesh.vertex_normals)
+    hashBytes(hash, mesh.vertex_normals, 3 * mesh.vertex_count * sizeof(double));
+  else if (mesh.triangle_normals)
+    hashBytes(hash, mesh.triangle_normals, 3 * mesh.triangle_count * sizeof(double));
+  return hash;
+}
+
+Ogre::MeshPtr createOgreMesh(Ogre::SceneManager* scene_manager, const shapes::Mesh& mesh)
+{
+  static uint32_t count = 0;
+  const std::string name = "RenderShapes_Mesh" + std::to_string(count++);
+  Ogre::ManualObject* manual_object = scene_manager->createManualObject(name + "_ManualObject");
+  manual_object->estimateVertexCount(3 * mesh.triangle_count);
+  manual_object->begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_TRIANGLE_LIST,
+                       Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+
+  Ogre::Vector3 normal(0.0, 0.0, 0.0);
+  for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+  {
+    unsigned int i3 = i * 3;
+    if (mesh.triangle_normals && !mesh.vertex_normals)
+    {
+      normal.x = mesh.triangle_normals[i3];
+      normal.y = mesh.triangle_normals[i3 + 1];
+      normal.z = mesh.triangle_normals[i3 + 2];
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+      unsigned int vi = 3 * mesh.triangles[i3 + k];
+      manual_object->position(mesh.vertices[vi], mesh.vertices[vi + 1], mesh.vertices[vi + 2]);
+      if (mesh.vertex_normals)
+        manual_object->normal(mesh.vertex_normals[vi], mesh.vertex_normals[vi + 1], mesh.vertex_normals[vi + 2]);
+      else if (mesh.triangle_normals)
+        manual_object->normal(normal);
+    }
+  }
+  manual_object->end();
+
+  Ogre::MeshPtr ogre_mesh = manual_object->convertToMesh(name);
+  scene_manager->destroyManualObject(manual_object);
+  return ogre_mesh;
+}
+}  // namespace
+
 RenderShapes::RenderShapes(rviz_common::DisplayContext* context) : context_(context)
 {
 }
@@ -67,6 +149,28 @@ void RenderShapes::clear()
 {
   scene_shapes_.clear();
   octree_voxel_grids_.clear();
+
+  std::map<std::uint64_t, SharedMesh>& meshes = sharedMeshes();
+  for (std::uint64_t key : mesh_keys_)
+  {
+    auto it = meshes.find(key);
+    if (it != meshes.end() && --it->second.users == 0)
+    {
+      Ogre::MeshManager::getSingleton().remove(it->second.mesh);
+      meshes.erase(it);
+    }
+  }
+  mesh_keys_.clear();
+}
+
+Ogre::MeshPtr RenderShapes::acquireMesh(const shapes::Mesh& mesh)
+{
+  const std::uint64_t key = meshKey(mesh);
+  SharedMesh& shared = sharedMeshes()[key];
+  if (shared.users++ == 0)
+    shared.mesh = createOgreMesh(context_->getSceneManager(), mesh);
+  mesh_keys_.push_back(key);
+  return shared.mesh;
 }
 
 void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, const Eigen::Isometry3d& p,
@@ -121,34 +225,7 @@ void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, co
       {
         rviz_rendering::MeshShape* m = new rviz_rendering::MeshShape(context_->getSceneManager(), node);
         ogre_shape = m;
-
-        Ogre::Vector3 normal(0.0, 0.0, 0.0);
-        for (unsigned int i = 0; i < mesh->triangle_count; ++i)
-        {
-          unsigned int i3 = i * 3;
-          if (mesh->triangle_normals && !mesh->vertex_normals)
-          {
-            normal.x = mesh->triangle_normals[i3];
-            normal.y = mesh->triangle_normals[i3 + 1];
-            normal.z = mesh->triangle_normals[i3 + 2];
-          }
-
-          for (int k = 0; k < 3; ++k)
-          {
-            unsigned int vi = 3 * mesh->triangles[i3 + k];
-            Ogre::Vector3 v(mesh->vertices[vi], mesh->vertices[vi + 1], mesh->vertices[vi + 2]);
-            if (mesh->vertex_normals)
-            {
-              Ogre::Vector3 n(mesh->vertex_normals[vi], mesh->vertex_normals[vi + 1], mesh->vertex_normals[vi + 2]);
-              m->addVertex(v, n);
-            }
-            else if (mesh->triangle_normals)
-              m->addVertex(v, normal);
-            else
-              m->addVertex(v);
-          }
-        }
-        m->endTriangles();
+        m->setMesh(acquireMesh(*mesh));
       }
     }
     break;
@@ -188,6 +265,24 @@ void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, co
   }
 }
 
+void RenderShapes::updateOcTree(std::size_t index, const std::shared_ptr<const octomap::OcTree>& octree,
+                                const Eigen::Isometry3d& p)
+{
+  const OcTreeRenderPtr& octree_render = octree_voxel_grids_.at(index);
+  Eigen::Vector3d translation = p.translation();
+  ASSERT_ISOMETRY(p)  // unsanitized input, could contain a non-isometry
+  Eigen::Quaterniond q(p.linear());
+  octree_render->setPosition(Ogre::Vector3(translation.x(), translation.y(), translation.z()));
+  octree_render->setOrientation(Ogre::Quaternion(q.w(), q.x(), q.y(), q.z()));
+  octree_render->update(octree);
+}
+
+void RenderShapes::updateOcTreeLevelOfDetail(const Ogre::Vector3& camera_position, double min_voxel_angle)
+{
+  for (const OcTreeRenderPtr& octree_render : octree_voxel_grids_)
+    octree_render->updateLevelOfDetail(camera_position, min_voxel_angle);
+}
+
 void RenderShapes::updateShapeColors(float r, float g, float b, float a)
 {
   for (const std::unique_ptr<rviz_rendering::Shape>& shape : scene_shapes_)
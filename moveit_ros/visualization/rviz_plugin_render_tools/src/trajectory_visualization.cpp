@@ -127,6 +127,13 @@ TrajectoryVisualization::TrajectoryVisualization(rviz_common::properties::Proper
                                                                        widget, SLOT(changedTrailStepSize()), this);
   trail_step_size_property_->setMin(1);
 
+  trail_max_states_property_ = new rviz_common::properties::IntProperty(
+      "Trail Max States", 100,
+      "Specifies the maximum number of robot states shown in the trajectory trail. Longer trails are thinned "
+      "to states evenly spaced along the path.",
+      widget, SLOT(changedTrailStepSize()), this);
+  trail_max_states_property_->setMin(2);
+
   interrupt_display_property_ = new rviz_common::properties::BoolProperty(
       "Interrupt Display", false,
       "Immediately show newly planned trajectory, interrupting the currently displayed one.", widget);
@@ -211,6 +218,7 @@ void TrajectoryVisualization::onRobotModelLoaded(const moveit::core::RobotModelC
 
   // Load rviz robot
   display_path_robot_->load(*robot_model_->getURDF());
+  clearTrajectoryTrail();
   enabledRobotColor();  // force-refresh to account for saved display configuration
   // perform post-poned subscription to trajectory topic
   // Check if topic name is empty
@@ -233,6 +241,7 @@ void TrajectoryVisualization::reset()
 void TrajectoryVisualization::clearTrajectoryTrail()
 {
   trajectory_trail_.clear();
+  trail_waypoints_.clear();
 }
 
 void TrajectoryVisualization::changedLoopDisplay()
@@ -242,36 +251,76 @@ void TrajectoryVisualization::changedLoopDisplay()
     trajectory_slider_panel_->pauseButton(false);
 }
 
-void TrajectoryVisualization::changedShowTrail()
+namespace
 {
-  clearTrajectoryTrail();
+// Every step_size-th waypoint and the last one. If these are more than max_states, they are thinned to waypoints
+// evenly spaced by joint space distance along the path, so that densely sampled segments do not use up the budget.
+std::vector<std::size_t> getTrailWaypoints(const robot_trajectory::RobotTrajectory& trajectory, std::size_t step_size,
+                                           std::size_t max_states)
+{
+  std::vector<std::size_t> waypoints;
+  const std::size_t count = trajectory.getWayPointCount();
+  for (std::size_t i = 0; i < count; i += step_size)
+    waypoints.push_back(i);
+  // always include last trajectory point
+  if (waypoints.back() != count - 1)
+    waypoints.push_back(count - 1);
+  if (waypoints.size() <= max_states)
+    return waypoints;
+
+  std::vector<double> path_length(waypoints.size(), 0.0);
+  for (std::size_t i = 1; i < waypoints.size(); ++i)
+    path_length[i] = path_length[i - 1] +
+                     trajectory.getWayPoint(waypoints[i - 1]).distance(trajectory.getWayPoint(waypoints[i]));
+
+  std::vector<std::size_t> thinned = { waypoints.front() };
+  std::size_t j = 1;
+  for (std::size_t k = 1; k + 1 < max_states; ++k)
+  {
+    const double target = path_length.back() * k / (max_states - 1);
+    while (j + 1 < waypoints.size() && path_length[j] < target)
+      ++j;
+    if (j + 1 < waypoints.size() && waypoints[j] != thinned.back())
+      thinned.push_back(waypoints[j]);
+  }
+  thinned.push_back(waypoints.back());
+  return thinned;
+}
+}  // namespace
 
-  if (!trail_display_property_->getBool())
-    return;
+void TrajectoryVisualization::changedShowTrail()
+{
   robot_trajectory::RobotTrajectoryPtr t = trajectory_message_to_display_;
   if (!t)
     t = displaying_trajectory_message_;
-  if (!t)
+  if (!trail_display_property_->getBool() || !t || t->empty())
+  {
+    clearTrajectoryTrail();
     return;
+  }
 
-  int stepsize = trail_step_size_property_->getInt();
-  // always include last trajectory point
-  trajectory_trail_.resize(static_cast<int>(std::ceil((t->getWayPointCount() + stepsize - 1) / (float)stepsize)));
-  for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
+  trail_waypoints_ = getTrailWaypoints(*t, trail_step_size_property_->getInt(), trail_max_states_property_->getInt());
+  if (trajectory_trail_.size() > trail_waypoints_.size())
+    trajectory_trail_.resize(trail_waypoints_.size());
+  for (std::size_t i = 0; i < trail_waypoints_.size(); ++i)
   {
-    int waypoint_i = std::min(i * stepsize, t->getWayPointCount() - 1);  // limit to last trajectory point
-    auto r =
-        std::make_unique<RobotStateVisualization>(scene_node_, context_, "Trail Robot " + std::to_string(i), nullptr);
-    r->load(*robot_model_->getURDF());
-    r->setVisualVisible(display_path_visual_enabled_property_->getBool());
-    r->setCollisionVisible(display_path_collision_enabled_property_->getBool());
-    r->setAlpha(robot_path_alpha_property_->getFloat());
+    const std::size_t waypoint_i = trail_waypoints_[i];
+    if (i == trajectory_trail_.size())
+    {
+      auto r =
+          std::make_unique<RobotStateVisualization>(scene_node_, context_, "Trail Robot " + std::to_string(i), nullptr);
+      r->load(*robot_model_->getURDF());
+      r->setVisualVisible(display_path_visual_enabled_property_->getBool());
+      r->setCollisionVisible(display_path_collision_enabled_property_->getBool());
+      r->setAlpha(robot_path_alpha_property_->getFloat());
+      trajectory_trail_.push_back(std::move(r));
+    }
+    const RobotStateVisualizationUniquePtr& r = trajectory_trail_[i];
     r->update(t->getWayPointPtr(waypoint_i), default_attached_object_color_);
     if (enable_robot_color_property_->getBool())
       setRobotColor(&(r->getRobot()), robot_color_property_->getColor());
-    r->setVisible(display_->isEnabled() && (!animating_path_ || waypoint_i <= current_state_));
+    r->setVisible(display_->isEnabled() && (!animating_path_ || static_cast<int>(waypoint_i) <= current_state_));
     r->updateAttachedObjectColors(default_attached_object_color_);
-    trajectory_trail_[i] = std::move(r);
   }
 }
 
@@ -494,10 +543,8 @@ void TrajectoryVisualization::update(float wall_dt, float sim_dt)
              (tm = displaying_trajectory_message_->getWayPointDurationFromPrevious(current_state_ + 1) / rt_factor) <
                  current_state_time_)
       {
+        // skipped waypoints are not rendered, only the one reached is
         current_state_time_ -= tm;
-        // if we are stuck in the while loop we should move the robot along the path to keep up
-        if (tm < current_state_time_)
-          display_path_robot_->update(displaying_trajectory_message_->getWayPointPtr(current_state_));
         ++current_state_;
       }
     }
@@ -516,8 +563,7 @@ void TrajectoryVisualization::update(float wall_dt, float sim_dt)
         trajectory_slider_panel_->setSliderPosition(current_state_);
       display_path_robot_->update(displaying_trajectory_message_->getWayPointPtr(current_state_));
       for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
-        trajectory_trail_[i]->setVisible(
-            std::min(waypoint_count - 1, static_cast<int>(i) * trail_step_size_property_->getInt()) <= current_state_);
+        trajectory_trail_[i]->setVisible(static_cast<int>(trail_waypoints_[i]) <= current_state_);
     }
     else
     {
@@ -41,6 +41,8 @@
 #include <moveit_msgs/msg/planning_scene.hpp>
 #include <moveit_msgs/msg/motion_plan_request.hpp>
 #include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <functional>
+#include <set>
 
 #include <moveit_warehouse_export.h>
 
@@ -63,6 +65,14 @@ public:
 
   static const std::string PLANNING_SCENE_ID_NAME;
   static const std::string MOTION_PLAN_REQUEST_ID_NAME;
+  /** \brief Metadata field holding a hash of the serialized request, by which identical requests are looked up */
+  static const std::string MOTION_PLAN_REQUEST_HASH_NAME;
+
+  /** \brief Receives a query with its name, returns whether the iteration continues */
+  using PlanningQueryCallback =
+      std::function<bool(const std::string& query_name, const MotionPlanRequestWithMetadata& planning_query)>;
+  /** \brief Receives a result, returns whether the iteration continues */
+  using PlanningResultCallback = std::function<bool(const RobotTrajectoryWithMetadata& planning_result)>;
 
   PlanningSceneStorage(warehouse_ros::DatabaseConnection::Ptr conn);
 
@@ -90,11 +100,19 @@ public:
                                const std::string& scene_name) const;
   void getPlanningQueries(std::vector<MotionPlanRequestWithMetadata>& planning_queries,
                           std::vector<std::string>& query_names, const std::string& scene_name) const;
+  /** \brief Pass the queries of \e scene_name whose names match \e regex (all if empty) to \e callback, in a single
+      database query whose results are loaded one at a time rather than all at once */
+  void forEachPlanningQuery(const std::string& scene_name, const std::string& regex,
+                            const PlanningQueryCallback& callback) const;
 
   void getPlanningResults(std::vector<RobotTrajectoryWithMetadata>& planning_results, const std::string& scene_name,
                           const moveit_msgs::msg::MotionPlanRequest& planning_query) const;
   void getPlanningResults(std::vector<RobotTrajectoryWithMetadata>& planning_results, const std::string& scene_name,
                           const std::string& query_name) const;
+  /** \brief Pass the results of the query \e query_name of \e scene_name to \e callback, loading them one at a time.
+      With \e metadata_only, the trajectories are not loaded, e.g. for counting the results. */
+  void forEachPlanningResult(const std::string& scene_name, const std::string& query_name,
+                             const PlanningResultCallback& callback, bool metadata_only = false) const;
 
   void renamePlanningScene(const std::string& old_scene_name, const std::string& new_scene_name);
   void renamePlanningQuery(const std::string& scene_name, const std::string& old_query_name,
@@ -113,11 +131,15 @@ private:
 
   std::string getMotionPlanRequestName(const moveit_msgs::msg::MotionPlanRequest& planning_query,
                                        const std::string& scene_name) const;
+  /** \brief Add the hash field to the requests of \e scene_name stored without it, once per scene */
+  void addMissingMotionPlanRequestHashes(const std::string& scene_name) const;
   std::string addNewPlanningRequest(const moveit_msgs::msg::MotionPlanRequest& planning_query,
                                     const std::string& scene_name, const std::string& query_name);
 
   PlanningSceneCollection planning_scene_collection_;
   MotionPlanRequestCollection motion_plan_request_collection_;
   RobotTrajectoryCollection robot_trajectory_collection_;
+  /// Scenes whose requests are known to have a hash field
+  mutable std::set<std::string> hashed_scenes_;
 };
 }  // namespace moveit_warehouse
@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#pragma once
+
+#include <moveit/warehouse/moveit_message_storage.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <Eigen/Geometry>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+
+#include <moveit_warehouse_export.h>
+
+namespace moveit_warehouse
+{
+typedef warehouse_ros::MessageCollection<moveit_msgs::msg::RobotTrajectory>::Ptr TrajectoryLibraryCollection;
+
+MOVEIT_CLASS_FORWARD(TrajectoryLibrary);  // Defines TrajectoryLibraryPtr, ConstPtr, WeakPtr... etc
+
+/** \brief Stored trajectories of a robot, retrieved by the similarity of their start and goal to a new request.
+
+    All trajectories of the robot are loaded into memory on construction and indexed per group in a kd-tree over
+    their start and goal joint positions, so that the nearest ones are found in well under a millisecond. Additional
+    task space indexes over the start and goal positions of a link can be added with addTaskSpaceIndex(). Joint space
+    distances are Euclidean over the variables of the group, task space distances are in meters. */
+class MOVEIT_WAREHOUSE_EXPORT TrajectoryLibrary : public MoveItMessageStorage
+{
+public:
+  static const std::string DATABASE_NAME;
+
+  static const std::string ROBOT_NAME;
+  static const std::string GROUP_NAME;
+
+  TrajectoryLibrary(warehouse_ros::DatabaseConnection::Ptr conn, const moveit::core::RobotModelConstPtr& robot_model);
+  ~TrajectoryLibrary() override;
+
+  /** \brief Store \e trajectory, which needs to have a group, and add it to the indexes */
+  bool addTrajectory(const robot_trajectory::RobotTrajectory& trajectory);
+
+  /** \brief Index the trajectories of \e group by the positions of \e link at their start and goal as well */
+  bool addTaskSpaceIndex(const std::string& group, const std::string& link);
+
+  /** \brief Number of stored trajectories of \e group */
+  std::size_t getTrajectoryCount(const std::string& group) const;
+
+  /** \brief Get up to \e count trajectories of \e group, nearest first, whose start and goal joint positions together
+      are at most \e max_distance from \e start and \e goal */
+  std::vector<robot_trajectory::RobotTrajectoryConstPtr>
+  getNearestTrajectories(const std::string& group, const moveit::core::RobotState& start,
+                         const moveit::core::RobotState& goal, std::size_t count, double max_distance) const;
+
+  /** \brief Get up to \e count trajectories of \e group, nearest first, whose start and goal positions of \e link
+      together are at most \e max_distance from the position of \e link in \e start and \e goal_position. Requires a
+      task space index for \e group and \e link. */
+  std::vector<robot_trajectory::RobotTrajectoryConstPtr>
+  getNearestTrajectories(const std::string& group, const moveit::core::RobotState& start, const std::string& link,
+                         const Eigen::Vector3d& goal_position, std::size_t count, double max_distance) const;
+
+  /** \brief Provide the nearest trajectories to the plan candidates stage of a PlanningPipeline. Requests whose first
+      goal has joint constraints for all variables of the group are looked up in joint space, requests whose first
+      goal is a single position constraint on a link with a task space index in task space. The library needs to
+      outlive the pipeline. */
+  planning_pipeline::PlanningPipeline::PlanCandidateSourceFn
+  getPlanCandidateSource(std::size_t count, double max_joint_distance, double max_task_distance) const;
+
+  /** \brief Remove all trajectories of all robots */
+  void reset();
+
+  class NearestNeighborIndex;
+  struct GroupIndex;
+
+private:
+  void createCollections();
+  void loadTrajectories();
+  void indexTrajectory(const robot_trajectory::RobotTrajectoryConstPtr& trajectory);
+
+  moveit::core::RobotModelConstPtr robot_model_;
+  TrajectoryLibraryCollection trajectory_collection_;
+
+  std::map<std::string, std::shared_ptr<GroupIndex>> groups_;
+  mutable std::shared_mutex groups_lock_;
+};
+}  // namespace moveit_warehouse
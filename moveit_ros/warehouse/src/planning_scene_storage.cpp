@@ -37,18 +37,51 @@
 #include <moveit/warehouse/planning_scene_storage.h>
 #include <utility>
 #include <rclcpp/serialization.hpp>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
 #include <regex>
 
 const std::string moveit_warehouse::PlanningSceneStorage::DATABASE_NAME = "moveit_planning_scenes";
 
 const std::string moveit_warehouse::PlanningSceneStorage::PLANNING_SCENE_ID_NAME = "planning_scene_id";
 const std::string moveit_warehouse::PlanningSceneStorage::MOTION_PLAN_REQUEST_ID_NAME = "motion_request_id";
+const std::string moveit_warehouse::PlanningSceneStorage::MOTION_PLAN_REQUEST_HASH_NAME = "motion_request_hash";
 
 using warehouse_ros::Metadata;
 using warehouse_ros::Query;
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.warehouse.planning_scene_storage");
 
+namespace
+{
+rclcpp::SerializedMessage serializeRequest(const moveit_msgs::msg::MotionPlanRequest& planning_query)
+{
+  static const rclcpp::Serialization<moveit_msgs::msg::MotionPlanRequest> SERIALIZER;
+  rclcpp::SerializedMessage serialized_msg;
+  SERIALIZER.serialize_message(&planning_query, &serialized_msg);
+  return serialized_msg;
+}
+
+// 64 bit FNV-1a of the serialized request, as hex string since the metadata has no 64 bit integers
+std::string hashRequest(const rclcpp::SerializedMessage& serialized_msg)
+{
+  const auto* data = static_cast<const unsigned char*>(serialized_msg.get_rcl_serialized_message().buffer);
+  std::uint64_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < serialized_msg.size(); ++i)
+    hash = (hash ^ data[i]) * 1099511628211ull;
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016" PRIx64, hash);
+  return hex;
+}
+
+bool equalRequests(const rclcpp::SerializedMessage& a, const rclcpp::SerializedMessage& b)
+{
+  return a.size() == b.size() &&
+         memcmp(a.get_rcl_serialized_message().buffer, b.get_rcl_serialized_message().buffer, a.size()) == 0;
+}
+}  // namespace
+
 moveit_warehouse::PlanningSceneStorage::PlanningSceneStorage(warehouse_ros::DatabaseConnection::Ptr conn)
   : MoveItMessageStorage(std::move(conn))
 {
@@ -70,6 +103,7 @@ void moveit_warehouse::PlanningSceneStorage::reset()
   planning_scene_collection_.reset();
   motion_plan_request_collection_.reset();
   robot_trajectory_collection_.reset();
+  hashed_scenes_.clear();
   conn_->dropDatabase(DATABASE_NAME);
   createCollections();
 }
@@ -99,39 +133,53 @@ bool moveit_warehouse::PlanningSceneStorage::hasPlanningScene(const std::string&
 std::string moveit_warehouse::PlanningSceneStorage::getMotionPlanRequestName(
     const moveit_msgs::msg::MotionPlanRequest& planning_query, const std::string& scene_name) const
 {
-  // get all existing motion planning requests for this planning scene
+  addMissingMotionPlanRequestHashes(scene_name);
+
+  // only the requests with the same hash are loaded, and compared in full in case of a hash collision
+  const rclcpp::SerializedMessage serialized_msg_arg = serializeRequest(planning_query);
   Query::Ptr q = motion_plan_request_collection_->createQuery();
   q->append(PLANNING_SCENE_ID_NAME, scene_name);
+  q->append(MOTION_PLAN_REQUEST_HASH_NAME, hashRequest(serialized_msg_arg));
   std::vector<MotionPlanRequestWithMetadata> existing_requests = motion_plan_request_collection_->queryList(q, false);
-
-  // if there are no requests stored, we are done
-  if (existing_requests.empty())
-    return "";
-
-  // compute the serialization of the message passed as argument
-  rclcpp::Serialization<moveit_msgs::msg::MotionPlanRequest> serializer;
-  rclcpp::SerializedMessage serialized_msg_arg;
-  serializer.serialize_message(&planning_query, &serialized_msg_arg);
-  const size_t serial_size_arg = serialized_msg_arg.size();
-  const void* data_arg = serialized_msg_arg.get_rcl_serialized_message().buffer;
-
   for (MotionPlanRequestWithMetadata& existing_request : existing_requests)
   {
-    auto msg = static_cast<const moveit_msgs::msg::MotionPlanRequest&>(*existing_request);
-    rclcpp::SerializedMessage serialized_msg;
-    serializer.serialize_message(&msg, &serialized_msg);
-    const size_t serial_size = serialized_msg.size();
-    const void* data = serialized_msg.get_rcl_serialized_message().buffer;
-
-    if (serial_size != serial_size_arg)
-      continue;
-    if (memcmp(data_arg, data, serial_size) == 0)
+    if (equalRequests(serializeRequest(*existing_request), serialized_msg_arg))
       // we found the same message twice
       return existing_request->lookupString(MOTION_PLAN_REQUEST_ID_NAME);
   }
   return "";
 }
 
+void moveit_warehouse::PlanningSceneStorage::addMissingMotionPlanRequestHashes(const std::string& scene_name) const
+{
+  if (!hashed_scenes_.insert(scene_name).second)
+    return;
+
+  // requests stored before the hash field was introduced are hashed once, so that later lookups are single queries
+  Query::Ptr q = motion_plan_request_collection_->createQuery();
+  q->append(PLANNING_SCENE_ID_NAME, scene_name);
+  std::vector<MotionPlanRequestWithMetadata> existing_requests = motion_plan_request_collection_->queryList(q, true);
+  std::size_t count = 0;
+  for (MotionPlanRequestWithMetadata& existing_request : existing_requests)
+  {
+    if (existing_request->lookupField(MOTION_PLAN_REQUEST_HASH_NAME) ||
+        !existing_request->lookupField(MOTION_PLAN_REQUEST_ID_NAME))
+      continue;
+    Query::Ptr request_q = motion_plan_request_collection_->createQuery();
+    request_q->append(PLANNING_SCENE_ID_NAME, scene_name);
+    request_q->append(MOTION_PLAN_REQUEST_ID_NAME, existing_request->lookupString(MOTION_PLAN_REQUEST_ID_NAME));
+    std::vector<MotionPlanRequestWithMetadata> requests = motion_plan_request_collection_->queryList(request_q, false);
+    if (requests.empty())
+      continue;
+    Metadata::Ptr m = motion_plan_request_collection_->createMetadata();
+    m->append(MOTION_PLAN_REQUEST_HASH_NAME, hashRequest(serializeRequest(*requests.front())));
+    motion_plan_request_collection_->modifyMetadata(request_q, m);
+    ++count;
+  }
+  if (count > 0)
+    RCLCPP_INFO(LOGGER, "Added the lookup hash to %zu planning queries of scene '%s'", count, scene_name.c_str());
+}
+
 void moveit_warehouse::PlanningSceneStorage::addPlanningQuery(const moveit_msgs::msg::MotionPlanRequest& planning_query,
                                                               const std::string& scene_name,
                                                               const std::string& query_name)
@@ -170,6 +218,7 @@ moveit_warehouse::PlanningSceneStorage::addNewPlanningRequest(const moveit_msgs:
   Metadata::Ptr metadata = motion_plan_request_collection_->createMetadata();
   metadata->append(PLANNING_SCENE_ID_NAME, scene_name);
   metadata->append(MOTION_PLAN_REQUEST_ID_NAME, id);
+  metadata->append(MOTION_PLAN_REQUEST_HASH_NAME, hashRequest(serializeRequest(planning_query)));
   motion_plan_request_collection_->insert(planning_query, metadata);
   RCLCPP_DEBUG(LOGGER, "Saved planning query '%s' for scene '%s'", id.c_str(), scene_name.c_str());
   return id;
@@ -322,7 +371,7 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningResults(
   if (id.empty())
     planning_results.clear();
   else
-    getPlanningResults(planning_results, id, scene_name);
+    getPlanningResults(planning_results, scene_name, id);
 }
 
 void moveit_warehouse::PlanningSceneStorage::getPlanningResults(
@@ -335,6 +384,42 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningResults(
   planning_results = robot_trajectory_collection_->queryList(q, false);
 }
 
+void moveit_warehouse::PlanningSceneStorage::forEachPlanningQuery(const std::string& scene_name,
+                                                                  const std::string& regex,
+                                                                  const PlanningQueryCallback& callback) const
+{
+  Query::Ptr q = motion_plan_request_collection_->createQuery();
+  q->append(PLANNING_SCENE_ID_NAME, scene_name);
+  std::regex r(regex.empty() ? ".*" : regex);
+  // the result iterators fetch one message at a time from the database
+  auto results = motion_plan_request_collection_->query(q, false);
+  for (auto it = results.first; it != results.second; ++it)
+  {
+    const MotionPlanRequestWithMetadata planning_query = *it;
+    if (!planning_query->lookupField(MOTION_PLAN_REQUEST_ID_NAME))
+      continue;
+    const std::string query_name = planning_query->lookupString(MOTION_PLAN_REQUEST_ID_NAME);
+    if (std::regex_match(query_name, r) && !callback(query_name, planning_query))
+      return;
+  }
+}
+
+void moveit_warehouse::PlanningSceneStorage::forEachPlanningResult(const std::string& scene_name,
+                                                                   const std::string& query_name,
+                                                                   const PlanningResultCallback& callback,
+                                                                   bool metadata_only) const
+{
+  Query::Ptr q = robot_trajectory_collection_->createQuery();
+  q->append(PLANNING_SCENE_ID_NAME, scene_name);
+  q->append(MOTION_PLAN_REQUEST_ID_NAME, query_name);
+  auto results = robot_trajectory_collection_->query(q, metadata_only);
+  for (auto it = results.first; it != results.second; ++it)
+  {
+    if (!callback(*it))
+      return;
+  }
+}
+
 bool moveit_warehouse::PlanningSceneStorage::hasPlanningQuery(const std::string& scene_name,
                                                               const std::string& query_name) const
 {
@@ -0,0 +1,416 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, PickNik Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/warehouse/trajectory_library.h>
+#include <moveit/robot_state/conversions.h>
+#include <tf2_eigen/tf2_eigen.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+const std::string moveit_warehouse::TrajectoryLibrary::DATABASE_NAME = "moveit_trajectory_library";
+
+const std::string moveit_warehouse::TrajectoryLibrary::ROBOT_NAME = "robot_id";
+const std::string moveit_warehouse::TrajectoryLibrary::GROUP_NAME = "group_id";
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.warehouse.trajectory_library");
+
+using warehouse_ros::Metadata;
+using warehouse_ros::Query;
+
+namespace moveit_warehouse
+{
+/** \brief Exact k nearest neighbor search over fixed size points. Points are added to a pending buffer that is
+    scanned linearly, and the kd-tree is rebuilt over all points once the buffer grows past an eighth of the tree. */
+class TrajectoryLibrary::NearestNeighborIndex
+{
+public:
+  explicit NearestNeighborIndex(std::size_t dimension) : dimension_(dimension)
+  {
+  }
+
+  /** \brief Add \e point, which is identified by its insertion order */
+  void add(const std::vector<double>& point)
+  {
+    points_.insert(points_.end(), point.begin(), point.end());
+    if (size() - indexed_ > std::max<std::size_t>(64, indexed_ / 8))
+      rebuild();
+  }
+
+  std::size_t size() const
+  {
+    return points_.size() / dimension_;
+  }
+
+  /** \brief Ids of up to \e count points at most \e max_distance from \e query, nearest first */
+  std::vector<std::size_t> nearest(const std::vector<double>& query, std::size_t count, double max_distance) const
+  {
+    Neighbors neighbors;
+    const double max_distance2 = max_distance * max_distance;
+    search(root_, query, count, max_distance2, neighbors);
+    for (std::size_t i = indexed_; i < size(); ++i)
+      consider(i, query, count, max_distance2, neighbors);
+
+    std::vector<std::size_t> ids(neighbors.size());
+    for (std::size_t i = ids.size(); i > 0; --i)
+    {
+      ids[i - 1] = neighbors.top().second;
+      neighbors.pop();
+    }
+    return ids;
+  }
+
+private:
+  struct Node
+  {
+    std::size_t point;
+    std::size_t axis;
+    int left;
+    int right;
+  };
+
+  // max heap of (squared distance, id)
+  using Neighbors = std::priority_queue<std::pair<double, std::size_t>>;
+
+  double coordinate(std::size_t id, std::size_t axis) const
+  {
+    return points_[id * dimension_ + axis];
+  }
+
+  void rebuild()
+  {
+    std::vector<std::size_t> ids(size());
+    std::iota(ids.begin(), ids.end(), 0);
+    nodes_.clear();
+    nodes_.reserve(ids.size());
+    root_ = build(ids, 0, ids.size(), 0);
+    indexed_ = ids.size();
+  }
+
+  int build(std::vector<std::size_t>& ids, std::size_t begin, std::size_t end, std::size_t depth)
+  {
+    if (begin >= end)
+      return -1;
+    const std::size_t axis = depth % dimension_;
+    const std::size_t middle = begin + (end - begin) / 2;
+    std::nth_element(ids.begin() + begin, ids.begin() + middle, ids.begin() + end,
+                     [this, axis](std::size_t a, std::size_t b) { return coordinate(a, axis) < coordinate(b, axis); });
+    const int node = static_cast<int>(nodes_.size());
+    nodes_.push_back(Node{ ids[middle], axis, -1, -1 });
+    const int left = build(ids, begin, middle, depth + 1);
+    const int right = build(ids, middle + 1, end, depth + 1);
+    nodes_[node].left = left;
+    nodes_[node].right = right;
+    return node;
+  }
+
+  void consider(std::size_t id, const std::vector<double>& query, std::size_t count, double max_distance2,
+                Neighbors& neighbors) const
+  {
+    double distance2 = 0.0;
+    for (std::size_t axis = 0; axis < dimension_; ++axis)
+    {
+      const double d = coordinate(id, axis) - query[axis];
+      distance2 += d * d;
+    }
+    if (distance2 > max_distance2 || (neighbors.size() >= count && distance2 >= neighbors.top().first))
+      return;
+    neighbors.emplace(distance2, id);
+    if (neighbors.size() > count)
+      neighbors.pop();
+  }
+
+  void search(int node, const std::vector<double>& query, std::size_t count, double max_distance2,
+              Neighbors& neighbors) const
+  {
+    if (node < 0 || count == 0)
+      return;
+    const Node& n = nodes_[node];
+    consider(n.point, query, count, max_distance2, neighbors);
+    const double d = query[n.axis] - coordinate(n.point, n.axis);
+    search(d < 0.0 ? n.left : n.right, query, count, max_distance2, neighbors);
+    const double bound = neighbors.size() >= count ? neighbors.top().first : max_distance2;
+    if (d * d <= bound)
+      search(d < 0.0 ? n.right : n.left, query, count, max_distance2, neighbors);
+  }
+
+  std::size_t dimension_;
+  std::vector<double> points_;
+  std::vector<Node> nodes_;
+  int root_ = -1;
+  std::size_t indexed_ = 0;
+};
+
+struct TrajectoryLibrary::GroupIndex
+{
+  explicit GroupIndex(const moveit::core::JointModelGroup* group)
+    : group(group), joint_index(2 * group->getVariableCount())
+  {
+  }
+
+  const moveit::core::JointModelGroup* group;
+  std::vector<robot_trajectory::RobotTrajectoryConstPtr> trajectories;
+
+  // start and goal positions of the group variables
+  NearestNeighborIndex joint_index;
+  // start and goal positions of a link, by link name
+  std::map<std::string, NearestNeighborIndex> task_indexes;
+};
+}  // namespace moveit_warehouse
+
+namespace
+{
+std::vector<double> jointKey(const moveit::core::JointModelGroup* group, const moveit::core::RobotState& start,
+                             const moveit::core::RobotState& goal)
+{
+  std::vector<double> key, goal_positions;
+  start.copyJointGroupPositions(group, key);
+  goal.copyJointGroupPositions(group, goal_positions);
+  key.insert(key.end(), goal_positions.begin(), goal_positions.end());
+  return key;
+}
+
+Eigen::Vector3d linkPosition(const moveit::core::RobotState& state, const std::string& link)
+{
+  moveit::core::RobotState updated(state);
+  updated.update();
+  return updated.getGlobalLinkTransform(link).translation();
+}
+
+std::vector<double> taskKey(const Eigen::Vector3d& start, const Eigen::Vector3d& goal)
+{
+  return { start.x(), start.y(), start.z(), goal.x(), goal.y(), goal.z() };
+}
+}  // namespace
+
+moveit_warehouse::TrajectoryLibrary::TrajectoryLibrary(warehouse_ros::DatabaseConnection::Ptr conn,
+                                                       const moveit::core::RobotModelConstPtr& robot_model)
+  : MoveItMessageStorage(std::move(conn)), robot_model_(robot_model)
+{
+  createCollections();
+  loadTrajectories();
+}
+
+moveit_warehouse::TrajectoryLibrary::~TrajectoryLibrary() = default;
+
+void moveit_warehouse::TrajectoryLibrary::createCollections()
+{
+  trajectory_collection_ = conn_->openCollectionPtr<moveit_msgs::msg::RobotTrajectory>(DATABASE_NAME, "trajectories");
+}
+
+void moveit_warehouse::TrajectoryLibrary::reset()
+{
+  trajectory_collection_.reset();
+  conn_->dropDatabase(DATABASE_NAME);
+  createCollections();
+  std::unique_lock<std::shared_mutex> lock(groups_lock_);
+  groups_.clear();
+}
+
+void moveit_warehouse::TrajectoryLibrary::loadTrajectories()
+{
+  moveit::core::RobotState reference_state(robot_model_);
+  reference_state.setToDefaultValues();
+
+  Query::Ptr q = trajectory_collection_->createQuery();
+  q->append(ROBOT_NAME, robot_model_->getName());
+  std::size_t loaded = 0;
+  auto results = trajectory_collection_->query(q, false);
+  for (auto it = results.first; it != results.second; ++it)
+  {
+    const auto entry = *it;
+    if (!entry->lookupField(GROUP_NAME))
+      continue;
+    const std::string group = entry->lookupString(GROUP_NAME);
+    if (!robot_model_->hasJointModelGroup(group))
+    {
+      RCLCPP_WARN(LOGGER, "Skipping stored trajectory for unknown group '%s'", group.c_str());
+      continue;
+    }
+    auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, group);
+    trajectory->setRobotTrajectoryMsg(reference_state, *entry);
+    if (trajectory->empty())
+      continue;
+    indexTrajectory(trajectory);
+    ++loaded;
+  }
+  RCLCPP_DEBUG(LOGGER, "Loaded %zu trajectories for robot '%s'", loaded, robot_model_->getName().c_str());
+}
+
+void moveit_warehouse::TrajectoryLibrary::indexTrajectory(const robot_trajectory::RobotTrajectoryConstPtr& trajectory)
+{
+  const moveit::core::JointModelGroup* jmg = trajectory->getGroup();
+  std::shared_ptr<GroupIndex>& index = groups_[jmg->getName()];
+  if (!index)
+    index = std::make_shared<GroupIndex>(jmg);
+
+  const moveit::core::RobotState& start = trajectory->getFirstWayPoint();
+  const moveit::core::RobotState& goal = trajectory->getLastWayPoint();
+  index->trajectories.push_back(trajectory);
+  index->joint_index.add(jointKey(jmg, start, goal));
+  for (auto& [link, task_index] : index->task_indexes)
+    task_index.add(taskKey(linkPosition(start, link), linkPosition(goal, link)));
+}
+
+bool moveit_warehouse::TrajectoryLibrary::addTrajectory(const robot_trajectory::RobotTrajectory& trajectory)
+{
+  if (!trajectory.getGroup() || trajectory.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "Only non-empty trajectories of a group can be added to the trajectory library");
+    return false;
+  }
+
+  moveit_msgs::msg::RobotTrajectory msg;
+  trajectory.getRobotTrajectoryMsg(msg);
+  Metadata::Ptr metadata = trajectory_collection_->createMetadata();
+  metadata->append(ROBOT_NAME, robot_model_->getName());
+  metadata->append(GROUP_NAME, trajectory.getGroupName());
+  trajectory_collection_->insert(msg, metadata);
+
+  std::unique_lock<std::shared_mutex> lock(groups_lock_);
+  indexTrajectory(std::make_shared<const robot_trajectory::RobotTrajectory>(trajectory, true));
+  return true;
+}
+
+bool moveit_warehouse::TrajectoryLibrary::addTaskSpaceIndex(const std::string& group, const std::string& link)
+{
+  if (!robot_model_->hasJointModelGroup(group) || !robot_model_->hasLinkModel(link))
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot index group '%s' by unknown group or link '%s'", group.c_str(), link.c_str());
+    return false;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(groups_lock_);
+  std::shared_ptr<GroupIndex>& index = groups_[group];
+  if (!index)
+    index = std::make_shared<GroupIndex>(robot_model_->getJointModelGroup(group));
+  if (index->task_indexes.count(link))
+    return true;
+
+  NearestNeighborIndex& task_index = index->task_indexes.emplace(link, NearestNeighborIndex(6)).first->second;
+  for (const robot_trajectory::RobotTrajectoryConstPtr& trajectory : index->trajectories)
+    task_index.add(taskKey(linkPosition(trajectory->getFirstWayPoint(), link),
+                           linkPosition(trajectory->getLastWayPoint(), link)));
+  return true;
+}
+
+std::size_t moveit_warehouse::TrajectoryLibrary::getTrajectoryCount(const std::string& group) const
+{
+  std::shared_lock<std::shared_mutex> lock(groups_lock_);
+  auto it = groups_.find(group);
+  return it == groups_.end() ? 0 : it->second->trajectories.size();
+}
+
+std::vector<robot_trajectory::RobotTrajectoryConstPtr> moveit_warehouse::TrajectoryLibrary::getNearestTrajectories(
+    const std::string& group, const moveit::core::RobotState& start, const moveit::core::RobotState& goal,
+    std::size_t count, double max_distance) const
+{
+  std::vector<robot_trajectory::RobotTrajectoryConstPtr> trajectories;
+  std::shared_lock<std::shared_mutex> lock(groups_lock_);
+  auto it = groups_.find(group);
+  if (it == groups_.end())
+    return trajectories;
+
+  const GroupIndex& index = *it->second;
+  for (std::size_t id : index.joint_index.nearest(jointKey(index.group, start, goal), count, max_distance))
+    trajectories.push_back(index.trajectories[id]);
+  return trajectories;
+}
+
+std::vector<robot_trajectory::RobotTrajectoryConstPtr> moveit_warehouse::TrajectoryLibrary::getNearestTrajectories(
+    const std::string& group, const moveit::core::RobotState& start, const std::string& link,
+    const Eigen::Vector3d& goal_position, std::size_t count, double max_distance) const
+{
+  std::vector<robot_trajectory::RobotTrajectoryConstPtr> trajectories;
+  std::shared_lock<std::shared_mutex> lock(groups_lock_);
+  auto it = groups_.find(group);
+  if (it == groups_.end())
+    return trajectories;
+
+  const GroupIndex& index = *it->second;
+  auto task_index = index.task_indexes.find(link);
+  if (task_index == index.task_indexes.end())
+  {
+    RCLCPP_WARN(LOGGER, "Group '%s' has no task space index for link '%s'", group.c_str(), link.c_str());
+    return trajectories;
+  }
+  const std::vector<double> key = taskKey(linkPosition(start, link), goal_position);
+  for (std::size_t id : task_index->second.nearest(key, count, max_distance))
+    trajectories.push_back(index.trajectories[id]);
+  return trajectories;
+}
+
+planning_pipeline::PlanningPipeline::PlanCandidateSourceFn
+moveit_warehouse::TrajectoryLibrary::getPlanCandidateSource(std::size_t count, double max_joint_distance,
+                                                            double max_task_distance) const
+{
+  return [this, count, max_joint_distance, max_task_distance](const planning_scene::PlanningSceneConstPtr& scene,
+                                                              const planning_interface::MotionPlanRequest& req) {
+    std::vector<robot_trajectory::RobotTrajectoryConstPtr> none;
+    if (req.goal_constraints.empty() || !robot_model_->hasJointModelGroup(req.group_name))
+      return none;
+
+    moveit::core::RobotState start = scene->getCurrentState();
+    moveit::core::robotStateMsgToRobotState(scene->getTransforms(), req.start_state, start);
+    const moveit_msgs::msg::Constraints& goal = req.goal_constraints.front();
+    const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup(req.group_name);
+
+    if (!goal.joint_constraints.empty() && goal.joint_constraints.size() >= jmg->getVariableCount())
+    {
+      moveit::core::RobotState goal_state(start);
+      for (const moveit_msgs::msg::JointConstraint& constraint : goal.joint_constraints)
+      {
+        const std::vector<std::string>& variables = robot_model_->getVariableNames();
+        if (std::find(variables.begin(), variables.end(), constraint.joint_name) == variables.end())
+          return none;
+        goal_state.setVariablePosition(constraint.joint_name, constraint.position);
+      }
+      return getNearestTrajectories(req.group_name, start, goal_state, count, max_joint_distance);
+    }
+
+    if (goal.joint_constraints.empty() && goal.position_constraints.size() == 1 &&
+        !goal.position_constraints.front().constraint_region.primitive_poses.empty())
+    {
+      const moveit_msgs::msg::PositionConstraint& constraint = goal.position_constraints.front();
+      Eigen::Vector3d target;
+      tf2::fromMsg(constraint.constraint_region.primitive_poses.front().position, target);
+      target = scene->getFrameTransform(constraint.header.frame_id) * target;
+      return getNearestTrajectories(req.group_name, start, constraint.link_name, target, count, max_task_distance);
+    }
+    return none;
+  };
+}
@@ -84,11 +84,14 @@ typedef std::map<std::pair<std::string, std::string>, LinkPairData> LinkPairMap;
  * \param trials Set the number random collision checks that are made. Increase the probability of correctness
  * \param min_collision_fraction If collisions are found between a pair of links >= this fraction, the are assumed
  * "always" in collision
+ * \param convergence_fraction Stop sampling for links that are never in collision early, once no new pair was seen
+ * colliding in this fraction of the trials. 1 always runs all trials
  * \return Adj List of unique set of pairs of links in string-based form
  */
 LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene, unsigned int* progress,
                                      const bool include_never_colliding, const unsigned int trials,
-                                     const double min_collision_faction, const bool verbose);
+                                     const double min_collision_faction, const bool verbose,
+                                     const double convergence_fraction = 0.25);
 
 /**
  * \brief Generate a list of unique link pairs for all links with geometry. Order pairs alphabetically. n choose 2 pairs
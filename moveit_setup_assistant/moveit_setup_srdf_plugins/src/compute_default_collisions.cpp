@@ -62,28 +62,33 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("collision_updater");
 // Unique set of pairs of links in string-based form
 typedef std::set<std::pair<std::string, std::string> > StringPairSet;
 
+// Sampling progress shared by the threads looking for links that are never in collision
+struct NeverInCollisionSampling
+{
+  std::mutex lock;
+  StringPairSet* links_seen_colliding;
+  // links_seen_colliding in the order the pairs were found, so threads can catch up incrementally
+  std::vector<std::pair<std::string, std::string> > seen_order;
+  unsigned int num_trials;
+  unsigned int convergence_trials;  // stop if no new pair was seen in this many trials
+  unsigned int claimed_trials = 0;
+  unsigned int finished_trials = 0;
+  unsigned int last_discovery = 0;  // finished_trials when the last new pair was seen
+  unsigned int* progress;
+};
+
 // Struct for passing parameters to threads, for cleaner code
 struct ThreadComputation
 {
-  ThreadComputation(planning_scene::PlanningScene& scene, const collision_detection::CollisionRequest& req,
-                    int thread_id, int num_trials, StringPairSet* links_seen_colliding, std::mutex* lock,
-                    unsigned int* progress)
-    : scene_(scene)
-    , req_(req)
-    , thread_id_(thread_id)
-    , num_trials_(num_trials)
-    , links_seen_colliding_(links_seen_colliding)
-    , lock_(lock)
-    , progress_(progress)
+  ThreadComputation(const planning_scene::PlanningScene& scene, const collision_detection::CollisionRequest& req,
+                    int thread_id, NeverInCollisionSampling* sampling)
+    : scene_(scene), req_(req), thread_id_(thread_id), sampling_(sampling)
   {
   }
-  planning_scene::PlanningScene& scene_;
+  const planning_scene::PlanningScene& scene_;
   const collision_detection::CollisionRequest& req_;
   int thread_id_;
-  unsigned int num_trials_;
-  StringPairSet* links_seen_colliding_;
-  std::mutex* lock_;
-  unsigned int* progress_;  // only to be updated by thread 0
+  NeverInCollisionSampling* sampling_;
 };
 
 // LinkGraph defines a Link's model and a set of unique links it connects
@@ -158,11 +163,13 @@ static unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scen
  * \param link_pairs List of all unique link pairs and each pair's properties
  * \param req A reference to a collision request that is already initialized
  * \param links_seen_colliding Set of links that have at some point been seen in collision
+ * \param convergence_fraction Stop early once no new pair was seen colliding in this fraction of num_trials
  * \return number of never in collision links found and disabled
  */
 static unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                             LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                            StringPairSet& links_seen_colliding, unsigned int* progress);
+                                            StringPairSet& links_seen_colliding, unsigned int* progress,
+                                            double convergence_fraction);
 
 /**
  * \brief Thread for getting the pairs of links that are never in collision
@@ -175,7 +182,8 @@ static void disableNeverInCollisionThread(ThreadComputation tc);
 // ******************************************************************************************
 LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene, unsigned int* progress,
                                      const bool include_never_colliding, const unsigned int num_trials,
-                                     const double min_collision_fraction, const bool verbose)
+                                     const double min_collision_fraction, const bool verbose,
+                                     const double convergence_fraction)
 {
   // Create new instance of planning scene using pointer
   planning_scene::PlanningScenePtr scene = parent_scene->diff();
@@ -240,7 +248,8 @@ LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr
   unsigned int num_never = 0;
   if (include_never_colliding)  // option of function
   {
-    num_never = disableNeverInCollision(num_trials, *scene, link_pairs, req, links_seen_colliding, progress);
+    num_never = disableNeverInCollision(num_trials, *scene, link_pairs, req, links_seen_colliding, progress,
+                                        convergence_fraction);
   }
 
   // RCLCPP_INFO_STREAM(LOGGER, "Link pairs seen colliding ever: %d", int(links_seen_colliding.size()));
@@ -553,19 +562,26 @@ unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scene, Link
 // ******************************************************************************************
 unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                      LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                     StringPairSet& links_seen_colliding, unsigned int* progress)
+                                     StringPairSet& links_seen_colliding, unsigned int* progress,
+                                     double convergence_fraction)
 {
   unsigned int num_disabled = 0;
   std::vector<std::thread> bgroup;
-  std::mutex lock;  // used for sharing the same data structures
 
-  int num_threads = std::thread::hardware_concurrency();  // how many cores does this computer have?
+  NeverInCollisionSampling sampling;
+  sampling.links_seen_colliding = &links_seen_colliding;
+  sampling.seen_order.assign(links_seen_colliding.begin(), links_seen_colliding.end());
+  sampling.num_trials = num_trials;
+  sampling.convergence_trials = std::max(1u, static_cast<unsigned int>(num_trials * convergence_fraction));
+  sampling.progress = progress;
+
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());  // how many cores does this computer have?
   // RCLCPP_INFO_STREAM_STREAM(LOGGER, "Performing " << num_trials << " trials for 'always in collision' checking on " <<
   //   num_threads << " threads...");
 
   for (int i = 0; i < num_threads; ++i)
   {
-    ThreadComputation tc(scene, req, i, num_trials / num_threads, &links_seen_colliding, &lock, progress);
+    ThreadComputation tc(scene, req, i, &sampling);
     bgroup.push_back(std::thread([tc] { return disableNeverInCollisionThread(tc); }));
   }
 
@@ -573,6 +589,8 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
   {
     thread.join();
   }
+  RCLCPP_DEBUG_STREAM(LOGGER, "Sampled " << sampling.finished_trials << " of " << num_trials
+                                         << " trials for links that are never in collision");
 
   // Loop through every possible link pair and check if it has ever been seen in collision
   for (std::pair<const std::pair<std::string, std::string>, LinkPairData>& link_pair : link_pairs)
@@ -602,43 +620,61 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
 // ******************************************************************************************
 void disableNeverInCollisionThread(ThreadComputation tc)
 {
-  // RCLCPP_INFO_STREAM_STREAM(LOGGER, "Thread " << tc.thread_id_ << " running " << tc.num_trials_ << " trials");
-
-  // User feedback vars
-  const unsigned int progress_interval = tc.num_trials_ / 20;  // show progress update every 5%
+  // Trials are claimed and reported in batches, so that threads rarely need to synchronize
+  static const unsigned int BATCH_SIZE = 100;
+  NeverInCollisionSampling& sampling = *tc.sampling_;
 
   // Create a new kinematic state for this thread to work on
   moveit::core::RobotState robot_state(tc.scene_.getRobotModel());
 
-  // Do a large number of tests
-  for (unsigned int i = 0; i < tc.num_trials_; ++i)
-  {
-    boost::this_thread::interruption_point();
+  // Pairs that are decided or have been seen colliding are allowed, so only undecided pairs are checked in detail
+  collision_detection::AllowedCollisionMatrix acm = tc.scene_.getAllowedCollisionMatrix();
+  std::size_t num_allowed = 0;  // elements of sampling.seen_order that are allowed in acm
+  StringPairSet found;
+  unsigned int batch = 0;
 
-    // Status update at intervals and only for 0 thread
-    if (i % progress_interval == 0 && tc.thread_id_ == 0)
+  while (true)
+  {
     {
-      (*tc.progress_) = i * 92 / tc.num_trials_ + 8;  // 8 is the amount of progress already completed in prev steps
+      std::scoped_lock slock(sampling.lock);
+      sampling.finished_trials += batch;
+      for (const std::pair<std::string, std::string>& pair : found)
+      {
+        if (sampling.links_seen_colliding->insert(pair).second)
+        {
+          sampling.seen_order.push_back(pair);
+          sampling.last_discovery = sampling.finished_trials;
+        }
+      }
+      found.clear();
+      for (; num_allowed < sampling.seen_order.size(); ++num_allowed)
+        acm.setEntry(sampling.seen_order[num_allowed].first, sampling.seen_order[num_allowed].second, true);
+
+      // Status update, 8 is the amount of progress already completed in prev steps
+      (*sampling.progress) = sampling.finished_trials * 92 / std::max(1u, sampling.num_trials) + 8;
+
+      // Stop once all trials are claimed, or once the set of colliding pairs has not changed for long enough
+      batch = std::min(BATCH_SIZE, sampling.num_trials - sampling.claimed_trials);
+      if (batch == 0 || sampling.finished_trials - sampling.last_discovery >= sampling.convergence_trials)
+        break;
+      sampling.claimed_trials += batch;
     }
 
-    collision_detection::CollisionResult res;
-    robot_state.setToRandomPositions();
-    tc.scene_.checkSelfCollision(tc.req_, res, robot_state);
-
-    // Check all contacts
-    for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
-         it != res.contacts.end(); ++it)
+    for (unsigned int i = 0; i < batch; ++i)
     {
-      // Check if this collision pair is unique before doing a thread lock
-      if (tc.links_seen_colliding_->find(it->first) == tc.links_seen_colliding_->end())
-      {
-        // Collision Matrix and links_seen_colliding is modified only if needed, based on above if statement
+      boost::this_thread::interruption_point();
 
-        std::scoped_lock slock(*tc.lock_);
-        tc.links_seen_colliding_->insert(it->first);
+      collision_detection::CollisionResult res;
+      robot_state.setToRandomPositions();
+      tc.scene_.checkSelfCollision(tc.req_, res, robot_state, acm);
 
-        tc.scene_.getAllowedCollisionMatrixNonConst().setEntry(it->first.first, it->first.second,
-                                                               true);  // disable link checking in the collision matrix
+      // Check all contacts
+      for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
+           it != res.contacts.end(); ++it)
+      {
+        // disable link checking locally, the pair is shared with the other threads after the batch
+        if (found.insert(it->first).second)
+          acm.setEntry(it->first.first, it->first.second, true);
       }
     }
   }